@@ -0,0 +1,2 @@
+#include "udfs/rebalancer/rebalancer_load_strategy--0.108-0.sql"
+#include "udfs/clustermgmt/colocation_advisor--0.108-0.sql"
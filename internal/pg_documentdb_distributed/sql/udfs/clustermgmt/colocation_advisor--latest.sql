@@ -0,0 +1,5 @@
+CREATE OR REPLACE FUNCTION __API_DISTRIBUTED_SCHEMA__.colocation_advisor(p_spec __CORE_SCHEMA_V2__.bson)
+ RETURNS __CORE_SCHEMA_V2__.bson
+ LANGUAGE C
+   STRICT
+ AS 'MODULE_PATHNAME', $$command_colocation_advisor$$;
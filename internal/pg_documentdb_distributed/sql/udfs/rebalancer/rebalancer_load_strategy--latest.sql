@@ -0,0 +1,23 @@
+CREATE OR REPLACE FUNCTION __API_DISTRIBUTED_SCHEMA__.shard_load_cost(shardid bigint)
+ RETURNS real
+ LANGUAGE C
+   STRICT
+ AS 'MODULE_PATHNAME', $$shard_load_cost$$;
+
+/*
+ * The by_load strategy balances the rows read and written per node. Like by_disk_size,
+ * a move is only made if it improves the balance by half the cost of the shard, which
+ * keeps a skewed tenant from bouncing its shards between nodes.
+ */
+DO $$
+BEGIN
+    IF NOT EXISTS (SELECT 1 FROM pg_catalog.pg_dist_rebalance_strategy WHERE name = 'by_load') THEN
+        PERFORM citus_add_rebalance_strategy(
+            'by_load',
+            (__SINGLE_QUOTED_STRING__(__API_DISTRIBUTED_SCHEMA__) || '.shard_load_cost')::regproc,
+            'citus_node_capacity_1',
+            'citus_shard_allowed_on_node_true',
+            0.1, 0.01, 0.5);
+    END IF;
+END;
+$$;
@@ -23,6 +23,7 @@
 #include "io/bson_core.h"
 #include "utils/documentdb_errors.h"
 #include "utils/query_utils.h"
+#include "commands/parse_error.h"
 
 #include "metadata/metadata_cache.h"
 #include "metadata/collection.h"
@@ -33,6 +34,10 @@
 
 PG_FUNCTION_INFO_V1(command_get_shard_map);
 PG_FUNCTION_INFO_V1(command_list_shards);
+PG_FUNCTION_INFO_V1(command_colocation_advisor);
+
+extern bool EnableColocationAdvisorApply;
+extern int MaxReplicatedCollectionSizeMB;
 
 
 /*
@@ -93,6 +98,10 @@ static int GetColocationForTable(Oid tableOid, const char *collectionName,
 
 static void ColocateShardedCitusTablesWithNone(const char *sourceTableName);
 static void ColocateUnshardedCitusTablesWithNone(const char *sourceTableName);
+static void HandleReplicatedColocation(MongoCollection *collection,
+									   const char *tableWithNamespace, bool replicated);
+static void ReplicateUnshardedCitusTable(const char *sourceTableName);
+static bool IsCitusReferenceTable(const char *sourceTableName);
 static void MoveShardToDistributedTable(const char *postgresTableToMove, const
 										char *targetShardTable);
 static void UndistributeAndRedistributeTable(const char *postgresTable, const
@@ -109,6 +118,8 @@ static Query * RewriteConfigChunksQueryForDistribution(Query *source);
 static List * GetShardMapNodes(void);
 static void WriteShardMap(pgbson_writer *writer, List *groupNodes);
 static void WriteShardList(pgbson_writer *writer, List *groupNodes);
+static bool ApplyColocationRecommendation(const bson_value_t *recommendation,
+										  List **colocatedCollections);
 
 /*
  * Implements the getShardMap command
@@ -150,6 +161,122 @@ command_list_shards(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Implements the colocation advisor: Lists the pairs of unsharded collections of
+ * the same database that are joined by $lookup, $graphLookup or $unionWith
+ * (as counted in collection_join_stats) at least minJoins times, most joined first:
+ * {
+ *    "recommendations": [ { "database", "collection", "colocateWith", "joins", "colocated", "applied" } ],
+ * }
+ * With apply: true (and enable_colocation_advisor_apply), the collections that
+ * aren't colocated yet are colocated with the collection they join. This can
+ * be scheduled (e.g. with pg_cron) to colocate collections as they get joined.
+ */
+Datum
+command_colocation_advisor(PG_FUNCTION_ARGS)
+{
+	pgbson *spec = PG_GETARG_PGBSON(0);
+
+	int64 minJoins = 1;
+	bool apply = false;
+	bson_iter_t specIter;
+	PgbsonInitIterator(spec, &specIter);
+	while (bson_iter_next(&specIter))
+	{
+		const char *key = bson_iter_key(&specIter);
+		if (strcmp(key, "minJoins") == 0)
+		{
+			if (!BSON_ITER_HOLDS_NUMBER(&specIter))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_TYPEMISMATCH),
+								errmsg("minJoins must be a number, not %s",
+									   BsonTypeName(bson_iter_type(&specIter)))));
+			}
+
+			minJoins = BsonValueAsInt64(bson_iter_value(&specIter));
+		}
+		else if (strcmp(key, "apply") == 0)
+		{
+			EnsureTopLevelFieldType("apply", &specIter, BSON_TYPE_BOOL);
+			apply = bson_iter_bool(&specIter);
+		}
+		else
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_FAILEDTOPARSE),
+							errmsg("Unrecognized field in colocation advisor: %s", key),
+							errdetail_log("Unrecognized field in colocation advisor: %s",
+										  key)));
+		}
+	}
+
+	if (apply && !EnableColocationAdvisorApply)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("Applying the colocation advisor is not enabled")));
+	}
+
+	const char *query = FormatSqlQuery(
+		"WITH r1 AS (SELECT s.database_name, s.collection_name, t.collection_name AS target_name,"
+		" j.join_count, ps.colocationid = pt.colocationid AS colocated"
+		" FROM %s.collection_join_stats() j"
+		" JOIN %s.collections s ON s.collection_id = j.source_collection_id"
+		" JOIN %s.collections t ON t.collection_id = j.target_collection_id"
+		" JOIN pg_catalog.pg_dist_partition ps ON ps.logicalrelid = ('%s.documents_' || s.collection_id)::regclass"
+		" JOIN pg_catalog.pg_dist_partition pt ON pt.logicalrelid = ('%s.documents_' || t.collection_id)::regclass"
+		" WHERE s.database_name = t.database_name AND s.shard_key IS NULL AND t.shard_key IS NULL"
+		" AND s.view_definition IS NULL AND t.view_definition IS NULL AND j.join_count >= $1)"
+		" SELECT %s.bson_json_to_bson(jsonb_build_object('recommendations', COALESCE(jsonb_agg("
+		" jsonb_build_object('database', database_name, 'collection', collection_name,"
+		" 'colocateWith', target_name, 'joins', join_count, 'colocated', colocated)"
+		" ORDER BY join_count DESC), '[]'::jsonb))::text) FROM r1",
+		DocumentDBApiInternalSchemaName, ApiCatalogSchemaName, ApiCatalogSchemaName,
+		ApiDataSchemaName, ApiDataSchemaName, CoreSchemaName);
+
+	Oid argTypes[1] = { INT8OID };
+	Datum argValues[1] = { Int64GetDatum(minJoins) };
+	char *argNulls = NULL;
+	bool readOnly = !apply;
+	bool isNull = false;
+	Datum result = ExtensionExecuteQueryWithArgsViaSPI(query, 1, argTypes, argValues,
+													   argNulls, readOnly, SPI_OK_SELECT,
+													   &isNull);
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	pgbson_array_writer recommendationsWriter;
+	PgbsonWriterStartArray(&writer, "recommendations", 15, &recommendationsWriter);
+	if (!isNull)
+	{
+		pgbsonelement element;
+		PgbsonToSinglePgbsonElement(DatumGetPgBson(result), &element);
+
+		List *colocatedCollections = NIL;
+		bson_iter_t recommendationsIter;
+		BsonValueInitIterator(&element.bsonValue, &recommendationsIter);
+		while (bson_iter_next(&recommendationsIter))
+		{
+			const bson_value_t *recommendation = bson_iter_value(&recommendationsIter);
+			bool applied = apply &&
+						   ApplyColocationRecommendation(recommendation,
+														 &colocatedCollections);
+
+			pgbson_writer recommendationWriter;
+			PgbsonArrayWriterStartDocument(&recommendationsWriter,
+										   &recommendationWriter);
+			PgbsonWriterConcat(&recommendationWriter,
+							   PgbsonInitFromDocumentBsonValue(recommendation));
+			PgbsonWriterAppendBool(&recommendationWriter, "applied", 7, applied);
+			PgbsonArrayWriterEndDocument(&recommendationsWriter, &recommendationWriter);
+		}
+	}
+
+	PgbsonWriterEndArray(&writer, &recommendationsWriter);
+	PgbsonWriterAppendDouble(&writer, "ok", 2, 1);
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
+}
+
+
 /*
  * override hooks related to colocation.
  */
@@ -163,6 +290,85 @@ UpdateColocationHooks(void)
 }
 
 
+/*
+ * Colocates the collection of a colocation advisor recommendation with the
+ * collection it joins, unless they're already colocated. A collection that was
+ * already colocated (or colocated with) by an earlier recommendation is left
+ * as is, so that the most joined pairs win and no collection moves twice.
+ */
+static bool
+ApplyColocationRecommendation(const bson_value_t *recommendation,
+							  List **colocatedCollections)
+{
+	const char *databaseName = NULL;
+	const char *collectionName = NULL;
+	const char *targetCollectionName = NULL;
+	bool colocated = false;
+
+	bson_iter_t recommendationIter;
+	BsonValueInitIterator(recommendation, &recommendationIter);
+	while (bson_iter_next(&recommendationIter))
+	{
+		const char *key = bson_iter_key(&recommendationIter);
+		if (strcmp(key, "database") == 0)
+		{
+			databaseName = bson_iter_utf8(&recommendationIter, NULL);
+		}
+		else if (strcmp(key, "collection") == 0)
+		{
+			collectionName = bson_iter_utf8(&recommendationIter, NULL);
+		}
+		else if (strcmp(key, "colocateWith") == 0)
+		{
+			targetCollectionName = bson_iter_utf8(&recommendationIter, NULL);
+		}
+		else if (strcmp(key, "colocated") == 0)
+		{
+			colocated = bson_iter_bool(&recommendationIter);
+		}
+	}
+
+	if (colocated || databaseName == NULL || collectionName == NULL ||
+		targetCollectionName == NULL)
+	{
+		return false;
+	}
+
+	char *sourceNamespace = psprintf("%s.%s", databaseName, collectionName);
+	char *targetNamespace = psprintf("%s.%s", databaseName, targetCollectionName);
+	ListCell *namespaceCell;
+	foreach(namespaceCell, *colocatedCollections)
+	{
+		const char *colocatedNamespace = lfirst(namespaceCell);
+		if (strcmp(colocatedNamespace, sourceNamespace) == 0 ||
+			strcmp(colocatedNamespace, targetNamespace) == 0)
+		{
+			return false;
+		}
+	}
+
+	MongoCollection *collection = GetMongoCollectionByNameDatum(
+		CStringGetTextDatum(databaseName), CStringGetTextDatum(collectionName),
+		AccessExclusiveLock);
+	if (collection == NULL)
+	{
+		return false;
+	}
+
+	pgbson_writer colocationWriter;
+	PgbsonWriterInit(&colocationWriter);
+	PgbsonWriterAppendUtf8(&colocationWriter, "collection", 10, targetCollectionName);
+	bson_value_t colocationValue = ConvertPgbsonToBsonValue(
+		PgbsonWriterGetPgbson(&colocationWriter));
+
+	HandleDistributedColocation(collection, &colocationValue);
+
+	*colocatedCollections = lappend(*colocatedCollections, sourceNamespace);
+	*colocatedCollections = lappend(*colocatedCollections, targetNamespace);
+	return true;
+}
+
+
 /*
  * Process colocation options for a distributed DocumentDB deployment.
  */
@@ -189,11 +395,20 @@ HandleDistributedColocation(MongoCollection *collection, const
 
 	StringView collectionName = { 0 };
 	bool colocateWithNull = false;
+	bool hasReplicated = false;
+	bool replicated = false;
 	while (bson_iter_next(&colocationIter))
 	{
 		const char *key = bson_iter_key(&colocationIter);
 
-		if (strcmp(key, "collection") == 0)
+		if (strcmp(key, "replicated") == 0)
+		{
+			EnsureTopLevelFieldType("colocation.replicated", &colocationIter,
+									BSON_TYPE_BOOL);
+			hasReplicated = true;
+			replicated = bson_iter_bool(&colocationIter);
+		}
+		else if (strcmp(key, "collection") == 0)
 		{
 			if (BSON_ITER_HOLDS_UTF8(&colocationIter))
 			{
@@ -223,6 +438,19 @@ HandleDistributedColocation(MongoCollection *collection, const
 		}
 	}
 
+	if (hasReplicated)
+	{
+		if (collectionName.length != 0 || colocateWithNull)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+							errmsg(
+								"Cannot specify both collection and replicated for colocation")));
+		}
+
+		HandleReplicatedColocation(collection, tableWithNamespace, replicated);
+		return;
+	}
+
 	if (collectionName.length == 0 && !colocateWithNull)
 	{
 		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
@@ -281,6 +509,16 @@ HandleDistributedColocation(MongoCollection *collection, const
 		 */
 		char *targetWithNamespace = psprintf("%s.%s", ApiDataSchemaName,
 											 targetCollection->tableName);
+
+		/* Reference tables all share one colocation group: check these first */
+		if (IsCitusReferenceTable(targetWithNamespace))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+							errmsg(
+								"Current collection cannot be colocated with a replicated collection: "
+								"it is already available on every node.")));
+		}
+
 		int colocationId = GetColocationForTable(targetCollection->relationId,
 												 targetCollectionName,
 												 targetWithNamespace);
@@ -976,7 +1214,8 @@ ColocateUnshardedCitusTablesWithNone(const char *sourceTableName)
 	bool resultNullIgnore = false;
 	Oid tableDetailsArgTypes[1] = { TEXTOID };
 	Datum tableDetailsArgValues[1] = { CStringGetTextDatum(sourceTableName) };
-	if (strcmp(distributionColumn, "<none>") == 0)
+	if (strcmp(distributionColumn, "<none>") == 0 &&
+		strcmp(citusTableType, "reference") != 0)
 	{
 		const char *updateColocationQuery =
 			"SELECT update_distributed_table_colocation($1, colocate_with => 'none')";
@@ -995,6 +1234,125 @@ ColocateUnshardedCitusTablesWithNone(const char *sourceTableName)
 }
 
 
+/*
+ * Handles colocation: { replicated: true/false } for collMod. A replicated
+ * collection is a citus reference table: every node has a copy of it that the
+ * writes keep in sync, so that the collections on any node can join it locally
+ * (e.g. in a $lookup from a sharded collection). With replicated: false, a
+ * replicated collection goes back to being a single shard collection that is
+ * not colocated with any other.
+ */
+static void
+HandleReplicatedColocation(MongoCollection *collection, const char *tableWithNamespace,
+						   bool replicated)
+{
+	if (collection->shardKey != NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("Cannot replicate a collection that is already sharded.")));
+	}
+
+	char *retryTableWithNamespace = psprintf("%s.retry_%ld", ApiDataSchemaName,
+											 collection->collectionId);
+	bool isReplicated = IsCitusReferenceTable(tableWithNamespace);
+	if (!replicated)
+	{
+		if (isReplicated)
+		{
+			ColocateUnshardedCitusTablesWithNone(tableWithNamespace);
+
+			const char *retryTableShardKeyValue = NULL;
+			UndistributeAndRedistributeTable(retryTableWithNamespace,
+											 tableWithNamespace,
+											 retryTableShardKeyValue);
+		}
+
+		return;
+	}
+
+	if (isReplicated)
+	{
+		return;
+	}
+
+	/*
+	 * Every node gets a copy: only small collections can be replicated. The size
+	 * rounds up to the next MB, so that any data counts against a limit of 0.
+	 */
+	const char *sizeQuery = "SELECT citus_total_relation_size($1::regclass)";
+	Oid sizeArgTypes[1] = { TEXTOID };
+	Datum sizeArgValues[1] = { CStringGetTextDatum(tableWithNamespace) };
+	char *argNulls = NULL;
+	bool readOnly = true;
+	bool isNull = false;
+	Datum sizeDatum = ExtensionExecuteQueryWithArgsViaSPI(sizeQuery, 1, sizeArgTypes,
+														  sizeArgValues, argNulls,
+														  readOnly, SPI_OK_SELECT,
+														  &isNull);
+	int64 collectionSizeBytes = isNull ? 0 : DatumGetInt64(sizeDatum);
+	int64 collectionSizeMB = (collectionSizeBytes + (1024 * 1024) - 1) / (1024 * 1024);
+	if (collectionSizeMB > MaxReplicatedCollectionSizeMB)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg(
+							"Collection %s.%s is too large to be replicated: %ld MB. The limit is %d MB",
+							collection->name.databaseName,
+							collection->name.collectionName, collectionSizeMB,
+							MaxReplicatedCollectionSizeMB),
+						errdetail_log(
+							"Collection is too large to be replicated: %ld MB. The limit is %d MB",
+							collectionSizeMB, MaxReplicatedCollectionSizeMB)));
+	}
+
+	ReplicateUnshardedCitusTable(tableWithNamespace);
+	ReplicateUnshardedCitusTable(retryTableWithNamespace);
+}
+
+
+/*
+ * Converts an unsharded citus table into a reference table.
+ */
+static void
+ReplicateUnshardedCitusTable(const char *sourceTableName)
+{
+	if (IsCitusReferenceTable(sourceTableName))
+	{
+		return;
+	}
+
+	bool readOnly = false;
+	char *argNulls = NULL;
+	bool resultNullIgnore = false;
+	Oid tableDetailsArgTypes[1] = { TEXTOID };
+	Datum tableDetailsArgValues[1] = { CStringGetTextDatum(sourceTableName) };
+
+	const char *undistributeTable = "SELECT undistribute_table($1)";
+	ExtensionExecuteQueryWithArgsViaSPI(undistributeTable, 1, tableDetailsArgTypes,
+										tableDetailsArgValues, argNulls, readOnly,
+										SPI_OK_SELECT, &resultNullIgnore);
+
+	const char *createReferenceTable = "SELECT create_reference_table($1::regclass)";
+	ExtensionExecuteQueryWithArgsViaSPI(createReferenceTable, 1, tableDetailsArgTypes,
+										tableDetailsArgValues, argNulls, readOnly,
+										SPI_OK_SELECT, &resultNullIgnore);
+}
+
+
+/*
+ * Returns whether the citus table is a reference table.
+ */
+static bool
+IsCitusReferenceTable(const char *sourceTableName)
+{
+	const char *citusTableType = NULL;
+	const char *distributionColumn = NULL;
+	int64 shardCount = 0;
+	GetCitusTableDistributionDetails(sourceTableName, &citusTableType,
+									 &distributionColumn, &shardCount);
+	return strcmp(citusTableType, "reference") == 0;
+}
+
+
 /*
  * Core logic for colocating 2 unsharded citus tables.
  */
@@ -318,6 +318,8 @@ RunMultiValueQueryWithNestedDistributionCore(const char *query, int nArgs, Oid *
  * e.g. for documents_1 returns documents_1_102011.
  * If shards are unavailable returns NULL - can be retried.
  * If the shard is remote and not loca - returns ""
+ * Replicated collections (reference tables) also return "": the writes must
+ * go through citus to reach the copies on every node.
  */
 static const char *
 TryGetShardNameForUnshardedCollectionCore(Oid relationId, uint64 collectionId, const
@@ -330,16 +332,17 @@ TryGetShardNameForUnshardedCollectionCore(Oid relationId, uint64 collectionId, c
 	}
 
 	const char *shardIdDetailsQuery =
-		"SELECT shardid, shardminvalue, shardmaxvalue FROM pg_dist_shard WHERE logicalrelid = $1 LIMIT 1";
+		"SELECT s.shardid, s.shardminvalue, s.shardmaxvalue, p.repmodel = 't' FROM pg_dist_shard s"
+		" JOIN pg_dist_partition p ON p.logicalrelid = s.logicalrelid WHERE s.logicalrelid = $1 LIMIT 1";
 
 	Oid shardCountArgTypes[1] = { OIDOID };
 	Datum shardCountArgValues[1] = { ObjectIdGetDatum(relationId) };
 	char *argNullNone = NULL;
 	bool readOnly = true;
 
-	int numValues = 3;
-	Datum resultDatums[3] = { 0 };
-	bool resultNulls[3] = { 0 };
+	int numValues = 4;
+	Datum resultDatums[4] = { 0 };
+	bool resultNulls[4] = { 0 };
 
 	ExtensionExecuteMultiValueQueryWithArgsViaSPI(
 		shardIdDetailsQuery, 1, shardCountArgTypes, shardCountArgValues, argNullNone,
@@ -350,6 +353,12 @@ TryGetShardNameForUnshardedCollectionCore(Oid relationId, uint64 collectionId, c
 		return NULL;
 	}
 
+	if (!resultNulls[3] && DatumGetBool(resultDatums[3]))
+	{
+		/* reference table */
+		return "";
+	}
+
 	int64_t shardIdValue = DatumGetInt64(resultDatums[0]);
 
 	/* Only support this for single shard distributed
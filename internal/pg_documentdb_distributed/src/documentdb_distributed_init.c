@@ -23,6 +23,12 @@ bool EnableMetadataReferenceTableSync = DEFAULT_ENABLE_METADATA_REFERENCE_SYNC;
 #define DEFAULT_ENABLE_SHARD_REBALANCER false
 bool EnableShardRebalancer = DEFAULT_ENABLE_SHARD_REBALANCER;
 
+#define DEFAULT_ENABLE_COLOCATION_ADVISOR_APPLY false
+bool EnableColocationAdvisorApply = DEFAULT_ENABLE_COLOCATION_ADVISOR_APPLY;
+
+#define DEFAULT_MAX_REPLICATED_COLLECTION_SIZE_MB 100
+int MaxReplicatedCollectionSizeMB = DEFAULT_MAX_REPLICATED_COLLECTION_SIZE_MB;
+
 #define DEFAULT_CLUSTER_ADMIN_ROLE ""
 char *ClusterAdminRole = DEFAULT_CLUSTER_ADMIN_ROLE;
 
@@ -50,6 +56,20 @@ InitDocumentDBDistributedConfigurations(const char *prefix)
 		NULL, &EnableShardRebalancer, DEFAULT_ENABLE_SHARD_REBALANCER,
 		PGC_USERSET, 0, NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		psprintf("%s.enable_colocation_advisor_apply", prefix),
+		gettext_noop(
+			"Determines whether or not the colocation advisor can colocate the collections it recommends."),
+		NULL, &EnableColocationAdvisorApply, DEFAULT_ENABLE_COLOCATION_ADVISOR_APPLY,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.max_replicated_collection_size_mb", prefix),
+		gettext_noop(
+			"The max size in MB of a collection that collMod can replicate to every node."),
+		NULL, &MaxReplicatedCollectionSizeMB, DEFAULT_MAX_REPLICATED_COLLECTION_SIZE_MB,
+		0, INT_MAX, PGC_SUSET, GUC_UNIT_MB, NULL, NULL, NULL);
+
 	DefineCustomStringVariable(
 		psprintf("%s.clusterAdminRole", prefix),
 		gettext_noop(
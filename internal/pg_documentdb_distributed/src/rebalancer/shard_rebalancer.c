@@ -17,6 +17,8 @@
 #include "utils/typcache.h"
 #include "parser/parse_type.h"
 #include "nodes/makefuncs.h"
+#include "utils/hsearch.h"
+#include "utils/memutils.h"
 
 #include "io/bson_core.h"
 #include "utils/documentdb_errors.h"
@@ -30,6 +32,26 @@ extern bool EnableShardRebalancer;
 PG_FUNCTION_INFO_V1(command_rebalancer_status);
 PG_FUNCTION_INFO_V1(command_rebalancer_start);
 PG_FUNCTION_INFO_V1(command_rebalancer_stop);
+PG_FUNCTION_INFO_V1(shard_load_cost);
+
+/*
+ * The load of a shard as seen by the by_load rebalance strategy.
+ */
+typedef struct ShardLoadEntry
+{
+	/* The id of the shard (hash key) */
+	int64 shardId;
+
+	/* The rows read and written on the shard */
+	double load;
+} ShardLoadEntry;
+
+/*
+ * The loads of the shards for the current transaction: Citus computes the cost of
+ * every shard when planning a rebalance, so the loads are collected from all
+ * the nodes once and reused. Reset when the transaction ends.
+ */
+static HTAB *ShardLoadHash = NULL;
 
 
 static void PopulateRebalancerRowsFromResponse(pgbson_writer *responseWriter,
@@ -37,6 +59,8 @@ static void PopulateRebalancerRowsFromResponse(pgbson_writer *responseWriter,
 
 static bool HasActiveRebalancing(void);
 static char * GetRebalancerStrategy(pgbson *startArgs);
+static HTAB * GetShardLoadHash(void);
+static void ResetShardLoadHash(void *arg);
 
 Datum
 command_rebalancer_status(PG_FUNCTION_ARGS)
@@ -169,6 +193,34 @@ command_rebalancer_stop(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * The shard cost function of the by_load rebalance strategy. The cost of a
+ * shard is the number of rows read (by sequential and index scans) and written
+ * on it according to the statistics of the node that holds it, plus one so that
+ * idle shards are still spread out like by_shard_count does.
+ *
+ * Moving a hot shard off a node moves its cost, so the rebalancer evens out the
+ * throughput of the nodes rather than their shard counts or sizes.
+ */
+Datum
+shard_load_cost(PG_FUNCTION_ARGS)
+{
+	int64 shardId = PG_GETARG_INT64(0);
+
+	bool found = false;
+	ShardLoadEntry *entry = hash_search(GetShardLoadHash(), &shardId, HASH_FIND,
+										&found);
+
+	float4 cost = 1;
+	if (found)
+	{
+		cost += (float4) entry->load;
+	}
+
+	PG_RETURN_FLOAT4(cost);
+}
+
+
 /*
  * Appends a DocumentDB compatible response for the rebalancer status:
  * {
@@ -303,3 +355,83 @@ GetRebalancerStrategy(pgbson *startArgs)
 
 	return NULL;
 }
+
+
+/*
+ * Gets the loads of the shards of the collections, collecting them from the
+ * statistics of all the nodes on the first call in the transaction.
+ */
+static HTAB *
+GetShardLoadHash(void)
+{
+	if (ShardLoadHash != NULL)
+	{
+		return ShardLoadHash;
+	}
+
+	/*
+	 * Shards are named <table>_<shardid>: Only those are picked up, which skips
+	 * the shell tables of the distributed tables on the coordinator.
+	 */
+	bool readOnly = true;
+	bool isNull = false;
+	Datum result = ExtensionExecuteQueryViaSPI(
+		FormatSqlQuery(
+			"SELECT %s.bson_json_to_bson(COALESCE(jsonb_object_agg("
+			" (regexp_match(s.key, '_([0-9]+)$'))[1], s.value), '{}')::text)"
+			" FROM run_command_on_all_nodes($cmd$"
+			" SELECT COALESCE(json_object_agg(relname, seq_tup_read + COALESCE(idx_tup_fetch, 0)"
+			" + n_tup_ins + n_tup_upd + n_tup_del), '{}') FROM pg_stat_all_tables"
+			" WHERE schemaname = '%s' AND relname ~ '_[0-9]+_[0-9]+$'"
+			" $cmd$) r, jsonb_each(r.result::jsonb) s WHERE r.success",
+			CoreSchemaName, ApiDataSchemaName), readOnly, SPI_OK_SELECT, &isNull);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopTransactionContext);
+
+	HASHCTL hashInfo;
+	memset(&hashInfo, 0, sizeof(hashInfo));
+	hashInfo.keysize = sizeof(int64);
+	hashInfo.entrysize = sizeof(ShardLoadEntry);
+	hashInfo.hcxt = TopTransactionContext;
+	HTAB *shardLoadHash = hash_create("Shard load hash", 256, &hashInfo,
+									  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+	MemoryContextCallback *resetCallback = palloc0(sizeof(MemoryContextCallback));
+	resetCallback->func = ResetShardLoadHash;
+	MemoryContextRegisterResetCallback(TopTransactionContext, resetCallback);
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (!isNull)
+	{
+		bson_iter_t loadIter;
+		PgbsonInitIterator(DatumGetPgBson(result), &loadIter);
+		while (bson_iter_next(&loadIter))
+		{
+			if (!BSON_ITER_HOLDS_NUMBER(&loadIter))
+			{
+				continue;
+			}
+
+			int64 shardId = strtoll(bson_iter_key(&loadIter), NULL, 10);
+
+			bool found = false;
+			ShardLoadEntry *entry = hash_search(shardLoadHash, &shardId, HASH_ENTER,
+												&found);
+			entry->load = BsonValueAsDouble(bson_iter_value(&loadIter));
+		}
+	}
+
+	ShardLoadHash = shardLoadHash;
+	return ShardLoadHash;
+}
+
+
+/*
+ * Forgets the shard loads of the transaction when its memory goes away.
+ */
+static void
+ResetShardLoadHash(void *arg)
+{
+	ShardLoadHash = NULL;
+}
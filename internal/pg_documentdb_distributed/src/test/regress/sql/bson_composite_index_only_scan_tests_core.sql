@@ -114,6 +114,23 @@ SELECT 'VACUUM documentdb_data.documents_' || :'coll_id' \gexec
 EXPLAIN (ANALYZE ON, COSTS OFF, VERBOSE ON, TIMING OFF, SUMMARY OFF) SELECT document FROM bson_aggregation_pipeline('idx_only_scan_db', '{ "aggregate" : "idx_only_scan_coll", "pipeline" : [{ "$match" : {"country": {"$eq": "Mexico"}} }, { "$count": "count" }]}');
 
 
+-- projections covered by a composite index skip the heap (after removing the multi-key document)
+SELECT documentdb_api.delete('idx_only_scan_db', '{ "delete": "idx_only_scan_coll", "deletes": [ {"q": {"_id": {"$eq": 17} }, "limit": 0} ]}');
+SELECT 'VACUUM documentdb_data.documents_' || :'coll_id' \gexec
+SELECT documentdb_api_internal.create_indexes_non_concurrently('idx_only_scan_db', '{ "createIndexes": "idx_only_scan_coll", "indexes": [ { "key": { "country": 1, "provider": 1 }, "storageEngine": { "enableOrderedIndex": true }, "name": "country_1_provider_1" }] }', true);
+BEGIN;
+set local documentdb.enableIndexOnlyScanForProjection to on;
+EXPLAIN (ANALYZE ON, COSTS OFF, VERBOSE ON, TIMING OFF, SUMMARY OFF) SELECT document FROM bson_aggregation_pipeline('idx_only_scan_db', '{ "aggregate" : "idx_only_scan_coll", "pipeline" : [{ "$match" : {"country": "Mexico", "provider": "AWS"} }, { "$project" : { "provider" : 1, "_id": 0 } }]}');
+SELECT document FROM bson_aggregation_pipeline('idx_only_scan_db', '{ "aggregate" : "idx_only_scan_coll", "pipeline" : [{ "$match" : {"country": "Mexico", "provider": "AWS"} }, { "$project" : { "provider" : 1, "_id": 0 } }]}');
+EXPLAIN (ANALYZE ON, COSTS OFF, VERBOSE ON, TIMING OFF, SUMMARY OFF) SELECT document FROM bson_aggregation_find('idx_only_scan_db', '{ "find" : "idx_only_scan_coll", "filter" : {"country": { "$gte": "Mexico" } }, "projection": { "country": 1, "_id": 0 }, "sort": { "country": 1 } }');
+SELECT document FROM bson_aggregation_find('idx_only_scan_db', '{ "find" : "idx_only_scan_coll", "filter" : {"country": { "$gte": "Mexico" } }, "projection": { "country": 1, "_id": 0 }, "sort": { "country": 1 } }');
+
+-- not covered: _id is projected, a path outside the index, or more than one field
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('idx_only_scan_db', '{ "aggregate" : "idx_only_scan_coll", "pipeline" : [{ "$match" : {"country": "Mexico"} }, { "$project" : { "provider" : 1 } }]}');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('idx_only_scan_db', '{ "aggregate" : "idx_only_scan_coll", "pipeline" : [{ "$match" : {"country": "Mexico"} }, { "$project" : { "city" : 1, "_id": 0 } }]}');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('idx_only_scan_db', '{ "aggregate" : "idx_only_scan_coll", "pipeline" : [{ "$match" : {"country": "Mexico"} }, { "$project" : { "country": 1, "provider" : 1, "_id": 0 } }]}');
+ROLLBACK;
+
 -- TODO support sharded collections, currently we don't because of the shard_key_value filter
 
 -- SELECT documentdb_api.shard_collection('idx_only_scan_db', 'idx_only_scan_coll', '{ "country": "hashed" }', FALSE);
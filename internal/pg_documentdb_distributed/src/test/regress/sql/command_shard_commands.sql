@@ -94,4 +94,40 @@ SELECT command_sharding_get_collectionInfo();
 
 -- reshard with same key and change chunks allowed
 SELECT documentdb_api.reshard_collection('{ "reshardCollection": "comm_sh_coll.single_shard", "key": { "a": "hashed" }, "unique": false, "numInitialChunks": 2, "forceRedistribution": true }');
-SELECT command_sharding_get_collectionInfo();
\ No newline at end of file
+SELECT command_sharding_get_collectionInfo();
+-- replicated collections
+SELECT documentdb_api.insert_one('comm_sh_coll', 'replicated_dim', '{ "_id": 1, "name": "one" }');
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'replicated_dim', '{ "collMod": "replicated_dim", "colocation": { "replicated": 1 } }');
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'replicated_dim', '{ "collMod": "replicated_dim", "colocation": { "replicated": true, "collection": null } }');
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'single_shard', '{ "collMod": "single_shard", "colocation": { "replicated": true } }');
+
+-- too large for the limit
+set documentdb_distributed.max_replicated_collection_size_mb to 0;
+SELECT documentdb_api.insert_one('comm_sh_coll', 'replicated_dim', FORMAT('{ "_id": 2, "name": "%s" }', repeat('a', 100000))::documentdb_core.bson);
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'replicated_dim', '{ "collMod": "replicated_dim", "colocation": { "replicated": true } }');
+reset documentdb_distributed.max_replicated_collection_size_mb;
+
+-- citus logs the table conversions
+SET client_min_messages TO WARNING;
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'replicated_dim', '{ "collMod": "replicated_dim", "colocation": { "replicated": true } }');
+SET client_min_messages TO DEFAULT;
+SELECT regexp_replace(tbls.table_name::text, '[0-9]+$', '') AS table_name, tbls.citus_table_type FROM public.citus_tables tbls JOIN documentdb_api_catalog.collections c
+    ON tbls.table_name::text IN ('documentdb_data.documents_' || c.collection_id, 'documentdb_data.retry_' || c.collection_id)
+    WHERE c.database_name = 'comm_sh_coll' AND c.collection_name = 'replicated_dim' ORDER BY 1;
+
+-- writes reach the replicated collection, and a sharded collection joins it
+SELECT documentdb_api.insert_one('comm_sh_coll', 'replicated_dim', '{ "_id": 3, "name": "three" }');
+SELECT documentdb_api.update('comm_sh_coll', '{ "update": "replicated_dim", "updates": [ { "q": { "_id": 1 }, "u": { "$set": { "name": "uno" } } } ] }');
+SELECT document FROM bson_aggregation_pipeline('comm_sh_coll',
+    '{ "aggregate": "single_shard", "pipeline": [ { "$lookup": { "from": "replicated_dim", "localField": "a", "foreignField": "_id", "as": "dim" } }, { "$project": { "dim.name": 1 } } ], "cursor": {} }');
+
+-- cannot colocate with a replicated collection
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'comp_shard', '{ "collMod": "comp_shard", "colocation": { "collection": "replicated_dim" } }');
+
+-- back to a single shard collection
+SET client_min_messages TO WARNING;
+SELECT documentdb_api.coll_mod('comm_sh_coll', 'replicated_dim', '{ "collMod": "replicated_dim", "colocation": { "replicated": false } }');
+SET client_min_messages TO DEFAULT;
+SELECT regexp_replace(tbls.table_name::text, '[0-9]+$', '') AS table_name, tbls.citus_table_type FROM public.citus_tables tbls JOIN documentdb_api_catalog.collections c
+    ON tbls.table_name::text IN ('documentdb_data.documents_' || c.collection_id, 'documentdb_data.retry_' || c.collection_id)
+    WHERE c.database_name = 'comm_sh_coll' AND c.collection_name = 'replicated_dim' ORDER BY 1;
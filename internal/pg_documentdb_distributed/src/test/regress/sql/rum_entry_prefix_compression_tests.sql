@@ -0,0 +1,66 @@
+SET search_path TO documentdb_core,documentdb_api,documentdb_api_catalog,documentdb_api_internal;
+
+SET citus.next_shard_id TO 9650000;
+SET documentdb.next_collection_id TO 965000;
+SET documentdb.next_collection_index_id TO 965000;
+
+CREATE EXTENSION IF NOT EXISTS pageinspect;
+CREATE SCHEMA rum_prefix_test;
+CREATE FUNCTION rum_prefix_test.rum_page_get_stats(page bytea)
+RETURNS jsonb LANGUAGE C STRICT AS '$libdir/pg_documentdb_extended_rum', $$rum_page_get_stats$$;
+
+-- the non leaf entry pages of an index filled with the compression enabled keep a prefix of their keys.
+-- Only the keys of values with the same encoded length share more than their first byte, so values of
+-- different lengths are inserted too, which keep their full keys.
+CREATE TABLE rum_prefix_test.docs_prefix (id int, document documentdb_core.bson);
+CREATE TABLE rum_prefix_test.docs_plain (id int, document documentdb_core.bson);
+CREATE INDEX docs_prefix_a_idx ON rum_prefix_test.docs_prefix USING documentdb_extended_rum (document documentdb_extended_rum_catalog.bson_extended_rum_single_path_ops(path='a'));
+CREATE INDEX docs_plain_a_idx ON rum_prefix_test.docs_plain USING documentdb_extended_rum (document documentdb_extended_rum_catalog.bson_extended_rum_single_path_ops(path='a'));
+
+SET documentdb_rum.enable_entry_prefix_compression TO on;
+INSERT INTO rum_prefix_test.docs_prefix SELECT i, FORMAT('{ "_id": %s, "a": "this_is_a_long_common_prefix_shared_by_the_keys_%s" }', i, lpad(i::text, 6, '0'))::bson FROM generate_series(1, 30000) i;
+INSERT INTO rum_prefix_test.docs_prefix SELECT i, FORMAT('{ "_id": %s, "a": "shorter_%s" }', i, i - 30000)::bson FROM generate_series(30001, 32000) i;
+RESET documentdb_rum.enable_entry_prefix_compression;
+
+INSERT INTO rum_prefix_test.docs_plain SELECT id, document FROM rum_prefix_test.docs_prefix ORDER BY id;
+
+-- the root was split (more than one non leaf page), and only the compressed index has prefix pages
+SELECT COUNT(*) FILTER (WHERE stats->>'flagsStr' LIKE '%ENTRYPREFIX%') > 0 AS has_prefix_pages,
+    COUNT(*) FILTER (WHERE stats->>'flagsStr' NOT LIKE '%LEAF%' AND stats->>'flagsStr' NOT LIKE '%DATA%') > 1 AS has_non_leaf_splits
+FROM (SELECT rum_prefix_test.rum_page_get_stats(get_raw_page('rum_prefix_test.docs_prefix_a_idx', blkno::int)) AS stats
+    FROM generate_series(1, pg_relation_size('rum_prefix_test.docs_prefix_a_idx') / current_setting('block_size')::int - 1) blkno) s;
+SELECT COUNT(*) FILTER (WHERE stats->>'flagsStr' LIKE '%ENTRYPREFIX%') > 0 AS has_prefix_pages,
+    COUNT(*) FILTER (WHERE stats->>'flagsStr' NOT LIKE '%LEAF%' AND stats->>'flagsStr' NOT LIKE '%DATA%') > 1 AS has_non_leaf_splits
+FROM (SELECT rum_prefix_test.rum_page_get_stats(get_raw_page('rum_prefix_test.docs_plain_a_idx', blkno::int)) AS stats
+    FROM generate_series(1, pg_relation_size('rum_prefix_test.docs_plain_a_idx') / current_setting('block_size')::int - 1) blkno) s;
+
+-- the index scans return the same documents as the sequential scan
+BEGIN;
+set local enable_seqscan to off;
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @= '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_012345" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @>= '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_010000" }' AND document @< '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_010100" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @= '{ "a": "shorter_77" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @>= '{ "a": "shorter_" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_plain WHERE document @= '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_012345" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_plain WHERE document @>= '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_010000" }' AND document @< '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_010100" }';
+ROLLBACK;
+
+BEGIN;
+set local enable_indexscan to off;
+set local enable_bitmapscan to off;
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @= '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_012345" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @>= '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_010000" }' AND document @< '{ "a": "this_is_a_long_common_prefix_shared_by_the_keys_010100" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @= '{ "a": "shorter_77" }';
+SELECT COUNT(*), SUM(id) FROM rum_prefix_test.docs_prefix WHERE document @>= '{ "a": "shorter_" }';
+ROLLBACK;
+
+-- every key is found through the compressed index
+BEGIN;
+set local enable_seqscan to off;
+SELECT COUNT(*) FROM rum_prefix_test.docs_prefix p WHERE EXISTS (SELECT 1 FROM rum_prefix_test.docs_prefix i WHERE i.document @= documentdb_api_catalog.bson_dollar_project(p.document, '{ "_id": 0, "a": 1 }') AND i.id = p.id);
+ROLLBACK;
+
+DROP TABLE rum_prefix_test.docs_prefix, rum_prefix_test.docs_plain;
+DROP FUNCTION rum_prefix_test.rum_page_get_stats(bytea);
+DROP SCHEMA rum_prefix_test;
+DROP EXTENSION pageinspect;
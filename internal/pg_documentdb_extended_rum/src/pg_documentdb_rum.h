@@ -20,6 +20,7 @@
 #include "storage/bufmgr.h"
 #include "utils/datum.h"
 #include "utils/memutils.h"
+#include "utils/wait_event.h"
 
 #include "rumsort.h"
 
@@ -71,6 +72,7 @@ typedef RumPageOpaqueData *RumPageOpaque;
 #define RUM_LIST (1 << 4)
 #define RUM_LIST_FULLROW (1 << 5)       /* makes sense only on RUM_LIST page */
 #define RUM_HALF_DEAD (1 << 6)
+#define RUM_ENTRY_PREFIX (1 << 7)       /* non-leaf entry page with a key prefix */
 
 /* Page numbers of fixed-location pages */
 #define RUM_METAPAGE_BLKNO (0)
@@ -157,6 +159,8 @@ typedef struct RumMetaPageData
 #define RumPageSetHalfDead(page) (RumPageGetOpaque(page)->flags |= RUM_HALF_DEAD)
 #define RumPageSetNonHalfDead(page) (RumPageGetOpaque(page)->flags &= ~RUM_HALF_DEAD)
 
+#define RumPageHasEntryPrefix(page) ((RumPageGetOpaque(page)->flags & RUM_ENTRY_PREFIX) != 0)
+
 #define RumPageRightMost(page) (RumPageGetOpaque(page)->rightlink == InvalidBlockNumber)
 #define RumPageLeftMost(page) (RumPageGetOpaque(page)->leftlink == InvalidBlockNumber)
 
@@ -315,6 +319,28 @@ typedef signed char RumNullCategory;
 #define RumSetDownlink(itup, blkno) ItemPointerSet(&(itup)->t_tid, blkno, \
 												   InvalidOffsetNumber)
 
+/*
+ * Non-leaf entry pages flagged RUM_ENTRY_PREFIX store a prefix of the keys
+ * after the opaque data, in a larger special space. Their tuples flagged
+ * with RumItupIsSuffix store the rest of their key only (see rumentrypage.c).
+ */
+typedef struct RumEntryPrefixData
+{
+	uint16 length;
+	char data[FLEXIBLE_ARRAY_MEMBER];
+} RumEntryPrefixData;
+
+#define RUM_ENTRY_PREFIX_MAX_LENGTH 128
+
+#define RumEntryPrefixSpecialSize(length) \
+	(MAXALIGN(sizeof(RumPageOpaqueData)) + \
+	 MAXALIGN(offsetof(RumEntryPrefixData, data) + (length)))
+#define RumPageGetEntryPrefix(page) \
+	((RumEntryPrefixData *) ((char *) RumPageGetOpaque(page) + \
+							 MAXALIGN(sizeof(RumPageOpaqueData))))
+
+#define RumItupIsSuffix(itup) (((itup)->t_info & INDEX_AM_RESERVED_BIT) != 0)
+
 
 /*
  * Data (posting tree) pages
@@ -481,6 +507,8 @@ extern Buffer RumNewBuffer(Relation index);
 extern void RumInitBuffer(GenericXLogState *state, Buffer buffer, uint32 flags,
 						  bool isBuild);
 extern void RumInitPage(Page page, uint32 f, Size pageSize);
+extern void RumInitEntryPrefixPage(Page page, uint32 f, Size pageSize,
+								   const char *prefix, uint16 prefixLength);
 extern void RumInitMetabuffer(GenericXLogState *state, Buffer metaBuffer,
 							  bool isBuild);
 extern int rumCompareEntries(RumState *rumstate, OffsetNumber attnum,
@@ -885,6 +913,12 @@ typedef struct RumScanOpaqueData
 
 	/* Index only scan metadata. */
 	RumProjectIndexTupleData *projectIndexTupleData;
+
+	/* documentdb: the entry whose upcoming heap blocks were prefetched, and how far */
+	RumScanEntry prefetchEntry;
+	ItemPointerData prefetchListStart;
+	ItemPointerData prefetchHorizon;
+	BlockNumber prefetchBlock;
 }   RumScanOpaqueData;
 
 typedef RumScanOpaqueData *RumScanOpaque;
@@ -991,13 +1025,21 @@ typedef enum SimilarityType
 #define RUM_DEFAULT_THROW_ERROR_ON_INVALID_DATA_PAGE false
 #define RUM_DEFAULT_DISABLE_FAST_SCAN false
 #define RUM_DEFAULT_ENABLE_ENTRY_FIND_ITEM_ON_SCAN true
+#define RUM_DEFAULT_ENABLE_GALLOPING_ENTRY_FIND_ITEM true
 #define RUM_DEFAULT_ENABLE_PARALLEL_INDEX_BUILD false
+#define RUM_DEFAULT_ENABLE_PARALLEL_ADDINFO_INDEX_BUILD true
+#define RUM_DEFAULT_ENABLE_PARALLEL_VACUUM false
+#define RUM_DEFAULT_ENABLE_INSERT_STATE_CACHE true
+#define RUM_DEFAULT_HEAP_PREFETCH_DISTANCE 0
 #define RUM_DEFAULT_PARALLEL_INDEX_WORKERS_OVERRIDE -1
 #define RUM_DEFAULT_SKIP_RETRY_ON_DELETE_PAGE true
 #define DEFAULT_FORCE_RUM_ORDERED_INDEX_SCAN false
 #define RUM_DEFAULT_PREFER_ORDERED_INDEX_SCAN true
 #define RUM_DEFAULT_ENABLE_SKIP_INTERMEDIATE_ENTRY true
 #define RUM_DEFAULT_USE_NEW_ITEM_PTR_DECODING true
+#define RUM_DEFAULT_USE_BATCH_ITEM_PTR_DECODING false
+#define RUM_DEFAULT_ENABLE_CUSTOM_WAIT_EVENTS true
+#define RUM_DEFAULT_ENABLE_ENTRY_PREFIX_COMPRESSION false
 
 /* GUC parameters */
 extern int RumFuzzySearchLimit;
@@ -1008,13 +1050,61 @@ extern bool RumEnableRefindLeafOnEntryNextItem;
 extern bool RumThrowErrorOnInvalidDataPage;
 extern bool RumDisableFastScan;
 extern bool RumEnableEntryFindItemOnScan;
+extern bool RumEnableGallopingEntryFindItem;
 extern bool RumEnableParallelIndexBuild;
+extern bool RumEnableParallelAddInfoIndexBuild;
+extern bool RumEnableParallelVacuum;
+extern bool RumEnableInsertStateCache;
+extern int RumHeapPrefetchDistance;
 extern int RumParallelIndexWorkersOverride;
 extern bool RumSkipRetryOnDeletePage;
 extern bool RumForceOrderedIndexScan;
 extern bool RumPreferOrderedIndexScan;
 extern bool RumEnableSkipIntermediateEntry;
 extern bool RumUseNewItemPtrDecoding;
+extern bool RumUseBatchItemPtrDecoding;
+extern bool RumEnableCustomWaitEvents;
+extern bool RumEnableEntryPrefixCompression;
+
+uint32 RumGetPostingDecodeWaitEventInfo(void);
+
+
+/*
+ * Reports decoding posting lists as the wait event of the backend, and
+ * returns the wait event it reported before for RumReportPostingDecodeEnd.
+ */
+static inline uint32
+RumReportPostingDecodeStart(void)
+{
+	if (!RumEnableCustomWaitEvents)
+	{
+		return 0;
+	}
+
+	uint32 previousWaitEventInfo = *my_wait_event_info;
+	pgstat_report_wait_start(RumGetPostingDecodeWaitEventInfo());
+	return previousWaitEventInfo;
+}
+
+
+static inline void
+RumReportPostingDecodeEnd(uint32 previousWaitEventInfo)
+{
+	if (!RumEnableCustomWaitEvents)
+	{
+		return;
+	}
+
+	if (previousWaitEventInfo != 0)
+	{
+		pgstat_report_wait_start(previousWaitEventInfo);
+	}
+	else
+	{
+		pgstat_report_wait_end();
+	}
+}
+
 
 /*
  * Functions for reading ItemPointers with additional information. Used in
@@ -1246,12 +1336,80 @@ rumDataPageLeafReadWithBlockNumberIncr(Pointer ptr, OffsetNumber attnum, RumItem
 }
 
 
+/*
+ * Decodes the item pointers of a leaf data page whose items carry no additional
+ * information. Dense posting lists are dominated by items that take one byte for
+ * the block number delta and one for the offset: These are checked 4 items (8
+ * bytes) at a time and decoded without walking the varbyte continuation bits.
+ * Every item takes at least 2 bytes, so the 8 byte read never passes the end of
+ * the remaining items. Anything else falls back to the regular decoding.
+ */
+static inline void
+rumDataPageLeafReadItemPointersBatch(Pointer ptr, RumItem *items, int nitems)
+{
+	uint64 blockNumberIncr = 0;
+	int i = 0;
+	while (i < nitems)
+	{
+		if (nitems - i >= 4)
+		{
+			const unsigned char *p = (const unsigned char *) ptr;
+			uint64 word;
+			memcpy(&word, p, sizeof(uint64));
+
+			/* All single byte values, offsets in range and no item with addInfo */
+			if ((word & UINT64CONST(0x8080808080808080)) == 0 &&
+				(p[1] & p[3] & p[5] & p[7] & SEVENTHBIT) != 0 &&
+				(p[1] & SIXMASK) != 0 && (p[3] & SIXMASK) != 0 &&
+				(p[5] & SIXMASK) != 0 && (p[7] & SIXMASK) != 0)
+			{
+				for (int j = 0; j < 4; j++)
+				{
+					RumItem *item = &items[i + j];
+					blockNumberIncr += p[2 * j];
+					item->iptr.ip_blkid.bi_lo = blockNumberIncr & 0xFFFF;
+					item->iptr.ip_blkid.bi_hi = (blockNumberIncr >> 16) & 0xFFFF;
+					item->iptr.ip_posid = p[2 * j + 1] & SIXMASK;
+					item->addInfoIsNull = true;
+					item->addInfo = (Datum) 0;
+				}
+
+				ptr += 8;
+				i += 4;
+				continue;
+			}
+		}
+
+		ptr = rumDataPageLeafReadItemPointerWithBlockNumberIncr(ptr, &items[i],
+																&blockNumberIncr);
+		if (!items[i].addInfoIsNull)
+		{
+			/* Should not have additional information without an attribute */
+			elog(ERROR, "unexpected additional information on rumpage");
+		}
+
+		items[i].addInfo = (Datum) 0;
+		i++;
+	}
+}
+
+
 inline static void
 rumPopulateDataPage(RumState *rumstate, RumScanEntry entry, OffsetNumber maxoff, Page
 					pageInner)
 {
 	InitBlockNumberIncrZero(blockNumberIncr);
 	Pointer ptr = RumDataPageGetData(pageInner);
+	uint32 previousWaitEventInfo = RumReportPostingDecodeStart();
+
+	if (RumUseBatchItemPtrDecoding && !rumstate->useAlternativeOrder &&
+		rumstate->addAttrs[entry->attnum - 1] == NULL && maxoff >= FirstOffsetNumber)
+	{
+		rumDataPageLeafReadItemPointersBatch(ptr, entry->list, maxoff);
+		RumReportPostingDecodeEnd(previousWaitEventInfo);
+		return;
+	}
+
 	for (OffsetNumber i = FirstOffsetNumber; i <= maxoff; i = OffsetNumberNext(i))
 	{
 		ptr = rumDataPageLeafReadWithBlockNumberIncr(ptr, entry->attnum,
@@ -1264,6 +1422,8 @@ rumPopulateDataPage(RumState *rumstate, RumScanEntry entry, OffsetNumber maxoff,
 	{
 		memset(&entry->list[0], 0, sizeof(RumItem));
 	}
+
+	RumReportPostingDecodeEnd(previousWaitEventInfo);
 }
 
 
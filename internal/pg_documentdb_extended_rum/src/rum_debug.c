@@ -119,6 +119,12 @@ RumPageFlagsToString(Page page)
 		separator = "|";
 	}
 
+	if (RumPageHasEntryPrefix(page))
+	{
+		appendStringInfo(flagsStr, "%sENTRYPREFIX", separator);
+		separator = "|";
+	}
+
 	return flagsStr->data;
 }
 
@@ -33,6 +33,7 @@ typedef struct RumTuple
 	bool typbyval;              /* typbyval for key */
 	signed char category;       /* category: normal or NULL? */
 	int nitems;                 /* number of RumItems in the data */
+	int addinfolen;             /* bytes of serialized addInfo after the items */
 	char data[FLEXIBLE_ARRAY_MEMBER];
 } RumTuple;
 
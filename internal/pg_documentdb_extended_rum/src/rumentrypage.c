@@ -15,6 +15,45 @@
 
 #include "pg_documentdb_rum.h"
 
+/*
+ * Prefix compression of non-leaf entry pages
+ *
+ * The keys of an entry tree share long prefixes (e.g. the path of the terms of
+ * a wildcard index). When enabled, a split of a non-leaf entry page stores the
+ * longest prefix shared by the keys of the new page once, in the special space
+ * of the page (RUM_ENTRY_PREFIX), and its tuples keep only the rest of their
+ * key (RumItupIsSuffix). Tuples inserted later keep their full key if they
+ * don't share the prefix. The keys are rebuilt where they are compared (the
+ * binary search while descending the tree) and when a tuple is copied off
+ * the page. Only varlena keys are compressed, and leaf pages never are: scans
+ * keep pointers to the keys of the leaf pages they read.
+ *
+ * The prefix of a page doesn't change until the page splits again, and the
+ * tuples of a compressed page still fit after its split as they keep at
+ * least the prefix of the page.
+ */
+
+#define EntryPageGetPrefix(page) \
+	(RumPageHasEntryPrefix(page) ? RumPageGetEntryPrefix(page) : NULL)
+
+static Datum entryGetTupleKey(RumState *rumstate, const RumEntryPrefixData *prefix,
+							  IndexTuple itup, RumNullCategory *category,
+							  bool *isCopy);
+static struct varlena * entryGetCompressibleKey(RumState *rumstate,
+												const RumEntryPrefixData *prefix,
+												IndexTuple itup);
+static IndexTuple entryFormTupleWithKey(RumState *rumstate, IndexTuple itup,
+										const char *keyData, int keyLength,
+										bool isSuffix);
+static IndexTuple entryExpandTuple(RumState *rumstate, const RumEntryPrefixData *prefix,
+								   IndexTuple itup);
+static IndexTuple entryCompressTuple(RumState *rumstate, IndexTuple itup,
+									 const char *prefix, int prefixLength);
+static Size entryPageCapacity(Size pageSize, int prefixLength);
+static void entryFillPage(RumBtree btree, Page page, uint16 flags, Size pageSize,
+						  IndexTuple *tuples, int ntuples,
+						  const RumEntryPrefixData *basePrefix);
+
 /*
  * Read item pointers with additional information from leaf data page.
  * Information is stored in the same manner as in leaf data pages.
@@ -86,6 +125,12 @@ RumFormInteriorTuple(RumBtree btree, IndexTuple itup, Page page,
 	IndexTuple nitup;
 	RumNullCategory category;
 
+	if (RumPageHasEntryPrefix(page))
+	{
+		/* The tuple goes to another page: Copy it with its full key */
+		itup = entryExpandTuple(btree->rumstate, RumPageGetEntryPrefix(page), itup);
+	}
+
 	if (RumPageIsLeaf(page) && !RumIsPostingTree(itup))
 	{
 		/* Tuple contains a posting list, just copy stuff before that */
@@ -143,6 +188,8 @@ entryIsMoveRight(RumBtree btree, Page page)
 	OffsetNumber attnum;
 	Datum key;
 	RumNullCategory category;
+	bool isCopy;
+	int result;
 
 	if (RumPageRightMost(page))
 	{
@@ -157,16 +204,19 @@ entryIsMoveRight(RumBtree btree, Page page)
 
 	itup = rumEntryGetRightMostTuple(page);
 	attnum = rumtuple_get_attrnum(btree->rumstate, itup);
-	key = rumtuple_get_key(btree->rumstate, itup, &category);
-
-	if (rumCompareAttEntries(btree->rumstate,
-							 btree->entryAttnum, btree->entryKey, btree->entryCategory,
-							 attnum, key, category) > 0)
+	key = entryGetTupleKey(btree->rumstate, EntryPageGetPrefix(page), itup,
+							   &category, &isCopy);
+
+	result = rumCompareAttEntries(btree->rumstate,
+								  btree->entryAttnum, btree->entryKey,
+								  btree->entryCategory,
+								  attnum, key, category);
+	if (isCopy)
 	{
-		return true;
+		pfree(DatumGetPointer(key));
 	}
 
-	return false;
+	return result > 0;
 }
 
 
@@ -214,15 +264,21 @@ entryLocateEntry(RumBtree btree, RumBtreeStack *stack)
 			OffsetNumber attnum;
 			Datum key;
 			RumNullCategory category;
+			bool isCopy;
 
 			itup = (IndexTuple) PageGetItem(page, PageGetItemId(page, mid));
 			attnum = rumtuple_get_attrnum(btree->rumstate, itup);
-			key = rumtuple_get_key(btree->rumstate, itup, &category);
+			key = entryGetTupleKey(btree->rumstate, EntryPageGetPrefix(page), itup,
+							   &category, &isCopy);
 			result = rumCompareAttEntries(btree->rumstate,
 										  btree->entryAttnum,
 										  btree->entryKey,
 										  btree->entryCategory,
 										  attnum, key, category);
+			if (isCopy)
+			{
+				pfree(DatumGetPointer(key));
+			}
 		}
 
 		if (result == 0)
@@ -458,10 +514,19 @@ static void
 entryPlaceToPage(RumBtree btree, Page page, OffsetNumber off)
 {
 	OffsetNumber placed;
+	IndexTuple entry = btree->entry;
 
 	entryPreparePage(btree, page, off);
 
-	placed = PageAddItem(page, (Item) btree->entry, IndexTupleSize(btree->entry), off,
+	if (RumPageHasEntryPrefix(page))
+	{
+		RumEntryPrefixData *prefix = RumPageGetEntryPrefix(page);
+
+		entry = entryCompressTuple(btree->rumstate, btree->entry, prefix->data,
+								   prefix->length);
+	}
+
+	placed = PageAddItem(page, (Item) entry, IndexTupleSize(entry), off,
 						 false, false);
 	if (placed != off)
 	{
@@ -469,6 +534,11 @@ entryPlaceToPage(RumBtree btree, Page page, OffsetNumber off)
 			 RelationGetRelationName(btree->index));
 	}
 
+	if (entry != btree->entry)
+	{
+		pfree(entry);
+	}
+
 	btree->entry = NULL;
 }
 
@@ -488,11 +558,14 @@ entrySplitPage(RumBtree btree, Buffer lbuf, Buffer rbuf,
 				 separator = InvalidOffsetNumber;
 	Size totalsize = 0;
 	Size lsize = 0,
-		 size;
+		 size,
+		 capacity;
 	char *ptr;
 	IndexTuple itup,
-			   leftrightmost = NULL;
-	Page page;
+			   entry = btree->entry;
+	IndexTuple *tuples;
+	RumEntryPrefixData *basePrefix = NULL;
+	uint16 flags;
 	Page newlPage = PageGetTempPageCopy(lPage);
 	Size pageSize = PageGetPageSize(newlPage);
 
@@ -507,6 +580,21 @@ entrySplitPage(RumBtree btree, Buffer lbuf, Buffer rbuf,
 
 	entryPreparePage(btree, newlPage, off);
 
+	if (RumPageHasEntryPrefix(newlPage))
+	{
+		/*
+		 * The tuples keep the prefix of the page in both halves (or a longer
+		 * one), so the new tuple is compressed with it too.
+		 */
+		RumEntryPrefixData *pagePrefix = RumPageGetEntryPrefix(newlPage);
+
+		basePrefix = palloc(offsetof(RumEntryPrefixData, data) + pagePrefix->length);
+		memcpy(basePrefix, pagePrefix,
+			   offsetof(RumEntryPrefixData, data) + pagePrefix->length);
+		entry = entryCompressTuple(btree->rumstate, btree->entry, basePrefix->data,
+								   basePrefix->length);
+	}
+
 	maxoff = PageGetMaxOffsetNumber(newlPage);
 	ptr = tupstore;
 
@@ -514,8 +602,8 @@ entrySplitPage(RumBtree btree, Buffer lbuf, Buffer rbuf,
 	{
 		if (i == off)
 		{
-			size = MAXALIGN(IndexTupleSize(btree->entry));
-			memcpy(ptr, btree->entry, size);
+			size = MAXALIGN(IndexTupleSize(entry));
+			memcpy(ptr, entry, size);
 			ptr += size;
 			totalsize += size + sizeof(ItemIdData);
 		}
@@ -529,51 +617,69 @@ entrySplitPage(RumBtree btree, Buffer lbuf, Buffer rbuf,
 
 	if (off == maxoff + 1)
 	{
-		size = MAXALIGN(IndexTupleSize(btree->entry));
-		memcpy(ptr, btree->entry, size);
+		size = MAXALIGN(IndexTupleSize(entry));
+		memcpy(ptr, entry, size);
 		totalsize += size + sizeof(ItemIdData);
 	}
 
-	RumInitPage(rPage, RumPageGetOpaque(newlPage)->flags, pageSize);
-	RumInitPage(newlPage, RumPageGetOpaque(rPage)->flags, pageSize);
+	if (entry != btree->entry)
+	{
+		pfree(entry);
+	}
+
+	/*
+	 * The halves also have to fit with the prefix of the page: Nothing
+	 * guarantees that balancing the sizes does.
+	 */
+	flags = RumPageGetOpaque(newlPage)->flags;
+	capacity = entryPageCapacity(pageSize, basePrefix != NULL ? basePrefix->length : 0);
 
 	ptr = tupstore;
 	maxoff++;
 	lsize = 0;
 
-	page = newlPage;
+	tuples = palloc(sizeof(IndexTuple) * maxoff);
 	for (i = FirstOffsetNumber; i <= maxoff; i++)
 	{
 		itup = (IndexTuple) ptr;
+		size = MAXALIGN(IndexTupleSize(itup)) + sizeof(ItemIdData);
 
-		if (lsize > totalsize / 2)
-		{
-			if (separator == InvalidOffsetNumber)
-			{
-				separator = i - 1;
-			}
-			page = rPage;
-		}
-		else
+		if (separator == InvalidOffsetNumber &&
+			(lsize > totalsize / 2 || lsize + size > capacity))
 		{
-			leftrightmost = itup;
-			lsize += MAXALIGN(IndexTupleSize(itup)) + sizeof(ItemIdData);
+			separator = i - 1;
 		}
 
-		if (PageAddItem(page, (Item) itup, IndexTupleSize(itup), InvalidOffsetNumber,
-						false, false) == InvalidOffsetNumber)
+		if (separator == InvalidOffsetNumber)
 		{
-			elog(ERROR, "failed to add item to index page in \"%s\"",
-				 RelationGetRelationName(btree->index));
+			lsize += size;
 		}
+
+		tuples[i - 1] = itup;
 		ptr += MAXALIGN(IndexTupleSize(itup));
 	}
 
-	btree->entry = RumFormInteriorTuple(btree, leftrightmost, newlPage,
+	if (separator == InvalidOffsetNumber)
+	{
+		separator = maxoff - 1;
+	}
+
+	entryFillPage(btree, newlPage, flags, pageSize, tuples, separator, basePrefix);
+	entryFillPage(btree, rPage, flags, pageSize, tuples + separator,
+				  maxoff - separator, basePrefix);
+
+	itup = rumEntryGetRightMostTuple(newlPage);
+	btree->entry = RumFormInteriorTuple(btree, itup, newlPage,
 										BufferGetBlockNumber(lbuf));
 
 	btree->rightblkno = BufferGetBlockNumber(rbuf);
 
+	pfree(tuples);
+	if (basePrefix != NULL)
+	{
+		pfree(basePrefix);
+	}
+
 	return newlPage;
 }
 
@@ -596,29 +702,21 @@ rumPageGetLinkItup(RumBtree btree, Buffer buf, Page page)
 
 /*
  * Fills new root by rightest values from child.
- * Also called from rumxlog, should not use btree
  */
 void
 rumEntryFillRoot(RumBtree btree, Buffer root, Buffer lbuf, Buffer rbuf,
 				 Page page, Page lpage, Page rpage)
 {
-	IndexTuple itup;
+	IndexTuple tuples[2];
 
-	itup = rumPageGetLinkItup(btree, lbuf, lpage);
-	if (PageAddItem(page, (Item) itup, IndexTupleSize(itup), InvalidOffsetNumber, false,
-					false) == InvalidOffsetNumber)
-	{
-		elog(ERROR, "failed to add item to index root page");
-	}
-	pfree(itup);
+	tuples[0] = rumPageGetLinkItup(btree, lbuf, lpage);
+	tuples[1] = rumPageGetLinkItup(btree, rbuf, rpage);
 
-	itup = rumPageGetLinkItup(btree, rbuf, rpage);
-	if (PageAddItem(page, (Item) itup, IndexTupleSize(itup), InvalidOffsetNumber, false,
-					false) == InvalidOffsetNumber)
-	{
-		elog(ERROR, "failed to add item to index root page");
-	}
-	pfree(itup);
+	entryFillPage(btree, page, RumPageGetOpaque(page)->flags, PageGetPageSize(page),
+				  tuples, 2, NULL);
+
+	pfree(tuples[0]);
+	pfree(tuples[1]);
 }
 
 
@@ -657,3 +755,308 @@ rumPrepareEntryScan(RumBtree btree, OffsetNumber attnum,
 	btree->entryCategory = category;
 	btree->isDelete = false;
 }
+
+
+/*
+ * Returns the key of a tuple of an entry page, rebuilt with the prefix of the
+ * page (NULL if it has none) if the tuple only stores the rest of it. isCopy
+ * is then true and the key is palloc'd.
+ */
+static Datum
+entryGetTupleKey(RumState *rumstate, const RumEntryPrefixData *prefix, IndexTuple itup,
+				 RumNullCategory *category, bool *isCopy)
+{
+	Datum key = rumtuple_get_key(rumstate, itup, category);
+	struct varlena *suffix;
+	bytea *fullKey;
+	int suffixLength;
+
+	*isCopy = false;
+	if (prefix == NULL || !RumItupIsSuffix(itup))
+	{
+		return key;
+	}
+
+	Assert(*category == RUM_CAT_NORM_KEY);
+	suffix = pg_detoast_datum_packed((struct varlena *) DatumGetPointer(key));
+	suffixLength = VARSIZE_ANY_EXHDR(suffix);
+
+	fullKey = (bytea *) palloc(VARHDRSZ + prefix->length + suffixLength);
+	SET_VARSIZE(fullKey, VARHDRSZ + prefix->length + suffixLength);
+	memcpy(VARDATA(fullKey), prefix->data, prefix->length);
+	memcpy(VARDATA(fullKey) + prefix->length, VARDATA_ANY(suffix), suffixLength);
+
+	if ((Pointer) suffix != DatumGetPointer(key))
+	{
+		pfree(suffix);
+	}
+
+	*isCopy = true;
+	return PointerGetDatum(fullKey);
+}
+
+
+/*
+ * Returns the full key of a tuple as an uncompressed varlena, or NULL if its
+ * key can't be prefix compressed: It is null or not a varlena.
+ */
+static struct varlena *
+entryGetCompressibleKey(RumState *rumstate, const RumEntryPrefixData *prefix,
+						IndexTuple itup)
+{
+	OffsetNumber attnum = rumtuple_get_attrnum(rumstate, itup);
+	Form_pg_attribute keyAttr = TupleDescAttr(rumstate->tupdesc[attnum - 1],
+											  rumstate->oneCol ? 0 : 1);
+	RumNullCategory category;
+	bool isCopy;
+	Datum key;
+
+	if (keyAttr->attlen != -1 || keyAttr->attbyval)
+	{
+		return NULL;
+	}
+
+	key = entryGetTupleKey(rumstate, prefix, itup, &category, &isCopy);
+	if (category != RUM_CAT_NORM_KEY)
+	{
+		return NULL;
+	}
+
+	return pg_detoast_datum_packed((struct varlena *) DatumGetPointer(key));
+}
+
+
+/*
+ * Forms a non-leaf entry tuple with the downlink of itup and the key given by
+ * its bytes, which are the rest of the key after the prefix of the page if
+ * isSuffix.
+ */
+static IndexTuple
+entryFormTupleWithKey(RumState *rumstate, IndexTuple itup, const char *keyData,
+					  int keyLength, bool isSuffix)
+{
+	OffsetNumber attnum = rumtuple_get_attrnum(rumstate, itup);
+	bytea *key = (bytea *) palloc(VARHDRSZ + keyLength);
+	Datum datums[3];
+	bool isnull[3];
+	IndexTuple nitup;
+
+	SET_VARSIZE(key, VARHDRSZ + keyLength);
+	memcpy(VARDATA(key), keyData, keyLength);
+
+	/* Same layout as RumFormTuple: optional column number, key, no additional info */
+	if (rumstate->oneCol)
+	{
+		datums[0] = PointerGetDatum(key);
+		isnull[0] = false;
+		isnull[1] = true;
+	}
+	else
+	{
+		datums[0] = UInt16GetDatum(attnum);
+		isnull[0] = false;
+		datums[1] = PointerGetDatum(key);
+		isnull[1] = false;
+		isnull[2] = true;
+	}
+
+	nitup = index_form_tuple(rumstate->tupdesc[attnum - 1], datums, isnull);
+	nitup->t_tid = itup->t_tid;
+	if (isSuffix)
+	{
+		nitup->t_info |= INDEX_AM_RESERVED_BIT;
+	}
+
+	pfree(key);
+	return nitup;
+}
+
+
+/*
+ * Returns the tuple with its full key, or the tuple itself if it stores the
+ * full key.
+ */
+static IndexTuple
+entryExpandTuple(RumState *rumstate, const RumEntryPrefixData *prefix, IndexTuple itup)
+{
+	struct varlena *key;
+
+	if (prefix == NULL || !RumItupIsSuffix(itup))
+	{
+		return itup;
+	}
+
+	key = entryGetCompressibleKey(rumstate, prefix, itup);
+	Assert(key != NULL);
+	return entryFormTupleWithKey(rumstate, itup, VARDATA_ANY(key),
+								 VARSIZE_ANY_EXHDR(key), false);
+}
+
+
+/*
+ * Returns the tuple with the full key compressed with the prefix, or the
+ * tuple itself if its key doesn't start with the prefix.
+ */
+static IndexTuple
+entryCompressTuple(RumState *rumstate, IndexTuple itup, const char *prefix,
+				   int prefixLength)
+{
+	struct varlena *key;
+	int keyLength;
+
+	Assert(!RumItupIsSuffix(itup));
+	if (prefixLength == 0)
+	{
+		return itup;
+	}
+
+	key = entryGetCompressibleKey(rumstate, NULL, itup);
+	if (key == NULL)
+	{
+		return itup;
+	}
+
+	keyLength = VARSIZE_ANY_EXHDR(key);
+	if (keyLength < prefixLength || memcmp(VARDATA_ANY(key), prefix, prefixLength) != 0)
+	{
+		return itup;
+	}
+
+	return entryFormTupleWithKey(rumstate, itup, VARDATA_ANY(key) + prefixLength,
+								 keyLength - prefixLength, true);
+}
+
+
+/*
+ * The space for tuples (and their line pointers) of an empty entry page with
+ * a prefix of the length.
+ */
+static Size
+entryPageCapacity(Size pageSize, int prefixLength)
+{
+	Size specialSize = prefixLength > 0 ?
+					   RumEntryPrefixSpecialSize(prefixLength) :
+					   MAXALIGN(sizeof(RumPageOpaqueData));
+
+	return pageSize - SizeOfPageHeaderData - specialSize;
+}
+
+
+/*
+ * Initializes a page of a split (or a new root) and adds the tuples to it.
+ * The tuples may be compressed with basePrefix, which the page then keeps.
+ * When compression is enabled, a non-leaf page instead uses the longest
+ * prefix shared by the keys that start with basePrefix if that saves space.
+ */
+static void
+entryFillPage(RumBtree btree, Page page, uint16 flags, Size pageSize,
+			  IndexTuple *tuples, int ntuples, const RumEntryPrefixData *basePrefix)
+{
+	RumState *rumstate = btree->rumstate;
+	int baseLength = basePrefix != NULL ? basePrefix->length : 0;
+	const char *prefixData = basePrefix != NULL ? basePrefix->data : NULL;
+	int prefixLength = baseLength;
+	IndexTuple *pageTuples = tuples;
+	int i;
+
+	flags &= ~RUM_ENTRY_PREFIX;
+	if ((flags & RUM_LEAF) == 0 && RumEnableEntryPrefixCompression && ntuples > 1)
+	{
+		struct varlena **keys = palloc0(sizeof(struct varlena *) * ntuples);
+		struct varlena *firstKey = NULL;
+		int commonLength = 0;
+		Size baseSize = 0;
+
+		/* The longest prefix of the keys that start with the base prefix */
+		for (i = 0; i < ntuples; i++)
+		{
+			struct varlena *key = entryGetCompressibleKey(rumstate, basePrefix,
+														  tuples[i]);
+			int keyLength;
+
+			baseSize += MAXALIGN(IndexTupleSize(tuples[i])) + sizeof(ItemIdData);
+			if (key == NULL)
+			{
+				continue;
+			}
+
+			keyLength = VARSIZE_ANY_EXHDR(key);
+			if (keyLength < baseLength ||
+				memcmp(VARDATA_ANY(key), prefixData, baseLength) != 0)
+			{
+				continue;
+			}
+
+			keys[i] = key;
+			if (firstKey == NULL)
+			{
+				firstKey = key;
+				commonLength = Min(keyLength, RUM_ENTRY_PREFIX_MAX_LENGTH);
+			}
+			else
+			{
+				int j = baseLength;
+
+				commonLength = Min(commonLength, keyLength);
+				while (j < commonLength &&
+					   VARDATA_ANY(key)[j] == VARDATA_ANY(firstKey)[j])
+				{
+					j++;
+				}
+
+				commonLength = j;
+			}
+		}
+
+		if (firstKey != NULL && commonLength > baseLength)
+		{
+			IndexTuple *compressedTuples = palloc(sizeof(IndexTuple) * ntuples);
+			Size compressedSize = 0;
+
+			for (i = 0; i < ntuples; i++)
+			{
+				compressedTuples[i] = keys[i] == NULL ? tuples[i] :
+									  entryFormTupleWithKey(rumstate, tuples[i],
+															VARDATA_ANY(keys[i]) +
+															commonLength,
+															VARSIZE_ANY_EXHDR(keys[i]) -
+															commonLength,
+															true);
+				compressedSize += MAXALIGN(IndexTupleSize(compressedTuples[i])) +
+								  sizeof(ItemIdData);
+			}
+
+			/* Use the longer prefix if it fits and the page ends up smaller */
+			if (compressedSize <= entryPageCapacity(pageSize, commonLength) &&
+				compressedSize + RumEntryPrefixSpecialSize(commonLength) <
+				baseSize + (pageSize - SizeOfPageHeaderData -
+							entryPageCapacity(pageSize, baseLength)))
+			{
+				pageTuples = compressedTuples;
+				prefixData = VARDATA_ANY(firstKey);
+				prefixLength = commonLength;
+			}
+		}
+	}
+
+	if (prefixLength > 0)
+	{
+		RumInitEntryPrefixPage(page, flags, pageSize, prefixData, prefixLength);
+	}
+	else
+	{
+		RumInitPage(page, flags, pageSize);
+	}
+
+	for (i = 0; i < ntuples; i++)
+	{
+		IndexTuple itup = pageTuples[i];
+
+		if (PageAddItem(page, (Item) itup, IndexTupleSize(itup), InvalidOffsetNumber,
+						false, false) == InvalidOffsetNumber)
+		{
+			elog(ERROR, "failed to add item to index page in \"%s\"",
+				 RelationGetRelationName(btree->index));
+		}
+	}
+}
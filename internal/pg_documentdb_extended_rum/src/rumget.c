@@ -15,6 +15,7 @@
 #include "rumsort.h"
 
 #include "access/relscan.h"
+#include "storage/bufmgr.h"
 #include "storage/predicate.h"
 #include "miscadmin.h"
 #include "utils/builtins.h"
@@ -48,6 +49,8 @@ bool RumEnableRefindLeafOnEntryNextItem =
 	RUM_DEFAULT_ENABLE_REFIND_LEAF_ON_ENTRY_NEXT_ITEM;
 bool RumDisableFastScan = RUM_DEFAULT_DISABLE_FAST_SCAN;
 bool RumEnableEntryFindItemOnScan = RUM_DEFAULT_ENABLE_ENTRY_FIND_ITEM_ON_SCAN;
+bool RumEnableGallopingEntryFindItem = RUM_DEFAULT_ENABLE_GALLOPING_ENTRY_FIND_ITEM;
+int RumHeapPrefetchDistance = RUM_DEFAULT_HEAP_PREFETCH_DISTANCE;
 bool RumForceOrderedIndexScan = DEFAULT_FORCE_RUM_ORDERED_INDEX_SCAN;
 bool RumPreferOrderedIndexScan = RUM_DEFAULT_PREFER_ORDERED_INDEX_SCAN;
 bool RumEnableSkipIntermediateEntry = RUM_DEFAULT_ENABLE_SKIP_INTERMEDIATE_ENTRY;
@@ -2994,6 +2997,73 @@ end:
 }
 
 
+/*
+ * Finds the first item of the loaded list of the entry from its current offset
+ * that is not before the given item in the scan direction. The list is probed at
+ * exponentially growing distances and the last step is binary searched, so
+ * skipping over a long run of a common term to the next item of a rare one
+ * costs a logarithmic number of comparisons. Returns false (with the offset
+ * past the end of the list) if no such item is loaded.
+ */
+static bool
+entryGallopListItem(RumState *rumstate, RumScanEntry entry, RumItem *item)
+{
+	int start = entry->offset;
+	int remaining = ScanDirectionIsForward(entry->scanDirection) ?
+					entry->nlist - start : start + 1;
+
+#define ENTRY_LIST_ITEM_AT(step) (&entry->list[start + (step) * entry->scanDirection])
+#define ENTRY_LIST_ITEM_REACHED(step) \
+	(compareRumItemScanDirection(rumstate, entry->attnumOrig, entry->scanDirection, \
+								 ENTRY_LIST_ITEM_AT(step), item) >= 0)
+
+	if (remaining <= 0)
+	{
+		return false;
+	}
+
+	/* lower is known to be before the item, upper is the first candidate */
+	int lower = -1;
+	int upper = 0;
+	while (upper < remaining && !ENTRY_LIST_ITEM_REACHED(upper))
+	{
+		lower = upper;
+		upper = upper == 0 ? 1 : upper * 2;
+	}
+
+	if (upper > remaining)
+	{
+		upper = remaining;
+	}
+
+	while (upper - lower > 1)
+	{
+		int middle = lower + (upper - lower) / 2;
+		if (ENTRY_LIST_ITEM_REACHED(middle))
+		{
+			upper = middle;
+		}
+		else
+		{
+			lower = middle;
+		}
+	}
+
+	if (upper == remaining)
+	{
+		entry->offset = start + remaining * entry->scanDirection;
+		return false;
+	}
+
+	entry->curItem = *ENTRY_LIST_ITEM_AT(upper);
+	entry->offset = start + (upper + 1) * entry->scanDirection;
+	return true;
+
+#undef ENTRY_LIST_ITEM_REACHED
+#undef ENTRY_LIST_ITEM_AT
+}
+
+
 /*
  * Find item of scan entry wich is greater or equal to the given item.
  */
@@ -3021,18 +3091,28 @@ entryFindItem(RumState *rumstate, RumScanEntry entry, RumItem *item, Snapshot sn
 		{
 			return;
 		}
-		while (entry->offset >= 0 && entry->offset < entry->nlist)
+		if (RumEnableGallopingEntryFindItem)
 		{
-			if (compareRumItemScanDirection(rumstate, entry->attnumOrig,
-											entry->scanDirection,
-											&entry->list[entry->offset],
-											item) >= 0)
+			if (entryGallopListItem(rumstate, entry, item))
 			{
-				entry->curItem = entry->list[entry->offset];
-				entry->offset += entry->scanDirection;
 				return;
 			}
-			entry->offset += entry->scanDirection;
+		}
+		else
+		{
+			while (entry->offset >= 0 && entry->offset < entry->nlist)
+			{
+				if (compareRumItemScanDirection(rumstate, entry->attnumOrig,
+												entry->scanDirection,
+												&entry->list[entry->offset],
+												item) >= 0)
+				{
+					entry->curItem = entry->list[entry->offset];
+					entry->offset += entry->scanDirection;
+					return;
+				}
+				entry->offset += entry->scanDirection;
+			}
 		}
 	}
 
@@ -3837,6 +3917,82 @@ scanGetItemOrdered(IndexScanDesc scan, RumItem *advancePast,
 }
 
 
+/*
+ * The heap fetch of each returned tuple is a random read: Issue prefetches for the
+ * heap blocks of the next items of the entry that drives the scan, so that they
+ * are in flight while the executor works on the current one. Only scans where a
+ * single entry produces the results in TID order qualify (ordered scans and scans
+ * with a single entry); prefetches are refilled once the lead drops below half
+ * the distance so each call does a constant amount of work.
+ */
+static void
+rumPrefetchHeapBlocks(IndexScanDesc scan, RumScanOpaque so)
+{
+	RumScanEntry entry = NULL;
+	int start, end, half;
+
+	if (scan->heapRelation == NULL || so->rumstate.useAlternativeOrder)
+	{
+		return;
+	}
+
+	if (so->scanType == RumOrderedScan && so->orderByScanData != NULL)
+	{
+		entry = so->orderByScanData->orderByEntry;
+	}
+	else if (so->totalentries == 1)
+	{
+		entry = so->entries[0];
+	}
+
+	if (entry == NULL || entry->isFinished || entry->list == NULL ||
+		!ScanDirectionIsForward(entry->scanDirection) ||
+		entry->offset < 0 || entry->offset >= entry->nlist)
+	{
+		return;
+	}
+
+	start = entry->offset;
+	end = Min(entry->nlist, start + RumHeapPrefetchDistance);
+	half = Min(end - 1, start + RumHeapPrefetchDistance / 2);
+
+	/*
+	 * Ordered scans reuse the entry for the posting list of every key, which need
+	 * not be in TID order across keys: Only resume within the same list.
+	 */
+	if (so->prefetchEntry == entry && ItemPointerIsValid(&so->prefetchHorizon) &&
+		ItemPointerEquals(&so->prefetchListStart, &entry->list[0].iptr))
+	{
+		if (rumCompareItemPointers(&entry->list[half].iptr, &so->prefetchHorizon) <= 0)
+		{
+			/* Still far enough ahead */
+			return;
+		}
+
+		while (start < end &&
+			   rumCompareItemPointers(&entry->list[start].iptr,
+									  &so->prefetchHorizon) <= 0)
+		{
+			start++;
+		}
+	}
+
+	for (int i = start; i < end; i++)
+	{
+		BlockNumber block = ItemPointerGetBlockNumber(&entry->list[i].iptr);
+		if (block != so->prefetchBlock)
+		{
+			PrefetchBuffer(scan->heapRelation, MAIN_FORKNUM, block);
+			so->prefetchBlock = block;
+		}
+	}
+
+	so->prefetchEntry = entry;
+	so->prefetchListStart = entry->list[0].iptr;
+	so->prefetchHorizon = entry->list[end - 1].iptr;
+}
+
+
 /*
  * Get next item whether using regular or fast scan.
  */
@@ -4196,6 +4352,11 @@ rumgettuple(IndexScanDesc scan, ScanDirection direction)
 	{
 		if (scanGetItem(scan, &so->item, &so->item, &recheck, &recheckOrderby))
 		{
+			if (RumHeapPrefetchDistance > 0)
+			{
+				rumPrefetchHeapBlocks(scan, so);
+			}
+
 			SET_SCAN_TID(scan, so->item.iptr);
 			scan->xs_recheck = recheck;
 			scan->xs_recheckorderby = recheckOrderby;
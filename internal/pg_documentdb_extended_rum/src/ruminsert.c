@@ -40,6 +40,9 @@
 #include "rumbuild_tuplesort.h"
 
 bool RumEnableParallelIndexBuild = RUM_DEFAULT_ENABLE_PARALLEL_INDEX_BUILD;
+bool RumEnableParallelAddInfoIndexBuild =
+	RUM_DEFAULT_ENABLE_PARALLEL_ADDINFO_INDEX_BUILD;
+bool RumEnableInsertStateCache = RUM_DEFAULT_ENABLE_INSERT_STATE_CACHE;
 int RumParallelIndexWorkersOverride = RUM_DEFAULT_PARALLEL_INDEX_WORKERS_OVERRIDE;
 
 extern PGDLLEXPORT void rum_parallel_build_main(dsm_segment *seg, shm_toc *toc);
@@ -194,6 +197,14 @@ typedef struct RumBuffer
 	int nfrozen;
 	SortSupport ssup;           /* for sorting/comparing keys */
 	RumItem *items;
+
+	/*
+	 * The additional info attribute of the key (NULL if it has none) and the
+	 * context that holds the additional info of the items.
+	 */
+	RumState *rumstate;
+	Form_pg_attribute addAttr;
+	MemoryContext addInfoCtx;
 } RumBuffer;
 
 static void _rum_end_parallel(RumLeader *rumleader, RumBuildState *state);
@@ -868,16 +879,16 @@ rumbuild(Relation heap, Relation index, struct IndexInfo *indexInfo)
 	buildstate.accum.rumstate = &buildstate.rumstate;
 	rumInitBA(&buildstate.accum);
 
-	/* Scenarios that have addinfo need to skip parallel build */
+	/*
+	 * Scenarios that have addinfo need to skip parallel build, unless it is
+	 * the addinfo of the key itself (e.g. the lexeme positions of text
+	 * indexes): The workers then also extract it, and ship it to the leader
+	 * with the TIDs.
+	 */
 	for (i = 0; i < INDEX_MAX_KEYS && isParallelIndexCapable; i++)
 	{
-		if (buildstate.rumstate.addAttrs[i] != NULL)
-		{
-			isParallelIndexCapable = false;
-			break;
-		}
-
-		if (buildstate.rumstate.canJoinAddInfo[i])
+		if (buildstate.rumstate.addAttrs[i] != NULL &&
+			!RumEnableParallelAddInfoIndexBuild)
 		{
 			isParallelIndexCapable = false;
 			break;
@@ -887,7 +898,8 @@ rumbuild(Relation heap, Relation index, struct IndexInfo *indexInfo)
 	/* We only support parallel build when it's sorted via itempointers only */
 	if (RumEnableParallelIndexBuild &&
 		isParallelIndexCapable &&
-		!buildstate.rumstate.attrnAddToColumn)
+		!buildstate.rumstate.attrnAddToColumn &&
+		!buildstate.rumstate.useAlternativeOrder)
 	{
 		return rumbuild_parallel(heap, index, indexInfo, &buildstate);
 	}
@@ -983,13 +995,14 @@ static RumTuple *
 _rum_build_tuple(OffsetNumber attrnum, unsigned char category,
 				 Datum key, int16 typlen, bool typbyval,
 				 RumItem *items, uint32 nitems,
-				 Size *len)
+				 Form_pg_attribute addAttr, Size *len)
 {
 	RumTuple *tuple;
 	char *ptr;
 
 	Size tuplen;
 	int keylen;
+	Size addinfolen = 0;
 
 	dlist_mutable_iter iter;
 	dlist_head segments;
@@ -1056,12 +1069,25 @@ _rum_build_tuple(OffsetNumber attrnum, unsigned char category,
 		dlist_push_tail(&segments, &seginfo->node);
 	}
 
+	/*
+	 * The posting lists only hold the TIDs: The additional info of the items
+	 * (e.g. the lexeme positions of text indexes) is serialized after them.
+	 */
+	if (addAttr != NULL)
+	{
+		for (uint32 i = 0; i < nitems; i++)
+		{
+			addinfolen += datumEstimateSpace(items[i].addInfo, items[i].addInfoIsNull,
+											 addAttr->attbyval, addAttr->attlen);
+		}
+	}
+
 	/*
 	 * Determine RUM tuple length with all the data included. Be careful about
 	 * alignment, to allow direct access to compressed segments (those require
 	 * only SHORTALIGN).
 	 */
-	tuplen = SHORTALIGN(offsetof(RumTuple, data) + keylen) + compresslen;
+	tuplen = SHORTALIGN(offsetof(RumTuple, data) + keylen) + compresslen + addinfolen;
 
 	*len = tuplen;
 
@@ -1079,6 +1105,7 @@ _rum_build_tuple(OffsetNumber attrnum, unsigned char category,
 	tuple->category = category;
 	tuple->keylen = keylen;
 	tuple->nitems = nitems;
+	tuple->addinfolen = addinfolen;
 
 	/* key type info */
 	tuple->typlen = typlen;
@@ -1126,6 +1153,15 @@ _rum_build_tuple(OffsetNumber attrnum, unsigned char category,
 		pfree(seginfo);
 	}
 
+	if (addAttr != NULL)
+	{
+		for (uint32 i = 0; i < nitems; i++)
+		{
+			datumSerialize(items[i].addInfo, items[i].addInfoIsNull,
+						   addAttr->attbyval, addAttr->attlen, &ptr);
+		}
+	}
+
 	return tuple;
 }
 
@@ -1150,21 +1186,38 @@ _rum_parse_tuple_key(RumTuple *a)
 }
 
 
+/*
+ * Returns the items of the tuple, with their additional info (if any)
+ * restored in addInfoCtx.
+ */
 static RumItem *
-_rum_parse_tuple_items(RumTuple *a)
+_rum_parse_tuple_items(RumTuple *a, MemoryContext addInfoCtx)
 {
 	int len;
 	char *ptr;
 	int ndecoded;
 	RumItem *items;
 
-	len = a->tuplen - SHORTALIGN(offsetof(RumTuple, data) + a->keylen);
+	len = a->tuplen - SHORTALIGN(offsetof(RumTuple, data) + a->keylen) - a->addinfolen;
 	ptr = (char *) a + SHORTALIGN(offsetof(RumTuple, data) + a->keylen);
 
 	items = rumPostingListDecodeAllSegments((RumPostingList *) ptr, len, &ndecoded);
 
 	Assert(ndecoded == a->nitems);
 
+	if (a->addinfolen > 0)
+	{
+		MemoryContext oldCtx = MemoryContextSwitchTo(addInfoCtx);
+
+		ptr += len;
+		for (int i = 0; i < ndecoded; i++)
+		{
+			items[i].addInfo = datumRestore(&ptr, &items[i].addInfoIsNull);
+		}
+
+		MemoryContextSwitchTo(oldCtx);
+	}
+
 	return items;
 }
 
@@ -1185,7 +1238,7 @@ AssertCheckRumItems(RumBuffer *buffer)
 	for (int i = 0; i < buffer->nitems; i++)
 	{
 		Assert(ItemPointerIsValid(&buffer->items[i].iptr));
-		Assert(buffer->items[i].addInfoIsNull);
+		Assert(buffer->addAttr != NULL || buffer->items[i].addInfoIsNull);
 
 		/* don't check ordering for the first TID item */
 		if (i == 0)
@@ -1237,6 +1290,11 @@ RumBufferInit(RumState *state)
 	 */
 	buffer->maxitems = (64 * 1024L) / sizeof(RumItem);
 
+	buffer->rumstate = state;
+	buffer->addInfoCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Rum build buffer additional info",
+											   ALLOCSET_DEFAULT_SIZES);
+
 	nKeys = IndexRelationGetNumberOfKeyAttributes(state->index);
 
 	buffer->ssup = palloc0(sizeof(SortSupportData) * nKeys);
@@ -1361,7 +1419,7 @@ RumBufferStoreTuple(RumBuffer *buffer, RumTuple *tup)
 	AssertCheckRumBuffer(buffer);
 
 	key = _rum_parse_tuple_key(tup);
-	items = _rum_parse_tuple_items(tup);
+	items = _rum_parse_tuple_items(tup, buffer->addInfoCtx);
 
 	/* if the buffer is empty, set the fields (and copy the key) */
 	if (RumBufferIsEmpty(buffer))
@@ -1369,6 +1427,7 @@ RumBufferStoreTuple(RumBuffer *buffer, RumTuple *tup)
 		buffer->category = tup->category;
 		buffer->keylen = tup->keylen;
 		buffer->attnum = tup->attrnum;
+		buffer->addAttr = buffer->rumstate->addAttrs[tup->attrnum - 1];
 
 		buffer->typlen = tup->typlen;
 		buffer->typbyval = tup->typbyval;
@@ -1495,6 +1554,9 @@ RumBufferReset(RumBuffer *buffer)
 
 	buffer->typlen = 0;
 	buffer->typbyval = 0;
+
+	buffer->addAttr = NULL;
+	MemoryContextReset(buffer->addInfoCtx);
 }
 
 
@@ -1504,10 +1566,34 @@ RumBufferTrim(RumBuffer *buffer)
 	Assert((buffer->nfrozen > 0) && (buffer->nfrozen <= buffer->nitems));
 
 	memmove(&buffer->items[0], &buffer->items[buffer->nfrozen],
-			sizeof(ItemPointerData) * (buffer->nitems - buffer->nfrozen));
+			sizeof(RumItem) * (buffer->nitems - buffer->nfrozen));
 
 	buffer->nitems -= buffer->nfrozen;
 	buffer->nfrozen = 0;
+
+	/* Only keep the additional info of the remaining items */
+	if (buffer->addAttr != NULL)
+	{
+		MemoryContext trimmedCtx = AllocSetContextCreate(
+			MemoryContextGetParent(buffer->addInfoCtx),
+			"Rum build buffer additional info",
+			ALLOCSET_DEFAULT_SIZES);
+		MemoryContext oldCtx = MemoryContextSwitchTo(trimmedCtx);
+
+		for (int i = 0; i < buffer->nitems; i++)
+		{
+			if (!buffer->items[i].addInfoIsNull)
+			{
+				buffer->items[i].addInfo = datumCopy(buffer->items[i].addInfo,
+													 buffer->addAttr->attbyval,
+													 buffer->addAttr->attlen);
+			}
+		}
+
+		MemoryContextSwitchTo(oldCtx);
+		MemoryContextDelete(buffer->addInfoCtx);
+		buffer->addInfoCtx = trimmedCtx;
+	}
 }
 
 
@@ -1526,6 +1612,7 @@ RumBufferFree(RumBuffer *buffer)
 		pfree(DatumGetPointer(buffer->key));
 	}
 
+	MemoryContextDelete(buffer->addInfoCtx);
 	pfree(buffer);
 }
 
@@ -1573,7 +1660,8 @@ rumFlushBuildState(RumBuildState *buildstate, Relation index)
 
 		tup = _rum_build_tuple(attnum, category,
 							   key, attr->attlen, attr->attbyval,
-							   list, nlist, &tuplen);
+							   list, nlist, buildstate->rumstate.addAttrs[attnum - 1],
+							   &tuplen);
 
 		tuplesort_putrumtuple(buildstate->bs_worker_sort, tup, tuplen);
 
@@ -1705,7 +1793,8 @@ _rum_process_worker_data(RumBuildState *state, Tuplesortstate *worker_sort,
 
 			ntup = _rum_build_tuple(buffer->attnum, buffer->category,
 									buffer->key, buffer->typlen, buffer->typbyval,
-									buffer->items, buffer->nitems, &ntuplen);
+									buffer->items, buffer->nitems, buffer->addAttr,
+								&ntuplen);
 
 			tuplesort_putrumtuple(state->bs_sortstate, ntup, ntuplen);
 			state->bs_numtuples++;
@@ -1739,7 +1828,8 @@ _rum_process_worker_data(RumBuildState *state, Tuplesortstate *worker_sort,
 
 			ntup = _rum_build_tuple(buffer->attnum, buffer->category,
 									buffer->key, buffer->typlen, buffer->typbyval,
-									buffer->items, buffer->nfrozen, &ntuplen);
+									buffer->items, buffer->nfrozen, buffer->addAttr,
+									&ntuplen);
 
 			tuplesort_putrumtuple(state->bs_sortstate, ntup, ntuplen);
 
@@ -1766,7 +1856,8 @@ _rum_process_worker_data(RumBuildState *state, Tuplesortstate *worker_sort,
 
 		ntup = _rum_build_tuple(buffer->attnum, buffer->category,
 								buffer->key, buffer->typlen, buffer->typbyval,
-								buffer->items, buffer->nitems, &ntuplen);
+								buffer->items, buffer->nitems, buffer->addAttr,
+								&ntuplen);
 
 		tuplesort_putrumtuple(state->bs_sortstate, ntup, ntuplen);
 		state->bs_numtuples++;
@@ -2530,29 +2621,48 @@ ruminsert(Relation index, Datum *values, bool *isnull,
 #endif
 		  )
 {
-	RumState rumstate;
+	RumState *rumstate;
 	MemoryContext oldCtx;
 	MemoryContext insertCtx;
 	int i;
 	Datum outerAddInfo = (Datum) 0;
 	bool outerAddInfoIsNull = true;
 
+	/*
+	 * Multi-row writes call this once per heap tuple: Like GIN, keep the RumState
+	 * (support functions, tuple descriptors) for the whole statement in the
+	 * IndexInfo instead of looking it up again for every tuple.
+	 */
+	rumstate = RumEnableInsertStateCache ? (RumState *) indexInfo->ii_AmCache : NULL;
+	if (rumstate == NULL && RumEnableInsertStateCache)
+	{
+		oldCtx = MemoryContextSwitchTo(indexInfo->ii_Context);
+		rumstate = (RumState *) palloc(sizeof(RumState));
+		initRumState(rumstate, index);
+		indexInfo->ii_AmCache = (void *) rumstate;
+		MemoryContextSwitchTo(oldCtx);
+	}
+
 	insertCtx = RumContextCreate(CurrentMemoryContext,
 								 "Rum insert temporary context");
 
 	oldCtx = MemoryContextSwitchTo(insertCtx);
 
-	initRumState(&rumstate, index);
+	if (rumstate == NULL)
+	{
+		rumstate = (RumState *) palloc(sizeof(RumState));
+		initRumState(rumstate, index);
+	}
 
-	if (AttributeNumberIsValid(rumstate.attrnAttachColumn))
+	if (AttributeNumberIsValid(rumstate->attrnAttachColumn))
 	{
-		outerAddInfo = values[rumstate.attrnAttachColumn - 1];
-		outerAddInfoIsNull = isnull[rumstate.attrnAttachColumn - 1];
+		outerAddInfo = values[rumstate->attrnAttachColumn - 1];
+		outerAddInfoIsNull = isnull[rumstate->attrnAttachColumn - 1];
 	}
 
-	for (i = 0; i < rumstate.origTupdesc->natts; i++)
+	for (i = 0; i < rumstate->origTupdesc->natts; i++)
 	{
-		rumHeapTupleInsert(&rumstate, (OffsetNumber) (i + 1),
+		rumHeapTupleInsert(rumstate, (OffsetNumber) (i + 1),
 						   values[i], isnull[i], ht_ctid,
 						   outerAddInfo, outerAddInfoIsNull);
 	}
@@ -731,6 +731,9 @@ rumNewScanKey(IndexScanDesc scan)
 	so->willSort = false;
 	so->orderByScanData = NULL;
 	so->projectIndexTupleData = NULL;
+	so->prefetchEntry = NULL;
+	ItemPointerSetInvalid(&so->prefetchHorizon);
+	so->prefetchBlock = InvalidBlockNumber;
 
 	/*
 	 * Allocate all the scan key information in the key context. (If
@@ -18,6 +18,7 @@
 #include "catalog/pg_collation.h"
 #include "catalog/pg_opclass.h"
 #include "catalog/pg_type.h"
+#include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "storage/indexfsm.h"
 #include "storage/lmgr.h"
@@ -44,6 +45,12 @@ static relopt_kind rum_relopt_kind;
 
 bool RumThrowErrorOnInvalidDataPage = RUM_DEFAULT_THROW_ERROR_ON_INVALID_DATA_PAGE;
 bool RumUseNewItemPtrDecoding = RUM_DEFAULT_USE_NEW_ITEM_PTR_DECODING;
+bool RumUseBatchItemPtrDecoding = RUM_DEFAULT_USE_BATCH_ITEM_PTR_DECODING;
+bool RumEnableCustomWaitEvents = RUM_DEFAULT_ENABLE_CUSTOM_WAIT_EVENTS;
+bool RumEnableEntryPrefixCompression = RUM_DEFAULT_ENABLE_ENTRY_PREFIX_COMPRESSION;
+
+/* The wait event of decoding posting lists, 0 until the backend registers it */
+static uint32 RumPostingDecodeWaitEventInfo = 0;
 
 /*
  * Module load callback
@@ -133,6 +140,15 @@ _PG_init(void)
 		PGC_USERSET, 0,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".enable_rum_galloping_entry_find_item",
+		"Sets whether or not entry find item gallops through the loaded items of a page",
+		NULL,
+		&RumEnableGallopingEntryFindItem,
+		RUM_DEFAULT_ENABLE_GALLOPING_ENTRY_FIND_ITEM,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
 	DefineCustomBoolVariable(
 		DOCUMENTDB_RUM_GUC_PREFIX ".enable_parallel_index_build",
 		"Sets whether or not to enable parallel index build",
@@ -142,6 +158,42 @@ _PG_init(void)
 		PGC_USERSET, 0,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".enable_parallel_addinfo_index_build",
+		"Sets whether or not indexes with additional info (e.g. text indexes) can be built in parallel",
+		NULL,
+		&RumEnableParallelAddInfoIndexBuild,
+		RUM_DEFAULT_ENABLE_PARALLEL_ADDINFO_INDEX_BUILD,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".enable_parallel_vacuum",
+		"Sets whether or not rum indexes can be vacuumed by parallel vacuum workers",
+		NULL,
+		&RumEnableParallelVacuum,
+		RUM_DEFAULT_ENABLE_PARALLEL_VACUUM,
+		PGC_SIGHUP, 0,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".enable_insert_state_cache",
+		"Sets whether or not the rum state is kept across the inserts of a statement",
+		NULL,
+		&RumEnableInsertStateCache,
+		RUM_DEFAULT_ENABLE_INSERT_STATE_CACHE,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".heap_prefetch_distance",
+		"Sets how many upcoming items of a streaming rum index scan have their heap blocks prefetched (0 disables it)",
+		NULL,
+		&RumHeapPrefetchDistance,
+		RUM_DEFAULT_HEAP_PREFETCH_DISTANCE, 0, 1024,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		DOCUMENTDB_RUM_GUC_PREFIX ".parallel_index_workers_override",
 		"Sets the number of parallel index workers to use (default: -1, meaning no override)",
@@ -189,6 +241,33 @@ _PG_init(void)
 		PGC_USERSET, 0,
 		NULL, NULL, NULL);
 
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".rum_use_batch_item_ptr_decoding",
+		"Sets whether or not to decode the item pointers of data pages without additional information in batches",
+		NULL,
+		&RumUseBatchItemPtrDecoding,
+		RUM_DEFAULT_USE_BATCH_ITEM_PTR_DECODING,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".enable_custom_wait_events",
+		"Sets whether or not decoding posting lists is reported as a wait event in pg_stat_activity",
+		NULL,
+		&RumEnableCustomWaitEvents,
+		RUM_DEFAULT_ENABLE_CUSTOM_WAIT_EVENTS,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		DOCUMENTDB_RUM_GUC_PREFIX ".enable_entry_prefix_compression",
+		"Sets whether or not the keys of the non-leaf entry pages written by page splits are prefix compressed",
+		NULL,
+		&RumEnableEntryPrefixCompression,
+		RUM_DEFAULT_ENABLE_ENTRY_PREFIX_COMPRESSION,
+		PGC_USERSET, 0,
+		NULL, NULL, NULL);
+
 	rum_relopt_kind = add_reloption_kind();
 
 	add_string_reloption(rum_relopt_kind, "attach",
@@ -215,6 +294,28 @@ _PG_init(void)
 }
 
 
+/*
+ * Returns the wait_event_info of decoding posting lists: a custom wait event
+ * (DocumentDBRumPostingDecode) on PostgreSQL 17 and later, and the generic
+ * "Extension" wait event before.
+ */
+uint32
+RumGetPostingDecodeWaitEventInfo(void)
+{
+	if (RumPostingDecodeWaitEventInfo == 0)
+	{
+#if PG_VERSION_NUM >= 170000
+		RumPostingDecodeWaitEventInfo =
+			WaitEventExtensionNew("DocumentDBRumPostingDecode");
+#else
+		RumPostingDecodeWaitEventInfo = PG_WAIT_EXTENSION;
+#endif
+	}
+
+	return RumPostingDecodeWaitEventInfo;
+}
+
+
 /*
  * RUM handler function: return IndexAmRoutine with access method parameters
  * and callbacks.
@@ -241,6 +342,20 @@ documentdb_rumhandler(PG_FUNCTION_ARGS)
 	amroutine->amcanparallel = false;
 #endif
 	amroutine->amkeytype = InvalidOid;
+#if PG_VERSION_NUM >= 130000
+
+	/*
+	 * Like GIN, bulk delete and cleanup only walk this index, so a parallel
+	 * vacuum can hand them to a worker and vacuum the other indexes meanwhile.
+	 * The options are cached with the relcache entry of the index, so the
+	 * setting is only changed through the server configuration.
+	 */
+	amroutine->amusemaintenanceworkmem = false;
+	amroutine->amparallelvacuumoptions = RumEnableParallelVacuum ?
+										 VACUUM_OPTION_PARALLEL_BULKDEL |
+										 VACUUM_OPTION_PARALLEL_CLEANUP :
+										 VACUUM_OPTION_NO_PARALLEL;
+#endif
 
 	amroutine->ambuild = rumbuild;
 	amroutine->ambuildempty = rumbuildempty;
@@ -739,13 +854,42 @@ RumInitPage(Page page, uint32 f, Size pageSize)
 
 	opaque = RumPageGetOpaque(page);
 	memset(opaque, 0, sizeof(RumPageOpaqueData));
-	opaque->flags = f;
+
+	/* The flags are often copied from another page: There is no room for a prefix */
+	opaque->flags = f & ~RUM_ENTRY_PREFIX;
 	opaque->leftlink = InvalidBlockNumber;
 	opaque->rightlink = InvalidBlockNumber;
 	RumItemSetMin(RumDataPageGetRightBound(page));
 }
 
 
+/*
+ * Initializes a non-leaf entry page whose keys are compressed with the prefix.
+ */
+void
+RumInitEntryPrefixPage(Page page, uint32 f, Size pageSize, const char *prefix,
+					   uint16 prefixLength)
+{
+	RumPageOpaque opaque;
+	RumEntryPrefixData *entryPrefix;
+
+	Assert((f & RUM_LEAF) == 0 && (f & RUM_DATA) == 0);
+	Assert(prefixLength > 0 && prefixLength <= RUM_ENTRY_PREFIX_MAX_LENGTH);
+
+	PageInit(page, pageSize, RumEntryPrefixSpecialSize(prefixLength));
+
+	opaque = RumPageGetOpaque(page);
+	memset(opaque, 0, sizeof(RumPageOpaqueData));
+	opaque->flags = f | RUM_ENTRY_PREFIX;
+	opaque->leftlink = InvalidBlockNumber;
+	opaque->rightlink = InvalidBlockNumber;
+
+	entryPrefix = RumPageGetEntryPrefix(page);
+	entryPrefix->length = prefixLength;
+	memcpy(entryPrefix->data, prefix, prefixLength);
+}
+
+
 void
 RumInitBuffer(GenericXLogState *state, Buffer buffer, uint32 flags,
 			  bool isBuild)
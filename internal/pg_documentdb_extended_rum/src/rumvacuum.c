@@ -24,6 +24,7 @@
 
 bool RumUseNewVacuumScan = RUM_USE_NEW_VACUUM_SCAN;
 bool RumSkipRetryOnDeletePage = RUM_DEFAULT_SKIP_RETRY_ON_DELETE_PAGE;
+bool RumEnableParallelVacuum = RUM_DEFAULT_ENABLE_PARALLEL_VACUUM;
 
 #if PG_VERSION_NUM >= 180000
 #define RumVacuumDelayPointCompat() \
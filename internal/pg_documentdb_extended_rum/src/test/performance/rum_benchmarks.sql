@@ -0,0 +1,215 @@
+-- Index build and maintenance benchmarks of documentdb_extended_rum.
+--
+-- For every data size in :sizes and posting list shape in :shapes a collection
+-- is loaded, and the following are measured on it through the documentdb API:
+--
+--   build_serial, build_parallel  the build of a single path index with and
+--                                 without documentdb_rum.enable_parallel_index_build
+--   build_composite               the build of a composite index
+--   scan_equality, scan_range,    the best of :iterations index scans of the
+--   scan_ordered                  composite index
+--   insert_composite, insert_wildcard
+--                                 inserting :insert_rows documents into the
+--                                 collection with a composite / wildcard index
+--   build_wildcard                the build of a wildcard index
+--   vacuum                        vacuuming the collection after half of its
+--                                 documents are deleted
+--
+-- The shapes control the posting lists of the index terms: "unique" has a
+-- posting list of one item per term, "skewed" has a handful of terms with
+-- posting trees and "array" has ten overlapping terms per document.
+--
+-- The results are printed as CSV: name,ms,ops,index_bytes where name is
+-- <benchmark>/<shape>/<size>, ops is the number of documents indexed, scanned,
+-- inserted or left after the vacuum and index_bytes the size of the secondary
+-- indexes of the collection after the step.
+
+-- Only the results go to the output
+\o /dev/null
+SET client_min_messages TO WARNING;
+CREATE EXTENSION IF NOT EXISTS documentdb CASCADE;
+CREATE EXTENSION IF NOT EXISTS documentdb_extended_rum;
+
+\if :{?sizes}
+\else
+\set sizes 10000,100000
+\endif
+\if :{?shapes}
+\else
+\set shapes unique,skewed,array
+\endif
+\if :{?iterations}
+\else
+\set iterations 5
+\endif
+\if :{?insert_rows}
+\else
+\set insert_rows 2000
+\endif
+\if :{?parallel_workers}
+\else
+\set parallel_workers 2
+\endif
+
+SELECT pg_catalog.set_config('documentdb.alternate_index_handler_name', 'extended_rum', false);
+SELECT pg_catalog.set_config('documentdb_bench.iterations', :'iterations', false);
+SELECT pg_catalog.set_config('documentdb_bench.insert_rows', :'insert_rows', false);
+SELECT pg_catalog.set_config('max_parallel_maintenance_workers', :'parallel_workers', false);
+SELECT pg_catalog.set_config('documentdb_rum.parallel_index_workers_override', :'parallel_workers', false);
+
+SELECT documentdb_api.drop_database('rum_bench');
+
+CREATE TEMP TABLE bench_results (name text, ms numeric, ops bigint, index_bytes bigint);
+
+CREATE TEMP TABLE bench_collections AS
+SELECT shape, size::bigint AS size, shape || '_' || size AS collection_name
+FROM unnest(string_to_array(:'shapes', ',')) shape,
+	 unnest(string_to_array(:'sizes', ',')) size;
+
+CREATE FUNCTION pg_temp.bench_document(p_shape text, p_id bigint)
+RETURNS documentdb_core.bson
+AS $$
+	SELECT (CASE p_shape
+		WHEN 'unique' THEN FORMAT('{ "_id": %s, "a": %s, "b": %s, "c": "str%s" }',
+								  p_id, p_id, p_id % 1000, p_id)
+		WHEN 'skewed' THEN FORMAT('{ "_id": %s, "a": %s, "b": %s, "c": "str%s" }',
+								  p_id, p_id % 10, p_id % 3, p_id)
+		ELSE FORMAT('{ "_id": %s, "a": [ %s ], "b": %s, "c": "str%s" }', p_id,
+					(SELECT string_agg((p_id + j)::text, ', ') FROM generate_series(0, 9) j),
+					p_id % 100, p_id)
+	END)::documentdb_core.bson;
+$$ LANGUAGE sql;
+
+-- The size of the secondary (i.e. rum) indexes of a data table
+CREATE FUNCTION pg_temp.bench_index_bytes(p_table regclass)
+RETURNS bigint
+AS $$
+	SELECT coalesce(sum(pg_relation_size(indexrelid)), 0)::bigint
+	FROM pg_index WHERE indrelid = p_table AND NOT indisprimary;
+$$ LANGUAGE sql;
+
+CREATE FUNCTION pg_temp.bench_start()
+RETURNS void
+AS $$
+	SELECT pg_catalog.set_config('documentdb_bench.start', clock_timestamp()::text, false);
+$$ LANGUAGE sql;
+
+-- Records the time since bench_start() as the result of the benchmark
+CREATE FUNCTION pg_temp.bench_record(p_name text, p_ops bigint, p_table regclass)
+RETURNS void
+AS $$
+	INSERT INTO bench_results VALUES (p_name,
+		round(extract(epoch FROM clock_timestamp() -
+					  current_setting('documentdb_bench.start')::timestamptz) * 1000, 3),
+		p_ops, pg_temp.bench_index_bytes(p_table));
+$$ LANGUAGE sql;
+
+CREATE FUNCTION pg_temp.run_scan_benchmark(p_name text, p_collection text, p_filter text,
+										   p_sort text, p_limit int, p_table regclass)
+RETURNS void
+AS $$
+DECLARE
+	v_query text;
+	v_ops bigint;
+	v_start timestamptz;
+	v_elapsed_ms numeric;
+	v_best_ms numeric := NULL;
+BEGIN
+	v_query := FORMAT('{ "find": "%s", "filter": %s', p_collection, p_filter);
+	IF p_sort IS NOT NULL THEN
+		v_query := v_query || FORMAT(', "sort": %s', p_sort);
+	END IF;
+	IF p_limit IS NOT NULL THEN
+		v_query := v_query || FORMAT(', "limit": %s', p_limit);
+	END IF;
+	v_query := FORMAT('SELECT count(*) FROM documentdb_api_catalog.bson_aggregation_find(''rum_bench'', %L)',
+					  v_query || ' }');
+
+	-- warm up the buffers and caches before measuring
+	EXECUTE v_query INTO v_ops;
+
+	FOR i IN 1..current_setting('documentdb_bench.iterations')::int LOOP
+		v_start := clock_timestamp();
+		EXECUTE v_query INTO v_ops;
+		v_elapsed_ms := extract(epoch FROM clock_timestamp() - v_start) * 1000;
+		v_best_ms := least(coalesce(v_best_ms, v_elapsed_ms), v_elapsed_ms);
+	END LOOP;
+
+	INSERT INTO bench_results VALUES (p_name, round(v_best_ms, 3), v_ops,
+									  pg_temp.bench_index_bytes(p_table));
+END;
+$$ LANGUAGE plpgsql;
+
+-- Inserts the p_batch'th batch of :insert_rows documents after the loaded ones
+CREATE FUNCTION pg_temp.run_insert_benchmark(p_name text, p_collection text, p_shape text,
+											 p_size bigint, p_batch int, p_table regclass)
+RETURNS void
+AS $$
+DECLARE
+	v_rows int := current_setting('documentdb_bench.insert_rows')::int;
+	v_first_id bigint := p_size + p_batch * v_rows + 1;
+BEGIN
+	PERFORM pg_temp.bench_start();
+	PERFORM count(documentdb_api.insert_one('rum_bench', p_collection,
+											pg_temp.bench_document(p_shape, i)))
+	FROM generate_series(v_first_id, v_first_id + v_rows - 1) i;
+	PERFORM pg_temp.bench_record(p_name, v_rows, p_table);
+END;
+$$ LANGUAGE plpgsql;
+
+-- Load the collections
+SELECT count(documentdb_api.insert_one('rum_bench', collection_name, pg_temp.bench_document(shape, i)))
+FROM bench_collections, generate_series(1, size) i;
+
+-- The steps of the benchmarks of each collection, where
+--   %1$s is the collection, %2$s the <shape>/<size> suffix of the results,
+--   %3$s the data table, %4$s the size, %5$s the shape,
+--   %6$s the value of the equality scans and [%7$s, %8$s) the range of the range scans
+CREATE TEMP TABLE bench_steps (step_id int, step text);
+INSERT INTO bench_steps VALUES
+	(1, 'SELECT pg_catalog.set_config(''documentdb_rum.enable_parallel_index_build'', ''off'', false)'),
+	(2, 'SELECT pg_temp.bench_start()'),
+	(3, 'SELECT documentdb_api_internal.create_indexes_non_concurrently(''rum_bench'', ''{ "createIndexes": "%1$s", "indexes": [ { "key": { "a": 1 }, "name": "a_1" } ] }'', true)'),
+	(4, 'SELECT pg_temp.bench_record(''build_serial/%2$s'', %4$s, ''%3$s'')'),
+	(5, 'CALL documentdb_api.drop_indexes(''rum_bench'', ''{ "dropIndexes": "%1$s", "index": "a_1" }'')'),
+	(6, 'SELECT pg_catalog.set_config(''documentdb_rum.enable_parallel_index_build'', ''on'', false)'),
+	(7, 'SELECT pg_temp.bench_start()'),
+	(8, 'SELECT documentdb_api_internal.create_indexes_non_concurrently(''rum_bench'', ''{ "createIndexes": "%1$s", "indexes": [ { "key": { "a": 1 }, "name": "a_1" } ] }'', true)'),
+	(9, 'SELECT pg_temp.bench_record(''build_parallel/%2$s'', %4$s, ''%3$s'')'),
+	(10, 'CALL documentdb_api.drop_indexes(''rum_bench'', ''{ "dropIndexes": "%1$s", "index": "a_1" }'')'),
+	(11, 'SELECT pg_temp.bench_start()'),
+	(12, 'SELECT documentdb_api_internal.create_indexes_non_concurrently(''rum_bench'', ''{ "createIndexes": "%1$s", "indexes": [ { "key": { "a": 1, "b": 1 }, "enableCompositeTerm": true, "name": "a_b_1" } ] }'', true)'),
+	(13, 'SELECT pg_temp.bench_record(''build_composite/%2$s'', %4$s, ''%3$s'')'),
+	(14, 'ANALYZE %3$s'),
+	(15, 'SELECT pg_catalog.set_config(''documentdb.forceDisableSeqScan'', ''on'', false)'),
+	(16, 'SELECT pg_temp.run_scan_benchmark(''scan_equality/%2$s'', ''%1$s'', ''{ "a": %6$s }'', NULL, NULL, ''%3$s'')'),
+	(17, 'SELECT pg_temp.run_scan_benchmark(''scan_range/%2$s'', ''%1$s'', ''{ "a": { "$gte": %7$s, "$lt": %8$s } }'', NULL, NULL, ''%3$s'')'),
+	(18, 'SELECT pg_temp.run_scan_benchmark(''scan_ordered/%2$s'', ''%1$s'', ''{ "a": { "$gte": %7$s } }'', ''{ "a": 1 }'', 100, ''%3$s'')'),
+	(19, 'SELECT pg_catalog.set_config(''documentdb.forceDisableSeqScan'', ''off'', false)'),
+	(20, 'SELECT pg_temp.run_insert_benchmark(''insert_composite/%2$s'', ''%1$s'', ''%5$s'', %4$s, 0, ''%3$s'')'),
+	(21, 'CALL documentdb_api.drop_indexes(''rum_bench'', ''{ "dropIndexes": "%1$s", "index": "a_b_1" }'')'),
+	(22, 'SELECT pg_temp.bench_start()'),
+	(23, 'SELECT documentdb_api_internal.create_indexes_non_concurrently(''rum_bench'', ''{ "createIndexes": "%1$s", "indexes": [ { "key": { "$**": 1 }, "name": "wildcard" } ] }'', true)'),
+	(24, 'SELECT pg_temp.bench_record(''build_wildcard/%2$s'', %4$s, ''%3$s'')'),
+	(25, 'SELECT pg_temp.run_insert_benchmark(''insert_wildcard/%2$s'', ''%1$s'', ''%5$s'', %4$s, 1, ''%3$s'')'),
+	(26, 'SELECT documentdb_api.delete(''rum_bench'', ''{ "delete": "%1$s", "deletes": [ { "q": { "_id": { "$mod": [ 2, 0 ] } }, "limit": 0 } ] }'')'),
+	(27, 'SELECT pg_temp.bench_start()'),
+	(28, 'VACUUM %3$s'),
+	(29, 'SELECT pg_temp.bench_record(''vacuum/%2$s'', (SELECT count(*) FROM %3$s), ''%3$s'')');
+
+-- VACUUM, drop_indexes and the parallel builds need to run as top level statements
+SELECT FORMAT(s.step, c.collection_name, c.shape || '/' || c.size,
+			  'documentdb_data.documents_' || m.collection_id, c.size, c.shape,
+			  CASE c.shape WHEN 'skewed' THEN 5 ELSE c.size / 2 END,
+			  CASE c.shape WHEN 'skewed' THEN 2 ELSE c.size / 4 END,
+			  CASE c.shape WHEN 'skewed' THEN 5 ELSE c.size / 4 + c.size / 10 END)
+FROM bench_collections c
+JOIN documentdb_api_catalog.collections m
+  ON m.database_name = 'rum_bench' AND m.collection_name = c.collection_name
+CROSS JOIN bench_steps s
+ORDER BY c.size, c.shape, s.step_id \gexec
+
+SELECT documentdb_api.drop_database('rum_bench');
+
+\o
+\copy (SELECT name, ms, ops, index_bytes FROM bench_results ORDER BY name) TO STDOUT WITH (FORMAT csv, HEADER)
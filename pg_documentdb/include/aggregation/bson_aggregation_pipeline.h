@@ -79,6 +79,18 @@ typedef struct
 	 * The time system variables ($$NOW, $$CLUSTER_TIME).
 	 */
 	TimeSystemVariables timeSystemVariables;
+
+	/*
+	 * The requested maxParallelWorkers in the query request
+	 * (-1 if not specified).
+	 */
+	int32_t maxParallelWorkers;
+
+	/*
+	 * The requested maxAwaitTimeMS of a getMore of a tailable cursor
+	 * (0 if not specified).
+	 */
+	int32_t maxAwaitTimeMS;
 } QueryData;
 
 
@@ -133,6 +145,7 @@ GenerateFirstPageQueryData(void)
 {
 	QueryData queryData = { 0 };
 	queryData.batchSize = DefaultCursorFirstPageBatchSize;
+	queryData.maxParallelWorkers = -1;
 	return queryData;
 }
 
@@ -44,6 +44,7 @@ typedef enum
 
 	/* Start internal stages Mongo */
 	Stage_Internal_InhibitOptimization = 1,
+	Stage_Internal_UnpackBucket,
 
 	/* Start Mongo Public stages */
 	Stage_AddFields = 10,
@@ -69,6 +70,8 @@ typedef enum
 	Stage_Merge,
 	Stage_Out,
 	Stage_Project,
+	Stage_QueryStats,
+	Stage_RankFusion,
 	Stage_Redact,
 	Stage_ReplaceRoot,
 	Stage_ReplaceWith,
@@ -176,6 +179,16 @@ typedef struct
 
 	/*Parent Stage Name*/
 	ParentStageName parentStageName;
+
+	/*
+	 * The query scanning the buckets of a time-series collection, whose target
+	 * list unpacks them ($_internalUnpackBucket). The filters of a $match on
+	 * the measurements are also applied to the bucket document, which is the
+	 * timeseriesBucketDocument expression, to prune the buckets.
+	 */
+	Query *timeseriesBucketQuery;
+	Expr *timeseriesBucketDocument;
+	struct TimeseriesOptions *timeseriesOptions;
 } AggregationPipelineBuildContext;
 
 
@@ -258,6 +271,8 @@ Query * HandleIndexStats(const bson_value_t *existingValue, Query *query,
 						 AggregationPipelineBuildContext *context);
 Query * HandleCurrentOp(const bson_value_t *existingValue, Query *query,
 						AggregationPipelineBuildContext *context);
+Query * HandleQueryStats(const bson_value_t *existingValue, Query *query,
+						 AggregationPipelineBuildContext *context);
 Query * HandleChangeStream(const bson_value_t *existingValue, Query *query,
 						   AggregationPipelineBuildContext *context);
 
@@ -0,0 +1,64 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/aggregation/bson_aggregation_query_cache.h
+ *
+ * Exports for the per backend cache of queries generated for find and aggregate.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BSON_AGGREGATION_QUERY_CACHE_H
+#define BSON_AGGREGATION_QUERY_CACHE_H
+
+#include <nodes/parsenodes.h>
+
+#include "io/bson_core.h"
+#include "aggregation/bson_aggregation_pipeline.h"
+
+/*
+ * The kind of command the query was generated for.
+ */
+typedef enum QueryShapeCacheKind
+{
+	QueryShapeCacheKind_Find = 1,
+
+	QueryShapeCacheKind_Aggregate = 2,
+} QueryShapeCacheKind;
+
+/*
+ * The key of a request in the query shape cache: Built when looking up
+ * the cache, and passed back when adding the generated query.
+ */
+typedef struct QueryShapeCacheKey
+{
+	/* The hash of the shape */
+	uint64 hash;
+
+	/*
+	 * The kind, the query generation inputs, the database and the spec without
+	 * the per request fields. NULL if the request can't be cached.
+	 */
+	bytea *shape;
+
+	/* The invalidations seen by the cache when the key was built */
+	uint64 invalidationCount;
+
+	/*
+	 * The feature counters of the backend when the key was built: The ones the
+	 * query generation increments are replayed on cache hits.
+	 */
+	int *featureCountersAtMiss;
+} QueryShapeCacheKey;
+
+/* Feature flag for the query shape cache */
+extern bool EnableQueryShapeCache;
+
+Query * GetQueryFromShapeCache(QueryShapeCacheKind kind, text *database, pgbson *spec,
+							   QueryData *queryData, bool addCursorParams,
+							   bool setStatementTimeout, QueryShapeCacheKey *key);
+void AddQueryToShapeCache(QueryShapeCacheKey *key, Query *query,
+						  const QueryData *queryData);
+void InvalidateQueryShapeCache(void);
+
+#endif
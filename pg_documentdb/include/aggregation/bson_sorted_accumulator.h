@@ -80,6 +80,7 @@ Datum BsonOrderTransition(PG_FUNCTION_ARGS, bool invertSort, bool isSingle, bool
 						  storeInputExpression);
 Datum BsonOrderTransitionOnSorted(PG_FUNCTION_ARGS, bool invertSort, bool isSingle);
 Datum BsonOrderCombine(PG_FUNCTION_ARGS, bool invertSort);
+Datum BsonOrderCombineOnSorted(PG_FUNCTION_ARGS, bool invertSort);
 Datum BsonOrderFinal(PG_FUNCTION_ARGS, bool isSingle, bool invert);
 Datum BsonOrderFinalOnSorted(PG_FUNCTION_ARGS, bool isSingle);
 
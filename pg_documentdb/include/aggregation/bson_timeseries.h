@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/aggregation/bson_timeseries.h
+ *
+ * Common declarations of functions for handling the $_internalUnpackBucket
+ * stage of time-series collections.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BSON_TIMESERIES_H
+#define BSON_TIMESERIES_H
+
+
+#include "io/bson_core.h"
+#include "aggregation/bson_aggregation_pipeline.h"
+
+#include "aggregation/bson_aggregation_pipeline_private.h"
+
+Query * HandleInternalUnpackBucket(const bson_value_t *existingValue, Query *query,
+								   AggregationPipelineBuildContext *context);
+void AddTimeseriesBucketFilters(const bson_value_t *matchValue, Query *query,
+								AggregationPipelineBuildContext *context);
+
+#endif
@@ -79,6 +79,14 @@ typedef struct ChildNodeData
 	 * DO NOT add to the children directly.
 	 */
 	BsonPathNode *children;
+
+	/*
+	 * Index of the children by field, built once numChildren goes past
+	 * BSON_TREE_CHILD_INDEX_THRESHOLD so that looking up a child of a wide node
+	 * (e.g. a projection with hundreds of fields) isn't linear in its children.
+	 * NULL for narrower nodes.
+	 */
+	struct HTAB *childIndex;
 } ChildNodeData;
 
 /* Data for an intermediate path node in the tree */
@@ -89,6 +89,18 @@ typedef struct
 
 	/* Flag to decide whether to run the job on metadata coordinator only or on all nodes. */
 	bool toBeExecutedOnMetadataCoordinatorOnly;
+
+	/*
+	 * Jobs with a higher priority are started first when more jobs are due
+	 * than the background worker may run at once.
+	 */
+	int priority;
+
+	/*
+	 * The number of executions of the job that may run at the same time, so that
+	 * a slow execution doesn't hold back the next scheduled ones. 0 means 1.
+	 */
+	int maxConcurrentExecutions;
 } BackgroundWorkerJob;
 
 /*
@@ -96,4 +108,7 @@ typedef struct
  */
 void RegisterBackgroundWorkerJob(BackgroundWorkerJob job);
 
+Size BackgroundWorkerShmemSize(void);
+void BackgroundWorkerShmemInit(void);
+
 #endif /* DOCUMENTS_BACKGROUND_WORKER_JOB_H */
@@ -0,0 +1,29 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/commands/columnar_projection.h
+ *
+ * Exports related to the columnar projection store of a collection. The
+ * store is a side table ("columns_<collectionId>") that holds, for every
+ * document, just the paths designated with collMod's columnarPaths, and
+ * that is kept in sync with the collection by a trigger on its data table.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOCUMENTDB_COLUMNAR_PROJECTION_H
+#define DOCUMENTDB_COLUMNAR_PROJECTION_H
+
+#include <postgres.h>
+#include <nodes/pg_list.h>
+
+#include "io/bson_core.h"
+#include "metadata/collection.h"
+#include "utils/string_view.h"
+
+List * ParseColumnarProjectionPaths(bson_iter_t *iter, const char *fieldName);
+void SetCollectionColumnarProjection(const MongoCollection *collection, List *paths);
+List * GetColumnarProjectionPaths(const MongoCollection *collection,
+								  Oid *storeRelationId);
+bool IsPathCoveredByColumnarProjection(const StringView *path, List *paths);
+
+#endif
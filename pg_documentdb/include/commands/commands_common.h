@@ -94,11 +94,14 @@ pgbson * RewriteDocumentWithCustomObjectId(pgbson *document,
 
 void ValidateIdField(const bson_value_t *idValue);
 void SetExplicitStatementTimeout(int timeoutMilliseconds);
+void SetWriteConcernDurability(const bson_value_t *writeConcern);
 
 void CommitWriteProcedureAndReacquireCollectionLock(MongoCollection *collection,
 													Oid shardTableOid,
 													bool setSnapshot);
 
+void UpdatePostgresIndex(uint64_t collectionId, int indexId, bool hidden);
+
 extern bool SimulateRecoveryState;
 extern bool DocumentDBPGReadOnlyForDiskFull;
 
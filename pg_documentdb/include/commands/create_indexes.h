@@ -160,6 +160,15 @@ typedef struct
 	/* The term in the document for specifying language overrides */
 	char *languageOverride;
 
+	/*
+	 * ICU collation string of the "collation" field, NULL when unspecified
+	 * or for the simple (binary) collation.
+	 */
+	char *collationString;
+
+	/* raw document hold by "collation" field */
+	pgbson *collationDocument;
+
 	/* Optional weights document */
 	pgbson *weightsDocument;
 
@@ -24,10 +24,12 @@ bool CreateAndDrainPersistedQuery(const char *cursorName, Query *query,
 								  pgbson_array_writer *arrayWriter, bool isHoldCursor,
 								  bool closeCursor);
 void CreateAndDrainSingleBatchQuery(const char *cursorName, Query *query,
-									int batchSize, int32_t *numIterations, uint32_t
+									int batchSize, int maxParallelWorkers,
+									int32_t *numIterations, uint32_t
 									accumulatedSize, pgbson_array_writer *arrayWriter);
 bytea * CreateAndDrainPersistedQueryWithFiles(const char *cursorName, Query *query,
-											  int batchSize, int32_t *numIterations,
+											  int batchSize, int maxParallelWorkers,
+											  int32_t *numIterations,
 											  uint32_t
 											  accumulatedSize,
 											  pgbson_array_writer *arrayWriter, bool
@@ -44,6 +46,9 @@ void CreateAndDrainPointReadQuery(const char *cursorName, Query *query,
 								  int32_t *numIterations, uint32_t
 								  accumulatedSize,
 								  pgbson_array_writer *arrayWriter);
+bool TryDrainDirectPointRead(Oid relationId, int64 shardKeyValue, List *objectIds,
+							 uint32_t accumulatedSize,
+							 pgbson_array_writer *arrayWriter);
 
 TupleDesc ConstructCursorResultTupleDesc(AttrNumber maxAttrNum);
 
@@ -59,6 +64,7 @@ HTAB * CreateTailableCursorHashSet(void);
 void BuildContinuationMap(pgbson *continuationValue, HTAB *cursorMap);
 void BuildTailableCursorContinuationMap(pgbson *continuationValue, HTAB *cursorMap);
 void SerializeContinuationsToWriter(pgbson_writer *writer, HTAB *cursorMap);
+void SerializeCompactContinuationsToWriter(pgbson_writer *writer, HTAB *cursorMap);
 void SerializeTailableContinuationsToWriter(pgbson_writer *writer, HTAB *cursorMap);
 
 pgbson * DrainSingleResultQuery(Query *query);
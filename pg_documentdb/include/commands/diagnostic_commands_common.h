@@ -12,13 +12,28 @@
 #ifndef DIAGNOSTIC_COMMANDS_COMMON_H
 #define DIAGNOSTIC_COMMANDS_COMMON_H
 
+/*
+ * Receives a worker result of RunQueryOnAllServerNodesStreaming, which the
+ * callback owns from then on.
+ */
+typedef void (*WorkerResultCallback)(pgbson *workerResult, void *state);
+
 List * RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types, int
 								numValues, PGFunction directFunc,
 								const char *nameSpaceName, const char *functionName);
+void RunQueryOnAllServerNodesStreaming(const char *commandName, Datum *values,
+									   Oid *types, int numValues, PGFunction directFunc,
+									   const char *nameSpaceName,
+									   const char *functionName,
+									   WorkerResultCallback callback,
+									   void *callbackState);
 
 
 pgbson * RunWorkerDiagnosticLogic(pgbson *(*workerFunc)(void *state), void *state);
 
+pgbson * GetCachedDiagnosticResponse(const char *cacheKey);
+void AddDiagnosticResponseToCache(const char *cacheKey, const pgbson *response);
+
 
 /* Common keys (for parsing error messages and codes from worker to coordinator)
  * Note that these are #defines instead of consts since the C compiler complains
@@ -22,4 +22,8 @@ bool InsertOrReplaceDocument(uint64 collectionId, const char *shardTableName, in
 							 shardKeyValue,
 							 pgbson *objectId, pgbson *document,
 							 const bson_value_t *updateSpecValue);
+
+bool InsertDocumentIfNotExists(uint64 collectionId, const char *shardTableName,
+							   int64 shardKeyValue, pgbson *objectId,
+							   pgbson *document);
 #endif
@@ -0,0 +1,57 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/commands/timeseries.h
+ *
+ * Exports related to time-series collections. A time-series collection is
+ * a view over a buckets collection ("system.buckets.<name>") that stores
+ * the measurements grouped by their metaField and time window; the view
+ * unpacks the buckets with the $_internalUnpackBucket stage.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef DOCUMENTDB_TIMESERIES_H
+#define DOCUMENTDB_TIMESERIES_H
+
+#include <postgres.h>
+
+#include "io/bson_core.h"
+#include "metadata/collection.h"
+
+#define TIMESERIES_BUCKETS_PREFIX "system.buckets."
+#define TIMESERIES_BUCKETS_PREFIX_LENGTH 15
+
+/* The fields of a bucket document */
+#define TIMESERIES_BUCKET_META_FIELD "meta"
+#define TIMESERIES_BUCKET_CONTROL_FIELD "control"
+#define TIMESERIES_BUCKET_DATA_FIELD "data"
+
+/* The most measurements a single bucket holds */
+#define TIMESERIES_BUCKET_MAX_COUNT 1000
+
+/*
+ * The options of a time-series collection, also the spec of the
+ * $_internalUnpackBucket stage of its view.
+ */
+typedef struct TimeseriesOptions
+{
+	/* The field holding the time of the measurements */
+	const char *timeField;
+
+	/* The field holding the metadata of the measurements, NULL if none */
+	const char *metaField;
+
+	/* The width of the time window covered by a bucket */
+	int64 bucketMaxSpanSeconds;
+} TimeseriesOptions;
+
+void ParseTimeseriesOptions(const bson_value_t *optionsValue, const char *fieldPrefix,
+							bool isCreateSpec, TimeseriesOptions *options);
+bson_value_t CreateTimeseriesViewPipeline(const TimeseriesOptions *options);
+bool TryGetTimeseriesOptions(const MongoCollection *collection,
+							 TimeseriesOptions *options);
+uint64 InsertTimeseriesMeasurements(MongoCollection *bucketsCollection,
+									const TimeseriesOptions *options,
+									List *measurements);
+
+#endif
@@ -17,4 +17,10 @@ void InitializeBackgroundJobConfigurations(const char *prefix, const char *newGu
 void InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix);
 
 void InitDocumentDBBackgroundWorkerConfigurations(const char *prefix);
+
+extern uint64 ConfigGeneration;
+void BumpConfigGenerationBool(bool newValue, void *extra);
+void BumpConfigGenerationInt(int newValue, void *extra);
+void BumpConfigGenerationReal(double newValue, void *extra);
+void BumpConfigGenerationString(const char *newValue, void *extra);
 #endif
@@ -24,6 +24,8 @@ void AddExtensionQueryScanForVectorQuery(PlannerInfo *root, RelOptInfo *rel,
 										 RangeTblEntry *rte,
 										 const SearchQueryEvalData *searchQueryData);
 
+void AddExtensionQueryScanForAdaptiveScan(PlannerInfo *root, RelOptInfo *rel,
+										  RangeTblEntry *rte);
 
 void AddExplainCustomScanWrapper(PlannerInfo *root, RelOptInfo *rel,
 								 RangeTblEntry *rte);
@@ -108,6 +108,10 @@ typedef struct DollarCenterOperatorState
 	/* Input radius, in radians for $centerSphere and in 2d units for $center */
 	double radius;
 
+	/* The center of the circle, in 2d units, for $center */
+	double centerX;
+	double centerY;
+
 	/* Radius converted to meters */
 	double radiusInMeters;
 
@@ -118,6 +122,20 @@ typedef struct DollarCenterOperatorState
 	bool isRadiusInfinite;
 }DollarCenterOperatorState;
 
+/*
+ * Operator state for the $box operator.
+ */
+typedef struct DollarBoxOperatorState
+{
+	ShapeOperatorState opState;
+
+	/* Bounds of the box in 2d units */
+	double xMin;
+	double yMin;
+	double xMax;
+	double yMax;
+} DollarBoxOperatorState;
+
 const ShapeOperator * GetShapeOperatorByValue(const bson_value_t *shapeValue,
 											  bson_value_t *shapePointsOut);
 
@@ -0,0 +1,21 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/infrastructure/collection_join_stats.h
+ *
+ * Declarations for the shared memory counts of the collections joined by
+ * $lookup, $graphLookup and $unionWith.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DOCUMENTDB_COLLECTION_JOIN_STATS_H
+#define DOCUMENTDB_COLLECTION_JOIN_STATS_H
+#include <postgres.h>
+
+Size CollectionJoinStatsShmemSize(void);
+void InitializeCollectionJoinStatsShmem(void);
+
+void RecordCollectionJoin(uint64 sourceCollectionId, uint64 targetCollectionId);
+
+#endif
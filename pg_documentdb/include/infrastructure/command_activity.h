@@ -0,0 +1,54 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/infrastructure/command_activity.h
+ *
+ * Declarations for the shared memory registry of the commands running
+ * in each backend.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DOCUMENTDB_COMMAND_ACTIVITY_H
+#define DOCUMENTDB_COMMAND_ACTIVITY_H
+#include <postgres.h>
+#include <datatype/timestamp.h>
+
+#include "io/bson_core.h"
+#include "metadata/collection.h"
+
+#define MAX_COMMAND_ACTIVITY_NAME_LENGTH 32
+
+/*
+ * The command that a backend last published, along with the start of the
+ * statement it was published in.
+ */
+typedef struct CommandActivity
+{
+	/* The pid of the backend, 0 if it never published a command */
+	int pid;
+
+	/* The statement start time, matches query_start of pg_stat_activity */
+	TimestampTz statementStartTime;
+
+	/* The name of the command, e.g. "find" */
+	char commandName[MAX_COMMAND_ACTIVITY_NAME_LENGTH];
+
+	/* The currentOp "op" of the command, e.g. "query" */
+	char opType[MAX_COMMAND_ACTIVITY_NAME_LENGTH];
+
+	char databaseName[MAX_DATABASE_NAME_LENGTH];
+
+	/* The collection the command targets, empty if there is none */
+	char collectionName[MAX_COLLECTION_NAME_LENGTH];
+} CommandActivity;
+
+Size CommandActivityShmemSize(void);
+void InitializeCommandActivityShmem(void);
+
+void ReportCommandActivity(const char *commandName, const char *opType,
+						   text *databaseName, pgbson *commandSpec);
+CommandActivity * GetCommandActivitySnapshot(int *activityCount);
+const CommandActivity * GetCurrentCommandActivity(void);
+
+#endif
@@ -47,6 +47,11 @@
 #define QUERY_ID_RETRY_RECORD_SELECT (22L << 32)
 
 #define QUERY_ID_INSERT_OR_REPLACE (23L << 32)
+#define QUERY_ID_INSERT_IF_NOT_EXISTS (24L << 32)
+
+/* Catalog lookups of collection metadata (with a collectionId of 0) */
+#define QUERY_ID_COLLECTION_BY_ID (25L << 32)
+#define QUERY_ID_COLLECTION_BY_NAME (26L << 32)
 
 #define QUERY_DELETE_WITH_FILTER_LET_AND_COLLATION (30L << 32)
 #define QUERY_DELETE_WITH_FILTER_SHARDKEY_LET_AND_COLLATION (31L << 32)
@@ -87,12 +92,37 @@
 	QUERY_UPDATE_MANY_WITH_QUERY_FILTER_OPERATOR + \
 	QUERY_UPDATE_MANY_SHARD_KEY_OBJECT_ID_QUERY_OFFSET
 
+/* Delete queries for a batch of _id values */
+#define QUERY_DELETE_WITH_SHARDKEY_ID_ARRAY (48L << 32)
+
+/* The largest number of sort fields a sorted query variant can encode */
+#define QUERY_SORT_VARIANT_MAX_FIELDS 16
+
+/*
+ * Builds the ID of the variant of baseQueryId that adds an ORDER BY on
+ * sortFieldCount fields: The low bits hold the number of sort fields, a bit
+ * for each ascending field and any caller specific bits (up to 7) for the
+ * shape of the sort expressions.
+ */
+static inline uint64
+GetSortedQueryVariantId(uint64 baseQueryId, int sortFieldCount, uint32 ascendingMask,
+						uint32 sortShape)
+{
+	return baseQueryId | ((uint64) (sortShape & 0x7F) << 24) |
+		   ((uint64) (sortFieldCount & 0xFF) << 16) | (ascendingMask & 0xFFFF);
+}
+
 
 /* GUC that controls the query plan cache size */
 extern int QueryPlanCacheSizeLimit;
 
+/* GUC that controls the number of queries kept in the shared registry */
+extern int SharedQueryPlanTemplateCount;
+
 
 void InitializeQueryPlanCache(void);
+Size QueryPlanCacheShmemSize(void);
+void InitializeQueryPlanCacheShmem(void);
 SPIPlanPtr GetSPIQueryPlan(uint64 collectionId, uint64 queryId,
 						   const char *query, Oid *argTypes, int argCount);
 
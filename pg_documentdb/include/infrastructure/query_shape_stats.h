@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/infrastructure/query_shape_stats.h
+ *
+ * Declarations for the shared memory statistics of the queries that
+ * commands run, grouped by query shape and namespace.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DOCUMENTDB_QUERY_SHAPE_STATS_H
+#define DOCUMENTDB_QUERY_SHAPE_STATS_H
+#include <postgres.h>
+
+#include "io/bson_core.h"
+#include "infrastructure/command_activity.h"
+
+extern bool EnableQueryShapeStats;
+
+Size QueryShapeStatsShmemSize(void);
+void InitializeQueryShapeStatsShmem(void);
+
+void ReportQueryShape(const CommandActivity *activity, pgbson *commandSpec);
+void RecordQueryShapeExecution(const CommandActivity *activity, int64 executionMicros,
+							   int64 docsExamined, int64 docsReturned, Oid indexId);
+
+#endif
@@ -0,0 +1,22 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/infrastructure/slow_operation_log.h
+ *
+ * Declarations for the shared memory log of the queries of slow and
+ * sampled commands.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DOCUMENTDB_SLOW_OPERATION_LOG_H
+#define DOCUMENTDB_SLOW_OPERATION_LOG_H
+#include <postgres.h>
+
+Size SlowOperationLogShmemSize(void);
+void InitializeSlowOperationLogShmem(void);
+
+void InstallSlowOperationLogHooks(void);
+void UninstallSlowOperationLogHooks(void);
+
+#endif
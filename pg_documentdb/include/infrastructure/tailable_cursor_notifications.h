@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/infrastructure/tailable_cursor_notifications.h
+ *
+ * Declarations for the notifications of committed writes to the getMore of
+ * tailable cursors that await data.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DOCUMENTDB_TAILABLE_CURSOR_NOTIFICATIONS_H
+#define DOCUMENTDB_TAILABLE_CURSOR_NOTIFICATIONS_H
+#include <postgres.h>
+
+extern bool EnableTailableCursorAwaitData;
+
+Size TailableCursorNotificationsShmemSize(void);
+void InitializeTailableCursorNotificationsShmem(void);
+
+void NotifyCollectionWriteOnCommit(uint64 collectionId);
+void ProcessPendingCollectionWriteNotifications(bool isCommit);
+
+uint64 GetCollectionWriteGeneration(uint64 collectionId);
+bool WaitForCollectionWrite(uint64 collectionId, uint64 writeGeneration,
+							long timeoutMs);
+
+#endif
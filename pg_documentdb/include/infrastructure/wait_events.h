@@ -0,0 +1,73 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/infrastructure/wait_events.h
+ *
+ * Declarations for the wait events that the phases of the extension report
+ * in pg_stat_activity, so that sampling attributes their time.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef DOCUMENTDB_WAIT_EVENTS_H
+#define DOCUMENTDB_WAIT_EVENTS_H
+#include <postgres.h>
+#include <utils/wait_event.h>
+
+typedef enum DocumentDBWaitEvent
+{
+	DocumentDBWaitEvent_QueryGeneration = 0,
+	DocumentDBWaitEvent_CursorFileRead,
+	DocumentDBWaitEvent_CursorFileWrite,
+	DocumentDBWaitEvent_IndexTermExtraction,
+	DocumentDBWaitEvent_SchemaValidation,
+	DocumentDBWaitEvent_WorkerCall,
+	DocumentDBWaitEvent_TailableCursorAwait,
+
+	DocumentDBWaitEvent_Max
+} DocumentDBWaitEvent;
+
+extern bool EnableCustomWaitEvents;
+
+uint32 GetDocumentDBWaitEventInfo(DocumentDBWaitEvent waitEvent);
+
+
+/*
+ * Reports that the backend entered the phase of the wait event, and returns
+ * the wait event it reported before (to restore with ReportDocumentDBWaitEnd)
+ * so that the phases can nest, e.g. a worker call that validates the schema.
+ */
+static inline uint32
+ReportDocumentDBWaitStart(DocumentDBWaitEvent waitEvent)
+{
+	if (!EnableCustomWaitEvents)
+	{
+		return 0;
+	}
+
+	uint32 previousWaitEventInfo = *my_wait_event_info;
+	pgstat_report_wait_start(GetDocumentDBWaitEventInfo(waitEvent));
+	return previousWaitEventInfo;
+}
+
+
+static inline void
+ReportDocumentDBWaitEnd(uint32 previousWaitEventInfo)
+{
+	if (!EnableCustomWaitEvents)
+	{
+		return;
+	}
+
+	if (previousWaitEventInfo != 0)
+	{
+		pgstat_report_wait_start(previousWaitEventInfo);
+	}
+	else
+	{
+		pgstat_report_wait_end();
+	}
+}
+
+
+#endif
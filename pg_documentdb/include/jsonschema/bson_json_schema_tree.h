@@ -124,6 +124,21 @@ typedef enum SchemaNodeType
 } SchemaNodeType;
 
 
+/*
+ * A field named by "properties" or "required" of an object node, in the
+ * sorted lookup array of the node.
+ */
+typedef struct SchemaObjectField
+{
+	StringView field;
+
+	/* The field node under "properties" (or NULL if only required) */
+	SchemaFieldNode *fieldNode;
+
+	/* The position of the field in "required" (or -1 if not required) */
+	int requiredIndex;
+} SchemaObjectField;
+
 typedef struct ValidationsObject
 {
 	/* List of child field nodes */
@@ -131,6 +146,16 @@ typedef struct ValidationsObject
 
 	/* Array of required field names */
 	bson_value_t *required;
+
+	/* Number of required field names */
+	int requiredCount;
+
+	/*
+	 * The fields of properties and required sorted by name, so that each field
+	 * of a document is looked up once with a binary search.
+	 */
+	SchemaObjectField *sortedFields;
+	int sortedFieldCount;
 } ValidationsObject;
 
 typedef struct ValidationsCommon
@@ -231,5 +256,7 @@ typedef struct SchemaTreeState
 void BuildSchemaTree(SchemaTreeState *treeState, bson_iter_t *schemaIter);
 SchemaFieldNode * FindFieldNodeByName(const SchemaNode *parent, const
 									  char *field);
+const SchemaObjectField * FindObjectFieldByName(const SchemaNode *node,
+												const StringView *field);
 
 #endif
@@ -237,6 +237,13 @@ char * ParseAndGetValidationLevelOption(bson_iter_t *iter, const
 										char *validationLevelName, bool *hasValue);
 char * ParseAndGetValidationActionOption(bson_iter_t *iter, const
 										 char *validationActionName, bool *hasValue);
+char * ParseAndGetDocumentCompressionOption(bson_iter_t *iter, const
+											char *compressionName);
+void SetCollectionDocumentCompression(const MongoCollection *collection,
+									  const char *compression);
+void ParseClusteredIndexOption(bson_iter_t *iter, const char *clusteredIndexName);
+void SetCollectionClustered(const MongoCollection *collection);
+bool IsClusteredCollection(uint64 collectionId);
 void UpdateMongoCollectionUsingIds(MongoCollection *mongoCollection, uint64 collectionId,
 								   Oid shardOid);
 
@@ -47,6 +47,7 @@ extern MemoryContext DocumentDBApiMetadataCacheContext;
 
 /* functions related with pg_documentdb "extension" itself */
 void InitializeDocumentDBApiExtensionCache(void);
+void PrewarmDocumentDBApiExtensionCache(void);
 void InvalidateCollectionsCache(void);
 bool IsDocumentDBApiExtensionActive(void);
 Oid DocumentDBApiExtensionOwner(void);
@@ -231,6 +232,7 @@ Oid Float8PlusOperatorId(void);
 Oid Float8MinusOperatorId(void);
 Oid Float8MultiplyOperatorId(void);
 Oid BsonRumHashPathOperatorFamily(void);
+Oid BsonHashPathOperatorFamily(void);
 Oid BsonRumUniquePathOperatorFamily(void);
 
 /* Vector Functions */
@@ -391,6 +393,16 @@ Oid BsonLastNAggregateAllArgsFunctionOid(void);
 Oid BsonLastNOnSortedAggregateFunctionOid(void);
 Oid BsonLastNOnSortedAggregateAllArgsFunctionOid(void);
 Oid BsonAddToSetAggregateFunctionOid(void);
+Oid BsonAddToSetParallelAggregateFunctionOid(void);
+Oid BsonArrayParallelAggregateFunctionOid(void);
+Oid BsonFirstParallelAggregateFunctionOid(void);
+Oid BsonLastParallelAggregateFunctionOid(void);
+Oid BsonFirstNParallelAggregateFunctionOid(void);
+Oid BsonLastNParallelAggregateFunctionOid(void);
+Oid BsonCountAggregateFunctionOid(void);
+Oid BsonApproxCountDistinctAggregateFunctionOid(void);
+Oid BsonExactPercentileAggregateFunctionOid(void);
+Oid BsonExactMedianAggregateFunctionOid(void);
 Oid BsonStdDevPopAggregateFunctionOid(void);
 Oid BsonStdDevSampAggregateFunctionOid(void);
 Oid PostgresAnyValueFunctionOid(void);
@@ -402,12 +414,16 @@ Oid BsonLookupExtractFilterArrayFunctionOid(void);
 Oid BsonLookupUnwindFunctionOid(void);
 Oid BsonDistinctUnwindFunctionOid(void);
 Oid BsonDollarBucketAutoFunctionOid(void);
+Oid BsonDollarGraphLookupTraverseFunctionOid(void);
+Oid BsonDollarBucketAutoBoundariesAggregateOid(void);
+Oid BsonDollarBucketAutoAssignFunctionOid(void);
 Oid BsonDistinctAggregateFunctionOid(void);
 Oid RowGetBsonFunctionOid(void);
 Oid ApiChangeStreamAggregationFunctionOid(void);
 Oid ApiCollStatsAggregationFunctionOid(void);
 Oid ApiIndexStatsAggregationFunctionOid(void);
 Oid BsonCurrentOpAggregationFunctionId(void);
+Oid QueryShapeStatsFunctionId(void);
 Oid BsonMaxNAggregateFunctionOid(void);
 Oid BsonMinNAggregateFunctionOid(void);
 Oid BsonMedianAggregateFunctionOid(void);
@@ -426,6 +442,8 @@ Oid BsonDocumentNumberFunctionOid(void);
 Oid BsonDensifyRangeWindowFunctionOid(void);
 Oid BsonDensifyPartitionWindowFunctionOid(void);
 Oid BsonDensifyFullWindowFunctionOid(void);
+Oid BsonDensifyUnwindFunctionOid(void);
+Oid BsonTimeseriesUnpackBucketFunctionOid(void);
 
 
 /* Catalog */
@@ -13,5 +13,7 @@
 #define RELATION_UTILS_H
 
 Datum SequenceGetNextValAsUser(Oid sequenceId, Oid userId);
+bool TryGetAttributeCorrelation(Oid relationId, AttrNumber attributeNumber,
+								double *correlation);
 
 #endif
@@ -83,7 +83,9 @@ typedef struct
 	bool isWildcard;
 	bool generateNotFoundTerm;
 	bool useReducedWildcardTerms;
+	bool hashTruncatedTerms;
 	int path;
+	int collation;
 } BsonGinSinglePathOptions;
 
 /*
@@ -100,6 +102,7 @@ typedef struct
 	BsonGinIndexOptionsBase base;
 	bool isExclusion;
 	bool includeId;
+	bool useCompactPaths;
 	int pathSpec;
 } BsonGinWildcardProjectionPathOptions;
 
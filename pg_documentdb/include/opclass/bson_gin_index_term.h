@@ -79,6 +79,27 @@ typedef struct IndexTermCreateMetadata
 
 	/* Whether or not the term is for a descending index */
 	bool isDescending;
+
+	/*
+	 * The included paths of a wildcard projection index whose terms store the
+	 * ordinal of the included path in place of the path prefix (see SerializeTermToWriter).
+	 */
+	const char *compactPathSpec;
+
+	/* The number of paths in compactPathSpec (0 if terms store the full path) */
+	uint32_t compactPathCount;
+
+	/*
+	 * Whether truncated terms are accompanied by a term with the hash of the full
+	 * value (see GenerateTruncatedValueHashTerm).
+	 */
+	bool hashTruncatedTerms;
+
+	/*
+	 * The ICU collation string of collated indexes: Their string terms store the
+	 * collation sort key of the value instead of the value (NULL otherwise).
+	 */
+	const char *collationString;
 } IndexTermCreateMetadata;
 
 
@@ -135,6 +156,8 @@ Datum GenerateRootTruncatedTerm(const IndexTermCreateMetadata *);
 Datum GenerateRootMultiKeyTerm(const IndexTermCreateMetadata *);
 Datum GenerateValueUndefinedTerm(const IndexTermCreateMetadata *termData);
 Datum GenerateValueMaybeUndefinedTerm(const IndexTermCreateMetadata *termData);
+Datum GenerateTruncatedValueHashTerm(const pgbsonelement *indexElement,
+									 const IndexTermCreateMetadata *termData);
 int32_t CompareBsonIndexTerm(const BsonIndexTerm *left, const BsonIndexTerm *right,
 							 bool *isComparisonValid);
 
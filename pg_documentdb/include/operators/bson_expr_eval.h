@@ -55,6 +55,13 @@ typedef struct ExprEvalState
 	 * This array can be reused across executions of the expression.
 	 */
 	Datum *datums;
+
+	/*
+	 * Optional: The expression compiled into a linear predicate program that is
+	 * evaluated directly against bson inputs, skipping the expression above for
+	 * the documents it supports.
+	 */
+	struct CompiledPredicateProgram *compiledProgram;
 }ExprEvalState;
 
 ExprEvalState * GetExpressionEvalState(const bson_value_t *expression,
@@ -80,6 +87,9 @@ bool EvalBooleanExpressionAgainstValue(ExprEvalState *evalState,
 									   bool shouldRecurseIfArray);
 bool EvalBooleanExpressionAgainstBson(ExprEvalState *evalState,
 									  const bson_value_t *queryValue);
+void EvalBooleanExpressionAgainstBsonBatch(ExprEvalState *evalState,
+										   const bson_value_t *documents,
+										   int numDocuments, bool *matches);
 
 bson_value_t EvalExpressionAgainstArrayGetFirstMatch(ExprEvalState *evalState,
 													 const bson_value_t *queryValue);
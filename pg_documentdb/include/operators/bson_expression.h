@@ -58,6 +58,12 @@ typedef struct ExpressionVariableContext
 
 	/* the expression's parent to be  able to traverse if the variable is not found in the current context. */
 	const struct ExpressionVariableContext *parent;
+
+	/*
+	 * Optional: A field directory over the document being evaluated. Used to resolve
+	 * field path expressions against $$CURRENT / $$ROOT without re-walking the document.
+	 */
+	PgbsonFieldDirectory *documentDirectory;
 } ExpressionVariableContext;
 
 /* Func that will handle evaluating a given operator on a document. */
@@ -221,6 +227,15 @@ typedef struct ParseAggregationExpressionContext
 
 	/* collationString to be used by comparison operators */
 	const char *collationString;
+
+	/* Whether operator expressions repeated across the fields of a projection are evaluated once per document. */
+	bool shareRepeatedExpressions;
+
+	/* The operator expressions parsed for the fields so far (when shareRepeatedExpressions is set). */
+	List *sharedExpressions;
+
+	/* The generation of the shared expressions (if any are shared), which the projection advances per document. */
+	uint64 *sharedExpressionGeneration;
 } ParseAggregationExpressionContext;
 
 
@@ -234,12 +249,19 @@ void EvaluateAggregationExpressionDataToWriter(const
 void ParseAggregationExpressionData(AggregationExpressionData *expressionData,
 									const bson_value_t *value,
 									ParseAggregationExpressionContext *context);
+void ParseSharedAggregationExpressionData(AggregationExpressionData *expressionData,
+										  const bson_value_t *value,
+										  ParseAggregationExpressionContext *context);
+bool BeginExpressionEvaluationArena(void);
+void EndExpressionEvaluationArena(bool openedArena);
+void ResetExpressionEvaluationArena(void);
 void ParseVariableSpec(const bson_value_t *variableSpec,
 					   ExpressionVariableContext *variableContext,
 					   ParseAggregationExpressionContext *parseContext);
 void VariableContextSetVariableData(ExpressionVariableContext *variableContext, const
 									VariableData *variableData);
 void ValidateVariableName(StringView name);
+bool IsAggregationExpressionNonDeterministic(const bson_value_t *value);
 
 void GetTimeSystemVariablesFromVariableSpec(const pgbson *variableSpec,
 											TimeSystemVariables *timeSystemVariables);
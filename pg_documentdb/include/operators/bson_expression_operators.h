@@ -145,6 +145,9 @@ typedef struct ExtensionTimezone
 		/* The timezone ID if isUtcOffset == false. */
 		const char *id;
 	};
+
+	/* The resolved timezone for the timezone ID (set by ParseTimezone) */
+	const struct pg_tz *pgTimezone;
 } ExtensionTimezone;
 
 /* Type to specify the case for date and timestamp types for
@@ -25,6 +25,8 @@ extern planner_hook_type ExtensionPreviousPlannerHook;
 extern set_rel_pathlist_hook_type ExtensionPreviousSetRelPathlistHook;
 extern explain_get_index_name_hook_type ExtensionPreviousIndexNameHook;
 extern get_relation_info_hook_type ExtensionPreviousGetRelationInfoHook;
+extern create_upper_paths_hook_type ExtensionPreviousCreateUpperPathsHook;
+extern set_join_pathlist_hook_type ExtensionPreviousSetJoinPathlistHook;
 extern bool SimulateRecoveryState;
 extern bool DocumentDBPGReadOnlyForDiskFull;
 
@@ -36,6 +38,12 @@ void ExtensionRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 							  RangeTblEntry *rte);
 void ExtensionGetRelationInfoHook(PlannerInfo *root, Oid relationObjectId,
 								  bool inhparent, RelOptInfo *rel);
+void ExtensionCreateUpperPathsHook(PlannerInfo *root, UpperRelationKind stage,
+								   RelOptInfo *inputRel, RelOptInfo *outputRel,
+								   void *extra);
+void ExtensionSetJoinPathlistHook(PlannerInfo *root, RelOptInfo *joinrel,
+								  RelOptInfo *outerrel, RelOptInfo *innerrel,
+								  JoinType jointype, JoinPathExtraData *extra);
 bool IsDocumentDbCollectionBasedRTE(RangeTblEntry *rte);
 bool IsResolvableDocumentDbCollectionBasedRTE(RangeTblEntry *rte,
 											  ParamListInfo boundParams);
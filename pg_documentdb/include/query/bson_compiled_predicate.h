@@ -0,0 +1,27 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/query/bson_compiled_predicate.h
+ *
+ * Declarations of the linear programs compiled from query filters.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BSON_COMPILED_PREDICATE_H
+#define BSON_COMPILED_PREDICATE_H
+
+#include "io/bson_core.h"
+
+typedef struct CompiledPredicateProgram CompiledPredicateProgram;
+
+CompiledPredicateProgram * TryCompileQueryPredicateProgram(const bson_value_t *filter);
+bool EvaluateCompiledPredicateProgram(CompiledPredicateProgram *program,
+									  const bson_value_t *document, bool *isMatch);
+void EvaluateCompiledPredicateProgramBatch(CompiledPredicateProgram *program,
+										   const bson_value_t *documents,
+										   int numDocuments, bool *isMatch,
+										   bool *isEvaluated);
+void FreeCompiledPredicateProgram(CompiledPredicateProgram *program);
+
+#endif
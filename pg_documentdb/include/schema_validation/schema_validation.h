@@ -25,6 +25,9 @@ void AssignSchemaValidationState(ExprEvalState *state, pgbson *schemaValidationI
 								 MemoryContext memoryContext);
 void ValidateSchemaOnDocumentInsert(ExprEvalState *evalState, const
 									bson_value_t *document, const char *errMsg);
+void ValidateSchemaOnDocumentsInsert(ExprEvalState *evalState,
+									 const bson_value_t *documents, int numDocuments,
+									 const char *errMsg);
 
 void ValidateSchemaOnDocumentUpdate(ValidationLevels validationLevelText,
 									ExprEvalState *evalState,
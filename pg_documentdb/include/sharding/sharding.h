@@ -13,8 +13,17 @@
 
 #include "metadata/collection.h"
 
+/* A shard key definition with its paths pre-split, see CompileShardKey */
+typedef struct CompiledShardKey CompiledShardKey;
+
 int64 ComputeShardKeyHashForDocument(pgbson *shardKey, uint64_t collectionId,
 									 pgbson *document);
+CompiledShardKey * CompileShardKey(pgbson *shardKey);
+int64 ComputeShardKeyHashForCompiledKey(CompiledShardKey *compiledKey,
+										uint64_t collectionId, pgbson *document);
+void ComputeShardKeyHashesForDocuments(pgbson *shardKey, uint64_t collectionId,
+									   pgbson **documents, int documentCount,
+									   int64 *shardKeyHashes);
 bool ComputeShardKeyHashForQuery(pgbson *shardKey, uint64_t collectionId, pgbson *query,
 								 int64 *shardKeyHash, bool *isShardKeyCollationAware);
 bool ComputeShardKeyHashForQueryValue(pgbson *shardKey, uint64_t collectionId, const
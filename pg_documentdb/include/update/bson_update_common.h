@@ -123,6 +123,16 @@ const struct BsonIntermediatePathNode * GetOperatorUpdateState(const
 															   const bson_value_t *
 															   arrayFilters,
 															   bool isUpsert);
+const struct BsonIntermediatePathNode * GetCachedOperatorUpdateState(const
+																	 bson_value_t *
+																	 updateSpec,
+																	 const
+																	 bson_value_t *
+																	 querySpec,
+																	 const
+																	 bson_value_t *
+																	 arrayFilters,
+																	 bool isUpsert);
 pgbson * ProcessUpdateOperatorWithState(pgbson *sourceDoc,
 										const struct BsonIntermediatePathNode *
 										updateState,
@@ -201,6 +201,8 @@ typedef enum
 	FEATURE_COMMAND_COMPACT,
 	FEATURE_COMMAND_COUNT,
 	FEATURE_COMMAND_CREATE_COLLECTION,
+	FEATURE_COMMAND_CREATE_TIMESERIES,
+	FEATURE_COMMAND_CREATE_CLUSTERED,
 	FEATURE_COMMAND_CREATE_VALIDATION,
 	FEATURE_COMMAND_CREATE_VIEW,
 	FEATURE_COMMAND_CURRENTOP,
@@ -219,6 +221,7 @@ typedef enum
 	FEATURE_COMMAND_INSERT_BULK,
 	FEATURE_COMMAND_LIST_COLLECTIONS_CURSOR_FIRST_PAGE,
 	FEATURE_COMMAND_LIST_INDEXES_CURSOR_FIRST_PAGE,
+	FEATURE_COMMAND_REFRESH_VIEW,
 	FEATURE_COMMAND_RESHARD_COLLECTION,
 	FEATURE_COMMAND_SHARD_COLLECTION,
 	FEATURE_COMMAND_UNSHARD_COLLECTION,
@@ -237,6 +240,8 @@ typedef enum
 	FEATURE_COMMAND_COLLMOD_VALIDATION,
 	FEATURE_COMMAND_COLLMOD_TTL_UPDATE,
 	FEATURE_COMMAND_COLLMOD_INDEX_HIDDEN,
+	FEATURE_COMMAND_COLLMOD_DOCUMENT_COMPRESSION,
+	FEATURE_COMMAND_COLLMOD_COLUMNAR_PATHS,
 
 	/* Feature Connection Status*/
 	FEATURE_CONNECTION_STATUS,
@@ -318,6 +323,7 @@ typedef enum
 	FEATURE_STAGE_GROUP_ACC_TOPN,
 	FEATURE_STAGE_INDEXSTATS,
 	FEATURE_STAGE_INTERNAL_INHIBIT_OPTIMIZATION,
+	FEATURE_STAGE_INTERNAL_UNPACK_BUCKET,
 	FEATURE_STAGE_INVERSEMATCH,
 	FEATURE_STAGE_LIMIT,
 	FEATURE_STAGE_LOOKUP,
@@ -326,6 +332,8 @@ typedef enum
 	FEATURE_STAGE_OUT,
 	FEATURE_STAGE_PROJECT,
 	FEATURE_STAGE_PROJECT_FIND,
+	FEATURE_STAGE_QUERY_STATS,
+	FEATURE_STAGE_RANK_FUSION,
 	FEATURE_STAGE_REDACT,
 	FEATURE_STAGE_REPLACE_ROOT,
 	FEATURE_STAGE_REPLACE_WITH,
@@ -361,6 +369,8 @@ typedef enum
 	/* Feature usage stats */
 	FEATURE_USAGE_TTL_PURGER_CALLS,
 	FEATURE_USAGE_INDEX_SCAN_WITH_LIMIT,
+	FEATURE_USAGE_QUERY_PLAN_CACHE_PREWARM,
+	FEATURE_USAGE_OR_BRANCH_SORT_MERGE,
 
 	/* Feature mapping region - User CRUD*/
 	FEATURE_USER_CREATE,
@@ -374,12 +384,50 @@ typedef enum
 
 typedef int FeatureCounter[MAX_FEATURE_COUNT];
 
+/*
+ * The commands whose latency is recorded in the command latency histograms.
+ */
+typedef enum CommandLatencyKind
+{
+	CommandLatencyKind_Insert = 0,
+	CommandLatencyKind_Update,
+	CommandLatencyKind_Delete,
+	CommandLatencyKind_FindAndModify,
+	CommandLatencyKind_Find,
+	CommandLatencyKind_Aggregate,
+	CommandLatencyKind_Count,
+	CommandLatencyKind_Distinct,
+	CommandLatencyKind_GetMore,
+
+	/* This value must appear at the end in the CommandLatencyKind definition. */
+	CommandLatencyKind_Max
+} CommandLatencyKind;
+
+/*
+ * Commands that take less than 2^(i + 7) microseconds are counted in bucket i,
+ * the last bucket counts all the slower ones.
+ */
+#define COMMAND_LATENCY_BUCKET_COUNT 16
+
+typedef struct CommandLatencyHistogram
+{
+	/* The number of commands of each kind in each latency bucket */
+	uint32 buckets[CommandLatencyKind_Max][COMMAND_LATENCY_BUCKET_COUNT];
+
+	/* The summed latency of the commands of each kind in microseconds */
+	uint64 totalMicros[CommandLatencyKind_Max];
+} CommandLatencyHistogram;
+
 extern Size SharedFeatureCounterShmemSize(void);
 extern void SharedFeatureCounterShmemInit(void);
 extern const char * GetFeatureCountersAsString(void);
 extern void ResetFeatureCounters(void);
 extern FeatureCounter *FeatureCounterBackendArray;
 
+extern Size CommandLatencyShmemSize(void);
+extern void CommandLatencyShmemInit(void);
+extern void ReportCommandLatency(CommandLatencyKind commandKind);
+
 /*
  *  Given a feature id this method increments the feature usage count for the
  *  feature for the current backend process.
@@ -398,4 +446,18 @@ ReportFeatureUsage(int featureId)
 }
 
 
+/*
+ *  Returns the feature usage counts of the current backend process.
+ */
+static inline const int *
+GetBackendFeatureCounters(void)
+{
+#if PG_VERSION_NUM >= 170000
+	return FeatureCounterBackendArray[MyProcNumber];
+#else
+	return FeatureCounterBackendArray[MyBackendId - 1];
+#endif
+}
+
+
 #endif /* FEATURE_COUNTER_H */
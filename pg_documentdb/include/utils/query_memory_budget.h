@@ -0,0 +1,23 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/utils/query_memory_budget.h
+ *
+ * Declarations for the memory budget shared by the stages and accumulators
+ * of a query.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+
+#ifndef QUERY_MEMORY_BUDGET_H
+#define QUERY_MEMORY_BUDGET_H
+
+void ReserveQueryMemory(MemoryContext context, int64 bytes, const char *consumerName);
+bool TryReserveQueryMemory(MemoryContext context, int64 bytes,
+						   const char *consumerName);
+
+void SetQueryMemoryAllowDiskUse(bool allowDiskUse);
+int64 GetQueryMemoryPeakBytes(void);
+
+#endif
@@ -100,6 +100,14 @@ char * ExtensionExecuteQueryOnLocalhostViaLibPQ(char *query);
 char * ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ(char *query, const Oid userOid,
 													  bool useSerialExecution);
 
+/*
+ * Same as ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ, but sets the given
+ * options on the connection.
+ */
+char * ExtensionExecuteQueryAsUserOnLocalhostWithOptionsViaLibPQ(char *query, const Oid
+																 userOid, const
+																 char *connectionOptions);
+
 /* Same as ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ, but it allows to execute parameterized query */
 char * ExtensionExecuteQueryWithArgsAsUserOnLocalhostViaLibPQ(char *query, const Oid
 															  userOid, int nParams,
@@ -52,6 +52,10 @@
 #define VECTOR_PARAMETER_NAME_ITERATIVE_SCAN "iterativeScan"
 #define VECTOR_PARAMETER_NAME_ITERATIVE_SCAN_STR_LEN 13
 
+/* Search parameter for the recall that the calibrated efSearch or nProbes must meet */
+#define VECTOR_PARAMETER_NAME_TARGET_RECALL "targetRecall"
+#define VECTOR_PARAMETER_NAME_TARGET_RECALL_STR_LEN 12
+
 /* dynamic calculation of nprobes or efSearch depending on collection size */
 #define VECTOR_SEARCH_SMALL_COLLECTION_ROWS 10000
 
@@ -79,6 +83,18 @@ extern bool EnableVectorPreFilterV2;
  */
 extern int VectorPreFilterIterativeScanMode;
 
+/*
+ * GUC for the largest estimated number of candidate rows for which vector
+ * search skips the vector index and ranks the candidates exactly.
+ */
+extern int VectorExactSearchMaxCandidateRows;
+
+/*
+ * GUC for the oversampling of vector searches on compressed indexes that
+ * do not specify one.
+ */
+extern double VectorSearchDefaultOversampling;
+
 /*
  * GUC to enable vector compression feature for vector search.
  */
@@ -0,0 +1,26 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/vector/vector_search_calibration.h
+ *
+ * Declarations for the calibration of the search parameters of vector
+ * indexes for a target recall.
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef VECTOR_SEARCH_CALIBRATION__H
+#define VECTOR_SEARCH_CALIBRATION__H
+
+#include <postgres.h>
+
+extern int VectorSearchCalibrationSampleSize;
+
+Size VectorSearchCalibrationShmemSize(void);
+void InitializeVectorSearchCalibrationShmem(void);
+
+bool TryGetCalibratedVectorSearchParameter(Oid indexOid, double targetRecall,
+										   const char **parameterName,
+										   uint32_t *parameterNameLength,
+										   int32_t *parameterValue);
+
+#endif
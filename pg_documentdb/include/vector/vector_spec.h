@@ -125,9 +125,12 @@ typedef struct VectorSearchOptions
 	/* The vector index definition */
 	const VectorIndexDefinition *vectorIndexDef;
 
-	/* Over sample rate */
+	/* Over sample rate (0 if not specified: see VectorSearchDefaultOversampling) */
 	double oversampling;
 
+	/* The recall that the search parameters must meet (0 if not specified) */
+	double targetRecall;
+
 	/* The compression type of the vector index */
 	VectorIndexCompressionType compressionType;
 
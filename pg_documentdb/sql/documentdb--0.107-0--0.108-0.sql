@@ -1,5 +1,27 @@
 #include "udfs/index_mgmt/create_index_background--0.108-0.sql"
 #include "udfs/rum/bson_rum_text_path_adapter_funcs--0.24-0.sql"
+#include "udfs/aggregation/group_aggregates_support--0.108-0.sql"
+#include "udfs/aggregation/group_aggregates--0.108-0.sql"
+#include "udfs/aggregation/bson_graph_lookup_functions--0.108-0.sql"
+#include "udfs/aggregation/bson_bucket_auto_approximate--0.108-0.sql"
+#include "udfs/aggregation/bson_densify_unwind--0.108-0.sql"
+#include "udfs/aggregation/bson_timeseries_unpack_bucket--0.108-0.sql"
+#include "udfs/schema_mgmt/refresh_materialized_view--0.108-0.sql"
+#include "udfs/metadata/prewarm_query_plan_cache--0.108-0.sql"
+#include "udfs/commands_crud/delete_expired_retry_records_background--0.108-0.sql"
+#include "udfs/telemetry/command_latency_stats--0.108-0.sql"
+#include "udfs/rum/bson_hash_path_ops_functions--0.108-0.sql"
+#include "schema/bson_hash_path_operator_class--0.108-0.sql"
+#include "udfs/commands_diagnostic/slow_operation_log--0.108-0.sql"
+#include "udfs/commands_diagnostic/collection_join_stats--0.108-0.sql"
+#include "udfs/commands_diagnostic/query_shape_stats--0.108-0.sql"
+#include "udfs/commands_diagnostic/background_worker_jobs--0.108-0.sql"
+#include "udfs/schema_mgmt/reshard_collection_online--0.108-0.sql"
+#include "udfs/schema_mgmt/maintain_columnar_projection--0.108-0.sql"
+#include "udfs/schema_mgmt/recluster_collections_background--0.108-0.sql"
+#include "udfs/vector/calibrate_vector_indexes_background--0.108-0.sql"
+#include "udfs/schema_mgmt/drop_deferred_relations_background--0.108-0.sql"
+#include "udfs/auth/auth_scram_secret--0.108-0.sql"
 
 GRANT UPDATE (indisvalid) ON pg_catalog.pg_index to __API_ADMIN_ROLE__;
 
@@ -0,0 +1,8 @@
+-- Native hash index for { "path": "hashed" } indexes: documents are hashed on the value at the
+-- indexed path (with the path options), $eq queries are hashed on their value as a bsonquery.
+CREATE OPERATOR CLASS __API_SCHEMA_INTERNAL_V2__.bson_hash_path_ops
+    FOR TYPE __CORE_SCHEMA__.bson USING hash AS
+        OPERATOR        1       __API_CATALOG_SCHEMA__.#= (__CORE_SCHEMA__.bson, __CORE_SCHEMA__.bsonquery),
+        FUNCTION        1       __API_SCHEMA_INTERNAL_V2__.bson_hash_path_value(__CORE_SCHEMA__.bson),
+        FUNCTION        1       __API_SCHEMA_INTERNAL_V2__.bson_hash_path_query(__CORE_SCHEMA__.bsonquery),
+        FUNCTION        3       (__CORE_SCHEMA__.bson) __API_SCHEMA_INTERNAL_V2__.gin_bson_hashed_options(internal);
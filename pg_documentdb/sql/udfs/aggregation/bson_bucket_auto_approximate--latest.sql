@@ -0,0 +1,29 @@
+/*
+ * Support functions for the approximate boundaries of $bucketAuto: The boundaries are
+ * computed from a reservoir sample of the groupBy values and documents are then
+ * assigned to a bucket by a search over the boundaries.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_dollar_bucket_auto_boundaries_transition(internal, __CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+ RETURNS internal
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_dollar_bucket_auto_boundaries_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_dollar_bucket_auto_boundaries_final(internal)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_dollar_bucket_auto_boundaries_final$function$;
+
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.bson_dollar_bucket_auto_boundaries(__CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_SCHEMA_INTERNAL_V2__.bson_dollar_bucket_auto_boundaries_transition,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_dollar_bucket_auto_boundaries_final,
+    stype = internal
+);
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_dollar_bucket_auto_assign(value __CORE_SCHEMA__.bson, boundaries __CORE_SCHEMA__.bson)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_dollar_bucket_auto_assign$function$;
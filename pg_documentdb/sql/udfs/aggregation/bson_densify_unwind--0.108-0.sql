@@ -0,0 +1,9 @@
+/*
+ * Expands the output of the $densify window functions into documents, generating the
+ * documents that fill each gap as they are returned.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_densify_unwind(__CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+ RETURNS SETOF __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_densify_unwind$function$;
@@ -0,0 +1,5 @@
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_dollar_graph_lookup_traverse(input __CORE_SCHEMA__.bson, spec __CORE_SCHEMA__.bson)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ STABLE STRICT
+AS 'MODULE_PATHNAME', $function$bson_dollar_graph_lookup_traverse$function$;
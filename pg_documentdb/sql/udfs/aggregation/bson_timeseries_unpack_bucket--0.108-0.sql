@@ -0,0 +1,9 @@
+/*
+ * Returns the measurements of a bucket of a time-series collection, for the
+ * $_internalUnpackBucket stage of its view.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_timeseries_unpack_bucket(__CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+ RETURNS SETOF __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_timeseries_unpack_bucket$function$;
@@ -0,0 +1,147 @@
+/*
+ * Variants of BSON_ARRAY_AGG and BSON_ADD_TO_SET for $group that can be partially
+ * aggregated by parallel workers and combined by the leader.
+ */
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_ARRAY_AGG_PARALLEL(__CORE_SCHEMA__.bson, text, boolean)
+(
+    SFUNC = __API_SCHEMA_INTERNAL_V2__.bson_array_agg_parallel_transition,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_array_agg_parallel_final,
+    stype = internal,
+    SERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_array_agg_serialize,
+    DESERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_array_agg_deserialize,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_array_agg_combine,
+    PARALLEL = SAFE
+);
+
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_ADD_TO_SET_PARALLEL(__CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_parallel_transition,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_parallel_final,
+    stype = internal,
+    SERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_serialize,
+    DESERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_deserialize,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_combine,
+    PARALLEL = SAFE
+);
+
+/*
+ * BSONMAX and BSONMIN with moving aggregate support so that sliding window frames
+ * don't recompute the aggregate for every row.
+ */
+CREATE OR REPLACE AGGREGATE __API_CATALOG_SCHEMA__.BSONMAX(__CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_CATALOG_SCHEMA__.bson_max_transition,
+    FINALFUNC = __API_CATALOG_SCHEMA__.bson_min_max_final,
+    stype = __CORE_SCHEMA__.bson,
+    COMBINEFUNC = __API_CATALOG_SCHEMA__.bson_max_combine,
+    mstype = internal,
+    MSFUNC = __API_SCHEMA_INTERNAL_V2__.bson_max_moving_transition,
+    MFINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_min_max_moving_final,
+    MINVFUNC = __API_SCHEMA_INTERNAL_V2__.bson_min_max_moving_invtransition,
+    PARALLEL = SAFE
+);
+
+CREATE OR REPLACE AGGREGATE __API_CATALOG_SCHEMA__.BSONMIN(__CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_CATALOG_SCHEMA__.bson_min_transition,
+    FINALFUNC = __API_CATALOG_SCHEMA__.bson_min_max_final,
+    stype = __CORE_SCHEMA__.bson,
+    COMBINEFUNC = __API_CATALOG_SCHEMA__.bson_min_combine,
+    mstype = internal,
+    MSFUNC = __API_SCHEMA_INTERNAL_V2__.bson_min_moving_transition,
+    MFINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_min_max_moving_final,
+    MINVFUNC = __API_SCHEMA_INTERNAL_V2__.bson_min_max_moving_invtransition,
+    PARALLEL = SAFE
+);
+
+/*
+ * A row count for $count that doesn't read the documents it counts.
+ */
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_COUNT(*)
+(
+    SFUNC = pg_catalog.int8inc,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_count_final,
+    stype = bigint,
+    INITCOND = '0',
+    COMBINEFUNC = pg_catalog.int8pl,
+    PARALLEL = SAFE
+);
+
+/*
+ * An approximate count of the distinct values for $approxCountDistinct.
+ */
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_APPROX_COUNT_DISTINCT(__CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_SCHEMA_INTERNAL_V2__.bson_approx_count_distinct_transition,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_approx_count_distinct_final,
+    stype = bytea,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_approx_count_distinct_combine,
+    PARALLEL = SAFE
+);
+
+/*
+ * The exact ('discrete') $percentile and $median.
+ */
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_EXACT_PERCENTILE(__CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_transition,
+    stype = internal,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_final,
+    SERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_serialize,
+    DESERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_deserialize,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_combine,
+    PARALLEL = SAFE
+);
+
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_EXACT_MEDIAN(__CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_transition,
+    stype = internal,
+    FINALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_median_final,
+    SERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_serialize,
+    DESERIALFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_deserialize,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_combine,
+    PARALLEL = SAFE
+);
+
+/*
+ * Variants of BSONFIRSTONSORTED, BSONLASTONSORTED, BSONFIRSTNONSORTED and BSONLASTNONSORTED
+ * for $group on input without a sort specification. As the input has no order, the
+ * workers can compute the partial states which are combined on the coordinator instead
+ * of pulling all the rows to the coordinator.
+ */
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_FIRST_PARALLEL(__CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_CATALOG_SCHEMA__.bson_first_transition_on_sorted,
+    FINALFUNC = __API_CATALOG_SCHEMA__.bson_first_last_final_on_sorted,
+    stype = bytea,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_first_combine_on_sorted,
+    PARALLEL = SAFE
+);
+
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_LAST_PARALLEL(__CORE_SCHEMA__.bson)
+(
+    SFUNC = __API_CATALOG_SCHEMA__.bson_last_transition_on_sorted,
+    FINALFUNC = __API_CATALOG_SCHEMA__.bson_first_last_final_on_sorted,
+    stype = bytea,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_last_combine_on_sorted,
+    PARALLEL = SAFE
+);
+
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_FIRSTN_PARALLEL(__CORE_SCHEMA__.bson, bigint)
+(
+    SFUNC = __API_CATALOG_SCHEMA__.bson_firstn_transition_on_sorted,
+    FINALFUNC = __API_CATALOG_SCHEMA__.bson_firstn_lastn_final_on_sorted,
+    stype = bytea,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_first_combine_on_sorted,
+    PARALLEL = SAFE
+);
+
+CREATE OR REPLACE AGGREGATE __API_SCHEMA_INTERNAL_V2__.BSON_LASTN_PARALLEL(__CORE_SCHEMA__.bson, bigint)
+(
+    SFUNC = __API_CATALOG_SCHEMA__.bson_lastn_transition_on_sorted,
+    FINALFUNC = __API_CATALOG_SCHEMA__.bson_firstn_lastn_final_on_sorted,
+    stype = bytea,
+    COMBINEFUNC = __API_SCHEMA_INTERNAL_V2__.bson_last_combine_on_sorted,
+    PARALLEL = SAFE
+);
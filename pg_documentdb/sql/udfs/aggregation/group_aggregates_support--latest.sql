@@ -366,4 +366,182 @@ CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.tdigest_deserial(bytea, in
  RETURNS internal
  LANGUAGE c
  IMMUTABLE STRICT
-AS 'MODULE_PATHNAME', $function$tdigest_deserial$function$;
\ No newline at end of file
+AS 'MODULE_PATHNAME', $function$tdigest_deserial$function$;
+
+/*
+ * Support functions for the parallel $push and $addToSet aggregates: These use an
+ * internal transition state that is serialized to pass it between parallel workers.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_array_agg_parallel_transition(internal, __CORE_SCHEMA__.bson, text, boolean)
+ RETURNS internal
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_array_agg_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_array_agg_parallel_final(internal)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_array_agg_final$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_array_agg_serialize(internal)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE STRICT
+AS 'MODULE_PATHNAME', $function$bson_array_agg_serialize$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_array_agg_deserialize(bytea, internal)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE STRICT
+AS 'MODULE_PATHNAME', $function$bson_array_agg_deserialize$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_array_agg_combine(internal, internal)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE
+AS 'MODULE_PATHNAME', $function$bson_array_agg_combine$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_parallel_transition(internal, __CORE_SCHEMA__.bson)
+ RETURNS internal
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_add_to_set_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_parallel_final(internal)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_add_to_set_final$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_serialize(internal)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE STRICT
+AS 'MODULE_PATHNAME', $function$bson_add_to_set_serialize$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_deserialize(bytea, internal)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE STRICT
+AS 'MODULE_PATHNAME', $function$bson_add_to_set_deserialize$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_add_to_set_combine(internal, internal)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE
+AS 'MODULE_PATHNAME', $function$bson_add_to_set_combine$function$;
+
+/*
+ * Moving aggregate support for BSONMAX and BSONMIN over sliding window frames.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_max_moving_transition(internal, __CORE_SCHEMA__.bson)
+ RETURNS internal
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_max_moving_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_min_moving_transition(internal, __CORE_SCHEMA__.bson)
+ RETURNS internal
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_min_moving_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_min_max_moving_invtransition(internal, __CORE_SCHEMA__.bson)
+ RETURNS internal
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_min_max_moving_invtransition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_min_max_moving_final(internal)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ STABLE
+AS 'MODULE_PATHNAME', $function$bson_min_max_moving_final$function$;
+
+/*
+ * Final function of BSON_COUNT(*): Writes the row count computed by int8inc as a
+ * bson number.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_count_final(bigint)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE STRICT PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_count_final$function$;
+
+/*
+ * Support functions of BSON_APPROX_COUNT_DISTINCT: The state is a HyperLogLog sketch.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_approx_count_distinct_transition(bytea, __CORE_SCHEMA__.bson)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_approx_count_distinct_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_approx_count_distinct_combine(bytea, bytea)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_approx_count_distinct_combine$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_approx_count_distinct_final(bytea)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_approx_count_distinct_final$function$;
+
+/*
+ * Support functions of BSON_EXACT_PERCENTILE and BSON_EXACT_MEDIAN: The state holds
+ * the numeric values of the group.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_transition(internal, __CORE_SCHEMA__.bson, __CORE_SCHEMA__.bson)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_exact_percentile_transition$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_combine(internal, internal)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_exact_percentile_combine$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_serialize(internal)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE STRICT PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_exact_percentile_serialize$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_deserialize(bytea, internal)
+ RETURNS internal
+ LANGUAGE c
+ IMMUTABLE STRICT PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_exact_percentile_deserialize$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_exact_percentile_final(internal)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_exact_percentile_final$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_exact_median_final(internal)
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_exact_median_final$function$;
+
+/*
+ * Combine functions of BSON_FIRST_PARALLEL, BSON_LAST_PARALLEL, BSON_FIRSTN_PARALLEL
+ * and BSON_LASTN_PARALLEL: Merge the states built by the on sorted transitions.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_first_combine_on_sorted(bytea, bytea)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_first_combine_on_sorted$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_last_combine_on_sorted(bytea, bytea)
+ RETURNS bytea
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $function$bson_last_combine_on_sorted$function$;
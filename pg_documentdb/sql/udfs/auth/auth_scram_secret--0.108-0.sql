@@ -0,0 +1,14 @@
+/*
+ * scram_sha256_get_secret() gets the SALT, Iteration count, StoredKey and
+ * ServerKey of the given user so that the gateway can verify client proofs
+ * without a round trip per handshake.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.scram_sha256_get_secret(
+    p_user_name text)
+ RETURNS __CORE_SCHEMA_V2__.bson
+ LANGUAGE C
+PARALLEL SAFE STABLE
+AS 'MODULE_PATHNAME', $$command_scram_sha256_get_secret$$;
+COMMENT ON FUNCTION __API_SCHEMA_INTERNAL_V2__.scram_sha256_get_secret(text)
+    IS 'Gets the SCRAM secret of the given user from the backend';
+REVOKE ALL ON FUNCTION __API_SCHEMA_INTERNAL_V2__.scram_sha256_get_secret(text) FROM PUBLIC;
@@ -0,0 +1,10 @@
+/*
+ * Prunes the retry records of retryable writes that are older than
+ * documentdb.retryRecordRetentionSeconds. This is called periodically by the
+ * background worker framework.
+ */
+CREATE OR REPLACE PROCEDURE __API_SCHEMA_INTERNAL_V2__.delete_expired_retry_records_background(IN p_batch_size int default -1)
+    LANGUAGE c
+AS 'MODULE_PATHNAME', $procedure$delete_expired_retry_records_background$procedure$;
+COMMENT ON PROCEDURE __API_SCHEMA_INTERNAL_V2__.delete_expired_retry_records_background(int)
+    IS 'Drops expired retry records of retryable writes from all collections.';
@@ -0,0 +1,18 @@
+-- Returns the background worker jobs registered on this node and the executions
+-- of each of them since the server started, from the shared memory job stats
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.background_worker_jobs(
+	OUT job_id int,
+	OUT job_name text,
+	OUT priority int,
+	OUT max_concurrent_executions int,
+	OUT running_executions int,
+	OUT total_executions bigint,
+	OUT failed_executions bigint,
+	OUT timed_out_executions bigint,
+	OUT deferred_executions bigint,
+	OUT last_start_time timestamptz,
+	OUT last_end_time timestamptz,
+	OUT last_duration_ms bigint)
+RETURNS SETOF RECORD
+LANGUAGE C VOLATILE PARALLEL SAFE
+AS 'MODULE_PATHNAME', $$get_background_worker_jobs$$;
@@ -0,0 +1,12 @@
+-- Returns the number of times each collection of the current database was joined by
+-- $lookup, $graphLookup and $unionWith stages on another collection, from the shared
+-- memory join counts
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.collection_join_stats(
+	IN reset_stats_after_read bool DEFAULT false,
+	OUT source_collection_id bigint,
+	OUT target_collection_id bigint,
+	OUT join_count bigint,
+	OUT last_join_time timestamptz)
+RETURNS SETOF RECORD
+LANGUAGE C VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $$get_collection_join_stats$$;
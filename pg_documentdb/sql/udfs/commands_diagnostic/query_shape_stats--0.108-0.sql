@@ -0,0 +1,7 @@
+-- Returns the shared memory statistics of the queries of the commands by query shape
+-- and namespace, in the format of $queryStats
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.query_shape_stats(
+	IN reset_stats_after_read bool DEFAULT false)
+RETURNS SETOF __CORE_SCHEMA__.bson
+LANGUAGE C VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $$get_query_shape_stats$$;
@@ -0,0 +1,7 @@
+-- Returns the queries of the slow and sampled commands recorded in the shared memory
+-- slow operation log, oldest first, in the format of the system.profile collection
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.slow_operation_log(
+	IN reset_log_after_read bool DEFAULT false)
+RETURNS SETOF __CORE_SCHEMA__.bson
+LANGUAGE C VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $$get_slow_operation_log$$;
@@ -0,0 +1,10 @@
+/*
+ * __API_SCHEMA_INTERNAL_V2__.prewarm_query_plan_cache initializes the metadata cache of the
+ * current backend and prepares the queries that backends prepared the most in its query
+ * plan cache, and returns how many were prepared.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.prewarm_query_plan_cache(max_plans int4 DEFAULT NULL)
+ RETURNS int4
+ LANGUAGE c
+ VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $function$command_prewarm_query_plan_cache$function$;
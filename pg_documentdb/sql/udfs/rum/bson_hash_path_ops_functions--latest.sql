@@ -0,0 +1,11 @@
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_hash_path_value(__CORE_SCHEMA__.bson)
+ RETURNS int4
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_hash_path_value$function$;
+
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.bson_hash_path_query(__CORE_SCHEMA__.bsonquery)
+ RETURNS int4
+ LANGUAGE c
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_hash_path_query$function$;
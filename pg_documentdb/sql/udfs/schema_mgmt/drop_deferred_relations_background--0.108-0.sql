@@ -0,0 +1,11 @@
+/*
+ * Drops up to p_batch_size (default documentdb.deferredDropMaxRelationsPerRun)
+ * of the tables and indexes of dropped collections and indexes, whose drops
+ * were deferred. This is called periodically by the background worker
+ * framework.
+ */
+CREATE OR REPLACE PROCEDURE __API_SCHEMA_INTERNAL_V2__.drop_deferred_relations_background(IN p_batch_size int default -1)
+    LANGUAGE c
+AS 'MODULE_PATHNAME', $procedure$drop_deferred_relations_background$procedure$;
+COMMENT ON PROCEDURE __API_SCHEMA_INTERNAL_V2__.drop_deferred_relations_background(int)
+    IS 'Drops the relations of dropped collections and indexes in the background.';
@@ -0,0 +1,25 @@
+/*
+ * Keeps the columnar projection store in TG_ARGV[0] in sync with the data table
+ * of a collection: the store holds the $project of TG_ARGV[1] of every document.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.maintain_columnar_projection()
+ RETURNS trigger
+ LANGUAGE plpgsql
+AS $fn$
+BEGIN
+    IF TG_OP = 'DELETE' OR (TG_OP = 'UPDATE' AND
+        (OLD.shard_key_value, OLD.object_id) IS DISTINCT FROM (NEW.shard_key_value, NEW.object_id)) THEN
+        EXECUTE format('DELETE FROM %s WHERE shard_key_value = $1 AND object_id = $2', TG_ARGV[0])
+            USING OLD.shard_key_value, OLD.object_id;
+    END IF;
+
+    IF TG_OP <> 'DELETE' THEN
+        EXECUTE format('INSERT INTO %s (shard_key_value, object_id, document)'
+                       ' VALUES ($1, $2, __API_CATALOG_SCHEMA__.bson_dollar_project($3, $4::__CORE_SCHEMA__.bson))'
+                       ' ON CONFLICT (shard_key_value, object_id) DO UPDATE SET document = EXCLUDED.document', TG_ARGV[0])
+            USING NEW.shard_key_value, NEW.object_id, NEW.document, TG_ARGV[1];
+    END IF;
+
+    RETURN NULL;
+END;
+$fn$;
@@ -0,0 +1,10 @@
+/*
+ * Rewrites the clustered collections whose physical order drifted from the _id
+ * order below documentdb.clusteredCollectionMinCorrelation. This is called
+ * periodically by the background worker framework.
+ */
+CREATE OR REPLACE PROCEDURE __API_SCHEMA_INTERNAL_V2__.recluster_collections_background(IN p_batch_size int default -1)
+    LANGUAGE c
+AS 'MODULE_PATHNAME', $procedure$recluster_collections_background$procedure$;
+COMMENT ON PROCEDURE __API_SCHEMA_INTERNAL_V2__.recluster_collections_background(int)
+    IS 'Reclusters clustered collections in _id order.';
@@ -0,0 +1,8 @@
+/*
+ * __API_SCHEMA_V2__.refresh_materialized_view materializes the output of a view into a collection.
+ */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_V2__.refresh_materialized_view(dbname text, refreshSpec __CORE_SCHEMA_V2__.bson)
+ RETURNS __CORE_SCHEMA_V2__.bson
+ LANGUAGE c
+ VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $$command_refresh_materialized_view$$;
@@ -0,0 +1,29 @@
+/*
+ * Reshards a collection while it takes writes: the documents are copied to the
+ * new shard key in throttled chunks, committing after each, and only the final
+ * catch up on the captured changes blocks writes.
+ */
+CREATE OR REPLACE PROCEDURE __API_SCHEMA_V2__.reshard_collection_online(
+    IN p_shard_key_spec __CORE_SCHEMA_V2__.bson,
+    IN p_batch_size int DEFAULT 10000,
+    IN p_batch_delay_ms int DEFAULT 0)
+ LANGUAGE C
+AS 'MODULE_PATHNAME', $procedure$command_reshard_collection_online$procedure$;
+COMMENT ON PROCEDURE __API_SCHEMA_V2__.reshard_collection_online(__CORE_SCHEMA_V2__.bson, int, int)
+    IS 'Reshards a collection without blocking writes for the length of the copy';
+
+/* Logs the object_id of the documents written during an online reshard into the change table in TG_ARGV[0] */
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.record_reshard_change()
+ RETURNS trigger
+ LANGUAGE plpgsql
+AS $fn$
+BEGIN
+    IF TG_OP = 'DELETE' THEN
+        EXECUTE format('INSERT INTO %s (object_id) VALUES ($1)', TG_ARGV[0]) USING OLD.object_id;
+    ELSE
+        EXECUTE format('INSERT INTO %s (object_id) VALUES ($1)', TG_ARGV[0]) USING NEW.object_id;
+    END IF;
+
+    RETURN NULL;
+END;
+$fn$;
@@ -0,0 +1,18 @@
+-- This function is used to get the command latency histograms for reporting to
+-- the telemetry pipeline
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.command_latency_stats(
+	IN reset_stats_after_read bool,
+	OUT command_name text,
+	OUT latency_upper_bound_us int8,
+	OUT command_count int8)
+RETURNS SETOF RECORD
+LANGUAGE C VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $$get_command_latency_stats$$;
+
+-- Returns the command latency histograms in the format of the opLatencies
+-- section of serverStatus
+CREATE OR REPLACE FUNCTION __API_SCHEMA_INTERNAL_V2__.command_latency_status(
+	IN reset_stats_after_read bool DEFAULT false)
+RETURNS __CORE_SCHEMA__.bson
+LANGUAGE C VOLATILE PARALLEL UNSAFE
+AS 'MODULE_PATHNAME', $$get_command_latency_status$$;
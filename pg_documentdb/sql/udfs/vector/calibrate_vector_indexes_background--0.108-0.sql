@@ -0,0 +1,12 @@
+/*
+ * Measures the recall of the vector indexes against exact search for increasing
+ * values of their search parameter, sampling
+ * documentdb.vectorSearchCalibrationSampleSize vectors as queries. Searches
+ * with a targetRecall use the recall curves. This is called periodically by
+ * the background worker framework.
+ */
+CREATE OR REPLACE PROCEDURE __API_SCHEMA_INTERNAL_V2__.calibrate_vector_indexes_background(IN p_batch_size int default -1)
+    LANGUAGE c
+AS 'MODULE_PATHNAME', $procedure$calibrate_vector_indexes_background$procedure$;
+COMMENT ON PROCEDURE __API_SCHEMA_INTERNAL_V2__.calibrate_vector_indexes_background(int)
+    IS 'Calibrates the search parameters of vector indexes for target recalls.';
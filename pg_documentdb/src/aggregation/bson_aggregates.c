@@ -18,6 +18,7 @@
 #include <utils/builtins.h>
 #include <utils/heap_utils.h>
 #include "utils/documentdb_errors.h"
+#include "utils/query_memory_budget.h"
 #include "metadata/collection.h"
 #include "commands/insert.h"
 #include "sharding/sharding.h"
@@ -28,6 +29,23 @@
 #include "aggregation/bson_sorted_accumulator.h"
 #include "operators/bson_expression_operators.h"
 
+extern bool EnableDecimal128SumFastPath;
+
+/*
+ * The layout of the BID encoding of decimal128 values as stored in bson
+ * (for the small coefficient encoding, which is used for all canonical
+ * finite values).
+ */
+#define DECIMAL128_SIGN_MASK UINT64CONST(0x8000000000000000)
+#define DECIMAL128_COMBINATION_LARGE_MASK UINT64CONST(0x6000000000000000)
+#define DECIMAL128_EXPONENT_SHIFT 49
+#define DECIMAL128_EXPONENT_MASK 0x3FFF
+#define DECIMAL128_COEFFICIENT_HIGH_MASK UINT64CONST(0x0001FFFFFFFFFFFF)
+
+/* 10^34: The smallest coefficient that exceeds the decimal128 precision */
+#define DECIMAL128_MAX_COEFFICIENT_PLUS_ONE \
+	((int128) UINT64CONST(10000000000000000) * UINT64CONST(1000000000000000000))
+
 /* --------------------------------------------------------- */
 /* Data-types */
 /* --------------------------------------------------------- */
@@ -36,12 +54,28 @@ typedef struct BsonNumericAggState
 {
 	bson_value_t sum;
 	int64_t count;
+
+	/*
+	 * While set, the sum is a decimal128 that is kept here as an integer
+	 * coefficient, so that decimal128 values of the same exponent can be
+	 * added exactly with an integer add. It is written back to sum before
+	 * any other add and when the state is read (see FlushPendingDecimal128Sum).
+	 * The coefficient is an int128 stored as two halves since the state lives
+	 * in an unaligned bytea.
+	 */
+	bool hasPendingDecimalSum;
+	int32_t pendingDecimalExponent;
+	uint64_t pendingDecimalCoefficientHigh;
+	uint64_t pendingDecimalCoefficientLow;
 } BsonNumericAggState;
 
 typedef struct BsonArrayGroupAggState
 {
 	pgbson_writer writer;
 	pgbson_array_writer arrayWriter;
+
+	/* The path the array is written to (needed to rebuild a serialized state) */
+	char *path;
 } BsonArrayGroupAggState;
 
 /*
@@ -88,6 +122,26 @@ typedef struct BinaryHeapState
 	bool isMaxN;
 } BinaryHeapState;
 
+/*
+ * Moving aggregate state for $min and $max over sliding window frames. This is a
+ * monotonic deque of the frame's values: Each value is only kept while no later value
+ * in the frame supersedes it, so the front is always the result and every row is
+ * added and removed once.
+ */
+typedef struct BsonMinMaxMovingState
+{
+	/* ring buffer of the candidate values and the position of their rows */
+	pgbson **values;
+	int64 *rowPositions;
+	int32 capacity;
+	int32 head;
+	int32 count;
+
+	/* position of the next row added to and removed from the frame */
+	int64 nextAddPosition;
+	int64 nextRemovePosition;
+} BsonMinMaxMovingState;
+
 const char charset[] = "abcdefghijklmnopqrstuvwxyz0123456789";
 
 
@@ -96,12 +150,20 @@ const char charset[] = "abcdefghijklmnopqrstuvwxyz0123456789";
 /* --------------------------------------------------------- */
 
 static bytea * AllocateBsonNumericAggState(void);
+static bytea * AllocateBsonArrayGroupAggState(const char *path);
+static bytea * AllocateBsonAddToSetState(void);
+static void AppendBsonArrayValues(pgbson_array_writer *arrayWriter,
+								  const bson_value_t *arrayValue);
+static bool TryAddDecimal128ToPendingSum(BsonNumericAggState *state,
+										 const bson_value_t *value);
+static void FlushPendingDecimal128Sum(BsonNumericAggState *state);
 static void CheckAggregateIntermediateResultSize(uint32_t size);
 static void CreateObjectAggTreeNodes(BsonObjectAggState *currentState,
 									 pgbson *currentValue);
 static void ValidateMergeObjectsInput(pgbson *input);
 static Datum ParseAndReturnMergeObjectsTree(BsonObjectAggState *state);
 static Datum bson_maxminn_transition(PG_FUNCTION_ARGS, bool isMaxN);
+static Datum BsonMinMaxMovingTransitionCore(PG_FUNCTION_ARGS, bool isMax);
 
 void DeserializeBinaryHeapState(bytea *byteArray, BinaryHeapState *state);
 bytea * SerializeBinaryHeapState(MemoryContext aggregateContext, BinaryHeapState *state,
@@ -113,11 +175,16 @@ bytea * SerializeBinaryHeapState(MemoryContext aggregateContext, BinaryHeapState
 
 PG_FUNCTION_INFO_V1(bson_sum_avg_transition);
 PG_FUNCTION_INFO_V1(bson_sum_final);
+PG_FUNCTION_INFO_V1(bson_count_final);
 PG_FUNCTION_INFO_V1(bson_avg_final);
 PG_FUNCTION_INFO_V1(bson_sum_avg_combine);
 PG_FUNCTION_INFO_V1(bson_sum_avg_minvtransition);
 PG_FUNCTION_INFO_V1(bson_min_transition);
 PG_FUNCTION_INFO_V1(bson_max_transition);
+PG_FUNCTION_INFO_V1(bson_min_moving_transition);
+PG_FUNCTION_INFO_V1(bson_max_moving_transition);
+PG_FUNCTION_INFO_V1(bson_min_max_moving_invtransition);
+PG_FUNCTION_INFO_V1(bson_min_max_moving_final);
 PG_FUNCTION_INFO_V1(bson_min_max_final);
 PG_FUNCTION_INFO_V1(bson_min_combine);
 PG_FUNCTION_INFO_V1(bson_max_combine);
@@ -125,6 +192,9 @@ PG_FUNCTION_INFO_V1(bson_build_distinct_response);
 PG_FUNCTION_INFO_V1(bson_array_agg_transition);
 PG_FUNCTION_INFO_V1(bson_array_agg_minvtransition);
 PG_FUNCTION_INFO_V1(bson_array_agg_final);
+PG_FUNCTION_INFO_V1(bson_array_agg_serialize);
+PG_FUNCTION_INFO_V1(bson_array_agg_deserialize);
+PG_FUNCTION_INFO_V1(bson_array_agg_combine);
 PG_FUNCTION_INFO_V1(bson_distinct_array_agg_transition);
 PG_FUNCTION_INFO_V1(bson_distinct_array_agg_final);
 PG_FUNCTION_INFO_V1(bson_object_agg_transition);
@@ -133,6 +203,9 @@ PG_FUNCTION_INFO_V1(bson_out_transition);
 PG_FUNCTION_INFO_V1(bson_out_final);
 PG_FUNCTION_INFO_V1(bson_add_to_set_transition);
 PG_FUNCTION_INFO_V1(bson_add_to_set_final);
+PG_FUNCTION_INFO_V1(bson_add_to_set_serialize);
+PG_FUNCTION_INFO_V1(bson_add_to_set_deserialize);
+PG_FUNCTION_INFO_V1(bson_add_to_set_combine);
 PG_FUNCTION_INFO_V1(bson_merge_objects_transition_on_sorted);
 PG_FUNCTION_INFO_V1(bson_merge_objects_transition);
 PG_FUNCTION_INFO_V1(bson_merge_objects_final);
@@ -179,25 +252,22 @@ BsonArrayAggTransitionCore(PG_FUNCTION_ARGS, bool handleSingleValueElement,
 	/* If the intermediate state has never been initialized, create it */
 	if (PG_ARGISNULL(0)) /* First arg is the running aggregated state*/
 	{
-		int bson_size = sizeof(BsonArrayAggState) + VARHDRSZ;
-		bytea *combinedStateBytes = (bytea *) palloc0(bson_size);
-		SET_VARSIZE(combinedStateBytes, bson_size);
-		bytes = combinedStateBytes;
-
-		currentState = (BsonArrayAggState *) VARDATA(bytes);
-		currentState->isWindowAggregation = isWindowAggregation;
-		currentState->currentSizeWritten = 0;
-
 		if (isWindowAggregation)
 		{
+			int bson_size = sizeof(BsonArrayAggState) + VARHDRSZ;
+			bytea *combinedStateBytes = (bytea *) palloc0(bson_size);
+			SET_VARSIZE(combinedStateBytes, bson_size);
+			bytes = combinedStateBytes;
+
+			currentState = (BsonArrayAggState *) VARDATA(bytes);
+			currentState->isWindowAggregation = true;
+			currentState->currentSizeWritten = 0;
 			currentState->aggState.window.aggregateList = NIL;
 		}
 		else
 		{
-			PgbsonWriterInit(&currentState->aggState.group.writer);
-			PgbsonWriterStartArray(&currentState->aggState.group.writer, path, strlen(
-									   path),
-								   &currentState->aggState.group.arrayWriter);
+			bytes = AllocateBsonArrayGroupAggState(path);
+			currentState = (BsonArrayAggState *) VARDATA(bytes);
 		}
 	}
 	else
@@ -251,6 +321,7 @@ BsonArrayAggTransitionCore(PG_FUNCTION_ARGS, bool handleSingleValueElement,
 			}
 		}
 		currentState->currentSizeWritten += PgbsonGetBsonSize(currentValue);
+		ReserveQueryMemory(aggregateContext, PgbsonGetBsonSize(currentValue), "$push");
 	}
 
 	if (currentValue != NULL)
@@ -410,6 +481,148 @@ bson_array_agg_final(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * The serialfunc for the parallel array aggregation: Writes out the size
+ * written so far, the path and the array built so far, in that order.
+ */
+Datum
+bson_array_agg_serialize(PG_FUNCTION_ARGS)
+{
+	if (!AggCheckCallContext(fcinfo, NULL))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	BsonArrayAggState *state = (BsonArrayAggState *) VARDATA(PG_GETARG_POINTER(0));
+	if (state->isWindowAggregation)
+	{
+		ereport(ERROR, errmsg(
+					"window aggregate state for $push can not be serialized"));
+	}
+
+	bson_value_t arrayValue = PgbsonArrayWriterGetValue(
+		&state->aggState.group.arrayWriter);
+	uint32_t pathLength = strlen(state->aggState.group.path);
+
+	int requiredByteSize = VARHDRSZ + sizeof(int64) + sizeof(uint32_t) + pathLength +
+						   arrayValue.value.v_doc.data_len;
+	bytea *bytes = (bytea *) palloc(requiredByteSize);
+	SET_VARSIZE(bytes, requiredByteSize);
+
+	char *bytePointer = VARDATA(bytes);
+	memcpy(bytePointer, &state->currentSizeWritten, sizeof(int64));
+	bytePointer += sizeof(int64);
+	memcpy(bytePointer, &pathLength, sizeof(uint32_t));
+	bytePointer += sizeof(uint32_t);
+	memcpy(bytePointer, state->aggState.group.path, pathLength);
+	bytePointer += pathLength;
+	memcpy(bytePointer, arrayValue.value.v_doc.data, arrayValue.value.v_doc.data_len);
+
+	PG_RETURN_BYTEA_P(bytes);
+}
+
+
+/*
+ * The deserialfunc for the parallel array aggregation: Rebuilds the state
+ * written by bson_array_agg_serialize in the aggregate context.
+ */
+Datum
+bson_array_agg_deserialize(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	bytea *serializedBytes = PG_GETARG_BYTEA_PP(0);
+	const char *bytePointer = VARDATA_ANY(serializedBytes);
+	const char *byteEnd = bytePointer + VARSIZE_ANY_EXHDR(serializedBytes);
+
+	int64 currentSizeWritten;
+	memcpy(&currentSizeWritten, bytePointer, sizeof(int64));
+	bytePointer += sizeof(int64);
+
+	uint32_t pathLength;
+	memcpy(&pathLength, bytePointer, sizeof(uint32_t));
+	bytePointer += sizeof(uint32_t);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+
+	char *path = pnstrdup(bytePointer, pathLength);
+	bytePointer += pathLength;
+
+	bytea *bytes = AllocateBsonArrayGroupAggState(path);
+	BsonArrayAggState *state = (BsonArrayAggState *) VARDATA(bytes);
+
+	bson_value_t arrayValue = { 0 };
+	arrayValue.value_type = BSON_TYPE_ARRAY;
+	arrayValue.value.v_doc.data = (uint8_t *) bytePointer;
+	arrayValue.value.v_doc.data_len = byteEnd - bytePointer;
+	AppendBsonArrayValues(&state->aggState.group.arrayWriter, &arrayValue);
+	state->currentSizeWritten = currentSizeWritten;
+
+	MemoryContextSwitchTo(oldContext);
+	PG_RETURN_POINTER(bytes);
+}
+
+
+/*
+ * The combinefunc for the parallel array aggregation: Appends the values of
+ * the second state to the array of the first.
+ */
+Datum
+bson_array_agg_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+		{
+			PG_RETURN_NULL();
+		}
+
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+
+	BsonArrayAggState *rightState = (BsonArrayAggState *) VARDATA(
+		PG_GETARG_POINTER(1));
+
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+
+	bytea *bytes;
+	if (PG_ARGISNULL(0))
+	{
+		bytes = AllocateBsonArrayGroupAggState(rightState->aggState.group.path);
+	}
+	else
+	{
+		bytes = (bytea *) PG_GETARG_POINTER(0);
+	}
+
+	BsonArrayAggState *leftState = (BsonArrayAggState *) VARDATA(bytes);
+	CheckAggregateIntermediateResultSize(leftState->currentSizeWritten +
+										 rightState->currentSizeWritten);
+
+	bson_value_t rightArray = PgbsonArrayWriterGetValue(
+		&rightState->aggState.group.arrayWriter);
+	AppendBsonArrayValues(&leftState->aggState.group.arrayWriter, &rightArray);
+	leftState->currentSizeWritten += rightState->currentSizeWritten;
+	ReserveQueryMemory(aggregateContext, rightState->currentSizeWritten, "$push");
+
+	MemoryContextSwitchTo(oldContext);
+	PG_RETURN_POINTER(bytes);
+}
+
+
 /*
  * The finalfunc for distinct array aggregation.
  * Similar to array_agg but also writes "ok": 1
@@ -501,6 +714,8 @@ AggregateObjectsCore(PG_FUNCTION_ARGS)
 		currentValue = PgbsonCloneFromPgbson(currentValue);
 		CreateObjectAggTreeNodes(currentState, currentValue);
 		currentState->currentSizeWritten += PgbsonGetBsonSize(currentValue);
+		ReserveQueryMemory(aggregateContext, PgbsonGetBsonSize(currentValue),
+						   "$mergeObjects");
 	}
 
 	MemoryContextSwitchTo(oldContext);
@@ -683,6 +898,12 @@ bson_sum_avg_transition(PG_FUNCTION_ARGS)
 	pgbsonelement currentValueElement;
 	PgbsonToSinglePgbsonElement(currentValue, &currentValueElement);
 
+	if (TryAddDecimal128ToPendingSum(currentState, &currentValueElement.bsonValue))
+	{
+		currentState->count++;
+		PG_RETURN_POINTER(bytes);
+	}
+
 	bool overflowedFromInt64Ignore = false;
 
 	if (AddNumberToBsonValue(&currentState->sum, &currentValueElement.bsonValue,
@@ -737,6 +958,7 @@ bson_sum_avg_minvtransition(PG_FUNCTION_ARGS)
 	bool overflowedFromInt64Ignore = false;
 
 	/* Aply the inverse of $sum and $avg */
+	FlushPendingDecimal128Sum(currentState);
 	if (currentState->count > 0 &&
 		SubtractNumberFromBsonValue(&currentState->sum, &currentValueElement.bsonValue,
 									&overflowedFromInt64Ignore))
@@ -763,9 +985,10 @@ bson_sum_final(PG_FUNCTION_ARGS)
 	finalValue.pathLength = 0;
 	if (currentSum != NULL)
 	{
-		BsonNumericAggState *state = (BsonNumericAggState *) VARDATA_ANY(
-			currentSum);
-		finalValue.bsonValue = state->sum;
+		BsonNumericAggState state;
+		memcpy(&state, VARDATA_ANY(currentSum), sizeof(BsonNumericAggState));
+		FlushPendingDecimal128Sum(&state);
+		finalValue.bsonValue = state.sum;
 	}
 	else
 	{
@@ -778,6 +1001,34 @@ bson_sum_final(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Applies the "final calculation" (FINALFUNC) for BSON_COUNT(*).
+ * The row count is written as an int32 while it fits, and as an int64
+ * otherwise, which is the same type bsonsum would produce for the count.
+ */
+Datum
+bson_count_final(PG_FUNCTION_ARGS)
+{
+	int64 count = PG_GETARG_INT64(0);
+
+	pgbsonelement finalValue;
+	finalValue.path = "";
+	finalValue.pathLength = 0;
+	if (count <= INT32_MAX)
+	{
+		finalValue.bsonValue.value_type = BSON_TYPE_INT32;
+		finalValue.bsonValue.value.v_int32 = (int32) count;
+	}
+	else
+	{
+		finalValue.bsonValue.value_type = BSON_TYPE_INT64;
+		finalValue.bsonValue.value.v_int64 = count;
+	}
+
+	PG_RETURN_POINTER(PgbsonElementToPgbson(&finalValue));
+}
+
+
 /*
  * Applies the "final calculation" (FINALFUNC) for average.
  * This takes the final value created and outputs a bson "average"
@@ -792,8 +1043,11 @@ bson_avg_final(PG_FUNCTION_ARGS)
 	finalValue.pathLength = 0;
 	if (avgIntermediateState != NULL)
 	{
-		BsonNumericAggState *averageState = (BsonNumericAggState *) VARDATA_ANY(
-			avgIntermediateState);
+		BsonNumericAggState averageStateCopy;
+		memcpy(&averageStateCopy, VARDATA_ANY(avgIntermediateState),
+			   sizeof(BsonNumericAggState));
+		BsonNumericAggState *averageState = &averageStateCopy;
+		FlushPendingDecimal128Sum(averageState);
 		if (averageState->count == 0)
 		{
 			/* Mongo returns $null for empty sets */
@@ -914,6 +1168,163 @@ bson_min_transition(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Applies the moving aggregate transition (MSFUNC) for $max over a window frame.
+ */
+Datum
+bson_max_moving_transition(PG_FUNCTION_ARGS)
+{
+	bool isMax = true;
+	return BsonMinMaxMovingTransitionCore(fcinfo, isMax);
+}
+
+
+/*
+ * Applies the moving aggregate transition (MSFUNC) for $min over a window frame.
+ */
+Datum
+bson_min_moving_transition(PG_FUNCTION_ARGS)
+{
+	bool isMax = false;
+	return BsonMinMaxMovingTransitionCore(fcinfo, isMax);
+}
+
+
+/*
+ * Applies the inverse transition (MINVFUNC) for $min and $max. Rows leave the frame
+ * in the order they were added, so the removed row is the oldest one: It is only in
+ * the deque if it is still the front.
+ */
+Datum
+bson_min_max_moving_invtransition(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (AggCheckCallContext(fcinfo, &aggregateContext) != AGG_CONTEXT_WINDOW)
+	{
+		ereport(ERROR, errmsg(
+					"window aggregate function called in non-window-aggregate context"));
+	}
+
+	if (PG_ARGISNULL(0))
+	{
+		/* Returning NULL is an indiacation that inverse can't be applied and the aggregation needs to be redone */
+		PG_RETURN_NULL();
+	}
+
+	BsonMinMaxMovingState *state = (BsonMinMaxMovingState *) PG_GETARG_POINTER(0);
+	int64 removedPosition = state->nextRemovePosition++;
+	if (state->count > 0 && state->rowPositions[state->head] == removedPosition)
+	{
+		pfree(state->values[state->head]);
+		state->head = (state->head + 1) % state->capacity;
+		state->count--;
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+
+/*
+ * Applies the moving aggregate final function (MFINALFUNC) for $min and $max.
+ * Like bson_min_max_final returns null for empty frames.
+ */
+Datum
+bson_min_max_moving_final(PG_FUNCTION_ARGS)
+{
+	BsonMinMaxMovingState *state = PG_ARGISNULL(0) ? NULL :
+								   (BsonMinMaxMovingState *) PG_GETARG_POINTER(0);
+	if (state != NULL && state->count > 0)
+	{
+		PG_RETURN_POINTER(CopyPgbsonIntoMemoryContext(state->values[state->head],
+													  CurrentMemoryContext));
+	}
+
+	pgbsonelement finalValue;
+	finalValue.path = "";
+	finalValue.pathLength = 0;
+	finalValue.bsonValue.value_type = BSON_TYPE_NULL;
+	PG_RETURN_POINTER(PgbsonElementToPgbson(&finalValue));
+}
+
+
+/*
+ * Adds a row to the moving $min/$max state: Values at the back of the deque that the
+ * new value supersedes are dropped before it is appended. Ties are resolved in favor
+ * of the later value as in bson_min_transition/bson_max_transition.
+ */
+static Datum
+BsonMinMaxMovingTransitionCore(PG_FUNCTION_ARGS, bool isMax)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	BsonMinMaxMovingState *state = PG_ARGISNULL(0) ? NULL :
+								   (BsonMinMaxMovingState *) PG_GETARG_POINTER(0);
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+	if (state == NULL)
+	{
+		state = palloc0(sizeof(BsonMinMaxMovingState));
+		state->capacity = 16;
+		state->values = palloc(sizeof(pgbson *) * state->capacity);
+		state->rowPositions = palloc(sizeof(int64) * state->capacity);
+	}
+
+	int64 addedPosition = state->nextAddPosition++;
+	pgbson *value = PG_GETARG_MAYBE_NULL_PGBSON(1);
+	if (value == NULL)
+	{
+		MemoryContextSwitchTo(oldContext);
+		PG_RETURN_POINTER(state);
+	}
+
+	while (state->count > 0)
+	{
+		int32 tail = (state->head + state->count - 1) % state->capacity;
+		int32 compResult = ComparePgbson(state->values[tail], value);
+		if ((isMax && compResult > 0) || (!isMax && compResult < 0))
+		{
+			break;
+		}
+
+		pfree(state->values[tail]);
+		state->count--;
+	}
+
+	if (state->count == state->capacity)
+	{
+		/* Grow the ring buffer, unrolling it so that the front is at the start */
+		int32 newCapacity = state->capacity * 2;
+		pgbson **values = palloc(sizeof(pgbson *) * newCapacity);
+		int64 *rowPositions = palloc(sizeof(int64) * newCapacity);
+		for (int32 i = 0; i < state->count; i++)
+		{
+			int32 index = (state->head + i) % state->capacity;
+			values[i] = state->values[index];
+			rowPositions[i] = state->rowPositions[index];
+		}
+
+		pfree(state->values);
+		pfree(state->rowPositions);
+		state->values = values;
+		state->rowPositions = rowPositions;
+		state->capacity = newCapacity;
+		state->head = 0;
+	}
+
+	int32 tail = (state->head + state->count) % state->capacity;
+	state->values[tail] = CopyPgbsonIntoMemoryContext(value, aggregateContext);
+	state->rowPositions[tail] = addedPosition;
+	state->count++;
+
+	MemoryContextSwitchTo(oldContext);
+	PG_RETURN_POINTER(state);
+}
+
+
 /*
  * Applies the "combine function" (COMBINEFUNC) for sum and average.
  * takes two of the aggregate state structures (bson_numeric_agg_state)
@@ -962,17 +1373,23 @@ bson_sum_avg_combine(PG_FUNCTION_ARGS)
 	}
 	else
 	{
-		BsonNumericAggState *leftState = (BsonNumericAggState *) VARDATA_ANY(
-			PG_GETARG_BYTEA_P(0));
-		BsonNumericAggState *rightState = (BsonNumericAggState *) VARDATA_ANY(
-			PG_GETARG_BYTEA_P(1));
+		BsonNumericAggState leftState;
+		BsonNumericAggState rightState;
+		memcpy(&leftState, VARDATA_ANY(PG_GETARG_BYTEA_P(0)),
+			   sizeof(BsonNumericAggState));
+		memcpy(&rightState, VARDATA_ANY(PG_GETARG_BYTEA_P(1)),
+			   sizeof(BsonNumericAggState));
+
+		/* Fold the pending decimal sums before combining */
+		FlushPendingDecimal128Sum(&leftState);
+		FlushPendingDecimal128Sum(&rightState);
 
-		currentState->count = leftState->count + rightState->count;
-		currentState->sum = leftState->sum;
+		currentState->count = leftState.count + rightState.count;
+		currentState->sum = leftState.sum;
 
 		bool overflowedFromInt64Ignore = false;
 
-		AddNumberToBsonValue(&currentState->sum, &rightState->sum,
+		AddNumberToBsonValue(&currentState->sum, &rightState.sum,
 							 &overflowedFromInt64Ignore);
 	}
 
@@ -1167,14 +1584,9 @@ bson_add_to_set_transition(PG_FUNCTION_ARGS)
 	/* If the intermediate state has never been initialized, create it */
 	if (PG_ARGISNULL(0)) /* First arg is the running aggregated state*/
 	{
-		int bson_size = sizeof(BsonAddToSetState) + VARHDRSZ;
-		bytea *combinedStateBytes = (bytea *) palloc0(bson_size);
-		SET_VARSIZE(combinedStateBytes, bson_size);
-		bytes = combinedStateBytes;
+		bytes = AllocateBsonAddToSetState();
 
 		currentState = (BsonAddToSetState *) VARDATA(bytes);
-		currentState->currentSizeWritten = 0;
-		currentState->set = CreateBsonValueHashSet();
 		currentState->isWindowAggregation = isWindowAggregation;
 	}
 	else
@@ -1212,6 +1624,8 @@ bson_add_to_set_transition(PG_FUNCTION_ARGS)
 			if (!found)
 			{
 				currentState->currentSizeWritten += PgbsonGetBsonSize(currentValue);
+				ReserveQueryMemory(aggregateContext, PgbsonGetBsonSize(currentValue),
+								   "$addToSet");
 			}
 		}
 		else
@@ -1291,6 +1705,154 @@ bson_add_to_set_final(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * The serialfunc for the parallel BSON_ADD_TO_SET aggregate: Writes out the
+ * size written so far followed by the values of the set as a bson array.
+ */
+Datum
+bson_add_to_set_serialize(PG_FUNCTION_ARGS)
+{
+	if (!AggCheckCallContext(fcinfo, NULL))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	BsonAddToSetState *state = (BsonAddToSetState *) VARDATA(PG_GETARG_POINTER(0));
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	pgbson_array_writer arrayWriter;
+	PgbsonWriterStartArray(&writer, "", 0, &arrayWriter);
+
+	HASH_SEQ_STATUS seq_status;
+	const bson_value_t *entry;
+	hash_seq_init(&seq_status, state->set);
+	while ((entry = hash_seq_search(&seq_status)) != NULL)
+	{
+		PgbsonArrayWriterWriteValue(&arrayWriter, entry);
+	}
+
+	bson_value_t arrayValue = PgbsonArrayWriterGetValue(&arrayWriter);
+
+	int requiredByteSize = VARHDRSZ + sizeof(int64) + arrayValue.value.v_doc.data_len;
+	bytea *bytes = (bytea *) palloc(requiredByteSize);
+	SET_VARSIZE(bytes, requiredByteSize);
+
+	char *bytePointer = VARDATA(bytes);
+	memcpy(bytePointer, &state->currentSizeWritten, sizeof(int64));
+	bytePointer += sizeof(int64);
+	memcpy(bytePointer, arrayValue.value.v_doc.data, arrayValue.value.v_doc.data_len);
+
+	PgbsonWriterFree(&writer);
+	PG_RETURN_BYTEA_P(bytes);
+}
+
+
+/*
+ * The deserialfunc for the parallel BSON_ADD_TO_SET aggregate: Rebuilds the
+ * set written by bson_add_to_set_serialize in the aggregate context.
+ */
+Datum
+bson_add_to_set_deserialize(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	bytea *serializedBytes = PG_GETARG_BYTEA_PP(0);
+	const char *bytePointer = VARDATA_ANY(serializedBytes);
+	uint32_t arrayLength = VARSIZE_ANY_EXHDR(serializedBytes) - sizeof(int64);
+
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+
+	bytea *bytes = AllocateBsonAddToSetState();
+	BsonAddToSetState *state = (BsonAddToSetState *) VARDATA(bytes);
+	memcpy(&state->currentSizeWritten, bytePointer, sizeof(int64));
+	bytePointer += sizeof(int64);
+
+	/* The set references the values, so they're copied into the aggregate context */
+	bson_value_t arrayValue = { 0 };
+	arrayValue.value_type = BSON_TYPE_ARRAY;
+	arrayValue.value.v_doc.data = palloc(arrayLength);
+	arrayValue.value.v_doc.data_len = arrayLength;
+	memcpy(arrayValue.value.v_doc.data, bytePointer, arrayLength);
+
+	bson_iter_t arrayIter;
+	BsonValueInitIterator(&arrayValue, &arrayIter);
+	while (bson_iter_next(&arrayIter))
+	{
+		bool found = false;
+		hash_search(state->set, bson_iter_value(&arrayIter), HASH_ENTER, &found);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	PG_RETURN_POINTER(bytes);
+}
+
+
+/*
+ * The combinefunc for the parallel BSON_ADD_TO_SET aggregate: Adds the values
+ * of the second set to the first.
+ */
+Datum
+bson_add_to_set_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+		{
+			PG_RETURN_NULL();
+		}
+
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+
+	BsonAddToSetState *rightState = (BsonAddToSetState *) VARDATA(
+		PG_GETARG_POINTER(1));
+
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+
+	bytea *bytes = PG_ARGISNULL(0) ? AllocateBsonAddToSetState() :
+				   (bytea *) PG_GETARG_POINTER(0);
+	BsonAddToSetState *leftState = (BsonAddToSetState *) VARDATA(bytes);
+
+	HASH_SEQ_STATUS seq_status;
+	const bson_value_t *entry;
+	hash_seq_init(&seq_status, rightState->set);
+	while ((entry = hash_seq_search(&seq_status)) != NULL)
+	{
+		bool found = false;
+		hash_search(leftState->set, entry, HASH_ENTER, &found);
+		if (!found)
+		{
+			/* Track the same size the transition function does for the value */
+			pgbson *valueDocument = BsonValueToDocumentPgbson(entry);
+			leftState->currentSizeWritten += PgbsonGetBsonSize(valueDocument);
+			ReserveQueryMemory(aggregateContext, PgbsonGetBsonSize(valueDocument),
+							   "$addToSet");
+			pfree(valueDocument);
+
+			CheckAggregateIntermediateResultSize(leftState->currentSizeWritten);
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	PG_RETURN_POINTER(bytes);
+}
+
+
 /* --------------------------------------------------------- */
 /* Private helper methods */
 /* --------------------------------------------------------- */
@@ -1306,6 +1868,194 @@ AllocateBsonNumericAggState()
 }
 
 
+/*
+ * Allocates the state of bson_array_agg for a $group with an empty array
+ * started at the given path.
+ */
+static bytea *
+AllocateBsonArrayGroupAggState(const char *path)
+{
+	int bson_size = sizeof(BsonArrayAggState) + VARHDRSZ;
+	bytea *combinedStateBytes = (bytea *) palloc0(bson_size);
+	SET_VARSIZE(combinedStateBytes, bson_size);
+
+	BsonArrayAggState *state = (BsonArrayAggState *) VARDATA(combinedStateBytes);
+	state->isWindowAggregation = false;
+	state->currentSizeWritten = 0;
+	state->aggState.group.path = pstrdup(path);
+	PgbsonWriterInit(&state->aggState.group.writer);
+	PgbsonWriterStartArray(&state->aggState.group.writer, state->aggState.group.path,
+						   strlen(state->aggState.group.path),
+						   &state->aggState.group.arrayWriter);
+
+	return combinedStateBytes;
+}
+
+
+/*
+ * Allocates the state of BSON_ADD_TO_SET with an empty set.
+ */
+static bytea *
+AllocateBsonAddToSetState(void)
+{
+	int bson_size = sizeof(BsonAddToSetState) + VARHDRSZ;
+	bytea *combinedStateBytes = (bytea *) palloc0(bson_size);
+	SET_VARSIZE(combinedStateBytes, bson_size);
+
+	BsonAddToSetState *state = (BsonAddToSetState *) VARDATA(combinedStateBytes);
+	state->currentSizeWritten = 0;
+	state->set = CreateBsonValueHashSet();
+	state->isWindowAggregation = false;
+
+	return combinedStateBytes;
+}
+
+
+/*
+ * Appends each of the values of the given bson array to the array writer.
+ */
+static void
+AppendBsonArrayValues(pgbson_array_writer *arrayWriter, const bson_value_t *arrayValue)
+{
+	bson_iter_t arrayIter;
+	BsonValueInitIterator(arrayValue, &arrayIter);
+	while (bson_iter_next(&arrayIter))
+	{
+		PgbsonArrayWriterWriteValue(arrayWriter, bson_iter_value(&arrayIter));
+	}
+}
+
+
+#ifdef HAVE_INT128
+
+/*
+ * Gets the signed coefficient and the exponent of a finite, non zero decimal128
+ * value in the canonical (small coefficient) encoding.
+ * Returns false for any other value (large coefficient encodings, infinities, NaN,
+ * and zeros, whose sign an integer coefficient can't preserve).
+ */
+static bool
+TryGetDecimal128Coefficient(const bson_value_t *value, int128 *coefficient,
+							int32_t *exponent)
+{
+	if (value->value_type != BSON_TYPE_DECIMAL128)
+	{
+		return false;
+	}
+
+	uint64_t high = value->value.v_decimal128.high;
+	uint64_t low = value->value.v_decimal128.low;
+	if ((high & DECIMAL128_COMBINATION_LARGE_MASK) == DECIMAL128_COMBINATION_LARGE_MASK)
+	{
+		return false;
+	}
+
+	/* Non canonical coefficients are zeros by the spec */
+	int128 result = ((int128) (high & DECIMAL128_COEFFICIENT_HIGH_MASK) << 64) | low;
+	if (result == 0 || result >= DECIMAL128_MAX_COEFFICIENT_PLUS_ONE)
+	{
+		return false;
+	}
+
+	*coefficient = (high & DECIMAL128_SIGN_MASK) ? -result : result;
+	*exponent = (int32_t) ((high >> DECIMAL128_EXPONENT_SHIFT) & DECIMAL128_EXPONENT_MASK);
+	return true;
+}
+
+
+#endif
+
+
+/*
+ * Adds a decimal128 value to the state's sum through the pending coefficient sum.
+ * Once the sum is a decimal128, decimal128 values with the same exponent are added
+ * as int128 coefficients for as long as the result is non zero and fits the 34
+ * digits of decimal128 precision. Such an addition is exact, and its result keeps
+ * the exponent, so it is the same decimal128 that the per-row add would produce:
+ * The pending coefficient stands for the whole sum, and the sum is only written
+ * back by FlushPendingDecimal128Sum.
+ * Returns false (with the pending sum flushed) if the value must be added to the
+ * sum by the general path instead.
+ */
+static bool
+TryAddDecimal128ToPendingSum(BsonNumericAggState *state, const bson_value_t *value)
+{
+#ifdef HAVE_INT128
+	int128 coefficient;
+	int32_t exponent;
+	if (!EnableDecimal128SumFastPath ||
+		!TryGetDecimal128Coefficient(value, &coefficient, &exponent))
+	{
+		FlushPendingDecimal128Sum(state);
+		return false;
+	}
+
+	int128 pending;
+	int32_t pendingExponent;
+	if (state->hasPendingDecimalSum)
+	{
+		pending = (int128) ((((uint128) state->pendingDecimalCoefficientHigh) << 64) |
+							state->pendingDecimalCoefficientLow);
+		pendingExponent = state->pendingDecimalExponent;
+	}
+	else if (!TryGetDecimal128Coefficient(&state->sum, &pending, &pendingExponent))
+	{
+		/* The sum isn't a decimal128 yet: the general path converts it */
+		return false;
+	}
+
+	int128 newPending = pending + coefficient;
+	if (pendingExponent != exponent || newPending == 0 ||
+		newPending >= DECIMAL128_MAX_COEFFICIENT_PLUS_ONE ||
+		newPending <= -DECIMAL128_MAX_COEFFICIENT_PLUS_ONE)
+	{
+		FlushPendingDecimal128Sum(state);
+		return false;
+	}
+
+	state->hasPendingDecimalSum = true;
+	state->pendingDecimalExponent = exponent;
+	state->pendingDecimalCoefficientHigh = (uint64_t) ((uint128) newPending >> 64);
+	state->pendingDecimalCoefficientLow = (uint64_t) newPending;
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+/*
+ * Writes the pending decimal128 coefficient sum (if any) back as the state's sum.
+ */
+static void
+FlushPendingDecimal128Sum(BsonNumericAggState *state)
+{
+#ifdef HAVE_INT128
+	if (!state->hasPendingDecimalSum)
+	{
+		return;
+	}
+
+	int128 pending = (int128) ((((uint128) state->pendingDecimalCoefficientHigh) << 64) |
+							   state->pendingDecimalCoefficientLow);
+	uint64_t sign = 0;
+	if (pending < 0)
+	{
+		sign = DECIMAL128_SIGN_MASK;
+		pending = -pending;
+	}
+
+	state->sum.value_type = BSON_TYPE_DECIMAL128;
+	state->sum.value.v_decimal128.low = (uint64_t) pending;
+	state->sum.value.v_decimal128.high =
+		sign |
+		((uint64_t) state->pendingDecimalExponent << DECIMAL128_EXPONENT_SHIFT) |
+		((uint64_t) ((uint128) pending >> 64) & DECIMAL128_COEFFICIENT_HIGH_MASK);
+	state->hasPendingDecimalSum = false;
+#endif
+}
+
+
 void
 CheckAggregateIntermediateResultSize(uint32_t size)
 {
@@ -52,9 +52,13 @@
 #include "aggregation/bson_aggregation_pipeline_private.h"
 #include "api_hooks.h"
 
+extern bool EnableListCollectionsNamePushdown;
+
 static Query * GenerateBaseListCollectionsQuery(Datum databaseDatum, bool nameOnly,
 												bool addDistributedMetadata,
+												List *collectionNames,
 												AggregationPipelineBuildContext *context);
+static List * ExtractListCollectionsNameFilter(const bson_value_t *filter);
 static Query * HandleListCollectionsProjector(Query *query,
 											  AggregationPipelineBuildContext *context,
 											  bool nameOnly, bool addDistributedMetadata);
@@ -191,9 +195,16 @@ GenerateListCollectionsQuery(text *databaseDatum, pgbson *listCollectionsSpec,
 							"Required field database must be valid")));
 	}
 
+	List *collectionNames = NIL;
+	if (EnableListCollectionsNamePushdown && filter.value_type != BSON_TYPE_EOD)
+	{
+		collectionNames = ExtractListCollectionsNameFilter(&filter);
+	}
+
 	Query *query = GenerateBaseListCollectionsQuery(PointerGetDatum(databaseDatum),
 													nameOnly,
-													distributedMetadata, &context);
+													distributedMetadata,
+													collectionNames, &context);
 	queryData->namespaceName = context.namespaceName;
 
 	query = HandleListCollectionsProjector(query, &context, nameOnly,
@@ -373,6 +384,56 @@ HandleCurrentOp(const bson_value_t *existingValue, Query *query,
 }
 
 
+/*
+ * Mutates the query to process the $queryStats aggregation stage
+ * Stage parameters:
+ * { }
+ * This stage will form the query
+ * SELECT document FROM ApiInternalSchemaNameV2.query_shape_stats(false);
+ * Requires this to be the first stage, so the prior query is discarded.
+ */
+Query *
+HandleQueryStats(const bson_value_t *existingValue, Query *query,
+				 AggregationPipelineBuildContext *context)
+{
+	ReportFeatureUsage(FEATURE_STAGE_QUERY_STATS);
+	EnsureTopLevelFieldValueType("pipeline.$queryStats", existingValue,
+								 BSON_TYPE_DOCUMENT);
+
+	bson_iter_t specIter;
+	BsonValueInitIterator(existingValue, &specIter);
+	if (bson_iter_next(&specIter))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+						errmsg(
+							"The BSON field $queryStats.%s is not recognized as a valid field",
+							bson_iter_key(&specIter))));
+	}
+
+	if (context->stageNum != 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40602),
+						errmsg(
+							"The $queryStats can only be used as the initial stage in the pipeline.")));
+	}
+
+	const char *databaseStr = text_to_cstring(context->databaseNameDatum);
+	if (strcmp(databaseStr, "admin") != 0 ||
+		query->jointree->fromlist != NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDNAMESPACE),
+						errmsg(
+							"$queryStats must be executed on the 'admin' database with parameter {aggregate: 1}")));
+	}
+
+	bool resetAfterRead = false;
+	List *args = list_make1(makeConst(BOOLOID, -1, InvalidOid, 1,
+									  BoolGetDatum(resetAfterRead), false, true));
+	bool isMultiRow = true;
+	return BuildSingleFunctionQuery(QueryShapeStatsFunctionId(), args, isMultiRow);
+}
+
+
 /*
  * Generates the base query that queries the ApiCatalogSchemaName.collection_indexes
  * for a listIndexes scenario.
@@ -519,11 +580,14 @@ GenerateBaseListIndexesQuery(text *databaseDatum, const StringView *collectionNa
 
 /*
  * Generates the base table that queries the ApiCatalogSchemaName.collections
- * for a listCollections scenario.
+ * for a listCollections scenario. If collectionNames is not NIL, only the
+ * collections with one of those names are read, so that the lookup can use the
+ * (database_name, collection_name) index instead of scanning the database.
  */
 static Query *
 GenerateBaseListCollectionsQuery(Datum databaseDatum, bool nameOnly,
 								 bool addDistributedMetadata,
+								 List *collectionNames,
 								 AggregationPipelineBuildContext *context)
 {
 	Query *query = makeNode(Query);
@@ -584,8 +648,29 @@ GenerateBaseListCollectionsQuery(Datum databaseDatum, bool nameOnly,
 								  (Expr *) collectionVar, (Expr *) systemCollection,
 								  InvalidOid, DEFAULT_COLLATION_OID);
 
+	List *quals = list_make2(opExpr, notExpr);
+	if (collectionNames != NIL)
+	{
+		List *nameQuals = NIL;
+		ListCell *nameCell;
+		foreach(nameCell, collectionNames)
+		{
+			StringView *collectionName = lfirst(nameCell);
+			Const *nameConst = MakeTextConst(collectionName->string,
+											 collectionName->length);
+			nameQuals = lappend(nameQuals,
+								make_opclause(TextEqualOperatorId(), BOOLOID, false,
+											  (Expr *) copyObject(collectionVar),
+											  (Expr *) nameConst,
+											  InvalidOid, DEFAULT_COLLATION_OID));
+		}
+
+		quals = lappend(quals, list_length(nameQuals) == 1 ?
+						linitial(nameQuals) : make_orclause(nameQuals));
+	}
+
 	query->jointree = makeFromExpr(list_make1(rtr), (Node *) make_ands_explicit(
-									   list_make2(opExpr, notExpr)));
+									   quals));
 
 	/* Add a row_get_bson to make it a single bson document */
 	Var *rowExpr = makeVar(1, 0, ApiCatalogCollectionsTypeOid(), -1, InvalidOid, 0);
@@ -605,6 +690,89 @@ GenerateBaseListCollectionsQuery(Datum databaseDatum, bool nameOnly,
 }
 
 
+/*
+ * Returns the collection names that a listCollections filter restricts the
+ * "name" field to, or NIL if it doesn't. Only top level { name: "a" },
+ * { name: { $eq: "a" } } and { name: { $in: [ "a", "b" ] } } are recognized:
+ * the full filter is still applied on top of the catalog query, so this only
+ * needs to keep every collection that the filter could match.
+ */
+static List *
+ExtractListCollectionsNameFilter(const bson_value_t *filter)
+{
+	bson_iter_t filterIter;
+	BsonValueInitIterator(filter, &filterIter);
+	while (bson_iter_next(&filterIter))
+	{
+		if (strcmp(bson_iter_key(&filterIter), "name") != 0)
+		{
+			continue;
+		}
+
+		const bson_value_t *nameValue = bson_iter_value(&filterIter);
+		if (nameValue->value_type == BSON_TYPE_UTF8)
+		{
+			StringView *name = palloc(sizeof(StringView));
+			name->string = nameValue->value.v_utf8.str;
+			name->length = nameValue->value.v_utf8.len;
+			return list_make1(name);
+		}
+
+		if (nameValue->value_type != BSON_TYPE_DOCUMENT)
+		{
+			return NIL;
+		}
+
+		bson_iter_t operatorIter;
+		BsonValueInitIterator(nameValue, &operatorIter);
+		if (!bson_iter_next(&operatorIter))
+		{
+			return NIL;
+		}
+
+		const char *operatorName = bson_iter_key(&operatorIter);
+		const bson_value_t *operatorValue = bson_iter_value(&operatorIter);
+		List *names = NIL;
+		if (strcmp(operatorName, "$eq") == 0 &&
+			operatorValue->value_type == BSON_TYPE_UTF8)
+		{
+			StringView *name = palloc(sizeof(StringView));
+			name->string = operatorValue->value.v_utf8.str;
+			name->length = operatorValue->value.v_utf8.len;
+			names = list_make1(name);
+		}
+		else if (strcmp(operatorName, "$in") == 0 &&
+				 operatorValue->value_type == BSON_TYPE_ARRAY)
+		{
+			bson_iter_t inIter;
+			BsonValueInitIterator(operatorValue, &inIter);
+			while (bson_iter_next(&inIter))
+			{
+				/* Regexes or other types can't be looked up by name */
+				if (!BSON_ITER_HOLDS_UTF8(&inIter))
+				{
+					return NIL;
+				}
+
+				StringView *name = palloc(sizeof(StringView));
+				name->string = bson_iter_utf8(&inIter, &name->length);
+				names = lappend(names, name);
+			}
+		}
+
+		/* More operators on name: leave them all to the match */
+		if (bson_iter_next(&operatorIter))
+		{
+			return NIL;
+		}
+
+		return names;
+	}
+
+	return NIL;
+}
+
+
 /*
  * Modifies the query to handle the $collStats stage.
  */
@@ -44,6 +44,7 @@
 #include "utils/feature_counter.h"
 #include "utils/version_utils.h"
 #include "operators/bson_expression.h"
+#include "infrastructure/collection_join_stats.h"
 
 #include "aggregation/bson_aggregation_pipeline_private.h"
 
@@ -51,6 +52,9 @@ const int MaximumLookupPipelineDepth = 20;
 extern bool EnableLookupIdJoinOptimizationOnCollation;
 extern bool EnableNowSystemVariable;
 extern bool EnableLookupInnerJoin;
+extern bool EnableGraphLookupTraversal;
+extern bool EnableFacetSharedInput;
+extern bool EnableFlatUnionWithAppend;
 
 /*
  * Struct having parsed view of the
@@ -278,7 +282,13 @@ static Query * BuildRecursiveGraphLookupQuery(QuerySource parentSource,
 											  AggregationPipelineBuildContext *
 											  parentContext,
 											  CommonTableExpr *baseCteExpr, int levelsUp);
+static void RecordJoinedCollection(AggregationPipelineBuildContext *context,
+								   const MongoCollection *joinedCollection);
+static Const * BuildGraphLookupTraverseSpec(GraphLookupArgs *args,
+											AggregationPipelineBuildContext *
+											parentContext);
 static void ValidateUnionWithPipeline(const bson_value_t *pipeline, bool hasCollection);
+static Query * TryGetUnionWithSetOperationQuery(Query *query);
 
 static void ValidateLetHasNoVariables(AggregationExpressionData *parsedData);
 static void WalkQueryAndSetLevelsUp(Query *query, Var *varToCheck,
@@ -379,6 +389,18 @@ HandleFacet(const bson_value_t *existingValue, Query *query,
 								context->nestedPipelineLevel);
 	baseCte->ctequery = (Node *) query;
 
+	/*
+	 * With more than one facet, every facet reads the base CTE. Force it to be
+	 * materialized so that the input pipeline runs once and each facet reads the
+	 * materialized documents: Otherwise a planner that inlines the CTE (e.g. for
+	 * distributed queries) runs the input pipeline and its scan once per facet.
+	 * A single facet reads the input once either way and stays inlined.
+	 */
+	if (EnableFacetSharedInput && numStages > 1)
+	{
+		baseCte->ctematerialized = CTEMaterializeAlways;
+	}
+
 	/* Second step: Build UNION ALL query */
 	Query *finalQuery = BuildFacetUnionAllQuery(numStages, existingValue, baseCte,
 												query->querySource,
@@ -1082,6 +1104,7 @@ HandleUnionWith(const bson_value_t *existingValue, Query *query,
 											collectionUuid,
 											indexHint,
 											&subPipelineContext);
+		RecordJoinedCollection(context, subPipelineContext.mongoCollection);
 	}
 	else
 	{
@@ -1108,6 +1131,7 @@ HandleUnionWith(const bson_value_t *existingValue, Query *query,
 												collectionUuid,
 												indexHint,
 												&subPipelineContext);
+			RecordJoinedCollection(context, subPipelineContext.mongoCollection);
 		}
 
 		if (pipelineValue.value_type != BSON_TYPE_EOD)
@@ -1123,6 +1147,33 @@ HandleUnionWith(const bson_value_t *existingValue, Query *query,
 	}
 
 	bool includeAllColumns = false;
+
+	/*
+	 * A chain of $unionWith stages would otherwise nest one 2 armed UNION ALL per
+	 * stage. Add the new arm to the UNION ALL of the prior $unionWith instead so
+	 * that all arms end up under one Append, which the planner can run as a
+	 * Parallel Append: The latency is then bounded by the slowest arm rather than
+	 * the sum of all of them.
+	 */
+	Query *priorUnionQuery = EnableFlatUnionWithAppend ?
+							 TryGetUnionWithSetOperationQuery(query) : NULL;
+	if (priorUnionQuery != NULL)
+	{
+		RangeTblEntry *rightRte = MakeSubQueryRte(rightQuery, context->stageNum, 0,
+												  "unionRight",
+												  includeAllColumns);
+		priorUnionQuery->rtable = lappend(priorUnionQuery->rtable, rightRte);
+
+		RangeTblRef *rightReference = makeNode(RangeTblRef);
+		rightReference->rtindex = list_length(priorUnionQuery->rtable);
+
+		SetOperationStmt *setOpStatement = MakeBsonSetOpStatement();
+		setOpStatement->larg = priorUnionQuery->setOperations;
+		setOpStatement->rarg = (Node *) rightReference;
+		priorUnionQuery->setOperations = (Node *) setOpStatement;
+		return query;
+	}
+
 	RangeTblEntry *leftRte = MakeSubQueryRte(leftQuery, context->stageNum, 0,
 											 "unionLeft",
 											 includeAllColumns);
@@ -1164,6 +1215,61 @@ HandleUnionWith(const bson_value_t *existingValue, Query *query,
 }
 
 
+/*
+ * Returns the UNION ALL query built by a $unionWith if the query is exactly the
+ * output of a prior $unionWith stage with no other stage applied on top of it.
+ * Returns NULL otherwise.
+ */
+static Query *
+TryGetUnionWithSetOperationQuery(Query *query)
+{
+	if (list_length(query->rtable) != 1 || query->jointree == NULL ||
+		list_length(query->jointree->fromlist) != 1 ||
+		query->jointree->quals != NULL || list_length(query->targetList) != 1 ||
+		query->hasAggs || query->hasWindowFuncs || query->hasTargetSRFs ||
+		query->hasSubLinks || query->groupClause != NIL ||
+		query->sortClause != NIL || query->limitCount != NULL ||
+		query->limitOffset != NULL || query->cteList != NIL ||
+		query->distinctClause != NIL)
+	{
+		return NULL;
+	}
+
+	TargetEntry *entry = linitial(query->targetList);
+	RangeTblEntry *rte = linitial(query->rtable);
+	if (!IsA(entry->expr, Var) || rte->rtekind != RTE_SUBQUERY)
+	{
+		return NULL;
+	}
+
+	/* The prior $unionWith may have been fenced, e.g. for EXPLAIN */
+	Query *unionQuery = rte->subquery;
+	if (unionQuery->setOperations == NULL ||
+		!IsA(unionQuery->setOperations, SetOperationStmt) ||
+		unionQuery->limitCount != NULL || unionQuery->limitOffset != NULL ||
+		unionQuery->sortClause != NIL || unionQuery->cteList != NIL)
+	{
+		return NULL;
+	}
+
+	SetOperationStmt *setOpStatement = (SetOperationStmt *) unionQuery->setOperations;
+	if (setOpStatement->op != SETOP_UNION || !setOpStatement->all)
+	{
+		return NULL;
+	}
+
+	/* Only the UNION ALL of $unionWith has "unionLeft" as its first arm */
+	RangeTblEntry *leftRte = linitial(unionQuery->rtable);
+	if (leftRte->alias == NULL ||
+		strncmp(leftRte->alias->aliasname, "unionLeft", strlen("unionLeft")) != 0)
+	{
+		return NULL;
+	}
+
+	return unionQuery;
+}
+
+
 /*
  * Validates the facet pipeline definition.
  */
@@ -2333,6 +2439,7 @@ ProcessLookupCoreWithLet(Query *query, AggregationPipelineBuildContext *context,
 
 	LookupOptimizationArgs optimizationArgs = { 0 };
 	OptimizeLookup(lookupArgs, leftQuery, context, &optimizationArgs);
+	RecordJoinedCollection(context, optimizationArgs.rightQueryContext.mongoCollection);
 
 	/* Generate the lookup query */
 	/* Start with a fresh query */
@@ -3488,6 +3595,22 @@ BuildGraphLookupCteQuery(QuerySource parentSource,
 	Var *firstVar = makeVar(graphLookupRef->rtindex, 1, BsonTypeId(), -1, InvalidOid, 0);
 	TargetEntry *firstEntry = makeTargetEntry((Expr *) firstVar, 1, "document", false);
 
+	Const *traverseSpec = BuildGraphLookupTraverseSpec(args, parentContext);
+	if (traverseSpec != NULL)
+	{
+		/* bson_dollar_graph_lookup_traverse(inputExpr, spec) */
+		Var *inputExprVar = makeVar(graphLookupRef->rtindex, 2, BsonTypeId(), -1,
+									InvalidOid, 0);
+		FuncExpr *traverseExpr = makeFuncExpr(
+			BsonDollarGraphLookupTraverseFunctionOid(), BsonTypeId(),
+			list_make2(inputExprVar, traverseSpec), InvalidOid, InvalidOid,
+			COERCE_EXPLICIT_CALL);
+		TargetEntry *secondEntry = makeTargetEntry((Expr *) traverseExpr, 2,
+												   "addFields", false);
+		graphLookupQuery->targetList = list_make2(firstEntry, secondEntry);
+		return graphLookupQuery;
+	}
+
 	/* The subquery for the recursive CTE goes here:
 	 * The CTE goes 2 levels up since it has to go through this graphLookupQuery (1)
 	 * to the parent query (2)
@@ -3515,6 +3638,97 @@ BuildGraphLookupCteQuery(QuerySource parentSource,
 }
 
 
+/*
+ * Builds the spec for the breadth first traversal of a $graphLookup in
+ * bson_dollar_graph_lookup_traverse. Returns NULL if the traversal does not
+ * apply and the recursive CTE needs to be used instead: The traversal queries
+ * the collection directly, so it applies only to unsharded collections (not
+ * views), and it does not support let variables or collations.
+ */
+static Const *
+BuildGraphLookupTraverseSpec(GraphLookupArgs *args,
+							 AggregationPipelineBuildContext *parentContext)
+{
+	if (!EnableGraphLookupTraversal ||
+		!IsClusterVersionAtleast(DocDB_V0, 108, 0) ||
+		parentContext->variableSpec != NULL ||
+		IsCollationApplicable(parentContext->collationString))
+	{
+		return NULL;
+	}
+
+	Datum collectionNameDatum = PointerGetDatum(
+		cstring_to_text_with_len(args->fromCollection.string,
+								 args->fromCollection.length));
+	MongoCollection *collection = GetMongoCollectionOrViewByNameDatum(
+		parentContext->databaseNameDatum, collectionNameDatum, AccessShareLock);
+	if (collection == NULL || collection->viewDefinition != NULL ||
+		collection->shardKey != NULL)
+	{
+		return NULL;
+	}
+
+	if (args->restrictSearch.value_type != BSON_TYPE_EOD)
+	{
+		/* Validate the restrictSearch filter the same way as the recursive query */
+		AggregationPipelineBuildContext subPipelineContext = { 0 };
+		subPipelineContext.nestedPipelineLevel = parentContext->nestedPipelineLevel + 2;
+		subPipelineContext.databaseNameDatum = parentContext->databaseNameDatum;
+		pg_uuid_t *collectionUuid = NULL;
+		bson_value_t *indexHint = NULL;
+		Query *restrictQuery = GenerateBaseTableQuery(parentContext->databaseNameDatum,
+													  &args->fromCollection,
+													  collectionUuid, indexHint,
+													  &subPipelineContext);
+		restrictQuery = HandleMatch(&args->restrictSearch, restrictQuery,
+									&subPipelineContext);
+		if (restrictQuery->sortClause != NIL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION5626500),
+							errmsg(
+								"$near, $nearSphere and $geoNear cannot be used here. Use $geoWithin instead.")));
+		}
+	}
+
+	RecordJoinedCollection(parentContext, collection);
+
+	pgbson_writer specWriter;
+	PgbsonWriterInit(&specWriter);
+	PgbsonWriterAppendInt64(&specWriter, "collectionId", 12,
+							(int64) collection->collectionId);
+	PgbsonWriterAppendUtf8(&specWriter, "connectToField", 14,
+						   CreateStringFromStringView(&args->connectToField));
+
+	pgbson_writer connectFromWriter;
+	PgbsonWriterStartDocument(&specWriter, "connectFromExpression", 21,
+							  &connectFromWriter);
+	PgbsonWriterAppendValue(&connectFromWriter, "$makeArray", 10,
+							&args->connectFromFieldExpression);
+	PgbsonWriterEndDocument(&specWriter, &connectFromWriter);
+
+	PgbsonWriterAppendUtf8(&specWriter, "as", 2,
+						   CreateStringFromStringView(&args->asField));
+	if (args->depthField.length > 0)
+	{
+		PgbsonWriterAppendUtf8(&specWriter, "depthField", 10,
+							   CreateStringFromStringView(&args->depthField));
+	}
+
+	if (args->maxDepth >= 0 && args->maxDepth != INT32_MAX)
+	{
+		PgbsonWriterAppendInt32(&specWriter, "maxDepth", 8, args->maxDepth);
+	}
+
+	if (args->restrictSearch.value_type != BSON_TYPE_EOD)
+	{
+		PgbsonWriterAppendValue(&specWriter, "restrictSearch", 14,
+								&args->restrictSearch);
+	}
+
+	return MakeBsonConst(PgbsonWriterGetPgbson(&specWriter));
+}
+
+
 /*
  * Creates an expression for bson_expression_get(document, '{ "_id": "$_id"}', true)
  */
@@ -3555,6 +3769,7 @@ GenerateBaseCaseQuery(AggregationPipelineBuildContext *parentContext,
 	Query *baseCaseQuery = GenerateBaseTableQuery(parentContext->databaseNameDatum,
 												  &args->fromCollection, collectionUuid,
 												  indexHint, &subPipelineContext);
+	RecordJoinedCollection(parentContext, subPipelineContext.mongoCollection);
 
 	/* Citus doesn't suppor this scenario: ERROR:  recursive CTEs are not supported in distributed queries */
 	if (subPipelineContext.mongoCollection != NULL &&
@@ -4168,3 +4383,23 @@ ValidateLetHasNoVariables(AggregationExpressionData *parsedExpression)
 							   nameWithoutPrefix)));
 	}
 }
+
+
+/*
+ * Counts a join of the collection by a $lookup, $graphLookup or $unionWith
+ * stage of the pipeline on the collection of the context. This is used to
+ * advise colocating collections that are often joined together.
+ */
+static void
+RecordJoinedCollection(AggregationPipelineBuildContext *context,
+					   const MongoCollection *joinedCollection)
+{
+	if (context->mongoCollection == NULL || joinedCollection == NULL ||
+		joinedCollection->viewDefinition != NULL)
+	{
+		return;
+	}
+
+	RecordCollectionJoin(context->mongoCollection->collectionId,
+						 joinedCollection->collectionId);
+}
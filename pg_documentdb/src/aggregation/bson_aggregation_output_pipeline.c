@@ -123,6 +123,9 @@ extern bool EnableCollation;
 /* GUC to enable schema validation */
 extern bool EnableSchemaValidation;
 
+/* GUC to write $out through an INSERT .. SELECT instead of a MERGE */
+extern bool EnableOutInsertSelect;
+
 static void ParseMergeStage(const bson_value_t *existingValue, const
 							char *currentNameSpace, MergeArgs *args);
 static void ParseOutStage(const bson_value_t *existingValue, const char *currentNameSpace,
@@ -183,6 +186,7 @@ static inline TargetEntry * MakeExtractFuncExprForMergeTE(const char *onField, u
 														  length, Var *sourceDocument,
 														  const int resNum);
 static void TruncateDataTable(int collectionId);
+static Query * ConvertOutMergeToInsertSelect(Query *query, MergeAction *insertAction);
 static inline bool CheckSchemaValidationEnabledForDollarMergeOut(void);
 static inline void ValidateTargetNameSpaceForOutputStage(const StringView *targetDB,
 														 const StringView *
@@ -2047,12 +2051,19 @@ HandleOut(const bson_value_t *existingValue, Query *query,
 	Var *targetShardKeyValueVar = makeVar(targetCollectionVarNo,
 										  targetShardKeyValueAttrNo, INT8OID, -1, 0, 0);
 
-	query->mergeActionList = list_make1(MakeActionWhenNotMatched(WhenNotMatched_INSERT,
-																 sourceDocVar,
-																 generatedObjectIdVar,
-																 sourceShardKeyValueVar,
-																 targetCollection,
-																 schemaValidatorInfoConst));
+	MergeAction *insertAction = MakeActionWhenNotMatched(WhenNotMatched_INSERT,
+														 sourceDocVar,
+														 generatedObjectIdVar,
+														 sourceShardKeyValueVar,
+														 targetCollection,
+														 schemaValidatorInfoConst);
+
+	if (EnableOutInsertSelect)
+	{
+		return ConvertOutMergeToInsertSelect(query, insertAction);
+	}
+
+	query->mergeActionList = list_make1(insertAction);
 
 	/* Write the join condition for $out, which will be in the form of
 	 * `ON target.shard_key_value = source.target_shard_key_value`
@@ -2081,6 +2092,42 @@ HandleOut(const bson_value_t *existingValue, Query *query,
 }
 
 
+/*
+ * The target of $out is always empty when the query runs (freshly created or
+ * truncated), so every source row takes the not matched action of the MERGE.
+ * This rewrites the MERGE into an INSERT .. SELECT with the same target list,
+ * which saves the executor the join against the target and the per row
+ * action evaluation, leaving a plain bulk insert of the source rows.
+ */
+static Query *
+ConvertOutMergeToInsertSelect(Query *query, MergeAction *insertAction)
+{
+	query->commandType = CMD_INSERT;
+	query->targetList = insertAction->targetList;
+	query->mergeActionList = NIL;
+
+#if PG_VERSION_NUM >= 170000
+	query->mergeTargetRelation = 0;
+#else
+	query->mergeUseOuterJoin = false;
+#endif
+
+	RangeTblEntry *targetRte = linitial(query->rtable);
+#if PG_VERSION_NUM >= 160000
+	RTEPermissionInfo *permInfo = getRTEPermissionInfo(query->rteperminfos, targetRte);
+	permInfo->requiredPerms = ACL_INSERT;
+#else
+	targetRte->requiredPerms = ACL_INSERT;
+#endif
+
+	/* The source query is the only relation scanned */
+	RangeTblRef *rtr = makeNode(RangeTblRef);
+	rtr->rtindex = 2;
+	query->jointree = makeFromExpr(list_make1(rtr), NULL);
+	return query;
+}
+
+
 /*
  * Truncate data table corresponding to the input collection id.
  */
@@ -12,6 +12,7 @@
 #include <float.h>
 #include <fmgr.h>
 #include <miscadmin.h>
+#include <common/int.h>
 #include <optimizer/optimizer.h>
 
 #include <access/table.h>
@@ -50,11 +51,14 @@
 #include "query/query_operator.h"
 #include "planner/documentdb_planner.h"
 #include "aggregation/bson_aggregation_pipeline.h"
+#include "aggregation/bson_aggregation_query_cache.h"
 #include "aggregation/bson_aggregation_window_operators.h"
 #include "commands/parse_error.h"
+#include "commands/columnar_projection.h"
 #include "commands/commands_common.h"
 #include "commands/defrem.h"
 #include "utils/feature_counter.h"
+#include "utils/query_memory_budget.h"
 #include "utils/version_utils.h"
 #include "aggregation/bson_query.h"
 #include "metadata/index.h"
@@ -62,6 +66,7 @@
 #include "aggregation/bson_aggregation_pipeline_private.h"
 #include "aggregation/bson_bucket_auto.h"
 #include "api_hooks.h"
+#include "infrastructure/wait_events.h"
 #include "vector/vector_common.h"
 #include "aggregation/bson_project.h"
 #include "operators/bson_expression.h"
@@ -70,6 +75,7 @@
 #include "geospatial/bson_geospatial_common.h"
 #include "geospatial/bson_geospatial_geonear.h"
 #include "aggregation/bson_densify.h"
+#include "aggregation/bson_timeseries.h"
 #include "collation/collation.h"
 #include "api_hooks.h"
 
@@ -80,9 +86,23 @@ extern int MaxAggregationStagesAllowed;
 extern bool EnableIndexOrderbyPushdown;
 extern bool EnableIndexHintSupport;
 extern bool EnableIndexOrderbyPushdownLegacy;
+extern bool EnableParallelGroupAccumulators;
+extern bool EnableSortLimitProjectionDeferral;
+extern bool EnableOutInsertSelect;
+extern bool EnableUnwindGroupFusion;
+extern bool EnableBsonCountAggregate;
+extern bool EnablePipelineStageRewrites;
+extern bool EnableApproxCountDistinct;
+extern bool EnableExactPercentile;
+extern bool EnableGroupFirstRowPerGroup;
+extern bool EnableRankFusionStage;
 
 /* GUC to config tdigest compression */
 extern int TdigestCompressionAccuracy;
+extern double SampleBlockScanMaxFraction;
+extern bool SeparateAggregationStagesInPlan;
+extern bool EnableOrBranchSortMerge;
+extern bool EnableColumnarProjectionStore;
 
 /*
  * The mutation function that modifies a given query with a pipeline stage's value.
@@ -151,6 +171,16 @@ typedef struct AggregationStageDefinition
 } AggregationStageDefinition;
 
 
+static Query * GenerateAggregationQueryCore(text *database, pgbson *aggregationSpec,
+											QueryData *queryData, bool addCursorParams,
+											bool setStatementTimeout);
+static Query * GenerateFindQueryCore(text *databaseDatum, pgbson *findSpec,
+									 QueryData *queryData, bool addCursorParams,
+									 bool setStatementTimeout);
+static Query * GenerateCountQueryCore(text *databaseDatum, pgbson *countSpec,
+									  bool setStatementTimeout);
+static Query * GenerateDistinctQueryCore(text *databaseDatum, pgbson *distinctSpec,
+										 bool setStatementTimeout);
 static void AddCursorFunctionsToQuery(Query *query, Query *baseQuery,
 									  QueryData *queryData,
 									  AggregationPipelineBuildContext *context,
@@ -161,6 +191,16 @@ static void AddQualifierForTailableQuery(Query *query, Query *baseQuery,
 										 context);
 static void SetBatchSize(const char *fieldName, const bson_value_t *value,
 						 QueryData *queryData);
+static void SetMaxParallelWorkers(const char *fieldName, const bson_value_t *value,
+								  QueryData *queryData);
+static bool TryGetOrBranchSortLimit(const bson_value_t *filter, const bson_value_t *sort,
+									const bson_value_t *skip, const bson_value_t *limit,
+									int64_t *branchLimit);
+static Query * GenerateOrBranchUnionQuery(const bson_value_t *filter,
+										  const bson_value_t *sort, int64_t branchLimit,
+										  const StringView *collectionName,
+										  pg_uuid_t *collectionUuid,
+										  AggregationPipelineBuildContext *context);
 
 static int CompareStageByStageName(const void *a, const void *b);
 static bool IsDefaultJoinTree(Node *node);
@@ -184,12 +224,20 @@ static Query * HandleProject(const bson_value_t *existingValue, Query *query,
 static Query * HandleProjectFind(const bson_value_t *existingValue,
 								 const bson_value_t *queryValue, Query *query,
 								 AggregationPipelineBuildContext *context);
+static Query * HandleRankFusion(const bson_value_t *existingValue, Query *query,
+								AggregationPipelineBuildContext *context);
+static void AppendRankFusionInputStages(pgbson_array_writer *pipelineWriter,
+										const bson_value_t *inputPipeline,
+										double weight);
 static Query * HandleRedact(const bson_value_t *existingValue, Query *query,
 							AggregationPipelineBuildContext *context);
 static Query * HandleReplaceRoot(const bson_value_t *existingValue, Query *query,
 								 AggregationPipelineBuildContext *context);
 static Query * HandleReplaceWith(const bson_value_t *existingValue, Query *query,
 								 AggregationPipelineBuildContext *context);
+static bool IsSampleSmallForBlockScan(Oid relationId, double sampleSize);
+static Aggref * CreateCountStarAggregate(Oid aggregateFunctionId,
+										 ParseState *parseState);
 static Query * HandleSample(const bson_value_t *existingValue, Query *query,
 							AggregationPipelineBuildContext *context);
 static Query * HandleSkip(const bson_value_t *existingValue, Query *query,
@@ -230,6 +278,9 @@ static bool CanInlineLookupStageMatch(const bson_value_t *stageValue, const
 									  StringView *lookupPath, bool hasLet);
 
 static bool CheckFuncExprBsonDollarProjectGeonear(const FuncExpr *funcExpr);
+static bool IsDeferrableProjectionFunction(Oid functionOid);
+static Query * DeferProjectionPastSortLimit(Query *query,
+											AggregationPipelineBuildContext *context);
 
 static void ValidateQueryTreeForMatchStage(const Query *query);
 static void RewriteFillToSetWindowFieldsSpec(const bson_value_t *fillSpec,
@@ -239,8 +290,42 @@ static void RewriteFillToSetWindowFieldsSpec(const bson_value_t *fillSpec,
 											 bson_value_t *addFieldsForValueFill,
 											 bson_value_t *setWindowFieldsSpec,
 											 bson_value_t *partitionByFields);
+static bool TryGetUnwindGroupProjection(const bson_value_t *unwindValue,
+										const bson_value_t *groupValue,
+										bson_value_t *projectionValue);
+static bool IsExpressionLimitedToPaths(const bson_value_t *expression,
+									   const StringView *unwindPath,
+									   const StringView *indexPath);
 static void TryOptimizeAggregationPipelines(List **aggregationStages,
 											AggregationPipelineBuildContext *context);
+static List * RewriteAggregationStages(List *stagesList);
+static void SeparateStageSubQuery(Query *query, const char *stageName, int stageNum);
+static bool TryGetMatchFilterPaths(const bson_value_t *filter, List **paths);
+static void TryUseColumnarProjectionStore(Query *baseQuery, MongoCollection *collection,
+										  List *aggregationStages);
+static bool IsPipelineCoveredByColumnarProjection(List *aggregationStages,
+												  List *coveredPaths);
+static bool IsProjectionCoveredByColumnarProjection(const bson_value_t *projection,
+													const char *pathPrefix,
+													List *coveredPaths,
+													bool *hasInclusion);
+static bool IsExpressionCoveredByColumnarProjection(const bson_value_t *expression,
+													List *coveredPaths);
+static bool CanMoveMatchBeforeStage(List *matchPaths, const AggregationStage *stage);
+static bool PathListOverlaps(List *paths, const StringView *path);
+static List * GetTopLevelKeyPaths(const bson_value_t *document, bool
+								  skipOperatorValues);
+static bool TryGetLookupAsPath(const bson_value_t *lookupValue, StringView *asPath);
+static bool TryCoalesceLimitOrSkip(AggregationStage *stage,
+								   const AggregationStage *nextStage);
+static bool TryMoveLimitBeforeSkip(const AggregationStage *skipStage,
+								   AggregationStage *limitStage);
+static Query * TryHandleGroupAsFirstRowPerGroup(const bson_value_t *existingValue,
+												Query *query,
+												AggregationPipelineBuildContext *
+												context);
+static void GetGroupAccumulatorElement(bson_iter_t *groupIter, StringView *keyView,
+									   pgbsonelement *accumulatorElement);
 
 #define COMPATIBLE_CHANGE_STREAM_STAGES_COUNT 8
 const char *CompatibleChangeStreamPipelineStages[COMPATIBLE_CHANGE_STREAM_STAGES_COUNT] =
@@ -291,6 +376,21 @@ static const AggregationStageDefinition StageDefinitions[] =
 		.allowBaseShardTablePushdown = true,
 		.stageEnum = Stage_Internal_InhibitOptimization,
 	},
+	{
+		.stage = "$_internalUnpackBucket",
+		.mutateFunc = &HandleInternalUnpackBucket,
+		.requiresPersistentCursor = &RequiresPersistentCursorTrue,
+		.canInlineLookupStageFunc = NULL,
+
+		/* The buckets are scanned in no particular order */
+		.preservesStableSortOrder = false,
+		.canHandleAgnosticQueries = false,
+		.isProjectTransform = false,
+		.isOutputStage = false,
+		.pipelineCheckFunc = NULL,
+		.allowBaseShardTablePushdown = true,
+		.stageEnum = Stage_Internal_UnpackBucket,
+	},
 	{
 		.stage = "$addFields",
 		.mutateFunc = &HandleAddFields,
@@ -637,6 +737,39 @@ static const AggregationStageDefinition StageDefinitions[] =
 		.allowBaseShardTablePushdown = true,
 		.stageEnum = Stage_Project,
 	},
+	{
+		.stage = "$queryStats",
+		.mutateFunc = &HandleQueryStats,
+		.requiresPersistentCursor = &RequiresPersistentCursorTrue,
+
+		/* Changes the projector - can't be inlined */
+		.canInlineLookupStageFunc = NULL,
+
+		/* queryStats changes the output format */
+		.preservesStableSortOrder = false,
+
+		.canHandleAgnosticQueries = true,
+		.isProjectTransform = false,
+		.isOutputStage = false,
+		.pipelineCheckFunc = NULL,
+		.allowBaseShardTablePushdown = false,
+		.stageEnum = Stage_QueryStats,
+	},
+	{
+		.stage = "$rankFusion",
+		.mutateFunc = &HandleRankFusion,
+		.requiresPersistentCursor = &RequiresPersistentCursorTrue,
+		.canInlineLookupStageFunc = NULL,
+
+		/* Output is ordered by the fused score */
+		.preservesStableSortOrder = false,
+		.canHandleAgnosticQueries = false,
+		.isProjectTransform = false,
+		.isOutputStage = false,
+		.pipelineCheckFunc = NULL,
+		.allowBaseShardTablePushdown = false,
+		.stageEnum = Stage_RankFusion,
+	},
 	{
 		.stage = "$redact",
 		.mutateFunc = &HandleRedact,
@@ -1012,6 +1145,284 @@ SetBatchSize(const char *fieldName, const bson_value_t *value, QueryData *queryD
 }
 
 
+/*
+ * The largest skip + limit for which the branches of an $or are sorted and limited
+ * separately: Each branch returns up to this many documents.
+ */
+#define MAX_OR_BRANCH_SORT_LIMIT 10000
+
+/*
+ * The most $or branches that are sorted and limited separately.
+ */
+#define MAX_OR_BRANCH_SORT_BRANCHES 8
+
+
+/*
+ * Checks whether a find with the given filter, sort, skip and limit can be run as
+ * the union of its $or branches, each sorted and limited on its own: The filter
+ * has an $or of a few branches, the sort is a simple key sort and the skip + limit
+ * is small. Returns the limit of each branch (skip + limit) in branchLimit.
+ */
+static bool
+TryGetOrBranchSortLimit(const bson_value_t *filter, const bson_value_t *sort,
+						const bson_value_t *skip, const bson_value_t *limit,
+						int64_t *branchLimit)
+{
+	if (filter->value_type != BSON_TYPE_DOCUMENT ||
+		sort->value_type != BSON_TYPE_DOCUMENT || IsBsonValueEmptyDocument(sort) ||
+		!BsonValueIsNumber(limit))
+	{
+		return false;
+	}
+
+	/* Only plain ascending/descending keys (no $natural, no $meta) */
+	bson_iter_t sortIter;
+	BsonValueInitIterator(sort, &sortIter);
+	while (bson_iter_next(&sortIter))
+	{
+		if (bson_iter_key(&sortIter)[0] == '$' ||
+			!BsonValueIsNumber(bson_iter_value(&sortIter)))
+		{
+			return false;
+		}
+	}
+
+	int64_t skipValue = 0;
+	if (skip->value_type != BSON_TYPE_EOD)
+	{
+		if (!BsonValueIsNumber(skip))
+		{
+			return false;
+		}
+
+		skipValue = BsonValueAsInt64(skip);
+	}
+
+	int64_t limitValue = BsonValueAsInt64(limit);
+	if (skipValue < 0 || limitValue <= 0 ||
+		skipValue + limitValue > MAX_OR_BRANCH_SORT_LIMIT)
+	{
+		return false;
+	}
+
+	int numOrFields = 0;
+	int numBranches = 0;
+	bson_iter_t filterIter;
+	BsonValueInitIterator(filter, &filterIter);
+	while (bson_iter_next(&filterIter))
+	{
+		if (strcmp(bson_iter_key(&filterIter), "$or") != 0)
+		{
+			continue;
+		}
+
+		numOrFields++;
+		if (!BSON_ITER_HOLDS_ARRAY(&filterIter))
+		{
+			return false;
+		}
+
+		bson_iter_t branchIter;
+		if (!bson_iter_recurse(&filterIter, &branchIter))
+		{
+			return false;
+		}
+
+		while (bson_iter_next(&branchIter))
+		{
+			if (!BSON_ITER_HOLDS_DOCUMENT(&branchIter))
+			{
+				return false;
+			}
+
+			numBranches++;
+		}
+	}
+
+	if (numOrFields != 1 || numBranches < 2 ||
+		numBranches > MAX_OR_BRANCH_SORT_BRANCHES)
+	{
+		return false;
+	}
+
+	*branchLimit = skipValue + limitValue;
+	return true;
+}
+
+
+/*
+ * Generates the query for a find whose filter has an $or, when the find is sorted
+ * and limited (see TryGetOrBranchSortLimit), as the UNION ALL of its branches:
+ * Branch i is { "$and": [ <the rest of the filter>, <$or[i]>,
+ * { "$nor": [ <$or[0]> ... <$or[i - 1]> ] } ] } sorted and limited to branchLimit.
+ * The $nor makes the branches disjoint, so no document is returned twice, and
+ * each branch can be served by an ordered scan of the index for its own filter.
+ * The caller applies the sort, skip and limit of the find on the union, which then
+ * sorts at most branchLimit documents per branch instead of every match of the $or.
+ */
+static Query *
+GenerateOrBranchUnionQuery(const bson_value_t *filter, const bson_value_t *sort,
+						   int64_t branchLimit, const StringView *collectionName,
+						   pg_uuid_t *collectionUuid,
+						   AggregationPipelineBuildContext *context)
+{
+	ReportFeatureUsage(FEATURE_USAGE_OR_BRANCH_SORT_MERGE);
+
+	/* The filter without the $or */
+	pgbson_writer restWriter;
+	PgbsonWriterInit(&restWriter);
+
+	bson_value_t orValue = { 0 };
+	bson_iter_t filterIter;
+	BsonValueInitIterator(filter, &filterIter);
+	while (bson_iter_next(&filterIter))
+	{
+		if (strcmp(bson_iter_key(&filterIter), "$or") == 0)
+		{
+			orValue = *bson_iter_value(&filterIter);
+		}
+		else
+		{
+			PgbsonWriterAppendValue(&restWriter, bson_iter_key(&filterIter),
+									bson_iter_key_len(&filterIter),
+									bson_iter_value(&filterIter));
+		}
+	}
+
+	pgbson *restFilter = PgbsonWriterGetPgbson(&restWriter);
+
+	bson_value_t limitValue = { 0 };
+	limitValue.value_type = BSON_TYPE_INT64;
+	limitValue.value.v_int64 = branchLimit;
+
+	List *branchQueries = NIL;
+	List *priorBranches = NIL;
+	AggregationPipelineBuildContext branchContext = { 0 };
+	bson_iter_t branchIter;
+	BsonValueInitIterator(&orValue, &branchIter);
+	while (bson_iter_next(&branchIter))
+	{
+		const bson_value_t *branchValue = bson_iter_value(&branchIter);
+
+		pgbson_writer branchWriter;
+		PgbsonWriterInit(&branchWriter);
+		pgbson_array_writer andWriter;
+		PgbsonWriterStartArray(&branchWriter, "$and", 4, &andWriter);
+		if (!IsPgbsonEmptyDocument(restFilter))
+		{
+			PgbsonArrayWriterWriteDocument(&andWriter, restFilter);
+		}
+
+		PgbsonArrayWriterWriteValue(&andWriter, branchValue);
+		if (priorBranches != NIL)
+		{
+			pgbson_writer norWriter;
+			PgbsonArrayWriterStartDocument(&andWriter, &norWriter);
+			pgbson_array_writer norArrayWriter;
+			PgbsonWriterStartArray(&norWriter, "$nor", 4, &norArrayWriter);
+
+			ListCell *cell;
+			foreach(cell, priorBranches)
+			{
+				PgbsonArrayWriterWriteValue(&norArrayWriter, lfirst(cell));
+			}
+
+			PgbsonWriterEndArray(&norWriter, &norArrayWriter);
+			PgbsonArrayWriterEndDocument(&andWriter, &norWriter);
+		}
+
+		PgbsonWriterEndArray(&branchWriter, &andWriter);
+		bson_value_t branchFilter = ConvertPgbsonToBsonValue(
+			PgbsonWriterGetPgbson(&branchWriter));
+
+		/* Each branch is planned on its own */
+		branchContext = *context;
+		bson_value_t *indexHint = NULL;
+		Query *branchQuery = GenerateBaseTableQuery(context->databaseNameDatum,
+													collectionName, collectionUuid,
+													indexHint, &branchContext);
+		branchQuery = HandleMatch(&branchFilter, branchQuery, &branchContext);
+		branchContext.stageNum++;
+		branchQuery = HandleSort(sort, branchQuery, &branchContext);
+		branchContext.stageNum++;
+		branchQuery = HandleLimit(&limitValue, branchQuery, &branchContext);
+
+		branchQueries = lappend(branchQueries, branchQuery);
+		priorBranches = lappend(priorBranches, (void *) branchValue);
+	}
+
+	/* The collection resolved by the branches */
+	context->namespaceName = branchContext.namespaceName;
+	context->mongoCollection = branchContext.mongoCollection;
+	context->collectionNameView = branchContext.collectionNameView;
+
+	Query *unionQuery = makeNode(Query);
+	unionQuery->commandType = CMD_SELECT;
+	unionQuery->querySource = QSRC_ORIGINAL;
+	unionQuery->canSetTag = true;
+	unionQuery->jointree = makeNode(FromExpr);
+
+	bool includeAllColumns = false;
+	Node *setOperations = NULL;
+	ListCell *cell;
+	foreach(cell, branchQueries)
+	{
+		Query *branchQuery = lfirst(cell);
+		RangeTblEntry *branchRte = MakeSubQueryRte(branchQuery, context->stageNum,
+												   foreach_current_index(cell),
+												   "orBranch", includeAllColumns);
+		unionQuery->rtable = lappend(unionQuery->rtable, branchRte);
+
+		RangeTblRef *branchReference = makeNode(RangeTblRef);
+		branchReference->rtindex = list_length(unionQuery->rtable);
+		if (setOperations == NULL)
+		{
+			setOperations = (Node *) branchReference;
+		}
+		else
+		{
+			SetOperationStmt *setOpStatement = MakeBsonSetOpStatement();
+			setOpStatement->larg = setOperations;
+			setOpStatement->rarg = (Node *) branchReference;
+			setOperations = (Node *) setOpStatement;
+		}
+	}
+
+	unionQuery->setOperations = setOperations;
+
+	/* Result column node */
+	Query *firstBranch = linitial(branchQueries);
+	TargetEntry *firstTargetEntry = linitial(firstBranch->targetList);
+	Var *var = makeVar(1, firstTargetEntry->resno, BsonTypeId(), -1, InvalidOid, 0);
+	TargetEntry *resultEntry = makeTargetEntry((Expr *) var, firstTargetEntry->resno,
+											   firstTargetEntry->resname, false);
+	unionQuery->targetList = list_make1(resultEntry);
+	return MigrateQueryToSubQuery(unionQuery, context);
+}
+
+
+/*
+ * Parses the maxParallelWorkers of a find/aggregate: The number of parallel workers
+ * the scans of the request may use when parallel query is enabled. 0 disables
+ * parallel scans for the request.
+ */
+static void
+SetMaxParallelWorkers(const char *fieldName, const bson_value_t *value,
+					  QueryData *queryData)
+{
+	EnsureTopLevelNumberFieldType(fieldName, value);
+
+	queryData->maxParallelWorkers = BsonValueAsInt32(value);
+	if (queryData->maxParallelWorkers < 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg(
+							"maxParallelWorkers value must be non-negative, but received: %d",
+							queryData->maxParallelWorkers)));
+	}
+}
+
+
 /*
  * Common utility function for parsing a the namespace (Collection) argument for find/aggregate
  * Updates the cursor state with the namespaceName 'db.coll'
@@ -1093,6 +1504,11 @@ Query *
 MutateQueryWithPipeline(Query *query, List *aggregationStages,
 						AggregationPipelineBuildContext *context)
 {
+	/* Each top level stage gets its own subquery when explaining stages separately */
+	bool separateStages = SeparateAggregationStagesInPlan &&
+						  context->nestedPipelineLevel == 0;
+	const char *previousStageName = NULL;
+
 	/* Apply stage transformations now */
 	ListCell *stageCell = NULL;
 	foreach(stageCell, aggregationStages)
@@ -1118,6 +1534,11 @@ MutateQueryWithPipeline(Query *query, List *aggregationStages,
 		if (context->requiresSubQuery)
 		{
 			query = MigrateQueryToSubQuery(query, context);
+
+			if (separateStages && previousStageName != NULL)
+			{
+				SeparateStageSubQuery(query, previousStageName, context->stageNum - 1);
+			}
 		}
 
 		if (context->requiresSubQueryAfterProject)
@@ -1154,6 +1575,13 @@ MutateQueryWithPipeline(Query *query, List *aggregationStages,
 		{
 			context->sortSpec.value_type = BSON_TYPE_EOD;
 		}
+
+		if (separateStages)
+		{
+			context->requiresSubQuery = true;
+			previousStageName = stageName;
+		}
+
 		context->stageNum++;
 	}
 
@@ -1175,6 +1603,41 @@ MutateQueryWithPipeline(Query *query, List *aggregationStages,
 Query *
 GenerateAggregationQuery(text *database, pgbson *aggregationSpec, QueryData *queryData,
 						 bool addCursorParams, bool setStatementTimeout)
+{
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_QueryGeneration);
+
+	Query *query = NULL;
+	QueryShapeCacheKey cacheKey;
+	if (EnableQueryShapeCache)
+	{
+		query = GetQueryFromShapeCache(QueryShapeCacheKind_Aggregate, database,
+									   aggregationSpec, queryData, addCursorParams,
+									   setStatementTimeout, &cacheKey);
+	}
+
+	if (query == NULL)
+	{
+		query = GenerateAggregationQueryCore(database, aggregationSpec, queryData,
+											 addCursorParams, setStatementTimeout);
+		if (EnableQueryShapeCache)
+		{
+			AddQueryToShapeCache(&cacheKey, query, queryData);
+		}
+	}
+
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
+	return query;
+}
+
+
+/*
+ * Generates the query for an aggregation pipeline (without the query shape cache).
+ */
+static Query *
+GenerateAggregationQueryCore(text *database, pgbson *aggregationSpec,
+							 QueryData *queryData, bool addCursorParams,
+							 bool setStatementTimeout)
 {
 	AggregationPipelineBuildContext context = { 0 };
 	context.databaseNameDatum = database;
@@ -1226,8 +1689,9 @@ GenerateAggregationQuery(text *database, pgbson *aggregationSpec, QueryData *que
 		}
 		else if (StringViewEqualsCString(&keyView, "allowDiskUse"))
 		{
-			/* We otherwise ignore this for now (TODO Support this) */
+			/* Only applies to the memory budget of the query for now */
 			EnsureTopLevelFieldType("allowDiskUse", &aggregationIterator, BSON_TYPE_BOOL);
+			SetQueryMemoryAllowDiskUse(bson_iter_bool(&aggregationIterator));
 		}
 		else if (StringViewEqualsCString(&keyView, "explain"))
 		{
@@ -1279,9 +1743,13 @@ GenerateAggregationQuery(text *database, pgbson *aggregationSpec, QueryData *que
 		else if (setStatementTimeout &&
 				 StringViewEqualsCString(&keyView, "maxTimeMS"))
 		{
-			EnsureTopLevelFieldIsNumberLike("find.maxTimeMS", value);
+			EnsureTopLevelFieldIsNumberLike("aggregate.maxTimeMS", value);
 			SetExplicitStatementTimeout(BsonValueAsInt32(value));
 		}
+		else if (StringViewEqualsCString(&keyView, "maxParallelWorkers"))
+		{
+			SetMaxParallelWorkers("aggregate.maxParallelWorkers", value, queryData);
+		}
 		else if (StringViewEqualsCString(&keyView, "$db"))
 		{
 			/* BackCompat: Ignore if provided top level */
@@ -1349,9 +1817,21 @@ GenerateAggregationQuery(text *database, pgbson *aggregationSpec, QueryData *que
 
 	/* Remember the base query - this will be needed since we need to update the cursor function on the base RTE */
 	Query *baseQuery = query;
+	MongoCollection *baseCollection = context.mongoCollection;
 
 	query = MutateQueryWithPipeline(query, aggregationStages, &context);
 
+	/*
+	 * Only persistent cursors are considered for the columnar projection store, since
+	 * the getMore of a streamable cursor needs to resume on the same table.
+	 */
+	if (EnableColumnarProjectionStore && !isCollectionAgnosticQuery &&
+		context.requiresPersistentCursor && baseCollection != NULL &&
+		StringViewEqualsCString(&collectionName, baseCollection->name.collectionName))
+	{
+		TryUseColumnarProjectionStore(baseQuery, baseCollection, aggregationStages);
+	}
+
 	if (context.requiresTailableCursor)
 	{
 		queryData->cursorKind = QueryCursorType_Tailable;
@@ -1363,9 +1843,10 @@ GenerateAggregationQuery(text *database, pgbson *aggregationSpec, QueryData *que
 		 */
 		addCursorParams = false;
 	}
-	else if (query->commandType == CMD_MERGE)
+	else if (query->commandType == CMD_MERGE ||
+			 (EnableOutInsertSelect && query->commandType == CMD_INSERT))
 	{
-		/* CMD_MERGE is case when pipeline has output stage ($merge or $out) result will be always single batch. */
+		/* CMD_MERGE (or CMD_INSERT for $out) is case when pipeline has output stage ($merge or $out) result will be always single batch. */
 		ThrowIfServerOrTransactionReadOnly();
 		queryData->cursorKind = QueryCursorType_SingleBatch;
 	}
@@ -1434,6 +1915,40 @@ IsNaturalSortHint(const bson_value_t *hintValue)
 Query *
 GenerateFindQuery(text *databaseDatum, pgbson *findSpec, QueryData *queryData, bool
 				  addCursorParams, bool setStatementTimeout)
+{
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_QueryGeneration);
+
+	Query *query = NULL;
+	QueryShapeCacheKey cacheKey;
+	if (EnableQueryShapeCache)
+	{
+		query = GetQueryFromShapeCache(QueryShapeCacheKind_Find, databaseDatum,
+									   findSpec, queryData, addCursorParams,
+									   setStatementTimeout, &cacheKey);
+	}
+
+	if (query == NULL)
+	{
+		query = GenerateFindQueryCore(databaseDatum, findSpec, queryData,
+									  addCursorParams, setStatementTimeout);
+		if (EnableQueryShapeCache)
+		{
+			AddQueryToShapeCache(&cacheKey, query, queryData);
+		}
+	}
+
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
+	return query;
+}
+
+
+/*
+ * Generates the query for a find spec (without the query shape cache).
+ */
+static Query *
+GenerateFindQueryCore(text *databaseDatum, pgbson *findSpec, QueryData *queryData, bool
+					  addCursorParams, bool setStatementTimeout)
 {
 	AggregationPipelineBuildContext context = { 0 };
 	context.databaseNameDatum = databaseDatum;
@@ -1625,6 +2140,11 @@ GenerateFindQuery(text *databaseDatum, pgbson *findSpec, QueryData *queryData, b
 					SetExplicitStatementTimeout(BsonValueAsInt32(value));
 					continue;
 				}
+				else if (StringViewEqualsCString(&keyView, "maxParallelWorkers"))
+				{
+					SetMaxParallelWorkers("find.maxParallelWorkers", value, queryData);
+					continue;
+				}
 
 				goto default_find_case;
 			}
@@ -1824,17 +2344,32 @@ default_find_case:
 		}
 	}
 
-	Query *query = GenerateBaseTableQuery(context.databaseNameDatum, &collectionName,
-										  collectionUuid, &indexHint,
-										  &context);
-	Query *baseQuery = query;
-
-	/* First apply match */
-	if (filter.value_type != BSON_TYPE_EOD)
-	{
-		query = HandleMatch(&filter, query, &context);
+	Query *query;
+	Query *baseQuery;
+	int64_t orBranchLimit = 0;
+	if (EnableOrBranchSortMerge && indexHint.value_type == BSON_TYPE_EOD &&
+		TryGetOrBranchSortLimit(&filter, &sort, &skip, &limit, &orBranchLimit))
+	{
+		/* The sort, skip and limit below then apply to the merged branches */
+		query = GenerateOrBranchUnionQuery(&filter, &sort, orBranchLimit,
+										   &collectionName, collectionUuid, &context);
+		baseQuery = query;
 		context.stageNum++;
 	}
+	else
+	{
+		query = GenerateBaseTableQuery(context.databaseNameDatum, &collectionName,
+									   collectionUuid, &indexHint,
+									   &context);
+		baseQuery = query;
+
+		/* First apply match */
+		if (filter.value_type != BSON_TYPE_EOD)
+		{
+			query = HandleMatch(&filter, query, &context);
+			context.stageNum++;
+		}
+	}
 
 	/* Then apply sort */
 	if (sort.value_type != BSON_TYPE_EOD)
@@ -1912,6 +2447,20 @@ default_find_case:
  */
 Query *
 GenerateCountQuery(text *databaseDatum, pgbson *countSpec, bool setStatementTimeout)
+{
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_QueryGeneration);
+	Query *query = GenerateCountQueryCore(databaseDatum, countSpec, setStatementTimeout);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
+	return query;
+}
+
+
+/*
+ * Generates the query for a count spec.
+ */
+static Query *
+GenerateCountQueryCore(text *databaseDatum, pgbson *countSpec, bool setStatementTimeout)
 {
 	AggregationPipelineBuildContext context = { 0 };
 	context.databaseNameDatum = databaseDatum;
@@ -2106,6 +2655,22 @@ GenerateCountQuery(text *databaseDatum, pgbson *countSpec, bool setStatementTime
  */
 Query *
 GenerateDistinctQuery(text *databaseDatum, pgbson *distinctSpec, bool setStatementTimeout)
+{
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_QueryGeneration);
+	Query *query = GenerateDistinctQueryCore(databaseDatum, distinctSpec,
+											 setStatementTimeout);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
+	return query;
+}
+
+
+/*
+ * Generates the query for a distinct spec.
+ */
+static Query *
+GenerateDistinctQueryCore(text *databaseDatum, pgbson *distinctSpec,
+						  bool setStatementTimeout)
 {
 	AggregationPipelineBuildContext context = { 0 };
 	context.databaseNameDatum = databaseDatum;
@@ -2240,6 +2805,17 @@ ParseGetMore(text **databaseName, pgbson *getMoreSpec, QueryData *queryData, boo
 			EnsureTopLevelFieldIsNumberLike("getMore.maxTimeMS", value);
 			SetExplicitStatementTimeout(BsonValueAsInt32(value));
 		}
+		else if (strcmp(pathKey, "maxAwaitTimeMS") == 0)
+		{
+			const bson_value_t *value = bson_iter_value(&cursorSpecIter);
+			EnsureTopLevelFieldIsNumberLike("getMore.maxAwaitTimeMS", value);
+			queryData->maxAwaitTimeMS = BsonValueAsInt32(value);
+			if (queryData->maxAwaitTimeMS < 0)
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg("maxAwaitTimeMS must be a non-negative value")));
+			}
+		}
 		else if (strcmp(pathKey, "$db") == 0)
 		{
 			/* BackCompat: Ignore if provided top level */
@@ -2718,7 +3294,7 @@ ParseInputDocumentForMedianAndPercentile(const bson_value_t *inputDocument,
 							opName, keyName)));
 	}
 
-	/* validate method: can only be 'approximate' for now */
+	/* validate method: can only be 'approximate' or, if enabled, 'discrete' */
 	if (method->value_type != BSON_TYPE_UTF8)
 	{
 		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_TYPEMISMATCH), errmsg(
@@ -2727,7 +3303,10 @@ ParseInputDocumentForMedianAndPercentile(const bson_value_t *inputDocument,
 						errdetail_log(
 							"BSON field '$%s.method' expects type 'string'", opName)));
 	}
-	if (strcmp(method->value.v_utf8.str, "approximate") != 0)
+	bool isExactMethod = EnableExactPercentile &&
+						 IsClusterVersionAtleast(DocDB_V0, 108, 0) &&
+						 strcmp(method->value.v_utf8.str, "discrete") == 0;
+	if (strcmp(method->value.v_utf8.str, "approximate") != 0 && !isExactMethod)
 	{
 		/* Same error message for both $median and $percentile */
 		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE), errmsg(
@@ -3611,7 +4190,12 @@ HandleLimit(const bson_value_t *existingValue, Query *query,
 	{
 		query->limitCount = (Node *) makeConst(INT8OID, -1, InvalidOid, sizeof(int64_t),
 											   Int64GetDatum(limitValue), false, true);
-	}
+
+		if (EnableSortLimitProjectionDeferral && query->sortClause != NIL)
+		{
+			query = DeferProjectionPastSortLimit(query, context);
+		}
+	}
 
 	/* PG applies projection before LIMIT - consequently if there was an error in the 11th
 	 * document and you do limit 10, PG would error out.
@@ -3623,6 +4207,102 @@ HandleLimit(const bson_value_t *existingValue, Query *query,
 }
 
 
+/*
+ * Whether the function is a per document projection that can be evaluated
+ * after a sort + limit instead of before it.
+ */
+static bool
+IsDeferrableProjectionFunction(Oid functionOid)
+{
+	return functionOid == BsonDollarProjectFunctionOid() ||
+		   functionOid == BsonDollarProjectWithLetFunctionOid() ||
+		   functionOid == BsonDollarProjectWithLetAndCollationFunctionOid() ||
+		   functionOid == BsonDollarAddFieldsFunctionOid() ||
+		   functionOid == BsonDollarAddFieldsWithLetFunctionOid() ||
+		   functionOid == BsonDollarAddFieldsWithLetAndCollationFunctionOid() ||
+		   functionOid == BsonDollarReplaceRootFunctionOid() ||
+		   functionOid == BsonDollarReplaceRootWithLetFunctionOid() ||
+		   functionOid == BsonDollarReplaceRootWithLetAndCollationFunctionOid();
+}
+
+
+/*
+ * Given a query with a sort and a limit whose document is produced by a chain of
+ * projections ($project, $addFields, $replaceRoot ...) over the sorted document,
+ * moves the projections to an outer query over the sort + limit.
+ *
+ * The sort keys are junk entries computed on the document before the projections,
+ * so the projections do not affect the order. However, PG evaluates the target list
+ * below the Sort node, so a bounded (top-K) sort would still project every input
+ * document. Moving the projections out means only the K documents returned are
+ * projected, which also matches the protocol behavior of not failing the projection
+ * on documents that are dropped by the limit.
+ */
+static Query *
+DeferProjectionPastSortLimit(Query *query, AggregationPipelineBuildContext *context)
+{
+	if (query->hasAggs || query->hasWindowFuncs || query->hasTargetSRFs ||
+		query->groupClause != NIL || query->distinctClause != NIL ||
+		query->limitOffset != NULL)
+	{
+		return query;
+	}
+
+	TargetEntry *firstEntry = linitial(query->targetList);
+	if (!IsA(firstEntry->expr, FuncExpr))
+	{
+		return query;
+	}
+
+	/* Walk down the projection chain to the document that was sorted */
+	Expr **baseDocument = &firstEntry->expr;
+	while (IsA(*baseDocument, FuncExpr))
+	{
+		FuncExpr *projection = (FuncExpr *) *baseDocument;
+		if (!IsDeferrableProjectionFunction(projection->funcid))
+		{
+			break;
+		}
+
+		/*
+		 * The remaining arguments move to the outer query: Only allow the
+		 * ones that are not bound to the current query level.
+		 */
+		ListCell *argCell;
+		for_each_from(argCell, projection->args, 1)
+		{
+			Node *arg = lfirst(argCell);
+			if (!IsA(arg, Const) &&
+				!(IsA(arg, Param) && ((Param *) arg)->paramkind == PARAM_EXTERN))
+			{
+				return query;
+			}
+		}
+
+		baseDocument = (Expr **) &linitial(projection->args);
+	}
+
+	if (baseDocument == &firstEntry->expr)
+	{
+		/* No projections to defer */
+		return query;
+	}
+
+	Expr *projectionChain = firstEntry->expr;
+	Expr *sortedDocument = *baseDocument;
+
+	/* Sort and limit the unprojected document */
+	firstEntry->expr = sortedDocument;
+	query = MigrateQueryToSubQuery(query, context);
+
+	/* Re-apply the projections on the output of the sort + limit */
+	TargetEntry *outerEntry = linitial(query->targetList);
+	*baseDocument = outerEntry->expr;
+	outerEntry->expr = projectionChain;
+	return query;
+}
+
+
 /*
  * Mutates the query for the $match stage.
  * Simply calls the ExpandQueryOperator similar to the @@ operator.
@@ -3642,11 +4322,19 @@ HandleMatch(const bson_value_t *existingValue, Query *query,
 							"The match filter must always be provided as an expression within a object.")));
 	}
 
-	if (query->limitOffset != NULL || query->limitCount != NULL)
+	/*
+	 * The filter applies to the output of a target list SRF, e.g. for a find()
+	 * on a view.
+	 */
+	if (query->limitOffset != NULL || query->limitCount != NULL ||
+		query->hasTargetSRFs)
 	{
 		query = MigrateQueryToSubQuery(query, context);
 	}
 
+	/* A filter on the measurements of a time-series collection prunes its buckets */
+	AddTimeseriesBucketFilters(existingValue, query, context);
+
 	TargetEntry *entry = linitial(query->targetList);
 	BsonQueryOperatorContext filterContext = { 0 };
 	filterContext.documentExpr = entry->expr;
@@ -4315,6 +5003,31 @@ CreateSingleArgAggregate(Oid aggregateFunctionId, Expr *argument, ParseState *pa
 }
 
 
+/*
+ * Creates an Aggref for an aggregate over (*) that returns bson.
+ */
+static Aggref *
+CreateCountStarAggregate(Oid aggregateFunctionId, ParseState *parseState)
+{
+	Aggref *aggref = makeNode(Aggref);
+	aggref->aggfnoid = aggregateFunctionId;
+	aggref->aggtype = BsonTypeId();
+	aggref->aggtranstype = InvalidOid; /* set by planner later */
+	aggref->aggdirectargs = NIL;
+	aggref->aggstar = true;
+	aggref->aggkind = AGGKIND_NORMAL; /* reset by planner */
+	aggref->aggsplit = AGGSPLIT_SIMPLE;
+	aggref->aggno = -1;     /* planner will set aggno and aggtransno */
+	aggref->aggtransno = -1;
+	aggref->location = -1;
+	aggref->aggargtypes = NIL;
+
+	bool aggDistinct = false;
+	transformAggregateCall(parseState, aggref, NIL, NIL, aggDistinct);
+	return aggref;
+}
+
+
 static Query *
 HandleDistinct(const StringView *distinctKey, Query *query,
 			   AggregationPipelineBuildContext *context)
@@ -4568,12 +5281,26 @@ HandleCount(const bson_value_t *existingValue, Query *query,
 	parseState->p_expr_kind = EXPR_KIND_SELECT_TARGET;
 	parseState->p_next_resno = firstEntry->resno + 1;
 
-	pgbson_writer writer;
-	PgbsonWriterInit(&writer);
-	PgbsonWriterAppendInt32(&writer, "", 0, 1);
-	Expr *constValue = (Expr *) MakeBsonConst(PgbsonWriterGetPgbson(&writer));
-	Aggref *aggref = CreateSingleArgAggregate(BsonSumAggregateFunctionOid(), constValue,
-											  parseState);
+	Aggref *aggref;
+	if (EnableBsonCountAggregate && IsClusterVersionAtleast(DocDB_V0, 108, 0))
+	{
+		/*
+		 * BSON_COUNT(*) keeps an int8 state and takes no arguments, so the
+		 * scan below doesn't need to produce (or detoast) the document and
+		 * no bson is parsed per row.
+		 */
+		aggref = CreateCountStarAggregate(BsonCountAggregateFunctionOid(), parseState);
+	}
+	else
+	{
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+		PgbsonWriterAppendInt32(&writer, "", 0, 1);
+		Expr *constValue = (Expr *) MakeBsonConst(PgbsonWriterGetPgbson(&writer));
+		aggref = CreateSingleArgAggregate(BsonSumAggregateFunctionOid(), constValue,
+										  parseState);
+	}
+
 	pfree(parseState);
 
 	query->hasAggs = true;
@@ -5027,6 +5754,343 @@ HandleSortByCount(const bson_value_t *existingValue, Query *query,
 }
 
 
+/*
+ * Handles the $rankFusion stage.
+ * { $rankFusion: { input: { pipelines: { <name>: [ ... ], ... } },
+ *                  combination: { weights: { <name>: <number>, ... } } } }
+ *
+ * Each input pipeline is expected to return its documents best first (e.g. a $search
+ * or $vectorSearch, or a $sort followed by a $limit). A document scores
+ * weight / (60 + rank) in every input that returns it (reciprocal rank fusion with
+ * the rank starting at 1), and the documents are returned by the sum of their scores.
+ *
+ * This is rewritten into existing stages: The first input runs on the current query
+ * and the others are appended with a $unionWith on the same collection, so all the
+ * inputs are one query that ends in
+ * { $group: { _id: "$_id", doc: { $first: "$doc" }, score: { $sum: "$score" } } },
+ * { $sort: { score: -1, _id: 1 } },
+ * { $replaceRoot: { newRoot: "$doc" } }
+ */
+static Query *
+HandleRankFusion(const bson_value_t *existingValue, Query *query,
+				 AggregationPipelineBuildContext *context)
+{
+	if (!EnableRankFusionStage)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("Stage $rankFusion is not supported yet in native pipeline"),
+						errdetail_log(
+							"Stage $rankFusion is not supported yet in native pipeline")));
+	}
+
+	ReportFeatureUsage(FEATURE_STAGE_RANK_FUSION);
+
+	if (context->stageNum != 0 || context->nestedPipelineLevel > 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg(
+							"$rankFusion must appear as the initial stage in the pipeline sequence.")));
+	}
+
+	EnsureTopLevelFieldValueType("$rankFusion", existingValue, BSON_TYPE_DOCUMENT);
+
+	bson_value_t pipelinesValue = { 0 };
+	bson_value_t weightsValue = { 0 };
+
+	bson_iter_t specIter;
+	BsonValueInitIterator(existingValue, &specIter);
+	while (bson_iter_next(&specIter))
+	{
+		const char *key = bson_iter_key(&specIter);
+		const bson_value_t *value = bson_iter_value(&specIter);
+		if (strcmp(key, "input") == 0)
+		{
+			EnsureTopLevelFieldValueType("$rankFusion.input", value, BSON_TYPE_DOCUMENT);
+
+			bson_iter_t inputIter;
+			BsonValueInitIterator(value, &inputIter);
+			while (bson_iter_next(&inputIter))
+			{
+				if (strcmp(bson_iter_key(&inputIter), "pipelines") != 0)
+				{
+					ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+									errmsg("$rankFusion.input contains an unknown field %s",
+										   bson_iter_key(&inputIter))));
+				}
+
+				EnsureTopLevelFieldValueType("$rankFusion.input.pipelines",
+											 bson_iter_value(&inputIter),
+											 BSON_TYPE_DOCUMENT);
+				pipelinesValue = *bson_iter_value(&inputIter);
+			}
+		}
+		else if (strcmp(key, "combination") == 0)
+		{
+			EnsureTopLevelFieldValueType("$rankFusion.combination", value,
+										 BSON_TYPE_DOCUMENT);
+
+			bson_iter_t combinationIter;
+			BsonValueInitIterator(value, &combinationIter);
+			while (bson_iter_next(&combinationIter))
+			{
+				if (strcmp(bson_iter_key(&combinationIter), "weights") != 0)
+				{
+					ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+									errmsg(
+										"$rankFusion.combination contains an unknown field %s",
+										bson_iter_key(&combinationIter))));
+				}
+
+				EnsureTopLevelFieldValueType("$rankFusion.combination.weights",
+											 bson_iter_value(&combinationIter),
+											 BSON_TYPE_DOCUMENT);
+				weightsValue = *bson_iter_value(&combinationIter);
+			}
+		}
+		else
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+							errmsg("$rankFusion contains an unknown field %s", key)));
+		}
+	}
+
+	if (pipelinesValue.value_type == BSON_TYPE_EOD ||
+		IsBsonValueEmptyDocument(&pipelinesValue))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_FAILEDTOPARSE),
+						errmsg(
+							"$rankFusion requires at least one pipeline in input.pipelines")));
+	}
+
+	/* Every weight must name one of the input pipelines */
+	if (weightsValue.value_type == BSON_TYPE_DOCUMENT)
+	{
+		bson_iter_t weightsIter;
+		BsonValueInitIterator(&weightsValue, &weightsIter);
+		while (bson_iter_next(&weightsIter))
+		{
+			const bson_value_t *weight = bson_iter_value(&weightsIter);
+			if (!BsonValueIsNumber(weight) || BsonValueAsDouble(weight) < 0)
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"$rankFusion weight for pipeline %s must be a non-negative number",
+									bson_iter_key(&weightsIter))));
+			}
+
+			bson_iter_t pipelineIter;
+			BsonValueInitIterator(&pipelinesValue, &pipelineIter);
+			if (!bson_iter_find_w_len(&pipelineIter, bson_iter_key(&weightsIter),
+									  bson_iter_key_len(&weightsIter)))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"$rankFusion weight %s does not match any pipeline in input.pipelines",
+									bson_iter_key(&weightsIter))));
+			}
+		}
+	}
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	pgbson_array_writer pipelineWriter;
+	PgbsonWriterStartArray(&writer, "", 0, &pipelineWriter);
+
+	bool isFirstPipeline = true;
+	bson_iter_t pipelineIter;
+	BsonValueInitIterator(&pipelinesValue, &pipelineIter);
+	while (bson_iter_next(&pipelineIter))
+	{
+		const char *pipelineName = bson_iter_key(&pipelineIter);
+		const bson_value_t *inputPipeline = bson_iter_value(&pipelineIter);
+		if (*pipelineName == '\0' || *pipelineName == '$' ||
+			strchr(pipelineName, '.') != NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+							errmsg(
+								"$rankFusion pipeline name '%s' must be non-empty, must not start with '$' and must not contain '.'",
+								pipelineName)));
+		}
+
+		if (inputPipeline->value_type != BSON_TYPE_ARRAY)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_TYPEMISMATCH),
+							errmsg(
+								"$rankFusion input pipeline %s must be an array, but found %s",
+								pipelineName, BsonTypeName(inputPipeline->value_type))));
+		}
+
+		double weight = 1.0;
+		bson_iter_t weightIter;
+		if (weightsValue.value_type == BSON_TYPE_DOCUMENT)
+		{
+			BsonValueInitIterator(&weightsValue, &weightIter);
+			if (bson_iter_find_w_len(&weightIter, pipelineName,
+									 bson_iter_key_len(&pipelineIter)))
+			{
+				weight = BsonValueAsDouble(bson_iter_value(&weightIter));
+			}
+		}
+
+		if (isFirstPipeline)
+		{
+			AppendRankFusionInputStages(&pipelineWriter, inputPipeline, weight);
+			isFirstPipeline = false;
+			continue;
+		}
+
+		/* { $unionWith: { coll: <this collection>, pipeline: [ <input ranked> ] } } */
+		pgbson_writer stageWriter;
+		PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+
+		pgbson_writer unionWithWriter;
+		PgbsonWriterStartDocument(&stageWriter, "$unionWith", 10, &unionWithWriter);
+		PgbsonWriterAppendUtf8(&unionWithWriter, "coll", 4,
+							   CreateStringFromStringView(&context->collectionNameView));
+
+		pgbson_array_writer unionPipelineWriter;
+		PgbsonWriterStartArray(&unionWithWriter, "pipeline", 8, &unionPipelineWriter);
+		AppendRankFusionInputStages(&unionPipelineWriter, inputPipeline, weight);
+		PgbsonWriterEndArray(&unionWithWriter, &unionPipelineWriter);
+
+		PgbsonWriterEndDocument(&stageWriter, &unionWithWriter);
+		PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+	}
+
+	/* { $group: { _id: "$_id", doc: { $first: "$doc" }, score: { $sum: "$score" } } } */
+	pgbson_writer stageWriter;
+	PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+	pgbson_writer groupWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$group", 6, &groupWriter);
+	PgbsonWriterAppendUtf8(&groupWriter, "_id", 3, "$_id");
+
+	pgbson_writer accumulatorWriter;
+	PgbsonWriterStartDocument(&groupWriter, "doc", 3, &accumulatorWriter);
+	PgbsonWriterAppendUtf8(&accumulatorWriter, "$first", 6, "$doc");
+	PgbsonWriterEndDocument(&groupWriter, &accumulatorWriter);
+
+	PgbsonWriterStartDocument(&groupWriter, "score", 5, &accumulatorWriter);
+	PgbsonWriterAppendUtf8(&accumulatorWriter, "$sum", 4, "$score");
+	PgbsonWriterEndDocument(&groupWriter, &accumulatorWriter);
+	PgbsonWriterEndDocument(&stageWriter, &groupWriter);
+	PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+
+	/* { $sort: { score: -1, _id: 1 } } */
+	PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+	pgbson_writer sortWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$sort", 5, &sortWriter);
+	PgbsonWriterAppendInt32(&sortWriter, "score", 5, -1);
+	PgbsonWriterAppendInt32(&sortWriter, "_id", 3, 1);
+	PgbsonWriterEndDocument(&stageWriter, &sortWriter);
+	PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+
+	/* { $replaceRoot: { newRoot: "$doc" } } */
+	PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+	pgbson_writer replaceRootWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$replaceRoot", 12, &replaceRootWriter);
+	PgbsonWriterAppendUtf8(&replaceRootWriter, "newRoot", 7, "$doc");
+	PgbsonWriterEndDocument(&stageWriter, &replaceRootWriter);
+	PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+
+	PgbsonWriterEndArray(&writer, &pipelineWriter);
+
+	pgbsonelement pipelineElement;
+	PgbsonToSinglePgbsonElement(PgbsonWriterGetPgbson(&writer), &pipelineElement);
+
+	/*
+	 * The rewritten stages run at the stage number of $rankFusion so that a $search
+	 * or $vectorSearch of the first input is still the initial stage. Applying them
+	 * advances the stage number once per rewritten stage, and the caller advances it
+	 * again for $rankFusion itself, so leave it on the last rewritten stage.
+	 */
+	List *stages = ExtractAggregationStages(&pipelineElement.bsonValue, context);
+	query = MutateQueryWithPipeline(query, stages, context);
+	context->stageNum--;
+	return query;
+}
+
+
+/*
+ * Writes the stages of one $rankFusion input followed by the stages that turn its
+ * output into { _id, doc, score } with the reciprocal rank score of each document:
+ * { $group: { _id: null, docs: { $push: "$$ROOT" } } },
+ * { $unwind: { path: "$docs", includeArrayIndex: "rank" } },
+ * { $replaceRoot: { newRoot: { _id: "$docs._id", doc: "$docs",
+ *                              score: { $divide: [ weight, { $add: [ 61, "$rank" ] } ] } } } }
+ */
+static void
+AppendRankFusionInputStages(pgbson_array_writer *pipelineWriter,
+							const bson_value_t *inputPipeline, double weight)
+{
+	bson_iter_t stageIter;
+	BsonValueInitIterator(inputPipeline, &stageIter);
+	while (bson_iter_next(&stageIter))
+	{
+		PgbsonArrayWriterWriteValue(pipelineWriter, bson_iter_value(&stageIter));
+	}
+
+	pgbson_writer stageWriter;
+	PgbsonArrayWriterStartDocument(pipelineWriter, &stageWriter);
+	pgbson_writer groupWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$group", 6, &groupWriter);
+	PgbsonWriterAppendNull(&groupWriter, "_id", 3);
+	pgbson_writer pushWriter;
+	PgbsonWriterStartDocument(&groupWriter, "docs", 4, &pushWriter);
+	PgbsonWriterAppendUtf8(&pushWriter, "$push", 5, "$$ROOT");
+	PgbsonWriterEndDocument(&groupWriter, &pushWriter);
+	PgbsonWriterEndDocument(&stageWriter, &groupWriter);
+	PgbsonArrayWriterEndDocument(pipelineWriter, &stageWriter);
+
+	PgbsonArrayWriterStartDocument(pipelineWriter, &stageWriter);
+	pgbson_writer unwindWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$unwind", 7, &unwindWriter);
+	PgbsonWriterAppendUtf8(&unwindWriter, "path", 4, "$docs");
+	PgbsonWriterAppendUtf8(&unwindWriter, "includeArrayIndex", 17, "rank");
+	PgbsonWriterEndDocument(&stageWriter, &unwindWriter);
+	PgbsonArrayWriterEndDocument(pipelineWriter, &stageWriter);
+
+	PgbsonArrayWriterStartDocument(pipelineWriter, &stageWriter);
+	pgbson_writer replaceRootWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$replaceRoot", 12, &replaceRootWriter);
+	pgbson_writer newRootWriter;
+	PgbsonWriterStartDocument(&replaceRootWriter, "newRoot", 7, &newRootWriter);
+	PgbsonWriterAppendUtf8(&newRootWriter, "_id", 3, "$docs._id");
+	PgbsonWriterAppendUtf8(&newRootWriter, "doc", 3, "$docs");
+
+	pgbson_writer scoreWriter;
+	PgbsonWriterStartDocument(&newRootWriter, "score", 5, &scoreWriter);
+	pgbson_array_writer divideWriter;
+	PgbsonWriterStartArray(&scoreWriter, "$divide", 7, &divideWriter);
+	bson_value_t weightValue = { 0 };
+	weightValue.value_type = BSON_TYPE_DOUBLE;
+	weightValue.value.v_double = weight;
+	PgbsonArrayWriterWriteValue(&divideWriter, &weightValue);
+
+	pgbson_writer addWriter;
+	PgbsonArrayWriterStartDocument(&divideWriter, &addWriter);
+	pgbson_array_writer addArgsWriter;
+	PgbsonWriterStartArray(&addWriter, "$add", 4, &addArgsWriter);
+	bson_value_t rankOffset = { 0 };
+	rankOffset.value_type = BSON_TYPE_INT32;
+	rankOffset.value.v_int32 = 61;
+	PgbsonArrayWriterWriteValue(&addArgsWriter, &rankOffset);
+	bson_value_t rankPath = { 0 };
+	rankPath.value_type = BSON_TYPE_UTF8;
+	rankPath.value.v_utf8.str = "$rank";
+	rankPath.value.v_utf8.len = 5;
+	PgbsonArrayWriterWriteValue(&addArgsWriter, &rankPath);
+	PgbsonWriterEndArray(&addWriter, &addArgsWriter);
+	PgbsonArrayWriterEndDocument(&divideWriter, &addWriter);
+
+	PgbsonWriterEndArray(&scoreWriter, &divideWriter);
+	PgbsonWriterEndDocument(&newRootWriter, &scoreWriter);
+	PgbsonWriterEndDocument(&replaceRootWriter, &newRootWriter);
+	PgbsonWriterEndDocument(&stageWriter, &replaceRootWriter);
+	PgbsonArrayWriterEndDocument(pipelineWriter, &stageWriter);
+}
+
+
 /*
  * Helper method that adds a group expression projection to the query's targetList.
  * Creates a VAR that can be used in the projector of the higher level sub-query.
@@ -5594,15 +6658,33 @@ AddPercentileMedianGroupAccumulator(Query *query, const bson_value_t *accumulato
 			InvalidOid, COERCE_EXPLICIT_CALL);
 	}
 
-	Oid aggregateFunctionOid = isMedianOp ? BsonMedianAggregateFunctionOid() :
-							   BsonPercentileAggregateFunctionOid();
-	Aggref *aggref = CreateMultiArgAggregate(aggregateFunctionOid, list_make3(
-												 (Expr *) inputAccumFunc,
-												 accuracyConstValue, (Expr *) pAccumFunc),
-											 list_make3_oid(
-												 BsonTypeId(),
-												 accuracyConstValue->consttype,
-												 BsonTypeId()), parseState);
+	Aggref *aggref;
+	if (strcmp(method.value.v_utf8.str, "discrete") == 0)
+	{
+		/*
+		 * The exact method keeps the numeric values of the group and selects the
+		 * ranks of the percentiles out of them rather than sorting them all.
+		 */
+		Oid aggregateFunctionOid = isMedianOp ? BsonExactMedianAggregateFunctionOid() :
+								   BsonExactPercentileAggregateFunctionOid();
+		aggref = CreateMultiArgAggregate(aggregateFunctionOid, list_make2(
+											 (Expr *) inputAccumFunc,
+											 (Expr *) pAccumFunc),
+										 list_make2_oid(BsonTypeId(), BsonTypeId()),
+										 parseState);
+	}
+	else
+	{
+		Oid aggregateFunctionOid = isMedianOp ? BsonMedianAggregateFunctionOid() :
+								   BsonPercentileAggregateFunctionOid();
+		aggref = CreateMultiArgAggregate(aggregateFunctionOid, list_make3(
+											 (Expr *) inputAccumFunc,
+											 accuracyConstValue, (Expr *) pAccumFunc),
+										 list_make3_oid(
+											 BsonTypeId(),
+											 accuracyConstValue->consttype,
+											 BsonTypeId()), parseState);
+	}
 
 	repathArgs = lappend(repathArgs, AddGroupExpression((Expr *) accumulatorText,
 														parseState, identifiers, query,
@@ -5650,6 +6732,16 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 							"The fields of a group must be explicitly defined within an object")));
 	}
 
+	if (EnableGroupFirstRowPerGroup)
+	{
+		Query *firstRowQuery = TryHandleGroupAsFirstRowPerGroup(existingValue, query,
+																context);
+		if (firstRowQuery != NULL)
+		{
+			return firstRowQuery;
+		}
+	}
+
 	/* Push prior stuff to a subquery first since we're gonna aggregate our way */
 	if (list_length(query->targetList) > 1 || query->hasAggs ||
 		list_length(query->groupClause) > 0 || list_length(query->sortClause) > 0 ||
@@ -5734,6 +6826,17 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 														identifiers, query, BsonTypeId(),
 														&groupEntry));
 
+	/*
+	 * The parallel variants of $push, $addToSet, $first, $last, $firstN and $lastN
+	 * can be partially aggregated by parallel workers and on the shards, with the
+	 * partial states combined by the leader or the coordinator. $push is only order
+	 * preserving on a single backend, so it keeps the serial aggregate when a prior
+	 * stage sorted the input. The same holds for $first, $last, $firstN and $lastN,
+	 * which only use the parallel variants on input without a sort specification.
+	 */
+	bool useParallelAccumulators = EnableParallelGroupAccumulators &&
+								   IsClusterVersionAtleast(DocDB_V0, 108, 0);
+
 	/* Now add accumulators */
 	parseState->p_expr_kind = EXPR_KIND_SELECT_TARGET;
 	BsonValueInitIterator(existingValue, &groupIter);
@@ -5745,37 +6848,11 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 			continue;
 		}
 
-		if (StringViewContains(&keyView, '.'))
-		{
-			/* Paths here cannot be dotted paths */
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40235),
-							errmsg(
-								"The specified field name %.*s is not allowed to include the '.' character.",
-								keyView.length, keyView.string)));
-		}
+		pgbsonelement accumulatorElement;
+		GetGroupAccumulatorElement(&groupIter, &keyView, &accumulatorElement);
 
 		Const *accumulatorText = MakeTextConst(keyView.string, keyView.length);
 
-		bson_iter_t accumulatorIterator;
-		if (!BSON_ITER_HOLDS_DOCUMENT(&groupIter) ||
-			!bson_iter_recurse(&groupIter, &accumulatorIterator))
-		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40234),
-							errmsg(
-								"The field '%.*s' is required to be an accumulator-type object",
-								keyView.length, keyView.string)));
-		}
-
-		pgbsonelement accumulatorElement;
-		if (!TryGetSinglePgbsonElementFromBsonIterator(&accumulatorIterator,
-													   &accumulatorElement))
-		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40238),
-							errmsg(
-								"The field '%.*s' is required to define exactly one accumulator",
-								keyView.length, keyView.string)));
-		}
-
 		StringView accumulatorName = {
 			.length = accumulatorElement.pathLength, .string = accumulatorElement.path
 		};
@@ -5842,6 +6919,8 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 													   accumulatorText, parseState,
 													   identifiers,
 													   origEntry->expr,
+													   useParallelAccumulators ?
+													   BsonFirstParallelAggregateFunctionOid() :
 													   BsonFirstOnSortedAggregateFunctionOid(),
 													   context->variableSpec);
 			}
@@ -5868,6 +6947,8 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 													   accumulatorText, parseState,
 													   identifiers,
 													   origEntry->expr,
+													   useParallelAccumulators ?
+													   BsonLastParallelAggregateFunctionOid() :
 													   BsonLastOnSortedAggregateFunctionOid(),
 													   context->variableSpec);
 			}
@@ -5900,6 +6981,8 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 														accumulatorText, parseState,
 														identifiers,
 														origEntry->expr,
+														useParallelAccumulators ?
+														BsonFirstNParallelAggregateFunctionOid() :
 														BsonFirstNOnSortedAggregateFunctionOid(),
 														&accumulatorName,
 														context->variableSpec);
@@ -5935,6 +7018,8 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 														accumulatorText, parseState,
 														identifiers,
 														origEntry->expr,
+														useParallelAccumulators ?
+														BsonLastNParallelAggregateFunctionOid() :
 														BsonLastNOnSortedAggregateFunctionOid(),
 														&accumulatorName,
 														context->variableSpec);
@@ -5986,9 +7071,24 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 												   accumulatorText, parseState,
 												   identifiers,
 												   origEntry->expr,
+												   useParallelAccumulators ?
+												   BsonAddToSetParallelAggregateFunctionOid() :
 												   BsonAddToSetAggregateFunctionOid(),
 												   context->variableSpec);
 		}
+		else if (StringViewEqualsCString(&accumulatorName, "$approxCountDistinct") &&
+				 EnableApproxCountDistinct &&
+				 IsClusterVersionAtleast(DocDB_V0, 108, 0))
+		{
+			repathArgs = AddSimpleGroupAccumulator(query,
+												   &accumulatorElement.bsonValue,
+												   repathArgs,
+												   accumulatorText, parseState,
+												   identifiers,
+												   origEntry->expr,
+												   BsonApproxCountDistinctAggregateFunctionOid(),
+												   context->variableSpec);
+		}
 		else if (StringViewEqualsCString(&accumulatorName, "$mergeObjects"))
 		{
 			if (context->sortSpec.value_type == BSON_TYPE_EOD)
@@ -6020,13 +7120,17 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 		{
 			char *fieldPath = "";
 			bool handleSingleValue = true;
+			Oid arrayAggFunctionOid =
+				useParallelAccumulators && context->sortSpec.value_type == BSON_TYPE_EOD ?
+				BsonArrayParallelAggregateFunctionOid() :
+				BsonArrayAggregateAllArgsFunctionOid();
 			repathArgs = AddArrayAggGroupAccumulator(query,
 													 &accumulatorElement.bsonValue,
 													 repathArgs,
 													 accumulatorText, parseState,
 													 identifiers,
 													 origEntry->expr,
-													 BsonArrayAggregateAllArgsFunctionOid(),
+													 arrayAggFunctionOid,
 													 fieldPath,
 													 handleSingleValue,
 													 context->variableSpec);
@@ -6263,20 +7367,238 @@ HandleGroup(const bson_value_t *existingValue, Query *query,
 
 
 /*
- * Pushes the current query into a subquery.
- * Then creates a brand new query that projects the 'document' value
- * from the underlying subquery.
+ * Handles a $group on "$k" whose accumulators are all $first right after a $sort
+ * that starts with k (e.g. the latest document per device) as a DISTINCT ON
+ * rather than as an aggregate:
+ *
+ *   SELECT DISTINCT ON (sort_k, group_k) document ... ORDER BY sort_k, group_k, sort_t
+ *
+ * The input then only needs to be in the order of the sort (which an index on
+ * (k, t) provides) and the first row of each group is kept, instead of evaluating
+ * every accumulator against every row of the group. The sort key of k is the same
+ * for all documents of a group, so ordering by the group key after it keeps the
+ * documents of each group together in the order of the $sort (also for arrays,
+ * which sort by their smallest element but group by the whole value).
+ *
+ * Returns NULL if the stage doesn't have that shape.
  */
-Query *
-MigrateQueryToSubQuery(Query *parse, AggregationPipelineBuildContext *context)
+static Query *
+TryHandleGroupAsFirstRowPerGroup(const bson_value_t *existingValue, Query *query,
+								 AggregationPipelineBuildContext *context)
 {
-	context->numNestedLevels++;
-
-	TargetEntry *tle = (TargetEntry *) linitial(parse->targetList);
-	RangeTblEntry *rte = MakeSubQueryRte(parse, context->stageNum,
-										 context->nestedPipelineLevel,
-										 "agg", context->expandTargetList);
-	context->expandTargetList = false;
+	if (query->sortClause == NIL || context->sortSpec.value_type != BSON_TYPE_DOCUMENT ||
+		context->variableSpec != NULL || query->limitCount != NULL ||
+		query->limitOffset != NULL || query->distinctClause != NIL ||
+		query->hasAggs || query->groupClause != NIL)
+	{
+		return NULL;
+	}
+
+	/* The sort has to start with the path that is grouped on */
+	bson_iter_t sortIter;
+	BsonValueInitIterator(&context->sortSpec, &sortIter);
+	if (!bson_iter_next(&sortIter))
+	{
+		return NULL;
+	}
+
+	pgbsonelement firstSortElement;
+	BsonIterToPgbsonElement(&sortIter, &firstSortElement);
+	if (!BsonValueIsNumber(&firstSortElement.bsonValue))
+	{
+		return NULL;
+	}
+
+	/* Like $group, the first _id is the group key */
+	bson_value_t idValue = { 0 };
+	bson_iter_t groupIter;
+	BsonValueInitIterator(existingValue, &groupIter);
+	while (bson_iter_next(&groupIter))
+	{
+		StringView keyView = bson_iter_key_string_view(&groupIter);
+		if (StringViewEquals(&keyView, &IdFieldStringView))
+		{
+			idValue = *bson_iter_value(&groupIter);
+			break;
+		}
+	}
+
+	if (idValue.value_type != BSON_TYPE_UTF8 ||
+		idValue.value.v_utf8.len < 2 || idValue.value.v_utf8.str[0] != '$' ||
+		idValue.value.v_utf8.str[1] == '$' ||
+		strcmp(idValue.value.v_utf8.str + 1, firstSortElement.path) != 0)
+	{
+		return NULL;
+	}
+
+	List *firstAccumulators = NIL;
+	BsonValueInitIterator(existingValue, &groupIter);
+	while (bson_iter_next(&groupIter))
+	{
+		StringView keyView = bson_iter_key_string_view(&groupIter);
+		if (StringViewEquals(&keyView, &IdFieldStringView))
+		{
+			continue;
+		}
+
+		/* The fields are validated the same way as for $group */
+		pgbsonelement accumulatorElement;
+		GetGroupAccumulatorElement(&groupIter, &keyView, &accumulatorElement);
+
+		/* Leave anything that is not { name: { $first: expr } } to $group */
+		if (keyView.length == 0 || keyView.string[0] == '$' ||
+			strcmp(accumulatorElement.path, "$first") != 0 ||
+			accumulatorElement.bsonValue.value_type == BSON_TYPE_ARRAY)
+		{
+			return NULL;
+		}
+
+		/* As well as repeated output fields */
+		ListCell *accumulatorCell;
+		foreach(accumulatorCell, firstAccumulators)
+		{
+			pgbsonelement *otherAccumulator = lfirst(accumulatorCell);
+			if (otherAccumulator->pathLength == keyView.length &&
+				strncmp(otherAccumulator->path, keyView.string, keyView.length) == 0)
+			{
+				return NULL;
+			}
+		}
+
+		pgbsonelement *firstAccumulator = palloc(sizeof(pgbsonelement));
+		firstAccumulator->path = keyView.string;
+		firstAccumulator->pathLength = keyView.length;
+		firstAccumulator->bsonValue = accumulatorElement.bsonValue;
+		firstAccumulators = lappend(firstAccumulators, firstAccumulator);
+	}
+
+	if (firstAccumulators == NIL)
+	{
+		return NULL;
+	}
+
+	TargetEntry *origEntry = linitial(query->targetList);
+	pgbson *groupValue = BsonValueToDocumentPgbson(&idValue);
+	List *groupArgs = list_make3(origEntry->expr, MakeBsonConst(groupValue),
+								 MakeBoolValueConst(true));
+	FuncExpr *groupFunc = makeFuncExpr(BsonExpressionGetFunctionOid(), BsonTypeId(),
+									   groupArgs, InvalidOid, InvalidOid,
+									   COERCE_EXPLICIT_CALL);
+
+	bool resjunk = true;
+	TargetEntry *groupEntry = makeTargetEntry((Expr *) groupFunc,
+											  list_length(query->targetList) + 1,
+											  "?group?", resjunk);
+	query->targetList = lappend(query->targetList, groupEntry);
+
+	SortGroupClause *groupClause = makeNode(SortGroupClause);
+	groupClause->tleSortGroupRef = assignSortGroupRef(groupEntry, query->targetList);
+	groupClause->eqop = BsonEqualOperatorId();
+	groupClause->sortop = BsonLessThanOperatorId();
+	groupClause->nulls_first = false;
+	groupClause->hashable = true;
+
+	/* ORDER BY sort_k, group_k, <rest of the sort> with DISTINCT ON (sort_k, group_k) */
+	SortGroupClause *firstSortClause = linitial(query->sortClause);
+	query->sortClause = list_insert_nth(list_copy(query->sortClause), 1, groupClause);
+	query->distinctClause = list_make2(copyObject(firstSortClause),
+									   copyObject(groupClause));
+	query->hasDistinctOn = true;
+
+	query = MigrateQueryToSubQuery(query, context);
+
+	/* Each $first is the accumulator's expression on the one document of the group */
+	TargetEntry *entry = linitial(query->targetList);
+	Expr *documentExpr = entry->expr;
+	List *repathArgs = list_make2(MakeTextConst("_id", 3),
+								  makeFuncExpr(BsonExpressionGetFunctionOid(),
+											   BsonTypeId(),
+											   list_make3(documentExpr,
+														  MakeBsonConst(groupValue),
+														  MakeBoolValueConst(true)),
+											   InvalidOid, InvalidOid,
+											   COERCE_EXPLICIT_CALL));
+
+	ListCell *cell;
+	foreach(cell, firstAccumulators)
+	{
+		pgbsonelement *firstAccumulator = lfirst(cell);
+		Expr *accumulatorDocument = GetDocumentExprForGroupAccumulatorValue(
+			&firstAccumulator->bsonValue, documentExpr);
+		pgbson *accumulatorValue = BsonValueToDocumentPgbson(
+			&firstAccumulator->bsonValue);
+		FuncExpr *accumulatorFunc = makeFuncExpr(
+			BsonExpressionGetFunctionOid(), BsonTypeId(),
+			list_make3(accumulatorDocument, MakeBsonConst(accumulatorValue),
+					   MakeBoolValueConst(true)),
+			InvalidOid, InvalidOid, COERCE_EXPLICIT_CALL);
+
+		repathArgs = lappend(repathArgs, MakeTextConst(firstAccumulator->path,
+													   firstAccumulator->pathLength));
+		repathArgs = lappend(repathArgs, accumulatorFunc);
+	}
+
+	bool overrideArrayInProjection = false;
+	entry->expr = GenerateMultiExpressionRepathExpression(repathArgs,
+														  overrideArrayInProjection);
+	context->requiresSubQuery = true;
+	return query;
+}
+
+
+/*
+ * Validates an output field of a $group (other than _id) and gets its
+ * { accumulator: value } element.
+ */
+static void
+GetGroupAccumulatorElement(bson_iter_t *groupIter, StringView *keyView,
+						   pgbsonelement *accumulatorElement)
+{
+	if (StringViewContains(keyView, '.'))
+	{
+		/* Paths here cannot be dotted paths */
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40235),
+						errmsg(
+							"The specified field name %.*s is not allowed to include the '.' character.",
+							keyView->length, keyView->string)));
+	}
+
+	bson_iter_t accumulatorIterator;
+	if (!BSON_ITER_HOLDS_DOCUMENT(groupIter) ||
+		!bson_iter_recurse(groupIter, &accumulatorIterator))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40234),
+						errmsg(
+							"The field '%.*s' is required to be an accumulator-type object",
+							keyView->length, keyView->string)));
+	}
+
+	if (!TryGetSinglePgbsonElementFromBsonIterator(&accumulatorIterator,
+												   accumulatorElement))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40238),
+						errmsg(
+							"The field '%.*s' is required to define exactly one accumulator",
+							keyView->length, keyView->string)));
+	}
+}
+
+
+/*
+ * Pushes the current query into a subquery.
+ * Then creates a brand new query that projects the 'document' value
+ * from the underlying subquery.
+ */
+Query *
+MigrateQueryToSubQuery(Query *parse, AggregationPipelineBuildContext *context)
+{
+	context->numNestedLevels++;
+
+	TargetEntry *tle = (TargetEntry *) linitial(parse->targetList);
+	RangeTblEntry *rte = MakeSubQueryRte(parse, context->stageNum,
+										 context->nestedPipelineLevel,
+										 "agg", context->expandTargetList);
+	context->expandTargetList = false;
 
 	Index childIndex = 1;
 	Var *newQueryOutput = makeVar(childIndex, tle->resno, BsonTypeId(), -1, InvalidOid,
@@ -6301,6 +7623,33 @@ MigrateQueryToSubQuery(Query *parse, AggregationPipelineBuildContext *context)
 }
 
 
+/*
+ * Names the subquery that holds the output of a stage after the stage
+ * (e.g. agg_stage_2_lookup for the $lookup at index 2 of the pipeline) and keeps the
+ * planner from pulling it up into the query above with an OFFSET 0, so that
+ * EXPLAIN ANALYZE reports the rows, time, memory and disk usage of the stage
+ * under its own Subquery Scan.
+ */
+static void
+SeparateStageSubQuery(Query *query, const char *stageName, int stageNum)
+{
+	RangeTblEntry *rte = linitial(query->rtable);
+	Assert(rte->rtekind == RTE_SUBQUERY);
+
+	char *aliasName = psprintf("agg_stage_%d_%s", stageNum, stageName + 1);
+	rte->alias->aliasname = aliasName;
+	rte->eref->aliasname = aliasName;
+
+	Query *stageQuery = rte->subquery;
+	if (stageQuery->limitOffset == NULL && stageQuery->limitCount == NULL)
+	{
+		stageQuery->limitOffset = (Node *) makeConst(INT8OID, -1, InvalidOid,
+													 sizeof(int64_t), Int64GetDatum(0),
+													 false, true);
+	}
+}
+
+
 /*
  * Creates an RTE for a Subquery provided given the prefixed stage name
  */
@@ -7126,7 +8475,8 @@ HandleSample(const bson_value_t *existingValue, Query *query,
 	/* If there is a filter that's not the default filter then we can't push down sample */
 	/* TOOD: Pushdown sample to base RTE for $lookup. */
 	if (rte->rtekind == RTE_RELATION &&
-		IsDefaultJoinTree(query->jointree->quals))
+		IsDefaultJoinTree(query->jointree->quals) &&
+		(rte->tablesample != NULL || IsSampleSmallForBlockScan(rte->relid, sizeDouble)))
 	{
 		/* Then just convert this to a Sample RTE */
 		if (rte->tablesample != NULL)
@@ -7201,6 +8551,37 @@ HandleSample(const bson_value_t *existingValue, Query *query,
 }
 
 
+/*
+ * Whether a $sample of sampleSize documents is small enough relative to the
+ * estimated size of the collection to be served by TABLESAMPLE SYSTEM_ROWS,
+ * which reads just the blocks needed for the sample. When the sample covers
+ * a large part of the collection, reading that many random blocks costs more
+ * than a sequential scan, and since SYSTEM_ROWS returns whole blocks the
+ * sample also gets clustered, so the random order over the full collection
+ * is preferred. Collections without an estimate (never analyzed, or the shell
+ * of a distributed table) always use the block sample.
+ */
+static bool
+IsSampleSmallForBlockScan(Oid relationId, double sampleSize)
+{
+	Relation relation = RelationIdGetRelation(relationId);
+	if (!RelationIsValid(relation))
+	{
+		return true;
+	}
+
+	double estimatedRows = relation->rd_rel->reltuples;
+	RelationClose(relation);
+
+	if (estimatedRows <= 0)
+	{
+		return true;
+	}
+
+	return sampleSize <= estimatedRows * SampleBlockScanMaxFraction;
+}
+
+
 /*
  * Helper method used by MutateStageWithPipeline to extract the appropriate
  * Stage information. Compares the aggregation stage by the ordinal comparison
@@ -7582,6 +8963,11 @@ static void
 TryOptimizeAggregationPipelines(List **aggregationStages,
 								AggregationPipelineBuildContext *context)
 {
+	if (EnablePipelineStageRewrites)
+	{
+		*aggregationStages = RewriteAggregationStages(*aggregationStages);
+	}
+
 	List *stagesList = *aggregationStages;
 	if (stagesList == NIL || list_length(stagesList) == 0)
 	{
@@ -7655,5 +9041,1059 @@ TryOptimizeAggregationPipelines(List **aggregationStages,
 		nextIndex = currentIndex + 1;
 	}
 
+	/*
+	 * $unwind followed by $group on the unwound elements: Each unwound row holds a copy
+	 * of the full document that the $group then only reads the unwound path of. If the
+	 * $group references nothing else, trim the document down to the unwound path before
+	 * the $unwind so that the rows produced per array element stay small.
+	 */
+	if (EnableUnwindGroupFusion)
+	{
+		stagesList = *aggregationStages;
+		for (int i = list_length(stagesList) - 2; i >= 0; i--)
+		{
+			AggregationStage *stage = (AggregationStage *) list_nth(stagesList, i);
+			AggregationStage *nextStage = (AggregationStage *) list_nth(stagesList,
+																		 i + 1);
+			if (stage->stageDefinition->stageEnum != Stage_Unwind ||
+				nextStage->stageDefinition->stageEnum != Stage_Group)
+			{
+				continue;
+			}
+
+			/* Already trimmed */
+			if (i > 0 && ((AggregationStage *) list_nth(stagesList, i - 1))->
+				stageDefinition->stageEnum == Stage_Project)
+			{
+				continue;
+			}
+
+			bson_value_t projectionValue;
+			if (!TryGetUnwindGroupProjection(&stage->stageValue, &nextStage->stageValue,
+											 &projectionValue))
+			{
+				continue;
+			}
+
+			AggregationStage *projectStage = palloc0(sizeof(AggregationStage));
+			projectStage->stageValue = projectionValue;
+			projectStage->stageDefinition = (AggregationStageDefinition *) bsearch(
+				"$project", StageDefinitions,
+				AggregationStageCount,
+				sizeof(AggregationStageDefinition),
+				CompareStageByStageName);
+			Assert(projectStage->stageDefinition != NULL);
+			stagesList = list_insert_nth(stagesList, i, projectStage);
+		}
+
+		*aggregationStages = stagesList;
+	}
+
 	context->allowShardBaseTable = allowShardBaseTable;
 }
+
+
+/*
+ * Rewrites the stages of a pipeline into an equivalent order that is cheaper to run:
+ *  - A $match moves ahead of the $addFields/$set/$unset/$project/$unwind/$lookup stages
+ *    before it if it only filters on paths that they leave untouched. This mostly
+ *    lets the filter reach the collection (and its indexes) before the documents are
+ *    enriched.
+ *  - Adjacent $match stages are combined with an $and, adjacent $limit and $skip
+ *    stages into one.
+ *  - A $skip followed by a $limit becomes a $limit of both followed by the $skip.
+ *    The $limit then lands in the same query as a prior $sort, so ORDER BY ... LIMIT
+ *    is pushed to each shard instead of every shard returning all its rows for the
+ *    coordinator to sort and skip.
+ *  - A $sort + $limit right after a $lookup runs before it when it doesn't sort on the
+ *    "as" field: $lookup writes each document out once, so only the documents
+ *    that are kept need to be joined.
+ *  - $match: {} and $addFields/$set: {} stages are dropped.
+ */
+static List *
+RewriteAggregationStages(List *stagesList)
+{
+	bool isModified = true;
+	while (isModified)
+	{
+		isModified = false;
+		for (int i = 0; i < list_length(stagesList); i++)
+		{
+			AggregationStage *stage = (AggregationStage *) list_nth(stagesList, i);
+			Stage stageEnum = stage->stageDefinition->stageEnum;
+			AggregationStage *previousStage = i > 0 ?
+											  (AggregationStage *) list_nth(stagesList,
+																			i - 1) :
+											  NULL;
+
+			if ((stageEnum == Stage_Match || stageEnum == Stage_AddFields ||
+				 stageEnum == Stage_Set) &&
+				stage->stageValue.value_type == BSON_TYPE_DOCUMENT &&
+				IsBsonValueEmptyDocument(&stage->stageValue) &&
+				list_length(stagesList) > 1)
+			{
+				stagesList = list_delete_nth_cell(stagesList, i);
+				isModified = true;
+				break;
+			}
+
+			if (previousStage == NULL)
+			{
+				continue;
+			}
+
+			/* Filters with operators that are restricted in position ($text etc.) stay put */
+			List *matchPaths = NIL;
+			bool isPlainMatch = stageEnum == Stage_Match &&
+								TryGetMatchFilterPaths(&stage->stageValue,
+													   &matchPaths);
+
+			Stage previousStageEnum = previousStage->stageDefinition->stageEnum;
+			List *previousMatchPaths = NIL;
+			if (isPlainMatch && previousStageEnum == Stage_Match &&
+				TryGetMatchFilterPaths(&previousStage->stageValue, &previousMatchPaths))
+			{
+				pgbson_writer writer;
+				PgbsonWriterInit(&writer);
+				pgbson_array_writer andWriter;
+				PgbsonWriterStartArray(&writer, "$and", 4, &andWriter);
+				PgbsonArrayWriterWriteValue(&andWriter, &previousStage->stageValue);
+				PgbsonArrayWriterWriteValue(&andWriter, &stage->stageValue);
+				PgbsonWriterEndArray(&writer, &andWriter);
+
+				previousStage->stageValue = ConvertPgbsonToBsonValue(
+					PgbsonWriterGetPgbson(&writer));
+				stagesList = list_delete_nth_cell(stagesList, i);
+				isModified = true;
+				break;
+			}
+
+			if (stageEnum == previousStageEnum &&
+				(stageEnum == Stage_Limit || stageEnum == Stage_Skip) &&
+				TryCoalesceLimitOrSkip(previousStage, stage))
+			{
+				stagesList = list_delete_nth_cell(stagesList, i);
+				isModified = true;
+				break;
+			}
+
+			if (stageEnum == Stage_Limit && previousStageEnum == Stage_Skip &&
+				TryMoveLimitBeforeSkip(previousStage, stage))
+			{
+				/* $skip, $limit => $limit, $skip */
+				list_nth_cell(stagesList, i - 1)->ptr_value = stage;
+				list_nth_cell(stagesList, i)->ptr_value = previousStage;
+				isModified = true;
+				break;
+			}
+
+			if (isPlainMatch && CanMoveMatchBeforeStage(matchPaths, previousStage))
+			{
+				list_nth_cell(stagesList, i - 1)->ptr_value = stage;
+				list_nth_cell(stagesList, i)->ptr_value = previousStage;
+				isModified = true;
+				break;
+			}
+
+			StringView asPath = { 0 };
+			if (stageEnum == Stage_Sort && previousStageEnum == Stage_Lookup &&
+				i + 1 < list_length(stagesList) &&
+				((AggregationStage *) list_nth(stagesList, i + 1))->stageDefinition->
+				stageEnum == Stage_Limit &&
+				stage->stageValue.value_type == BSON_TYPE_DOCUMENT &&
+				TryGetLookupAsPath(&previousStage->stageValue, &asPath))
+			{
+				bool skipOperatorValues = true;
+				List *sortPaths = GetTopLevelKeyPaths(&stage->stageValue,
+													  skipOperatorValues);
+				if (sortPaths != NIL && !PathListOverlaps(sortPaths, &asPath))
+				{
+					/* $lookup, $sort, $limit => $sort, $limit, $lookup */
+					stagesList = list_delete_nth_cell(stagesList, i - 1);
+					stagesList = list_insert_nth(stagesList, i + 1, previousStage);
+					isModified = true;
+					break;
+				}
+			}
+		}
+	}
+
+	return stagesList;
+}
+
+
+/*
+ * Gets the paths that a $match filter reads. Returns false if the filter can
+ * read more than its field paths ($expr, $where, $jsonSchema, $text etc.).
+ */
+static bool
+TryGetMatchFilterPaths(const bson_value_t *filter, List **paths)
+{
+	if (filter->value_type != BSON_TYPE_DOCUMENT)
+	{
+		return false;
+	}
+
+	bson_iter_t filterIter;
+	BsonValueInitIterator(filter, &filterIter);
+	while (bson_iter_next(&filterIter))
+	{
+		StringView key = bson_iter_key_string_view(&filterIter);
+		if (!StringViewStartsWith(&key, '$'))
+		{
+			StringView *path = palloc(sizeof(StringView));
+			*path = key;
+			*paths = lappend(*paths, path);
+			continue;
+		}
+
+		if (strcmp(key.string, "$comment") == 0)
+		{
+			continue;
+		}
+
+		if (strcmp(key.string, "$and") != 0 && strcmp(key.string, "$or") != 0 &&
+			strcmp(key.string, "$nor") != 0)
+		{
+			return false;
+		}
+
+		if (!BSON_ITER_HOLDS_ARRAY(&filterIter))
+		{
+			return false;
+		}
+
+		bson_iter_t clauseIter;
+		BsonValueInitIterator(bson_iter_value(&filterIter), &clauseIter);
+		while (bson_iter_next(&clauseIter))
+		{
+			if (!TryGetMatchFilterPaths(bson_iter_value(&clauseIter), paths))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * Whether a $match that reads matchPaths filters the same documents before and after
+ * the given stage.
+ */
+static bool
+CanMoveMatchBeforeStage(List *matchPaths, const AggregationStage *stage)
+{
+	const bson_value_t *stageValue = &stage->stageValue;
+	switch (stage->stageDefinition->stageEnum)
+	{
+		case Stage_AddFields:
+		case Stage_Set:
+		{
+			if (stageValue->value_type != BSON_TYPE_DOCUMENT)
+			{
+				return false;
+			}
+
+			bool skipOperatorValues = false;
+			List *writtenPaths = GetTopLevelKeyPaths(stageValue, skipOperatorValues);
+			ListCell *cell;
+			foreach(cell, writtenPaths)
+			{
+				if (PathListOverlaps(matchPaths, lfirst(cell)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		case Stage_Unset:
+		{
+			List *removedPaths = NIL;
+			if (stageValue->value_type == BSON_TYPE_UTF8)
+			{
+				StringView *path = palloc(sizeof(StringView));
+				path->string = stageValue->value.v_utf8.str;
+				path->length = stageValue->value.v_utf8.len;
+				removedPaths = lappend(removedPaths, path);
+			}
+			else if (stageValue->value_type == BSON_TYPE_ARRAY)
+			{
+				bson_iter_t unsetIter;
+				BsonValueInitIterator(stageValue, &unsetIter);
+				while (bson_iter_next(&unsetIter))
+				{
+					if (!BSON_ITER_HOLDS_UTF8(&unsetIter))
+					{
+						return false;
+					}
+
+					StringView *path = palloc(sizeof(StringView));
+					path->string = bson_iter_utf8(&unsetIter, &path->length);
+					removedPaths = lappend(removedPaths, path);
+				}
+			}
+			else
+			{
+				return false;
+			}
+
+			ListCell *cell;
+			foreach(cell, removedPaths)
+			{
+				if (PathListOverlaps(matchPaths, lfirst(cell)))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		case Stage_Project:
+		{
+			/* Only inclusions and exclusions: Expressions can rename or compute paths */
+			if (stageValue->value_type != BSON_TYPE_DOCUMENT)
+			{
+				return false;
+			}
+
+			List *includedPaths = NIL;
+			List *excludedPaths = NIL;
+			bool isIdExcluded = false;
+			bson_iter_t projectIter;
+			BsonValueInitIterator(stageValue, &projectIter);
+			while (bson_iter_next(&projectIter))
+			{
+				const bson_value_t *value = bson_iter_value(&projectIter);
+				if (!BsonValueIsNumberOrBool(value))
+				{
+					return false;
+				}
+
+				StringView *path = palloc(sizeof(StringView));
+				*path = bson_iter_key_string_view(&projectIter);
+				if (StringViewStartsWith(path, '$'))
+				{
+					return false;
+				}
+
+				bool isIdPath = strcmp(path->string, "_id") == 0;
+				if (BsonValueAsBool(value))
+				{
+					includedPaths = lappend(includedPaths, path);
+				}
+				else if (isIdPath)
+				{
+					isIdExcluded = true;
+				}
+				else
+				{
+					excludedPaths = lappend(excludedPaths, path);
+				}
+			}
+
+			if (isIdExcluded)
+			{
+				StringView *idPath = palloc(sizeof(StringView));
+				*idPath = IdFieldStringView;
+				excludedPaths = lappend(excludedPaths, idPath);
+			}
+
+			ListCell *cell;
+			foreach(cell, matchPaths)
+			{
+				StringView *matchPath = lfirst(cell);
+				if (PathListOverlaps(excludedPaths, matchPath))
+				{
+					return false;
+				}
+
+				if (includedPaths == NIL)
+				{
+					continue;
+				}
+
+				/* With inclusions the path must be kept whole: it or a parent is included */
+				StringView matchPathTopLevel = StringViewFindPrefix(matchPath, '.');
+				bool isIncluded = !isIdExcluded &&
+								  StringViewEquals(matchPathTopLevel.length > 0 ?
+												   &matchPathTopLevel : matchPath,
+												   &IdFieldStringView);
+				ListCell *includedCell;
+				foreach(includedCell, includedPaths)
+				{
+					StringView *includedPath = lfirst(includedCell);
+					if (StringViewEquals(includedPath, matchPath) ||
+						(StringViewStartsWithStringView(matchPath, includedPath) &&
+						 matchPath->string[includedPath->length] == '.'))
+					{
+						isIncluded = true;
+						break;
+					}
+				}
+
+				if (!isIncluded)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		case Stage_Unwind:
+		{
+			StringView unwindPath = { 0 };
+			StringView indexPath = { 0 };
+			if (stageValue->value_type == BSON_TYPE_UTF8)
+			{
+				unwindPath.string = stageValue->value.v_utf8.str;
+				unwindPath.length = stageValue->value.v_utf8.len;
+			}
+			else if (stageValue->value_type == BSON_TYPE_DOCUMENT)
+			{
+				bson_iter_t unwindIter;
+				BsonValueInitIterator(stageValue, &unwindIter);
+				while (bson_iter_next(&unwindIter))
+				{
+					const char *key = bson_iter_key(&unwindIter);
+					if (strcmp(key, "path") == 0 && BSON_ITER_HOLDS_UTF8(&unwindIter))
+					{
+						unwindPath.string = bson_iter_utf8(&unwindIter,
+														   &unwindPath.length);
+					}
+					else if (strcmp(key, "includeArrayIndex") == 0 &&
+							 BSON_ITER_HOLDS_UTF8(&unwindIter))
+					{
+						indexPath.string = bson_iter_utf8(&unwindIter,
+														  &indexPath.length);
+					}
+					else if (strcmp(key, "preserveNullAndEmptyArrays") != 0)
+					{
+						/* Leave invalid specs to the $unwind stage to report */
+						return false;
+					}
+				}
+			}
+
+			if (unwindPath.length < 2 || unwindPath.string[0] != '$')
+			{
+				return false;
+			}
+
+			unwindPath.string++;
+			unwindPath.length--;
+			return !PathListOverlaps(matchPaths, &unwindPath) &&
+				   (indexPath.length == 0 || !PathListOverlaps(matchPaths, &indexPath));
+		}
+
+		case Stage_Lookup:
+		{
+			StringView asPath = { 0 };
+			return TryGetLookupAsPath(stageValue, &asPath) &&
+				   !PathListOverlaps(matchPaths, &asPath);
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * Whether any of the paths is the given path, a parent of it or a child of it.
+ */
+static bool
+PathListOverlaps(List *paths, const StringView *path)
+{
+	ListCell *cell;
+	foreach(cell, paths)
+	{
+		StringView *other = lfirst(cell);
+		const StringView *shorter = other->length < path->length ? other : path;
+		const StringView *longer = other->length < path->length ? path : other;
+		if (StringViewStartsWithStringView(longer, shorter) &&
+			(longer->length == shorter->length ||
+			 longer->string[shorter->length] == '.'))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * Gets the keys of a document ($addFields, $sort specs) as paths. Returns NIL if
+ * skipOperatorValues is set and any of the values isn't a plain number (e.g.
+ * $sort: { "score": { "$meta": "textScore" } }).
+ */
+static List *
+GetTopLevelKeyPaths(const bson_value_t *document, bool skipOperatorValues)
+{
+	List *paths = NIL;
+	bson_iter_t documentIter;
+	BsonValueInitIterator(document, &documentIter);
+	while (bson_iter_next(&documentIter))
+	{
+		if (skipOperatorValues && !BsonValueIsNumber(bson_iter_value(&documentIter)))
+		{
+			return NIL;
+		}
+
+		StringView *path = palloc(sizeof(StringView));
+		*path = bson_iter_key_string_view(&documentIter);
+		paths = lappend(paths, path);
+	}
+
+	return paths;
+}
+
+
+/*
+ * Gets the "as" field of a $lookup stage.
+ */
+static bool
+TryGetLookupAsPath(const bson_value_t *lookupValue, StringView *asPath)
+{
+	if (lookupValue->value_type != BSON_TYPE_DOCUMENT)
+	{
+		return false;
+	}
+
+	bson_iter_t lookupIter;
+	BsonValueInitIterator(lookupValue, &lookupIter);
+	if (!bson_iter_find(&lookupIter, "as") || !BSON_ITER_HOLDS_UTF8(&lookupIter))
+	{
+		return false;
+	}
+
+	asPath->string = bson_iter_utf8(&lookupIter, &asPath->length);
+	return asPath->length > 0 && asPath->string[0] != '$';
+}
+
+
+/*
+ * Merges a $limit or $skip stage into the same stage before it:
+ * $limit: a, $limit: b => $limit: min(a, b) and $skip: a, $skip: b => $skip: a + b.
+ * Only positive integer values are combined; other values are left to the stage
+ * to validate.
+ */
+static bool
+TryCoalesceLimitOrSkip(AggregationStage *stage, const AggregationStage *nextStage)
+{
+	const bson_value_t *left = &stage->stageValue;
+	const bson_value_t *right = &nextStage->stageValue;
+	if ((left->value_type != BSON_TYPE_INT32 && left->value_type != BSON_TYPE_INT64) ||
+		(right->value_type != BSON_TYPE_INT32 && right->value_type != BSON_TYPE_INT64))
+	{
+		return false;
+	}
+
+	int64_t leftValue = BsonValueAsInt64(left);
+	int64_t rightValue = BsonValueAsInt64(right);
+	if (leftValue <= 0 || rightValue <= 0)
+	{
+		return false;
+	}
+
+	int64_t result;
+	if (stage->stageDefinition->stageEnum == Stage_Limit)
+	{
+		result = Min(leftValue, rightValue);
+	}
+	else if (pg_add_s64_overflow(leftValue, rightValue, &result))
+	{
+		return false;
+	}
+
+	stage->stageValue.value_type = BSON_TYPE_INT64;
+	stage->stageValue.value.v_int64 = result;
+	return true;
+}
+
+
+/*
+ * Given a $skip stage and the $limit stage that follows it, updates the $limit to
+ * take the rows of both so that it can run ahead of the $skip. Returns false
+ * if the stages aren't positive integers (left to the stages to validate), or the
+ * sum overflows.
+ */
+static bool
+TryMoveLimitBeforeSkip(const AggregationStage *skipStage, AggregationStage *limitStage)
+{
+	const bson_value_t *skip = &skipStage->stageValue;
+	const bson_value_t *limit = &limitStage->stageValue;
+	if ((skip->value_type != BSON_TYPE_INT32 && skip->value_type != BSON_TYPE_INT64) ||
+		(limit->value_type != BSON_TYPE_INT32 && limit->value_type != BSON_TYPE_INT64))
+	{
+		return false;
+	}
+
+	int64_t skipValue = BsonValueAsInt64(skip);
+	int64_t limitValue = BsonValueAsInt64(limit);
+	if (skipValue <= 0 || limitValue <= 0)
+	{
+		return false;
+	}
+
+	int64_t result;
+	if (pg_add_s64_overflow(skipValue, limitValue, &result))
+	{
+		return false;
+	}
+
+	limitStage->stageValue.value_type = BSON_TYPE_INT64;
+	limitStage->stageValue.value.v_int64 = result;
+	return true;
+}
+
+
+/*
+ * Given an $unwind stage and the $group stage that follows it, checks whether the
+ * $group only references the unwound path (or the array index field of the $unwind).
+ * If so, returns the $project inclusion spec that keeps just those paths in
+ * projectionValue.
+ */
+static bool
+TryGetUnwindGroupProjection(const bson_value_t *unwindValue,
+							const bson_value_t *groupValue,
+							bson_value_t *projectionValue)
+{
+	StringView unwindPath = { 0 };
+	StringView indexPath = { 0 };
+	if (unwindValue->value_type == BSON_TYPE_UTF8)
+	{
+		unwindPath.string = unwindValue->value.v_utf8.str;
+		unwindPath.length = unwindValue->value.v_utf8.len;
+	}
+	else if (unwindValue->value_type == BSON_TYPE_DOCUMENT)
+	{
+		bson_iter_t iter;
+		BsonValueInitIterator(unwindValue, &iter);
+		while (bson_iter_next(&iter))
+		{
+			const char *key = bson_iter_key(&iter);
+			if (strcmp(key, "path") == 0 && BSON_ITER_HOLDS_UTF8(&iter))
+			{
+				unwindPath.string = bson_iter_utf8(&iter, &unwindPath.length);
+			}
+			else if (strcmp(key, "includeArrayIndex") == 0 &&
+					 BSON_ITER_HOLDS_UTF8(&iter))
+			{
+				indexPath.string = bson_iter_utf8(&iter, &indexPath.length);
+			}
+			else if (strcmp(key, "preserveNullAndEmptyArrays") != 0)
+			{
+				/* Leave invalid specs to the $unwind stage to report */
+				return false;
+			}
+		}
+	}
+
+	/* Only well formed paths are considered, the rest is validated by the $unwind */
+	if (unwindPath.length < 2 || unwindPath.string[0] != '$' ||
+		unwindPath.string[1] == '$')
+	{
+		return false;
+	}
+
+	unwindPath.string++;
+	unwindPath.length--;
+	if (StringViewStartsWith(&unwindPath, '$') ||
+		(indexPath.length > 0 && (indexPath.string[0] == '$' ||
+								  StringViewContains(&indexPath, '.'))))
+	{
+		return false;
+	}
+
+	/* _id is always kept by the $project, don't trim when it is the unwound path */
+	StringView idPath = { .string = "_id", .length = 3 };
+	if (StringViewStartsWithStringView(&unwindPath, &idPath) ||
+		(indexPath.length > 0 && StringViewEquals(&indexPath, &idPath)))
+	{
+		return false;
+	}
+
+	if (groupValue->value_type != BSON_TYPE_DOCUMENT ||
+		!IsExpressionLimitedToPaths(groupValue, &unwindPath, &indexPath))
+	{
+		return false;
+	}
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+	PgbsonWriterAppendInt32(&writer, "_id", 3, 0);
+	PgbsonWriterAppendInt32(&writer, unwindPath.string, unwindPath.length, 1);
+	if (indexPath.length > 0 && !StringViewEquals(&indexPath, &unwindPath))
+	{
+		PgbsonWriterAppendInt32(&writer, indexPath.string, indexPath.length, 1);
+	}
+
+	*projectionValue = ConvertPgbsonToBsonValue(PgbsonWriterGetPgbson(&writer));
+	return true;
+}
+
+
+/*
+ * Walks the $group spec and returns true if every field path it references is the
+ * unwound path (or nested under it) or the array index path. Variables are treated as
+ * referencing the full document.
+ */
+static bool
+IsExpressionLimitedToPaths(const bson_value_t *expression,
+						   const StringView *unwindPath,
+						   const StringView *indexPath)
+{
+	check_stack_depth();
+	if (expression->value_type == BSON_TYPE_UTF8)
+	{
+		StringView value = {
+			.string = expression->value.v_utf8.str,
+			.length = expression->value.v_utf8.len
+		};
+		if (!StringViewStartsWith(&value, '$'))
+		{
+			return true;
+		}
+
+		if (value.length < 2 || value.string[1] == '$')
+		{
+			return false;
+		}
+
+		StringView path = StringViewSubstring(&value, 1);
+		StringView prefix = StringViewFindPrefix(&path, '.');
+		if (prefix.length == 0)
+		{
+			prefix = path;
+		}
+
+		if (indexPath->length > 0 && StringViewEquals(&prefix, indexPath))
+		{
+			return true;
+		}
+
+		/* The path must be the unwound path or a path nested under it */
+		return StringViewStartsWithStringView(&path, unwindPath) &&
+			   (path.length == unwindPath->length ||
+				path.string[unwindPath->length] == '.');
+	}
+
+	if (expression->value_type == BSON_TYPE_DOCUMENT ||
+		expression->value_type == BSON_TYPE_ARRAY)
+	{
+		bson_iter_t iter;
+		BsonValueInitIterator(expression, &iter);
+		while (bson_iter_next(&iter))
+		{
+			/*
+			 * sortBy of $top/$bottom and the field operators name document fields
+			 * without a '$' prefix, don't try to reason about them.
+			 */
+			const char *key = bson_iter_key(&iter);
+			if (expression->value_type == BSON_TYPE_DOCUMENT &&
+				(strcmp(key, "sortBy") == 0 || strcmp(key, "$getField") == 0 ||
+				 strcmp(key, "$setField") == 0 || strcmp(key, "$unsetField") == 0))
+			{
+				return false;
+			}
+
+			/* $literal strings that look like paths are treated as paths */
+			if (!IsExpressionLimitedToPaths(bson_iter_value(&iter), unwindPath,
+											indexPath))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * Scans the columnar projection store of the collection in place of its data
+ * table, if it has one and the pipeline reads no path outside of it. The store
+ * has the shard_key_value, object_id and document columns of the data table at
+ * the same positions, so only the relation of the base RTE changes.
+ */
+static void
+TryUseColumnarProjectionStore(Query *baseQuery, MongoCollection *collection,
+							  List *aggregationStages)
+{
+	if (list_length(baseQuery->rtable) != 1)
+	{
+		return;
+	}
+
+	RangeTblEntry *rte = linitial(baseQuery->rtable);
+	if (rte->rtekind != RTE_RELATION)
+	{
+		return;
+	}
+
+	Oid storeRelationId = InvalidOid;
+	List *coveredPaths = GetColumnarProjectionPaths(collection, &storeRelationId);
+	if (coveredPaths == NIL)
+	{
+		return;
+	}
+
+	/* Reads pushed down to a local shard table are left as they are */
+	if (rte->relid != get_relname_relid(collection->tableName, ApiDataNamespaceOid()) ||
+		!IsPipelineCoveredByColumnarProjection(aggregationStages, coveredPaths))
+	{
+		return;
+	}
+
+	rte->relid = storeRelationId;
+
+	/* The store has no creation_time column */
+	rte->eref->colnames = list_copy_head(rte->eref->colnames, 3);
+#if PG_VERSION_NUM >= 160000
+	RTEPermissionInfo *permInfo = getRTEPermissionInfo(baseQuery->rteperminfos, rte);
+	permInfo->relid = storeRelationId;
+#endif
+}
+
+
+/*
+ * Whether the stages read only paths kept by the columnar projection store up
+ * to the $group, $project or $count that replaces the documents. Only $match,
+ * $sort, $skip and $limit may come before it: the documents that come out of
+ * the other stages can still carry uncovered paths.
+ */
+static bool
+IsPipelineCoveredByColumnarProjection(List *aggregationStages, List *coveredPaths)
+{
+	ListCell *stageCell;
+	foreach(stageCell, aggregationStages)
+	{
+		AggregationStage *stage = (AggregationStage *) lfirst(stageCell);
+		const bson_value_t *stageValue = &stage->stageValue;
+		switch (stage->stageDefinition->stageEnum)
+		{
+			case Stage_Match:
+			{
+				List *matchPaths = NIL;
+				if (!TryGetMatchFilterPaths(stageValue, &matchPaths))
+				{
+					return false;
+				}
+
+				ListCell *pathCell;
+				foreach(pathCell, matchPaths)
+				{
+					if (!IsPathCoveredByColumnarProjection(lfirst(pathCell),
+														   coveredPaths))
+					{
+						return false;
+					}
+				}
+
+				continue;
+			}
+
+			case Stage_Sort:
+			{
+				if (stageValue->value_type != BSON_TYPE_DOCUMENT)
+				{
+					return false;
+				}
+
+				bson_iter_t sortIter;
+				BsonValueInitIterator(stageValue, &sortIter);
+				while (bson_iter_next(&sortIter))
+				{
+					/* $meta sorts are left to the data table */
+					StringView path = bson_iter_key_string_view(&sortIter);
+					if (BSON_ITER_HOLDS_DOCUMENT(&sortIter) ||
+						!IsPathCoveredByColumnarProjection(&path, coveredPaths))
+					{
+						return false;
+					}
+				}
+
+				continue;
+			}
+
+			case Stage_Skip:
+			case Stage_Limit:
+			{
+				continue;
+			}
+
+			case Stage_Count:
+			{
+				return true;
+			}
+
+			case Stage_Group:
+			{
+				return stageValue->value_type == BSON_TYPE_DOCUMENT &&
+					   IsExpressionCoveredByColumnarProjection(stageValue,
+															   coveredPaths);
+			}
+
+			case Stage_Project:
+			{
+				/* An exclusion projection keeps the uncovered paths */
+				bool hasInclusion = false;
+				return stageValue->value_type == BSON_TYPE_DOCUMENT &&
+					   IsProjectionCoveredByColumnarProjection(stageValue, NULL,
+															   coveredPaths,
+															   &hasInclusion) &&
+					   hasInclusion;
+			}
+
+			default:
+			{
+				return false;
+			}
+		}
+	}
+
+	/* The documents themselves are returned */
+	return false;
+}
+
+
+/*
+ * Walks an inclusion $project spec and returns true if every path it includes
+ * or references is kept by the columnar projection store. Sets hasInclusion if
+ * the spec includes or computes a field (otherwise it's an exclusion of _id).
+ */
+static bool
+IsProjectionCoveredByColumnarProjection(const bson_value_t *projection,
+										const char *pathPrefix,
+										List *coveredPaths, bool *hasInclusion)
+{
+	check_stack_depth();
+
+	bson_iter_t projectionIter;
+	BsonValueInitIterator(projection, &projectionIter);
+	while (bson_iter_next(&projectionIter))
+	{
+		const char *key = bson_iter_key(&projectionIter);
+		const bson_value_t *value = bson_iter_value(&projectionIter);
+		char *path = pathPrefix == NULL ? (char *) key :
+					 psprintf("%s.%s", pathPrefix, key);
+
+		if (BsonValueIsNumberOrBool(value))
+		{
+			if (!BsonValueAsBool(value))
+			{
+				if (pathPrefix != NULL || strcmp(key, "_id") != 0)
+				{
+					return false;
+				}
+
+				continue;
+			}
+
+			StringView pathView = CreateStringViewFromString(path);
+			if (!IsPathCoveredByColumnarProjection(&pathView, coveredPaths))
+			{
+				return false;
+			}
+
+			*hasInclusion = true;
+			continue;
+		}
+
+		if (value->value_type == BSON_TYPE_DOCUMENT)
+		{
+			bson_iter_t valueIter;
+			BsonValueInitIterator(value, &valueIter);
+			if (bson_iter_next(&valueIter) && bson_iter_key(&valueIter)[0] != '$')
+			{
+				/* A nested projection */
+				if (!IsProjectionCoveredByColumnarProjection(value, path, coveredPaths,
+															 hasInclusion))
+				{
+					return false;
+				}
+
+				continue;
+			}
+		}
+
+		if (!IsExpressionCoveredByColumnarProjection(value, coveredPaths))
+		{
+			return false;
+		}
+
+		*hasInclusion = true;
+	}
+
+	return true;
+}
+
+
+/*
+ * Walks an expression (or a $group spec) and returns true if every field path
+ * it references is kept by the columnar projection store. Variables are treated
+ * as referencing the full document.
+ */
+static bool
+IsExpressionCoveredByColumnarProjection(const bson_value_t *expression,
+										List *coveredPaths)
+{
+	check_stack_depth();
+	if (expression->value_type == BSON_TYPE_UTF8)
+	{
+		StringView value = {
+			.string = expression->value.v_utf8.str,
+			.length = expression->value.v_utf8.len
+		};
+		if (!StringViewStartsWith(&value, '$'))
+		{
+			return true;
+		}
+
+		if (value.length < 2 || value.string[1] == '$')
+		{
+			return false;
+		}
+
+		StringView path = StringViewSubstring(&value, 1);
+		return IsPathCoveredByColumnarProjection(&path, coveredPaths);
+	}
+
+	if (expression->value_type == BSON_TYPE_DOCUMENT ||
+		expression->value_type == BSON_TYPE_ARRAY)
+	{
+		bson_iter_t iter;
+		BsonValueInitIterator(expression, &iter);
+		while (bson_iter_next(&iter))
+		{
+			/*
+			 * sortBy of $top/$bottom and the field operators name document fields
+			 * without a '$' prefix, don't try to reason about them.
+			 */
+			const char *key = bson_iter_key(&iter);
+			if (expression->value_type == BSON_TYPE_DOCUMENT &&
+				(strcmp(key, "sortBy") == 0 || strcmp(key, "$getField") == 0 ||
+				 strcmp(key, "$setField") == 0 || strcmp(key, "$unsetField") == 0))
+			{
+				return false;
+			}
+
+			if (!IsExpressionCoveredByColumnarProjection(bson_iter_value(&iter),
+														 coveredPaths))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,564 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/aggregation/bson_aggregation_query_cache.c
+ *
+ * Implementation of a per backend cache of the queries generated for
+ * find and aggregate.
+ *
+ * Drivers send the same find and aggregate specs over and over (the same
+ * pipeline, the same filter with the same values, the getMore of a streaming
+ * cursor that regenerates the query of the first page). Generating the
+ * query walks the spec, looks up the collection and builds the stages every
+ * time. The cache is keyed by the shape of the request: The database, the
+ * spec without the fields that change per request (lsid, txnNumber,
+ * $clusterTime, maxTimeMS) and the inputs of the query generation. A hit
+ * returns a copy of the query generated for the first request along with
+ * the QueryData it produced.
+ *
+ * The query embeds the relation the collection maps to, so the whole cache
+ * is dropped on any relcache invalidation (which covers creating, dropping
+ * and altering collections as well as index changes). The query generation
+ * also depends on the user settable configs (feature flags and limits), so
+ * the cache is dropped as well when any of them changed (ConfigGeneration).
+ * A least recently used (LRU) queue limits the size of the cache.
+ *
+ * The feature usage the query generation reports is recorded with the entry
+ * and reported again on every hit, so the counters don't depend on the cache.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+#include <miscadmin.h>
+#include <common/hashfn.h>
+#include <lib/ilist.h>
+#include <lib/stringinfo.h>
+#include <nodes/nodeFuncs.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+
+#include "io/bson_core.h"
+#include "aggregation/bson_aggregation_query_cache.h"
+#include "commands/commands_common.h"
+#include "commands/parse_error.h"
+#include "configs/config_initialization.h"
+#include "operators/bson_expression.h"
+#include "utils/feature_counter.h"
+#include "utils/type_cache.h"
+
+typedef struct QueryShapeCacheEntry
+{
+	/* The hash of the shape: key of the entry in the hash */
+	uint64 hash;
+
+	/* The shape the query was generated for */
+	bytea *shape;
+
+	/* The generated query */
+	Query *query;
+
+	/* The QueryData the query generation produced */
+	QueryData queryData;
+
+	/* The features the query generation reported and how many times */
+	int numReportedFeatures;
+	int *reportedFeatureIds;
+	int *reportedFeatureCounts;
+
+	/* memory context that holds the shape and the query */
+	MemoryContext entryContext;
+
+	/* node in the LRU queue */
+	dlist_node lruNode;
+
+	/* whether this cache entry was fully built */
+	bool isValid;
+} QueryShapeCacheEntry;
+
+/*
+ * The state to replace the $$NOW of the request the query was generated
+ * for in the variable specs of the query.
+ */
+typedef struct ReplaceNowVariableContext
+{
+	/* The $$NOW the query was generated with */
+	bson_value_t generatedNow;
+
+	/* The $$NOW of the current request */
+	bson_value_t currentNow;
+} ReplaceNowVariableContext;
+
+/* GUC that controls the query shape cache size */
+extern int QueryShapeCacheSizeLimit;
+
+extern bool EnableNowSystemVariable;
+
+/* memory context in which the cache is allocated */
+static MemoryContext QueryShapeCacheContext = NULL;
+
+/* hash table containing the cached queries */
+static HTAB *QueryShapeHash = NULL;
+
+/* linked list for keeping track of LRU */
+static dlist_head QueryShapeLRUQueue;
+
+/* number of entries in the query shape cache */
+static int CachedQueryShapesCount = 0;
+
+/* number of times the cache was invalidated */
+static uint64 QueryShapeCacheInvalidations = 0;
+
+/* the ConfigGeneration the cached queries were generated with */
+static uint64 QueryShapeCacheConfigGeneration = 0;
+
+static void InitializeQueryShapeCache(void);
+static void RemoveQueryShapeCacheEntry(QueryShapeCacheEntry *entry);
+static bytea * BuildQueryShape(QueryShapeCacheKind kind, text *database, pgbson *spec,
+							   const QueryData *queryData, bool addCursorParams);
+static bool SpecReferencesTimeVariables(pgbson *spec);
+static void ApplyStatementTimeoutFromSpec(QueryShapeCacheKind kind, pgbson *spec);
+static bool ReplaceNowVariableWalker(Node *node, ReplaceNowVariableContext *context);
+
+
+/*
+ * GetQueryFromShapeCache returns a copy of the cached query generated for the
+ * shape of the request and updates the queryData the same way the query
+ * generation did. Returns NULL on a miss, in which case the key is set up to
+ * add the query once it is generated.
+ */
+Query *
+GetQueryFromShapeCache(QueryShapeCacheKind kind, text *database, pgbson *spec,
+					   QueryData *queryData, bool addCursorParams,
+					   bool setStatementTimeout, QueryShapeCacheKey *key)
+{
+	key->shape = NULL;
+	key->hash = 0;
+	key->featureCountersAtMiss = NULL;
+
+	/* Queries generated with other config values can't be reused */
+	if (QueryShapeCacheConfigGeneration != ConfigGeneration)
+	{
+		InvalidateQueryShapeCache();
+		QueryShapeCacheConfigGeneration = ConfigGeneration;
+	}
+
+	key->invalidationCount = QueryShapeCacheInvalidations;
+
+	/*
+	 * Time variables used in the spec may be evaluated while generating
+	 * the query, so those requests always generate a new query.
+	 */
+	if (QueryShapeCacheSizeLimit <= 0 || SpecReferencesTimeVariables(spec))
+	{
+		return NULL;
+	}
+
+	key->shape = BuildQueryShape(kind, database, spec, queryData, addCursorParams);
+	key->hash = hash_bytes_extended((const unsigned char *) VARDATA(key->shape),
+									VARSIZE(key->shape) - VARHDRSZ, 0);
+
+	InitializeQueryShapeCache();
+
+	QueryShapeCacheEntry *entry = hash_search(QueryShapeHash, &key->hash, HASH_FIND,
+											  NULL);
+	if (entry == NULL || !entry->isValid ||
+		VARSIZE(entry->shape) != VARSIZE(key->shape) ||
+		memcmp(VARDATA(entry->shape), VARDATA(key->shape),
+			   VARSIZE(key->shape) - VARHDRSZ) != 0)
+	{
+		key->featureCountersAtMiss = palloc(sizeof(FeatureCounter));
+		memcpy(key->featureCountersAtMiss, GetBackendFeatureCounters(),
+			   sizeof(FeatureCounter));
+		return NULL;
+	}
+
+	/* move entry to the tail of the queue */
+	dlist_delete(&entry->lruNode);
+	dlist_push_tail(&QueryShapeLRUQueue, &entry->lruNode);
+
+	/*
+	 * Copy everything out of the entry: The caller owns the query, and the
+	 * entry may be dropped by an invalidation while the query runs.
+	 */
+	Query *query = copyObject(entry->query);
+	TimeSystemVariables requestTimeVariables = queryData->timeSystemVariables;
+	bson_value_t generatedNow = entry->queryData.timeSystemVariables.nowValue;
+
+	*queryData = entry->queryData;
+	if (entry->queryData.namespaceName != NULL)
+	{
+		queryData->namespaceName = pstrdup(entry->queryData.namespaceName);
+	}
+
+	queryData->timeSystemVariables = requestTimeVariables;
+	if (EnableNowSystemVariable)
+	{
+		/* Resolve the $$NOW of this request the same way the query generation does */
+		bson_value_t emptyLet = { 0 };
+		bool isWriteCommand = false;
+		ParseAndGetTopLevelVariableSpec(&emptyLet, &queryData->timeSystemVariables,
+										isWriteCommand);
+
+		ReplaceNowVariableContext context = {
+			.generatedNow = generatedNow,
+			.currentNow = queryData->timeSystemVariables.nowValue
+		};
+
+		if (generatedNow.value_type == BSON_TYPE_DATE_TIME &&
+			context.currentNow.value_type == BSON_TYPE_DATE_TIME &&
+			generatedNow.value.v_datetime != context.currentNow.value.v_datetime)
+		{
+			query_tree_walker(query, ReplaceNowVariableWalker, &context, 0);
+		}
+	}
+
+	if (setStatementTimeout)
+	{
+		ApplyStatementTimeoutFromSpec(kind, spec);
+	}
+
+	for (int i = 0; i < entry->numReportedFeatures; i++)
+	{
+		for (int j = 0; j < entry->reportedFeatureCounts[i]; j++)
+		{
+			ReportFeatureUsage(entry->reportedFeatureIds[i]);
+		}
+	}
+
+	return query;
+}
+
+
+/*
+ * AddQueryToShapeCache adds a copy of the query generated on a miss of
+ * GetQueryFromShapeCache to the cache, along with the QueryData the query
+ * generation produced. Purges the oldest entry from the LRU queue if the
+ * cache exceeds the size limit.
+ */
+void
+AddQueryToShapeCache(QueryShapeCacheKey *key, Query *query, const QueryData *queryData)
+{
+	/*
+	 * The query may be built against metadata that was invalidated while
+	 * it was generated: Don't keep it around in that case.
+	 */
+	if (key->shape == NULL ||
+		key->invalidationCount != QueryShapeCacheInvalidations)
+	{
+		return;
+	}
+
+	InitializeQueryShapeCache();
+
+	bool foundInCache = false;
+	QueryShapeCacheEntry *entry = hash_search(QueryShapeHash, &key->hash, HASH_ENTER,
+											  &foundInCache);
+	if (foundInCache && entry->isValid)
+	{
+		/* Another shape with the same hash, replace it */
+		dlist_delete(&entry->lruNode);
+		MemoryContextDelete(entry->entryContext);
+		CachedQueryShapesCount--;
+	}
+
+	/*
+	 * Since HASH_ENTER doesn't zero-initialize cache-entry, we first set
+	 * isValid to false before performing any other operations. That way,
+	 * if we now fail to fully-initialize the cache entry for some reason,
+	 * then the next caller wouldn't mistakenly assume the otherwise due to
+	 * isValid being set to a garbage value different than "false".
+	 */
+	entry->isValid = false;
+	entry->entryContext = NULL;
+
+	if (CachedQueryShapesCount >= QueryShapeCacheSizeLimit &&
+		!dlist_is_empty(&QueryShapeLRUQueue))
+	{
+		RemoveQueryShapeCacheEntry(dlist_head_element(QueryShapeCacheEntry, lruNode,
+													  &QueryShapeLRUQueue));
+	}
+
+	MemoryContext entryContext = AllocSetContextCreate(QueryShapeCacheContext,
+													   "DocumentDB query shape entry",
+													   ALLOCSET_SMALL_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(entryContext);
+	entry->shape = (bytea *) palloc(VARSIZE(key->shape));
+	memcpy(entry->shape, key->shape, VARSIZE(key->shape));
+	entry->query = copyObject(query);
+	entry->queryData = *queryData;
+	if (queryData->namespaceName != NULL)
+	{
+		entry->queryData.namespaceName = pstrdup(queryData->namespaceName);
+	}
+
+	/*
+	 * The counters only grow in this backend, unless the counters were reset
+	 * meanwhile in which case the difference is not used.
+	 */
+	const int *featureCounters = GetBackendFeatureCounters();
+	int reportedCounts[MAX_FEATURE_INDEX] = { 0 };
+	entry->numReportedFeatures = 0;
+	for (int featureId = 0; key->featureCountersAtMiss != NULL &&
+		 featureId < MAX_FEATURE_INDEX; featureId++)
+	{
+		reportedCounts[featureId] = featureCounters[featureId] -
+									key->featureCountersAtMiss[featureId];
+		if (reportedCounts[featureId] > 0)
+		{
+			entry->numReportedFeatures++;
+		}
+	}
+
+	entry->reportedFeatureIds = palloc(sizeof(int) *
+									   Max(entry->numReportedFeatures, 1));
+	entry->reportedFeatureCounts = palloc(sizeof(int) *
+										  Max(entry->numReportedFeatures, 1));
+	int reportedIndex = 0;
+	for (int featureId = 0; featureId < MAX_FEATURE_INDEX; featureId++)
+	{
+		if (reportedCounts[featureId] > 0)
+		{
+			entry->reportedFeatureIds[reportedIndex] = featureId;
+			entry->reportedFeatureCounts[reportedIndex] = reportedCounts[featureId];
+			reportedIndex++;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	entry->entryContext = entryContext;
+
+	/*
+	 * Now that we initialized all the fields without any errors, append the
+	 * cache entry at the tail of the queue and mark it as valid without any
+	 * operations that could result in an ereport() in between.
+	 */
+	dlist_push_tail(&QueryShapeLRUQueue, &entry->lruNode);
+	CachedQueryShapesCount++;
+	entry->isValid = true;
+}
+
+
+/*
+ * InvalidateQueryShapeCache drops all the cached queries. Called on relcache
+ * invalidations.
+ */
+void
+InvalidateQueryShapeCache(void)
+{
+	QueryShapeCacheInvalidations++;
+
+	if (QueryShapeHash == NULL)
+	{
+		return;
+	}
+
+	MemoryContextDelete(QueryShapeCacheContext);
+	QueryShapeCacheContext = NULL;
+	QueryShapeHash = NULL;
+	CachedQueryShapesCount = 0;
+}
+
+
+/*
+ * InitializeQueryShapeCache initializes the session-level query shape cache.
+ */
+static void
+InitializeQueryShapeCache(void)
+{
+	if (QueryShapeHash != NULL)
+	{
+		return;
+	}
+
+	QueryShapeCacheContext = AllocSetContextCreate(CacheMemoryContext,
+												   "DocumentDB query shape cache context",
+												   ALLOCSET_DEFAULT_SIZES);
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(uint64);
+	info.entrysize = sizeof(QueryShapeCacheEntry);
+	info.hcxt = QueryShapeCacheContext;
+	int hashFlags = HASH_ELEM | HASH_BLOBS | HASH_CONTEXT;
+
+	QueryShapeHash = hash_create("DocumentDB query shape cache hash", 32, &info,
+								 hashFlags);
+
+	dlist_init(&QueryShapeLRUQueue);
+	CachedQueryShapesCount = 0;
+}
+
+
+/*
+ * RemoveQueryShapeCacheEntry removes an entry from the LRU queue and the hash.
+ */
+static void
+RemoveQueryShapeCacheEntry(QueryShapeCacheEntry *entry)
+{
+	dlist_delete(&entry->lruNode);
+	MemoryContextDelete(entry->entryContext);
+
+	bool foundInCache = false;
+	hash_search(QueryShapeHash, &entry->hash, HASH_REMOVE, &foundInCache);
+	CachedQueryShapesCount--;
+}
+
+
+/*
+ * Serializes the inputs the query generation depends on: The kind and options
+ * of the request, the user, the database and the spec without the fields that
+ * change per request and are not used to build the query.
+ */
+static bytea *
+BuildQueryShape(QueryShapeCacheKind kind, text *database, pgbson *spec,
+				const QueryData *queryData, bool addCursorParams)
+{
+	StringInfoData shape;
+	initStringInfo(&shape);
+	appendBinaryStringInfo(&shape, (char *) &kind, sizeof(kind));
+	appendBinaryStringInfo(&shape, (char *) &addCursorParams, sizeof(bool));
+
+	Oid userId = GetUserId();
+	appendBinaryStringInfo(&shape, (char *) &userId, sizeof(Oid));
+	appendBinaryStringInfo(&shape, (char *) &queryData->batchSize, sizeof(int32_t));
+	appendBinaryStringInfo(&shape, (char *) &queryData->cursorKind,
+						   sizeof(QueryCursorType));
+
+	int32 databaseLength = database != NULL ? VARSIZE_ANY_EXHDR(database) : -1;
+	appendBinaryStringInfo(&shape, (char *) &databaseLength, sizeof(int32));
+	if (database != NULL)
+	{
+		appendBinaryStringInfo(&shape, VARDATA_ANY(database), databaseLength);
+	}
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	bson_iter_t specIter;
+	PgbsonInitIterator(spec, &specIter);
+	while (bson_iter_next(&specIter))
+	{
+		const char *key = bson_iter_key(&specIter);
+		if (strcmp(key, "lsid") == 0 || strcmp(key, "txnNumber") == 0 ||
+			strcmp(key, "$clusterTime") == 0 || strcmp(key, "maxTimeMS") == 0)
+		{
+			continue;
+		}
+
+		PgbsonWriterAppendValue(&writer, key, bson_iter_key_len(&specIter),
+								bson_iter_value(&specIter));
+	}
+
+	pgbson *normalizedSpec = PgbsonWriterGetPgbson(&writer);
+	appendBinaryStringInfo(&shape, VARDATA(normalizedSpec),
+						   VARSIZE(normalizedSpec) - VARHDRSZ);
+
+	bytea *result = (bytea *) palloc(VARHDRSZ + shape.len);
+	SET_VARSIZE(result, VARHDRSZ + shape.len);
+	memcpy(VARDATA(result), shape.data, shape.len);
+	pfree(shape.data);
+	return result;
+}
+
+
+/*
+ * Whether the raw spec mentions $$NOW or $$CLUSTER_TIME anywhere (as a value
+ * or in a nested expression).
+ */
+static bool
+SpecReferencesTimeVariables(pgbson *spec)
+{
+	const char *data = VARDATA(spec);
+	size_t length = VARSIZE(spec) - VARHDRSZ;
+	static const char *timeVariables[] = { "$$NOW", "$$CLUSTER_TIME" };
+
+	for (int i = 0; i < (int) lengthof(timeVariables); i++)
+	{
+		size_t variableLength = strlen(timeVariables[i]);
+		for (size_t offset = 0; offset + variableLength <= length; offset++)
+		{
+			if (data[offset] == '$' &&
+				memcmp(data + offset, timeVariables[i], variableLength) == 0)
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * The query generation applies maxTimeMS as it walks the spec: Do the same
+ * when the query comes from the cache.
+ */
+static void
+ApplyStatementTimeoutFromSpec(QueryShapeCacheKind kind, pgbson *spec)
+{
+	bson_iter_t maxTimeIter;
+	if (PgbsonInitIteratorAtPath(spec, "maxTimeMS", &maxTimeIter))
+	{
+		const bson_value_t *value = bson_iter_value(&maxTimeIter);
+		EnsureTopLevelFieldIsNumberLike(kind == QueryShapeCacheKind_Aggregate ?
+										"aggregate.maxTimeMS" : "find.maxTimeMS",
+										value);
+		SetExplicitStatementTimeout(BsonValueAsInt32(value));
+	}
+}
+
+
+/*
+ * Replaces the $$NOW of the request the query was generated for with the one
+ * of the current request in the variable specs of the query (and its nested
+ * pipelines). Variable specs are bson constants that start with the "now"
+ * field.
+ */
+static bool
+ReplaceNowVariableWalker(Node *node, ReplaceNowVariableContext *context)
+{
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	if (IsA(node, Query))
+	{
+		return query_tree_walker((Query *) node, ReplaceNowVariableWalker, context, 0);
+	}
+
+	if (IsA(node, Const))
+	{
+		Const *constNode = (Const *) node;
+		if (constNode->constisnull || constNode->consttype != BsonTypeId())
+		{
+			return false;
+		}
+
+		bson_iter_t variableIter;
+		PgbsonInitIterator(DatumGetPgBson(constNode->constvalue), &variableIter);
+		if (!bson_iter_next(&variableIter) ||
+			strcmp(bson_iter_key(&variableIter), "now") != 0 ||
+			!BSON_ITER_HOLDS_DATE_TIME(&variableIter) ||
+			bson_iter_date_time(&variableIter) !=
+			context->generatedNow.value.v_datetime)
+		{
+			return false;
+		}
+
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+		PgbsonWriterAppendValue(&writer, "now", 3, &context->currentNow);
+		while (bson_iter_next(&variableIter))
+		{
+			PgbsonWriterAppendValue(&writer, bson_iter_key(&variableIter),
+									bson_iter_key_len(&variableIter),
+									bson_iter_value(&variableIter));
+		}
+
+		constNode->constvalue = PointerGetDatum(PgbsonWriterGetPgbson(&writer));
+		return false;
+	}
+
+	return expression_tree_walker(node, ReplaceNowVariableWalker, context);
+}
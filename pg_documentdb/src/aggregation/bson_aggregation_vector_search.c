@@ -1487,6 +1487,26 @@ ParseAndValidateIndexSpecificOptions(VectorSearchOptions *vectorSearchOptions)
 	{
 		vectorSearchOptions->searchParamPgbson = searchParamPgbson;
 	}
+
+	/*
+	 * The target recall is resolved to a calibrated efSearch or nProbes when
+	 * the search parameters are calculated for the index (an explicit
+	 * efSearch or nProbes takes precedence).
+	 */
+	if (vectorSearchOptions->targetRecall > 0)
+	{
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+		PgbsonWriterAppendDouble(&writer, VECTOR_PARAMETER_NAME_TARGET_RECALL,
+								 VECTOR_PARAMETER_NAME_TARGET_RECALL_STR_LEN,
+								 vectorSearchOptions->targetRecall);
+		if (vectorSearchOptions->searchParamPgbson != NULL)
+		{
+			PgbsonWriterConcat(&writer, vectorSearchOptions->searchParamPgbson);
+		}
+
+		vectorSearchOptions->searchParamPgbson = PgbsonWriterGetPgbson(&writer);
+	}
 }
 
 
@@ -1555,6 +1575,18 @@ HandleVectorSearchCore(Query *query, VectorSearchOptions *vectorSearchOptions,
 	/* Add the sort by to the query */
 	TargetEntry *sortEntry = AddSortByToQuery(query, processedSortExpr);
 
+	/*
+	 * Compressed indexes rank on the compressed vectors: Unless told otherwise,
+	 * fetch k * the default oversampling candidates so that rescoring them on the
+	 * full precision vectors of the documents can recover the true top k.
+	 */
+	if (vectorSearchOptions->oversampling == 0 &&
+		!vectorSearchOptions->exactSearch &&
+		vectorSearchOptions->compressionType != VectorIndexCompressionType_None)
+	{
+		vectorSearchOptions->oversampling = VectorSearchDefaultOversampling;
+	}
+
 	/* Calculate the limit for oversampling */
 	int innerLimit = vectorSearchOptions->resultCount;
 	if (vectorSearchOptions->oversampling > 1)
@@ -1828,6 +1860,25 @@ ParseAndValidateVectorQuerySpecCore(const pgbson *vectorSearchSpecPgbson,
 									"$oversampling must be set to a value that is greater or equal to 1.")));
 			}
 		}
+		else if (strcmp(key, VECTOR_PARAMETER_NAME_TARGET_RECALL) == 0)
+		{
+			if (!BSON_ITER_HOLDS_NUMBER(&specIter))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"$targetRecall must be a number value.")));
+			}
+
+			vectorSearchOptions->targetRecall = BsonValueAsDouble(value);
+
+			if (!(vectorSearchOptions->targetRecall > 0 &&
+				  vectorSearchOptions->targetRecall <= 1))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"$targetRecall must be greater than 0 and less than or equal to 1.")));
+			}
+		}
 		else if (strcmp(key, "score") == 0)
 		{
 			if (!BSON_ITER_HOLDS_DOCUMENT(&specIter))
@@ -1868,12 +1919,6 @@ ParseAndValidateVectorQuerySpecCore(const pgbson *vectorSearchSpecPgbson,
 						errmsg(
 							"$k is required field for using a vector index.")));
 	}
-
-	/* Set default values for optional parameters */
-	if (vectorSearchOptions->oversampling == 0)
-	{
-		vectorSearchOptions->oversampling = 1;
-	}
 }
 
 
@@ -32,6 +32,8 @@
 #include "utils/feature_counter.h"
 #include "utils/documentdb_errors.h"
 
+extern bool EnableApproxCountDistinct;
+
 /* --------------------------------------------------------- */
 /* Data types */
 /* --------------------------------------------------------- */
@@ -185,6 +187,10 @@ static WindowFunc * HandleDollarFirstLastOperators(const bson_value_t *opValue,
 /*===================================*/
 static WindowFunc * HandleDollarAddToSetWindowOperator(const bson_value_t *opValue,
 													   WindowOperatorContext *context);
+static WindowFunc * HandleDollarApproxCountDistinctWindowOperator(const
+																  bson_value_t *opValue,
+																  WindowOperatorContext
+																  *context);
 static WindowFunc * HandleDollarAvgWindowOperator(const bson_value_t *opValue,
 												  WindowOperatorContext *context);
 static WindowFunc * HandleDollarCountWindowOperator(const bson_value_t *opValue,
@@ -261,6 +267,10 @@ static const WindowOperatorDefinition WindowOperatorDefinitions[] =
 		.operatorName = "$addToSet",
 		.windowOperatorFunc = &HandleDollarAddToSetWindowOperator
 	},
+	{
+		.operatorName = "$approxCountDistinct",
+		.windowOperatorFunc = &HandleDollarApproxCountDistinctWindowOperator
+	},
 	{
 		.operatorName = "$avg",
 		.windowOperatorFunc = &HandleDollarAvgWindowOperator
@@ -1810,6 +1820,28 @@ HandleDollarAddToSetWindowOperator(const bson_value_t *opValue,
 }
 
 
+/*
+ * Handles the $approxCountDistinct window operator: The distinct count of the window
+ * estimated by a HyperLogLog sketch.
+ */
+static WindowFunc *
+HandleDollarApproxCountDistinctWindowOperator(const bson_value_t *opValue,
+											  WindowOperatorContext *context)
+{
+	if (!EnableApproxCountDistinct || !IsClusterVersionAtleast(DocDB_V0, 108, 0))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_FAILEDTOPARSE),
+						errmsg("Unrecognized window function, %s",
+							   "$approxCountDistinct"),
+						errdetail_log("Unrecognized window function, %s",
+									  "$approxCountDistinct")));
+	}
+
+	return GetSimpleBsonExpressionGetWindowFunc(opValue, context,
+												BsonApproxCountDistinctAggregateFunctionOid());
+}
+
+
 /*
  *  Parse array input for $covariancePop and $covarianceSamp window operators
  */
@@ -3008,10 +3040,8 @@ HandleDollarConstFillWindowOperator(const bson_value_t *opValue,
 
 /*
  * Handle the $min window operator. This uses the existing
- * `bsonmin` aggregate function.
- *
- * TODO: This is just a quick implementation. Later add inverse transition
- * to make it performant for moving windows
+ * `bsonmin` aggregate function, whose moving aggregate keeps a monotonic
+ * deque of the frame so that sliding frames don't recompute it per row.
  */
 static WindowFunc *
 HandleDollarMinWindowOperator(const bson_value_t *opValue,
@@ -3025,10 +3055,8 @@ HandleDollarMinWindowOperator(const bson_value_t *opValue,
 
 /*
  * Handle the $max window operator. This uses the existing
- * `bsonmax` aggregate function.
- *
- * TODO: This is just a quick implementation. Later add inverse transition
- * to make it performant for moving windows
+ * `bsonmax` aggregate function, whose moving aggregate keeps a monotonic
+ * deque of the frame so that sliding frames don't recompute it per row.
  */
 static WindowFunc *
 HandleDollarMaxWindowOperator(const bson_value_t *opValue,
@@ -26,6 +26,13 @@
 #include "aggregation/bson_bucket_auto.h"
 
 extern bool EnableBucketAutoStage;
+extern bool EnableBucketAutoApproximateBoundaries;
+
+/*
+ * The number of groupBy values kept in the reservoir sample that the approximate
+ * bucket boundaries are computed from.
+ */
+#define BUCKET_AUTO_SAMPLE_SIZE 8192
 
 /*
  * Structure for $bucketAuto specs.
@@ -86,6 +93,45 @@ typedef struct
 	MemoryContext mcxt;
 } BucketAutoState;
 
+/*
+ * Transition state of the bson_dollar_bucket_auto_boundaries aggregate.
+ */
+typedef struct
+{
+	/* number of buckets requested */
+	int32 numBuckets;
+
+	/* number of rows seen so far */
+	int64 totalRows;
+
+	/* number of values in the sample */
+	int32 sampleCount;
+
+	/* reservoir sample of the groupBy values */
+	bson_value_t *samples;
+
+	/* the exact min and max of the groupBy values */
+	bson_value_t minValue;
+	bson_value_t maxValue;
+
+	/* state of the generator that picks the reservoir slots */
+	uint64 randomState;
+} BucketAutoSampleState;
+
+/*
+ * Parsed boundaries cached across calls of bson_dollar_bucket_auto_assign.
+ */
+typedef struct
+{
+	/* copy of the boundaries document the cache was built from */
+	pgbson *boundariesDocument;
+
+	/* the bucket boundaries in ascending order */
+	bson_value_t *boundaries;
+
+	int32 numBoundaries;
+} BucketAutoAssignState;
+
 static const char *BUCKETAUTO_BUCKET_ID_FIELD = "bucket_id";
 static const StringView BUCKETAUTO_GRANULARITY_SUPPORTED_TYPES[] = {
 	{ "POWERSOF2", 9 },
@@ -112,6 +158,12 @@ static Query * BuildBucketAutoQuery(Query *query,
 									bson_value_t *groupBy, const
 									bson_value_t *bucketAutoSpec);
 
+static Query * BuildBucketAutoApproximateQuery(Query *query,
+											   AggregationPipelineBuildContext *
+											   context, const
+											   bson_value_t *groupBy, const
+											   bson_value_t *bucketAutoSpec);
+
 static void BuildBucketAutoGroupSpec(const bson_value_t *output, bson_value_t *groupSpec);
 
 static void SetLowerBound(const pgbson *currentValue, const BucketAutoArguments *args,
@@ -128,6 +180,10 @@ static void ValidateValueIsNumberic(pgbson *value);
 
 static double FindClosestPowersOf2(double n, bool findLarger);
 
+static int CompareBucketAutoSamples(const void *left, const void *right);
+
+static uint64 NextBucketAutoRandom(BucketAutoSampleState *state);
+
 static double FindClosest125(double n, bool findLarger);
 
 static double FindClosestRenardOrEseries(double n, bool findLarger, const
@@ -138,6 +194,9 @@ static double FindClosestRenardOrEseries(double n, bool findLarger, const
 /* --------------------------------------------------------- */
 
 PG_FUNCTION_INFO_V1(bson_dollar_bucket_auto);
+PG_FUNCTION_INFO_V1(bson_dollar_bucket_auto_boundaries_transition);
+PG_FUNCTION_INFO_V1(bson_dollar_bucket_auto_boundaries_final);
+PG_FUNCTION_INFO_V1(bson_dollar_bucket_auto_assign);
 
 /*
  * Assign a bucket id for each document with a window function. Similar to ntile(n) window function of Postgres.
@@ -263,6 +322,254 @@ bson_dollar_bucket_auto(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Transition function of the bson_dollar_bucket_auto_boundaries aggregate. Keeps the
+ * exact min and max of the groupBy values along with a reservoir sample of them.
+ */
+Datum
+bson_dollar_bucket_auto_boundaries_transition(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	BucketAutoSampleState *state = PG_ARGISNULL(0) ? NULL :
+								   (BucketAutoSampleState *) PG_GETARG_POINTER(0);
+	if (state == NULL)
+	{
+		if (PG_ARGISNULL(2))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("unexpected - $bucketAuto spec is missing.")));
+		}
+
+		BucketAutoArguments args = { 0 };
+		InitializeBucketAutoArguments(&args, PG_GETARG_PGBSON_PACKED(2));
+
+		state = MemoryContextAllocZero(aggregateContext, sizeof(BucketAutoSampleState));
+		state->numBuckets = args.numBuckets;
+		state->samples = MemoryContextAllocZero(aggregateContext,
+												sizeof(bson_value_t) *
+												BUCKET_AUTO_SAMPLE_SIZE);
+
+		/* A fixed seed keeps the boundaries stable across runs over the same data */
+		state->randomState = UINT64CONST(0x9E3779B97F4A7C15);
+	}
+
+	if (PG_ARGISNULL(1))
+	{
+		PG_RETURN_POINTER(state);
+	}
+
+	pgbsonelement valueElement;
+	PgbsonToSinglePgbsonElement(PG_GETARG_PGBSON_PACKED(1), &valueElement);
+	const bson_value_t *value = &valueElement.bsonValue;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+	bool isComparisonValid = true;
+	if (state->totalRows == 0)
+	{
+		bson_value_copy(value, &state->minValue);
+		bson_value_copy(value, &state->maxValue);
+	}
+	else if (CompareBsonValueAndType(value, &state->minValue, &isComparisonValid) < 0)
+	{
+		bson_value_destroy(&state->minValue);
+		bson_value_copy(value, &state->minValue);
+	}
+	else if (CompareBsonValueAndType(value, &state->maxValue, &isComparisonValid) > 0)
+	{
+		bson_value_destroy(&state->maxValue);
+		bson_value_copy(value, &state->maxValue);
+	}
+
+	state->totalRows++;
+	if (state->sampleCount < BUCKET_AUTO_SAMPLE_SIZE)
+	{
+		bson_value_copy(value, &state->samples[state->sampleCount++]);
+	}
+	else
+	{
+		/* Reservoir sampling: the row replaces a sampled one with probability size/rows */
+		uint64 slot = NextBucketAutoRandom(state) % (uint64) state->totalRows;
+		if (slot < BUCKET_AUTO_SAMPLE_SIZE)
+		{
+			bson_value_destroy(&state->samples[slot]);
+			bson_value_copy(value, &state->samples[slot]);
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+	PG_RETURN_POINTER(state);
+}
+
+
+/*
+ * Final function of the bson_dollar_bucket_auto_boundaries aggregate. Sorts the sample
+ * and picks evenly spaced values from it as the boundaries between the buckets, the
+ * first and last boundaries being the exact min and max of the groupBy values.
+ * Returns { "": [ <boundaries> ] }.
+ */
+Datum
+bson_dollar_bucket_auto_boundaries_final(PG_FUNCTION_ARGS)
+{
+	BucketAutoSampleState *state = PG_ARGISNULL(0) ? NULL :
+								   (BucketAutoSampleState *) PG_GETARG_POINTER(0);
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+	pgbson_array_writer arrayWriter;
+	PgbsonWriterStartArray(&writer, "", 0, &arrayWriter);
+
+	if (state != NULL && state->totalRows > 0)
+	{
+		qsort(state->samples, state->sampleCount, sizeof(bson_value_t),
+			  CompareBucketAutoSamples);
+
+		int32 numBuckets = state->numBuckets;
+		if (numBuckets > state->sampleCount)
+		{
+			numBuckets = state->sampleCount;
+		}
+
+		PgbsonArrayWriterWriteValue(&arrayWriter, &state->minValue);
+		const bson_value_t *previous = &state->minValue;
+		bool isComparisonValid = true;
+		for (int32 i = 1; i < numBuckets; i++)
+		{
+			const bson_value_t *boundary =
+				&state->samples[(int64) i * state->sampleCount / numBuckets];
+
+			/* Equal values always land in the same bucket, skip repeated boundaries */
+			if (CompareBsonValueAndType(boundary, previous, &isComparisonValid) <= 0 ||
+				CompareBsonValueAndType(boundary, &state->maxValue,
+										&isComparisonValid) >= 0)
+			{
+				continue;
+			}
+
+			PgbsonArrayWriterWriteValue(&arrayWriter, boundary);
+			previous = boundary;
+		}
+
+		if (CompareBsonValueAndType(&state->maxValue, &state->minValue,
+									&isComparisonValid) > 0)
+		{
+			PgbsonArrayWriterWriteValue(&arrayWriter, &state->maxValue);
+		}
+	}
+
+	PgbsonWriterEndArray(&writer, &arrayWriter);
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
+}
+
+
+/*
+ * Assigns a groupBy value to the bucket of the boundaries computed by
+ * bson_dollar_bucket_auto_boundaries. The buckets include their lower bound, and the
+ * last bucket also includes the max value.
+ * result format: {"bucket_id" : {"min" : <lower_bound>, "max" : <upper_bound>}}.
+ */
+Datum
+bson_dollar_bucket_auto_assign(PG_FUNCTION_ARGS)
+{
+	pgbson *boundariesDocument = PG_GETARG_PGBSON_PACKED(1);
+
+	/*
+	 * The boundaries come from an init plan so they can't be cached at plan time:
+	 * keep the parsed form as long as the document doesn't change.
+	 */
+	BucketAutoAssignState *state = (BucketAutoAssignState *) fcinfo->flinfo->fn_extra;
+	if (state == NULL ||
+		VARSIZE_ANY(state->boundariesDocument) != VARSIZE_ANY(boundariesDocument) ||
+		memcmp(state->boundariesDocument, boundariesDocument,
+			   VARSIZE_ANY(boundariesDocument)) != 0)
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(fcinfo->flinfo->fn_mcxt);
+		if (state == NULL)
+		{
+			state = palloc0(sizeof(BucketAutoAssignState));
+			fcinfo->flinfo->fn_extra = state;
+		}
+
+		state->boundariesDocument = CopyPgbsonIntoMemoryContext(boundariesDocument,
+																CurrentMemoryContext);
+
+		pgbsonelement boundariesElement;
+		PgbsonToSinglePgbsonElement(state->boundariesDocument, &boundariesElement);
+
+		bson_iter_t arrayIter;
+		BsonValueInitIterator(&boundariesElement.bsonValue, &arrayIter);
+		List *boundaries = NIL;
+		while (bson_iter_next(&arrayIter))
+		{
+			bson_value_t *boundary = palloc(sizeof(bson_value_t));
+			*boundary = *bson_iter_value(&arrayIter);
+			boundaries = lappend(boundaries, boundary);
+		}
+
+		state->numBoundaries = list_length(boundaries);
+		state->boundaries = palloc0(sizeof(bson_value_t) *
+									Max(state->numBoundaries, 1));
+		ListCell *cell;
+		foreach(cell, boundaries)
+		{
+			state->boundaries[foreach_current_index(cell)] =
+				*(bson_value_t *) lfirst(cell);
+		}
+
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	if (state->numBoundaries == 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+						errmsg("unexpected - $bucketAuto has no bucket boundaries.")));
+	}
+
+	pgbsonelement valueElement;
+	PgbsonToSinglePgbsonElement(PG_GETARG_PGBSON_PACKED(0), &valueElement);
+
+	/* Find the last boundary that is less than or equal to the value */
+	int32 low = 0;
+	int32 high = state->numBoundaries - 1;
+	bool isComparisonValid = true;
+	while (low < high)
+	{
+		int32 mid = low + (high - low + 1) / 2;
+		if (CompareBsonValueAndType(&state->boundaries[mid], &valueElement.bsonValue,
+									&isComparisonValid) <= 0)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	/* The max value belongs to the last bucket */
+	if (low == state->numBoundaries - 1 && low > 0)
+	{
+		low--;
+	}
+
+	int32 upper = state->numBoundaries == 1 ? low : low + 1;
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+	pgbson_writer innerWriter;
+	PgbsonWriterStartDocument(&writer, "bucket_id", 9, &innerWriter);
+	PgbsonWriterAppendValue(&innerWriter, "min", 3, &state->boundaries[low]);
+	PgbsonWriterAppendValue(&innerWriter, "max", 3, &state->boundaries[upper]);
+	PgbsonWriterEndDocument(&writer, &innerWriter);
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
+}
+
+
 /*
  * Handles the $bucketAuto stage.
  * Validate the arguments and check required fields.
@@ -389,10 +696,25 @@ HandleBucketAuto(const bson_value_t *existingValue, Query *query,
 							BsonValueToJsonForLogging(&groupBy))));
 	}
 
-	/* step 1: ntile window function to assign bucket_id for each row. */
-	query = BuildBucketAutoQuery(query, context,
-								 &groupBy,
-								 existingValue);
+	/*
+	 * step 1: ntile window function to assign bucket_id for each row. The approximate
+	 * mode assigns it from boundaries computed over a sample instead, which doesn't
+	 * need a sort of all the rows. Boundaries rounded to a granularity need the exact
+	 * mode.
+	 */
+	if (EnableBucketAutoApproximateBoundaries && granularity == NULL &&
+		IsClusterVersionAtleast(DocDB_V0, 108, 0))
+	{
+		query = BuildBucketAutoApproximateQuery(query, context,
+												&groupBy,
+												existingValue);
+	}
+	else
+	{
+		query = BuildBucketAutoQuery(query, context,
+									 &groupBy,
+									 existingValue);
+	}
 
 	/* step 2: Group by bucket id and add output fields. */
 	bson_value_t groupSpec = { 0 };
@@ -533,6 +855,104 @@ BuildBucketAutoQuery(Query *query,
 }
 
 
+/*
+ * Build the bucket assignment against approximate boundaries: The boundaries are
+ * computed once by an aggregate over a copy of the input query and the documents are
+ * then assigned to a bucket in a single pass with no sort.
+ * Result query:
+ * SELECT bson_dollar_add_fields(document, bson_dollar_bucket_auto_assign(bson_expression_get(document, '{ "" : "<groupByField>" }'::bson, true),
+ *          (SELECT bson_dollar_bucket_auto_boundaries(bson_expression_get(document, '{ "" : "<groupByField>" }'::bson, true), '<spec>'::bson)
+ *           FROM <collection>))) AS document
+ *  FROM <collection>;
+ */
+static Query *
+BuildBucketAutoApproximateQuery(Query *query,
+								AggregationPipelineBuildContext *context, const
+								bson_value_t *groupBy, const
+								bson_value_t *bucketAutoSpec)
+{
+	pgbson *groupByDoc = BsonValueToDocumentPgbson(groupBy);
+	pgbson *specBson = PgbsonInitFromDocumentBsonValue(bucketAutoSpec);
+
+	/* The boundaries query needs its own copy of the input */
+	Query *boundariesQuery = copyObject(query);
+	TargetEntry *origEntry = linitial(query->targetList);
+	TargetEntry *boundariesOrigEntry = linitial(boundariesQuery->targetList);
+
+	Oid bsonExpressionGetFunction;
+	List *args;
+	List *boundariesArgs;
+	if (context->variableSpec != NULL)
+	{
+		bsonExpressionGetFunction = BsonExpressionGetWithLetFunctionOid();
+		args = list_make4(origEntry->expr, MakeBsonConst(groupByDoc),
+						  MakeBoolValueConst(true), context->variableSpec);
+		boundariesArgs = list_make4(boundariesOrigEntry->expr,
+									MakeBsonConst(groupByDoc),
+									MakeBoolValueConst(true),
+									copyObject(context->variableSpec));
+	}
+	else
+	{
+		bsonExpressionGetFunction = BsonExpressionGetFunctionOid();
+		args = list_make3(origEntry->expr, MakeBsonConst(groupByDoc),
+						  MakeBoolValueConst(true));
+		boundariesArgs = list_make3(boundariesOrigEntry->expr,
+									MakeBsonConst(groupByDoc),
+									MakeBoolValueConst(true));
+	}
+
+	FuncExpr *getGroupbyFieldExpr = makeFuncExpr(bsonExpressionGetFunction,
+												 BsonTypeId(), args,
+												 InvalidOid, InvalidOid,
+												 COERCE_EXPLICIT_CALL);
+	FuncExpr *boundariesGroupbyFieldExpr = makeFuncExpr(bsonExpressionGetFunction,
+														BsonTypeId(), boundariesArgs,
+														InvalidOid, InvalidOid,
+														COERCE_EXPLICIT_CALL);
+
+	ParseState *parseState = make_parsestate(NULL);
+	parseState->p_expr_kind = EXPR_KIND_SELECT_TARGET;
+	parseState->p_next_resno = 1;
+	Aggref *boundariesAggref = CreateMultiArgAggregate(
+		BsonDollarBucketAutoBoundariesAggregateOid(),
+		list_make2(boundariesGroupbyFieldExpr, MakeBsonConst(specBson)),
+		list_make2_oid(BsonTypeId(), BsonTypeId()), parseState);
+	pfree(parseState);
+
+	bool resjunk = false;
+	boundariesQuery->targetList = list_make1(makeTargetEntry((Expr *) boundariesAggref,
+															 1, "boundaries",
+															 resjunk));
+	boundariesQuery->hasAggs = true;
+
+	SubLink *boundariesSubLink = makeNode(SubLink);
+	boundariesSubLink->subLinkType = EXPR_SUBLINK;
+	boundariesSubLink->subLinkId = 0;
+	boundariesSubLink->subselect = (Node *) boundariesQuery;
+
+	FuncExpr *assignExpr = makeFuncExpr(BsonDollarBucketAutoAssignFunctionOid(),
+										BsonTypeId(),
+										list_make2(getGroupbyFieldExpr,
+												   boundariesSubLink),
+										InvalidOid, InvalidOid,
+										COERCE_EXPLICIT_CALL);
+
+	FuncExpr *newDocExpr = makeFuncExpr(BsonDollarAddFieldsFunctionOid(),
+										BsonTypeId(),
+										list_make2(origEntry->expr, assignExpr),
+										InvalidOid, InvalidOid,
+										COERCE_EXPLICIT_CALL);
+	origEntry->expr = (Expr *) newDocExpr;
+	query->hasSubLinks = true;
+
+	/* Push everything to subquery after this */
+	context->requiresSubQuery = true;
+
+	return query;
+}
+
+
 /*
  * build group spec to call HandleGroup.
  * 1. Add '_id' field to group spec, which is the bucket id generated by window function.
@@ -843,6 +1263,31 @@ ValidateValueIsNumberic(pgbson *value)
 }
 
 
+static int
+CompareBucketAutoSamples(const void *left, const void *right)
+{
+	bool isComparisonValid = true;
+	return CompareBsonValueAndType((const bson_value_t *) left,
+								   (const bson_value_t *) right,
+								   &isComparisonValid);
+}
+
+
+/*
+ * xorshift64* step, used to pick the reservoir slots in the sample.
+ */
+static uint64
+NextBucketAutoRandom(BucketAutoSampleState *state)
+{
+	uint64 x = state->randomState;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	state->randomState = x;
+	return x * UINT64CONST(0x2545F4914F6CDD1D);
+}
+
+
 static double
 FindClosestPowersOf2(double n, bool findLarger)
 {
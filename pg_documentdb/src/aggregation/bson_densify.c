@@ -28,6 +28,7 @@
 #include "utils/feature_counter.h"
 #include "utils/documentdb_errors.h"
 #include "utils/date_utils.h"
+#include "utils/query_memory_budget.h"
 #include "commands/commands_common.h"
 
 #include "aggregation/bson_densify.h"
@@ -38,6 +39,8 @@ int32 PEC_InternalQueryMaxAllowedDensifyDocs = DEFAULT_MAX_ALLOWED_DOCS_IN_DENSI
 int32 PEC_InternalDocumentSourceDensifyMaxMemoryBytes =
 	BSON_MAX_ALLOWED_SIZE_INTERMEDIATE;
 
+extern bool EnableStreamingDensify;
+
 /*
  * DensifyType enumerates the available modes for the $densify aggregation stage,
  * specifying whether densification is performed over a fixed range, within partitions,
@@ -132,9 +135,44 @@ typedef struct DensifyArguments
 	 * a path tree so that the documents can just projected using the tree
 	 */
 	pgbson *partitionByFields;
+
+	/*
+	 * Whether the window functions describe the gaps to fill instead of writing the
+	 * generated documents, the documents are then generated by bson_densify_unwind.
+	 * This is set internally when building the query and is not part of the user spec.
+	 */
+	bool streamGaps;
 } DensifyArguments;
 
 
+/*
+ * State of the bson_densify_unwind SRF for a single row of the window function.
+ */
+typedef struct DensifyUnwindState
+{
+	/* Iterator over the entries written by the window function */
+	bson_iter_t entriesIter;
+
+	/* Whether a gap is being filled */
+	bool inGap;
+
+	/* The next value to generate in the gap */
+	bson_value_t currentValue;
+
+	/* The bound of the gap */
+	bson_value_t maxValue;
+
+	/* Whether the bound itself is generated */
+	bool includeMaxBound;
+
+	/* The partitionBy values of the gap's documents, NULL if there are none */
+	pgbson *partitionBy;
+
+	/* The parsed spec used to generate the gap's documents */
+	DensifyWindowState *densifyState;
+} DensifyUnwindState;
+
+
 /*
  * Hash entry for densify `full` mode
  * hash table. Holds the group key value and the
@@ -221,6 +259,11 @@ typedef struct DensifyWindowState
 static const char *DENSIFY_RESULT_FIELD = "_";
 static const int DENSIFY_RESULT_FIELD_LENGTH = 1;
 
+/* Internal spec field and entry fields used when the gaps are streamed */
+static const char *DENSIFY_STREAM_GAPS_FIELD = "streamGaps";
+static const char *DENSIFY_DOCUMENT_ENTRY_FIELD = "d";
+static const char *DENSIFY_GAP_ENTRY_FIELD = "g";
+
 /*====================================*/
 /* Forward declarations               */
 /*====================================*/
@@ -266,6 +309,19 @@ static bson_value_t GenerateAndWriteDocumentsInRange(const bson_value_t *minValu
 													 DensifyWindowState *state,
 													 pgbson_array_writer *arrayWriter,
 													 bool includeMaxBound);
+static bson_value_t WriteGapInRange(const bson_value_t *minValue, const
+									bson_value_t *maxValue,
+									const pgbson *partitionBy,
+									DensifyWindowState *state,
+									pgbson_array_writer *arrayWriter,
+									bool includeMaxBound);
+static void WriteDensifyDocument(pgbson_array_writer *arrayWriter,
+								 const pgbson *document, DensifyWindowState *state);
+static void SetDensifyStepIncrementor(DensifyWindowState *state);
+static void InitializeDensifyUnwindState(DensifyWindowState *state,
+										 const pgbson *densifySpec);
+static pgbson * BuildDensifyWindowSpec(const bson_value_t *existingValue,
+									   bool streamGaps);
 static Query * GenerateSelectNullQuery(void);
 static Query * GenerateUnionAllWithSelectNullQuery(Query *baseQuery,
 												   AggregationPipelineBuildContext *
@@ -276,6 +332,7 @@ static Query * GenerateUnionAllWithSelectNullQuery(Query *baseQuery,
 PG_FUNCTION_INFO_V1(bson_densify_range);
 PG_FUNCTION_INFO_V1(bson_densify_partition);
 PG_FUNCTION_INFO_V1(bson_densify_full);
+PG_FUNCTION_INFO_V1(bson_densify_unwind);
 
 
 /* bson_densify_range
@@ -454,6 +511,146 @@ bson_densify_full(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * bson_densify_unwind
+ *    Expands the output of the densify window functions when the gaps are streamed.
+ * The input is of the form {"_": [ {"d": <document>}, {"g": <gap>}, ... ]} where each
+ * gap is {"min": <value>, "max": <value>, "i": <include max>, "p": <partitionBy>} and
+ * the documents of each gap are only generated as they are returned, so a gap of any
+ * size is never held in memory.
+ *
+ * densifySpec => The $densify spec the window function was called with
+ */
+Datum
+bson_densify_unwind(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *functionContext;
+	DensifyUnwindState *unwindState;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		functionContext = SRF_FIRSTCALL_INIT();
+		MemoryContext oldContext = MemoryContextSwitchTo(
+			functionContext->multi_call_memory_ctx);
+
+		pgbson *densifiedDocs = PG_GETARG_PGBSON(0);
+		unwindState = palloc0(sizeof(DensifyUnwindState));
+
+		bson_iter_t resultIter;
+		if (PgbsonInitIteratorAtPath(densifiedDocs, DENSIFY_RESULT_FIELD,
+									 &resultIter) &&
+			BSON_ITER_HOLDS_ARRAY(&resultIter))
+		{
+			bson_iter_recurse(&resultIter, &unwindState->entriesIter);
+		}
+		else
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("unexpected - invalid $densify result document.")));
+		}
+
+		/* fn_extra holds the SRF's call context, so the spec is parsed for every row */
+		unwindState->densifyState = palloc0(sizeof(DensifyWindowState));
+		InitializeDensifyUnwindState(unwindState->densifyState, PG_GETARG_PGBSON(1));
+
+		MemoryContextSwitchTo(oldContext);
+		functionContext->user_fctx = (void *) unwindState;
+	}
+
+	functionContext = SRF_PERCALL_SETUP();
+	unwindState = (DensifyUnwindState *) functionContext->user_fctx;
+	DensifyWindowState *densifyState = unwindState->densifyState;
+
+	while (true)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (unwindState->inGap)
+		{
+			bool isComparisionValid = true;
+			int compareResult = CompareBsonValueAndType(&unwindState->currentValue,
+														&unwindState->maxValue,
+														&isComparisionValid);
+			if (compareResult < 0 || (unwindState->includeMaxBound &&
+									  compareResult == 0))
+			{
+				pgbson_writer writer;
+				PgbsonWriterInit(&writer);
+				AddGroupByValueToGeneratedDocuments(&writer, unwindState->partitionBy);
+				PgbsonWriterAppendValue(&writer,
+										densifyState->arguments.field.string,
+										densifyState->arguments.field.length,
+										&unwindState->currentValue);
+
+				densifyState->incrementor(&unwindState->currentValue,
+										  &densifyState->typedStep);
+				SRF_RETURN_NEXT(functionContext,
+								PointerGetDatum(PgbsonWriterGetPgbson(&writer)));
+			}
+
+			unwindState->inGap = false;
+		}
+
+		if (!bson_iter_next(&unwindState->entriesIter))
+		{
+			break;
+		}
+
+		pgbsonelement entryElement;
+		if (!BSON_ITER_HOLDS_DOCUMENT(&unwindState->entriesIter) ||
+			!TryGetBsonValueToPgbsonElement(bson_iter_value(&unwindState->entriesIter),
+											&entryElement) ||
+			entryElement.bsonValue.value_type != BSON_TYPE_DOCUMENT)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("unexpected - invalid $densify result entry.")));
+		}
+
+		if (strcmp(entryElement.path, DENSIFY_DOCUMENT_ENTRY_FIELD) == 0)
+		{
+			SRF_RETURN_NEXT(functionContext,
+							PointerGetDatum(PgbsonInitFromDocumentBsonValue(
+												&entryElement.bsonValue)));
+		}
+
+		/* Start filling a new gap */
+		MemoryContext oldContext = MemoryContextSwitchTo(
+			functionContext->multi_call_memory_ctx);
+		unwindState->partitionBy = NULL;
+		unwindState->includeMaxBound = false;
+
+		bson_iter_t gapIter;
+		BsonValueInitIterator(&entryElement.bsonValue, &gapIter);
+		while (bson_iter_next(&gapIter))
+		{
+			const char *key = bson_iter_key(&gapIter);
+			if (strcmp(key, "min") == 0)
+			{
+				unwindState->currentValue = *bson_iter_value(&gapIter);
+			}
+			else if (strcmp(key, "max") == 0)
+			{
+				unwindState->maxValue = *bson_iter_value(&gapIter);
+			}
+			else if (strcmp(key, "i") == 0)
+			{
+				unwindState->includeMaxBound = bson_iter_as_bool(&gapIter);
+			}
+			else if (strcmp(key, "p") == 0)
+			{
+				unwindState->partitionBy = PgbsonInitFromDocumentBsonValue(
+					bson_iter_value(&gapIter));
+			}
+		}
+
+		MemoryContextSwitchTo(oldContext);
+		unwindState->inGap = true;
+	}
+
+	SRF_RETURN_DONE(functionContext);
+}
+
+
 /*
  * Aggregation pipleine stage handler for `$densify`.
  * Converts to a window function which densifies the incoming documents based on the mode inline
@@ -500,12 +697,20 @@ HandleDensify(const bson_value_t *existingValue, Query *query,
 	bool isCollectionDataTable = rte->rtekind == RTE_RELATION;
 
 	pgbson *densifySpec = PgbsonInitFromDocumentBsonValue(existingValue);
-	Const *densifySpecConst = MakeBsonConst(densifySpec);
 
 	DensifyArguments arguments;
 	memset(&arguments, 0, sizeof(DensifyArguments));
 	PopulateDensifyArgs(&arguments, densifySpec);
 
+	/*
+	 * With streamed gaps the window function only describes the gaps and
+	 * bson_densify_unwind generates their documents lazily.
+	 */
+	bool streamGaps = EnableStreamingDensify &&
+					  IsClusterVersionAtleast(DocDB_V0, 108, 0);
+	densifySpec = BuildDensifyWindowSpec(existingValue, streamGaps);
+	Const *densifySpecConst = MakeBsonConst(densifySpec);
+
 	/*
 	 * Special case for range mode densify.
 	 * Generate documents in the range even when the collection is
@@ -596,11 +801,23 @@ HandleDensify(const bson_value_t *existingValue, Query *query,
 	query = MigrateQueryToSubQuery(query, context);
 
 	firstEntry = linitial(query->targetList);
-	List *unwindArgs = list_make2(firstEntry->expr, MakeTextConst(DENSIFY_RESULT_FIELD,
-																  DENSIFY_RESULT_FIELD_LENGTH));
-	FuncExpr *lookupUnwindExpr = makeFuncExpr(BsonLookupUnwindFunctionOid(), BsonTypeId(),
-											  unwindArgs, InvalidOid, InvalidOid,
-											  COERCE_EXPLICIT_CALL);
+	FuncExpr *lookupUnwindExpr;
+	if (streamGaps)
+	{
+		List *unwindArgs = list_make2(firstEntry->expr, copyObject(densifySpecConst));
+		lookupUnwindExpr = makeFuncExpr(BsonDensifyUnwindFunctionOid(), BsonTypeId(),
+										unwindArgs, InvalidOid, InvalidOid,
+										COERCE_EXPLICIT_CALL);
+	}
+	else
+	{
+		List *unwindArgs = list_make2(firstEntry->expr,
+									  MakeTextConst(DENSIFY_RESULT_FIELD,
+													DENSIFY_RESULT_FIELD_LENGTH));
+		lookupUnwindExpr = makeFuncExpr(BsonLookupUnwindFunctionOid(), BsonTypeId(),
+										unwindArgs, InvalidOid, InvalidOid,
+										COERCE_EXPLICIT_CALL);
+	}
 	lookupUnwindExpr->funcretset = true;
 	firstEntry->expr = (Expr *) lookupUnwindExpr;
 	query->hasTargetSRFs = true;
@@ -1012,7 +1229,7 @@ DensifyDocsFromState(const pgbson *document, bson_value_t *minValue,
 
 	if (document != NULL)
 	{
-		PgbsonArrayWriterWriteDocument(&arrayWriter, document);
+		WriteDensifyDocument(&arrayWriter, document, state);
 	}
 
 	if (partitionState->isLastRow && state->arguments.densifyType == DENSIFY_TYPE_RANGE)
@@ -1089,6 +1306,11 @@ PopulateDensifyArgs(DensifyArguments *arguments, const pgbson *densifySpec)
 		{
 			partitionByFieldsValue = element.bsonValue;
 		}
+		else if (strcmp(element.path, DENSIFY_STREAM_GAPS_FIELD) == 0 &&
+				 element.bsonValue.value_type == BSON_TYPE_BOOL)
+		{
+			arguments->streamGaps = element.bsonValue.value.v_bool;
+		}
 	}
 
 	/* Parse required field */
@@ -1353,6 +1575,12 @@ GenerateAndWriteDocumentsInRange(const bson_value_t *minValue, const
 		ThorwLimitExceededError(PEC_InternalQueryMaxAllowedDensifyDocs + 1);
 	}
 
+	if (state->arguments.streamGaps)
+	{
+		return WriteGapInRange(minValue, maxValue, partitionBy, state, arrayWriter,
+							   includeMaxBound);
+	}
+
 	int compareResult = CompareBsonValueAndType(&generatedValue, maxValue,
 												&isComparisionValid);
 	while (compareResult < 0 || (includeMaxBound && compareResult == 0))
@@ -1374,6 +1602,8 @@ GenerateAndWriteDocumentsInRange(const bson_value_t *minValue, const
 			/* Exclude existing docs */
 			state->nDocumentsGenerated++;
 			state->memConsumed += PgbsonWriterGetSize(&childWriter);
+			ReserveQueryMemory(CurrentMemoryContext, PgbsonWriterGetSize(&childWriter),
+							   "$densify");
 		}
 
 		PgbsonArrayWriterEndDocument(arrayWriter, &childWriter);
@@ -1409,6 +1639,126 @@ GenerateAndWriteDocumentsInRange(const bson_value_t *minValue, const
 }
 
 
+/*
+ * Streamed counterpart of GenerateAndWriteDocumentsInRange: Writes a single entry that
+ * describes the gap from `minValue` to `maxValue` for bson_densify_unwind to fill, and
+ * returns the next value after the range. The generated documents still count towards
+ * the allowed limit but are never held in memory together.
+ */
+static bson_value_t
+WriteGapInRange(const bson_value_t *minValue, const bson_value_t *maxValue,
+				const pgbson *partitionBy, DensifyWindowState *state,
+				pgbson_array_writer *arrayWriter, bool includeMaxBound)
+{
+	bool isComparisionValid = true;
+	bson_value_t generatedValue = *minValue;
+	bool hasDocuments = false;
+
+	int compareResult = CompareBsonValueAndType(&generatedValue, maxValue,
+												&isComparisionValid);
+	while (compareResult < 0 || (includeMaxBound && compareResult == 0))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		hasDocuments = true;
+		if (compareResult != 0)
+		{
+			/* Exclude existing docs */
+			state->nDocumentsGenerated++;
+		}
+
+		if (state->nDocumentsGenerated > PEC_InternalQueryMaxAllowedDensifyDocs)
+		{
+			ThorwLimitExceededError(state->nDocumentsGenerated);
+		}
+
+		/* Increment to next value */
+		state->incrementor(&generatedValue, &state->typedStep);
+		compareResult = CompareBsonValueAndType(&generatedValue, maxValue,
+												&isComparisionValid);
+	}
+
+	if (hasDocuments)
+	{
+		pgbson_writer entryWriter;
+		PgbsonArrayWriterStartDocument(arrayWriter, &entryWriter);
+		pgbson_writer gapWriter;
+		PgbsonWriterStartDocument(&entryWriter, DENSIFY_GAP_ENTRY_FIELD, 1, &gapWriter);
+		PgbsonWriterAppendValue(&gapWriter, "min", 3, minValue);
+		PgbsonWriterAppendValue(&gapWriter, "max", 3, maxValue);
+		PgbsonWriterAppendBool(&gapWriter, "i", 1, includeMaxBound);
+		if (partitionBy != NULL)
+		{
+			PgbsonWriterAppendDocument(&gapWriter, "p", 1, partitionBy);
+		}
+
+		PgbsonWriterEndDocument(&entryWriter, &gapWriter);
+		PgbsonArrayWriterEndDocument(arrayWriter, &entryWriter);
+	}
+
+	/* Update the new value in state */
+	if (compareResult == 0)
+	{
+		generatedValue = *maxValue;
+		state->incrementor(&generatedValue, &state->typedStep);
+	}
+	return generatedValue;
+}
+
+
+/*
+ * Writes a document of the collection into the window function's result, wrapped as
+ * a document entry when the gaps are streamed.
+ */
+static void
+WriteDensifyDocument(pgbson_array_writer *arrayWriter, const pgbson *document,
+					 DensifyWindowState *state)
+{
+	if (!state->arguments.streamGaps)
+	{
+		PgbsonArrayWriterWriteDocument(arrayWriter, document);
+		return;
+	}
+
+	pgbson_writer entryWriter;
+	PgbsonArrayWriterStartDocument(arrayWriter, &entryWriter);
+	PgbsonWriterAppendDocument(&entryWriter, DENSIFY_DOCUMENT_ENTRY_FIELD, 1, document);
+	PgbsonArrayWriterEndDocument(arrayWriter, &entryWriter);
+}
+
+
+/*
+ * Builds the spec passed to the densify functions: the user spec with the internal
+ * streamGaps field set as requested.
+ */
+static pgbson *
+BuildDensifyWindowSpec(const bson_value_t *existingValue, bool streamGaps)
+{
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	bson_iter_t iter;
+	BsonValueInitIterator(existingValue, &iter);
+	while (bson_iter_next(&iter))
+	{
+		if (strcmp(bson_iter_key(&iter), DENSIFY_STREAM_GAPS_FIELD) == 0)
+		{
+			continue;
+		}
+
+		PgbsonWriterAppendIter(&writer, &iter);
+	}
+
+	if (streamGaps)
+	{
+		PgbsonWriterAppendBool(&writer, DENSIFY_STREAM_GAPS_FIELD,
+							   strlen(DENSIFY_STREAM_GAPS_FIELD), true);
+	}
+
+	return PgbsonWriterGetPgbson(&writer);
+}
+
+
 static void
 NumericStepIncrementor(bson_value_t *baseValue, TypedStep *step)
 {
@@ -1648,7 +1998,32 @@ InitializeDensifyWindowState(DensifyWindowState *state, const pgbson *densifySpe
 	/* Create and intialize projection tree */
 	CreateProjectionTreeStateForPartitionBy(state, args->partitionByFields);
 
-	/* Set the step incrementors */
+	SetDensifyStepIncrementor(state);
+	state->previousType = DENSIFY_DOCUMENT_UNKNOWN;
+	memset(&state->partitionAwareState, 0, sizeof(PartitionAwareState));
+}
+
+
+/*
+ * Initializes the DensifyWindowState used by bson_densify_unwind, which only needs
+ * the field and the step to generate the documents of a gap.
+ */
+static void
+InitializeDensifyUnwindState(DensifyWindowState *state, const pgbson *densifySpec)
+{
+	state->executorContext = CurrentMemoryContext;
+	PopulateDensifyArgs(&state->arguments, densifySpec);
+	SetDensifyStepIncrementor(state);
+}
+
+
+/*
+ * Sets the step incrementor based on whether the step has a time unit.
+ */
+static void
+SetDensifyStepIncrementor(DensifyWindowState *state)
+{
+	DensifyArguments *args = &state->arguments;
 	if (args->timeUnit != DateUnit_Invalid)
 	{
 		int64 amount = BsonValueAsInt64(&args->step);
@@ -1661,8 +2036,6 @@ InitializeDensifyWindowState(DensifyWindowState *state, const pgbson *densifySpe
 		state->typedStep.numericStep = args->step;
 		state->incrementor = &NumericStepIncrementor;
 	}
-	state->previousType = DENSIFY_DOCUMENT_UNKNOWN;
-	memset(&state->partitionAwareState, 0, sizeof(PartitionAwareState));
 }
 
 
@@ -0,0 +1,496 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/aggregation/bson_exact_percentile.c
+ *
+ * Implementation of the exact ('discrete') $percentile and $median accumulators.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <math.h>
+#include <port/pg_bitutils.h>
+
+#include "io/bson_core.h"
+#include "utils/documentdb_errors.h"
+
+/*
+ * The state of the exact percentile aggregates: The numeric values of the group
+ * as plain doubles (8 bytes per value rather than a bson value or a sort tuple),
+ * and the requested percentiles.
+ */
+typedef struct ExactPercentileState
+{
+	/* The requested percentiles, between 0.0 and 1.0 */
+	int32 numPercentiles;
+	double *percentiles;
+
+	/* The values collected so far */
+	int64 numValues;
+	int64 valuesCapacity;
+	double *values;
+} ExactPercentileState;
+
+/* The number of values the state is first allocated with */
+#define EXACT_PERCENTILE_INITIAL_CAPACITY 64
+
+static ExactPercentileState * AllocateExactPercentileState(const pgbson *percentiles);
+static void AppendExactPercentileValues(ExactPercentileState *state,
+										const double *values, int64 numValues);
+static void ComputeExactPercentiles(ExactPercentileState *state, double *result);
+static void SelectKthValue(double *values, int64 left, int64 right, int64 k);
+static int CompareDoubles(const void *a, const void *b);
+
+PG_FUNCTION_INFO_V1(bson_exact_percentile_transition);
+PG_FUNCTION_INFO_V1(bson_exact_percentile_combine);
+PG_FUNCTION_INFO_V1(bson_exact_percentile_serialize);
+PG_FUNCTION_INFO_V1(bson_exact_percentile_deserialize);
+PG_FUNCTION_INFO_V1(bson_exact_percentile_final);
+PG_FUNCTION_INFO_V1(bson_exact_median_final);
+
+
+/*
+ * Collects the numeric values of the group. Other types and NaN are ignored, the
+ * same as for the approximate method.
+ */
+Datum
+bson_exact_percentile_transition(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	ExactPercentileState *state;
+	if (PG_ARGISNULL(0))
+	{
+		pgbson *percentiles = PG_GETARG_MAYBE_NULL_PGBSON(2);
+		if (percentiles == NULL || IsPgbsonEmptyDocument(percentiles))
+		{
+			PG_RETURN_NULL();
+		}
+
+		MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+		state = AllocateExactPercentileState(percentiles);
+		MemoryContextSwitchTo(oldContext);
+	}
+	else
+	{
+		state = (ExactPercentileState *) PG_GETARG_POINTER(0);
+	}
+
+	pgbson *currentValue = PG_GETARG_MAYBE_NULL_PGBSON(1);
+	if (currentValue == NULL || IsPgbsonEmptyDocument(currentValue))
+	{
+		PG_RETURN_POINTER(state);
+	}
+
+	pgbsonelement element;
+	PgbsonToSinglePgbsonElement(currentValue, &element);
+	if (BsonValueIsNumber(&element.bsonValue) && !IsBsonValueNaN(&element.bsonValue))
+	{
+		double value = BsonValueAsDoubleQuiet(&element.bsonValue);
+
+		MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+		AppendExactPercentileValues(state, &value, 1);
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+
+/*
+ * Merges the values collected by two partial aggregates.
+ */
+Datum
+bson_exact_percentile_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+		{
+			PG_RETURN_NULL();
+		}
+
+		PG_RETURN_POINTER(PG_GETARG_POINTER(0));
+	}
+
+	ExactPercentileState *right = (ExactPercentileState *) PG_GETARG_POINTER(1);
+	MemoryContext oldContext = MemoryContextSwitchTo(aggregateContext);
+
+	ExactPercentileState *left;
+	if (PG_ARGISNULL(0))
+	{
+		left = palloc0(sizeof(ExactPercentileState));
+		left->numPercentiles = right->numPercentiles;
+		left->percentiles = palloc(sizeof(double) * right->numPercentiles);
+		memcpy(left->percentiles, right->percentiles,
+			   sizeof(double) * right->numPercentiles);
+	}
+	else
+	{
+		left = (ExactPercentileState *) PG_GETARG_POINTER(0);
+	}
+
+	AppendExactPercentileValues(left, right->values, right->numValues);
+	MemoryContextSwitchTo(oldContext);
+
+	PG_RETURN_POINTER(left);
+}
+
+
+Datum
+bson_exact_percentile_serialize(PG_FUNCTION_ARGS)
+{
+	ExactPercentileState *state = (ExactPercentileState *) PG_GETARG_POINTER(0);
+
+	Size percentilesSize = sizeof(double) * state->numPercentiles;
+	Size valuesSize = sizeof(double) * state->numValues;
+	Size length = sizeof(int32) + sizeof(int64) + percentilesSize + valuesSize;
+
+	bytea *serialized = palloc(length + VARHDRSZ);
+	SET_VARSIZE(serialized, length + VARHDRSZ);
+
+	char *ptr = VARDATA(serialized);
+	memcpy(ptr, &state->numPercentiles, sizeof(int32));
+	ptr += sizeof(int32);
+	memcpy(ptr, &state->numValues, sizeof(int64));
+	ptr += sizeof(int64);
+	memcpy(ptr, state->percentiles, percentilesSize);
+	ptr += percentilesSize;
+	memcpy(ptr, state->values, valuesSize);
+
+	PG_RETURN_BYTEA_P(serialized);
+}
+
+
+Datum
+bson_exact_percentile_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea *serialized = PG_GETARG_BYTEA_PP(0);
+	const char *ptr = VARDATA_ANY(serialized);
+
+	ExactPercentileState *state = palloc0(sizeof(ExactPercentileState));
+	memcpy(&state->numPercentiles, ptr, sizeof(int32));
+	ptr += sizeof(int32);
+
+	int64 numValues;
+	memcpy(&numValues, ptr, sizeof(int64));
+	ptr += sizeof(int64);
+
+	state->percentiles = palloc(sizeof(double) * state->numPercentiles);
+	memcpy(state->percentiles, ptr, sizeof(double) * state->numPercentiles);
+	ptr += sizeof(double) * state->numPercentiles;
+
+	AppendExactPercentileValues(state, (const double *) ptr, numValues);
+
+	PG_RETURN_POINTER(state);
+}
+
+
+/*
+ * Writes the exact values at the requested percentiles as an array ($percentile).
+ * Groups without numeric values produce an array of nulls.
+ */
+Datum
+bson_exact_percentile_final(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+	{
+		PG_RETURN_NULL();
+	}
+
+	ExactPercentileState *state = (ExactPercentileState *) PG_GETARG_POINTER(0);
+	double *result = palloc(sizeof(double) * state->numPercentiles);
+	if (state->numValues > 0)
+	{
+		ComputeExactPercentiles(state, result);
+	}
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	pgbson_array_writer arrayWriter;
+	PgbsonWriterStartArray(&writer, "", 0, &arrayWriter);
+	for (int i = 0; i < state->numPercentiles; i++)
+	{
+		bson_value_t value = { 0 };
+		if (state->numValues > 0)
+		{
+			value.value_type = BSON_TYPE_DOUBLE;
+			value.value.v_double = result[i];
+		}
+		else
+		{
+			value.value_type = BSON_TYPE_NULL;
+		}
+
+		PgbsonArrayWriterWriteValue(&arrayWriter, &value);
+	}
+
+	PgbsonWriterEndArray(&writer, &arrayWriter);
+	pfree(result);
+
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
+}
+
+
+/*
+ * Writes the exact median as a single value ($median), null if the group has no
+ * numeric values.
+ */
+Datum
+bson_exact_median_final(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+	{
+		PG_RETURN_NULL();
+	}
+
+	ExactPercentileState *state = (ExactPercentileState *) PG_GETARG_POINTER(0);
+
+	pgbsonelement finalValue;
+	finalValue.path = "";
+	finalValue.pathLength = 0;
+	if (state->numValues == 0)
+	{
+		finalValue.bsonValue.value_type = BSON_TYPE_NULL;
+	}
+	else
+	{
+		double *result = palloc(sizeof(double) * state->numPercentiles);
+		ComputeExactPercentiles(state, result);
+		finalValue.bsonValue.value_type = BSON_TYPE_DOUBLE;
+		finalValue.bsonValue.value.v_double = result[0];
+		pfree(result);
+	}
+
+	PG_RETURN_POINTER(PgbsonElementToPgbson(&finalValue));
+}
+
+
+/*
+ * Allocates the state for the percentiles given as { "": <number> } for $median
+ * or { "": [ <numbers> ] } for $percentile.
+ */
+static ExactPercentileState *
+AllocateExactPercentileState(const pgbson *percentiles)
+{
+	pgbsonelement element;
+	PgbsonToSinglePgbsonElement(percentiles, &element);
+
+	ExactPercentileState *state = palloc0(sizeof(ExactPercentileState));
+	if (element.bsonValue.value_type != BSON_TYPE_ARRAY)
+	{
+		state->numPercentiles = 1;
+		state->percentiles = palloc(sizeof(double));
+		state->percentiles[0] = BsonValueAsDoubleQuiet(&element.bsonValue);
+		return state;
+	}
+
+	int numPercentiles = BsonDocumentValueCountKeys(&element.bsonValue);
+	if (numPercentiles == 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION7750301), errmsg(
+							"Expected an array containing numbers from 0.0 to 1.0, but instead received: %s",
+							BsonValueToJsonForLogging(&element.bsonValue))));
+	}
+
+	state->numPercentiles = numPercentiles;
+	state->percentiles = palloc(sizeof(double) * numPercentiles);
+
+	bson_iter_t iter;
+	BsonValueInitIterator(&element.bsonValue, &iter);
+	int i = 0;
+	while (bson_iter_next(&iter))
+	{
+		const bson_value_t *value = bson_iter_value(&iter);
+		if (!BsonValueIsNumber(value))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION7750302), errmsg(
+								"Expected an array containing numbers from 0.0 to 1.0, but instead received: %s",
+								BsonValueToJsonForLogging(value))));
+		}
+
+		double percentile = BsonValueAsDoubleQuiet(value);
+		if (percentile < 0 || percentile > 1)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION7750303), errmsg(
+								"Expected an array containing numbers from 0.0 to 1.0, but instead received: %lf",
+								percentile)));
+		}
+
+		state->percentiles[i++] = percentile;
+	}
+
+	return state;
+}
+
+
+/*
+ * Appends values to the state, doubling its capacity as needed. Must be called in
+ * the memory context that owns the state.
+ */
+static void
+AppendExactPercentileValues(ExactPercentileState *state, const double *values,
+							int64 numValues)
+{
+	if (numValues == 0)
+	{
+		return;
+	}
+
+	if (state->numValues + numValues > state->valuesCapacity)
+	{
+		int64 newCapacity = Max(state->valuesCapacity * 2,
+								EXACT_PERCENTILE_INITIAL_CAPACITY);
+		while (newCapacity < state->numValues + numValues)
+		{
+			newCapacity *= 2;
+		}
+
+		/* Large groups can go past 1GB of values */
+		state->values = state->values == NULL ?
+						MemoryContextAllocHuge(CurrentMemoryContext,
+											   sizeof(double) * newCapacity) :
+						repalloc_huge(state->values, sizeof(double) * newCapacity);
+		state->valuesCapacity = newCapacity;
+	}
+
+	memcpy(state->values + state->numValues, values, sizeof(double) * numValues);
+	state->numValues += numValues;
+}
+
+
+/*
+ * Finds the value at the rank of each requested percentile (the discrete
+ * percentile: ceil(p * n) - 1 of the sorted values) without sorting all of them.
+ * The ranks are selected in increasing order, each one only partitions the values
+ * after the prior rank since everything after it is already the larger side.
+ */
+static void
+ComputeExactPercentiles(ExactPercentileState *state, double *result)
+{
+	int numPercentiles = state->numPercentiles;
+	int64 *ranks = palloc(sizeof(int64) * numPercentiles);
+	int *order = palloc(sizeof(int) * numPercentiles);
+	for (int i = 0; i < numPercentiles; i++)
+	{
+		double rank = ceil(state->percentiles[i] * state->numValues) - 1;
+		ranks[i] = Min(Max((int64) rank, 0), state->numValues - 1);
+		order[i] = i;
+	}
+
+	/* The number of percentiles is small: Insertion sort the order by rank */
+	for (int i = 1; i < numPercentiles; i++)
+	{
+		int current = order[i];
+		int j = i - 1;
+		while (j >= 0 && ranks[order[j]] > ranks[current])
+		{
+			order[j + 1] = order[j];
+			j--;
+		}
+
+		order[j + 1] = current;
+	}
+
+	int64 left = 0;
+	for (int i = 0; i < numPercentiles; i++)
+	{
+		int64 rank = ranks[order[i]];
+		SelectKthValue(state->values, left, state->numValues - 1, rank);
+		result[order[i]] = state->values[rank];
+		left = rank;
+	}
+
+	pfree(ranks);
+	pfree(order);
+}
+
+
+/*
+ * Introselect: Quickselect with a median of three pivot that moves the k-th
+ * smallest value of values[left..right] to values[k], with everything before it
+ * no larger and everything after it no smaller. Falls back to sorting the range
+ * if the partitioning degrades, which bounds it by O(n log n).
+ */
+static void
+SelectKthValue(double *values, int64 left, int64 right, int64 k)
+{
+	int depthLimit = 2 * (pg_leftmost_one_pos64((uint64) (right - left + 1)) + 1);
+	while (right > left)
+	{
+		if (depthLimit-- == 0)
+		{
+			qsort(values + left, right - left + 1, sizeof(double), CompareDoubles);
+			return;
+		}
+
+		double first = values[left];
+		double middle = values[left + (right - left) / 2];
+		double last = values[right];
+		double pivot = first < middle ?
+					   (middle < last ? middle : (first < last ? last : first)) :
+					   (first < last ? first : (middle < last ? last : middle));
+
+		int64 i = left;
+		int64 j = right;
+		while (i <= j)
+		{
+			while (values[i] < pivot)
+			{
+				i++;
+			}
+
+			while (values[j] > pivot)
+			{
+				j--;
+			}
+
+			if (i <= j)
+			{
+				double temp = values[i];
+				values[i] = values[j];
+				values[j] = temp;
+				i++;
+				j--;
+			}
+		}
+
+		/* values[j + 1..i - 1] are all equal to the pivot */
+		if (k <= j)
+		{
+			right = j;
+		}
+		else if (k >= i)
+		{
+			left = i;
+		}
+		else
+		{
+			return;
+		}
+	}
+}
+
+
+static int
+CompareDoubles(const void *a, const void *b)
+{
+	double left = *(const double *) a;
+	double right = *(const double *) b;
+	return left < right ? -1 : (left > right ? 1 : 0);
+}
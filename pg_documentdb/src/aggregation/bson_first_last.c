@@ -35,6 +35,8 @@ PG_FUNCTION_INFO_V1(bson_lastn_final);
 PG_FUNCTION_INFO_V1(bson_firstn_transition_on_sorted);
 PG_FUNCTION_INFO_V1(bson_lastn_transition_on_sorted);
 PG_FUNCTION_INFO_V1(bson_firstn_lastn_final_on_sorted);
+PG_FUNCTION_INFO_V1(bson_first_combine_on_sorted);
+PG_FUNCTION_INFO_V1(bson_last_combine_on_sorted);
 
 /*
  * Applies the "state transition" (SFUNC) for first.
@@ -255,3 +257,27 @@ bson_lastn_combine(PG_FUNCTION_ARGS)
 	bool isLast = true;
 	return BsonOrderCombine(fcinfo, isLast);
 }
+
+
+/*
+ * Applies the "combine" (COMBINEFUNC) for first and firstn on input
+ * without a sort specification.
+ */
+Datum
+bson_first_combine_on_sorted(PG_FUNCTION_ARGS)
+{
+	bool isLast = false;
+	return BsonOrderCombineOnSorted(fcinfo, isLast);
+}
+
+
+/*
+ * Applies the "combine" (COMBINEFUNC) for last and lastn on input
+ * without a sort specification.
+ */
+Datum
+bson_last_combine_on_sorted(PG_FUNCTION_ARGS)
+{
+	bool isLast = true;
+	return BsonOrderCombineOnSorted(fcinfo, isLast);
+}
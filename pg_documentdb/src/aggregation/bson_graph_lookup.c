@@ -0,0 +1,416 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/aggregation/bson_graph_lookup.c
+ *
+ * Implementation of the breadth first traversal for the $graphLookup stage.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <executor/spi.h>
+#include <utils/builtins.h>
+
+#include "io/bson_core.h"
+#include "metadata/collection.h"
+#include "metadata/metadata_cache.h"
+#include "operators/bson_expression.h"
+#include "query/bson_compare.h"
+#include "utils/documentdb_errors.h"
+#include "utils/fmgr_utils.h"
+#include "utils/hashset_utils.h"
+#include "utils/query_utils.h"
+
+/*
+ * The args of the traversal parsed from the spec built by the pipeline
+ * for the $graphLookup stage.
+ */
+typedef struct GraphLookupTraverseArgs
+{
+	/* The collection that is traversed */
+	uint64 collectionId;
+
+	/* The field of the traversed documents matched against the frontier */
+	const char *connectToField;
+
+	/* The expression for the values of the next frontier: { "$makeArray": "$connectFromField" } */
+	AggregationExpressionData connectFromExpression;
+
+	/* The field the output array is written to */
+	StringView asField;
+
+	/* The optional field the depth of each document is written to */
+	StringView depthField;
+
+	/* The maximum depth to traverse */
+	int32 maxDepth;
+
+	/* The optional filter for the traversed documents */
+	bson_value_t restrictSearch;
+} GraphLookupTraverseArgs;
+
+/*
+ * A document visited by the traversal.
+ */
+typedef struct GraphLookupVisitedDocument
+{
+	/* The _id of the document */
+	bson_value_t objectId;
+
+	/* The document */
+	pgbson *document;
+
+	/* The depth at which the document was first reached */
+	int32 depth;
+} GraphLookupVisitedDocument;
+
+static void PopulateGraphLookupTraverseArgs(GraphLookupTraverseArgs *args,
+											pgbson *spec);
+static pgbson * TraverseGraphLookup(const bson_value_t *startValues,
+									const GraphLookupTraverseArgs *args);
+static pgbson * QueryGraphLookupFrontier(const char *query,
+										 const GraphLookupTraverseArgs *args,
+										 const bson_value_t *frontier);
+static int CompareVisitedDocumentsById(const ListCell *left, const ListCell *right);
+
+PG_FUNCTION_INFO_V1(bson_dollar_graph_lookup_traverse);
+
+/*
+ * Runs the $graphLookup for a single input document: The input is of the form
+ * { "connectToField": [ start values ] } and the output of the form
+ * { "as": [ documents ] }.
+ *
+ * The graph is traversed breadth first: Each depth probes the collection once for
+ * the whole frontier of values with an $in on the connectToField, so the probe can
+ * use an index on that field. Documents are tracked by _id in a visited set, so each
+ * document is returned once at the smallest depth it is reachable at, and each
+ * value is probed at most once which terminates the traversal on cycles.
+ */
+Datum
+bson_dollar_graph_lookup_traverse(PG_FUNCTION_ARGS)
+{
+	pgbson *input = PG_GETARG_PGBSON(0);
+	pgbson *spec = PG_GETARG_PGBSON(1);
+
+	const GraphLookupTraverseArgs *args;
+	int argPosition = 1;
+
+	SetCachedFunctionState(
+		args,
+		GraphLookupTraverseArgs,
+		argPosition,
+		PopulateGraphLookupTraverseArgs,
+		spec);
+
+	GraphLookupTraverseArgs localArgs;
+	if (args == NULL)
+	{
+		PopulateGraphLookupTraverseArgs(&localArgs, spec);
+		args = &localArgs;
+	}
+
+	pgbsonelement inputElement;
+	PgbsonToSinglePgbsonElement(input, &inputElement);
+
+	PG_RETURN_POINTER(TraverseGraphLookup(&inputElement.bsonValue, args));
+}
+
+
+/*
+ * Parses the traversal spec of the form
+ * { "collectionId": <int64>, "connectToField": <string>, "connectFromExpression": <expression>,
+ *   "as": <string>, "depthField": <string>, "maxDepth": <int32>, "restrictSearch": <document> }
+ */
+static void
+PopulateGraphLookupTraverseArgs(GraphLookupTraverseArgs *args, pgbson *spec)
+{
+	memset(args, 0, sizeof(GraphLookupTraverseArgs));
+	args->maxDepth = INT32_MAX;
+
+	bson_iter_t specIter;
+	PgbsonInitIterator(spec, &specIter);
+	while (bson_iter_next(&specIter))
+	{
+		const char *key = bson_iter_key(&specIter);
+		const bson_value_t *value = bson_iter_value(&specIter);
+		if (strcmp(key, "collectionId") == 0)
+		{
+			args->collectionId = (uint64) BsonValueAsInt64(value);
+		}
+		else if (strcmp(key, "connectToField") == 0)
+		{
+			args->connectToField = pnstrdup(value->value.v_utf8.str,
+											value->value.v_utf8.len);
+		}
+		else if (strcmp(key, "connectFromExpression") == 0)
+		{
+			ParseAggregationExpressionContext parseContext = { 0 };
+			ParseAggregationExpressionData(&args->connectFromExpression, value,
+										   &parseContext);
+		}
+		else if (strcmp(key, "as") == 0)
+		{
+			args->asField = (StringView) {
+				.string = pnstrdup(value->value.v_utf8.str, value->value.v_utf8.len),
+				.length = value->value.v_utf8.len
+			};
+		}
+		else if (strcmp(key, "depthField") == 0)
+		{
+			args->depthField = (StringView) {
+				.string = pnstrdup(value->value.v_utf8.str, value->value.v_utf8.len),
+				.length = value->value.v_utf8.len
+			};
+		}
+		else if (strcmp(key, "maxDepth") == 0)
+		{
+			args->maxDepth = BsonValueAsInt32(value);
+		}
+		else if (strcmp(key, "restrictSearch") == 0)
+		{
+			pgbson *restrictSearch = PgbsonInitFromDocumentBsonValue(value);
+			args->restrictSearch = ConvertPgbsonToBsonValue(restrictSearch);
+		}
+		else
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("Unexpected field in graph lookup traversal spec: %s",
+								   key)));
+		}
+	}
+}
+
+
+/*
+ * Traverses the graph from the start values and writes the visited documents
+ * into the output document.
+ */
+static pgbson *
+TraverseGraphLookup(const bson_value_t *startValues, const GraphLookupTraverseArgs *args)
+{
+	MongoCollection *collection = GetMongoCollectionByColId(args->collectionId,
+															AccessShareLock);
+
+	List *visitedDocuments = NIL;
+	if (collection != NULL)
+	{
+		StringInfo query = makeStringInfo();
+		appendStringInfo(query,
+						 "SELECT %s.bson_array_agg(document, '') FROM %s.%s"
+						 " WHERE document OPERATOR(%s.@@) $1::%s",
+						 ApiCatalogSchemaName, ApiDataSchemaName, collection->tableName,
+						 ApiCatalogSchemaName, FullBsonTypeName);
+
+		HTAB *visitedIds = CreateBsonValueHashSet();
+		HTAB *probedValues = CreateBsonValueHashSet();
+
+		/* The first frontier is the start values */
+		pgbson_writer frontierWriter;
+		pgbson_array_writer frontierArrayWriter;
+		PgbsonWriterInit(&frontierWriter);
+		PgbsonWriterStartArray(&frontierWriter, "", 0, &frontierArrayWriter);
+
+		bson_iter_t startIter;
+		BsonValueInitIterator(startValues, &startIter);
+		while (bson_iter_next(&startIter))
+		{
+			const bson_value_t *value = bson_iter_value(&startIter);
+			bool found = false;
+			hash_search(probedValues, value, HASH_ENTER, &found);
+			if (!found)
+			{
+				PgbsonArrayWriterWriteValue(&frontierArrayWriter, value);
+			}
+		}
+
+		PgbsonWriterEndArray(&frontierWriter, &frontierArrayWriter);
+		uint32_t frontierSize = PgbsonArrayWriterGetIndex(&frontierArrayWriter);
+
+		for (int32 depth = 0; frontierSize > 0 && depth <= args->maxDepth; depth++)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			pgbsonelement frontierElement;
+			PgbsonToSinglePgbsonElement(PgbsonWriterGetPgbson(&frontierWriter),
+										&frontierElement);
+			pgbson *matchedDocuments = QueryGraphLookupFrontier(query->data, args,
+																&frontierElement.
+																bsonValue);
+
+			PgbsonWriterInit(&frontierWriter);
+			PgbsonWriterStartArray(&frontierWriter, "", 0, &frontierArrayWriter);
+			if (matchedDocuments != NULL)
+			{
+				pgbsonelement matchedElement;
+				PgbsonToSinglePgbsonElement(matchedDocuments, &matchedElement);
+
+				bson_iter_t matchedIter;
+				BsonValueInitIterator(&matchedElement.bsonValue, &matchedIter);
+				while (bson_iter_next(&matchedIter))
+				{
+					pgbson *document = PgbsonInitFromDocumentBsonValue(
+						bson_iter_value(&matchedIter));
+
+					bson_iter_t idIter;
+					if (!PgbsonInitIteratorAtPath(document, "_id", &idIter))
+					{
+						continue;
+					}
+
+					bson_value_t objectId = *bson_iter_value(&idIter);
+					bool found = false;
+					hash_search(visitedIds, &objectId, HASH_ENTER, &found);
+					if (found)
+					{
+						continue;
+					}
+
+					GraphLookupVisitedDocument *visited = palloc(
+						sizeof(GraphLookupVisitedDocument));
+					visited->objectId = objectId;
+					visited->document = document;
+					visited->depth = depth;
+					visitedDocuments = lappend(visitedDocuments, visited);
+
+					/* Add the values not probed yet to the next frontier */
+					pgbson_writer valueWriter;
+					pgbson_element_writer elementWriter;
+					PgbsonWriterInit(&valueWriter);
+					PgbsonInitObjectElementWriter(&valueWriter, &elementWriter, "", 0);
+					StringView path = { .string = "", .length = 0 };
+					ExpressionVariableContext *variableContext = NULL;
+					bool isNullOnEmpty = false;
+					EvaluateAggregationExpressionDataToWriter(
+						&args->connectFromExpression, document, path, &valueWriter,
+						variableContext, isNullOnEmpty);
+
+					bson_value_t nextValues = PgbsonElementWriterGetValue(&elementWriter);
+					if (nextValues.value_type != BSON_TYPE_ARRAY)
+					{
+						continue;
+					}
+
+					bson_iter_t nextIter;
+					BsonValueInitIterator(&nextValues, &nextIter);
+					while (bson_iter_next(&nextIter))
+					{
+						const bson_value_t *value = bson_iter_value(&nextIter);
+						hash_search(probedValues, value, HASH_ENTER, &found);
+						if (!found)
+						{
+							PgbsonArrayWriterWriteValue(&frontierArrayWriter, value);
+						}
+					}
+				}
+			}
+
+			PgbsonWriterEndArray(&frontierWriter, &frontierArrayWriter);
+			frontierSize = PgbsonArrayWriterGetIndex(&frontierArrayWriter);
+		}
+
+		hash_destroy(probedValues);
+		hash_destroy(visitedIds);
+	}
+
+	/* Match the order of the recursive query: Documents are sorted by _id */
+	list_sort(visitedDocuments, CompareVisitedDocumentsById);
+
+	pgbson_writer writer;
+	pgbson_array_writer arrayWriter;
+	PgbsonWriterInit(&writer);
+	PgbsonWriterStartArray(&writer, args->asField.string, args->asField.length,
+						   &arrayWriter);
+
+	ListCell *cell;
+	foreach(cell, visitedDocuments)
+	{
+		GraphLookupVisitedDocument *visited = lfirst(cell);
+		pgbson *document = visited->document;
+		if (args->depthField.length > 0)
+		{
+			pgbson_writer depthWriter;
+			PgbsonWriterInit(&depthWriter);
+			PgbsonWriterAppendInt32(&depthWriter, args->depthField.string,
+									args->depthField.length, visited->depth);
+
+			bool overrideArray = true;
+			document = DatumGetPgBson(OidFunctionCall3(
+										  BsonDollaMergeDocumentsFunctionOid(),
+										  PointerGetDatum(document),
+										  PointerGetDatum(PgbsonWriterGetPgbson(
+															  &depthWriter)),
+										  BoolGetDatum(overrideArray)));
+		}
+
+		PgbsonArrayWriterWriteDocument(&arrayWriter, document);
+	}
+
+	PgbsonWriterEndArray(&writer, &arrayWriter);
+	return PgbsonWriterGetPgbson(&writer);
+}
+
+
+/*
+ * Queries the documents of the collection whose connectToField matches one of the
+ * values of the frontier (and the restrictSearch filter). Returns the documents as
+ * { "": [ documents ] } or NULL if there are none.
+ */
+static pgbson *
+QueryGraphLookupFrontier(const char *query, const GraphLookupTraverseArgs *args,
+						 const bson_value_t *frontier)
+{
+	pgbson_writer filterWriter;
+	PgbsonWriterInit(&filterWriter);
+
+	pgbson_array_writer andWriter;
+	PgbsonWriterStartArray(&filterWriter, "$and", 4, &andWriter);
+
+	pgbson_writer connectWriter;
+	PgbsonArrayWriterStartDocument(&andWriter, &connectWriter);
+	pgbson_writer inWriter;
+	PgbsonWriterStartDocument(&connectWriter, args->connectToField,
+							  strlen(args->connectToField), &inWriter);
+	PgbsonWriterAppendValue(&inWriter, "$in", 3, frontier);
+	PgbsonWriterEndDocument(&connectWriter, &inWriter);
+	PgbsonArrayWriterEndDocument(&andWriter, &connectWriter);
+
+	if (args->restrictSearch.value_type == BSON_TYPE_DOCUMENT)
+	{
+		PgbsonArrayWriterWriteValue(&andWriter, &args->restrictSearch);
+	}
+
+	PgbsonWriterEndArray(&filterWriter, &andWriter);
+
+	int nargs = 1;
+	Oid argTypes[1] = { BsonTypeId() };
+	Datum argValues[1] = { PointerGetDatum(PgbsonWriterGetPgbson(&filterWriter)) };
+	char argNulls[1] = { ' ' };
+	bool readOnly = true;
+	bool isNull = false;
+	Datum result = ExtensionExecuteQueryWithArgsViaSPI(query, nargs, argTypes, argValues,
+													   argNulls, readOnly, SPI_OK_SELECT,
+													   &isNull);
+	if (isNull)
+	{
+		return NULL;
+	}
+
+	return DatumGetPgBson(result);
+}
+
+
+/*
+ * Orders visited documents by their _id.
+ */
+static int
+CompareVisitedDocumentsById(const ListCell *left, const ListCell *right)
+{
+	GraphLookupVisitedDocument *leftDocument = lfirst(left);
+	GraphLookupVisitedDocument *rightDocument = lfirst(right);
+
+	bool isComparisonValid = false;
+	return CompareBsonValueAndType(&leftDocument->objectId, &rightDocument->objectId,
+								   &isComparisonValid);
+}
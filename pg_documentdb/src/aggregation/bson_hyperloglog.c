@@ -0,0 +1,237 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/aggregation/bson_hyperloglog.c
+ *
+ * Implementation of the HyperLogLog sketch behind $approxCountDistinct.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <math.h>
+#include <port/pg_bitutils.h>
+
+#include "io/bson_core.h"
+#include "utils/documentdb_errors.h"
+
+/*
+ * The number of bits of the hash that pick the register: 2^12 registers of a byte
+ * each give a standard error of about 1.6% (1.04 / sqrt(2^12)) for 4KB per group.
+ */
+#define HLL_PRECISION 12
+#define HLL_NUM_REGISTERS (1 << HLL_PRECISION)
+
+/*
+ * The state of the sketch. Sketches are merged by taking the maximum of each
+ * register, so partial states from workers or shards combine without loss.
+ */
+typedef struct HyperLogLogState
+{
+	int32 vl_len_;              /* varlena header (do not touch directly!) */
+
+	/* The precision the sketch was built with (HLL_PRECISION) */
+	int32 precision;
+
+	/* The largest rank (leading zeros + 1) seen for the hashes of each register */
+	uint8 registers[FLEXIBLE_ARRAY_MEMBER];
+} HyperLogLogState;
+
+#define HLL_STATE_SIZE (offsetof(HyperLogLogState, registers) + HLL_NUM_REGISTERS)
+
+static HyperLogLogState * AllocateHyperLogLogState(MemoryContext aggregateContext);
+static void CheckHyperLogLogState(const HyperLogLogState *state);
+static int64 EstimateHyperLogLogCardinality(const HyperLogLogState *state);
+
+PG_FUNCTION_INFO_V1(bson_approx_count_distinct_transition);
+PG_FUNCTION_INFO_V1(bson_approx_count_distinct_combine);
+PG_FUNCTION_INFO_V1(bson_approx_count_distinct_final);
+
+
+/*
+ * Adds the hash of the value to the sketch. Missing values ({}) are not counted,
+ * the same as with $addToSet.
+ */
+Datum
+bson_approx_count_distinct_transition(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	HyperLogLogState *state;
+	if (PG_ARGISNULL(0))
+	{
+		state = AllocateHyperLogLogState(aggregateContext);
+	}
+	else
+	{
+		state = (HyperLogLogState *) PG_GETARG_BYTEA_P(0);
+	}
+
+	pgbson *currentValue = PG_GETARG_MAYBE_NULL_PGBSON(1);
+	if (currentValue == NULL || IsPgbsonEmptyDocument(currentValue))
+	{
+		PG_RETURN_POINTER(state);
+	}
+
+	pgbsonelement element;
+	PgbsonToSinglePgbsonElement(currentValue, &element);
+
+	/*
+	 * The top bits pick the register, the rank is taken from the rest. The low bit
+	 * that is set after the shift bounds the rank for hashes that are all zeros.
+	 */
+	uint64 hash = (uint64) BsonValueHash(&element.bsonValue, 0);
+	uint32 index = (uint32) (hash >> (64 - HLL_PRECISION));
+	uint64 remainder = (hash << HLL_PRECISION) | (UINT64CONST(1) <<
+												  (HLL_PRECISION - 1));
+	uint8 rank = (uint8) (64 - pg_leftmost_one_pos64(remainder));
+
+	if (rank > state->registers[index])
+	{
+		state->registers[index] = rank;
+	}
+
+	PG_RETURN_POINTER(state);
+}
+
+
+/*
+ * Merges two sketches by keeping the largest rank of each register.
+ */
+Datum
+bson_approx_count_distinct_combine(PG_FUNCTION_ARGS)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, errmsg(
+					"Aggregate function invoked in non-aggregate context"));
+	}
+
+	if (PG_ARGISNULL(1))
+	{
+		if (PG_ARGISNULL(0))
+		{
+			PG_RETURN_NULL();
+		}
+
+		PG_RETURN_POINTER(PG_GETARG_BYTEA_P(0));
+	}
+
+	HyperLogLogState *right = (HyperLogLogState *) PG_GETARG_BYTEA_P(1);
+	CheckHyperLogLogState(right);
+
+	HyperLogLogState *left;
+	if (PG_ARGISNULL(0))
+	{
+		left = AllocateHyperLogLogState(aggregateContext);
+	}
+	else
+	{
+		left = (HyperLogLogState *) PG_GETARG_BYTEA_P(0);
+		CheckHyperLogLogState(left);
+	}
+
+	for (int i = 0; i < HLL_NUM_REGISTERS; i++)
+	{
+		left->registers[i] = Max(left->registers[i], right->registers[i]);
+	}
+
+	PG_RETURN_POINTER(left);
+}
+
+
+/*
+ * Writes the estimated number of distinct values as an int32 while it fits and
+ * as an int64 otherwise.
+ */
+Datum
+bson_approx_count_distinct_final(PG_FUNCTION_ARGS)
+{
+	int64 estimate = 0;
+	if (!PG_ARGISNULL(0))
+	{
+		HyperLogLogState *state = (HyperLogLogState *) PG_GETARG_BYTEA_P(0);
+		CheckHyperLogLogState(state);
+		estimate = EstimateHyperLogLogCardinality(state);
+	}
+
+	pgbsonelement finalValue;
+	finalValue.path = "";
+	finalValue.pathLength = 0;
+	if (estimate <= INT32_MAX)
+	{
+		finalValue.bsonValue.value_type = BSON_TYPE_INT32;
+		finalValue.bsonValue.value.v_int32 = (int32) estimate;
+	}
+	else
+	{
+		finalValue.bsonValue.value_type = BSON_TYPE_INT64;
+		finalValue.bsonValue.value.v_int64 = estimate;
+	}
+
+	PG_RETURN_POINTER(PgbsonElementToPgbson(&finalValue));
+}
+
+
+static HyperLogLogState *
+AllocateHyperLogLogState(MemoryContext aggregateContext)
+{
+	HyperLogLogState *state = MemoryContextAllocZero(aggregateContext, HLL_STATE_SIZE);
+	SET_VARSIZE(state, HLL_STATE_SIZE);
+	state->precision = HLL_PRECISION;
+	return state;
+}
+
+
+/*
+ * States come back from other workers or nodes serialized: Make sure they were
+ * built the same way before merging or reading them.
+ */
+static void
+CheckHyperLogLogState(const HyperLogLogState *state)
+{
+	if (VARSIZE(state) != HLL_STATE_SIZE || state->precision != HLL_PRECISION)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+						errmsg("Invalid approximate distinct count state")));
+	}
+}
+
+
+/*
+ * The HyperLogLog estimate (Flajolet et al.) with linear counting while many
+ * registers are still empty. The hashes are 64 bit, so the estimate needs no
+ * correction for hash collisions at the high end.
+ */
+static int64
+EstimateHyperLogLogCardinality(const HyperLogLogState *state)
+{
+	double registerCount = HLL_NUM_REGISTERS;
+	double alpha = 0.7213 / (1.0 + 1.079 / registerCount);
+
+	double inverseSum = 0;
+	int emptyRegisters = 0;
+	for (int i = 0; i < HLL_NUM_REGISTERS; i++)
+	{
+		inverseSum += ldexp(1.0, -state->registers[i]);
+		if (state->registers[i] == 0)
+		{
+			emptyRegisters++;
+		}
+	}
+
+	double estimate = alpha * registerCount * registerCount / inverseSum;
+	if (estimate <= 2.5 * registerCount && emptyRegisters > 0)
+	{
+		estimate = registerCount * log(registerCount / emptyRegisters);
+	}
+
+	return (int64) llround(estimate);
+}
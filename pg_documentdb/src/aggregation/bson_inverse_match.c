@@ -16,9 +16,12 @@
 #include "io/bson_core.h"
 #include "io/bson_traversal.h"
 #include "operators/bson_expression.h"
+#include "query/bson_compiled_predicate.h"
 #include "utils/documentdb_errors.h"
 #include "utils/fmgr_utils.h"
 
+extern bool EnableCompiledQueryPredicates;
+
 /* --------------------------------------------------------- */
 /* Forward declaration */
 /* --------------------------------------------------------- */
@@ -57,6 +60,9 @@ typedef struct InverseMatchArgs
 static void PopulateInverseMatchArgs(InverseMatchArgs *args, bson_iter_t *specIter);
 static void ValidateQueryInput(const bson_value_t *value);
 static bool EvaluateInverseMatch(pgbson *document, const InverseMatchArgs *args);
+static bool TryEvaluateCompiledInverseMatch(CompiledPredicateProgram *program,
+											const bson_value_t *queryInput,
+											bool *result);
 static bool InverseMatchVisitTopLevelField(pgbsonelement *element, const
 										   StringView *filterPath,
 										   void *state);
@@ -159,8 +165,24 @@ EvaluateInverseMatch(pgbson *document, const InverseMatchArgs *args)
 							BsonTypeName(queryValue.value_type))));
 	}
 
+	/*
+	 * Rules that only use simple comparisons are compiled into a predicate
+	 * program which is much cheaper to build than an executor expression:
+	 * This matters when the input is matched against a large number of
+	 * stored queries.
+	 */
 	MemoryContext memoryContext = CurrentMemoryContext;
-	ExprEvalState *exprEvalState = GetExpressionEvalState(&queryValue, memoryContext);
+	CompiledPredicateProgram *program = NULL;
+	ExprEvalState *exprEvalState = NULL;
+	if (EnableCompiledQueryPredicates)
+	{
+		program = TryCompileQueryPredicateProgram(&queryValue);
+	}
+
+	if (program == NULL)
+	{
+		exprEvalState = GetExpressionEvalState(&queryValue, memoryContext);
+	}
 
 	bson_value_t queryInput;
 	if (args->queryInputExpression.kind == AggregationExpressionKind_Constant)
@@ -196,6 +218,19 @@ EvaluateInverseMatch(pgbson *document, const InverseMatchArgs *args)
 	bson_type_t inputType = queryInput.value_type;
 	bool result = false;
 
+	if (program != NULL)
+	{
+		bool evaluated = TryEvaluateCompiledInverseMatch(program, &queryInput, &result);
+		FreeCompiledPredicateProgram(program);
+		if (evaluated)
+		{
+			return result;
+		}
+
+		/* The input needs the full query semantics */
+		exprEvalState = GetExpressionEvalState(&queryValue, memoryContext);
+	}
+
 	if (inputType == BSON_TYPE_ARRAY)
 	{
 		result = EvalBooleanExpressionAgainstArray(exprEvalState, &queryInput);
@@ -219,6 +254,49 @@ EvaluateInverseMatch(pgbson *document, const InverseMatchArgs *args)
 }
 
 
+/*
+ * Evaluates the compiled rule query against the input document (or any of
+ * the documents of the input array). Returns false if the program could not
+ * evaluate one of the documents, in which case the caller falls back to the
+ * query operators.
+ */
+static bool
+TryEvaluateCompiledInverseMatch(CompiledPredicateProgram *program,
+								const bson_value_t *queryInput, bool *result)
+{
+	*result = false;
+	if (queryInput->value_type == BSON_TYPE_DOCUMENT)
+	{
+		return EvaluateCompiledPredicateProgram(program, queryInput, result);
+	}
+	else if (queryInput->value_type != BSON_TYPE_ARRAY)
+	{
+		return false;
+	}
+
+	bson_iter_t arrayIter;
+	BsonValueInitIterator(queryInput, &arrayIter);
+	while (bson_iter_next(&arrayIter))
+	{
+		const bson_value_t *element = bson_iter_value(&arrayIter);
+		bool isMatch = false;
+		if (element->value_type != BSON_TYPE_DOCUMENT ||
+			!EvaluateCompiledPredicateProgram(program, element, &isMatch))
+		{
+			return false;
+		}
+
+		if (isMatch)
+		{
+			*result = true;
+			return true;
+		}
+	}
+
+	return true;
+}
+
+
 /*
  * Parses the {"path": <document>, "input": <document or array of documents>, "defaultResult": <bool> }
  * and stores it into the args parameter. It just validates the input as the rest of validation is done at
@@ -19,6 +19,9 @@
 #include "operators/bson_expr_eval.h"
 #include "metadata/metadata_cache.h"
 #include "io/bson_traversal.h"
+#include "query/bson_compiled_predicate.h"
+
+extern bool EnableCompiledQueryPredicates;
 
 
 /* --------------------------------------------------------- */
@@ -38,6 +41,13 @@ typedef struct BsonPositionalQueryQual
 	/* The expression that needs to be evaluated for applying this filter */
 	ExprEvalState *evalState;
 
+	/*
+	 * For $elemMatch on documents, the filter compiled into a predicate
+	 * program that array elements are matched with directly (NULL if the
+	 * filter could not be compiled).
+	 */
+	CompiledPredicateProgram *compiledProgram;
+
 	/* Whether or not the filter only matches an array */
 	bool isArrayMatch;
 
@@ -56,6 +66,9 @@ typedef struct TraverseBsonPositionalQualState
 	/* The expression to evaluate at the leaf */
 	ExprEvalState *evalState;
 
+	/* The compiled program of the expression (if any) */
+	CompiledPredicateProgram *compiledProgram;
+
 	/* Output variable - the matched index (if any) */
 	int32_t matchIndex;
 
@@ -158,6 +171,7 @@ MatchPositionalQueryAgainstDocument(const BsonPositionalQueryData *data, const
 		TraverseBsonPositionalQualState traverseState =
 		{
 			.evalState = qual->evalState,
+			.compiledProgram = qual->compiledProgram,
 			.matchIndex = -1,
 			.currentIntermediateIndex = -1,
 			.isArrayMatch = qual->isArrayMatch,
@@ -308,6 +322,7 @@ ProcessSingleFuncExpr(FuncExpr *expr, List **finalList, bool isArrayMatch, const
 	qual->path = path;
 	qual->isArrayMatch = isArrayMatch;
 	qual->isEmptyElemMatch = false;
+	qual->compiledProgram = NULL;
 	if (expr->funcid == BsonValueElemMatchMatchFunctionId())
 	{
 		if (IsBsonValueEmptyDocument(&singleElement.bsonValue))
@@ -320,6 +335,13 @@ ProcessSingleFuncExpr(FuncExpr *expr, List **finalList, bool isArrayMatch, const
 		qual->evalState = GetExpressionEvalState(&singleElement.bsonValue,
 												 CurrentMemoryContext);
 		qual->isArrayMatch = true;
+
+		/* Document elements of large arrays skip the expression evaluation */
+		if (EnableCompiledQueryPredicates && !qual->isEmptyElemMatch)
+		{
+			qual->compiledProgram = TryCompileQueryPredicateProgram(
+				&singleElement.bsonValue);
+		}
 	}
 	else
 	{
@@ -405,7 +427,10 @@ PositionalQueryVisitArrayField(pgbsonelement *element, const StringView *filterP
 		result = element->bsonValue.value_type == BSON_TYPE_DOCUMENT ||
 				 element->bsonValue.value_type == BSON_TYPE_ARRAY;
 	}
-	else
+	else if (queryState->compiledProgram == NULL ||
+			 element->bsonValue.value_type != BSON_TYPE_DOCUMENT ||
+			 !EvaluateCompiledPredicateProgram(queryState->compiledProgram,
+											   &element->bsonValue, &result))
 	{
 		bool shouldRecurseIfArray = false;
 		result = EvalBooleanExpressionAgainstValue(queryState->evalState,
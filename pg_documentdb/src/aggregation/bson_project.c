@@ -39,6 +39,10 @@
 #include "commands/commands_common.h"
 #include "collation/collation.h"
 
+extern bool EnableDocumentFieldDirectory;
+extern bool EnableProjectionRawFieldCopy;
+extern bool EnableAddFieldsAppendFastPath;
+
 
 /* --------------------------------------------------------- */
 /* Error-Messages */
@@ -77,11 +81,32 @@ typedef struct BsonProjectionQueryState
 	/* Total number of projections that needs to come at the end */
 	uint32_t endTotalProjections;
 
+	/* Whether the projection only writes top level fields ($addFields: { "a": <expr> }) */
+	bool writesOnlyTopLevelFields;
+
 	/* Optional: Bson Project Document stage function hooks */
 	BsonProjectDocumentFunctions projectDocumentFuncs;
+
+	/* The generation of the expressions shared across the fields (NULL if none are) */
+	uint64 *sharedExpressionGeneration;
 } BsonProjectionQueryState;
 
 
+/*
+ * A run of consecutive fields of a source document that are written through
+ * unmodified: The run is copied to the output as one byte range when the next
+ * field that the projection does touch (or the end of the document) is reached.
+ */
+typedef struct PassThroughFieldRun
+{
+	/* The first serialized element of the run */
+	const uint8_t *start;
+
+	/* The length of the serialized elements in the run */
+	uint32_t length;
+} PassThroughFieldRun;
+
+
 /* --------------------------------------------------------- */
 /* Forward declaration */
 /* --------------------------------------------------------- */
@@ -99,7 +124,15 @@ static void ProjectCurrentIteratorFieldToWriter(bson_iter_t *documentIterator,
 												bool projectNonMatchingFields,
 												Bitmapset **fieldHandledBitMap,
 												ProjectDocumentState *projectDocState,
-												bool isInNestedArray);
+												bool isInNestedArray,
+												PassThroughFieldRun *passThroughRun);
+static bool DocumentHasAnyTopLevelField(pgbson *document,
+										const BsonIntermediatePathNode *tree);
+static bool TryGetReplaceRootPathDocument(pgbson *document,
+										  const bson_value_t *pathExpression,
+										  bson_value_t *pathDocument);
+static inline void FlushPassThroughFieldRun(pgbson_writer *writer,
+											PassThroughFieldRun *passThroughRun);
 static void HandleUnresolvedFields(const BsonIntermediatePathNode *parentNode,
 								   Bitmapset *fieldBitMapSet,
 								   pgbson_writer *writer,
@@ -820,6 +853,19 @@ ProjectReplaceRootDocument(pgbson *document,
 						   const ExpressionVariableContext *variableContext,
 						   bool forceProjectId)
 {
+	/*
+	 * Unwrapping an embedded document by its path ({ newRoot: "$a.b" }) is
+	 * just a copy of its bytes: Skip evaluating it through a writer.
+	 */
+	bson_value_t pathDocument;
+	if (!forceProjectId &&
+		replaceRootExpression->kind == AggregationExpressionKind_Path &&
+		TryGetReplaceRootPathDocument(document, &replaceRootExpression->value,
+									  &pathDocument))
+	{
+		return PgbsonInitFromDocumentBsonValue(&pathDocument);
+	}
+
 	pgbson_writer writer;
 	PgbsonWriterInit(&writer);
 
@@ -891,6 +937,57 @@ ProjectReplaceRootDocument(pgbson *document,
 }
 
 
+/*
+ * Gets the value at the path of a field path expression (e.g. "$a.b") if it
+ * is a document reached through documents only. Paths through arrays or that
+ * don't resolve to a document return false, and are left to the expression
+ * evaluation (and its errors).
+ */
+static bool
+TryGetReplaceRootPathDocument(pgbson *document, const bson_value_t *pathExpression,
+							  bson_value_t *pathDocument)
+{
+	/* Skip the leading '$' */
+	StringView path =
+	{
+		.string = pathExpression->value.v_utf8.str + 1,
+		.length = pathExpression->value.v_utf8.len - 1
+	};
+
+	bson_iter_t documentIterator;
+	PgbsonInitIterator(document, &documentIterator);
+	while (true)
+	{
+		StringView field = StringViewFindPrefix(&path, '.');
+		if (field.string == NULL)
+		{
+			field = path;
+		}
+
+		if (!bson_iter_find_w_len(&documentIterator, field.string, field.length) ||
+			!BSON_ITER_HOLDS_DOCUMENT(&documentIterator))
+		{
+			return false;
+		}
+
+		if (field.length == path.length)
+		{
+			*pathDocument = *bson_iter_value(&documentIterator);
+			return true;
+		}
+
+		bson_iter_t childIterator;
+		if (!bson_iter_recurse(&documentIterator, &childIterator))
+		{
+			return false;
+		}
+
+		documentIterator = childIterator;
+		path = StringViewSubstring(&path, field.length + 1);
+	}
+}
+
+
 /* Populates the aggregation expression data for a replace root stage based on the pathSpec specified to $replaceRoot. */
 void
 PopulateReplaceRootExpressionDataFromSpec(BsonReplaceRootRedactState *state,
@@ -1481,15 +1578,50 @@ pgbson *
 ProjectDocumentWithState(pgbson *sourceDocument,
 						 const BsonProjectionQueryState *state)
 {
+	/*
+	 * When fields that aren't in the projection are written through
+	 * (exclusion, $addFields, $set) the output is at least about the size
+	 * of the source document: size the writer upfront to avoid regrowing it.
+	 */
 	pgbson_writer writer;
-	PgbsonWriterInit(&writer);
+	if (state->projectNonMatchingFields)
+	{
+		PgbsonWriterInitWithSizeHint(&writer, PgbsonGetBsonSize(sourceDocument));
+	}
+	else
+	{
+		PgbsonWriterInit(&writer);
+	}
+
 	bson_iter_t documentIterator;
 	PgbsonInitIterator(sourceDocument, &documentIterator);
 
+	/* Expressions shared across the fields are evaluated anew for this document */
+	if (state->sharedExpressionGeneration != NULL)
+	{
+		(*state->sharedExpressionGeneration)++;
+	}
+
+	/*
+	 * Field path expressions in the projection ("$a", "$$ROOT.b") each look up a
+	 * path on the source document: Share a field directory across them so that
+	 * the document is walked at most once for the top level fields.
+	 */
+	const ExpressionVariableContext *variableContext = state->variableContext;
+	ExpressionVariableContext documentVariableContext = { 0 };
+	PgbsonFieldDirectory documentDirectory;
+	if (EnableDocumentFieldDirectory)
+	{
+		PgbsonFieldDirectoryInit(&documentDirectory, sourceDocument);
+		documentVariableContext.parent = state->variableContext;
+		documentVariableContext.documentDirectory = &documentDirectory;
+		variableContext = &documentVariableContext;
+	}
+
 	ProjectDocumentState projectDocState = {
 		.isPositionalAlreadyEvaluated = false,
 		.parentDocument = sourceDocument,
-		.variableContext = state->variableContext,
+		.variableContext = variableContext,
 		.hasExclusion = state->hasExclusion,
 		.projectDocumentFuncs = state->projectDocumentFuncs,
 		.pendingProjectionState = NULL,
@@ -1503,14 +1635,67 @@ ProjectDocumentWithState(pgbson *sourceDocument,
 				state->endTotalProjections);
 	}
 
-	bool isInNestedArray = false;
-	TraverseObjectAndAppendToWriter(&documentIterator, state->root, &writer,
-									state->projectNonMatchingFields,
-									&projectDocState, isInNestedArray);
+	/* The temporary values of the expressions are released at once after the document */
+	bool openedArena = BeginExpressionEvaluationArena();
+
+	if (EnableAddFieldsAppendFastPath && state->writesOnlyTopLevelFields &&
+		projectDocState.pendingProjectionState == NULL &&
+		!DocumentHasAnyTopLevelField(sourceDocument, state->root))
+	{
+		/*
+		 * None of the fields exist yet: The source document is kept as is and the
+		 * fields are appended after it, which is where they'd be written anyway.
+		 */
+		PgbsonWriterConcat(&writer, sourceDocument);
+		HandleUnresolvedFields(state->root, NULL, &writer, sourceDocument,
+							   variableContext);
+	}
+	else
+	{
+		bool isInNestedArray = false;
+		TraverseObjectAndAppendToWriter(&documentIterator, state->root, &writer,
+										state->projectNonMatchingFields,
+										&projectDocState, isInNestedArray);
+	}
+
+	EndExpressionEvaluationArena(openedArena);
+
+	if (EnableDocumentFieldDirectory)
+	{
+		PgbsonFieldDirectoryFree(&documentDirectory);
+	}
+
 	return PgbsonWriterGetPgbson(&writer);
 }
 
 
+/*
+ * Whether any of the top level fields of the document is one of the fields of the
+ * path tree. Only compares the keys: No values are read.
+ */
+static bool
+DocumentHasAnyTopLevelField(pgbson *document, const BsonIntermediatePathNode *tree)
+{
+	bson_iter_t documentIterator;
+	PgbsonInitIterator(document, &documentIterator);
+	while (bson_iter_next(&documentIterator))
+	{
+		StringView key = bson_iter_key_string_view(&documentIterator);
+
+		const BsonPathNode *child;
+		foreach_child(child, tree)
+		{
+			if (StringViewEquals(&child->field, &key))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
 /*
  * Tries to inline a left Projection expression with a right Projection expression
  * to create a merged expression if possible.
@@ -1726,6 +1911,9 @@ BuildBsonPathTreeForDollarProjectCore(BsonProjectionQueryState *state,
 			projectionContext->collationString;
 	}
 
+	/* The fields are evaluated against the same document: Share repeated expressions */
+	pathTreeContext->parseAggregationContext.shareRepeatedExpressions = true;
+
 	bool hasFields = false;
 	bool forceLeafExpression = false;
 	BsonIntermediatePathNode *root = BuildBsonPathTree(projectionContext->pathSpecIter,
@@ -1740,6 +1928,8 @@ BuildBsonPathTreeForDollarProjectCore(BsonProjectionQueryState *state,
 	state->hasInclusion = pathTreeContext->hasInclusion;
 	state->hasExclusion = pathTreeContext->hasExclusion;
 	state->projectNonMatchingFields = pathTreeContext->hasExclusion;
+	state->sharedExpressionGeneration =
+		pathTreeContext->parseAggregationContext.sharedExpressionGeneration;
 
 	SetVariableSpec(&state->variableContext, projectionContext->variableSpec);
 }
@@ -1772,6 +1962,9 @@ BuildBsonPathTreeForDollarAddFields(BsonProjectionQueryState *state,
 		context.parseAggregationContext.collationString = collationString;
 	}
 
+	/* The fields are evaluated against the same document: Share repeated expressions */
+	context.parseAggregationContext.shareRepeatedExpressions = true;
+
 	bool hasFields = false;
 	bool forceLeafExpression = true;
 	BsonIntermediatePathNode *root = BuildBsonPathTree(projectionSpecIter, &context,
@@ -1781,6 +1974,19 @@ BuildBsonPathTreeForDollarAddFields(BsonProjectionQueryState *state,
 	state->hasInclusion = context.hasInclusion;
 	state->hasExclusion = context.hasExclusion;
 	state->projectNonMatchingFields = true;
+	state->writesOnlyTopLevelFields = true;
+	state->sharedExpressionGeneration =
+		context.parseAggregationContext.sharedExpressionGeneration;
+
+	const BsonPathNode *child;
+	foreach_child(child, root)
+	{
+		if (child->nodeType != NodeType_LeafField)
+		{
+			state->writesOnlyTopLevelFields = false;
+			break;
+		}
+	}
 
 	SetVariableSpec(&state->variableContext, variableSpec);
 }
@@ -2289,7 +2495,8 @@ ProjectCurrentIteratorFieldToWriter(bson_iter_t *documentIterator,
 									bool projectNonMatchingFields,
 									Bitmapset **fieldHandledBitmapSet,
 									ProjectDocumentState *projectDocState,
-									bool isInNestedArray)
+									bool isInNestedArray,
+									PassThroughFieldRun *passThroughRun)
 {
 	StringView path = bson_iter_key_string_view(documentIterator);
 
@@ -2306,6 +2513,9 @@ ProjectCurrentIteratorFieldToWriter(bson_iter_t *documentIterator,
 			continue;
 		}
 
+		/* The fields written through so far precede whatever is written for this one */
+		FlushPassThroughFieldRun(writer, passThroughRun);
+
 		/* field is a match.
 		 * field is a perfect match - add it.
 		 */
@@ -2460,7 +2670,20 @@ ProjectCurrentIteratorFieldToWriter(bson_iter_t *documentIterator,
 	 *      a. $project has exclusions on a path
 	 *      b. $addFields
 	 */
-	if (projectNonMatchingFields)
+	if (projectNonMatchingFields && passThroughRun != NULL)
+	{
+		const uint8_t *elementStart = documentIterator->raw + documentIterator->off;
+		uint32_t elementLength = documentIterator->next_off - documentIterator->off;
+		if (passThroughRun->length == 0 ||
+			passThroughRun->start + passThroughRun->length != elementStart)
+		{
+			FlushPassThroughFieldRun(writer, passThroughRun);
+			passThroughRun->start = elementStart;
+		}
+
+		passThroughRun->length += elementLength;
+	}
+	else if (projectNonMatchingFields)
 	{
 		PgbsonWriterAppendValue(writer, path.string, path.length, bson_iter_value(
 									documentIterator));
@@ -2468,6 +2691,24 @@ ProjectCurrentIteratorFieldToWriter(bson_iter_t *documentIterator,
 }
 
 
+/*
+ * Writes out the pending run of unmodified fields as is.
+ */
+static inline void
+FlushPassThroughFieldRun(pgbson_writer *writer, PassThroughFieldRun *passThroughRun)
+{
+	if (passThroughRun == NULL || passThroughRun->length == 0)
+	{
+		return;
+	}
+
+	PgbsonWriterAppendRawElements(writer, passThroughRun->start,
+								  passThroughRun->length);
+	passThroughRun->start = NULL;
+	passThroughRun->length = 0;
+}
+
+
 /*
  * Walks all fields in an object in the current iterator and validates if any paths match the
  * specified path tree specified.
@@ -2484,6 +2725,16 @@ TraverseObjectAndAppendToWriter(bson_iter_t *iterator,
 	check_stack_depth();
 	CHECK_FOR_INTERRUPTS();
 
+	/*
+	 * Fields that aren't in the projection are copied in runs rather than one by one:
+	 * This matters for exclusions like { "largeField": 0 } where the rest of the
+	 * document is written through.
+	 */
+	PassThroughFieldRun passThroughRun = { 0 };
+	PassThroughFieldRun *passThroughRunPtr =
+		projectNonMatchingFields && EnableProjectionRawFieldCopy ? &passThroughRun :
+		NULL;
+
 	/* determine the number of bits for a bitmask on the children. */
 	Bitmapset *fieldHandledBitmapSet = NULL;
 	while (bson_iter_next(iterator))
@@ -2493,9 +2744,12 @@ TraverseObjectAndAppendToWriter(bson_iter_t *iterator,
 											projectNonMatchingFields,
 											&fieldHandledBitmapSet,
 											projectDocState,
-											isInNestedArray);
+											isInNestedArray,
+											passThroughRunPtr);
 	}
 
+	FlushPassThroughFieldRun(writer, passThroughRunPtr);
+
 	/* add any unresolved field nodes that needed to be added. */
 	HandleUnresolvedFields(pathSpecTree, fieldHandledBitmapSet, writer,
 						   projectDocState->parentDocument,
@@ -2819,11 +3073,15 @@ MergeDocumentWithArrayOverride(pgbson *sourceDocument, const
 		.skipIntermediateArrayFields = overrideNestedArrays,
 	};
 
+	bool openedArena = BeginExpressionEvaluationArena();
+
 	bool isInNestedArray = false;
 	TraverseObjectAndAppendToWriter(&documentIterator, pathSpecTree, &writer,
 									projectNonMatchingField,
 									&projectDocState, isInNestedArray);
 
+	EndExpressionEvaluationArena(openedArena);
+
 	return PgbsonWriterGetPgbson(&writer);
 }
 
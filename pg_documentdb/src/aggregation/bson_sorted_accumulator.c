@@ -35,6 +35,8 @@
 static void ParseInputExpressionAndPersistValue(AggregationExpressionData *expressionData,
 												const bson_value_t *expressionValue,
 												ParseAggregationExpressionContext *context);
+static int64 GetOnSortedValuesPrefixSize(char *values, int64 valuesSize, int64
+										 valueCount, int64 prefixCount);
 
 /*
  * Converts a BsonOrderAggState into a serialized form to allow the internal type to be bytea
@@ -771,6 +773,133 @@ BsonOrderTransitionOnSorted(PG_FUNCTION_ARGS, bool invertSort, bool isSingle)
 }
 
 
+/*
+ * Applies the "combine" (COMBINEFUNC) for the accumulators on input without
+ * a sort specification, whose state is built by BsonOrderTransitionOnSorted.
+ *
+ * The args of PG_FUNCTION_ARGS are:
+ *      0) left side partial aggregate
+ *      1) right side partial aggregate
+ *
+ * As the input has no order, the partial states can be merged as if the rows
+ * of the right side followed the rows of the left side:
+ *      (1) For invertSort = false the values of the right side are appended to
+ *          the values of the left side until the state has ReturnCount values.
+ *      (2) For invertSort = true the last ReturnCount values of the left side
+ *          followed by the right side are kept.
+ */
+Datum
+BsonOrderCombineOnSorted(PG_FUNCTION_ARGS, bool invertSort)
+{
+	MemoryContext aggregateContext;
+	if (!AggCheckCallContext(fcinfo, &aggregateContext))
+	{
+		ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg(
+							"Aggregate function invoked in non-aggregate context")));
+	}
+
+	/* Check if either result is NULL and return Non-NULL */
+	if (PG_ARGISNULL(0))
+	{
+		return PG_GETARG_DATUM(1);
+	}
+
+	if (PG_ARGISNULL(1))
+	{
+		return PG_GETARG_DATUM(0);
+	}
+
+	bytea *states[2] = { PG_GETARG_BYTEA_P(0), PG_GETARG_BYTEA_P(1) };
+	char *values[2];
+	int64 valuesSize[2];
+	int64 currentCount[2];
+	int64 returnCount = 0;
+
+	/* Format is VARHDR | ByteSize | ReturnCount | CurrentCount | InputExpressionSize | InputExpression | values... */
+	for (int i = 0; i < 2; i++)
+	{
+		char *sourcePtr = (char *) VARDATA(states[i]);
+		int64 byteSize = *(int64 *) sourcePtr;
+		sourcePtr += sizeof(int64);
+		returnCount = *(int64 *) sourcePtr;
+		sourcePtr += sizeof(int64);
+		currentCount[i] = *(int64 *) sourcePtr;
+		sourcePtr += sizeof(int64);
+		int64 inputExpressionSize = *(int64 *) sourcePtr;
+		sourcePtr += sizeof(int64);
+
+		/* The input expression is only stored for $setWindowFields which doesn't combine */
+		if (inputExpressionSize != 0 || currentCount[i] > returnCount)
+		{
+			ereport(ERROR, (errcode(ERRCODE_INTERNAL_ERROR), errmsg(
+								"Invalid state for aggregate function BsonOrderCombineOnSorted")));
+		}
+
+		values[i] = sourcePtr;
+		valuesSize[i] = byteSize - VARHDRSZ - sizeof(int64) * 4;
+	}
+
+	int64 keepCount[2] = { currentCount[0], currentCount[1] };
+	if (!invertSort)
+	{
+		keepCount[1] = Min(currentCount[1], returnCount - currentCount[0]);
+		if (keepCount[1] == 0)
+		{
+			PG_RETURN_POINTER(states[0]);
+		}
+	}
+	else
+	{
+		keepCount[0] = Min(currentCount[0], returnCount - currentCount[1]);
+		if (keepCount[0] == 0)
+		{
+			PG_RETURN_POINTER(states[1]);
+		}
+	}
+
+	/*
+	 * Find the values to copy from each side: A prefix of the right values when
+	 * taking the first values, and a suffix of the left values when taking the last.
+	 */
+	char *copyStart[2] = { values[0], values[1] };
+	int64 copySize[2] = { valuesSize[0], valuesSize[1] };
+	if (!invertSort)
+	{
+		copySize[1] = GetOnSortedValuesPrefixSize(values[1], valuesSize[1],
+												  currentCount[1], keepCount[1]);
+	}
+	else
+	{
+		int64 droppedSize = GetOnSortedValuesPrefixSize(values[0], valuesSize[0],
+														currentCount[0],
+														currentCount[0] -
+														keepCount[0]);
+		copyStart[0] += droppedSize;
+		copySize[0] -= droppedSize;
+	}
+
+	uint32 totalSize = VARHDRSZ + sizeof(int64) * 4 + copySize[0] + copySize[1];
+	bytea *returnData = (bytea *) palloc0(totalSize);
+	SET_VARSIZE(returnData, totalSize);
+
+	char *returnDataPtr = (char *) VARDATA(returnData);
+	*((int64 *) (returnDataPtr)) = totalSize;
+	returnDataPtr += sizeof(int64);
+	*((int64 *) (returnDataPtr)) = returnCount;
+	returnDataPtr += sizeof(int64);
+	*((int64 *) (returnDataPtr)) = keepCount[0] + keepCount[1];
+	returnDataPtr += sizeof(int64);
+	*((int64 *) (returnDataPtr)) = 0;
+	returnDataPtr += sizeof(int64);
+
+	memcpy(returnDataPtr, copyStart[0], copySize[0]);
+	returnDataPtr += copySize[0];
+	memcpy(returnDataPtr, copyStart[1], copySize[1]);
+
+	PG_RETURN_POINTER(returnData);
+}
+
+
 /*
  * Applies the "state transition" (SFUNC) for accumulator.
  *
@@ -1383,3 +1512,38 @@ ParseInputExpressionAndPersistValue(AggregationExpressionData *expressionData,
 	bson_value_t persistedValue = element.bsonValue;
 	ParseAggregationExpressionData(expressionData, &persistedValue, context);
 }
+
+
+/*
+ * Returns the size of the first prefixCount values out of the valueCount values
+ * of an on sorted state. Each value is followed by its uint32 size, so the values
+ * are walked back from the end: The values themselves can't be walked forward
+ * since a NULL is written as a single 0 byte rather than a varlena.
+ */
+static int64
+GetOnSortedValuesPrefixSize(char *values, int64 valuesSize, int64 valueCount, int64
+							prefixCount)
+{
+	int64 prefixSize = valuesSize;
+	for (int64 i = valueCount; i > prefixCount; i--)
+	{
+		if (prefixSize < (int64) sizeof(uint32))
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Corrupted BSON entry in aggregation state")));
+		}
+
+		uint32 valueSize = *(uint32 *) (values + prefixSize - sizeof(uint32));
+		if ((int64) valueSize + (int64) sizeof(uint32) > prefixSize)
+		{
+			ereport(ERROR,
+					(errcode(ERRCODE_INTERNAL_ERROR),
+					 errmsg("Corrupted BSON entry in aggregation state")));
+		}
+
+		prefixSize -= valueSize + sizeof(uint32);
+	}
+
+	return prefixSize;
+}
@@ -106,6 +106,9 @@ typedef struct tdigest_aggstate_t
 } tdigest_aggstate_t;
 
 static int centroid_cmp(const void *a, const void *b);
+static void tdigest_merge_sorted(const centroid_t *left, int nleft,
+								 const centroid_t *right, int nright,
+								 centroid_t *result);
 
 #define PG_GETARG_TDIGEST(x) (tdigest_t *) PG_DETOAST_DATUM(PG_GETARG_DATUM(x))
 
@@ -949,6 +952,13 @@ tdigest_serial(PG_FUNCTION_ARGS)
 
 	state = (tdigest_aggstate_t *) PG_GETARG_POINTER(0);
 
+	/*
+	 * Only ship the compacted digest: The uncompacted buffer can be up to 10x the
+	 * compression, which would make the partial states sent by every parallel
+	 * worker or shard much larger than the digest they represent.
+	 */
+	tdigest_compact(state);
+
 	len = offsetof(tdigest_aggstate_t, percentiles) +
 		  state->npercentiles * sizeof(double) +
 		  state->nvalues * sizeof(double) +
@@ -1120,27 +1130,72 @@ tdigest_combine(PG_FUNCTION_ARGS)
 	dst = (tdigest_aggstate_t *) PG_GETARG_POINTER(0);
 
 	/*
-	 * Do a compaction on each digest, to make sure we have enough space.
-	 *
-	 * XXX Maybe do this only when necessary, i.e. when we can't fit the
-	 * data into the dst digest? Also, is it really ensured this gives us
-	 * enough free space?
+	 * Do a compaction on each digest, so that both are sorted and as small as
+	 * their compression allows.
 	 */
 	tdigest_compact(dst);
 	tdigest_compact(src);
 
-	/* copy the second part */
-	memcpy(&dst->centroids[dst->ncentroids],
-		   src->centroids,
-		   src->ncentroids * sizeof(centroid_t));
+	/*
+	 * Merge the two sorted centroid arrays in a single pass, the sort done by the
+	 * compaction then finds them already ordered. The merged centroids may not fit
+	 * into the buffer of dst, so they are compacted in a scratch digest first.
+	 */
+	int nmerged = dst->ncentroids + src->ncentroids;
+	centroid_t *merged = palloc(sizeof(centroid_t) * Max(nmerged, 1));
+	tdigest_merge_sorted(dst->centroids, dst->ncentroids,
+						 src->centroids, src->ncentroids, merged);
+
+	tdigest_aggstate_t scratch = *dst;
+	scratch.centroids = merged;
+	scratch.ncentroids = nmerged;
+	scratch.ncompacted = 0;
+	scratch.count = dst->count + src->count;
+	tdigest_compact(&scratch);
+
+	Assert(scratch.ncentroids < BUFFER_SIZE(dst->compression));
+	memcpy(dst->centroids, scratch.centroids,
+		   sizeof(centroid_t) * scratch.ncentroids);
+	dst->ncentroids = scratch.ncentroids;
+	dst->ncompacted = scratch.ncompacted;
+	dst->ncompactions = scratch.ncompactions;
+	dst->count = scratch.count;
+	pfree(merged);
 
-	dst->ncentroids += src->ncentroids;
-	dst->count += src->count;
+	PG_RETURN_POINTER(dst);
+}
 
-	/* mark the digest as not compacted */
-	dst->ncompacted = 0;
 
-	PG_RETURN_POINTER(dst);
+/*
+ * Merges two arrays of centroids sorted by centroid_cmp into result.
+ */
+static void
+tdigest_merge_sorted(const centroid_t *left, int nleft,
+					 const centroid_t *right, int nright, centroid_t *result)
+{
+	int i = 0, j = 0, k = 0;
+
+	while (i < nleft && j < nright)
+	{
+		if (centroid_cmp(&left[i], &right[j]) <= 0)
+		{
+			result[k++] = left[i++];
+		}
+		else
+		{
+			result[k++] = right[j++];
+		}
+	}
+
+	while (i < nleft)
+	{
+		result[k++] = left[i++];
+	}
+
+	while (j < nright)
+	{
+		result[k++] = right[j++];
+	}
 }
 
 
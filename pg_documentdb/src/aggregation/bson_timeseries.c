@@ -0,0 +1,520 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/aggregation/bson_timeseries.c
+ *
+ * Implementation of the $_internalUnpackBucket stage, which returns the
+ * measurements of the buckets of a time-series collection.
+ * See also commands/timeseries.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <miscadmin.h>
+#include <funcapi.h>
+#include <nodes/makefuncs.h>
+
+#include "io/bson_core.h"
+#include "commands/timeseries.h"
+#include "metadata/metadata_cache.h"
+#include "query/query_operator.h"
+#include "utils/documentdb_errors.h"
+#include "utils/feature_counter.h"
+
+#include "aggregation/bson_timeseries.h"
+
+extern bool EnableCollation;
+
+/*
+ * State of the bson_timeseries_unpack_bucket SRF for a single bucket.
+ */
+typedef struct TimeseriesUnpackState
+{
+	/* The iterator over the measurements of the bucket */
+	bson_iter_t dataIter;
+
+	/* The metaField added back to the measurements, NULL if none */
+	const char *metaField;
+
+	/* The meta value of the bucket, BSON_TYPE_EOD if it has none */
+	bson_value_t meta;
+} TimeseriesUnpackState;
+
+
+static void AppendTimeseriesBucketFilters(const bson_value_t *filter,
+										  const TimeseriesOptions *options,
+										  bool allowStringBounds,
+										  pgbson_array_writer *filtersWriter);
+static void AppendMeasurementBoundFilters(const char *field, const char *operator,
+										  const bson_value_t *operand,
+										  const TimeseriesOptions *options,
+										  bool allowStringBounds,
+										  pgbson_array_writer *filtersWriter);
+static void AppendMeasurementBoundFilter(const char *controlPath, const char *operator,
+										 const bson_value_t *operand,
+										 const char *typeName, bool isTimeField,
+										 pgbson_array_writer *filtersWriter);
+static bool IsTimeseriesBucketScan(Query *query,
+								   AggregationPipelineBuildContext *context);
+
+PG_FUNCTION_INFO_V1(bson_timeseries_unpack_bucket);
+
+
+/*
+ * bson_timeseries_unpack_bucket
+ *    Returns the measurements of a bucket of a time-series collection, one
+ * at a time, with the meta value of the bucket added back as their metaField.
+ *
+ * unpackSpec => The spec of the $_internalUnpackBucket stage
+ */
+Datum
+bson_timeseries_unpack_bucket(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *functionContext;
+	TimeseriesUnpackState *unpackState;
+
+	if (SRF_IS_FIRSTCALL())
+	{
+		functionContext = SRF_FIRSTCALL_INIT();
+		MemoryContext oldContext = MemoryContextSwitchTo(
+			functionContext->multi_call_memory_ctx);
+
+		pgbson *bucket = PG_GETARG_PGBSON(0);
+		pgbson *unpackSpec = PG_GETARG_PGBSON(1);
+
+		TimeseriesOptions options;
+		bool isCreateSpec = false;
+		bson_value_t specValue = ConvertPgbsonToBsonValue(unpackSpec);
+		ParseTimeseriesOptions(&specValue, "$_internalUnpackBucket", isCreateSpec,
+							   &options);
+
+		unpackState = palloc0(sizeof(TimeseriesUnpackState));
+		unpackState->metaField = options.metaField;
+
+		bson_iter_t bucketIter;
+		PgbsonInitIterator(bucket, &bucketIter);
+		while (bson_iter_next(&bucketIter))
+		{
+			const char *key = bson_iter_key(&bucketIter);
+			if (strcmp(key, TIMESERIES_BUCKET_META_FIELD) == 0)
+			{
+				unpackState->meta = *bson_iter_value(&bucketIter);
+			}
+			else if (strcmp(key, TIMESERIES_BUCKET_DATA_FIELD) == 0 &&
+					 BSON_ITER_HOLDS_ARRAY(&bucketIter))
+			{
+				bson_iter_recurse(&bucketIter, &unpackState->dataIter);
+			}
+		}
+
+		MemoryContextSwitchTo(oldContext);
+		functionContext->user_fctx = (void *) unpackState;
+	}
+
+	functionContext = SRF_PERCALL_SETUP();
+	unpackState = (TimeseriesUnpackState *) functionContext->user_fctx;
+
+	/* A bucket without data (e.g. written directly to the buckets) has no measurements */
+	while (unpackState->dataIter.raw != NULL && bson_iter_next(&unpackState->dataIter))
+	{
+		if (!BSON_ITER_HOLDS_DOCUMENT(&unpackState->dataIter))
+		{
+			continue;
+		}
+
+		if (unpackState->metaField == NULL ||
+			unpackState->meta.value_type == BSON_TYPE_EOD)
+		{
+			SRF_RETURN_NEXT(functionContext,
+							PointerGetDatum(PgbsonInitFromDocumentBsonValue(
+												bson_iter_value(&unpackState->dataIter))));
+		}
+
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+
+		bson_iter_t measurementIter;
+		bson_iter_recurse(&unpackState->dataIter, &measurementIter);
+		while (bson_iter_next(&measurementIter))
+		{
+			PgbsonWriterAppendIter(&writer, &measurementIter);
+		}
+
+		PgbsonWriterAppendValue(&writer, unpackState->metaField,
+								strlen(unpackState->metaField), &unpackState->meta);
+		SRF_RETURN_NEXT(functionContext, PointerGetDatum(PgbsonWriterGetPgbson(&writer)));
+	}
+
+	SRF_RETURN_DONE(functionContext);
+}
+
+
+/*
+ * Aggregation pipeline stage handler for `$_internalUnpackBucket`, the stage of
+ * the view of a time-series collection. The buckets are unpacked by an SRF:
+ *
+ * SELECT bson_timeseries_unpack_bucket(document, '<spec>') FROM <buckets>
+ *
+ * The measurements of a bucket are only built as they are returned. The query
+ * is kept in the context so that the $match that follows can prune its buckets.
+ */
+Query *
+HandleInternalUnpackBucket(const bson_value_t *existingValue, Query *query,
+						   AggregationPipelineBuildContext *context)
+{
+	ReportFeatureUsage(FEATURE_STAGE_INTERNAL_UNPACK_BUCKET);
+	if (existingValue->value_type != BSON_TYPE_DOCUMENT)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_FAILEDTOPARSE),
+						errmsg(
+							"The $_internalUnpackBucket specification must be an object, got %s",
+							BsonTypeName(existingValue->value_type))));
+	}
+
+	TimeseriesOptions *options = palloc0(sizeof(TimeseriesOptions));
+	bool isCreateSpec = false;
+	ParseTimeseriesOptions(existingValue, "$_internalUnpackBucket", isCreateSpec,
+						   options);
+
+	/* The first projector is the bucket document */
+	TargetEntry *firstEntry = linitial(query->targetList);
+	Expr *bucketDocument = firstEntry->expr;
+
+	Const *unpackSpec = MakeBsonConst(PgbsonInitFromDocumentBsonValue(existingValue));
+	FuncExpr *unpackExpr = makeFuncExpr(
+		BsonTimeseriesUnpackBucketFunctionOid(), BsonTypeId(),
+		list_make2(bucketDocument, unpackSpec), InvalidOid, InvalidOid,
+		COERCE_EXPLICIT_CALL);
+	unpackExpr->funcretset = true;
+
+	/* Filters on the bucket only prune it if they apply before the unpacking */
+	bool canPruneBuckets = query->limitCount == NULL && query->limitOffset == NULL &&
+						   !query->hasTargetSRFs && !query->hasAggs &&
+						   !query->hasWindowFuncs && query->groupClause == NIL &&
+						   query->distinctClause == NIL;
+
+	firstEntry->expr = (Expr *) unpackExpr;
+	query->hasTargetSRFs = true;
+
+	context->timeseriesBucketQuery = canPruneBuckets ? query : NULL;
+	context->timeseriesBucketDocument = bucketDocument;
+	context->timeseriesOptions = options;
+
+	/* Since this is an SRF, we need a child CTE if anyone comes after the unpack */
+	context->requiresSubQuery = true;
+	return query;
+}
+
+
+/*
+ * Adds the filters of a $match on the measurements unpacked from the buckets
+ * of a time-series collection to the bucket scan, so that the buckets none of
+ * whose measurements can match are skipped before they are unpacked:
+ *
+ *   - a filter on the metaField (or its subfields) becomes the same filter on
+ *     the meta field of the buckets.
+ *   - a comparison of a top level field with a number, date or string skips the
+ *     buckets whose control min/max are out of range. Buckets whose min/max
+ *     are of another type than the value are kept, as they may hold
+ *     measurements of mixed types or arrays.
+ *
+ * The $match is still applied to the unpacked measurements.
+ */
+void
+AddTimeseriesBucketFilters(const bson_value_t *matchValue, Query *query,
+						   AggregationPipelineBuildContext *context)
+{
+	if (context->timeseriesBucketQuery == NULL ||
+		matchValue->value_type != BSON_TYPE_DOCUMENT ||
+		!IsTimeseriesBucketScan(query, context))
+	{
+		return;
+	}
+
+	/* The control min/max are in binary order, which a collation may not follow */
+	bool allowStringBounds = !EnableCollation || context->collationString[0] == '\0';
+
+	pgbson_writer filterWriter;
+	PgbsonWriterInit(&filterWriter);
+
+	pgbson_array_writer filtersWriter;
+	PgbsonWriterStartArray(&filterWriter, "$and", 4, &filtersWriter);
+	AppendTimeseriesBucketFilters(matchValue, context->timeseriesOptions,
+								  allowStringBounds, &filtersWriter);
+	uint32_t filterCount = PgbsonArrayWriterGetIndex(&filtersWriter);
+	PgbsonWriterEndArray(&filterWriter, &filtersWriter);
+
+	if (filterCount == 0)
+	{
+		return;
+	}
+
+	BsonQueryOperatorContext filterContext = { 0 };
+	filterContext.documentExpr = context->timeseriesBucketDocument;
+	filterContext.inputType = MongoQueryOperatorInputType_Bson;
+	filterContext.simplifyOperators = true;
+	filterContext.coerceOperatorExprIfApplicable = true;
+	filterContext.variableContext = context->variableSpec;
+
+	if (EnableCollation)
+	{
+		filterContext.collationString = context->collationString;
+	}
+
+	bson_iter_t filterIter;
+	PgbsonWriterGetIterator(&filterWriter, &filterIter);
+	List *quals = CreateQualsFromQueryDocIterator(&filterIter, &filterContext);
+
+	Query *bucketQuery = context->timeseriesBucketQuery;
+	if (bucketQuery->jointree->quals != NULL)
+	{
+		quals = lappend(quals, bucketQuery->jointree->quals);
+	}
+
+	bucketQuery->jointree->quals = (Node *) make_ands_explicit(quals);
+}
+
+
+/*
+ * Whether the query returns the measurements of the bucket scan as they are
+ * unpacked, i.e. it is the subquery wrapping the bucket scan and no stage
+ * changed the measurements since.
+ */
+static bool
+IsTimeseriesBucketScan(Query *query, AggregationPipelineBuildContext *context)
+{
+	if (list_length(query->rtable) != 1 || query->limitCount != NULL ||
+		query->limitOffset != NULL || query->hasTargetSRFs || query->hasAggs ||
+		query->groupClause != NIL)
+	{
+		return false;
+	}
+
+	RangeTblEntry *rte = linitial(query->rtable);
+	if (rte->rtekind != RTE_SUBQUERY || rte->subquery != context->timeseriesBucketQuery)
+	{
+		return false;
+	}
+
+	TargetEntry *entry = linitial(query->targetList);
+	if (!IsA(entry->expr, Var))
+	{
+		return false;
+	}
+
+	Var *documentVar = (Var *) entry->expr;
+	return documentVar->varno == 1 && documentVar->varattno == 1 &&
+		   documentVar->varlevelsup == 0;
+}
+
+
+/*
+ * Writes the bucket filters of the $match filter to the filters array.
+ */
+static void
+AppendTimeseriesBucketFilters(const bson_value_t *filter,
+							  const TimeseriesOptions *options, bool allowStringBounds,
+							  pgbson_array_writer *filtersWriter)
+{
+	size_t metaFieldLength = options->metaField != NULL ? strlen(options->metaField) :
+							 0;
+
+	bson_iter_t filterIter;
+	BsonValueInitIterator(filter, &filterIter);
+	while (bson_iter_next(&filterIter))
+	{
+		const char *key = bson_iter_key(&filterIter);
+		const bson_value_t *value = bson_iter_value(&filterIter);
+
+		if (strcmp(key, "$and") == 0 && value->value_type == BSON_TYPE_ARRAY)
+		{
+			bson_iter_t clauseIter;
+			BsonValueInitIterator(value, &clauseIter);
+			while (bson_iter_next(&clauseIter))
+			{
+				if (BSON_ITER_HOLDS_DOCUMENT(&clauseIter))
+				{
+					AppendTimeseriesBucketFilters(bson_iter_value(&clauseIter), options,
+												  allowStringBounds, filtersWriter);
+				}
+			}
+
+			continue;
+		}
+
+		if (key[0] == '$')
+		{
+			/* Other logical operators and $expr don't prune the buckets */
+			continue;
+		}
+
+		if (metaFieldLength > 0 &&
+			strncmp(key, options->metaField, metaFieldLength) == 0 &&
+			(key[metaFieldLength] == '\0' || key[metaFieldLength] == '.'))
+		{
+			/* The meta value of a bucket is the metaField of all its measurements */
+			pgbson_writer metaFilterWriter;
+			PgbsonArrayWriterStartDocument(filtersWriter, &metaFilterWriter);
+			PgbsonWriterAppendValue(&metaFilterWriter,
+									psprintf("%s%s", TIMESERIES_BUCKET_META_FIELD,
+											 key + metaFieldLength), -1, value);
+			PgbsonArrayWriterEndDocument(filtersWriter, &metaFilterWriter);
+			continue;
+		}
+
+		if (strchr(key, '.') != NULL)
+		{
+			/* The control min/max are of the top level fields only */
+			continue;
+		}
+
+		if (value->value_type != BSON_TYPE_DOCUMENT)
+		{
+			AppendMeasurementBoundFilters(key, "$eq", value, options, allowStringBounds,
+										  filtersWriter);
+			continue;
+		}
+
+		/* Only the operators of the field are bounds, a document is an equality */
+		bson_iter_t operatorIter;
+		BsonValueInitIterator(value, &operatorIter);
+		bool isOperatorDocument = true;
+		while (bson_iter_next(&operatorIter))
+		{
+			isOperatorDocument = isOperatorDocument &&
+								 bson_iter_key(&operatorIter)[0] == '$';
+		}
+
+		if (!isOperatorDocument)
+		{
+			continue;
+		}
+
+		BsonValueInitIterator(value, &operatorIter);
+		while (bson_iter_next(&operatorIter))
+		{
+			AppendMeasurementBoundFilters(key, bson_iter_key(&operatorIter),
+										  bson_iter_value(&operatorIter), options,
+										  allowStringBounds, filtersWriter);
+		}
+	}
+}
+
+
+/*
+ * Writes the bucket filters of the comparison of the field with the operand:
+ * the buckets whose min (for $lt/$lte) or max (for $gt/$gte) can't satisfy it
+ * are skipped, $eq checks both.
+ */
+static void
+AppendMeasurementBoundFilters(const char *field, const char *operator,
+							  const bson_value_t *operand,
+							  const TimeseriesOptions *options, bool allowStringBounds,
+							  pgbson_array_writer *filtersWriter)
+{
+	const char *typeName;
+	if (BsonTypeIsNumber(operand->value_type))
+	{
+		typeName = "number";
+	}
+	else if (operand->value_type == BSON_TYPE_DATE_TIME)
+	{
+		typeName = "date";
+	}
+	else if (operand->value_type == BSON_TYPE_UTF8 && allowStringBounds)
+	{
+		typeName = "string";
+	}
+	else
+	{
+		return;
+	}
+
+	/* Every measurement has a date in the timeField, so its min/max are dates */
+	bool isTimeField = strcmp(field, options->timeField) == 0;
+
+	bool boundsMin = strcmp(operator, "$lt") == 0 || strcmp(operator, "$lte") == 0 ||
+					 strcmp(operator, "$eq") == 0;
+	bool boundsMax = strcmp(operator, "$gt") == 0 || strcmp(operator, "$gte") == 0 ||
+					 strcmp(operator, "$eq") == 0;
+
+	if (boundsMin)
+	{
+		AppendMeasurementBoundFilter(psprintf("control.min.%s", field),
+									 strcmp(operator, "$lt") == 0 ? "$lt" : "$lte",
+									 operand, typeName, isTimeField, filtersWriter);
+	}
+
+	if (boundsMax)
+	{
+		AppendMeasurementBoundFilter(psprintf("control.max.%s", field),
+									 strcmp(operator, "$gt") == 0 ? "$gt" : "$gte",
+									 operand, typeName, isTimeField, filtersWriter);
+	}
+}
+
+
+/*
+ * Writes the filter on a control min/max of the buckets:
+ *
+ *   { "$or": [ { <controlPath>: { <operator>: <operand> } },
+ *              { "control.min.<field>": { "$not": { "$type": <type> } } },
+ *              { "control.max.<field>": { "$not": { "$type": <type> } } } ] }
+ *
+ * When the min and max of a bucket are of the type of the operand, all its
+ * values are (the types sort before or after each other), so the bound is
+ * exact. Otherwise the bucket is kept.
+ */
+static void
+AppendMeasurementBoundFilter(const char *controlPath, const char *operator,
+							 const bson_value_t *operand, const char *typeName,
+							 bool isTimeField, pgbson_array_writer *filtersWriter)
+{
+	pgbson_writer boundFilterWriter;
+	PgbsonArrayWriterStartDocument(filtersWriter, &boundFilterWriter);
+
+	if (isTimeField && strcmp(typeName, "date") == 0)
+	{
+		pgbson_writer operatorWriter;
+		PgbsonWriterStartDocument(&boundFilterWriter, controlPath, -1, &operatorWriter);
+		PgbsonWriterAppendValue(&operatorWriter, operator, strlen(operator), operand);
+		PgbsonWriterEndDocument(&boundFilterWriter, &operatorWriter);
+		PgbsonArrayWriterEndDocument(filtersWriter, &boundFilterWriter);
+		return;
+	}
+
+	/* "control.min." and "control.max." have the same length */
+	const char *field = controlPath + strlen("control.min.");
+
+	pgbson_array_writer orWriter;
+	PgbsonWriterStartArray(&boundFilterWriter, "$or", 3, &orWriter);
+
+	pgbson_writer clauseWriter;
+	pgbson_writer operatorWriter;
+	PgbsonArrayWriterStartDocument(&orWriter, &clauseWriter);
+	PgbsonWriterStartDocument(&clauseWriter, controlPath, -1, &operatorWriter);
+	PgbsonWriterAppendValue(&operatorWriter, operator, strlen(operator), operand);
+	PgbsonWriterEndDocument(&clauseWriter, &operatorWriter);
+	PgbsonArrayWriterEndDocument(&orWriter, &clauseWriter);
+
+	const char *boundPaths[2] = {
+		psprintf("control.min.%s", field), psprintf("control.max.%s", field)
+	};
+	for (int i = 0; i < 2; i++)
+	{
+		PgbsonArrayWriterStartDocument(&orWriter, &clauseWriter);
+		PgbsonWriterStartDocument(&clauseWriter, boundPaths[i], -1, &operatorWriter);
+
+		pgbson_writer typeWriter;
+		PgbsonWriterStartDocument(&operatorWriter, "$not", 4, &typeWriter);
+		PgbsonWriterAppendUtf8(&typeWriter, "$type", 5, typeName);
+		PgbsonWriterEndDocument(&operatorWriter, &typeWriter);
+
+		PgbsonWriterEndDocument(&clauseWriter, &operatorWriter);
+		PgbsonArrayWriterEndDocument(&orWriter, &clauseWriter);
+	}
+
+	PgbsonWriterEndArray(&boundFilterWriter, &orWriter);
+	PgbsonArrayWriterEndDocument(filtersWriter, &boundFilterWriter);
+}
@@ -10,6 +10,8 @@
 #include <postgres.h>
 #include <lib/stringinfo.h>
 #include <miscadmin.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
 
 #define BSON_TREE_PRIVATE
 #include "aggregation/bson_tree.h"
@@ -17,9 +19,31 @@
 #undef BSON_TREE_PRIVATE
 
 #include "io/bson_core.h"
+#include "utils/hashset_utils.h"
 
 #include "aggregation/bson_projection_tree.h"
 
+/*
+ * The number of children of a node above which the children are indexed by
+ * their field. Below it the linked list is as fast to walk as a hash probe.
+ */
+#define BSON_TREE_CHILD_INDEX_THRESHOLD 16
+
+/*
+ * Entry of the child index of a node: the child with the field, and the child
+ * before it in the linked list (NULL for the first child) so that the child can
+ * be replaced without walking the list.
+ */
+typedef struct ChildNodeIndexEntry
+{
+	/* key for hash entry; should be the first field */
+	StringView field;
+
+	BsonPathNode *node;
+
+	BsonPathNode *previousNode;
+} ChildNodeIndexEntry;
+
 static BsonLeafPathNode * GetOrAddLeafArrayChildNode(BsonLeafArrayWithFieldPathNode *tree,
 													 const char *relativePath,
 													 const StringView *fieldPath,
@@ -50,6 +74,14 @@ static BsonPathNode * TraverseDottedPathAndGetOrAddNodeCore(const StringView *pa
 															bool *nodeCreated,
 															ParseAggregationExpressionContext
 															*parseContext);
+static BsonPathNode * FindChildNode(ChildNodeData *childData,
+									const StringView *fieldPath,
+									BsonPathNode **previousNode);
+static void BuildChildNodeIndex(ChildNodeData *childData);
+static void AddChildNodeIndexEntry(ChildNodeData *childData, BsonPathNode *childNode,
+								   BsonPathNode *previousNode);
+static uint32 ChildNodeIndexHashFunc(const void *obj, Size objsize);
+static int ChildNodeIndexCompareFunc(const void *obj1, const void *obj2, Size objsize);
 static void FreeBsonPathNode(BsonPathNode *node);
 static void FreeLeafWithArrayFieldNodes(BsonLeafArrayWithFieldPathNode *leafArrayNode);
 
@@ -567,6 +599,11 @@ ValidateAndSetLeafNodeData(BsonPathNode *childNode, const bson_value_t *value,
 		leafPathNode->fieldData.kind = AggregationExpressionKind_Constant;
 		leafPathNode->fieldData.value = *value;
 	}
+	else if (parseContext != NULL && parseContext->shareRepeatedExpressions)
+	{
+		ParseSharedAggregationExpressionData(&leafPathNode->fieldData, value,
+											 parseContext);
+	}
 	else
 	{
 		ParseAggregationExpressionData(&leafPathNode->fieldData, value, parseContext);
@@ -626,19 +663,10 @@ GetOrAddChildNode(BsonIntermediatePathNode *tree, const char *relativePath,
 				  NodeType childNodeType, bool replaceExistingNodes,
 				  void *nodeCreationState, bool *alreadyExists)
 {
-	BsonPathNode *childNode;
 	BsonPathNode *previousChild = NULL;
-	bool found = false;
-	foreach_child(childNode, tree)
-	{
-		if (StringViewEquals(&childNode->field, fieldPath))
-		{
-			found = true;
-			break;
-		}
-
-		previousChild = childNode;
-	}
+	BsonPathNode *childNode = FindChildNode(&tree->childData, fieldPath,
+											&previousChild);
+	bool found = childNode != NULL;
 
 	if (alreadyExists)
 	{
@@ -691,6 +719,8 @@ GetOrAddChildNode(BsonIntermediatePathNode *tree, const char *relativePath,
 void
 AddChildToTree(ChildNodeData *childData, BsonPathNode *childNode)
 {
+	BsonPathNode *previousTail = childData->children;
+
 	/* fix-up the tree's child */
 	if (childData->children == NULL)
 	{
@@ -717,6 +747,15 @@ AddChildToTree(ChildNodeData *childData, BsonPathNode *childNode)
 	}
 
 	childData->numChildren++;
+
+	if (childData->childIndex != NULL)
+	{
+		AddChildNodeIndexEntry(childData, childNode, previousTail);
+	}
+	else if (childData->numChildren > BSON_TREE_CHILD_INDEX_THRESHOLD)
+	{
+		BuildChildNodeIndex(childData);
+	}
 }
 
 
@@ -768,6 +807,24 @@ ReplaceTreeInNodeCore(BsonPathNode *previousNode, BsonPathNode *baseNode,
 			baseNode->parent->childData.children = newNode;
 		}
 	}
+
+	/* Point the index at the new node, and its successor's entry back at it */
+	ChildNodeData *childData = &baseNode->parent->childData;
+	if (childData->childIndex != NULL)
+	{
+		AddChildNodeIndexEntry(childData, newNode, previousNode);
+		if (newNode != childData->children)
+		{
+			bool found = false;
+			ChildNodeIndexEntry *nextEntry = hash_search(childData->childIndex,
+														 &newNode->next->field,
+														 HASH_FIND, &found);
+			if (found)
+			{
+				nextEntry->previousNode = newNode;
+			}
+		}
+	}
 }
 
 
@@ -815,6 +872,12 @@ FreeTree(BsonIntermediatePathNode *root)
 	}
 
 	FreeBsonPathNode(previousNode);
+
+	if (root->childData.childIndex != NULL)
+	{
+		hash_destroy(root->childData.childIndex);
+	}
+
 	pfree(root);
 }
 
@@ -888,6 +951,11 @@ FreeLeafWithArrayFieldNodes(BsonLeafArrayWithFieldPathNode *leafArrayNode)
 		pfree(previousNode);
 	}
 
+	if (leafArrayNode->arrayChild.childIndex != NULL)
+	{
+		hash_destroy(leafArrayNode->arrayChild.childIndex);
+	}
+
 	pfree(leafArrayNode);
 }
 
@@ -917,24 +985,11 @@ ResetNodeWithValueOrField(const BsonLeafPathNode *baseLeafNode, const char *rela
 	ValidateAndSetLeafNodeData(leafPathNode, value, &baseNode->field,
 							   treatLeafDataAsConstant, parseContext);
 
-	/* now fix up the child nodes */
+	/* now fix up the child nodes: Find the previous node to the node asked for */
 	BsonPathNode *previousNode = NULL;
-	BsonPathNode *currentNode;
-
-	/* Find the previous node to the node asked for */
-	bool found = false;
-	foreach_child(currentNode, baseNode->parent)
-	{
-		if (currentNode == baseNode)
-		{
-			found = true;
-			break;
-		}
-
-		previousNode = currentNode;
-	}
-
-	if (!found)
+	BsonPathNode *currentNode = FindChildNode(&baseNode->parent->childData,
+											  &baseNode->field, &previousNode);
+	if (currentNode != baseNode)
 	{
 		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR), errmsg(
 							"Unable to find base node in projection tree's children")));
@@ -994,18 +1049,11 @@ GetOrAddLeafArrayChildNode(BsonLeafArrayWithFieldPathNode *tree, const char *rel
 						   const StringView *fieldPath, CreateLeafNodeFunc createFunc,
 						   NodeType childNodeType)
 {
-	BsonLeafPathNode *childNode;
-	bool found = false;
-	foreach_array_child(childNode, tree)
-	{
-		if (StringViewEquals(&childNode->baseNode.field, fieldPath))
-		{
-			found = true;
-			break;
-		}
-	}
-
-	if (!found)
+	BsonPathNode *previousNode = NULL;
+	BsonLeafPathNode *childNode = (BsonLeafPathNode *) FindChildNode(&tree->arrayChild,
+																	 fieldPath,
+																	 &previousNode);
+	if (childNode == NULL)
 	{
 		void *nodeState = NULL;
 		childNode = createFunc(fieldPath, relativePath, nodeState);
@@ -1018,6 +1066,118 @@ GetOrAddLeafArrayChildNode(BsonLeafArrayWithFieldPathNode *tree, const char *rel
 }
 
 
+/*
+ * Finds the child with the given field of a node, using the child index if the
+ * node has one. Also sets previousNode to the child before it in the linked
+ * list (NULL for the first child). Returns NULL if there is no such child.
+ */
+static BsonPathNode *
+FindChildNode(ChildNodeData *childData, const StringView *fieldPath,
+			  BsonPathNode **previousNode)
+{
+	*previousNode = NULL;
+	if (childData->childIndex != NULL)
+	{
+		bool found = false;
+		ChildNodeIndexEntry *entry = hash_search(childData->childIndex, fieldPath,
+												 HASH_FIND, &found);
+		if (!found)
+		{
+			return NULL;
+		}
+
+		*previousNode = entry->previousNode;
+		return entry->node;
+	}
+
+	BsonPathNode *childNode = childData->children == NULL ? NULL :
+							  childData->children->next;
+	for (uint32_t i = 0; i < childData->numChildren; i++)
+	{
+		if (StringViewEquals(&childNode->field, fieldPath))
+		{
+			return childNode;
+		}
+
+		*previousNode = childNode;
+		childNode = childNode->next;
+	}
+
+	*previousNode = NULL;
+	return NULL;
+}
+
+
+/*
+ * Builds the child index of a node from its current children. The index is
+ * allocated with the nodes of the tree, so it lives as long as the tree does.
+ */
+static void
+BuildChildNodeIndex(ChildNodeData *childData)
+{
+	MemoryContext oldContext = MemoryContextSwitchTo(
+		GetMemoryChunkContext(childData->children));
+	HASHCTL hashInfo = CreateExtensionHashCTL(sizeof(StringView),
+											  sizeof(ChildNodeIndexEntry),
+											  ChildNodeIndexCompareFunc,
+											  ChildNodeIndexHashFunc);
+	childData->childIndex = hash_create("Bson tree child index",
+										childData->numChildren * 2, &hashInfo,
+										DefaultExtensionHashFlags);
+	MemoryContextSwitchTo(oldContext);
+
+	BsonPathNode *previousNode = NULL;
+	BsonPathNode *childNode = childData->children->next;
+	for (uint32_t i = 0; i < childData->numChildren; i++)
+	{
+		AddChildNodeIndexEntry(childData, childNode, previousNode);
+		previousNode = childNode;
+		childNode = childNode->next;
+	}
+}
+
+
+/*
+ * Adds (or repoints) the entry of a child in the child index of a node.
+ */
+static void
+AddChildNodeIndexEntry(ChildNodeData *childData, BsonPathNode *childNode,
+					   BsonPathNode *previousNode)
+{
+	bool found = false;
+	ChildNodeIndexEntry *entry = hash_search(childData->childIndex, &childNode->field,
+											 HASH_ENTER, &found);
+	entry->field = childNode->field;
+	entry->node = childNode;
+	entry->previousNode = previousNode;
+}
+
+
+/*
+ * ChildNodeIndexHashFunc is the (HASHCTL.hash) callback used to hash the
+ * entries of the child index based on the field.
+ */
+static uint32
+ChildNodeIndexHashFunc(const void *obj, Size objsize)
+{
+	const StringView *field = obj;
+	return HashStringView(field);
+}
+
+
+/*
+ * ChildNodeIndexCompareFunc is the (HASHCTL.match) callback used to compare
+ * the fields of two entries of the child index.
+ */
+static int
+ChildNodeIndexCompareFunc(const void *obj1, const void *obj2, Size objsize)
+{
+	const StringView *field1 = obj1;
+	const StringView *field2 = obj2;
+	return CompareStringView(field1, field2);
+}
+
+
 /*
  * Method that creates a BsonLeafArrayWithFieldPathNode node.
  */
@@ -9,6 +9,7 @@
  */
 
 #include <postgres.h>
+#include <funcapi.h>
 
 #include "aggregation/bson_project.h"
 #include "aggregation/bson_projection_tree.h"
@@ -29,14 +30,63 @@ typedef struct DistinctTraverseState
 	TupleDesc tupleDescriptor;
 } DistinctTraverseState;
 
+/*
+ * State of a $unwind of a document across the calls of the set returning
+ * function: The elements of the array are unwound one per call, and what
+ * the output documents have in common is prepared once for the document.
+ */
+typedef struct UnwindArrayState
+{
+	/* The source document */
+	pgbson *document;
+
+	/* The path being unwound (without the $ prefix) */
+	char *path;
+
+	/* optional name for the index field to be added */
+	char *indexFieldName;
+
+	/* Whether to keep an empty array at the path */
+	bool preserveNullAndEmpty;
+
+	/* The single output of the document when its path does not hold an array */
+	bool hasPendingResult;
+	Datum pendingResult;
+
+	/* Iterator over the remaining elements of the array at the path */
+	bool hasArray;
+	bson_iter_t arrayIter;
+
+	/* The index of the next element of the array */
+	long index;
+
+	/*
+	 * For top level paths: The fields of the document before and after the
+	 * path, which the output documents are written from around the element.
+	 * NULL otherwise.
+	 */
+	pgbson *leadingFields;
+	pgbson *trailingFields;
+
+	/*
+	 * Otherwise, the addFields tree producing the output documents, built
+	 * once: Only the constants of its leaves change between elements.
+	 */
+	BsonIntermediatePathNode *projectionTree;
+	BsonLeafPathNode *elementLeaf;
+	BsonLeafPathNode *indexLeaf;
+} UnwindArrayState;
+
 
 static pgbson * BsonUnwindElement(pgbson *document, char *path, char *indexFieldName,
 								  long index, const bson_value_t *element);
 static pgbson * BsonUnwindEmptyArray(pgbson *document, char *path, char *indexFieldName);
-static Datum BsonUnwindArray(PG_FUNCTION_ARGS, Tuplestorestate *tupleState,
-							 TupleDesc *tupleDescriptor,
-							 char *path, char *indexFieldName, bool
-							 preserveNullAndEmpty);
+static void InitUnwindArrayState(PG_FUNCTION_ARGS, char *path, char *indexFieldName,
+								 bool preserveNullAndEmpty);
+static Datum BsonUnwindArrayNext(PG_FUNCTION_ARGS);
+static void PrepareUnwindArrayElements(UnwindArrayState *state);
+static pgbson * BsonUnwindArrayElement(UnwindArrayState *state,
+									   const bson_value_t *element);
 static bool DistinctContinueProcessIntermediateArray(void *state, const
 													 bson_value_t *value, bool
 													 isArrayIndexSearch);
@@ -69,6 +119,11 @@ PG_FUNCTION_INFO_V1(bson_lookup_unwind);
 Datum
 bson_dollar_unwind_with_options(PG_FUNCTION_ARGS)
 {
+	if (!SRF_IS_FIRSTCALL())
+	{
+		return BsonUnwindArrayNext(fcinfo);
+	}
+
 	pgbson *spec = PG_GETARG_PGBSON_PACKED(1);
 
 	char *path = NULL;
@@ -123,11 +178,8 @@ bson_dollar_unwind_with_options(PG_FUNCTION_ARGS)
 							"$unwind requires a path")));
 	}
 
-	TupleDesc descriptor;
-	Tuplestorestate *tupleStore = SetupBsonTuplestore(fcinfo, &descriptor);
-
-	return BsonUnwindArray(fcinfo, tupleStore, &descriptor, path, indexFieldName,
-						   preserveNullAndEmpty);
+	InitUnwindArrayState(fcinfo, path, indexFieldName, preserveNullAndEmpty);
+	return BsonUnwindArrayNext(fcinfo);
 }
 
 
@@ -141,15 +193,15 @@ bson_dollar_unwind_with_options(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_unwind(PG_FUNCTION_ARGS)
 {
-	char *indexFieldName = NULL;
-	bool preserveNullAndEmpty = false;
-
-	TupleDesc descriptor;
-	Tuplestorestate *tupleStore = SetupBsonTuplestore(fcinfo, &descriptor);
+	if (SRF_IS_FIRSTCALL())
+	{
+		char *indexFieldName = NULL;
+		bool preserveNullAndEmpty = false;
+		InitUnwindArrayState(fcinfo, text_to_cstring(PG_GETARG_TEXT_PP(1)),
+							 indexFieldName, preserveNullAndEmpty);
+	}
 
-	return BsonUnwindArray(fcinfo, tupleStore, &descriptor, text_to_cstring(
-							   PG_GETARG_TEXT_PP(1)), indexFieldName,
-						   preserveNullAndEmpty);
+	return BsonUnwindArrayNext(fcinfo);
 }
 
 
@@ -245,20 +297,18 @@ bson_lookup_unwind(PG_FUNCTION_ARGS)
 /* --------------------------------------------------------- */
 
 /*
- * BsonUnwindArray is the internal implementation of $unwind as a set returning function
+ * InitUnwindArrayState sets up the unwind of the document on the first call
+ * of $unwind as a set returning function (one output document per call)
  *      path -> The path to be unwound
  *      indexFieldName -> optional string to add the index in the output document
  *      preserveNullAndEmpty -> whether to keep null and empty unwind values
  *
  *  PG_FUNCTION_ARGS contains the document
  */
-static Datum
-BsonUnwindArray(PG_FUNCTION_ARGS, Tuplestorestate *tupleStore, TupleDesc *tupleDescriptor,
-				char *path, char *indexFieldName, bool
-				preserveNullAndEmpty)
+static void
+InitUnwindArrayState(PG_FUNCTION_ARGS, char *path, char *indexFieldName,
+					 bool preserveNullAndEmpty)
 {
-	pgbson *document = PG_GETARG_PGBSON_PACKED(0);
-
 	/* Strip the $ prefix from the path */
 	if (strlen(path) <= 1)
 	{
@@ -271,11 +321,21 @@ BsonUnwindArray(PG_FUNCTION_ARGS, Tuplestorestate *tupleStore, TupleDesc *tupleD
 		ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE), errmsg(
 							"$unwind path must be prefixed by $")));
 	}
-	path = path + 1;
+
+	FuncCallContext *functionContext = SRF_FIRSTCALL_INIT();
+	MemoryContext oldContext = MemoryContextSwitchTo(
+		functionContext->multi_call_memory_ctx);
+
+	UnwindArrayState *state = palloc0(sizeof(UnwindArrayState));
+	state->document = PG_GETARG_PGBSON_PACKED(0);
+	state->path = pstrdup(path + 1);
+	state->indexFieldName = indexFieldName != NULL ? pstrdup(indexFieldName) : NULL;
+	state->preserveNullAndEmpty = preserveNullAndEmpty;
+	functionContext->user_fctx = state;
 
 	/* Start the iterator at the provided path */
 	bson_iter_t documentIterator;
-	if (!PgbsonInitIteratorAtPath(document, path, &documentIterator))
+	if (!PgbsonInitIteratorAtPath(state->document, state->path, &documentIterator))
 	{
 		/* No field was found, return no results on this document */
 		if (preserveNullAndEmpty)
@@ -283,106 +343,233 @@ BsonUnwindArray(PG_FUNCTION_ARGS, Tuplestorestate *tupleStore, TupleDesc *tupleD
 			/* undefined elements are preserved */
 			bson_value_t element;
 			element.value_type = BSON_TYPE_EOD;
-			Datum values[1];
-			bool isNull = false;
-
-			values[0] = PointerGetDatum(BsonUnwindElement(document,
-														  path,
-														  indexFieldName,
-														  -1,
-														  &element));
-			tuplestore_putvalues(tupleStore, *tupleDescriptor, values, &isNull);
+			state->hasPendingResult = true;
+			state->pendingResult = PointerGetDatum(BsonUnwindElement(
+													   state->document, state->path,
+													   state->indexFieldName, -1,
+													   &element));
 		}
-
-		PG_FREE_IF_COPY(document, 0);
-		PG_RETURN_VOID();
 	}
-
-	if (!BSON_ITER_HOLDS_ARRAY(&documentIterator))
+	else if (!BSON_ITER_HOLDS_ARRAY(&documentIterator))
 	{
 		if (!BSON_ITER_HOLDS_NULL(&documentIterator))
 		{
 			/* Single non-null elements are always preserved */
-			Datum values[1];
-			bool nulls[1];
-
+			state->hasPendingResult = true;
 			if (indexFieldName == NULL)
 			{
 				/* This is just the source doc */
-				values[0] = PG_GETARG_DATUM(0);
+				state->pendingResult = PointerGetDatum(state->document);
 			}
 			else
 			{
 				const bson_value_t *element = bson_iter_value(&documentIterator);
-				values[0] = PointerGetDatum(BsonUnwindElement(document,
-															  path,
-															  indexFieldName,
-															  -1,
-															  element));
+				state->pendingResult = PointerGetDatum(BsonUnwindElement(
+														   state->document,
+														   state->path,
+														   state->indexFieldName,
+														   -1, element));
 			}
-
-			nulls[0] = false;
-
-			tuplestore_putvalues(tupleStore, *tupleDescriptor, values, nulls);
 		}
 		else if (preserveNullAndEmpty)
 		{
 			/* Nulls are persisted if the document is preserved in the output */
 			bson_value_t element;
 			element.value_type = BSON_TYPE_NULL;
-			Datum values[1];
-			bool isNull = false;
-
-			values[0] = PointerGetDatum(BsonUnwindElement(document,
-														  path,
-														  indexFieldName,
-														  -1,
-														  &element));
-			tuplestore_putvalues(tupleStore, *tupleDescriptor, values, &isNull);
+			state->hasPendingResult = true;
+			state->pendingResult = PointerGetDatum(BsonUnwindElement(
+													   state->document, state->path,
+													   state->indexFieldName, -1,
+													   &element));
+		}
+	}
+	else
+	{
+		/* If the target path is an array, recurse into it */
+		bson_iter_recurse(&documentIterator, &state->arrayIter);
+		state->hasArray = true;
+		PrepareUnwindArrayElements(state);
+	}
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+/*
+ * BsonUnwindArrayNext returns the next output document of the unwind set up by
+ * InitUnwindArrayState. The elements of the array are unwound lazily, one per
+ * call, so only the output document being returned is alive at any time.
+ */
+static Datum
+BsonUnwindArrayNext(PG_FUNCTION_ARGS)
+{
+	FuncCallContext *functionContext = SRF_PERCALL_SETUP();
+	UnwindArrayState *state = (UnwindArrayState *) functionContext->user_fctx;
+
+	if (state->hasPendingResult)
+	{
+		state->hasPendingResult = false;
+		SRF_RETURN_NEXT(functionContext, state->pendingResult);
+	}
+
+	if (state->hasArray)
+	{
+		if (bson_iter_next(&state->arrayIter))
+		{
+			/* Project normal array elements and single non-null elements */
+			pgbson *result = BsonUnwindArrayElement(state,
+													bson_iter_value(&state->arrayIter));
+			state->index++;
+			SRF_RETURN_NEXT(functionContext, PointerGetDatum(result));
 		}
 
-		PG_FREE_IF_COPY(document, 0);
-		PG_RETURN_VOID();
+		state->hasArray = false;
+		if (state->index == 0 && state->preserveNullAndEmpty)
+		{
+			/* Empty arrays are removed if the document is preserved in the output */
+			SRF_RETURN_NEXT(functionContext, PointerGetDatum(
+								BsonUnwindEmptyArray(state->document, state->path,
+													 state->indexFieldName)));
+		}
 	}
 
-	bson_iter_t childIterator;
+	SRF_RETURN_DONE(functionContext);
+}
 
-	/* If the target path is an array, recurse into it */
-	bson_iter_recurse(&documentIterator, &childIterator);
 
-	long index = 0;
-	while (bson_iter_next(&childIterator))
+/*
+ * Prepares what the output documents of the elements of the array at the path
+ * have in common (see BsonUnwindElement for the shape of the output).
+ *
+ * For a top level path (and index field that's not in the document), an output
+ * document is the fields before the path, the element and the fields after the
+ * path (then the index): These fields are written out once here and copied as is
+ * for every element. Otherwise, the addFields tree for the output is built once
+ * and only its constants are replaced per element.
+ */
+static void
+PrepareUnwindArrayElements(UnwindArrayState *state)
+{
+	bool isTopLevelPath = strchr(state->path, '.') == NULL &&
+						  (state->indexFieldName == NULL ||
+						   (strchr(state->indexFieldName, '.') == NULL &&
+							strcmp(state->indexFieldName, state->path) != 0));
+
+	if (isTopLevelPath)
 	{
-		/* Project normal array elements and single non-null elements */
-		const bson_value_t *element = bson_iter_value(&childIterator);
+		pgbson_writer leadingWriter;
+		pgbson_writer trailingWriter;
+		PgbsonWriterInit(&leadingWriter);
+		PgbsonWriterInit(&trailingWriter);
+
+		bool isPathFound = false;
+		bson_iter_t documentIterator;
+		PgbsonInitIterator(state->document, &documentIterator);
+		while (bson_iter_next(&documentIterator))
+		{
+			const char *key = bson_iter_key(&documentIterator);
+			uint32_t keyLength = bson_iter_key_len(&documentIterator);
+			if (!isPathFound && strcmp(key, state->path) == 0)
+			{
+				isPathFound = true;
+				continue;
+			}
 
-		pgbson *result = BsonUnwindElement(document, path, indexFieldName, index,
-										   element);
+			if (state->indexFieldName != NULL &&
+				strcmp(key, state->indexFieldName) == 0)
+			{
+				/* The index replaces the existing field in place */
+				isTopLevelPath = false;
+				break;
+			}
 
-		Datum values[1];
-		bool nulls[1];
+			PgbsonWriterAppendValue(isPathFound ? &trailingWriter : &leadingWriter,
+									key, keyLength, bson_iter_value(&documentIterator));
+		}
 
-		values[0] = PointerGetDatum(result);
-		nulls[0] = false;
-		tuplestore_putvalues(tupleStore, *tupleDescriptor, values, nulls);
+		if (isTopLevelPath)
+		{
+			state->leadingFields = PgbsonWriterGetPgbson(&leadingWriter);
+			state->trailingFields = PgbsonWriterGetPgbson(&trailingWriter);
+			return;
+		}
+	}
 
-		index++;
+	/* unwound elements come from arrays in documents which will already be evaluated in a previous stage or directly from a collection, */
+	/* so we can safely treat the values as constants and no need to pay the cost to parse them as expressions. */
+	bool treatLeafDataAsConstant = true;
+	ParseAggregationExpressionContext parseContext = { 0 };
+	bson_value_t placeholderValue = { 0 };
+	placeholderValue.value_type = BSON_TYPE_NULL;
+
+	state->projectionTree = MakeRootNode();
+
+	StringView pathView = CreateStringViewFromString(state->path);
+	state->elementLeaf = (BsonLeafPathNode *) TraverseDottedPathAndAddLeafFieldNode(
+		&pathView, &placeholderValue, state->projectionTree,
+		BsonDefaultCreateLeafNode, treatLeafDataAsConstant, &parseContext);
+
+	if (state->indexFieldName != NULL)
+	{
+		StringView indexFieldView = CreateStringViewFromString(state->indexFieldName);
+		state->indexLeaf = (BsonLeafPathNode *) TraverseDottedPathAndAddLeafFieldNode(
+			&indexFieldView, &placeholderValue, state->projectionTree,
+			BsonDefaultCreateLeafNode, treatLeafDataAsConstant, &parseContext);
 	}
+}
 
-	if (index == 0 && preserveNullAndEmpty)
+
+/*
+ * Produces the output document of the current element of the array being
+ * unwound from what PrepareUnwindArrayElements prepared.
+ */
+static pgbson *
+BsonUnwindArrayElement(UnwindArrayState *state, const bson_value_t *element)
+{
+	bson_value_t indexValue = { 0 };
+	indexValue.value_type = BSON_TYPE_INT64;
+	indexValue.value.v_int64 = state->index;
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	if (state->leadingFields != NULL)
 	{
-		Datum values[1];
-		bool isNull = false;
-
-		/* Empty arrays are removed if the document is preserved in the output */
-		values[0] = PointerGetDatum(BsonUnwindEmptyArray(
-										document, path,
-										indexFieldName));
-		tuplestore_putvalues(tupleStore, *tupleDescriptor, values, &isNull);
+		PgbsonWriterConcat(&writer, state->leadingFields);
+		PgbsonWriterAppendValue(&writer, state->path, strlen(state->path), element);
+		PgbsonWriterConcat(&writer, state->trailingFields);
+
+		if (state->indexFieldName != NULL)
+		{
+			PgbsonWriterAppendValue(&writer, state->indexFieldName,
+									strlen(state->indexFieldName), &indexValue);
+		}
+
+		return PgbsonWriterGetPgbson(&writer);
 	}
 
-	PG_FREE_IF_COPY(document, 0);
-	PG_RETURN_VOID();
+	state->elementLeaf->fieldData.value = *element;
+	if (state->indexLeaf != NULL)
+	{
+		/* When the index field is the path, the index is what gets written */
+		state->indexLeaf->fieldData.value = indexValue;
+	}
+
+	bson_iter_t documentIterator;
+	PgbsonInitIterator(state->document, &documentIterator);
+	bool projectNonMatchingField = true;
+	ProjectDocumentState projectDocState = {
+		.isPositionalAlreadyEvaluated = false,
+		.parentDocument = state->document,
+		.pendingProjectionState = NULL,
+		.skipIntermediateArrayFields = false,
+	};
+
+	bool isInNestedArray = false;
+	TraverseObjectAndAppendToWriter(&documentIterator, state->projectionTree, &writer,
+									projectNonMatchingField,
+									&projectDocState, isInNestedArray);
+	return PgbsonWriterGetPgbson(&writer);
 }
 
 
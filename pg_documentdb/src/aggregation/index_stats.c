@@ -23,9 +23,32 @@
 #include "commands/diagnostic_commands_common.h"
 #include "api_hooks.h"
 #include "metadata/metadata_cache.h"
+#include "utils/version_utils.h"
 
 
 static const char *IndexUsageKey = "index_usage";
+static const char *IndexUsageDetailsKey = "index_usage_details";
+
+extern bool EnableIndexStatsUsageDetails;
+
+/*
+ * The usage of an index beyond the number of scans, summed over the shards
+ * of the collection on all nodes.
+ */
+typedef struct IndexUsageDetails
+{
+	/* The index entries returned by scans of the index */
+	int64 tuplesRead;
+
+	/* The live table rows fetched by simple scans of the index */
+	int64 tuplesFetched;
+
+	/* The size of the index on disk */
+	int64 sizeBytes;
+
+	/* The last time the index was scanned (0 if unknown) */
+	int64 lastUsedMillis;
+} IndexUsageDetails;
 
 PG_FUNCTION_INFO_V1(command_index_stats_aggregation);
 PG_FUNCTION_INFO_V1(command_index_stats_worker);
@@ -40,6 +63,10 @@ static pgbson * IndexStatsWorker(void *fcinfoPointer);
 
 static void MergeWorkerResults(MongoCollection *collection, List *workerResults,
 							   Tuplestorestate *tupleStore, TupleDesc tupleDescriptor);
+static void GetIndexUsageDetails(List *indexDetailDocs, const char *indexName,
+								 IndexUsageDetails *details);
+static void WriteIndexUsageDetails(pgbson_writer *writer,
+								   const IndexUsageDetails *details);
 
 
 /*
@@ -164,8 +191,19 @@ IndexStatsWorker(void *fcinfoPointer)
 	pgbson_writer indexWriter;
 	PgbsonWriterStartDocument(&writer, IndexUsageKey, -1, &indexWriter);
 
+	/*
+	 * These are the cumulative statistics postgres keeps per index in shared
+	 * memory: They survive a clean restart and are reset with the statistics.
+	 */
 	const char *query =
-		"SELECT indexrelid, idx_scan FROM pg_catalog.pg_stat_all_indexes "
+		"SELECT indexrelid, idx_scan, idx_tup_read, idx_tup_fetch, "
+		" pg_catalog.pg_relation_size(indexrelid), "
+#if PG_VERSION_NUM >= 160000
+		" last_idx_scan "
+#else
+		" NULL::timestamptz "
+#endif
+		" FROM pg_catalog.pg_stat_all_indexes "
 		" WHERE relid =ANY ($1)";
 
 	int nargs = 1;
@@ -176,6 +214,7 @@ IndexStatsWorker(void *fcinfoPointer)
 	MemoryContext priorMemoryContext = CurrentMemoryContext;
 
 	HTAB *indexHash = CreatePgbsonElementHashSet();
+	List *indexDetailDocs = NIL;
 	SPI_connect();
 
 	Portal statsPortal = SPI_cursor_open_with_args("workerIndexUsageStats", query, nargs,
@@ -220,6 +259,23 @@ IndexStatsWorker(void *fcinfoPointer)
 
 				int64 indexAccesses = DatumGetInt64(resultDatum);
 
+				/* The remaining columns are only used for the usage details */
+				int64 detailValues[3] = { 0 };
+				for (int i = 0; i < 3; i++)
+				{
+					resultDatum = SPI_getbinval(SPI_tuptable->vals[tupleNumber],
+												SPI_tuptable->tupdesc, i + 3, &isNull);
+					detailValues[i] = isNull ? 0 : DatumGetInt64(resultDatum);
+				}
+
+				AttrNumber lastUsedAttribute = 6;
+				resultDatum = SPI_getbinval(SPI_tuptable->vals[tupleNumber],
+											SPI_tuptable->tupdesc, lastUsedAttribute,
+											&isNull);
+				int64 lastUsedMillis = isNull ? 0 :
+									   GetDateTimeFromTimestamp(DatumGetTimestampTz(
+																	resultDatum));
+
 				/* Now write the result */
 				MemoryContext spiContext = MemoryContextSwitchTo(priorMemoryContext);
 
@@ -243,6 +299,21 @@ IndexStatsWorker(void *fcinfoPointer)
 						AddNumberToBsonValue(&foundElement->bsonValue, &element.bsonValue,
 											 &overflowedIgnore);
 					}
+
+					/* Shards of the same index are summed up by the coordinator */
+					pgbson_writer detailWriter;
+					PgbsonWriterInit(&detailWriter);
+					PgbsonWriterAppendUtf8(&detailWriter, "name", 4, collectionIndexName);
+					PgbsonWriterAppendInt64(&detailWriter, "tuplesRead", 10,
+											detailValues[0]);
+					PgbsonWriterAppendInt64(&detailWriter, "tuplesFetched", 13,
+											detailValues[1]);
+					PgbsonWriterAppendInt64(&detailWriter, "sizeBytes", 9,
+											detailValues[2]);
+					PgbsonWriterAppendInt64(&detailWriter, "lastUsed", 8,
+											lastUsedMillis);
+					indexDetailDocs = lappend(indexDetailDocs,
+											  PgbsonWriterGetPgbson(&detailWriter));
 				}
 
 				MemoryContextSwitchTo(spiContext);
@@ -272,6 +343,23 @@ IndexStatsWorker(void *fcinfoPointer)
 	hash_destroy(indexHash);
 
 	PgbsonWriterEndDocument(&writer, &indexWriter);
+
+	/*
+	 * Coordinators of older versions reject unknown worker fields, so only send
+	 * the usage details once the whole cluster has been upgraded.
+	 */
+	if (IsClusterVersionAtleast(DocDB_V0, 108, 0))
+	{
+		pgbson_array_writer detailsWriter;
+		PgbsonWriterStartArray(&writer, IndexUsageDetailsKey, -1, &detailsWriter);
+		ListCell *detailCell;
+		foreach(detailCell, indexDetailDocs)
+		{
+			PgbsonArrayWriterWriteDocument(&detailsWriter, lfirst(detailCell));
+		}
+		PgbsonWriterEndArray(&writer, &detailsWriter);
+	}
+
 	return PgbsonWriterGetPgbson(&writer);
 }
 
@@ -281,7 +369,7 @@ IndexStatsWorker(void *fcinfoPointer)
  * set of index documents that can be merged.
  */
 static List *
-ParseWorkerResults(List *workerResults)
+ParseWorkerResults(List *workerResults, List **indexDetailDocs)
 {
 	ListCell *workerCell;
 
@@ -313,6 +401,23 @@ ParseWorkerResults(List *workerResults)
 				*value = *bson_iter_value(&workerIter);
 				indexDocs = lappend(indexDocs, value);
 			}
+			else if (strcmp(key, IndexUsageDetailsKey) == 0)
+			{
+				bson_iter_t detailsIter;
+				if (!BSON_ITER_HOLDS_ARRAY(&workerIter) ||
+					!bson_iter_recurse(&workerIter, &detailsIter))
+				{
+					ereport(ERROR, (errmsg(
+										"indexStats worker usage details must be an array")));
+				}
+
+				while (bson_iter_next(&detailsIter))
+				{
+					bson_value_t *value = palloc(sizeof(bson_value_t));
+					*value = *bson_iter_value(&detailsIter);
+					*indexDetailDocs = lappend(*indexDetailDocs, value);
+				}
+			}
 			else
 			{
 				ereport(ERROR, (errmsg("unknown field received from indexStats worker %s",
@@ -340,7 +445,8 @@ static void
 MergeWorkerResults(MongoCollection *collection, List *workerResults,
 				   Tuplestorestate *tupleStore, TupleDesc tupleDescriptor)
 {
-	List *indexDocs = ParseWorkerResults(workerResults);
+	List *indexDetailDocs = NIL;
+	List *indexDocs = ParseWorkerResults(workerResults, &indexDetailDocs);
 
 	bool excludeIdIndex = false;
 
@@ -422,6 +528,15 @@ MergeWorkerResults(MongoCollection *collection, List *workerResults,
 		PgbsonWriterAppendInt64(&childWriter, "ops", 3, usages);
 		PgbsonWriterAppendValue(&childWriter, "since", 5, &startTimeValue);
 		PgbsonWriterEndDocument(&writer, &childWriter);
+
+		if (EnableIndexStatsUsageDetails)
+		{
+			IndexUsageDetails usageDetails = { 0 };
+			GetIndexUsageDetails(indexDetailDocs, details->indexSpec.indexName,
+								 &usageDetails);
+			WriteIndexUsageDetails(&writer, &usageDetails);
+		}
+
 		PgbsonWriterAppendDocument(&writer, "spec", 4, IndexSpecAsBson(
 									   &details->indexSpec));
 
@@ -433,3 +548,81 @@ MergeWorkerResults(MongoCollection *collection, List *workerResults,
 
 	hash_destroy(bsonElementHash);
 }
+
+
+/*
+ * Sums up the usage details the workers reported for the shards of the index.
+ */
+static void
+GetIndexUsageDetails(List *indexDetailDocs, const char *indexName,
+					 IndexUsageDetails *details)
+{
+	ListCell *cell;
+	foreach(cell, indexDetailDocs)
+	{
+		bson_value_t *detailDoc = lfirst(cell);
+
+		bson_iter_t detailIter;
+		BsonValueInitIterator(detailDoc, &detailIter);
+		if (!bson_iter_find(&detailIter, "name") ||
+			!BSON_ITER_HOLDS_UTF8(&detailIter) ||
+			strcmp(bson_iter_utf8(&detailIter, NULL), indexName) != 0)
+		{
+			continue;
+		}
+
+		BsonValueInitIterator(detailDoc, &detailIter);
+		while (bson_iter_next(&detailIter))
+		{
+			const char *key = bson_iter_key(&detailIter);
+			if (strcmp(key, "tuplesRead") == 0)
+			{
+				details->tuplesRead += BsonValueAsInt64(bson_iter_value(&detailIter));
+			}
+			else if (strcmp(key, "tuplesFetched") == 0)
+			{
+				details->tuplesFetched += BsonValueAsInt64(bson_iter_value(&detailIter));
+			}
+			else if (strcmp(key, "sizeBytes") == 0)
+			{
+				details->sizeBytes += BsonValueAsInt64(bson_iter_value(&detailIter));
+			}
+			else if (strcmp(key, "lastUsed") == 0)
+			{
+				details->lastUsedMillis = Max(details->lastUsedMillis,
+											  BsonValueAsInt64(bson_iter_value(
+																   &detailIter)));
+			}
+		}
+	}
+}
+
+
+/*
+ * Writes the usage details of an index:
+ * { "usage": { "tuplesRead", "tuplesFetched", "sizeBytes", "lastUsed" } }
+ * lastUsed is null if the index was never scanned since the statistics were
+ * reset (or the server does not track it), which makes unused indexes easy
+ * to find with a $match on it.
+ */
+static void
+WriteIndexUsageDetails(pgbson_writer *writer, const IndexUsageDetails *details)
+{
+	pgbson_writer usageWriter;
+	PgbsonWriterStartDocument(writer, "usage", 5, &usageWriter);
+	PgbsonWriterAppendInt64(&usageWriter, "tuplesRead", 10, details->tuplesRead);
+	PgbsonWriterAppendInt64(&usageWriter, "tuplesFetched", 13, details->tuplesFetched);
+	PgbsonWriterAppendInt64(&usageWriter, "sizeBytes", 9, details->sizeBytes);
+	if (details->lastUsedMillis == 0)
+	{
+		PgbsonWriterAppendNull(&usageWriter, "lastUsed", 8);
+	}
+	else
+	{
+		bson_value_t lastUsedValue = { 0 };
+		lastUsedValue.value_type = BSON_TYPE_DATE_TIME;
+		lastUsedValue.value.v_datetime = details->lastUsedMillis;
+		PgbsonWriterAppendValue(&usageWriter, "lastUsed", 8, &lastUsedValue);
+	}
+	PgbsonWriterEndDocument(writer, &usageWriter);
+}
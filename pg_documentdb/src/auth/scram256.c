@@ -11,6 +11,7 @@
 #include "postgres.h"
 #include "common/scram-common.h"
 #include "libpq/crypt.h"
+#include "utils/acl.h"
 #include "utils/builtins.h"
 #include "io/bson_core.h"
 #include "common/base64.h" /* Postgres base64 encode / decode functions */
@@ -35,6 +36,12 @@
 #define AUTH_SALT_KEY_LEN strlen(AUTH_SALT_KEY) /* salt key length */
 #define AUTH_SERV_SIGN_KEY "ServerSignature" /* Server signature key */
 #define AUTH_SERV_SIGN_KEY_LEN strlen(AUTH_SERV_SIGN_KEY) /* Serv sign length */
+#define AUTH_STORED_KEY "StoredKey" /* StoredKey of the shadow password */
+#define AUTH_STORED_KEY_LEN strlen(AUTH_STORED_KEY)
+#define AUTH_SERVER_KEY "ServerKey" /* ServerKey of the shadow password */
+#define AUTH_SERVER_KEY_LEN strlen(AUTH_SERVER_KEY)
+#define AUTH_ROLE_OID_KEY "roleOid" /* Oid of the role being authenticated */
+#define AUTH_ROLE_OID_KEY_LEN strlen(AUTH_ROLE_OID_KEY)
 
 /* Test helper functions in use */
 #define AUTH_MSG_KEY "AuthMessage"
@@ -155,6 +162,63 @@ static pgbson * BuildResponseMsgForSaltRequest(SaltIterationsReqResult *requestR
 static pgbson * BuildResponseMsgForAuthRequest(ScramAuthResult *authReqResult);
 
 
+/* Build the response BSON for a SCRAM secret request */
+static pgbson * BuildResponseMsgForSecretRequest(ScramState *state, Oid roleOid);
+
+
+/* Base64 encodes a StoredKey or ServerKey */
+static char * EncodeScramKey(const uint8 *key, int keyLength);
+
+
+/* Build the response BSON for a SCRAM secret request. The secret is only
+ * returned when the shadow password could be parsed (keyLength is set). */
+static pgbson *
+BuildResponseMsgForSecretRequest(ScramState *state, Oid roleOid)
+{
+	pgbson_writer resultWriter;
+	bool found = state->keyLength > 0;
+
+	PgbsonWriterInit(&resultWriter);
+
+	PgbsonWriterAppendInt32(&resultWriter, AUTH_OK_KEY, AUTH_OK_KEY_LEN,
+							found ? 1 : 0);
+	if (!found)
+	{
+		return PgbsonWriterGetPgbson(&resultWriter);
+	}
+
+	PgbsonWriterAppendInt32(&resultWriter, AUTH_ITER_KEY, AUTH_ITER_KEY_LEN,
+							state->iterations);
+	PgbsonWriterAppendUtf8(&resultWriter, AUTH_SALT_KEY, AUTH_SALT_KEY_LEN,
+						   state->encodedSalt);
+	PgbsonWriterAppendUtf8(&resultWriter, AUTH_STORED_KEY, AUTH_STORED_KEY_LEN,
+						   EncodeScramKey(state->storedKey, state->keyLength));
+	PgbsonWriterAppendUtf8(&resultWriter, AUTH_SERVER_KEY, AUTH_SERVER_KEY_LEN,
+						   EncodeScramKey(state->serverKey, state->keyLength));
+	PgbsonWriterAppendInt64(&resultWriter, AUTH_ROLE_OID_KEY, AUTH_ROLE_OID_KEY_LEN,
+							(int64) roleOid);
+
+	return PgbsonWriterGetPgbson(&resultWriter);
+}
+
+
+/* Base64 encodes a StoredKey or ServerKey */
+static char *
+EncodeScramKey(const uint8 *key, int keyLength)
+{
+	int encodedLength = pg_b64_enc_len(keyLength);
+
+	/* don't forget the zero-terminator */
+	char *encodedKey = palloc0(encodedLength + 1);
+	encodedLength = pg_b64_encode((const char_uint8_compat *) key, keyLength,
+								  encodedKey, encodedLength);
+
+	encodedLength = (encodedLength < 0) ? 0 : encodedLength;
+	encodedKey[encodedLength] = AUTH_EOS_CHAR;
+	return encodedKey;
+}
+
+
 /* Build the response BSON for Auth Message and Client Proof generator test
  * helper function */
 static pgbson * BuildResponseMsgForClientProofGeneratorForTest(
@@ -179,6 +243,7 @@ static bool ScramSaltedPassword(ScramState *state, const char *password, const
  */
 PG_FUNCTION_INFO_V1(command_authenticate_with_scram_sha256);
 PG_FUNCTION_INFO_V1(command_scram_sha256_get_salt_and_iterations);
+PG_FUNCTION_INFO_V1(command_scram_sha256_get_secret);
 PG_FUNCTION_INFO_V1(command_generate_auth_message_client_proof_for_test);
 PG_FUNCTION_INFO_V1(command_generate_server_signature_for_test);
 PG_FUNCTION_INFO_V1(command_authenticate_with_pwd);
@@ -225,6 +290,50 @@ command_scram_sha256_get_salt_and_iterations(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * This function provides the SCRAM secret of the given user name so that the
+ * caller (the gateway) can verify client proofs of the user itself, without a
+ * round trip per handshake. It's only meant for the gateway's system user.
+ * Input argument 1: User name. Type: text
+ * Output: { "ok" : 1, "iterations" : int, "salt" : text, "StoredKey" : text,
+ *           "ServerKey" : text, "roleOid" : long }
+ */
+Datum
+command_scram_sha256_get_secret(PG_FUNCTION_ARGS)
+{
+	ScramState scramState;
+	Oid roleOid = InvalidOid;
+
+	memset(&scramState, 0, sizeof(ScramState));
+	scramState.encodedSalt = "";
+	scramState.keyLength = SCRAM_SHA_256_KEY_LEN;
+	scramState.hashType = PG_SHA256;
+
+	if (!IsNativeAuthEnabled)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg(
+							"Native authentication is disabled on cluster. Enable native authentication or use Entra ID authentication.")));
+	}
+
+	if (PG_ARGISNULL(0))
+	{
+		scramState.keyLength = 0;
+		PG_RETURN_POINTER(BuildResponseMsgForSecretRequest(&scramState, roleOid));
+	}
+
+	scramState.userName = text_to_cstring(PG_GETARG_TEXT_P(0));
+	roleOid = get_role_oid(scramState.userName, true);
+
+	if (!OidIsValid(roleOid) || !ParseScramShadowPassword(&scramState))
+	{
+		scramState.keyLength = 0;
+	}
+
+	PG_RETURN_POINTER(BuildResponseMsgForSecretRequest(&scramState, roleOid));
+}
+
+
 /*
  * command_authenticate_with_scram_sha256 authenticates the provided user name
  * with the scramed password from postgresql.
@@ -9,6 +9,8 @@
  */
 
 #include <postgres.h>
+#include <fmgr.h>
+#include <funcapi.h>
 #include <catalog/pg_extension.h>
 #include <catalog/namespace.h>
 #include <nodes/pg_list.h>
@@ -19,6 +21,8 @@
 #include <miscadmin.h>
 #include <postmaster/bgworker.h>
 #include <storage/shmem.h>
+#include <storage/spin.h>
+#include <storage/lwlock.h>
 #include <storage/ipc.h>
 #include <postmaster/postmaster.h>
 #include <utils/backend_status.h>
@@ -47,15 +51,54 @@
 
 #define ONE_SEC_IN_MS 1000L
 
+/*
+ * The jobs registry should not be exposed outside this c file to avoid unpredictable behavior.
+ */
+#define MAX_BACKGROUND_WORKER_JOBS 5
+static BackgroundWorkerJob JobRegistry[MAX_BACKGROUND_WORKER_JOBS];
+static int JobEntries = 0;
+
+/* The most executions of a single job that may run at the same time */
+#define MAX_BACKGROUND_WORKER_JOB_CONCURRENCY 4
+
+/*
+ * The executions of a job as seen by the leader, reported by the
+ * background_worker_jobs() function. Indexed like the JobRegistry.
+ */
+typedef struct BackgroundWorkerJobStats
+{
+	int runningExecutions;
+
+	uint64 totalExecutions;
+
+	uint64 failedExecutions;
+
+	uint64 timedOutExecutions;
+
+	/* Due executions that waited for a free slot of the pool */
+	uint64 deferredExecutions;
+
+	TimestampTz lastStartTime;
+
+	TimestampTz lastEndTime;
+
+	int64 lastDurationMs;
+} BackgroundWorkerJobStats;
+
 /*
  * The main background worker shmem struct.  On shared memory we store this main
  * struct. This struct keeps:
  *
  * latch Sharable latch
+ * jobStats The executions of each registered job, protected by statsLock
  */
 typedef struct BackgroundWorkerShmemStruct
 {
 	Latch latch;
+
+	slock_t statsLock;
+
+	BackgroundWorkerJobStats jobStats[MAX_BACKGROUND_WORKER_JOBS];
 } BackgroundWorkerShmemStruct;
 
 PGDLLEXPORT void DocumentDBBackgroundWorkerMain(Datum);
@@ -66,13 +109,12 @@ extern char *LocalhostConnectionString;
 extern int LatchTimeOutSec;
 extern bool EnableBackgroundWorkerJobs;
 extern int BackgroundWorkerJobTimeoutThresholdSec;
+extern int BackgroundWorkerMaxConcurrentJobs;
 
 static bool BackgroundWorkerReloadConfig = false;
 
 /* Shared memory segment for BackgroundWorker */
 static BackgroundWorkerShmemStruct *BackgroundWorkerShmem;
-static Size BackgroundWorkerShmemSize(void);
-static void BackgroundWorkerShmemInit(void);
 static void BackgroundWorkerKill(int code, Datum arg);
 
 /* Flags set by signal handlers */
@@ -106,6 +148,39 @@ typedef enum BackgroundWorkerBoolOption
 	BackgroundWorkerBoolOption_True = 1,
 } BackgroundWorkerBoolOption;
 
+/*
+ * How an execution of a job ended, for the job stats.
+ */
+typedef enum
+{
+	JOB_RUN_SUCCEEDED = 0,
+
+	JOB_RUN_FAILED = 1,
+
+	JOB_RUN_TIMED_OUT = 2,
+
+	/* The execution was dropped when the jobs were disabled or on shutdown. */
+	JOB_RUN_ABANDONED = 3,
+} BackgroundWorkerJobRunOutcome;
+
+/*
+ * A single execution of a job command over its own connection.
+ */
+typedef struct
+{
+	/* PG connection object instance. */
+	PGconn *connection;
+
+	/* When the execution started. */
+	TimestampTz startTime;
+
+	/* Set when the command returned an error. */
+	bool failed;
+
+	/* Execution state. */
+	BackgroundWorkerJobState state;
+} BackgroundWorkerJobRun;
+
 /*
  * Background worker job execution object.
  */
@@ -114,17 +189,20 @@ typedef struct
 	/* For 1:1 mapping between BackgroundWorkerJob and BackgroundWorkerJobExecution. */
 	BackgroundWorkerJob job;
 
+	/* Index of the job in the JobRegistry and in the shared job stats. */
+	int registryIndex;
+
 	/* Last time when job started execution. */
 	TimestampTz lastStartTime;
 
-	/* PG connection object instance. */
-	PGconn *connection;
-
 	/* SQL command query generated from job command and argument. */
 	char *commandQuery;
 
-	/* Job state. */
-	BackgroundWorkerJobState state;
+	/* The executions of the job, up to job.maxConcurrentExecutions run at a time. */
+	BackgroundWorkerJobRun runs[MAX_BACKGROUND_WORKER_JOB_CONCURRENCY];
+
+	/* The number of runs that are JOB_RUNNING. */
+	int runningCount;
 } BackgroundWorkerJobExecution;
 
 extern void RegisterBackgroundWorkerJobAllowedCommand(BackgroundWorkerJobCommand command);
@@ -135,19 +213,29 @@ static BackgroundWorkerBoolOption IsCoordinator =
 /* Background worker job functions*/
 static void ValidateJob(BackgroundWorkerJob job);
 static void ManageJobsLifeCycle(List *jobExecutions, char *userName, char *databaseName);
-static void ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName,
+static bool ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName,
 					   char *databaseName, TimestampTz currentTime);
-static void CheckJobCompletion(BackgroundWorkerJobExecution *jobExec);
+static void CheckJobCompletion(BackgroundWorkerJobExecution *jobExec,
+							   BackgroundWorkerJobRun *run, TimestampTz currentTime);
+static void FinishJobRun(BackgroundWorkerJobExecution *jobExec,
+						 BackgroundWorkerJobRun *run, TimestampTz currentTime,
+						 BackgroundWorkerJobRunOutcome outcome);
+static int CompareJobExecutionsByPriority(const ListCell *left, const ListCell *right);
+static int GetMaxConcurrentExecutions(const BackgroundWorkerJob *job);
+static void RecordJobRunStart(BackgroundWorkerJobExecution *jobExec,
+							  TimestampTz startTime);
+static void RecordJobRunDeferred(BackgroundWorkerJobExecution *jobExec);
 static void FreeJobExecutions(List *jobExecutions);
 static bool CheckIfMetadataCoordinator(void);
 static bool CheckIfJobCommandIsAllowed(BackgroundWorkerJobCommand command);
 static bool CanExecuteJob(BackgroundWorkerJobExecution *jobExec, TimestampTz currentTime);
 static bool CheckIfRoleExists(const char *roleName);
 static List * GenerateJobExecutions(void);
-static BackgroundWorkerJobExecution * CreateJobExecutionObj(BackgroundWorkerJob job);
+static BackgroundWorkerJobExecution * CreateJobExecutionObj(BackgroundWorkerJob job,
+															int registryIndex);
 static char * GenerateCommandQuery(BackgroundWorkerJob job, MemoryContext stableContext);
-static void CancelJobIfTimeIsUp(BackgroundWorkerJobExecution *jobExec, TimestampTz
-								currentTime);
+static void CancelJobIfTimeIsUp(BackgroundWorkerJobExecution *jobExec,
+								BackgroundWorkerJobRun *run, TimestampTz currentTime);
 static void WaitForBackgroundWorkerDependencies(void);
 
 /*
@@ -158,13 +246,7 @@ static BackgroundWorkerJobCommand
 	AllowedCommandRegistry[MAX_BACKGROUND_WORKER_ALLOWED_COMMANDS];
 static int AllowedCommandEntries = 0;
 
-
-/*
- * The jobs registry should not be exposed outside this c file to avoid unpredictable behavior.
- */
-#define MAX_BACKGROUND_WORKER_JOBS 5
-static BackgroundWorkerJob JobRegistry[MAX_BACKGROUND_WORKER_JOBS];
-static int JobEntries = 0;
+PG_FUNCTION_INFO_V1(get_background_worker_jobs);
 
 
 /* Default implementation of the hook. Presently just returns a const.
@@ -380,34 +462,94 @@ RegisterBackgroundWorkerJob(BackgroundWorkerJob job)
 
 /*
  * ManageJobsLifeCycle walks through the list of jobs and takes action based on their state.
+ * The executions that are done are reaped first, then the jobs that are due are started
+ * by priority while the pool of BackgroundWorkerMaxConcurrentJobs executions has room.
+ * Jobs that don't fit stay due and are started on a later tick, ahead of the jobs of the
+ * same priority that ran more recently.
  */
 static void
 ManageJobsLifeCycle(List *jobExecutions, char *userName, char *databaseName)
 {
 	TimestampTz currentTime = GetCurrentTimestamp();
 	ListCell *jobExecCell = NULL;
+	List *dueJobExecutions = NIL;
+	int runningExecutions = 0;
 
 	/*
-	 * Manages each job execution's state. Execute if possible and
-	 * complete when done.
+	 * Manages the state of each execution of the jobs: cancel the ones that
+	 * ran out of time and complete the ones that are done.
 	 */
 	foreach(jobExecCell, jobExecutions)
 	{
 		BackgroundWorkerJobExecution *jobExec = (BackgroundWorkerJobExecution *) lfirst(
 			jobExecCell);
 
-		/* Cancels job in case the job is running is open and timeout was reached. */
-		CancelJobIfTimeIsUp(jobExec, currentTime);
+		for (int i = 0; i < MAX_BACKGROUND_WORKER_JOB_CONCURRENCY; i++)
+		{
+			/* Cancels job in case the job is running is open and timeout was reached. */
+			CancelJobIfTimeIsUp(jobExec, &jobExec->runs[i], currentTime);
+
+			/* Check if job completed in case the job is running. */
+			CheckJobCompletion(jobExec, &jobExec->runs[i], currentTime);
+		}
 
-		/* Check if job completed in case the job is running. */
-		CheckJobCompletion(jobExec);
+		runningExecutions += jobExec->runningCount;
 
-		/* Executes job if it hasn't started and the scheduled interval was reached. */
 		if (CanExecuteJob(jobExec, currentTime))
 		{
-			ExecuteJob(jobExec, userName, databaseName, currentTime);
+			dueJobExecutions = lappend(dueJobExecutions, jobExec);
+		}
+	}
+
+	list_sort(dueJobExecutions, CompareJobExecutionsByPriority);
+
+	/* Executes the due jobs while there's room in the pool. */
+	foreach(jobExecCell, dueJobExecutions)
+	{
+		BackgroundWorkerJobExecution *jobExec = (BackgroundWorkerJobExecution *) lfirst(
+			jobExecCell);
+
+		if (runningExecutions >= BackgroundWorkerMaxConcurrentJobs)
+		{
+			ereport(DEBUG1, (errmsg(
+								 "Deferring background worker job %s with id %d: %d executions are already running.",
+								 jobExec->job.jobName, jobExec->job.jobId,
+								 runningExecutions)));
+			RecordJobRunDeferred(jobExec);
+			continue;
+		}
+
+		if (ExecuteJob(jobExec, userName, databaseName, currentTime))
+		{
+			runningExecutions++;
 		}
 	}
+
+	list_free(dueJobExecutions);
+}
+
+
+/*
+ * Orders the job executions by descending priority, then by the oldest last start
+ * so that jobs of the same priority take turns.
+ */
+static int
+CompareJobExecutionsByPriority(const ListCell *left, const ListCell *right)
+{
+	BackgroundWorkerJobExecution *leftJobExec = lfirst(left);
+	BackgroundWorkerJobExecution *rightJobExec = lfirst(right);
+
+	if (leftJobExec->job.priority != rightJobExec->job.priority)
+	{
+		return leftJobExec->job.priority > rightJobExec->job.priority ? -1 : 1;
+	}
+
+	if (leftJobExec->lastStartTime != rightJobExec->lastStartTime)
+	{
+		return leftJobExec->lastStartTime < rightJobExec->lastStartTime ? -1 : 1;
+	}
+
+	return 0;
 }
 
 
@@ -431,7 +573,7 @@ CanExecuteJob(BackgroundWorkerJobExecution *jobExec, TimestampTz currentTime)
 	 * We are assuming that job schedule intervals are a multiple of LatchTimeoutSec, therefore we do
 	 * not have to handle odd intervals such as LatchTimeoutSec of 10 seconds and job interval of 15 seconds.
 	 */
-	return jobExec->state == JOB_IDLE &&
+	return jobExec->runningCount < GetMaxConcurrentExecutions(&jobExec->job) &&
 		   scheduleIntervalInSeconds > 0 &&
 		   TimestampDifferenceExceeds(jobExec->lastStartTime, currentTime,
 									  scheduleIntervalInSeconds * ONE_SEC_IN_MS);
@@ -443,15 +585,19 @@ CanExecuteJob(BackgroundWorkerJobExecution *jobExec, TimestampTz currentTime)
  * If positive, closes the job PG connection and resets it.
  */
 static void
-CheckJobCompletion(BackgroundWorkerJobExecution *jobExec)
+CheckJobCompletion(BackgroundWorkerJobExecution *jobExec, BackgroundWorkerJobRun *run,
+				   TimestampTz currentTime)
 {
-	PGconn *conn = jobExec->connection;
-	if (jobExec->state == JOB_IDLE)
+	PGconn *conn = run->connection;
+	if (run->state == JOB_IDLE)
 	{
 		return;
 	}
 
-	/* Checks if command is busy. If not, close connection and reset it. */
+	/*
+	 * Reads the results that arrived without blocking. Once the command is done
+	 * the connection is closed and the run is reset.
+	 */
 	PG_TRY();
 	{
 		if (PQconsumeInput(conn) == 0)
@@ -459,11 +605,28 @@ CheckJobCompletion(BackgroundWorkerJobExecution *jobExec)
 			PGConnReportError(conn, NULL, ERROR);
 		}
 
-		if (!PQisBusy(conn))
+		bool isDone = false;
+		while (!PQisBusy(conn))
 		{
-			PQfinish(conn);
-			jobExec->connection = NULL;
-			jobExec->state = JOB_IDLE;
+			PGresult *result = PQgetResult(conn);
+			if (result == NULL)
+			{
+				isDone = true;
+				break;
+			}
+
+			if (PQresultStatus(result) == PGRES_FATAL_ERROR)
+			{
+				run->failed = true;
+			}
+
+			PQclear(result);
+		}
+
+		if (isDone)
+		{
+			FinishJobRun(jobExec, run, currentTime,
+						 run->failed ? JOB_RUN_FAILED : JOB_RUN_SUCCEEDED);
 		}
 	}
 	PG_CATCH();
@@ -471,12 +634,8 @@ CheckJobCompletion(BackgroundWorkerJobExecution *jobExec)
 		/* Clear error context since we don't use it. */
 		FlushErrorState();
 
-		/* We fail gracefuly and close the connection. */
-		PQfinish(conn);
-
-		/* Set state to idle so it can run in the next iteration. */
-		jobExec->connection = NULL;
-		jobExec->state = JOB_IDLE;
+		/* We fail gracefuly and close the connection, so it can run in the next iteration. */
+		FinishJobRun(jobExec, run, currentTime, JOB_RUN_FAILED);
 
 		ereport(WARNING, (errmsg(
 							  "Failed to execute background worker job %s with id %d. Could not consume input from the connection.",
@@ -486,6 +645,95 @@ CheckJobCompletion(BackgroundWorkerJobExecution *jobExec)
 }
 
 
+/*
+ * Closes the connection of a job execution, resets it to idle and records how it ended.
+ */
+static void
+FinishJobRun(BackgroundWorkerJobExecution *jobExec, BackgroundWorkerJobRun *run,
+			 TimestampTz currentTime, BackgroundWorkerJobRunOutcome outcome)
+{
+	if (run->connection != NULL)
+	{
+		PQfinish(run->connection);
+		run->connection = NULL;
+	}
+
+	run->state = JOB_IDLE;
+	run->failed = false;
+	jobExec->runningCount--;
+
+	if (BackgroundWorkerShmem == NULL)
+	{
+		return;
+	}
+
+	long seconds = 0;
+	int microseconds = 0;
+	TimestampDifference(run->startTime, currentTime, &seconds, &microseconds);
+
+	BackgroundWorkerJobStats *stats =
+		&BackgroundWorkerShmem->jobStats[jobExec->registryIndex];
+	SpinLockAcquire(&BackgroundWorkerShmem->statsLock);
+	stats->runningExecutions = Max(stats->runningExecutions - 1, 0);
+	if (outcome != JOB_RUN_ABANDONED)
+	{
+		stats->totalExecutions++;
+		stats->failedExecutions += outcome == JOB_RUN_FAILED ? 1 : 0;
+		stats->timedOutExecutions += outcome == JOB_RUN_TIMED_OUT ? 1 : 0;
+		stats->lastEndTime = currentTime;
+		stats->lastDurationMs = (int64) seconds * ONE_SEC_IN_MS + microseconds / 1000;
+	}
+	SpinLockRelease(&BackgroundWorkerShmem->statsLock);
+}
+
+
+/*
+ * Records the start of an execution of the job in the shared job stats.
+ */
+static void
+RecordJobRunStart(BackgroundWorkerJobExecution *jobExec, TimestampTz startTime)
+{
+	if (BackgroundWorkerShmem == NULL)
+	{
+		return;
+	}
+
+	BackgroundWorkerJobStats *stats =
+		&BackgroundWorkerShmem->jobStats[jobExec->registryIndex];
+	SpinLockAcquire(&BackgroundWorkerShmem->statsLock);
+	stats->runningExecutions++;
+	stats->lastStartTime = startTime;
+	SpinLockRelease(&BackgroundWorkerShmem->statsLock);
+}
+
+
+/*
+ * Counts a due execution of the job that waited for room in the pool.
+ */
+static void
+RecordJobRunDeferred(BackgroundWorkerJobExecution *jobExec)
+{
+	if (BackgroundWorkerShmem == NULL)
+	{
+		return;
+	}
+
+	SpinLockAcquire(&BackgroundWorkerShmem->statsLock);
+	BackgroundWorkerShmem->jobStats[jobExec->registryIndex].deferredExecutions++;
+	SpinLockRelease(&BackgroundWorkerShmem->statsLock);
+}
+
+
+/*
+ * The number of executions of the job that may run at the same time.
+ */
+static int
+GetMaxConcurrentExecutions(const BackgroundWorkerJob *job)
+{
+	return job->maxConcurrentExecutions > 0 ? job->maxConcurrentExecutions : 1;
+}
+
+
 /*
  * Wait until the background worker prerequisistes are met. We currently wait
  * for the BackgroundWorkerRole to be created.
@@ -531,13 +779,31 @@ WaitForBackgroundWorkerDependencies(void)
 
 
 /*
- * Executes job command through LibPQ.
+ * Executes job command through LibPQ on a free run of the job. Returns whether
+ * the command was sent.
  */
-static void
+static bool
 ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName, char *databaseName,
 		   TimestampTz currentTime)
 {
-	PGconn *conn = NULL;
+	BackgroundWorkerJobRun *run = NULL;
+	for (int i = 0; i < GetMaxConcurrentExecutions(&jobExec->job); i++)
+	{
+		if (jobExec->runs[i].state == JOB_IDLE)
+		{
+			run = &jobExec->runs[i];
+			break;
+		}
+	}
+
+	if (run == NULL)
+	{
+		return false;
+	}
+
+	/* declared volatile because of the longjmp in PG_CATCH */
+	PGconn *volatile conn = NULL;
+	volatile bool isStarted = false;
 	StringInfo localhostConnStr = makeStringInfo();
 
 	/*
@@ -595,10 +861,15 @@ ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName, char *database
 			PGConnReportError(conn, NULL, ERROR);
 		}
 
-		/* Query was sent successfuly. Assign connection to job. */
-		jobExec->connection = conn;
-		jobExec->state = JOB_RUNNING;
+		/* Query was sent successfuly. Assign connection to the run. */
+		run->connection = conn;
+		run->startTime = currentTime;
+		run->failed = false;
+		run->state = JOB_RUNNING;
+		jobExec->runningCount++;
 		jobExec->lastStartTime = currentTime;
+		RecordJobRunStart(jobExec, currentTime);
+		isStarted = true;
 	}
 	PG_CATCH();
 	{
@@ -612,7 +883,7 @@ ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName, char *database
 		}
 
 		/* Set state to idle so it can run in the next iteration. */
-		jobExec->state = JOB_IDLE;
+		run->state = JOB_IDLE;
 
 		ereport(WARNING, (errmsg(
 							  "Failed to execute background worker job id %d. Could not establish connection and send query.",
@@ -621,6 +892,7 @@ ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName, char *database
 	PG_END_TRY();
 
 	pfree(localhostConnStr->data);
+	return isStarted;
 }
 
 
@@ -629,18 +901,19 @@ ExecuteJob(BackgroundWorkerJobExecution *jobExec, char *userName, char *database
  * If connectionTimeout <= 0 OR the job has no active connection, do nothing.
  */
 static void
-CancelJobIfTimeIsUp(BackgroundWorkerJobExecution *jobExec, TimestampTz currentTime)
+CancelJobIfTimeIsUp(BackgroundWorkerJobExecution *jobExec, BackgroundWorkerJobRun *run,
+					TimestampTz currentTime)
 {
 	int timeoutInSeconds = jobExec->job.timeoutInSeconds;
-	PGconn *conn = jobExec->connection;
-	if (jobExec->state == JOB_IDLE ||
+	PGconn *conn = run->connection;
+	if (run->state == JOB_IDLE ||
 		timeoutInSeconds <= 0)
 	{
 		return;
 	}
 
 	if (TimestampDifferenceExceeds(
-			jobExec->lastStartTime,
+			run->startTime,
 			currentTime,
 			timeoutInSeconds * ONE_SEC_IN_MS))
 	{
@@ -649,9 +922,7 @@ CancelJobIfTimeIsUp(BackgroundWorkerJobExecution *jobExec, TimestampTz currentTi
 			PGConnTryCancel(conn);
 		}
 
-		PQfinish(conn);
-		jobExec->connection = NULL;
-		jobExec->state = JOB_IDLE;
+		FinishJobRun(jobExec, run, currentTime, JOB_RUN_TIMED_OUT);
 
 		ereport(LOG, (errmsg(
 						  "Canceled background worker job %s with id %d because of connection timeout of %d seconds.",
@@ -726,6 +997,14 @@ ValidateJob(BackgroundWorkerJob job)
 							job.jobName, BackgroundWorkerJobTimeoutThresholdSec)));
 	}
 
+	if (job.maxConcurrentExecutions < 0 ||
+		job.maxConcurrentExecutions > MAX_BACKGROUND_WORKER_JOB_CONCURRENCY)
+	{
+		ereport(ERROR, (errmsg(
+							"Concurrent executions of background worker job \'%s\' must be between 0 and %d",
+							job.jobName, MAX_BACKGROUND_WORKER_JOB_CONCURRENCY)));
+	}
+
 	if (!CheckIfJobCommandIsAllowed(job.command))
 	{
 		ereport(ERROR, (errmsg("Background worker job command is not allowed")));
@@ -767,7 +1046,7 @@ GenerateJobExecutions(void)
 
 	for (int i = 0; i < JobEntries; i++)
 	{
-		BackgroundWorkerJobExecution *jobExec = CreateJobExecutionObj(JobRegistry[i]);
+		BackgroundWorkerJobExecution *jobExec = CreateJobExecutionObj(JobRegistry[i], i);
 
 		/*
 		 * Check for nullity. NULL is returned if an error happened while creating
@@ -794,7 +1073,7 @@ GenerateJobExecutions(void)
  * object. We need it to keep track of execution states and database connection.
  */
 static BackgroundWorkerJobExecution *
-CreateJobExecutionObj(BackgroundWorkerJob job)
+CreateJobExecutionObj(BackgroundWorkerJob job, int registryIndex)
 {
 	BackgroundWorkerJobExecution *jobExec = NULL;
 	char *commandQuery = NULL;
@@ -805,12 +1084,17 @@ CreateJobExecutionObj(BackgroundWorkerJob job)
 		return NULL;
 	}
 
-	jobExec = palloc(sizeof(BackgroundWorkerJobExecution));
+	jobExec = palloc0(sizeof(BackgroundWorkerJobExecution));
 	jobExec->lastStartTime = GetCurrentTimestamp();
 	jobExec->job = job;
-	jobExec->connection = NULL;
+	jobExec->registryIndex = registryIndex;
 	jobExec->commandQuery = commandQuery;
-	jobExec->state = JOB_IDLE;
+	jobExec->runningCount = 0;
+	for (int i = 0; i < MAX_BACKGROUND_WORKER_JOB_CONCURRENCY; i++)
+	{
+		jobExec->runs[i].connection = NULL;
+		jobExec->runs[i].state = JOB_IDLE;
+	}
 
 	return jobExec;
 }
@@ -828,11 +1112,14 @@ FreeJobExecutions(List *jobExecutions)
 		BackgroundWorkerJobExecution *jobExec = (BackgroundWorkerJobExecution *) lfirst(
 			jobExecCell);
 
-		/* Close PG connection if not NULL. */
-		if (jobExec->connection != NULL)
+		/* Close the PG connections of the running executions. */
+		for (int i = 0; i < MAX_BACKGROUND_WORKER_JOB_CONCURRENCY; i++)
 		{
-			PQfinish(jobExec->connection);
-			jobExec->connection = NULL;
+			if (jobExec->runs[i].state == JOB_RUNNING)
+			{
+				FinishJobRun(jobExec, &jobExec->runs[i], GetCurrentTimestamp(),
+							 JOB_RUN_ABANDONED);
+			}
 		}
 	}
 	list_free_deep(jobExecutions);
@@ -955,7 +1242,7 @@ GenerateCommandQuery(BackgroundWorkerJob job, MemoryContext stableContext)
 /*
  * Report shared-memory space needed by BackgroundWorkerShmemInit
  */
-static Size
+Size
 BackgroundWorkerShmemSize(void)
 {
 	Size size;
@@ -969,10 +1256,12 @@ BackgroundWorkerShmemSize(void)
  * BackgroundWorkerShmemInit
  * Allocate and initialize Background worker-related shared memory
  */
-static void
+void
 BackgroundWorkerShmemInit(void)
 {
 	bool found;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
 	BackgroundWorkerShmem = (BackgroundWorkerShmemStruct *) ShmemInitStruct(
 		"DocumentDB Background Worker data",
 		BackgroundWorkerShmemSize(),
@@ -982,7 +1271,70 @@ BackgroundWorkerShmemInit(void)
 		/* First time through, so initialize */
 		MemSet(BackgroundWorkerShmem, 0, BackgroundWorkerShmemSize());
 		InitSharedLatch(&BackgroundWorkerShmem->latch);
+		SpinLockInit(&BackgroundWorkerShmem->statsLock);
 	}
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * get_background_worker_jobs returns the registered background worker jobs and
+ * their executions as rows of (job_id, job_name, priority, max_concurrent_executions,
+ * running_executions, total_executions, failed_executions, timed_out_executions,
+ * deferred_executions, last_start_time, last_end_time, last_duration_ms).
+ */
+Datum
+get_background_worker_jobs(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *resultSet = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc tupleDescriptor;
+	if (get_call_result_type(fcinfo, NULL, &tupleDescriptor) != TYPEFUNC_COMPOSITE)
+	{
+		elog(ERROR, "return type must be a row type");
+	}
+
+	MemoryContext oldContext =
+		MemoryContextSwitchTo(resultSet->econtext->ecxt_per_query_memory);
+	Tuplestorestate *tupleStore = tuplestore_begin_heap(true, false, work_mem);
+	resultSet->returnMode = SFRM_Materialize;
+	resultSet->setResult = tupleStore;
+	resultSet->setDesc = tupleDescriptor;
+	MemoryContextSwitchTo(oldContext);
+
+	BackgroundWorkerJobStats jobStats[MAX_BACKGROUND_WORKER_JOBS];
+	memset(jobStats, 0, sizeof(jobStats));
+	if (BackgroundWorkerShmem != NULL)
+	{
+		SpinLockAcquire(&BackgroundWorkerShmem->statsLock);
+		memcpy(jobStats, BackgroundWorkerShmem->jobStats, sizeof(jobStats));
+		SpinLockRelease(&BackgroundWorkerShmem->statsLock);
+	}
+
+	Datum values[12];
+	bool isNulls[12];
+	for (int i = 0; i < JobEntries; i++)
+	{
+		memset(isNulls, false, sizeof(isNulls));
+
+		values[0] = Int32GetDatum(JobRegistry[i].jobId);
+		values[1] = CStringGetTextDatum(JobRegistry[i].jobName);
+		values[2] = Int32GetDatum(JobRegistry[i].priority);
+		values[3] = Int32GetDatum(GetMaxConcurrentExecutions(&JobRegistry[i]));
+		values[4] = Int32GetDatum(jobStats[i].runningExecutions);
+		values[5] = Int64GetDatum((int64) jobStats[i].totalExecutions);
+		values[6] = Int64GetDatum((int64) jobStats[i].failedExecutions);
+		values[7] = Int64GetDatum((int64) jobStats[i].timedOutExecutions);
+		values[8] = Int64GetDatum((int64) jobStats[i].deferredExecutions);
+		values[9] = TimestampTzGetDatum(jobStats[i].lastStartTime);
+		isNulls[9] = jobStats[i].lastStartTime == 0;
+		values[10] = TimestampTzGetDatum(jobStats[i].lastEndTime);
+		isNulls[10] = jobStats[i].lastEndTime == 0;
+		values[11] = Int64GetDatum(jobStats[i].lastDurationMs);
+		isNulls[11] = jobStats[i].lastEndTime == 0;
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	PG_RETURN_VOID();
 }
 
 
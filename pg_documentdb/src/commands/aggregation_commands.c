@@ -27,11 +27,25 @@
 #include <aggregation/bson_aggregation_pipeline.h>
 #include "aggregation/aggregation_commands.h"
 #include "infrastructure/cursor_store.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/tailable_cursor_notifications.h"
+#include "metadata/collection.h"
+#include "commands/commands_common.h"
+#include "query/bson_compare.h"
+#include <utils/acl.h>
+#include <utils/rls.h>
+#include <utils/snapmgr.h>
+#include <utils/timestamp.h>
 
 
 extern bool EnableNowSystemVariable;
 extern bool UseFileBasedPersistedCursors;
 extern bool EnableDelayedHoldPortal;
+extern bool EnableDirectPointReads;
+extern bool EnableCompactCursorContinuation;
+
+/* The largest $in list on _id served without generating a query */
+#define MAX_DIRECT_POINT_READ_IDS 100
 
 /* --------------------------------------------------------- */
 /* Data types */
@@ -165,6 +179,11 @@ static Datum HandleFirstPageRequest(pgbson *querySpec, int64_t cursorId,
 									QueryKind queryKind, Query *query);
 
 static int64_t GenerateCursorId(int64_t inputValue);
+static uint64 GetTailableCursorCollectionId(text *database, const char *namespaceName);
+static bool TryHandleDirectPointReadFind(text *database, pgbson *findSpec,
+										 Datum *response);
+static bool TryParseDirectPointReadFilter(const bson_value_t *filter, List **idValues);
+static bool IsDirectPointReadIdValue(const bson_value_t *idValue);
 
 
 /* --------------------------------------------------------- */
@@ -202,6 +221,7 @@ aggregate_cursor_first_page(text *database, pgbson *aggregationSpec,
 							int64_t cursorId)
 {
 	ReportFeatureUsage(FEATURE_COMMAND_AGG_CURSOR_FIRST_PAGE);
+	ReportCommandActivity("aggregate", "command", database, aggregationSpec);
 
 	bool generateCursorParams = true;
 	bool setStatementTimeout = true;
@@ -211,6 +231,7 @@ aggregate_cursor_first_page(text *database, pgbson *aggregationSpec,
 
 	Datum response = HandleFirstPageRequest(aggregationSpec, cursorId, &queryData,
 											QueryKind_Aggregate, query);
+	ReportCommandLatency(CommandLatencyKind_Aggregate);
 	return response;
 }
 
@@ -235,6 +256,15 @@ Datum
 find_cursor_first_page(text *database, pgbson *findSpec, int64_t cursorId)
 {
 	ReportFeatureUsage(FEATURE_COMMAND_FIND_CURSOR_FIRST_PAGE);
+	ReportCommandActivity("find", "query", database, findSpec);
+
+	Datum directPointReadResponse;
+	if (EnableDirectPointReads &&
+		TryHandleDirectPointReadFind(database, findSpec, &directPointReadResponse))
+	{
+		ReportCommandLatency(CommandLatencyKind_Find);
+		return directPointReadResponse;
+	}
 
 	/* Parse the find spec for the purposes of query execution */
 	QueryData queryData = GenerateFirstPageQueryData();
@@ -247,10 +277,300 @@ find_cursor_first_page(text *database, pgbson *findSpec, int64_t cursorId)
 	Datum response = HandleFirstPageRequest(
 		findSpec, cursorId, &queryData,
 		QueryKind_Find, query);
+	ReportCommandLatency(CommandLatencyKind_Find);
 	return response;
 }
 
 
+/*
+ * Serves a find that only filters on _id ({ _id: <value> }, { _id: { $eq: <value> } }
+ * or { _id: { $in: [ <values> ] } }) on an unsharded collection straight from the
+ * primary key index, without generating or planning a query. Returns false if the
+ * spec has anything else (projection, sort, limit, collation, hint ...) or the
+ * collection can't be read locally, in which case the caller goes through the query.
+ */
+static bool
+TryHandleDirectPointReadFind(text *database, pgbson *findSpec, Datum *response)
+{
+	bson_iter_t findIterator;
+	PgbsonInitIterator(findSpec, &findIterator);
+
+	StringView collectionName = { 0 };
+	bson_value_t filter = { 0 };
+	bson_value_t maxTimeMS = { 0 };
+	int32_t batchSize = DefaultCursorFirstPageBatchSize;
+	while (bson_iter_next(&findIterator))
+	{
+		const char *key = bson_iter_key(&findIterator);
+		const bson_value_t *value = bson_iter_value(&findIterator);
+		if (strcmp(key, "find") == 0)
+		{
+			if (value->value_type != BSON_TYPE_UTF8)
+			{
+				return false;
+			}
+
+			collectionName.string = value->value.v_utf8.str;
+			collectionName.length = value->value.v_utf8.len;
+		}
+		else if (strcmp(key, "filter") == 0)
+		{
+			filter = *value;
+		}
+		else if (strcmp(key, "batchSize") == 0)
+		{
+			if (!BsonValueIsNumber(value))
+			{
+				return false;
+			}
+
+			batchSize = BsonValueAsInt32(value);
+		}
+		else if (strcmp(key, "maxTimeMS") == 0)
+		{
+			maxTimeMS = *value;
+		}
+		else if (strcmp(key, "$db") == 0)
+		{
+			if (database == NULL)
+			{
+				if (value->value_type != BSON_TYPE_UTF8)
+				{
+					return false;
+				}
+
+				database = cstring_to_text_with_len(value->value.v_utf8.str,
+													value->value.v_utf8.len);
+			}
+		}
+		else if (strcmp(key, "singleBatch") != 0 && strcmp(key, "lsid") != 0 &&
+				 strcmp(key, "$clusterTime") != 0 &&
+				 strcmp(key, "$readPreference") != 0)
+		{
+			return false;
+		}
+	}
+
+	List *idValues = NIL;
+	if (database == NULL || collectionName.length == 0 ||
+		filter.value_type != BSON_TYPE_DOCUMENT || batchSize < 1 ||
+		!TryParseDirectPointReadFilter(&filter, &idValues) ||
+		list_length(idValues) > batchSize)
+	{
+		return false;
+	}
+
+	Datum collectionNameDatum = PointerGetDatum(
+		cstring_to_text_with_len(collectionName.string, collectionName.length));
+	MongoCollection *collection = GetMongoCollectionOrViewByNameDatum(
+		PointerGetDatum(database), collectionNameDatum, AccessShareLock);
+	if (collection == NULL || collection->viewDefinition != NULL ||
+		collection->shardKey != NULL)
+	{
+		return false;
+	}
+
+	/* Read the same table the query would: The local shard if there's one */
+	Oid relationId = TryGetCollectionShardTable(collection, AccessShareLock);
+	if (relationId == InvalidOid)
+	{
+		if (!DefaultInlineWriteOperations)
+		{
+			return false;
+		}
+
+		relationId = collection->relationId;
+	}
+
+	/* Let the query path report permission errors and apply row level security */
+	if (pg_class_aclcheck(relationId, GetUserId(), ACL_SELECT) != ACLCHECK_OK ||
+		check_enable_rls(relationId, InvalidOid, true) != RLS_NONE)
+	{
+		return false;
+	}
+
+	List *objectIds = NIL;
+	ListCell *idCell;
+	foreach(idCell, idValues)
+	{
+		pgbsonelement objectIdElement = {
+			.path = "",
+			.pathLength = 0,
+			.bsonValue = *(bson_value_t *) lfirst(idCell)
+		};
+		objectIds = lappend(objectIds, PgbsonElementToPgbson(&objectIdElement));
+	}
+
+	if (maxTimeMS.value_type != BSON_TYPE_EOD)
+	{
+		EnsureTopLevelFieldIsNumberLike("find.maxTimeMS", &maxTimeMS);
+		SetExplicitStatementTimeout(BsonValueAsInt32(&maxTimeMS));
+	}
+
+	pgbson_writer writer;
+	pgbson_writer cursorDoc;
+	pgbson_array_writer arrayWriter;
+
+	/* min bson size is 5 (see IsPgbsonEmptyDocument) */
+	uint32_t accumulatedSize = 5;
+	bool isFirstPage = true;
+	const char *namespaceName = psprintf("%.*s.%.*s",
+										 (int) VARSIZE_ANY_EXHDR(database),
+										 VARDATA_ANY(database),
+										 (int) collectionName.length,
+										 collectionName.string);
+	SetupCursorPagePreamble(&writer, &cursorDoc, &arrayWriter, namespaceName,
+							isFirstPage, &accumulatedSize);
+
+	if (!TryDrainDirectPointRead(relationId, (int64) collection->collectionId,
+								 objectIds, accumulatedSize, &arrayWriter))
+	{
+		return false;
+	}
+
+	ReportFeatureUsage(FEATURE_CURSOR_TYPE_POINT_READ);
+
+	/* See sql/udfs/commands_crud/query_cursors_aggregate--latest.sql */
+	AttrNumber maxOutAttrNum = 4;
+	TupleDesc tupleDesc = ConstructCursorResultTupleDesc(maxOutAttrNum);
+
+	int64_t cursorId = 0;
+	pgbson *continuationDoc = NULL;
+	bool persistConnection = false;
+	pgbson *postBatchResumeToken = NULL;
+	*response = PostProcessCursorPage(&cursorDoc, &arrayWriter, &writer, cursorId,
+									  continuationDoc, persistConnection,
+									  postBatchResumeToken, tupleDesc);
+	return true;
+}
+
+
+/*
+ * Extracts the _id values of a { _id: <value> }, { _id: { $eq: <value> } } or
+ * { _id: { $in: [ <values> ] } } filter. Values that the primary key can't look
+ * up by equality on their own (null, regex, arrays, documents ...) are not
+ * accepted, and equal values in $in are only looked up once.
+ */
+static bool
+TryParseDirectPointReadFilter(const bson_value_t *filter, List **idValues)
+{
+	bson_iter_t filterIterator;
+	BsonValueInitIterator(filter, &filterIterator);
+	pgbsonelement filterElement;
+	if (!TryGetSinglePgbsonElementFromBsonIterator(&filterIterator, &filterElement) ||
+		strcmp(filterElement.path, "_id") != 0)
+	{
+		return false;
+	}
+
+	if (filterElement.bsonValue.value_type != BSON_TYPE_DOCUMENT)
+	{
+		if (!IsDirectPointReadIdValue(&filterElement.bsonValue))
+		{
+			return false;
+		}
+
+		bson_value_t *idValue = palloc(sizeof(bson_value_t));
+		*idValue = filterElement.bsonValue;
+		*idValues = list_make1(idValue);
+		return true;
+	}
+
+	bson_iter_t operatorIterator;
+	BsonValueInitIterator(&filterElement.bsonValue, &operatorIterator);
+	pgbsonelement operatorElement;
+	if (!TryGetSinglePgbsonElementFromBsonIterator(&operatorIterator, &operatorElement))
+	{
+		return false;
+	}
+
+	if (strcmp(operatorElement.path, "$eq") == 0)
+	{
+		if (!IsDirectPointReadIdValue(&operatorElement.bsonValue))
+		{
+			return false;
+		}
+
+		bson_value_t *idValue = palloc(sizeof(bson_value_t));
+		*idValue = operatorElement.bsonValue;
+		*idValues = list_make1(idValue);
+		return true;
+	}
+
+	if (strcmp(operatorElement.path, "$in") != 0 ||
+		operatorElement.bsonValue.value_type != BSON_TYPE_ARRAY)
+	{
+		return false;
+	}
+
+	bson_iter_t inIterator;
+	BsonValueInitIterator(&operatorElement.bsonValue, &inIterator);
+	while (bson_iter_next(&inIterator))
+	{
+		const bson_value_t *inValue = bson_iter_value(&inIterator);
+		if (!IsDirectPointReadIdValue(inValue))
+		{
+			return false;
+		}
+
+		bool isDuplicate = false;
+		ListCell *idCell;
+		foreach(idCell, *idValues)
+		{
+			bool isComparisonValid = true;
+			if (CompareBsonValueAndType(lfirst(idCell), inValue,
+										&isComparisonValid) == 0 &&
+				isComparisonValid)
+			{
+				isDuplicate = true;
+				break;
+			}
+		}
+
+		if (isDuplicate)
+		{
+			continue;
+		}
+
+		if (list_length(*idValues) >= MAX_DIRECT_POINT_READ_IDS)
+		{
+			return false;
+		}
+
+		bson_value_t *idValue = palloc(sizeof(bson_value_t));
+		*idValue = *inValue;
+		*idValues = lappend(*idValues, idValue);
+	}
+
+	return *idValues != NIL;
+}
+
+
+static bool
+IsDirectPointReadIdValue(const bson_value_t *idValue)
+{
+	switch (idValue->value_type)
+	{
+		case BSON_TYPE_DOCUMENT:
+		case BSON_TYPE_ARRAY:
+		case BSON_TYPE_REGEX:
+		case BSON_TYPE_NULL:
+		case BSON_TYPE_UNDEFINED:
+		case BSON_TYPE_MINKEY:
+		case BSON_TYPE_MAXKEY:
+		case BSON_TYPE_EOD:
+		{
+			return false;
+		}
+
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+
 /*
  * Parses a listCollections spec and creates a query, executes it and returns the first page
  * along with the cursor information associated with the listCollections query.
@@ -344,6 +664,7 @@ command_cursor_get_more(PG_FUNCTION_ARGS)
 	AttrNumber maxOutAttrNum = 2;
 	Datum responseDatum = aggregation_cursor_get_more(database, getMoreSpec,
 													  cursorSpec, maxOutAttrNum);
+	ReportCommandLatency(CommandLatencyKind_GetMore);
 	PG_RETURN_DATUM(responseDatum);
 }
 
@@ -510,11 +831,54 @@ aggregation_cursor_get_more(text *database, pgbson *getMoreSpec,
 											 generateCursorParams, setStatementTimeout);
 			HTAB *cursorMap = CreateTailableCursorHashSet();
 			BuildTailableCursorContinuationMap(cursorSpec, cursorMap);
+
+			/*
+			 * With maxAwaitTimeMS, a getMore that finds no new data waits for a
+			 * write to the collection to commit and queries again, until the
+			 * await time expires. The write generation is read before the first
+			 * query so that writes that commit while it runs are not missed.
+			 */
+			uint64 awaitCollectionId = 0;
+			uint64 writeGeneration = 0;
+			TimestampTz awaitDeadline = 0;
+			if (EnableTailableCursorAwaitData &&
+				getMoreInfo.queryData.maxAwaitTimeMS > 0)
+			{
+				awaitCollectionId = GetTailableCursorCollectionId(
+					database, getMoreInfo.queryData.namespaceName);
+				writeGeneration = GetCollectionWriteGeneration(awaitCollectionId);
+				awaitDeadline = TimestampTzPlusMilliseconds(
+					GetCurrentTimestamp(), getMoreInfo.queryData.maxAwaitTimeMS);
+			}
+
 			int numIterations = 0;
-			postBatchResumeToken = DrainTailableQuery(cursorMap, query,
+			postBatchResumeToken = DrainTailableQuery(cursorMap, copyObject(query),
 													  getMoreInfo.queryData.batchSize,
 													  &numIterations,
 													  accumulatedSize, &arrayWriter);
+			while (awaitCollectionId != 0 && PgbsonArrayWriterGetIndex(&arrayWriter) == 0)
+			{
+				long remainingMs = TimestampDifferenceMilliseconds(GetCurrentTimestamp(),
+																   awaitDeadline);
+				if (!WaitForCollectionWrite(awaitCollectionId, writeGeneration,
+											remainingMs))
+				{
+					break;
+				}
+
+				writeGeneration = GetCollectionWriteGeneration(awaitCollectionId);
+
+				/* Query with a new snapshot that sees the writes committed since */
+				PushActiveSnapshot(GetTransactionSnapshot());
+				postBatchResumeToken = DrainTailableQuery(cursorMap, copyObject(query),
+														  getMoreInfo.queryData.
+														  batchSize,
+														  &numIterations,
+														  accumulatedSize,
+														  &arrayWriter);
+				PopActiveSnapshot();
+			}
+
 			continuationDoc = BuildStreamingContinuationDocument(cursorMap,
 																 getMoreInfo.querySpec,
 																 getMoreInfo.cursorId,
@@ -553,6 +917,7 @@ command_distinct_query(PG_FUNCTION_ARGS)
 
 	text *database = PG_GETARG_TEXT_P(0);
 	pgbson *distinctSpec = PG_GETARG_PGBSON(1);
+	ReportCommandActivity("distinct", "command", database, distinctSpec);
 
 	bool setStatementTimeout = true;
 	Query *query = GenerateDistinctQuery(database, distinctSpec, setStatementTimeout);
@@ -568,6 +933,7 @@ command_distinct_query(PG_FUNCTION_ARGS)
 		response = PgbsonWriterGetPgbson(&defaultWriter);
 	}
 
+	ReportCommandLatency(CommandLatencyKind_Distinct);
 	PG_RETURN_POINTER(response);
 }
 
@@ -583,6 +949,7 @@ command_count_query(PG_FUNCTION_ARGS)
 
 	text *database = PG_GETARG_TEXT_P(0);
 	pgbson *countSpec = PG_GETARG_PGBSON(1);
+	ReportCommandActivity("count", "command", database, countSpec);
 
 	bool setStatementTimeout = true;
 	Query *query = GenerateCountQuery(database, countSpec, setStatementTimeout);
@@ -598,6 +965,7 @@ command_count_query(PG_FUNCTION_ARGS)
 		response = PgbsonWriterGetPgbson(&defaultWriter);
 	}
 
+	ReportCommandLatency(CommandLatencyKind_Count);
 	PG_RETURN_POINTER(response);
 }
 
@@ -686,6 +1054,7 @@ HandleFirstPageRequest(pgbson *querySpec, int64_t cursorId,
 			ReportFeatureUsage(FEATURE_CURSOR_TYPE_SINGLE_BATCH);
 			CreateAndDrainSingleBatchQuery("singleBatchCursor", query,
 										   queryData->batchSize,
+										   queryData->maxParallelWorkers,
 										   &numIterations,
 										   accumulatedSize, &arrayWriter);
 			queryFullyDrained = true;
@@ -781,6 +1150,8 @@ HandleFirstPageRequest(pgbson *querySpec, int64_t cursorId,
 																			   query,
 																			   queryData->
 																			   batchSize,
+																			   queryData->
+																			   maxParallelWorkers,
 																			   &
 																			   numIterations,
 																			   accumulatedSize,
@@ -906,6 +1277,10 @@ BuildStreamingContinuationDocument(HTAB *cursorMap, pgbson *querySpec, int64_t c
 	{
 		SerializeTailableContinuationsToWriter(&writer, cursorMap);
 	}
+	else if (EnableCompactCursorContinuation)
+	{
+		SerializeCompactContinuationsToWriter(&writer, cursorMap);
+	}
 	else
 	{
 		SerializeContinuationsToWriter(&writer, cursorMap);
@@ -1142,6 +1517,29 @@ ParseGetMoreSpec(text **databaseName, pgbson *getMoreSpec, pgbson *cursorSpec,
 }
 
 
+/*
+ * Returns the collectionId of the collection a tailable cursor reads, 0 if it
+ * does not read a single existing collection.
+ */
+static uint64
+GetTailableCursorCollectionId(text *database, const char *namespaceName)
+{
+	uint32_t databaseLength = VARSIZE_ANY_EXHDR(database);
+	if (namespaceName == NULL || strlen(namespaceName) <= databaseLength + 1)
+	{
+		return 0;
+	}
+
+	/* The namespace is database.collection */
+	const char *collectionName = namespaceName + databaseLength + 1;
+	MongoCollection *collection =
+		GetMongoCollectionByNameDatum(PointerGetDatum(database),
+									  CStringGetTextDatum(collectionName),
+									  AccessShareLock);
+	return collection != NULL ? collection->collectionId : 0;
+}
+
+
 /*
  * Creates a unique cursorId if one isn't provided.
  */
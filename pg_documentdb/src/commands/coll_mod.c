@@ -15,6 +15,7 @@
 #include <utils/lsyscache.h>
 
 #include "commands/parse_error.h"
+#include "commands/columnar_projection.h"
 #include "commands/commands_common.h"
 #include "utils/documentdb_errors.h"
 #include "metadata/collection.h"
@@ -67,6 +68,12 @@ typedef struct
 	/* The validation action for the collection */
 	char *validationAction;
 
+	/* The compression method for the collection's documents */
+	char *documentCompression;
+
+	/* The paths kept by the columnar projection store, NIL to drop it */
+	List *columnarPaths;
+
 	/* TODO: Add more options when they are supported e.g.: Validators etc */
 } CollModOptions;
 
@@ -89,6 +96,12 @@ typedef enum CollModSpecFlags
 	/* validation update */
 	HAS_VALIDATION_OPTION = 1 << 7,
 
+	/* document compression update */
+	HAS_DOCUMENT_COMPRESSION = 1 << 8,
+
+	/* columnar projection store update */
+	HAS_COLUMNAR_PATHS = 1 << 9,
+
 	/* TODO: More OPTIONS to follow */
 } CollModSpecFlags;
 
@@ -112,7 +125,6 @@ static void ModifyViewDefinition(Datum databaseDatum,
 								 pgbson_writer *writer);
 static bool GetHiddenFlagFromOptions(pgbson *indexOptions);
 static pgbson * UpdateHiddenInIndexOptions(pgbson *indexOptions, bool hidden);
-static void UpdatePostgresIndex(uint64_t collectionId, int indexId, bool hidden);
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -259,6 +271,25 @@ command_coll_mod(PG_FUNCTION_ARGS)
 							   collModOptions.validationAction);
 	}
 
+	if (specFlags & HAS_DOCUMENT_COMPRESSION)
+	{
+		ReportFeatureUsage(FEATURE_COMMAND_COLLMOD_DOCUMENT_COMPRESSION);
+		SetCollectionDocumentCompression(collection,
+										 collModOptions.documentCompression);
+	}
+
+	if (specFlags & HAS_COLUMNAR_PATHS)
+	{
+		ReportFeatureUsage(FEATURE_COMMAND_COLLMOD_COLUMNAR_PATHS);
+		if (collection->viewDefinition != NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+							errmsg("Cannot specify columnarPaths on a view")));
+		}
+
+		SetCollectionColumnarProjection(collection, collModOptions.columnarPaths);
+	}
+
 	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
 }
 
@@ -342,6 +373,18 @@ ParseSpecSetCollModOptions(const pgbson *collModSpec,
 																				 &
 																				 hasSchemaValidation);
 		}
+		else if (strcmp(key, "documentCompression") == 0)
+		{
+			collModOptions->documentCompression = ParseAndGetDocumentCompressionOption(
+				&iter, "collMod.documentCompression");
+			specFlags |= HAS_DOCUMENT_COMPRESSION;
+		}
+		else if (strcmp(key, "columnarPaths") == 0)
+		{
+			collModOptions->columnarPaths = ParseColumnarProjectionPaths(
+				&iter, "collMod.columnarPaths");
+			specFlags |= HAS_COLUMNAR_PATHS;
+		}
 		else if (IsCommonSpecIgnoredField(key))
 		{
 			/*
@@ -785,7 +828,11 @@ UpdateHiddenInIndexOptions(pgbson *indexOptions, bool hidden)
 }
 
 
-static void
+/*
+ * UpdatePostgresIndex hides the index with indexId from queries (or makes it
+ * visible again). A hidden index is still maintained by the writes.
+ */
+void
 UpdatePostgresIndex(uint64_t collectionId, int indexId, bool hidden)
 {
 	/* First get the OID of the index */
@@ -58,6 +58,24 @@ typedef struct
 	int32 ok;
 } CollStatsResult;
 
+
+/*
+ * The totals of the worker results of a collStats, summed up as each
+ * worker returns.
+ */
+typedef struct
+{
+	int64 totalRelationSize;
+	int64 totalTableSize;
+	int64 totalDocCount;
+	int64 totalDocCountFromStats;
+	int64 totalDocColumnSize;
+	int64 totalDocColumnSizeFromStats;
+
+	/* The pgbsonelement { "indexName": (int64) indexSize } size of each index */
+	HTAB *indexSizesHash;
+} CollStatsMergeState;
+
 typedef enum CollStatsAggMode
 {
 	CollStatsAggMode_None = 0x0,
@@ -80,9 +98,12 @@ static void BuildResultData(Datum databaseName, Datum collectionName,
 
 
 static pgbson * CollStatsCoordinator(Datum databaseName, Datum collectionName, int scale);
-static void MergeWorkerResults(CollStatsResult *result, MongoCollection *collection,
-							   List *workerResults, int scale);
-static pgbson * MergeWorkerIndexDocs(MongoCollection *collection, List *workerIndexDocs,
+static void MergeWorkerResult(pgbson *workerBson, void *state);
+static void MergeWorkerIndexSizes(CollStatsMergeState *mergeState,
+								  const bson_value_t *indexSizes);
+static void FinalizeWorkerResults(CollStatsResult *result, MongoCollection *collection,
+								  CollStatsMergeState *mergeState, int scale);
+static pgbson * MergeWorkerIndexDocs(MongoCollection *collection, HTAB *bsonElementHash,
 									 int32 scale, int *indexCount);
 static pgbson * CollStatsWorker(void *fcinfoPointer);
 static void GetPostgresRelationSizes(ArrayType *relationIds, int64 *totalRelationSize,
@@ -327,12 +348,19 @@ CollStatsCoordinator(Datum databaseName, Datum collectionName, int scale)
 					 (int) VARSIZE_ANY_EXHDR(collectionName),
 					 (char *) VARDATA_ANY(collectionName));
 
+	StringInfo cacheKey = makeStringInfo();
+	appendStringInfo(cacheKey, "collStats.%d.%s", scale, namespaceString->data);
+	pgbson *response = GetCachedDiagnosticResponse(cacheKey->data);
+	if (response != NULL)
+	{
+		return response;
+	}
+
 	CollStatsResult result = { 0 };
 	result.ns = namespaceString->data;
 	result.scaleFactor = scale;
 	result.ok = 1;
 
-	pgbson *response;
 	MongoCollection *collection =
 		GetMongoCollectionByNameDatum(databaseName,
 									  collectionName,
@@ -345,6 +373,7 @@ CollStatsCoordinator(Datum databaseName, Datum collectionName, int scale)
 	{
 		BuildResultData(databaseName, collectionName, &result, collection, scale);
 		response = BuildResponseMessage(&result);
+		AddDiagnosticResponseToCache(cacheKey->data, response);
 	}
 
 	return response;
@@ -360,126 +389,169 @@ static void
 BuildResultData(Datum databaseName, Datum collectionName, CollStatsResult *result,
 				MongoCollection *collection, int32 scale)
 {
-	List *workerBsons;
+	CollStatsMergeState mergeState = { 0 };
+	mergeState.indexSizesHash = CreatePgbsonElementHashSet();
+
+	/* Sum up the worker BSON results as they arrive */
 	int numValues = 3;
 	Datum values[3] = { databaseName, collectionName, Int32GetDatum(scale) };
 	Oid types[3] = { TEXTOID, TEXTOID, INT4OID };
-	workerBsons = RunQueryOnAllServerNodes("CollStats", values, types, numValues,
-										   command_coll_stats_worker,
-										   ApiToApiInternalSchemaName,
-										   "coll_stats_worker");
-
-	/* Now that we have the worker BSON results, merge them to the final one */
-	MergeWorkerResults(result, collection, workerBsons, scale);
+	RunQueryOnAllServerNodesStreaming("CollStats", values, types, numValues,
+									  command_coll_stats_worker,
+									  ApiToApiInternalSchemaName,
+									  "coll_stats_worker",
+									  MergeWorkerResult, &mergeState);
+
+	/* Now that we have all the worker totals, build the final one */
+	FinalizeWorkerResults(result, collection, &mergeState, scale);
 }
 
 
 /*
- * Given a List of bsons that were dispatched by the query workers,
- * and a given collection & scale, merges the results into the target
- * CollStatsResult struct.
+ * Given a bson that was dispatched by a query worker, adds its statistics
+ * to the totals of the CollStatsMergeState. The worker bson is freed once
+ * it is merged.
  */
 static void
-MergeWorkerResults(CollStatsResult *result, MongoCollection *collection,
-				   List *workerResults, int scale)
+MergeWorkerResult(pgbson *workerBson, void *state)
 {
 	/* To merge the results, we apply each shard's results consecutively until we have everything
 	 * each field is processed by its intent
 	 */
+	CollStatsMergeState *mergeState = (CollStatsMergeState *) state;
+	bson_iter_t workerIter;
+	PgbsonInitIterator(workerBson, &workerIter);
+
+	int64 workerTotalDocCount = 0;
+	int64 workerTotalDocCountFromStats = 0;
+	int32 averageDocSize = 0;
 
-	ListCell *workerCell;
+	int errorCode = 0;
+	const char *errorMessage = NULL;
 
-	result->totalSize = 0;
-	result->storageSize = 0;
-	int64 totalDocCount = 0;
-	int64 totalDocCountFromStats = 0;
-	int64 totalDocColumnSize = 0;
-	int64 totalDocColumnSizeFromStats = 0;
-	List *indexDocs = NIL;
+	while (bson_iter_next(&workerIter))
+	{
+		const char *key = bson_iter_key(&workerIter);
+		if (strcmp(key, ErrCodeKey) == 0)
+		{
+			errorCode = BsonValueAsInt32(bson_iter_value(&workerIter));
+		}
+		else if (strcmp(key, ErrMsgKey) == 0)
+		{
+			const char *string = bson_iter_utf8(&workerIter, NULL);
+			errorMessage = pstrdup(string);
+		}
+		else if (strcmp(key, "total_rel_size") == 0)
+		{
+			/* associative - sum up across nodes */
+			int64 value = BsonValueAsInt64(bson_iter_value(&workerIter));
+			mergeState->totalRelationSize += value;
+		}
+		else if (strcmp(key, "total_tbl_size") == 0)
+		{
+			/* associative - sum up across nodes */
+			int64 value = BsonValueAsInt64(bson_iter_value(&workerIter));
+			mergeState->totalTableSize += value;
+		}
+		else if (strcmp(key, "total_doc_count") == 0)
+		{
+			/*
+			 * Sum up from total docs - note we don't persist this
+			 * since we may need to go to the runtime.
+			 */
+			workerTotalDocCount = BsonValueAsInt64(bson_iter_value(&workerIter));
+		}
+		else if (strcmp(key, "total_stats_doc_count") == 0)
+		{
+			/*
+			 * Sum up from total docs - note we don't persist this
+			 * since we may need to go to the runtime.
+			 */
+			workerTotalDocCountFromStats = BsonValueAsInt64(bson_iter_value(
+																&workerIter));
+		}
+		else if (strcmp(key, "avg_doc_size") == 0)
+		{
+			averageDocSize = BsonValueAsInt32(bson_iter_value(&workerIter));
+		}
+		else if (strcmp(key, "index_sizes") == 0)
+		{
+			MergeWorkerIndexSizes(mergeState, bson_iter_value(&workerIter));
+		}
+		else
+		{
+			ereport(ERROR, (errmsg("unknown field received from collstats worker %s",
+								   key)));
+		}
+	}
 
-	foreach(workerCell, workerResults)
+	if (errorMessage != NULL)
 	{
-		pgbson *workerBson = lfirst(workerCell);
-		bson_iter_t workerIter;
-		PgbsonInitIterator(workerBson, &workerIter);
+		errorCode = errorCode == 0 ? ERRCODE_DOCUMENTDB_INTERNALERROR : errorCode;
+		ereport(ERROR, (errcode(errorCode), errmsg("Error running collstats %s",
+												   errorMessage)));
+	}
+
+	mergeState->totalDocColumnSize += (averageDocSize * workerTotalDocCount);
+	mergeState->totalDocCount += workerTotalDocCount;
+	mergeState->totalDocCountFromStats += workerTotalDocCountFromStats;
+	mergeState->totalDocColumnSizeFromStats += (averageDocSize *
+												workerTotalDocCountFromStats);
+
+	pfree(workerBson);
+}
 
-		int64 workerTotalDocCount = 0;
-		int64 workerTotalDocCountFromStats = 0;
-		int32 averageDocSize = 0;
 
-		int errorCode = 0;
-		const char *errorMessage = NULL;
+/*
+ * As part of the worker merge, each worker sends back a document of index sizes:
+ * For each index, add the { "indexName": (int64)indexSize } into the bsonElement
+ * hash. If the entry for that indexName already exists, add to the existing size.
+ * The names are copied since the worker bson doesn't outlive its merge.
+ */
+static void
+MergeWorkerIndexSizes(CollStatsMergeState *mergeState, const bson_value_t *indexSizes)
+{
+	bson_iter_t indexDocIter;
+	BsonValueInitIterator(indexSizes, &indexDocIter);
 
-		while (bson_iter_next(&workerIter))
+	while (bson_iter_next(&indexDocIter))
+	{
+		pgbsonelement element = { 0 };
+		element.path = bson_iter_key(&indexDocIter);
+		element.pathLength = bson_iter_key_len(&indexDocIter);
+		element.bsonValue = *bson_iter_value(&indexDocIter);
+
+		bool found = false;
+		pgbsonelement *foundVal = hash_search(mergeState->indexSizesHash, &element,
+											  HASH_ENTER, &found);
+		if (found)
 		{
-			const char *key = bson_iter_key(&workerIter);
-			if (strcmp(key, ErrCodeKey) == 0)
-			{
-				errorCode = BsonValueAsInt32(bson_iter_value(&workerIter));
-			}
-			else if (strcmp(key, ErrMsgKey) == 0)
-			{
-				const char *string = bson_iter_utf8(&workerIter, NULL);
-				errorMessage = pstrdup(string);
-			}
-			else if (strcmp(key, "total_rel_size") == 0)
-			{
-				/* associative - sum up across nodes */
-				int64 value = BsonValueAsInt64(bson_iter_value(&workerIter));
-				result->totalSize += value;
-			}
-			else if (strcmp(key, "total_tbl_size") == 0)
-			{
-				/* associative - sum up across nodes */
-				int64 value = BsonValueAsInt64(bson_iter_value(&workerIter));
-				result->storageSize += value;
-			}
-			else if (strcmp(key, "total_doc_count") == 0)
-			{
-				/*
-				 * Sum up from total docs - note we don't persist this
-				 * since we may need to go to the runtime.
-				 */
-				workerTotalDocCount = BsonValueAsInt64(bson_iter_value(&workerIter));
-			}
-			else if (strcmp(key, "total_stats_doc_count") == 0)
-			{
-				/*
-				 * Sum up from total docs - note we don't persist this
-				 * since we may need to go to the runtime.
-				 */
-				workerTotalDocCountFromStats = BsonValueAsInt64(bson_iter_value(
-																	&workerIter));
-			}
-			else if (strcmp(key, "avg_doc_size") == 0)
-			{
-				averageDocSize = BsonValueAsInt32(bson_iter_value(&workerIter));
-			}
-			else if (strcmp(key, "index_sizes") == 0)
-			{
-				bson_value_t *value = palloc(sizeof(bson_value_t));
-				*value = *bson_iter_value(&workerIter);
-				indexDocs = lappend(indexDocs, value);
-			}
-			else
-			{
-				ereport(ERROR, (errmsg("unknown field received from collstats worker %s",
-									   key)));
-			}
+			bool overflowedIgnore = false;
+			AddNumberToBsonValue(&foundVal->bsonValue, &element.bsonValue,
+								 &overflowedIgnore);
 		}
-
-		if (errorMessage != NULL)
+		else
 		{
-			errorCode = errorCode == 0 ? ERRCODE_DOCUMENTDB_INTERNALERROR : errorCode;
-			ereport(ERROR, (errcode(errorCode), errmsg("Error running collstats %s",
-													   errorMessage)));
+			foundVal->path = pnstrdup(element.path, element.pathLength);
 		}
-
-		totalDocColumnSize += (averageDocSize * workerTotalDocCount);
-		totalDocCount += workerTotalDocCount;
-		totalDocCountFromStats += workerTotalDocCountFromStats;
-		totalDocColumnSizeFromStats += (averageDocSize * workerTotalDocCountFromStats);
 	}
+}
+
+
+/*
+ * Given the totals merged from the query workers, and a given collection
+ * & scale, computes the results into the target CollStatsResult struct.
+ */
+static void
+FinalizeWorkerResults(CollStatsResult *result, MongoCollection *collection,
+					  CollStatsMergeState *mergeState, int scale)
+{
+	result->totalSize = mergeState->totalRelationSize;
+	result->storageSize = mergeState->totalTableSize;
+	int64 totalDocCount = mergeState->totalDocCount;
+	int64 totalDocCountFromStats = mergeState->totalDocCountFromStats;
+	int64 totalDocColumnSize = mergeState->totalDocColumnSize;
+	int64 totalDocColumnSizeFromStats = mergeState->totalDocColumnSizeFromStats;
 
 	bool isSmallCollection = false;
 	int64 docCountResult;
@@ -553,54 +625,22 @@ MergeWorkerResults(CollStatsResult *result, MongoCollection *collection,
 	bool inProgressOnly = true;
 	List *indexBuilds = CollectionIdGetIndexNames(collection->collectionId,
 												  excludeIdIndex, inProgressOnly);
-	result->indexSizes = MergeWorkerIndexDocs(collection, indexDocs, scale,
-											  &result->nindexes);
+	result->indexSizes = MergeWorkerIndexDocs(collection, mergeState->indexSizesHash,
+											  scale, &result->nindexes);
 	result->indexBuilds = indexBuilds;
 }
 
 
 /*
- * As part of the worker merge, each worker sends back a list of index sizes.
- * Here we need to merge all the index sizes into a common document
- * that is ordered by index name from the collection_indexes table (for stability).
+ * Once all the index sizes of the workers are merged, we need to write them into a
+ * common document that is ordered by index name from the collection_indexes table
+ * (for stability).
  */
 static pgbson *
-MergeWorkerIndexDocs(MongoCollection *collection, List *workerIndexDocs, int32 scale,
+MergeWorkerIndexDocs(MongoCollection *collection, HTAB *bsonElementHash, int32 scale,
 					 int *indexCount)
 {
 	*indexCount = 0;
-	HTAB *bsonElementHash = CreatePgbsonElementHashSet();
-
-	/* First run through the worker index docs -
-	 * For each doc, add the { "indexName": (int64)indexSize }
-	 * into the bsonElement hash. If the entry for that indexName
-	 * already exists, add to the existing size.
-	 */
-	ListCell *indexCell;
-	foreach(indexCell, workerIndexDocs)
-	{
-		bson_value_t *value = lfirst(indexCell);
-		bson_iter_t indexDocIter;
-		BsonValueInitIterator(value, &indexDocIter);
-
-		while (bson_iter_next(&indexDocIter))
-		{
-			pgbsonelement element = { 0 };
-			element.path = bson_iter_key(&indexDocIter);
-			element.pathLength = bson_iter_key_len(&indexDocIter);
-			element.bsonValue = *bson_iter_value(&indexDocIter);
-
-			bool found = false;
-			pgbsonelement *foundVal = hash_search(bsonElementHash, &element, HASH_ENTER,
-												  &found);
-			if (found)
-			{
-				bool overflowedIgnore = false;
-				AddNumberToBsonValue(&foundVal->bsonValue, &element.bsonValue,
-									 &overflowedIgnore);
-			}
-		}
-	}
 
 	/*
 	 * Get the existing set of names (ordered) from the collection_indexes
@@ -0,0 +1,338 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/commands/columnar_projection.c
+ *
+ * Implementation of the columnar projection store of a collection.
+ *
+ * collMod's columnarPaths designates the few paths an analytical workload
+ * reads out of the documents of a collection. The store keeps these paths
+ * (and _id) of every document in a narrow side table laid out like the data
+ * table:
+ *
+ *    columns_<collectionId> (shard_key_value, object_id, document)
+ *
+ * so that aggregation pipelines that only reference these paths can scan the
+ * side table in place of the data table. A row trigger on the data table
+ * maintains the side table on every write; the trigger arguments are also
+ * where the covered paths are read back from, so a data table without the
+ * trigger (e.g. after a reshard) is never substituted.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+#include <commands/trigger.h>
+#include <executor/spi.h>
+#include <utils/builtins.h>
+#include <utils/json.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+
+#include "api_hooks.h"
+#include "commands/columnar_projection.h"
+#include "commands/commands_common.h"
+#include "commands/parse_error.h"
+#include "metadata/metadata_cache.h"
+#include "utils/documentdb_errors.h"
+#include "utils/query_utils.h"
+
+extern bool EnableColumnarProjectionStore;
+
+#define COLUMNAR_PROJECTION_TRIGGER_FORMAT "columnar_projection_" UINT64_FORMAT
+#define COLUMNAR_PROJECTION_TABLE_FORMAT "columns_" UINT64_FORMAT
+
+static char * CreateColumnarProjectionSpec(List *paths);
+static const char * GetColumnarProjectionTriggerSpec(Oid dataTableOid,
+													 uint64 collectionId);
+
+
+/*
+ * Parses the "columnarPaths" option of collMod: an array of the field paths
+ * to keep in the columnar projection store. An empty array drops the store.
+ * _id is always kept and is skipped if listed.
+ */
+List *
+ParseColumnarProjectionPaths(bson_iter_t *iter, const char *fieldName)
+{
+	if (!EnableColumnarProjectionStore)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("columnarPaths not supported yet")));
+	}
+
+	EnsureTopLevelFieldType(fieldName, iter, BSON_TYPE_ARRAY);
+
+	List *paths = NIL;
+	bson_iter_t pathsIter;
+	bson_iter_recurse(iter, &pathsIter);
+	while (bson_iter_next(&pathsIter))
+	{
+		if (!BSON_ITER_HOLDS_UTF8(&pathsIter))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_TYPEMISMATCH),
+							errmsg("%s must be an array of field paths, found %s",
+								   fieldName,
+								   BsonTypeName(bson_iter_type(&pathsIter)))));
+		}
+
+		StringView path = { 0 };
+		path.string = bson_iter_utf8(&pathsIter, &path.length);
+		if (path.length == 0 || path.string[0] == '$' ||
+			path.string[0] == '.' || path.string[path.length - 1] == '.' ||
+			strstr(path.string, "..") != NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+							errmsg("Invalid path '%.*s' in %s", path.length,
+								   path.string, fieldName)));
+		}
+
+		/* _id is always kept */
+		if (IsPathCoveredByColumnarProjection(&path, NIL))
+		{
+			continue;
+		}
+
+		/* Overlapping paths would collide in the $project of the store */
+		bool collides = IsPathCoveredByColumnarProjection(&path, paths);
+		List *newPathList = list_make1((char *) path.string);
+		ListCell *pathCell;
+		foreach(pathCell, paths)
+		{
+			StringView existingPath = CreateStringViewFromString(lfirst(pathCell));
+			collides = collides ||
+					   IsPathCoveredByColumnarProjection(&existingPath, newPathList);
+		}
+
+		list_free(newPathList);
+		if (collides)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+							errmsg("Path collision at '%s' in %s", path.string,
+								   fieldName)));
+		}
+
+		paths = lappend(paths, pnstrdup(path.string, path.length));
+	}
+
+	return paths;
+}
+
+
+/*
+ * Creates, replaces or (for empty paths) drops the columnar projection store of
+ * the collection. The store is filled from the existing documents; the trigger
+ * is created first so that the writes that commit after the backfill wait on
+ * its lock and are captured.
+ */
+void
+SetCollectionColumnarProjection(const MongoCollection *collection, List *paths)
+{
+	char *dataTableName = psprintf("%s.%s", ApiDataSchemaName, collection->tableName);
+	char *storeTableName = psprintf("%s." COLUMNAR_PROJECTION_TABLE_FORMAT,
+									ApiDataSchemaName, collection->collectionId);
+	char *triggerName = psprintf(COLUMNAR_PROJECTION_TRIGGER_FORMAT,
+								 collection->collectionId);
+
+	StringInfo queryInfo = makeStringInfo();
+	bool readOnly = false;
+	bool isNull = false;
+
+	appendStringInfo(queryInfo, "DROP TRIGGER IF EXISTS %s ON %s", triggerName,
+					 dataTableName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "DROP TABLE IF EXISTS %s", storeTableName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	if (paths == NIL)
+	{
+		return;
+	}
+
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "CREATE TABLE %s ("
+					 "shard_key_value bigint not null,"
+					 "object_id %s.bson not null,"
+					 "document %s.bson not null,"
+					 "PRIMARY KEY (shard_key_value, object_id))",
+					 storeTableName, CoreSchemaName, CoreSchemaName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	/* The writers of the collection maintain it through the trigger */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "ALTER TABLE %s OWNER TO %s", storeTableName,
+					 ApiAdminRole);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	/* Since we're colocating with, shardCount should be 0 */
+	int shardCount = 0;
+	DistributePostgresTable(storeTableName,
+							collection->shardKey != NULL ? "shard_key_value" : NULL,
+							dataTableName, shardCount);
+
+	char *projectionSpec = CreateColumnarProjectionSpec(paths);
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "CREATE TRIGGER %s AFTER INSERT OR UPDATE OR DELETE ON %s"
+					 " FOR EACH ROW EXECUTE FUNCTION %s.maintain_columnar_projection(%s, %s)",
+					 triggerName, dataTableName, ApiInternalSchemaNameV2,
+					 quote_literal_cstr(storeTableName),
+					 quote_literal_cstr(projectionSpec));
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "INSERT INTO %s (shard_key_value, object_id, document)"
+					 " SELECT shard_key_value, object_id, %s.bson_dollar_project(document, $1)"
+					 " FROM %s",
+					 storeTableName, ApiCatalogSchemaName, dataTableName);
+
+	Oid argTypes[1] = { BsonTypeId() };
+	Datum argValues[1] = { PointerGetDatum(PgbsonInitFromJson(projectionSpec)) };
+	char argNulls[1] = { ' ' };
+	ExtensionExecuteQueryWithArgsViaSPI(queryInfo->data, 1, argTypes, argValues,
+										argNulls, readOnly, SPI_OK_INSERT, &isNull);
+}
+
+
+/*
+ * Returns the paths kept by the columnar projection store of the collection,
+ * along with the OID of the side table in storeRelationId, or NIL if the
+ * collection has no store.
+ */
+List *
+GetColumnarProjectionPaths(const MongoCollection *collection, Oid *storeRelationId)
+{
+	*storeRelationId = InvalidOid;
+	if (collection == NULL || collection->viewDefinition != NULL)
+	{
+		return NIL;
+	}
+
+	Oid dataTableOid = get_relname_relid(collection->tableName, ApiDataNamespaceOid());
+	if (!OidIsValid(dataTableOid))
+	{
+		return NIL;
+	}
+
+	const char *projectionSpec = GetColumnarProjectionTriggerSpec(
+		dataTableOid, collection->collectionId);
+	if (projectionSpec == NULL)
+	{
+		return NIL;
+	}
+
+	char *storeTableName = psprintf(COLUMNAR_PROJECTION_TABLE_FORMAT,
+									collection->collectionId);
+	Oid storeOid = get_relname_relid(storeTableName, ApiDataNamespaceOid());
+	if (!OidIsValid(storeOid))
+	{
+		return NIL;
+	}
+
+	List *paths = NIL;
+	bson_iter_t specIter;
+	PgbsonInitIterator(PgbsonInitFromJson(projectionSpec), &specIter);
+	while (bson_iter_next(&specIter))
+	{
+		const char *path = bson_iter_key(&specIter);
+		if (strcmp(path, "_id") != 0)
+		{
+			paths = lappend(paths, pstrdup(path));
+		}
+	}
+
+	*storeRelationId = storeOid;
+	return paths;
+}
+
+
+/*
+ * Returns true if the value at the path is kept whole by the columnar
+ * projection store with the given paths: the path is one of them or is
+ * nested under one of them.
+ */
+bool
+IsPathCoveredByColumnarProjection(const StringView *path, List *paths)
+{
+	StringView idPath = { .string = "_id", .length = 3 };
+	if (StringViewEquals(path, &idPath) ||
+		(StringViewStartsWithStringView(path, &idPath) &&
+		 path->string[idPath.length] == '.'))
+	{
+		return true;
+	}
+
+	ListCell *pathCell;
+	foreach(pathCell, paths)
+	{
+		StringView coveredPath = CreateStringViewFromString(lfirst(pathCell));
+		if (StringViewStartsWithStringView(path, &coveredPath) &&
+			(path->length == coveredPath.length ||
+			 path->string[coveredPath.length] == '.'))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/*
+ * Builds the $project inclusion spec (as extended JSON) that the store applies
+ * to the documents.
+ */
+static char *
+CreateColumnarProjectionSpec(List *paths)
+{
+	StringInfo spec = makeStringInfo();
+	appendStringInfoString(spec, "{ \"_id\": 1");
+
+	ListCell *pathCell;
+	foreach(pathCell, paths)
+	{
+		appendStringInfoString(spec, ", ");
+		escape_json(spec, lfirst(pathCell));
+		appendStringInfoString(spec, ": 1");
+	}
+
+	appendStringInfoString(spec, " }");
+	return spec->data;
+}
+
+
+/*
+ * Returns the projection spec argument of the enabled columnar projection
+ * trigger on the data table, or NULL if it has none.
+ */
+static const char *
+GetColumnarProjectionTriggerSpec(Oid dataTableOid, uint64 collectionId)
+{
+	Relation dataTable = RelationIdGetRelation(dataTableOid);
+	if (!RelationIsValid(dataTable))
+	{
+		return NULL;
+	}
+
+	const char *projectionSpec = NULL;
+	if (dataTable->trigdesc != NULL)
+	{
+		char *triggerName = psprintf(COLUMNAR_PROJECTION_TRIGGER_FORMAT, collectionId);
+		for (int i = 0; i < dataTable->trigdesc->numtriggers; i++)
+		{
+			Trigger *trigger = &dataTable->trigdesc->triggers[i];
+			if (strcmp(trigger->tgname, triggerName) == 0 &&
+				trigger->tgenabled != TRIGGER_DISABLED && trigger->tgnargs == 2)
+			{
+				projectionSpec = pstrdup(trigger->tgargs[1]);
+				break;
+			}
+		}
+	}
+
+	RelationClose(dataTable);
+	return projectionSpec;
+}
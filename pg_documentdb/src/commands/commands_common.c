@@ -27,12 +27,14 @@
 #include "metadata/metadata_cache.h"
 #include "planner/documentdb_planner.h"
 #include "utils/timeout.h"
+#include "utils/guc_utils.h"
 
 
 extern bool ThrowDeadlockOnCrud;
 extern bool EnableBackendStatementTimeout;
 extern int MaxCustomCommandTimeout;
 extern bool EnableVariablesSupportForWriteCommands;
+extern bool EnableRelaxedDurabilityWriteConcern;
 
 /*
  *  This is a list of command options that are not currently supported.
@@ -289,6 +291,56 @@ SetExplicitStatementTimeout(int timeoutMilliseconds)
 }
 
 
+/*
+ * SetWriteConcernDurability commits the current transaction asynchronously
+ * when the write concern of the command does not ask for the write to be
+ * durable: that is { w: 0 } (unacknowledged) or { j: false } (acknowledged
+ * before it is journaled). An explicit { j: true } always keeps the commit
+ * synchronous. The setting is local to the transaction, so it only applies
+ * to writes that run in their own (implicit) transaction: The write concern
+ * of a statement in a multi-document transaction must not change how the
+ * writes of the other statements of the transaction commit.
+ */
+void
+SetWriteConcernDurability(const bson_value_t *writeConcern)
+{
+	if (!EnableRelaxedDurabilityWriteConcern ||
+		writeConcern->value_type != BSON_TYPE_DOCUMENT ||
+		IsTransactionBlock())
+	{
+		return;
+	}
+
+	bool isUnacknowledged = false;
+	bool hasJournal = false;
+	bool journal = false;
+
+	bson_iter_t writeConcernIter;
+	BsonValueInitIterator(writeConcern, &writeConcernIter);
+	while (bson_iter_next(&writeConcernIter))
+	{
+		const char *key = bson_iter_key(&writeConcernIter);
+		const bson_value_t *value = bson_iter_value(&writeConcernIter);
+		if (strcmp(key, "w") == 0)
+		{
+			isUnacknowledged = BsonValueIsNumber(value) &&
+							   BsonValueAsInt64(value) == 0;
+		}
+		else if (strcmp(key, "j") == 0 && value->value_type == BSON_TYPE_BOOL)
+		{
+			hasJournal = true;
+			journal = value->value.v_bool;
+		}
+	}
+
+	bool relaxDurability = hasJournal ? !journal : isUnacknowledged;
+	if (relaxDurability && synchronous_commit != SYNCHRONOUS_COMMIT_OFF)
+	{
+		SetGUCLocally("synchronous_commit", "off");
+	}
+}
+
+
 pgbson *
 GetObjectIdFilterFromQueryDocumentValue(const bson_value_t *queryDoc,
 										bool *queryHasNonIdFilters,
@@ -584,12 +636,23 @@ CommitWriteProcedureAndReacquireCollectionLock(MongoCollection *collection,
 		PopActiveSnapshot();
 	}
 
+	/*
+	 * A relaxed write concern sets synchronous_commit locally to the transaction:
+	 * Carry it over to the rest of the batch.
+	 */
+	bool isAsynchronousCommit = synchronous_commit == SYNCHRONOUS_COMMIT_OFF;
+
 	/* Commit the old transaction */
 	CommitTransactionCommand();
 
 	/* Initiate a new transaction */
 	StartTransactionCommand();
 
+	if (isAsynchronousCommit && synchronous_commit != SYNCHRONOUS_COMMIT_OFF)
+	{
+		SetGUCLocally("synchronous_commit", "off");
+	}
+
 	/* Push the active snapshot if commands need it (Portals do) */
 	if (setSnapshot)
 	{
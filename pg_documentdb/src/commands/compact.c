@@ -3,21 +3,28 @@
  *
  * src/commands/compact.c
  *
- * Implementation of the blocking compact command.
+ * Implementation of the compact command.
  *-------------------------------------------------------------------------
  */
 #include <postgres.h>
+#include <math.h>
 #include <commands/vacuum.h>
+#include <executor/spi.h>
 #include <nodes/parsenodes.h>
 #include <fmgr.h>
 #include <miscadmin.h>
 #include <storage/lmgr.h>
+#include <utils/array.h>
+#include <utils/fmgrprotos.h>
+#include <utils/lsyscache.h>
 #include <utils/syscache.h>
 
 #include "api_hooks.h"
 #include "commands/commands_common.h"
 #include "commands/parse_error.h"
 #include "metadata/metadata_cache.h"
+#include "metadata/relation_utils.h"
+#include "utils/data_table_utils.h"
 #include "utils/documentdb_errors.h"
 #include "utils/feature_counter.h"
 #include "utils/query_utils.h"
@@ -25,6 +32,12 @@
 #include "utils/version_utils.h"
 
 extern bool EnableCompact;
+extern bool EnableOnlineCompact;
+extern int OnlineCompactCostDelayMs;
+extern double ClusteredCollectionMinCorrelation;
+
+/* The lock timeout (in ms) for reclustering a collection in the background */
+#define RECLUSTER_LOCK_TIMEOUT_MS 1000
 
 typedef struct CompactArgs
 {
@@ -55,11 +68,12 @@ typedef struct CompactArgs
 } CompactArgs;
 
 static void ParseCompactCommandSpec(pgbson *compactSpec, CompactArgs *args);
-static void PerformVacuum(MongoCollection *collection);
-static void ValidateLocksAndCheckAccess(MongoCollection *collection);
+static void PerformVacuum(MongoCollection *collection, bool isOnline);
+static void ValidateLocksAndCheckAccess(MongoCollection *collection, bool isOnline);
 
 
 PG_FUNCTION_INFO_V1(command_compact);
+PG_FUNCTION_INFO_V1(recluster_collections_background);
 
 /*
  * command_compact implements the functionality of compact Database command
@@ -116,8 +130,9 @@ command_compact(PG_FUNCTION_ARGS)
 	}
 
 	/*
-	 * VACUUM FULL is a blocking operation and it takes AccessExclusiveLock on the table.
-	 * Also we can only execute it on the top level (not within a function and procedure tranasction), so we can't
+	 * VACUUM FULL is a blocking operation and it takes AccessExclusiveLock on the table,
+	 * the online compact runs a plain VACUUM that only takes ShareUpdateExclusiveLock.
+	 * Also we can only execute either on the top level (not within a function and procedure tranasction), so we can't
 	 * take any lock on the collection here to avoid deadlock situation.
 	 */
 	MongoCollection *collection = GetMongoCollectionByNameDatum(CStringGetTextDatum(
@@ -133,7 +148,8 @@ command_compact(PG_FUNCTION_ARGS)
 							   args.collectionName)));
 	}
 
-	ValidateLocksAndCheckAccess(collection);
+	bool isOnline = EnableOnlineCompact;
+	ValidateLocksAndCheckAccess(collection, isOnline);
 
 	/* Start building the response */
 	pgbson_writer response;
@@ -153,13 +169,39 @@ command_compact(PG_FUNCTION_ARGS)
 		PG_RETURN_POINTER(PgbsonWriterGetPgbson(&response));
 	}
 
-	if (!beforeVacuumStats.nullStats && (beforeVacuumStats.estimatedBloatStorage /
-										 BYTES_PER_MB) >= args.freeSpaceTargetMB)
+	bool meetsFreeSpaceTarget = !beforeVacuumStats.nullStats &&
+								(beforeVacuumStats.estimatedBloatStorage /
+								 BYTES_PER_MB) >= args.freeSpaceTargetMB;
+	if (meetsFreeSpaceTarget && isOnline)
+	{
+		/*
+		 * A plain vacuum only returns the empty pages at the end of the table and the
+		 * indexes, so the space freed is measured instead of taken from the estimate.
+		 */
+		int64 sizeBeforeVacuum = DatumGetInt64(DirectFunctionCall1(
+												   pg_total_relation_size,
+												   ObjectIdGetDatum(
+													   collection->relationId)));
+
+		elog(LOG, "Performing online compact vacuum on collection %s.%s",
+			 args.databaseName, args.collectionName);
+		PerformVacuum(collection, isOnline);
+
+		int64 sizeAfterVacuum = DatumGetInt64(DirectFunctionCall1(
+												  pg_total_relation_size,
+												  ObjectIdGetDatum(
+													  collection->relationId)));
+		PgbsonWriterAppendInt64(&response, "bytesFreed", 10,
+								Max(sizeBeforeVacuum - sizeAfterVacuum, 0));
+		PG_RETURN_POINTER(PgbsonWriterGetPgbson(&response));
+	}
+
+	if (meetsFreeSpaceTarget)
 	{
 		/* Only perform full vacuum if there are stats available and freeSpace target is met */
 		elog(LOG, "Performing compact vacuum full on collection %s.%s",
 			 args.databaseName, args.collectionName);
-		PerformVacuum(collection);
+		PerformVacuum(collection, isOnline);
 	}
 
 	/* This is very rough, currently it doesn't considers the space freed by vacuuming index
@@ -179,10 +221,10 @@ command_compact(PG_FUNCTION_ARGS)
 /*
  * Performs the necessary checks to ensure that the current user has priveleges to
  * perform the compact operation on the collection, also checks if the realtion to be vacuumed
- * is available for exclusive access locking
+ * is available for locking in the mode the vacuum takes.
  */
 static void
-ValidateLocksAndCheckAccess(MongoCollection *collection)
+ValidateLocksAndCheckAccess(MongoCollection *collection, bool isOnline)
 {
 	/*
 	 * Check if the current user is permitted to perform VACUUM FULL on the collection.
@@ -202,7 +244,7 @@ ValidateLocksAndCheckAccess(MongoCollection *collection)
 	}
 	Form_pg_class classForm = (Form_pg_class) GETSTRUCT(tuple);
 
-	bits32 options = VACOPT_VACUUM | VACOPT_FULL;
+	bits32 options = isOnline ? VACOPT_VACUUM : VACOPT_VACUUM | VACOPT_FULL;
 	bool userCanVacuum = false;
 #if PG_VERSION_NUM >= 170000
 	userCanVacuum = vacuum_is_permitted_for_relation(collection->relationId,
@@ -226,14 +268,18 @@ ValidateLocksAndCheckAccess(MongoCollection *collection)
 							collection->name.collectionName)));
 	}
 
-	/* Now checking if the collection is available for exclusive locking :
+	/* Now checking if the collection is available for locking :
 	 * - To validate early if only 1 vacuum is running on the collection.
 	 *
-	 * Immediately unlock the table to avoid deadlock situation with VACUUM FULL.
+	 * The online compact only conflicts with other vacuums and schema changes, so
+	 * reads and writes on the collection don't fail it.
+	 *
+	 * Immediately unlock the table to avoid deadlock situation with the VACUUM.
 	 */
-	if (ConditionalLockRelationOid(collection->relationId, AccessExclusiveLock))
+	LOCKMODE lockMode = isOnline ? ShareUpdateExclusiveLock : AccessExclusiveLock;
+	if (ConditionalLockRelationOid(collection->relationId, lockMode))
 	{
-		UnlockRelationOid(collection->relationId, AccessExclusiveLock);
+		UnlockRelationOid(collection->relationId, lockMode);
 	}
 	else
 	{
@@ -254,24 +300,136 @@ ValidateLocksAndCheckAccess(MongoCollection *collection)
 /*
  * This sends a VACUUM FULL command to the local server via libpq, as VACUUM FULL can't
  * be executed in a transaction block.
+ *
+ * For the online compact this sends a plain VACUUM instead: It keeps the collection
+ * readable and writable, and truncates the empty pages at the end of the table when
+ * it can briefly get the lock for it. It is throttled with the vacuum cost delay so
+ * it doesn't starve the workload of IO.
  */
 static void
-PerformVacuum(MongoCollection *collection)
+PerformVacuum(MongoCollection *collection, bool isOnline)
 {
 	Assert(collection != NULL && collection->relationId != InvalidOid);
 
-	const char *vacuumFullQuery = FormatSqlQuery("VACUUM FULL %s.documents_%ld",
-												 ApiDataSchemaName,
-												 collection->collectionId);
-
 	/* VACUUM needs to be performed at the top level */
-	bool useSerialExecution = false;
 	Oid userOid = GetUserId();
+	if (isOnline)
+	{
+		const char *vacuumQuery = FormatSqlQuery(
+			"VACUUM (TRUNCATE true) %s.documents_%ld", ApiDataSchemaName,
+			collection->collectionId);
+		char *connectionOptions = psprintf("-c vacuum_cost_delay=%d",
+										   OnlineCompactCostDelayMs);
+		ExtensionExecuteQueryAsUserOnLocalhostWithOptionsViaLibPQ((char *) vacuumQuery,
+																  userOid,
+																  connectionOptions);
+		return;
+	}
+
+	/*
+	 * A clustered collection is rewritten in _id order instead: CLUSTER takes the
+	 * same lock as VACUUM FULL and frees the same space.
+	 */
+	const char *vacuumFullQuery =
+		IsClusteredCollection(collection->collectionId) ?
+		FormatSqlQuery("CLUSTER %s.documents_%ld", ApiDataSchemaName,
+					   collection->collectionId) :
+		FormatSqlQuery("VACUUM FULL %s.documents_%ld", ApiDataSchemaName,
+					   collection->collectionId);
+
+	bool useSerialExecution = false;
 	ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ((char *) vacuumFullQuery, userOid,
 												   useSerialExecution);
 }
 
 
+/*
+ * recluster_collections_background rewrites up to a batch of clustered
+ * collections in _id order (default one per run) whose heap order drifted (as
+ * measured by the object_id correlation of the last ANALYZE) below
+ * ClusteredCollectionMinCorrelation. This is called periodically by the
+ * background worker framework.
+ *
+ * CLUSTER locks the collection exclusively while it rewrites it, so it is
+ * attempted with a short lock timeout: a collection that is busy fails the
+ * run and is retried by the next one.
+ */
+Datum
+recluster_collections_background(PG_FUNCTION_ARGS)
+{
+	int32 batchSize = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
+	if (batchSize <= 0)
+	{
+		batchSize = 1;
+	}
+
+	if (ClusteredCollectionMinCorrelation <= 0)
+	{
+		PG_RETURN_VOID();
+	}
+
+	ArrayType *collectionIdArray = GetCollectionIds();
+	if (collectionIdArray == NULL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	Datum *collectionIds = NULL;
+	int collectionCount = 0;
+	deconstruct_array(collectionIdArray, INT8OID, sizeof(int64), true, TYPALIGN_INT,
+					  &collectionIds, NULL, &collectionCount);
+
+	int reclustered = 0;
+	for (int i = 0; i < collectionCount && reclustered < batchSize; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		uint64 collectionId = (uint64) DatumGetInt64(collectionIds[i]);
+		char dataTableName[NAMEDATALEN];
+		snprintf(dataTableName, NAMEDATALEN, DOCUMENT_DATA_TABLE_NAME_FORMAT, collectionId);
+
+		/* The collection may have been dropped since the ids were read */
+		Oid dataTableOid = get_relname_relid(dataTableName, ApiDataNamespaceOid());
+		if (dataTableOid == InvalidOid || !IsClusteredCollection(collectionId))
+		{
+			continue;
+		}
+
+		double correlation = 0;
+		if (!TryGetAttributeCorrelation(dataTableOid,
+										DOCUMENT_DATA_TABLE_OBJECT_ID_VAR_ATTR_NUMBER,
+										&correlation) ||
+			fabs(correlation) >= ClusteredCollectionMinCorrelation)
+		{
+			continue;
+		}
+
+		elog(LOG, "Reclustering collection " UINT64_FORMAT " with _id correlation %f",
+			 collectionId, correlation);
+
+		const char *clusterQuery = FormatSqlQuery("CLUSTER %s.%s", ApiDataSchemaName,
+												  dataTableName);
+		bool readOnly = false;
+		int statementTimeout = 0;
+		ExtensionExecuteCappedStatementWithArgsViaSPI(clusterQuery, 0, NULL, NULL, NULL,
+													  readOnly, SPI_OK_UTILITY,
+													  statementTimeout,
+													  RECLUSTER_LOCK_TIMEOUT_MS);
+
+		/* Refresh the statistics so the next run sees the new order */
+		const char *analyzeQuery = FormatSqlQuery("ANALYZE %s.%s", ApiDataSchemaName,
+												  dataTableName);
+		ExtensionExecuteCappedStatementWithArgsViaSPI(analyzeQuery, 0, NULL, NULL, NULL,
+													  readOnly, SPI_OK_UTILITY,
+													  statementTimeout,
+													  RECLUSTER_LOCK_TIMEOUT_MS);
+		reclustered++;
+	}
+
+	PG_RETURN_VOID();
+}
+
+
 static void
 ParseCompactCommandSpec(pgbson *compactSpec, CompactArgs *args)
 {
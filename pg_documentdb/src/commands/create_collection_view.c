@@ -20,10 +20,13 @@
 
 #include "commands/commands_common.h"
 #include "commands/parse_error.h"
+#include "commands/timeseries.h"
 #include "metadata/collection.h"
 #include "metadata/metadata_cache.h"
 #include "utils/documentdb_errors.h"
 #include "aggregation/bson_aggregation_pipeline.h"
+#include "aggregation/aggregation_commands.h"
+#include "utils/query_utils.h"
 #include "utils/error_utils.h"
 #include "utils/feature_counter.h"
 #include "utils/version_utils.h"
@@ -57,6 +60,15 @@ typedef struct CreateSpec
 
 	/* idIndex */
 	bson_value_t idIndex;
+
+	/* documentCompression */
+	char *documentCompression;
+
+	/* timeseries (NULL if it's not a time-series collection) */
+	TimeseriesOptions *timeseries;
+
+	/* clusteredIndex: whether the documents are kept ordered by _id */
+	bool clustered;
 } CreateSpec;
 
 static const StringView SystemPrefix = { .string = "system.", .length = 7 };
@@ -76,7 +88,13 @@ static void WalkPipelineForViewCycles(Datum databaseDatum, const char *viewName,
 static bool CreateView(Datum databaseDatum, const char *viewName,
 					   const char *viewSource, const bson_value_t *pipeline);
 
+static void CreateTimeseriesCollection(Datum databaseDatum, CreateSpec *createDefinition);
+
+static void CheckIncrementalViewPipelineStages(const bson_value_t *pipeline);
+static bool TryGetMaxObjectId(MongoCollection *collection, bson_value_t *maxObjectId);
+
 PG_FUNCTION_INFO_V1(command_create_collection_view);
+PG_FUNCTION_INFO_V1(command_refresh_materialized_view);
 
 extern bool EnableSchemaValidation;
 
@@ -106,6 +124,11 @@ command_create_collection_view(PG_FUNCTION_ARGS)
 		/* Collection exists validate options */
 		ValidateCollectionOptionsEquivalent(createDefinition, collection);
 	}
+	else if (createDefinition->timeseries != NULL)
+	{
+		ReportFeatureUsage(FEATURE_COMMAND_CREATE_TIMESERIES);
+		CreateTimeseriesCollection(databaseDatum, createDefinition);
+	}
 	else if (createDefinition->viewOn != NULL)
 	{
 		Datum viewOnDatum = CStringGetTextDatum(createDefinition->viewOn);
@@ -122,6 +145,25 @@ command_create_collection_view(PG_FUNCTION_ARGS)
 		ReportFeatureUsage(FEATURE_COMMAND_CREATE_COLLECTION);
 		CreateCollection(databaseDatum, createDatum);
 
+		if (createDefinition->documentCompression != NULL ||
+			createDefinition->clustered)
+		{
+			MongoCollection *createdCollection =
+				GetMongoCollectionByNameDatum(databaseDatum, createDatum,
+											  AccessExclusiveLock);
+			if (createDefinition->documentCompression != NULL)
+			{
+				SetCollectionDocumentCompression(createdCollection,
+												 createDefinition->documentCompression);
+			}
+
+			if (createDefinition->clustered)
+			{
+				ReportFeatureUsage(FEATURE_COMMAND_CREATE_CLUSTERED);
+				SetCollectionClustered(createdCollection);
+			}
+		}
+
 		if (hasSchemaValidationSpec)
 		{
 			ReportFeatureUsage(FEATURE_COMMAND_CREATE_VALIDATION);
@@ -300,15 +342,16 @@ ParseCreateSpec(Datum databaseDatum, pgbson *createSpec, bool *hasSchemaValidati
 			EnsureTopLevelFieldType("create.timeseries", &createIter, BSON_TYPE_DOCUMENT);
 			if (!IsBsonValueEmptyDocument(bson_iter_value(&createIter)))
 			{
-				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
-								errmsg(
-									"Time series data collections are currently not supported")));
+				bool isCreateSpec = true;
+				spec->timeseries = palloc0(sizeof(TimeseriesOptions));
+				ParseTimeseriesOptions(bson_iter_value(&createIter), "create.timeseries",
+									   isCreateSpec, spec->timeseries);
 			}
 		}
 		else if (strcmp(key, "clusteredIndex") == 0)
 		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
-							errmsg("clusteredIndex not supported yet")));
+			ParseClusteredIndexOption(&createIter, "create.clusteredIndex");
+			spec->clustered = true;
 		}
 		else if (strcmp(key, "expireAfterSeconds") == 0)
 		{
@@ -370,6 +413,11 @@ ParseCreateSpec(Datum databaseDatum, pgbson *createSpec, bool *hasSchemaValidati
 																	   "create.validationAction",
 																	   hasSchemaValidationSpec);
 		}
+		else if (strcmp(key, "documentCompression") == 0)
+		{
+			spec->documentCompression = ParseAndGetDocumentCompressionOption(
+				&createIter, "create.documentCompression");
+		}
 		else if (strcmp(key, "writeConcern") == 0)
 		{
 			/* Ignore: Should we fail here? */
@@ -412,6 +460,50 @@ ParseCreateSpec(Datum databaseDatum, pgbson *createSpec, bool *hasSchemaValidati
 						errmsg("'viewOn' and 'idIndex' cannot both be specified")));
 	}
 
+	if (spec->viewOn != NULL && spec->documentCompression != NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+						errmsg(
+							"'viewOn' and 'documentCompression' cannot both be specified")));
+	}
+
+	if (spec->clustered && (spec->viewOn != NULL || spec->timeseries != NULL))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+						errmsg("'clusteredIndex' can only be specified for a collection")));
+	}
+
+	if (spec->timeseries != NULL)
+	{
+		if (spec->viewOn != NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+							errmsg(
+								"'viewOn' and 'timeseries' cannot both be specified")));
+		}
+
+		if (spec->idIndex.value_type != BSON_TYPE_EOD)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+							errmsg(
+								"'timeseries' and 'idIndex' cannot both be specified")));
+		}
+
+		if (*hasSchemaValidationSpec)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+							errmsg(
+								"Schema validation of time-series collections is not supported yet")));
+		}
+
+		/*
+		 * A time-series collection is a view over its buckets: describe it
+		 * as one so that an existing collection is compared like a view.
+		 */
+		spec->viewOn = psprintf("%s%s", TIMESERIES_BUCKETS_PREFIX, spec->name);
+		spec->pipeline = CreateTimeseriesViewPipeline(spec->timeseries);
+	}
+
 	if (*hasSchemaValidationSpec)
 	{
 		spec->validationAction = spec->validationAction == NULL ? "error" :
@@ -552,6 +644,33 @@ CreateView(Datum databaseDatum, const char *viewName,
 }
 
 
+/*
+ * Creates a time-series collection: the buckets collection holding the
+ * measurements, and the view unpacking the buckets under the name of the
+ * collection. Large buckets are compressed by TOAST, the documentCompression
+ * option picks the compression method of the buckets.
+ */
+static void
+CreateTimeseriesCollection(Datum databaseDatum, CreateSpec *createDefinition)
+{
+	Datum bucketsDatum = CStringGetTextDatum(createDefinition->viewOn);
+	ValidateDatabaseCollection(databaseDatum, bucketsDatum);
+	CreateCollection(databaseDatum, bucketsDatum);
+
+	if (createDefinition->documentCompression != NULL)
+	{
+		MongoCollection *bucketsCollection =
+			GetMongoCollectionByNameDatum(databaseDatum, bucketsDatum,
+										  AccessExclusiveLock);
+		SetCollectionDocumentCompression(bucketsCollection,
+										 createDefinition->documentCompression);
+	}
+
+	CreateView(databaseDatum, createDefinition->name, createDefinition->viewOn,
+			   &createDefinition->pipeline);
+}
+
+
 /*
  * Checks if an existent collection and view (or new collection) are equivalent
  * and throws the appropriate error code.
@@ -965,3 +1084,250 @@ CheckForViewCyclesAndDepth(Datum databaseDatum, const char *viewName, const
 						errmsg("Cycle detected in view: %s", errorStr->data)));
 	}
 }
+
+
+/*
+ * command_refresh_materialized_view materializes the output of a view into a
+ * collection:
+ * { "refreshView": <view>, "into": <collection>, "after": <watermark> }
+ *
+ * Without "after" the whole view is recomputed and the target collection replaced
+ * ($out): no _id filter is applied, so documents of every _id type are included.
+ * With "after" only the source documents with an _id greater than "after" and at
+ * most the current largest _id are run through the view pipeline and merged into
+ * the target ($merge). This is only valid for append-only sources whose _id values
+ * increase and share one type (e.g. ObjectIds), since $gt and $lte only match
+ * values of the same type, and for views that transform documents one at a time.
+ *
+ * Returns { "watermark": <max source _id>, "ok": 1 } which is the "after" value to
+ * use for the next refresh. A full refresh may already include documents inserted
+ * after the watermark was read; merging them again on the next incremental refresh
+ * replaces them with the same output.
+ */
+Datum
+command_refresh_materialized_view(PG_FUNCTION_ARGS)
+{
+	Datum databaseDatum = PG_GETARG_DATUM(0);
+	pgbson *refreshSpec = PG_GETARG_PGBSON(1);
+
+	const char *viewName = NULL;
+	const char *targetName = NULL;
+	bson_value_t afterValue = { 0 };
+
+	bson_iter_t refreshIter;
+	PgbsonInitIterator(refreshSpec, &refreshIter);
+	while (bson_iter_next(&refreshIter))
+	{
+		const char *key = bson_iter_key(&refreshIter);
+		if (strcmp(key, "refreshView") == 0)
+		{
+			EnsureTopLevelFieldType("refreshView.refreshView", &refreshIter,
+									BSON_TYPE_UTF8);
+			viewName = bson_iter_utf8(&refreshIter, NULL);
+		}
+		else if (strcmp(key, "into") == 0)
+		{
+			EnsureTopLevelFieldType("refreshView.into", &refreshIter, BSON_TYPE_UTF8);
+			targetName = bson_iter_utf8(&refreshIter, NULL);
+		}
+		else if (strcmp(key, "after") == 0)
+		{
+			afterValue = *bson_iter_value(&refreshIter);
+		}
+		else if (!IsCommonSpecIgnoredField(key))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+							errmsg("BSON field 'refreshView.%s' is an "
+								   "unknown field", key)));
+		}
+	}
+
+	if (viewName == NULL || targetName == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_FAILEDTOPARSE),
+						errmsg("Both 'refreshView' and 'into' must be specified")));
+	}
+
+	ThrowIfServerOrTransactionReadOnly();
+
+	MongoCollection *view = GetMongoCollectionOrViewByNameDatum(
+		databaseDatum, CStringGetTextDatum(viewName), NoLock);
+	if (view == NULL || view->viewDefinition == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_NAMESPACENOTFOUND),
+						errmsg("Namespace %s.%s is not a view",
+							   TextDatumGetCString(databaseDatum), viewName)));
+	}
+
+	ViewDefinition definition = { 0 };
+	DecomposeViewDefinition(view->viewDefinition, &definition);
+
+	Datum sourceDatum = CStringGetTextDatum(definition.viewSource);
+	MongoCollection *source = GetMongoCollectionOrViewByNameDatum(databaseDatum,
+																  sourceDatum,
+																  NoLock);
+	if (source != NULL && source->viewDefinition != NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTEDONVIEW),
+						errmsg("Only views defined directly on a collection can be "
+							   "materialized")));
+	}
+
+	bool isIncremental = afterValue.value_type != BSON_TYPE_EOD;
+	if (isIncremental && definition.pipeline.value_type != BSON_TYPE_EOD)
+	{
+		CheckIncrementalViewPipelineStages(&definition.pipeline);
+	}
+
+	ReportFeatureUsage(FEATURE_COMMAND_REFRESH_VIEW);
+
+	/*
+	 * Fix the upper bound before running the pipeline so that documents inserted
+	 * concurrently are picked up by the next incremental refresh rather than
+	 * skipped by it.
+	 */
+	bson_value_t watermark = { 0 };
+	bool hasWatermark = source != NULL && TryGetMaxObjectId(source, &watermark);
+
+	if (!hasWatermark && isIncremental)
+	{
+		/* Nothing was added to the source: the watermark stays where it was */
+		watermark = afterValue;
+		hasWatermark = true;
+	}
+	else
+	{
+		pgbson_writer aggregateWriter;
+		PgbsonWriterInit(&aggregateWriter);
+		PgbsonWriterAppendUtf8(&aggregateWriter, "aggregate", 9,
+							   definition.viewSource);
+
+		pgbson_array_writer pipelineWriter;
+		PgbsonWriterStartArray(&aggregateWriter, "pipeline", 8, &pipelineWriter);
+
+		/* The bounds are type bracketed, a full refresh must not filter on them */
+		if (isIncremental)
+		{
+			pgbson_writer stageWriter, matchWriter, idWriter;
+			PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+			PgbsonWriterStartDocument(&stageWriter, "$match", 6, &matchWriter);
+			PgbsonWriterStartDocument(&matchWriter, "_id", 3, &idWriter);
+			PgbsonWriterAppendValue(&idWriter, "$gt", 3, &afterValue);
+			PgbsonWriterAppendValue(&idWriter, "$lte", 4, &watermark);
+			PgbsonWriterEndDocument(&matchWriter, &idWriter);
+			PgbsonWriterEndDocument(&stageWriter, &matchWriter);
+			PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+		}
+
+		if (definition.pipeline.value_type != BSON_TYPE_EOD)
+		{
+			bson_iter_t viewPipelineIter;
+			BsonValueInitIterator(&definition.pipeline, &viewPipelineIter);
+			while (bson_iter_next(&viewPipelineIter))
+			{
+				PgbsonArrayWriterWriteValue(&pipelineWriter,
+											bson_iter_value(&viewPipelineIter));
+			}
+		}
+
+		pgbson_writer stageWriter;
+		PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+		if (isIncremental)
+		{
+			pgbson_writer mergeWriter;
+			PgbsonWriterStartDocument(&stageWriter, "$merge", 6, &mergeWriter);
+			PgbsonWriterAppendUtf8(&mergeWriter, "into", 4, targetName);
+			PgbsonWriterAppendUtf8(&mergeWriter, "whenMatched", 11, "replace");
+			PgbsonWriterAppendUtf8(&mergeWriter, "whenNotMatched", 14, "insert");
+			PgbsonWriterEndDocument(&stageWriter, &mergeWriter);
+		}
+		else
+		{
+			PgbsonWriterAppendUtf8(&stageWriter, "$out", 4, targetName);
+		}
+
+		PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+		PgbsonWriterEndArray(&aggregateWriter, &pipelineWriter);
+
+		pgbson_writer cursorWriter;
+		PgbsonWriterStartDocument(&aggregateWriter, "cursor", 6, &cursorWriter);
+		PgbsonWriterEndDocument(&aggregateWriter, &cursorWriter);
+
+		int64_t cursorId = 0;
+		aggregate_cursor_first_page(DatumGetTextP(databaseDatum),
+									PgbsonWriterGetPgbson(&aggregateWriter),
+									cursorId);
+	}
+
+	pgbson_writer finalWriter;
+	PgbsonWriterInit(&finalWriter);
+	if (hasWatermark)
+	{
+		PgbsonWriterAppendValue(&finalWriter, "watermark", 9, &watermark);
+	}
+
+	PgbsonWriterAppendDouble(&finalWriter, "ok", 2, 1);
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&finalWriter));
+}
+
+
+/*
+ * An incremental refresh runs the view pipeline over the new source documents only,
+ * which gives the same result as a full refresh only if every stage handles each
+ * document on its own.
+ */
+static void
+CheckIncrementalViewPipelineStages(const bson_value_t *pipeline)
+{
+	bson_iter_t pipelineIter;
+	BsonValueInitIterator(pipeline, &pipelineIter);
+
+	while (bson_iter_next(&pipelineIter))
+	{
+		pgbsonelement stageElement;
+		BsonValueToPgbsonElement(bson_iter_value(&pipelineIter), &stageElement);
+
+		if (strcmp(stageElement.path, "$match") != 0 &&
+			strcmp(stageElement.path, "$project") != 0 &&
+			strcmp(stageElement.path, "$addFields") != 0 &&
+			strcmp(stageElement.path, "$set") != 0 &&
+			strcmp(stageElement.path, "$unset") != 0 &&
+			strcmp(stageElement.path, "$replaceRoot") != 0 &&
+			strcmp(stageElement.path, "$replaceWith") != 0 &&
+			strcmp(stageElement.path, "$redact") != 0)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_OPTIONNOTSUPPORTEDONVIEW),
+							errmsg("The stage %s in the view pipeline does not support "
+								   "an incremental refresh", stageElement.path),
+							errdetail_log("Refresh the view without 'after' instead")));
+		}
+	}
+}
+
+
+/*
+ * Gets the largest _id in the collection through the primary key index.
+ * Returns false if the collection is empty.
+ */
+static bool
+TryGetMaxObjectId(MongoCollection *collection, bson_value_t *maxObjectId)
+{
+	StringInfo query = makeStringInfo();
+	appendStringInfo(query,
+					 "SELECT object_id FROM %s.%s ORDER BY object_id DESC LIMIT 1",
+					 ApiDataSchemaName, collection->tableName);
+
+	bool isNull = true;
+	bool readOnly = true;
+	Datum result = ExtensionExecuteQueryViaSPI(query->data, readOnly, SPI_OK_SELECT,
+											   &isNull);
+	if (isNull)
+	{
+		return false;
+	}
+
+	pgbsonelement element;
+	PgbsonToSinglePgbsonElement(DatumGetPgBson(result), &element);
+	*maxObjectId = element.bsonValue;
+	return true;
+}
@@ -47,6 +47,7 @@
 #include "commands/drop_indexes.h"
 #include "commands/lock_tags.h"
 #include "commands/parse_error.h"
+#include "collation/collation.h"
 #include "geospatial/bson_geospatial_common.h"
 #include "geospatial/bson_geospatial_geonear.h"
 #include "metadata/collection.h"
@@ -162,6 +163,9 @@ extern bool DefaultEnableLargeUniqueIndexKeys;
 extern bool SkipFailOnCollation;
 extern bool ForceWildcardReducedTerm;
 extern bool DefaultUseCompositeOpClass;
+extern bool EnableCompactWildcardProjectionTerms;
+extern bool EnableHashedTruncatedIndexTerms;
+extern bool EnableNativeHashIndex;
 
 extern char *AlternateIndexHandler;
 
@@ -295,6 +299,7 @@ static char * GenerateIndexExprStr(const char *indexAmSuffix,
 								   const char *languageOverride,
 								   bool enableLargeIndexKeys,
 								   bool useReducedWildcardTerms,
+								   const char *collationString,
 								   const char *indexAmOpClassCatalogSchema,
 								   const char *indexAmOpClassInternalCatalogSchema);
 static char * Generate2dsphereIndexExprStr(const IndexDefKey *indexDefKey);
@@ -317,6 +322,7 @@ static BsonLeafPathNode * CreateIndexesCreateLeafNode(const StringView *fieldPat
 													  void *state);
 static const char * SerializeWeightedPaths(List *weightedPaths);
 static bool IndexSupportsTruncation(IndexDef *indexDef);
+static bool IsNativeHashIndexCandidate(const IndexDef *indexDef);
 
 
 /*
@@ -1878,6 +1884,23 @@ ParseIndexDefDocumentInternal(const bson_iter_t *indexesArrayIter,
 			/* parsed by the method above*/
 			continue;
 		}
+		else if (EnableCollation && strcmp(indexDefDocKey, "collation") == 0)
+		{
+			EnsureIndexDefDocFieldType(&indexDefDocIter, BSON_TYPE_DOCUMENT);
+
+			const bson_value_t *collationValue = bson_iter_value(&indexDefDocIter);
+			char *collationString = palloc0(MAX_ICU_COLLATION_LENGTH);
+			ParseAndGetCollationString(collationValue, collationString);
+
+			/* The simple collation compares binary, same as no collation */
+			if (IsCollationValid(collationString) &&
+				!IsSimpleCollation(collationString))
+			{
+				indexDef->collationString = collationString;
+				indexDef->collationDocument =
+					PgbsonInitFromDocumentBsonValue(collationValue);
+			}
+		}
 		else if (!SkipFailOnCollation && strcmp(indexDefDocKey, "collation") == 0)
 		{
 			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
@@ -2003,6 +2026,49 @@ ParseIndexDefDocumentInternal(const bson_iter_t *indexesArrayIter,
 		}
 	}
 
+	if (indexDef->collationString != NULL)
+	{
+		/*
+		 * Collated indexes store the collation sort key of the string terms of
+		 * single path regular indexes. The unique and composite op classes
+		 * compare the raw terms, so these can't be collated yet.
+		 */
+		if (indexDef->unique == BoolIndexOption_True)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_CANNOTCREATEINDEX),
+							errmsg(
+								"collation is not supported with unique indexes.")));
+		}
+
+		if (indexDef->enableCompositeTerm == BoolIndexOption_True)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_CANNOTCREATEINDEX),
+							errmsg(
+								"collation is not supported with enableCompositeTerm.")));
+		}
+
+		if (indexDef->key->isWildcard)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_CANNOTCREATEINDEX),
+							errmsg(
+								"collation is not supported with wildcard indexes.")));
+		}
+
+		ListCell *keyCell;
+		foreach(keyCell, indexDef->key->keyPathList)
+		{
+			IndexDefKeyPath *keyPath = lfirst(keyCell);
+			if (keyPath->indexKind != MongoIndexKind_Regular || keyPath->isWildcard)
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_CANNOTCREATEINDEX),
+								errmsg(
+									"collation is only supported with regular non-wildcard indexes.")));
+			}
+		}
+
+		indexDef->enableCompositeTerm = BoolIndexOption_False;
+	}
+
 	if (indexDef->enableCompositeTerm == BoolIndexOption_True ||
 		(indexDef->enableCompositeTerm == BoolIndexOption_Undefined &&
 		 DefaultUseCompositeOpClass))
@@ -4678,6 +4744,12 @@ MakeIndexSpecForIndexDef(IndexDef *indexDef)
 		PgbsonWriterAppendInt32(&writer, "enableOrderedIndex", 18, 1);
 	}
 
+	if (indexDef->collationDocument != NULL)
+	{
+		PgbsonWriterAppendDocument(&writer, "collation", 9,
+								   indexDef->collationDocument);
+	}
+
 	if (!IsPgbsonWriterEmptyDocument(&writer))
 	{
 		indexSpec.indexOptions = PgbsonWriterGetPgbson(&writer);
@@ -4709,6 +4781,28 @@ CreatePostgresIndex(uint64 collectionId, IndexDef *indexDef, int indexId,
 }
 
 
+/*
+ * Whether the index is a non unique single field hashed index that can be built
+ * as a native postgres hash index.
+ */
+static bool
+IsNativeHashIndexCandidate(const IndexDef *indexDef)
+{
+	if (!EnableNativeHashIndex || !indexDef->key->hasHashedIndexes ||
+		indexDef->unique == BoolIndexOption_True ||
+		list_length(indexDef->key->keyPathList) != 1 ||
+		!IsClusterVersionAtleast(DocDB_V0, 108, 0))
+	{
+		return false;
+	}
+
+	IndexDefKeyPath *indexKeyPath = (IndexDefKeyPath *) linitial(
+		indexDef->key->keyPathList);
+	return indexKeyPath->indexKind == MongoIndexKind_Hashed &&
+		   !indexKeyPath->isWildcard;
+}
+
+
 /*
  * CreatePostgresIndexCreationCmd creates postgres index creation command based on indexDef passed.
  */
@@ -4769,6 +4863,7 @@ CreatePostgresIndexCreationCmd(uint64 collectionId, IndexDef *indexDef, int inde
 											  indexDef->languageOverride,
 											  enableLargeIndexKeys,
 											  useReducedWildcardTermGeneration,
+											  indexDef->collationString,
 											  indexAm->get_opclass_catalog_schema(),
 											  indexAm->get_opclass_internal_catalog_schema()),
 						 indexDef->partialFilterExpr ? "WHERE (" : "",
@@ -4864,6 +4959,42 @@ CreatePostgresIndexCreationCmd(uint64 collectionId, IndexDef *indexDef, int inde
 												indexDef->partialFilterExpr) : "",
 						 indexDef->partialFilterExpr ? ")" : "");
 	}
+	else if (IsNativeHashIndexCandidate(indexDef))
+	{
+		/*
+		 * Single field hashed indexes only serve equality: Back them with a postgres
+		 * hash index that stores one hash of the path value per document.
+		 */
+		IndexDefKeyPath *indexKeyPath = (IndexDefKeyPath *) linitial(
+			indexDef->key->keyPathList);
+		appendStringInfo(cmdStr,
+						 "CREATE INDEX %s " DOCUMENT_DATA_TABLE_INDEX_NAME_FORMAT,
+						 concurrently ? "CONCURRENTLY" : "",
+						 indexId);
+
+		if (isTempCollection)
+		{
+			appendStringInfo(cmdStr,
+							 " ON documents_temp");
+		}
+		else
+		{
+			appendStringInfo(cmdStr,
+							 " ON %s." DOCUMENT_DATA_TABLE_NAME_FORMAT,
+							 ApiDataSchemaName, collectionId);
+		}
+
+		appendStringInfo(cmdStr,
+						 " USING hash (document %s.bson_hash_path_ops(path=%s)) %s%s%s",
+						 ApiInternalSchemaNameV2,
+						 quote_literal_cstr(indexKeyPath->path),
+						 indexDef->partialFilterExpr ? "WHERE (" : "",
+						 indexDef->partialFilterExpr ?
+						 GenerateIndexFilterStr(collectionId,
+												indexDef->partialFilterExpr) :
+						 "",
+						 indexDef->partialFilterExpr ? ")" : "");
+	}
 	else
 	{
 		appendStringInfo(cmdStr,
@@ -4912,6 +5043,7 @@ CreatePostgresIndexCreationCmd(uint64 collectionId, IndexDef *indexDef, int inde
 											  indexDef->languageOverride,
 											  enableLargeIndexKeys,
 											  useReducedWildcardTermGeneration,
+											  indexDef->collationString,
 											  indexAm->get_opclass_catalog_schema(),
 											  indexAm->get_opclass_internal_catalog_schema()),
 						 indexDef->partialFilterExpr ? "WHERE (" : "",
@@ -5268,6 +5400,7 @@ GenerateIndexExprStr(const char *indexAmSuffix,
 					 const char *indexName, const char *defaultLanguage,
 					 const char *languageOverride, bool enableLargeIndexKeys,
 					 bool useReducedWildcardTerms,
+					 const char *collationString,
 					 const char *indexAmOpClassCatalogSchema,
 					 const char *indexAmOpClassInternalCatalogSchema)
 {
@@ -5402,13 +5535,18 @@ GenerateIndexExprStr(const char *indexAmSuffix,
 
 			if (wpPathOps->nonIdFieldInclusion != WP_IM_INVALID)
 			{
+				/* Terms of inclusion projections can refer to the included path by ordinal */
+				bool useCompactPaths = EnableCompactWildcardProjectionTerms &&
+									   wpPathOps->nonIdFieldInclusion == WP_IM_INCLUDE &&
+									   IsClusterVersionAtleast(DocDB_V0, 108, 0);
 				appendStringInfo(indexExprStr,
-								 ", pathspec=%s, isexclusion=%s)",
+								 ", pathspec=%s, isexclusion=%s%s)",
 								 quote_literal_cstr(
 									 StringListGetBsonArrayRepr(
 										 wpPathOps->nonIdFieldPathList)),
 								 wpPathOps->nonIdFieldInclusion == WP_IM_EXCLUDE ?
-								 "true" : "false");
+								 "true" : "false",
+								 useCompactPaths ? ", cp=true" : "");
 			}
 			else
 			{
@@ -5575,6 +5713,7 @@ GenerateIndexExprStr(const char *indexAmSuffix,
 
 					const char *useReducedWildcardOption = "";
 					const char *generateNotFoundTermOption = "";
+					const char *hashTruncatedTermsOption = "";
 					if (useReducedWildcardTerms && indexKeyPath->isWildcard)
 					{
 						useReducedWildcardOption = ",rwt=true";
@@ -5585,8 +5724,24 @@ GenerateIndexExprStr(const char *indexAmSuffix,
 						generateNotFoundTermOption = ",generateNotFoundTerm=true";
 					}
 
+					/* Unique indexes check their terms with the unique op class instead */
+					if (EnableHashedTruncatedIndexTerms && !unique &&
+						indexTermSizeLimitArg[0] != '\0' &&
+						IsClusterVersionAtleast(DocDB_V0, 108, 0))
+					{
+						hashTruncatedTermsOption = ",th=true";
+					}
+
+					const char *collationOptionKey = "";
+					const char *collationOptionValue = "";
+					if (collationString != NULL)
+					{
+						collationOptionKey = ",collation=";
+						collationOptionValue = quote_literal_cstr(collationString);
+					}
+
 					appendStringInfo(indexExprStr,
-									 "%s document %s.bson_%s_single_path_ops(path=%s%s%s%s%s)",
+									 "%s document %s.bson_%s_single_path_ops(path=%s%s%s%s%s%s%s%s)",
 									 firstColumnWritten ? "," : "",
 									 indexAmOpClassCatalogSchema,
 									 indexAmSuffix,
@@ -5594,7 +5749,10 @@ GenerateIndexExprStr(const char *indexAmSuffix,
 									 indexKeyPath->isWildcard ? ",iswildcard=true" : "",
 									 indexTermSizeLimitArg,
 									 generateNotFoundTermOption,
-									 useReducedWildcardOption);
+									 useReducedWildcardOption,
+									 hashTruncatedTermsOption,
+									 collationOptionKey,
+									 collationOptionValue);
 					if (unique)
 					{
 						appendStringInfo(indexExprStr, " WITH OPERATOR(%s.=?=)",
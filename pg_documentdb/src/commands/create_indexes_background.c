@@ -105,9 +105,13 @@ typedef enum BackgroundIndexRunStatus
 
 	/* An index build was done in the current loop */
 	RunStatus_IndexBuildDone = 4,
+
+	/* Index builds were held back because the replicas are lagging */
+	RunStatus_ThrottledByReplicationLag = 5,
 } BackgroundIndexRunStatus;
 
 extern int MaxIndexBuildAttempts;
+extern int MaxIndexBuildReplicationLagInSec;
 extern int IndexQueueEvictionIntervalInSec;
 extern bool EnableMultipleIndexBuildsPerRun;
 
@@ -165,6 +169,7 @@ static Datum ComposeCheckIndexStatusResponse(FunctionCallInfo fcinfo, pgbson *bs
 											 ok, bool finish);
 static void TryDropCollectionIndex(int indexId);
 static bool PruneSkippableIndexes(void);
+static bool IsIndexBuildThrottledByReplicationLag(void);
 static BackgroundIndexRunStatus build_index_concurrently_from_indexqueue_core(
 	MemoryContext stableContext);
 
@@ -228,6 +233,43 @@ command_build_index_background(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Index builds write the whole index to the WAL, which can leave the replicas far
+ * behind when many builds run back to back. When the replay lag of any replica
+ * exceeds MaxIndexBuildReplicationLagInSec, no new build is started in this round.
+ */
+static bool
+IsIndexBuildThrottledByReplicationLag(void)
+{
+	if (MaxIndexBuildReplicationLagInSec <= 0)
+	{
+		return false;
+	}
+
+	const char *query =
+		"SELECT EXTRACT(EPOCH FROM MAX(replay_lag))::int8 FROM pg_catalog.pg_stat_replication";
+
+	bool isNull = false;
+	bool readOnly = true;
+	Datum result = ExtensionExecuteQueryViaSPI(query, readOnly, SPI_OK_SELECT, &isNull);
+	if (isNull)
+	{
+		return false;
+	}
+
+	int64 replicationLagInSec = DatumGetInt64(result);
+	if (replicationLagInSec <= MaxIndexBuildReplicationLagInSec)
+	{
+		return false;
+	}
+
+	ereport(LOG, (errmsg("Replication lag of " INT64_FORMAT
+						 " seconds exceeds the limit of %d seconds. Retrying index builds in another round.",
+						 replicationLagInSec, MaxIndexBuildReplicationLagInSec)));
+	return true;
+}
+
+
 static BackgroundIndexRunStatus
 build_index_concurrently_from_indexqueue_core(MemoryContext stableContext)
 {
@@ -239,6 +281,11 @@ build_index_concurrently_from_indexqueue_core(MemoryContext stableContext)
 		return RunStatus_PrunedSkippableIndexes;
 	}
 
+	if (IsIndexBuildThrottledByReplicationLag())
+	{
+		return RunStatus_ThrottledByReplicationLag;
+	}
+
 	List *excludeCollectionIds = NIL;
 	uint64 *collectionIds = GetCollectionIdsForIndexBuild(excludeCollectionIds);
 
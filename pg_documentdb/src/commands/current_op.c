@@ -15,6 +15,7 @@
 #include <utils/builtins.h>
 #include <catalog/namespace.h>
 #include <catalog/pg_am_d.h>
+#include <utils/timestamp.h>
 
 #include "io/bson_core.h"
 #include "metadata/index.h"
@@ -32,6 +33,7 @@
 #include "metadata/index.h"
 #include "utils/guc_utils.h"
 #include "index_am/index_am_utils.h"
+#include "infrastructure/command_activity.h"
 
 
 /*
@@ -57,6 +59,17 @@ typedef struct
 } CurrentOpOptions;
 
 
+/*
+ * The response the worker activities are merged into.
+ */
+typedef struct
+{
+	TupleDesc descriptor;
+
+	Tuplestorestate *tupleStore;
+} CurrentOpMergeState;
+
+
 /*
  * Wrapper holding a single activity in a worker.
  */
@@ -104,8 +117,17 @@ typedef struct
 	/* During processing, whether or not to add index build stats */
 	bool processedBuildIndexStatProgress;
 
+	/* During processing, whether or not to add the vacuum stats of a compact */
+	bool processedVacuumStatProgress;
+
 	/* Index spec for running create Index */
 	IndexSpec *indexSpec;
+
+	/* The query_start of pg_stat_activity */
+	TimestampTz queryStartTimestamp;
+
+	/* The command the backend published for the query, if any */
+	const CommandActivity *commandActivity;
 } SingleWorkerActivity;
 
 PG_FUNCTION_INFO_V1(command_current_op);
@@ -118,8 +140,7 @@ static pgbson * BuildAggregateSpecFromCommandSpec(pgbson *commandSpec,
 static void CurrentOpAggregateCore(pgbson *spec, TupleDesc descriptor,
 								   Tuplestorestate *tupleStore);
 static void PopulateCurrentOpOptions(pgbson *bson, CurrentOpOptions *options);
-static void MergeWorkerBsons(List *workerBsons, TupleDesc descriptor,
-							 Tuplestorestate *tupleStore);
+static void MergeWorkerBson(pgbson *workerBson, void *state);
 static pgbson * CurrentOpWorkerCore(void *spec);
 static List * WorkerGetBaseActivities(void);
 static void WriteOneActivityToDocument(SingleWorkerActivity *activity,
@@ -130,14 +151,18 @@ static const char * WriteCommandAndGetQueryType(const char *query,
 static void DetectMongoCollection(SingleWorkerActivity *activity);
 static IndexSpec * GetIndexSpecForShardedCreateIndexQuery(SingleWorkerActivity *activity);
 static void AddIndexBuilds(TupleDesc descriptor, Tuplestorestate *tupleStore);
+static void WriteVacuumProgress(SingleWorkerActivity *activity, pgbson_writer *writer);
 static const char * WriteIndexBuildProgressAndGetMessage(SingleWorkerActivity *activity,
 														 pgbson_writer *writer);
 static void WriteGlobalPidOfLockingProcess(SingleWorkerActivity *activity,
 										   pgbson_writer *writer);
 static void WriteIndexSpec(SingleWorkerActivity *activity, pgbson_writer *commandWriter);
+static void MatchPublishedCommandActivities(List *activities);
+static int CompareCommandActivityPids(const void *left, const void *right);
 
 extern char *CurrentOpApplicationName;
 extern bool CurrentOpAddSqlCommand;
+extern bool EnableCommandActivityRegistry;
 
 
 /* Single node scenario - the global_pid can be assumed to be just the one for the coordinator */
@@ -259,24 +284,27 @@ CurrentOpAggregateCore(pgbson *spec, TupleDesc descriptor,
 	CurrentOpOptions options = { 0 };
 	PopulateCurrentOpOptions(spec, &options);
 
-	List *workerBsons = NIL;
+	CurrentOpMergeState mergeState = {
+		.descriptor = descriptor,
+		.tupleStore = tupleStore
+	};
+
 	if (options.localOps)
 	{
-		workerBsons = list_make1(CurrentOpWorkerCore(spec));
+		MergeWorkerBson(CurrentOpWorkerCore(spec), &mergeState);
 	}
 	else
 	{
 		int numValues = 1;
 		Datum values[1] = { PointerGetDatum(spec) };
 		Oid types[1] = { BsonTypeId() };
-		workerBsons = RunQueryOnAllServerNodes("CurrentOp", values, types, numValues,
-											   command_current_op_worker,
-											   ApiToApiInternalSchemaName,
-											   "current_op_worker");
+		RunQueryOnAllServerNodesStreaming("CurrentOp", values, types, numValues,
+										  command_current_op_worker,
+										  ApiToApiInternalSchemaName,
+										  "current_op_worker",
+										  MergeWorkerBson, &mergeState);
 	}
 
-	MergeWorkerBsons(workerBsons, descriptor, tupleStore);
-
 	/* The index queue and build status only needs to run on the coordinator
 	 * run this only here.
 	 */
@@ -328,63 +356,64 @@ PopulateCurrentOpOptions(pgbson *spec, CurrentOpOptions *options)
 
 
 /*
- * Logic that builds the currentOp responses (only runs on query coordinator)
+ * Logic that builds the currentOp responses (only runs on query coordinator):
+ * Adds the activities of a worker to the response as soon as it returned them.
  */
 static void
-MergeWorkerBsons(List *workerBsons, TupleDesc descriptor, Tuplestorestate *tupleStore)
+MergeWorkerBson(pgbson *workerBson, void *state)
 {
-	ListCell *workerCell;
-	foreach(workerCell, workerBsons)
-	{
-		pgbson *workerBson = lfirst(workerCell);
-		bson_iter_t workerIter;
-		PgbsonInitIterator(workerBson, &workerIter);
+	CurrentOpMergeState *mergeState = (CurrentOpMergeState *) state;
+	bson_iter_t workerIter;
+	PgbsonInitIterator(workerBson, &workerIter);
 
-		int errorCode = 0;
-		const char *errorMessage = NULL;
-		while (bson_iter_next(&workerIter))
+	int errorCode = 0;
+	const char *errorMessage = NULL;
+	while (bson_iter_next(&workerIter))
+	{
+		const char *key = bson_iter_key(&workerIter);
+		if (strcmp(key, ErrCodeKey) == 0)
 		{
-			const char *key = bson_iter_key(&workerIter);
-			if (strcmp(key, ErrCodeKey) == 0)
-			{
-				errorCode = BsonValueAsInt32(bson_iter_value(&workerIter));
-			}
-			else if (strcmp(key, ErrMsgKey) == 0)
-			{
-				const char *string = bson_iter_utf8(&workerIter, NULL);
-				errorMessage = pstrdup(string);
-			}
-			else if (strcmp(key, "activities") == 0)
+			errorCode = BsonValueAsInt32(bson_iter_value(&workerIter));
+		}
+		else if (strcmp(key, ErrMsgKey) == 0)
+		{
+			const char *string = bson_iter_utf8(&workerIter, NULL);
+			errorMessage = pstrdup(string);
+		}
+		else if (strcmp(key, "activities") == 0)
+		{
+			bson_iter_t activityIter;
+			if (bson_iter_recurse(&workerIter, &activityIter))
 			{
-				bson_iter_t activityIter;
-				if (bson_iter_recurse(&workerIter, &activityIter))
+				while (bson_iter_next(&activityIter))
 				{
-					while (bson_iter_next(&activityIter))
-					{
-						pgbson *docBson = PgbsonInitFromDocumentBsonValue(bson_iter_value(
-																			  &
-																			  activityIter));
-
-						Datum tupleValue[1] = { PointerGetDatum(docBson) };
-						bool nulls[1] = { false };
-						tuplestore_putvalues(tupleStore, descriptor, tupleValue, nulls);
-					}
+					pgbson *docBson = PgbsonInitFromDocumentBsonValue(bson_iter_value(
+																		  &activityIter));
+
+					Datum tupleValue[1] = { PointerGetDatum(docBson) };
+					bool nulls[1] = { false };
+					tuplestore_putvalues(mergeState->tupleStore, mergeState->descriptor,
+										 tupleValue, nulls);
+					pfree(docBson);
 				}
 			}
-			else
-			{
-				ereport(ERROR, (errmsg("unknown field received from currentOp worker %s",
-									   key)));
-			}
 		}
-
-		if (errorMessage != NULL)
+		else
 		{
-			errorCode = errorCode == 0 ? ERRCODE_DOCUMENTDB_INTERNALERROR : errorCode;
-			ereport(ERROR, (errcode(errorCode), errmsg("Error running currentOp: %s",
-													   errorMessage)));
+			ereport(ERROR, (errmsg("unknown field received from currentOp worker %s",
+								   key)));
 		}
 	}
+
+	if (errorMessage != NULL)
+	{
+		errorCode = errorCode == 0 ? ERRCODE_DOCUMENTDB_INTERNALERROR : errorCode;
+		ereport(ERROR, (errcode(errorCode), errmsg("Error running currentOp: %s",
+												   errorMessage)));
+	}
+
+	/* The activities were copied into the tuple store */
+	pfree(workerBson);
 }
 
 
@@ -399,6 +428,10 @@ CurrentOpWorkerCore(void *specPointer)
 	PopulateCurrentOpOptions(spec, &options);
 
 	List *activities = WorkerGetBaseActivities();
+	if (EnableCommandActivityRegistry)
+	{
+		MatchPublishedCommandActivities(activities);
+	}
 
 	pgbson_writer writer;
 	PgbsonWriterInit(&writer);
@@ -471,7 +504,8 @@ WorkerGetBaseActivities()
 						   " pa.wait_event_type AS wait_event_type, "
 						   " pa.global_pid || ':' || (EXTRACT(epoch FROM pa.query_start) * 1000000)::numeric(20,0) AS op_id, "
 						   " EXTRACT(epoch FROM now() - pa.state_change)::bigint AS state_change_since, "
-						   " pa.groupid AS shard_id FROM (");
+						   " pa.groupid AS shard_id, "
+						   " pa.query_start AS query_start_timestamp FROM (");
 
 	appendStringInfoString(queryInfo, DistributedOperationsQuery);
 
@@ -667,6 +701,15 @@ WorkerGetBaseActivities()
 			activity->shardId = DatumGetInt32(resultDatum);
 		}
 
+		/* query_start_timestamp (Attr 12) */
+		resultDatum = SPI_getbinval(SPI_tuptable->vals[0],
+									SPI_tuptable->tupdesc, 12,
+									&isNull);
+		if (!isNull)
+		{
+			activity->queryStartTimestamp = DatumGetTimestampTz(resultDatum);
+		}
+
 		spiContext = MemoryContextSwitchTo(priorMemoryContext);
 		workerActivities = lappend(workerActivities, activity);
 		MemoryContextSwitchTo(spiContext);
@@ -679,6 +722,59 @@ WorkerGetBaseActivities()
 }
 
 
+/*
+ * Matches the active queries with the commands their backends published in
+ * the shared command activity registry. A published command only describes
+ * the query if it was published during that same statement, which the
+ * statement start time tells.
+ */
+static void
+MatchPublishedCommandActivities(List *activities)
+{
+	int publishedCount = 0;
+	CommandActivity *publishedActivities = GetCommandActivitySnapshot(&publishedCount);
+	if (publishedCount == 0)
+	{
+		return;
+	}
+
+	qsort(publishedActivities, publishedCount, sizeof(CommandActivity),
+		  CompareCommandActivityPids);
+
+	ListCell *cell;
+	foreach(cell, activities)
+	{
+		SingleWorkerActivity *activity = lfirst(cell);
+		if (activity->statPid <= 0 || activity->queryStartTimestamp == 0 ||
+			strcmp(activity->state, "active") != 0)
+		{
+			continue;
+		}
+
+		CommandActivity searchKey = { 0 };
+		searchKey.pid = (int) activity->statPid;
+		CommandActivity *published = bsearch(&searchKey, publishedActivities,
+											 publishedCount, sizeof(CommandActivity),
+											 CompareCommandActivityPids);
+		if (published != NULL &&
+			published->statementStartTime == activity->queryStartTimestamp)
+		{
+			activity->commandActivity = published;
+		}
+	}
+}
+
+
+static int
+CompareCommandActivityPids(const void *left, const void *right)
+{
+	const CommandActivity *leftActivity = (const CommandActivity *) left;
+	const CommandActivity *rightActivity = (const CommandActivity *) right;
+	return leftActivity->pid < rightActivity->pid ? -1 :
+		   leftActivity->pid > rightActivity->pid ? 1 : 0;
+}
+
+
 /*
  * Given an activity on a worker node via SingleWorkerActivity,
  * writes the activity to the target pgbson_writer. The activity
@@ -688,7 +784,16 @@ static void
 WriteOneActivityToDocument(SingleWorkerActivity *workerActivity,
 						   pgbson_writer *singleActivityWriter)
 {
-	DetectMongoCollection(workerActivity);
+	const CommandActivity *commandActivity = workerActivity->commandActivity;
+	if (commandActivity != NULL)
+	{
+		workerActivity->processedMongoDatabase = commandActivity->databaseName;
+		workerActivity->processedMongoCollection = commandActivity->collectionName;
+	}
+	else
+	{
+		DetectMongoCollection(workerActivity);
+	}
 
 	char *shardId = psprintf("shard_%d", workerActivity->shardId);
 	PgbsonWriterAppendUtf8(singleActivityWriter, "shard", 5, shardId);
@@ -761,9 +866,20 @@ WriteOneActivityToDocument(SingleWorkerActivity *workerActivity,
 		PgbsonWriterStartDocument(singleActivityWriter, "command", 7,
 								  &commandDocumentWriter);
 
-		const char *queryType = WriteCommandAndGetQueryType(workerActivity->query,
-															workerActivity,
-															&commandDocumentWriter);
+		const char *queryType;
+		if (commandActivity != NULL)
+		{
+			PgbsonWriterAppendUtf8(&commandDocumentWriter, commandActivity->commandName,
+								   strlen(commandActivity->commandName),
+								   commandActivity->collectionName);
+			queryType = commandActivity->opType;
+		}
+		else
+		{
+			queryType = WriteCommandAndGetQueryType(workerActivity->query,
+													workerActivity,
+													&commandDocumentWriter);
+		}
 		PgbsonWriterEndDocument(singleActivityWriter, &commandDocumentWriter);
 		PgbsonWriterAppendUtf8(singleActivityWriter, "op", 2, queryType);
 	}
@@ -809,6 +925,14 @@ WriteOneActivityToDocument(SingleWorkerActivity *workerActivity,
 			PgbsonWriterAppendUtf8(singleActivityWriter, "msg", 3, message);
 		}
 	}
+
+	if (workerActivity->processedVacuumStatProgress && workerActivity->statPid > 0)
+	{
+		pgbson_writer progressWriter;
+		PgbsonWriterStartDocument(singleActivityWriter, "progress", 8, &progressWriter);
+		WriteVacuumProgress(workerActivity, &progressWriter);
+		PgbsonWriterEndDocument(singleActivityWriter, &progressWriter);
+	}
 }
 
 
@@ -1077,6 +1201,14 @@ WriteCommandAndGetQueryType(const char *query, SingleWorkerActivity *activity,
 		activity->processedBuildIndexStatProgress = true;
 		return "workerCommand";
 	}
+	else if (strstr(query, "VACUUM") == query)
+	{
+		/* The vacuum sent by compact for the collection */
+		PgbsonWriterAppendUtf8(commandWriter, "compact", 7,
+							   activity->processedMongoCollection);
+		activity->processedVacuumStatProgress = true;
+		return "workerCommand";
+	}
 	else
 	{
 		return "command";
@@ -1470,6 +1602,11 @@ PhaseToUserMessage(const char *phaseString)
 }
 
 
+/* The fraction done of the current phase of an index build, terms when known and blocks otherwise */
+#define INDEX_BUILD_FRACTION_DONE \
+	" LATERAL (SELECT COALESCE(p.tuples_done::float8 / NULLIF(p.tuples_total, 0), " \
+	" p.blocks_done::float8 / NULLIF(p.blocks_total, 0)) AS fraction_done) f"
+
 /*
  * Gets the index progress data from pg_stat_progress_create_index and writes it out to the
  * "progress" document as well as builds a message for the top level currentOp.
@@ -1488,18 +1625,29 @@ WriteIndexBuildProgressAndGetMessage(SingleWorkerActivity *activity,
 					 " tuples_done AS \"terms_done\", tuples_total AS \"terms_total\", "
 					 " (tuples_done * 100.0 / NULLIF(tuples_total, 0)) AS \"terms_progress\", ");
 
+	/*
+	 * The time left is extrapolated from the time the build has been running and the
+	 * fraction done of the current phase. It is NULL, and skipped, until the phase has
+	 * made progress.
+	 */
+	appendStringInfo(str,
+					 " (EXTRACT(EPOCH FROM now() - (SELECT a.query_start FROM pg_catalog.pg_stat_activity a WHERE a.pid = p.pid)) * "
+					 " (1 - f.fraction_done) / NULLIF(f.fraction_done, 0))::int8 AS \"secs_remaining\", ");
+
 	if (DefaultInlineWriteOperations)
 	{
 		/* Match the distributed set up to say a single node has a global pid of node 1 + PID (Similar to citus logic) */
 		appendStringInfo(str,
-						 " (10000000000 + current_locker_pid)::int8 AS AS \"Waiting on op_prefix\""
-						 " FROM pg_stat_progress_create_index WHERE (10000000000 + current_locker_pid)::int8 = $1), ");
+						 " (10000000000 + current_locker_pid)::int8 AS \"Waiting on op_prefix\""
+						 " FROM pg_stat_progress_create_index p, " INDEX_BUILD_FRACTION_DONE
+						 " WHERE (10000000000 + current_locker_pid)::int8 = $1), ");
 	}
 	else
 	{
 		appendStringInfo(str,
 						 " pg_catalog.citus_calculate_gpid(pg_catalog.citus_nodeid_for_gpid($1), current_locker_pid::integer) AS \"Waiting on op_prefix\""
-						 " FROM pg_stat_progress_create_index WHERE pid IN (SELECT process_id FROM pg_catalog.get_all_active_transactions() WHERE global_pid = $1)), ");
+						 " FROM pg_stat_progress_create_index p, " INDEX_BUILD_FRACTION_DONE
+						 " WHERE p.pid IN (SELECT process_id FROM pg_catalog.get_all_active_transactions() WHERE global_pid = $1)), ");
 	}
 
 	appendStringInfo(str,
@@ -1577,6 +1725,49 @@ WriteIndexBuildProgressAndGetMessage(SingleWorkerActivity *activity,
 }
 
 
+/*
+ * Gets the progress of the vacuum run by compact from pg_stat_progress_vacuum and writes
+ * it out to the "progress" document. The vacuum runs on a local connection of the
+ * node, so it is matched on the pid.
+ */
+static void
+WriteVacuumProgress(SingleWorkerActivity *activity, pgbson_writer *writer)
+{
+	/* NULLIF(heap_blks_total) skips "Progress" for empty tables, the same as for index builds */
+	StringInfo str = makeStringInfo();
+	appendStringInfo(str,
+					 "WITH c1 AS (SELECT phase, heap_blks_total AS blocks_total, "
+					 " heap_blks_scanned AS blocks_scanned, heap_blks_vacuumed AS blocks_vacuumed, "
+					 " (heap_blks_scanned * 100.0 / NULLIF(heap_blks_total, 0)) AS \"Progress\" "
+					 " FROM pg_catalog.pg_stat_progress_vacuum WHERE pid = $1) "
+					 " SELECT %s.row_get_bson(c1) FROM c1", CoreSchemaName);
+
+	Oid argTypes[1] = { INT4OID };
+	Datum argValues[1] = {
+		Int32GetDatum((int32) activity->statPid)
+	};
+	char argNulls[1] = { ' ' };
+	bool readOnly = true;
+
+	bool isNull = false;
+	Datum result = ExtensionExecuteQueryWithArgsViaSPI(str->data, 1, argTypes, argValues,
+													   argNulls,
+													   readOnly, SPI_OK_SELECT, &isNull);
+	if (isNull)
+	{
+		return;
+	}
+
+	bson_iter_t resultIter;
+	PgbsonInitIterator(DatumGetPgBson(result), &resultIter);
+	while (bson_iter_next(&resultIter))
+	{
+		const char *key = bson_iter_key(&resultIter);
+		PgbsonWriterAppendValue(writer, key, strlen(key), bson_iter_value(&resultIter));
+	}
+}
+
+
 /*
  * Given an activity that's waiting on a lock, gets the process that currently holds that lock.
  */
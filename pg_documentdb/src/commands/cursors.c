@@ -11,6 +11,12 @@
 #include <fmgr.h>
 #include <miscadmin.h>
 #include <funcapi.h>
+#include <access/genam.h>
+#include <access/table.h>
+#include <access/tableam.h>
+#include <executor/executor.h>
+#include <utils/fmgroids.h>
+#include <utils/rel.h>
 #include <utils/portal.h>
 #include <utils/varlena.h>
 #include <utils/typcache.h>
@@ -36,7 +42,9 @@
 #include "io/bson_set_returning_functions.h"
 #include "commands/commands_common.h"
 #include "planner/documents_custom_planner.h"
+#include "metadata/collection.h"
 #include "infrastructure/cursor_store.h"
+#include "utils/guc_utils.h"
 
 
 /*
@@ -48,7 +56,24 @@ extern int32_t MaxWorkerCursorSize;
 extern bool EnablePrimaryKeyCursorScan;
 extern bool UseFileBasedPersistedCursors;
 extern bool EnableDebugQueryText;
+extern bool EnableSlowOperationLog;
 extern bool EnableDelayedHoldPortal;
+extern bool EnableParallelQueryPlans;
+extern bool EnableOutInsertSelect;
+
+/*
+ * The field and the version of the compact continuation: A binary value with
+ * <version><varint count> followed by one entry per shard of
+ * <flags><table name><varint block><varint offset>[<varint length><pk bson>].
+ * The table name is written as varint collection (and shard) ids when it is a
+ * documents_<collectionId>[_<shardId>] table.
+ */
+#define COMPACT_CONTINUATION_FIELD "cc"
+#define COMPACT_CONTINUATION_VERSION 1
+
+#define COMPACT_CONTINUATION_FLAG_TABLE_ID 0x1
+#define COMPACT_CONTINUATION_FLAG_SHARD_ID 0x2
+#define COMPACT_CONTINUATION_FLAG_PRIMARY_KEY 0x4
 
 static char LastOpenPortalName[NAMEDATALEN] = { 0 };
 
@@ -138,6 +163,8 @@ static void UpdateCursorInContinuationMap(pgbson *continuationValue, HTAB *curso
 										  isTailable);
 
 static void UpdateCursorInContinuationMapCore(bson_iter_t *iter, HTAB *cursorMap);
+static void BuildContinuationMapFromCompact(const bson_value_t *compactValue,
+											HTAB *cursorMap);
 static void UpdateTailableCursorInContinuationMapCore(bson_iter_t *iter,
 													  HTAB *cursorMap);
 
@@ -190,6 +217,8 @@ static BsonStoreTupleDestReceiver * CreateBsonStoreTupleDestReceiver(
 static void DrainStatementViaExecutor(PlannedStmt *queryPlan, ParamListInfo paramList,
 									  const char *sourceText, DestReceiver *destReceiver,
 									  MemoryContext currentContext);
+static PlannedStmt * PlanRunOnceQuery(Query *query, int cursorOptions,
+									  ParamListInfo paramList, int maxParallelWorkers);
 
 const char NodeId[] = "nodeId";
 uint32_t NodeIdLength = 7;
@@ -213,12 +242,13 @@ DrainSingleResultQuery(Query *query)
 	queryPortal->cursorOptions = cursorOptions;
 
 	ParamListInfo paramListInfo = NULL;
-	PlannedStmt *queryPlan = pg_plan_query(query, NULL, cursorOptions,
-										   paramListInfo);
+	int maxParallelWorkers = -1;
+	PlannedStmt *queryPlan = PlanRunOnceQuery(query, cursorOptions, paramListInfo,
+											  maxParallelWorkers);
 
 	/* Set the plan in the cursor for this iteration */
 	char *sourceText = "";
-	if (EnableDebugQueryText)
+	if (EnableDebugQueryText || EnableSlowOperationLog)
 	{
 		bool pretty = false;
 		sourceText = pg_get_querydef(query, pretty);
@@ -231,6 +261,12 @@ DrainSingleResultQuery(Query *query)
 	/* Trigger execution (Start the ExecEngine etc.) */
 	PortalStart(queryPortal, paramListInfo, 0, GetActiveSnapshot());
 
+	/*
+	 * The portal is fetched from exactly once: Let the executor know so that it
+	 * can run a parallel plan.
+	 */
+	queryPortal->run_once = true;
+
 	if (SPI_connect() != SPI_OK_CONNECT)
 	{
 		ereport(ERROR, (errmsg("could not connect to SPI manager")));
@@ -390,7 +426,8 @@ DrainTailableQuery(HTAB *cursorMap, Query *query, int batchSize,
 
 void
 CreateAndDrainSingleBatchQuery(const char *cursorName, Query *query,
-							   int batchSize, int32_t *numIterations, uint32_t
+							   int batchSize, int maxParallelWorkers,
+							   int32_t *numIterations, uint32_t
 							   accumulatedSize, pgbson_array_writer *arrayWriter)
 {
 	/* Set up cursor flags */
@@ -402,7 +439,8 @@ CreateAndDrainSingleBatchQuery(const char *cursorName, Query *query,
 
 	/* Plan the query */
 	ParamListInfo paramList = NULL;
-	PlannedStmt *queryPlan = pg_plan_query(query, NULL, cursorOptions, paramList);
+	PlannedStmt *queryPlan = PlanRunOnceQuery(query, cursorOptions, paramList,
+											  maxParallelWorkers);
 	BsonStoreTupleDestReceiver *receiver = CreateBsonStoreTupleDestReceiver(
 		arrayWriter,
 		CurrentMemoryContext,
@@ -411,7 +449,7 @@ CreateAndDrainSingleBatchQuery(const char *cursorName, Query *query,
 		accumulatedSize,
 		closeCursor);
 	char *sourceText = "";
-	if (EnableDebugQueryText)
+	if (EnableDebugQueryText || EnableSlowOperationLog)
 	{
 		bool pretty = false;
 		sourceText = pg_get_querydef(query, pretty);
@@ -492,9 +530,10 @@ CreateAndDrainPersistedQuery(const char *cursorName, Query *query,
 	queryPortal->visible = true;
 	queryPortal->cursorOptions = cursorOptions;
 
-	if (query->commandType == CMD_MERGE)
+	if (query->commandType == CMD_MERGE ||
+		(EnableOutInsertSelect && query->commandType == CMD_INSERT))
 	{
-		/* In order to use a portal & SPI in Merge Command we need to set it to true */
+		/* In order to use a portal & SPI in Merge (or the INSERT of $out) Command we need to set it to true */
 		queryPlan->hasReturning = true;
 	}
 	else if (!closeCursor && (!EnableDelayedHoldPortal || !isHoldCursor))
@@ -511,7 +550,7 @@ CreateAndDrainPersistedQuery(const char *cursorName, Query *query,
 
 	/* Set the plan into the portal  */
 	char *sourceText = "";
-	if (EnableDebugQueryText)
+	if (EnableDebugQueryText || EnableSlowOperationLog)
 	{
 		bool pretty = false;
 		sourceText = pg_get_querydef(query, pretty);
@@ -578,7 +617,8 @@ CreateAndDrainPersistedQuery(const char *cursorName, Query *query,
 
 bytea *
 CreateAndDrainPersistedQueryWithFiles(const char *cursorName, Query *query,
-									  int batchSize, int32_t *numIterations, uint32_t
+									  int batchSize, int maxParallelWorkers,
+									  int32_t *numIterations, uint32_t
 									  accumulatedSize,
 									  pgbson_array_writer *arrayWriter, bool closeCursor)
 {
@@ -590,7 +630,8 @@ CreateAndDrainPersistedQueryWithFiles(const char *cursorName, Query *query,
 
 	/* Plan the query */
 	ParamListInfo paramList = NULL;
-	PlannedStmt *queryPlan = pg_plan_query(query, NULL, cursorOptions, paramList);
+	PlannedStmt *queryPlan = PlanRunOnceQuery(query, cursorOptions, paramList,
+											  maxParallelWorkers);
 
 	BsonStoreTupleDestReceiver *receiver = CreateBsonStoreTupleDestReceiver(arrayWriter,
 																			CurrentMemoryContext,
@@ -599,7 +640,7 @@ CreateAndDrainPersistedQueryWithFiles(const char *cursorName, Query *query,
 																			accumulatedSize,
 																			closeCursor);
 	char *sourceText = "";
-	if (EnableDebugQueryText)
+	if (EnableDebugQueryText || EnableSlowOperationLog)
 	{
 		bool pretty = false;
 		sourceText = pg_get_querydef(query, pretty);
@@ -648,7 +689,7 @@ CreateAndDrainPointReadQuery(const char *cursorName, Query *query,
 		accumulatedSize,
 		closeCursor);
 	char *sourceText = "";
-	if (EnableDebugQueryText)
+	if (EnableDebugQueryText || EnableSlowOperationLog)
 	{
 		bool pretty = false;
 		sourceText = pg_get_querydef(query, pretty);
@@ -658,6 +699,127 @@ CreateAndDrainPointReadQuery(const char *cursorName, Query *query,
 }
 
 
+/*
+ * Fetches the documents with the given object_ids ({ "": <_id> }) under the
+ * shard key value from the primary key index of the relation directly, without
+ * building or planning a query, and writes them to the array writer.
+ * Returns false without writing anything if the relation doesn't have the
+ * (shard_key_value, object_id) primary key or the documents don't fit in
+ * a single page, in which case the caller falls back to the query path.
+ */
+bool
+TryDrainDirectPointRead(Oid relationId, int64 shardKeyValue, List *objectIds,
+						uint32_t accumulatedSize, pgbson_array_writer *arrayWriter)
+{
+	Relation relation = table_open(relationId, AccessShareLock);
+	Oid primaryKeyIndexId = relation->rd_pkindex;
+	if (primaryKeyIndexId == InvalidOid)
+	{
+#if PG_VERSION_NUM >= 180000
+		bool deferrableOk = false;
+		primaryKeyIndexId = RelationGetPrimaryKeyIndex(relation, deferrableOk);
+#else
+		primaryKeyIndexId = RelationGetPrimaryKeyIndex(relation);
+#endif
+	}
+
+	if (primaryKeyIndexId == InvalidOid)
+	{
+		table_close(relation, NoLock);
+		return false;
+	}
+
+	Relation indexRelation = index_open(primaryKeyIndexId, AccessShareLock);
+	if (indexRelation->rd_index->indnkeyatts != 2 ||
+		indexRelation->rd_index->indkey.values[0] !=
+		DOCUMENT_DATA_TABLE_SHARD_KEY_VALUE_VAR_ATTR_NUMBER ||
+		indexRelation->rd_index->indkey.values[1] !=
+		DOCUMENT_DATA_TABLE_OBJECT_ID_VAR_ATTR_NUMBER)
+	{
+		index_close(indexRelation, NoLock);
+		table_close(relation, NoLock);
+		return false;
+	}
+
+	ScanKeyData scanKeys[2];
+	ScanKeyInit(&scanKeys[0], 1, BTEqualStrategyNumber, F_INT8EQ,
+				Int64GetDatum(shardKeyValue));
+	RegProcedure objectIdEqualProc = get_opcode(BsonEqualOperatorId());
+
+	int numScanKeys = 2;
+	int numOrderByKeys = 0;
+#if PG_VERSION_NUM >= 180000
+	IndexScanDesc scanDesc = index_beginscan(relation, indexRelation,
+											 GetActiveSnapshot(), NULL, numScanKeys,
+											 numOrderByKeys);
+#else
+	IndexScanDesc scanDesc = index_beginscan(relation, indexRelation,
+											 GetActiveSnapshot(), numScanKeys,
+											 numOrderByKeys);
+#endif
+	TupleTableSlot *slot = table_slot_create(relation, NULL);
+
+	/* this is the overhead of the array index, see BsonStoreDestReceiveCore */
+	const int perDocOverhead = 9;
+	uint64 totalSize = accumulatedSize;
+	List *documents = NIL;
+	ListCell *objectIdCell;
+	foreach(objectIdCell, objectIds)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		ScanKeyInit(&scanKeys[1], 2, BTEqualStrategyNumber, objectIdEqualProc,
+					PointerGetDatum(lfirst(objectIdCell)));
+		index_rescan(scanDesc, scanKeys, numScanKeys, NULL, numOrderByKeys);
+
+		/* The primary key is unique, there's at most one match */
+		if (index_getnext_slot(scanDesc, ForwardScanDirection, slot))
+		{
+			bool isNull = false;
+			Datum documentDatum = slot_getattr(slot,
+											   DOCUMENT_DATA_TABLE_DOCUMENT_VAR_ATTR_NUMBER,
+											   &isNull);
+			if (!isNull)
+			{
+				pgbson *document = (pgbson *) PG_DETOAST_DATUM_COPY(documentDatum);
+				totalSize += VARSIZE_ANY_EXHDR(document) + perDocOverhead;
+				documents = lappend(documents, document);
+			}
+		}
+
+		ExecClearTuple(slot);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	index_endscan(scanDesc);
+	index_close(indexRelation, NoLock);
+	table_close(relation, NoLock);
+
+	/* we need to allow at least 1 document per response. */
+	if (totalSize >= BSON_MAX_ALLOWED_SIZE && list_length(documents) > 1)
+	{
+		return false;
+	}
+
+	ListCell *documentCell;
+	foreach(documentCell, documents)
+	{
+		pgbson *document = lfirst(documentCell);
+		if (VARSIZE_ANY_EXHDR(document) > BSON_MAX_ALLOWED_SIZE)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BSONOBJECTTOOLARGE),
+							errmsg("Size %u is larger than MaxDocumentSize %u",
+								   (uint32_t) VARSIZE_ANY_EXHDR(document),
+								   BSON_MAX_ALLOWED_SIZE)));
+		}
+
+		PgbsonArrayWriterWriteDocument(arrayWriter, document);
+	}
+
+	return true;
+}
+
+
 static void
 BsonStoreDestReceiverStartup(DestReceiver *destReceiver, int operation,
 							 TupleDesc inputTupleDesc)
@@ -844,6 +1006,38 @@ DrainStatementViaExecutor(PlannedStmt *queryPlan, ParamListInfo paramList, const
 }
 
 
+/*
+ * Plans a query that is executed exactly once (to completion or until the
+ * receiver stops it) and never fetched from again. Such queries can run
+ * parallel plans: When parallel query plans are enabled, the planner is
+ * allowed to pick Gather paths with up to maxParallelWorkers workers per
+ * Gather (-1 uses max_parallel_workers_per_gather, 0 disables parallelism).
+ */
+static PlannedStmt *
+PlanRunOnceQuery(Query *query, int cursorOptions, ParamListInfo paramList,
+				 int maxParallelWorkers)
+{
+	if (!EnableParallelQueryPlans || maxParallelWorkers == 0)
+	{
+		return pg_plan_query(query, NULL, cursorOptions, paramList);
+	}
+
+	cursorOptions |= CURSOR_OPT_PARALLEL_OK;
+	if (maxParallelWorkers < 0)
+	{
+		return pg_plan_query(query, NULL, cursorOptions, paramList);
+	}
+
+	/* The worker count is fixed in the plan, so the limit only matters for planning */
+	int savedGUCLevel = NewGUCNestLevel();
+	SetGUCLocally("max_parallel_workers_per_gather",
+				  psprintf("%d", maxParallelWorkers));
+	PlannedStmt *queryPlan = pg_plan_query(query, NULL, cursorOptions, paramList);
+	RollbackGUCChange(savedGUCLevel);
+	return queryPlan;
+}
+
+
 /*
  * Given a query that is pre-created, Creates a "Portal" for that query
  * and executes that query inline, updating the target writer with the
@@ -877,7 +1071,7 @@ PlanStreamingQuery(Query *query, Datum parameter, HTAB *cursorMap)
 
 	/* Set the plan in the cursor for this iteration */
 	char *sourceText = "";
-	if (EnableDebugQueryText)
+	if (EnableDebugQueryText || EnableSlowOperationLog)
 	{
 		bool pretty = false;
 		sourceText = pg_get_querydef(query, pretty);
@@ -1553,6 +1747,12 @@ BuildContinuationMap(pgbson *continuationValue, HTAB *cursorMap)
 	while (bson_iter_next(&continuationIterator))
 	{
 		const char *currentField = bson_iter_key(&continuationIterator);
+		if (strcmp(currentField, COMPACT_CONTINUATION_FIELD) == 0)
+		{
+			BuildContinuationMapFromCompact(bson_iter_value(&continuationIterator),
+											cursorMap);
+			continue;
+		}
 
 		/* Ignore all other valuesin this stage. */
 		if (strcmp(currentField, "continuation") != 0)
@@ -1730,6 +1930,268 @@ SerializeContinuationsToWriter(pgbson_writer *writer, HTAB *cursorMap)
 }
 
 
+/*
+ * Appends an unsigned LEB128 varint to the buffer.
+ */
+static void
+AppendVarint(StringInfo buffer, uint64 value)
+{
+	while (value >= 0x80)
+	{
+		appendStringInfoChar(buffer, (char) ((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+
+	appendStringInfoChar(buffer, (char) value);
+}
+
+
+/*
+ * Reads an unsigned LEB128 varint from the buffer and advances it.
+ */
+static uint64
+ReadVarint(const uint8_t **buffer, const uint8_t *end)
+{
+	uint64 value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (*buffer >= end)
+		{
+			break;
+		}
+
+		uint8_t current = *(*buffer)++;
+		value |= ((uint64) (current & 0x7F)) << shift;
+		if ((current & 0x80) == 0)
+		{
+			return value;
+		}
+	}
+
+	ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+					errmsg("Invalid compact continuation: malformed varint")));
+}
+
+
+/*
+ * Parses the ids of a documents_<collectionId>[_<shardId>] table name. Only names
+ * that format back to the same string are parsed, so that the encoding round trips.
+ */
+static bool
+TryParseDocumentsTableName(const char *tableName, uint32_t tableNameLength,
+						   uint64 *collectionId, uint64 *shardId, bool *hasShardId)
+{
+	const uint32_t prefixLength = strlen(DOCUMENT_DATA_TABLE_NAME_PREFIX);
+	if (tableNameLength <= prefixLength || tableNameLength >= NAMEDATALEN ||
+		strncmp(tableName, DOCUMENT_DATA_TABLE_NAME_PREFIX, prefixLength) != 0)
+	{
+		return false;
+	}
+
+	const char *current = tableName + prefixLength;
+	char *end = NULL;
+	if (*current < '0' || *current > '9')
+	{
+		return false;
+	}
+
+	errno = 0;
+	*collectionId = strtou64(current, &end, 10);
+	*hasShardId = false;
+	if (errno == 0 && *end == '_' && end[1] >= '0' && end[1] <= '9')
+	{
+		*hasShardId = true;
+		*shardId = strtou64(end + 1, &end, 10);
+	}
+
+	if (errno != 0 || *end != '\0')
+	{
+		return false;
+	}
+
+	char formatted[NAMEDATALEN];
+	if (*hasShardId)
+	{
+		snprintf(formatted, NAMEDATALEN, DOCUMENT_DATA_TABLE_NAME_FORMAT "_"
+				 UINT64_FORMAT, *collectionId, *shardId);
+	}
+	else
+	{
+		snprintf(formatted, NAMEDATALEN, DOCUMENT_DATA_TABLE_NAME_FORMAT,
+				 *collectionId);
+	}
+
+	return strcmp(formatted, tableName) == 0;
+}
+
+
+/*
+ * Writes the continuation of each shard in the compact binary form (see
+ * COMPACT_CONTINUATION_FIELD) for the continuation returned to the client.
+ * On collections with many shards this is a fraction of the size of the
+ * document per shard. The continuation sent to the workers stays a
+ * document (see SerializeContinuationForWorker).
+ */
+void
+SerializeCompactContinuationsToWriter(pgbson_writer *writer, HTAB *cursorMap)
+{
+	StringInfoData buffer;
+	initStringInfo(&buffer);
+	appendStringInfoChar(&buffer, (char) COMPACT_CONTINUATION_VERSION);
+	AppendVarint(&buffer, hash_get_num_entries(cursorMap));
+
+	HASH_SEQ_STATUS hashStatus;
+	CursorContinuationEntry *entry;
+	hash_seq_init(&hashStatus, cursorMap);
+	while ((entry = (CursorContinuationEntry *) hash_seq_search(&hashStatus)) != NULL)
+	{
+		uint64 collectionId = 0, shardId = 0;
+		bool hasShardId = false;
+		bool hasTableId = TryParseDocumentsTableName(entry->tableName,
+													 entry->tableNameLength,
+													 &collectionId, &shardId,
+													 &hasShardId);
+		bool hasPrimaryKey = EnablePrimaryKeyCursorScan && entry->cursorEntry != NULL;
+
+		uint8_t flags = (hasTableId ? COMPACT_CONTINUATION_FLAG_TABLE_ID : 0) |
+						(hasShardId ? COMPACT_CONTINUATION_FLAG_SHARD_ID : 0) |
+						(hasPrimaryKey ? COMPACT_CONTINUATION_FLAG_PRIMARY_KEY : 0);
+		appendStringInfoChar(&buffer, (char) flags);
+
+		if (hasTableId)
+		{
+			AppendVarint(&buffer, collectionId);
+			if (hasShardId)
+			{
+				AppendVarint(&buffer, shardId);
+			}
+		}
+		else
+		{
+			AppendVarint(&buffer, entry->tableNameLength);
+			appendBinaryStringInfo(&buffer, entry->tableName, entry->tableNameLength);
+		}
+
+		AppendVarint(&buffer, ItemPointerGetBlockNumberNoCheck(&entry->continuation));
+		AppendVarint(&buffer, ItemPointerGetOffsetNumberNoCheck(&entry->continuation));
+
+		if (hasPrimaryKey)
+		{
+			AppendVarint(&buffer, VARSIZE(entry->cursorEntry));
+			appendBinaryStringInfo(&buffer, (char *) entry->cursorEntry,
+								   VARSIZE(entry->cursorEntry));
+		}
+	}
+
+	bson_value_t compactValue = { 0 };
+	compactValue.value_type = BSON_TYPE_BINARY;
+	compactValue.value.v_binary.subtype = BSON_SUBTYPE_BINARY;
+	compactValue.value.v_binary.data = (uint8_t *) buffer.data;
+	compactValue.value.v_binary.data_len = buffer.len;
+	PgbsonWriterAppendValue(writer, COMPACT_CONTINUATION_FIELD,
+							strlen(COMPACT_CONTINUATION_FIELD), &compactValue);
+	pfree(buffer.data);
+}
+
+
+/*
+ * Builds the cursor map from the compact binary continuation written by
+ * SerializeCompactContinuationsToWriter.
+ */
+static void
+BuildContinuationMapFromCompact(const bson_value_t *compactValue, HTAB *cursorMap)
+{
+	if (compactValue->value_type != BSON_TYPE_BINARY ||
+		compactValue->value.v_binary.data_len < 1 ||
+		compactValue->value.v_binary.data[0] != COMPACT_CONTINUATION_VERSION)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg("Invalid compact continuation: unsupported format")));
+	}
+
+	const uint8_t *current = compactValue->value.v_binary.data + 1;
+	const uint8_t *end = compactValue->value.v_binary.data +
+						 compactValue->value.v_binary.data_len;
+	uint64 entryCount = ReadVarint(&current, end);
+	for (uint64 i = 0; i < entryCount; i++)
+	{
+		if (current >= end)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+							errmsg("Invalid compact continuation: truncated entry")));
+		}
+
+		uint8_t flags = *current++;
+		CursorContinuationEntry searchEntry = { 0 };
+		if (flags & COMPACT_CONTINUATION_FLAG_TABLE_ID)
+		{
+			uint64 collectionId = ReadVarint(&current, end);
+			char *tableName = (flags & COMPACT_CONTINUATION_FLAG_SHARD_ID) ?
+							  psprintf(DOCUMENT_DATA_TABLE_NAME_FORMAT "_"
+									   UINT64_FORMAT, collectionId,
+									   ReadVarint(&current, end)) :
+							  psprintf(DOCUMENT_DATA_TABLE_NAME_FORMAT, collectionId);
+			searchEntry.tableName = tableName;
+			searchEntry.tableNameLength = strlen(tableName);
+		}
+		else
+		{
+			uint64 tableNameLength = ReadVarint(&current, end);
+			if (tableNameLength == 0 || tableNameLength >= NAMEDATALEN ||
+				tableNameLength > (uint64) (end - current))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg("Invalid compact continuation: bad table name")));
+			}
+
+			searchEntry.tableName = pnstrdup((const char *) current, tableNameLength);
+			searchEntry.tableNameLength = tableNameLength;
+			current += tableNameLength;
+		}
+
+		uint64 blockNumber = ReadVarint(&current, end);
+		uint64 offsetNumber = ReadVarint(&current, end);
+		if (blockNumber > MaxBlockNumber || offsetNumber > PG_UINT16_MAX)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+							errmsg("Invalid compact continuation: bad position")));
+		}
+
+		pgbson *primaryKey = NULL;
+		if (flags & COMPACT_CONTINUATION_FLAG_PRIMARY_KEY)
+		{
+			uint64 primaryKeyLength = ReadVarint(&current, end);
+			if (primaryKeyLength < VARHDRSZ ||
+				primaryKeyLength > (uint64) (end - current))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg("Invalid compact continuation: bad primary key")));
+			}
+
+			primaryKey = palloc(primaryKeyLength);
+			memcpy(primaryKey, current, primaryKeyLength);
+			SET_VARSIZE(primaryKey, primaryKeyLength);
+			current += primaryKeyLength;
+		}
+
+		bool found = false;
+		CursorContinuationEntry *hashEntry = hash_search(cursorMap, &searchEntry,
+														 HASH_ENTER, &found);
+		ItemPointerSet(&hashEntry->continuation, (BlockNumber) blockNumber,
+					   (OffsetNumber) offsetNumber);
+		if (!found)
+		{
+			hashEntry->cursorEntry = NULL;
+		}
+
+		if (EnablePrimaryKeyCursorScan && primaryKey != NULL)
+		{
+			hashEntry->cursorEntry = primaryKey;
+		}
+	}
+}
+
+
 void
 SerializeTailableContinuationsToWriter(pgbson_writer *writer, HTAB *cursorMap)
 {
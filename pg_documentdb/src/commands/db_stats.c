@@ -250,14 +250,23 @@ DbStatsCoordinator(Datum databaseName, int32 scale)
 					 (int) VARSIZE_ANY_EXHDR(databaseName),
 					 (char *) VARDATA_ANY(databaseName));
 
+	StringInfo cacheKey = makeStringInfo();
+	appendStringInfo(cacheKey, "dbStats.%d.%s", scale, namespaceString->data);
+	pgbson *response = GetCachedDiagnosticResponse(cacheKey->data);
+	if (response != NULL)
+	{
+		return response;
+	}
+
 	DbStatsResult result = { 0 };
 	result.db = namespaceString->data;
 	result.scaleFactor = scale;
 	result.ok = 1;
 
 	BuildResultData(databaseName, &result, scale);
-	pgbson *response = BuildResponseMessage(&result);
+	response = BuildResponseMessage(&result);
 
+	AddDiagnosticResponseToCache(cacheKey->data, response);
 	return response;
 }
 
@@ -13,8 +13,10 @@
 #include "miscadmin.h"
 
 #include "access/xact.h"
+#include "catalog/pg_type.h"
 #include "executor/spi.h"
 #include "lib/stringinfo.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 
 #include "io/bson_core.h"
@@ -28,6 +30,8 @@
 #include "metadata/metadata_cache.h"
 #include "query/query_operator.h"
 #include "infrastructure/documentdb_plan_cache.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/tailable_cursor_notifications.h"
 #include "sharding/sharding.h"
 #include "commands/retryable_writes.h"
 #include "io/pgbsonsequence.h"
@@ -37,6 +41,7 @@
 #include "utils/version_utils.h"
 #include "utils/query_utils.h"
 #include "api_hooks.h"
+#include "infrastructure/wait_events.h"
 
 
 /*
@@ -94,6 +99,8 @@ typedef struct
 
 extern bool UseLocalExecutionShardQueries;
 extern bool EnableVariablesSupportForWriteCommands;
+extern bool EnableBatchDeleteByObjectIds;
+extern bool EnableSortedWritePlanCache;
 
 PG_FUNCTION_INFO_V1(command_delete);
 PG_FUNCTION_INFO_V1(command_delete_one);
@@ -113,6 +120,11 @@ static void ProcessBatchDeletion(MongoCollection *collection,
 								 bool forceInline, text *transactionId,
 								 BatchDeletionResult *batchResult);
 
+static bool TryProcessBatchDeletionByObjectIds(MongoCollection *collection,
+											   List *deletions, text *transactionId,
+											   BatchDeletionResult *batchResult);
+static uint64 DeleteDocumentsByObjectIds(MongoCollection *collection,
+										 ArrayType *objectIdArray);
 static pgbson * ProcessBatchDeleteUnsharded(MongoCollection *collection,
 											BatchDeletionSpec *batchSpec,
 											text *transactionId);
@@ -185,6 +197,8 @@ command_delete(PG_FUNCTION_ARGS)
 	}
 
 	ReportFeatureUsage(FEATURE_COMMAND_DELETE);
+	ReportCommandActivity("delete", "remove", DatumGetTextPP(databaseNameDatum),
+						  deleteSpec);
 
 	/* fetch TupleDesc for return value, not interested in resultTypeId */
 	Oid *resultTypeId = NULL;
@@ -237,6 +251,9 @@ command_delete(PG_FUNCTION_ARGS)
 			batchResponse = ProcessBatchDeleteUnsharded(collection, batchSpec,
 														transactionId);
 		}
+
+		/* Wake up the tailable cursors awaiting data once the deletes commit */
+		NotifyCollectionWriteOnCommit(collection->collectionId);
 	}
 	else
 	{
@@ -271,6 +288,8 @@ command_delete(PG_FUNCTION_ARGS)
 	values[0] = PointerGetDatum(batchResponse);
 	values[1] = BoolGetDatum(!hasWriteErrors);
 	HeapTuple resultTuple = heap_form_tuple(resultTupDesc, values, isNulls);
+
+	ReportCommandLatency(CommandLatencyKind_Delete);
 	PG_RETURN_DATUM(HeapTupleGetDatum(resultTuple));
 }
 
@@ -329,6 +348,10 @@ BuildBatchDeletionSpec(bson_iter_t *deleteCommandIter, pgbsonsequence *deleteDoc
 			SetExplicitStatementTimeout(BsonValueAsInt32(bson_iter_value(
 															 deleteCommandIter)));
 		}
+		else if (strcmp(field, "writeConcern") == 0)
+		{
+			SetWriteConcernDurability(bson_iter_value(deleteCommandIter));
+		}
 		else if (strcmp(field, "let") == 0)
 		{
 			ReportFeatureUsage(FEATURE_LET_TOP_LEVEL);
@@ -352,11 +375,7 @@ BuildBatchDeletionSpec(bson_iter_t *deleteCommandIter, pgbsonsequence *deleteDoc
 		{
 			elog(DEBUG1, "Command field not recognized: delete.%s", field);
 
-			/*
-			 *  Silently ignore now, so that clients don't break
-			 *  TODO: implement me
-			 *      writeConcern
-			 */
+			/* Silently ignore now, so that clients don't break */
 		}
 		else
 		{
@@ -628,6 +647,12 @@ ProcessBatchDeletion(MongoCollection *collection, BatchDeletionSpec *batchSpec,
 	batchResult->rowsDeleted = 0;
 	batchResult->writeErrors = NIL;
 
+	if (TryProcessBatchDeletionByObjectIds(collection, deletions, transactionId,
+										   batchResult))
+	{
+		return;
+	}
+
 	/* declared volatile because of the longjmp in PG_CATCH */
 	volatile int deleteIndex = 0;
 
@@ -692,6 +717,179 @@ ProcessBatchDeletion(MongoCollection *collection, BatchDeletionSpec *batchSpec,
 }
 
 
+/*
+ * TryProcessBatchDeletionByObjectIds deletes a batch made up only of plain
+ * {_id: value} deletes on an unsharded collection with a single
+ * DELETE .. WHERE object_id = ANY(..) instead of a subtransaction and a
+ * delete per entry. Cleanup jobs tend to send exactly such batches.
+ *
+ * _id is unique within the collection, so the combined delete removes the
+ * same documents and counts the same rows as deleting them one at a time,
+ * and these deletes cannot fail on their own. If the combined delete fails
+ * anyway, it is rolled back and the caller processes the batch one delete at
+ * a time to report the errors per entry.
+ *
+ * Returns true if the batch was deleted.
+ */
+static bool
+TryProcessBatchDeletionByObjectIds(MongoCollection *collection, List *deletions,
+								   text *transactionId,
+								   BatchDeletionResult *batchResult)
+{
+	if (!EnableBatchDeleteByObjectIds || transactionId != NULL ||
+		collection->shardKey != NULL || list_length(deletions) < 2)
+	{
+		return false;
+	}
+
+	Datum *objectIdDatums = palloc(sizeof(Datum) * list_length(deletions));
+	int objectIdCount = 0;
+
+	ListCell *deletionCell = NULL;
+	foreach(deletionCell, deletions)
+	{
+		DeletionSpec *deletionSpec = lfirst(deletionCell);
+		const bson_value_t *query = deletionSpec->deleteOneParams.query;
+		if (deletionSpec->deleteOneParams.returnDeletedDocument ||
+			IsCollationApplicable(deletionSpec->deleteOneParams.collationString) ||
+			query->value_type != BSON_TYPE_DOCUMENT)
+		{
+			return false;
+		}
+
+		bson_iter_t queryIter;
+		BsonValueInitIterator(query, &queryIter);
+		if (!bson_iter_next(&queryIter) || strcmp(bson_iter_key(&queryIter), "_id") != 0)
+		{
+			return false;
+		}
+
+		/* Only plain equality: skip operators, regexes and values that match missing fields */
+		pgbsonelement objectIdElement = { 0 };
+		objectIdElement.path = "";
+		objectIdElement.pathLength = 0;
+		objectIdElement.bsonValue = *bson_iter_value(&queryIter);
+		bson_type_t idType = objectIdElement.bsonValue.value_type;
+		if (idType == BSON_TYPE_DOCUMENT || idType == BSON_TYPE_ARRAY ||
+			idType == BSON_TYPE_REGEX || idType == BSON_TYPE_NULL ||
+			idType == BSON_TYPE_UNDEFINED || bson_iter_next(&queryIter))
+		{
+			return false;
+		}
+
+		objectIdDatums[objectIdCount++] =
+			PointerGetDatum(PgbsonElementToPgbson(&objectIdElement));
+	}
+
+	ArrayType *objectIdArray = construct_array(objectIdDatums, objectIdCount,
+											   BsonTypeId(), -1, false, TYPALIGN_INT);
+
+	MemoryContext oldContext = CurrentMemoryContext;
+	ResourceOwner oldOwner = CurrentResourceOwner;
+
+	/* declared volatile because of the longjmp in PG_CATCH */
+	volatile uint64 rowsDeleted = 0;
+	volatile bool isSuccess = false;
+
+	BeginInternalSubTransaction(NULL);
+
+	PG_TRY();
+	{
+		rowsDeleted = DeleteDocumentsByObjectIds(collection, objectIdArray);
+
+		/* Commit the inner transaction, return to outer xact context */
+		ReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldContext);
+		CurrentResourceOwner = oldOwner;
+
+		isSuccess = true;
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(oldContext);
+		ErrorData *errorData = CopyErrorDataAndFlush();
+
+		/* Abort inner transaction */
+		RollbackAndReleaseCurrentSubTransaction();
+		MemoryContextSwitchTo(oldContext);
+		CurrentResourceOwner = oldOwner;
+
+		if (IsOperatorInterventionError(errorData))
+		{
+			ReThrowError(errorData);
+		}
+
+		FreeErrorData(errorData);
+		isSuccess = false;
+	}
+	PG_END_TRY();
+
+	if (isSuccess)
+	{
+		batchResult->rowsDeleted = rowsDeleted;
+	}
+
+	return isSuccess;
+}
+
+
+/*
+ * DeleteDocumentsByObjectIds deletes the documents of an unsharded collection
+ * whose object_id is in the given bson array. Returns the number of deleted rows.
+ */
+static uint64
+DeleteDocumentsByObjectIds(MongoCollection *collection, ArrayType *objectIdArray)
+{
+	uint64 collectionId = collection->collectionId;
+
+	SPI_connect();
+
+	StringInfoData deleteQuery;
+	initStringInfo(&deleteQuery);
+	appendStringInfo(&deleteQuery, "DELETE FROM ");
+
+	if (collection->shardTableName[0] != '\0')
+	{
+		appendStringInfo(&deleteQuery, " %s.%s", ApiDataSchemaName,
+						 collection->shardTableName);
+	}
+	else
+	{
+		appendStringInfo(&deleteQuery, " %s.documents_" UINT64_FORMAT, ApiDataSchemaName,
+						 collectionId);
+	}
+
+	appendStringInfo(&deleteQuery,
+					 " WHERE shard_key_value = $1 AND object_id OPERATOR(%s.=) ANY($2)",
+					 CoreSchemaName);
+
+	int argCount = 2;
+	Oid argTypes[2] = { INT8OID, GetBsonArrayTypeOid() };
+	char argNulls[2] = { ' ', ' ' };
+	Datum argValues[2];
+
+	/* since this is unsharded, the shard key value is just the collection id. */
+	argValues[0] = Int64GetDatum(collectionId);
+	argValues[1] = PointerGetDatum(objectIdArray);
+
+	bool readOnly = false;
+	long maxTupleCount = 0;
+	SPIPlanPtr plan = GetSPIQueryPlanWithLocalShard(collectionId,
+													collection->shardTableName,
+													QUERY_DELETE_WITH_SHARDKEY_ID_ARRAY,
+													deleteQuery.data, argTypes, argCount);
+
+	SPI_execute_plan(plan, argValues, argNulls, readOnly, maxTupleCount);
+	uint64 rowsDeleted = SPI_processed;
+
+	pfree(deleteQuery.data);
+
+	SPI_finish();
+
+	return rowsDeleted;
+}
+
+
 static pgbson *
 ProcessBatchDeleteUnsharded(MongoCollection *collection, BatchDeletionSpec *batchSpec,
 							text *transactionId)
@@ -1075,10 +1273,13 @@ CallDeleteWorker(MongoCollection *collection,
 	int numResults = 1;
 
 	/* forceDelegation assumes nested distribution */
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_WorkerCall);
 	RunMultiValueQueryWithNestedDistribution(updateQuery, argCount, argTypes, argValues,
 											 argNulls,
 											 readOnly, SPI_OK_SELECT, resultDatum,
 											 isNulls, numResults);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
 
 	if (isNulls[0])
 	{
@@ -1386,8 +1587,10 @@ DeleteOneInternal(MongoCollection *collection, DeleteOneParams *deleteOneParams,
 	}
 
 	/* assign sorting values */
+	uint64 sortedPlanId = 0;
 	if (sortFieldDocumentsLength > 0)
 	{
+		uint32 ascendingMask = 0;
 		appendStringInfoString(&selectQuery, " ORDER BY");
 
 		int sortItemSqlArgBaseIndex = nextSqlArgIndex;
@@ -1395,6 +1598,10 @@ DeleteOneInternal(MongoCollection *collection, DeleteOneParams *deleteOneParams,
 		{
 			pgbson *sortDoc = list_nth(sortFieldDocuments, i);
 			bool isAscending = ValidateOrderbyExpressionAndGetIsAscending(sortDoc);
+			if (isAscending && i < QUERY_SORT_VARIANT_MAX_FIELDS)
+			{
+				ascendingMask |= (1 << i);
+			}
 
 			int sqlArgPosition = i + sortItemSqlArgBaseIndex;
 
@@ -1418,6 +1625,21 @@ DeleteOneInternal(MongoCollection *collection, DeleteOneParams *deleteOneParams,
 			argValues[sqlArgPosition - 1] = PointerGetDatum(sortDoc);
 			argNulls[sqlArgPosition - 1] = ' ';
 		}
+
+		/*
+		 * The sort only changes the query text by the number and directions of
+		 * the sort fields and whether it uses the collation. Whether the
+		 * document is returned is part of the shape too, since it is not part
+		 * of planId yet.
+		 */
+		if (EnableSortedWritePlanCache &&
+			sortFieldDocumentsLength <= QUERY_SORT_VARIANT_MAX_FIELDS)
+		{
+			uint32 sortShape = (applyCollation ? 1 : 0) |
+							   (deleteOneParams->returnDeletedDocument ? 2 : 0);
+			sortedPlanId = GetSortedQueryVariantId(planId, sortFieldDocumentsLength,
+												   ascendingMask, sortShape);
+		}
 	}
 
 	appendStringInfo(&selectQuery,
@@ -1451,7 +1673,7 @@ DeleteOneInternal(MongoCollection *collection, DeleteOneParams *deleteOneParams,
 	bool readOnly = false;
 	long maxTupleCount = 0;
 
-	if (list_length(sortFieldDocuments) > 0)
+	if (list_length(sortFieldDocuments) > 0 && sortedPlanId == 0)
 	{
 		/* we can't cache sort query */
 		SPI_execute_with_args(deleteQuery.data, argCount, argTypes, argValues, argNulls,
@@ -1461,6 +1683,7 @@ DeleteOneInternal(MongoCollection *collection, DeleteOneParams *deleteOneParams,
 	{
 		SPIPlanPtr plan = GetSPIQueryPlanWithLocalShard(collection->collectionId,
 														collection->shardTableName,
+														sortedPlanId != 0 ? sortedPlanId :
 														planId, deleteQuery.data,
 														argTypes,
 														argCount);
@@ -14,6 +14,10 @@
 #include <nodes/makefuncs.h>
 #include <catalog/namespace.h>
 #include <access/xact.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
+#include <utils/timestamp.h>
+#include <utils/timeout.h>
 
 #include "metadata/collection.h"
 #include "metadata/index.h"
@@ -28,6 +32,39 @@
 #include "utils/error_utils.h"
 #include "utils/documentdb_errors.h"
 
+/* The longest key (command, scale and namespace) of the stats response cache */
+#define DIAGNOSTIC_STATS_CACHE_KEY_LENGTH 512
+
+/* The cache is reset once it holds this many responses */
+#define MAX_DIAGNOSTIC_STATS_CACHE_ENTRIES 256
+
+/* The number of worker results fetched from the fan-out query at a time */
+#define DIAGNOSTIC_WORKER_FETCH_BATCH_SIZE 16
+
+/*
+ * An entry in the session cache of dbStats and collStats responses.
+ */
+typedef struct DiagnosticStatsCacheEntry
+{
+	char cacheKey[DIAGNOSTIC_STATS_CACHE_KEY_LENGTH];
+
+	/* When the response was computed */
+	TimestampTz cachedTime;
+
+	/* The response, allocated in DiagnosticStatsCacheContext */
+	pgbson *response;
+} DiagnosticStatsCacheEntry;
+
+extern int DiagnosticStatsCacheSeconds;
+extern int DiagnosticWorkerTimeoutMs;
+
+static HTAB *DiagnosticStatsCacheHash = NULL;
+static MemoryContext DiagnosticStatsCacheContext = NULL;
+
+static void InitializeDiagnosticStatsCache(void);
+static void CollectWorkerResult(pgbson *workerResult, void *state);
+static void ThrowWorkerError(const char *commandName, const char *workerError);
+
 
 /*
  * Issues a run_command_on_all_nodes to get the currentOp
@@ -41,6 +78,28 @@ List *
 RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 						 int numValues, PGFunction directFunc,
 						 const char *nameSpaceName, const char *functionName)
+{
+	List *workerBsons = NIL;
+	RunQueryOnAllServerNodesStreaming(commandName, values, types, numValues,
+									  directFunc, nameSpaceName, functionName,
+									  CollectWorkerResult, &workerBsons);
+	return workerBsons;
+}
+
+
+/*
+ * Like RunQueryOnAllServerNodes but hands each worker result to the callback
+ * as soon as it is fetched, so that the caller merges it into its response and
+ * frees it instead of holding the results of every node of the cluster until
+ * the last one arrived. The workers are queried in parallel, and the query is
+ * canceled after documentdb.diagnosticWorkerTimeoutMs when no other statement
+ * timeout applies.
+ */
+void
+RunQueryOnAllServerNodesStreaming(const char *commandName, Datum *values, Oid *types,
+								  int numValues, PGFunction directFunc,
+								  const char *nameSpaceName, const char *functionName,
+								  WorkerResultCallback callback, void *callbackState)
 {
 	if (DefaultInlineWriteOperations)
 	{
@@ -55,10 +114,10 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 		}
 
 		result = (*directFunc)(fcinfo);
-
-		List *resultList = list_make1(DatumGetPgBson(result));
 		pfree(fcinfo);
-		return resultList;
+
+		callback(DatumGetPgBson(result), callbackState);
+		return;
 	}
 
 	StringInfo cmdStr = makeStringInfo();
@@ -82,9 +141,21 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 		appendStringInfo(cmdStr, ",$%d", (i + 1));
 	}
 
-	appendStringInfo(cmdStr, "))");
+	/* Dispatch to all the nodes at once rather than one node after the other */
+	appendStringInfo(cmdStr, "), parallel => true)");
+
+	/*
+	 * Bound the wait on a slow or unreachable node unless the command already
+	 * runs under a statement timeout (e.g. from its maxTimeMS).
+	 */
+	bool armedWorkerTimeout = false;
+	if (DiagnosticWorkerTimeoutMs > 0 && !get_timeout_active(STATEMENT_TIMEOUT))
+	{
+		enable_timeout_after(STATEMENT_TIMEOUT, DiagnosticWorkerTimeoutMs);
+		armedWorkerTimeout = true;
+	}
+
 	bool readOnly = true;
-	List *workerBsons = NIL;
 	MemoryContext priorMemoryContext = CurrentMemoryContext;
 	SPI_connect();
 
@@ -96,7 +167,7 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 
 	while (hasData)
 	{
-		SPI_cursor_fetch(workerQueryPortal, true, INT_MAX);
+		SPI_cursor_fetch(workerQueryPortal, true, DIAGNOSTIC_WORKER_FETCH_BATCH_SIZE);
 
 		hasData = SPI_processed >= 1;
 		if (!hasData)
@@ -120,12 +191,12 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 
 				bool isSuccess = DatumGetBool(resultDatum);
 
+				AttrNumber resultAttribute = 2;
+				resultDatum = SPI_getbinval(SPI_tuptable->vals[tupleNumber],
+											SPI_tuptable->tupdesc, resultAttribute,
+											&isNull);
 				if (isSuccess)
 				{
-					AttrNumber resultAttribute = 2;
-					resultDatum = SPI_getbinval(SPI_tuptable->vals[tupleNumber],
-												SPI_tuptable->tupdesc, resultAttribute,
-												&isNull);
 					if (isNull)
 					{
 						ereport(ERROR, (errmsg(
@@ -148,15 +219,12 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 						bson = PgbsonInitFromJson(resultString);
 					}
 
-					workerBsons = lappend(workerBsons, bson);
+					callback(bson, callbackState);
 					MemoryContextSwitchTo(spiContext);
+					pfree(resultString);
 				}
 				else
 				{
-					AttrNumber resultAttribute = 2;
-					resultDatum = SPI_getbinval(SPI_tuptable->vals[tupleNumber],
-												SPI_tuptable->tupdesc, resultAttribute,
-												&isNull);
 					if (isNull)
 					{
 						elog(WARNING,
@@ -166,71 +234,11 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 					}
 
 					text *resultText = DatumGetTextP(resultDatum);
-					const char *workerError = text_to_cstring(resultText);
-
-					StringView errorView = CreateStringViewFromString(workerError);
-					StringView connectivityView = CreateStringViewFromString(
-						"Unable to establish connection with");
-					StringView recoveryErrorView = CreateStringViewFromString(
-						"terminating connection due to conflict with recovery");
-					StringView recoveryCancelErrorView = CreateStringViewFromString(
-						"canceling statement due to conflict with recovery");
-					StringView outOfMemoryView = CreateStringViewFromString(
-						"out of memory");
-					StringView errorStartView = CreateStringViewFromString(
-						"ERROR: ");
-
-					if (StringViewStartsWithStringView(&errorView, &errorStartView))
-					{
-						errorView = StringViewSubstring(&errorView,
-														errorStartView.length);
-					}
-
-					if (StringViewStartsWithStringView(&errorView, &connectivityView))
-					{
-						ereport(ERROR, (errcode(ERRCODE_CONNECTION_FAILURE),
-										errmsg(
-											"%s on worker failed with connectivity errors",
-											commandName),
-										errdetail_log(
-											"%s on worker failed with an unexpected error: %s",
-											commandName, workerError)));
-					}
-					else if (StringViewStartsWithStringView(&errorView,
-															&recoveryErrorView) ||
-							 StringViewStartsWithStringView(&errorView,
-															&recoveryCancelErrorView))
-					{
-						ereport(ERROR, (errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
-										errmsg(
-											"Worker %s operation failed due to recovery-related errors",
-											commandName),
-										errdetail_log(
-											"Worker %s operation failed due to recovery-related errors: %s",
-											commandName, workerError)));
-					}
-					else if (StringViewStartsWithStringView(&errorView, &outOfMemoryView))
-					{
-						ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT),
-										errmsg(
-											"%s on worker failed with out of memory errors",
-											commandName),
-										errdetail_log(
-											"%s on worker failed with an out of memory error: %s",
-											commandName, workerError)));
-					}
-					else
-					{
-						ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
-										errmsg(
-											"%s on worker failed with an unexpected error",
-											commandName),
-										errdetail_log(
-											"%s on worker failed with an unexpected error: %s",
-											commandName, workerError)));
-					}
+					ThrowWorkerError(commandName, text_to_cstring(resultText));
 				}
 			}
+
+			SPI_freetuptable(SPI_tuptable);
 		}
 		else
 		{
@@ -241,7 +249,92 @@ RunQueryOnAllServerNodes(const char *commandName, Datum *values, Oid *types,
 	SPI_cursor_close(workerQueryPortal);
 	SPI_finish();
 
-	return workerBsons;
+	if (armedWorkerTimeout)
+	{
+		disable_timeout(STATEMENT_TIMEOUT, false);
+	}
+}
+
+
+/*
+ * Collects the worker results for RunQueryOnAllServerNodes.
+ */
+static void
+CollectWorkerResult(pgbson *workerResult, void *state)
+{
+	List **workerBsons = (List **) state;
+	*workerBsons = lappend(*workerBsons, workerResult);
+}
+
+
+/*
+ * Rethrows the error a worker of a diagnostic query failed with, classifying
+ * the transient failures so that clients can retry them.
+ */
+static void
+ThrowWorkerError(const char *commandName, const char *workerError)
+{
+	StringView errorView = CreateStringViewFromString(workerError);
+	StringView connectivityView = CreateStringViewFromString(
+		"Unable to establish connection with");
+	StringView recoveryErrorView = CreateStringViewFromString(
+		"terminating connection due to conflict with recovery");
+	StringView recoveryCancelErrorView = CreateStringViewFromString(
+		"canceling statement due to conflict with recovery");
+	StringView outOfMemoryView = CreateStringViewFromString(
+		"out of memory");
+	StringView errorStartView = CreateStringViewFromString(
+		"ERROR: ");
+
+	if (StringViewStartsWithStringView(&errorView, &errorStartView))
+	{
+		errorView = StringViewSubstring(&errorView,
+										errorStartView.length);
+	}
+
+	if (StringViewStartsWithStringView(&errorView, &connectivityView))
+	{
+		ereport(ERROR, (errcode(ERRCODE_CONNECTION_FAILURE),
+						errmsg(
+							"%s on worker failed with connectivity errors",
+							commandName),
+						errdetail_log(
+							"%s on worker failed with an unexpected error: %s",
+							commandName, workerError)));
+	}
+	else if (StringViewStartsWithStringView(&errorView,
+											&recoveryErrorView) ||
+			 StringViewStartsWithStringView(&errorView,
+											&recoveryCancelErrorView))
+	{
+		ereport(ERROR, (errcode(ERRCODE_T_R_SERIALIZATION_FAILURE),
+						errmsg(
+							"Worker %s operation failed due to recovery-related errors",
+							commandName),
+						errdetail_log(
+							"Worker %s operation failed due to recovery-related errors: %s",
+							commandName, workerError)));
+	}
+	else if (StringViewStartsWithStringView(&errorView, &outOfMemoryView))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT),
+						errmsg(
+							"%s on worker failed with out of memory errors",
+							commandName),
+						errdetail_log(
+							"%s on worker failed with an out of memory error: %s",
+							commandName, workerError)));
+	}
+	else
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+						errmsg(
+							"%s on worker failed with an unexpected error",
+							commandName),
+						errdetail_log(
+							"%s on worker failed with an unexpected error: %s",
+							commandName, workerError)));
+	}
 }
 
 
@@ -290,3 +383,104 @@ RunWorkerDiagnosticLogic(pgbson *(*workerFunc)(void *state), void *state)
 
 	return response;
 }
+
+
+/*
+ * Returns a copy of the response cached for the key if it was computed less than
+ * documentdb.diagnosticStatsCacheSeconds ago, NULL otherwise. Monitoring agents
+ * poll dbStats and collStats every few seconds, and each call sums the relation
+ * sizes of every shard and index of the database on all nodes.
+ */
+pgbson *
+GetCachedDiagnosticResponse(const char *cacheKey)
+{
+	if (DiagnosticStatsCacheSeconds <= 0 || DiagnosticStatsCacheHash == NULL ||
+		strlen(cacheKey) >= DIAGNOSTIC_STATS_CACHE_KEY_LENGTH)
+	{
+		return NULL;
+	}
+
+	bool found = false;
+	DiagnosticStatsCacheEntry *entry = hash_search(DiagnosticStatsCacheHash, cacheKey,
+												   HASH_FIND, &found);
+	if (!found)
+	{
+		return NULL;
+	}
+
+	if (TimestampDifferenceExceeds(entry->cachedTime, GetCurrentTimestamp(),
+								   DiagnosticStatsCacheSeconds * 1000))
+	{
+		pfree(entry->response);
+		hash_search(DiagnosticStatsCacheHash, cacheKey, HASH_REMOVE, NULL);
+		return NULL;
+	}
+
+	return CopyPgbsonIntoMemoryContext(entry->response, CurrentMemoryContext);
+}
+
+
+/*
+ * Keeps the response computed for the key for the next
+ * documentdb.diagnosticStatsCacheSeconds.
+ */
+void
+AddDiagnosticResponseToCache(const char *cacheKey, const pgbson *response)
+{
+	if (DiagnosticStatsCacheSeconds <= 0 ||
+		strlen(cacheKey) >= DIAGNOSTIC_STATS_CACHE_KEY_LENGTH)
+	{
+		return;
+	}
+
+	InitializeDiagnosticStatsCache();
+
+	if (hash_get_num_entries(DiagnosticStatsCacheHash) >=
+		MAX_DIAGNOSTIC_STATS_CACHE_ENTRIES)
+	{
+		/* Expired entries are only removed when looked up: start over */
+		hash_destroy(DiagnosticStatsCacheHash);
+		DiagnosticStatsCacheHash = NULL;
+		MemoryContextReset(DiagnosticStatsCacheContext);
+		InitializeDiagnosticStatsCache();
+	}
+
+	bool found = false;
+	DiagnosticStatsCacheEntry *entry = hash_search(DiagnosticStatsCacheHash, cacheKey,
+												   HASH_ENTER, &found);
+	if (found)
+	{
+		pfree(entry->response);
+	}
+
+	entry->cachedTime = GetCurrentTimestamp();
+	entry->response = CopyPgbsonIntoMemoryContext(response,
+												  DiagnosticStatsCacheContext);
+}
+
+
+static void
+InitializeDiagnosticStatsCache(void)
+{
+	if (DiagnosticStatsCacheHash != NULL)
+	{
+		return;
+	}
+
+	if (DiagnosticStatsCacheContext == NULL)
+	{
+		DiagnosticStatsCacheContext = AllocSetContextCreate(CacheMemoryContext,
+															"DocumentDB diagnostic stats cache context",
+															ALLOCSET_SMALL_SIZES);
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = DIAGNOSTIC_STATS_CACHE_KEY_LENGTH;
+	info.entrysize = sizeof(DiagnosticStatsCacheEntry);
+	info.hcxt = DiagnosticStatsCacheContext;
+	int hashFlags = HASH_ELEM | HASH_STRINGS | HASH_CONTEXT;
+
+	DiagnosticStatsCacheHash = hash_create("DocumentDB diagnostic stats cache hash", 32,
+										   &info, hashFlags);
+}
@@ -11,6 +11,7 @@
 #include "fmgr.h"
 #include "miscadmin.h"
 #include "utils/builtins.h"
+#include "utils/lsyscache.h"
 #include "utils/resowner.h"
 #include "utils/uuid.h"
 #include "lib/stringinfo.h"
@@ -18,6 +19,9 @@
 #include "utils/syscache.h"
 #include "nodes/makefuncs.h"
 #include "catalog/namespace.h"
+#include "catalog/pg_type.h"
+#include "utils/array.h"
+#include "utils/snapmgr.h"
 
 #include "utils/documentdb_errors.h"
 #include "metadata/collection.h"
@@ -31,11 +35,23 @@
 
 #include "api_hooks.h"
 
+extern int DeferredDropMaxRelationsPerRun;
+
+/* Dropping a relation that is in use fails the run and is retried by the next one */
+#define DEFERRED_DROP_LOCK_TIMEOUT_MS 1000
+
+/* The pause between the drops of a run, to spread the file removals over time */
+#define DEFERRED_DROP_PAUSE_MS 100
+
+/* The batch size used to drop the leftovers of deferred drops once they are turned off */
+#define DEFERRED_DROP_LEFTOVER_BATCH_SIZE 100
+
 static char * ConstructDropCommandCstr(char *databaseName, char *collectionName,
 									   pgbson *writeConcern, char *uuid, bool
 									   trackChanges);
 
 PG_FUNCTION_INFO_V1(command_drop_collection);
+PG_FUNCTION_INFO_V1(drop_deferred_relations_background);
 
 /*
  * command_drop_collection implements the logic
@@ -133,28 +149,50 @@ command_drop_collection(PG_FUNCTION_ARGS)
 		}
 	}
 
-	StringInfo deleteCommand = makeStringInfo();
-	bool readOnly;
 	bool isNull;
 
-	appendStringInfo(deleteCommand,
-					 "DROP TABLE IF EXISTS %s.documents_"
-					 INT64_FORMAT,
-					 ApiDataSchemaName,
-					 collection->collectionId);
-	readOnly = false;
-	isNull = false;
+	/*
+	 * With deferred drops, the collection is only removed from the metadata
+	 * below: its tables no longer have a collection and are dropped by
+	 * drop_deferred_relations_background, so that the drop neither waits for
+	 * nor blocks the queries on them, nor removes their files inline.
+	 */
+	if (DeferredDropMaxRelationsPerRun <= 0)
+	{
+		bool readOnly = false;
+		StringInfo deleteCommand = makeStringInfo();
+		appendStringInfo(deleteCommand,
+						 "DROP TABLE IF EXISTS %s.documents_"
+						 INT64_FORMAT,
+						 ApiDataSchemaName,
+						 collection->collectionId);
+		isNull = false;
 
-	ExtensionExecuteQueryViaSPI(deleteCommand->data, readOnly, SPI_OK_UTILITY, &isNull);
+		ExtensionExecuteQueryViaSPI(deleteCommand->data, readOnly, SPI_OK_UTILITY,
+									&isNull);
 
-	resetStringInfo(deleteCommand);
-	appendStringInfo(deleteCommand,
-					 "DROP TABLE IF EXISTS %s.retry_" INT64_FORMAT,
-					 ApiDataSchemaName, collection->collectionId);
-	readOnly = false;
-	isNull = false;
+		resetStringInfo(deleteCommand);
+		appendStringInfo(deleteCommand,
+						 "DROP TABLE IF EXISTS %s.retry_" INT64_FORMAT,
+						 ApiDataSchemaName, collection->collectionId);
+		readOnly = false;
+		isNull = false;
+
+		ExtensionExecuteQueryViaSPI(deleteCommand->data, readOnly, SPI_OK_UTILITY,
+									&isNull);
 
-	ExtensionExecuteQueryViaSPI(deleteCommand->data, readOnly, SPI_OK_UTILITY, &isNull);
+		/* The columnar projection store, if collMod added one */
+		char *columnsTableName = psprintf("columns_" INT64_FORMAT,
+										  collection->collectionId);
+		if (OidIsValid(get_relname_relid(columnsTableName, ApiDataNamespaceOid())))
+		{
+			resetStringInfo(deleteCommand);
+			appendStringInfo(deleteCommand, "DROP TABLE %s.%s", ApiDataSchemaName,
+							 columnsTableName);
+			ExtensionExecuteQueryViaSPI(deleteCommand->data, readOnly, SPI_OK_UTILITY,
+										&isNull);
+		}
+	}
 
 	StringInfo deleteFromCollectionsCommand = makeStringInfo();
 	appendStringInfo(deleteFromCollectionsCommand,
@@ -194,6 +232,110 @@ command_drop_collection(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * drop_deferred_relations_background drops up to a batch of the relations
+ * left behind by deferred drops (default DeferredDropMaxRelationsPerRun, or
+ * DEFERRED_DROP_LEFTOVER_BATCH_SIZE when drops are no longer deferred):
+ * the tables whose collection and the indexes whose index record no longer
+ * exist (the indexes of such tables are dropped with them). Such a relation
+ * is only visible here once the drop that removed its metadata committed,
+ * and its id is never reused. Each drop is committed on its own, with a
+ * short lock timeout and a pause after it, so that the
+ * exclusive locks are short-lived and the file removals are spread over
+ * time. This is called periodically by the background worker framework.
+ */
+Datum
+drop_deferred_relations_background(PG_FUNCTION_ARGS)
+{
+	int32 batchSize = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
+	if (batchSize <= 0)
+	{
+		batchSize = DeferredDropMaxRelationsPerRun;
+	}
+
+	if (batchSize <= 0)
+	{
+		/* Drops are no longer deferred, but those deferred before still need to run */
+		batchSize = DEFERRED_DROP_LEFTOVER_BATCH_SIZE;
+	}
+
+	/*
+	 * The tables are dropped first, and their indexes with them: Only the
+	 * indexes of the tables of existing collections are dropped on their own.
+	 */
+	const char *deferredRelationsQuery =
+		FormatSqlQuery(
+			"SELECT pg_catalog.array_agg(d.cmd) FROM (SELECT pg_catalog.format("
+			"'DROP %%s IF EXISTS %%I.%%I', CASE c.relkind WHEN 'i' THEN 'INDEX' ELSE 'TABLE' END,"
+			" n.nspname, c.relname) AS cmd FROM pg_catalog.pg_class c"
+			" JOIN pg_catalog.pg_namespace n ON n.oid = c.relnamespace"
+			" WHERE c.relnamespace = %u AND ("
+			"(c.relkind = 'r' AND c.relname ~ '^(documents|retry|columns)_[0-9]+$'"
+			" AND NOT EXISTS (SELECT 1 FROM %s.collections cl"
+			" WHERE cl.collection_id = pg_catalog.substring(c.relname, '[0-9]+$')::bigint))"
+			" OR (c.relkind = 'i' AND c.relname ~ '^" DOCUMENT_DATA_TABLE_INDEX_NAME_FORMAT_PREFIX
+			"[0-9]+$'"
+			" AND NOT EXISTS (SELECT 1 FROM %s.collection_indexes ci"
+			" WHERE ci.index_id = pg_catalog.substring(c.relname, '[0-9]+$')::int)"
+			" AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_constraint con"
+			" WHERE con.conindid = c.oid)"
+			" AND EXISTS (SELECT 1 FROM pg_catalog.pg_index i"
+			" JOIN pg_catalog.pg_class t ON t.oid = i.indrelid"
+			" JOIN %s.collections cl"
+			" ON cl.collection_id = pg_catalog.substring(t.relname, '[0-9]+$')::bigint"
+			" WHERE i.indexrelid = c.oid)))"
+			" ORDER BY c.relkind DESC, c.oid LIMIT %d) d",
+			ApiDataNamespaceOid(), ApiCatalogSchemaName, ApiCatalogSchemaName,
+			ApiCatalogSchemaName, batchSize);
+
+	bool readOnly = true;
+	bool isNull = false;
+	Datum dropCommandsDatum = ExtensionExecuteQueryViaSPI(deferredRelationsQuery,
+														  readOnly, SPI_OK_SELECT,
+														  &isNull);
+	if (isNull)
+	{
+		PG_RETURN_VOID();
+	}
+
+	Datum *dropCommands = NULL;
+	int dropCommandCount = 0;
+	deconstruct_array(DatumGetArrayTypeP(dropCommandsDatum), TEXTOID, -1, false,
+					  TYPALIGN_INT, &dropCommands, NULL, &dropCommandCount);
+
+	/* save the memory context before committing the transactions */
+	MemoryContext procMemContext = CurrentMemoryContext;
+
+	for (int i = 0; i < dropCommandCount; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		const char *dropCommand = TextDatumGetCString(dropCommands[i]);
+		elog(LOG, "Dropping relation of a deferred drop: %s", dropCommand);
+
+		readOnly = false;
+		int statementTimeout = 0;
+		ExtensionExecuteCappedStatementWithArgsViaSPI(dropCommand, 0, NULL, NULL, NULL,
+													  readOnly, SPI_OK_UTILITY,
+													  statementTimeout,
+													  DEFERRED_DROP_LOCK_TIMEOUT_MS);
+
+		/* The lock is released and the files are removed on commit */
+		PopAllActiveSnapshots();
+		CommitTransactionCommand();
+		StartTransactionCommand();
+		MemoryContextSwitchTo(procMemContext);
+
+		if (i < dropCommandCount - 1)
+		{
+			pg_usleep(DEFERRED_DROP_PAUSE_MS * 1000L);
+		}
+	}
+
+	PG_RETURN_VOID();
+}
+
+
 /*
  * Reconstructs the drop command from the parameter values
  */
@@ -100,6 +100,10 @@ static void HandleDropIndexConcurrently(uint64 collectionId, int indexId, bool u
 										bool missingOk, DropIndexesResult *result,
 										MemoryContext oldMemContext);
 static void CancelIndexBuildRequest(int indexId);
+static void DropIndexAndDeleteIndexRecord(uint64 collectionId, int indexId, bool unique,
+										  bool missingOk);
+
+extern int DeferredDropMaxRelationsPerRun;
 
 /*
  * command_drop_indexes is the implementation of the internal logic for
@@ -192,14 +196,12 @@ ProcessDropIndexesRequest(char *dbName, DropIndexesArg dropIndexesArg, bool
 			}
 
 			bool missingOk = true;
-			bool concurrently = false;
 			if (!dropIndexConcurrently)
 			{
-				DropPostgresIndex(collectionId, indexDetails->indexId,
-								  indexDetails->indexSpec.indexUnique ==
-								  BoolIndexOption_True,
-								  concurrently, missingOk);
-				DeleteCollectionIndexRecord(collectionId, indexDetails->indexId);
+				DropIndexAndDeleteIndexRecord(collectionId, indexDetails->indexId,
+											  indexDetails->indexSpec.indexUnique ==
+											  BoolIndexOption_True,
+											  missingOk);
 			}
 			else
 			{
@@ -341,11 +343,10 @@ ProcessDropIndexesRequest(char *dbName, DropIndexesArg dropIndexesArg, bool
 		}
 		else
 		{
-			DropPostgresIndex(collectionId, matchingIndexDetails->indexId,
-							  matchingIndexDetails->indexSpec.indexUnique ==
-							  BoolIndexOption_True,
-							  concurrently, missingOk);
-			DeleteCollectionIndexRecord(collectionId, matchingIndexDetails->indexId);
+			DropIndexAndDeleteIndexRecord(collectionId, matchingIndexDetails->indexId,
+										  matchingIndexDetails->indexSpec.indexUnique ==
+										  BoolIndexOption_True,
+										  missingOk);
 		}
 	}
 	else
@@ -672,6 +673,44 @@ DropIndexesArgExpandIndexNameList(uint64 collectionId, DropIndexesArg *dropIndex
 }
 
 
+/*
+ * DropIndexAndDeleteIndexRecord drops the index with indexId, in the current
+ * transaction, and deletes its index record.
+ *
+ * With deferred drops, a non-unique index is only hidden from queries: once its
+ * index record is deleted drop_deferred_relations_background drops it, so that
+ * dropIndexes doesn't wait for the queries on the collection. The index of a
+ * unique constraint is still dropped here since it keeps enforcing the
+ * constraint until then.
+ */
+static void
+DropIndexAndDeleteIndexRecord(uint64 collectionId, int indexId, bool unique,
+							  bool missingOk)
+{
+	bool deferDrop = false;
+	if (DeferredDropMaxRelationsPerRun > 0 && !unique)
+	{
+		char postgresIndexName[NAMEDATALEN] = { 0 };
+		pg_sprintf(postgresIndexName, DOCUMENT_DATA_TABLE_INDEX_NAME_FORMAT, indexId);
+		deferDrop = OidIsValid(get_relname_relid(postgresIndexName,
+												 ApiDataNamespaceOid()));
+	}
+
+	if (deferDrop)
+	{
+		bool hidden = true;
+		UpdatePostgresIndex(collectionId, indexId, hidden);
+	}
+	else
+	{
+		bool concurrently = false;
+		DropPostgresIndex(collectionId, indexId, unique, concurrently, missingOk);
+	}
+
+	DeleteCollectionIndexRecord(collectionId, indexId);
+}
+
+
 /*
  * DropPostgresIndex drops GIN index with indexId.
  */
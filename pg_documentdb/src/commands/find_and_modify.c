@@ -22,6 +22,7 @@
 #include "commands/parse_error.h"
 #include "commands/update.h"
 #include "metadata/collection.h"
+#include "infrastructure/command_activity.h"
 #include "query/query_operator.h"
 #include "sharding/sharding.h"
 #include "utils/feature_counter.h"
@@ -153,6 +154,8 @@ command_find_and_modify(PG_FUNCTION_ARGS)
 	text *transactionId = !PG_ARGISNULL(2) ? PG_GETARG_TEXT_P(2) : NULL;
 
 	ReportFeatureUsage(FEATURE_COMMAND_FINDANDMODIFY);
+	ReportCommandActivity("findAndModify", "command",
+						  DatumGetTextPP(databaseNameDatum), message);
 
 	/* fetch TupleDesc for return value, not interested in resultTypeId */
 	Oid *resultTypeId = NULL;
@@ -230,6 +233,8 @@ command_find_and_modify(PG_FUNCTION_ARGS)
 	values[0] = PointerGetDatum(BuildResponseMessage(&result));
 	values[1] = BoolGetDatum(result.ok);
 	resultTuple = heap_form_tuple(resultTupDesc, values, isNulls);
+
+	ReportCommandLatency(CommandLatencyKind_FindAndModify);
 	PG_RETURN_DATUM(HeapTupleGetDatum(resultTuple));
 }
 
@@ -376,6 +381,10 @@ ParseFindAndModifyMessage(pgbson *message)
 
 			spec.bypassDocumentValidation = bson_iter_bool(&messageIter);
 		}
+		else if (strcmp(key, "writeConcern") == 0)
+		{
+			SetWriteConcernDurability(bson_iter_value(&messageIter));
+		}
 		else if (strcmp(key, "let") == 0)
 		{
 			ReportFeatureUsage(FEATURE_LET_TOP_LEVEL);
@@ -404,7 +413,6 @@ ParseFindAndModifyMessage(pgbson *message)
 
 		/*
 		 * XXX: Silently ignore so that clients don't break:
-		 *  - writeConcern
 		 *  - comment
 		 *	- bypassDocumentValidation
 		 *  - collation
@@ -22,6 +22,9 @@
 #include <catalog/pg_class.h>
 #include <parser/parse_relation.h>
 #include <utils/lsyscache.h>
+#include <access/tableam.h>
+#include <executor/executor.h>
+#include <utils/rls.h>
 
 #include "access/xact.h"
 #include "executor/spi.h"
@@ -34,8 +37,11 @@
 #include "commands/parse_error.h"
 #include "metadata/collection.h"
 #include "infrastructure/documentdb_plan_cache.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/tailable_cursor_notifications.h"
 #include "sharding/sharding.h"
 #include "commands/retryable_writes.h"
+#include "commands/timeseries.h"
 #include "io/pgbsonsequence.h"
 #include "utils/query_utils.h"
 #include "utils/feature_counter.h"
@@ -48,6 +54,7 @@
 #include "operators/bson_expr_eval.h"
 #include "planner/documentdb_planner.h"
 #include "optimizer/plancat.h"
+#include "infrastructure/wait_events.h"
 
 /*
  * BatchInsertionSpec describes a batch of insert operations.
@@ -57,9 +64,15 @@ typedef struct BatchInsertionSpec
 	/* collection in which to perform insertions */
 	char *collectionName;
 
-	/* list of documents to insert */
+	/* list of documents to insert (NIL if streamed from documentSequence) */
 	List *documents;
 
+	/* The document sequence the documents are streamed from, or NULL */
+	pgbsonsequence *documentSequence;
+
+	/* number of documents to insert */
+	int documentCount;
+
 	/* if ordered, stop after the first failure */
 	bool isOrdered;
 
@@ -89,6 +102,20 @@ typedef struct BatchInsertionResult
 	MemoryContext resultMemoryContext;
 } BatchInsertionResult;
 
+/*
+ * InsertionDocumentCursor tracks the position of the next document
+ * to insert in a BatchInsertionSpec. Cursors are plain values and
+ * can be copied to remember (and rewind to) a position in the batch.
+ */
+typedef struct InsertionDocumentCursor
+{
+	/* The index of the next document in the list of documents */
+	int nextListIndex;
+
+	/* The iterator over the document sequence (for streamed batches) */
+	PgbsonSequenceIterator sequenceIterator;
+} InsertionDocumentCursor;
+
 
 PG_FUNCTION_INFO_V1(command_insert);
 PG_FUNCTION_INFO_V1(command_insert_one);
@@ -101,10 +128,21 @@ static BatchInsertionSpec * BuildBatchInsertionSpec(bson_iter_t *insertCommandIt
 static List * BuildInsertionList(bson_iter_t *insertArrayIter, bool *hasSkippedDocuments);
 static List * BuildInsertionListFromPgbsonSequence(pgbsonsequence *docSequence,
 												   bool *hasSkippedDocuments);
+static int CountInsertionDocumentsInPgbsonSequence(pgbsonsequence *docSequence,
+												   bool *hasSkippedDocuments);
+static void InitInsertionDocumentCursor(BatchInsertionSpec *batchSpec,
+										InsertionDocumentCursor *cursor);
+static bool InsertionDocumentCursorNext(BatchInsertionSpec *batchSpec,
+										InsertionDocumentCursor *cursor,
+										bson_value_t *documentValue);
 static void ProcessBatchInsertion(MongoCollection *collection,
 								  BatchInsertionSpec *batchSpec,
 								  text *transactionId, BatchInsertionResult *batchResult,
 								  bool isTransactional);
+static void ProcessTimeseriesBatchInsertion(Datum databaseNameDatum,
+											const TimeseriesOptions *options,
+											BatchInsertionSpec *batchSpec,
+											BatchInsertionResult *batchResult);
 static void DoBatchInsertNoTransactionId(MongoCollection *collection,
 										 BatchInsertionSpec *batchSpec,
 										 BatchInsertionResult *batchResult,
@@ -145,6 +183,10 @@ static inline RangeTblEntry * CreateBaseTableRteForInsert(MongoCollection *colle
 														  shardOid,
 														  List **optionalPermInfos);
 static inline void ReportInsertFeatureUsage(int batchSize);
+static bool TryExecuteLocalShardMultiInsert(MongoCollection *collection, Oid shardOid,
+											int numDocuments, int64 *shardKeyValues,
+											pgbson **objectIds, pgbson **documents,
+											uint64_t *rowsInserted);
 
 /*
  * ApiGucPrefix.enable_create_collection_on_insert GUC determines whether
@@ -155,6 +197,11 @@ extern bool UseLocalExecutionShardQueries;
 extern bool EnableBypassDocumentValidation;
 extern bool EnableSchemaValidation;
 extern bool EnableInsertCustomPlan;
+extern bool EnableStreamingSequenceInsert;
+extern bool EnableBatchPredicateEvaluation;
+extern bool EnableMultiRowHeapInsert;
+extern bool EnableBatchShardKeyHashing;
+extern bool EnableInsertSubBatchRetry;
 
 /*
  * command_insert handles the insert command invocation through a PostgreSQL function.
@@ -264,6 +311,8 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 {
 	const char *collectionName = NULL;
 	List *documents = NIL;
+	pgbsonsequence *documentSequence = NULL;
+	int insertionCount = 0;
 	bool isOrdered = true;
 	bool hasDocuments = false;
 	bool hasSkippedDocuments = false;
@@ -301,6 +350,7 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 			bson_iter_recurse(insertCommandIter, &insertArrayIter);
 
 			documents = BuildInsertionList(&insertArrayIter, &hasSkippedDocuments);
+			insertionCount = list_length(documents);
 			hasDocuments = true;
 		}
 		else if (strcmp(field, "ordered") == 0)
@@ -329,6 +379,10 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 			SetExplicitStatementTimeout(BsonValueAsInt32(bson_iter_value(
 															 insertCommandIter)));
 		}
+		else if (strcmp(field, "writeConcern") == 0)
+		{
+			SetWriteConcernDurability(bson_iter_value(insertCommandIter));
+		}
 		else if (IsCommonSpecIgnoredField(field))
 		{
 			elog(DEBUG1, "Command field not recognized: insert.%s", field);
@@ -336,7 +390,6 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 			/*
 			 *  Silently ignore now, so that clients don't break
 			 *  TODO: implement me
-			 *      writeConcern
 			 *      comment
 			 */
 		}
@@ -356,10 +409,22 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 							"The BSON field 'insert.insert' is required but not provided")));
 	}
 
-	if (insertDocs != NULL)
+	if (insertDocs != NULL && EnableStreamingSequenceInsert)
+	{
+		/*
+		 * Validate the sequence up front but leave the documents in place:
+		 * They are streamed from the sequence as they're inserted.
+		 */
+		insertionCount = CountInsertionDocumentsInPgbsonSequence(insertDocs,
+																 &hasSkippedDocuments);
+		documentSequence = insertDocs;
+		hasDocuments = true;
+	}
+	else if (insertDocs != NULL)
 	{
 		documents = BuildInsertionListFromPgbsonSequence(insertDocs,
 														 &hasSkippedDocuments);
+		insertionCount = list_length(documents);
 		hasDocuments = true;
 	}
 
@@ -370,7 +435,6 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 							   "a required field")));
 	}
 
-	int insertionCount = list_length(documents);
 	if ((!hasSkippedDocuments && insertionCount == 0) ||
 		insertionCount > MaxWriteBatchSize)
 	{
@@ -384,6 +448,8 @@ BuildBatchInsertionSpec(bson_iter_t *insertCommandIter, pgbsonsequence *insertDo
 
 	batchSpec->collectionName = (char *) collectionName;
 	batchSpec->documents = documents;
+	batchSpec->documentSequence = documentSequence;
+	batchSpec->documentCount = insertionCount;
 	batchSpec->isOrdered = isOrdered;
 	batchSpec->bypassDocumentValidation = bypassDocumentValidation;
 
@@ -502,6 +568,89 @@ BuildInsertionListFromPgbsonSequence(pgbsonsequence *docSequence,
 }
 
 
+/*
+ * CountInsertionDocumentsInPgbsonSequence validates the documents specified
+ * in the given pgbsonsequence and returns the number of documents to insert
+ * without materializing them.
+ */
+static int
+CountInsertionDocumentsInPgbsonSequence(pgbsonsequence *docSequence,
+										bool *hasSkippedDocuments)
+{
+	*hasSkippedDocuments = false;
+
+	int documentCount = 0;
+	PgbsonSequenceIterator sequenceIterator;
+	PgbsonSequenceIteratorInit(&sequenceIterator, docSequence);
+
+	bson_value_t docValue;
+	while (PgbsonSequenceIteratorNext(&sequenceIterator, &docValue))
+	{
+		if (ValidateAndCheckShouldInsertDocument(&docValue))
+		{
+			documentCount++;
+		}
+		else
+		{
+			*hasSkippedDocuments = true;
+		}
+	}
+
+	return documentCount;
+}
+
+
+/*
+ * Initializes a cursor at the first document to insert in the batch.
+ */
+static void
+InitInsertionDocumentCursor(BatchInsertionSpec *batchSpec,
+							InsertionDocumentCursor *cursor)
+{
+	memset(cursor, 0, sizeof(InsertionDocumentCursor));
+	if (batchSpec->documentSequence != NULL)
+	{
+		PgbsonSequenceIteratorInit(&cursor->sequenceIterator,
+								   batchSpec->documentSequence);
+	}
+}
+
+
+/*
+ * Moves the cursor to the next document to insert in the batch and sets
+ * documentValue to it. Documents that are skipped for insertion are not
+ * returned. Returns false once all the documents have been visited.
+ */
+static bool
+InsertionDocumentCursorNext(BatchInsertionSpec *batchSpec,
+							InsertionDocumentCursor *cursor,
+							bson_value_t *documentValue)
+{
+	if (batchSpec->documentSequence == NULL)
+	{
+		if (cursor->nextListIndex >= list_length(batchSpec->documents))
+		{
+			return false;
+		}
+
+		*documentValue = *(bson_value_t *) list_nth(batchSpec->documents,
+													cursor->nextListIndex);
+		cursor->nextListIndex++;
+		return true;
+	}
+
+	while (PgbsonSequenceIteratorNext(&cursor->sequenceIterator, documentValue))
+	{
+		if (ValidateAndCheckShouldInsertDocument(documentValue))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 /*
  * Creates the Param values for the BSON types.
  * We do this as a BYTEA param so that Citus can
@@ -541,13 +690,13 @@ CreateBsonParam(int paramIndex, ParamListInfo paramListInfo, pgbson *bsonValue)
  * and moving forward, this is left as an optimization for the future.
  */
 static bool
-DoMultiInsertWithoutTransactionId(MongoCollection *collection, List *inserts, Oid
-								  shardOid,
+DoMultiInsertWithoutTransactionId(MongoCollection *collection,
+								  BatchInsertionSpec *batchSpec,
+								  InsertionDocumentCursor *cursor, Oid shardOid,
 								  BatchInsertionResult *batchResult, int insertIndex,
 								  int *insertCountResult, ExprEvalState *evalState)
 {
 	/* declared volatile because of the longjmp in PG_CATCH */
-	volatile int insertInnerIndex = insertIndex;
 	volatile int insertCount = 0;
 
 	MemoryContext oldContext = CurrentMemoryContext;
@@ -558,33 +707,80 @@ DoMultiInsertWithoutTransactionId(MongoCollection *collection, List *inserts, Oi
 	PG_TRY();
 	{
 		List *valuesList = NIL;
-		ListCell *insertCell;
 
 		/* Make params for all the BSONs - we have 2 per insert - objectId/insertDoc */
-		int expectedNumParams = Min(list_length(inserts), BatchWriteSubTransactionCount);
+		int expectedNumParams = Min(batchSpec->documentCount - insertIndex,
+									BatchWriteSubTransactionCount);
 		ParamListInfo paramListInfo = makeParamList(expectedNumParams * 2);
-		int paramIndex = 0;
-		while (insertInnerIndex < list_length(inserts) &&
-			   insertCount < BatchWriteSubTransactionCount)
+
+		/*
+		 * Gather the documents of the sub-batch first so that the schema validator
+		 * evaluates them as one batch. A document that fails validation fails the
+		 * sub-batch, which is then retried one document at a time.
+		 */
+		bson_value_t *documentValues = palloc(sizeof(bson_value_t) *
+											  Max(expectedNumParams, 1));
+		int numDocuments = 0;
+		while (numDocuments < expectedNumParams &&
+			   InsertionDocumentCursorNext(batchSpec, cursor,
+										   &documentValues[numDocuments]))
+		{
+			numDocuments++;
+		}
+
+		ExprEvalState *documentEvalState = evalState;
+		if (evalState != NULL && EnableBatchPredicateEvaluation)
+		{
+			ValidateSchemaOnDocumentsInsert(evalState, documentValues, numDocuments,
+											FAILED_VALIDATION_ERROR_MSG);
+			documentEvalState = NULL;
+		}
+
+		int64 *shardKeyValues = palloc(sizeof(int64) * Max(numDocuments, 1));
+		pgbson **objectIds = palloc(sizeof(pgbson *) * Max(numDocuments, 1));
+		pgbson **insertDocs = palloc(sizeof(pgbson *) * Max(numDocuments, 1));
+		for (int documentIndex = 0; documentIndex < numDocuments; documentIndex++)
+		{
+			insertDocs[documentIndex] =
+				PreprocessInsertionDoc(&documentValues[documentIndex], collection,
+									   EnableBatchShardKeyHashing ? NULL :
+									   &shardKeyValues[documentIndex],
+									   &objectIds[documentIndex], documentEvalState);
+			insertCount++;
+		}
+
+		if (EnableBatchShardKeyHashing)
 		{
-			insertCell = list_nth_cell(inserts, insertInnerIndex);
-			const bson_value_t *documentValue = lfirst(insertCell);
+			/* Hash the whole sub-batch with the shard key paths compiled once */
+			ComputeShardKeyHashesForDocuments(collection->shardKey,
+											  collection->collectionId, insertDocs,
+											  numDocuments, shardKeyValues);
+		}
 
-			int64_t shardKeyValue;
-			pgbson *objectId;
-			pgbson *insertDoc =
-				PreprocessInsertionDoc(documentValue, collection, &shardKeyValue,
-									   &objectId, evalState);
+		uint64_t rowsProcessed = 0;
+		bool insertedInBulk = EnableMultiRowHeapInsert && shardOid != InvalidOid &&
+							  TryExecuteLocalShardMultiInsert(collection, shardOid,
+															  numDocuments,
+															  shardKeyValues, objectIds,
+															  insertDocs,
+															  &rowsProcessed);
 
+		int paramIndex = 0;
+		for (int documentIndex = 0; !insertedInBulk && documentIndex < numDocuments;
+			 documentIndex++)
+		{
 			/* Generate a values lists for the insert as
 			 * VALUES(shard_key_value, object_id, document, creationTime)
 			 */
 			Const *shardKeyConst = makeConst(INT8OID, -1, InvalidOid, 8,
-											 Int64GetDatum(shardKeyValue), false, true);
-			Expr *objectidParam = CreateBsonParam(paramIndex, paramListInfo, objectId);
+											 Int64GetDatum(shardKeyValues[documentIndex]),
+											 false, true);
+			Expr *objectidParam = CreateBsonParam(paramIndex, paramListInfo,
+												  objectIds[documentIndex]);
 			paramIndex++;
 
-			Expr *documentParam = CreateBsonParam(paramIndex, paramListInfo, insertDoc);
+			Expr *documentParam = CreateBsonParam(paramIndex, paramListInfo,
+												  insertDocs[documentIndex]);
 			paramIndex++;
 
 			List *values = CreateValuesListForInsert(shardKeyConst, objectidParam,
@@ -593,14 +789,15 @@ DoMultiInsertWithoutTransactionId(MongoCollection *collection, List *inserts, Oi
 													 mongoDataCreationTimeVarAttrNumber);
 
 			valuesList = lappend(valuesList, values);
-			insertCount++;
-			insertInnerIndex++;
 		}
 
 		paramListInfo->numParams = paramIndex;
 
-		uint64_t rowsProcessed = 0;
-		if (!EnableInsertCustomPlan || shardOid == InvalidOid)
+		if (insertedInBulk)
+		{
+			/* Inserted straight into the shard */
+		}
+		else if (!EnableInsertCustomPlan || shardOid == InvalidOid)
 		{
 			Query *query = CreateInsertQuery(collection, shardOid,
 											 valuesList);
@@ -621,6 +818,10 @@ DoMultiInsertWithoutTransactionId(MongoCollection *collection, List *inserts, Oi
 		insertCount = rowsProcessed;
 		list_free_deep(valuesList);
 		pfree(paramListInfo);
+		pfree(documentValues);
+		pfree(shardKeyValues);
+		pfree(objectIds);
+		pfree(insertDocs);
 
 		/* Commit the inner transaction, return to outer xact context */
 		ReleaseCurrentSubTransaction();
@@ -764,12 +965,20 @@ ProcessBatchInsertion(MongoCollection *collection, BatchInsertionSpec *batchSpec
 	 * multiple updates, since they would be considered retries of each
 	 * other. We pass NULL for now to disable retryable writes.
 	 */
-	if (transactionId != NULL && list_length(batchSpec->documents) == 1)
+	if (transactionId != NULL && batchSpec->documentCount == 1)
 	{
 		/* So at this point, we have a single document and transactionId != NULL */
 		int insertIndex = 0;
-		DoSingleInsert(collection, batchSpec->insertShardOid, linitial(
-						   batchSpec->documents),
+		InsertionDocumentCursor cursor;
+		bson_value_t document;
+		InitInsertionDocumentCursor(batchSpec, &cursor);
+		if (!InsertionDocumentCursorNext(batchSpec, &cursor, &document))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("Unable to find the document to insert")));
+		}
+
+		DoSingleInsert(collection, batchSpec->insertShardOid, &document,
 					   transactionId, batchResult, insertIndex, evalState);
 	}
 	else
@@ -790,20 +999,37 @@ ProcessBatchInsertion(MongoCollection *collection, BatchInsertionSpec *batchSpec
 
 /*
  * Process an insertion for batch of inserts using the INSERT command.
+ * Documents are preprocessed and inserted in sub-batches of at most
+ * BatchWriteSubTransactionCount documents. The intermediate state of a
+ * sub-batch is allocated in a memory context that is reset before the
+ * next sub-batch so that memory stays bounded regardless of batch size.
  */
 static void
 DoBatchInsertNoTransactionId(MongoCollection *collection, BatchInsertionSpec *batchSpec,
 							 BatchInsertionResult *batchResult, ExprEvalState *evalState,
 							 bool isTransactional)
 {
-	List *insertions = batchSpec->documents;
+	int documentCount = batchSpec->documentCount;
 	bool isOrdered = batchSpec->isOrdered;
 
 	int insertIndex = 0;
 	bool hasBatchedInsertFailed = false;
 
-	ListCell *insertCell = NULL;
-	while (insertIndex < list_length(insertions))
+	/*
+	 * The index up to which documents are inserted one at a time after a failed
+	 * sub-batch, when only the failed sub-batch is retried.
+	 */
+	int singleInsertEndIndex = 0;
+
+	InsertionDocumentCursor cursor;
+	InitInsertionDocumentCursor(batchSpec, &cursor);
+
+	/* The result context outlives the intermediate commits of the batch */
+	MemoryContext subBatchContext = AllocSetContextCreate(
+		batchResult->resultMemoryContext, "InsertSubBatchContext",
+		ALLOCSET_DEFAULT_SIZES);
+
+	while (insertIndex < documentCount)
 	{
 		CHECK_FOR_INTERRUPTS();
 
@@ -816,12 +1042,18 @@ DoBatchInsertNoTransactionId(MongoCollection *collection, BatchInsertionSpec *ba
 														   setSnapshot);
 		}
 
-		if (list_length(insertions) > 1 && !hasBatchedInsertFailed)
+		MemoryContextReset(subBatchContext);
+		MemoryContext oldContext = MemoryContextSwitchTo(subBatchContext);
+
+		if (documentCount > 1 && !hasBatchedInsertFailed &&
+			insertIndex >= singleInsertEndIndex)
 		{
 			/* Optimistically try to do multiple updates together, if it fails, try again one by one to figure out which one failed */
 			int incrementCount = 0;
+			InsertionDocumentCursor subBatchStart = cursor;
 			bool performedBatchInsert = DoMultiInsertWithoutTransactionId(collection,
-																		  insertions,
+																		  batchSpec,
+																		  &cursor,
 																		  batchSpec->
 																		  insertShardOid,
 																		  batchResult,
@@ -832,21 +1064,43 @@ DoBatchInsertNoTransactionId(MongoCollection *collection, BatchInsertionSpec *ba
 			Assert(!performedBatchInsert || incrementCount > 0);
 			if (!performedBatchInsert)
 			{
-				/* Has a failure, set hasFailures and retry */
-				hasBatchedInsertFailed = true;
+				/* Has a failure, retry from the start of the sub-batch one by one */
+				cursor = subBatchStart;
+				if (EnableInsertSubBatchRetry && !isOrdered)
+				{
+					/*
+					 * Unordered inserts keep going after a failure: Only the failed
+					 * sub-batch needs single inserts to find the failing documents,
+					 * the rest of the batch goes back to multi-row inserts.
+					 */
+					singleInsertEndIndex = insertIndex +
+										   Min(documentCount - insertIndex,
+											   BatchWriteSubTransactionCount);
+				}
+				else
+				{
+					hasBatchedInsertFailed = true;
+				}
 			}
 
 			insertIndex += incrementCount;
+			MemoryContextSwitchTo(oldContext);
 			continue;
 		}
 
-		insertCell = list_nth_cell(insertions, insertIndex);
-		const bson_value_t *document = lfirst(insertCell);
+		bson_value_t document;
+		if (!InsertionDocumentCursorNext(batchSpec, &cursor, &document))
+		{
+			MemoryContextSwitchTo(oldContext);
+			break;
+		}
+
 		text *transactionId = NULL;
-		bool isSuccess = DoSingleInsert(collection, batchSpec->insertShardOid, document,
+		bool isSuccess = DoSingleInsert(collection, batchSpec->insertShardOid, &document,
 										transactionId, batchResult,
 										insertIndex, evalState);
 		insertIndex++;
+		MemoryContextSwitchTo(oldContext);
 
 		if (!isSuccess && isOrdered)
 		{
@@ -854,6 +1108,8 @@ DoBatchInsertNoTransactionId(MongoCollection *collection, BatchInsertionSpec *ba
 			break;
 		}
 	}
+
+	MemoryContextDelete(subBatchContext);
 }
 
 
@@ -964,6 +1220,8 @@ CommandInsertCore(PG_FUNCTION_ARGS, bool isTransactional, MemoryContext allocCon
 
 	Datum databaseNameDatum = PG_GETARG_DATUM(0);
 	pgbson *insertSpec = PG_GETARG_PGBSON(1);
+	ReportCommandActivity("insert", "insert", DatumGetTextPP(databaseNameDatum),
+						  insertSpec);
 
 	pgbsonsequence *insertDocs = PG_GETARG_MAYBE_NULL_PGBSON_SEQUENCE(2);
 
@@ -991,11 +1249,11 @@ CommandInsertCore(PG_FUNCTION_ARGS, bool isTransactional, MemoryContext allocCon
 	/* we first validate insert command BSON and build a specification */
 	BatchInsertionSpec *batchSpec = BuildBatchInsertionSpec(&insertCommandIter,
 															insertDocs);
-	ReportInsertFeatureUsage(list_length(batchSpec->documents));
+	ReportInsertFeatureUsage(batchSpec->documentCount);
 	BatchInsertionResult batchResult;
 	batchResult.resultMemoryContext = allocContext;
 	MemoryContextSwitchTo(oldContext);
-	if (list_length(batchSpec->documents) == 0)
+	if (batchSpec->documentCount == 0)
 	{
 		/* Don't create the collection if there are no documents to insert */
 		batchResult.rowsInserted = 0;
@@ -1007,23 +1265,47 @@ CommandInsertCore(PG_FUNCTION_ARGS, bool isTransactional, MemoryContext allocCon
 		/* open collection */
 		Datum collectionNameDatum = CStringGetTextDatum(batchSpec->collectionName);
 		MongoCollection *collection =
-			GetMongoCollectionByNameDatum(databaseNameDatum, collectionNameDatum,
-										  RowExclusiveLock);
+			GetMongoCollectionOrViewByNameDatum(databaseNameDatum, collectionNameDatum,
+												RowExclusiveLock);
 
-		if (collection == NULL)
+		TimeseriesOptions timeseriesOptions;
+		if (TryGetTimeseriesOptions(collection, &timeseriesOptions))
 		{
-			collection = CreateCollectionForInsert(databaseNameDatum,
-												   collectionNameDatum);
+			/* The measurements are written to the buckets behind the view */
+			ProcessTimeseriesBatchInsertion(databaseNameDatum, &timeseriesOptions,
+											batchSpec, &batchResult);
 		}
 		else
 		{
-			batchSpec->insertShardOid = TryGetCollectionShardTable(collection,
-																   RowExclusiveLock);
-		}
+			if (collection != NULL && collection->viewDefinition != NULL)
+			{
+				/* Errors out for views */
+				collection = GetMongoCollectionByNameDatum(databaseNameDatum,
+														   collectionNameDatum,
+														   RowExclusiveLock);
+			}
 
-		/* execute data inserts */
-		ProcessBatchInsertion(collection, batchSpec, transactionId, &batchResult,
-							  isTransactional);
+			if (collection == NULL)
+			{
+				collection = CreateCollectionForInsert(databaseNameDatum,
+													   collectionNameDatum);
+			}
+			else
+			{
+				batchSpec->insertShardOid = TryGetCollectionShardTable(collection,
+																	   RowExclusiveLock);
+			}
+
+			/* execute data inserts */
+			ProcessBatchInsertion(collection, batchSpec, transactionId, &batchResult,
+								  isTransactional);
+
+			/* Wake up the tailable cursors awaiting data once the inserts commit */
+			if (batchResult.rowsInserted > 0)
+			{
+				NotifyCollectionWriteOnCommit(collection->collectionId);
+			}
+		}
 	}
 
 	Datum values[2];
@@ -1032,6 +1314,8 @@ CommandInsertCore(PG_FUNCTION_ARGS, bool isTransactional, MemoryContext allocCon
 	values[0] = PointerGetDatum(BuildResponseMessage(&batchResult));
 	values[1] = BoolGetDatum(batchResult.writeErrors == NIL);
 	HeapTuple resultTuple = heap_form_tuple(resultTupDesc, values, isNulls);
+
+	ReportCommandLatency(CommandLatencyKind_Insert);
 	return HeapTupleGetDatum(resultTuple);
 }
 
@@ -1079,10 +1363,13 @@ CallInsertWorkerForInsertOne(MongoCollection *collection, int64 shardKeyHash,
 	int numResults = 1;
 
 	/* forceDelegation assumes nested distribution */
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_WorkerCall);
 	RunMultiValueQueryWithNestedDistribution(updateQuery, argCount, argTypes, argValues,
 											 argNulls,
 											 readOnly, SPI_OK_SELECT, resultDatum,
 											 isNulls, numResults);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
 
 	if (isNulls[0])
 	{
@@ -1316,6 +1603,74 @@ InsertOrReplaceDocument(uint64 collectionId, const char *shardTableName, int64
 }
 
 
+/*
+ * Inserts a document with the given shardKeyValue and object_id unless a document
+ * with the same _id already exists. Returns whether the document was inserted.
+ */
+bool
+InsertDocumentIfNotExists(uint64 collectionId, const char *shardTableName,
+						  int64 shardKeyValue, pgbson *objectId, pgbson *document)
+{
+	StringInfoData query;
+	const int argCount = 3;
+	Oid argTypes[3];
+	Datum argValues[3];
+
+	SPI_connect();
+
+	initStringInfo(&query);
+	appendStringInfo(&query, "INSERT INTO %s.", ApiDataSchemaName);
+
+	bool isLocalShard = shardTableName != NULL && shardTableName[0] != '\0';
+	if (isLocalShard)
+	{
+		appendStringInfoString(&query, shardTableName);
+	}
+	else
+	{
+		appendStringInfo(&query, "documents_" UINT64_FORMAT, collectionId);
+	}
+
+	appendStringInfo(&query, " (shard_key_value, object_id, document) "
+							 " VALUES ($1, %s.bson_from_bytea($2), "
+							 "%s.bson_from_bytea($3))",
+					 CoreSchemaName, CoreSchemaName);
+
+	if (isLocalShard)
+	{
+		/* Direct shard - the constraint has the tableId_shardId suffix of documents_ */
+		const int prefixLength = 10;
+		appendStringInfo(&query, " ON CONFLICT ON CONSTRAINT collection_pk_%s"
+								 " DO NOTHING", shardTableName + prefixLength);
+	}
+	else
+	{
+		appendStringInfo(&query, " ON CONFLICT ON CONSTRAINT collection_pk_" UINT64_FORMAT
+						 " DO NOTHING", collectionId);
+	}
+
+	argTypes[0] = INT8OID;
+	argValues[0] = Int64GetDatum(shardKeyValue);
+	argTypes[1] = BYTEAOID;
+	argValues[1] = PointerGetDatum(CastPgbsonToBytea(objectId));
+	argTypes[2] = BYTEAOID;
+	argValues[2] = PointerGetDatum(CastPgbsonToBytea(document));
+
+	SPIPlanPtr plan = GetSPIQueryPlanWithLocalShard(collectionId, shardTableName,
+													QUERY_ID_INSERT_IF_NOT_EXISTS,
+													query.data, argTypes,
+													argCount);
+
+	int spiStatus = SPI_execute_plan(plan, argValues, NULL, false, 1);
+	bool isInserted = spiStatus == SPI_OK_INSERT && SPI_processed == 1;
+	pfree(query.data);
+
+	SPI_finish();
+
+	return isInserted;
+}
+
+
 /*
  * BuildResponseMessage builds the response BSON for an insert command.
  */
@@ -1378,10 +1733,15 @@ PreprocessInsertionDoc(const bson_value_t *docValue, MongoCollection *collection
 	 * is not problematic in terms of querying, because it means this
 	 * object can only be found by queries that do not specify a full
 	 * shard key filter and those queries scan all the shards.
+	 *
+	 * Callers that hash a whole batch at once pass a NULL shardKeyHash.
 	 */
-	*shardKeyHash = ComputeShardKeyHashForDocument(collection->shardKey,
-												   collection->collectionId,
-												   insertDoc);
+	if (shardKeyHash != NULL)
+	{
+		*shardKeyHash = ComputeShardKeyHashForDocument(collection->shardKey,
+													   collection->collectionId,
+													   insertDoc);
+	}
 
 	if (objectId != NULL)
 	{
@@ -1392,6 +1752,47 @@ PreprocessInsertionDoc(const bson_value_t *docValue, MongoCollection *collection
 }
 
 
+/*
+ * Inserts the documents of the batch into a time-series collection, which
+ * adds them as measurements to the buckets of the collection. The batch is
+ * validated as a whole: an invalid measurement fails the command.
+ */
+static void
+ProcessTimeseriesBatchInsertion(Datum databaseNameDatum,
+								const TimeseriesOptions *options,
+								BatchInsertionSpec *batchSpec,
+								BatchInsertionResult *batchResult)
+{
+	Datum bucketsNameDatum = CStringGetTextDatum(
+		psprintf("%s%s", TIMESERIES_BUCKETS_PREFIX, batchSpec->collectionName));
+	MongoCollection *bucketsCollection =
+		GetMongoCollectionByNameDatum(databaseNameDatum, bucketsNameDatum,
+									  RowExclusiveLock);
+	if (bucketsCollection == NULL)
+	{
+		bucketsCollection = CreateCollectionForInsert(databaseNameDatum,
+													  bucketsNameDatum);
+	}
+
+	List *measurements = NIL;
+	InsertionDocumentCursor cursor;
+	InitInsertionDocumentCursor(batchSpec, &cursor);
+
+	bson_value_t documentValue;
+	while (InsertionDocumentCursorNext(batchSpec, &cursor, &documentValue))
+	{
+		bson_value_t *measurement = palloc(sizeof(bson_value_t));
+		*measurement = documentValue;
+		measurements = lappend(measurements, measurement);
+	}
+
+	batchResult->rowsInserted = InsertTimeseriesMeasurements(bucketsCollection,
+															 options, measurements);
+	batchResult->ok = 1;
+	batchResult->writeErrors = NIL;
+}
+
+
 /*
  * Creates a Query for the purposes of inserting a document. This takes
  * the form
@@ -1586,6 +1987,153 @@ ExecuteLocalShardInsertPlan(PlannedStmt *queryPlan, ParamListInfo paramListInfo)
 }
 
 
+/*
+ * Inserts a sub-batch of documents straight into the local shard with
+ * table_multi_insert and then inserts the index entries of each row, skipping
+ * the planning and the per row executor overhead of the INSERT.
+ * Uniqueness and constraint violations are raised like the INSERT does, so a
+ * failure fails the sub-batch and the caller retries it document by document.
+ * Returns false without inserting if the shard needs more than this handles:
+ * Triggers, row level security or columns that need their default.
+ */
+static bool
+TryExecuteLocalShardMultiInsert(MongoCollection *collection, Oid shardOid,
+								int numDocuments, int64 *shardKeyValues,
+								pgbson **objectIds, pgbson **documents,
+								uint64_t *rowsInserted)
+{
+	if (numDocuments <= 0)
+	{
+		return false;
+	}
+
+	ThrowIfWriteCommandNotAllowed();
+
+	Relation shardRelation = table_open(shardOid, RowExclusiveLock);
+	TupleDesc tupleDesc = RelationGetDescr(shardRelation);
+	AttrNumber creationTimeAttr = collection->mongoDataCreationTimeVarAttrNumber;
+
+	bool canInsertInBulk = shardRelation->rd_rel->relkind == RELKIND_RELATION &&
+						   shardRelation->trigdesc == NULL &&
+						   check_enable_rls(shardOid, InvalidOid, true) != RLS_ENABLED;
+	for (int i = 0; canInsertInBulk && i < tupleDesc->natts; i++)
+	{
+		Form_pg_attribute attribute = TupleDescAttr(tupleDesc, i);
+		AttrNumber attributeNumber = attribute->attnum;
+		bool isSetByInsert =
+			attributeNumber == DOCUMENT_DATA_TABLE_SHARD_KEY_VALUE_VAR_ATTR_NUMBER ||
+			attributeNumber == DOCUMENT_DATA_TABLE_OBJECT_ID_VAR_ATTR_NUMBER ||
+			attributeNumber == DOCUMENT_DATA_TABLE_DOCUMENT_VAR_ATTR_NUMBER ||
+			attributeNumber == creationTimeAttr;
+		if (!isSetByInsert && !attribute->attisdropped &&
+			(attribute->atthasdef || attribute->attnotnull || attribute->attgenerated))
+		{
+			canInsertInBulk = false;
+		}
+	}
+
+	if (!canInsertInBulk)
+	{
+		table_close(shardRelation, NoLock);
+		return false;
+	}
+
+	/* Set up the executor state the same way the INSERT plan would */
+	EState *estate = CreateExecutorState();
+#if PG_VERSION_NUM >= 160000
+	List *permInfos = NIL;
+	RangeTblEntry *relationRte = CreateBaseTableRteForInsert(collection, shardOid,
+															 &permInfos);
+	relationRte->inh = false;
+	ExecCheckPermissions(list_make1(relationRte), permInfos, true);
+#if PG_VERSION_NUM >= 180000
+	ExecInitRangeTable(estate, list_make1(relationRte), permInfos,
+					   bms_make_singleton(1));
+#else
+	ExecInitRangeTable(estate, list_make1(relationRte), permInfos);
+#endif
+#else
+	RangeTblEntry *relationRte = CreateBaseTableRteForInsert(collection, shardOid, NULL);
+	relationRte->inh = false;
+	ExecCheckRTPerms(list_make1(relationRte), true);
+	ExecInitRangeTable(estate, list_make1(relationRte));
+#endif
+
+	ResultRelInfo *resultRelInfo = makeNode(ResultRelInfo);
+	InitResultRelInfo(resultRelInfo, shardRelation, 1, NULL, 0);
+	bool speculative = false;
+	ExecOpenIndices(resultRelInfo, speculative);
+
+	TimestampTz creationTime = (TimestampTz) 000000000000000LL; /* same as the INSERT */
+	TupleTableSlot **slots = palloc(sizeof(TupleTableSlot *) * numDocuments);
+	for (int i = 0; i < numDocuments; i++)
+	{
+		TupleTableSlot *slot = table_slot_create(shardRelation, NULL);
+		ExecClearTuple(slot);
+		memset(slot->tts_isnull, true, sizeof(bool) * tupleDesc->natts);
+
+		slot->tts_values[DOCUMENT_DATA_TABLE_SHARD_KEY_VALUE_VAR_ATTR_NUMBER - 1] =
+			Int64GetDatum(shardKeyValues[i]);
+		slot->tts_isnull[DOCUMENT_DATA_TABLE_SHARD_KEY_VALUE_VAR_ATTR_NUMBER - 1] = false;
+		slot->tts_values[DOCUMENT_DATA_TABLE_OBJECT_ID_VAR_ATTR_NUMBER - 1] =
+			PointerGetDatum(objectIds[i]);
+		slot->tts_isnull[DOCUMENT_DATA_TABLE_OBJECT_ID_VAR_ATTR_NUMBER - 1] = false;
+		slot->tts_values[DOCUMENT_DATA_TABLE_DOCUMENT_VAR_ATTR_NUMBER - 1] =
+			PointerGetDatum(documents[i]);
+		slot->tts_isnull[DOCUMENT_DATA_TABLE_DOCUMENT_VAR_ATTR_NUMBER - 1] = false;
+		if (creationTimeAttr != -1)
+		{
+			slot->tts_values[creationTimeAttr - 1] = TimestampTzGetDatum(creationTime);
+			slot->tts_isnull[creationTimeAttr - 1] = false;
+		}
+
+		ExecStoreVirtualTuple(slot);
+		if (tupleDesc->constr != NULL)
+		{
+			ExecConstraints(resultRelInfo, slot, estate);
+		}
+
+		slots[i] = slot;
+	}
+
+	CommandId commandId = GetCurrentCommandId(true);
+	int insertOptions = 0;
+	table_multi_insert(shardRelation, slots, numDocuments, commandId, insertOptions,
+					   NULL);
+
+	/* Now the index entries of the rows: These raise unique violations on _id */
+	for (int i = 0; i < numDocuments; i++)
+	{
+		if (resultRelInfo->ri_NumIndices > 0)
+		{
+			bool update = false;
+			bool noDupErr = false;
+#if PG_VERSION_NUM >= 160000
+			bool onlySummarizing = false;
+			List *recheckIndexes = ExecInsertIndexTuples(resultRelInfo, slots[i], estate,
+														 update, noDupErr, NULL, NIL,
+														 onlySummarizing);
+#else
+			List *recheckIndexes = ExecInsertIndexTuples(resultRelInfo, slots[i], estate,
+														 update, noDupErr, NULL, NIL);
+#endif
+			list_free(recheckIndexes);
+			ResetPerTupleExprContext(estate);
+		}
+
+		ExecDropSingleTupleTableSlot(slots[i]);
+	}
+
+	ExecCloseIndices(resultRelInfo);
+	FreeExecutorState(estate);
+	table_close(shardRelation, NoLock);
+	pfree(slots);
+
+	*rowsInserted = numDocuments;
+	return true;
+}
+
+
 /* indicates the presence of a creation_time column in the table, either at attribute number 4 or 5 */
 static inline List *
 CreateValuesListForInsert(Const *shardKey, Expr *objectId, Expr *document, AttrNumber
@@ -10,14 +10,28 @@
 #include "postgres.h"
 #include "fmgr.h"
 #include "miscadmin.h"
+#include "catalog/pg_type.h"
 #include "executor/spi.h"
 #include "lib/stringinfo.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
+#include "utils/lsyscache.h"
+#include "utils/timestamp.h"
 
 #include "io/bson_core.h"
 #include "infrastructure/documentdb_plan_cache.h"
 #include "commands/retryable_writes.h"
 #include "metadata/metadata_cache.h"
+#include "utils/data_table_utils.h"
+#include "utils/query_utils.h"
+
+extern int RetryRecordRetentionSeconds;
+extern int MaxRetryRecordDeleteBatchSize;
+
+static uint64 DeleteExpiredRetryRecords(uint64 collectionId, TimestampTz cutoffTime,
+										int32 batchSize);
+
+PG_FUNCTION_INFO_V1(delete_expired_retry_records_background);
 
 
 /*
@@ -286,3 +300,109 @@ InsertRetryRecord(uint64 collectionId, int64 shardKeyValue, text *transactionId,
 
 	SPI_finish();
 }
+
+
+/*
+ * delete_expired_retry_records_background prunes up to a batch of the retry
+ * records older than RetryRecordRetentionSeconds from the retry table of each
+ * collection. This is called periodically by the background worker framework,
+ * and keeps the retry tables (and their primary key probed on every retryable
+ * write) from growing without a bound.
+ */
+Datum
+delete_expired_retry_records_background(PG_FUNCTION_ARGS)
+{
+	int32 batchSize = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
+	if (batchSize <= 0)
+	{
+		batchSize = MaxRetryRecordDeleteBatchSize;
+	}
+
+	if (RetryRecordRetentionSeconds <= 0)
+	{
+		PG_RETURN_VOID();
+	}
+
+	ArrayType *collectionIdArray = GetCollectionIds();
+	if (collectionIdArray == NULL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	Datum *collectionIds = NULL;
+	int collectionCount = 0;
+	deconstruct_array(collectionIdArray, INT8OID, sizeof(int64), true, TYPALIGN_INT,
+					  &collectionIds, NULL, &collectionCount);
+
+	TimestampTz cutoffTime = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+														 -(int64)
+														 RetryRecordRetentionSeconds *
+														 1000L);
+
+	uint64 totalDeleted = 0;
+	for (int i = 0; i < collectionCount; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		uint64 collectionId = (uint64) DatumGetInt64(collectionIds[i]);
+		char retryTableName[NAMEDATALEN];
+		snprintf(retryTableName, NAMEDATALEN, "retry_" UINT64_FORMAT, collectionId);
+
+		/* The collection may have been dropped since the ids were read */
+		if (get_relname_relid(retryTableName, ApiDataNamespaceOid()) == InvalidOid)
+		{
+			continue;
+		}
+
+		totalDeleted += DeleteExpiredRetryRecords(collectionId, cutoffTime, batchSize);
+	}
+
+	if (totalDeleted > 0)
+	{
+		elog(DEBUG1, "Deleted " UINT64_FORMAT " expired retry records from %d "
+					 "collections", totalDeleted, collectionCount);
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * DeleteExpiredRetryRecords deletes up to batchSize retry records of the
+ * collection written before the cutoff time, and returns the number deleted.
+ * DELETE does not support LIMIT, so the batch is picked in a subquery on the
+ * primary key.
+ */
+static uint64
+DeleteExpiredRetryRecords(uint64 collectionId, TimestampTz cutoffTime, int32 batchSize)
+{
+	StringInfoData query;
+	initStringInfo(&query);
+	appendStringInfo(&query,
+					 "DELETE FROM %s.retry_" UINT64_FORMAT
+					 " WHERE write_time < $1 AND (shard_key_value, transaction_id) IN ("
+					 " SELECT shard_key_value, transaction_id FROM %s.retry_" UINT64_FORMAT
+					 " WHERE write_time < $1 LIMIT $2)",
+					 ApiDataSchemaName, collectionId, ApiDataSchemaName, collectionId);
+
+	int nargs = 2;
+	Oid argTypes[2] = { TIMESTAMPTZOID, INT4OID };
+	Datum argValues[2] = {
+		TimestampTzGetDatum(cutoffTime), Int32GetDatum(batchSize)
+	};
+	char argNulls[2] = { ' ', ' ' };
+
+	bool readOnly = false;
+	int statementTimeout = 0;
+	int lockTimeout = 0;
+	uint64 rowsDeleted = ExtensionExecuteCappedStatementWithArgsViaSPI(query.data, nargs,
+																	   argTypes,
+																	   argValues,
+																	   argNulls,
+																	   readOnly,
+																	   SPI_OK_DELETE,
+																	   statementTimeout,
+																	   lockTimeout);
+	pfree(query.data);
+	return rowsDeleted;
+}
@@ -0,0 +1,662 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/commands/timeseries.c
+ *
+ * Implementation of time-series collections.
+ *
+ * The measurements of a time-series collection are stored in a buckets
+ * collection, one document per metaField value and time window:
+ *
+ *    { _id, meta: <metaField value>,
+ *      control: { min: { <field>: <min>, ... }, max: { ... }, count: <n> },
+ *      data: [ <measurement without the metaField>, ... ] }
+ *
+ * The time-series collection itself is a view over the buckets collection
+ * with a single $_internalUnpackBucket stage, which returns the measurements
+ * and uses the control min/max of the buckets to skip the buckets a filter
+ * can't match.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+#include <miscadmin.h>
+
+#include "io/bson_core.h"
+#include "commands/commands_common.h"
+#include "commands/parse_error.h"
+#include "commands/timeseries.h"
+#include "commands/update.h"
+#include "query/bson_compare.h"
+#include "sharding/sharding.h"
+#include "utils/documentdb_errors.h"
+
+/* The bucket spans of the granularities */
+#define TIMESERIES_SECONDS_GRANULARITY_SPAN 3600
+#define TIMESERIES_MINUTES_GRANULARITY_SPAN 86400
+#define TIMESERIES_HOURS_GRANULARITY_SPAN 2592000
+#define TIMESERIES_MAX_BUCKET_SPAN 31536000
+
+/*
+ * The measurements of a batch that go to the same bucket.
+ */
+typedef struct TimeseriesBucketGroup
+{
+	/* The metaField of the measurements, BSON_TYPE_EOD if they don't have one */
+	bson_value_t meta;
+
+	/* The start of the time window of the bucket */
+	int64 bucketStartMs;
+
+	/* The measurements (pgbson *) */
+	List *measurements;
+} TimeseriesBucketGroup;
+
+/*
+ * The smallest and largest value of a top level field of the measurements
+ * added to a bucket.
+ */
+typedef struct TimeseriesFieldBounds
+{
+	const char *field;
+	bson_value_t min;
+	bson_value_t max;
+} TimeseriesFieldBounds;
+
+
+static void ValidateTimeseriesField(const char *fieldName, const char *fieldValue);
+static bool TimeseriesMetaEquals(const bson_value_t *left, const bson_value_t *right);
+static TimeseriesBucketGroup * GetBucketGroup(List **groups, const bson_value_t *meta,
+											  int64 bucketStartMs);
+static void UpsertTimeseriesBucket(MongoCollection *bucketsCollection,
+								   const TimeseriesOptions *options,
+								   TimeseriesBucketGroup *group, List *measurements);
+static List * GetMeasurementFieldBounds(const TimeseriesOptions *options,
+										List *measurements);
+
+
+/*
+ * Parses the options of a time-series collection. These are the "timeseries"
+ * field of a create() command (isCreateSpec), or the spec of the
+ * $_internalUnpackBucket stage which is written by CreateTimeseriesViewPipeline.
+ */
+void
+ParseTimeseriesOptions(const bson_value_t *optionsValue, const char *fieldPrefix,
+					   bool isCreateSpec, TimeseriesOptions *options)
+{
+	memset(options, 0, sizeof(TimeseriesOptions));
+
+	const char *granularity = NULL;
+	int64 bucketRoundingSeconds = 0;
+
+	bson_iter_t optionsIter;
+	BsonValueInitIterator(optionsValue, &optionsIter);
+	while (bson_iter_next(&optionsIter))
+	{
+		const char *key = bson_iter_key(&optionsIter);
+		const bson_value_t *value = bson_iter_value(&optionsIter);
+		if (strcmp(key, "timeField") == 0)
+		{
+			EnsureTopLevelFieldType(psprintf("%s.timeField", fieldPrefix), &optionsIter,
+									BSON_TYPE_UTF8);
+			options->timeField = pstrdup(value->value.v_utf8.str);
+			ValidateTimeseriesField("timeField", options->timeField);
+		}
+		else if (strcmp(key, "metaField") == 0)
+		{
+			EnsureTopLevelFieldType(psprintf("%s.metaField", fieldPrefix), &optionsIter,
+									BSON_TYPE_UTF8);
+			options->metaField = pstrdup(value->value.v_utf8.str);
+			ValidateTimeseriesField("metaField", options->metaField);
+		}
+		else if (strcmp(key, "bucketMaxSpanSeconds") == 0)
+		{
+			if (!BsonTypeIsNumber(value->value_type))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_TYPEMISMATCH),
+								errmsg(
+									"BSON field '%s.bucketMaxSpanSeconds' is the wrong type '%s', expected type 'int'",
+									fieldPrefix, BsonTypeName(value->value_type))));
+			}
+
+			options->bucketMaxSpanSeconds = BsonValueAsInt64(value);
+			if (options->bucketMaxSpanSeconds < 1 ||
+				options->bucketMaxSpanSeconds > TIMESERIES_MAX_BUCKET_SPAN)
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+								errmsg(
+									"Timeseries 'bucketMaxSpanSeconds' must be between 1 and %d",
+									TIMESERIES_MAX_BUCKET_SPAN)));
+			}
+		}
+		else if (isCreateSpec && strcmp(key, "bucketRoundingSeconds") == 0)
+		{
+			if (!BsonTypeIsNumber(value->value_type))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_TYPEMISMATCH),
+								errmsg(
+									"BSON field '%s.bucketRoundingSeconds' is the wrong type '%s', expected type 'int'",
+									fieldPrefix, BsonTypeName(value->value_type))));
+			}
+
+			bucketRoundingSeconds = BsonValueAsInt64(value);
+		}
+		else if (isCreateSpec && strcmp(key, "granularity") == 0)
+		{
+			EnsureTopLevelFieldType(psprintf("%s.granularity", fieldPrefix),
+									&optionsIter, BSON_TYPE_UTF8);
+			granularity = value->value.v_utf8.str;
+		}
+		else
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+							errmsg("BSON field '%s.%s' is an unknown field.",
+								   fieldPrefix, key)));
+		}
+	}
+
+	if (options->timeField == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40414),
+						errmsg(
+							"BSON field '%s.timeField' is missing but a required field",
+							fieldPrefix)));
+	}
+
+	if (options->metaField != NULL && strcmp(options->metaField,
+											 options->timeField) == 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg("The 'metaField' cannot be the same as the 'timeField'")));
+	}
+
+	if (granularity != NULL && options->bucketMaxSpanSeconds != 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+						errmsg(
+							"Timeseries 'granularity' and 'bucketMaxSpanSeconds' cannot both be specified")));
+	}
+
+	if (bucketRoundingSeconds != options->bucketMaxSpanSeconds)
+	{
+		/* The buckets always start at a multiple of their span */
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INVALIDOPTIONS),
+						errmsg(
+							"Timeseries 'bucketMaxSpanSeconds' and 'bucketRoundingSeconds' fields must be set together and equal")));
+	}
+
+	if (options->bucketMaxSpanSeconds != 0)
+	{
+		return;
+	}
+
+	if (granularity == NULL || strcmp(granularity, "seconds") == 0)
+	{
+		options->bucketMaxSpanSeconds = TIMESERIES_SECONDS_GRANULARITY_SPAN;
+	}
+	else if (strcmp(granularity, "minutes") == 0)
+	{
+		options->bucketMaxSpanSeconds = TIMESERIES_MINUTES_GRANULARITY_SPAN;
+	}
+	else if (strcmp(granularity, "hours") == 0)
+	{
+		options->bucketMaxSpanSeconds = TIMESERIES_HOURS_GRANULARITY_SPAN;
+	}
+	else
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg(
+							"The enumeration value '%s' provided for the field '%s.granularity' is invalid.",
+							granularity, fieldPrefix)));
+	}
+}
+
+
+/*
+ * Writes the pipeline of the view of a time-series collection:
+ * [ { "$_internalUnpackBucket": { timeField, metaField, bucketMaxSpanSeconds } } ]
+ */
+bson_value_t
+CreateTimeseriesViewPipeline(const TimeseriesOptions *options)
+{
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	pgbson_array_writer pipelineWriter;
+	PgbsonWriterStartArray(&writer, "pipeline", 8, &pipelineWriter);
+
+	pgbson_writer stageWriter;
+	PgbsonArrayWriterStartDocument(&pipelineWriter, &stageWriter);
+
+	pgbson_writer specWriter;
+	PgbsonWriterStartDocument(&stageWriter, "$_internalUnpackBucket", -1, &specWriter);
+	PgbsonWriterAppendUtf8(&specWriter, "timeField", 9, options->timeField);
+	if (options->metaField != NULL)
+	{
+		PgbsonWriterAppendUtf8(&specWriter, "metaField", 9, options->metaField);
+	}
+
+	PgbsonWriterAppendInt64(&specWriter, "bucketMaxSpanSeconds", 20,
+							options->bucketMaxSpanSeconds);
+	PgbsonWriterEndDocument(&stageWriter, &specWriter);
+
+	PgbsonArrayWriterEndDocument(&pipelineWriter, &stageWriter);
+	PgbsonWriterEndArray(&writer, &pipelineWriter);
+
+	bson_iter_t pipelineIter;
+	PgbsonInitIteratorAtPath(PgbsonWriterGetPgbson(&writer), "pipeline", &pipelineIter);
+	return *bson_iter_value(&pipelineIter);
+}
+
+
+/*
+ * Returns whether the collection is the view of a time-series collection,
+ * and if so its options.
+ */
+bool
+TryGetTimeseriesOptions(const MongoCollection *collection, TimeseriesOptions *options)
+{
+	if (collection == NULL || collection->viewDefinition == NULL)
+	{
+		return false;
+	}
+
+	ViewDefinition definition = { 0 };
+	DecomposeViewDefinition(collection->viewDefinition, &definition);
+	if (definition.viewSource == NULL ||
+		strncmp(definition.viewSource, TIMESERIES_BUCKETS_PREFIX,
+				TIMESERIES_BUCKETS_PREFIX_LENGTH) != 0 ||
+		definition.pipeline.value_type != BSON_TYPE_ARRAY)
+	{
+		return false;
+	}
+
+	bson_iter_t pipelineIter;
+	BsonValueInitIterator(&definition.pipeline, &pipelineIter);
+
+	pgbsonelement stageElement;
+	if (!bson_iter_next(&pipelineIter) || !BSON_ITER_HOLDS_DOCUMENT(&pipelineIter) ||
+		!TryGetBsonValueToPgbsonElement(bson_iter_value(&pipelineIter),
+										&stageElement) ||
+		strcmp(stageElement.path, "$_internalUnpackBucket") != 0 ||
+		bson_iter_next(&pipelineIter))
+	{
+		return false;
+	}
+
+	bool isCreateSpec = false;
+	ParseTimeseriesOptions(&stageElement.bsonValue, "$_internalUnpackBucket",
+						   isCreateSpec, options);
+	return true;
+}
+
+
+/*
+ * Inserts the measurements (bson_value_t * documents) into the buckets of a
+ * time-series collection. The measurements are grouped by their metaField
+ * and bucket window, and each group is upserted into a bucket of its window
+ * that has room for it. Returns the number of measurements inserted.
+ */
+uint64
+InsertTimeseriesMeasurements(MongoCollection *bucketsCollection,
+							 const TimeseriesOptions *options, List *measurements)
+{
+	int64 bucketSpanMs = options->bucketMaxSpanSeconds * 1000;
+	List *groups = NIL;
+
+	ListCell *cell;
+	foreach(cell, measurements)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		pgbson *measurement = RewriteDocumentValueAddObjectId(
+			(const bson_value_t *) lfirst(cell));
+		PgbsonValidateInputBson(measurement, BSON_VALIDATE_NONE);
+
+		bson_iter_t timeIter;
+		if (!PgbsonInitIteratorAtPath(measurement, options->timeField, &timeIter) ||
+			!BSON_ITER_HOLDS_DATE_TIME(&timeIter))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+							errmsg(
+								"'%s' must be present and contain a valid BSON UTC datetime value",
+								options->timeField)));
+		}
+
+		/* Round down, also for the times before the epoch */
+		int64 timeMs = bson_iter_date_time(&timeIter);
+		int64 bucketStartMs = timeMs - (timeMs % bucketSpanMs);
+		if (timeMs % bucketSpanMs < 0)
+		{
+			bucketStartMs -= bucketSpanMs;
+		}
+
+		bson_value_t meta = { 0 };
+		bson_iter_t metaIter;
+		if (options->metaField != NULL &&
+			PgbsonInitIteratorAtPath(measurement, options->metaField, &metaIter))
+		{
+			meta = *bson_iter_value(&metaIter);
+		}
+
+		TimeseriesBucketGroup *group = GetBucketGroup(&groups, &meta, bucketStartMs);
+		group->measurements = lappend(group->measurements, measurement);
+	}
+
+	foreach(cell, groups)
+	{
+		TimeseriesBucketGroup *group = lfirst(cell);
+		List *bucketMeasurements = NIL;
+
+		ListCell *measurementCell;
+		foreach(measurementCell, group->measurements)
+		{
+			bucketMeasurements = lappend(bucketMeasurements, lfirst(measurementCell));
+			if (list_length(bucketMeasurements) == TIMESERIES_BUCKET_MAX_COUNT)
+			{
+				UpsertTimeseriesBucket(bucketsCollection, options, group,
+									   bucketMeasurements);
+				bucketMeasurements = NIL;
+			}
+		}
+
+		if (bucketMeasurements != NIL)
+		{
+			UpsertTimeseriesBucket(bucketsCollection, options, group,
+								   bucketMeasurements);
+		}
+	}
+
+	return (uint64) list_length(measurements);
+}
+
+
+/*
+ * The time and meta fields are top level fields of the measurements.
+ */
+static void
+ValidateTimeseriesField(const char *fieldName, const char *fieldValue)
+{
+	if (strlen(fieldValue) == 0 || fieldValue[0] == '$' ||
+		strchr(fieldValue, '.') != NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg(
+							"The '%s' must be a non-empty top level field name that doesn't start with '$'",
+							fieldName)));
+	}
+
+	if (strcmp(fieldValue, "_id") == 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg("The '%s' cannot be \"_id\"", fieldName)));
+	}
+}
+
+
+static bool
+TimeseriesMetaEquals(const bson_value_t *left, const bson_value_t *right)
+{
+	if (left->value_type != right->value_type)
+	{
+		return false;
+	}
+
+	if (left->value_type == BSON_TYPE_EOD)
+	{
+		return true;
+	}
+
+	bool isComparisonValid = true;
+	return CompareBsonValueAndType(left, right, &isComparisonValid) == 0 &&
+		   isComparisonValid;
+}
+
+
+/*
+ * Returns the group of the measurements with the meta value in the bucket
+ * window, adding it if it's the first such measurement.
+ */
+static TimeseriesBucketGroup *
+GetBucketGroup(List **groups, const bson_value_t *meta, int64 bucketStartMs)
+{
+	ListCell *cell;
+	foreach(cell, *groups)
+	{
+		TimeseriesBucketGroup *group = lfirst(cell);
+		if (group->bucketStartMs == bucketStartMs &&
+			TimeseriesMetaEquals(&group->meta, meta))
+		{
+			return group;
+		}
+	}
+
+	TimeseriesBucketGroup *group = palloc0(sizeof(TimeseriesBucketGroup));
+	group->meta = *meta;
+	group->bucketStartMs = bucketStartMs;
+	*groups = lappend(*groups, group);
+	return group;
+}
+
+
+/*
+ * Adds the measurements to a bucket of the group's window that still has room
+ * for them, or to a new bucket. This is an upsert of the form
+ *
+ *    q: { meta: <meta>, "control.min.<time>": { $gte: <start> },
+ *         "control.max.<time>": { $lt: <end> }, "control.count": { $lte: <max - n> } }
+ *    u: { $push: { data: { $each: [ <measurements> ] } },
+ *         $min: { "control.min.<field>": <min>, ... },
+ *         $max: { "control.max.<field>": <max>, ... },
+ *         $inc: { "control.count": <n> } }
+ */
+static void
+UpsertTimeseriesBucket(MongoCollection *bucketsCollection,
+					   const TimeseriesOptions *options, TimeseriesBucketGroup *group,
+					   List *measurements)
+{
+	int measurementCount = list_length(measurements);
+	int64 bucketSpanMs = options->bucketMaxSpanSeconds * 1000;
+
+	pgbson_writer queryWriter;
+	PgbsonWriterInit(&queryWriter);
+	if (options->metaField != NULL)
+	{
+		if (group->meta.value_type == BSON_TYPE_EOD)
+		{
+			pgbson_writer existsWriter;
+			PgbsonWriterStartDocument(&queryWriter, TIMESERIES_BUCKET_META_FIELD, -1,
+									  &existsWriter);
+			PgbsonWriterAppendBool(&existsWriter, "$exists", 7, false);
+			PgbsonWriterEndDocument(&queryWriter, &existsWriter);
+		}
+		else
+		{
+			PgbsonWriterAppendValue(&queryWriter, TIMESERIES_BUCKET_META_FIELD, -1,
+									&group->meta);
+		}
+	}
+
+	bson_value_t boundValue = { .value_type = BSON_TYPE_DATE_TIME };
+	pgbson_writer boundWriter;
+	PgbsonWriterStartDocument(&queryWriter, psprintf("control.min.%s",
+													 options->timeField), -1,
+							  &boundWriter);
+	boundValue.value.v_datetime = group->bucketStartMs;
+	PgbsonWriterAppendValue(&boundWriter, "$gte", 4, &boundValue);
+	PgbsonWriterEndDocument(&queryWriter, &boundWriter);
+
+	PgbsonWriterStartDocument(&queryWriter, psprintf("control.max.%s",
+													 options->timeField), -1,
+							  &boundWriter);
+	boundValue.value.v_datetime = group->bucketStartMs + bucketSpanMs;
+	PgbsonWriterAppendValue(&boundWriter, "$lt", 3, &boundValue);
+	PgbsonWriterEndDocument(&queryWriter, &boundWriter);
+
+	PgbsonWriterStartDocument(&queryWriter, "control.count", -1, &boundWriter);
+	PgbsonWriterAppendInt32(&boundWriter, "$lte", 4,
+							TIMESERIES_BUCKET_MAX_COUNT - measurementCount);
+	PgbsonWriterEndDocument(&queryWriter, &boundWriter);
+
+	pgbson_writer updateWriter;
+	PgbsonWriterInit(&updateWriter);
+
+	/* The measurements are stored without their metaField, it's in the bucket */
+	pgbson_writer pushWriter;
+	PgbsonWriterStartDocument(&updateWriter, "$push", 5, &pushWriter);
+	pgbson_writer eachWriter;
+	PgbsonWriterStartDocument(&pushWriter, TIMESERIES_BUCKET_DATA_FIELD, -1,
+							  &eachWriter);
+	pgbson_array_writer dataWriter;
+	PgbsonWriterStartArray(&eachWriter, "$each", 5, &dataWriter);
+
+	ListCell *cell;
+	foreach(cell, measurements)
+	{
+		pgbson_writer measurementWriter;
+		PgbsonArrayWriterStartDocument(&dataWriter, &measurementWriter);
+
+		bson_iter_t measurementIter;
+		PgbsonInitIterator(lfirst(cell), &measurementIter);
+		while (bson_iter_next(&measurementIter))
+		{
+			if (options->metaField == NULL ||
+				strcmp(bson_iter_key(&measurementIter), options->metaField) != 0)
+			{
+				PgbsonWriterAppendIter(&measurementWriter, &measurementIter);
+			}
+		}
+
+		PgbsonArrayWriterEndDocument(&dataWriter, &measurementWriter);
+	}
+
+	PgbsonWriterEndArray(&eachWriter, &dataWriter);
+	PgbsonWriterEndDocument(&pushWriter, &eachWriter);
+	PgbsonWriterEndDocument(&updateWriter, &pushWriter);
+
+	List *fieldBounds = GetMeasurementFieldBounds(options, measurements);
+
+	pgbson_writer minWriter;
+	PgbsonWriterStartDocument(&updateWriter, "$min", 4, &minWriter);
+	foreach(cell, fieldBounds)
+	{
+		TimeseriesFieldBounds *bounds = lfirst(cell);
+		PgbsonWriterAppendValue(&minWriter, psprintf("control.min.%s", bounds->field),
+								-1, &bounds->min);
+	}
+	PgbsonWriterEndDocument(&updateWriter, &minWriter);
+
+	pgbson_writer maxWriter;
+	PgbsonWriterStartDocument(&updateWriter, "$max", 4, &maxWriter);
+	foreach(cell, fieldBounds)
+	{
+		TimeseriesFieldBounds *bounds = lfirst(cell);
+		PgbsonWriterAppendValue(&maxWriter, psprintf("control.max.%s", bounds->field),
+								-1, &bounds->max);
+	}
+	PgbsonWriterEndDocument(&updateWriter, &maxWriter);
+
+	pgbson_writer incWriter;
+	PgbsonWriterStartDocument(&updateWriter, "$inc", 4, &incWriter);
+	PgbsonWriterAppendInt32(&incWriter, "control.count", -1, measurementCount);
+	PgbsonWriterEndDocument(&updateWriter, &incWriter);
+
+	bson_value_t query = ConvertPgbsonToBsonValue(PgbsonWriterGetPgbson(&queryWriter));
+	bson_value_t update = ConvertPgbsonToBsonValue(
+		PgbsonWriterGetPgbson(&updateWriter));
+
+	int64 shardKeyHash = 0;
+	bool isShardKeyCollationAware = false;
+	if (!ComputeShardKeyHashForQueryValue(bucketsCollection->shardKey,
+										  bucketsCollection->collectionId, &query,
+										  &shardKeyHash, &isShardKeyCollationAware))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("Inserts into sharded time-series collections are "
+							   "not supported yet")));
+	}
+
+	UpdateOneParams updateOneParams = {
+		.query = &query,
+		.update = &update,
+		.isUpsert = true,
+		.sort = NULL,
+		.returnDocument = UPDATE_RETURNS_NONE,
+		.returnFields = NULL,
+		.arrayFilters = NULL,
+		.bypassDocumentValidation = true,
+		.variableSpec = NULL
+	};
+
+	/* The retry records are kept by the insert command itself */
+	text *transactionId = NULL;
+	bool forceInlineWrites = false;
+	ExprEvalState *evalState = NULL;
+	UpdateOneResult updateOneResult = { 0 };
+	UpdateOne(bucketsCollection, &updateOneParams, shardKeyHash, transactionId,
+			  &updateOneResult, forceInlineWrites, evalState);
+}
+
+
+/*
+ * Gets the smallest and largest value of every top level field of the
+ * measurements (other than the metaField), which are kept in the control
+ * field of the bucket to prune the buckets of queries.
+ */
+static List *
+GetMeasurementFieldBounds(const TimeseriesOptions *options, List *measurements)
+{
+	List *fieldBounds = NIL;
+
+	ListCell *cell;
+	foreach(cell, measurements)
+	{
+		bson_iter_t measurementIter;
+		PgbsonInitIterator(lfirst(cell), &measurementIter);
+		while (bson_iter_next(&measurementIter))
+		{
+			const char *key = bson_iter_key(&measurementIter);
+			if ((options->metaField != NULL && strcmp(key, options->metaField) == 0) ||
+				strchr(key, '.') != NULL)
+			{
+				continue;
+			}
+
+			const bson_value_t *value = bson_iter_value(&measurementIter);
+			TimeseriesFieldBounds *bounds = NULL;
+			ListCell *boundsCell;
+			foreach(boundsCell, fieldBounds)
+			{
+				TimeseriesFieldBounds *existing = lfirst(boundsCell);
+				if (strcmp(existing->field, key) == 0)
+				{
+					bounds = existing;
+					break;
+				}
+			}
+
+			if (bounds == NULL)
+			{
+				bounds = palloc0(sizeof(TimeseriesFieldBounds));
+				bounds->field = key;
+				bounds->min = *value;
+				bounds->max = *value;
+				fieldBounds = lappend(fieldBounds, bounds);
+				continue;
+			}
+
+			bool isComparisonValid = true;
+			if (CompareBsonValueAndType(value, &bounds->min, &isComparisonValid) < 0)
+			{
+				bounds->min = *value;
+			}
+
+			if (CompareBsonValueAndType(value, &bounds->max, &isComparisonValid) > 0)
+			{
+				bounds->max = *value;
+			}
+		}
+	}
+
+	return fieldBounds;
+}
@@ -86,6 +86,8 @@
 #include "metadata/collection.h"
 #include "metadata/metadata_cache.h"
 #include "infrastructure/documentdb_plan_cache.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/tailable_cursor_notifications.h"
 #include "query/query_operator.h"
 #include "sharding/sharding.h"
 #include "commands/retryable_writes.h"
@@ -97,6 +99,7 @@
 #include "schema_validation/schema_validation.h"
 
 #include "api_hooks.h"
+#include "infrastructure/wait_events.h"
 
 /* from tid.c */
 #define DatumGetItemPointer(X) ((ItemPointer) DatumGetPointer(X))
@@ -274,6 +277,8 @@ typedef struct
 
 extern bool UseLocalExecutionShardQueries;
 extern bool EnableVariablesSupportForWriteCommands;
+extern bool EnableSortedWritePlanCache;
+extern bool EnableUpsertInsertFirst;
 
 static BatchUpdateSpec * BuildBatchUpdateSpec(bson_iter_t *updateCommandIter,
 											  pgbsonsequence *updateDocs);
@@ -326,6 +331,10 @@ static void UpdateOneInternalWithRetryRecord(MongoCollection *collection, int64
 											 UpdateOneParams *updateOneParams,
 											 UpdateOneResult *result,
 											 ExprEvalState *stateForSchemaValidation);
+static bool TryInsertFirstForUpsert(MongoCollection *collection,
+									UpdateOneParams *updateOneParams,
+									int64 shardKeyHash, UpdateOneResult *result,
+									ExprEvalState *stateForSchemaValidation);
 static bool SelectUpdateCandidate(MongoCollection *collection, int64
 								  shardKeyHash, UpdateOneParams *updateOneParams,
 								  UpdateCandidate *updateCandidate,
@@ -452,6 +461,7 @@ command_update_bulk(PG_FUNCTION_ARGS)
 	HeapTuple resultTuple = PerformUpdateCore(databaseNameDatum, updateSpec, updateDocs,
 											  transactionId, resultTupDesc,
 											  isTransactional, stableContext);
+	ReportCommandLatency(CommandLatencyKind_Update);
 	PG_RETURN_DATUM(HeapTupleGetDatum(resultTuple));
 }
 
@@ -500,6 +510,7 @@ command_update(PG_FUNCTION_ARGS)
 	HeapTuple resultTuple = PerformUpdateCore(databaseNameDatum, updateSpec, updateDocs,
 											  transactionId, resultTupDesc,
 											  isTransactional, CurrentMemoryContext);
+	ReportCommandLatency(CommandLatencyKind_Update);
 	PG_RETURN_DATUM(HeapTupleGetDatum(resultTuple));
 }
 
@@ -519,6 +530,9 @@ PerformUpdateCore(Datum databaseNameDatum, pgbson *updateSpec,
 				  MemoryContext allocContext)
 {
 	ThrowIfServerOrTransactionReadOnly();
+	ReportCommandActivity("update", "update", DatumGetTextPP(databaseNameDatum),
+						  updateSpec);
+
 	bson_iter_t updateCommandIter;
 	PgbsonInitIterator(updateSpec, &updateCommandIter);
 
@@ -637,6 +651,9 @@ PerformUpdateCore(Datum databaseNameDatum, pgbson *updateSpec,
 		FreeExprEvalState(state, allocContext);
 	}
 
+	/* Wake up the tailable cursors awaiting data once the updates commit */
+	NotifyCollectionWriteOnCommit(collection->collectionId);
+
 	values[0] = PointerGetDatum(result);
 	values[1] = BoolGetDatum(!hasWriteErrors);
 	resultTuple = heap_form_tuple(resultTupDesc, values, isNulls);
@@ -787,6 +804,10 @@ BuildBatchUpdateSpec(bson_iter_t *updateCommandIter, pgbsonsequence *updateDocs)
 			SetExplicitStatementTimeout(BsonValueAsInt32(bson_iter_value(
 															 updateCommandIter)));
 		}
+		else if (strcmp(field, "writeConcern") == 0)
+		{
+			SetWriteConcernDurability(bson_iter_value(updateCommandIter));
+		}
 		else if (strcmp(field, "let") == 0)
 		{
 			ReportFeatureUsage(FEATURE_LET_TOP_LEVEL);
@@ -810,11 +831,7 @@ BuildBatchUpdateSpec(bson_iter_t *updateCommandIter, pgbsonsequence *updateDocs)
 		{
 			elog(DEBUG1, "Unrecognized command field: update.%s", field);
 
-			/*
-			 *  Silently ignore now, so that clients don't break
-			 *  TODO: implement me
-			 *      writeConcern
-			 */
+			/* Silently ignore now, so that clients don't break */
 		}
 		else
 		{
@@ -2213,10 +2230,13 @@ CallUpdateWorker(MongoCollection *collection, pgbson *serializedSpec,
 	int numResults = 1;
 
 	/* forceDelegation assumes nested distribution */
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_WorkerCall);
 	RunMultiValueQueryWithNestedDistribution(updateQuery, argCount, argTypes, argValues,
 											 argNulls,
 											 readOnly, SPI_OK_SELECT, resultDatum,
 											 isNulls, numResults);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
 
 	if (isNulls[0])
 	{
@@ -3101,6 +3121,13 @@ UpdateOneInternal(MongoCollection *collection, UpdateOneParams *updateOneParams,
 	result->resultDocument = NULL;
 	result->upsertedObjectId = NULL;
 
+	if (updateOneParams->isUpsert &&
+		TryInsertFirstForUpsert(collection, updateOneParams, shardKeyHash, result,
+								stateForSchemaValidation))
+	{
+		return;
+	}
+
 	UpdateCandidate updateCandidate = { 0 };
 
 	bool getExistingDoc = updateOneParams->returnDocument != UPDATE_RETURNS_NONE ||
@@ -3268,6 +3295,79 @@ UpdateOneInternal(MongoCollection *collection, UpdateOneParams *updateOneParams,
 }
 
 
+/*
+ * TryInsertFirstForUpsert handles an upsert with a plain { _id: <value> } filter
+ * by inserting the upserted document first, and returns whether it did. An
+ * existing document with the _id makes the insert a no-op on the primary key,
+ * in which case the update goes through the regular path. Upserts of new
+ * documents then cost a single probe of the primary key instead of a lookup
+ * followed by the insert.
+ */
+static bool
+TryInsertFirstForUpsert(MongoCollection *collection, UpdateOneParams *updateOneParams,
+						int64 shardKeyHash, UpdateOneResult *result,
+						ExprEvalState *stateForSchemaValidation)
+{
+	/*
+	 * Validation (and returning the old document) depend on whether a document
+	 * exists, leave those to the regular path.
+	 */
+	if (!EnableUpsertInsertFirst || stateForSchemaValidation != NULL ||
+		updateOneParams->returnDocument == UPDATE_RETURNS_OLD ||
+		updateOneParams->returnFields != NULL || updateOneParams->sort != NULL ||
+		updateOneParams->arrayFilters != NULL ||
+		updateOneParams->query->value_type != BSON_TYPE_DOCUMENT)
+	{
+		return false;
+	}
+
+	bson_iter_t queryIter;
+	BsonValueInitIterator(updateOneParams->query, &queryIter);
+	if (!bson_iter_next(&queryIter) || strcmp(bson_iter_key(&queryIter), "_id") != 0)
+	{
+		return false;
+	}
+
+	/* Only plain equality: skip operators, regexes and values that match missing fields */
+	bson_type_t idType = bson_iter_type(&queryIter);
+	if (idType == BSON_TYPE_DOCUMENT || idType == BSON_TYPE_ARRAY ||
+		idType == BSON_TYPE_REGEX || idType == BSON_TYPE_NULL ||
+		idType == BSON_TYPE_UNDEFINED || bson_iter_next(&queryIter))
+	{
+		return false;
+	}
+
+	pgbson *emptyDocument = PgbsonInitEmpty();
+	pgbson *newDoc = BsonUpdateDocument(emptyDocument, updateOneParams->update,
+										updateOneParams->query,
+										updateOneParams->arrayFilters,
+										updateOneParams->variableSpec);
+
+	int64 newShardKeyHash =
+		ComputeShardKeyHashForDocument(collection->shardKey,
+									   collection->collectionId, newDoc);
+	if (newShardKeyHash != shardKeyHash)
+	{
+		return false;
+	}
+
+	pgbson *objectId = PgbsonGetDocumentId(newDoc);
+	if (!InsertDocumentIfNotExists(collection->collectionId, collection->shardTableName,
+								   shardKeyHash, objectId, newDoc))
+	{
+		return false;
+	}
+
+	if (updateOneParams->returnDocument == UPDATE_RETURNS_NEW)
+	{
+		result->resultDocument = newDoc;
+	}
+
+	result->upsertedObjectId = objectId;
+	return true;
+}
+
+
 /*
  * SelectUpdateCandidate finds at most 1 document to update, locks the row,
  * writes the updated value of the document to updateCandidate (if no update happened it sets it to NULL),
@@ -3443,7 +3543,16 @@ SelectUpdateCandidate(MongoCollection *collection, int64 shardKeyHash,
 	/* set sort value */
 	if (list_length(sortFieldDocuments) > 0)
 	{
-		planId = 0;
+		/*
+		 * The sort only changes the query text by the number and directions of
+		 * the sort fields, so those select the cached plan (e.g. for findAndModify
+		 * claiming the first document of a queue).
+		 */
+		int sortFieldCount = list_length(sortFieldDocuments);
+		bool cacheSortedPlan = EnableSortedWritePlanCache &&
+							   sortFieldCount <= QUERY_SORT_VARIANT_MAX_FIELDS;
+		uint32 ascendingMask = 0;
+
 		appendStringInfoString(&updateQuery, " ORDER BY");
 
 		int sortItemSqlArgBaseIndex = nextSqlArgIndex;
@@ -3452,6 +3561,11 @@ SelectUpdateCandidate(MongoCollection *collection, int64 shardKeyHash,
 			int sqlArgNumber = i + sortItemSqlArgBaseIndex;
 			pgbson *sortDoc = list_nth(sortFieldDocuments, i);
 			bool isAscending = ValidateOrderbyExpressionAndGetIsAscending(sortDoc);
+			if (isAscending && i < QUERY_SORT_VARIANT_MAX_FIELDS)
+			{
+				ascendingMask |= (1 << i);
+			}
+
 			appendStringInfo(&updateQuery,
 							 "%s %s.bson_orderby(document, $%d::%s) %s",
 							 i > 0 ? "," : "", ApiCatalogSchemaName, sqlArgNumber,
@@ -3463,6 +3577,11 @@ SelectUpdateCandidate(MongoCollection *collection, int64 shardKeyHash,
 				PointerGetDatum(CastPgbsonToBytea(sortDoc));
 			argNulls[sqlArgNumber - 1] = ' ';
 		}
+
+		uint32 sortShape = 0;
+		planId = cacheSortedPlan ?
+				 GetSortedQueryVariantId(planId, sortFieldCount, ascendingMask,
+										 sortShape) : 0;
 	}
 
 	appendStringInfo(&updateQuery,
@@ -10,7 +10,9 @@
 
 /*
  * Currently this will only support validating the indexes. It'll only check
- * if the index is valid (checking the 'indisvalid' column in pg_index)
+ * if the index is valid (checking the 'indisvalid' column in pg_index).
+ * With full or sample, the documents of the collection are also checked to
+ * hold the _id they are stored under.
  */
 
 #include <postgres.h>
@@ -24,9 +26,13 @@
 #include "metadata/metadata_cache.h"
 #include "metadata/index.h"
 #include "utils/feature_counter.h"
+#include "utils/guc_utils.h"
 #include "utils/query_utils.h"
 #include "commands/parse_error.h"
 
+extern bool EnableValidateDocumentScan;
+extern int MaxValidateParallelWorkers;
+
 PG_FUNCTION_INFO_V1(command_validate);
 
 typedef struct
@@ -45,6 +51,12 @@ typedef struct
 
 	/* if ONLY metadata validation is required, currently a no-op */
 	bool metadata;
+
+	/*
+	 * The percent of the pages of the collection to check the documents of,
+	 * 0 when not sampling.
+	 */
+	double samplePercent;
 } ValidateSpec;
 
 typedef struct
@@ -58,6 +70,14 @@ typedef struct
 	/* Details of each index along with it's validity */
 	pgbson *indexDetailsPgbson;
 
+	/* Whether the documents were checked, and whether only a sample of them */
+	bool scannedDocuments;
+	bool sampledDocuments;
+
+	/* The number of documents checked, and how many of those were invalid */
+	int64 numRecords;
+	int64 numInvalidDocuments;
+
 	/* if true, the collection is valid */
 	bool isValid;
 
@@ -74,8 +94,11 @@ typedef struct
 	int32 ok;
 } ValidateResult;
 
-static void validateCollection(MongoCollection *collection, ValidateResult *result);
+static void validateCollection(MongoCollection *collection, ValidateSpec *spec,
+							   ValidateResult *result);
 static void CheckIndisvalid(uint64 collectionId, ValidateResult *result);
+static void CheckDocuments(uint64 collectionId, double samplePercent,
+						   ValidateResult *result);
 static pgbson * BuildResponseMessage(ValidateResult *result);
 
 /*
@@ -131,6 +154,17 @@ command_validate(PG_FUNCTION_ARGS)
 		{
 			validateSpec.metadata = BsonValueAsBool(value);
 		}
+		else if (StringViewEqualsCString(&keyView, "sample"))
+		{
+			EnsureTopLevelFieldIsNumberLike("validate.sample", value);
+			validateSpec.samplePercent = BsonValueAsDouble(value);
+			if (!(validateSpec.samplePercent > 0 && validateSpec.samplePercent <= 100))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"validate.sample must be a percent of pages greater than 0 and at most 100")));
+			}
+		}
 	}
 
 	if (validateSpec.collectionName == NULL || strlen(validateSpec.collectionName) == 0)
@@ -141,7 +175,8 @@ command_validate(PG_FUNCTION_ARGS)
 	}
 
 	/* Check that validate->metadata is not specified with validateSpec->full and validateSpec->repair */
-	if (validateSpec.metadata && (validateSpec.full || validateSpec.repair))
+	if (validateSpec.metadata && (validateSpec.full || validateSpec.repair ||
+								  validateSpec.samplePercent > 0))
 	{
 		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
 						errmsg(
@@ -178,12 +213,16 @@ command_validate(PG_FUNCTION_ARGS)
 	result.isValid = true;
 	result.isRepaired = false;
 	result.indexDetailsPgbson = NULL;
+	result.scannedDocuments = false;
+	result.sampledDocuments = false;
+	result.numRecords = 0;
+	result.numInvalidDocuments = 0;
 	result.warnings = NIL;
 	result.errors = NIL;
 	result.ok = 1;
 
 
-	validateCollection(collection, &result);
+	validateCollection(collection, &validateSpec, &result);
 	pgbson *response = BuildResponseMessage(&result);
 	PG_RETURN_POINTER(response);
 }
@@ -193,13 +232,20 @@ command_validate(PG_FUNCTION_ARGS)
  * validateCollection is the internal implementation for validating a collection.
  */
 static void
-validateCollection(MongoCollection *collection, ValidateResult *result)
+validateCollection(MongoCollection *collection, ValidateSpec *spec,
+				   ValidateResult *result)
 {
 	/* Validate indexes */
 
 	/* check the indisvalid column in pg_index */
 	CheckIndisvalid(collection->collectionId, result);
 
+	/* A sample takes precedence over full, so routine checks stay cheap */
+	if (EnableValidateDocumentScan && (spec->full || spec->samplePercent > 0))
+	{
+		CheckDocuments(collection->collectionId, spec->samplePercent, result);
+	}
+
 	/*
 	 * TODO Add further index validations here:
 	 * 1. Unique indexes must not have duplicate documents
@@ -311,6 +357,61 @@ CheckIndisvalid(uint64 collectionId, ValidateResult *result)
 }
 
 
+/*
+ * CheckDocuments checks that the documents of the collection hold the _id they are
+ * stored under. The full scan is planned as a parallel aggregate so the heap is
+ * split across up to MaxValidateParallelWorkers workers; the sample reads a random
+ * subset of the pages (TABLESAMPLE SYSTEM) instead.
+ */
+static void
+CheckDocuments(uint64 collectionId, double samplePercent, ValidateResult *result)
+{
+	StringInfo cmdStr = makeStringInfo();
+	appendStringInfo(cmdStr,
+					 "SELECT COUNT(*)::int8, COUNT(*) FILTER (WHERE "
+					 " %s.bson_get_value(document, '_id') IS NULL OR "
+					 " NOT (object_id OPERATOR(%s.=) %s.bson_get_value(document, '_id')))::int8 "
+					 " FROM %s.documents_" UINT64_FORMAT,
+					 CoreSchemaName, CoreSchemaName, CoreSchemaName,
+					 ApiDataSchemaName, collectionId);
+	if (samplePercent > 0)
+	{
+		appendStringInfo(cmdStr, " TABLESAMPLE SYSTEM (%g)", samplePercent);
+	}
+
+	/* The worker count is fixed when the query is planned inside SPI */
+	int savedGUCLevel = NewGUCNestLevel();
+	SetGUCLocally("max_parallel_workers_per_gather",
+				  psprintf("%d", MaxValidateParallelWorkers));
+
+	int numValues = 2;
+	Datum results[2] = { 0 };
+	bool isNulls[2] = { false, false };
+	bool readOnly = true;
+	ExtensionExecuteMultiValueQueryViaSPI(cmdStr->data, readOnly, SPI_OK_SELECT,
+										  results, isNulls, numValues);
+	RollbackGUCChange(savedGUCLevel);
+
+	result->scannedDocuments = true;
+	result->sampledDocuments = samplePercent > 0;
+	result->numRecords = isNulls[0] ? 0 : DatumGetInt64(results[0]);
+	result->numInvalidDocuments = isNulls[1] ? 0 : DatumGetInt64(results[1]);
+
+	if (result->numInvalidDocuments > 0)
+	{
+		result->isValid = false;
+		StringInfo error = makeStringInfo();
+		appendStringInfo(error,
+						 "Detected " INT64_FORMAT
+						 " document(s) whose _id does not match the _id they are stored under",
+						 result->numInvalidDocuments);
+		result->errors = lappend(result->errors, error);
+	}
+
+	pfree(cmdStr->data);
+}
+
+
 /*
  * Builds the pgbson response for the validate() command
  */
@@ -321,6 +422,14 @@ BuildResponseMessage(ValidateResult *result)
 	PgbsonWriterInit(&writer);
 
 	PgbsonWriterAppendUtf8(&writer, "ns", 2, result->ns);
+	if (result->scannedDocuments)
+	{
+		PgbsonWriterAppendInt64(&writer, "nrecords", 8, result->numRecords);
+		PgbsonWriterAppendInt64(&writer, "nInvalidDocuments", 17,
+								result->numInvalidDocuments);
+		PgbsonWriterAppendBool(&writer, "sampled", 7, result->sampledDocuments);
+	}
+
 	PgbsonWriterAppendInt64(&writer, "nIndexes", 8, result->totalIndexes);
 	PgbsonWriterAppendDocument(&writer, "indexDetails", 12, result->indexDetailsPgbson);
 	PgbsonWriterAppendBool(&writer, "valid", 5, result->isValid);
@@ -47,6 +47,30 @@ int TTLTaskMaxRunTimeInMS = DEFAULT_TTL_TASK_MAX_RUNTIME_IN_MS;
 #define DEFAULT_REPEAT_PURGE_INDEXES_FOR_TTL_TASK false
 bool RepeatPurgeIndexesForTTLTask = DEFAULT_REPEAT_PURGE_INDEXES_FOR_TTL_TASK;
 
+#define DEFAULT_MAX_INDEX_BUILD_REPLICATION_LAG_IN_SEC 0
+int MaxIndexBuildReplicationLagInSec = DEFAULT_MAX_INDEX_BUILD_REPLICATION_LAG_IN_SEC;
+
+#define DEFAULT_MAX_TTL_BATCHES_PER_SHARD 1
+int MaxTTLBatchesPerShard = DEFAULT_MAX_TTL_BATCHES_PER_SHARD;
+
+#define DEFAULT_TTL_PURGER_MAX_DELETES_PER_SECOND 0
+int TTLPurgerMaxDeletesPerSecond = DEFAULT_TTL_PURGER_MAX_DELETES_PER_SECOND;
+
+#define DEFAULT_RETRY_RECORD_RETENTION_SECONDS 0
+int RetryRecordRetentionSeconds = DEFAULT_RETRY_RECORD_RETENTION_SECONDS;
+
+#define DEFAULT_MAX_RETRY_RECORD_DELETE_BATCH_SIZE 10000
+int MaxRetryRecordDeleteBatchSize = DEFAULT_MAX_RETRY_RECORD_DELETE_BATCH_SIZE;
+
+#define DEFAULT_CLUSTERED_COLLECTION_MIN_CORRELATION 0.0
+double ClusteredCollectionMinCorrelation = DEFAULT_CLUSTERED_COLLECTION_MIN_CORRELATION;
+
+#define DEFAULT_VECTOR_SEARCH_CALIBRATION_SAMPLE_SIZE 0
+int VectorSearchCalibrationSampleSize = DEFAULT_VECTOR_SEARCH_CALIBRATION_SAMPLE_SIZE;
+
+#define DEFAULT_DEFERRED_DROP_MAX_RELATIONS_PER_RUN 0
+int DeferredDropMaxRelationsPerRun = DEFAULT_DEFERRED_DROP_MAX_RELATIONS_PER_RUN;
+
 #define DEFAULT_ENABLE_BG_WORKER false
 bool EnableBackgroundWorker = DEFAULT_ENABLE_BG_WORKER;
 
@@ -56,6 +80,9 @@ bool EnableBackgroundWorkerJobs = DEFAULT_ENABLE_BG_WORKER_JOBS;
 #define DEFAULT_BG_WORKER_JOB_TIMEOUT_THRESHOLD_SEC 300
 int BackgroundWorkerJobTimeoutThresholdSec = DEFAULT_BG_WORKER_JOB_TIMEOUT_THRESHOLD_SEC;
 
+#define DEFAULT_BG_WORKER_MAX_CONCURRENT_JOBS 4
+int BackgroundWorkerMaxConcurrentJobs = DEFAULT_BG_WORKER_MAX_CONCURRENT_JOBS;
+
 #define DEFAULT_BG_DATABASE_NAME "postgres"
 char *BackgroundWorkerDatabaseName = DEFAULT_BG_DATABASE_NAME;
 
@@ -151,6 +178,83 @@ InitializeBackgroundJobConfigurations(const char *prefix, const char *newGucPref
 		0,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		psprintf("%s.maxTTLBatchesPerShard", newGucPrefix),
+		gettext_noop(
+			"The max number of consecutive full batches the TTL task deletes from a shard before moving to the next one."),
+		NULL,
+		&MaxTTLBatchesPerShard,
+		DEFAULT_MAX_TTL_BATCHES_PER_SHARD, 1, INT_MAX,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.TTLPurgerMaxDeletesPerSecond", newGucPrefix),
+		gettext_noop(
+			"The max rate of documents deleted per second by a TTL task invocation. 0 means unlimited."),
+		NULL,
+		&TTLPurgerMaxDeletesPerSecond,
+		DEFAULT_TTL_PURGER_MAX_DELETES_PER_SECOND, 0, INT_MAX,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.retryRecordRetentionSeconds", newGucPrefix),
+		gettext_noop(
+			"The age in seconds after which the background worker deletes the retry records of retryable writes. 0 keeps them until the collection is dropped."),
+		NULL,
+		&RetryRecordRetentionSeconds,
+		DEFAULT_RETRY_RECORD_RETENTION_SECONDS, 0, INT_MAX / 1000,
+		PGC_SUSET,
+		GUC_UNIT_S,
+		NULL, NULL, NULL);
+
+	DefineCustomRealVariable(
+		psprintf("%s.clusteredCollectionMinCorrelation", newGucPrefix),
+		gettext_noop(
+			"The correlation between the physical and the _id order of a clustered collection below which the background worker reclusters it. 0 never reclusters."),
+		NULL,
+		&ClusteredCollectionMinCorrelation,
+		DEFAULT_CLUSTERED_COLLECTION_MIN_CORRELATION, 0, 1,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.vectorSearchCalibrationSampleSize", newGucPrefix),
+		gettext_noop(
+			"The number of sampled vectors the background worker queries to calibrate the search parameters of a vector index for target recalls. 0 never calibrates."),
+		NULL,
+		&VectorSearchCalibrationSampleSize,
+		DEFAULT_VECTOR_SEARCH_CALIBRATION_SAMPLE_SIZE, 0, 10000,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.deferredDropMaxRelationsPerRun", newGucPrefix),
+		gettext_noop(
+			"The max number of relations of dropped collections and indexes that the background worker removes per run. 0 drops them synchronously."),
+		NULL,
+		&DeferredDropMaxRelationsPerRun,
+		DEFAULT_DEFERRED_DROP_MAX_RELATIONS_PER_RUN, 0, 1000,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.maxRetryRecordDeleteBatchSize", newGucPrefix),
+		gettext_noop(
+			"The max number of expired retry records deleted from a collection per invocation of the pruning task."),
+		NULL,
+		&MaxRetryRecordDeleteBatchSize,
+		DEFAULT_MAX_RETRY_RECORD_DELETE_BATCH_SIZE, 1, INT_MAX,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		psprintf("%s.TTLPurgerLockTimeout", prefix),
 		gettext_noop(
@@ -181,6 +285,16 @@ InitializeBackgroundJobConfigurations(const char *prefix, const char *newGucPref
 		0,
 		NULL, NULL, NULL);
 
+	DefineCustomIntVariable(
+		psprintf("%s.maxIndexBuildReplicationLagInSec", newGucPrefix),
+		gettext_noop(
+			"Replication lag in seconds above which background index builds wait for the replicas to catch up. 0 disables the check."),
+		NULL, &MaxIndexBuildReplicationLagInSec,
+		DEFAULT_MAX_INDEX_BUILD_REPLICATION_LAG_IN_SEC, 0, INT_MAX,
+		PGC_SUSET,
+		0,
+		NULL, NULL, NULL);
+
 	DefineCustomIntVariable(
 		psprintf("%s.indexBuildScheduleInSec", prefix),
 		gettext_noop("The index build cron-job schedule in seconds."),
@@ -221,6 +335,16 @@ InitializeBackgroundJobConfigurations(const char *prefix, const char *newGucPref
 		PGC_USERSET,
 		0,
 		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.backgroundWorkerMaxConcurrentJobs", newGucPrefix),
+		gettext_noop(
+			"Maximum number of background worker job executions that run at the same time."),
+		NULL, &BackgroundWorkerMaxConcurrentJobs,
+		DEFAULT_BG_WORKER_MAX_CONCURRENT_JOBS, 1, 64,
+		PGC_SIGHUP,
+		0,
+		NULL, NULL, NULL);
 }
 
 
@@ -22,6 +22,10 @@
 bool EnableSchemaValidation =
 	DEFAULT_ENABLE_SCHEMA_VALIDATION;
 
+#define DEFAULT_ENABLE_COLLECTION_DOCUMENT_COMPRESSION false
+bool EnableCollectionDocumentCompression =
+	DEFAULT_ENABLE_COLLECTION_DOCUMENT_COMPRESSION;
+
 #define DEFAULT_ENABLE_BYPASSDOCUMENTVALIDATION false
 bool EnableBypassDocumentValidation =
 	DEFAULT_ENABLE_BYPASSDOCUMENTVALIDATION;
@@ -150,6 +154,210 @@ bool UseLegacyForcePushdownBehavior = DEFAULT_USE_LEGACY_FORCE_PUSHDOWN_BEHAVIOR
 #define DEFAULT_ENABLE_DELAYED_HOLD_PORTAL true
 bool EnableDelayedHoldPortal = DEFAULT_ENABLE_DELAYED_HOLD_PORTAL;
 
+#define DEFAULT_ENABLE_DOCUMENT_FIELD_DIRECTORY true
+bool EnableDocumentFieldDirectory = DEFAULT_ENABLE_DOCUMENT_FIELD_DIRECTORY;
+
+#define DEFAULT_ENABLE_DECIMAL128_SUM_FAST_PATH true
+bool EnableDecimal128SumFastPath = DEFAULT_ENABLE_DECIMAL128_SUM_FAST_PATH;
+
+#define DEFAULT_ENABLE_STREAMING_SEQUENCE_INSERT true
+bool EnableStreamingSequenceInsert = DEFAULT_ENABLE_STREAMING_SEQUENCE_INSERT;
+
+#define DEFAULT_ENABLE_COMPILED_QUERY_PREDICATES true
+bool EnableCompiledQueryPredicates = DEFAULT_ENABLE_COMPILED_QUERY_PREDICATES;
+
+#define DEFAULT_ENABLE_BATCH_PREDICATE_EVALUATION true
+bool EnableBatchPredicateEvaluation = DEFAULT_ENABLE_BATCH_PREDICATE_EVALUATION;
+
+#define DEFAULT_ENABLE_AGGREGATION_EXPRESSION_OPTIMIZATION true
+bool EnableAggregationExpressionOptimization =
+	DEFAULT_ENABLE_AGGREGATION_EXPRESSION_OPTIMIZATION;
+
+#define DEFAULT_ENABLE_TIMEZONE_OFFSET_WINDOW_CACHE true
+bool EnableTimezoneOffsetWindowCache = DEFAULT_ENABLE_TIMEZONE_OFFSET_WINDOW_CACHE;
+
+#define DEFAULT_ENABLE_ASCII_STRING_FAST_PATHS true
+bool EnableAsciiStringFastPaths = DEFAULT_ENABLE_ASCII_STRING_FAST_PATHS;
+
+#define DEFAULT_ENABLE_EXPRESSION_EVALUATION_ARENA true
+bool EnableExpressionEvaluationArena = DEFAULT_ENABLE_EXPRESSION_EVALUATION_ARENA;
+
+#define DEFAULT_ENABLE_GROUP_HASH_AGGREGATION false
+bool EnableGroupHashAggregation = DEFAULT_ENABLE_GROUP_HASH_AGGREGATION;
+
+#define DEFAULT_ENABLE_PARALLEL_GROUP_ACCUMULATORS false
+bool EnableParallelGroupAccumulators = DEFAULT_ENABLE_PARALLEL_GROUP_ACCUMULATORS;
+
+#define DEFAULT_ENABLE_SORT_LIMIT_PROJECTION_DEFERRAL false
+bool EnableSortLimitProjectionDeferral = DEFAULT_ENABLE_SORT_LIMIT_PROJECTION_DEFERRAL;
+
+#define DEFAULT_ENABLE_LOOKUP_MEMOIZED_JOIN false
+bool EnableLookupMemoizedJoin = DEFAULT_ENABLE_LOOKUP_MEMOIZED_JOIN;
+
+#define DEFAULT_ENABLE_GRAPH_LOOKUP_TRAVERSAL false
+bool EnableGraphLookupTraversal = DEFAULT_ENABLE_GRAPH_LOOKUP_TRAVERSAL;
+
+#define DEFAULT_ENABLE_FACET_SHARED_INPUT true
+bool EnableFacetSharedInput = DEFAULT_ENABLE_FACET_SHARED_INPUT;
+
+#define DEFAULT_ENABLE_UNWIND_GROUP_FUSION false
+bool EnableUnwindGroupFusion = DEFAULT_ENABLE_UNWIND_GROUP_FUSION;
+
+#define DEFAULT_ENABLE_BUCKET_AUTO_APPROXIMATE_BOUNDARIES false
+bool EnableBucketAutoApproximateBoundaries =
+	DEFAULT_ENABLE_BUCKET_AUTO_APPROXIMATE_BOUNDARIES;
+
+#define DEFAULT_ENABLE_STREAMING_DENSIFY false
+bool EnableStreamingDensify = DEFAULT_ENABLE_STREAMING_DENSIFY;
+
+#define DEFAULT_ENABLE_BSON_COUNT_AGGREGATE false
+bool EnableBsonCountAggregate = DEFAULT_ENABLE_BSON_COUNT_AGGREGATE;
+
+#define DEFAULT_ENABLE_INDEX_ONLY_SCAN_FOR_DISTINCT false
+bool EnableIndexOnlyScanForDistinct = DEFAULT_ENABLE_INDEX_ONLY_SCAN_FOR_DISTINCT;
+
+#define DEFAULT_ENABLE_OUT_INSERT_SELECT false
+bool EnableOutInsertSelect = DEFAULT_ENABLE_OUT_INSERT_SELECT;
+
+#define DEFAULT_ENABLE_PROJECTION_RAW_FIELD_COPY false
+bool EnableProjectionRawFieldCopy = DEFAULT_ENABLE_PROJECTION_RAW_FIELD_COPY;
+
+#define DEFAULT_ENABLE_ADD_FIELDS_APPEND_FAST_PATH false
+bool EnableAddFieldsAppendFastPath = DEFAULT_ENABLE_ADD_FIELDS_APPEND_FAST_PATH;
+
+#define DEFAULT_ENABLE_PIPELINE_STAGE_REWRITES false
+bool EnablePipelineStageRewrites = DEFAULT_ENABLE_PIPELINE_STAGE_REWRITES;
+
+#define DEFAULT_ENABLE_APPROX_COUNT_DISTINCT false
+bool EnableApproxCountDistinct = DEFAULT_ENABLE_APPROX_COUNT_DISTINCT;
+
+#define DEFAULT_ENABLE_FLAT_UNION_WITH_APPEND false
+bool EnableFlatUnionWithAppend = DEFAULT_ENABLE_FLAT_UNION_WITH_APPEND;
+
+#define DEFAULT_ENABLE_EXACT_PERCENTILE false
+bool EnableExactPercentile = DEFAULT_ENABLE_EXACT_PERCENTILE;
+
+#define DEFAULT_ENABLE_GROUP_FIRST_ROW_PER_GROUP false
+bool EnableGroupFirstRowPerGroup = DEFAULT_ENABLE_GROUP_FIRST_ROW_PER_GROUP;
+
+#define DEFAULT_ENABLE_INDEX_ONLY_SCAN_FOR_PROJECTION false
+bool EnableIndexOnlyScanForProjection = DEFAULT_ENABLE_INDEX_ONLY_SCAN_FOR_PROJECTION;
+
+#define DEFAULT_ENABLE_COMPOSITE_INDEX_SKIP_SCAN false
+bool EnableCompositeIndexSkipScan = DEFAULT_ENABLE_COMPOSITE_INDEX_SKIP_SCAN;
+
+#define DEFAULT_ENABLE_COMPACT_WILDCARD_PROJECTION_TERMS false
+bool EnableCompactWildcardProjectionTerms =
+	DEFAULT_ENABLE_COMPACT_WILDCARD_PROJECTION_TERMS;
+
+#define DEFAULT_ENABLE_NATIVE_HASH_INDEX false
+bool EnableNativeHashIndex = DEFAULT_ENABLE_NATIVE_HASH_INDEX;
+
+#define DEFAULT_ENABLE_ORDERED_INDEX_SCAN_STARTUP_COST false
+bool EnableOrderedIndexScanStartupCost = DEFAULT_ENABLE_ORDERED_INDEX_SCAN_STARTUP_COST;
+
+#define DEFAULT_ENABLE_GEOSPATIAL_POINT_FAST_PATH true
+bool EnableGeospatialPointFastPath = DEFAULT_ENABLE_GEOSPATIAL_POINT_FAST_PATH;
+
+#define DEFAULT_ENABLE_RANK_FUSION_STAGE true
+bool EnableRankFusionStage = DEFAULT_ENABLE_RANK_FUSION_STAGE;
+
+#define DEFAULT_ENABLE_INDEX_STATS_USAGE_DETAILS false
+bool EnableIndexStatsUsageDetails = DEFAULT_ENABLE_INDEX_STATS_USAGE_DETAILS;
+
+#define DEFAULT_ENABLE_HASHED_TRUNCATED_INDEX_TERMS false
+bool EnableHashedTruncatedIndexTerms = DEFAULT_ENABLE_HASHED_TRUNCATED_INDEX_TERMS;
+
+#define DEFAULT_ENABLE_QUERY_SHAPE_CACHE false
+bool EnableQueryShapeCache = DEFAULT_ENABLE_QUERY_SHAPE_CACHE;
+
+#define DEFAULT_ENABLE_DIRECT_POINT_READS false
+bool EnableDirectPointReads = DEFAULT_ENABLE_DIRECT_POINT_READS;
+
+#define DEFAULT_ENABLE_PARALLEL_QUERY_PLANS false
+bool EnableParallelQueryPlans = DEFAULT_ENABLE_PARALLEL_QUERY_PLANS;
+
+#define DEFAULT_ENABLE_DOLLAR_OPERATOR_COST_MODEL false
+bool EnableDollarOperatorCostModel = DEFAULT_ENABLE_DOLLAR_OPERATOR_COST_MODEL;
+
+#define DEFAULT_ENABLE_KEYSET_CURSOR_CONTINUATION false
+bool EnableKeysetCursorContinuation = DEFAULT_ENABLE_KEYSET_CURSOR_CONTINUATION;
+
+#define DEFAULT_ENABLE_OR_BRANCH_SORT_MERGE false
+bool EnableOrBranchSortMerge = DEFAULT_ENABLE_OR_BRANCH_SORT_MERGE;
+
+#define DEFAULT_ENABLE_ADAPTIVE_INDEX_SCAN false
+bool EnableAdaptiveIndexScan = DEFAULT_ENABLE_ADAPTIVE_INDEX_SCAN;
+
+#define DEFAULT_ENABLE_CURSOR_FILE_COMPRESSION false
+bool EnableCursorFileCompression = DEFAULT_ENABLE_CURSOR_FILE_COMPRESSION;
+
+#define DEFAULT_ENABLE_COMPACT_CURSOR_CONTINUATION false
+bool EnableCompactCursorContinuation = DEFAULT_ENABLE_COMPACT_CURSOR_CONTINUATION;
+
+#define DEFAULT_ENABLE_MULTI_ROW_HEAP_INSERT false
+bool EnableMultiRowHeapInsert = DEFAULT_ENABLE_MULTI_ROW_HEAP_INSERT;
+
+#define DEFAULT_ENABLE_UPDATE_SPEC_CACHE false
+bool EnableUpdateSpecCache = DEFAULT_ENABLE_UPDATE_SPEC_CACHE;
+
+#define DEFAULT_ENABLE_BATCH_DELETE_BY_OBJECT_IDS false
+bool EnableBatchDeleteByObjectIds = DEFAULT_ENABLE_BATCH_DELETE_BY_OBJECT_IDS;
+
+#define DEFAULT_ENABLE_SORTED_WRITE_PLAN_CACHE false
+bool EnableSortedWritePlanCache = DEFAULT_ENABLE_SORTED_WRITE_PLAN_CACHE;
+
+#define DEFAULT_ENABLE_RELAXED_DURABILITY_WRITE_CONCERN false
+bool EnableRelaxedDurabilityWriteConcern = DEFAULT_ENABLE_RELAXED_DURABILITY_WRITE_CONCERN;
+
+#define DEFAULT_ENABLE_INSERT_SUB_BATCH_RETRY false
+bool EnableInsertSubBatchRetry = DEFAULT_ENABLE_INSERT_SUB_BATCH_RETRY;
+
+#define DEFAULT_ENABLE_UPSERT_INSERT_FIRST false
+bool EnableUpsertInsertFirst = DEFAULT_ENABLE_UPSERT_INSERT_FIRST;
+
+#define DEFAULT_ENABLE_COLLECTION_CATALOG_PLAN_CACHE false
+bool EnableCollectionCatalogPlanCache = DEFAULT_ENABLE_COLLECTION_CATALOG_PLAN_CACHE;
+
+#define DEFAULT_ENABLE_LIST_COLLECTIONS_NAME_PUSHDOWN false
+bool EnableListCollectionsNamePushdown = DEFAULT_ENABLE_LIST_COLLECTIONS_NAME_PUSHDOWN;
+
+#define DEFAULT_ENABLE_COMMAND_ACTIVITY_REGISTRY false
+bool EnableCommandActivityRegistry = DEFAULT_ENABLE_COMMAND_ACTIVITY_REGISTRY;
+
+#define DEFAULT_ENABLE_COMMAND_LATENCY_HISTOGRAMS false
+bool EnableCommandLatencyHistograms = DEFAULT_ENABLE_COMMAND_LATENCY_HISTOGRAMS;
+
+#define DEFAULT_ENABLE_ONLINE_COMPACT false
+bool EnableOnlineCompact = DEFAULT_ENABLE_ONLINE_COMPACT;
+
+#define DEFAULT_ENABLE_VALIDATE_DOCUMENT_SCAN false
+bool EnableValidateDocumentScan = DEFAULT_ENABLE_VALIDATE_DOCUMENT_SCAN;
+
+#define DEFAULT_ENABLE_SLOW_OPERATION_LOG false
+bool EnableSlowOperationLog = DEFAULT_ENABLE_SLOW_OPERATION_LOG;
+
+#define DEFAULT_ENABLE_COLLECTION_JOIN_STATS false
+bool EnableCollectionJoinStats = DEFAULT_ENABLE_COLLECTION_JOIN_STATS;
+
+#define DEFAULT_ENABLE_QUERY_SHAPE_STATS false
+bool EnableQueryShapeStats = DEFAULT_ENABLE_QUERY_SHAPE_STATS;
+
+#define DEFAULT_ENABLE_BATCH_SHARD_KEY_HASHING true
+bool EnableBatchShardKeyHashing = DEFAULT_ENABLE_BATCH_SHARD_KEY_HASHING;
+
+#define DEFAULT_ENABLE_COLUMNAR_PROJECTION_STORE false
+bool EnableColumnarProjectionStore = DEFAULT_ENABLE_COLUMNAR_PROJECTION_STORE;
+
+#define DEFAULT_ENABLE_CLUSTERED_COLLECTIONS false
+bool EnableClusteredCollections = DEFAULT_ENABLE_CLUSTERED_COLLECTIONS;
+
+#define DEFAULT_ENABLE_CUSTOM_WAIT_EVENTS true
+bool EnableCustomWaitEvents = DEFAULT_ENABLE_CUSTOM_WAIT_EVENTS;
+
+#define DEFAULT_ENABLE_TAILABLE_CURSOR_AWAIT_DATA true
+bool EnableTailableCursorAwaitData = DEFAULT_ENABLE_TAILABLE_CURSOR_AWAIT_DATA;
+
 
 /*
  * SECTION: Let support feature flags
@@ -220,42 +428,42 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 		gettext_noop(
 			"Enables support for HNSW index type and query for vector search in bson documents index."),
 		NULL, &EnableVectorHNSWIndex, DEFAULT_ENABLE_VECTOR_HNSW_INDEX,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableVectorPreFilter", prefix),
 		gettext_noop(
 			"Enables support for vector pre-filtering feature for vector search in bson documents index."),
 		NULL, &EnableVectorPreFilter, DEFAULT_ENABLE_VECTOR_PRE_FILTER,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableVectorPreFilterV2", prefix),
 		gettext_noop(
 			"Enables support for vector pre-filtering v2 feature for vector search in bson documents index."),
 		NULL, &EnableVectorPreFilterV2, DEFAULT_ENABLE_VECTOR_PRE_FILTER_V2,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enable_force_push_vector_index", prefix),
 		gettext_noop(
 			"Enables ensuring that vector index queries are always pushed to the vector index."),
 		NULL, &EnableVectorForceIndexPushdown, DEFAULT_ENABLE_VECTOR_FORCE_INDEX_PUSHDOWN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableVectorCompressionHalf", newGucPrefix),
 		gettext_noop(
 			"Enables support for vector index compression half"),
 		NULL, &EnableVectorCompressionHalf, DEFAULT_ENABLE_VECTOR_COMPRESSION_HALF,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableVectorCompressionPQ", newGucPrefix),
 		gettext_noop(
 			"Enables support for vector index compression product quantization"),
 		NULL, &EnableVectorCompressionPQ, DEFAULT_ENABLE_VECTOR_COMPRESSION_PQ,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableVectorCalculateDefaultSearchParam", newGucPrefix),
@@ -263,7 +471,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Enables support for vector index default search parameter calculation"),
 		NULL, &EnableVectorCalculateDefaultSearchParameter,
 		DEFAULT_ENABLE_VECTOR_CALCULATE_DEFAULT_SEARCH_PARAM,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableNewSelectivityMode", newGucPrefix),
@@ -271,7 +479,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Determines whether to use the new selectivity logic."),
 		NULL, &EnableNewOperatorSelectivityMode,
 		DEFAULT_ENABLE_NEW_OPERATOR_SELECTIVITY,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.disableDollarSupportFuncSelectivity", newGucPrefix),
@@ -279,7 +487,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Disables the selectivity calculation for dollar support functions - override on top of enableNewSelectivityMode."),
 		NULL, &DisableDollarSupportFuncSelectivity,
 		DEFAULT_DISABLE_DOLLAR_FUNCTION_SELECTIVITY,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableRumIndexScan", newGucPrefix),
@@ -290,7 +498,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 		DEFAULT_ENABLE_RUM_INDEX_SCAN,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableSchemaValidation", prefix),
@@ -301,7 +509,18 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 		DEFAULT_ENABLE_SCHEMA_VALIDATION,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCollectionDocumentCompression", prefix),
+		gettext_noop(
+			"Whether or not to support the documentCompression option on create and collMod."),
+		NULL,
+		&EnableCollectionDocumentCompression,
+		DEFAULT_ENABLE_COLLECTION_DOCUMENT_COMPRESSION,
+		PGC_USERSET,
+		0,
+		NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableBypassDocumentValidation", prefix),
@@ -312,21 +531,21 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 		DEFAULT_ENABLE_BYPASSDOCUMENTVALIDATION,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.recreate_retry_table_on_shard", prefix),
 		gettext_noop(
 			"Gets whether or not to recreate a retry table to match the main table"),
 		NULL, &RecreateRetryTableOnSharding, DEFAULT_RECREATE_RETRY_TABLE_ON_SHARDING,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.skipFailOnCollation", newGucPrefix),
 		gettext_noop(
 			"Determines whether we can skip failing when collation is specified but collation is not supported"),
 		NULL, &SkipFailOnCollation, DEFAULT_SKIP_FAIL_ON_COLLATION,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableLookupIdJoinOptimizationOnCollation", newGucPrefix),
@@ -334,7 +553,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Determines whether we can perform _id join opetimization on collation. It would be a customer input confiriming that _id does not contain collation aware data types (i.e., UTF8 and DOCUMENT)."),
 		NULL, &EnableLookupIdJoinOptimizationOnCollation,
 		DEFAULT_ENABLE_LOOKUP_ID_JOIN_OPTIMIZATION_ON_COLLATION,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableNowSystemVariable", newGucPrefix),
@@ -342,7 +561,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Enables support for the $$NOW time system variable."),
 		NULL, &EnableNowSystemVariable,
 		DEFAULT_ENABLE_NOW_SYSTEM_VARIABLE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableLetAndCollationForQueryMatch", newGucPrefix),
@@ -350,7 +569,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to enable collation and let for query match."),
 		NULL, &EnableLetAndCollationForQueryMatch,
 		DEFAULT_ENABLE_LET_AND_COLLATION_FOR_QUERY_MATCH,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableVariablesSupportForWriteCommands", newGucPrefix),
@@ -358,7 +577,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to enable let variables and $$NOW support for write (update, delete, findAndModify) commands. Only support for delete is available now."),
 		NULL, &EnableVariablesSupportForWriteCommands,
 		DEFAULT_ENABLE_VARIABLES_SUPPORT_FOR_WRITE_COMMANDS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enablePrimaryKeyCursorScan", newGucPrefix),
@@ -366,7 +585,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to enable primary key cursor scan for streaming cursors."),
 		NULL, &EnablePrimaryKeyCursorScan,
 		DEFAULT_ENABLE_PRIMARY_KEY_CURSOR_SCAN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableUsernamePasswordConstraints", newGucPrefix),
@@ -374,7 +593,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Determines whether username and password constraints are enabled."),
 		NULL, &EnableUsernamePasswordConstraints,
 		DEFAULT_ENABLE_USERNAME_PASSWORD_CONSTRAINTS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableDataTableWithoutCreationTime", newGucPrefix),
@@ -382,7 +601,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Create data table without creation_time column."),
 		NULL, &EnableDataTableWithoutCreationTime,
 		DEFAULT_ENABLE_DATA_TABLES_WITHOUT_CREATION_TIME,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableMultipleIndexBuildsPerRun", newGucPrefix),
@@ -399,7 +618,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to use file based persisted cursors."),
 		NULL, &UseFileBasedPersistedCursors,
 		DEFAULT_USE_FILE_BASED_PERSISTED_CURSORS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableCompact", newGucPrefix),
@@ -407,7 +626,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to enable compact command."),
 		NULL, &EnableCompact,
 		DEFAULT_ENABLE_COMPACT_COMMAND,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableUsersInfoPrivileges", newGucPrefix),
@@ -415,7 +634,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Determines whether the usersInfo command returns privileges."),
 		NULL, &EnableUsersInfoPrivileges,
 		DEFAULT_ENABLE_USERS_INFO_PRIVILEGES,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.isNativeAuthEnabled", newGucPrefix),
@@ -423,7 +642,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Determines whether native authentication is enabled."),
 		NULL, &IsNativeAuthEnabled,
 		DEFAULT_ENABLE_NATIVE_AUTHENTICATION,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.useLegacyNullEqualityBehavior", newGucPrefix),
@@ -431,7 +650,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to use legacy null equality behavior."),
 		NULL, &UseLegacyNullEqualityBehavior,
 		DEFAULT_USE_LEGACY_NULL_EQUALITY_BEHAVIOR,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.useNewElemMatchIndexPushdown", newGucPrefix),
@@ -439,7 +658,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to use the new elemMatch index pushdown logic."),
 		NULL, &UseNewElemMatchIndexPushdown,
 		DEFAULT_USE_NEW_ELEMMATCH_INDEX_PUSHDOWN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableLookupInnerJoin", newGucPrefix),
@@ -447,7 +666,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to enable lookup inner join."),
 		NULL, &EnableLookupInnerJoin,
 		DEFAULT_LOOKUP_ENABLE_INNER_JOIN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceBitmapScanForLookup", newGucPrefix),
@@ -455,7 +674,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to force bitmap scan for lookup."),
 		NULL, &ForceBitmapScanForLookup,
 		DEFAULT_FORCE_BITMAP_SCAN_FOR_LOOKUP,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.lowSelectivityForLookup", newGucPrefix),
@@ -463,7 +682,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to use low selectivity for lookup."),
 		NULL, &LowSelectivityForLookup,
 		DEFAULT_LOW_SELECTIVITY_FOR_LOOKUP,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableBucketAutoStage", newGucPrefix),
@@ -471,7 +690,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether to enable the $bucketAuto stage."),
 		NULL, &EnableBucketAutoStage,
 		DEFAULT_ENABLE_BUCKET_AUTO_STAGE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableInsertCustomPlan", newGucPrefix),
@@ -479,21 +698,21 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether to use custom insert plan for insert commands."),
 		NULL, &EnableInsertCustomPlan,
 		DEFAULT_ENABLE_INSERT_CUSTOM_PLAN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.defaultUseCompositeOpClass", newGucPrefix),
 		gettext_noop(
 			"Whether to enable the new experimental composite index opclass for default index creates"),
 		NULL, &DefaultUseCompositeOpClass, DEFAULT_USE_NEW_COMPOSITE_INDEX_OPCLASS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableIndexOrderbyPushdown", newGucPrefix),
 		gettext_noop(
 			"Whether to enable the sort on the new experimental composite index opclass"),
 		NULL, &EnableIndexOrderbyPushdown, DEFAULT_ENABLE_INDEX_ORDERBY_PUSHDOWN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableIndexOrderbyPushdownLegacy", newGucPrefix),
@@ -501,35 +720,35 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether to enable the prior index sort on the new experimental composite index opclass"),
 		NULL, &EnableIndexOrderbyPushdownLegacy,
 		DEFAULT_ENABLE_INDEX_ORDERBY_PUSHDOWN_LEGACY,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableIndexHintSupport", newGucPrefix),
 		gettext_noop(
 			"Whether to enable index hint support for index pushdown."),
 		NULL, &EnableIndexHintSupport, DEFAULT_ENABLE_INDEX_HINT_SUPPORT,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.useLegacyForcePushdownBehavior", newGucPrefix),
 		gettext_noop(
 			"Whether to use legacy force index pushdown behavior."),
 		NULL, &UseLegacyForcePushdownBehavior, DEFAULT_USE_LEGACY_FORCE_PUSHDOWN_BEHAVIOR,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableRoleCrud", newGucPrefix),
 		gettext_noop(
 			"Enables role crud through the data plane."),
 		NULL, &EnableRoleCrud, DEFAULT_ENABLE_ROLE_CRUD,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableIndexPriorityOrdering", newGucPrefix),
 		gettext_noop(
 			"Whether to reorder the indexlist at the planner level based on priority of indexes."),
 		NULL, &EnableIndexPriorityOrdering, DEFAULT_ENABLE_INDEX_PRIORITY_ORDERING,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableSchemaEnforcementForCSFLE", newGucPrefix),
@@ -537,14 +756,14 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to enable schema enforcement for CSFLE."),
 		NULL, &EnableSchemaEnforcementForCSFLE,
 		DEFAULT_ENABLE_SCHEMA_ENFORCEMENT_FOR_CSFLE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableIndexOnlyScan", newGucPrefix),
 		gettext_noop(
 			"Whether to enable index only scan for queries that can be satisfied by an index without accessing the table."),
 		NULL, &EnableIndexOnlyScan, DEFAULT_ENABLE_INDEX_ONLY_SCAN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableRangeOptimizationForComposite", newGucPrefix),
@@ -552,7 +771,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether to enable range optimization for composite indexes."),
 		NULL, &EnableRangeOptimizationForComposite,
 		DEFAULT_ENABLE_RANGE_OPTIMIZATION_COMPOSITE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.usePgStatsLiveTuplesForCount", newGucPrefix),
@@ -560,7 +779,7 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether to use pg_stat_all_tables live tuples for count in collStats."),
 		NULL, &UsePgStatsLiveTuplesForCount,
 		DEFAULT_USE_PG_STATS_LIVE_TUPLES_FOR_COUNT,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.useLegacyShardKeyFilterOnUpdate", newGucPrefix),
@@ -568,12 +787,509 @@ InitializeFeatureFlagConfigurations(const char *prefix, const char *newGucPrefix
 			"Whether or not to use the older style shard key filter on update calls."),
 		NULL, &UseLegacyShardKeyFilterOnUpdate,
 		DEFAULT_USE_LEGACY_SHARD_KEY_FILTER_ON_UPDATE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableDelayedHoldPortal", newGucPrefix),
 		gettext_noop(
 			"Whether to delay holding the portal until we know there is more data to be fetched."),
 		NULL, &EnableDelayedHoldPortal, DEFAULT_ENABLE_DELAYED_HOLD_PORTAL,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableDocumentFieldDirectory", newGucPrefix),
+		gettext_noop(
+			"Whether to share a lazily built field offset directory across the field paths evaluated on a document."),
+		NULL, &EnableDocumentFieldDirectory, DEFAULT_ENABLE_DOCUMENT_FIELD_DIRECTORY,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableDecimal128SumFastPath", newGucPrefix),
+		gettext_noop(
+			"Whether $sum and $avg accumulate decimal128 values with the same exponent as a widened integer coefficient."),
+		NULL, &EnableDecimal128SumFastPath, DEFAULT_ENABLE_DECIMAL128_SUM_FAST_PATH,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableStreamingSequenceInsert", newGucPrefix),
+		gettext_noop(
+			"Whether inserts stream the documents of a document sequence in sub-batches instead of materializing them up front."),
+		NULL, &EnableStreamingSequenceInsert, DEFAULT_ENABLE_STREAMING_SEQUENCE_INSERT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCompiledQueryPredicates", newGucPrefix),
+		gettext_noop(
+			"Whether filters evaluated against documents are compiled into a linear predicate program."),
+		NULL, &EnableCompiledQueryPredicates, DEFAULT_ENABLE_COMPILED_QUERY_PREDICATES,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBatchPredicateEvaluation", newGucPrefix),
+		gettext_noop(
+			"Whether compiled filters are evaluated over batches of documents at a time."),
+		NULL, &EnableBatchPredicateEvaluation, DEFAULT_ENABLE_BATCH_PREDICATE_EVALUATION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableAggregationExpressionOptimization", newGucPrefix),
+		gettext_noop(
+			"Whether constant operator expressions are folded and repeated projection expressions are evaluated once per document."),
+		NULL, &EnableAggregationExpressionOptimization,
+		DEFAULT_ENABLE_AGGREGATION_EXPRESSION_OPTIMIZATION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableTimezoneOffsetWindowCache", newGucPrefix),
+		gettext_noop(
+			"Whether date operators resolve timezone UTC offsets from cached transition windows."),
+		NULL, &EnableTimezoneOffsetWindowCache, DEFAULT_ENABLE_TIMEZONE_OFFSET_WINDOW_CACHE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableAsciiStringFastPaths", newGucPrefix),
+		gettext_noop(
+			"Whether string operators process ASCII input a machine word at a time."),
+		NULL, &EnableAsciiStringFastPaths, DEFAULT_ENABLE_ASCII_STRING_FAST_PATHS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableExpressionEvaluationArena", newGucPrefix),
+		gettext_noop(
+			"Whether projections allocate temporary expression values from an arena reset per document."),
+		NULL, &EnableExpressionEvaluationArena,
+		DEFAULT_ENABLE_EXPRESSION_EVALUATION_ARENA,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableGroupHashAggregation", newGucPrefix),
+		gettext_noop(
+			"Whether $group always uses a hash aggregation bounded by hash_mem that "
+			"spills partitions of group keys to disk, instead of sort based grouping."),
+		gettext_noop(
+			"This applies when every accumulator of the stage supports hashing. The "
+			"number of partitions spilled is reported as the Batches of the "
+			"HashAggregate node in EXPLAIN ANALYZE."),
+		&EnableGroupHashAggregation, DEFAULT_ENABLE_GROUP_HASH_AGGREGATION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableParallelGroupAccumulators", newGucPrefix),
+		gettext_noop(
+			"Whether $group uses the $push, $addToSet, $first, $last, $firstN and $lastN aggregates that support parallel partial aggregation."),
+		NULL, &EnableParallelGroupAccumulators,
+		DEFAULT_ENABLE_PARALLEL_GROUP_ACCUMULATORS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableSortLimitProjectionDeferral", newGucPrefix),
+		gettext_noop(
+			"Whether projections between a $sort and a $limit are applied after the bounded top-K sort."),
+		NULL, &EnableSortLimitProjectionDeferral,
+		DEFAULT_ENABLE_SORT_LIMIT_PROJECTION_DEFERRAL,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableLookupMemoizedJoin", newGucPrefix),
+		gettext_noop(
+			"Whether $lookup caches the matched documents of the foreign collection "
+			"in a hash table keyed on the join key of the input documents."),
+		gettext_noop(
+			"The cache is bounded by hash_mem and is reported as a Memoize node "
+			"in EXPLAIN."),
+		&EnableLookupMemoizedJoin, DEFAULT_ENABLE_LOOKUP_MEMOIZED_JOIN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableGraphLookupTraversal", newGucPrefix),
+		gettext_noop(
+			"Whether $graphLookup uses a breadth first traversal with a visited set "
+			"instead of a recursive query."),
+		NULL, &EnableGraphLookupTraversal, DEFAULT_ENABLE_GRAPH_LOOKUP_TRAVERSAL,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableFacetSharedInput", newGucPrefix),
+		gettext_noop(
+			"Whether the input of a $facet with multiple facets is materialized once and shared by the facets."),
+		NULL, &EnableFacetSharedInput, DEFAULT_ENABLE_FACET_SHARED_INPUT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableUnwindGroupFusion", newGucPrefix),
+		gettext_noop(
+			"Whether an $unwind followed by a $group that only uses the unwound path "
+			"unwinds just that path instead of the full document."),
+		NULL, &EnableUnwindGroupFusion, DEFAULT_ENABLE_UNWIND_GROUP_FUSION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBucketAutoApproximateBoundaries", newGucPrefix),
+		gettext_noop(
+			"Whether $bucketAuto computes its bucket boundaries from a sample of the "
+			"groupBy values instead of sorting all of them."),
+		gettext_noop(
+			"Buckets are then only approximately even in size. Specs with a "
+			"granularity always use exact boundaries."),
+		&EnableBucketAutoApproximateBoundaries,
+		DEFAULT_ENABLE_BUCKET_AUTO_APPROXIMATE_BOUNDARIES,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableStreamingDensify", newGucPrefix),
+		gettext_noop(
+			"Whether $densify emits the documents that fill a gap one at a time "
+			"instead of building all of them for the row that ends the gap."),
+		NULL, &EnableStreamingDensify, DEFAULT_ENABLE_STREAMING_DENSIFY,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBsonCountAggregate", newGucPrefix),
+		gettext_noop(
+			"Whether or not to compute $count and the count command with a row count aggregate that doesn't read the documents."),
+		NULL, &EnableBsonCountAggregate, DEFAULT_ENABLE_BSON_COUNT_AGGREGATE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableIndexOnlyScanForDistinct", newGucPrefix),
+		gettext_noop(
+			"Whether or not to answer distinct on the paths of a composite index with an index only scan."),
+		NULL, &EnableIndexOnlyScanForDistinct,
+		DEFAULT_ENABLE_INDEX_ONLY_SCAN_FOR_DISTINCT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableOutInsertSelect", newGucPrefix),
+		gettext_noop(
+			"Whether or not to write the output of $out with an INSERT .. SELECT instead of a MERGE."),
+		NULL, &EnableOutInsertSelect, DEFAULT_ENABLE_OUT_INSERT_SELECT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableProjectionRawFieldCopy", newGucPrefix),
+		gettext_noop(
+			"Whether or not projections copy runs of fields they don't modify as raw bytes."),
+		NULL, &EnableProjectionRawFieldCopy, DEFAULT_ENABLE_PROJECTION_RAW_FIELD_COPY,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableAddFieldsAppendFastPath", newGucPrefix),
+		gettext_noop(
+			"Whether or not $addFields appends new top level fields to the unmodified document."),
+		NULL, &EnableAddFieldsAppendFastPath,
+		DEFAULT_ENABLE_ADD_FIELDS_APPEND_FAST_PATH,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enablePipelineStageRewrites", newGucPrefix),
+		gettext_noop(
+			"Whether or not to reorder and combine aggregation stages (e.g. move $match ahead of $lookup) before building the query."),
+		NULL, &EnablePipelineStageRewrites, DEFAULT_ENABLE_PIPELINE_STAGE_REWRITES,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableApproxCountDistinct", newGucPrefix),
+		gettext_noop(
+			"Whether or not to support the $approxCountDistinct accumulator and window operator."),
+		NULL, &EnableApproxCountDistinct, DEFAULT_ENABLE_APPROX_COUNT_DISTINCT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableFlatUnionWithAppend", newGucPrefix),
+		gettext_noop(
+			"Whether or not consecutive $unionWith stages are planned as a single (possibly parallel) Append."),
+		NULL, &EnableFlatUnionWithAppend, DEFAULT_ENABLE_FLAT_UNION_WITH_APPEND,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableExactPercentile", newGucPrefix),
+		gettext_noop(
+			"Whether or not to support the exact 'discrete' method of $percentile and $median."),
+		NULL, &EnableExactPercentile, DEFAULT_ENABLE_EXACT_PERCENTILE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableGroupFirstRowPerGroup", newGucPrefix),
+		gettext_noop(
+			"Whether or not a $group of only $first accumulators after a $sort on the group key keeps the first sorted row of each group."),
+		NULL, &EnableGroupFirstRowPerGroup, DEFAULT_ENABLE_GROUP_FIRST_ROW_PER_GROUP,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableIndexOnlyScanForProjection", newGucPrefix),
+		gettext_noop(
+			"Whether or not to consider index only scans for queries whose projection is covered by a composite index."),
+		NULL, &EnableIndexOnlyScanForProjection,
+		DEFAULT_ENABLE_INDEX_ONLY_SCAN_FOR_PROJECTION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCompositeIndexSkipScan", newGucPrefix),
+		gettext_noop(
+			"Whether or not to consider composite indexes for queries without a filter on the first path by skipping over the leading path values."),
+		NULL, &EnableCompositeIndexSkipScan, DEFAULT_ENABLE_COMPOSITE_INDEX_SKIP_SCAN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCompactWildcardProjectionTerms", newGucPrefix),
+		gettext_noop(
+			"Whether or not new inclusion wildcard projection indexes store the ordinal of the included path in place of the path prefix in their terms."),
+		NULL, &EnableCompactWildcardProjectionTerms,
+		DEFAULT_ENABLE_COMPACT_WILDCARD_PROJECTION_TERMS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableNativeHashIndex", newGucPrefix),
+		gettext_noop(
+			"Whether or not to back new single field hashed indexes with a postgres hash index."),
+		NULL, &EnableNativeHashIndex, DEFAULT_ENABLE_NATIVE_HASH_INDEX,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableOrderedIndexScanStartupCost", newGucPrefix),
+		gettext_noop(
+			"Whether or not order by pushdowns to composite indexes are costed to stream their first tuple after a single descent."),
+		NULL, &EnableOrderedIndexScanStartupCost,
+		DEFAULT_ENABLE_ORDERED_INDEX_SCAN_STARTUP_COST,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableGeospatialPointFastPath", newGucPrefix),
+		gettext_noop(
+			"Whether or not runtime $box and $center checks compare point documents on their coordinates without building a geometry."),
+		NULL, &EnableGeospatialPointFastPath, DEFAULT_ENABLE_GEOSPATIAL_POINT_FAST_PATH,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableRankFusionStage", newGucPrefix),
+		gettext_noop(
+			"Whether or not the $rankFusion stage is supported to combine ranked pipelines with reciprocal rank fusion."),
+		NULL, &EnableRankFusionStage, DEFAULT_ENABLE_RANK_FUSION_STAGE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableIndexStatsUsageDetails", newGucPrefix),
+		gettext_noop(
+			"Whether or not $indexStats reports the tuples read, size and last use of each index."),
+		NULL, &EnableIndexStatsUsageDetails, DEFAULT_ENABLE_INDEX_STATS_USAGE_DETAILS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableHashedTruncatedIndexTerms", newGucPrefix),
+		gettext_noop(
+			"Whether or not new single path indexes store a hash of the full value next to truncated terms so equality can discard values that only share the truncated prefix."),
+		NULL, &EnableHashedTruncatedIndexTerms,
+		DEFAULT_ENABLE_HASHED_TRUNCATED_INDEX_TERMS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableQueryShapeCache", newGucPrefix),
+		gettext_noop(
+			"Whether or not the queries generated for find and aggregate are cached per backend and reused for requests with the same shape."),
+		NULL, &EnableQueryShapeCache, DEFAULT_ENABLE_QUERY_SHAPE_CACHE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableDirectPointReads", newGucPrefix),
+		gettext_noop(
+			"Whether or not finds on _id of unsharded collections are served from the primary key index without generating a query."),
+		NULL, &EnableDirectPointReads, DEFAULT_ENABLE_DIRECT_POINT_READS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableParallelQueryPlans", newGucPrefix),
+		gettext_noop(
+			"Whether or not queries that are executed once (single batch, file based cursors, count and distinct) can use parallel plans."),
+		NULL, &EnableParallelQueryPlans, DEFAULT_ENABLE_PARALLEL_QUERY_PLANS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableDollarOperatorCostModel", newGucPrefix),
+		gettext_noop(
+			"Whether or not the planner costs query operators by operator kind and query value."),
+		NULL, &EnableDollarOperatorCostModel, DEFAULT_ENABLE_DOLLAR_OPERATOR_COST_MODEL,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableKeysetCursorContinuation", newGucPrefix),
+		gettext_noop(
+			"Whether or not streaming cursors on primary key index scans resume from the last primary key returned."),
+		NULL, &EnableKeysetCursorContinuation, DEFAULT_ENABLE_KEYSET_CURSOR_CONTINUATION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableOrBranchSortMerge", newGucPrefix),
+		gettext_noop(
+			"Whether or not sorted and limited finds on $or filters sort and limit each $or branch separately."),
+		NULL, &EnableOrBranchSortMerge, DEFAULT_ENABLE_OR_BRANCH_SORT_MERGE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableAdaptiveIndexScan", newGucPrefix),
+		gettext_noop(
+			"Whether or not index scans that return far more rows than estimated switch to a sequential scan."),
+		NULL, &EnableAdaptiveIndexScan, DEFAULT_ENABLE_ADAPTIVE_INDEX_SCAN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCursorFileCompression", newGucPrefix),
+		gettext_noop(
+			"Whether or not file based persisted cursors compress the blocks they write."),
+		NULL, &EnableCursorFileCompression, DEFAULT_ENABLE_CURSOR_FILE_COMPRESSION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCompactCursorContinuation", newGucPrefix),
+		gettext_noop(
+			"Whether or not streaming cursors return their per shard continuation in a compact binary form."),
+		NULL, &EnableCompactCursorContinuation,
+		DEFAULT_ENABLE_COMPACT_CURSOR_CONTINUATION,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableMultiRowHeapInsert", newGucPrefix),
+		gettext_noop(
+			"Whether or not batch inserts into a local shard insert each sub-batch with a single multi row heap insert."),
+		NULL, &EnableMultiRowHeapInsert, DEFAULT_ENABLE_MULTI_ROW_HEAP_INSERT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableUpdateSpecCache", newGucPrefix),
+		gettext_noop(
+			"Whether or not parsed update operator specs are cached and reused across the entries of a batch."),
+		NULL, &EnableUpdateSpecCache, DEFAULT_ENABLE_UPDATE_SPEC_CACHE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBatchDeleteByObjectIds", newGucPrefix),
+		gettext_noop(
+			"Whether or not batches of _id deletes on unsharded collections run as a single delete."),
+		NULL, &EnableBatchDeleteByObjectIds, DEFAULT_ENABLE_BATCH_DELETE_BY_OBJECT_IDS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableSortedWritePlanCache", newGucPrefix),
+		gettext_noop(
+			"Whether or not the plans of single document updates and deletes with a sort are cached."),
+		NULL, &EnableSortedWritePlanCache, DEFAULT_ENABLE_SORTED_WRITE_PLAN_CACHE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableRelaxedDurabilityWriteConcern", newGucPrefix),
+		gettext_noop(
+			"Whether or not writes with a write concern of w: 0 or j: false commit asynchronously."),
+		NULL, &EnableRelaxedDurabilityWriteConcern, DEFAULT_ENABLE_RELAXED_DURABILITY_WRITE_CONCERN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableInsertSubBatchRetry", newGucPrefix),
+		gettext_noop(
+			"Whether or not unordered inserts only retry the failed sub-batch one document at a time."),
+		NULL, &EnableInsertSubBatchRetry, DEFAULT_ENABLE_INSERT_SUB_BATCH_RETRY,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableUpsertInsertFirst", newGucPrefix),
+		gettext_noop(
+			"Whether or not upserts with an _id equality filter try to insert the document before looking for a match."),
+		NULL, &EnableUpsertInsertFirst, DEFAULT_ENABLE_UPSERT_INSERT_FIRST,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCollectionCatalogPlanCache", newGucPrefix),
+		gettext_noop(
+			"Whether or not the plans of the collection metadata lookups are cached."),
+		NULL, &EnableCollectionCatalogPlanCache, DEFAULT_ENABLE_COLLECTION_CATALOG_PLAN_CACHE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableListCollectionsNamePushdown", newGucPrefix),
+		gettext_noop(
+			"Whether or not to push name filters of listCollections down to the collections catalog index."),
+		NULL, &EnableListCollectionsNamePushdown, DEFAULT_ENABLE_LIST_COLLECTIONS_NAME_PUSHDOWN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCommandActivityRegistry", newGucPrefix),
+		gettext_noop(
+			"Whether or not commands publish their name and namespace to shared memory for currentOp."),
+		NULL, &EnableCommandActivityRegistry, DEFAULT_ENABLE_COMMAND_ACTIVITY_REGISTRY,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCommandLatencyHistograms", newGucPrefix),
+		gettext_noop(
+			"Whether or not to record the latency of commands in per backend histograms."),
+		NULL, &EnableCommandLatencyHistograms, DEFAULT_ENABLE_COMMAND_LATENCY_HISTOGRAMS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableOnlineCompact", newGucPrefix),
+		gettext_noop(
+			"Whether or not to run compact as an online vacuum that keeps the collection writable."),
+		NULL, &EnableOnlineCompact, DEFAULT_ENABLE_ONLINE_COMPACT,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableValidateDocumentScan", newGucPrefix),
+		gettext_noop(
+			"Whether or not validate with full or sample checks the documents of the collection."),
+		NULL, &EnableValidateDocumentScan, DEFAULT_ENABLE_VALIDATE_DOCUMENT_SCAN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableSlowOperationLog", newGucPrefix),
+		gettext_noop(
+			"Whether or not to record the queries of slow and sampled commands in the slow operation log."),
+		NULL, &EnableSlowOperationLog, DEFAULT_ENABLE_SLOW_OPERATION_LOG,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCollectionJoinStats", newGucPrefix),
+		gettext_noop(
+			"Whether or not to count the collections joined by $lookup, $graphLookup and $unionWith for colocation advice."),
+		NULL, &EnableCollectionJoinStats, DEFAULT_ENABLE_COLLECTION_JOIN_STATS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableQueryShapeStats", newGucPrefix),
+		gettext_noop(
+			"Whether or not to collect the statistics of the queries of find, aggregate, count, distinct and findAndModify by query shape for $queryStats."),
+		NULL, &EnableQueryShapeStats, DEFAULT_ENABLE_QUERY_SHAPE_STATS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBatchShardKeyHashing", newGucPrefix),
+		gettext_noop(
+			"Whether or not to compute the shard key hashes of a batch of inserted documents with a shard key compiled once for the batch."),
+		NULL, &EnableBatchShardKeyHashing, DEFAULT_ENABLE_BATCH_SHARD_KEY_HASHING,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableColumnarProjectionStore", newGucPrefix),
+		gettext_noop(
+			"Whether or not to support the columnarPaths option of collMod and read covered aggregation pipelines from the columnar projection store."),
+		NULL, &EnableColumnarProjectionStore, DEFAULT_ENABLE_COLUMNAR_PROJECTION_STORE,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableClusteredCollections", newGucPrefix),
+		gettext_noop(
+			"Whether or not to support the clusteredIndex option on create, which keeps the documents of the collection ordered by _id."),
+		NULL, &EnableClusteredCollections, DEFAULT_ENABLE_CLUSTERED_COLLECTIONS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCustomWaitEvents", newGucPrefix),
+		gettext_noop(
+			"Whether or not to report the phases of the extension (e.g. query generation, index term extraction) as wait events in pg_stat_activity."),
+		NULL, &EnableCustomWaitEvents, DEFAULT_ENABLE_CUSTOM_WAIT_EVENTS,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableTailableCursorAwaitData", newGucPrefix),
+		gettext_noop(
+			"Whether or not a getMore of a tailable cursor with maxAwaitTimeMS waits for writes to the collection to commit when there is no new data, rather than returning an empty batch."),
+		NULL, &EnableTailableCursorAwaitData, DEFAULT_ENABLE_TAILABLE_CURSOR_AWAIT_DATA,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 }
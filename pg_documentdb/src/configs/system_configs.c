@@ -42,6 +42,39 @@ int ShardingMaxChunks = DEFAULT_SHARDING_MAX_CHUNKS;
 #define DEFAULT_QUERY_PLAN_CACHE_SIZE_LIMIT 100
 int QueryPlanCacheSizeLimit = DEFAULT_QUERY_PLAN_CACHE_SIZE_LIMIT;
 
+#define DEFAULT_QUERY_SHAPE_CACHE_SIZE_LIMIT 100
+int QueryShapeCacheSizeLimit = DEFAULT_QUERY_SHAPE_CACHE_SIZE_LIMIT;
+
+#define DEFAULT_DIAGNOSTIC_STATS_CACHE_SECONDS 0
+int DiagnosticStatsCacheSeconds = DEFAULT_DIAGNOSTIC_STATS_CACHE_SECONDS;
+
+#define DEFAULT_DIAGNOSTIC_WORKER_TIMEOUT_MS 0
+int DiagnosticWorkerTimeoutMs = DEFAULT_DIAGNOSTIC_WORKER_TIMEOUT_MS;
+
+#define DEFAULT_ONLINE_COMPACT_COST_DELAY_MS 2
+int OnlineCompactCostDelayMs = DEFAULT_ONLINE_COMPACT_COST_DELAY_MS;
+
+#define DEFAULT_MAX_VALIDATE_PARALLEL_WORKERS 2
+int MaxValidateParallelWorkers = DEFAULT_MAX_VALIDATE_PARALLEL_WORKERS;
+
+#define DEFAULT_SLOW_OPERATION_THRESHOLD_MS 100
+int SlowOperationThresholdMs = DEFAULT_SLOW_OPERATION_THRESHOLD_MS;
+
+#define DEFAULT_SLOW_OPERATION_SAMPLE_RATE 0.0
+double SlowOperationSampleRate = DEFAULT_SLOW_OPERATION_SAMPLE_RATE;
+
+#define DEFAULT_SLOW_OPERATION_LOG_ENTRIES 256
+int SlowOperationLogEntries = DEFAULT_SLOW_OPERATION_LOG_ENTRIES;
+
+#define DEFAULT_MAX_QUERY_MEMORY_MB 0
+int MaxQueryMemoryMB = DEFAULT_MAX_QUERY_MEMORY_MB;
+
+#define DEFAULT_MAX_TIME_BUCKETS_IN_SHARD_KEY_FILTER 64
+int MaxTimeBucketsInShardKeyFilter = DEFAULT_MAX_TIME_BUCKETS_IN_SHARD_KEY_FILTER;
+
+#define DEFAULT_SHARED_QUERY_PLAN_TEMPLATE_COUNT 256
+int SharedQueryPlanTemplateCount = DEFAULT_SHARED_QUERY_PLAN_TEMPLATE_COUNT;
+
 /* TODO: Raise this back to 100,000 once we can optimize sub-transaction */
 /* handling with multi-node clusters. */
 #define DEFAULT_MAX_WRITE_BATCH_SIZE 25000
@@ -129,6 +162,15 @@ bool EnableUserCrud = DEFAULT_ENABLE_USER_CRUD;
 #define DEFAULT_VECTOR_ITERATIVE_SCAN_MODE VectorIterativeScan_RELAXED_ORDER
 int VectorPreFilterIterativeScanMode = DEFAULT_VECTOR_ITERATIVE_SCAN_MODE;
 
+#define DEFAULT_VECTOR_EXACT_SEARCH_MAX_CANDIDATE_ROWS 0
+int VectorExactSearchMaxCandidateRows = DEFAULT_VECTOR_EXACT_SEARCH_MAX_CANDIDATE_ROWS;
+
+#define DEFAULT_VECTOR_SEARCH_DEFAULT_OVERSAMPLING 1.0
+double VectorSearchDefaultOversampling = DEFAULT_VECTOR_SEARCH_DEFAULT_OVERSAMPLING;
+
+#define DEFAULT_SELECTIVITY_INDEX_PROBE_MAX_TUPLES 0
+int SelectivityIndexProbeMaxTuples = DEFAULT_SELECTIVITY_INDEX_PROBE_MAX_TUPLES;
+
 #define DEFAULT_ENABLE_GEONEAR_FORCE_INDEX_PUSHDOWN true
 bool EnableGeonearForceIndexPushdown = DEFAULT_ENABLE_GEONEAR_FORCE_INDEX_PUSHDOWN;
 
@@ -154,6 +196,9 @@ int MaxAllowedCursorIntermediateFileSizeMB =
 #define DEFAULT_MAX_CURSOR_FILE_COUNT 5000
 int MaxCursorFileCount = DEFAULT_MAX_CURSOR_FILE_COUNT;
 
+#define DEFAULT_CURSOR_FILE_READ_AHEAD_SIZE_KB 1024
+int CursorFileReadAheadSizeKB = DEFAULT_CURSOR_FILE_READ_AHEAD_SIZE_KB;
+
 /* Starting pg18 use documentdb_extended_rum for the rum library */
 #if PG_VERSION_NUM >= 180000
 #define DEFAULT_RUM_LIBRARY_LOAD_OPTION RumLibraryLoadOption_RequireDocumentDBRum
@@ -166,6 +211,31 @@ RumLibraryLoadOptions DocumentDBRumLibraryLoadOption = DEFAULT_RUM_LIBRARY_LOAD_
 #define DEFAULT_ENABLE_STATEMENT_TIMEOUT true
 bool EnableBackendStatementTimeout = DEFAULT_ENABLE_STATEMENT_TIMEOUT;
 
+/*
+ * The largest fraction of the estimated collection rows that $sample reads through
+ * TABLESAMPLE SYSTEM_ROWS. Larger samples visit so many random blocks that a
+ * sequential scan with a random sort is cheaper and gives a uniform sample.
+ * Like the pseudo-random cursor of MongoDB, the block sample is used below 5%.
+ */
+#define DEFAULT_SAMPLE_BLOCK_SCAN_MAX_FRACTION 0.05
+double SampleBlockScanMaxFraction = DEFAULT_SAMPLE_BLOCK_SCAN_MAX_FRACTION;
+
+/*
+ * Whether every aggregation stage is planned as its own subquery scan so that
+ * EXPLAIN ANALYZE reports the rows, time and memory of each stage. This keeps the
+ * planner from merging stages and is meant for diagnosing pipelines only.
+ */
+#define DEFAULT_SEPARATE_AGGREGATION_STAGES_IN_PLAN false
+bool SeparateAggregationStagesInPlan = DEFAULT_SEPARATE_AGGREGATION_STAGES_IN_PLAN;
+
+/*
+ * The fillfactor of the data table of clustered collections: The free space left
+ * in each page lets updates stay on the page instead of moving the document to
+ * the end of the table, out of _id order.
+ */
+#define DEFAULT_CLUSTERED_COLLECTION_FILL_FACTOR 90
+int ClusteredCollectionFillFactor = DEFAULT_CLUSTERED_COLLECTION_FILL_FACTOR;
+
 static struct config_enum_entry rum_load_options[4] = {
 	{ "none", RumLibraryLoadOption_None, false },
 	{ "prefer_documentdb_extended_rum", RumLibraryLoadOption_PreferDocumentDBRum, false },
@@ -174,6 +244,45 @@ static struct config_enum_entry rum_load_options[4] = {
 	{ NULL, 0, false }
 };
 
+/*
+ * The number of times a user settable config changed in this backend (including
+ * the reverts of SET LOCAL and of aborted transactions). Caches of generated
+ * queries compare it to drop queries generated with other settings.
+ */
+uint64 ConfigGeneration = 0;
+
+
+/*
+ * The assign hooks of the user settable configs that bump the ConfigGeneration.
+ */
+void
+BumpConfigGenerationBool(bool newValue, void *extra)
+{
+	ConfigGeneration++;
+}
+
+
+void
+BumpConfigGenerationInt(int newValue, void *extra)
+{
+	ConfigGeneration++;
+}
+
+
+void
+BumpConfigGenerationReal(double newValue, void *extra)
+{
+	ConfigGeneration++;
+}
+
+
+void
+BumpConfigGenerationString(const char *newValue, void *extra)
+{
+	ConfigGeneration++;
+}
+
+
 void
 InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 {
@@ -190,7 +299,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		psprintf("%s.enable_create_collection_on_insert", prefix),
 		gettext_noop("Create a collection when inserting into a non-existent collection"),
 		NULL, &EnableCreateCollectionOnInsert, true,
-		PGC_USERSET, GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE, NULL, NULL, NULL);
+		PGC_USERSET, GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.query_plan_cache_size", prefix),
@@ -200,6 +309,122 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_QUERY_PLAN_CACHE_SIZE_LIMIT, 1, INT_MAX,
 		PGC_USERSET,
 		0,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.query_shape_cache_size", prefix),
+		gettext_noop("Set the size of the cache of queries generated for find and aggregate"),
+		NULL,
+		&QueryShapeCacheSizeLimit,
+		DEFAULT_QUERY_SHAPE_CACHE_SIZE_LIMIT, 0, INT_MAX,
+		PGC_USERSET,
+		0,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.diagnosticStatsCacheSeconds", prefix),
+		gettext_noop(
+			"Set the number of seconds the responses of dbStats and collStats are reused for in a session, 0 to always compute them."),
+		NULL,
+		&DiagnosticStatsCacheSeconds,
+		DEFAULT_DIAGNOSTIC_STATS_CACHE_SECONDS, 0, 3600,
+		PGC_USERSET,
+		GUC_UNIT_S,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.diagnosticWorkerTimeoutMs", prefix),
+		gettext_noop(
+			"Set the milliseconds after which the worker calls of currentOp, collStats, dbStats and indexStats are canceled when no statement timeout applies, 0 to wait for them."),
+		NULL,
+		&DiagnosticWorkerTimeoutMs,
+		DEFAULT_DIAGNOSTIC_WORKER_TIMEOUT_MS, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_MS,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.onlineCompactCostDelayMs", prefix),
+		gettext_noop(
+			"Set the vacuum cost delay used to throttle an online compact, 0 to not throttle it."),
+		NULL,
+		&OnlineCompactCostDelayMs,
+		DEFAULT_ONLINE_COMPACT_COST_DELAY_MS, 0, 100,
+		PGC_USERSET,
+		GUC_UNIT_MS,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.maxValidateParallelWorkers", prefix),
+		gettext_noop(
+			"Set the maximum number of parallel workers the document scan of validate uses, 0 to scan serially."),
+		NULL,
+		&MaxValidateParallelWorkers,
+		DEFAULT_MAX_VALIDATE_PARALLEL_WORKERS, 0, 64,
+		PGC_USERSET,
+		0,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.slowOperationThresholdMs", prefix),
+		gettext_noop(
+			"Set the execution time above which the queries of commands are recorded in the slow operation log."),
+		NULL,
+		&SlowOperationThresholdMs,
+		DEFAULT_SLOW_OPERATION_THRESHOLD_MS, 0, INT_MAX,
+		PGC_USERSET,
+		GUC_UNIT_MS,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomRealVariable(
+		psprintf("%s.slowOperationSampleRate", prefix),
+		gettext_noop(
+			"Set the fraction of the queries of commands below the threshold that are recorded in the slow operation log."),
+		NULL, &SlowOperationSampleRate, DEFAULT_SLOW_OPERATION_SAMPLE_RATE, 0, 1,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationReal, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.slowOperationLogEntries", prefix),
+		gettext_noop(
+			"Set the number of operations kept in the shared memory slow operation log, older ones are overwritten."),
+		NULL,
+		&SlowOperationLogEntries,
+		DEFAULT_SLOW_OPERATION_LOG_ENTRIES, 0, 65536,
+		PGC_POSTMASTER,
+		0,
+		NULL, NULL, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.maxQueryMemoryMB", prefix),
+		gettext_noop(
+			"Set the memory the stages and accumulators of a query may hold at once, 0 for no limit."),
+		NULL,
+		&MaxQueryMemoryMB,
+		DEFAULT_MAX_QUERY_MEMORY_MB, 0, INT_MAX / 1024,
+		PGC_USERSET,
+		0,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.maxTimeBucketsInShardKeyFilter", prefix),
+		gettext_noop(
+			"Set the number of time buckets up to which a date range on a time bucketed shard key filters the query to the shards of those buckets."),
+		NULL,
+		&MaxTimeBucketsInShardKeyFilter,
+		DEFAULT_MAX_TIME_BUCKETS_IN_SHARD_KEY_FILTER, 0, 4096,
+		PGC_USERSET,
+		0,
+		NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.shared_query_plan_templates", prefix),
+		gettext_noop(
+			"Set the number of prepared queries kept in shared memory to prewarm the query plan cache of new backends"),
+		NULL,
+		&SharedQueryPlanTemplateCount,
+		DEFAULT_SHARED_QUERY_PLAN_TEMPLATE_COUNT, 0, 65536,
+		PGC_POSTMASTER,
+		0,
 		NULL, NULL, NULL);
 
 	DefineCustomIntVariable(
@@ -210,7 +435,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_MAX_WRITE_BATCH_SIZE, 1, INT_MAX,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceRumIndexScantoBitmapHeapScan", prefix),
@@ -221,14 +446,14 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_FORCE_RUM_INDEXSCAN_TO_BITMAPHEAPSCAN,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceUseIndexIfAvailable", prefix),
 		gettext_noop(
 			"Forces the query planner to push to the RUM index if it's applicable - do not pick the index path purely based on cost."),
 		NULL, &ForceUseIndexIfAvailable, DEFAULT_FORCE_USE_INDEX_IF_AVAILABLE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.coll_stats_count_policy_threshold", prefix),
@@ -239,7 +464,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_COLL_STATS_COUNT_POLICY_THRESHOLD, 1, INT_MAX - 1,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.batchWriteSubTransactionCount", prefix),
@@ -248,7 +473,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_BATCH_WRITE_SUB_TRANSACTION_COUNT, 1, INT_MAX,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.IsPgReadOnlyForDiskFull", prefix),
@@ -256,28 +481,28 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Determines whether postgres is in readonly mode since disk is full"),
 		NULL, &DocumentDBPGReadOnlyForDiskFull,
 		DEFAULT_DOCUMENTDB_PG_READ_ONLY_FOR_DISK_FULL,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomRealVariable(
 		psprintf("%s.geo2dsphereSegmentMaxLength", prefix),
 		gettext_noop(
 			"Maximum segment length (in km) allowed for geospatial spherical queries. Set 0 if segmentation needs to be disabled."),
 		NULL, &MaxSegmentLengthInKms, DEFAULT_GEO_MAX_SEGMENT_LENGTH_KM, 0, 6372,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationReal, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.geo2dsphereSegmentMaxVertices", prefix),
 		gettext_noop(
 			"Maximum segment vertices allowed for geospatial spherical queries. If sphereSegmentMaxLength is 0 then this config has no effect overall."),
 		NULL, &MaxSegmentVertices, DEFAULT_MAX_SEGMENT_VERTICES, 0, 32,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.maxIndexesPerCollection", prefix),
 		gettext_noop(
 			"Maximum allowed indexes for a given collection."),
 		NULL, &MaxIndexesPerCollection, DEFAULT_MAX_INDEXES_PER_COLLECTION, 0, 300,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.maxWildcardIndexKeySize", newGucPrefix),
@@ -286,7 +511,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_MAX_WILDCARD_INDEX_KEY_SIZE, 1, INT32_MAX,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.maxSchemaValidatorSize", prefix),
@@ -297,14 +522,14 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_MAX_SCHEMA_VALIDATOR_SIZE, 0, 16 * 1024 * 1024,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.sharding_max_chunks", prefix),
 		gettext_noop(
 			"Gets the maximum allowed number of chunks for a shard collection operation"),
 		NULL, &ShardingMaxChunks, DEFAULT_SHARDING_MAX_CHUNKS, 1, 8192, PGC_USERSET, 0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.scramDefaultSaltLen", newGucPrefix),
@@ -322,7 +547,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		NULL,
 		&ThrowDeadlockOnCrud,
 		DEFAULT_THROW_DEADLOCK_ON_CRUD,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.maxUserLimit", newGucPrefix),
@@ -349,21 +574,21 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"The number of maximum centroid to use in the t-digest. Range from 10 to 10000. The higher the number, the more accurate will be, but higher memory usage."),
 		&TdigestCompressionAccuracy,
 		DEFAULT_TDIGEST_COMPRESSION_ACCURACY, 10, 10000,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomStringVariable(
 		psprintf("%s.blockedRolePrefixList", newGucPrefix),
 		gettext_noop("List of role prefixes that are blocked from being created/deleted. "
 					 "The list of role prefixes are comma separated."),
 		NULL, &BlockedRolePrefixList, DEFAULT_BLOCKED_ROLE_PREFIX_LIST,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationString, NULL);
 
 	DefineCustomStringVariable(
 		psprintf("%s.current_op_application_name", newGucPrefix),
 		gettext_noop(
 			"Application name that is tracked for current_op. '' means track all"),
 		NULL, &CurrentOpApplicationName, DEFAULT_CURRENT_OP_APPLICATION_NAME,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationString, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.aggregation_stages_limit", newGucPrefix),
@@ -372,7 +597,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		&MaxAggregationStagesAllowed,
 		DEFAULT_AGGREGATION_STAGES_LIMIT, DEFAULT_AGGREGATION_STAGES_LIMIT,
 		5 * DEFAULT_AGGREGATION_STAGES_LIMIT, /* Ballpark number for max is 5 times, we should rarely need to update it*/
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.index_term_compression_threshold", newGucPrefix),
@@ -381,14 +606,14 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		&IndexTermCompressionThreshold,
 		DEFAULT_INDEX_TERM_COMPRESSION_THRESHOLD, 128,
 		INT_MAX,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableUserCrud", newGucPrefix),
 		gettext_noop(
 			"Enables user crud through the data plane."),
 		NULL, &EnableUserCrud, DEFAULT_ENABLE_USER_CRUD,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableTTLJobsOnReadOnly", newGucPrefix),
@@ -396,7 +621,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Enables TTL jobs on read-only nodes. This will override"
 			" the default_transaction_readonly on the TTL job only."),
 		NULL, &EnableTtlJobsOnReadOnly, DEFAULT_ENABLE_TTL_JOBS_ON_READ_ONLY,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enable_force_push_geonear_index", newGucPrefix),
@@ -404,7 +629,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Enables ensuring that geonear queries are always pushed to the geospatial index."),
 		NULL, &EnableGeonearForceIndexPushdown,
 		DEFAULT_ENABLE_GEONEAR_FORCE_INDEX_PUSHDOWN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomEnumVariable(
 		psprintf("%s.vectorPreFilterIterativeScanMode", newGucPrefix),
@@ -414,14 +639,40 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Strict order ensures results are in the exact order by distance"),
 		NULL, &VectorPreFilterIterativeScanMode, DEFAULT_VECTOR_ITERATIVE_SCAN_MODE,
 		VECTOR_ITERATIVE_SCAN_OPTIONS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.vectorExactSearchMaxCandidateRows", newGucPrefix),
+		gettext_noop(
+			"The largest estimated number of rows matching a vector search query for which "
+			"the rows are ranked exactly instead of through the vector index. 0 disables it."),
+		NULL, &VectorExactSearchMaxCandidateRows,
+		DEFAULT_VECTOR_EXACT_SEARCH_MAX_CANDIDATE_ROWS, 0, INT_MAX,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
+
+	DefineCustomRealVariable(
+		psprintf("%s.vectorSearchDefaultOversampling", newGucPrefix),
+		gettext_noop(
+			"The oversampling used for vector searches on compressed (half or pq) vector indexes "
+			"that do not specify one: k * oversampling candidates are rescored on the full vectors."),
+		NULL, &VectorSearchDefaultOversampling, DEFAULT_VECTOR_SEARCH_DEFAULT_OVERSAMPLING,
+		1, 100, PGC_USERSET, 0, NULL, BumpConfigGenerationReal, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.selectivityIndexProbeMaxTuples", newGucPrefix),
+		gettext_noop(
+			"The most index entries counted in a single path index to estimate the selectivity "
+			"of an equality on the path while planning. 0 disables probing the index."),
+		NULL, &SelectivityIndexProbeMaxTuples,
+		DEFAULT_SELECTIVITY_INDEX_PROBE_MAX_TUPLES, 0, INT_MAX,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.defaultCursorFirstPageBatchSize", newGucPrefix),
 		gettext_noop("The default batch size for the first page of a cursor."),
 		NULL, &DefaultCursorFirstPageBatchSize,
 		DEFAULT_CURSOR_FIRST_PAGE_BATCH_SIZE, 1, INT_MAX,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableExtendedExplainPlans", newGucPrefix),
@@ -429,7 +680,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Enables extended explain plans for queries. "
 			"This will include additional information in the explain plans."),
 		NULL, &EnableExtendedExplainPlans, DEFAULT_ENABLE_EXTENDED_EXPLAIN_PLANS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.defaultCursorExpiryTimeLimitSeconds", newGucPrefix),
@@ -437,7 +688,7 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Default expiry time limit for cursor."),
 		NULL, &DefaultCursorExpiryTimeLimitSeconds,
 		DEFAULT_CURSOR_EXPIRY_TIME_LIMIT_SECONDS,
-		1, 3600, PGC_USERSET, 0, NULL, NULL, NULL);
+		1, 3600, PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.maxCursorIntermediateFileSizeMB", newGucPrefix),
@@ -445,14 +696,21 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 			"Maximum size of intermediate file for cursor."),
 		NULL, &MaxAllowedCursorIntermediateFileSizeMB,
 		DEFAULT_MAX_CURSOR_FILE_INTERMEDIATE_FILE_SIZE_MB,
-		1, INT_MAX, PGC_USERSET, 0, NULL, NULL, NULL);
+		1, INT_MAX, PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 	DefineCustomIntVariable(
 		psprintf("%s.maxCursorFileCount", newGucPrefix),
 		gettext_noop(
 			"Maximum number of cursor files allowed. set to 0 to disable cursor file limit."),
 		NULL, &MaxCursorFileCount,
 		DEFAULT_MAX_CURSOR_FILE_COUNT, 0, INT_MAX,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
+	DefineCustomIntVariable(
+		psprintf("%s.cursorFileReadAheadSizeKB", newGucPrefix),
+		gettext_noop(
+			"Maximum size of the next batch of a cursor file that getMore prefetches. set to 0 to disable the prefetch."),
+		NULL, &CursorFileReadAheadSizeKB,
+		DEFAULT_CURSOR_FILE_READ_AHEAD_SIZE_KB, 0, INT_MAX / 1024,
+		PGC_USERSET, GUC_UNIT_KB, NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomEnumVariable(
 		psprintf("%s.rum_library_load_option", newGucPrefix),
@@ -467,5 +725,29 @@ InitializeSystemConfigurations(const char *prefix, const char *newGucPrefix)
 		gettext_noop(
 			"Whether to enable per statement backend timeout override in the backend."),
 		NULL, &EnableBackendStatementTimeout, DEFAULT_ENABLE_STATEMENT_TIMEOUT,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomRealVariable(
+		psprintf("%s.sampleBlockScanMaxFraction", newGucPrefix),
+		gettext_noop(
+			"The largest fraction of the estimated collection size that $sample reads "
+			"through block sampling before falling back to a full scan."),
+		NULL, &SampleBlockScanMaxFraction, DEFAULT_SAMPLE_BLOCK_SCAN_MAX_FRACTION,
+		0, 1, PGC_USERSET, 0, NULL, BumpConfigGenerationReal, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.separateAggregationStagesInPlan", newGucPrefix),
+		gettext_noop(
+			"Plans every aggregation stage as its own subquery scan named after the stage so "
+			"that explain reports runtime statistics per stage."),
+		NULL, &SeparateAggregationStagesInPlan,
+		DEFAULT_SEPARATE_AGGREGATION_STAGES_IN_PLAN,
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
+
+	DefineCustomIntVariable(
+		psprintf("%s.clusteredCollectionFillFactor", newGucPrefix),
+		gettext_noop(
+			"The fillfactor of the data table of collections created with a clusteredIndex."),
+		NULL, &ClusteredCollectionFillFactor, DEFAULT_CLUSTERED_COLLECTION_FILL_FACTOR,
+		10, 100, PGC_USERSET, 0, NULL, BumpConfigGenerationInt, NULL);
 }
@@ -102,7 +102,7 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_NEXT_COLLECTION_ID, DEFAULT_NEXT_COLLECTION_ID, INT_MAX,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.next_collection_index_id", newGucPrefix),
@@ -119,14 +119,14 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_NEXT_COLLECTION_INDEX_ID, DEFAULT_NEXT_COLLECTION_INDEX_ID, INT_MAX,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.simulateRecoveryState", prefix),
 		gettext_noop(
 			"Simulates a database recovery state and throws an error for read-write operations."),
 		NULL, &SimulateRecoveryState, DEFAULT_SIMULATE_RECOVERY_STATE,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	/* Added variable for testing cursor continuations */
 	DefineCustomIntVariable(
@@ -137,7 +137,7 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_MAX_WORKER_CURSOR_SIZE, 1, BSON_MAX_ALLOWED_SIZE,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableCursorsOnAggregationQueryRewrite", newGucPrefix),
@@ -148,28 +148,28 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_ENABLE_CURSORS_ON_AGGREGATION_QUERY_REWRITE,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableGenerateNonExistsTerm", newGucPrefix),
 		gettext_noop(
 			"Enables generating the non exists term for new documents in a collection."),
 		NULL, &EnableGenerateNonExistsTerm, DEFAULT_ENABLE_GENERATE_NON_EXISTS_TERM,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceIndexTermTruncation", prefix),
 		gettext_noop(
 			"Whether to force the feature for index term truncation"),
 		NULL, &ForceIndexTermTruncation, DEFAULT_FORCE_INDEX_TERM_TRUNCATION,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceWildcardReducedTerm", prefix),
 		gettext_noop(
 			"Whether to force the feature for the wildcard reduced term generation"),
 		NULL, &ForceWildcardReducedTerm, DEFAULT_FORCE_WILDCARD_REDUCED_TERM,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.indexTermLimitOverride", prefix),
@@ -179,14 +179,14 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_INDEX_TRUNCATION_LIMIT_OVERRIDE, 1, INT_MAX,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.useLocalExecutionShardQueries", newGucPrefix),
 		gettext_noop(
 			"Determines whether or not to push local shard queries to the shard directly."),
 		NULL, &UseLocalExecutionShardQueries, DEFAULT_USE_LOCAL_EXECUTION_SHARD_QUERIES,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceLocalExecutionShardQueries", newGucPrefix),
@@ -194,7 +194,7 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 			"Determines whether or not to force all shard queries to be executed locally on the shard."),
 		NULL, &ForceLocalExecutionShardQueries,
 		DEFAULT_FORCE_LOCAL_EXECUTION_SHARD_QUERIES,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.defaultUniqueIndexKeyhashOverride", newGucPrefix),
@@ -204,14 +204,14 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_UNIQUE_INDEX_KEYHASH_OVERIDE, 0, INT_MAX,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableNativeColocation", prefix),
 		gettext_noop(
 			"Determines whether to turn on colocation of tables in a given collection database (and disabled outside the database)"),
 		NULL, &EnableNativeColocation, DEFAULT_ENABLE_NATIVE_COLOCATION,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.test.internalQueryMaxAllowedDensifyDocs", newGucPrefix),
@@ -223,7 +223,7 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_MAX_ALLOWED_DOCS_IN_DENSIFY, 0, INT32_MAX,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomIntVariable(
 		psprintf("%s.test.internalDocumentSourceDensifyMaxMemoryBytes", newGucPrefix),
@@ -235,48 +235,48 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		BSON_MAX_ALLOWED_SIZE_INTERMEDIATE, 0, BSON_MAX_ALLOWED_SIZE_INTERMEDIATE,
 		PGC_USERSET,
 		GUC_NO_SHOW_ALL | GUC_NOT_IN_SAMPLE,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationInt, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.forceDisableSeqScan", newGucPrefix),
 		gettext_noop(
 			"Whether to force disable sequential type scans on the collection."),
 		NULL, &ForceDisableSeqScan, DEFAULT_FORCE_DISABLE_SEQ_SCAN,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.currentOpAddSqlCommand", newGucPrefix),
 		gettext_noop(
 			"Whether to add the SQL command to the current operation view."),
 		NULL, &CurrentOpAddSqlCommand, DEFAULT_CURRENTOP_ADD_SQL_COMMAND,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomStringVariable(
 		psprintf("%s.alternate_index_handler_name", prefix),
 		gettext_noop(
 			"The name of the index handler to use as opposed to rum (currently for testing only)."),
 		NULL, &AlternateIndexHandler, DEFAULT_ALTERNATE_INDEX_HANDLER,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationString, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.logRelationIndexesOrder", newGucPrefix),
 		gettext_noop(
 			"Whether to log the order of indexes in the relation."),
 		NULL, &EnableLogRelationIndexesOrder, DEFAULT_LOG_RELATION_INDEXES_ORDER,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enable_large_unique_index_keys", newGucPrefix),
 		gettext_noop("Whether or not to enable large index keys on unique indexes."),
 		NULL, &DefaultEnableLargeUniqueIndexKeys, DEFAULT_ENABLE_LARGE_UNIQUE_INDEX_KEYS,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableDebugQueryText", newGucPrefix),
 		gettext_noop(
 			"Whether to enable query source text while planning aggregate/find queries for debugging, starts deparsing the query tree and degrades performance."),
 		NULL, &EnableDebugQueryText, DEFAULT_ENABLE_DEBUG_QUERY_TEXT,
-		PGC_USERSET, 0, NULL, NULL, NULL);
+		PGC_USERSET, 0, NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableMultiIndexRumJoin", newGucPrefix),
@@ -287,7 +287,7 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_ENABLE_MULTI_INDEX_RUM_JOIN,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
 
 	DefineCustomBoolVariable(
 		psprintf("%s.enableTTLDescSort", newGucPrefix),
@@ -298,5 +298,5 @@ InitializeTestConfigurations(const char *prefix, const char *newGucPrefix)
 		DEFAULT_ENABLE_TTL_DESC_SORT,
 		PGC_USERSET,
 		0,
-		NULL, NULL, NULL);
+		NULL, BumpConfigGenerationBool, NULL);
 }
@@ -41,6 +41,7 @@
 #include "customscan/bson_custom_query_scan.h"
 #include "index_am/index_am_utils.h"
 #include "index_am/documentdb_rum.h"
+#include "utils/query_memory_budget.h"
 
 
 /* --------------------------------------------------------- */
@@ -556,6 +557,13 @@ ExplainQueryScanExplainCustomScan(CustomScanState *node, List *ancestors,
 	ExplainOpenGroup("custom_scan", "IndexDetails", false, es);
 	WalkAndExplainScanState(&queryScanState->innerScanState->ps, es);
 	ExplainCloseGroup("custom_scan", "IndexDetails", false, es);
+
+	if (es->analyze)
+	{
+		/* The plan is explained once it ran, with the memory of all its stages */
+		ExplainPropertyInteger("peakQueryMemory", "bytes", GetQueryMemoryPeakBytes(),
+							   es);
+	}
 }
 
 
@@ -24,6 +24,7 @@
 #include <miscadmin.h>
 #include <optimizer/paths.h>
 #include <access/ginblock.h>
+#include <utils/hsearch.h>
 
 #if PG_VERSION_NUM >= 180000
 #include <commands/explain_format.h>
@@ -78,6 +79,21 @@ typedef struct InputQueryState
 
 	bool hasQueryTextData;
 	bool hasVectorSearchData;
+
+	/*
+	 * Whether the vector search ranks the few candidate rows exactly rather
+	 * than scanning the vector index.
+	 */
+	bool useExactVectorSearch;
+
+	/*
+	 * Whether this is an adaptive scan: An index scan that switches to a
+	 * sequential scan when it returns far more rows than estimated.
+	 */
+	bool isAdaptiveScan;
+
+	/* The number of rows the planner estimated for the index scan */
+	double adaptiveEstimatedRows;
 } InputQueryState;
 
 
@@ -97,8 +113,48 @@ typedef struct ExtensionQueryScanState
 
 	/* The immutable state for this query */
 	InputQueryState *inputState;
+
+	/*
+	 * The number of candidates the vector index returned: With a compressed
+	 * index these are the candidates rescored on the full vectors.
+	 */
+	uint64 vectorSearchCandidates;
+
+	/* For adaptive scans: The planning state of the sequential scan */
+	Plan *fallbackPlan;
+
+	/* For adaptive scans: The execution state of the sequential scan */
+	ScanState *fallbackScanState;
+
+	/* For adaptive scans: The rows returned by the index scan */
+	uint64 adaptiveIndexRows;
+
+	/* For adaptive scans: The rows after which the index scan is abandoned */
+	uint64 adaptiveSwitchThreshold;
+
+	/* For adaptive scans: Whether the scan switched to the sequential scan */
+	bool adaptiveSwitched;
+
+	/*
+	 * For adaptive scans: The TIDs the index scan returned, skipped by the
+	 * sequential scan after the switch.
+	 */
+	HTAB *adaptiveReturnedTids;
 } ExtensionQueryScanState;
 
+/*
+ * An adaptive scan switches once the index scan returned this many times the
+ * estimated rows (and at least ADAPTIVE_SCAN_MIN_SWITCH_ROWS rows).
+ */
+#define ADAPTIVE_SCAN_ESTIMATE_FACTOR 10
+#define ADAPTIVE_SCAN_MIN_SWITCH_ROWS 1000
+
+/*
+ * The TIDs returned before the switch are kept in memory: The index scan is not
+ * made adaptive when it would have to return more rows than this to switch.
+ */
+#define ADAPTIVE_SCAN_MAX_SWITCH_ROWS 1000000
+
 /* Name needed for Postgres to register a custom scan */
 #define InputContinuationNodeName "ExtensionQueryScanInput"
 
@@ -128,6 +184,7 @@ static bool EqualUnsupportedExtensionQueryScanNode(const struct ExtensibleNode *
 												   const struct ExtensibleNode *b);
 static List * AddCustomPathCore(List *pathList, InputQueryState *queryState);
 static TupleTableSlot * ExtensionQueryScanNext(CustomScanState *node);
+static TupleTableSlot * AdaptiveQueryScanNext(ExtensionQueryScanState *node);
 static bool ExtensionQueryScanNextRecheck(ScanState *state, TupleTableSlot *slot);
 
 
@@ -200,7 +257,12 @@ AddExtensionQueryScanForVectorQuery(PlannerInfo *root, RelOptInfo *rel,
 	rel->pathlist = AddCustomPathForVectorCore(root, rel->pathlist, rel, inputState,
 											   failIfNotFound);
 
-	if (rel->partial_pathlist != NIL)
+	if (inputState->useExactVectorSearch)
+	{
+		/* The partial paths would still go through the vector index */
+		rel->partial_pathlist = NIL;
+	}
+	else if (rel->partial_pathlist != NIL)
 	{
 		failIfNotFound = false;
 		rel->partial_pathlist = AddCustomPathForVectorCore(root,
@@ -229,6 +291,90 @@ AddExtensionQueryScanForTextQuery(PlannerInfo *root, RelOptInfo *rel, RangeTblEn
 }
 
 
+/*
+ * Wraps the plain index scans of the rel in an adaptive scan for when the
+ * estimates of the planner are off: Each index scan is paired with a sequential
+ * scan of the rel and the executor switches to the latter when the index scan
+ * returns far more rows than estimated (see AdaptiveQueryScanNext).
+ * The switch loses the order of the index, so this only applies when the query
+ * needs no order from the scan.
+ */
+void
+AddExtensionQueryScanForAdaptiveScan(PlannerInfo *root, RelOptInfo *rel,
+									 RangeTblEntry *rte)
+{
+	if (rte->rtekind != RTE_RELATION || root->query_pathkeys != NIL ||
+		rel->reloptkind != RELOPT_BASEREL)
+	{
+		return;
+	}
+
+	Path *seqScanPath = NULL;
+	ListCell *cell;
+	foreach(cell, rel->pathlist)
+	{
+		Path *inputPath = lfirst(cell);
+		if (!IsA(inputPath, IndexPath) || inputPath->pathtype != T_IndexScan ||
+			inputPath->param_info != NULL)
+		{
+			continue;
+		}
+
+		double switchRows = Max(inputPath->rows * ADAPTIVE_SCAN_ESTIMATE_FACTOR,
+								ADAPTIVE_SCAN_MIN_SWITCH_ROWS);
+		if (switchRows > ADAPTIVE_SCAN_MAX_SWITCH_ROWS || switchRows >= rel->tuples)
+		{
+			/* Either too many TIDs to track or the index scan can't return enough */
+			continue;
+		}
+
+		if (seqScanPath == NULL)
+		{
+			int parallelWorkers = 0;
+			seqScanPath = create_seqscan_path(root, rel, NULL, parallelWorkers);
+		}
+
+		InputQueryState *inputState = palloc0(sizeof(InputQueryState));
+		inputState->extensible.type = T_ExtensibleNode;
+		inputState->extensible.extnodename = InputContinuationNodeName;
+		inputState->isAdaptiveScan = true;
+		inputState->adaptiveEstimatedRows = inputPath->rows;
+
+		CustomPath *customPath = makeNode(CustomPath);
+		customPath->methods = &ExtensionQueryScanPathMethods;
+
+		Path *path = &customPath->path;
+		path->pathtype = T_CustomScan;
+		path->parent = inputPath->parent;
+		path->param_info = NULL;
+
+		/* The index scan is what runs as long as the estimate holds */
+		path->rows = inputPath->rows;
+		path->startup_cost = inputPath->startup_cost;
+		path->total_cost = inputPath->total_cost;
+
+		/* The TIDs returned before the switch are tracked in this backend only */
+		path->parallel_safe = false;
+		path->pathtarget = inputPath->pathtarget;
+
+		/* The rows are no longer in index order after a switch */
+		path->pathkeys = NIL;
+
+		/* The index scan comes first, the sequential scan second */
+		customPath->custom_paths = list_make2(inputPath, seqScanPath);
+
+#if (PG_VERSION_NUM >= 150000)
+
+		/* necessary to avoid extra Result node in PG15 */
+		customPath->flags = CUSTOMPATH_SUPPORT_PROJECTION;
+#endif
+
+		customPath->custom_private = list_make1(inputState);
+		lfirst(cell) = customPath;
+	}
+}
+
+
 /* --------------------------------------------------------- */
 /* Helper methods exports */
 /* --------------------------------------------------------- */
@@ -340,6 +486,38 @@ AddCustomPathForVectorCore(PlannerInfo *planner, List *pathList, RelOptInfo *rel
 							"Similarity index was not found for a vector similarity search query during planning.")));
 	}
 
+	/*
+	 * When the filters leave only a few candidate rows (e.g. a small tenant of a
+	 * large collection), scanning them and sorting by the exact distance is both
+	 * cheaper and exact. The vector index, with its iterative scan, is kept for
+	 * everything else.
+	 */
+	if (VectorExactSearchMaxCandidateRows > 0 &&
+		rel->rows <= VectorExactSearchMaxCandidateRows)
+	{
+		Path *exactSearchPath = NULL;
+		foreach(cell, pathList)
+		{
+			Path *inputPath = lfirst(cell);
+			if (inputPath == vectorSearchPath)
+			{
+				continue;
+			}
+
+			if (exactSearchPath == NULL ||
+				inputPath->total_cost < exactSearchPath->total_cost)
+			{
+				exactSearchPath = inputPath;
+			}
+		}
+
+		if (exactSearchPath != NULL)
+		{
+			vectorSearchPath = exactSearchPath;
+			queryState->useExactVectorSearch = true;
+		}
+	}
+
 	/* Need to figure out default params */
 	pgbson *searchBson = NULL;
 	if (queryState->querySearchData.SearchParamBson != (Datum) 0)
@@ -351,10 +529,14 @@ AddCustomPathForVectorCore(PlannerInfo *planner, List *pathList, RelOptInfo *rel
 	 * For filtering vector search, if the search param is not specified, searchBson contains the iterative param
 	 * We let index specific handler to decide if the default search param is needed or not
 	 */
-	IndexPath *indexPath = (IndexPath *) vectorSearchPath;
-	pgbson *defaultSearchParam = CalculateSearchParamBsonForIndexPath(indexPath,
-																	  searchBson);
-	queryState->querySearchData.SearchParamBson = PointerGetDatum(defaultSearchParam);
+	if (!queryState->useExactVectorSearch)
+	{
+		IndexPath *indexPath = (IndexPath *) vectorSearchPath;
+		pgbson *defaultSearchParam = CalculateSearchParamBsonForIndexPath(indexPath,
+																		  searchBson);
+		queryState->querySearchData.SearchParamBson = PointerGetDatum(
+			defaultSearchParam);
+	}
 
 	/* wrap the path in a custom path */
 	CustomPath *customPath = makeNode(CustomPath);
@@ -428,8 +610,16 @@ ExtensionQueryScanPlanCustomPath(PlannerInfo *root,
 	cscan->custom_private = best_path->custom_private;
 	cscan->custom_plans = custom_plans;
 
-	/* Only one plan is allowed here */
-	Assert(list_length(custom_plans) == 1);
+	/*
+	 * Only one plan is allowed here, except for adaptive scans which add their
+	 * sequential scan as the second plan. The readers of the plan handle both:
+	 * setrefs and the plan copy go over all of custom_plans, EXPLAIN and the
+	 * plan walkers (e.g. the slow operation log) over all of custom_ps, and the
+	 * scan state only takes the second plan for adaptive scans.
+	 */
+	Assert(list_length(custom_plans) == 1 ||
+		   (list_length(custom_plans) == 2 &&
+			((InputQueryState *) linitial(best_path->custom_private))->isAdaptiveScan));
 
 	/* The main plan comes in first */
 	Plan *nestedPlan = linitial(custom_plans);
@@ -492,6 +682,11 @@ ExtensionQueryScanCreateCustomScanState(CustomScan *cscan)
 	queryScanState->innerPlan = innerPlan;
 
 	queryScanState->inputState = (InputQueryState *) linitial(cscan->custom_private);
+	if (queryScanState->inputState->isAdaptiveScan)
+	{
+		queryScanState->fallbackPlan = (Plan *) lsecond(cscan->custom_plans);
+	}
+
 	return (Node *) cscanstate;
 }
 
@@ -530,6 +725,28 @@ ExtensionQueryScanBeginCustomScan(CustomScanState *node, EState *estate,
 	/* Store the inner state here so that EXPLAIN works */
 	queryScanState->custom_scanstate.custom_ps = list_make1(
 		queryScanState->innerScanState);
+
+	if (queryScanState->inputState->isAdaptiveScan)
+	{
+		queryScanState->fallbackScanState = (ScanState *) ExecInitNode(
+			queryScanState->fallbackPlan, estate, eflags);
+		queryScanState->custom_scanstate.custom_ps =
+			lappend(queryScanState->custom_scanstate.custom_ps,
+					queryScanState->fallbackScanState);
+
+		double switchRows = Max(queryScanState->inputState->adaptiveEstimatedRows *
+								ADAPTIVE_SCAN_ESTIMATE_FACTOR,
+								ADAPTIVE_SCAN_MIN_SWITCH_ROWS);
+		queryScanState->adaptiveSwitchThreshold = (uint64) switchRows;
+
+		HASHCTL hashInfo = { 0 };
+		hashInfo.keysize = sizeof(ItemPointerData);
+		hashInfo.entrysize = sizeof(ItemPointerData);
+		hashInfo.hcxt = CurrentMemoryContext;
+		queryScanState->adaptiveReturnedTids = hash_create(
+			"Adaptive scan returned TIDs", 1024, &hashInfo,
+			HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
 }
 
 
@@ -555,6 +772,10 @@ static TupleTableSlot *
 ExtensionQueryScanNext(CustomScanState *node)
 {
 	ExtensionQueryScanState *extensionScanState = (ExtensionQueryScanState *) node;
+	if (extensionScanState->inputState->isAdaptiveScan)
+	{
+		return AdaptiveQueryScanNext(extensionScanState);
+	}
 
 	/* Fetch a tuple from the underlying scan */
 	TupleTableSlot *slot = extensionScanState->innerScanState->ps.ExecProcNode(
@@ -566,12 +787,86 @@ ExtensionQueryScanNext(CustomScanState *node)
 		return slot;
 	}
 
+	extensionScanState->vectorSearchCandidates++;
+
 	/* Copy the slot onto our own query state for projection */
 	TupleTableSlot *ourSlot = node->ss.ss_ScanTupleSlot;
 	return ExecCopySlot(ourSlot, slot);
 }
 
 
+/*
+ * Gets the TID of the row that the scan returned: Scans that project return a
+ * virtual slot, the TID is then on the scan tuple.
+ */
+inline static ItemPointer
+GetScanSlotTid(ScanState *state, TupleTableSlot *slot)
+{
+	if (state->ps.ps_ExprContext != NULL &&
+		state->ps.ps_ExprContext->ecxt_scantuple != NULL)
+	{
+		return &state->ps.ps_ExprContext->ecxt_scantuple->tts_tid;
+	}
+
+	return &slot->tts_tid;
+}
+
+
+/*
+ * Runs the index scan of an adaptive scan until it has returned
+ * adaptiveSwitchThreshold rows: The estimate was then far off and the index scan
+ * likely visits a large part of the collection with random heap access.
+ * It then switches to the sequential scan, which skips the rows the index scan
+ * already returned.
+ */
+static TupleTableSlot *
+AdaptiveQueryScanNext(ExtensionQueryScanState *node)
+{
+	TupleTableSlot *ourSlot = node->custom_scanstate.ss.ss_ScanTupleSlot;
+	TupleTableSlot *slot;
+	if (!node->adaptiveSwitched)
+	{
+		slot = node->innerScanState->ps.ExecProcNode(
+			(PlanState *) node->innerScanState);
+		if (TupIsNull(slot))
+		{
+			return slot;
+		}
+
+		bool found = false;
+		hash_search(node->adaptiveReturnedTids,
+					GetScanSlotTid(node->innerScanState, slot), HASH_ENTER, &found);
+
+		node->adaptiveIndexRows++;
+		if (node->adaptiveIndexRows >= node->adaptiveSwitchThreshold)
+		{
+			node->adaptiveSwitched = true;
+		}
+
+		return ExecCopySlot(ourSlot, slot);
+	}
+
+	while (true)
+	{
+		CHECK_FOR_INTERRUPTS();
+		slot = node->fallbackScanState->ps.ExecProcNode(
+			(PlanState *) node->fallbackScanState);
+		if (TupIsNull(slot))
+		{
+			return slot;
+		}
+
+		bool found = false;
+		hash_search(node->adaptiveReturnedTids,
+					GetScanSlotTid(node->fallbackScanState, slot), HASH_FIND, &found);
+		if (!found)
+		{
+			return ExecCopySlot(ourSlot, slot);
+		}
+	}
+}
+
+
 static bool
 ExtensionQueryScanNextRecheck(ScanState *state, TupleTableSlot *slot)
 {
@@ -587,6 +882,11 @@ ExtensionQueryScanEndCustomScan(CustomScanState *node)
 	/* reset any scanstate state here */
 	QueryTextData = NULL;
 	ExecEndNode((PlanState *) queryScanState->innerScanState);
+	if (queryScanState->fallbackScanState != NULL)
+	{
+		ExecEndNode((PlanState *) queryScanState->fallbackScanState);
+		hash_destroy(queryScanState->adaptiveReturnedTids);
+	}
 }
 
 
@@ -597,6 +897,22 @@ ExtensionQueryScanReScanCustomScan(CustomScanState *node)
 
 	/* reset any scanstate state here */
 	ExecReScan((PlanState *) queryScanState->innerScanState);
+	if (queryScanState->fallbackScanState != NULL)
+	{
+		/* Start over on the index scan */
+		ExecReScan((PlanState *) queryScanState->fallbackScanState);
+		queryScanState->adaptiveSwitched = false;
+		queryScanState->adaptiveIndexRows = 0;
+
+		HASH_SEQ_STATUS status;
+		ItemPointer entry;
+		hash_seq_init(&status, queryScanState->adaptiveReturnedTids);
+		while ((entry = hash_seq_search(&status)) != NULL)
+		{
+			hash_search(queryScanState->adaptiveReturnedTids, entry, HASH_REMOVE,
+						NULL);
+		}
+	}
 }
 
 
@@ -607,6 +923,11 @@ ExtensionQueryScanExplainCustomScan(CustomScanState *node, List *ancestors,
 	/* Add any scan related information here */
 	/* show the ivfflat probes that were used. */
 	ExtensionQueryScanState *queryScanState = (ExtensionQueryScanState *) node;
+	if (queryScanState->inputState->useExactVectorSearch)
+	{
+		ExplainPropertyText("Vector Search Strategy", "exact", es);
+	}
+
 	if (queryScanState->inputState->hasVectorSearchData &&
 		(pgbson *) queryScanState->inputState->querySearchData.SearchParamBson != NULL)
 	{
@@ -614,6 +935,24 @@ ExtensionQueryScanExplainCustomScan(CustomScanState *node, List *ancestors,
 								(pgbson *) queryScanState->inputState->querySearchData.
 								SearchParamBson), es);
 	}
+
+	if (queryScanState->inputState->isAdaptiveScan)
+	{
+		ExplainPropertyUInteger("Adaptive Switch Rows", NULL,
+								queryScanState->adaptiveSwitchThreshold, es);
+		if (es->analyze)
+		{
+			ExplainPropertyText("Adaptive Scan", queryScanState->adaptiveSwitched ?
+								"sequential" : "index", es);
+		}
+	}
+
+	if (es->analyze && queryScanState->inputState->hasVectorSearchData &&
+		!queryScanState->inputState->useExactVectorSearch)
+	{
+		ExplainPropertyUInteger("Vector Search Candidates", NULL,
+								queryScanState->vectorSearchCandidates, es);
+	}
 }
 
 
@@ -643,6 +982,9 @@ CopyNodeInputQueryState(struct ExtensibleNode *target_node, const struct
 	newNode->extensible.extnodename = InputContinuationNodeName;
 	newNode->hasQueryTextData = from->hasQueryTextData;
 	newNode->hasVectorSearchData = from->hasVectorSearchData;
+	newNode->useExactVectorSearch = from->useExactVectorSearch;
+	newNode->isAdaptiveScan = from->isAdaptiveScan;
+	newNode->adaptiveEstimatedRows = from->adaptiveEstimatedRows;
 	if (from->hasQueryTextData)
 	{
 		newNode->queryTextData.indexOptions = pg_detoast_datum_copy(
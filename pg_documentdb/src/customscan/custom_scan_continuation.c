@@ -177,6 +177,7 @@ const StringView PrimaryKeyShardKey =
 
 extern bool EnableRumIndexScan;
 extern bool EnablePrimaryKeyCursorScan;
+extern bool EnableKeysetCursorContinuation;
 
 #define InputContinuationNodeName "ExtensionScanInputContinuation"
 
@@ -216,6 +217,8 @@ static bool EqualUnsupportedExtensionScanNode(const struct ExtensibleNode *a,
 											  const struct ExtensibleNode *b);
 static Node * ReplaceCursorParamValuesMutator(Node *node, ParamListInfo boundParams);
 static IndexOptInfo * GetPrimaryKeyIndexOpt(RelOptInfo *rel);
+static List * MergePrimaryKeyIndexClauses(List *continuationClauses,
+										 List *queryIndexClauses);
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -662,11 +665,23 @@ UpdatePathsWithExtensionStreamingCursorPlans(PlannerInfo *root, RelOptInfo *rel,
 	{
 		Path *inputPath = lfirst(cell);
 
+		/*
+		 * Index scans on the primary key return documents in primary key order:
+		 * These resume from the last primary key returned (keyset continuation)
+		 * instead of being converted to bitmap scans that re-scan every page.
+		 */
+		bool isPrimaryKeyIndexScan = false;
 		if (inputPath->pathtype == T_IndexScan)
 		{
 			IndexPath *indexPath = (IndexPath *) inputPath;
 			bool isIndexPathCostZero = inputPath->total_cost == 0;
-			if (indexPath->indexinfo->amhasgetbitmap)
+			if (EnableKeysetCursorContinuation && EnablePrimaryKeyCursorScan &&
+				IsBtreePrimaryKeyIndex(indexPath->indexinfo) &&
+				ScanDirectionIsForward(indexPath->indexscandir))
+			{
+				isPrimaryKeyIndexScan = true;
+			}
+			else if (indexPath->indexinfo->amhasgetbitmap)
 			{
 				inputPath = (Path *) create_bitmap_heap_path(root, rel,
 															 inputPath,
@@ -718,6 +733,12 @@ UpdatePathsWithExtensionStreamingCursorPlans(PlannerInfo *root, RelOptInfo *rel,
 
 			List *primaryKeyIndexClauses = BuildPrimaryKeyIndexClauses(root, rel,
 																	   &scanState);
+			if (isPrimaryKeyIndexScan)
+			{
+				/* Keep the query's own bounds on the primary key */
+				primaryKeyIndexClauses = MergePrimaryKeyIndexClauses(
+					primaryKeyIndexClauses, ((IndexPath *) inputPath)->indexclauses);
+			}
 
 			inputPath = (Path *) create_index_path(
 				root, info, primaryKeyIndexClauses, NIL, NIL, NIL, ForwardScanDirection,
@@ -725,6 +746,10 @@ UpdatePathsWithExtensionStreamingCursorPlans(PlannerInfo *root, RelOptInfo *rel,
 				1, false);
 			inputContinuation->isPrimaryKeyScan = true;
 		}
+		else if (isPrimaryKeyIndexScan)
+		{
+			inputContinuation->isPrimaryKeyScan = true;
+		}
 		else if (inputPath->pathtype == T_SeqScan)
 		{
 			/* See if we can convert to primary key scan */
@@ -1773,3 +1798,34 @@ BuildPrimaryKeyIndexClauses(PlannerInfo *root, RelOptInfo *rel, ExtensionScanSta
 
 	return list_make1(shardKeyClause);
 }
+
+
+/*
+ * Combines the index clauses of the query on the primary key index with the
+ * (shard_key_value, object_id) > (last returned) clause of the continuation.
+ * Index clauses must be ordered by index column: The continuation clause leads on
+ * the shard key column, so it goes after the query's shard key clauses and before
+ * the clauses on object_id.
+ */
+static List *
+MergePrimaryKeyIndexClauses(List *continuationClauses, List *queryIndexClauses)
+{
+	List *shardKeyClauses = NIL;
+	List *objectIdClauses = NIL;
+	ListCell *cell;
+	foreach(cell, queryIndexClauses)
+	{
+		IndexClause *clause = lfirst_node(IndexClause, cell);
+		if (clause->indexcol == 0)
+		{
+			shardKeyClauses = lappend(shardKeyClauses, clause);
+		}
+		else
+		{
+			objectIdClauses = lappend(objectIdClauses, clause);
+		}
+	}
+
+	return list_concat(list_concat(shardKeyClauses, continuationClauses),
+					   objectIdClauses);
+}
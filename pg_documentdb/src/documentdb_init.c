@@ -14,6 +14,7 @@
 #include <postmaster/bgworker.h>
 #include <storage/ipc.h>
 #include <storage/shmem.h>
+#include <catalog/pg_type.h>
 
 #include "documentdb_api_init.h"
 #include "metadata/metadata_guc.h"
@@ -24,18 +25,29 @@
 #include "utils/feature_counter.h"
 #include "utils/version_utils.h"
 #include "vector/vector_spec.h"
+#include "vector/vector_search_calibration.h"
 #include "commands/commands_common.h"
 #include "configs/config_initialization.h"
 #include "index_am/documentdb_rum.h"
 #include "infrastructure/cursor_store.h"
+#include "infrastructure/documentdb_plan_cache.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/slow_operation_log.h"
+#include "infrastructure/collection_join_stats.h"
+#include "infrastructure/query_shape_stats.h"
+#include "infrastructure/tailable_cursor_notifications.h"
 #include "background_worker/background_worker_job.h"
 #include "index_am/roaring_bitmap_adapter.h"
+#include "operators/bson_expression.h"
 
 /* --------------------------------------------------------- */
 /* Data Types & Enum values */
 /* --------------------------------------------------------- */
 
 extern bool EnableBackgroundWorker;
+extern int RetryRecordRetentionSeconds;
+extern double ClusteredCollectionMinCorrelation;
+extern int DeferredDropMaxRelationsPerRun;
 static shmem_startup_hook_type prev_shmem_startup_hook = NULL;
 static shmem_request_hook_type prev_shmem_request_hook = NULL;
 
@@ -99,6 +111,15 @@ InstallDocumentDBApiPostgresHooks(void)
 	ExtensionPreviousGetRelationInfoHook = get_relation_info_hook;
 	get_relation_info_hook = ExtensionGetRelationInfoHook;
 
+	ExtensionPreviousCreateUpperPathsHook = create_upper_paths_hook;
+	create_upper_paths_hook = ExtensionCreateUpperPathsHook;
+
+	ExtensionPreviousSetJoinPathlistHook = set_join_pathlist_hook;
+	set_join_pathlist_hook = ExtensionSetJoinPathlistHook;
+
+	/* record the queries of slow commands in the slow operation log */
+	InstallSlowOperationLogHooks();
+
 	RegisterXactCallback(DocumentDBTransactionCallback, NULL);
 	RegisterSubXactCallback(DocumentDBSubTransactionCallback, NULL);
 
@@ -160,6 +181,14 @@ UninstallDocumentDBApiPostgresHooks(void)
 	get_relation_info_hook = ExtensionPreviousGetRelationInfoHook;
 	ExtensionPreviousGetRelationInfoHook = NULL;
 
+	create_upper_paths_hook = ExtensionPreviousCreateUpperPathsHook;
+	ExtensionPreviousCreateUpperPathsHook = NULL;
+
+	set_join_pathlist_hook = ExtensionPreviousSetJoinPathlistHook;
+	ExtensionPreviousSetJoinPathlistHook = NULL;
+
+	UninstallSlowOperationLogHooks();
+
 	UnregisterXactCallback(DocumentDBTransactionCallback, NULL);
 	UnregisterSubXactCallback(DocumentDBSubTransactionCallback, NULL);
 }
@@ -190,6 +219,101 @@ InitializeBackgroundWorkerJobAllowedCommands(void)
 		.name = "build_index_background", .schema = ApiInternalSchemaName
 	};
 	RegisterBackgroundWorkerJobAllowedCommand(buildIndexConcurrently);
+
+	BackgroundWorkerJobCommand expiredRetryRecords = {
+		.name = "delete_expired_retry_records_background", .schema = ApiInternalSchemaName
+	};
+	RegisterBackgroundWorkerJobAllowedCommand(expiredRetryRecords);
+
+	/*
+	 * Retry records are only pruned when a retention is set at startup: the job
+	 * itself still checks the (reloadable) retention on every run.
+	 */
+	if (RetryRecordRetentionSeconds > 0)
+	{
+		BackgroundWorkerJob retryRecordPruneJob = {
+			.jobId = 1,
+			.jobName = "documentdb_retry_record_pruning",
+			.command = expiredRetryRecords,
+			.argument = { .argType = INT4OID, .argValue = NULL, .isNull = true },
+			.get_schedule_interval_in_seconds_hook = NULL,
+			.timeoutInSeconds = 60,
+			.toBeExecutedOnMetadataCoordinatorOnly = true,
+			.priority = 0,
+			.maxConcurrentExecutions = 1
+		};
+		RegisterBackgroundWorkerJob(retryRecordPruneJob);
+	}
+
+	BackgroundWorkerJobCommand reclusterCollections = {
+		.name = "recluster_collections_background", .schema = ApiInternalSchemaName
+	};
+	RegisterBackgroundWorkerJobAllowedCommand(reclusterCollections);
+
+	/* Clustered collections are only reclustered when a threshold is set at startup */
+	if (ClusteredCollectionMinCorrelation > 0)
+	{
+		BackgroundWorkerJob reclusterJob = {
+			.jobId = 2,
+			.jobName = "documentdb_recluster_collections",
+			.command = reclusterCollections,
+			.argument = { .argType = INT4OID, .argValue = NULL, .isNull = true },
+			.get_schedule_interval_in_seconds_hook = NULL,
+			.timeoutInSeconds = 3600,
+			.toBeExecutedOnMetadataCoordinatorOnly = true,
+			.priority = 0,
+			.maxConcurrentExecutions = 1
+		};
+		RegisterBackgroundWorkerJob(reclusterJob);
+	}
+
+	BackgroundWorkerJobCommand calibrateVectorIndexes = {
+		.name = "calibrate_vector_indexes_background", .schema = ApiInternalSchemaNameV2
+	};
+	RegisterBackgroundWorkerJobAllowedCommand(calibrateVectorIndexes);
+
+	/*
+	 * Vector indexes are only calibrated when a sample size is set at startup.
+	 * Each node calibrates the indexes of its own shards.
+	 */
+	if (VectorSearchCalibrationSampleSize > 0)
+	{
+		BackgroundWorkerJob calibrationJob = {
+			.jobId = 3,
+			.jobName = "documentdb_vector_search_calibration",
+			.command = calibrateVectorIndexes,
+			.argument = { .argType = INT4OID, .argValue = NULL, .isNull = true },
+			.get_schedule_interval_in_seconds_hook = NULL,
+			.timeoutInSeconds = 3600,
+			.toBeExecutedOnMetadataCoordinatorOnly = false,
+			.priority = 0,
+			.maxConcurrentExecutions = 1
+		};
+		RegisterBackgroundWorkerJob(calibrationJob);
+	}
+
+	BackgroundWorkerJobCommand dropDeferredRelations = {
+		.name = "drop_deferred_relations_background", .schema = ApiInternalSchemaNameV2
+	};
+	RegisterBackgroundWorkerJobAllowedCommand(dropDeferredRelations);
+
+	/*
+	 * The job is registered even if drops are not deferred at startup, since the
+	 * GUC can be changed later and relations deferred before it was turned off
+	 * still need to be dropped.
+	 */
+	BackgroundWorkerJob dropDeferredRelationsJob = {
+		.jobId = 4,
+		.jobName = "documentdb_drop_deferred_relations",
+		.command = dropDeferredRelations,
+		.argument = { .argType = INT4OID, .argValue = NULL, .isNull = true },
+		.get_schedule_interval_in_seconds_hook = NULL,
+		.timeoutInSeconds = 600,
+		.toBeExecutedOnMetadataCoordinatorOnly = true,
+		.priority = 0,
+		.maxConcurrentExecutions = 1
+	};
+	RegisterBackgroundWorkerJob(dropDeferredRelationsJob);
 }
 
 
@@ -207,8 +331,17 @@ DocumentDBSharedMemoryRequest(void)
 
 	/* Request ShMem from modules below */
 	RequestAddinShmemSpace(SharedFeatureCounterShmemSize());
+	RequestAddinShmemSpace(CommandLatencyShmemSize());
 	RequestAddinShmemSpace(VersionCacheShmemSize());
 	RequestAddinShmemSpace(FileCursorShmemSize());
+	RequestAddinShmemSpace(QueryPlanCacheShmemSize());
+	RequestAddinShmemSpace(CommandActivityShmemSize());
+	RequestAddinShmemSpace(SlowOperationLogShmemSize());
+	RequestAddinShmemSpace(CollectionJoinStatsShmemSize());
+	RequestAddinShmemSpace(QueryShapeStatsShmemSize());
+	RequestAddinShmemSpace(VectorSearchCalibrationShmemSize());
+	RequestAddinShmemSpace(TailableCursorNotificationsShmemSize());
+	RequestAddinShmemSpace(BackgroundWorkerShmemSize());
 }
 
 
@@ -217,8 +350,17 @@ DocumentDBSharedMemoryInit(void)
 {
 	/* CODESYNC: With Shmem request above */
 	SharedFeatureCounterShmemInit();
+	CommandLatencyShmemInit();
 	InitializeVersionCache();
 	InitializeFileCursorShmem();
+	InitializeQueryPlanCacheShmem();
+	InitializeCommandActivityShmem();
+	InitializeSlowOperationLogShmem();
+	InitializeCollectionJoinStatsShmem();
+	InitializeQueryShapeStatsShmem();
+	InitializeVectorSearchCalibrationShmem();
+	InitializeTailableCursorNotificationsShmem();
+	BackgroundWorkerShmemInit();
 
 	if (prev_shmem_startup_hook != NULL)
 	{
@@ -232,11 +374,28 @@ DocumentDBTransactionCallback(XactEvent event, void *arg)
 {
 	switch (event)
 	{
+		case XACT_EVENT_COMMIT:
+		{
+			bool isCommit = true;
+			ProcessPendingCollectionWriteNotifications(isCommit);
+			break;
+		}
+
+		case XACT_EVENT_PREPARE:
+		{
+			bool isCommit = false;
+			ProcessPendingCollectionWriteNotifications(isCommit);
+			break;
+		}
+
 		case XACT_EVENT_ABORT:
 		case XACT_EVENT_PARALLEL_ABORT:
 		{
+			bool isCommit = false;
+			ProcessPendingCollectionWriteNotifications(isCommit);
 			ConnMgrTryCancelActiveConnection();
 			DeletePendingCursorFiles();
+			ResetExpressionEvaluationArena();
 			break;
 		}
 
@@ -257,6 +416,7 @@ DocumentDBSubTransactionCallback(SubXactEvent event, SubTransactionId mySubid,
 		case SUBXACT_EVENT_ABORT_SUB:
 		{
 			ConnMgrTryCancelActiveConnection();
+			ResetExpressionEvaluationArena();
 			break;
 		}
 
@@ -319,6 +319,16 @@ BsonValueGetBox(const bson_value_t *shapePointValue, ShapeOperatorInfo *opInfo)
 		return DatumWithDefaultSRID(lineStringDatum);
 	}
 
+	if (opInfo != NULL)
+	{
+		DollarBoxOperatorState *state = palloc0(sizeof(DollarBoxOperatorState));
+		state->xMin = Min(box.xBottomLeft, box.xUpperRight);
+		state->yMin = Min(box.yBottomLeft, box.yUpperRight);
+		state->xMax = Max(box.xBottomLeft, box.xUpperRight);
+		state->yMax = Max(box.yBottomLeft, box.yUpperRight);
+		opInfo->opState = (ShapeOperatorState *) state;
+	}
+
 	/* Return geometry of the box with default SRID, this returns a Polygon */
 	return OidFunctionCall5(PostgisMakeEnvelopeFunctionId(),
 							Float8GetDatum(box.xBottomLeft),
@@ -467,6 +477,7 @@ BsonValueGetCenter(const bson_value_t *shapeValue, ShapeOperatorInfo *opInfo)
 	BsonValueInitIterator(shapeValue, &centerValueIter);
 	int16 index = 0;
 	Datum centerPoint = 0;
+	Point center = { 0 };
 	double radius = 0.0;
 	while (bson_iter_next(&centerValueIter))
 	{
@@ -499,6 +510,7 @@ BsonValueGetCenter(const bson_value_t *shapeValue, ShapeOperatorInfo *opInfo)
 
 				ParseBsonValueAsPoint(value, throwError, &errCtxt, &point);
 				centerPoint = GetLegacyPointDatum(point.x, point.y);
+				center = point;
 			}
 		}
 
@@ -550,6 +562,8 @@ BsonValueGetCenter(const bson_value_t *shapeValue, ShapeOperatorInfo *opInfo)
 	DollarCenterOperatorState *state = palloc0(sizeof(DollarCenterOperatorState));
 	state->isRadiusInfinite = false;
 	state->radius = radius;
+	state->centerX = center.x;
+	state->centerY = center.y;
 	opInfo->opState = (ShapeOperatorState *) state;
 
 	if (opInfo->queryStage == QueryStage_INDEX)
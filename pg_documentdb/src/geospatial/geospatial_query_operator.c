@@ -13,6 +13,7 @@
 #include <nodes/makefuncs.h>
 #include <utils/builtins.h>
 #include <utils/guc.h>
+#include <math.h>
 
 #include "io/bson_core.h"
 #include "io/pgbsonelement.h"
@@ -24,6 +25,7 @@
 #include "utils/query_utils.h"
 #include "utils/fmgr_utils.h"
 
+extern bool EnableGeospatialPointFastPath;
 
 /*
  * RuntimeBsonGeospatialState is the runtime state for the geospatial query operators
@@ -74,6 +76,7 @@ static void FillFmgrInfoForGeoWithin(const ShapeOperator *shapeOperator,
 									 RuntimeBsonGeospatialState *runtimeState);
 
 /*================= Operator Execution functions =======================*/
+static bool TryGetPointFromWKB(const StringInfo wkbBuffer, Point *point);
 static bool ContinueIfMatched(void *state);
 static void VisitSingleGeometryForGeoWithin(const WKBGeometryConst *geometryConst,
 											void *state);
@@ -477,6 +480,14 @@ CompareGeoDatumsForDollarCenter(const ProcessCommonGeospatialState *state,
 				return true;
 			}
 
+			/* Points are compared on their coordinates the same way ST_DWithin does */
+			Point point;
+			if (EnableGeospatialPointFastPath && TryGetPointFromWKB(buffer, &point))
+			{
+				return hypot(point.x - centerState->centerX,
+							 point.y - centerState->centerY) <= centerState->radius;
+			}
+
 			bytea *wkbBytea = WKBBufferGetByteaWithSRID(buffer);
 			Datum documentGeo = GetGeometryFromWKB(wkbBytea);
 			pfree(wkbBytea);
@@ -528,6 +539,22 @@ static bool
 CompareForGeoWithinDatum(const ProcessCommonGeospatialState *state, StringInfo wkbBuffer)
 {
 	GeospatialType type = state->geospatialType;
+
+	/*
+	 * A point covered by a $box is a match when it's within the bounds, including
+	 * the boundary: Skip building the geometry for it.
+	 */
+	Point point;
+	if (EnableGeospatialPointFastPath && type == GeospatialType_Geometry &&
+		state->opInfo != NULL && state->opInfo->op == GeospatialShapeOperator_BOX &&
+		state->opInfo->opState != NULL && TryGetPointFromWKB(wkbBuffer, &point))
+	{
+		DollarBoxOperatorState *boxState =
+			(DollarBoxOperatorState *) state->opInfo->opState;
+		return point.x >= boxState->xMin && point.x <= boxState->xMax &&
+			   point.y >= boxState->yMin && point.y <= boxState->yMax;
+	}
+
 	WKBGeometryType wkbType = *(int32 *) (wkbBuffer->data + WKB_BYTE_SIZE_ORDER);
 	if (!IsWKBCollectionType(wkbType) || type == GeospatialType_Geometry)
 	{
@@ -542,6 +569,30 @@ CompareForGeoWithinDatum(const ProcessCommonGeospatialState *state, StringInfo w
 }
 
 
+/*
+ * Reads the coordinates of the buffer if it holds a single point.
+ */
+static bool
+TryGetPointFromWKB(const StringInfo wkbBuffer, Point *point)
+{
+	if (wkbBuffer->len != WKB_BYTE_SIZE_ORDER + WKB_BYTE_SIZE_TYPE + WKB_BYTE_SIZE_POINT)
+	{
+		return false;
+	}
+
+	WKBGeometryType wkbType;
+	memcpy(&wkbType, wkbBuffer->data + WKB_BYTE_SIZE_ORDER, WKB_BYTE_SIZE_TYPE);
+	if (wkbType != WKBGeometryType_Point)
+	{
+		return false;
+	}
+
+	memcpy(point, wkbBuffer->data + WKB_BYTE_SIZE_ORDER + WKB_BYTE_SIZE_TYPE,
+		   WKB_BYTE_SIZE_POINT);
+	return true;
+}
+
+
 /*
  * Continue traversing a buffer if the runtime matcher indicates match
  */
@@ -21,6 +21,8 @@
 #include "math.h"
 #include <commands/explain.h>
 #include <access/gin.h>
+#include <optimizer/cost.h>
+#include <utils/spccache.h>
 
 #if PG_VERSION_NUM >= 180000
 #include <commands/explain_state.h>
@@ -42,6 +44,8 @@ extern bool ForceUseIndexIfAvailable;
 extern bool EnableIndexOrderbyPushdown;
 extern bool EnableIndexOnlyScan;
 extern bool EnableIndexOrderbyPushdownLegacy;
+extern bool EnableCompositeIndexSkipScan;
+extern bool EnableOrderedIndexScanStartupCost;
 extern const RumIndexArrayStateFuncs RoaringStateFuncs;
 
 bool RumHasMultiKeyPaths = false;
@@ -95,6 +99,9 @@ static bool MatchClauseWithIndexForFuncExpr(IndexPath *path, int32_t indexcol,
 static bool ValidateMatchForOrderbyQuals(IndexPath *path);
 
 static bool IsTextIndexMatch(IndexPath *path);
+static void AddCompositeIndexSkipScanCost(IndexPath *path, Cost *indexTotalCost);
+static void SetOrderedIndexScanStartupCost(IndexPath *path, Cost *indexStartupCost,
+										   Cost indexTotalCost);
 
 static IndexMultiKeyStatus CheckIndexHasArrays(Relation indexRelation,
 											   IndexAmRoutine *coreRoutine);
@@ -472,6 +479,7 @@ extension_rumcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		return;
 	}
 
+	bool isCompositeSkipScan = false;
 	if (IsCompositeOpFamilyOid(path->indexinfo->relam,
 							   path->indexinfo->opfamily[0]))
 	{
@@ -483,9 +491,17 @@ extension_rumcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 		/* If this is a composite index, then we need to ensure that
 		 * the first column of the index matches the query path.
 		 * This is because using the composite index would require specifying
-		 * the first column.
+		 * the first column - unless the scan can skip over the leading column:
+		 * The composite term transform generates a skip bound past each
+		 * leading value's range so the scan seeks into each one for the later
+		 * column filters.
 		 */
-		if (!firstColumnSpecified)
+		if (!firstColumnSpecified && EnableCompositeIndexSkipScan &&
+			path->indexclauses != NIL)
+		{
+			isCompositeSkipScan = true;
+		}
+		else if (!firstColumnSpecified)
 		{
 			*indexStartupCost = 0;
 			*indexTotalCost = INFINITY;
@@ -498,6 +514,17 @@ extension_rumcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 	gincostestimate(root, path, loop_count, indexStartupCost, indexTotalCost,
 					indexSelectivity, indexCorrelation, indexPages);
 
+	if (isCompositeSkipScan)
+	{
+		AddCompositeIndexSkipScanCost(path, indexTotalCost);
+	}
+
+	if (EnableOrderedIndexScanStartupCost && path->indexorderbys != NIL &&
+		IsCompositeOpFamilyOid(path->indexinfo->relam, path->indexinfo->opfamily[0]))
+	{
+		SetOrderedIndexScanStartupCost(path, indexStartupCost, *indexTotalCost);
+	}
+
 	/* Do a pass to check for text indexes (We force push down with cost == 0) */
 	if (ForceUseIndexIfAvailable || IsTextIndexMatch(path))
 	{
@@ -507,6 +534,53 @@ extension_rumcostestimate(PlannerInfo *root, IndexPath *path, double loop_count,
 }
 
 
+/*
+ * A skip scan over the leading column of a composite index pays a descent into
+ * the index for every distinct value of the leading column. There are no per path
+ * statistics on the documents, so the number of distinct values is estimated the
+ * way the planner does for columns without stats (DEFAULT_NUM_DISTINCT), bounded by
+ * the number of index entries. This keeps the skip scan for large collections with
+ * selective filters on the later columns, and leaves small ones to the SeqScan.
+ */
+static void
+AddCompositeIndexSkipScanCost(IndexPath *path, Cost *indexTotalCost)
+{
+	double indexTuples = Max(path->indexinfo->tuples, 1.0);
+	double numLeadingValues = Min(indexTuples, DEFAULT_NUM_DISTINCT);
+
+	double randomPageCost;
+	get_tablespace_page_costs(path->indexinfo->reltablespace, &randomPageCost, NULL);
+
+	/* Each seek reads a page and compares its way down to the next range */
+	Cost descentCost = randomPageCost + ceil(log(indexTuples) / log(2.0)) *
+					   cpu_operator_cost;
+	*indexTotalCost += numLeadingValues * descentCost;
+}
+
+
+/*
+ * The gin cost estimate charges reading all the matching entries and posting
+ * lists up front since GIN only returns bitmaps. An order by pushed to a composite
+ * index streams tuples in key order instead, so the first tuple only needs a
+ * descent to the first matching entry. Charging only that as startup lets a
+ * LIMIT over the sort pick the ordered index scan for the fraction it reads.
+ */
+static void
+SetOrderedIndexScanStartupCost(IndexPath *path, Cost *indexStartupCost,
+							   Cost indexTotalCost)
+{
+	double indexTuples = Max(path->indexinfo->tuples, 1.0);
+
+	double randomPageCost;
+	get_tablespace_page_costs(path->indexinfo->reltablespace, &randomPageCost, NULL);
+
+	/* One entry page and one posting page, compared to the first match */
+	Cost descentCost = 2 * randomPageCost + ceil(log(indexTuples) / log(2.0)) *
+					   cpu_operator_cost;
+	*indexStartupCost = Min(descentCost, indexTotalCost);
+}
+
+
 /*
  * Currently orderby pushdown only works for RUM indexes if enabled.
  * However, orderby also requires that the index is
@@ -0,0 +1,264 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/infrastructure/collection_join_stats.c
+ *
+ * Shared memory counts of the pairs of collections joined by $lookup,
+ * $graphLookup and $unionWith. Distributed deployments use these to find
+ * the unsharded collections that would benefit from being colocated.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <funcapi.h>
+#include <common/hashfn.h>
+#include <miscadmin.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/builtins.h>
+#include <utils/timestamp.h>
+
+#include "infrastructure/collection_join_stats.h"
+
+/* The number of pairs tracked: Joins of new pairs are dropped once full */
+#define MAX_COLLECTION_JOIN_ENTRIES 1024
+
+/*
+ * The joins between two collections. The pair is stored with the collection
+ * running the stage as the source, and the joined collection as the target.
+ * Collection ids are only unique within a database, so the database is part
+ * of the key.
+ */
+typedef struct CollectionJoinEntry
+{
+	Oid databaseId;
+
+	/* 0 if the entry is unused */
+	uint64 sourceCollectionId;
+
+	uint64 targetCollectionId;
+
+	uint64 joinCount;
+
+	TimestampTz lastJoinTime;
+} CollectionJoinEntry;
+
+typedef struct CollectionJoinStatsData
+{
+	int trancheId;
+
+	char *trancheName;
+
+	LWLock lock;
+
+	CollectionJoinEntry entries[MAX_COLLECTION_JOIN_ENTRIES];
+} CollectionJoinStatsData;
+
+extern bool EnableCollectionJoinStats;
+
+static CollectionJoinStatsData *CollectionJoinStats = NULL;
+
+static Tuplestorestate * SetupCollectionJoinStatsTuplestore(FunctionCallInfo fcinfo,
+															TupleDesc *tupleDescriptor);
+static inline uint32 CollectionJoinHash(Oid databaseId, uint64 sourceCollectionId,
+										uint64 targetCollectionId);
+
+PG_FUNCTION_INFO_V1(get_collection_join_stats);
+
+
+Size
+CollectionJoinStatsShmemSize(void)
+{
+	return sizeof(CollectionJoinStatsData);
+}
+
+
+/*
+ * InitializeCollectionJoinStatsShmem initializes the shared memory counts
+ * of collection joins.
+ */
+void
+InitializeCollectionJoinStatsShmem(void)
+{
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	CollectionJoinStats =
+		(CollectionJoinStatsData *) ShmemInitStruct("DocumentDB Collection Join Stats",
+													CollectionJoinStatsShmemSize(),
+													&found);
+
+	if (!found)
+	{
+		memset(CollectionJoinStats, 0, CollectionJoinStatsShmemSize());
+		CollectionJoinStats->trancheId = LWLockNewTrancheId();
+		CollectionJoinStats->trancheName = "Collection Join Stats Tranche";
+		LWLockRegisterTranche(CollectionJoinStats->trancheId,
+							  CollectionJoinStats->trancheName);
+
+		LWLockInitialize(&CollectionJoinStats->lock, CollectionJoinStats->trancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * Counts a join of the target collection from a stage running on the source
+ * collection. The pairs are kept in an open addressed table hashed on the
+ * database and the collection ids.
+ */
+void
+RecordCollectionJoin(uint64 sourceCollectionId, uint64 targetCollectionId)
+{
+	if (!EnableCollectionJoinStats || CollectionJoinStats == NULL ||
+		sourceCollectionId == 0 || targetCollectionId == 0 ||
+		sourceCollectionId == targetCollectionId)
+	{
+		return;
+	}
+
+	uint32 hash = CollectionJoinHash(MyDatabaseId, sourceCollectionId,
+									 targetCollectionId);
+	TimestampTz now = GetCurrentTimestamp();
+
+	LWLockAcquire(&CollectionJoinStats->lock, LW_EXCLUSIVE);
+	for (int i = 0; i < MAX_COLLECTION_JOIN_ENTRIES; i++)
+	{
+		CollectionJoinEntry *entry =
+			&CollectionJoinStats->entries[(hash + i) % MAX_COLLECTION_JOIN_ENTRIES];
+		if (entry->sourceCollectionId == 0)
+		{
+			entry->databaseId = MyDatabaseId;
+			entry->sourceCollectionId = sourceCollectionId;
+			entry->targetCollectionId = targetCollectionId;
+		}
+		else if (entry->databaseId != MyDatabaseId ||
+				 entry->sourceCollectionId != sourceCollectionId ||
+				 entry->targetCollectionId != targetCollectionId)
+		{
+			continue;
+		}
+
+		entry->joinCount++;
+		entry->lastJoinTime = now;
+		break;
+	}
+	LWLockRelease(&CollectionJoinStats->lock);
+}
+
+
+/*
+ * get_collection_join_stats returns the counted joins of the current database
+ * as rows of (source_collection_id, target_collection_id, join_count,
+ * last_join_time). With reset, the counts of the database are cleared after
+ * they are read.
+ */
+Datum
+get_collection_join_stats(PG_FUNCTION_ARGS)
+{
+	bool resetAfterRead = PG_GETARG_BOOL(0);
+
+	TupleDesc tupleDescriptor;
+	Tuplestorestate *tupleStore = SetupCollectionJoinStatsTuplestore(fcinfo,
+																	 &tupleDescriptor);
+	if (CollectionJoinStats == NULL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	CollectionJoinEntry *entries = palloc(sizeof(CollectionJoinStats->entries));
+	LWLockAcquire(&CollectionJoinStats->lock,
+				  resetAfterRead ? LW_EXCLUSIVE : LW_SHARED);
+	memcpy(entries, CollectionJoinStats->entries, sizeof(CollectionJoinStats->entries));
+	if (resetAfterRead)
+	{
+		/*
+		 * Clearing entries in the middle of a probe sequence would hide the pairs
+		 * after them, so rebuild the table with the entries of other databases.
+		 */
+		memset(CollectionJoinStats->entries, 0, sizeof(CollectionJoinStats->entries));
+		for (int i = 0; i < MAX_COLLECTION_JOIN_ENTRIES; i++)
+		{
+			if (entries[i].sourceCollectionId == 0 ||
+				entries[i].databaseId == MyDatabaseId)
+			{
+				continue;
+			}
+
+			uint32 hash = CollectionJoinHash(entries[i].databaseId,
+											 entries[i].sourceCollectionId,
+											 entries[i].targetCollectionId);
+			for (int j = 0; j < MAX_COLLECTION_JOIN_ENTRIES; j++)
+			{
+				CollectionJoinEntry *entry =
+					&CollectionJoinStats->entries[(hash + j) %
+												  MAX_COLLECTION_JOIN_ENTRIES];
+				if (entry->sourceCollectionId == 0)
+				{
+					*entry = entries[i];
+					break;
+				}
+			}
+		}
+	}
+	LWLockRelease(&CollectionJoinStats->lock);
+
+	Datum values[4];
+	bool isNulls[4] = { false, false, false, false };
+	for (int i = 0; i < MAX_COLLECTION_JOIN_ENTRIES; i++)
+	{
+		if (entries[i].sourceCollectionId == 0 ||
+			entries[i].databaseId != MyDatabaseId)
+		{
+			continue;
+		}
+
+		values[0] = Int64GetDatum((int64) entries[i].sourceCollectionId);
+		values[1] = Int64GetDatum((int64) entries[i].targetCollectionId);
+		values[2] = Int64GetDatum((int64) entries[i].joinCount);
+		values[3] = TimestampTzGetDatum(entries[i].lastJoinTime);
+		tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * Sets up a basic TupleStore for the collection join stats.
+ */
+static Tuplestorestate *
+SetupCollectionJoinStatsTuplestore(FunctionCallInfo fcinfo, TupleDesc *tupleDescriptor)
+{
+	ReturnSetInfo *resultSet = (ReturnSetInfo *) fcinfo->resultinfo;
+	if (get_call_result_type(fcinfo, NULL, tupleDescriptor) != TYPEFUNC_COMPOSITE)
+	{
+		elog(ERROR, "return type must be a row type");
+	}
+
+	MemoryContext perQueryContext = resultSet->econtext->ecxt_per_query_memory;
+
+	MemoryContext oldContext = MemoryContextSwitchTo(perQueryContext);
+	Tuplestorestate *tupstore = tuplestore_begin_heap(true, false, work_mem);
+	resultSet->returnMode = SFRM_Materialize;
+	resultSet->setResult = tupstore;
+	resultSet->setDesc = *tupleDescriptor;
+	MemoryContextSwitchTo(oldContext);
+
+	return tupstore;
+}
+
+
+/*
+ * The position of a pair in the open addressed table of joins.
+ */
+static inline uint32
+CollectionJoinHash(Oid databaseId, uint64 sourceCollectionId, uint64 targetCollectionId)
+{
+	uint32 hash = hash_combine(hash_bytes_uint32((uint32) sourceCollectionId),
+							   hash_bytes_uint32((uint32) targetCollectionId));
+	return hash_combine(hash, hash_bytes_uint32((uint32) databaseId));
+}
@@ -0,0 +1,224 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/infrastructure/command_activity.c
+ *
+ * A shared memory array with a slot per backend where each backend publishes
+ * the command it runs. currentOp reads the slots instead of detecting the
+ * command and the collection from the query text and the locks it holds.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <miscadmin.h>
+#include <access/xact.h>
+#include <port/atomics.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/proc.h>
+#include <storage/shmem.h>
+
+#include "io/bson_core.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/query_shape_stats.h"
+
+/*
+ * The slot of a backend. Only the owning backend writes to it: changeCount is
+ * odd while it does, and readers retry when it changed during their copy.
+ */
+typedef struct CommandActivitySlot
+{
+	pg_atomic_uint32 changeCount;
+
+	CommandActivity activity;
+} CommandActivitySlot;
+
+/* Copies of a slot that changed this many times in a row are skipped */
+#define MAX_COMMAND_ACTIVITY_READ_ATTEMPTS 3
+
+extern bool EnableCommandActivityRegistry;
+extern bool EnableSlowOperationLog;
+
+static CommandActivitySlot *CommandActivitySlots = NULL;
+
+/*
+ * The command the current backend last reported, also kept for the slow operation
+ * log and the query shape statistics
+ */
+static CommandActivity CurrentCommandActivity = { 0 };
+
+static void CopyNameIntoSlot(char *target, int targetSize, const char *source,
+							 int sourceLength);
+
+
+Size
+CommandActivityShmemSize(void)
+{
+	return mul_size(sizeof(CommandActivitySlot), MaxBackends);
+}
+
+
+/*
+ * InitializeCommandActivityShmem initializes the slots of the backends.
+ */
+void
+InitializeCommandActivityShmem(void)
+{
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	CommandActivitySlots =
+		(CommandActivitySlot *) ShmemInitStruct("DocumentDB Command Activity Array",
+												CommandActivityShmemSize(),
+												&found);
+
+	if (!found)
+	{
+		memset(CommandActivitySlots, 0, CommandActivityShmemSize());
+		for (int i = 0; i < MaxBackends; i++)
+		{
+			pg_atomic_init_u32(&CommandActivitySlots[i].changeCount, 0);
+		}
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * ReportCommandActivity publishes the command the current statement runs. The
+ * collection is read from the field of the spec named after the command, as in
+ * { "find": "collection" }.
+ */
+void
+ReportCommandActivity(const char *commandName, const char *opType,
+					  text *databaseName, pgbson *commandSpec)
+{
+	bool publishActivity = EnableCommandActivityRegistry && CommandActivitySlots != NULL;
+	if (!publishActivity && !EnableSlowOperationLog && !EnableQueryShapeStats)
+	{
+		return;
+	}
+
+	const char *collectionName = "";
+	uint32_t collectionNameLength = 0;
+	if (commandSpec != NULL)
+	{
+		bson_iter_t specIter;
+		PgbsonInitIterator(commandSpec, &specIter);
+		if (bson_iter_find(&specIter, commandName) && BSON_ITER_HOLDS_UTF8(&specIter))
+		{
+			collectionName = bson_iter_utf8(&specIter, &collectionNameLength);
+		}
+	}
+
+	CommandActivity *activity = &CurrentCommandActivity;
+	activity->pid = MyProcPid;
+	activity->statementStartTime = GetCurrentStatementStartTimestamp();
+	CopyNameIntoSlot(activity->commandName, MAX_COMMAND_ACTIVITY_NAME_LENGTH,
+					 commandName, strlen(commandName));
+	CopyNameIntoSlot(activity->opType, MAX_COMMAND_ACTIVITY_NAME_LENGTH,
+					 opType, strlen(opType));
+	CopyNameIntoSlot(activity->databaseName, MAX_DATABASE_NAME_LENGTH,
+					 VARDATA_ANY(databaseName), VARSIZE_ANY_EXHDR(databaseName));
+	CopyNameIntoSlot(activity->collectionName, MAX_COLLECTION_NAME_LENGTH,
+					 collectionName, collectionNameLength);
+
+	ReportQueryShape(activity, commandSpec);
+
+	if (!publishActivity)
+	{
+		return;
+	}
+
+#if PG_VERSION_NUM >= 170000
+	CommandActivitySlot *slot = &CommandActivitySlots[MyProcNumber];
+#else
+	CommandActivitySlot *slot = &CommandActivitySlots[MyBackendId - 1];
+#endif
+
+	pg_atomic_fetch_add_u32(&slot->changeCount, 1);
+	pg_write_barrier();
+
+	memcpy(&slot->activity, activity, sizeof(CommandActivity));
+
+	pg_write_barrier();
+	pg_atomic_fetch_add_u32(&slot->changeCount, 1);
+}
+
+
+/*
+ * GetCurrentCommandActivity returns the command the current statement reported,
+ * or NULL if it reported none.
+ */
+const CommandActivity *
+GetCurrentCommandActivity(void)
+{
+	if (CurrentCommandActivity.pid == 0 ||
+		CurrentCommandActivity.statementStartTime != GetCurrentStatementStartTimestamp())
+	{
+		return NULL;
+	}
+
+	return &CurrentCommandActivity;
+}
+
+
+/*
+ * GetCommandActivitySnapshot returns a copy of the slots of the backends that
+ * published a command, without taking any lock.
+ */
+CommandActivity *
+GetCommandActivitySnapshot(int *activityCount)
+{
+	*activityCount = 0;
+	if (CommandActivitySlots == NULL)
+	{
+		return NULL;
+	}
+
+	CommandActivity *activities = palloc(sizeof(CommandActivity) * MaxBackends);
+	for (int i = 0; i < MaxBackends; i++)
+	{
+		CommandActivitySlot *slot = &CommandActivitySlots[i];
+		CommandActivity *target = &activities[*activityCount];
+		for (int attempt = 0; attempt < MAX_COMMAND_ACTIVITY_READ_ATTEMPTS; attempt++)
+		{
+			uint32 changeCountBefore = pg_atomic_read_u32(&slot->changeCount);
+			if ((changeCountBefore & 1) != 0)
+			{
+				continue;
+			}
+
+			pg_read_barrier();
+			memcpy(target, &slot->activity, sizeof(CommandActivity));
+			pg_read_barrier();
+
+			if (pg_atomic_read_u32(&slot->changeCount) == changeCountBefore)
+			{
+				if (target->pid != 0)
+				{
+					(*activityCount)++;
+				}
+
+				break;
+			}
+		}
+	}
+
+	return activities;
+}
+
+
+/*
+ * Copies a name that is not null terminated into a slot and truncates it
+ * if it doesn't fit.
+ */
+static void
+CopyNameIntoSlot(char *target, int targetSize, const char *source, int sourceLength)
+{
+	int copyLength = Min(sourceLength, targetSize - 1);
+	memcpy(target, source, copyLength);
+	target[copyLength] = '\0';
+}
@@ -28,6 +28,7 @@
 #include <utils/timestamp.h>
 #include <utils/resowner.h>
 #include <port/atomics.h>
+#include <common/pg_lzcompress.h>
 #include <storage/lwlock.h>
 #include <storage/shmem.h>
 #if PG_VERSION_NUM >= 170000
@@ -45,12 +46,31 @@
 #include "utils/documentdb_errors.h"
 #include "io/bson_core.h"
 #include "infrastructure/cursor_store.h"
+#include "infrastructure/wait_events.h"
 
 extern char *ApiGucPrefix;
 extern bool UseFileBasedPersistedCursors;
 extern int MaxAllowedCursorIntermediateFileSizeMB;
 extern int DefaultCursorExpiryTimeLimitSeconds;
 extern int MaxCursorFileCount;
+extern bool EnableCursorFileCompression;
+extern int CursorFileReadAheadSizeKB;
+
+/*
+ * Compressed cursor files are a sequence of blocks, each a
+ * CompressedBlockHeader followed by the (compressed) contents of one buffer.
+ */
+typedef struct CompressedBlockHeader
+{
+	/* The number of bytes in the block once decompressed */
+	int32_t rawLength;
+
+	/* The number of compressed bytes that follow (0 if stored uncompressed) */
+	int32_t compressedLength;
+} CompressedBlockHeader;
+
+#define COMPRESSED_BLOCK_BUFFER_SIZE (sizeof(CompressedBlockHeader) + \
+									  PGLZ_MAX_OUTPUT(BLCKSZ))
 
 
 /*
@@ -67,6 +87,15 @@ typedef struct SerializedCursorState
 
 	/* The total file length (updated during writes) */
 	uint32_t file_length;
+
+	/*
+	 * For compressed files: file_offset points to the start of a block and this
+	 * is the offset into the decompressed block.
+	 */
+	uint32_t block_offset;
+
+	/* Whether the file is written as a sequence of compressed blocks */
+	bool isCompressed;
 } SerializedCursorState;
 
 typedef struct CursorFileState
@@ -91,6 +120,18 @@ typedef struct CursorFileState
 
 	uint32_t next_offset;
 
+	/* For compressed files: The offset into the current decompressed block */
+	uint32_t next_block_offset;
+
+	/* For compressed files: The length of the current block in the file */
+	uint32_t blockFileLength;
+
+	/* For compressed files: Scratch space for the compressed contents */
+	char *compressedBuffer;
+
+	/* In read mode - the file offset the read started at */
+	uint32_t start_offset;
+
 	/* In read more - whether or not the cursor is complete */
 	bool cursorComplete;
 } CursorFileState;
@@ -121,7 +162,12 @@ PG_FUNCTION_INFO_V1(cursor_directory_cleanup);
 
 
 static void FlushBuffer(CursorFileState *cursorFileState);
+static inline uint32 CursorFileWaitEventInfo(bool isRead);
 static bool FillBuffer(CursorFileState *cursorFileState, char *buffer, int32_t length);
+static bool FillBufferCompressed(CursorFileState *cursorFileState, char *buffer,
+								 int32_t length);
+static bool ReadCompressedBlock(CursorFileState *cursorFileState);
+static void PrefetchCursorFile(CursorFileState *cursorFileState);
 
 static void DecrementCursorCount(void);
 static bool IncrementCursorCount(void);
@@ -318,6 +364,12 @@ CreateCursorFile(const char *cursorName)
 	fileState->bufFile = cursorFile;
 	fileState->isReadWrite = true;
 
+	if (EnableCursorFileCompression)
+	{
+		fileState->cursorState.isCompressed = true;
+		fileState->compressedBuffer = palloc(COMPRESSED_BLOCK_BUFFER_SIZE);
+	}
+
 	return fileState;
 }
 
@@ -452,12 +504,20 @@ DeserializeFileState(bytea *cursorFileState)
 		ereport(ERROR, (errmsg("File based cursor is not enabled")));
 	}
 
+	/* States from before compression was added are shorter: They stay uncompressed */
 	CursorFileState *fileState = palloc0(sizeof(CursorFileState));
-	fileState->cursorState = *(SerializedCursorState *) VARDATA(cursorFileState);
+	memcpy(&fileState->cursorState, VARDATA(cursorFileState),
+		   Min(VARSIZE(cursorFileState) - VARHDRSZ, sizeof(SerializedCursorState)));
 	fileState->bufFile = PathNameOpenTemporaryFile(fileState->cursorState.cursorFileName,
 												   O_RDONLY | PG_BINARY | O_EXCL);
 	fileState->isReadWrite = false;
 	fileState->next_offset = fileState->cursorState.file_offset;
+	fileState->next_block_offset = fileState->cursorState.block_offset;
+	fileState->start_offset = fileState->cursorState.file_offset;
+	if (fileState->cursorState.isCompressed)
+	{
+		fileState->compressedBuffer = palloc(COMPRESSED_BLOCK_BUFFER_SIZE);
+	}
 
 	if (fileState->bufFile < 0 && errno == ENOENT)
 	{
@@ -492,6 +552,7 @@ ReadFromCursorFile(CursorFileState *cursorFileState)
 {
 	/* First step, advance the file stream forward with what was buffered before */
 	cursorFileState->cursorState.file_offset = cursorFileState->next_offset;
+	cursorFileState->cursorState.block_offset = cursorFileState->next_block_offset;
 
 	int32_t length = 0;
 	if (!FillBuffer(cursorFileState, (char *) &length, 4))
@@ -523,6 +584,11 @@ ReadFromCursorFile(CursorFileState *cursorFileState)
 static bool
 FillBuffer(CursorFileState *cursorFileState, char *buffer, int32_t length)
 {
+	if (cursorFileState->cursorState.isCompressed)
+	{
+		return FillBufferCompressed(cursorFileState, buffer, length);
+	}
+
 	while (length > 0)
 	{
 		if (cursorFileState->nbytes == 0)
@@ -530,7 +596,7 @@ FillBuffer(CursorFileState *cursorFileState, char *buffer, int32_t length)
 			int bytesRead = FileRead(cursorFileState->bufFile,
 									 cursorFileState->buffer.data, BLCKSZ,
 									 cursorFileState->next_offset,
-									 WAIT_EVENT_BUFFILE_READ);
+									 CursorFileWaitEventInfo(true));
 			cursorFileState->nbytes += bytesRead;
 			cursorFileState->pos = 0;
 			if (bytesRead == 0)
@@ -563,29 +629,204 @@ FillBuffer(CursorFileState *cursorFileState, char *buffer, int32_t length)
 }
 
 
+/*
+ * FillBuffer for compressed cursor files: The next_offset points to the block
+ * being read and next_block_offset to the position in the decompressed block.
+ */
+static bool
+FillBufferCompressed(CursorFileState *cursorFileState, char *buffer, int32_t length)
+{
+	while (length > 0)
+	{
+		if (cursorFileState->pos == cursorFileState->nbytes)
+		{
+			if (cursorFileState->nbytes > 0)
+			{
+				/* Done with the current block, move on to the next one */
+				cursorFileState->next_offset += cursorFileState->blockFileLength;
+				cursorFileState->next_block_offset = 0;
+				cursorFileState->nbytes = 0;
+			}
+
+			if (!ReadCompressedBlock(cursorFileState))
+			{
+				/* There's no more bytes left */
+				cursorFileState->cursorComplete = true;
+				return false;
+			}
+
+			cursorFileState->pos = cursorFileState->next_block_offset;
+		}
+
+		int32_t bytesToCopy = Min(length, cursorFileState->nbytes -
+								  cursorFileState->pos);
+		memcpy(buffer, cursorFileState->buffer.data + cursorFileState->pos,
+			   bytesToCopy);
+		cursorFileState->pos += bytesToCopy;
+		cursorFileState->next_block_offset += bytesToCopy;
+		buffer += bytesToCopy;
+		length -= bytesToCopy;
+	}
+
+	return true;
+}
+
+
+/*
+ * Reads and decompresses the block at next_offset into the buffer.
+ * Returns false if the end of the file is reached.
+ */
+static bool
+ReadCompressedBlock(CursorFileState *cursorFileState)
+{
+	CompressedBlockHeader header;
+	int bytesRead = FileRead(cursorFileState->bufFile, (char *) &header,
+							 sizeof(CompressedBlockHeader),
+							 cursorFileState->next_offset,
+							 CursorFileWaitEventInfo(true));
+	if (bytesRead == 0)
+	{
+		return false;
+	}
+
+	if (bytesRead != sizeof(CompressedBlockHeader) ||
+		header.rawLength <= 0 || header.rawLength > BLCKSZ ||
+		header.compressedLength < 0 ||
+		header.compressedLength > (int32_t) PGLZ_MAX_OUTPUT(BLCKSZ))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+						errmsg("Invalid block header in cursor file at offset %u",
+							   cursorFileState->next_offset)));
+	}
+
+	uint32_t dataOffset = cursorFileState->next_offset + sizeof(CompressedBlockHeader);
+	if (header.compressedLength == 0)
+	{
+		bytesRead = FileRead(cursorFileState->bufFile, cursorFileState->buffer.data,
+							 header.rawLength, dataOffset,
+							 CursorFileWaitEventInfo(true));
+		if (bytesRead != header.rawLength)
+		{
+			ereport(ERROR, (errcode_for_file_access(),
+							errmsg("Failed to read block from cursor file")));
+		}
+	}
+	else
+	{
+		bytesRead = FileRead(cursorFileState->bufFile, cursorFileState->compressedBuffer,
+							 header.compressedLength, dataOffset,
+							 CursorFileWaitEventInfo(true));
+		if (bytesRead != header.compressedLength ||
+			pglz_decompress(cursorFileState->compressedBuffer, header.compressedLength,
+							cursorFileState->buffer.data, header.rawLength, true) !=
+			header.rawLength)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("Failed to decompress block from cursor file")));
+		}
+	}
+
+	cursorFileState->nbytes = header.rawLength;
+	cursorFileState->blockFileLength = sizeof(CompressedBlockHeader) +
+									   (header.compressedLength == 0 ?
+										header.rawLength : header.compressedLength);
+	return true;
+}
+
+
+/*
+ * After a getMore, hints the OS to read the part of the file the next getMore
+ * likely needs (as much as this one read, up to cursorFileReadAheadSizeKB), so
+ * that it is read in the background while the client processes the current batch.
+ */
+static void
+PrefetchCursorFile(CursorFileState *cursorFileState)
+{
+	if (CursorFileReadAheadSizeKB <= 0 ||
+		cursorFileState->next_offset >= cursorFileState->cursorState.file_length)
+	{
+		return;
+	}
+
+	uint32_t readAhead = Max(cursorFileState->next_offset -
+							 cursorFileState->start_offset, BLCKSZ);
+	readAhead = Min(readAhead, ((uint32_t) CursorFileReadAheadSizeKB) * 1024);
+	readAhead = Min(readAhead, cursorFileState->cursorState.file_length -
+					cursorFileState->next_offset);
+	(void) FilePrefetch(cursorFileState->bufFile, cursorFileState->next_offset,
+						readAhead, CursorFileWaitEventInfo(true));
+}
+
+
+/*
+ * The wait event the file I/O of cursors reports: the cursor file wait events
+ * of the extension, or the BufFile ones of postgres when they're disabled.
+ */
+static inline uint32
+CursorFileWaitEventInfo(bool isRead)
+{
+	if (!EnableCustomWaitEvents)
+	{
+		return isRead ? WAIT_EVENT_BUFFILE_READ : WAIT_EVENT_BUFFILE_WRITE;
+	}
+
+	return GetDocumentDBWaitEventInfo(isRead ? DocumentDBWaitEvent_CursorFileRead :
+									  DocumentDBWaitEvent_CursorFileWrite);
+}
+
+
 /*
  * Writes whatever bytes have been filed into the buffer to the
  * cursor file. This is called when the buffer is full or
  * when the cursor file is closed.
+ * For compressed files, the buffer is written as one compressed block.
  */
 static void
 FlushBuffer(CursorFileState *cursorFileState)
 {
 	if (cursorFileState->pos > 0)
 	{
+		char *writeData = cursorFileState->buffer.data;
+		int writeLength = cursorFileState->pos;
+		if (cursorFileState->cursorState.isCompressed)
+		{
+			/* Buffers that don't compress well are stored as is */
+			CompressedBlockHeader header = { .rawLength = cursorFileState->pos };
+			char *blockData = cursorFileState->compressedBuffer +
+							  sizeof(CompressedBlockHeader);
+			int32 compressedLength = pglz_compress(cursorFileState->buffer.data,
+												   cursorFileState->pos, blockData,
+												   PGLZ_strategy_default);
+			if (compressedLength < 0)
+			{
+				memcpy(blockData, cursorFileState->buffer.data, cursorFileState->pos);
+				writeLength = cursorFileState->pos;
+			}
+			else
+			{
+				header.compressedLength = compressedLength;
+				writeLength = compressedLength;
+			}
+
+			memcpy(cursorFileState->compressedBuffer, &header,
+				   sizeof(CompressedBlockHeader));
+			writeData = cursorFileState->compressedBuffer;
+			writeLength += sizeof(CompressedBlockHeader);
+		}
+
 		int bytesWritten = FileWrite(cursorFileState->bufFile,
-									 cursorFileState->buffer.data, cursorFileState->pos,
+									 writeData, writeLength,
 									 cursorFileState->cursorState.file_offset,
-									 WAIT_EVENT_BUFFILE_WRITE);
+									 CursorFileWaitEventInfo(false));
 
-		if (bytesWritten != cursorFileState->pos)
+		if (bytesWritten != writeLength)
 		{
 			ereport(ERROR,
 					(errcode_for_file_access(),
 					 errmsg("Failed to save data to file")));
 		}
 
-		cursorFileState->cursorState.file_offset += cursorFileState->pos;
+		cursorFileState->cursorState.file_offset += writeLength;
 		cursorFileState->pos = 0;
 
 		Size maxFileSize = ((Size) MaxAllowedCursorIntermediateFileSizeMB) * 1024L * 1024;
@@ -617,6 +858,10 @@ CursorFileStateClose(CursorFileState *cursorFileState)
 		cursorFileState->cursorState.file_offset = 0;
 		pgstat_report_tempfile(cursorFileState->cursorState.file_length);
 	}
+	else if (!cursorFileState->cursorComplete)
+	{
+		PrefetchCursorFile(cursorFileState);
+	}
 
 	PendingCursorFile[0] = '\0';
 	FileClose(cursorFileState->bufFile);
@@ -14,6 +14,9 @@
 #include <nodes/execnodes.h>
 #include <executor/executor.h>
 #include <funcapi.h>
+#include <port/pg_bitutils.h>
+#include <access/xact.h>
+#include <utils/timestamp.h>
 
 #include <storage/shmem.h>
 #include <access/slru.h>
@@ -27,10 +30,13 @@
 
 
 #define FEATURE_COUNTER_STATS_COLUMNS 2
+#define COMMAND_LATENCY_STATS_COLUMNS 3
 
 static void StoreAllFeatureCounterStats(Tuplestorestate *tupleStore, TupleDesc
 										tupleDescriptor, bool resetStatsAfterRead);
 static void PopulateFeatureCounters(FeatureCounter *aggregatedFeatureCounter);
+static void PopulateCommandLatencyHistograms(CommandLatencyHistogram *aggregatedHistogram,
+											 bool resetStatsAfterRead);
 
 static Tuplestorestate * SetupFeatureCounterTuplestore(FunctionCallInfo fcinfo,
 													   TupleDesc *tupleDescriptor);
@@ -38,6 +44,29 @@ static Tuplestorestate * SetupFeatureCounterTuplestore(FunctionCallInfo fcinfo,
 
 FeatureCounter *FeatureCounterBackendArray = NULL;
 
+/*
+ * The command latency histograms of each backend. Like the feature counters,
+ * a backend only writes to its own histograms and readers sum them up. The
+ * histograms of each backend start on their own cache line.
+ */
+static char *CommandLatencyBackendArray = NULL;
+
+#define COMMAND_LATENCY_HISTOGRAM_STRIDE CACHELINEALIGN(sizeof(CommandLatencyHistogram))
+
+static const char *CommandLatencyKindNames[CommandLatencyKind_Max] = {
+	[CommandLatencyKind_Insert] = "insert",
+	[CommandLatencyKind_Update] = "update",
+	[CommandLatencyKind_Delete] = "delete",
+	[CommandLatencyKind_FindAndModify] = "findAndModify",
+	[CommandLatencyKind_Find] = "find",
+	[CommandLatencyKind_Aggregate] = "aggregate",
+	[CommandLatencyKind_Count] = "count",
+	[CommandLatencyKind_Distinct] = "distinct",
+	[CommandLatencyKind_GetMore] = "getMore",
+};
+
+extern bool EnableCommandLatencyHistograms;
+
 /*
  * IMP: Keep the feature enums alphabetically sorted. Sorting is done for better reability.
  * #CodeSync: Keep this in sync with FeatureType enum in feature_counter.h
@@ -211,6 +240,8 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 	[FEATURE_COMMAND_COMPACT] = "command_compact",
 	[FEATURE_COMMAND_COUNT] = "command_count",
 	[FEATURE_COMMAND_CREATE_COLLECTION] = "command_create_collection",
+	[FEATURE_COMMAND_CREATE_TIMESERIES] = "command_create_timeseries",
+	[FEATURE_COMMAND_CREATE_CLUSTERED] = "command_create_clustered",
 	[FEATURE_COMMAND_CREATE_VALIDATION] = "command_create_validation",
 	[FEATURE_COMMAND_CREATE_VIEW] = "command_create_view",
 	[FEATURE_COMMAND_CURRENTOP] = "command_current_op",
@@ -231,6 +262,7 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 		"command_list_collections_cursor_first_page",
 	[FEATURE_COMMAND_LIST_INDEXES_CURSOR_FIRST_PAGE] =
 		"command_list_indexes_cursor_first_page",
+	[FEATURE_COMMAND_REFRESH_VIEW] = "command_refresh_view",
 	[FEATURE_COMMAND_SHARD_COLLECTION] = "command_shard_collection",
 	[FEATURE_COMMAND_RESHARD_COLLECTION] = "command_reshard_collection",
 	[FEATURE_COMMAND_UNSHARD_COLLECTION] = "command_unshard_collection",
@@ -248,6 +280,8 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 	[FEATURE_COMMAND_COLLMOD_VALIDATION] = "collMod_validation",
 	[FEATURE_COMMAND_COLLMOD_TTL_UPDATE] = "collMod_ttl_update",
 	[FEATURE_COMMAND_COLLMOD_INDEX_HIDDEN] = "collMod_index_hidden",
+	[FEATURE_COMMAND_COLLMOD_DOCUMENT_COMPRESSION] = "collMod_document_compression",
+	[FEATURE_COMMAND_COLLMOD_COLUMNAR_PATHS] = "collMod_columnar_paths",
 
 	/* Feature Connection Status */
 	[FEATURE_CONNECTION_STATUS] = "connection_status",
@@ -331,6 +365,7 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 	[FEATURE_STAGE_GROUP_ACC_TOPN] = "topN",
 	[FEATURE_STAGE_INDEXSTATS] = "indexStats",
 	[FEATURE_STAGE_INTERNAL_INHIBIT_OPTIMIZATION] = "_internalInhibitOptimization",
+	[FEATURE_STAGE_INTERNAL_UNPACK_BUCKET] = "_internalUnpackBucket",
 	[FEATURE_STAGE_INVERSEMATCH] = "inverseMatch",
 	[FEATURE_STAGE_LIMIT] = "limit",
 	[FEATURE_STAGE_LOOKUP] = "lookup",
@@ -339,6 +374,8 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 	[FEATURE_STAGE_OUT] = "out",
 	[FEATURE_STAGE_PROJECT] = "project",
 	[FEATURE_STAGE_PROJECT_FIND] = "project_find",
+	[FEATURE_STAGE_QUERY_STATS] = "query_stats_agg",
+	[FEATURE_STAGE_RANK_FUSION] = "rank_fusion",
 	[FEATURE_STAGE_REDACT] = "redact",
 	[FEATURE_STAGE_REPLACE_ROOT] = "replace_root",
 	[FEATURE_STAGE_REPLACE_WITH] = "replace_with",
@@ -374,6 +411,8 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 	/* Feature usage stats */
 	[FEATURE_USAGE_TTL_PURGER_CALLS] = "ttl_purger_calls",
 	[FEATURE_USAGE_INDEX_SCAN_WITH_LIMIT] = "index_scan_with_limit",
+	[FEATURE_USAGE_QUERY_PLAN_CACHE_PREWARM] = "query_plan_cache_prewarm",
+	[FEATURE_USAGE_OR_BRANCH_SORT_MERGE] = "or_branch_sort_merge",
 
 	/* Feature mapping region - User CRUD*/
 	[FEATURE_USER_CREATE] = "user_create",
@@ -384,6 +423,8 @@ static char FeatureMapping[MAX_FEATURE_COUNT][MAX_FEATURE_NAME_LENGTH] = {
 
 
 PG_FUNCTION_INFO_V1(get_feature_counter_stats);
+PG_FUNCTION_INFO_V1(get_command_latency_stats);
+PG_FUNCTION_INFO_V1(get_command_latency_status);
 
 /*
  * get_feature_counter_stats returns all the available information about all
@@ -402,6 +443,111 @@ get_feature_counter_stats(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * get_command_latency_stats returns the number of commands of each kind in each
+ * latency bucket, summed across the backends. The upper bound of the last
+ * bucket is NULL.
+ */
+Datum
+get_command_latency_stats(PG_FUNCTION_ARGS)
+{
+	bool resetStatsAfterRead = PG_GETARG_BOOL(0);
+	TupleDesc tupleDescriptor = NULL;
+	Tuplestorestate *tupleStore = SetupFeatureCounterTuplestore(fcinfo, &tupleDescriptor);
+
+	CommandLatencyHistogram aggregatedHistogram;
+	PopulateCommandLatencyHistograms(&aggregatedHistogram, resetStatsAfterRead);
+
+	Datum values[COMMAND_LATENCY_STATS_COLUMNS] = { 0 };
+	bool isNulls[COMMAND_LATENCY_STATS_COLUMNS] = { 0 };
+	for (int kind = 0; kind < CommandLatencyKind_Max; kind++)
+	{
+		for (int bucket = 0; bucket < COMMAND_LATENCY_BUCKET_COUNT; bucket++)
+		{
+			if (aggregatedHistogram.buckets[kind][bucket] == 0)
+			{
+				continue;
+			}
+
+			values[0] = PointerGetDatum(cstring_to_text(CommandLatencyKindNames[kind]));
+			isNulls[1] = bucket == COMMAND_LATENCY_BUCKET_COUNT - 1;
+			values[1] = Int64GetDatum(INT64CONST(1) << (bucket + 7));
+			values[2] = Int64GetDatum(aggregatedHistogram.buckets[kind][bucket]);
+			tuplestore_putvalues(tupleStore, tupleDescriptor, values, isNulls);
+		}
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * get_command_latency_status returns the command latency histograms as a
+ * document in the format of the opLatencies of serverStatus:
+ * { "opLatencies": { "find": { "latency": <total micros>, "ops": <count>,
+ *   "histogram": [ { "micros": <bucket lower bound>, "count": <count> } ] } } }
+ * Only commands and buckets with a count are written.
+ */
+Datum
+get_command_latency_status(PG_FUNCTION_ARGS)
+{
+	bool resetStatsAfterRead = PG_GETARG_BOOL(0);
+
+	CommandLatencyHistogram aggregatedHistogram;
+	PopulateCommandLatencyHistograms(&aggregatedHistogram, resetStatsAfterRead);
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	pgbson_writer latenciesWriter;
+	PgbsonWriterStartDocument(&writer, "opLatencies", 11, &latenciesWriter);
+	for (int kind = 0; kind < CommandLatencyKind_Max; kind++)
+	{
+		int64 commandCount = 0;
+		for (int bucket = 0; bucket < COMMAND_LATENCY_BUCKET_COUNT; bucket++)
+		{
+			commandCount += aggregatedHistogram.buckets[kind][bucket];
+		}
+
+		if (commandCount == 0)
+		{
+			continue;
+		}
+
+		pgbson_writer commandWriter;
+		PgbsonWriterStartDocument(&latenciesWriter, CommandLatencyKindNames[kind],
+								  strlen(CommandLatencyKindNames[kind]), &commandWriter);
+		PgbsonWriterAppendInt64(&commandWriter, "latency", 7,
+								(int64) aggregatedHistogram.totalMicros[kind]);
+		PgbsonWriterAppendInt64(&commandWriter, "ops", 3, commandCount);
+
+		pgbson_array_writer histogramWriter;
+		PgbsonWriterStartArray(&commandWriter, "histogram", 9, &histogramWriter);
+		for (int bucket = 0; bucket < COMMAND_LATENCY_BUCKET_COUNT; bucket++)
+		{
+			if (aggregatedHistogram.buckets[kind][bucket] == 0)
+			{
+				continue;
+			}
+
+			pgbson_writer bucketWriter;
+			PgbsonArrayWriterStartDocument(&histogramWriter, &bucketWriter);
+			PgbsonWriterAppendInt64(&bucketWriter, "micros", 6,
+									bucket == 0 ? 0 : INT64CONST(1) << (bucket + 6));
+			PgbsonWriterAppendInt64(&bucketWriter, "count", 5,
+									aggregatedHistogram.buckets[kind][bucket]);
+			PgbsonArrayWriterEndDocument(&histogramWriter, &bucketWriter);
+		}
+
+		PgbsonWriterEndArray(&commandWriter, &histogramWriter);
+		PgbsonWriterEndDocument(&latenciesWriter, &commandWriter);
+	}
+
+	PgbsonWriterEndDocument(&writer, &latenciesWriter);
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
+}
+
+
 Size
 SharedFeatureCounterShmemSize(void)
 {
@@ -445,6 +591,106 @@ SharedFeatureCounterShmemInit(void)
 }
 
 
+Size
+CommandLatencyShmemSize(void)
+{
+	return mul_size(COMMAND_LATENCY_HISTOGRAM_STRIDE, MaxBackends);
+}
+
+
+/*
+ * CommandLatencyShmemInit initializes the shared memory used for the
+ * command latency histograms of the backends.
+ */
+void
+CommandLatencyShmemInit(void)
+{
+	bool found;
+	CommandLatencyBackendArray = (char *) ShmemInitStruct(
+		"Command Latency Histogram Array", CommandLatencyShmemSize(), &found);
+
+	if (!found)
+	{
+		MemSet(CommandLatencyBackendArray, 0, CommandLatencyShmemSize());
+	}
+}
+
+
+/*
+ * ReportCommandLatency counts the current statement, from its start until now,
+ * in the latency histogram of the command for the current backend.
+ */
+void
+ReportCommandLatency(CommandLatencyKind commandKind)
+{
+	if (!EnableCommandLatencyHistograms)
+	{
+		return;
+	}
+
+	TimestampTz now = GetCurrentTimestamp();
+	int64 latencyMicros = now - GetCurrentStatementStartTimestamp();
+
+	int bucket = 0;
+	if (latencyMicros >= 128)
+	{
+		bucket = Min(pg_leftmost_one_pos64((uint64) latencyMicros) - 6,
+					 COMMAND_LATENCY_BUCKET_COUNT - 1);
+	}
+
+#if PG_VERSION_NUM >= 170000
+	int backendIndex = MyProcNumber;
+#else
+	int backendIndex = MyBackendId - 1;
+#endif
+
+	CommandLatencyHistogram *histogram = (CommandLatencyHistogram *)
+										 (CommandLatencyBackendArray + backendIndex *
+										  COMMAND_LATENCY_HISTOGRAM_STRIDE);
+
+	pg_write_barrier();
+	histogram->buckets[commandKind][bucket]++;
+	histogram->totalMicros[commandKind] += (uint64) Max(latencyMicros, 0);
+}
+
+
+/*
+ * Sums up the command latency histograms of all the backends, and optionally
+ * resets them.
+ */
+static void
+PopulateCommandLatencyHistograms(CommandLatencyHistogram *aggregatedHistogram,
+								 bool resetStatsAfterRead)
+{
+	memset(aggregatedHistogram, 0, sizeof(CommandLatencyHistogram));
+
+	pg_memory_barrier();
+	for (int backend = 0; backend < MaxBackends; backend++)
+	{
+		CommandLatencyHistogram *histogram = (CommandLatencyHistogram *)
+											 (CommandLatencyBackendArray + backend *
+											  COMMAND_LATENCY_HISTOGRAM_STRIDE);
+		for (int kind = 0; kind < CommandLatencyKind_Max; kind++)
+		{
+			for (int bucket = 0; bucket < COMMAND_LATENCY_BUCKET_COUNT; bucket++)
+			{
+				aggregatedHistogram->buckets[kind][bucket] +=
+					histogram->buckets[kind][bucket];
+			}
+
+			aggregatedHistogram->totalMicros[kind] += histogram->totalMicros[kind];
+		}
+	}
+
+	if (resetStatsAfterRead)
+	{
+		/* Like the feature counters, increments racing with the reset can be lost */
+		pg_write_barrier();
+		MemSet(CommandLatencyBackendArray, 0, CommandLatencyShmemSize());
+	}
+}
+
+
 const char *
 GetFeatureCountersAsString(void)
 {
@@ -10,15 +10,33 @@
  * and a set of query flags. A least recently used (LRU) queue is kept
  * to limit the size of the cache.
  *
+ * SPI plans can't be shared across backends, so new backends pay for
+ * preparing every query they run once. To let callers (e.g. a connection
+ * pool opening new connections) warm a backend up front, the query strings
+ * and argument types of the plans prepared by any backend are also kept in a
+ * fixed size registry in shared memory, and prewarm_query_plan_cache prepares
+ * the most used ones in the current backend.
+ *
  *-------------------------------------------------------------------------
  */
 #include "postgres.h"
 #include "fmgr.h"
 #include "miscadmin.h"
 
+#include "catalog/namespace.h"
+#include "nodes/makefuncs.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
 #include "utils/memutils.h"
 
 #include "infrastructure/documentdb_plan_cache.h"
+#include "metadata/collection.h"
+#include "metadata/metadata_cache.h"
+#include "utils/feature_counter.h"
+
+/* The largest query and number of arguments kept in the shared registry */
+#define MAX_SHARED_PLAN_QUERY_LENGTH 2048
+#define MAX_SHARED_PLAN_ARGS 16
 
 /* QueryKey is used as the key of a query in the cache */
 typedef struct QueryKey
@@ -48,8 +66,50 @@ typedef struct QueryPlanCacheEntry
 	bool isValid;
 } QueryPlanCacheEntry;
 
+/*
+ * A query prepared by some backend, kept in shared memory so that other
+ * backends can prepare it before it's needed.
+ */
+typedef struct SharedQueryPlanTemplate
+{
+	/* key of the query */
+	QueryKey queryKey;
+
+	/* the database of the backend: collection ids are only unique per database */
+	Oid databaseId;
+
+	/* the number of backends that prepared the query */
+	uint64 prepareCount;
+
+	/* the argument types of the query */
+	int argCount;
+	Oid argTypes[MAX_SHARED_PLAN_ARGS];
+
+	/* the query string */
+	char query[MAX_SHARED_PLAN_QUERY_LENGTH];
+
+	/* whether the slot holds a query */
+	bool isValid;
+} SharedQueryPlanTemplate;
+
+typedef struct SharedQueryPlanCacheData
+{
+	int trancheId;
+	char *trancheName;
+	LWLock lock;
+
+	SharedQueryPlanTemplate templates[FLEXIBLE_ARRAY_MEMBER];
+} SharedQueryPlanCacheData;
+
 /* internal function declarations */
 static void RemoveOldestQueryPlan(void);
+static void RegisterSharedQueryPlanTemplate(const QueryKey *queryKey, const char *query,
+											Oid *argTypes, int argCount);
+static bool QueryPlanTemplateRelationsExist(const QueryKey *queryKey);
+static int CompareTemplatesByPrepareCount(const void *left, const void *right);
+
+/* the registry of queries prepared across backends */
+static SharedQueryPlanCacheData *SharedQueryPlanCache = NULL;
 
 /* memory context in which the cache is allocated */
 static MemoryContext QueryPlanCacheContext = NULL;
@@ -66,6 +126,8 @@ static int CachedPlansCount = 0;
 /* number of entries allowed in the query plan cache */
 extern int QueryPlanCacheSizeLimit;
 
+PG_FUNCTION_INFO_V1(command_prewarm_query_plan_cache);
+
 
 /*
  * InitializeQueryPlanCache initalized the session-level query plan
@@ -166,6 +228,8 @@ GetSPIQueryPlanWithLocalShard(uint64 collectionId, const char *shardTableName, u
 		SPI_keepplan(plan);
 		entry->plan = plan;
 
+		RegisterSharedQueryPlanTemplate(&queryKey, query, argTypes, argCount);
+
 		/*
 		 * Now that we initialized all the fields without any errors, i) append
 		 * the cache entry at the tail of the queue and ii) mark the cache entry
@@ -210,3 +274,250 @@ RemoveOldestQueryPlan(void)
 
 	CachedPlansCount--;
 }
+
+
+/*
+ * command_prewarm_query_plan_cache initializes the metadata cache and prepares
+ * the queries that backends of the same database prepared the most (up to the
+ * given number of queries, or the size of the query plan cache) in the current
+ * backend.
+ * Returns the number of queries prepared.
+ */
+Datum
+command_prewarm_query_plan_cache(PG_FUNCTION_ARGS)
+{
+	int maxPlans = PG_ARGISNULL(0) ? QueryPlanCacheSizeLimit : PG_GETARG_INT32(0);
+	maxPlans = Min(maxPlans, QueryPlanCacheSizeLimit);
+
+	/* The queries being prepared (and the first requests) need the metadata cache */
+	PrewarmDocumentDBApiExtensionCache();
+
+	if (SharedQueryPlanCache == NULL || SharedQueryPlanTemplateCount <= 0 ||
+		maxPlans <= 0)
+	{
+		PG_RETURN_INT32(0);
+	}
+
+	/* Take a snapshot of the registry so the lock isn't held while preparing */
+	Size snapshotSize = mul_size(sizeof(SharedQueryPlanTemplate),
+								 SharedQueryPlanTemplateCount);
+	SharedQueryPlanTemplate *templates = palloc(snapshotSize);
+	LWLockAcquire(&SharedQueryPlanCache->lock, LW_SHARED);
+	memcpy(templates, SharedQueryPlanCache->templates, snapshotSize);
+	LWLockRelease(&SharedQueryPlanCache->lock);
+
+	qsort(templates, SharedQueryPlanTemplateCount, sizeof(SharedQueryPlanTemplate),
+		  CompareTemplatesByPrepareCount);
+
+	SPI_connect();
+
+	int plansPrepared = 0;
+	for (int i = 0; i < SharedQueryPlanTemplateCount && plansPrepared < maxPlans; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		SharedQueryPlanTemplate *template = &templates[i];
+		if (!template->isValid)
+		{
+			/* invalid slots sort last */
+			break;
+		}
+
+		/* Neither the collection ids nor the catalog queries carry over to others */
+		if (template->databaseId != MyDatabaseId)
+		{
+			continue;
+		}
+
+		/* The collection may have been dropped since the query was registered */
+		if (!QueryPlanTemplateRelationsExist(&template->queryKey))
+		{
+			continue;
+		}
+
+		const char *shardTableName = template->queryKey.shardTableName[0] != '\0' ?
+									 template->queryKey.shardTableName : NULL;
+		GetSPIQueryPlanWithLocalShard(template->queryKey.collectionId, shardTableName,
+									  template->queryKey.queryId, template->query,
+									  template->argTypes, template->argCount);
+		plansPrepared++;
+	}
+
+	SPI_finish();
+	pfree(templates);
+
+	ReportFeatureUsage(FEATURE_USAGE_QUERY_PLAN_CACHE_PREWARM);
+	PG_RETURN_INT32(plansPrepared);
+}
+
+
+Size
+QueryPlanCacheShmemSize(void)
+{
+	Size size = offsetof(SharedQueryPlanCacheData, templates);
+	size = add_size(size, mul_size(sizeof(SharedQueryPlanTemplate),
+								   Max(SharedQueryPlanTemplateCount, 0)));
+	return size;
+}
+
+
+/*
+ * InitializeQueryPlanCacheShmem initializes the shared memory registry of
+ * the queries prepared across backends.
+ */
+void
+InitializeQueryPlanCacheShmem(void)
+{
+	bool found = false;
+
+	/*
+	 * make consistent with other extensions running.
+	 */
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	SharedQueryPlanCache =
+		(SharedQueryPlanCacheData *) ShmemInitStruct(
+			"Shared Query Plan Cache Data",
+			QueryPlanCacheShmemSize(),
+			&found);
+
+	if (!found)
+	{
+		memset(SharedQueryPlanCache, 0, QueryPlanCacheShmemSize());
+		SharedQueryPlanCache->trancheId = LWLockNewTrancheId();
+		SharedQueryPlanCache->trancheName = "Query Plan Cache Tranche";
+		LWLockRegisterTranche(SharedQueryPlanCache->trancheId,
+							  SharedQueryPlanCache->trancheName);
+
+		LWLockInitialize(&SharedQueryPlanCache->lock,
+						 SharedQueryPlanCache->trancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+	Assert(SharedQueryPlanCache->trancheId != 0);
+}
+
+
+/*
+ * RegisterSharedQueryPlanTemplate records a query that the current backend
+ * prepared in the shared registry. When the registry is full, the query that
+ * was prepared the least is replaced.
+ */
+static void
+RegisterSharedQueryPlanTemplate(const QueryKey *queryKey, const char *query,
+								Oid *argTypes, int argCount)
+{
+	if (SharedQueryPlanCache == NULL || SharedQueryPlanTemplateCount <= 0 ||
+		argCount > MAX_SHARED_PLAN_ARGS)
+	{
+		return;
+	}
+
+	size_t queryLength = strlen(query);
+	if (queryLength >= MAX_SHARED_PLAN_QUERY_LENGTH)
+	{
+		return;
+	}
+
+	LWLockAcquire(&SharedQueryPlanCache->lock, LW_EXCLUSIVE);
+
+	SharedQueryPlanTemplate *replaceTemplate = NULL;
+	for (int i = 0; i < SharedQueryPlanTemplateCount; i++)
+	{
+		SharedQueryPlanTemplate *template = &SharedQueryPlanCache->templates[i];
+		if (!template->isValid)
+		{
+			if (replaceTemplate == NULL || replaceTemplate->isValid)
+			{
+				replaceTemplate = template;
+			}
+
+			continue;
+		}
+
+		if (template->databaseId == MyDatabaseId &&
+			memcmp(&template->queryKey, queryKey, sizeof(QueryKey)) == 0 &&
+			strcmp(template->query, query) == 0)
+		{
+			template->prepareCount++;
+			LWLockRelease(&SharedQueryPlanCache->lock);
+			return;
+		}
+
+		if (replaceTemplate == NULL ||
+			(replaceTemplate->isValid &&
+			 template->prepareCount < replaceTemplate->prepareCount))
+		{
+			replaceTemplate = template;
+		}
+	}
+
+	replaceTemplate->queryKey = *queryKey;
+	replaceTemplate->databaseId = MyDatabaseId;
+	replaceTemplate->prepareCount = 1;
+	replaceTemplate->argCount = argCount;
+	if (argCount > 0)
+	{
+		memcpy(replaceTemplate->argTypes, argTypes, sizeof(Oid) * argCount);
+	}
+
+	memcpy(replaceTemplate->query, query, queryLength + 1);
+	replaceTemplate->isValid = true;
+
+	LWLockRelease(&SharedQueryPlanCache->lock);
+}
+
+
+/*
+ * Whether the collection (and the local shard) a registered query runs
+ * against still exist.
+ */
+static bool
+QueryPlanTemplateRelationsExist(const QueryKey *queryKey)
+{
+	/*
+	 * Queries of the catalog tables (e.g. collection lookups) use a collection id
+	 * of 0. The catalog differs per database, which the caller checks already.
+	 */
+	if (queryKey->collectionId == 0)
+	{
+		return true;
+	}
+
+	if (GetRelationIdForCollectionId(queryKey->collectionId, NoLock) == InvalidOid)
+	{
+		return false;
+	}
+
+	if (queryKey->shardTableName[0] != '\0')
+	{
+		bool missingOK = true;
+		RangeVar *rangeVar = makeRangeVar(ApiDataSchemaName,
+										  pstrdup(queryKey->shardTableName), -1);
+		return RangeVarGetRelid(rangeVar, NoLock, missingOK) != InvalidOid;
+	}
+
+	return true;
+}
+
+
+/*
+ * Sorts the valid templates first, most prepared first.
+ */
+static int
+CompareTemplatesByPrepareCount(const void *left, const void *right)
+{
+	const SharedQueryPlanTemplate *leftTemplate = left;
+	const SharedQueryPlanTemplate *rightTemplate = right;
+
+	if (leftTemplate->isValid != rightTemplate->isValid)
+	{
+		return leftTemplate->isValid ? -1 : 1;
+	}
+
+	if (leftTemplate->prepareCount == rightTemplate->prepareCount)
+	{
+		return 0;
+	}
+
+	return leftTemplate->prepareCount > rightTemplate->prepareCount ? -1 : 1;
+}
@@ -0,0 +1,613 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/infrastructure/query_shape_stats.c
+ *
+ * Shared memory statistics of the queries run by find, aggregate, count,
+ * distinct and findAndModify, grouped by the shape of the query: The
+ * filter, sort, projection or pipeline of the command with the values
+ * replaced by their type (e.g. { "a": "?number" }), and the namespace.
+ * Similar to pg_stat_statements, each shape counts the calls, the time spent
+ * executing its queries, the documents examined and returned, and the index
+ * last used. The statistics are read with $queryStats.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <common/hashfn.h>
+#include <mb/pg_wchar.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <storage/spin.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#include "io/bson_core.h"
+#include "io/bson_set_returning_functions.h"
+#include "infrastructure/query_shape_stats.h"
+#include "planner/documentdb_planner.h"
+
+/* The number of shapes tracked: The queries of new shapes are dropped once full */
+#define MAX_QUERY_SHAPE_STATS_ENTRIES 1024
+
+/* The shapes that don't fit are stored as truncated extended json */
+#define QUERY_SHAPE_MAX_LENGTH 1024
+
+/*
+ * The statistics of a query shape. The key (the hash, the namespace and the
+ * shape) is written under the exclusive lock of the table, the counters
+ * under the spinlock of the entry along with the shared lock of the table.
+ */
+typedef struct QueryShapeStatsEntry
+{
+	/* 0 if the entry is unused */
+	uint64 shapeHash;
+
+	char commandName[MAX_COMMAND_ACTIVITY_NAME_LENGTH];
+	char databaseName[MAX_DATABASE_NAME_LENGTH];
+	char collectionName[MAX_COLLECTION_NAME_LENGTH];
+
+	/* Whether the shape is the bson of the shape or its truncated json text */
+	bool isShapeText;
+	uint32 shapeLength;
+	char shape[QUERY_SHAPE_MAX_LENGTH];
+
+	slock_t mutex;
+
+	/* The number of commands that ran the shape */
+	int64 calls;
+
+	/* The time spent executing the queries of the commands */
+	int64 totalMicros;
+	int64 maxMicros;
+
+	int64 docsExamined;
+	int64 docsReturned;
+
+	/* The name of the index last scanned by the queries, empty if none */
+	char indexName[NAMEDATALEN];
+
+	TimestampTz firstSeenTime;
+	TimestampTz lastSeenTime;
+} QueryShapeStatsEntry;
+
+typedef struct QueryShapeStatsData
+{
+	int trancheId;
+
+	char *trancheName;
+
+	LWLock lock;
+
+	QueryShapeStatsEntry entries[MAX_QUERY_SHAPE_STATS_ENTRIES];
+} QueryShapeStatsData;
+
+/*
+ * The fields of a command spec that make up the shape of its query. The
+ * distinct key is a path, and is kept as is.
+ */
+typedef struct QueryShapeCommand
+{
+	const char *commandName;
+
+	const char *shapeFields[4];
+} QueryShapeCommand;
+
+static const QueryShapeCommand QueryShapeCommands[] = {
+	{ "aggregate", { "pipeline", NULL } },
+	{ "count", { "query", NULL } },
+	{ "distinct", { "key", "query", NULL } },
+	{ "find", { "filter", "sort", "projection", NULL } },
+	{ "findAndModify", { "query", "sort", "fields", NULL } },
+};
+
+/*
+ * The shape the current statement reported: The queries the statement runs
+ * are counted against it.
+ */
+typedef struct CurrentQueryShapeData
+{
+	/* The statement start time the shape was reported in, 0 if none */
+	TimestampTz statementStartTime;
+
+	uint64 shapeHash;
+
+	/* Whether a query of the statement was already counted as a call */
+	bool isCounted;
+
+	bool isShapeText;
+	uint32 shapeLength;
+	char shape[QUERY_SHAPE_MAX_LENGTH];
+} CurrentQueryShapeData;
+
+static QueryShapeStatsData *QueryShapeStats = NULL;
+
+static CurrentQueryShapeData CurrentQueryShape = { 0 };
+
+static const QueryShapeCommand * GetQueryShapeCommand(const char *commandName);
+static void WriteNormalizedValue(pgbson_element_writer *writer,
+								 const bson_value_t *value);
+static void WriteNormalizedDocument(pgbson_writer *writer, const bson_value_t *value);
+static QueryShapeStatsEntry * FindQueryShapeEntry(uint64 shapeHash,
+												  const CommandActivity *activity);
+static void CopyTruncatedString(char *target, int targetSize, const char *source);
+
+PG_FUNCTION_INFO_V1(get_query_shape_stats);
+
+
+Size
+QueryShapeStatsShmemSize(void)
+{
+	return sizeof(QueryShapeStatsData);
+}
+
+
+/*
+ * InitializeQueryShapeStatsShmem initializes the shared memory statistics of
+ * query shapes.
+ */
+void
+InitializeQueryShapeStatsShmem(void)
+{
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	QueryShapeStats =
+		(QueryShapeStatsData *) ShmemInitStruct("DocumentDB Query Shape Stats",
+												QueryShapeStatsShmemSize(),
+												&found);
+
+	if (!found)
+	{
+		memset(QueryShapeStats, 0, QueryShapeStatsShmemSize());
+		QueryShapeStats->trancheId = LWLockNewTrancheId();
+		QueryShapeStats->trancheName = "Query Shape Stats Tranche";
+		LWLockRegisterTranche(QueryShapeStats->trancheId,
+							  QueryShapeStats->trancheName);
+
+		LWLockInitialize(&QueryShapeStats->lock, QueryShapeStats->trancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * ReportQueryShape computes the shape of the query of the command the current
+ * statement reported, so that the queries it runs are counted against it.
+ * Commands without a query shape (e.g. insert) clear the shape of the
+ * previous statement.
+ */
+void
+ReportQueryShape(const CommandActivity *activity, pgbson *commandSpec)
+{
+	CurrentQueryShape.statementStartTime = 0;
+	CurrentQueryShape.shapeHash = 0;
+
+	const QueryShapeCommand *shapeCommand = GetQueryShapeCommand(activity->commandName);
+	if (!EnableQueryShapeStats || QueryShapeStats == NULL || shapeCommand == NULL ||
+		commandSpec == NULL)
+	{
+		return;
+	}
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+	PgbsonWriterAppendUtf8(&writer, "cmd", 3, shapeCommand->commandName);
+
+	for (int i = 0; shapeCommand->shapeFields[i] != NULL; i++)
+	{
+		const char *fieldName = shapeCommand->shapeFields[i];
+		bson_iter_t specIter;
+		PgbsonInitIterator(commandSpec, &specIter);
+		if (!bson_iter_find(&specIter, fieldName))
+		{
+			continue;
+		}
+
+		const bson_value_t *value = bson_iter_value(&specIter);
+		if (strcmp(fieldName, "pipeline") == 0 && value->value_type == BSON_TYPE_ARRAY)
+		{
+			/* The reads of the statistics are not counted in them */
+			bson_iter_t pipelineIter;
+			BsonValueInitIterator(value, &pipelineIter);
+			if (bson_iter_next(&pipelineIter) && BSON_ITER_HOLDS_DOCUMENT(&pipelineIter))
+			{
+				bson_iter_t stageIter;
+				if (bson_iter_recurse(&pipelineIter, &stageIter) &&
+					bson_iter_next(&stageIter) &&
+					strcmp(bson_iter_key(&stageIter), "$queryStats") == 0)
+				{
+					return;
+				}
+			}
+		}
+
+		pgbson_element_writer elementWriter;
+		PgbsonInitObjectElementWriter(&writer, &elementWriter, fieldName,
+									  strlen(fieldName));
+		if (strcmp(fieldName, "key") == 0)
+		{
+			PgbsonElementWriterWriteValue(&elementWriter, value);
+		}
+		else
+		{
+			WriteNormalizedValue(&elementWriter, value);
+		}
+	}
+
+	uint32 shapeSize = PgbsonWriterGetSize(&writer);
+	char *shapeBuffer = palloc(shapeSize);
+	PgbsonWriterCopyToBuffer(&writer, (uint8_t *) shapeBuffer, shapeSize);
+
+	uint64 shapeHash = hash_bytes_extended((const unsigned char *) shapeBuffer,
+										   shapeSize, 0);
+	shapeHash = hash_combine64(shapeHash, hash_bytes_extended(
+								   (const unsigned char *) activity->databaseName,
+								   strlen(activity->databaseName), 0));
+	shapeHash = hash_combine64(shapeHash, hash_bytes_extended(
+								   (const unsigned char *) activity->collectionName,
+								   strlen(activity->collectionName), 0));
+
+	if (shapeSize <= QUERY_SHAPE_MAX_LENGTH)
+	{
+		CurrentQueryShape.isShapeText = false;
+		CurrentQueryShape.shapeLength = shapeSize;
+		memcpy(CurrentQueryShape.shape, shapeBuffer, shapeSize);
+	}
+	else
+	{
+		const char *shapeText = PgbsonToJsonForLogging(PgbsonInitFromBuffer(shapeBuffer,
+																			 shapeSize));
+		CurrentQueryShape.isShapeText = true;
+		CopyTruncatedString(CurrentQueryShape.shape, QUERY_SHAPE_MAX_LENGTH, shapeText);
+		CurrentQueryShape.shapeLength = strlen(CurrentQueryShape.shape);
+	}
+
+	pfree(shapeBuffer);
+
+	CurrentQueryShape.statementStartTime = activity->statementStartTime;
+	CurrentQueryShape.shapeHash = shapeHash != 0 ? shapeHash : 1;
+	CurrentQueryShape.isCounted = false;
+}
+
+
+/*
+ * RecordQueryShapeExecution adds a query that ended to the statistics of the
+ * shape of the current statement. The first query of the statement counts
+ * the call, all of them add their time and documents.
+ */
+void
+RecordQueryShapeExecution(const CommandActivity *activity, int64 executionMicros,
+						  int64 docsExamined, int64 docsReturned, Oid indexId)
+{
+	if (!EnableQueryShapeStats || QueryShapeStats == NULL ||
+		CurrentQueryShape.shapeHash == 0 ||
+		CurrentQueryShape.statementStartTime != activity->statementStartTime)
+	{
+		return;
+	}
+
+	bool isNewCall = !CurrentQueryShape.isCounted;
+	CurrentQueryShape.isCounted = true;
+
+	const char *indexName = OidIsValid(indexId) ? get_rel_name(indexId) : NULL;
+	TimestampTz now = GetCurrentTimestamp();
+
+	LWLockAcquire(&QueryShapeStats->lock, LW_SHARED);
+	QueryShapeStatsEntry *entry = FindQueryShapeEntry(CurrentQueryShape.shapeHash, NULL);
+	if (entry == NULL)
+	{
+		LWLockRelease(&QueryShapeStats->lock);
+		LWLockAcquire(&QueryShapeStats->lock, LW_EXCLUSIVE);
+		entry = FindQueryShapeEntry(CurrentQueryShape.shapeHash, activity);
+	}
+
+	if (entry != NULL)
+	{
+		SpinLockAcquire(&entry->mutex);
+		if (isNewCall)
+		{
+			entry->calls++;
+		}
+
+		entry->totalMicros += executionMicros;
+		entry->maxMicros = Max(entry->maxMicros, executionMicros);
+		entry->docsExamined += docsExamined;
+		entry->docsReturned += docsReturned;
+		if (indexName != NULL)
+		{
+			CopyTruncatedString(entry->indexName, NAMEDATALEN, indexName);
+		}
+
+		if (entry->firstSeenTime == 0)
+		{
+			entry->firstSeenTime = now;
+		}
+
+		entry->lastSeenTime = now;
+		SpinLockRelease(&entry->mutex);
+	}
+
+	LWLockRelease(&QueryShapeStats->lock);
+}
+
+
+/*
+ * get_query_shape_stats returns the statistics of each query shape as a
+ * document in the format of $queryStats. With reset, the statistics are
+ * cleared after they are read.
+ */
+Datum
+get_query_shape_stats(PG_FUNCTION_ARGS)
+{
+	bool resetAfterRead = PG_GETARG_BOOL(0);
+
+	TupleDesc descriptor;
+	Tuplestorestate *tupleStore = SetupBsonTuplestore(fcinfo, &descriptor);
+	if (QueryShapeStats == NULL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	/*
+	 * Take a snapshot so the lock isn't held while building the documents. The
+	 * exclusive lock excludes the updates of the counters as well.
+	 */
+	QueryShapeStatsEntry *entries = palloc(sizeof(QueryShapeStats->entries));
+	LWLockAcquire(&QueryShapeStats->lock, LW_EXCLUSIVE);
+	memcpy(entries, QueryShapeStats->entries, sizeof(QueryShapeStats->entries));
+	if (resetAfterRead)
+	{
+		memset(QueryShapeStats->entries, 0, sizeof(QueryShapeStats->entries));
+	}
+	LWLockRelease(&QueryShapeStats->lock);
+
+	for (int i = 0; i < MAX_QUERY_SHAPE_STATS_ENTRIES; i++)
+	{
+		QueryShapeStatsEntry *entry = &entries[i];
+		if (entry->shapeHash == 0 || entry->calls == 0)
+		{
+			continue;
+		}
+
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+
+		pgbson_writer keyWriter;
+		PgbsonWriterStartDocument(&writer, "key", 3, &keyWriter);
+		if (entry->isShapeText)
+		{
+			PgbsonWriterAppendUtf8(&keyWriter, "queryShapeText", 14, entry->shape);
+		}
+		else
+		{
+			PgbsonWriterAppendDocument(&keyWriter, "queryShape", 10,
+									   PgbsonInitFromBuffer(entry->shape,
+															entry->shapeLength));
+		}
+
+		pgbson_writer namespaceWriter;
+		PgbsonWriterStartDocument(&keyWriter, "namespace", 9, &namespaceWriter);
+		PgbsonWriterAppendUtf8(&namespaceWriter, "db", 2, entry->databaseName);
+		PgbsonWriterAppendUtf8(&namespaceWriter, "coll", 4, entry->collectionName);
+		PgbsonWriterEndDocument(&keyWriter, &namespaceWriter);
+		PgbsonWriterAppendUtf8(&keyWriter, "command", 7, entry->commandName);
+		PgbsonWriterEndDocument(&writer, &keyWriter);
+
+		PgbsonWriterAppendUtf8(&writer, "queryShapeHash", 14,
+							   psprintf("%016" INT64_MODIFIER "X", entry->shapeHash));
+
+		if (entry->indexName[0] == '\0')
+		{
+			PgbsonWriterAppendUtf8(&writer, "planSummary", 11, "COLLSCAN");
+		}
+		else
+		{
+			bool useLibPq = false;
+			const char *indexName = GetDocumentDBIndexNameFromPostgresIndex(
+				entry->indexName, useLibPq);
+			PgbsonWriterAppendUtf8(&writer, "planSummary", 11,
+								   psprintf("IXSCAN %s", indexName != NULL ?
+											indexName : entry->indexName));
+		}
+
+		pgbson_writer metricsWriter;
+		PgbsonWriterStartDocument(&writer, "metrics", 7, &metricsWriter);
+		PgbsonWriterAppendInt64(&metricsWriter, "execCount", 9, entry->calls);
+
+		pgbson_writer timeWriter;
+		PgbsonWriterStartDocument(&metricsWriter, "totalExecMicros", 15, &timeWriter);
+		PgbsonWriterAppendInt64(&timeWriter, "sum", 3, entry->totalMicros);
+		PgbsonWriterAppendInt64(&timeWriter, "max", 3, entry->maxMicros);
+		PgbsonWriterEndDocument(&metricsWriter, &timeWriter);
+
+		PgbsonWriterAppendDouble(&metricsWriter, "meanExecMicros", 14,
+								 (double) entry->totalMicros / entry->calls);
+		PgbsonWriterAppendInt64(&metricsWriter, "docsExamined", 12,
+								entry->docsExamined);
+		PgbsonWriterAppendInt64(&metricsWriter, "docsReturned", 12,
+								entry->docsReturned);
+		PgbsonWriterAppendDateTime(&metricsWriter, "firstSeenTimestamp", 18,
+								   entry->firstSeenTime);
+		PgbsonWriterAppendDateTime(&metricsWriter, "latestSeenTimestamp", 19,
+								   entry->lastSeenTime);
+		PgbsonWriterEndDocument(&writer, &metricsWriter);
+
+		Datum tuple[1] = { PointerGetDatum(PgbsonWriterGetPgbson(&writer)) };
+		bool nulls[1] = { false };
+		tuplestore_putvalues(tupleStore, descriptor, tuple, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+static const QueryShapeCommand *
+GetQueryShapeCommand(const char *commandName)
+{
+	for (size_t i = 0; i < lengthof(QueryShapeCommands); i++)
+	{
+		if (strcmp(QueryShapeCommands[i].commandName, commandName) == 0)
+		{
+			return &QueryShapeCommands[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Writes the shape of a value: Documents and arrays of documents keep their
+ * structure, strings that start with $ (operators, paths, variables) are
+ * kept, and any other value is replaced by its type.
+ */
+static void
+WriteNormalizedValue(pgbson_element_writer *writer, const bson_value_t *value)
+{
+	switch (value->value_type)
+	{
+		case BSON_TYPE_DOCUMENT:
+		{
+			pgbson_writer childWriter;
+			PgbsonElementWriterStartDocument(writer, &childWriter);
+			WriteNormalizedDocument(&childWriter, value);
+			PgbsonElementWriterEndDocument(writer, &childWriter);
+			return;
+		}
+
+		case BSON_TYPE_ARRAY:
+		{
+			bool isDocumentArray = true;
+			bson_iter_t arrayIter;
+			BsonValueInitIterator(value, &arrayIter);
+			while (bson_iter_next(&arrayIter))
+			{
+				if (!BSON_ITER_HOLDS_DOCUMENT(&arrayIter))
+				{
+					isDocumentArray = false;
+					break;
+				}
+			}
+
+			if (!isDocumentArray)
+			{
+				break;
+			}
+
+			pgbson_array_writer childWriter;
+			PgbsonElementWriterStartArray(writer, &childWriter);
+			BsonValueInitIterator(value, &arrayIter);
+			while (bson_iter_next(&arrayIter))
+			{
+				pgbson_element_writer arrayElementWriter;
+				PgbsonInitArrayElementWriter(&childWriter, &arrayElementWriter);
+				WriteNormalizedValue(&arrayElementWriter, bson_iter_value(&arrayIter));
+			}
+			PgbsonElementWriterEndArray(writer, &childWriter);
+			return;
+		}
+
+		case BSON_TYPE_UTF8:
+		{
+			if (value->value.v_utf8.len > 0 && value->value.v_utf8.str[0] == '$')
+			{
+				PgbsonElementWriterWriteValue(writer, value);
+				return;
+			}
+
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+
+	bson_value_t typeValue = { 0 };
+	typeValue.value_type = BSON_TYPE_UTF8;
+	typeValue.value.v_utf8.str = psprintf("?%s", BsonValueIsNumber(value) ?
+										  "number" : BsonTypeName(value->value_type));
+	typeValue.value.v_utf8.len = strlen(typeValue.value.v_utf8.str);
+	PgbsonElementWriterWriteValue(writer, &typeValue);
+}
+
+
+static void
+WriteNormalizedDocument(pgbson_writer *writer, const bson_value_t *value)
+{
+	bson_iter_t documentIter;
+	BsonValueInitIterator(value, &documentIter);
+	while (bson_iter_next(&documentIter))
+	{
+		pgbson_element_writer elementWriter;
+		PgbsonInitObjectElementWriter(writer, &elementWriter,
+									  bson_iter_key(&documentIter),
+									  bson_iter_key_len(&documentIter));
+		WriteNormalizedValue(&elementWriter, bson_iter_value(&documentIter));
+	}
+}
+
+
+/*
+ * Finds the entry of a shape in the open addressed table. With an activity
+ * (and the exclusive lock held) the shape of the current statement is added
+ * in the first unused entry if it isn't there. Returns NULL if the shape is
+ * not found and can't be added.
+ */
+static QueryShapeStatsEntry *
+FindQueryShapeEntry(uint64 shapeHash, const CommandActivity *activity)
+{
+	for (int i = 0; i < MAX_QUERY_SHAPE_STATS_ENTRIES; i++)
+	{
+		QueryShapeStatsEntry *entry =
+			&QueryShapeStats->entries[(shapeHash + i) % MAX_QUERY_SHAPE_STATS_ENTRIES];
+		if (entry->shapeHash == shapeHash)
+		{
+			return entry;
+		}
+		else if (entry->shapeHash != 0)
+		{
+			continue;
+		}
+
+		if (activity == NULL)
+		{
+			return NULL;
+		}
+
+		memset(entry, 0, sizeof(QueryShapeStatsEntry));
+		SpinLockInit(&entry->mutex);
+		CopyTruncatedString(entry->commandName, MAX_COMMAND_ACTIVITY_NAME_LENGTH,
+							activity->commandName);
+		CopyTruncatedString(entry->databaseName, MAX_DATABASE_NAME_LENGTH,
+							activity->databaseName);
+		CopyTruncatedString(entry->collectionName, MAX_COLLECTION_NAME_LENGTH,
+							activity->collectionName);
+		entry->isShapeText = CurrentQueryShape.isShapeText;
+		entry->shapeLength = CurrentQueryShape.shapeLength;
+		memcpy(entry->shape, CurrentQueryShape.shape, CurrentQueryShape.shapeLength);
+		entry->shapeHash = shapeHash;
+		return entry;
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Copies a string into a fixed size field and truncates it if it doesn't fit,
+ * without splitting a multibyte character.
+ */
+static void
+CopyTruncatedString(char *target, int targetSize, const char *source)
+{
+	int copyLength = pg_mbcliplen(source, strlen(source), targetSize - 1);
+	memcpy(target, source, copyLength);
+	target[copyLength] = '\0';
+}
@@ -0,0 +1,529 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/infrastructure/slow_operation_log.c
+ *
+ * A fixed size shared memory log (the oldest entries are overwritten) of the
+ * queries run by commands that took longer than the slow operation threshold,
+ * plus a sample of the others. Each entry holds the generated SQL, the plan
+ * with the actual row counts, the documents examined, the index used and the
+ * timings, similar to the system.profile of the profiler.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <access/parallel.h>
+#include <commands/explain.h>
+#include <common/pg_prng.h>
+#include <executor/executor.h>
+#include <executor/instrument.h>
+#include <mb/pg_wchar.h>
+#include <nodes/nodeFuncs.h>
+#include <storage/ipc.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <tcop/tcopprot.h>
+#include <utils/lsyscache.h>
+#include <utils/timestamp.h>
+
+#if PG_VERSION_NUM >= 180000
+#include <commands/explain_format.h>
+#include <commands/explain_state.h>
+#endif
+
+#include "io/bson_core.h"
+#include "io/bson_set_returning_functions.h"
+#include "infrastructure/command_activity.h"
+#include "infrastructure/query_shape_stats.h"
+#include "infrastructure/slow_operation_log.h"
+#include "planner/documentdb_planner.h"
+#include "utils/documentdb_pg_compatibility.h"
+
+/* The captured SQL and plan are truncated to these lengths */
+#define SLOW_OPERATION_SQL_LENGTH 1024
+#define SLOW_OPERATION_PLAN_LENGTH 2048
+
+/*
+ * An operation in the log.
+ */
+typedef struct SlowOperationEntry
+{
+	/* The time the query finished, 0 if the entry is unused */
+	TimestampTz timestamp;
+
+	int pid;
+
+	/* Whether the query was recorded by sampling rather than for being slow */
+	bool sampled;
+
+	/* The time spent executing the query, and in the statement up to its end */
+	int64 executionMicros;
+	int64 statementMicros;
+
+	/* The rows read by the scans of the query, and the rows it returned */
+	int64 docsExamined;
+	int64 docsReturned;
+
+	char commandName[MAX_COMMAND_ACTIVITY_NAME_LENGTH];
+	char databaseName[MAX_DATABASE_NAME_LENGTH];
+	char collectionName[MAX_COLLECTION_NAME_LENGTH];
+
+	/* The name of the first index scanned by the query, empty if none */
+	char indexName[NAMEDATALEN];
+
+	char sql[SLOW_OPERATION_SQL_LENGTH];
+	char plan[SLOW_OPERATION_PLAN_LENGTH];
+} SlowOperationEntry;
+
+typedef struct SlowOperationLogData
+{
+	int trancheId;
+
+	char *trancheName;
+
+	LWLock lock;
+
+	/* The number of operations ever written: The next one goes in slot nextEntry % size */
+	uint64 nextEntry;
+
+	SlowOperationEntry entries[FLEXIBLE_ARRAY_MEMBER];
+} SlowOperationLogData;
+
+/* The state collected while walking the executed plan */
+typedef struct SlowOperationPlanStats
+{
+	int64 docsExamined;
+
+	Oid indexId;
+} SlowOperationPlanStats;
+
+extern bool EnableSlowOperationLog;
+extern int SlowOperationThresholdMs;
+extern double SlowOperationSampleRate;
+extern int SlowOperationLogEntries;
+
+static SlowOperationLogData *SlowOperationLog = NULL;
+
+static ExecutorStart_hook_type PreviousExecutorStartHook = NULL;
+static ExecutorEnd_hook_type PreviousExecutorEndHook = NULL;
+
+static void SlowOperationExecutorStart(QueryDesc *queryDesc, int eflags);
+static void SlowOperationExecutorEnd(QueryDesc *queryDesc);
+static bool ShouldTrackQuery(QueryDesc *queryDesc);
+static void RecordSlowOperation(QueryDesc *queryDesc, const CommandActivity *activity,
+								const SlowOperationPlanStats *planStats,
+								int64 executionMicros, bool sampled);
+static bool CollectPlanStats(PlanState *planState, void *context);
+static char * GetPlanText(QueryDesc *queryDesc);
+static void CopyTruncatedString(char *target, int targetSize, const char *source);
+
+PG_FUNCTION_INFO_V1(get_slow_operation_log);
+
+
+Size
+SlowOperationLogShmemSize(void)
+{
+	return add_size(offsetof(SlowOperationLogData, entries),
+					mul_size(sizeof(SlowOperationEntry), SlowOperationLogEntries));
+}
+
+
+/*
+ * InitializeSlowOperationLogShmem initializes the shared memory log of slow
+ * operations.
+ */
+void
+InitializeSlowOperationLogShmem(void)
+{
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	SlowOperationLog =
+		(SlowOperationLogData *) ShmemInitStruct("DocumentDB Slow Operation Log",
+												 SlowOperationLogShmemSize(),
+												 &found);
+
+	if (!found)
+	{
+		memset(SlowOperationLog, 0, SlowOperationLogShmemSize());
+		SlowOperationLog->trancheId = LWLockNewTrancheId();
+		SlowOperationLog->trancheName = "Slow Operation Log Tranche";
+		LWLockRegisterTranche(SlowOperationLog->trancheId,
+							  SlowOperationLog->trancheName);
+
+		LWLockInitialize(&SlowOperationLog->lock, SlowOperationLog->trancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+void
+InstallSlowOperationLogHooks(void)
+{
+	PreviousExecutorStartHook = ExecutorStart_hook;
+	ExecutorStart_hook = SlowOperationExecutorStart;
+
+	PreviousExecutorEndHook = ExecutorEnd_hook;
+	ExecutorEnd_hook = SlowOperationExecutorEnd;
+}
+
+
+void
+UninstallSlowOperationLogHooks(void)
+{
+	ExecutorStart_hook = PreviousExecutorStartHook;
+	PreviousExecutorStartHook = NULL;
+
+	ExecutorEnd_hook = PreviousExecutorEndHook;
+	PreviousExecutorEndHook = NULL;
+}
+
+
+/*
+ * get_slow_operation_log returns the logged operations, oldest first, as
+ * documents in the format of the system.profile collection. With reset, the
+ * log is emptied after it is read.
+ */
+Datum
+get_slow_operation_log(PG_FUNCTION_ARGS)
+{
+	bool resetAfterRead = PG_GETARG_BOOL(0);
+
+	TupleDesc descriptor;
+	Tuplestorestate *tupleStore = SetupBsonTuplestore(fcinfo, &descriptor);
+	if (SlowOperationLog == NULL || SlowOperationLogEntries <= 0)
+	{
+		PG_RETURN_VOID();
+	}
+
+	/* Take a snapshot of the log so the lock isn't held while looking up index names */
+	Size snapshotSize = mul_size(sizeof(SlowOperationEntry), SlowOperationLogEntries);
+	SlowOperationEntry *entries = palloc(snapshotSize);
+	LWLockAcquire(&SlowOperationLog->lock,
+				  resetAfterRead ? LW_EXCLUSIVE : LW_SHARED);
+	memcpy(entries, SlowOperationLog->entries, snapshotSize);
+	uint64 nextEntry = SlowOperationLog->nextEntry;
+	if (resetAfterRead)
+	{
+		memset(SlowOperationLog->entries, 0, snapshotSize);
+		SlowOperationLog->nextEntry = 0;
+	}
+	LWLockRelease(&SlowOperationLog->lock);
+
+	for (int i = 0; i < SlowOperationLogEntries; i++)
+	{
+		SlowOperationEntry *entry =
+			&entries[(nextEntry + i) % SlowOperationLogEntries];
+		if (entry->timestamp == 0)
+		{
+			continue;
+		}
+
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+		PgbsonWriterAppendUtf8(&writer, "op", 2, entry->commandName);
+
+		char *namespaceString = psprintf("%s.%s", entry->databaseName,
+										 entry->collectionName);
+		PgbsonWriterAppendUtf8(&writer, "ns", 2, namespaceString);
+		PgbsonWriterAppendDateTime(&writer, "ts", 2, entry->timestamp);
+		PgbsonWriterAppendInt64(&writer, "millis", 6, entry->statementMicros / 1000);
+
+		if (entry->indexName[0] == '\0')
+		{
+			PgbsonWriterAppendUtf8(&writer, "planSummary", 11, "COLLSCAN");
+		}
+		else
+		{
+			bool useLibPq = false;
+			const char *indexName = GetDocumentDBIndexNameFromPostgresIndex(
+				entry->indexName, useLibPq);
+			PgbsonWriterAppendUtf8(&writer, "planSummary", 11,
+								   psprintf("IXSCAN %s", indexName != NULL ?
+											indexName : entry->indexName));
+		}
+
+		PgbsonWriterAppendInt64(&writer, "docsExamined", 12, entry->docsExamined);
+		PgbsonWriterAppendInt64(&writer, "nreturned", 9, entry->docsReturned);
+		PgbsonWriterAppendBool(&writer, "sampled", 7, entry->sampled);
+		PgbsonWriterAppendInt32(&writer, "pid", 3, entry->pid);
+
+		pgbson_writer timingWriter;
+		PgbsonWriterStartDocument(&writer, "timing", 6, &timingWriter);
+		PgbsonWriterAppendInt64(&timingWriter, "executionMicros", 15,
+								entry->executionMicros);
+		PgbsonWriterAppendInt64(&timingWriter, "statementMicros", 15,
+								entry->statementMicros);
+		PgbsonWriterEndDocument(&writer, &timingWriter);
+
+		PgbsonWriterAppendUtf8(&writer, "sql", 3, entry->sql);
+		PgbsonWriterAppendUtf8(&writer, "plan", 4, entry->plan);
+
+		Datum tuple[1] = { PointerGetDatum(PgbsonWriterGetPgbson(&writer)) };
+		bool nulls[1] = { false };
+		tuplestore_putvalues(tupleStore, descriptor, tuple, nulls);
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/*
+ * Turns on the row counts of the plan nodes and the timing of the query for the
+ * queries that commands run, so the query can be logged when it ends.
+ */
+static void
+SlowOperationExecutorStart(QueryDesc *queryDesc, int eflags)
+{
+	bool trackQuery = (eflags & EXEC_FLAG_EXPLAIN_ONLY) == 0 &&
+					  ShouldTrackQuery(queryDesc);
+	if (trackQuery)
+	{
+		queryDesc->instrument_options |= INSTRUMENT_ROWS;
+	}
+
+	if (PreviousExecutorStartHook != NULL)
+	{
+		PreviousExecutorStartHook(queryDesc, eflags);
+	}
+	else
+	{
+		standard_ExecutorStart(queryDesc, eflags);
+	}
+
+	if (trackQuery && queryDesc->totaltime == NULL)
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(
+			queryDesc->estate->es_query_cxt);
+		bool asyncMode = false;
+		queryDesc->totaltime = InstrAlloc(1, INSTRUMENT_TIMER, asyncMode);
+		MemoryContextSwitchTo(oldContext);
+	}
+}
+
+
+/*
+ * Counts the query in the statistics of its shape, and logs it if it ran longer
+ * than the threshold or is sampled before the executor state (and the
+ * instrumentation in it) goes away.
+ */
+static void
+SlowOperationExecutorEnd(QueryDesc *queryDesc)
+{
+	if (queryDesc->totaltime != NULL &&
+		(queryDesc->instrument_options & INSTRUMENT_ROWS) != 0 &&
+		ShouldTrackQuery(queryDesc))
+	{
+		InstrEndLoop(queryDesc->totaltime);
+		int64 executionMicros = (int64) (queryDesc->totaltime->total * 1000000.0);
+		const CommandActivity *activity = GetCurrentCommandActivity();
+
+		SlowOperationPlanStats planStats = { 0 };
+		if (queryDesc->planstate != NULL)
+		{
+			CollectPlanStats(queryDesc->planstate, &planStats);
+		}
+
+		RecordQueryShapeExecution(activity, executionMicros, planStats.docsExamined,
+								  (int64) queryDesc->estate->es_processed,
+								  planStats.indexId);
+
+		bool isLogged = EnableSlowOperationLog && SlowOperationLog != NULL &&
+						SlowOperationLogEntries > 0;
+		bool isSlow = executionMicros >= (int64) SlowOperationThresholdMs * 1000;
+		bool isSampled = !isSlow && SlowOperationSampleRate > 0 &&
+						 pg_prng_double(&pg_global_prng_state) <
+						 SlowOperationSampleRate;
+		if (isLogged && (isSlow || isSampled))
+		{
+			RecordSlowOperation(queryDesc, activity, &planStats, executionMicros,
+								isSampled);
+		}
+	}
+
+	if (PreviousExecutorEndHook != NULL)
+	{
+		PreviousExecutorEndHook(queryDesc);
+	}
+	else
+	{
+		standard_ExecutorEnd(queryDesc);
+	}
+}
+
+
+/*
+ * Only the queries that a command runs after it reported itself in the current
+ * statement are logged and counted in the query shape statistics: The
+ * statement that calls the command and the queries of parallel workers are not.
+ */
+static bool
+ShouldTrackQuery(QueryDesc *queryDesc)
+{
+	bool isLogged = EnableSlowOperationLog && SlowOperationLog != NULL &&
+					SlowOperationLogEntries > 0;
+	return (isLogged || EnableQueryShapeStats) && !IsParallelWorker() &&
+		   queryDesc->sourceText != debug_query_string &&
+		   GetCurrentCommandActivity() != NULL;
+}
+
+
+static void
+RecordSlowOperation(QueryDesc *queryDesc, const CommandActivity *activity,
+					const SlowOperationPlanStats *planStats, int64 executionMicros,
+					bool sampled)
+{
+	SlowOperationEntry *entry = palloc0(sizeof(SlowOperationEntry));
+	entry->timestamp = GetCurrentTimestamp();
+	entry->pid = MyProcPid;
+	entry->sampled = sampled;
+	entry->executionMicros = executionMicros;
+	entry->statementMicros = entry->timestamp - GetCurrentStatementStartTimestamp();
+	entry->docsExamined = planStats->docsExamined;
+	entry->docsReturned = (int64) queryDesc->estate->es_processed;
+
+	CopyTruncatedString(entry->commandName, MAX_COMMAND_ACTIVITY_NAME_LENGTH,
+						activity->commandName);
+	CopyTruncatedString(entry->databaseName, MAX_DATABASE_NAME_LENGTH,
+						activity->databaseName);
+	CopyTruncatedString(entry->collectionName, MAX_COLLECTION_NAME_LENGTH,
+						activity->collectionName);
+
+	if (OidIsValid(planStats->indexId))
+	{
+		char *indexName = get_rel_name(planStats->indexId);
+		if (indexName != NULL)
+		{
+			CopyTruncatedString(entry->indexName, NAMEDATALEN, indexName);
+		}
+	}
+
+	CopyTruncatedString(entry->sql, SLOW_OPERATION_SQL_LENGTH,
+						queryDesc->sourceText != NULL ? queryDesc->sourceText : "");
+	CopyTruncatedString(entry->plan, SLOW_OPERATION_PLAN_LENGTH,
+						GetPlanText(queryDesc));
+
+	LWLockAcquire(&SlowOperationLog->lock, LW_EXCLUSIVE);
+	uint64 slot = SlowOperationLog->nextEntry % SlowOperationLogEntries;
+	memcpy(&SlowOperationLog->entries[slot], entry, sizeof(SlowOperationEntry));
+	SlowOperationLog->nextEntry++;
+	LWLockRelease(&SlowOperationLog->lock);
+
+	pfree(entry);
+}
+
+
+/*
+ * Sums the rows read (returned and filtered out) by the scans of the plan, and
+ * finds the first index scanned.
+ */
+static bool
+CollectPlanStats(PlanState *planState, void *context)
+{
+	SlowOperationPlanStats *planStats = (SlowOperationPlanStats *) context;
+	Plan *plan = planState->plan;
+
+	bool isScan = false;
+	Oid indexId = InvalidOid;
+	switch (nodeTag(plan))
+	{
+		case T_IndexScan:
+		{
+			isScan = true;
+			indexId = ((IndexScan *) plan)->indexid;
+			break;
+		}
+
+		case T_IndexOnlyScan:
+		{
+			isScan = true;
+			indexId = ((IndexOnlyScan *) plan)->indexid;
+			break;
+		}
+
+		case T_BitmapIndexScan:
+		{
+			/* The rows are counted on the bitmap heap scan above it */
+			indexId = ((BitmapIndexScan *) plan)->indexid;
+			break;
+		}
+
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_BitmapHeapScan:
+		{
+			isScan = true;
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+
+	if (isScan && planState->instrument != NULL)
+	{
+		InstrEndLoop(planState->instrument);
+		planStats->docsExamined += (int64) (planState->instrument->ntuples +
+											planState->instrument->nfiltered1 +
+											planState->instrument->nfiltered2);
+	}
+
+	if (!OidIsValid(planStats->indexId) && OidIsValid(indexId))
+	{
+		planStats->indexId = indexId;
+	}
+
+	return planstate_tree_walker(planState, CollectPlanStats, context);
+}
+
+
+/*
+ * Gets the text explain of the executed plan with the actual row counts. The
+ * index names are left as the Postgres names: Resolving them goes through a
+ * separate connection, which is too expensive while the command runs.
+ */
+static char *
+GetPlanText(QueryDesc *queryDesc)
+{
+	ExplainState *explainState = NewExplainState();
+	explainState->analyze = true;
+	explainState->costs = false;
+	explainState->timing = false;
+	explainState->summary = false;
+	explainState->format = EXPLAIN_FORMAT_TEXT;
+
+	explain_get_index_name_hook_type indexNameHook = explain_get_index_name_hook;
+	explain_get_index_name_hook = NULL;
+	PG_TRY();
+	{
+		ExplainBeginOutput(explainState);
+		ExplainPrintPlan(explainState, queryDesc);
+		ExplainEndOutput(explainState);
+	}
+	PG_FINALLY();
+	{
+		explain_get_index_name_hook = indexNameHook;
+	}
+	PG_END_TRY();
+
+	return explainState->str->data;
+}
+
+
+/*
+ * Copies a string into a fixed size field and truncates it if it doesn't fit,
+ * without splitting a multibyte character.
+ */
+static void
+CopyTruncatedString(char *target, int targetSize, const char *source)
+{
+	int copyLength = pg_mbcliplen(source, strlen(source), targetSize - 1);
+	memcpy(target, source, copyLength);
+	target[copyLength] = '\0';
+}
@@ -0,0 +1,246 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/infrastructure/tailable_cursor_notifications.c
+ *
+ * Notifications of committed writes to the getMore of tailable cursors that
+ * await data (maxAwaitTimeMS). Collections are hashed to slots in shared
+ * memory, each with a generation that is incremented when a transaction that
+ * wrote to a collection of the slot commits, and a condition variable that is
+ * broadcast then. A getMore that finds no new data sleeps on the condition
+ * variable of its collection until the generation changes or the await time
+ * expires, rather than returning an empty batch for the client to poll again.
+ * Collections that share a slot only cause spurious wakeups.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <port/atomics.h>
+#include <storage/condition_variable.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/timestamp.h>
+
+#include "infrastructure/tailable_cursor_notifications.h"
+#include "infrastructure/wait_events.h"
+
+/* The number of slots the collections are hashed to */
+#define TAILABLE_CURSOR_NOTIFICATION_SLOTS 1024
+
+/* The collections written by a transaction that are tracked individually */
+#define MAX_PENDING_COLLECTION_WRITES 16
+
+typedef struct CollectionWriteSlot
+{
+	/* Incremented on every commit that wrote to a collection of the slot */
+	pg_atomic_uint64 writeGeneration;
+
+	/* Broadcast after the generation is incremented */
+	ConditionVariable writeConditionVariable;
+} CollectionWriteSlot;
+
+typedef struct TailableCursorNotificationsData
+{
+	CollectionWriteSlot slots[TAILABLE_CURSOR_NOTIFICATION_SLOTS];
+} TailableCursorNotificationsData;
+
+static TailableCursorNotificationsData *TailableCursorNotifications = NULL;
+
+/*
+ * The collections written by the current transaction, notified on commit. If
+ * it writes to more collections than are tracked, all slots are notified.
+ */
+static uint64 PendingCollectionWrites[MAX_PENDING_COLLECTION_WRITES];
+static int NumPendingCollectionWrites = 0;
+static bool PendingCollectionWritesOverflowed = false;
+
+static inline CollectionWriteSlot * GetCollectionWriteSlot(uint64 collectionId);
+static void NotifyCollectionWriteSlot(CollectionWriteSlot *slot);
+
+
+Size
+TailableCursorNotificationsShmemSize(void)
+{
+	return sizeof(TailableCursorNotificationsData);
+}
+
+
+/*
+ * InitializeTailableCursorNotificationsShmem initializes the shared memory
+ * write generations and condition variables of the collection slots.
+ */
+void
+InitializeTailableCursorNotificationsShmem(void)
+{
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	TailableCursorNotifications =
+		(TailableCursorNotificationsData *) ShmemInitStruct(
+			"DocumentDB Tailable Cursor Notifications",
+			TailableCursorNotificationsShmemSize(),
+			&found);
+
+	if (!found)
+	{
+		for (int i = 0; i < TAILABLE_CURSOR_NOTIFICATION_SLOTS; i++)
+		{
+			CollectionWriteSlot *slot = &TailableCursorNotifications->slots[i];
+			pg_atomic_init_u64(&slot->writeGeneration, 0);
+			ConditionVariableInit(&slot->writeConditionVariable);
+		}
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * NotifyCollectionWriteOnCommit records that the current transaction wrote to
+ * the collection, so that the tailable cursors that await data on it are
+ * woken up once the writes are visible (i.e. when the transaction commits).
+ */
+void
+NotifyCollectionWriteOnCommit(uint64 collectionId)
+{
+	if (!EnableTailableCursorAwaitData || TailableCursorNotifications == NULL ||
+		PendingCollectionWritesOverflowed)
+	{
+		return;
+	}
+
+	for (int i = 0; i < NumPendingCollectionWrites; i++)
+	{
+		if (PendingCollectionWrites[i] == collectionId)
+		{
+			return;
+		}
+	}
+
+	if (NumPendingCollectionWrites == MAX_PENDING_COLLECTION_WRITES)
+	{
+		PendingCollectionWritesOverflowed = true;
+		return;
+	}
+
+	PendingCollectionWrites[NumPendingCollectionWrites++] = collectionId;
+}
+
+
+/*
+ * ProcessPendingCollectionWriteNotifications notifies the collections written
+ * by the transaction if it committed, and forgets them either way. This is
+ * called from the transaction callback, after the commit is visible to other
+ * backends.
+ */
+void
+ProcessPendingCollectionWriteNotifications(bool isCommit)
+{
+	if (isCommit && TailableCursorNotifications != NULL)
+	{
+		if (PendingCollectionWritesOverflowed)
+		{
+			for (int i = 0; i < TAILABLE_CURSOR_NOTIFICATION_SLOTS; i++)
+			{
+				NotifyCollectionWriteSlot(&TailableCursorNotifications->slots[i]);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < NumPendingCollectionWrites; i++)
+			{
+				NotifyCollectionWriteSlot(GetCollectionWriteSlot(
+											  PendingCollectionWrites[i]));
+			}
+		}
+	}
+
+	NumPendingCollectionWrites = 0;
+	PendingCollectionWritesOverflowed = false;
+}
+
+
+/*
+ * GetCollectionWriteGeneration returns the write generation of the collection
+ * to pass to WaitForCollectionWrite. It must be read before the query for new
+ * data runs so that writes committed in between are not missed.
+ */
+uint64
+GetCollectionWriteGeneration(uint64 collectionId)
+{
+	if (TailableCursorNotifications == NULL)
+	{
+		return 0;
+	}
+
+	return pg_atomic_read_u64(&GetCollectionWriteSlot(collectionId)->writeGeneration);
+}
+
+
+/*
+ * WaitForCollectionWrite sleeps until a write to the collection commits after
+ * the given write generation was read, or the timeout expires. Returns true
+ * if a write committed. The sleep is interrupted by query cancellation (e.g.
+ * maxTimeMS).
+ */
+bool
+WaitForCollectionWrite(uint64 collectionId, uint64 writeGeneration, long timeoutMs)
+{
+	if (TailableCursorNotifications == NULL || timeoutMs <= 0)
+	{
+		return false;
+	}
+
+	CollectionWriteSlot *slot = GetCollectionWriteSlot(collectionId);
+	const uint32 waitEventInfo = EnableCustomWaitEvents ?
+								 GetDocumentDBWaitEventInfo(
+		DocumentDBWaitEvent_TailableCursorAwait) :
+								 PG_WAIT_EXTENSION;
+	TimestampTz deadline = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+													   timeoutMs);
+
+	bool written = false;
+	ConditionVariablePrepareToSleep(&slot->writeConditionVariable);
+	while (true)
+	{
+		if (pg_atomic_read_u64(&slot->writeGeneration) != writeGeneration)
+		{
+			written = true;
+			break;
+		}
+
+		long remainingMs = TimestampDifferenceMilliseconds(GetCurrentTimestamp(),
+														   deadline);
+		if (remainingMs <= 0)
+		{
+			break;
+		}
+
+		ConditionVariableTimedSleep(&slot->writeConditionVariable, remainingMs,
+									waitEventInfo);
+	}
+
+	ConditionVariableCancelSleep();
+	return written;
+}
+
+
+/* --------------------------------------------------------- */
+/* Private helper methods */
+/* --------------------------------------------------------- */
+
+static inline CollectionWriteSlot *
+GetCollectionWriteSlot(uint64 collectionId)
+{
+	return &TailableCursorNotifications->slots[collectionId %
+											   TAILABLE_CURSOR_NOTIFICATION_SLOTS];
+}
+
+
+static void
+NotifyCollectionWriteSlot(CollectionWriteSlot *slot)
+{
+	pg_atomic_fetch_add_u64(&slot->writeGeneration, 1);
+	ConditionVariableBroadcast(&slot->writeConditionVariable);
+}
@@ -0,0 +1,75 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/infrastructure/wait_events.c
+ *
+ * The wait events of the phases of the extension. On PostgreSQL 17 and later
+ * each phase is a custom wait event of the "Extension" type with its own name
+ * (e.g. DocumentDBQueryGeneration), registered the first time a backend
+ * reports it. Earlier versions only have the generic "Extension" wait event,
+ * and the file I/O of cursors keeps reporting the BufFile wait events.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <utils/wait_event.h>
+
+#include "infrastructure/wait_events.h"
+
+static const char *WaitEventNames[DocumentDBWaitEvent_Max] = {
+	[DocumentDBWaitEvent_QueryGeneration] = "DocumentDBQueryGeneration",
+	[DocumentDBWaitEvent_CursorFileRead] = "DocumentDBCursorFileRead",
+	[DocumentDBWaitEvent_CursorFileWrite] = "DocumentDBCursorFileWrite",
+	[DocumentDBWaitEvent_IndexTermExtraction] = "DocumentDBIndexTermExtraction",
+	[DocumentDBWaitEvent_SchemaValidation] = "DocumentDBSchemaValidation",
+	[DocumentDBWaitEvent_WorkerCall] = "DocumentDBWorkerCall",
+	[DocumentDBWaitEvent_TailableCursorAwait] = "DocumentDBTailableCursorAwait",
+};
+
+/* The wait event info of each wait event, 0 until the backend registers it */
+static uint32 WaitEventInfos[DocumentDBWaitEvent_Max] = { 0 };
+
+
+/*
+ * Returns the wait_event_info to report for the phase of the wait event.
+ */
+uint32
+GetDocumentDBWaitEventInfo(DocumentDBWaitEvent waitEvent)
+{
+	Assert(waitEvent >= 0 && waitEvent < DocumentDBWaitEvent_Max);
+	if (WaitEventInfos[waitEvent] != 0)
+	{
+		return WaitEventInfos[waitEvent];
+	}
+
+#if PG_VERSION_NUM >= 170000
+
+	/* The registry is shared: all backends get the same info for a name */
+	WaitEventInfos[waitEvent] = WaitEventExtensionNew(WaitEventNames[waitEvent]);
+#else
+	(void) WaitEventNames;
+	switch (waitEvent)
+	{
+		case DocumentDBWaitEvent_CursorFileRead:
+		{
+			WaitEventInfos[waitEvent] = WAIT_EVENT_BUFFILE_READ;
+			break;
+		}
+
+		case DocumentDBWaitEvent_CursorFileWrite:
+		{
+			WaitEventInfos[waitEvent] = WAIT_EVENT_BUFFILE_WRITE;
+			break;
+		}
+
+		default:
+		{
+			WaitEventInfos[waitEvent] = PG_WAIT_EXTENSION;
+			break;
+		}
+	}
+#endif
+
+	return WaitEventInfos[waitEvent];
+}
@@ -33,6 +33,8 @@ static void FreeUnusedValidators(SchemaNode *node);
 
 static void ParseProperties(const bson_value_t *value, SchemaNode *node);
 static void ParseRequired(const bson_value_t *value, SchemaNode *node);
+static void BuildSortedObjectFields(SchemaNode *node);
+static int CompareSchemaObjectFields(const void *left, const void *right);
 
 static void ParseJsonType(const bson_value_t *value, SchemaNode *node);
 static void ParseBsonType(const bson_value_t *value, SchemaNode *node);
@@ -84,7 +86,8 @@ BuildSchemaTree(SchemaTreeState *treeState, bson_iter_t *schemaIter)
  * For a given field name, this function searches and returns the matching field node,
  * from the "properties" Linked List.
  * Returns null if such child node does not exist.
- * TODO: Optimize this function by storing field nodes as BST (instead of Linked List)
+ * This is used while building the tree: Validation looks up fields with
+ * FindObjectFieldByName instead.
  */
 SchemaFieldNode *
 FindFieldNodeByName(const SchemaNode *node, const char *field)
@@ -108,6 +111,28 @@ FindFieldNodeByName(const SchemaNode *node, const char *field)
 }
 
 
+/*
+ * For a given field name, returns the entry of the field in the sorted fields of
+ * "properties" and "required" of the object node, or NULL if the field is in
+ * neither of them.
+ */
+const SchemaObjectField *
+FindObjectFieldByName(const SchemaNode *node, const StringView *field)
+{
+	const ValidationsObject *object = node->validations.object;
+	if (object == NULL || object->sortedFieldCount == 0)
+	{
+		return NULL;
+	}
+
+	SchemaObjectField key = { .field = *field };
+	return (const SchemaObjectField *) bsearch(&key, object->sortedFields,
+											   object->sortedFieldCount,
+											   sizeof(SchemaObjectField),
+											   CompareSchemaObjectFields);
+}
+
+
 /* -------------------------------------------------------- */
 /*              Core Functions                              */
 /* -------------------------------------------------------- */
@@ -387,6 +412,11 @@ BuildSchemaTreeCoreOnNode(bson_iter_t *schemaIter, SchemaNode *node)
 						errmsg(
 							"'encrypt' implies 'bsonType: BinData' and cannot be combined with 'type' in $jsonSchema")));
 	}
+	if (node->validationFlags.object)
+	{
+		BuildSortedObjectFields(node);
+	}
+
 	FreeUnusedValidators(node);
 }
 
@@ -460,6 +490,7 @@ ParseRequired(const bson_value_t *value, SchemaNode *node)
 
 	/* Hash table to track seen field names for efficient duplicate detection */
 	HTAB *seenFieldsHash = CreateStringViewHashSet();
+	int requiredCount = 0;
 
 	while (bson_iter_next(&iter))
 	{
@@ -495,6 +526,7 @@ ParseRequired(const bson_value_t *value, SchemaNode *node)
 		}
 
 		PgbsonArrayWriterWriteUtf8(&arrayWriter, field);
+		requiredCount++;
 	}
 
 	/* Clean up hash table */
@@ -504,11 +536,114 @@ ParseRequired(const bson_value_t *value, SchemaNode *node)
 		sizeof(bson_value_t));
 	PgbsonArrayWriterCopyDataToBsonValue(&arrayWriter,
 										 node->validations.object->required);
+	node->validations.object->requiredCount = requiredCount;
 	PgbsonWriterFree(&writer);
 	node->validationFlags.object |= ObjectValidationTypes_Required;
 }
 
 
+/*
+ * Builds the array of the fields of "properties" and "required" of the node
+ * sorted by name, and numbers the required fields so that validation tracks the
+ * ones seen in a document without a hash table per document. Rebuilt when more
+ * validations are added on the node.
+ */
+static void
+BuildSortedObjectFields(SchemaNode *node)
+{
+	ValidationsObject *object = node->validations.object;
+	if (object->sortedFields != NULL)
+	{
+		pfree(object->sortedFields);
+		object->sortedFields = NULL;
+		object->sortedFieldCount = 0;
+	}
+
+	int propertiesCount = 0;
+	for (SchemaNode *child = (SchemaNode *) object->properties; child != NULL;
+		 child = child->next)
+	{
+		propertiesCount++;
+	}
+
+	int maxFieldCount = propertiesCount + object->requiredCount;
+	if (maxFieldCount == 0)
+	{
+		return;
+	}
+
+	SchemaObjectField *fields = palloc0(sizeof(SchemaObjectField) * maxFieldCount);
+	int fieldCount = 0;
+	for (SchemaNode *child = (SchemaNode *) object->properties; child != NULL;
+		 child = child->next)
+	{
+		fields[fieldCount].field = ((SchemaFieldNode *) child)->field;
+		fields[fieldCount].fieldNode = (SchemaFieldNode *) child;
+		fields[fieldCount].requiredIndex = -1;
+		fieldCount++;
+	}
+
+	qsort(fields, fieldCount, sizeof(SchemaObjectField), CompareSchemaObjectFields);
+
+	if (node->validationFlags.object & ObjectValidationTypes_Required)
+	{
+		/* Required fields that are also properties share the entry of the property */
+		int sortedPropertiesCount = fieldCount;
+		int requiredIndex = 0;
+		bson_iter_t iter;
+		BsonValueInitIterator(object->required, &iter);
+		while (bson_iter_next(&iter))
+		{
+			uint32_t length = 0;
+			const char *field = bson_iter_utf8(&iter, &length);
+			SchemaObjectField key = {
+				.field = { .string = field, .length = length }
+			};
+			SchemaObjectField *property = bsearch(&key, fields, sortedPropertiesCount,
+												  sizeof(SchemaObjectField),
+												  CompareSchemaObjectFields);
+			if (property != NULL)
+			{
+				property->requiredIndex = requiredIndex;
+			}
+			else
+			{
+				fields[fieldCount].field = key.field;
+				fields[fieldCount].fieldNode = NULL;
+				fields[fieldCount].requiredIndex = requiredIndex;
+				fieldCount++;
+			}
+
+			requiredIndex++;
+		}
+
+		qsort(fields, fieldCount, sizeof(SchemaObjectField), CompareSchemaObjectFields);
+	}
+
+	object->sortedFields = fields;
+	object->sortedFieldCount = fieldCount;
+}
+
+
+/*
+ * Orders the fields of an object node by length and then by bytes: Any total
+ * order works for the binary search, and this one rejects most mismatches on
+ * the length alone.
+ */
+static int
+CompareSchemaObjectFields(const void *left, const void *right)
+{
+	const StringView *leftField = &((const SchemaObjectField *) left)->field;
+	const StringView *rightField = &((const SchemaObjectField *) right)->field;
+	if (leftField->length != rightField->length)
+	{
+		return leftField->length < rightField->length ? -1 : 1;
+	}
+
+	return memcmp(leftField->string, rightField->string, leftField->length);
+}
+
+
 /*
  * ParseJsonType function reads the schema value for "type" keyword.
  * And stores it in the Node's common validations section.
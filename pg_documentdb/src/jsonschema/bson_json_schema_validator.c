@@ -207,67 +207,57 @@ ValidateBsonValueObject(const bson_value_t *value, const SchemaNode *node)
 		return true;
 	}
 
-	HTAB *hashTableForRequired = NULL;
-	bool isRequiredValid = false;
-	int requiredCount = 0;
-
-	/* required */
-	if (node->validationFlags.object & ObjectValidationTypes_Required)
+	/* The required fields of the schema seen so far in the document */
+	const ValidationsObject *object = node->validations.object;
+	int missingRequiredCount = 0;
+	bool *requiredSeen = NULL;
+	if (node->validationFlags.object & ObjectValidationTypes_Required &&
+		object->requiredCount > 0)
 	{
-		isRequiredValid = true;
-		requiredCount = 0;
-		hashTableForRequired = CreateStringViewHashSet();
-		bson_iter_t iter;
-		BsonValueInitIterator(node->validations.object->required, &iter);
-		while (bson_iter_next(&iter))
-		{
-			const char *field = bson_iter_utf8(&iter, NULL);
-			StringView fieldValue = {
-				.string = field,
-				.length = strlen(field)
-			};
-			hash_search(hashTableForRequired, &fieldValue, HASH_ENTER, NULL);
-			requiredCount++;
-		}
+		missingRequiredCount = object->requiredCount;
+		requiredSeen = palloc0(sizeof(bool) * object->requiredCount);
 	}
 
 	bson_iter_t iter;
 	BsonValueInitIterator(value, &iter);
 	while (bson_iter_next(&iter))
 	{
-		const char *field = bson_iter_key(&iter);
-		const bson_value_t *fieldValue = bson_iter_value(&iter);
+		StringView fieldView = {
+			.string = bson_iter_key(&iter),
+			.length = bson_iter_key_len(&iter)
+		};
+
+		const SchemaObjectField *objectField = FindObjectFieldByName(node, &fieldView);
+		if (objectField == NULL)
+		{
+			continue;
+		}
 
-		SchemaFieldNode *fieldNode = FindFieldNodeByName(node, field);
-		if (fieldNode != NULL)
+		if (objectField->fieldNode != NULL &&
+			!ValidateBsonValueAgainstSchemaTree(bson_iter_value(&iter),
+												(SchemaNode *) objectField->fieldNode))
 		{
-			if (!ValidateBsonValueAgainstSchemaTree(fieldValue,
-													(SchemaNode *) fieldNode))
+			if (requiredSeen != NULL)
 			{
-				return false;
+				pfree(requiredSeen);
 			}
+
+			return false;
 		}
 
 		/* required validation */
-		if (isRequiredValid)
-		{
-			bool found = false;
-			StringView fieldView = {
-				.string = field,
-				.length = strlen(field)
-			};
-			hash_search(hashTableForRequired, &fieldView, HASH_REMOVE, &found);
-			if (found)
-			{
-				requiredCount--;
-			}
+		if (requiredSeen != NULL && objectField->requiredIndex >= 0 &&
+			!requiredSeen[objectField->requiredIndex])
+		{
+			requiredSeen[objectField->requiredIndex] = true;
+			missingRequiredCount--;
 		}
 	}
 
-	if (isRequiredValid)
+	if (requiredSeen != NULL)
 	{
-		hash_destroy(hashTableForRequired);
-		if (requiredCount > 0)
+		pfree(requiredSeen);
+		if (missingRequiredCount > 0)
 		{
 			return false;
 		}
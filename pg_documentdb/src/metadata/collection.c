@@ -13,6 +13,7 @@
 
 #include "access/xact.h"
 #include "catalog/pg_attribute.h"
+#include "catalog/pg_index.h"
 #include "commands/extension.h"
 #include "executor/spi.h"
 #include "lib/stringinfo.h"
@@ -41,6 +42,7 @@
 #include "commands/parse_error.h"
 #include "utils/feature_counter.h"
 #include "jsonschema/bson_json_schema_tree.h"
+#include "infrastructure/documentdb_plan_cache.h"
 
 #define CREATE_COLLECTION_FUNC_NARGS 2
 
@@ -102,10 +104,17 @@ static const int NonWritableSystemCollectionNamesLength = 4;
 static const uint32_t MaxDatabaseCollectionLength = 235;
 static const StringView SystemPrefix = { .length = 7, .string = "system." };
 
+/* The buckets collections of time-series collections */
+static const StringView SystemBucketsPrefix = { .length = 15, .string = "system.buckets." };
+
 extern bool UseLocalExecutionShardQueries;
 extern bool ForceLocalExecutionShardQueries;
 extern bool EnableSchemaValidation;
+extern bool EnableCollectionDocumentCompression;
+extern bool EnableClusteredCollections;
+extern int ClusteredCollectionFillFactor;
 extern int MaxSchemaValidatorSize;
+extern bool EnableCollectionCatalogPlanCache;
 
 /* user-defined functions */
 PG_FUNCTION_INFO_V1(command_collection_table);
@@ -126,6 +135,9 @@ static bool GetMongoCollectionFromCatalogByNameDatum(Datum databaseNameDatum,
 static Oid GetRelationIdForCollectionTableName(char *collectionTableName,
 											   LOCKMODE lockMode);
 static AttrNumber GetMongoDataCreationTimeVarAttrNumber(Oid collectionOid);
+static void ExecuteCollectionCatalogQuery(uint64 queryId, const char *query,
+										  int argCount, Oid *argTypes,
+										  Datum *argValues);
 static MongoCollection * GetMongoCollectionByNameDatumCore(Datum databaseNameDatum,
 														   Datum collectionNameDatum,
 														   LOCKMODE lockMode);
@@ -881,7 +893,8 @@ GetMongoCollectionFromCatalogById(uint64 collectionId, Oid relationId,
 	argTypes[0] = INT8OID;
 	argValues[0] = UInt64GetDatum(collectionId);
 
-	SPI_execute_with_args(query.data, argCount, argTypes, argValues, NULL, false, 1);
+	ExecuteCollectionCatalogQuery(QUERY_ID_COLLECTION_BY_ID, query.data, argCount,
+								  argTypes, argValues);
 	if (SPI_processed > 0)
 	{
 		TupleDesc tupleDescriptor = SPI_tuptable->tupdesc;
@@ -997,6 +1010,34 @@ GetMongoCollectionFromCatalogById(uint64 collectionId, Oid relationId,
 }
 
 
+/*
+ * ExecuteCollectionCatalogQuery runs a lookup of at most one row of the
+ * collections catalog in the current SPI connection. Backends look up every
+ * collection they touch once, so the plan is kept in the query plan cache
+ * rather than parsed and planned on each lookup, which also lets new
+ * backends prewarm it.
+ */
+static void
+ExecuteCollectionCatalogQuery(uint64 queryId, const char *query, int argCount,
+							  Oid *argTypes, Datum *argValues)
+{
+	bool readOnly = false;
+	long tupleCountLimit = 1;
+	if (EnableCollectionCatalogPlanCache)
+	{
+		uint64 catalogCollectionId = 0;
+		SPIPlanPtr plan = GetSPIQueryPlan(catalogCollectionId, queryId, query,
+										  argTypes, argCount);
+		SPI_execute_plan(plan, argValues, NULL, readOnly, tupleCountLimit);
+	}
+	else
+	{
+		SPI_execute_with_args(query, argCount, argTypes, argValues, NULL, readOnly,
+							  tupleCountLimit);
+	}
+}
+
+
 /*
  * GetMongoCollectionFromCatalogByNameDatum returns whether a collection
  * with the given name (as database and collection name datums) exist in
@@ -1031,7 +1072,8 @@ GetMongoCollectionFromCatalogByNameDatum(Datum databaseNameDatum,
 	argTypes[1] = TEXTOID;
 	argValues[1] = collectionNameDatum;
 
-	SPI_execute_with_args(query.data, argCount, argTypes, argValues, NULL, false, 1);
+	ExecuteCollectionCatalogQuery(QUERY_ID_COLLECTION_BY_NAME, query.data, argCount,
+								  argTypes, argValues);
 	if (SPI_processed > 0)
 	{
 		TupleDesc tupleDescriptor = SPI_tuptable->tupdesc;
@@ -1282,7 +1324,9 @@ void
 ValidateCollectionNameForValidSystemNamespace(StringView *collectionView,
 											  Datum databaseNameDatum)
 {
-	if (StringViewStartsWithStringView(collectionView, &SystemPrefix))
+	if (StringViewStartsWithStringView(collectionView, &SystemPrefix) &&
+		!(StringViewStartsWithStringView(collectionView, &SystemBucketsPrefix) &&
+		  collectionView->length > SystemBucketsPrefix.length))
 	{
 		bool found = false;
 		for (int i = 0; i < ValidSystemCollectionNamesLength; i++)
@@ -1953,6 +1997,199 @@ ParseAndGetValidationLevelOption(bson_iter_t *iter, const char *validationLevelN
 }
 
 
+/*
+ * This function parses and checks the bson value for "documentCompression" option
+ * given in "create"/"collMod" command. The option maps to the compression method
+ * used when the document column is toasted.
+ */
+char *
+ParseAndGetDocumentCompressionOption(bson_iter_t *iter, const char *compressionName)
+{
+	if (!EnableCollectionDocumentCompression)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("documentCompression not supported yet")));
+	}
+
+	EnsureTopLevelFieldType(compressionName, iter, BSON_TYPE_UTF8);
+	const char *compression = bson_iter_utf8(iter, NULL);
+	if (strcmp(compression, "default") == 0 ||
+		strcmp(compression, "pglz") == 0 ||
+		strcmp(compression, "lz4") == 0)
+	{
+		return pstrdup(compression);
+	}
+	else
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg(
+							"The enumeration value '%s' provided for the field '%s' is invalid.",
+							compression, compressionName),
+						errdetail_log(
+							"The enumeration value '%s' provided for the field '%s' is invalid.",
+							compression, compressionName)));
+	}
+}
+
+
+/*
+ * Sets the compression method used for the document column of the collection's
+ * data table. This only applies to documents written after the change: existing
+ * documents keep their current compression until they are rewritten.
+ */
+void
+SetCollectionDocumentCompression(const MongoCollection *collection,
+								 const char *compression)
+{
+	StringInfo query = makeStringInfo();
+	appendStringInfo(query,
+					 "ALTER TABLE %s.%s ALTER COLUMN document SET COMPRESSION %s",
+					 ApiDataSchemaName, collection->tableName, compression);
+
+	bool readOnly = false;
+	bool isNull = false;
+	ExtensionExecuteQueryViaSPI(query->data, readOnly, SPI_OK_UTILITY, &isNull);
+}
+
+
+/*
+ * This function parses and checks the "clusteredIndex" option given in "create".
+ * Only a clustered index on { _id: 1 } is supported: it is the primary key of
+ * the data table that the documents are then kept ordered by.
+ */
+void
+ParseClusteredIndexOption(bson_iter_t *iter, const char *clusteredIndexName)
+{
+	if (!EnableClusteredCollections)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg("clusteredIndex not supported yet")));
+	}
+
+	EnsureTopLevelFieldType(clusteredIndexName, iter, BSON_TYPE_DOCUMENT);
+
+	bool hasKey = false;
+	bool hasUnique = false;
+	bson_iter_t clusteredIndexIter;
+	bson_iter_recurse(iter, &clusteredIndexIter);
+	while (bson_iter_next(&clusteredIndexIter))
+	{
+		const char *key = bson_iter_key(&clusteredIndexIter);
+		const bson_value_t *value = bson_iter_value(&clusteredIndexIter);
+		if (strcmp(key, "key") == 0)
+		{
+			EnsureTopLevelFieldType(psprintf("%s.key", clusteredIndexName),
+									&clusteredIndexIter, BSON_TYPE_DOCUMENT);
+
+			bson_iter_t keyIter;
+			BsonValueInitIterator(value, &keyIter);
+			if (!bson_iter_next(&keyIter) || strcmp(bson_iter_key(&keyIter), "_id") != 0 ||
+				!BsonValueIsNumber(bson_iter_value(&keyIter)) ||
+				BsonValueAsDouble(bson_iter_value(&keyIter)) != 1 ||
+				bson_iter_next(&keyIter))
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"The clusteredIndex option is only supported for key: {_id: 1}")));
+			}
+
+			hasKey = true;
+		}
+		else if (strcmp(key, "unique") == 0)
+		{
+			EnsureTopLevelFieldType(psprintf("%s.unique", clusteredIndexName),
+									&clusteredIndexIter, BSON_TYPE_BOOL);
+			if (!value->value.v_bool)
+			{
+				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+								errmsg(
+									"The clusteredIndex option requires unique: true")));
+			}
+
+			hasUnique = true;
+		}
+		else if (strcmp(key, "name") == 0)
+		{
+			/* The _id index keeps its name */
+			EnsureTopLevelFieldType(psprintf("%s.name", clusteredIndexName),
+									&clusteredIndexIter, BSON_TYPE_UTF8);
+		}
+		else if (strcmp(key, "v") == 0)
+		{
+			EnsureTopLevelFieldIsNumberLike(psprintf("%s.v", clusteredIndexName), value);
+		}
+		else
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_UNKNOWNBSONFIELD),
+							errmsg("The BSON field '%s.%s' is not recognized as a valid field.",
+								   clusteredIndexName, key)));
+		}
+	}
+
+	if (!hasKey || !hasUnique)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION40414),
+						errmsg("BSON field '%s.%s' is missing but is a required field",
+							   clusteredIndexName, !hasKey ? "key" : "unique")));
+	}
+}
+
+
+/*
+ * Marks the primary key (the _id index) of the collection's data table as its
+ * clustering index and leaves free space in its pages. A CLUSTER (run by compact
+ * or by the background worker) then rewrites the table in _id order, and the
+ * free space keeps updated documents in place in between.
+ */
+void
+SetCollectionClustered(const MongoCollection *collection)
+{
+	StringInfo query = makeStringInfo();
+	appendStringInfo(query,
+					 "ALTER TABLE %s.%s SET (fillfactor = %d)",
+					 ApiDataSchemaName, collection->tableName,
+					 ClusteredCollectionFillFactor);
+
+	bool readOnly = false;
+	bool isNull = false;
+	ExtensionExecuteQueryViaSPI(query->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	resetStringInfo(query);
+	appendStringInfo(query,
+					 "ALTER TABLE %s.%s CLUSTER ON collection_pk_" UINT64_FORMAT,
+					 ApiDataSchemaName, collection->tableName,
+					 collection->collectionId);
+	ExtensionExecuteQueryViaSPI(query->data, readOnly, SPI_OK_UTILITY, &isNull);
+}
+
+
+/*
+ * Whether the collection was created with a clusteredIndex, i.e. its _id index
+ * is the clustering index of the data table.
+ */
+bool
+IsClusteredCollection(uint64 collectionId)
+{
+	char primaryKeyName[NAMEDATALEN];
+	snprintf(primaryKeyName, NAMEDATALEN, "collection_pk_" UINT64_FORMAT, collectionId);
+	Oid primaryKeyOid = get_relname_relid(primaryKeyName, ApiDataNamespaceOid());
+	if (!OidIsValid(primaryKeyOid))
+	{
+		return false;
+	}
+
+	HeapTuple indexTuple = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(primaryKeyOid));
+	if (!HeapTupleIsValid(indexTuple))
+	{
+		return false;
+	}
+
+	bool isClustered = ((Form_pg_index) GETSTRUCT(indexTuple))->indisclustered;
+	ReleaseSysCache(indexTuple);
+	return isClustered;
+}
+
+
 /*
  * This utility function updates the `MongCollection` struct using the `collectionId` and `shardOid`.
  */
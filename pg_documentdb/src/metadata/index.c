@@ -2492,6 +2492,16 @@ AreIndexOptionsStillEquivalent(const char *path, const bson_value_t *left,
 
 		return enableCompositeTermLeft == enableCompositeTermRight;
 	}
+	else if (strcmp(path, "collation") == 0)
+	{
+		/* Indexes on the same keys with a different collation are distinct */
+		if (left == NULL || right == NULL)
+		{
+			return left == right;
+		}
+
+		return BsonValueEquals(left, right);
+	}
 	else
 	{
 		/* Other fields do not change index equivalency */
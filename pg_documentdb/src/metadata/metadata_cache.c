@@ -35,6 +35,7 @@
 #include "metadata/metadata_cache.h"
 #include "metadata/collection.h"
 #include "commands/defrem.h"
+#include "aggregation/bson_aggregation_query_cache.h"
 
 
 #define PG_EXTENSION_NAME_SCAN_NARGS 1
@@ -203,6 +204,9 @@ typedef struct DocumentDBApiOidCacheData
 	/* OID of the current_op aggregation function */
 	Oid BsonCurrentOpAggregationFunctionId;
 
+	/* OID of the ApiInternalSchemaNameV2.query_shape_stats function */
+	Oid QueryShapeStatsFunctionId;
+
 	/* OID of the ApiSchemaName.list_indexes function */
 	Oid IndexSpecAsBsonFunctionId;
 
@@ -569,6 +573,12 @@ typedef struct DocumentDBApiOidCacheData
 	/* Oid of the bson_densify_full window function */
 	Oid BsonDensifyFullWindowFunctionOid;
 
+	/* Oid of the bson_densify_unwind function */
+	Oid BsonDensifyUnwindFunctionOid;
+
+	/* Oid of the bson_timeseries_unpack_bucket function */
+	Oid BsonTimeseriesUnpackBucketFunctionOid;
+
 	/* OID of the drandom postgres method which generates a random float number in range [0 - 1) */
 	Oid PostgresDrandomFunctionId;
 
@@ -675,6 +685,9 @@ typedef struct DocumentDBApiOidCacheData
 	/* OID of the operator class for BSON Path operations with {ExtensionObjectPrefix}_rum */
 	Oid BsonRumHashPathOperatorFamily;
 
+	/* OID of the bson_hash_path_ops operator family for native hash indexes */
+	Oid BsonHashPathOperatorFamily;
+
 	/* OID of the operator class for BSON GIST geography */
 	Oid BsonGistGeographyOperatorFamily;
 
@@ -900,6 +913,36 @@ typedef struct DocumentDBApiOidCacheData
 	/* OID of the bson_add_to_set function. */
 	Oid ApiCatalogBsonAddToSetAggregateFunctionOid;
 
+	/* OID of the BSON_ADD_TO_SET_PARALLEL aggregate function */
+	Oid ApiCatalogBsonAddToSetParallelAggregateFunctionOid;
+
+	/* OID of the BSON_ARRAY_AGG_PARALLEL aggregate function */
+	Oid ApiCatalogBsonArrayParallelAggregateFunctionOid;
+
+	/* OID of the BSON_FIRST_PARALLEL aggregate function */
+	Oid ApiInternalBsonFirstParallelAggregateFunctionOid;
+
+	/* OID of the BSON_LAST_PARALLEL aggregate function */
+	Oid ApiInternalBsonLastParallelAggregateFunctionOid;
+
+	/* OID of the BSON_FIRSTN_PARALLEL aggregate function */
+	Oid ApiInternalBsonFirstNParallelAggregateFunctionOid;
+
+	/* OID of the BSON_LASTN_PARALLEL aggregate function */
+	Oid ApiInternalBsonLastNParallelAggregateFunctionOid;
+
+	/* OID of the BSON_COUNT(*) aggregate function */
+	Oid ApiInternalBsonCountAggregateFunctionOid;
+
+	/* OID of the BSON_APPROX_COUNT_DISTINCT aggregate function */
+	Oid ApiInternalBsonApproxCountDistinctAggregateFunctionOid;
+
+	/* OID of the BSON_EXACT_PERCENTILE aggregate function */
+	Oid ApiInternalBsonExactPercentileAggregateFunctionOid;
+
+	/* OID of the BSON_EXACT_MEDIAN aggregate function */
+	Oid ApiInternalBsonExactMedianAggregateFunctionOid;
+
 	/* OID of the bson_repath_and_build function */
 	Oid ApiCatalogBsonRepathAndBuildFunctionOid;
 
@@ -984,6 +1027,15 @@ typedef struct DocumentDBApiOidCacheData
 	/* OID of the ApiInternalSchemaName.bson_dollar_bucket_auto function */
 	Oid BsonDollarBucketAutoFunctionOid;
 
+	/* OID of the ApiInternalSchemaName.bson_dollar_graph_lookup_traverse function */
+	Oid BsonDollarGraphLookupTraverseFunctionOid;
+
+	/* OID of the bson_dollar_bucket_auto_boundaries aggregate */
+	Oid BsonDollarBucketAutoBoundariesAggregateOid;
+
+	/* OID of the bson_dollar_bucket_auto_assign function */
+	Oid BsonDollarBucketAutoAssignFunctionOid;
+
 	/* Postgis box2df type id */
 	Oid Box2dfTypeId;
 
@@ -1243,6 +1295,40 @@ InitializeDocumentDBApiExtensionCache(void)
 }
 
 
+/*
+ * PrewarmDocumentDBApiExtensionCache initializes the extension cache and looks
+ * up the types, operators and functions that nearly every query and write
+ * resolves, so that the first requests on a new backend don't pay for the
+ * catalog lookups. Other entries are still looked up lazily.
+ */
+void
+PrewarmDocumentDBApiExtensionCache(void)
+{
+	InitializeDocumentDBApiExtensionCache();
+	if (!IsDocumentDBApiExtensionActive())
+	{
+		return;
+	}
+
+	(void) BsonTypeId();
+	(void) DocumentDBCoreBsonTypeId();
+	(void) BsonQueryTypeId();
+	(void) IndexSpecTypeId();
+	(void) BsonEqualOperatorId();
+	(void) BsonLessThanOperatorId();
+	(void) BigintEqualOperatorId();
+	(void) ApiCollectionFunctionId();
+	(void) BsonQueryMatchFunctionId();
+	(void) BsonEqualMatchRuntimeFunctionId();
+	(void) BsonExpressionGetFunctionOid();
+	(void) BsonOrderByFunctionOid();
+	(void) BsonDollarProjectFunctionOid();
+	(void) BsonDollarAddFieldsFunctionOid();
+	(void) ApiCursorStateFunctionId();
+	(void) BsonEmptyDataTableFunctionId();
+}
+
+
 /* Invalidates the collections cache using the collections table oid.
  * this is used to be able to invalidate the cache via the version cache
  * so that the lifetime of both are tight together.
@@ -1268,6 +1354,9 @@ InvalidateCollectionsCache()
 static void
 InvalidateDocumentDBApiCache(Datum argument, Oid relationId)
 {
+	/* Generated queries embed the relations they read, drop them all */
+	InvalidateQueryShapeCache();
+
 	if (relationId == InvalidOid || relationId == Cache.CollectionsTableId)
 	{
 		/*
@@ -2990,6 +3079,35 @@ BsonDensifyFullWindowFunctionOid(void)
 }
 
 
+/*
+ * Returns the OID of the ApiInternalSchemaName.bson_densify_unwind function.
+ */
+Oid
+BsonDensifyUnwindFunctionOid(void)
+{
+	int nargs = 2;
+	Oid argTypes[2] = { BsonTypeId(), BsonTypeId() };
+	bool missingOk = false;
+	return GetSchemaFunctionIdWithNargs(&Cache.BsonDensifyUnwindFunctionOid,
+										DocumentDBApiInternalSchemaName,
+										"bson_densify_unwind", nargs, argTypes,
+										missingOk);
+}
+
+
+Oid
+BsonTimeseriesUnpackBucketFunctionOid(void)
+{
+	int nargs = 2;
+	Oid argTypes[2] = { BsonTypeId(), BsonTypeId() };
+	bool missingOk = false;
+	return GetSchemaFunctionIdWithNargs(&Cache.BsonTimeseriesUnpackBucketFunctionOid,
+										DocumentDBApiInternalSchemaName,
+										"bson_timeseries_unpack_bucket", nargs,
+										argTypes, missingOk);
+}
+
+
 /*
  * Returns the OID of the ApiSchema.cursor_state function.
  */
@@ -3217,6 +3335,26 @@ BsonCurrentOpAggregationFunctionId(void)
 }
 
 
+Oid
+QueryShapeStatsFunctionId(void)
+{
+	InitializeDocumentDBApiExtensionCache();
+
+	if (Cache.QueryShapeStatsFunctionId == InvalidOid)
+	{
+		List *functionNameList = list_make2(makeString(ApiInternalSchemaNameV2),
+											makeString("query_shape_stats"));
+		Oid paramOids[1] = { BOOLOID };
+		bool missingOK = false;
+
+		Cache.QueryShapeStatsFunctionId =
+			LookupFuncName(functionNameList, 1, paramOids, missingOK);
+	}
+
+	return Cache.QueryShapeStatsFunctionId;
+}
+
+
 /*
  * IndexSpecAsBsonFunctionId returns the OID of the ApiInternalSchemaName.index_spec_as_bson function.
  */
@@ -4428,6 +4566,96 @@ BsonAddToSetAggregateFunctionOid(void)
 }
 
 
+Oid
+BsonAddToSetParallelAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiCatalogBsonAddToSetParallelAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_add_to_set_parallel");
+}
+
+
+Oid
+BsonArrayParallelAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiCatalogBsonArrayParallelAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_array_agg_parallel");
+}
+
+
+Oid
+BsonFirstParallelAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonFirstParallelAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_first_parallel");
+}
+
+
+Oid
+BsonLastParallelAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonLastParallelAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_last_parallel");
+}
+
+
+Oid
+BsonFirstNParallelAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonFirstNParallelAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_firstn_parallel");
+}
+
+
+Oid
+BsonLastNParallelAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonLastNParallelAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_lastn_parallel");
+}
+
+
+Oid
+BsonCountAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonCountAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_count");
+}
+
+
+Oid
+BsonApproxCountDistinctAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonApproxCountDistinctAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_approx_count_distinct");
+}
+
+
+Oid
+BsonExactPercentileAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonExactPercentileAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_exact_percentile");
+}
+
+
+Oid
+BsonExactMedianAggregateFunctionOid(void)
+{
+	return GetAggregateFunctionByName(
+		&Cache.ApiInternalBsonExactMedianAggregateFunctionOid,
+		DocumentDBApiInternalSchemaName, "bson_exact_median");
+}
+
+
 Oid
 PostgresAnyValueFunctionOid(void)
 {
@@ -4546,6 +4774,75 @@ BsonDollarBucketAutoFunctionOid(void)
 }
 
 
+Oid
+BsonDollarGraphLookupTraverseFunctionOid(void)
+{
+	InitializeDocumentDBApiExtensionCache();
+
+	if (Cache.BsonDollarGraphLookupTraverseFunctionOid == InvalidOid)
+	{
+		List *functionNameList = list_make2(makeString(DocumentDBApiInternalSchemaName),
+											makeString(
+												"bson_dollar_graph_lookup_traverse"));
+		Oid paramOids[2] = { BsonTypeId(), BsonTypeId() };
+		bool missingOK = false;
+
+		Cache.BsonDollarGraphLookupTraverseFunctionOid =
+			LookupFuncName(functionNameList, 2, paramOids, missingOK);
+	}
+
+	return Cache.BsonDollarGraphLookupTraverseFunctionOid;
+}
+
+
+/*
+ * Returns the OID of the ApiInternalSchemaName.bson_dollar_bucket_auto_boundaries
+ * aggregate.
+ */
+Oid
+BsonDollarBucketAutoBoundariesAggregateOid(void)
+{
+	InitializeDocumentDBApiExtensionCache();
+
+	if (Cache.BsonDollarBucketAutoBoundariesAggregateOid == InvalidOid)
+	{
+		List *functionNameList = list_make2(makeString(DocumentDBApiInternalSchemaName),
+											makeString(
+												"bson_dollar_bucket_auto_boundaries"));
+		Oid paramOids[2] = { BsonTypeId(), BsonTypeId() };
+		bool missingOK = false;
+
+		Cache.BsonDollarBucketAutoBoundariesAggregateOid =
+			LookupFuncName(functionNameList, 2, paramOids, missingOK);
+	}
+
+	return Cache.BsonDollarBucketAutoBoundariesAggregateOid;
+}
+
+
+/*
+ * Returns the OID of the ApiInternalSchemaName.bson_dollar_bucket_auto_assign function.
+ */
+Oid
+BsonDollarBucketAutoAssignFunctionOid(void)
+{
+	InitializeDocumentDBApiExtensionCache();
+
+	if (Cache.BsonDollarBucketAutoAssignFunctionOid == InvalidOid)
+	{
+		List *functionNameList = list_make2(makeString(DocumentDBApiInternalSchemaName),
+											makeString("bson_dollar_bucket_auto_assign"));
+		Oid paramOids[2] = { BsonTypeId(), BsonTypeId() };
+		bool missingOK = false;
+
+		Cache.BsonDollarBucketAutoAssignFunctionOid =
+			LookupFuncName(functionNameList, 2, paramOids, missingOK);
+	}
+
+	return Cache.BsonDollarBucketAutoAssignFunctionOid;
+}
+
+
 Oid
 BsonRepathAndBuildFunctionOid(void)
 {
@@ -6336,6 +6633,27 @@ BsonRumHashPathOperatorFamily(void)
 }
 
 
+/*
+ * OID of the operator family for native hash indexes on hashed paths
+ */
+Oid
+BsonHashPathOperatorFamily(void)
+{
+	InitializeDocumentDBApiExtensionCache();
+
+	if (Cache.BsonHashPathOperatorFamily == InvalidOid)
+	{
+		bool missingOk = false;
+		Cache.BsonHashPathOperatorFamily = get_opfamily_oid(
+			HASH_AM_OID, list_make2(makeString(ApiInternalSchemaNameV2),
+									makeString("bson_hash_path_ops")),
+			missingOk);
+	}
+
+	return Cache.BsonHashPathOperatorFamily;
+}
+
+
 /*
  * OID of the operator class for BSON GIST spherical geometries
  */
@@ -9,7 +9,10 @@
  */
 #include <postgres.h>
 #include <miscadmin.h>
+#include <catalog/pg_statistic.h>
 #include <utils/fmgrprotos.h>
+#include <utils/lsyscache.h>
+#include <utils/syscache.h>
 
 #include "metadata/relation_utils.h"
 
@@ -32,3 +35,35 @@ SequenceGetNextValAsUser(Oid sequenceId, Oid userId)
 
 	return resultDatum;
 }
+
+
+/*
+ * TryGetAttributeCorrelation gets the correlation between the physical order of
+ * the rows of the relation and the order of the values of the attribute, as
+ * computed by the last ANALYZE. Returns false if there are no such statistics.
+ */
+bool
+TryGetAttributeCorrelation(Oid relationId, AttrNumber attributeNumber,
+						   double *correlation)
+{
+	HeapTuple statsTuple = SearchSysCache3(STATRELATTINH,
+										   ObjectIdGetDatum(relationId),
+										   Int16GetDatum(attributeNumber),
+										   BoolGetDatum(false));
+	if (!HeapTupleIsValid(statsTuple))
+	{
+		return false;
+	}
+
+	AttStatsSlot statsSlot;
+	bool found = get_attstatsslot(&statsSlot, statsTuple, STATISTIC_KIND_CORRELATION,
+								  InvalidOid, ATTSTATSSLOT_NUMBERS);
+	if (found)
+	{
+		*correlation = statsSlot.numbers[0];
+		free_attstatsslot(&statsSlot);
+	}
+
+	ReleaseSysCache(statsTuple);
+	return found;
+}
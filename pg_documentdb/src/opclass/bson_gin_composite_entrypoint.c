@@ -1117,6 +1117,12 @@ gin_bson_composite_ordering_transform(PG_FUNCTION_ARGS)
 		for (int i = 0; i < numPaths; i++)
 		{
 			BsonIndexTerm *term = &compareTerm[i];
+			if (IsIndexTermValueUndefined(term))
+			{
+				/* The path doesn't exist in the document, so don't project it */
+				continue;
+			}
+
 			PgbsonHeapWriterAppendValue(writer, indexPaths[i], indexPathLengths[i],
 										&term->element.bsonValue);
 		}
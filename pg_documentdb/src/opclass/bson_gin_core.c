@@ -37,6 +37,7 @@
 #include "query/bson_dollar_operators.h"
 #include "query/query_operator.h"
 #include "utils/documentdb_errors.h"
+#include "infrastructure/wait_events.h"
 #include <math.h>
 
 /* --------------------------------------------------------- */
@@ -617,6 +618,15 @@ GinBsonConsistentCore(BsonIndexStrategy strategy,
 				*recheck = IsSerializedIndexTermTruncated(DatumGetByteaPP(queryKeys[0]));
 				return check[0];
 			}
+			else if (IsSerializedIndexTermTruncated(DatumGetByteaPP(queryKeys[0])))
+			{
+				/*
+				 * A truncated value along with the hash of the full value: Both must
+				 * match. Values with the same hash still need the recheck.
+				 */
+				*recheck = true;
+				return check[0] && check[1];
+			}
 			else
 			{
 				return HandleConsistentEqualsNull(check, recheck, indexClassOptions);
@@ -1085,6 +1095,8 @@ void
 GenerateTerms(pgbson *bson, GenerateTermsContext *context, bool addRootTerm)
 {
 	bson_iter_t bsonIterator;
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_IndexTermExtraction);
 
 	/* now walk the entries and insert the terms */
 	PgbsonInitIterator(bson, &bsonIterator);
@@ -1158,6 +1170,7 @@ GenerateTerms(pgbson *bson, GenerateTermsContext *context, bool addRootTerm)
 	}
 
 	context->totalTermCount = context->index;
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
 }
 
 
@@ -1394,6 +1407,8 @@ GenerateTermPath(bson_iter_t *bsonIter, const char *basePath,
 				}
 			}
 
+			/* Serializing truncates the value in place: Keep the full value for the hash */
+			pgbsonelement fullElement = element;
 			BsonCompressableIndexTermSerialized serializedTerm =
 				SerializeBsonIndexTermWithCompression(
 					&element, &context->termMetadata);
@@ -1401,6 +1416,12 @@ GenerateTermPath(bson_iter_t *bsonIter, const char *basePath,
 			if (serializedTerm.isIndexTermTruncated)
 			{
 				context->hasTruncatedTerms = true;
+
+				if (context->termMetadata.hashTruncatedTerms)
+				{
+					AddTerm(context, GenerateTruncatedValueHashTerm(&fullElement,
+																	&context->termMetadata));
+				}
 			}
 
 			if (context->generateNotFoundTerm &&
@@ -1729,11 +1750,27 @@ GinBsonExtractQueryEqual(BsonExtractQueryArgs *args)
 	}
 	else
 	{
-		*nentries = 1;
-		entries = (Datum *) palloc(sizeof(Datum));
-		entries[0] = PointerGetDatum(SerializeBsonIndexTerm(&filterElement,
-															&args->termMetadata).
-									 indexTermVal);
+		/* Serializing truncates the value in place: Keep the full value for the hash */
+		pgbsonelement fullElement = filterElement;
+		BsonIndexTermSerialized serializedTerm = SerializeBsonIndexTerm(&filterElement,
+																		&args->
+																		termMetadata);
+		if (serializedTerm.isIndexTermTruncated &&
+			args->termMetadata.hashTruncatedTerms)
+		{
+			/* Match the hash of the full value as well (see GinBsonConsistentCore) */
+			*nentries = 2;
+			entries = (Datum *) palloc(sizeof(Datum) * 2);
+			entries[0] = PointerGetDatum(serializedTerm.indexTermVal);
+			entries[1] = GenerateTruncatedValueHashTerm(&fullElement,
+														&args->termMetadata);
+		}
+		else
+		{
+			*nentries = 1;
+			entries = (Datum *) palloc(sizeof(Datum));
+			entries[0] = PointerGetDatum(serializedTerm.indexTermVal);
+		}
 	}
 
 	return entries;
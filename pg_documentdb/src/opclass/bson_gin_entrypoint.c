@@ -60,6 +60,12 @@ static IndexTraverseOption GetHashIndexTraverseOption(void *contextOptions,
 static void ValidateWildcardProjectPathSpec(const char *prefix);
 static Size FillWildcardProjectPathSpec(const char *prefix, void *buffer);
 static bool QueryPathHasDigits(const char *path, uint32_t pathLength);
+static bool IsQualifierCollationSupportedByIndex(BsonGinIndexOptionsBase *options,
+												 const char *queryCollation,
+												 BsonIndexStrategy strategy,
+												 const bson_value_t *queryValue);
+static bool IsValueSupportedByCollatedIndex(const bson_value_t *value,
+											const char *queryCollation);
 static void FailIfQueryPathHasDigitsForWildcard(Datum query, bytea *options);
 
 
@@ -637,6 +643,16 @@ gin_bson_single_path_options(PG_FUNCTION_ARGS)
 							 false,
 							 offsetof(BsonGinSinglePathOptions, useReducedWildcardTerms));
 
+	add_local_bool_reloption(relopts, "th",
+							 "Whether truncated terms are accompanied by a hash of the full value",
+							 false,
+							 offsetof(BsonGinSinglePathOptions, hashTruncatedTerms));
+
+	add_local_string_reloption(relopts, "collation",
+							   "The ICU collation string of the sort keys of string terms",
+							   NULL, NULL, NULL,
+							   offsetof(BsonGinSinglePathOptions, collation));
+
 	add_local_int_reloption(relopts, "v",
 							"The version of the options struct.",
 							IndexOptionsVersion_V0,         /* default value */
@@ -684,6 +700,11 @@ gin_bson_wildcard_project_options(PG_FUNCTION_ARGS)
 							 "Whether the _id is included in the filter",
 							 includeIdDefault,
 							 offsetof(BsonGinWildcardProjectionPathOptions, includeId));
+	add_local_bool_reloption(relopts, "cp",
+							 "Whether index terms store the ordinal of the included path in place of the path prefix",
+							 false,
+							 offsetof(BsonGinWildcardProjectionPathOptions,
+									  useCompactPaths));
 	add_local_string_reloption(relopts, "pathspec",
 							   "The set of wildcard prefix paths in the form { 'path1' : 1, 'path2' : 1 }",
 							   NULL, &ValidateWildcardProjectPathSpec,
@@ -870,17 +891,11 @@ ValidateIndexForQualifierValue(bytea *indexOptions, Datum queryValue, BsonIndexS
 
 	queryBson = DatumGetPgBson(queryValue);
 
+	const char *collationString = NULL;
 	if (EnableCollation)
 	{
-		const char *collationString = PgbsonToSinglePgbsonElementWithCollation(queryBson,
-																			   &
-																			   filterElement);
-
-		if (IsCollationValid(collationString))
-		{
-			/* We don't yet support collated index, until then we can't use index */
-			return false;
-		}
+		collationString = PgbsonToSinglePgbsonElementWithCollation(queryBson,
+																   &filterElement);
 	}
 	else
 	{
@@ -888,6 +903,13 @@ ValidateIndexForQualifierValue(bytea *indexOptions, Datum queryValue, BsonIndexS
 	}
 
 	BsonGinIndexOptionsBase *options = (BsonGinIndexOptionsBase *) indexOptions;
+	if (!IsQualifierCollationSupportedByIndex(options,
+											  IsCollationValid(collationString) ?
+											  collationString : NULL,
+											  strategy, &filterElement.bsonValue))
+	{
+		return false;
+	}
 
 	IndexTraverseOption traverse = IndexTraverse_Invalid;
 	switch (options->type)
@@ -1013,6 +1035,113 @@ ValidateIndexForQualifierValue(bytea *indexOptions, Datum queryValue, BsonIndexS
 }
 
 
+/*
+ * Checks whether the collation of the qualifier (NULL if it has none) can be
+ * satisfied by the index. Indexes without a collation only serve qualifiers
+ * without a collation. Collated indexes store the sort key of their string
+ * terms: They serve equality and range qualifiers of the same collation on
+ * scalar values, and qualifiers without a collation only on values that aren't
+ * collation aware (e.g. numbers).
+ */
+static bool
+IsQualifierCollationSupportedByIndex(BsonGinIndexOptionsBase *options,
+									 const char *queryCollation,
+									 BsonIndexStrategy strategy,
+									 const bson_value_t *queryValue)
+{
+	const char *indexCollation = NULL;
+	if (options->type == IndexOptionsType_SinglePath)
+	{
+		BsonGinSinglePathOptions *singlePathOptions =
+			(BsonGinSinglePathOptions *) options;
+		indexCollation = GET_STRING_RELOPTION(singlePathOptions, collation);
+	}
+
+	if (indexCollation == NULL)
+	{
+		return queryCollation == NULL;
+	}
+
+	if (queryCollation != NULL && strcmp(queryCollation, indexCollation) != 0)
+	{
+		return false;
+	}
+
+	switch (strategy)
+	{
+		case BSON_INDEX_STRATEGY_DOLLAR_EXISTS:
+		{
+			return true;
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_EQUAL:
+		case BSON_INDEX_STRATEGY_DOLLAR_GREATER:
+		case BSON_INDEX_STRATEGY_DOLLAR_GREATER_EQUAL:
+		case BSON_INDEX_STRATEGY_DOLLAR_LESS:
+		case BSON_INDEX_STRATEGY_DOLLAR_LESS_EQUAL:
+		{
+			return IsValueSupportedByCollatedIndex(queryValue, queryCollation);
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_IN:
+		{
+			if (queryValue->value_type != BSON_TYPE_ARRAY)
+			{
+				return false;
+			}
+
+			bson_iter_t arrayIter;
+			BsonValueInitIterator(queryValue, &arrayIter);
+			while (bson_iter_next(&arrayIter))
+			{
+				if (!IsValueSupportedByCollatedIndex(bson_iter_value(&arrayIter),
+													 queryCollation))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+
+/*
+ * Only the top level strings of the terms of collated indexes are sort keys:
+ * Values holding nested strings can't be looked up, and strings can only be
+ * looked up when the qualifier has the collation of the index.
+ */
+static bool
+IsValueSupportedByCollatedIndex(const bson_value_t *value, const char *queryCollation)
+{
+	switch (value->value_type)
+	{
+		case BSON_TYPE_DOCUMENT:
+		case BSON_TYPE_ARRAY:
+		case BSON_TYPE_REGEX:
+		{
+			return false;
+		}
+
+		case BSON_TYPE_UTF8:
+		{
+			return queryCollation != NULL;
+		}
+
+		default:
+		{
+			return true;
+		}
+	}
+}
+
+
 /*
  * checks if a path can be pushed to an index given the options for a $in type query.
  */
@@ -1027,6 +1156,13 @@ ValidateIndexForQualifierPathForDollarIn(bytea *indexOptions, const StringView *
 
 	BsonGinIndexOptionsBase *options = (BsonGinIndexOptionsBase *) indexOptions;
 
+	/* The values of the $in are not known here: They may be strings */
+	if (options->type == IndexOptionsType_SinglePath &&
+		GET_STRING_RELOPTION((BsonGinSinglePathOptions *) options, collation) != NULL)
+	{
+		return false;
+	}
+
 	IndexTraverseOption traverse = IndexTraverse_Invalid;
 	switch (options->type)
 	{
@@ -1119,11 +1255,36 @@ GetIndexTermMetadata(void *indexOptions)
 {
 	BsonGinIndexOptionsBase *options = (BsonGinIndexOptionsBase *) indexOptions;
 
+	/* Inclusion wildcard projection indexes can replace the included path prefix
+	 * with its ordinal in the path spec */
+	const char *compactPathSpec = NULL;
+	uint32_t compactPathCount = 0;
+	if (options->type == IndexOptionsType_Wildcard)
+	{
+		BsonGinWildcardProjectionPathOptions *wildcardOptions =
+			(BsonGinWildcardProjectionPathOptions *) options;
+		if (wildcardOptions->useCompactPaths && !wildcardOptions->isExclusion)
+		{
+			Get_Index_Path_Option(wildcardOptions, pathSpec, compactPathSpec,
+								  compactPathCount);
+		}
+	}
+
+	/* Collated single path indexes store the sort keys of string terms */
+	const char *collationString = NULL;
+	if (options->type == IndexOptionsType_SinglePath)
+	{
+		BsonGinSinglePathOptions *singlePathOptions =
+			(BsonGinSinglePathOptions *) options;
+		collationString = GET_STRING_RELOPTION(singlePathOptions, collation);
+	}
+
 	if (options->version >= IndexOptionsVersion_V1 || options->indexTermTruncateLimit > 0)
 	{
 		StringView pathPrefix = { 0 };
 		bool isWildcard = false;
 		bool isWildcardProjection = false;
+		bool hashTruncatedTerms = false;
 		if (options->type == IndexOptionsType_SinglePath)
 		{
 			/* For single path indexes, we can elide the index path prefix */
@@ -1140,6 +1301,8 @@ GetIndexTermMetadata(void *indexOptions)
 			Get_Index_Path_Option(singlePathOptions, path, pathPrefix.string,
 								  pathPrefix.length);
 			isWildcard = singlePathOptions->isWildcard;
+			hashTruncatedTerms = singlePathOptions->hashTruncatedTerms &&
+								 !singlePathOptions->generateNotFoundTerm;
 		}
 		else if (options->type == IndexOptionsType_Composite)
 		{
@@ -1169,7 +1332,11 @@ GetIndexTermMetadata(void *indexOptions)
 				   .pathPrefix = pathPrefix,
 				   .isWildcard = isWildcard,
 				   .isWildcardProjection = isWildcardProjection,
-				   .indexVersion = options->version
+				   .indexVersion = options->version,
+				   .compactPathSpec = compactPathSpec,
+				   .compactPathCount = compactPathCount,
+				   .hashTruncatedTerms = hashTruncatedTerms,
+				   .collationString = collationString
 		};
 	}
 
@@ -1179,7 +1346,10 @@ GetIndexTermMetadata(void *indexOptions)
 			   .pathPrefix = { 0 },
 			   .isWildcard = false,
 			   .isWildcardProjection = false,
-			   .indexVersion = options->version
+			   .indexVersion = options->version,
+			   .compactPathSpec = compactPathSpec,
+			   .compactPathCount = compactPathCount,
+			   .collationString = collationString
 	};
 }
 
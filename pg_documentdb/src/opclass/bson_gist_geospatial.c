@@ -72,6 +72,11 @@ typedef struct IndexBsonGeospatialState
 	 */
 	List *segments;
 
+	/*
+	 * The index of the segment that last overlapped an index key
+	 */
+	int lastMatchedSegment;
+
 	/*
 	 * If radius is infinite for $center and $centerSphere in $within,
 	 * we simply return all documents without running any comparisons
@@ -116,6 +121,8 @@ static void PopulateGeospatialQueryState(IndexBsonGeospatialState *state,
 										 const pgbson *queryDoc,
 										 StrategyNumber strategy);
 static void SegmentizeQuery(IndexBsonGeospatialState *state);
+static bool AnySegmentOverlapsIndexKey(IndexBsonGeospatialState *state,
+									   Oid overlapsFunctionId, Datum indexKey);
 static float8 GeonearGISTDistanceWithState(PG_FUNCTION_ARGS, const
 										   GeonearDistanceState *state);
 static bool GeonearRangeConsistent(PG_FUNCTION_ARGS);
@@ -384,20 +391,9 @@ bson_gist_geometry_consistent_2d(PG_FUNCTION_ARGS)
 
 	BSON_BOUNDING_BOXF *documentBox2df = (BSON_BOUNDING_BOXF *) DatumGetPointer(
 		entry->key);
-	bool segmentedResult = false;
-	ListCell *cell;
-	foreach(cell, state->segments)
-	{
-		Datum segment = PointerGetDatum(lfirst(cell));
-		segmentedResult = OidFunctionCall2(PostgisBox2dfGeometryOverlapsFunctionId(),
-										   PointerGetDatum(documentBox2df), segment);
-		if (segmentedResult)
-		{
-			PG_RETURN_BOOL(true);
-		}
-	}
-
-	PG_RETURN_BOOL(false);
+	PG_RETURN_BOOL(AnySegmentOverlapsIndexKey(state,
+											  PostgisBox2dfGeometryOverlapsFunctionId(),
+											  PointerGetDatum(documentBox2df)));
 }
 
 
@@ -706,20 +702,35 @@ bson_gist_geography_consistent(PG_FUNCTION_ARGS)
 	 */
 
 	void *documentGIDX = (void *) PG_DETOAST_DATUM(entry->key);
-	bool segmentedResult = false;
-	ListCell *cell;
-	foreach(cell, state->segments)
-	{
-		Datum segment = PointerGetDatum(lfirst(cell));
-		segmentedResult = OidFunctionCall2(PostgisGIDXGeographyOverlapsFunctionId(),
-										   PointerGetDatum(documentGIDX), segment);
-		if (segmentedResult)
+	PG_RETURN_BOOL(AnySegmentOverlapsIndexKey(state,
+											  PostgisGIDXGeographyOverlapsFunctionId(),
+											  PointerGetDatum(documentGIDX)));
+}
+
+
+/*
+ * Checks whether the bounding box of an index key overlaps any of the segments of
+ * the query. Keys are visited in index order so neighbouring keys tend to fall in
+ * the same segment: The segment that matched last is checked first.
+ */
+static bool
+AnySegmentOverlapsIndexKey(IndexBsonGeospatialState *state, Oid overlapsFunctionId,
+						   Datum indexKey)
+{
+	int numSegments = list_length(state->segments);
+	for (int i = 0; i < numSegments; i++)
+	{
+		/* Start from the segment that matched last and wrap around */
+		int segmentIndex = (state->lastMatchedSegment + i) % numSegments;
+		Datum segment = PointerGetDatum(list_nth(state->segments, segmentIndex));
+		if (DatumGetBool(OidFunctionCall2(overlapsFunctionId, indexKey, segment)))
 		{
-			PG_RETURN_BOOL(true);
+			state->lastMatchedSegment = segmentIndex;
+			return true;
 		}
 	}
 
-	PG_RETURN_BOOL(false);
+	return false;
 }
 
 
@@ -982,11 +993,11 @@ GeonearGISTDistanceWithState(PG_FUNCTION_ARGS, const GeonearDistanceState *state
 static bool
 GeonearRangeConsistent(PG_FUNCTION_ARGS)
 {
+	GISTENTRY *gistEntry = (GISTENTRY *) PG_GETARG_POINTER(0);
 	pgbson *query = PG_GETARG_PGBSON(1);
 
 	const GeonearDistanceState *state;
 	int argPosition = 1;
-	float8 gistBoxDistance = 0.0;
 
 	SetCachedFunctionState(
 		state,
@@ -995,25 +1006,32 @@ GeonearRangeConsistent(PG_FUNCTION_ARGS)
 		BuildGeoNearRangeDistanceState,
 		query);
 
+	GeonearDistanceState distanceState;
 	if (state == NULL)
 	{
-		GeonearDistanceState distanceState;
 		memset(&distanceState, 0, sizeof(GeonearDistanceState));
 		BuildGeoNearRangeDistanceState(&distanceState, query);
-		gistBoxDistance = GeonearGISTDistanceWithState(fcinfo, &distanceState);
-	}
-	else
-	{
-		gistBoxDistance = GeonearGISTDistanceWithState(fcinfo, state);
+		state = &distanceState;
 	}
 
+	float8 gistBoxDistance = GeonearGISTDistanceWithState(fcinfo, state);
+
+	/*
+	 * The box distance is the smallest distance of anything under the entry, so
+	 * $maxDistance prunes whole subtrees of the distance ordered scan.
+	 */
 	if (state->maxDistance != NULL && gistBoxDistance > *(state->maxDistance) &&
 		!DOUBLE_EQUALS(gistBoxDistance, *(state->maxDistance)))
 	{
 		return false;
 	}
 
-	if (state->minDistance != NULL && gistBoxDistance < *(state->minDistance) &&
+	/*
+	 * Being closer than $minDistance says nothing about the rest of an inner
+	 * entry, so only leaves can be discarded for it.
+	 */
+	if (GIST_LEAF(gistEntry) && state->minDistance != NULL &&
+		gistBoxDistance < *(state->minDistance) &&
 		!DOUBLE_EQUALS(gistBoxDistance, *(state->minDistance)))
 	{
 		return false;
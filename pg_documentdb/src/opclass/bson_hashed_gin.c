@@ -74,6 +74,8 @@ PG_FUNCTION_INFO_V1(gin_bson_hashed_extract_value);
 PG_FUNCTION_INFO_V1(gin_bson_hashed_options);
 PG_FUNCTION_INFO_V1(gin_bson_hashed_extract_query);
 PG_FUNCTION_INFO_V1(gin_bson_hashed_consistent);
+PG_FUNCTION_INFO_V1(bson_hash_path_value);
+PG_FUNCTION_INFO_V1(bson_hash_path_query);
 
 /*
  * gin_bson_hashed_extract_query is run on the query path when a
@@ -286,6 +288,72 @@ gin_bson_hashed_consistent(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * bson_hash_path_value is the hash support function of the native hash index
+ * for hashed indexes (bson_hash_path_ops). It hashes the value at the indexed
+ * path of the document the same way as gin_bson_hashed_extract_value, but paths
+ * that don't exist (or are undefined) hash as null so that an $eq: null query
+ * finds them in the same bucket. Queries are hashed via bson_hash_path_query
+ * and matches are always rechecked by the hash index.
+ */
+Datum
+bson_hash_path_value(PG_FUNCTION_ARGS)
+{
+	pgbson *bson = PG_GETARG_PGBSON_PACKED(0);
+
+	if (!PG_HAS_OPCLASS_OPTIONS())
+	{
+		ereport(ERROR, (errmsg("Index does not have options")));
+	}
+
+	BsonGinHashOptions *options =
+		(BsonGinHashOptions *) PG_GET_OPCLASS_OPTIONS();
+
+	const char *indexPath;
+	uint32_t indexPathLength;
+	Get_Index_Path_Option(options, path, indexPath, indexPathLength);
+
+	bson_value_t hashValue = { 0 };
+	hashValue.value_type = BSON_TYPE_NULL;
+	if (indexPathLength > 0)
+	{
+		bson_iter_t bsonIterator;
+		PgbsonInitIterator(bson, &bsonIterator);
+
+		HashIndexTraverseState traverseState = { 0 };
+		traverseState.indexPath = indexPath;
+		TraverseBson(&bsonIterator, indexPath, &traverseState,
+					 &HashIndexExecutionFuncs);
+
+		if (traverseState.foundValue &&
+			traverseState.bsonValue.value_type != BSON_TYPE_UNDEFINED)
+		{
+			hashValue = traverseState.bsonValue;
+		}
+	}
+
+	/* The hash is persisted in the index: use the same hash as the index terms */
+	uint32 hash = (uint32) BsonValueHash(&hashValue, 0);
+	PG_FREE_IF_COPY(bson, 0);
+	PG_RETURN_UINT32(hash);
+}
+
+
+/*
+ * bson_hash_path_query hashes the value of a { "path": value } $eq query
+ * (as a bsonquery) for lookups in the native hash index for hashed indexes.
+ */
+Datum
+bson_hash_path_query(PG_FUNCTION_ARGS)
+{
+	pgbson *queryBson = PG_GETARG_PGBSON(0);
+	pgbsonelement queryElement;
+	PgbsonToSinglePgbsonElement(queryBson, &queryElement);
+
+	PG_RETURN_UINT32((uint32) BsonValueHash(&queryElement.bsonValue, 0));
+}
+
+
 /*
  * Generates the index hash terms for a given query predicate for a $eq.
  * This computes the hash, or also generates the "root" term if the $eq
@@ -21,6 +21,7 @@
 #include <tsearch/ts_cache.h>
 #include <catalog/namespace.h>
 #include <utils/array.h>
+#include <utils/memutils.h>
 #include <nodes/makefuncs.h>
 
 #include "io/bson_core.h"
@@ -57,6 +58,7 @@ typedef struct TextQueryEvalData
 } TextQueryEvalData;
 
 static QTNode * RewriteQueryTree(QTNode *node, bool *rewrote);
+static ArrayType * GetTextScoreWeightsArray(Datum *weightDatum);
 
 static IndexTraverseOption GetTextIndexTraverseOption(void *contextOptions,
 													  const char *currentPath, uint32_t
@@ -289,7 +291,12 @@ bson_dollar_text_meta_qual(PG_FUNCTION_ARGS)
 
 	BsonGinTextPathOptions *textOptions = (BsonGinTextPathOptions *) indexOptions;
 
-	/* If a runtime check is required, do it */
+	/*
+	 * If a runtime check is required, do it. When the query is served by the
+	 * text index this clause is only evaluated on recheck: The index stores the
+	 * lexeme positions as additional info, so phrase and proximity operators are
+	 * resolved by rum_tsquery_consistent without going back to the document.
+	 */
 	if (evaluateRuntimeCheck)
 	{
 		TSVector vector = GenerateTsVectorWithOptions(document, textOptions);
@@ -424,8 +431,7 @@ EvaluateMetaTextScore(pgbson *document)
 
 	/* The datum array is right after the path count */
 	Datum *weightDatum = (Datum *) pathSpecBytes;
-	ArrayType *rankArray = construct_array(weightDatum, 4, FLOAT4OID, sizeof(float), true,
-										   TYPALIGN_INT);
+	ArrayType *rankArray = GetTextScoreWeightsArray(weightDatum);
 
 	Datum result = OidFunctionCall3(TsRankFunctionId(),
 									PointerGetDatum(rankArray),
@@ -436,6 +442,39 @@ EvaluateMetaTextScore(pgbson *document)
 }
 
 
+/*
+ * The text score is evaluated for every matching document with the weights of the
+ * same index: Build the weights array once and keep it around for as long as the
+ * weights match rather than constructing it again on every row.
+ */
+static ArrayType *
+GetTextScoreWeightsArray(Datum *weightDatum)
+{
+	static ArrayType *CachedWeightsArray = NULL;
+	static Datum CachedWeights[4];
+
+	if (CachedWeightsArray != NULL &&
+		memcmp(CachedWeights, weightDatum, sizeof(CachedWeights)) == 0)
+	{
+		return CachedWeightsArray;
+	}
+
+	MemoryContext oldContext = MemoryContextSwitchTo(TopMemoryContext);
+	ArrayType *weightsArray = construct_array(weightDatum, 4, FLOAT4OID, sizeof(float),
+											  true, TYPALIGN_INT);
+	MemoryContextSwitchTo(oldContext);
+
+	if (CachedWeightsArray != NULL)
+	{
+		pfree(CachedWeightsArray);
+	}
+
+	memcpy(CachedWeights, weightDatum, sizeof(CachedWeights));
+	CachedWeightsArray = weightsArray;
+	return CachedWeightsArray;
+}
+
+
 /*
  * Validates that the order by is for a text search
  * i.e. the document { "$meta": "textScore" }
@@ -15,10 +15,12 @@
 #include <access/toast_compression.h>
 #include <access/toast_internals.h>
 #include "opclass/bson_gin_index_term.h"
+#include "collation/collation.h"
 #include "query/bson_compare.h"
 #include "utils/documentdb_errors.h"
 #include "types/decimal128.h"
 #include "io/bsonvalue_utils.h"
+#include "io/bson_hash.h"
 
 
 /*
@@ -62,6 +64,10 @@ extern int IndexTermCompressionThreshold;
 /* --------------------------------------------------------- */
 /* Forward Declaration */
 /* --------------------------------------------------------- */
+static const pgbsonelement * GetCollatedIndexElement(const pgbsonelement *indexElement,
+													  const IndexTermCreateMetadata *
+													  createMetadata,
+													  pgbsonelement *collatedElement);
 static bool SerializeTermToWriter(pgbson_writer *writer, pgbsonelement *indexElement,
 								  const IndexTermCreateMetadata *termMetadata);
 
@@ -82,6 +88,8 @@ static bytea * BuildSerializedIndexTerm(pgbsonelement *indexElement, const
 										IndexTermMetadata termMetadata,
 										BsonIndexTerm *indexTerm);
 static int32_t CompareCompositeIndexTerms(bytea *left, bytea *right);
+static char * GetCompactWildcardProjectionPath(StringView *indexPath, const
+											   IndexTermCreateMetadata *termMetadata);
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -900,6 +908,11 @@ SerializeTermToWriter(pgbson_writer *writer, pgbsonelement *indexElement,
 
 	char *newPath = NULL;
 
+	if (termMetadata->compactPathCount > 0 && indexPath.length > 0)
+	{
+		newPath = GetCompactWildcardProjectionPath(&indexPath, termMetadata);
+	}
+
 	if (termMetadata->pathPrefix.length > 0 && indexPath.length > 0 &&
 		!termMetadata->isWildcard)
 	{
@@ -1153,6 +1166,52 @@ SerializeTermToWriter(pgbson_writer *writer, pgbsonelement *indexElement,
 }
 
 
+/*
+ * For inclusion wildcard projection indexes every term path is under one of the
+ * included paths, so the included path is replaced with "$<ordinal>" (e.g. with
+ * pathspec [ "a.b", "c" ] the path a.b.d.e becomes $0.d.e and c becomes $1).
+ * The remainder always starts with a '.', so the encoding stays unique per path
+ * and term comparisons, which only rely on path equality, are unchanged.
+ * Paths outside the included paths (e.g. _id) are left as is since they can't
+ * start with a '$'. Returns the allocated path if the path was rewritten.
+ */
+static char *
+GetCompactWildcardProjectionPath(StringView *indexPath, const
+								 IndexTermCreateMetadata *termMetadata)
+{
+	const char *pathSpecBytes = termMetadata->compactPathSpec;
+	for (uint32_t i = 0; i < termMetadata->compactPathCount; i++)
+	{
+		uint32_t includedPathLength = *(uint32_t *) pathSpecBytes;
+		const char *includedPath = pathSpecBytes + sizeof(uint32_t);
+		pathSpecBytes += includedPathLength + sizeof(uint32_t);
+
+		if (includedPathLength > indexPath->length ||
+			strncmp(includedPath, indexPath->string, includedPathLength) != 0 ||
+			(includedPathLength < indexPath->length &&
+			 indexPath->string[includedPathLength] != '.'))
+		{
+			continue;
+		}
+
+		uint32_t suffixLength = indexPath->length - includedPathLength;
+
+		/* '$' + up to 10 digits of the ordinal + suffix + \0 */
+		char *newPath = palloc(suffixLength + 12);
+		int prefixLength = snprintf(newPath, 12, "$%u", i);
+		memcpy(&newPath[prefixLength], indexPath->string + includedPathLength,
+			   suffixLength);
+		newPath[prefixLength + suffixLength] = '\0';
+
+		indexPath->string = newPath;
+		indexPath->length = prefixLength + suffixLength;
+		return newPath;
+	}
+
+	return NULL;
+}
+
+
 /*
  * Internal Core method that serializes the term and returns the
  * serialized term. ALlows for the term to be force marked truncated
@@ -1302,6 +1361,34 @@ SerializeCompositeBsonIndexTermWithCompression(bytea **individualTerms,
 }
 
 
+/*
+ * For indexes that hash their truncated terms, this is the term generated next to
+ * a truncated term with the hash of the full value. Equality on a truncated value
+ * also matches this term so documents whose values only share the truncated prefix
+ * are discarded by the index instead of the runtime recheck.
+ * It is a metadata term on the path of the value: Metadata terms sort before all
+ * value terms, so scans over the values of the path never see it.
+ */
+Datum
+GenerateTruncatedValueHashTerm(const pgbsonelement *indexElement,
+							   const IndexTermCreateMetadata *termData)
+{
+	pgbsonelement element = { 0 };
+	element.path = indexElement->path;
+	element.pathLength = indexElement->pathLength;
+	element.bsonValue.value_type = BSON_TYPE_INT64;
+	pgbsonelement collatedElement;
+	const pgbsonelement *hashedElement = GetCollatedIndexElement(indexElement, termData,
+																 &collatedElement);
+	element.bsonValue.value.v_int64 = (int64) HashBsonValueComparableExtended(
+		&hashedElement->bsonValue, 0);
+
+	IndexTermMetadata termMetadata = IndexTermIsMetadata;
+	return PointerGetDatum(SerializeBsonIndexTermCore(&element, termData,
+													  termMetadata).indexTermVal);
+}
+
+
 /*
  * This is the root term that all documents get when the indexed path exists.
  * We pick a term that points to a path that is illegal ('')
@@ -1446,6 +1533,11 @@ BuildSerializedIndexTerm(pgbsonelement *indexElement, const
 						 IndexTermMetadata termMetadata,
 						 BsonIndexTerm *indexTerm)
 {
+	pgbsonelement collatedElement;
+	indexElement = (pgbsonelement *) GetCollatedIndexElement(indexElement,
+															 createMetadata,
+															 &collatedElement);
+
 	pgbson_writer writer;
 	PgbsonWriterInit(&writer);
 	bool isTermTruncated = SerializeTermToWriter(&writer, indexElement,
@@ -1522,3 +1614,29 @@ BuildSerializedIndexTerm(pgbsonelement *indexElement, const
 	PgbsonWriterCopyToBuffer(&writer, &buffer[1], dataSize);
 	return indexTermVal;
 }
+
+
+/*
+ * For collated indexes, returns the element with its string value replaced by
+ * the collation sort key of the string (in collatedElement), which compares
+ * binary in the order of the collation. Returns the element as is otherwise.
+ */
+static const pgbsonelement *
+GetCollatedIndexElement(const pgbsonelement *indexElement,
+						const IndexTermCreateMetadata *createMetadata,
+						pgbsonelement *collatedElement)
+{
+	if (createMetadata->collationString == NULL ||
+		indexElement->bsonValue.value_type != BSON_TYPE_UTF8)
+	{
+		return indexElement;
+	}
+
+	*collatedElement = *indexElement;
+	char *sortKey = GetCollationSortKey(createMetadata->collationString,
+										indexElement->bsonValue.value.v_utf8.str,
+										indexElement->bsonValue.value.v_utf8.len);
+	collatedElement->bsonValue.value.v_utf8.str = sortKey;
+	collatedElement->bsonValue.value.v_utf8.len = strlen(sortKey);
+	return collatedElement;
+}
@@ -47,6 +47,7 @@
 #include "query/bson_dollar_selectivity.h"
 #include "planner/documentdb_planner.h"
 #include "aggregation/bson_query_common.h"
+#include "collation/collation.h"
 
 typedef struct
 {
@@ -175,6 +176,8 @@ static Path * OptimizeBitmapQualsForBitmapAnd(BitmapAndPath *path,
 static IndexPath * OptimizeIndexPathForFilters(IndexPath *indexPath,
 											   ReplaceExtensionFunctionContext *context);
 static Expr * OpExprForAggregationStageSupportFunction(Node *supportRequest);
+static bool TryEstimateDollarOperatorCost(SupportRequestCost *req);
+static int CountNestedQueryClauses(const bson_value_t *value);
 static Path * FindIndexPathForQueryOperator(RelOptInfo *rel, List *pathList,
 											ReplaceExtensionFunctionContext *context,
 											MatchIndexPath matchIndexPath,
@@ -184,6 +187,8 @@ static bool IsMatchingPathForQueryOperator(RelOptInfo *rel, Path *path,
 										   MatchIndexPath matchIndexPath,
 										   void *matchContext);
 static Expr * ProcessFullScanForOrderBy(SupportRequestIndexCondition *req, List *args);
+static Expr * ProcessNativeHashIndexCondition(const MongoIndexOperatorInfo *operator,
+											  List *args, bytea *options);
 static OpExpr * CreateFullScanOpExpr(Expr *documentExpr, const char *sourcePath, uint32_t
 									 sourcePathLength, int32_t orderByScanDirection);
 static OpExpr * CreateExistsTrueOpExpr(Expr *documentExpr, const char *sourcePath,
@@ -238,6 +243,7 @@ static bool TryUseAlternateIndexForPrimaryKeyLookup(PlannerInfo *root, RelOptInf
 													context,
 													MatchIndexPath matchIndexPath);
 static void PrimaryKeyLookupUnableToFindIndex(void);
+static bool ExtractRangeArgumentElement(pgbson *argument, pgbsonelement *argElement);
 
 
 static const ForceIndexSupportFuncs ForceIndexOperatorSupport[] =
@@ -301,6 +307,9 @@ extern bool UseLegacyForcePushdownBehavior;
 extern bool LowSelectivityForLookup;
 extern bool EnableIndexOrderbyPushdown;
 extern bool EnableIndexOrderbyPushdownLegacy;
+extern bool EnableIndexOnlyScanForDistinct;
+extern bool EnableIndexOnlyScanForProjection;
+extern bool EnableDollarOperatorCostModel;
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -372,6 +381,14 @@ dollar_support(PG_FUNCTION_ARGS)
 			}
 		}
 	}
+	else if (IsA(supportRequest, SupportRequestCost) && EnableDollarOperatorCostModel)
+	{
+		SupportRequestCost *req = (SupportRequestCost *) supportRequest;
+		if (TryEstimateDollarOperatorCost(req))
+		{
+			responsePointer = (Pointer) req;
+		}
+	}
 
 	PG_RETURN_POINTER(responsePointer);
 }
@@ -1291,6 +1308,236 @@ ProjectionReferencesDocumentVar(Expr *node, void *state)
 }
 
 
+/*
+ * Collects the paths of a DISTINCT query's projection where every reference to
+ * the document is a bson_distinct_unwind(document, '<path>') with a constant top
+ * level path. Returns false if the projection uses the document in any other way.
+ */
+static bool
+TryGetDistinctUnwindProjectionPaths(List *targetList, List **distinctPaths)
+{
+	ListCell *cell;
+	foreach(cell, targetList)
+	{
+		TargetEntry *entry = lfirst_node(TargetEntry, cell);
+		bool projectionHasVarOrQuery = false;
+		ProjectionReferencesDocumentVar(entry->expr, &projectionHasVarOrQuery);
+		if (!projectionHasVarOrQuery)
+		{
+			continue;
+		}
+
+		if (!IsA(entry->expr, FuncExpr))
+		{
+			return false;
+		}
+
+		FuncExpr *funcExpr = (FuncExpr *) entry->expr;
+		if (funcExpr->funcid != BsonDistinctUnwindFunctionOid() ||
+			list_length(funcExpr->args) != 2 ||
+			!IsA(linitial(funcExpr->args), Var) ||
+			!IsA(lsecond(funcExpr->args), Const))
+		{
+			return false;
+		}
+
+		Const *pathConst = (Const *) lsecond(funcExpr->args);
+		if (pathConst->constisnull)
+		{
+			return false;
+		}
+
+		/* The index tuple projects the dotted path as a literal field name */
+		char *path = TextDatumGetCString(pathConst->constvalue);
+		if (strchr(path, '.') != NULL)
+		{
+			return false;
+		}
+
+		*distinctPaths = lappend(*distinctPaths, path);
+	}
+
+	return true;
+}
+
+
+/*
+ * Whether the projection spec includes a single top level path (excluding _id
+ * unless that is the path), adding the path to projectionPaths. The document
+ * built from the index term has its fields in the order of the index paths rather
+ * than of the stored document, so only a single field output is the same as the
+ * projection of the stored document.
+ */
+static bool
+TryGetInclusionProjectionPaths(const pgbson *projectionSpec, List **projectionPaths)
+{
+	bool hasIdPath = false;
+	int numIncludedPaths = 0;
+	bson_iter_t projectionIter;
+	PgbsonInitIterator(projectionSpec, &projectionIter);
+	while (bson_iter_next(&projectionIter))
+	{
+		const char *path = bson_iter_key(&projectionIter);
+		const bson_value_t *value = bson_iter_value(&projectionIter);
+		bool isIncluded;
+		if (value->value_type == BSON_TYPE_BOOL)
+		{
+			isIncluded = value->value.v_bool;
+		}
+		else if (BsonValueIsNumber(value))
+		{
+			isIncluded = !IsBsonValueNaN(value) && BsonValueAsDouble(value) != 0;
+		}
+		else
+		{
+			/* Expressions, $slice, $elemMatch and such need the document */
+			return false;
+		}
+
+		bool isIdPath = strcmp(path, "_id") == 0;
+		if (!isIncluded)
+		{
+			/* Only _id can be excluded in an inclusion projection */
+			if (!isIdPath)
+			{
+				return false;
+			}
+
+			hasIdPath = true;
+			continue;
+		}
+
+		/* The index tuple projects the dotted path as a literal field name */
+		if (path[0] == '$' || strchr(path, '.') != NULL)
+		{
+			return false;
+		}
+
+		hasIdPath = hasIdPath || isIdPath;
+		numIncludedPaths++;
+		*projectionPaths = lappend(*projectionPaths, pstrdup(path));
+	}
+
+	/* _id is projected unless excluded, so it has to come from the index too */
+	if (!hasIdPath)
+	{
+		numIncludedPaths++;
+		*projectionPaths = lappend(*projectionPaths, "_id");
+	}
+
+	return numIncludedPaths == 1;
+}
+
+
+/*
+ * Collects the paths that a projection of a find or aggregate reads from the
+ * document: Every reference to the document has to be a $project/find projection
+ * that includes top level paths, or the bson_orderby of a sort on a top level path.
+ * Returns false if the projection uses the document in any other way.
+ */
+static bool
+TryGetCoveredProjectionPaths(List *targetList, List **projectionPaths)
+{
+	ListCell *cell;
+	foreach(cell, targetList)
+	{
+		TargetEntry *entry = lfirst_node(TargetEntry, cell);
+		bool projectionHasVarOrQuery = false;
+		ProjectionReferencesDocumentVar(entry->expr, &projectionHasVarOrQuery);
+		if (!projectionHasVarOrQuery)
+		{
+			continue;
+		}
+
+		if (!IsA(entry->expr, FuncExpr))
+		{
+			return false;
+		}
+
+		FuncExpr *funcExpr = (FuncExpr *) entry->expr;
+		if (list_length(funcExpr->args) < 2 ||
+			!IsA(linitial(funcExpr->args), Var))
+		{
+			return false;
+		}
+
+		/* The remaining arguments must not read the document */
+		ListCell *argCell;
+		for_each_from(argCell, funcExpr->args, 1)
+		{
+			if (!IsA(lfirst(argCell), Const))
+			{
+				return false;
+			}
+		}
+
+		Const *specConst = (Const *) lsecond(funcExpr->args);
+		if (specConst->constisnull)
+		{
+			return false;
+		}
+
+		pgbson *spec = DatumGetPgBson(specConst->constvalue);
+		if (funcExpr->funcid == BsonDollarProjectFunctionOid() ||
+			funcExpr->funcid == BsonDollarProjectFindFunctionOid())
+		{
+			if (!TryGetInclusionProjectionPaths(spec, projectionPaths))
+			{
+				return false;
+			}
+		}
+		else if (funcExpr->funcid == BsonOrderByFunctionOid() &&
+				 list_length(funcExpr->args) == 2)
+		{
+			pgbsonelement sortElement;
+			if (!TryGetSinglePgbsonElementFromPgbson(spec, &sortElement) ||
+				!BsonValueIsNumber(&sortElement.bsonValue) ||
+				sortElement.path[0] == '$' || strchr(sortElement.path, '.') != NULL)
+			{
+				return false;
+			}
+
+			*projectionPaths = lappend(*projectionPaths, pstrdup(sortElement.path));
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * Whether every path in distinctPaths is a path of the composite index, so that
+ * the document projected from the index term has the same value for it.
+ */
+static bool
+IndexCoversDistinctPaths(IndexPath *indexPath, List *distinctPaths)
+{
+	bytea *indexOptions = indexPath->indexinfo->opclassoptions != NULL ?
+						  indexPath->indexinfo->opclassoptions[0] : NULL;
+	if (indexOptions == NULL)
+	{
+		return false;
+	}
+
+	ListCell *cell;
+	foreach(cell, distinctPaths)
+	{
+		int8_t sortDirection = 0;
+		if (GetCompositeOpClassColumnNumber((const char *) lfirst(cell), indexOptions,
+											&sortDirection) < 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 static inline bool
 IndexStrategySupportsIndexOnlyScan(BsonIndexStrategy indexStrategy)
 {
@@ -1434,8 +1681,9 @@ IndexClausesValidForIndexOnlyScan(IndexPath *indexPath,
  * This is possible if:
  * 1) The query is against a base table
  * 2) There are no joins
- * 3) Projection is covered (Today this requires projection to be a constant but
- *    this can be extended in the future)
+ * 3) Projection is covered (Today this requires projection to be a constant,
+ *    for DISTINCT queries, the distinct unwind of a top level path of the index,
+ *    or an inclusion projection and sort of top level paths of the index)
  * 4) Filters are covered by the index.
  * 5) The index filters are are not lossy operators.
  * 6) The index is a composite index.
@@ -1444,7 +1692,17 @@ void
 ConsiderIndexOnlyScan(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 					  Index rti, ReplaceExtensionFunctionContext *context)
 {
-	if (list_length(root->agginfos) == 0 ||
+	bool isDistinctQuery = EnableIndexOnlyScanForDistinct &&
+						   root->parse->distinctClause != NIL &&
+						   !root->parse->hasAggs;
+	bool isProjectionQuery = EnableIndexOnlyScanForProjection &&
+							 !isDistinctQuery && !root->parse->hasAggs &&
+							 root->parse->distinctClause == NIL &&
+							 !root->parse->hasWindowFuncs &&
+							 !root->parse->hasTargetSRFs &&
+							 root->parse->groupClause == NIL &&
+							 list_length(root->agginfos) == 0;
+	if ((list_length(root->agginfos) == 0 && !isDistinctQuery && !isProjectionQuery) ||
 		rte->rtekind != RTE_RELATION ||
 		root->hasJoinRTEs)
 	{
@@ -1457,9 +1715,33 @@ ConsiderIndexOnlyScan(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 	}
 
 	bool projectionHasVarOrQuery = false;
-	expression_tree_walker((Node *) root->parse->targetList,
-						   ProjectionReferencesDocumentVar,
-						   &projectionHasVarOrQuery);
+	List *distinctPaths = NIL;
+	if (isDistinctQuery)
+	{
+		/* The index tuple projects the index paths as the document, which covers
+		 * a distinct on those paths.
+		 */
+		projectionHasVarOrQuery =
+			!TryGetDistinctUnwindProjectionPaths(root->parse->targetList,
+												 &distinctPaths);
+	}
+	else if (isProjectionQuery)
+	{
+		/* The index tuple has the index paths of the document, which covers a
+		 * projection (and sort) of those paths. Queries that project the whole
+		 * document have nothing to cover.
+		 */
+		projectionHasVarOrQuery =
+			!TryGetCoveredProjectionPaths(root->parse->targetList, &distinctPaths) ||
+			distinctPaths == NIL;
+	}
+	else
+	{
+		expression_tree_walker((Node *) root->parse->targetList,
+							   ProjectionReferencesDocumentVar,
+							   &projectionHasVarOrQuery);
+	}
+
 	if (projectionHasVarOrQuery)
 	{
 		/* If the projection has a Var or a Query, we can't do index only scan
@@ -1503,6 +1785,13 @@ ConsiderIndexOnlyScan(PlannerInfo *root, RelOptInfo *rel, RangeTblEntry *rte,
 			continue;
 		}
 
+		/* The distinct or projected paths must all be in the index */
+		if (distinctPaths != NIL &&
+			!IndexCoversDistinctPaths(indexPath, distinctPaths))
+		{
+			continue;
+		}
+
 		if (!CompositeIndexSupportsIndexOnlyScan(indexPath))
 		{
 			continue;
@@ -2400,6 +2689,16 @@ HandleSupportRequestCondition(SupportRequestIndexCondition *req)
 
 	Oid operatorFamily = req->index->opfamily[req->indexcol];
 
+	if (req->index->relam == HASH_AM_OID)
+	{
+		if (operatorFamily != BsonHashPathOperatorFamily())
+		{
+			return NULL;
+		}
+
+		return ProcessNativeHashIndexCondition(operator, args, options);
+	}
+
 	Datum queryValue = ((Const *) operand)->constvalue;
 
 	/* Lookup the func in the set of operators */
@@ -2451,6 +2750,36 @@ HandleSupportRequestCondition(SupportRequestIndexCondition *req)
 }
 
 
+/*
+ * Native hash indexes on a hashed path only answer $eq: The query is rewritten
+ * to the runtime operator document #= query::bsonquery whose right hand side is
+ * hashed by the bsonquery support function of the operator family. The hash
+ * index rechecks every match so the clause is not lossy.
+ */
+static Expr *
+ProcessNativeHashIndexCondition(const MongoIndexOperatorInfo *operator, List *args,
+								bytea *options)
+{
+	if (operator->indexStrategy != BSON_INDEX_STRATEGY_DOLLAR_EQUAL)
+	{
+		return NULL;
+	}
+
+	Const *queryConst = (Const *) lsecond(args);
+	if (!ValidateIndexForQualifierValue(options, queryConst->constvalue,
+										operator->indexStrategy))
+	{
+		return NULL;
+	}
+
+	Const *bsonQueryConst = copyObject(queryConst);
+	bsonQueryConst->consttype = GetClusterBsonQueryTypeId();
+	return make_opclause(BsonEqualMatchRuntimeOperatorId(), BOOLOID, false,
+						 (Expr *) linitial(args), (Expr *) bsonQueryConst,
+						 InvalidOid, InvalidOid);
+}
+
+
 /*
  * Extract search parameters from indexPath->indexinfo->indrestrictinfo, which contains a list of restriction clauses represents clause of WHERE or JOIN
  * set to context->queryDataForVectorSearch
@@ -2486,6 +2815,25 @@ ExtractAndSetSearchParamterFromWrapFunction(IndexPath *indexPath,
 }
 
 
+/*
+ * Extracts the query argument of a comparison into argElement and returns
+ * whether the comparison has a collation.
+ */
+static bool
+ExtractRangeArgumentElement(pgbson *argument, pgbsonelement *argElement)
+{
+	if (EnableCollation)
+	{
+		const char *collationString =
+			PgbsonToSinglePgbsonElementWithCollation(argument, argElement);
+		return IsCollationValid(collationString);
+	}
+
+	PgbsonToSinglePgbsonElement(argument, argElement);
+	return false;
+}
+
+
 static List *
 OptimizeIndexExpressionsForRange(List *indexClauses)
 {
@@ -2523,7 +2871,12 @@ OptimizeIndexExpressionsForRange(List *indexClauses)
 				Const *argsConst = lsecond(opExpr->args);
 				pgbson *secondArg = DatumGetPgBson(argsConst->constvalue);
 				pgbsonelement argElement;
-				PgbsonToSinglePgbsonElement(secondArg, &argElement);
+				if (ExtractRangeArgumentElement(secondArg, &argElement))
+				{
+					/* Collated bounds can't be compared raw to be merged */
+					element->isInvalidCandidateForRange = true;
+					break;
+				}
 
 				if (argElement.bsonValue.value_type == BSON_TYPE_NULL &&
 					operator->indexStrategy == BSON_INDEX_STRATEGY_DOLLAR_GREATER_EQUAL)
@@ -2577,7 +2930,12 @@ OptimizeIndexExpressionsForRange(List *indexClauses)
 				Const *argsConst = lsecond(opExpr->args);
 				pgbson *secondArg = DatumGetPgBson(argsConst->constvalue);
 				pgbsonelement argElement;
-				PgbsonToSinglePgbsonElement(secondArg, &argElement);
+				if (ExtractRangeArgumentElement(secondArg, &argElement))
+				{
+					/* Collated bounds can't be compared raw to be merged */
+					element->isInvalidCandidateForRange = true;
+					break;
+				}
 
 				if (argElement.bsonValue.value_type == BSON_TYPE_NULL &&
 					operator->indexStrategy == BSON_INDEX_STRATEGY_DOLLAR_LESS_EQUAL)
@@ -3677,6 +4035,11 @@ TryUseAlternateIndexForIndexHint(PlannerInfo *root, RelOptInfo *rel,
 				opClassOptions, &isWildCardIndex);
 		}
 	}
+	else if (matchedInfo->relam == HASH_AM_OID)
+	{
+		/* Native hash indexes on a hashed path can't do full scans either */
+		isHashedIndex = true;
+	}
 
 	if (firstIndexPath == NULL || isWildCardIndex)
 	{
@@ -4155,3 +4518,209 @@ ProcessFullScanForOrderBy(SupportRequestIndexCondition *req, List *args)
 	return (Expr *) CreateFullScanOpExpr(
 		linitial(args), sourceElement.path, sourceElement.pathLength, querySortDirection);
 }
+
+
+/*
+ * Estimates the cost of evaluating a bson_dollar_<op> qual against a document
+ * from the operator and its query value, instead of the flat procost every
+ * operator shares. This orders the quals that are rechecked on a document
+ * cheapest first and lets the index choice account for the filters left over.
+ *
+ * Every operator pays for walking the path in the document (a lookup per
+ * dotted segment) and a compare. On top of that:
+ *   - $in/$nin build a hash set of the values once per scan and probe it per
+ *     document, regexes in the list are matched one by one.
+ *   - $all matches each of its values against the document.
+ *   - $regex compiles once per scan and matches in time that grows with the
+ *     pattern.
+ *   - $elemMatch evaluates its nested clauses against every array element.
+ *   - Geo and text operators evaluate geometries or tsvectors.
+ * Large values (documents, arrays, long strings) add to the cost of the compare.
+ * The estimate is in units of cpu_operator_cost so that the flat cost of 1 that
+ * the functions are declared with stays the cost of a plain compare.
+ */
+static bool
+TryEstimateDollarOperatorCost(SupportRequestCost *req)
+{
+	if (req->node == NULL)
+	{
+		return false;
+	}
+
+	List *args;
+	if (IsA(req->node, FuncExpr))
+	{
+		args = ((FuncExpr *) req->node)->args;
+	}
+	else if (IsA(req->node, OpExpr))
+	{
+		args = ((OpExpr *) req->node)->args;
+	}
+	else
+	{
+		return false;
+	}
+
+	if (list_length(args) < 2 || !IsA(lsecond(args), Const) ||
+		((Const *) lsecond(args))->constisnull)
+	{
+		return false;
+	}
+
+	const MongoIndexOperatorInfo *indexOperator =
+		GetMongoIndexOperatorInfoByPostgresFuncId(req->funcid);
+	if (indexOperator == NULL ||
+		indexOperator->indexStrategy == BSON_INDEX_STRATEGY_INVALID)
+	{
+		return false;
+	}
+
+	pgbsonelement queryElement;
+	if (!TryGetSinglePgbsonElementFromPgbson(
+			DatumGetPgBson(((Const *) lsecond(args))->constvalue), &queryElement))
+	{
+		return false;
+	}
+
+	/* Walking the path: One lookup per path segment */
+	double pathCost = 1.0;
+	for (uint32_t i = 0; i < queryElement.pathLength; i++)
+	{
+		if (queryElement.path[i] == '.')
+		{
+			pathCost += 1.0;
+		}
+	}
+
+	/* The compare itself, more expensive for larger values */
+	const bson_value_t *queryValue = &queryElement.bsonValue;
+	double compareCost = 1.0;
+	if (queryValue->value_type == BSON_TYPE_DOCUMENT ||
+		queryValue->value_type == BSON_TYPE_ARRAY)
+	{
+		compareCost += queryValue->value.v_doc.data_len / 256.0;
+	}
+	else if (queryValue->value_type == BSON_TYPE_UTF8)
+	{
+		compareCost += queryValue->value.v_utf8.len / 256.0;
+	}
+
+	double startupCost = 0;
+	double perTupleCost = pathCost + compareCost;
+	switch (indexOperator->indexStrategy)
+	{
+		case BSON_INDEX_STRATEGY_DOLLAR_IN:
+		case BSON_INDEX_STRATEGY_DOLLAR_NOT_IN:
+		{
+			if (queryValue->value_type != BSON_TYPE_ARRAY)
+			{
+				break;
+			}
+
+			int numValues = 0;
+			int numRegexes = 0;
+			bson_iter_t arrayIter;
+			BsonValueInitIterator(queryValue, &arrayIter);
+			while (bson_iter_next(&arrayIter))
+			{
+				numValues++;
+				if (BSON_ITER_HOLDS_REGEX(&arrayIter))
+				{
+					numRegexes++;
+				}
+			}
+
+			/* Hashing the values once, then a probe and the regexes per document */
+			startupCost = numValues;
+			perTupleCost = pathCost + 1.0 + numRegexes * 4.0;
+			break;
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_ALL:
+		{
+			if (queryValue->value_type == BSON_TYPE_ARRAY)
+			{
+				int numValues = BsonDocumentValueCountKeys(queryValue);
+				perTupleCost = (pathCost + 1.0) * Max(numValues, 1);
+			}
+
+			break;
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_REGEX:
+		{
+			uint32_t patternLength = 0;
+			if (queryValue->value_type == BSON_TYPE_REGEX)
+			{
+				patternLength = strlen(queryValue->value.v_regex.regex);
+			}
+			else if (queryValue->value_type == BSON_TYPE_UTF8)
+			{
+				patternLength = queryValue->value.v_utf8.len;
+			}
+
+			startupCost = 10.0 + patternLength;
+			perTupleCost = pathCost + 4.0 + patternLength / 8.0;
+			break;
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_ELEMMATCH:
+		{
+			/* Assume a few array elements per document */
+			int nestedClauses = CountNestedQueryClauses(queryValue);
+			perTupleCost = pathCost + 4.0 * Max(nestedClauses, 1);
+			break;
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_GEOWITHIN:
+		case BSON_INDEX_STRATEGY_DOLLAR_GEOINTERSECTS:
+		{
+			startupCost = 10.0;
+			perTupleCost = pathCost + 20.0 + compareCost;
+			break;
+		}
+
+		case BSON_INDEX_STRATEGY_DOLLAR_TEXT:
+		{
+			perTupleCost = pathCost + 20.0;
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+
+	req->startup = startupCost * cpu_operator_cost;
+	req->per_tuple = perTupleCost * cpu_operator_cost;
+	return true;
+}
+
+
+/*
+ * Counts the query clauses nested in a query value (e.g. the value of an
+ * $elemMatch): Every field of every nested document or array counts.
+ */
+static int
+CountNestedQueryClauses(const bson_value_t *value)
+{
+	if (value->value_type != BSON_TYPE_DOCUMENT &&
+		value->value_type != BSON_TYPE_ARRAY)
+	{
+		return 0;
+	}
+
+	check_stack_depth();
+
+	int count = 0;
+	bson_iter_t valueIter;
+	BsonValueInitIterator(value, &valueIter);
+	while (bson_iter_next(&valueIter))
+	{
+		count++;
+		count += CountNestedQueryClauses(bson_iter_value(&valueIter));
+	}
+
+	return count;
+}
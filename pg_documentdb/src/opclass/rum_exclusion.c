@@ -73,6 +73,15 @@ static void ValidateExclusionPathSpec(const char *prefix);
 static bool ProcessUniqueShardDocumentKeys(pgbson *uniqueShardDocument,
 										   HTAB *termsHashSet, HASHACTION hashAction);
 static HTAB * GetUniqueShardDocumentTermsHTAB(pgbson *document);
+static bool TryCompareUniqueShardDocumentTerms(pgbson *left, pgbson *right,
+											   bool *uniquenessConflict);
+
+/*
+ * Rechecks compare the terms of a path pairwise while there are at most this
+ * many pairs, which is the common case of one term per path (documents
+ * without arrays). Beyond that the terms of the left document are hashed.
+ */
+#define UNIQUE_RECHECK_MAX_TERM_PAIRS 64
 
 typedef struct IndexBounds
 {
@@ -422,18 +431,22 @@ bson_unique_shard_path_equal(PG_FUNCTION_ARGS)
 	pgbson *left = PG_GETARG_PGBSON_PACKED(0);
 	pgbson *right = PG_GETARG_PGBSON_PACKED(1);
 
+	bool uniquenessConflict;
+	if (!TryCompareUniqueShardDocumentTerms(left, right, &uniquenessConflict))
+	{
+		/* Build HTAB with every pair of { <path> : <term> } */
+		HTAB *leftHashTable = GetUniqueShardDocumentTermsHTAB(left);
 
-	/* Build HTAB with every pair of { <path> : <term> } */
-	HTAB *leftHashTable = GetUniqueShardDocumentTermsHTAB(left);
+		/*
+		 * Iterate through pgbson on the right to check if every path (key) has
+		 * a term match on the left.
+		 */
+		uniquenessConflict = ProcessUniqueShardDocumentKeys(right, leftHashTable,
+															HASH_FIND);
 
-	/*
-	 * Iterate through pgbson on the right to check if every path (key) has
-	 * a term match on the left.
-	 */
-	bool uniquenessConflict = ProcessUniqueShardDocumentKeys(right, leftHashTable,
-															 HASH_FIND);
+		hash_destroy(leftHashTable);
+	}
 
-	hash_destroy(leftHashTable);
 	PG_FREE_IF_COPY(left, 0);
 	PG_FREE_IF_COPY(right, 1);
 
@@ -872,3 +885,73 @@ GetUniqueShardDocumentTermsHTAB(pgbson *uniqueShardDocument)
 	ProcessUniqueShardDocumentKeys(uniqueShardDocument, termsHashSet, HASH_ENTER);
 	return termsHashSet;
 }
+
+
+/*
+ * Compares the terms of two unique shard documents path by path without
+ * building a hash table: The documents have a conflict if every path of the
+ * right document shares a term with the same path of the left document.
+ * Returns false if a path has too many terms to compare them pairwise.
+ */
+static bool
+TryCompareUniqueShardDocumentTerms(pgbson *left, pgbson *right,
+								   bool *uniquenessConflict)
+{
+	bson_iter_t rightIter;
+	PgbsonInitIterator(right, &rightIter);
+	while (bson_iter_next(&rightIter))
+	{
+		if (!BSON_ITER_HOLDS_ARRAY(&rightIter))
+		{
+			continue;
+		}
+
+		bson_iter_t leftIter;
+		PgbsonInitIterator(left, &leftIter);
+		if (!bson_iter_find_w_len(&leftIter, bson_iter_key(&rightIter),
+								  bson_iter_key_len(&rightIter)) ||
+			!BSON_ITER_HOLDS_ARRAY(&leftIter))
+		{
+			/* The left document has no terms for the path: No conflict */
+			*uniquenessConflict = false;
+			return true;
+		}
+
+		const bson_value_t *rightTerms = bson_iter_value(&rightIter);
+		const bson_value_t *leftTerms = bson_iter_value(&leftIter);
+		if (BsonDocumentValueCountKeys(rightTerms) *
+			BsonDocumentValueCountKeys(leftTerms) > UNIQUE_RECHECK_MAX_TERM_PAIRS)
+		{
+			return false;
+		}
+
+		bool termMatch = false;
+		bson_iter_t rightTermIter;
+		BsonValueInitIterator(rightTerms, &rightTermIter);
+		while (!termMatch && bson_iter_next(&rightTermIter))
+		{
+			bson_iter_t leftTermIter;
+			BsonValueInitIterator(leftTerms, &leftTermIter);
+			while (bson_iter_next(&leftTermIter))
+			{
+				bool isComparisonValidIgnore;
+				if (CompareBsonValueAndType(bson_iter_value(&rightTermIter),
+											bson_iter_value(&leftTermIter),
+											&isComparisonValidIgnore) == 0)
+				{
+					termMatch = true;
+					break;
+				}
+			}
+		}
+
+		if (!termMatch)
+		{
+			*uniquenessConflict = false;
+			return true;
+		}
+	}
+
+	*uniquenessConflict = true;
+	return true;
+}
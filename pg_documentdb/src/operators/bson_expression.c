@@ -83,9 +83,60 @@ typedef struct BsonExpressionPartitionByFieldsGetState
 	BsonProjectionQueryState *projectionTreeState;
 } BsonExpressionPartitionByFieldsGetState;
 
+/*
+ * The state of an expression that is repeated across the fields of a projection
+ * and is evaluated once per document, along with the result for the most
+ * recently evaluated document.
+ */
+typedef struct SharedAggregationExpressionState
+{
+	/* The expression shared by all the occurrences */
+	AggregationExpressionData *expression;
+
+	/* The generation of the projection, advanced before each document */
+	const uint64 *currentGeneration;
+
+	/* The generation the cached value was computed in */
+	uint64 generation;
+
+	/* The cached value (EOD if the expression evaluated to a missing value) */
+	bson_value_t value;
+} SharedAggregationExpressionState;
+
+/*
+ * An operator expression parsed for a field of a projection that can be shared
+ * with later fields with the same expression.
+ */
+typedef struct SharedAggregationExpressionEntry
+{
+	/* The expression spec, used to find repeated expressions */
+	bson_value_t expressionValue;
+
+	/* The field expression the entry was parsed into */
+	AggregationExpressionData *fieldExpression;
+
+	/* A copy of the expression as it was parsed */
+	AggregationExpressionData parsedExpression;
+
+	/* The shared state, created once the expression is repeated */
+	SharedAggregationExpressionState *sharedState;
+} SharedAggregationExpressionEntry;
+
 extern bool EnableCollation;
 extern bool EnableNowSystemVariable;
 extern bool EnableVariablesSupportForWriteCommands;
+extern bool EnableAggregationExpressionOptimization;
+extern bool EnableExpressionEvaluationArena;
+
+/*
+ * The arena that the temporary values of expression evaluation are allocated
+ * from while a document is projected. Individual values are never freed: The
+ * arena is reset wholesale once the document has been written out.
+ */
+static MemoryContext ExpressionEvaluationArena = NULL;
+
+/* Whether or not expression results currently allocate from the arena */
+static bool IsExpressionEvaluationArenaActive = false;
 
 /* --------------------------------------------------------- */
 /* Forward declaration */
@@ -95,11 +146,20 @@ static bool EvaluateFieldPathAndWriteCore(bson_iter_t *document,
 										  uint32_t dottedPathExpressionLength,
 										  pgbson_element_writer *writer, bool
 										  isNullOnEmpty);
+static bool EvaluateFieldPathAndWriteFromField(bson_iter_t *document,
+											   const char *dottedPathExpression,
+											   uint32_t dottedPathExpressionLength,
+											   uint32_t currentFieldLength,
+											   pgbson_element_writer *writer,
+											   bool isNullOnEmpty);
 static bool EvaluateFieldPathAndWrite(bson_value_t *value,
 									  const char *dottedPathExpression,
 									  uint32_t dottedPathExpressionLength,
 									  pgbson_element_writer *writer,
-									  bool isNullOnEmpty);
+									  bool isNullOnEmpty,
+									  PgbsonFieldDirectory *documentDirectory);
+static PgbsonFieldDirectory * GetDocumentDirectoryForValue(
+	ExpressionResult *expressionResult, const bson_value_t *value);
 static void EvaluateAggregationExpressionDocumentToWriter(const
 														  AggregationExpressionData *data,
 														  pgbson *document,
@@ -165,6 +225,18 @@ static void ParseBsonExpressionGetState(BsonExpressionGetState *getState,
 static void CreateProjectionTreeStateForPartitionByFields(
 	BsonExpressionPartitionByFieldsGetState *state, pgbson *partitionBy);
 
+static bool IsExpressionValueDeterministic(const bson_value_t *value,
+										   bool requireNoReferences);
+static void FoldOperatorExpressionToConstant(AggregationExpressionData *expressionData);
+static bson_value_t EvaluateAggregationExpressionDataToValue(
+	const AggregationExpressionData *expressionData, pgbson *document,
+	const ExpressionVariableContext *variableContext);
+static void SetSharedAggregationExpressionData(AggregationExpressionData *expressionData,
+											   SharedAggregationExpressionState *
+											   sharedState);
+static void HandlePreParsedSharedExpression(pgbson *doc, void *arguments,
+											ExpressionResult *expressionResult);
+
 
 /*
  *  Keep this list lexicographically sorted by the operator name,
@@ -1104,6 +1176,45 @@ ExpressionResultGetVariable(StringView variableName,
 }
 
 
+/*
+ * Walks the variable context chain of the expression result and returns the
+ * field directory built over the given value if one is available.
+ * Returns NULL if the value is not the document that the nearest directory indexes
+ * (e.g. $$CURRENT was rebound to a different value).
+ */
+static PgbsonFieldDirectory *
+GetDocumentDirectoryForValue(ExpressionResult *expressionResult,
+							 const bson_value_t *value)
+{
+	if (value->value_type != BSON_TYPE_DOCUMENT)
+	{
+		return NULL;
+	}
+
+	const ExpressionVariableContext *current =
+		&expressionResult->expressionResultPrivate.variableContext;
+	while (current != NULL)
+	{
+		if (current->documentDirectory != NULL)
+		{
+			const pgbson *directoryDocument = current->documentDirectory->document;
+			if (value->value.v_doc.data == (const uint8_t *) VARDATA_ANY(
+					directoryDocument) &&
+				value->value.v_doc.data_len == VARSIZE_ANY_EXHDR(directoryDocument))
+			{
+				return current->documentDirectory;
+			}
+
+			return NULL;
+		}
+
+		current = current->parent;
+	}
+
+	return NULL;
+}
+
+
 /*
  * Function to add a constant variable to the expression result context
  */
@@ -1265,6 +1376,18 @@ ParseVariableSpec(const bson_value_t *variableSpec,
 }
 
 
+/*
+ * Whether the expression spec (or query filter) can be evaluated to a different
+ * value for the same document e.g. it uses $rand.
+ */
+bool
+IsAggregationExpressionNonDeterministic(const bson_value_t *value)
+{
+	bool requireNoReferences = false;
+	return !IsExpressionValueDeterministic(value, requireNoReferences);
+}
+
+
 /* Helper function that checks if a variable name is an overridable system variable. */
 static bool
 IsOverridableSystemVariable(StringView *name)
@@ -1337,6 +1460,48 @@ EvaluateFieldPathAndWriteCore(bson_iter_t *document, const char *dottedPathExpre
 	check_stack_depth();
 	CHECK_FOR_INTERRUPTS();
 
+	const char *dotKeyStr = memchr(dottedPathExpression, '.', dottedPathExpressionLength);
+	uint32_t currentFieldLength = dotKeyStr == NULL ? dottedPathExpressionLength :
+								  (uint32_t) (dotKeyStr - dottedPathExpression);
+	if (!bson_iter_find_w_len(document, dottedPathExpression, currentFieldLength))
+	{
+		if (isNullOnEmpty)
+		{
+			bson_value_t nullValue = { 0 };
+			nullValue.value_type = BSON_TYPE_NULL;
+			PgbsonElementWriterWriteValue(writer, &nullValue);
+			return true;
+		}
+
+		return false;
+	}
+
+	return EvaluateFieldPathAndWriteFromField(document, dottedPathExpression,
+											  dottedPathExpressionLength,
+											  currentFieldLength, writer,
+											  isNullOnEmpty);
+}
+
+
+/*
+ * Given an iterator positioned on the field that matches the first segment of the
+ * dottedPathExpression, projects the value (or walks the remainder of the path)
+ * into the writer with the $field projection semantics.
+ */
+static bool
+EvaluateFieldPathAndWriteFromField(bson_iter_t *document,
+								   const char *dottedPathExpression,
+								   uint32_t dottedPathExpressionLength,
+								   uint32_t currentFieldLength,
+								   pgbson_element_writer *writer, bool isNullOnEmpty)
+{
+	if (currentFieldLength == dottedPathExpressionLength)
+	{
+		/* field found, copy value. */
+		PgbsonElementWriterWriteValue(writer, bson_iter_value(document));
+		return true;
+	}
+
 	/*
 	 * If the expression is matches into an array,
 	 * we don't need to write null for paths not found.
@@ -1352,43 +1517,7 @@ EvaluateFieldPathAndWriteCore(bson_iter_t *document, const char *dottedPathExpre
 	 */
 	bool isNullOnEmptyWhenDocumentHasArray = false;
 
-	const char *dotKeyStr = memchr(dottedPathExpression, '.', dottedPathExpressionLength);
-	if (dotKeyStr == NULL)
-	{
-		if (!bson_iter_find_w_len(document, dottedPathExpression,
-								  dottedPathExpressionLength))
-		{
-			if (isNullOnEmpty)
-			{
-				bson_value_t nullValue = { 0 };
-				nullValue.value_type = BSON_TYPE_NULL;
-				PgbsonElementWriterWriteValue(writer, &nullValue);
-				return true;
-			}
-
-			return false;
-		}
-
-		/* field found, copy value. */
-		PgbsonElementWriterWriteValue(writer, bson_iter_value(document));
-		return true;
-	}
-
-	uint32_t currentFieldLength = dotKeyStr - dottedPathExpression;
-	if (!bson_iter_find_w_len(document, dottedPathExpression, currentFieldLength))
-	{
-		if (isNullOnEmpty)
-		{
-			bson_value_t nullValue = { 0 };
-			nullValue.value_type = BSON_TYPE_NULL;
-			PgbsonElementWriterWriteValue(writer, &nullValue);
-			return true;
-		}
-
-		return false;
-	}
-
-	const char *remainingPath = dotKeyStr + 1;
+	const char *remainingPath = dottedPathExpression + currentFieldLength + 1;
 	uint32_t remainingPathLength = dottedPathExpressionLength - currentFieldLength - 1;
 	if (BSON_ITER_HOLDS_DOCUMENT(document))
 	{
@@ -1434,12 +1563,15 @@ EvaluateFieldPathAndWriteCore(bson_iter_t *document, const char *dottedPathExpre
 /*
  * Given an expression of the form "field": "path.to.field" and a given bson value
  * walks the value if it holds a document or an array to find the instance of the dotted expression.
+ * If a documentDirectory over the value is provided, the first segment of the path is resolved
+ * through the directory instead of walking the document from the first field.
  */
 static bool
 EvaluateFieldPathAndWrite(bson_value_t *value, const
 						  char *dottedPathExpression,
 						  uint32_t dottedPathExpressionLength,
-						  pgbson_element_writer *writer, bool isNullOnEmpty)
+						  pgbson_element_writer *writer, bool isNullOnEmpty,
+						  PgbsonFieldDirectory *documentDirectory)
 {
 	if (value->value_type != BSON_TYPE_DOCUMENT &&
 		value->value_type != BSON_TYPE_ARRAY)
@@ -1447,6 +1579,34 @@ EvaluateFieldPathAndWrite(bson_value_t *value, const
 		return false;
 	}
 
+	if (documentDirectory != NULL)
+	{
+		const char *dotKeyStr = memchr(dottedPathExpression, '.',
+									   dottedPathExpressionLength);
+		uint32_t currentFieldLength = dotKeyStr == NULL ? dottedPathExpressionLength :
+									  (uint32_t) (dotKeyStr - dottedPathExpression);
+
+		bson_iter_t fieldIter;
+		if (!PgbsonFieldDirectoryFindField(documentDirectory, dottedPathExpression,
+										   currentFieldLength, &fieldIter))
+		{
+			if (isNullOnEmpty)
+			{
+				bson_value_t nullValue = { 0 };
+				nullValue.value_type = BSON_TYPE_NULL;
+				PgbsonElementWriterWriteValue(writer, &nullValue);
+				return true;
+			}
+
+			return false;
+		}
+
+		return EvaluateFieldPathAndWriteFromField(&fieldIter, dottedPathExpression,
+												  dottedPathExpressionLength,
+												  currentFieldLength, writer,
+												  isNullOnEmpty);
+	}
+
 	/*
 	 * If the variable is matches into an array,
 	 * we don't need to write null for paths not found.
@@ -1578,10 +1738,23 @@ ExpressionResultSetValueFromWriter(ExpressionResult *expressionResult)
 			 * we have to create a copy that is owned by the result and will be
 			 * guaranteed to live for the lifetime of the expression
 			 */
-			pgbson *pgbson = BsonValueToDocumentPgbson(&bsonValue);
-			expressionResult->expressionResultPrivate.tracker->itemsToFree =
-				lappend(expressionResult->expressionResultPrivate.tracker->itemsToFree,
-						pgbson);
+			pgbson *pgbson;
+			if (IsExpressionEvaluationArenaActive)
+			{
+				/* The copy lives until the arena is reset after the document */
+				MemoryContext oldContext = MemoryContextSwitchTo(
+					ExpressionEvaluationArena);
+				pgbson = BsonValueToDocumentPgbson(&bsonValue);
+				MemoryContextSwitchTo(oldContext);
+			}
+			else
+			{
+				pgbson = BsonValueToDocumentPgbson(&bsonValue);
+				expressionResult->expressionResultPrivate.tracker->itemsToFree =
+					lappend(expressionResult->expressionResultPrivate.tracker->itemsToFree,
+							pgbson);
+			}
+
 			pgbsonelement element;
 			PgbsonToSinglePgbsonElement(pgbson, &element);
 			expressionResult->value = element.bsonValue;
@@ -1592,7 +1765,11 @@ ExpressionResultSetValueFromWriter(ExpressionResult *expressionResult)
 	expressionResult->expressionResultPrivate.valueSet = true;
 	if (expressionResult->expressionResultPrivate.hasBaseWriter)
 	{
-		PgbsonWriterFree(&expressionResult->expressionResultPrivate.baseWriter);
+		if (!IsExpressionEvaluationArenaActive)
+		{
+			PgbsonWriterFree(&expressionResult->expressionResultPrivate.baseWriter);
+		}
+
 		expressionResult->expressionResultPrivate.hasBaseWriter = false;
 		expressionResult->isExpressionWriter = false;
 	}
@@ -1643,7 +1820,11 @@ ExpressionResultReset(ExpressionResult *expressionResult)
 
 	if (expressionResult->expressionResultPrivate.hasBaseWriter)
 	{
-		PgbsonWriterFree(&expressionResult->expressionResultPrivate.baseWriter);
+		if (!IsExpressionEvaluationArenaActive)
+		{
+			PgbsonWriterFree(&expressionResult->expressionResultPrivate.baseWriter);
+		}
+
 		expressionResult->expressionResultPrivate.hasBaseWriter = false;
 	}
 }
@@ -1672,7 +1853,17 @@ ExpressionResultGetElementWriter(ExpressionResult *context)
 	{
 		/* initialize a new writer and use it to write to the field "". */
 		context->expressionResultPrivate.hasBaseWriter = true;
-		PgbsonWriterInit(&context->expressionResultPrivate.baseWriter);
+		if (IsExpressionEvaluationArenaActive)
+		{
+			/* The buffer is grown in place by repalloc, so it stays in the arena */
+			MemoryContext oldContext = MemoryContextSwitchTo(ExpressionEvaluationArena);
+			PgbsonWriterInit(&context->expressionResultPrivate.baseWriter);
+			MemoryContextSwitchTo(oldContext);
+		}
+		else
+		{
+			PgbsonWriterInit(&context->expressionResultPrivate.baseWriter);
+		}
 		PgbsonInitObjectElementWriter(&context->expressionResultPrivate.baseWriter,
 									  &context->expressionResultPrivate.writer, "", 0);
 		context->isExpressionWriter = true;
@@ -1914,6 +2105,141 @@ ParseAggregationExpressionData(AggregationExpressionData *expressionData,
 }
 
 
+/*
+ * Parses the expression for a field of a projection. If the same operator
+ * expression was already parsed for another field of the projection, the
+ * fields share a single expression that is evaluated once per document.
+ * The projection must advance context->sharedExpressionGeneration before
+ * evaluating each document.
+ */
+void
+ParseSharedAggregationExpressionData(AggregationExpressionData *expressionData,
+									 const bson_value_t *value,
+									 ParseAggregationExpressionContext *context)
+{
+	bool requireNoReferences = false;
+	if (!EnableAggregationExpressionOptimization ||
+		value->value_type != BSON_TYPE_DOCUMENT ||
+		!IsExpressionValueDeterministic(value, requireNoReferences))
+	{
+		ParseAggregationExpressionData(expressionData, value, context);
+		return;
+	}
+
+	ListCell *entryCell;
+	foreach(entryCell, context->sharedExpressions)
+	{
+		SharedAggregationExpressionEntry *entry = lfirst(entryCell);
+		if (entry->expressionValue.value.v_doc.data_len != value->value.v_doc.data_len ||
+			memcmp(entry->expressionValue.value.v_doc.data, value->value.v_doc.data,
+				   value->value.v_doc.data_len) != 0)
+		{
+			continue;
+		}
+
+		if (entry->sharedState == NULL)
+		{
+			if (context->sharedExpressionGeneration == NULL)
+			{
+				context->sharedExpressionGeneration = palloc(sizeof(uint64));
+				*context->sharedExpressionGeneration = 1;
+			}
+
+			SharedAggregationExpressionState *sharedState =
+				palloc0(sizeof(SharedAggregationExpressionState));
+			sharedState->currentGeneration = context->sharedExpressionGeneration;
+			sharedState->expression = palloc(sizeof(AggregationExpressionData));
+			*sharedState->expression = entry->parsedExpression;
+			entry->sharedState = sharedState;
+
+			/* Share the first occurrence too unless its field was replaced since */
+			AggregationExpressionData *fieldExpression = entry->fieldExpression;
+			if (fieldExpression->kind == AggregationExpressionKind_Operator &&
+				fieldExpression->operator.arguments ==
+				entry->parsedExpression.operator.arguments)
+			{
+				SetSharedAggregationExpressionData(fieldExpression, sharedState);
+			}
+		}
+
+		SetSharedAggregationExpressionData(expressionData, entry->sharedState);
+		return;
+	}
+
+	ParseAggregationExpressionData(expressionData, value, context);
+	if (expressionData->kind == AggregationExpressionKind_Operator)
+	{
+		SharedAggregationExpressionEntry *entry =
+			palloc0(sizeof(SharedAggregationExpressionEntry));
+		entry->expressionValue = *value;
+		entry->fieldExpression = expressionData;
+		entry->parsedExpression = *expressionData;
+		context->sharedExpressions = lappend(context->sharedExpressions, entry);
+	}
+}
+
+
+/*
+ * Starts allocating the temporary values of expression evaluation from the
+ * expression arena for the document about to be evaluated. Returns whether
+ * this call opened the arena: Nested calls share the arena of the outermost
+ * one, and only the outermost call may end it.
+ */
+bool
+BeginExpressionEvaluationArena(void)
+{
+	if (!EnableExpressionEvaluationArena || IsExpressionEvaluationArenaActive)
+	{
+		return false;
+	}
+
+	if (ExpressionEvaluationArena == NULL)
+	{
+		ExpressionEvaluationArena = AllocSetContextCreate(TopMemoryContext,
+														  "ExpressionEvaluationArena",
+														  ALLOCSET_DEFAULT_SIZES);
+	}
+
+	IsExpressionEvaluationArenaActive = true;
+	return true;
+}
+
+
+/*
+ * Ends the arena opened by BeginExpressionEvaluationArena, releasing every
+ * value allocated from it at once. No value allocated from the arena may be
+ * referenced after this.
+ */
+void
+EndExpressionEvaluationArena(bool openedArena)
+{
+	if (!openedArena)
+	{
+		return;
+	}
+
+	IsExpressionEvaluationArenaActive = false;
+	MemoryContextReset(ExpressionEvaluationArena);
+}
+
+
+/*
+ * Releases the expression arena when the (sub)transaction evaluating it aborts
+ * so that a failed evaluation does not leave it open.
+ */
+void
+ResetExpressionEvaluationArena(void)
+{
+	if (ExpressionEvaluationArena == NULL)
+	{
+		return;
+	}
+
+	IsExpressionEvaluationArenaActive = false;
+	MemoryContextReset(ExpressionEvaluationArena);
+}
+
+
 /* Evaluates the aggregation expression data for a preparsed aggregation operator,
  * and sets the value into the given expression result. */
 void
@@ -2266,10 +2592,11 @@ EvaluateAggregationExpressionVariable(const AggregationExpressionData *data,
 	/* Evaluate dotted expression for a variable */
 	StringView varNameDottedSuffix = StringViewFindSuffix(
 		&dottedExpression, '.');
+	PgbsonFieldDirectory *documentDirectory = NULL;
 	EvaluateFieldPathAndWrite(&variableValue, varNameDottedSuffix.string,
 							  varNameDottedSuffix.length,
 							  ExpressionResultGetElementWriter(expressionResult),
-							  isNullOnEmpty);
+							  isNullOnEmpty, documentDirectory);
 	ExpressionResultSetValueFromWriter(expressionResult);
 }
 
@@ -2377,10 +2704,12 @@ EvaluateAggregationExpressionSystemVariable(const AggregationExpressionData *dat
 	}
 
 	expressionResult->isFieldPathExpression = true;
+	PgbsonFieldDirectory *documentDirectory =
+		GetDocumentDirectoryForValue(expressionResult, &variableValue);
 	EvaluateFieldPathAndWrite(&variableValue, data->systemVariable.pathSuffix.string,
 							  data->systemVariable.pathSuffix.length,
 							  ExpressionResultGetElementWriter(expressionResult),
-							  isNullOnEmpty);
+							  isNullOnEmpty, documentDirectory);
 	ExpressionResultSetValueFromWriter(expressionResult);
 }
 
@@ -2512,6 +2841,14 @@ ParseDocumentAggregationExpressionData(const bson_value_t *value,
 
 				Assert(expressionData->operator.argumentsKind !=
 					   AggregationExpressionArgumentsKind_Invalid);
+
+				/* Operators that don't fold their constant arguments themselves are folded here */
+				bool requireNoReferences = true;
+				if (EnableAggregationExpressionOptimization &&
+					IsExpressionValueDeterministic(value, requireNoReferences))
+				{
+					FoldOperatorExpressionToConstant(expressionData);
+				}
 			}
 		}
 		else
@@ -3134,3 +3471,148 @@ ParseAndGetTopLevelVariableSpec(const bson_value_t *varSpec,
 
 	return PgbsonWriterGetPgbson(&resultWriter);
 }
+
+
+/*
+ * Whether the expression spec always evaluates to the same value for the same
+ * document: It has no non deterministic operators. If requireNoReferences is
+ * set, the spec must also not depend on the document or the variables (it
+ * has no field paths or variables, nor operators that implicitly read them)
+ * so that it evaluates to the same value for all documents.
+ */
+static bool
+IsExpressionValueDeterministic(const bson_value_t *value, bool requireNoReferences)
+{
+	if (value->value_type == BSON_TYPE_UTF8)
+	{
+		/* Both field paths and variables start with '$' */
+		return !requireNoReferences || value->value.v_utf8.len == 0 ||
+			   value->value.v_utf8.str[0] != '$';
+	}
+
+	if (value->value_type != BSON_TYPE_DOCUMENT && value->value_type != BSON_TYPE_ARRAY)
+	{
+		return true;
+	}
+
+	check_stack_depth();
+
+	bson_iter_t valueIter;
+	BsonValueInitIterator(value, &valueIter);
+	while (bson_iter_next(&valueIter))
+	{
+		const char *key = bson_iter_key(&valueIter);
+		if (value->value_type == BSON_TYPE_DOCUMENT && key[0] == '$')
+		{
+			if (strcmp(key, "$rand") == 0 || strcmp(key, "$function") == 0 ||
+				strcmp(key, "$accumulator") == 0)
+			{
+				return false;
+			}
+
+			/* $getField and $meta read the current document, internal operators may carry state */
+			if (requireNoReferences &&
+				(strcmp(key, "$getField") == 0 || strcmp(key, "$meta") == 0 ||
+				 key[1] == '_'))
+			{
+				return false;
+			}
+		}
+
+		if (!IsExpressionValueDeterministic(bson_iter_value(&valueIter),
+											requireNoReferences))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * Evaluates an operator expression that does not depend on the document
+ * and replaces it with the constant it evaluates to.
+ */
+static void
+FoldOperatorExpressionToConstant(AggregationExpressionData *expressionData)
+{
+	pgbson *emptyDocument = PgbsonInitEmpty();
+	const ExpressionVariableContext *variableContext = NULL;
+	bson_value_t constantValue = EvaluateAggregationExpressionDataToValue(
+		expressionData, emptyDocument, variableContext);
+
+	expressionData->kind = AggregationExpressionKind_Constant;
+	expressionData->value = constantValue;
+}
+
+
+/*
+ * Evaluates the expression against the document and returns its value, which
+ * is allocated in the current memory context (EOD if the expression evaluated
+ * to a missing value).
+ */
+static bson_value_t
+EvaluateAggregationExpressionDataToValue(const AggregationExpressionData *expressionData,
+										 pgbson *document,
+										 const ExpressionVariableContext *variableContext)
+{
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+
+	StringView path = { .string = "", .length = 0 };
+	bool isNullOnEmpty = false;
+	EvaluateAggregationExpressionDataToWriter(expressionData, document, path, &writer,
+											  variableContext, isNullOnEmpty);
+
+	pgbson *resultDocument = PgbsonWriterGetPgbson(&writer);
+	pgbsonelement resultElement;
+	if (!TryGetSinglePgbsonElementFromPgbson(resultDocument, &resultElement))
+	{
+		resultElement.bsonValue.value_type = BSON_TYPE_EOD;
+	}
+
+	return resultElement.bsonValue;
+}
+
+
+/*
+ * Sets the expression data to evaluate the shared expression through its
+ * per document cache.
+ */
+static void
+SetSharedAggregationExpressionData(AggregationExpressionData *expressionData,
+								   SharedAggregationExpressionState *sharedState)
+{
+	bson_type_t returnType = sharedState->expression->operator.returnType;
+	bson_value_t operatorValue = sharedState->expression->operator.expressionValue;
+
+	memset(expressionData, 0, sizeof(AggregationExpressionData));
+	expressionData->kind = AggregationExpressionKind_Operator;
+	expressionData->operator.arguments = sharedState;
+	expressionData->operator.argumentsKind = AggregationExpressionArgumentsKind_Palloc;
+	expressionData->operator.handleExpressionFunc = &HandlePreParsedSharedExpression;
+	expressionData->operator.returnType = returnType;
+	expressionData->operator.expressionValue = operatorValue;
+}
+
+
+/*
+ * Evaluates a shared expression: The value is computed for the first occurrence
+ * in a document and reused by the other occurrences.
+ */
+static void
+HandlePreParsedSharedExpression(pgbson *doc, void *arguments,
+								ExpressionResult *expressionResult)
+{
+	SharedAggregationExpressionState *sharedState = arguments;
+	if (sharedState->generation != *sharedState->currentGeneration)
+	{
+		sharedState->value = EvaluateAggregationExpressionDataToValue(
+			sharedState->expression, doc,
+			&expressionResult->expressionResultPrivate.variableContext);
+		sharedState->generation = *sharedState->currentGeneration;
+	}
+
+	ExpressionResultSetValue(expressionResult, &sharedState->value);
+}
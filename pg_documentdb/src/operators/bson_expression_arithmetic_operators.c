@@ -10,6 +10,7 @@
 
 #include <postgres.h>
 #include <math.h>
+#include <common/int.h>
 
 #include "io/bson_core.h"
 #include "query/bson_compare.h"
@@ -108,6 +109,9 @@ static void ProcessDollarLog10(const bson_value_t *currentValue, bson_value_t *r
 static void ProcessDollarLn(const bson_value_t *currentValue, bson_value_t *result);
 static void ProcessDollarAbs(const bson_value_t *currentValue, bson_value_t *result);
 static void ProcessDollarAddAccumulatedResult(void *state, bson_value_t *result);
+static inline bool TryAddNumbersFast(bson_value_t *result, const bson_value_t *value);
+static inline bool TryMultiplyNumbersFast(bson_value_t *result,
+										  const bson_value_t *value);
 static bool CheckForDateOverflow(bson_value_t *value);
 static void ThrowIfNotNumeric(const bson_value_t *value, const char *operatorName);
 static void ThrowIfNotNumericOrDate(const bson_value_t *value, const char *operatorName);
@@ -930,6 +934,11 @@ ProcessDollarAdd(const bson_value_t *currentElement, void *state, bson_value_t *
 {
 	DollarAddState *addState = (DollarAddState *) state;
 
+	if (TryAddNumbersFast(result, currentElement))
+	{
+		return true;
+	}
+
 	if (currentElement->value_type == BSON_TYPE_NULL)
 	{
 		/* break argument processing and return null */
@@ -1005,6 +1014,132 @@ ProcessDollarAdd(const bson_value_t *currentElement, void *state, bson_value_t *
 }
 
 
+/*
+ * Fast path of $add for the common case where both the running sum and the
+ * addend are int32, int64 or double. Follows the promotion rules of
+ * AddNumberToBsonValue (int32 overflows to int64, int64 overflows to double)
+ * without going through the generic numeric dispatch. Returns false, leaving
+ * the result untouched, for any other combination of types (dates, decimal128,
+ * null, undefined or non numeric values).
+ */
+static inline bool
+TryAddNumbersFast(bson_value_t *result, const bson_value_t *value)
+{
+	bson_type_t resultType = result->value_type;
+	bson_type_t valueType = value->value_type;
+
+	if (resultType == BSON_TYPE_INT32 && valueType == BSON_TYPE_INT32)
+	{
+		int32 sum;
+		if (pg_add_s32_overflow(result->value.v_int32, value->value.v_int32, &sum))
+		{
+			result->value.v_int64 = (int64) result->value.v_int32 +
+									value->value.v_int32;
+			result->value_type = BSON_TYPE_INT64;
+		}
+		else
+		{
+			result->value.v_int32 = sum;
+		}
+
+		return true;
+	}
+
+	if ((resultType != BSON_TYPE_INT32 && resultType != BSON_TYPE_INT64 &&
+		 resultType != BSON_TYPE_DOUBLE) ||
+		(valueType != BSON_TYPE_INT32 && valueType != BSON_TYPE_INT64 &&
+		 valueType != BSON_TYPE_DOUBLE))
+	{
+		return false;
+	}
+
+	if (resultType == BSON_TYPE_DOUBLE || valueType == BSON_TYPE_DOUBLE)
+	{
+		result->value.v_double = BsonValueAsDouble(result) + BsonValueAsDouble(value);
+		result->value_type = BSON_TYPE_DOUBLE;
+		return true;
+	}
+
+	int64 sum;
+	int64 current = BsonValueAsInt64(result);
+	int64 addend = BsonValueAsInt64(value);
+	if (pg_add_s64_overflow(current, addend, &sum))
+	{
+		result->value.v_double = (double) current + (double) addend;
+		result->value_type = BSON_TYPE_DOUBLE;
+	}
+	else
+	{
+		result->value.v_int64 = sum;
+		result->value_type = BSON_TYPE_INT64;
+	}
+
+	return true;
+}
+
+
+/*
+ * Fast path of $multiply for the common case where both the running product
+ * and the factor are int32, int64 or double. Follows the promotion rules of
+ * MultiplyWithFactorAndUpdate (int32 overflows to int64, int64 overflows to
+ * double) using overflow checked multiplication. Returns false, leaving the
+ * result untouched, for any other combination of types.
+ */
+static inline bool
+TryMultiplyNumbersFast(bson_value_t *result, const bson_value_t *value)
+{
+	bson_type_t resultType = result->value_type;
+	bson_type_t valueType = value->value_type;
+
+	if (resultType == BSON_TYPE_INT32 && valueType == BSON_TYPE_INT32)
+	{
+		int64 product = (int64) result->value.v_int32 * value->value.v_int32;
+		if (product < PG_INT32_MIN || product > PG_INT32_MAX)
+		{
+			result->value.v_int64 = product;
+			result->value_type = BSON_TYPE_INT64;
+		}
+		else
+		{
+			result->value.v_int32 = (int32) product;
+		}
+
+		return true;
+	}
+
+	if ((resultType != BSON_TYPE_INT32 && resultType != BSON_TYPE_INT64 &&
+		 resultType != BSON_TYPE_DOUBLE) ||
+		(valueType != BSON_TYPE_INT32 && valueType != BSON_TYPE_INT64 &&
+		 valueType != BSON_TYPE_DOUBLE))
+	{
+		return false;
+	}
+
+	if (resultType == BSON_TYPE_DOUBLE || valueType == BSON_TYPE_DOUBLE)
+	{
+		result->value.v_double = BsonValueAsDouble(result) * BsonValueAsDouble(value);
+		result->value_type = BSON_TYPE_DOUBLE;
+		return true;
+	}
+
+	int64 product;
+	int64 current = BsonValueAsInt64(result);
+	int64 factor = BsonValueAsInt64(value);
+	if (pg_mul_s64_overflow(current, factor, &product))
+	{
+		result->value.v_double = (double) current * (double) factor;
+		result->value_type = BSON_TYPE_DOUBLE;
+	}
+	else
+	{
+		result->value.v_int64 = product;
+		result->value_type = BSON_TYPE_INT64;
+	}
+
+	return true;
+}
+
+
 /* Function that validates the final state before returning the result for $add. */
 static void
 ProcessDollarAddAccumulatedResult(void *state, bson_value_t *result)
@@ -1042,6 +1177,11 @@ static bool
 ProcessDollarMultiply(const bson_value_t *currentElement, void *state,
 					  bson_value_t *result)
 {
+	if (TryMultiplyNumbersFast(result, currentElement))
+	{
+		return true;
+	}
+
 	if (IsExpressionResultNullOrUndefined(currentElement))
 	{
 		/* Break argument enumeration and set result to null */
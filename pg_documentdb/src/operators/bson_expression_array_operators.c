@@ -46,6 +46,13 @@ typedef void (*ProcessArrayOperatorOneOperand)(const bson_value_t *currentValue,
 											   bson_value_t *result);
 typedef void (*ProcessArrayOperatorTwoOperands)(void *state, bson_value_t *result);
 
+/*
+ * Function called with each element of an array expression that is evaluated
+ * lazily (see TryEnumerateArrayExpressionLazily). Returns false to stop the
+ * enumeration, in which case the remaining elements are not evaluated.
+ */
+typedef bool (*VisitArrayElementFunc)(const bson_value_t *element, void *state);
+
 typedef struct DollarInArguments
 {
 	AggregationExpressionData *targetValue;
@@ -103,6 +110,27 @@ typedef struct DollarFirstNLastNArguments
 	AggregationExpressionData elementsToFetch;
 } DollarFirstNLastNArguments;
 
+/* The state of the element visitors of the lazily evaluated array consumers. */
+typedef struct LazyArrayVisitState
+{
+	/* The number of elements visited so far. */
+	int32_t count;
+
+	/* The number of elements the consumer needs; INT32_MAX for all of them. */
+	int32_t limit;
+
+	/* For $in: the value to find and the collation to compare it with. */
+	const bson_value_t *targetValue;
+	const char *collationString;
+
+	/* For $arrayElemAt/$first: the element at index limit - 1. For $in: whether it was found. */
+	bson_value_t element;
+	bool found;
+
+	/* For $slice: the writer of the resulting array. */
+	pgbson_array_writer *arrayWriter;
+} LazyArrayVisitState;
+
 /* Struct that represents the parsed arguments to a $map expression. */
 typedef struct DollarMapArguments
 {
@@ -217,6 +245,37 @@ static void HandlePreParsedDollarArrayElemAtCore(pgbson *doc, void *arguments,
 												 ExpressionResult *expressionResult,
 												 char *operatorName);
 
+static bool EvaluateDollarFilterInput(DollarFilterArguments *filterArguments,
+									  pgbson *doc, ExpressionResult *childExpression,
+									  bson_value_t *inputArray, int32_t *limit);
+static void EnumerateDollarFilterElements(DollarFilterArguments *filterArguments,
+										  pgbson *doc,
+										  ExpressionResult *childExpression,
+										  const bson_value_t *inputArray, int32_t limit,
+										  VisitArrayElementFunc visitFunc,
+										  void *visitState);
+static bool EvaluateDollarMapInput(DollarMapArguments *mapArguments, pgbson *doc,
+								   ExpressionResult *childExpression,
+								   bson_value_t *inputArray);
+static void EnumerateDollarMapElements(DollarMapArguments *mapArguments, pgbson *doc,
+									   ExpressionResult *childExpression,
+									   const bson_value_t *inputArray,
+									   VisitArrayElementFunc visitFunc,
+									   void *visitState);
+static bool IsLazyArrayExpression(const AggregationExpressionData *data);
+static bool TryEnumerateArrayExpressionLazily(const AggregationExpressionData *data,
+											  pgbson *doc,
+											  ExpressionResult *expressionResult,
+											  VisitArrayElementFunc visitFunc,
+											  void *visitState, bool *isNull);
+static bool WriteArrayElement(const bson_value_t *element, void *state);
+static bool CountArrayElement(const bson_value_t *element, void *state);
+static bool FindArrayElementAtIndex(const bson_value_t *element, void *state);
+static bool FindDollarInElement(const bson_value_t *element, void *state);
+static bool WriteDollarSliceElement(const bson_value_t *element, void *state);
+static bool IsDollarInMatch(const bson_value_t *targetValue,
+							const bson_value_t *currentValue,
+							const char *collationString);
 static void ProcessDollarIn(bson_value_t *targetValue, const bson_value_t *searchArray,
 							const char *collationString, bson_value_t *result);
 static void ProcessDollarSlice(void *state, bson_value_t *result);
@@ -329,6 +388,26 @@ void
 HandlePreParsedDollarSize(pgbson *doc, void *argument,
 						  ExpressionResult *expressionResult)
 {
+	/* The size of a $filter or $map is counted without building the array */
+	LazyArrayVisitState visitState = { .count = 0, .limit = INT32_MAX };
+	bool isNull = false;
+	if (TryEnumerateArrayExpressionLazily(argument, doc, expressionResult,
+										  CountArrayElement, &visitState, &isNull))
+	{
+		bson_value_t result;
+		if (isNull)
+		{
+			/* Errors out just as $size of a null array does */
+			bson_value_t nullValue = { .value_type = BSON_TYPE_NULL };
+			ProcessDollarSize(&nullValue, &result);
+		}
+
+		result.value_type = BSON_TYPE_INT32;
+		result.value.v_int32 = visitState.count;
+		ExpressionResultSetValue(expressionResult, &result);
+		return;
+	}
+
 	HandlePreParsedArrayOperatorOneOperand(doc, argument, expressionResult,
 										   ProcessDollarSize);
 }
@@ -519,11 +598,36 @@ HandlePreParsedDollarIn(pgbson *doc, void *argument, ExpressionResult *expressio
 
 	ExpressionResultReset(&childResult);
 
+	bson_value_t result;
 	AggregationExpressionData *secondArg = state->searchArray;
+
+	/* A $filter or $map searched is evaluated only until the value is found */
+	LazyArrayVisitState visitState = {
+		.limit = INT32_MAX,
+		.targetValue = &firstValue,
+		.collationString = state->collationString,
+		.found = false
+	};
+	bool isNull = false;
+	if (TryEnumerateArrayExpressionLazily(secondArg, doc, &childResult,
+										  FindDollarInElement, &visitState, &isNull))
+	{
+		if (isNull)
+		{
+			/* Errors out just as $in on a null array does */
+			bson_value_t nullValue = { .value_type = BSON_TYPE_NULL };
+			ProcessDollarIn(&firstValue, &nullValue, state->collationString, &result);
+		}
+
+		result.value_type = BSON_TYPE_BOOL;
+		result.value.v_bool = visitState.found;
+		ExpressionResultSetValue(expressionResult, &result);
+		return;
+	}
+
 	EvaluateAggregationExpressionData(secondArg, doc, &childResult, isNullOnEmpty);
 	bson_value_t secondValue = childResult.value;
 
-	bson_value_t result;
 	ProcessDollarIn(&firstValue, &secondValue, state->collationString, &result);
 	ExpressionResultSetValue(expressionResult, &result);
 }
@@ -592,6 +696,55 @@ HandlePreParsedDollarSlice(pgbson *doc, void *arguments,
 {
 	List *argumentsList = (List *) arguments;
 
+	/*
+	 * The first n elements of a $filter or $map ({ $slice: [ <array>, n ] }) are
+	 * evaluated without evaluating the rest of the array.
+	 */
+	if (list_length(argumentsList) == 2 &&
+		IsLazyArrayExpression(list_nth(argumentsList, 0)))
+	{
+		bool isNullOnEmpty = false;
+		ExpressionResult childResult = ExpressionResultCreateChild(expressionResult);
+		EvaluateAggregationExpressionData(list_nth(argumentsList, 1), doc, &childResult,
+										  isNullOnEmpty);
+		bson_value_t countValue = childResult.value;
+
+		/* Any other count (and its errors) is handled as usual below */
+		bool checkFixedInteger = true;
+		if (BsonValueIsNumber(&countValue) &&
+			IsBsonValue32BitInteger(&countValue, checkFixedInteger) &&
+			BsonValueAsInt32(&countValue) >= 0)
+		{
+			pgbson_writer writer;
+			PgbsonWriterInit(&writer);
+			pgbson_array_writer arrayWriter;
+			PgbsonWriterStartArray(&writer, "", 0, &arrayWriter);
+
+			LazyArrayVisitState visitState = {
+				.count = 0,
+				.limit = BsonValueAsInt32(&countValue),
+				.arrayWriter = &arrayWriter
+			};
+			bool isNull = false;
+			ExpressionResultReset(&childResult);
+			if (TryEnumerateArrayExpressionLazily(list_nth(argumentsList, 0), doc,
+												  &childResult, WriteDollarSliceElement,
+												  &visitState, &isNull))
+			{
+				PgbsonWriterEndArray(&writer, &arrayWriter);
+
+				bson_value_t result = { .value_type = BSON_TYPE_NULL };
+				if (!isNull)
+				{
+					result = PgbsonArrayWriterGetValue(&arrayWriter);
+				}
+
+				ExpressionResultSetValue(expressionResult, &result);
+				return;
+			}
+		}
+	}
+
 	ThreeArgumentExpressionState state;
 	memset(&state, 0, sizeof(ThreeArgumentExpressionState));
 
@@ -824,50 +977,13 @@ HandlePreParsedDollarFilter(pgbson *doc, void *arguments,
 {
 	DollarFilterArguments *filterArguments = arguments;
 
-	bool isNullOnEmpty = false;
-
 	ExpressionResult childExpression = ExpressionResultCreateChild(expressionResult);
-	EvaluateAggregationExpressionData(&filterArguments->limit, doc, &childExpression,
-									  isNullOnEmpty);
-
-	bson_value_t evaluatedLimit = childExpression.value;
+	bson_value_t evaluatedInputArg;
 	int32_t limit;
-
-	if (IsExpressionResultNullOrUndefined(&evaluatedLimit))
-	{
-		limit = INT32_MAX;
-	}
-	else
-	{
-		bool checkFixedInteger = true;
-		if (!IsBsonValue32BitInteger(&evaluatedLimit, checkFixedInteger))
-		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION327391), errmsg(
-								"Operator $filter requires the limit to be specified as a 32-bit integer value: %s",
-								BsonValueToJsonForLogging(&evaluatedLimit)),
-							errdetail_log(
-								"The operator $filter has a limit of type %s that cannot be expressed as a 32-bit integer value.",
-								BsonTypeName(evaluatedLimit.value_type))));
-		}
-
-		limit = BsonValueAsInt32(&evaluatedLimit);
-		if (limit < 1)
-		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION327392), errmsg(
-								"$filter: limit value must be strictly greater than zero: %d",
-								limit)));
-		}
-	}
-
-	ExpressionResultReset(&childExpression);
-	EvaluateAggregationExpressionData(&filterArguments->input, doc, &childExpression,
-									  isNullOnEmpty);
-
-	bson_value_t evaluatedInputArg = childExpression.value;
-
-	/* If the input array is null or an undefined path the result is null. */
-	if (IsExpressionResultNullOrUndefined(&evaluatedInputArg))
+	if (!EvaluateDollarFilterInput(filterArguments, doc, &childExpression,
+								   &evaluatedInputArg, &limit))
 	{
+		/* If the input array is null or an undefined path the result is null. */
 		bson_value_t nullValue = {
 			.value_type = BSON_TYPE_NULL
 		};
@@ -876,47 +992,14 @@ HandlePreParsedDollarFilter(pgbson *doc, void *arguments,
 		return;
 	}
 
-	if (evaluatedInputArg.value_type != BSON_TYPE_ARRAY)
-	{
-		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION28651), errmsg(
-							"Expected 'array' type as input to $filter but found '%s' type",
-							BsonTypeName(
-								evaluatedInputArg.value_type)),
-						errdetail_log(
-							"Expected 'array' type as input to $filter but found '%s' type",
-							BsonTypeName(evaluatedInputArg.value_type))));
-	}
-
-	StringView aliasName = {
-		.string = filterArguments->alias.value.value.v_utf8.str,
-		.length = filterArguments->alias.value.value.v_utf8.len,
-	};
-
 	pgbson_element_writer *resultWriter = ExpressionResultGetElementWriter(
 		expressionResult);
 	pgbson_array_writer arrayWriter;
 	PgbsonElementWriterStartArray(resultWriter, &arrayWriter);
 
-	bson_iter_t arrayIter;
-	BsonValueInitIterator(&evaluatedInputArg, &arrayIter);
-
-	ExpressionResultReset(&childExpression);
-
-	while (limit > 0 && bson_iter_next(&arrayIter))
-	{
-		const bson_value_t *currentElem = bson_iter_value(&arrayIter);
-
-		ExpressionResultReset(&childExpression);
-		ExpressionResultSetConstantVariable(&childExpression, &aliasName, currentElem);
-		EvaluateAggregationExpressionData(&filterArguments->cond, doc, &childExpression,
-										  isNullOnEmpty);
-
-		if (BsonValueAsBool(&childExpression.value))
-		{
-			PgbsonArrayWriterWriteValue(&arrayWriter, currentElem);
-			limit--;
-		}
-	}
+	EnumerateDollarFilterElements(filterArguments, doc, &childExpression,
+								  &evaluatedInputArg, limit, WriteArrayElement,
+								  &arrayWriter);
 
 	PgbsonElementWriterEndArray(resultWriter, &arrayWriter);
 	ExpressionResultSetValueFromWriter(expressionResult);
@@ -1723,16 +1806,9 @@ HandlePreParsedDollarMap(pgbson *doc, void *arguments,
 {
 	DollarMapArguments *mapArguments = arguments;
 
-	bool isNullOnEmpty = false;
-
 	ExpressionResult childExpression = ExpressionResultCreateChild(expressionResult);
-
-	EvaluateAggregationExpressionData(&mapArguments->input, doc, &childExpression,
-									  isNullOnEmpty);
-
-	bson_value_t evaluatedInputArg = childExpression.value;
-
-	if (IsExpressionResultNullOrUndefined(&evaluatedInputArg))
+	bson_value_t evaluatedInputArg;
+	if (!EvaluateDollarMapInput(mapArguments, doc, &childExpression, &evaluatedInputArg))
 	{
 		bson_value_t nullValue = {
 			.value_type = BSON_TYPE_NULL
@@ -1742,52 +1818,13 @@ HandlePreParsedDollarMap(pgbson *doc, void *arguments,
 		return;
 	}
 
-	if (evaluatedInputArg.value_type != BSON_TYPE_ARRAY)
-	{
-		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION16883), errmsg(
-							"The $map operator requires an array input, but received %s instead",
-							BsonTypeName(
-								evaluatedInputArg.value_type)),
-						errdetail_log(
-							"The $map operator requires an array input, but received %s instead",
-							BsonTypeName(evaluatedInputArg.value_type))));
-	}
-
-	StringView aliasName = {
-		.string = mapArguments->as.value.value.v_utf8.str,
-		.length = mapArguments->as.value.value.v_utf8.len,
-	};
-
 	pgbson_element_writer *resultWriter = ExpressionResultGetElementWriter(
 		expressionResult);
 	pgbson_array_writer arrayWriter;
 	PgbsonElementWriterStartArray(resultWriter, &arrayWriter);
 
-	bson_iter_t arrayIter;
-	BsonValueInitIterator(&evaluatedInputArg, &arrayIter);
-
-	const bson_value_t nullValue = {
-		.value_type = BSON_TYPE_NULL
-	};
-
-	while (bson_iter_next(&arrayIter))
-	{
-		const bson_value_t *currentElem = bson_iter_value(&arrayIter);
-
-		ExpressionResult elementExpression = ExpressionResultCreateChild(
-			&childExpression);
-		ExpressionResultSetConstantVariable(&childExpression, &aliasName, currentElem);
-		EvaluateAggregationExpressionData(&mapArguments->in, doc, &elementExpression,
-										  isNullOnEmpty);
-		if (IsExpressionResultNullOrUndefined(&elementExpression.value))
-		{
-			PgbsonArrayWriterWriteValue(&arrayWriter, &nullValue);
-		}
-		else
-		{
-			PgbsonArrayWriterWriteValue(&arrayWriter, &elementExpression.value);
-		}
-	}
+	EnumerateDollarMapElements(mapArguments, doc, &childExpression, &evaluatedInputArg,
+							   WriteArrayElement, &arrayWriter);
 
 	PgbsonElementWriterEndArray(resultWriter, &arrayWriter);
 	ExpressionResultSetValueFromWriter(expressionResult);
@@ -2794,16 +2831,50 @@ HandlePreParsedDollarArrayElemAtCore(pgbson *doc, void *argument,
 	bool isNullOnEmpty = false;
 	ExpressionResult childResult = ExpressionResultCreateChild(expressionResult);
 
-	AggregationExpressionData *parsedArray = list_nth(arguments, 0);
-	EvaluateAggregationExpressionData(parsedArray, doc, &childResult, isNullOnEmpty);
-	bson_value_t arrayValue = childResult.value;
-
-	ExpressionResultReset(&childResult);
-
 	AggregationExpressionData *parsedIndex = list_nth(arguments, 1);
 	EvaluateAggregationExpressionData(parsedIndex, doc, &childResult, isNullOnEmpty);
 	bson_value_t indexValue = childResult.value;
 
+	ExpressionResultReset(&childResult);
+
+	/*
+	 * An element at a non-negative index of a $filter or $map is evaluated
+	 * without evaluating the elements after it.
+	 */
+	AggregationExpressionData *parsedArray = list_nth(arguments, 0);
+	bool checkFixedInteger = true;
+	if (IsLazyArrayExpression(parsedArray) &&
+		BsonTypeIsNumber(indexValue.value_type) &&
+		IsBsonValue32BitInteger(&indexValue, checkFixedInteger) &&
+		BsonValueAsInt32(&indexValue) >= 0)
+	{
+		LazyArrayVisitState visitState = {
+			.count = 0,
+			.limit = BsonValueAsInt32(&indexValue) + 1,
+			.found = false
+		};
+		bool isNull = false;
+		if (TryEnumerateArrayExpressionLazily(parsedArray, doc, &childResult,
+											  FindArrayElementAtIndex, &visitState,
+											  &isNull))
+		{
+			if (isNull)
+			{
+				bson_value_t nullValue = { .value_type = BSON_TYPE_NULL };
+				ExpressionResultSetValue(expressionResult, &nullValue);
+			}
+			else if (visitState.found)
+			{
+				ExpressionResultSetValue(expressionResult, &visitState.element);
+			}
+
+			return;
+		}
+	}
+
+	EvaluateAggregationExpressionData(parsedArray, doc, &childResult, isNullOnEmpty);
+	bson_value_t arrayValue = childResult.value;
+
 	ArrayElemAtArgumentState state;
 	memset(&state, 0, sizeof(ArrayElemAtArgumentState));
 
@@ -2821,6 +2892,317 @@ HandlePreParsedDollarArrayElemAtCore(pgbson *doc, void *argument,
 }
 
 
+/*
+ * Evaluates the limit and the input of a $filter expression. Returns false if
+ * the input is null or undefined (the result of the $filter is then null).
+ */
+static bool
+EvaluateDollarFilterInput(DollarFilterArguments *filterArguments, pgbson *doc,
+						  ExpressionResult *childExpression, bson_value_t *inputArray,
+						  int32_t *limit)
+{
+	bool isNullOnEmpty = false;
+	EvaluateAggregationExpressionData(&filterArguments->limit, doc, childExpression,
+									  isNullOnEmpty);
+
+	bson_value_t evaluatedLimit = childExpression->value;
+	if (IsExpressionResultNullOrUndefined(&evaluatedLimit))
+	{
+		*limit = INT32_MAX;
+	}
+	else
+	{
+		bool checkFixedInteger = true;
+		if (!IsBsonValue32BitInteger(&evaluatedLimit, checkFixedInteger))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION327391), errmsg(
+								"Operator $filter requires the limit to be specified as a 32-bit integer value: %s",
+								BsonValueToJsonForLogging(&evaluatedLimit)),
+							errdetail_log(
+								"The operator $filter has a limit of type %s that cannot be expressed as a 32-bit integer value.",
+								BsonTypeName(evaluatedLimit.value_type))));
+		}
+
+		*limit = BsonValueAsInt32(&evaluatedLimit);
+		if (*limit < 1)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION327392), errmsg(
+								"$filter: limit value must be strictly greater than zero: %d",
+								*limit)));
+		}
+	}
+
+	ExpressionResultReset(childExpression);
+	EvaluateAggregationExpressionData(&filterArguments->input, doc, childExpression,
+									  isNullOnEmpty);
+
+	*inputArray = childExpression->value;
+	if (IsExpressionResultNullOrUndefined(inputArray))
+	{
+		return false;
+	}
+
+	if (inputArray->value_type != BSON_TYPE_ARRAY)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION28651), errmsg(
+							"Expected 'array' type as input to $filter but found '%s' type",
+							BsonTypeName(
+								inputArray->value_type)),
+						errdetail_log(
+							"Expected 'array' type as input to $filter but found '%s' type",
+							BsonTypeName(inputArray->value_type))));
+	}
+
+	return true;
+}
+
+
+/*
+ * Calls visitFunc with each element of the input array of a $filter that
+ * matches its condition, up to its limit or until visitFunc returns false.
+ * We evalute the condition with every element of the input array and filter
+ * elements when the expression evaluates to false.
+ */
+static void
+EnumerateDollarFilterElements(DollarFilterArguments *filterArguments, pgbson *doc,
+							  ExpressionResult *childExpression,
+							  const bson_value_t *inputArray, int32_t limit,
+							  VisitArrayElementFunc visitFunc, void *visitState)
+{
+	bool isNullOnEmpty = false;
+	StringView aliasName = {
+		.string = filterArguments->alias.value.value.v_utf8.str,
+		.length = filterArguments->alias.value.value.v_utf8.len,
+	};
+
+	bson_iter_t arrayIter;
+	BsonValueInitIterator(inputArray, &arrayIter);
+
+	while (limit > 0 && bson_iter_next(&arrayIter))
+	{
+		const bson_value_t *currentElem = bson_iter_value(&arrayIter);
+
+		ExpressionResultReset(childExpression);
+		ExpressionResultSetConstantVariable(childExpression, &aliasName, currentElem);
+		EvaluateAggregationExpressionData(&filterArguments->cond, doc, childExpression,
+										  isNullOnEmpty);
+
+		if (BsonValueAsBool(&childExpression->value))
+		{
+			limit--;
+			if (!visitFunc(currentElem, visitState))
+			{
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+ * Evaluates the input of a $map expression. Returns false if the input is
+ * null or undefined (the result of the $map is then null).
+ */
+static bool
+EvaluateDollarMapInput(DollarMapArguments *mapArguments, pgbson *doc,
+					   ExpressionResult *childExpression, bson_value_t *inputArray)
+{
+	bool isNullOnEmpty = false;
+	EvaluateAggregationExpressionData(&mapArguments->input, doc, childExpression,
+									  isNullOnEmpty);
+
+	*inputArray = childExpression->value;
+	if (IsExpressionResultNullOrUndefined(inputArray))
+	{
+		return false;
+	}
+
+	if (inputArray->value_type != BSON_TYPE_ARRAY)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_LOCATION16883), errmsg(
+							"The $map operator requires an array input, but received %s instead",
+							BsonTypeName(
+								inputArray->value_type)),
+						errdetail_log(
+							"The $map operator requires an array input, but received %s instead",
+							BsonTypeName(inputArray->value_type))));
+	}
+
+	return true;
+}
+
+
+/*
+ * Calls visitFunc with the result of the 'in' expression of a $map for each
+ * element of its input array, until visitFunc returns false.
+ */
+static void
+EnumerateDollarMapElements(DollarMapArguments *mapArguments, pgbson *doc,
+						   ExpressionResult *childExpression,
+						   const bson_value_t *inputArray,
+						   VisitArrayElementFunc visitFunc, void *visitState)
+{
+	bool isNullOnEmpty = false;
+	StringView aliasName = {
+		.string = mapArguments->as.value.value.v_utf8.str,
+		.length = mapArguments->as.value.value.v_utf8.len,
+	};
+
+	bson_iter_t arrayIter;
+	BsonValueInitIterator(inputArray, &arrayIter);
+
+	const bson_value_t nullValue = {
+		.value_type = BSON_TYPE_NULL
+	};
+
+	while (bson_iter_next(&arrayIter))
+	{
+		const bson_value_t *currentElem = bson_iter_value(&arrayIter);
+
+		ExpressionResult elementExpression = ExpressionResultCreateChild(
+			childExpression);
+		ExpressionResultSetConstantVariable(childExpression, &aliasName, currentElem);
+		EvaluateAggregationExpressionData(&mapArguments->in, doc, &elementExpression,
+										  isNullOnEmpty);
+
+		const bson_value_t *mappedElem =
+			IsExpressionResultNullOrUndefined(&elementExpression.value) ?
+			&nullValue : &elementExpression.value;
+		if (!visitFunc(mappedElem, visitState))
+		{
+			break;
+		}
+	}
+}
+
+
+/*
+ * If the array expression is a $filter or a $map, evaluates its elements one at
+ * a time into visitFunc without building the array, so that consumers such as
+ * $size, $arrayElemAt or $in only evaluate (and never copy) the elements they
+ * need. Sets isNull if the result of the expression is null.
+ *
+ * Returns false if the expression can't be evaluated lazily, in which case the
+ * caller evaluates it as usual.
+ */
+static bool
+TryEnumerateArrayExpressionLazily(const AggregationExpressionData *data, pgbson *doc,
+								  ExpressionResult *expressionResult,
+								  VisitArrayElementFunc visitFunc, void *visitState,
+								  bool *isNull)
+{
+	if (!IsLazyArrayExpression(data))
+	{
+		return false;
+	}
+
+	ExpressionResult childExpression = ExpressionResultCreateChild(expressionResult);
+	bson_value_t inputArray;
+	if (data->operator.handleExpressionFunc == HandlePreParsedDollarFilter)
+	{
+		DollarFilterArguments *filterArguments = data->operator.arguments;
+		int32_t limit;
+		*isNull = !EvaluateDollarFilterInput(filterArguments, doc, &childExpression,
+											 &inputArray, &limit);
+		if (!*isNull)
+		{
+			EnumerateDollarFilterElements(filterArguments, doc, &childExpression,
+										  &inputArray, limit, visitFunc, visitState);
+		}
+
+		return true;
+	}
+	else if (data->operator.handleExpressionFunc == HandlePreParsedDollarMap)
+	{
+		DollarMapArguments *mapArguments = data->operator.arguments;
+		*isNull = !EvaluateDollarMapInput(mapArguments, doc, &childExpression,
+										  &inputArray);
+		if (!*isNull)
+		{
+			EnumerateDollarMapElements(mapArguments, doc, &childExpression,
+									   &inputArray, visitFunc, visitState);
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/* Whether the array expression is one that TryEnumerateArrayExpressionLazily evaluates lazily. */
+static bool
+IsLazyArrayExpression(const AggregationExpressionData *data)
+{
+	return data->kind == AggregationExpressionKind_Operator &&
+		   (data->operator.handleExpressionFunc == HandlePreParsedDollarFilter ||
+			data->operator.handleExpressionFunc == HandlePreParsedDollarMap);
+}
+
+
+/* Element visitor that writes the elements into the given array writer. */
+static bool
+WriteArrayElement(const bson_value_t *element, void *state)
+{
+	PgbsonArrayWriterWriteValue((pgbson_array_writer *) state, element);
+	return true;
+}
+
+
+/* Element visitor of $size: counts the elements. */
+static bool
+CountArrayElement(const bson_value_t *element, void *state)
+{
+	LazyArrayVisitState *visitState = state;
+	visitState->count++;
+	return true;
+}
+
+
+/* Element visitor of $arrayElemAt and $first: stops at the element at index limit - 1. */
+static bool
+FindArrayElementAtIndex(const bson_value_t *element, void *state)
+{
+	LazyArrayVisitState *visitState = state;
+	visitState->count++;
+	if (visitState->count == visitState->limit)
+	{
+		visitState->element = *element;
+		visitState->found = true;
+		return false;
+	}
+
+	return true;
+}
+
+
+/* Element visitor of $in: stops at the first element that matches the value to find. */
+static bool
+FindDollarInElement(const bson_value_t *element, void *state)
+{
+	LazyArrayVisitState *visitState = state;
+	visitState->found = IsDollarInMatch(visitState->targetValue, element,
+										visitState->collationString);
+	return !visitState->found;
+}
+
+
+/* Element visitor of $slice: writes up to limit elements. */
+static bool
+WriteDollarSliceElement(const bson_value_t *element, void *state)
+{
+	LazyArrayVisitState *visitState = state;
+	if (visitState->count >= visitState->limit)
+	{
+		return false;
+	}
+
+	PgbsonArrayWriterWriteValue(visitState->arrayWriter, element);
+	visitState->count++;
+	return visitState->count < visitState->limit;
+}
+
+
 /* --------------------------------------------------------- */
 /* Process operator helper functions */
 /* --------------------------------------------------------- */
@@ -2854,20 +3236,7 @@ ProcessDollarIn(bson_value_t *targetValue, const bson_value_t *searchArray,
 	while (bson_iter_next(&arrayIterator))
 	{
 		const bson_value_t *currentValue = bson_iter_value(&arrayIterator);
-
-		if (targetValue->value_type == BSON_TYPE_NULL &&
-			currentValue->value_type == BSON_TYPE_NULL)
-		{
-			found = true;
-			break;
-		}
-
-		bool isComparisonValid = false;
-		int cmp = CompareBsonValueAndTypeWithCollation(targetValue, currentValue,
-													   &isComparisonValid,
-													   collationString);
-
-		if (cmp == 0 && isComparisonValid)
+		if (IsDollarInMatch(targetValue, currentValue, collationString))
 		{
 			found = true;
 			break;
@@ -2879,6 +3248,25 @@ ProcessDollarIn(bson_value_t *targetValue, const bson_value_t *searchArray,
 }
 
 
+/* Whether an element of the array searched by $in matches the value to find. */
+static bool
+IsDollarInMatch(const bson_value_t *targetValue, const bson_value_t *currentValue,
+				const char *collationString)
+{
+	if (targetValue->value_type == BSON_TYPE_NULL &&
+		currentValue->value_type == BSON_TYPE_NULL)
+	{
+		return true;
+	}
+
+	bool isComparisonValid = false;
+	int cmp = CompareBsonValueAndTypeWithCollation(targetValue, currentValue,
+												   &isComparisonValid,
+												   collationString);
+	return cmp == 0 && isComparisonValid;
+}
+
+
 /* Process the $slice operator and save the sliced array into result */
 static void
 ProcessDollarSlice(void *state, bson_value_t *result)
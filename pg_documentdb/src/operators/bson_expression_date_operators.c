@@ -427,6 +427,33 @@ static const int QuartersPerYear = 4;
 static const int MonthsPerQuarter = 3;
 static const int MaxMinsRepresentedByUTCOffset = 6039;
 
+/*
+ * A window of time during which a timezone has a fixed UTC offset, i.e. the
+ * time between two of its transitions.
+ */
+typedef struct TimezoneOffsetWindow
+{
+	/* The timezone the window is for */
+	const pg_tz *pgTimezone;
+
+	/* The start (inclusive) and end (exclusive) of the window, in seconds since the Unix epoch */
+	pg_time_t windowStart;
+	pg_time_t windowEnd;
+
+	/* The UTC offset during the window, in seconds */
+	long int utcOffsetInSeconds;
+} TimezoneOffsetWindow;
+
+/*
+ * The most recently used offset window of each timezone: Values from the same
+ * window (e.g. dates that don't cross a DST change) resolve their UTC offset
+ * without looking up the timezone transitions.
+ */
+#define TIMEZONE_OFFSET_WINDOW_CACHE_SIZE 16
+static TimezoneOffsetWindow TimezoneOffsetWindowCache[TIMEZONE_OFFSET_WINDOW_CACHE_SIZE];
+
+extern bool EnableTimezoneOffsetWindowCache;
+
 /* --------------------------------------------------------- */
 /* Forward declaration */
 /* --------------------------------------------------------- */
@@ -520,6 +547,9 @@ static void ParseInputForDollarDateAddSubtract(const bson_value_t *inputArgument
 											   bson_value_t *amount,
 											   bson_value_t *timezone);
 static ExtensionTimezone ParseTimezone(StringView timezone);
+static bool TryGetUtcOffsetInSecondsForTimezone(int64_t epochInMs,
+												ExtensionTimezone timezone,
+												long int *utcOffsetInSeconds);
 static int64_t ParseUtcOffset(StringView offset);
 static inline void ParseUtcOffsetForDateString(char *dateString, int sizeOfDateString,
 											   int *indexOfDateStringIter,
@@ -2688,6 +2718,14 @@ GetPgTimestampFromEpochWithTimezone(int64_t epochInMs, ExtensionTimezone timezon
 		return GetPgTimestampFromUnixEpoch(epochInMs);
 	}
 
+	long int utcOffsetInSeconds;
+	if (EnableTimezoneOffsetWindowCache && timezone.pgTimezone != NULL &&
+		TryGetUtcOffsetInSecondsForTimezone(epochInMs, timezone, &utcOffsetInSeconds))
+	{
+		/* The local time is the UTC time shifted by the offset in effect at that time */
+		epochInMs += (int64_t) utcOffsetInSeconds * MILLISECONDS_IN_SECOND;
+		return GetPgTimestampFromUnixEpoch(epochInMs);
+	}
 
 	return OidFunctionCall2(PostgresTimestampToZoneFunctionId(),
 							CStringGetTextDatum(timezone.id),
@@ -2720,7 +2758,7 @@ GetPgTimestampFromEpochWithoutTimezone(int64_t epochInMs, ExtensionTimezone time
 static ExtensionTimezone
 ParseTimezone(StringView timezone)
 {
-	ExtensionTimezone result;
+	ExtensionTimezone result = { 0 };
 	if (timezone.length == 0 || timezone.string == NULL)
 	{
 		ThrowInvalidTimezoneIdentifier(timezone.string);
@@ -2756,13 +2794,15 @@ ParseTimezone(StringView timezone)
 		 * It doesn't matter that we're loading the TZ to validate if it exists,
 		 * as if it does, we are going to use it anyways and it will be in the cache already.
 		 */
-		if (isOffset || !pg_tzset(timezone.string))
+		pg_tz *pgTimezone = isOffset ? NULL : pg_tzset(timezone.string);
+		if (pgTimezone == NULL)
 		{
 			ThrowInvalidTimezoneIdentifier(timezone.string);
 		}
 
 		result.id = timezone.string;
 		result.isUtcOffset = false;
+		result.pgTimezone = pgTimezone;
 	}
 
 	return result;
@@ -2783,6 +2823,13 @@ DetermineUtcOffsetForEpochWithTimezone(int64_t epochInMs, ExtensionTimezone time
 		return timezone.offsetInMs / MILLISECONDS_IN_SECOND / SECONDS_IN_MINUTE;
 	}
 
+	long int utcOffsetInSeconds;
+	if (EnableTimezoneOffsetWindowCache && timezone.pgTimezone != NULL &&
+		TryGetUtcOffsetInSecondsForTimezone(epochInMs, timezone, &utcOffsetInSeconds))
+	{
+		return utcOffsetInSeconds / SECONDS_IN_MINUTE;
+	}
+
 	pg_tz *pgTz = pg_tzset(timezone.id);
 
 	/* Should not be null, we should've already validated the timezone identifier. */
@@ -2797,6 +2844,74 @@ DetermineUtcOffsetForEpochWithTimezone(int64_t epochInMs, ExtensionTimezone time
 }
 
 
+/*
+ * Gets the UTC offset in seconds of the timezone identifier at the given time.
+ * The offset window the time falls in is cached per timezone, so that the
+ * transitions are only looked up when a value falls outside of the window.
+ * Returns false if the offset can't be determined for the time (e.g. it is out
+ * of the range of the timezone library), in which case callers use the postgres
+ * timezone functions that report the error.
+ * This method assumes the timezone was resolved by the ParseTimezone method.
+ */
+static bool
+TryGetUtcOffsetInSecondsForTimezone(int64_t epochInMs, ExtensionTimezone timezone,
+									long int *utcOffsetInSeconds)
+{
+	/* Same conversion to pg_time_t as the postgres timezone functions */
+	TimestampTz timestampTz = DatumGetTimestampTz(GetPgTimestampFromUnixEpoch(epochInMs));
+	pg_time_t time = timestamptz_to_time_t(timestampTz);
+
+	const pg_tz *pgTimezone = timezone.pgTimezone;
+	TimezoneOffsetWindow *window =
+		&TimezoneOffsetWindowCache[((uintptr_t) pgTimezone >> 4) %
+								   TIMEZONE_OFFSET_WINDOW_CACHE_SIZE];
+	if (window->pgTimezone == pgTimezone && time >= window->windowStart &&
+		time < window->windowEnd)
+	{
+		*utcOffsetInSeconds = window->utcOffsetInSeconds;
+		return true;
+	}
+
+	long int beforeOffset;
+	int beforeIsDst;
+	pg_time_t boundary;
+	long int afterOffset;
+	int afterIsDst;
+	int result = pg_next_dst_boundary(&time, &beforeOffset, &beforeIsDst, &boundary,
+									  &afterOffset, &afterIsDst, pgTimezone);
+	if (result < 0)
+	{
+		/* The transitions could not be determined: Compute the offset for this time only */
+		struct pg_tm *pgLocalTime = pg_localtime(&time, pgTimezone);
+		if (pgLocalTime == NULL)
+		{
+			return false;
+		}
+
+		*utcOffsetInSeconds = pgLocalTime->tm_gmtoff;
+		return true;
+	}
+
+	pg_time_t windowEnd = result == 0 ? PG_INT64_MAX : boundary;
+	if (window->pgTimezone == pgTimezone && window->windowEnd == windowEnd &&
+		time < window->windowStart)
+	{
+		/* Same window as the cached one, extend it back to this time */
+		window->windowStart = time;
+	}
+	else
+	{
+		window->pgTimezone = pgTimezone;
+		window->windowStart = time;
+		window->windowEnd = windowEnd;
+		window->utcOffsetInSeconds = beforeOffset;
+	}
+
+	*utcOffsetInSeconds = beforeOffset;
+	return true;
+}
+
+
 /* Given a UTC offset string following valid offset formats, returns the offset difference in milliseconds.
  * Throws for non valid UTC offsets. */
 static int64_t
@@ -25,6 +25,7 @@
 /* Type definitions */
 /* --------------------------------------------------------- */
 typedef void (*ProcessSetDualOperands)(void *state, const char *collationString,
+									   HTAB *secondArgumentSet,
 									   bson_value_t *result);
 typedef bool (*ProcessSetVariableOperands)(const bson_value_t *currentValue,
 										   void *state,
@@ -62,6 +63,12 @@ typedef struct BinarySetOperatorState
 
 	/* collation string for comparison, if any */
 	char *collationString;
+
+	/*
+	 * The set of the elements of the second operand when it is a constant array,
+	 * built once at parse time and probed by each evaluation. NULL otherwise.
+	 */
+	HTAB *secondValueSet;
 } BinarySetOperatorState;
 
 /*
@@ -122,9 +129,12 @@ static bool ProcessDollarSetEqualsElement(const bson_value_t *currentValue, void
 										  isFieldPathExpression);
 static void ProcessDollarSetEqualsResult(void *state, bson_value_t *result);
 static void ProcessDollarSetDifference(void *state, const char *collationString,
+									   HTAB *secondArgumentSet,
 									   bson_value_t *result);
 static void ProcessDollarSetIsSubset(void *state, const char *collationString,
+									 HTAB *secondArgumentSet,
 									 bson_value_t *result);
+static HTAB * CreateSetFromArray(const bson_value_t *array, const char *collationString);
 static void ProcessSetElement(const bson_value_t *currentValue,
 							  DollarSetOperatorState *state);
 static bool ProcessDollarAllOrAnyElementsTrue(const bson_value_t *currentValue,
@@ -530,7 +540,8 @@ ParseSetDualOperands(const bson_value_t *argument,
 
 		const char *collationString = IsCollationApplicable(context->collationString) ?
 									  context->collationString : NULL;
-		processOperatorFunc(&state, collationString, &data->value);
+		HTAB *secondArgumentSet = NULL;
+		processOperatorFunc(&state, collationString, secondArgumentSet, &data->value);
 
 		data->kind = AggregationExpressionKind_Constant;
 		list_free_deep(arguments);
@@ -547,6 +558,18 @@ ParseSetDualOperands(const bson_value_t *argument,
 			binarySetOperatorState->collationString = pstrdup(context->collationString);
 		}
 
+		/*
+		 * The second operand is the set that the first one is probed against:
+		 * when it is a constant (e.g. a list of allowed roles), hash it once for
+		 * all the documents rather than on every evaluation.
+		 */
+		if (IsAggregationExpressionConstant(secondArg) &&
+			secondArg->value.value_type == BSON_TYPE_ARRAY)
+		{
+			binarySetOperatorState->secondValueSet = CreateSetFromArray(
+				&secondArg->value, binarySetOperatorState->collationString);
+		}
+
 		data->operator.arguments = binarySetOperatorState;
 		data->operator.argumentsKind = AggregationExpressionArgumentsKind_Palloc;
 	}
@@ -583,7 +606,8 @@ HandlePreParsedSetDualOperands(pgbson *doc, void *arguments,
 
 	InitializeDualArgumentExpressionState(firstValue, secondValue, hasFieldExpression,
 										  &state);
-	processOperatorFunc(&state, operatorState->collationString, result);
+	processOperatorFunc(&state, operatorState->collationString,
+						operatorState->secondValueSet, result);
 
 	ExpressionResultSetValue(expressionResult, result);
 }
@@ -861,7 +885,8 @@ ProcessDollarSetEqualsResult(void *state, bson_value_t *result)
 
 /* Function that validates the final state before returning the result for $setDifference. */
 static void
-ProcessDollarSetDifference(void *state, const char *collationString, bson_value_t *result)
+ProcessDollarSetDifference(void *state, const char *collationString,
+						   HTAB *secondArgumentSet, bson_value_t *result)
 {
 	DualArgumentExpressionState *context = (DualArgumentExpressionState *) state;
 
@@ -885,16 +910,23 @@ ProcessDollarSetDifference(void *state, const char *collationString, bson_value_
 							BsonTypeName(context->secondArgument.value_type))));
 	}
 
-	DollarSetOperatorState setDifferenceState =
+	/*
+	 * The elements of the second set, and the elements of the first one already
+	 * written (to skip their duplicates). The set of a constant second operand is
+	 * shared across evaluations, so the latter are kept apart from it.
+	 */
+	HTAB *secondSet;
+	HTAB *writtenSet;
+	if (secondArgumentSet != NULL)
 	{
-		.arrayCount = 0,
-		.isMatchWithPreviousSet = true,
-		.arrayElementsHashTable = CreateBsonValueWithCollationHashSet(
-			BsonValueHashEntryExtraDataSize),
-		.collationString = collationString
-	};
-
-	ProcessSetElement(&context->secondArgument, &setDifferenceState);
+		secondSet = secondArgumentSet;
+		writtenSet = CreateBsonValueWithCollationHashSet(BsonValueHashEntryExtraDataSize);
+	}
+	else
+	{
+		secondSet = CreateSetFromArray(&context->secondArgument, collationString);
+		writtenSet = secondSet;
+	}
 
 	bson_iter_t arrayIterator;
 	BsonValueInitIterator(&context->firstArgument, &arrayIterator);
@@ -912,11 +944,15 @@ ProcessDollarSetDifference(void *state, const char *collationString, bson_value_
 		};
 
 		bool found = false;
+		if (secondSet != writtenSet)
+		{
+			hash_search(secondSet, &elementToFind, HASH_FIND, &found);
+		}
 
-		hash_search(setDifferenceState.arrayElementsHashTable,
-					&elementToFind,
-					HASH_ENTER,
-					&found);
+		if (!found)
+		{
+			hash_search(writtenSet, &elementToFind, HASH_ENTER, &found);
+		}
 
 		if (!found)
 		{
@@ -925,14 +961,15 @@ ProcessDollarSetDifference(void *state, const char *collationString, bson_value_
 	}
 
 	PgbsonWriterEndArray(&writer, &arrayWriter);
-	hash_destroy(setDifferenceState.arrayElementsHashTable);
+	hash_destroy(writtenSet);
 	*result = PgbsonArrayWriterGetValue(&arrayWriter);
 }
 
 
 /* Function that validates the final state before returning the result for $setIsSubset. */
 static void
-ProcessDollarSetIsSubset(void *state, const char *collationString, bson_value_t *result)
+ProcessDollarSetIsSubset(void *state, const char *collationString,
+						 HTAB *secondArgumentSet, bson_value_t *result)
 {
 	DualArgumentExpressionState *context = (DualArgumentExpressionState *) state;
 
@@ -961,16 +998,8 @@ ProcessDollarSetIsSubset(void *state, const char *collationString, bson_value_t
 							BsonTypeName(context->secondArgument.value_type))));
 	}
 
-	DollarSetOperatorState setIsSubsetState =
-	{
-		.arrayCount = 0,
-		.isMatchWithPreviousSet = true,
-		.arrayElementsHashTable = CreateBsonValueWithCollationHashSet(
-			BsonValueHashEntryExtraDataSize),
-		.collationString = collationString
-	};
-
-	ProcessSetElement(&context->secondArgument, &setIsSubsetState);
+	HTAB *secondSet = secondArgumentSet != NULL ? secondArgumentSet :
+					  CreateSetFromArray(&context->secondArgument, collationString);
 
 	bson_iter_t arrayIterator;
 	BsonValueInitIterator(&context->firstArgument, &arrayIterator);
@@ -985,10 +1014,7 @@ ProcessDollarSetIsSubset(void *state, const char *collationString, bson_value_t
 
 		bool found = false;
 
-		hash_search(setIsSubsetState.arrayElementsHashTable,
-					&elementToFind,
-					HASH_FIND,
-					&found);
+		hash_search(secondSet, &elementToFind, HASH_FIND, &found);
 
 		if (!found)
 		{
@@ -997,12 +1023,37 @@ ProcessDollarSetIsSubset(void *state, const char *collationString, bson_value_t
 		}
 	}
 
-	hash_destroy(setIsSubsetState.arrayElementsHashTable);
+	if (secondSet != secondArgumentSet)
+	{
+		hash_destroy(secondSet);
+	}
+
 	result->value_type = BSON_TYPE_BOOL;
 	result->value.v_bool = isSubset;
 }
 
 
+/*
+ * Creates the hash set of the elements of the given array, compared with the
+ * given collation (if any).
+ */
+static HTAB *
+CreateSetFromArray(const bson_value_t *array, const char *collationString)
+{
+	DollarSetOperatorState setState =
+	{
+		.arrayCount = 0,
+		.isMatchWithPreviousSet = true,
+		.arrayElementsHashTable = CreateBsonValueWithCollationHashSet(
+			BsonValueHashEntryExtraDataSize),
+		.collationString = collationString
+	};
+
+	ProcessSetElement(array, &setState);
+	return setState.arrayElementsHashTable;
+}
+
+
 /*
  * For the currentElement which is of type BSON_TYPE_ARRAY,
  * iterate through currentElement and add all unique elements hash table
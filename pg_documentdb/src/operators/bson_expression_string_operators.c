@@ -9,6 +9,7 @@
  */
 
 #include <postgres.h>
+#include <port/pg_bitutils.h>
 
 #include "io/bson_core.h"
 #include "query/bson_compare.h"
@@ -24,6 +25,12 @@
 
 #define MAX_REGEX_OUTPUT_BUFFER_SIZE (64 * 1024 * 1024)
 
+/* Masks used to process strings a machine word (8 bytes) at a time */
+#define WORD_BYTE_HIGH_BITS UINT64CONST(0x8080808080808080)
+#define WORD_BROADCAST_BYTE(byte) (UINT64CONST(0x0101010101010101) * (uint8) (byte))
+
+extern bool EnableAsciiStringFastPaths;
+
 /* --------------------------------------------------------- */
 /* Type definitions */
 /* --------------------------------------------------------- */
@@ -212,6 +219,9 @@ static inline bool BsonValueStringHasNullCharcter(const bson_value_t *element);
 static inline bool IsUtf8ContinuationByte(const char *utf8Str);
 static inline size_t Utf8CodePointCount(const bson_value_t *utf8Str);
 static inline void ConvertToLower(char *str, uint32_t len);
+static inline void ConvertToUpper(char *str, uint32_t len);
+static inline bool IsAsciiString(const char *str, uint32_t len);
+static inline uint32_t ConvertAsciiWordsCase(char *str, uint32_t len, char firstLetter);
 static inline int GetSubstringPosition(char *str, char *substr, int strLen,
 									   int subStrLen, int lastPost);
 static void ReplaceSubstring(bson_value_t *result, bson_value_t *find,
@@ -1639,16 +1649,8 @@ ProcessDollarToUpper(const bson_value_t *currentValue, bson_value_t *result)
 		case BSON_TYPE_UTF8:
 		{
 			result->value_type = BSON_TYPE_UTF8;
-			char *str = currentValue->value.v_utf8.str;
-			for (uint32_t currByte = 0; currByte < currentValue->value.v_utf8.len;
-				 currByte++)
-			{
-				if (islower(*str))
-				{
-					*str = 'A' + (*str - 'a');
-				}
-				str++;
-			}
+			ConvertToUpper(currentValue->value.v_utf8.str,
+						   currentValue->value.v_utf8.len);
 			result->value = currentValue->value;
 			break;
 		}
@@ -1706,6 +1708,25 @@ ProcessDollarSplit(void *state, bson_value_t *result)
 	uint32_t bytesToProcess = remainingStrLen;
 	while (remainingStrLen >= context->secondArgument.value.v_utf8.len)
 	{
+		if (EnableAsciiStringFastPaths)
+		{
+			/*
+			 * Skip directly to the next candidate position: memchr scans for the
+			 * first byte of the separator far faster than a memcmp per byte.
+			 */
+			const char *candidate = memchr(currPtr,
+										   context->secondArgument.value.v_utf8.str[0],
+										   remainingStrLen -
+										   context->secondArgument.value.v_utf8.len + 1);
+			if (candidate == NULL)
+			{
+				break;
+			}
+
+			remainingStrLen -= candidate - currPtr;
+			currPtr = candidate;
+		}
+
 		if (memcmp(currPtr, context->secondArgument.value.v_utf8.str,
 				   context->secondArgument.value.v_utf8.len) == 0)
 		{
@@ -1955,6 +1976,56 @@ ProcessDollarIndexOfCP(void *state, bson_value_t *result)
 	ProcessDollarIndexOfCore(context, isIndexOfBytesOp, &startIndex,
 							 &endIndex);
 
+	if (EnableAsciiStringFastPaths &&
+		IsAsciiString(context->firstArgument.value.v_utf8.str,
+					  context->firstArgument.value.v_utf8.len))
+	{
+		/*
+		 * Code points and bytes coincide for an ASCII string, so the search runs
+		 * over byte offsets. A non ASCII substring can never match in this case.
+		 */
+		int strLen = (int) context->firstArgument.value.v_utf8.len;
+		int subStrLen = (int) context->secondArgument.value.v_utf8.len;
+		if (endIndex == -1 || endIndex > strLen)
+		{
+			endIndex = strLen;
+		}
+
+		if (startIndex > endIndex ||
+			!IsAsciiString(context->secondArgument.value.v_utf8.str, subStrLen))
+		{
+			return;
+		}
+
+		const char *string = context->firstArgument.value.v_utf8.str;
+		for (int currIndex = startIndex; currIndex + subStrLen <= endIndex; currIndex++)
+		{
+			if (subStrLen == 0)
+			{
+				result->value.v_int32 = currIndex;
+				return;
+			}
+
+			const char *candidate = memchr(string + currIndex,
+										   context->secondArgument.value.v_utf8.str[0],
+										   endIndex - subStrLen - currIndex + 1);
+			if (candidate == NULL)
+			{
+				return;
+			}
+
+			currIndex = candidate - string;
+			if (memcmp(candidate, context->secondArgument.value.v_utf8.str,
+					   subStrLen) == 0)
+			{
+				result->value.v_int32 = currIndex;
+				return;
+			}
+		}
+
+		return;
+	}
+
 	if (endIndex == -1)
 	{
 		endIndex = Utf8CodePointCount(&context->firstArgument);
@@ -2387,7 +2458,29 @@ Utf8CodePointCount(const bson_value_t *utf8Str)
 {
 	char *str = utf8Str->value.v_utf8.str;
 	size_t codePointCount = 0;
-	for (uint32_t currByte = 0; currByte < utf8Str->value.v_utf8.len; currByte++)
+	uint32_t currByte = 0;
+
+	if (EnableAsciiStringFastPaths)
+	{
+		/*
+		 * Count the continuation bytes 8 at a time: A byte is a continuation
+		 * byte when its top bit is set and the bit below it is clear.
+		 */
+		size_t continuationBytes = 0;
+		for (; currByte + sizeof(uint64) <= utf8Str->value.v_utf8.len;
+			 currByte += sizeof(uint64))
+		{
+			uint64 word;
+			memcpy(&word, str, sizeof(uint64));
+			continuationBytes += pg_popcount64(word & ~(word << 1) &
+											   WORD_BYTE_HIGH_BITS);
+			str += sizeof(uint64);
+		}
+
+		codePointCount = currByte - continuationBytes;
+	}
+
+	for (; currByte < utf8Str->value.v_utf8.len; currByte++)
 	{
 		/* Increment the codePointCount if the current byte is not a UTF-8 continuation byte. */
 		codePointCount += !IsUtf8ContinuationByte(str++);
@@ -2425,7 +2518,14 @@ IsUtf8ContinuationByte(const char *utf8Str)
 static inline void
 ConvertToLower(char *str, uint32_t len)
 {
-	for (uint32_t currByte = 0; currByte < len; currByte++)
+	uint32_t currByte = 0;
+	if (EnableAsciiStringFastPaths)
+	{
+		currByte = ConvertAsciiWordsCase(str, len, 'A');
+		str += currByte;
+	}
+
+	for (; currByte < len; currByte++)
 	{
 		if (isupper(*str))
 		{
@@ -2436,6 +2536,95 @@ ConvertToLower(char *str, uint32_t len)
 }
 
 
+/**
+ * A common helper function to convert a given UTF-8 type string to upper.
+ * It operates only on lower case letters and converts them to upper case.
+ * @param str : string which needs to be iterated and converted to upper case.
+ * @param len : len in bytes of the given str
+ */
+static inline void
+ConvertToUpper(char *str, uint32_t len)
+{
+	uint32_t currByte = 0;
+	if (EnableAsciiStringFastPaths)
+	{
+		currByte = ConvertAsciiWordsCase(str, len, 'a');
+		str += currByte;
+	}
+
+	for (; currByte < len; currByte++)
+	{
+		if (islower(*str))
+		{
+			*str = 'A' + (*str - 'a');
+		}
+		str++;
+	}
+}
+
+
+/*
+ * Flips the case of the letters in the range [firstLetter, firstLetter + 25] of
+ * the given string a machine word at a time, stopping at the first word that
+ * has a non ASCII byte. Returns the number of bytes processed: the remainder
+ * is left to the caller's byte at a time loop.
+ */
+static inline uint32_t
+ConvertAsciiWordsCase(char *str, uint32_t len, char firstLetter)
+{
+	/*
+	 * For ASCII bytes (< 0x80) adding (0x80 - c) sets the high bit exactly when the
+	 * byte is >= c, and can not carry into the neighbouring byte.
+	 */
+	const uint64 aboveFirst = WORD_BROADCAST_BYTE(0x80 - firstLetter);
+	const uint64 aboveLast = WORD_BROADCAST_BYTE(0x80 - (firstLetter + 26));
+
+	uint32_t currByte = 0;
+	for (; currByte + sizeof(uint64) <= len; currByte += sizeof(uint64))
+	{
+		uint64 word;
+		memcpy(&word, str + currByte, sizeof(uint64));
+		if ((word & WORD_BYTE_HIGH_BITS) != 0)
+		{
+			break;
+		}
+
+		uint64 letters = (word + aboveFirst) & ~(word + aboveLast) & WORD_BYTE_HIGH_BITS;
+
+		/* 0x80 >> 2 is 0x20, the bit that differs between the two cases */
+		word ^= letters >> 2;
+		memcpy(str + currByte, &word, sizeof(uint64));
+	}
+
+	return currByte;
+}
+
+
+/*
+ * Checks whether the given string only consists of ASCII bytes, testing a
+ * machine word at a time.
+ */
+static inline bool
+IsAsciiString(const char *str, uint32_t len)
+{
+	uint32_t currByte = 0;
+	uint64 highBits = 0;
+	for (; currByte + sizeof(uint64) <= len; currByte += sizeof(uint64))
+	{
+		uint64 word;
+		memcpy(&word, str + currByte, sizeof(uint64));
+		highBits |= word;
+	}
+
+	for (; currByte < len; currByte++)
+	{
+		highBits |= (uint8) str[currByte];
+	}
+
+	return (highBits & WORD_BYTE_HIGH_BITS) == 0;
+}
+
+
 /*
  * The function allocates memory for a new StringView object and populates the stringview by using a bson_value
  * that is expected to be of type BSON_TYPE_UTF8.
@@ -2595,6 +2784,23 @@ ProcessDollarSubstrCP(void *state, bson_value_t *result)
 							)));
 	}
 
+	if (EnableAsciiStringFastPaths &&
+		IsAsciiString(result->value.v_utf8.str, result->value.v_utf8.len))
+	{
+		/* Code points and bytes coincide, so slice the string directly */
+		if ((uint32_t) offset >= result->value.v_utf8.len)
+		{
+			result->value.v_utf8.str = "";
+			result->value.v_utf8.len = 0;
+			return;
+		}
+
+		result->value.v_utf8.str += offset;
+		result->value.v_utf8.len = Min((uint32_t) length,
+									   result->value.v_utf8.len - offset);
+		return;
+	}
+
 	int64_t cpCount = Utf8CodePointCount(result);
 	int64_t remainingCPCount = cpCount - offset;
 	if (remainingCPCount <= 0)
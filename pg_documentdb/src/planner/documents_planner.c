@@ -16,10 +16,13 @@
 
 #include <catalog/pg_am.h>
 #include <catalog/pg_class.h>
+#include <catalog/pg_index.h>
 #include <catalog/pg_opfamily.h>
+#include <catalog/pg_proc.h>
 #include <storage/lmgr.h>
 #include <optimizer/planner.h>
 #include "optimizer/pathnode.h"
+#include <optimizer/cost.h>
 #include <nodes/nodes.h>
 #include <nodes/makefuncs.h>
 #include <nodes/nodeFuncs.h>
@@ -29,6 +32,7 @@
 #include <storage/lockdefs.h>
 #include <tcop/utility.h>
 #include <utils/builtins.h>
+#include <utils/index_selfuncs.h>
 #include <utils/lsyscache.h>
 #include <utils/syscache.h>
 #include <executor/spi.h>
@@ -37,6 +41,7 @@
 #include "geospatial/bson_geospatial_geonear.h"
 #include "metadata/collection.h"
 #include "metadata/metadata_cache.h"
+#include "metadata/relation_utils.h"
 #include "planner/documentdb_planner.h"
 #include "query/query_operator.h"
 #include "opclass/bson_index_support.h"
@@ -46,6 +51,7 @@
 #include "customscan/bson_custom_query_scan.h"
 #include "opclass/bson_text_gin.h"
 #include "aggregation/bson_aggregation_pipeline.h"
+#include "operators/bson_expression.h"
 #include "utils/query_utils.h"
 #include "api_hooks.h"
 #include "query/bson_compare.h"
@@ -101,6 +107,7 @@ typedef struct DocumentDbQueryFlagsState
 static bool DocumentDbQueryFlagsWalker(Node *node, DocumentDbQueryFlagsState *queryFlags);
 static int DocumentDbQueryFlags(Query *query);
 static bool IsReadWriteCommand(Query *query);
+static bool IsInsertSelectQuery(Query *query);
 static Query * ReplaceDocumentDbCollectionFunction(Query *query, ParamListInfo
 												   boundParams,
 												   bool *isNonExistentCollection);
@@ -139,11 +146,18 @@ extern bool EnableIndexPriorityOrdering;
 extern bool EnableLogRelationIndexesOrder;
 extern bool ForceBitmapScanForLookup;
 extern bool EnableIndexOnlyScan;
+extern bool EnableGroupHashAggregation;
+extern bool EnableLookupMemoizedJoin;
+extern bool EnableAdaptiveIndexScan;
+extern bool EnableClusteredCollections;
+extern bool EnableOutInsertSelect;
 
 planner_hook_type ExtensionPreviousPlannerHook = NULL;
 set_rel_pathlist_hook_type ExtensionPreviousSetRelPathlistHook = NULL;
 explain_get_index_name_hook_type ExtensionPreviousIndexNameHook = NULL;
 get_relation_info_hook_type ExtensionPreviousGetRelationInfoHook = NULL;
+create_upper_paths_hook_type ExtensionPreviousCreateUpperPathsHook = NULL;
+set_join_pathlist_hook_type ExtensionPreviousSetJoinPathlistHook = NULL;
 
 
 /*
@@ -204,7 +218,8 @@ DocumentDBApiPlanner(Query *parse, const char *queryString, int cursorOptions,
 			ThrowIfWriteCommandNotAllowed();
 		}
 
-		if (parse->commandType != CMD_INSERT)
+		if (parse->commandType != CMD_INSERT ||
+			(EnableOutInsertSelect && IsInsertSelectQuery(parse)))
 		{
 			queryFlags = DocumentDbQueryFlags(parse);
 		}
@@ -838,6 +853,13 @@ ExtensionRelPathlistHookCoreLegacy(PlannerInfo *root, RelOptInfo *rel, Index rti
 			AddExtensionQueryScanForTextQuery(root, rel, rte, textIndexData);
 		}
 	}
+	else if (EnableAdaptiveIndexScan && !updatedPaths && !ForceDisableSeqScan &&
+			 indexContext.forceIndexQueryOpData.type == ForceIndexOpType_None &&
+			 indexContext.primaryKeyLookupPath == NULL)
+	{
+		/* Guard index scans against misestimates by letting them fall back to a seqscan */
+		AddExtensionQueryScanForAdaptiveScan(root, rel, rte);
+	}
 
 	if (EnableExtendedExplainPlans)
 	{
@@ -948,6 +970,13 @@ ExtensionRelPathlistHookCoreNew(PlannerInfo *root, RelOptInfo *rel, Index rti,
 			AddExtensionQueryScanForTextQuery(root, rel, rte, textIndexData);
 		}
 	}
+	else if (EnableAdaptiveIndexScan && !updatedPaths && !ForceDisableSeqScan &&
+			 indexContext.forceIndexQueryOpData.type == ForceIndexOpType_None &&
+			 indexContext.primaryKeyLookupPath == NULL)
+	{
+		/* Guard index scans against misestimates by letting them fall back to a seqscan */
+		AddExtensionQueryScanForAdaptiveScan(root, rel, rte);
+	}
 
 	if (EnableExtendedExplainPlans)
 	{
@@ -977,6 +1006,274 @@ ExtensionRelPathlistHook(PlannerInfo *root, RelOptInfo *rel, Index rti,
 }
 
 
+/*
+ * Checks whether the grouping of the query is the single bson key grouping
+ * generated for $group (and the stages built on it).
+ */
+static inline bool
+IsBsonGroupByQuery(Query *query)
+{
+	if (list_length(query->groupClause) != 1 || query->groupingSets != NIL)
+	{
+		return false;
+	}
+
+	SortGroupClause *groupClause = linitial(query->groupClause);
+	return groupClause->eqop == BsonEqualOperatorId();
+}
+
+
+/*
+ * For $group, keeps only the hashed aggregation paths in the grouping relation
+ * when enableGroupHashAggregation is set and the planner could hash the group.
+ * Hash aggregation is bounded by hash_mem: once the hash table is full, the
+ * input rows of new group keys are partitioned and spilled to disk, and each
+ * partition is aggregated in a later batch. The states of groups that are
+ * already in memory are never serialized, so every accumulator supports this.
+ * Sort based grouping is left in place when hashing is not possible (e.g.
+ * accumulators that aggregate in a sorted order).
+ */
+static void
+ForceHashedGroupAggregationPaths(PlannerInfo *root, RelOptInfo *outputRel)
+{
+	if (!IsBsonGroupByQuery(root->parse))
+	{
+		return;
+	}
+
+	List *hashedPaths = NIL;
+	ListCell *pathCell;
+	foreach(pathCell, outputRel->pathlist)
+	{
+		Path *path = (Path *) lfirst(pathCell);
+		if (IsA(path, AggPath) && ((AggPath *) path)->aggstrategy == AGG_HASHED)
+		{
+			hashedPaths = lappend(hashedPaths, path);
+		}
+	}
+
+	if (hashedPaths != NIL)
+	{
+		outputRel->pathlist = hashedPaths;
+	}
+}
+
+
+/*
+ * Hook for the upper relations of a query (grouping, window functions, etc).
+ */
+void
+ExtensionCreateUpperPathsHook(PlannerInfo *root, UpperRelationKind stage,
+							  RelOptInfo *inputRel, RelOptInfo *outputRel,
+							  void *extra)
+{
+	if (ExtensionPreviousCreateUpperPathsHook != NULL)
+	{
+		ExtensionPreviousCreateUpperPathsHook(root, stage, inputRel, outputRel, extra);
+	}
+
+	if (stage == UPPERREL_GROUP_AGG && EnableGroupHashAggregation &&
+		IsDocumentDBApiExtensionActive())
+	{
+		ForceHashedGroupAggregationPaths(root, outputRel);
+	}
+}
+
+
+/*
+ * Whether the relation is the foreign collection side of a $lookup: The pipeline
+ * builder emits it as a lateral subquery over the input documents.
+ */
+static bool
+IsLookupRightRelation(PlannerInfo *root, RelOptInfo *rel)
+{
+	if (rel->reloptkind != RELOPT_BASEREL || rel->rtekind != RTE_SUBQUERY)
+	{
+		return false;
+	}
+
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	return rte->lateral && rte->alias != NULL &&
+		   strncmp(rte->alias->aliasname, "lookupRight_", 12) == 0;
+}
+
+
+/*
+ * Whether the function is volatile (check_functions_in_node callback).
+ */
+static bool
+IsVolatileFunctionChecker(Oid funcId, void *context)
+{
+	return func_volatile(funcId) == PROVOLATILE_VOLATILE;
+}
+
+
+/*
+ * Walks the foreign collection side of a $lookup and returns true if it can
+ * produce different output for the same input document: It samples the
+ * collection ($sample), calls volatile functions (e.g. the random sort of
+ * $sample) or its expressions and filters use $rand. $$NOW is fixed for the
+ * transaction so it does not prevent caching the output.
+ */
+static bool
+LookupRightHasVolatileOutputWalker(Node *node, void *context)
+{
+	if (node == NULL)
+	{
+		return false;
+	}
+
+	if (IsA(node, Query))
+	{
+		return query_tree_walker((Query *) node, LookupRightHasVolatileOutputWalker,
+								 context, QTW_EXAMINE_RTES_BEFORE);
+	}
+
+	if (IsA(node, RangeTblEntry))
+	{
+		return ((RangeTblEntry *) node)->tablesample != NULL;
+	}
+
+	if (IsA(node, Const))
+	{
+		Const *constValue = (Const *) node;
+		if (constValue->constisnull ||
+			(constValue->consttype != BsonTypeId() &&
+			 constValue->consttype != BsonQueryTypeId()))
+		{
+			return false;
+		}
+
+		pgbson *bson = DatumGetPgBsonPacked(constValue->constvalue);
+		bson_value_t value = ConvertPgbsonToBsonValue(bson);
+		return IsAggregationExpressionNonDeterministic(&value);
+	}
+
+	if (check_functions_in_node(node, IsVolatileFunctionChecker, context))
+	{
+		return true;
+	}
+
+	return expression_tree_walker(node, LookupRightHasVolatileOutputWalker, context);
+}
+
+
+/*
+ * For the nested loops of a $lookup, adds nested loops that cache the output of
+ * the foreign collection side keyed on the values it references from the input
+ * documents (the lookup filter and let). Input documents that share a join key
+ * then reuse the matched documents from the cache instead of re-probing the
+ * foreign collection.
+ *
+ * Postgres does not consider a Memoize node for the computed lookup keys, so
+ * the memoized nested loops are built here. They are costed the way the join
+ * planner costs Memoize (the rescans of the Memoize node are costed by the
+ * expected cache hit ratio on the keys) and compete with the existing nested
+ * loops. The cache is bounded by hash_mem and evicts the least recently used
+ * keys beyond that.
+ */
+static void
+MemoizeLookupNestedLoopPaths(PlannerInfo *root, RelOptInfo *joinrel,
+							 RelOptInfo *outerrel, RelOptInfo *innerrel,
+							 JoinType jointype, JoinPathExtraData *extra)
+{
+	if (!enable_memoize || innerrel->lateral_vars == NIL ||
+		!bms_is_subset(innerrel->lateral_relids, outerrel->relids))
+	{
+		return;
+	}
+
+	/* Caching is only valid if the same key always produces the same matches */
+	RangeTblEntry *rte = planner_rt_fetch(innerrel->relid, root);
+	if (LookupRightHasVolatileOutputWalker((Node *) rte->subquery, NULL))
+	{
+		return;
+	}
+
+	List *paramExprs = NIL;
+	List *hashOperators = NIL;
+	ListCell *cell;
+	foreach(cell, innerrel->lateral_vars)
+	{
+		Node *lateralVar = (Node *) lfirst(cell);
+		if (!IsA(lateralVar, Var) || exprType(lateralVar) != BsonTypeId())
+		{
+			return;
+		}
+
+		paramExprs = lappend(paramExprs, lateralVar);
+		hashOperators = lappend_oid(hashOperators, BsonEqualOperatorId());
+	}
+
+	/* Build the paths first since add_path may free the paths of the join */
+	List *memoizedPaths = NIL;
+	foreach(cell, joinrel->pathlist)
+	{
+		Path *path = (Path *) lfirst(cell);
+		if (!IsA(path, NestPath))
+		{
+			continue;
+		}
+
+		NestPath *nestPath = (NestPath *) path;
+		Path *outerPath = nestPath->jpath.outerjoinpath;
+		Path *innerPath = nestPath->jpath.innerjoinpath;
+		if (innerPath->parent != innerrel || IsA(innerPath, MemoizePath))
+		{
+			continue;
+		}
+
+		/*
+		 * Compare the keys by their bytes: Values that are equal but of different
+		 * types (e.g. 1 and 1.0) may still produce different results on the foreign
+		 * collection side.
+		 */
+		bool singleRow = false;
+		bool binaryMode = true;
+		Path *memoizePath = (Path *) create_memoize_path(
+			root, innerrel, innerPath, paramExprs, hashOperators, singleRow,
+			binaryMode, outerPath->rows);
+
+		JoinCostWorkspace workspace;
+		initial_cost_nestloop(root, &workspace, jointype, outerPath, memoizePath,
+							  extra);
+		memoizedPaths = lappend(memoizedPaths, create_nestloop_path(
+									root, joinrel, jointype, &workspace, extra,
+									outerPath, memoizePath,
+									nestPath->jpath.joinrestrictinfo,
+									path->pathkeys, PATH_REQ_OUTER(path)));
+	}
+
+	foreach(cell, memoizedPaths)
+	{
+		add_path(joinrel, (Path *) lfirst(cell));
+	}
+}
+
+
+/*
+ * Hook for the join relations of a query.
+ */
+void
+ExtensionSetJoinPathlistHook(PlannerInfo *root, RelOptInfo *joinrel,
+							 RelOptInfo *outerrel, RelOptInfo *innerrel,
+							 JoinType jointype, JoinPathExtraData *extra)
+{
+	if (ExtensionPreviousSetJoinPathlistHook != NULL)
+	{
+		ExtensionPreviousSetJoinPathlistHook(root, joinrel, outerrel, innerrel,
+											 jointype, extra);
+	}
+
+	if (EnableLookupMemoizedJoin && IsDocumentDBApiExtensionActive() &&
+		IsLookupRightRelation(root, innerrel))
+	{
+		MemoizeLookupNestedLoopPaths(root, joinrel, outerrel, innerrel, jointype,
+									 extra);
+	}
+}
+
+
 /*
  * GetIndexOptInfoSortOrder determines the sort order for IndexOptInfo based on
  * the index type and properties. This is used to prioritize indexes in the
@@ -1131,6 +1428,74 @@ LogRelationIndexesOrder(const RelOptInfo *rel)
 }
 
 
+/*
+ * Cost estimate of the primary key index of a clustered collection.
+ *
+ * btcostestimate derives the correlation of the index from its leading column,
+ * shard_key_value, which is constant across an unsharded collection and so has
+ * no correlation statistic. For a clustered collection the heap is laid out
+ * in object_id order, so use the correlation of object_id instead: this is what
+ * makes range scans on _id cost (and get picked) as the sequential reads they
+ * are.
+ */
+static void
+ClusteredIdIndexCostEstimate(PlannerInfo *root, IndexPath *path, double loop_count,
+							 Cost *indexStartupCost, Cost *indexTotalCost,
+							 Selectivity *indexSelectivity, double *indexCorrelation,
+							 double *indexPages)
+{
+	btcostestimate(root, path, loop_count, indexStartupCost, indexTotalCost,
+				   indexSelectivity, indexCorrelation, indexPages);
+
+	RangeTblEntry *rte = planner_rt_fetch(path->indexinfo->rel->relid, root);
+	double objectIdCorrelation = 0;
+	if (TryGetAttributeCorrelation(rte->relid,
+								   DOCUMENT_DATA_TABLE_OBJECT_ID_VAR_ATTR_NUMBER,
+								   &objectIdCorrelation))
+	{
+		*indexCorrelation = objectIdCorrelation;
+	}
+}
+
+
+/*
+ * Marks the primary key index of a clustered collection to be costed with
+ * the correlation of the _id order (see ClusteredIdIndexCostEstimate).
+ */
+static void
+UpdateClusteredIndexCostEstimate(RelOptInfo *rel)
+{
+	ListCell *indexCell;
+	foreach(indexCell, rel->indexlist)
+	{
+		IndexOptInfo *indexInfo = lfirst(indexCell);
+		if (indexInfo->relam != BTREE_AM_OID)
+		{
+			continue;
+		}
+
+		const char *indexName = get_rel_name(indexInfo->indexoid);
+		if (indexName == NULL || strncmp(indexName, "collection_pk_", 14) != 0)
+		{
+			continue;
+		}
+
+		HeapTuple indexTuple = SearchSysCache1(INDEXRELID,
+											   ObjectIdGetDatum(indexInfo->indexoid));
+		if (HeapTupleIsValid(indexTuple))
+		{
+			Form_pg_index indexForm = (Form_pg_index) GETSTRUCT(indexTuple);
+			if (indexForm->indisclustered)
+			{
+				indexInfo->amcostestimate = ClusteredIdIndexCostEstimate;
+			}
+
+			ReleaseSysCache(indexTuple);
+		}
+	}
+}
+
+
 /*
  * ExtensionGetRelationInfoHookCore is the core implementation of the get_relation_info
  * hook for the DocumentDB API extension. It modifies the relation info based on the
@@ -1159,6 +1524,11 @@ ExtensionGetRelationInfoHookCore(PlannerInfo *root, Oid relationObjectId,
 		list_sort(rel->indexlist, CompareIndexOptionsFunc);
 	}
 
+	if (EnableClusteredCollections && rel->indexlist != NIL)
+	{
+		UpdateClusteredIndexCostEstimate(rel);
+	}
+
 	if (EnableLogRelationIndexesOrder)
 	{
 		LogRelationIndexesOrder(rel);
@@ -1322,6 +1692,28 @@ DocumentDbQueryFlagsWalker(Node *node, DocumentDbQueryFlagsState *queryFlags)
 }
 
 
+/*
+ * Whether the INSERT reads its rows from a query (as $out does) rather than
+ * from a VALUES list, in which case the source query needs the same handling
+ * as any other query.
+ */
+static bool
+IsInsertSelectQuery(Query *query)
+{
+	ListCell *cell;
+	foreach(cell, query->rtable)
+	{
+		RangeTblEntry *rte = (RangeTblEntry *) lfirst(cell);
+		if (rte->rtekind == RTE_SUBQUERY)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 /*
  * Helper method that identifies if a query statement is read-write or read only.
  */
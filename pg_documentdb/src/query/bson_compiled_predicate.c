@@ -0,0 +1,1113 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/query/bson_compiled_predicate.c
+ *
+ * Compiles query filters into a compact linear program that is built once
+ * and interpreted per document. The program shares a single path lookup
+ * across all the predicates on the same path, short circuits $and/$or with
+ * jumps, and uses comparison opcodes specialized to the type of the filter
+ * value.
+ *
+ * Only a subset of filters is compiled: Comparisons ($eq, $ne, $gt, $gte,
+ * $lt, $lte) against scalar values, $exists, and $and/$or/$nor of such
+ * filters. A document that would need the full query semantics (arrays,
+ * undefined or NaN values, non document intermediate path values) is not
+ * evaluated by the program and callers fall back to the query operators.
+ *
+ * Programs can also be evaluated over a batch of documents: The paths are
+ * extracted once per document into columns of values, and each instruction
+ * then runs over the whole column with the comparison specialized to the
+ * type of the constant.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+
+#include "io/bson_core.h"
+#include "query/bson_compare.h"
+#include "query/bson_compiled_predicate.h"
+
+
+/* --------------------------------------------------------- */
+/* Data-types */
+/* --------------------------------------------------------- */
+
+/*
+ * The instructions of a compiled predicate program. Each instruction either
+ * sets the result register of the program or jumps based on it.
+ */
+typedef enum CompiledPredicateOpCode
+{
+	/* Sets the result to true */
+	CompiledPredicateOpCode_True = 0,
+
+	/* Compares the value at a path against the instruction's constant */
+	CompiledPredicateOpCode_Equal = 1,
+	CompiledPredicateOpCode_Greater = 2,
+	CompiledPredicateOpCode_GreaterEqual = 3,
+	CompiledPredicateOpCode_Less = 4,
+	CompiledPredicateOpCode_LessEqual = 5,
+
+	/* Checks whether a path exists (or does not exist) */
+	CompiledPredicateOpCode_Exists = 6,
+
+	/* Negates the result */
+	CompiledPredicateOpCode_Not = 7,
+
+	/* Jumps to the instruction's jump target if the result is false */
+	CompiledPredicateOpCode_JumpIfFalse = 8,
+
+	/* Jumps to the instruction's jump target if the result is true */
+	CompiledPredicateOpCode_JumpIfTrue = 9,
+} CompiledPredicateOpCode;
+
+
+/*
+ * The kind of comparison to use for a comparison instruction, based on the
+ * type of the constant in the filter.
+ */
+typedef enum CompiledPredicateCompareKind
+{
+	/* Compare using the generic bson comparison */
+	CompiledPredicateCompareKind_Generic = 0,
+
+	/* The constant is an int32/int64: Integers are compared directly */
+	CompiledPredicateCompareKind_Integer = 1,
+
+	/* The constant is a string: Strings are compared directly */
+	CompiledPredicateCompareKind_String = 2,
+
+	/* The constant is null: Matches null and missing values */
+	CompiledPredicateCompareKind_Null = 3,
+} CompiledPredicateCompareKind;
+
+
+typedef struct CompiledPredicateInstruction
+{
+	CompiledPredicateOpCode opCode;
+
+	/* The kind of comparison (for comparison instructions) */
+	CompiledPredicateCompareKind compareKind;
+
+	/* The path slot the instruction reads (for comparisons and $exists) */
+	int pathSlot;
+
+	/* The index of the instruction to jump to (for jumps) */
+	int jumpTarget;
+
+	/* Whether the path should exist (for $exists) */
+	bool existsValue;
+
+	/* The integer value of the constant (for CompiledPredicateCompareKind_Integer) */
+	int64 integerConstant;
+
+	/* The constant to compare against (for comparisons) */
+	bson_value_t constant;
+} CompiledPredicateInstruction;
+
+
+/*
+ * The result of resolving a path against a document.
+ */
+typedef enum CompiledPathState
+{
+	CompiledPathState_Found = 0,
+	CompiledPathState_Missing = 1,
+
+	/* The path needs the full query semantics for this document */
+	CompiledPathState_Unsupported = 2,
+} CompiledPathState;
+
+
+/*
+ * A distinct path referenced by the predicates of the program, along with
+ * the value it resolved to for the document currently being evaluated.
+ */
+typedef struct CompiledPredicatePath
+{
+	/* The dotted path */
+	const char *path;
+	uint32_t pathLength;
+
+	/* The evaluation the resolved value belongs to */
+	uint64 generation;
+
+	/* The resolved state and value */
+	CompiledPathState state;
+	bson_value_t value;
+} CompiledPredicatePath;
+
+
+struct CompiledPredicateProgram
+{
+	/* A copy of the filter that the constants and paths point into */
+	pgbson *filter;
+
+	CompiledPredicateInstruction *instructions;
+	int numInstructions;
+	int maxInstructions;
+
+	CompiledPredicatePath *paths;
+	int numPaths;
+	int maxPaths;
+
+	/* Incremented for each evaluation to invalidate the resolved paths */
+	uint64 generation;
+};
+
+
+/* --------------------------------------------------------- */
+/* Forward declaration */
+/* --------------------------------------------------------- */
+
+static bool CompileFilterDocument(CompiledPredicateProgram *program,
+								  const bson_value_t *filterDocument);
+static bool CompileLogicalOperator(CompiledPredicateProgram *program,
+								   const bson_value_t *operands, bool isAnd);
+static bool CompileFilterElement(CompiledPredicateProgram *program,
+								 bson_iter_t *filterIterator);
+static bool CompilePathOperator(CompiledPredicateProgram *program, int pathSlot,
+								const char *operatorName,
+								const bson_value_t *operatorValue);
+static bool CompileComparison(CompiledPredicateProgram *program,
+							  CompiledPredicateOpCode opCode, int pathSlot,
+							  const bson_value_t *constant, bool isNegated);
+static int EmitInstruction(CompiledPredicateProgram *program,
+						   CompiledPredicateOpCode opCode);
+static void PatchJumpTargets(CompiledPredicateProgram *program, List *jumps);
+static int GetOrAddPathSlot(CompiledPredicateProgram *program, const char *path,
+							uint32_t pathLength);
+static bool IsSupportedPath(const char *path, uint32_t pathLength);
+static CompiledPredicatePath * ResolvePath(CompiledPredicateProgram *program,
+										   int pathSlot,
+										   const bson_value_t *document);
+static CompiledPathState ResolvePathValue(const CompiledPredicatePath *path,
+										  const bson_value_t *document,
+										  bson_value_t *value);
+static void EvaluateComparisonColumn(const CompiledPredicateInstruction *instruction,
+									 const CompiledPathState *columnStates,
+									 const bson_value_t *columnValues,
+									 const int *resumeAt, const bool *isEvaluated,
+									 int programCounter, int numDocuments,
+									 bool *isMatch);
+static bool EvaluateComparison(const CompiledPredicateInstruction *instruction,
+							   CompiledPathState state, const bson_value_t *value);
+static inline bool IsComparisonMatch(CompiledPredicateOpCode opCode, int cmp);
+
+/*
+ * Whether the document at the given index of a batch still executes the
+ * instruction at the program counter: It was not skipped over by a jump and
+ * did not need to fall back to the query operators.
+ */
+#define IsBatchDocumentActive(resumeAt, isEvaluated, index, programCounter) \
+	((isEvaluated)[index] && (resumeAt)[index] <= (programCounter))
+
+
+/* --------------------------------------------------------- */
+/* Top level exports */
+/* --------------------------------------------------------- */
+
+/*
+ * Compiles the query filter into a predicate program allocated in the current
+ * memory context. Returns NULL if the filter uses constructs that the program
+ * does not support.
+ */
+CompiledPredicateProgram *
+TryCompileQueryPredicateProgram(const bson_value_t *filter)
+{
+	if (filter->value_type != BSON_TYPE_DOCUMENT)
+	{
+		return NULL;
+	}
+
+	CompiledPredicateProgram *program = palloc0(sizeof(CompiledPredicateProgram));
+	program->filter = PgbsonInitFromDocumentBsonValue(filter);
+
+	program->maxInstructions = 8;
+	program->instructions = palloc(sizeof(CompiledPredicateInstruction) *
+								   program->maxInstructions);
+	program->maxPaths = 4;
+	program->paths = palloc0(sizeof(CompiledPredicatePath) * program->maxPaths);
+
+	bson_value_t filterValue = ConvertPgbsonToBsonValue(program->filter);
+	if (!CompileFilterDocument(program, &filterValue))
+	{
+		FreeCompiledPredicateProgram(program);
+		return NULL;
+	}
+
+	return program;
+}
+
+
+/*
+ * Evaluates the predicate program against the document. Returns true and sets
+ * isMatch if the program could evaluate the document; returns false if the
+ * document needs to be evaluated by the query operators instead.
+ */
+bool
+EvaluateCompiledPredicateProgram(CompiledPredicateProgram *program,
+								 const bson_value_t *document, bool *isMatch)
+{
+	program->generation++;
+
+	bool result = true;
+	int programCounter = 0;
+	while (programCounter < program->numInstructions)
+	{
+		const CompiledPredicateInstruction *instruction =
+			&program->instructions[programCounter];
+		switch (instruction->opCode)
+		{
+			case CompiledPredicateOpCode_True:
+			{
+				result = true;
+				break;
+			}
+
+			case CompiledPredicateOpCode_Not:
+			{
+				result = !result;
+				break;
+			}
+
+			case CompiledPredicateOpCode_JumpIfFalse:
+			{
+				if (!result)
+				{
+					programCounter = instruction->jumpTarget;
+					continue;
+				}
+
+				break;
+			}
+
+			case CompiledPredicateOpCode_JumpIfTrue:
+			{
+				if (result)
+				{
+					programCounter = instruction->jumpTarget;
+					continue;
+				}
+
+				break;
+			}
+
+			case CompiledPredicateOpCode_Exists:
+			{
+				CompiledPredicatePath *path = ResolvePath(program, instruction->pathSlot,
+														  document);
+				if (path->state == CompiledPathState_Unsupported)
+				{
+					return false;
+				}
+
+				result = (path->state == CompiledPathState_Found) ==
+						 instruction->existsValue;
+				break;
+			}
+
+			default:
+			{
+				CompiledPredicatePath *path = ResolvePath(program, instruction->pathSlot,
+														  document);
+				if (path->state == CompiledPathState_Unsupported)
+				{
+					return false;
+				}
+
+				result = EvaluateComparison(instruction, path->state, &path->value);
+				break;
+			}
+		}
+
+		programCounter++;
+	}
+
+	*isMatch = result;
+	return true;
+}
+
+
+/*
+ * Evaluates the predicate program against a batch of documents. For each
+ * document, isEvaluated is set to whether the program could evaluate it and,
+ * if so, isMatch to whether it matched. Documents that were not evaluated
+ * need to be evaluated by the query operators instead.
+ *
+ * Each path is resolved once per document into a column, and the program is
+ * then run one instruction at a time over all the documents: Jumps record
+ * the instruction each document resumes at rather than moving a shared
+ * program counter.
+ */
+void
+EvaluateCompiledPredicateProgramBatch(CompiledPredicateProgram *program,
+									  const bson_value_t *documents, int numDocuments,
+									  bool *isMatch, bool *isEvaluated)
+{
+	if (numDocuments <= 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < numDocuments; i++)
+	{
+		isMatch[i] = true;
+		isEvaluated[i] = true;
+	}
+
+	/* Extract the columns: Path slot s of document i is at s * numDocuments + i */
+	int numCells = Max(program->numPaths * numDocuments, 1);
+	CompiledPathState *columnStates = palloc(sizeof(CompiledPathState) * numCells);
+	bson_value_t *columnValues = palloc(sizeof(bson_value_t) * numCells);
+	for (int pathSlot = 0; pathSlot < program->numPaths; pathSlot++)
+	{
+		const CompiledPredicatePath *path = &program->paths[pathSlot];
+		int columnStart = pathSlot * numDocuments;
+		for (int i = 0; i < numDocuments; i++)
+		{
+			CompiledPathState state = ResolvePathValue(path, &documents[i],
+													   &columnValues[columnStart + i]);
+			columnStates[columnStart + i] = state;
+			if (state == CompiledPathState_Unsupported)
+			{
+				isEvaluated[i] = false;
+			}
+		}
+	}
+
+	int *resumeAt = palloc0(sizeof(int) * numDocuments);
+	for (int programCounter = 0; programCounter < program->numInstructions;
+		 programCounter++)
+	{
+		const CompiledPredicateInstruction *instruction =
+			&program->instructions[programCounter];
+		int columnStart = instruction->pathSlot * numDocuments;
+		switch (instruction->opCode)
+		{
+			case CompiledPredicateOpCode_True:
+			case CompiledPredicateOpCode_Not:
+			case CompiledPredicateOpCode_JumpIfFalse:
+			case CompiledPredicateOpCode_JumpIfTrue:
+			{
+				for (int i = 0; i < numDocuments; i++)
+				{
+					if (!IsBatchDocumentActive(resumeAt, isEvaluated, i, programCounter))
+					{
+						continue;
+					}
+
+					if (instruction->opCode == CompiledPredicateOpCode_True)
+					{
+						isMatch[i] = true;
+					}
+					else if (instruction->opCode == CompiledPredicateOpCode_Not)
+					{
+						isMatch[i] = !isMatch[i];
+					}
+					else if (isMatch[i] ==
+							 (instruction->opCode == CompiledPredicateOpCode_JumpIfTrue))
+					{
+						resumeAt[i] = instruction->jumpTarget;
+					}
+				}
+
+				break;
+			}
+
+			case CompiledPredicateOpCode_Exists:
+			{
+				for (int i = 0; i < numDocuments; i++)
+				{
+					if (IsBatchDocumentActive(resumeAt, isEvaluated, i, programCounter))
+					{
+						isMatch[i] = (columnStates[columnStart + i] ==
+									  CompiledPathState_Found) == instruction->existsValue;
+					}
+				}
+
+				break;
+			}
+
+			default:
+			{
+				EvaluateComparisonColumn(instruction, &columnStates[columnStart],
+										 &columnValues[columnStart], resumeAt,
+										 isEvaluated, programCounter, numDocuments,
+										 isMatch);
+				break;
+			}
+		}
+	}
+
+	pfree(resumeAt);
+	pfree(columnValues);
+	pfree(columnStates);
+}
+
+
+/*
+ * Frees the memory held by a predicate program.
+ */
+void
+FreeCompiledPredicateProgram(CompiledPredicateProgram *program)
+{
+	if (program == NULL)
+	{
+		return;
+	}
+
+	pfree(program->instructions);
+	pfree(program->paths);
+	pfree(program->filter);
+	pfree(program);
+}
+
+
+/* --------------------------------------------------------- */
+/* Private helper methods */
+/* --------------------------------------------------------- */
+
+/*
+ * Compiles a filter document: The filter matches if all its top level
+ * elements match, so the elements are chained with JumpIfFalse.
+ */
+static bool
+CompileFilterDocument(CompiledPredicateProgram *program,
+					  const bson_value_t *filterDocument)
+{
+	bson_iter_t filterIterator;
+	BsonValueInitIterator(filterDocument, &filterIterator);
+
+	List *jumps = NIL;
+	bool isFirst = true;
+	while (bson_iter_next(&filterIterator))
+	{
+		if (!isFirst)
+		{
+			jumps = lappend_int(jumps, EmitInstruction(program,
+													   CompiledPredicateOpCode_JumpIfFalse));
+		}
+
+		if (!CompileFilterElement(program, &filterIterator))
+		{
+			return false;
+		}
+
+		isFirst = false;
+	}
+
+	if (isFirst)
+	{
+		/* An empty filter matches everything */
+		EmitInstruction(program, CompiledPredicateOpCode_True);
+	}
+
+	PatchJumpTargets(program, jumps);
+	return true;
+}
+
+
+/*
+ * Compiles the operands of a $and (or $or) into a chain of filters that
+ * short circuits on the first false (or true) result.
+ */
+static bool
+CompileLogicalOperator(CompiledPredicateProgram *program, const bson_value_t *operands,
+					   bool isAnd)
+{
+	if (operands->value_type != BSON_TYPE_ARRAY)
+	{
+		return false;
+	}
+
+	bson_iter_t operandsIterator;
+	BsonValueInitIterator(operands, &operandsIterator);
+
+	List *jumps = NIL;
+	bool isFirst = true;
+	while (bson_iter_next(&operandsIterator))
+	{
+		if (!BSON_ITER_HOLDS_DOCUMENT(&operandsIterator))
+		{
+			return false;
+		}
+
+		if (!isFirst)
+		{
+			CompiledPredicateOpCode jumpOpCode = isAnd ?
+												 CompiledPredicateOpCode_JumpIfFalse :
+												 CompiledPredicateOpCode_JumpIfTrue;
+			jumps = lappend_int(jumps, EmitInstruction(program, jumpOpCode));
+		}
+
+		if (!CompileFilterDocument(program, bson_iter_value(&operandsIterator)))
+		{
+			return false;
+		}
+
+		isFirst = false;
+	}
+
+	if (isFirst)
+	{
+		/* Empty logical operators are rejected by the query operators */
+		return false;
+	}
+
+	PatchJumpTargets(program, jumps);
+	return true;
+}
+
+
+/*
+ * Compiles a single element of a filter document: Either a logical operator
+ * or a path along with its value (or operators).
+ */
+static bool
+CompileFilterElement(CompiledPredicateProgram *program, bson_iter_t *filterIterator)
+{
+	const char *key = bson_iter_key(filterIterator);
+	uint32_t keyLength = bson_iter_key_len(filterIterator);
+	const bson_value_t *value = bson_iter_value(filterIterator);
+
+	if (key[0] == '$')
+	{
+		if (strcmp(key, "$and") == 0)
+		{
+			return CompileLogicalOperator(program, value, true);
+		}
+		else if (strcmp(key, "$or") == 0)
+		{
+			return CompileLogicalOperator(program, value, false);
+		}
+		else if (strcmp(key, "$nor") == 0)
+		{
+			if (!CompileLogicalOperator(program, value, false))
+			{
+				return false;
+			}
+
+			EmitInstruction(program, CompiledPredicateOpCode_Not);
+			return true;
+		}
+
+		return false;
+	}
+
+	if (!IsSupportedPath(key, keyLength))
+	{
+		return false;
+	}
+
+	int pathSlot = GetOrAddPathSlot(program, key, keyLength);
+
+	bson_iter_t valueIterator;
+	if (value->value_type != BSON_TYPE_DOCUMENT ||
+		!bson_iter_recurse(filterIterator, &valueIterator) ||
+		!bson_iter_next(&valueIterator) ||
+		bson_iter_key(&valueIterator)[0] != '$')
+	{
+		/* { path: value } is an implicit $eq (documents are not supported) */
+		bool isNegated = false;
+		return CompileComparison(program, CompiledPredicateOpCode_Equal, pathSlot, value,
+								 isNegated);
+	}
+
+	/* { path: { $op1: value1, $op2: value2 } } matches if all the operators match */
+	List *jumps = NIL;
+	bool isFirst = true;
+	do {
+		const char *operatorName = bson_iter_key(&valueIterator);
+		if (operatorName[0] != '$')
+		{
+			return false;
+		}
+
+		if (!isFirst)
+		{
+			jumps = lappend_int(jumps, EmitInstruction(program,
+													   CompiledPredicateOpCode_JumpIfFalse));
+		}
+
+		if (!CompilePathOperator(program, pathSlot, operatorName,
+								 bson_iter_value(&valueIterator)))
+		{
+			return false;
+		}
+
+		isFirst = false;
+	} while (bson_iter_next(&valueIterator));
+
+	PatchJumpTargets(program, jumps);
+	return true;
+}
+
+
+/*
+ * Compiles a single operator applied to a path.
+ */
+static bool
+CompilePathOperator(CompiledPredicateProgram *program, int pathSlot,
+					const char *operatorName, const bson_value_t *operatorValue)
+{
+	bool isNegated = false;
+	if (strcmp(operatorName, "$eq") == 0)
+	{
+		return CompileComparison(program, CompiledPredicateOpCode_Equal, pathSlot,
+								 operatorValue, isNegated);
+	}
+	else if (strcmp(operatorName, "$ne") == 0)
+	{
+		isNegated = true;
+		return CompileComparison(program, CompiledPredicateOpCode_Equal, pathSlot,
+								 operatorValue, isNegated);
+	}
+	else if (strcmp(operatorName, "$gt") == 0)
+	{
+		return CompileComparison(program, CompiledPredicateOpCode_Greater, pathSlot,
+								 operatorValue, isNegated);
+	}
+	else if (strcmp(operatorName, "$gte") == 0)
+	{
+		return CompileComparison(program, CompiledPredicateOpCode_GreaterEqual, pathSlot,
+								 operatorValue, isNegated);
+	}
+	else if (strcmp(operatorName, "$lt") == 0)
+	{
+		return CompileComparison(program, CompiledPredicateOpCode_Less, pathSlot,
+								 operatorValue, isNegated);
+	}
+	else if (strcmp(operatorName, "$lte") == 0)
+	{
+		return CompileComparison(program, CompiledPredicateOpCode_LessEqual, pathSlot,
+								 operatorValue, isNegated);
+	}
+	else if (strcmp(operatorName, "$exists") == 0)
+	{
+		int index = EmitInstruction(program, CompiledPredicateOpCode_Exists);
+		CompiledPredicateInstruction *instruction = &program->instructions[index];
+		instruction->pathSlot = pathSlot;
+
+		/* Same as the query operators: Only numeric (or bool) zero is a negative match */
+		instruction->existsValue = !(BsonValueIsNumberOrBool(operatorValue) &&
+									 BsonValueAsInt64(operatorValue) == 0);
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * Compiles a comparison of the value at the path against a constant,
+ * picking the comparison kind based on the type of the constant.
+ */
+static bool
+CompileComparison(CompiledPredicateProgram *program, CompiledPredicateOpCode opCode,
+				  int pathSlot, const bson_value_t *constant, bool isNegated)
+{
+	CompiledPredicateCompareKind compareKind = CompiledPredicateCompareKind_Generic;
+	int64 integerConstant = 0;
+	switch (constant->value_type)
+	{
+		case BSON_TYPE_INT32:
+		{
+			compareKind = CompiledPredicateCompareKind_Integer;
+			integerConstant = constant->value.v_int32;
+			break;
+		}
+
+		case BSON_TYPE_INT64:
+		{
+			compareKind = CompiledPredicateCompareKind_Integer;
+			integerConstant = constant->value.v_int64;
+			break;
+		}
+
+		case BSON_TYPE_UTF8:
+		{
+			compareKind = CompiledPredicateCompareKind_String;
+			break;
+		}
+
+		case BSON_TYPE_NULL:
+		{
+			/* $gt/$lt null have their own semantics for missing values */
+			if (opCode == CompiledPredicateOpCode_Greater ||
+				opCode == CompiledPredicateOpCode_Less)
+			{
+				return false;
+			}
+
+			compareKind = CompiledPredicateCompareKind_Null;
+			break;
+		}
+
+		case BSON_TYPE_DOUBLE:
+		case BSON_TYPE_DECIMAL128:
+		{
+			if (IsBsonValueNaN(constant))
+			{
+				return false;
+			}
+
+			break;
+		}
+
+		case BSON_TYPE_BOOL:
+		case BSON_TYPE_DATE_TIME:
+		case BSON_TYPE_OID:
+		{
+			break;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+
+	int index = EmitInstruction(program, opCode);
+	CompiledPredicateInstruction *instruction = &program->instructions[index];
+	instruction->compareKind = compareKind;
+	instruction->pathSlot = pathSlot;
+	instruction->integerConstant = integerConstant;
+	instruction->constant = *constant;
+
+	if (isNegated)
+	{
+		EmitInstruction(program, CompiledPredicateOpCode_Not);
+	}
+
+	return true;
+}
+
+
+/*
+ * Appends an instruction to the program and returns its index.
+ */
+static int
+EmitInstruction(CompiledPredicateProgram *program, CompiledPredicateOpCode opCode)
+{
+	if (program->numInstructions == program->maxInstructions)
+	{
+		program->maxInstructions *= 2;
+		program->instructions = repalloc(program->instructions,
+										 sizeof(CompiledPredicateInstruction) *
+										 program->maxInstructions);
+	}
+
+	int index = program->numInstructions++;
+	CompiledPredicateInstruction *instruction = &program->instructions[index];
+	memset(instruction, 0, sizeof(CompiledPredicateInstruction));
+	instruction->opCode = opCode;
+	return index;
+}
+
+
+/*
+ * Points the given jump instructions at the next instruction to be emitted.
+ */
+static void
+PatchJumpTargets(CompiledPredicateProgram *program, List *jumps)
+{
+	ListCell *jumpCell;
+	foreach(jumpCell, jumps)
+	{
+		program->instructions[lfirst_int(jumpCell)].jumpTarget =
+			program->numInstructions;
+	}
+
+	list_free(jumps);
+}
+
+
+/*
+ * Returns the slot for the path, adding one if the path is not yet tracked
+ * so that predicates on the same path share a single lookup.
+ */
+static int
+GetOrAddPathSlot(CompiledPredicateProgram *program, const char *path,
+				 uint32_t pathLength)
+{
+	for (int i = 0; i < program->numPaths; i++)
+	{
+		if (program->paths[i].pathLength == pathLength &&
+			memcmp(program->paths[i].path, path, pathLength) == 0)
+		{
+			return i;
+		}
+	}
+
+	if (program->numPaths == program->maxPaths)
+	{
+		program->maxPaths *= 2;
+		program->paths = repalloc(program->paths,
+								  sizeof(CompiledPredicatePath) * program->maxPaths);
+	}
+
+	int slot = program->numPaths++;
+	memset(&program->paths[slot], 0, sizeof(CompiledPredicatePath));
+	program->paths[slot].path = path;
+	program->paths[slot].pathLength = pathLength;
+	return slot;
+}
+
+
+/*
+ * Whether the path is a plain dotted path: No empty segments and no
+ * positional or operator segments.
+ */
+static bool
+IsSupportedPath(const char *path, uint32_t pathLength)
+{
+	if (pathLength == 0 || path[0] == '.' || path[pathLength - 1] == '.')
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < pathLength; i++)
+	{
+		if (path[i] == '$' || (path[i] == '.' && path[i + 1] == '.'))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+/*
+ * Resolves the path in the given slot against the document, reusing the
+ * value resolved earlier in the same evaluation if any.
+ */
+static CompiledPredicatePath *
+ResolvePath(CompiledPredicateProgram *program, int pathSlot,
+			const bson_value_t *document)
+{
+	CompiledPredicatePath *path = &program->paths[pathSlot];
+	if (path->generation == program->generation)
+	{
+		return path;
+	}
+
+	path->generation = program->generation;
+	path->state = ResolvePathValue(path, document, &path->value);
+	return path;
+}
+
+
+/*
+ * Resolves the path against the document and returns whether it was found;
+ * the value is set for found paths.
+ */
+static CompiledPathState
+ResolvePathValue(const CompiledPredicatePath *path, const bson_value_t *document,
+				 bson_value_t *value)
+{
+	bson_iter_t iterator;
+	if (!bson_iter_init_from_data(&iterator, document->value.v_doc.data,
+								  document->value.v_doc.data_len))
+	{
+		return CompiledPathState_Unsupported;
+	}
+
+	const char *segment = path->path;
+	const char *pathEnd = path->path + path->pathLength;
+	while (true)
+	{
+		const char *segmentEnd = memchr(segment, '.', pathEnd - segment);
+		bool isLastSegment = segmentEnd == NULL;
+		if (isLastSegment)
+		{
+			segmentEnd = pathEnd;
+		}
+
+		if (!bson_iter_find_w_len(&iterator, segment, segmentEnd - segment))
+		{
+			return CompiledPathState_Missing;
+		}
+
+		bson_type_t type = bson_iter_type(&iterator);
+		if (!isLastSegment)
+		{
+			bson_iter_t childIterator;
+			if (type != BSON_TYPE_DOCUMENT ||
+				!bson_iter_recurse(&iterator, &childIterator))
+			{
+				/* Arrays and scalars along the path need the full semantics */
+				return CompiledPathState_Unsupported;
+			}
+
+			iterator = childIterator;
+			segment = segmentEnd + 1;
+			continue;
+		}
+
+		*value = *bson_iter_value(&iterator);
+		if (type == BSON_TYPE_ARRAY || type == BSON_TYPE_UNDEFINED ||
+			IsBsonValueNaN(value))
+		{
+			return CompiledPathState_Unsupported;
+		}
+
+		return CompiledPathState_Found;
+	}
+}
+
+
+/*
+ * Evaluates a comparison instruction over a column of resolved values for
+ * the active documents of a batch. Integer constants are compared inline
+ * against the integer values of the column; everything else goes through
+ * the comparison for a single value.
+ */
+static void
+EvaluateComparisonColumn(const CompiledPredicateInstruction *instruction,
+						 const CompiledPathState *columnStates,
+						 const bson_value_t *columnValues, const int *resumeAt,
+						 const bool *isEvaluated, int programCounter, int numDocuments,
+						 bool *isMatch)
+{
+	if (instruction->compareKind != CompiledPredicateCompareKind_Integer)
+	{
+		for (int i = 0; i < numDocuments; i++)
+		{
+			if (IsBatchDocumentActive(resumeAt, isEvaluated, i, programCounter))
+			{
+				isMatch[i] = EvaluateComparison(instruction, columnStates[i],
+												&columnValues[i]);
+			}
+		}
+
+		return;
+	}
+
+	int64 integerConstant = instruction->integerConstant;
+	for (int i = 0; i < numDocuments; i++)
+	{
+		if (!IsBatchDocumentActive(resumeAt, isEvaluated, i, programCounter))
+		{
+			continue;
+		}
+
+		const bson_value_t *value = &columnValues[i];
+		if (columnStates[i] == CompiledPathState_Found &&
+			(value->value_type == BSON_TYPE_INT32 || value->value_type == BSON_TYPE_INT64))
+		{
+			int64 integerValue = value->value_type == BSON_TYPE_INT32 ?
+								 value->value.v_int32 : value->value.v_int64;
+			int cmp = integerValue < integerConstant ? -1 :
+					  integerValue > integerConstant ? 1 : 0;
+			isMatch[i] = IsComparisonMatch(instruction->opCode, cmp);
+		}
+		else
+		{
+			isMatch[i] = EvaluateComparison(instruction, columnStates[i], value);
+		}
+	}
+}
+
+
+/*
+ * Evaluates a comparison instruction against the resolved path state and value.
+ * Values only compare against constants of the same sort order type.
+ */
+static bool
+EvaluateComparison(const CompiledPredicateInstruction *instruction,
+				   CompiledPathState state, const bson_value_t *value)
+{
+	if (instruction->compareKind == CompiledPredicateCompareKind_Null)
+	{
+		/* $eq/$gte/$lte null match null and missing values */
+		return state == CompiledPathState_Missing ||
+			   value->value_type == BSON_TYPE_NULL;
+	}
+
+	if (state == CompiledPathState_Missing)
+	{
+		return false;
+	}
+
+	int cmp;
+	if (instruction->compareKind == CompiledPredicateCompareKind_Integer &&
+		(value->value_type == BSON_TYPE_INT32 || value->value_type == BSON_TYPE_INT64))
+	{
+		int64 integerValue = value->value_type == BSON_TYPE_INT32 ?
+							 value->value.v_int32 : value->value.v_int64;
+		cmp = integerValue < instruction->integerConstant ? -1 :
+			  integerValue > instruction->integerConstant ? 1 : 0;
+	}
+	else if (instruction->compareKind == CompiledPredicateCompareKind_String &&
+			 value->value_type == BSON_TYPE_UTF8)
+	{
+		const char *collationString = NULL;
+		cmp = CompareStrings(value->value.v_utf8.str, value->value.v_utf8.len,
+							 instruction->constant.value.v_utf8.str,
+							 instruction->constant.value.v_utf8.len, collationString);
+	}
+	else
+	{
+		if (CompareBsonSortOrderType(value, &instruction->constant) != 0)
+		{
+			return false;
+		}
+
+		bool isComparisonValid = false;
+		cmp = CompareBsonValueAndType(value, &instruction->constant,
+									  &isComparisonValid);
+		if (!isComparisonValid)
+		{
+			return false;
+		}
+	}
+
+	return IsComparisonMatch(instruction->opCode, cmp);
+}
+
+
+/*
+ * Whether the result of comparing a value against the constant matches
+ * the comparison opcode.
+ */
+static inline bool
+IsComparisonMatch(CompiledPredicateOpCode opCode, int cmp)
+{
+	switch (opCode)
+	{
+		case CompiledPredicateOpCode_Equal:
+		{
+			return cmp == 0;
+		}
+
+		case CompiledPredicateOpCode_Greater:
+		{
+			return cmp > 0;
+		}
+
+		case CompiledPredicateOpCode_GreaterEqual:
+		{
+			return cmp >= 0;
+		}
+
+		case CompiledPredicateOpCode_Less:
+		{
+			return cmp < 0;
+		}
+
+		case CompiledPredicateOpCode_LessEqual:
+		{
+			return cmp <= 0;
+		}
+
+		default:
+		{
+			ereport(ERROR, (errmsg("Unexpected compiled predicate opcode %d",
+								   opCode)));
+		}
+	}
+}
@@ -29,6 +29,7 @@
 #include "collation/collation.h"
 #include "utils/version_utils.h"
 #include "aggregation/bson_query.h"
+#include "query/bson_compiled_predicate.h"
 
 /*
  * Custom bson_orderBy options to allow specific types when sorting.
@@ -100,6 +101,12 @@ typedef struct BsonDollarInQueryState
 	/* Hash all entries in `$in` excluding those of regex type, as regex-type entries are being handled separately. */
 	HTAB *bsonValueHashSet;
 
+	/*
+	 * Indexed by bson_type_t: Whether a value of that type could match any entry of
+	 * bsonValueHashSet (i.e. an entry of the same sort order type was hashed).
+	 */
+	bool hashedSortOrderTypes[UINT8_MAX + 1];
+
 	/* true if array has any null value */
 	bool hasNull;
 
@@ -145,6 +152,12 @@ typedef struct TraverseInValidateState
 	/* Hash all entries in `$in` excluding those of regex type, as regex-type entries are being handled separately. */
 	HTAB *bsonValueHashSet;
 
+	/*
+	 * Whether values of a given bson_type_t could match an entry of bsonValueHashSet.
+	 * This is a copy: the query state may be local to PopulateDollarInValidationState.
+	 */
+	bool hashedSortOrderTypes[UINT8_MAX + 1];
+
 	/* true if array has any null value */
 	bool hasNull;
 } TraverseInValidateState;
@@ -285,6 +298,8 @@ typedef bool (*IsQueryFilterNullFunc)(const TraverseValidateState *state);
 extern bool EnableCollation;
 extern bool EnableNowSystemVariable;
 extern bool UseLegacyNullEqualityBehavior;
+extern bool EnableDocumentFieldDirectory;
+extern bool EnableCompiledQueryPredicates;
 
 /* --------------------------------------------------------- */
 /* Forward declaration */
@@ -355,6 +370,7 @@ static bool CompareBsonAgainstQuery(const pgbson *element,
 									const pgbson *filter,
 									CompareMatchValueFunc compareFunc,
 									IsQueryFilterNullFunc isQueryFilterNull);
+static pgbson * GetDocumentForFilterPath(Datum documentDatum, const pgbson *filter);
 static bool IsExistPositiveMatch(pgbson *filter);
 static pgbsonelement PopulateRegexState(PG_FUNCTION_ARGS,
 										TraverseRegexValidateState *state);
@@ -362,6 +378,7 @@ static void PopulateRegexFromQuery(RegexData *regexState, pgbsonelement *filterE
 static void PopulateDollarInValidationState(PG_FUNCTION_ARGS,
 											TraverseInValidateState *state,
 											pgbsonelement *filterElement);
+static void MarkHashedSortOrderType(bool *hashedSortOrderTypes, bson_type_t type);
 static void PopulateDollarInStateFromQuery(BsonDollarInQueryState *dollarInState,
 										   const pgbson *filter);
 static pgbsonelement PopulateElemMatchValidationState(PG_FUNCTION_ARGS,
@@ -618,8 +635,8 @@ PG_FUNCTION_INFO_V1(bson_value_dollar_bits_any_set);
 Datum
 bson_dollar_size(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	bson_iter_t documentIterator;
 	pgbsonelement filterElement;
@@ -668,8 +685,8 @@ bson_value_dollar_size(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_type(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	IsQueryFilterNullFunc isNullFilterEquality = NULL;
 	PG_RETURN_BOOL(CompareBsonAgainstQuery(document, filter, CompareArrayTypeMatch,
@@ -1058,8 +1075,8 @@ bson_value_dollar_mod(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_eq(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 	IsQueryFilterNullFunc isNullFilterEquality = IsQueryFilterNullForValue;
 	PG_RETURN_BOOL(CompareBsonAgainstQuery(document, filter, CompareEqualMatch,
 										   isNullFilterEquality));
@@ -1096,8 +1113,8 @@ bson_value_dollar_eq(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_gt(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	IsQueryFilterNullFunc isNullFilterEquality = NULL;
 	PG_RETURN_BOOL(CompareBsonAgainstQuery(document, filter, CompareGreaterMatch,
@@ -1150,8 +1167,8 @@ bson_dollar_not_gt(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_gte(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 	IsQueryFilterNullFunc isNullFilterEquality = IsQueryFilterNullForValue;
 	PG_RETURN_BOOL(CompareBsonAgainstQuery(document, filter, CompareGreaterEqualMatch,
 										   isNullFilterEquality));
@@ -1349,8 +1366,8 @@ bson_dollar_not_lt(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_lt(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	IsQueryFilterNullFunc isNullFilterEquality = NULL;
 	PG_RETURN_BOOL(CompareBsonAgainstQuery(document, filter, CompareLessMatch,
@@ -1385,8 +1402,8 @@ bson_value_dollar_lt(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_lte(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	IsQueryFilterNullFunc isNullFilterEquality = IsQueryFilterNullForValue;
 	PG_RETURN_BOOL(CompareBsonAgainstQuery(document, filter, CompareLessEqualMatch,
@@ -1576,8 +1593,8 @@ bson_value_dollar_nin(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_ne(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	IsQueryFilterNullFunc isNullFilterEquality = IsQueryFilterNullForValue;
 	PG_RETURN_BOOL(!CompareBsonAgainstQuery(document, filter, CompareEqualMatch,
@@ -1611,8 +1628,8 @@ bson_value_dollar_ne(PG_FUNCTION_ARGS)
 Datum
 bson_dollar_exists(PG_FUNCTION_ARGS)
 {
-	pgbson *document = PG_GETARG_PGBSON(0);
 	pgbson *filter = PG_GETARG_PGBSON(1);
+	pgbson *document = GetDocumentForFilterPath(PG_GETARG_DATUM(0), filter);
 
 	bool existsPositiveMatch = IsExistPositiveMatch(filter);
 
@@ -1684,6 +1701,19 @@ bson_dollar_expr(PG_FUNCTION_ARGS)
 		cachedExprQueryState = &localState;
 	}
 
+	/* Share a field directory across the field paths referenced in the $expr */
+	const ExpressionVariableContext *variableContext =
+		cachedExprQueryState->variableContext;
+	ExpressionVariableContext documentVariableContext = { 0 };
+	PgbsonFieldDirectory documentDirectory;
+	if (EnableDocumentFieldDirectory)
+	{
+		PgbsonFieldDirectoryInit(&documentDirectory, document);
+		documentVariableContext.parent = cachedExprQueryState->variableContext;
+		documentVariableContext.documentDirectory = &documentDirectory;
+		variableContext = &documentVariableContext;
+	}
+
 	pgbson_writer writer;
 	PgbsonWriterInit(&writer);
 	bool isNullOnEmpty = false;
@@ -1691,9 +1721,14 @@ bson_dollar_expr(PG_FUNCTION_ARGS)
 	EvaluateAggregationExpressionDataToWriter(
 		cachedExprQueryState->expression,
 		document, emptyPathView, &writer,
-		cachedExprQueryState->variableContext,
+		variableContext,
 		isNullOnEmpty);
 
+	if (EnableDocumentFieldDirectory)
+	{
+		PgbsonFieldDirectoryFree(&documentDirectory);
+	}
+
 	bson_iter_t resultIterator;
 	PgbsonWriterGetIterator(&writer, &resultIterator);
 
@@ -2848,6 +2883,26 @@ CompareBsonAgainstQuery(const pgbson *element,
 }
 
 
+/*
+ * Gets the document to evaluate a single path filter against. The filter
+ * is of the form { "path": <value> }: Since only the first top level field
+ * matching the path is traversed, large toasted documents only need to be
+ * detoasted up to that field.
+ */
+static pgbson *
+GetDocumentForFilterPath(Datum documentDatum, const pgbson *filter)
+{
+	bson_iter_t filterIterator;
+	PgbsonInitIterator(filter, &filterIterator);
+	if (!bson_iter_next(&filterIterator))
+	{
+		return DatumGetPgBson(documentDatum);
+	}
+
+	return DatumGetPgBsonForPath(documentDatum, bson_iter_key(&filterIterator));
+}
+
+
 /*
  * Implements the core logic of <value> $eq <value>
  */
@@ -3009,7 +3064,13 @@ CompareInMatch(const pgbsonelement *documentIterator,
 
 	/* 2: verify if document matches with any entry of $in which are hashed */
 	const char *collationString = inValidationState->traverseState.collationString;
-	if (IsCollationApplicable(collationString))
+	if (!inValidationState->hashedSortOrderTypes[
+			(uint8_t) documentIterator->bsonValue.value_type])
+	{
+		/* Values only compare equal within a sort order type: skip hashing the value */
+		match = false;
+	}
+	else if (IsCollationApplicable(collationString))
 	{
 		BsonValueHashEntry hashEntry = {
 			.bsonValue = documentIterator->bsonValue,
@@ -3475,6 +3536,18 @@ PopulateElemMatchStateFromQuery(BsonElemMatchQueryState *state, const pgbson *fi
 		&filterElement.bsonValue,
 		CurrentMemoryContext,
 		state->collationString);
+
+	/*
+	 * The document elements of the array are evaluated by the compiled program
+	 * when the filter can be compiled (it compares strings without collation).
+	 */
+	if (EnableCompiledQueryPredicates && !state->isEmptyElemMatch &&
+		!IsCollationApplicable(state->collationString))
+	{
+		state->expressionEvaluationState->compiledProgram =
+			TryCompileQueryPredicateProgram(&filterElement.bsonValue);
+	}
+
 	state->filterElement = filterElement;
 }
 
@@ -3747,6 +3820,8 @@ PopulateDollarInValidationState(PG_FUNCTION_ARGS,
 	state->hasNull = dollarInState->hasNull;
 	state->regexList = dollarInState->regexList;
 	state->bsonValueHashSet = dollarInState->bsonValueHashSet;
+	memcpy(state->hashedSortOrderTypes, dollarInState->hashedSortOrderTypes,
+		   sizeof(state->hashedSortOrderTypes));
 }
 
 
@@ -3779,16 +3854,20 @@ PopulateDollarInStateFromQuery(BsonDollarInQueryState *dollarInState,
 	dollarInState->filterElement = filterElement;
 	dollarInState->regexList = NIL;
 
-	/* Generate a hash table for the $in input array, which is created per query and automatically destroyed after query execution. */
+	/*
+	 * Generate a hash table for the $in input array, which is created per query and automatically destroyed after query execution.
+	 * The table is sized for the array upfront since $in arrays can have tens of thousands of entries.
+	 */
+	long numElements = Max(BsonDocumentValueCountKeys(&filterElement.bsonValue), 1);
 	if (IsCollationApplicable(dollarInState->collationString))
 	{
 		int metadataSize = 0;
-		dollarInState->bsonValueHashSet = CreateBsonValueWithCollationHashSet(
-			metadataSize);
+		dollarInState->bsonValueHashSet = CreateBsonValueWithCollationHashSetWithSize(
+			metadataSize, numElements);
 	}
 	else
 	{
-		dollarInState->bsonValueHashSet = CreateBsonValueHashSet();
+		dollarInState->bsonValueHashSet = CreateBsonValueHashSetWithSize(numElements);
 	}
 
 	while (bson_iter_next(&arrayIterator))
@@ -3811,6 +3890,8 @@ PopulateDollarInStateFromQuery(BsonDollarInQueryState *dollarInState,
 		else
 		{
 			bool found = false;
+			MarkHashedSortOrderType(dollarInState->hashedSortOrderTypes,
+									arrayValue->value_type);
 
 			if (IsCollationApplicable(collationString))
 			{
@@ -3832,6 +3913,31 @@ PopulateDollarInStateFromQuery(BsonDollarInQueryState *dollarInState,
 }
 
 
+/*
+ * Marks every bson type that shares the sort order type of the given type as
+ * potentially matching an entry of the $in hash set.
+ */
+static void
+MarkHashedSortOrderType(bool *hashedSortOrderTypes, bson_type_t type)
+{
+	if (hashedSortOrderTypes[(uint8_t) type])
+	{
+		return;
+	}
+
+	for (int typeIndex = 0; typeIndex <= UINT8_MAX; typeIndex++)
+	{
+		bson_type_t candidateType = (bson_type_t) typeIndex;
+		if ((candidateType <= BSON_TYPE_DECIMAL128 || candidateType == BSON_TYPE_MAXKEY ||
+			 candidateType == BSON_TYPE_MINKEY) &&
+			CompareSortOrderType(candidateType, type) == 0)
+		{
+			hashedSortOrderTypes[typeIndex] = true;
+		}
+	}
+}
+
+
 /*
  * Checks if a single value in a pgbsonelement is null.
  * Used in $eq/$ne/$gte/$lte scenarios to validate that the filter is null to apply
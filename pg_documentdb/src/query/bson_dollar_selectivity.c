@@ -9,16 +9,25 @@
  */
 #include <postgres.h>
 #include <fmgr.h>
+#include <access/genam.h>
+#include <access/relscan.h>
 #include <utils/lsyscache.h>
+#include <utils/rel.h>
 #include <nodes/pathnodes.h>
 #include <utils/selfuncs.h>
 #include <metadata/metadata_cache.h>
 #include <planner/mongo_query_operator.h>
 
+#include "io/bson_analyze.h"
+#include "index_am/index_am_utils.h"
+#include "opclass/bson_gin_index_mgmt.h"
+#include "query/bson_compare.h"
 #include "query/bson_dollar_selectivity.h"
 
 extern bool EnableNewOperatorSelectivityMode;
 extern bool LowSelectivityForLookup;
+extern bool EnableBsonPathStatistics;
+extern int SelectivityIndexProbeMaxTuples;
 
 
 static double GetStatisticsNoStatsData(List *args, Oid selectivityOpExpr, double
@@ -27,6 +36,24 @@ static double GetStatisticsNoStatsData(List *args, Oid selectivityOpExpr, double
 static double GetDisableStatisticSelectivity(List *args, double
 											 defaultDisabledSelectivity);
 
+static const MongoIndexOperatorInfo * GetIndexOperatorForSelectivity(Oid
+																	 selectivityOpExpr,
+																	 Const *secondConst);
+static bool TryGetPathStatisticsSelectivity(PlannerInfo *planner, Oid selectivityOpExpr,
+											List *args, int varRelId,
+											double *selectivity);
+static bool TryGetIndexProbeSelectivity(PlannerInfo *planner, Oid selectivityOpExpr,
+										List *args, int varRelId,
+										double defaultSelectivity,
+										double *selectivity);
+static int64 CountIndexProbeMatches(Oid indexOid, BsonIndexStrategy strategy,
+									Datum queryValue, int64 maxTuples);
+static bool TryGetPathEqualitySelectivity(AttStatsSlot *sslot,
+										  const pgbsonelement *queryElement,
+										  const BsonPathStatisticsEntry *summary,
+										  double existsFraction,
+										  double *selectivity);
+
 PG_FUNCTION_INFO_V1(bson_dollar_selectivity);
 
 
@@ -77,9 +104,25 @@ GetDollarOperatorSelectivity(PlannerInfo *planner, Oid selectivityOpExpr,
 		return GetDisableStatisticSelectivity(args, defaultExprSelectivity);
 	}
 
+	double pathSelectivity;
+	if (EnableBsonPathStatistics &&
+		TryGetPathStatisticsSelectivity(planner, selectivityOpExpr, args, varRelId,
+										&pathSelectivity))
+	{
+		return pathSelectivity;
+	}
+
 	double defaultInputSelectivity = GetStatisticsNoStatsData(args, selectivityOpExpr,
 															  defaultExprSelectivity);
 
+	double probeSelectivity;
+	if (SelectivityIndexProbeMaxTuples > 0 &&
+		TryGetIndexProbeSelectivity(planner, selectivityOpExpr, args, varRelId,
+									defaultInputSelectivity, &probeSelectivity))
+	{
+		return probeSelectivity;
+	}
+
 	/*
 	 * This is Postgres's default selectivity implementation that looks at statistics
 	 * and gets the Most common values/ histograms and gets the overall selectivity
@@ -120,17 +163,8 @@ GetStatisticsNoStatsData(List *args, Oid selectivityOpExpr, double defaultExprSe
 	}
 
 	Const *secondConst = (Const *) secondNode;
-	const MongoIndexOperatorInfo *indexOp;
-	if (secondConst->consttype == BsonQueryTypeId())
-	{
-		Oid selectFuncId = get_opcode(selectivityOpExpr);
-		indexOp = GetMongoIndexOperatorInfoByPostgresFuncId(selectFuncId);
-	}
-	else
-	{
-		/* This is an index pushdown operator */
-		indexOp = GetMongoIndexOperatorByPostgresOperatorId(selectivityOpExpr);
-	}
+	const MongoIndexOperatorInfo *indexOp = GetIndexOperatorForSelectivity(
+		selectivityOpExpr, secondConst);
 
 	if (indexOp->indexStrategy == BSON_INDEX_STRATEGY_INVALID)
 	{
@@ -200,6 +234,318 @@ GetStatisticsNoStatsData(List *args, Oid selectivityOpExpr, double defaultExprSe
 }
 
 
+/*
+ * Gets the operator info for the operator being estimated given its
+ * constant query argument.
+ */
+static const MongoIndexOperatorInfo *
+GetIndexOperatorForSelectivity(Oid selectivityOpExpr, Const *secondConst)
+{
+	if (secondConst->consttype == BsonQueryTypeId())
+	{
+		Oid selectFuncId = get_opcode(selectivityOpExpr);
+		return GetMongoIndexOperatorInfoByPostgresFuncId(selectFuncId);
+	}
+	else
+	{
+		/* This is an index pushdown operator */
+		return GetMongoIndexOperatorByPostgresOperatorId(selectivityOpExpr);
+	}
+}
+
+
+/*
+ * Estimates the selectivity of $eq, $ne and $exists on a top level path using
+ * the per path statistics collected by ANALYZE (see bson_typanalyze).
+ * Returns false if there are no statistics that apply to the operator.
+ */
+static bool
+TryGetPathStatisticsSelectivity(PlannerInfo *planner, Oid selectivityOpExpr,
+								List *args, int varRelId, double *selectivity)
+{
+	if (list_length(args) != 2 || !IsA(lsecond(args), Const))
+	{
+		return false;
+	}
+
+	Const *secondConst = (Const *) lsecond(args);
+	if (secondConst->constisnull)
+	{
+		return false;
+	}
+
+	const MongoIndexOperatorInfo *indexOp = GetIndexOperatorForSelectivity(
+		selectivityOpExpr, secondConst);
+	if (indexOp->indexStrategy != BSON_INDEX_STRATEGY_DOLLAR_EQUAL &&
+		indexOp->indexStrategy != BSON_INDEX_STRATEGY_DOLLAR_NOT_EQUAL &&
+		indexOp->indexStrategy != BSON_INDEX_STRATEGY_DOLLAR_EXISTS)
+	{
+		return false;
+	}
+
+	pgbsonelement queryElement;
+	PgbsonToSinglePgbsonElement(DatumGetPgBson(secondConst->constvalue),
+								&queryElement);
+	if (memchr(queryElement.path, '.', queryElement.pathLength) != NULL)
+	{
+		/* Statistics are only collected for top level paths */
+		return false;
+	}
+
+	VariableStatData vardata;
+	examine_variable(planner, linitial(args), varRelId, &vardata);
+
+	AttStatsSlot sslot;
+	if (!HeapTupleIsValid(vardata.statsTuple) ||
+		!get_attstatsslot(&sslot, vardata.statsTuple, BSON_STATISTIC_KIND_PATH_STATS,
+						  InvalidOid, ATTSTATSSLOT_VALUES | ATTSTATSSLOT_NUMBERS))
+	{
+		ReleaseVariableStats(vardata);
+		return false;
+	}
+
+	StringView queryPath = {
+		.string = queryElement.path, .length = queryElement.pathLength
+	};
+
+	bool hasSummary = false;
+	BsonPathStatisticsEntry summary = { 0 };
+	double existsFraction = 0;
+	for (int i = 0; i < sslot.nvalues && !hasSummary; i++)
+	{
+		ParseBsonPathStatisticsEntry(DatumGetPgBson(sslot.values[i]), &summary);
+		if (summary.isSummary && StringViewEquals(&summary.path, &queryPath))
+		{
+			hasSummary = true;
+			existsFraction = sslot.numbers[i];
+		}
+	}
+
+	bool result = false;
+	if (hasSummary)
+	{
+		switch (indexOp->indexStrategy)
+		{
+			case BSON_INDEX_STRATEGY_DOLLAR_EXISTS:
+			{
+				int32_t value = BsonValueAsInt32(&queryElement.bsonValue);
+				*selectivity = value > 0 ? existsFraction : 1.0 - existsFraction;
+				result = true;
+				break;
+			}
+
+			case BSON_INDEX_STRATEGY_DOLLAR_EQUAL:
+			{
+				result = TryGetPathEqualitySelectivity(&sslot, &queryElement, &summary,
+													   existsFraction, selectivity);
+				break;
+			}
+
+			case BSON_INDEX_STRATEGY_DOLLAR_NOT_EQUAL:
+			{
+				double equalitySelectivity = 0;
+				result = TryGetPathEqualitySelectivity(&sslot, &queryElement, &summary,
+													   existsFraction,
+													   &equalitySelectivity);
+				*selectivity = 1.0 - equalitySelectivity;
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+	}
+
+	free_attstatsslot(&sslot);
+	ReleaseVariableStats(vardata);
+
+	if (result)
+	{
+		CLAMP_PROBABILITY(*selectivity);
+	}
+
+	return result;
+}
+
+
+/*
+ * Estimates the selectivity of an $eq on a path with a single path index by
+ * counting the index entries for the term, the same way postgres probes an
+ * index for the actual endpoints of a range. The count stops at
+ * SelectivityIndexProbeMaxTuples: If the term has more entries, the probe only
+ * gives a lower bound for the default selectivity.
+ */
+static bool
+TryGetIndexProbeSelectivity(PlannerInfo *planner, Oid selectivityOpExpr, List *args,
+							int varRelId, double defaultSelectivity,
+							double *selectivity)
+{
+	if (list_length(args) != 2 || !IsA(linitial(args), Var) ||
+		!IsA(lsecond(args), Const) || planner == NULL ||
+		varRelId <= 0 || varRelId >= planner->simple_rel_array_size)
+	{
+		return false;
+	}
+
+	RelOptInfo *rel = planner->simple_rel_array[varRelId];
+	Var *documentVar = (Var *) linitial(args);
+	Const *secondConst = (Const *) lsecond(args);
+	if (rel == NULL || rel->indexlist == NIL || rel->tuples < 1 ||
+		secondConst->constisnull)
+	{
+		return false;
+	}
+
+	const MongoIndexOperatorInfo *indexOp = GetIndexOperatorForSelectivity(
+		selectivityOpExpr, secondConst);
+	if (indexOp->indexStrategy != BSON_INDEX_STRATEGY_DOLLAR_EQUAL)
+	{
+		return false;
+	}
+
+	pgbsonelement queryElement;
+	PgbsonToSinglePgbsonElement(DatumGetPgBson(secondConst->constvalue),
+								&queryElement);
+	bson_type_t queryType = queryElement.bsonValue.value_type;
+	if (queryType == BSON_TYPE_NULL || queryType == BSON_TYPE_REGEX)
+	{
+		/* These match documents that have no entry for the term */
+		return false;
+	}
+
+	ListCell *indexCell;
+	foreach(indexCell, rel->indexlist)
+	{
+		IndexOptInfo *index = (IndexOptInfo *) lfirst(indexCell);
+		if (index->nkeycolumns != 1 || index->indexkeys[0] != documentVar->varattno ||
+			index->indpred != NIL || !index->amhasgettuple ||
+			index->opclassoptions == NULL || index->opclassoptions[0] == NULL ||
+			!IsBsonRegularIndexAm(index->relam) ||
+			!IsSinglePathOpFamilyOid(index->relam, index->opfamily[0]))
+		{
+			continue;
+		}
+
+		if (!ValidateIndexForQualifierValue(index->opclassoptions[0],
+											secondConst->constvalue,
+											BSON_INDEX_STRATEGY_DOLLAR_EQUAL))
+		{
+			continue;
+		}
+
+		int64 matches = CountIndexProbeMatches(index->indexoid,
+											   BSON_INDEX_STRATEGY_DOLLAR_EQUAL,
+											   secondConst->constvalue,
+											   SelectivityIndexProbeMaxTuples);
+		if (matches >= SelectivityIndexProbeMaxTuples)
+		{
+			*selectivity = Max(defaultSelectivity, matches / rel->tuples);
+		}
+		else
+		{
+			/* Like postgres, presume at least one row matches */
+			*selectivity = Max(matches, 1) / rel->tuples;
+		}
+
+		CLAMP_PROBABILITY(*selectivity);
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * Counts the entries of the index that match the query, up to maxTuples.
+ * This walks the index directly (without visiting the table) like the
+ * multikey checks of the RUM index do, so entries of dead rows are counted too.
+ */
+static int64
+CountIndexProbeMatches(Oid indexOid, BsonIndexStrategy strategy, Datum queryValue,
+					   int64 maxTuples)
+{
+	Relation indexRelation = index_open(indexOid, AccessShareLock);
+	IndexAmRoutine *indexRoutine = indexRelation->rd_indam;
+
+	IndexScanDesc scan = indexRoutine->ambeginscan(indexRelation, 1, 0);
+
+	ScanKeyData probeKey = { 0 };
+	probeKey.sk_attno = 1;
+	probeKey.sk_collation = InvalidOid;
+	probeKey.sk_strategy = strategy;
+	probeKey.sk_argument = queryValue;
+	indexRoutine->amrescan(scan, &probeKey, 1, NULL, 0);
+
+	int64 matches = 0;
+	while (matches < maxTuples &&
+		   indexRoutine->amgettuple(scan, ForwardScanDirection))
+	{
+		matches++;
+	}
+
+	indexRoutine->amendscan(scan);
+	index_close(indexRelation, AccessShareLock);
+	return matches;
+}
+
+
+/*
+ * Estimates the selectivity of an equality on a top level path from its
+ * most common values. Values that are not among the most common values are
+ * assumed to share the remaining fraction of documents with the path evenly
+ * with the other values tracked during sampling.
+ */
+static bool
+TryGetPathEqualitySelectivity(AttStatsSlot *sslot, const pgbsonelement *queryElement,
+							  const BsonPathStatisticsEntry *summary,
+							  double existsFraction, double *selectivity)
+{
+	bson_type_t queryType = queryElement->bsonValue.value_type;
+	if (summary->hasArrays || summary->sampleRows <= 0 ||
+		queryType == BSON_TYPE_NULL || queryType == BSON_TYPE_ARRAY ||
+		queryType == BSON_TYPE_DOCUMENT || queryType == BSON_TYPE_REGEX)
+	{
+		/* These can match documents that don't have the same value at the path */
+		return false;
+	}
+
+	double mcvFraction = 0;
+	int numMcvs = 0;
+	for (int i = 0; i < sslot->nvalues; i++)
+	{
+		BsonPathStatisticsEntry entry;
+		ParseBsonPathStatisticsEntry(DatumGetPgBson(sslot->values[i]), &entry);
+		if (entry.isSummary || !StringViewEquals(&entry.path, &summary->path))
+		{
+			continue;
+		}
+
+		if (BsonValueEquals(&entry.value, &queryElement->bsonValue))
+		{
+			*selectivity = sslot->numbers[i];
+			return true;
+		}
+
+		mcvFraction += sslot->numbers[i];
+		numMcvs++;
+	}
+
+	if (summary->isComplete)
+	{
+		/* Every distinct value was tracked and this one wasn't common in the sample */
+		*selectivity = 1.0 / summary->sampleRows;
+		return true;
+	}
+
+	double remainingFraction = Max(existsFraction - mcvFraction, 0);
+	int otherValues = Max(summary->trackedValues - numMcvs, 1);
+	*selectivity = remainingFraction / otherValues;
+	return true;
+}
+
+
 /*
  * Legacy function for compat to restore prior value to
  * implementing selectivity.
@@ -18,9 +18,12 @@
 
 #include "operators/bson_expr_eval.h"
 #include "query/query_operator.h"
+#include "query/bson_compiled_predicate.h"
 #include "utils/documentdb_errors.h"
 #include "metadata/metadata_cache.h"
 
+extern bool EnableCompiledQueryPredicates;
+extern bool EnableBatchPredicateEvaluation;
 
 /* --------------------------------------------------------- */
 /* Data-types */
@@ -139,6 +142,22 @@ EvalBooleanExpressionAgainstArray(ExprEvalState *evalState, const
 	while (bson_iter_next(&arrayIterator))
 	{
 		BsonIterToPgbsonElement(&arrayIterator, &element);
+
+		/* Document elements are evaluated by the compiled program when possible */
+		bool matched = false;
+		if (evalState->compiledProgram != NULL &&
+			element.bsonValue.value_type == BSON_TYPE_DOCUMENT &&
+			EvaluateCompiledPredicateProgram(evalState->compiledProgram,
+											 &element.bsonValue, &matched))
+		{
+			if (matched)
+			{
+				return true;
+			}
+
+			continue;
+		}
+
 		Datum result = ExpressionEval(evalState, &element);
 		if (DatumGetBool(result))
 		{
@@ -186,13 +205,58 @@ bool
 EvalBooleanExpressionAgainstBson(ExprEvalState *evalState,
 								 const bson_value_t *queryValue)
 {
+	bool matched = false;
+	if (evalState->compiledProgram != NULL &&
+		EvaluateCompiledPredicateProgram(evalState->compiledProgram, queryValue,
+										 &matched))
+	{
+		return matched;
+	}
+
 	pgbson *bson = PgbsonInitFromDocumentBsonValue(queryValue);
-	bool matched = DatumGetBool(ExpressionEvalForBson(evalState, bson));
+	matched = DatumGetBool(ExpressionEvalForBson(evalState, bson));
 
 	return matched;
 }
 
 
+/*
+ * Evaluate a query expression against each of the provided documents and
+ * set whether it matched in matches. The compiled predicate program (if any)
+ * evaluates the documents as one batch; the documents it could not evaluate
+ * are evaluated one at a time.
+ */
+void
+EvalBooleanExpressionAgainstBsonBatch(ExprEvalState *evalState,
+									  const bson_value_t *documents, int numDocuments,
+									  bool *matches)
+{
+	if (evalState->compiledProgram == NULL || !EnableBatchPredicateEvaluation)
+	{
+		for (int i = 0; i < numDocuments; i++)
+		{
+			matches[i] = EvalBooleanExpressionAgainstBson(evalState, &documents[i]);
+		}
+
+		return;
+	}
+
+	bool *isEvaluated = palloc(sizeof(bool) * Max(numDocuments, 1));
+	EvaluateCompiledPredicateProgramBatch(evalState->compiledProgram, documents,
+										  numDocuments, matches, isEvaluated);
+	for (int i = 0; i < numDocuments; i++)
+	{
+		if (!isEvaluated[i])
+		{
+			pgbson *bson = PgbsonInitFromDocumentBsonValue(&documents[i]);
+			matches[i] = DatumGetBool(ExpressionEvalForBson(evalState, bson));
+		}
+	}
+
+	pfree(isEvaluated);
+}
+
+
 /*
  * Evaluate a query expression against every element of the array
  * and for each element check whether the query returns a match.
@@ -332,6 +396,13 @@ GetExpressionEvalStateForBsonInput(const bson_value_t *expression, MemoryContext
 	context.hasOperatorRestrictions = hasOperatorRestrictions;
 	Expr *expr = CreateQualForBsonExpression(expression, NULL, &context);
 	ExprEvalState *evalState = CreateEvalStateFromExpr(expr, BsonTypeId());
+
+	/* The query operators above still validate the expression and serve as the fallback */
+	if (EnableCompiledQueryPredicates)
+	{
+		evalState->compiledProgram = TryCompileQueryPredicateProgram(expression);
+	}
+
 	MemoryContextSwitchTo(originalMemoryContext);
 	return evalState;
 }
@@ -383,6 +454,12 @@ FreeExprEvalState(ExprEvalState *exprEvalState, MemoryContext memoryContext)
 			exprEvalState->tupleSlot = NULL;
 		}
 
+		if (exprEvalState->compiledProgram != NULL)
+		{
+			FreeCompiledPredicateProgram(exprEvalState->compiledProgram);
+			exprEvalState->compiledProgram = NULL;
+		}
+
 		pfree(exprEvalState);
 
 		MemoryContextSwitchTo(originalMemoryContext);
@@ -406,6 +483,7 @@ CreateEvalStateFromExpr(Expr *expression, Oid attributeOid)
 	evalState->exprState = ExecPrepareExpr(expression, evalState->estate);
 	evalState->exprContext = GetPerTupleExprContext(evalState->estate);
 	evalState->datums = palloc(sizeof(Datum));
+	evalState->compiledProgram = NULL;
 
 	TupleDesc tupleDescriptor = CreateTemplateTupleDesc(1);
 
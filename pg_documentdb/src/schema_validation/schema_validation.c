@@ -14,6 +14,7 @@
 #include "schema_validation/schema_validation.h"
 #include "metadata/collection.h"
 #include "utils/documentdb_errors.h"
+#include "infrastructure/wait_events.h"
 
 extern bool EnableSchemaValidation;
 PG_FUNCTION_INFO_V1(command_schema_validation_against_update);
@@ -111,7 +112,10 @@ void
 ValidateSchemaOnDocumentInsert(ExprEvalState *evalState, const bson_value_t *document,
 							   const char *errMsg)
 {
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_SchemaValidation);
 	bool matched = EvalBooleanExpressionAgainstBson(evalState, document);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
 	if (!matched)
 	{
 		/* todo: additional information about the cause of the failure */
@@ -121,6 +125,38 @@ ValidateSchemaOnDocumentInsert(ExprEvalState *evalState, const bson_value_t *doc
 }
 
 
+/*
+ * Validate a batch of documents against the schema validator, throwing an error
+ * if any of the documents does not match it. Same as ValidateSchemaOnDocumentInsert,
+ * but lets the validator evaluate the documents as one batch.
+ */
+void
+ValidateSchemaOnDocumentsInsert(ExprEvalState *evalState, const bson_value_t *documents,
+								int numDocuments, const char *errMsg)
+{
+	if (numDocuments <= 0)
+	{
+		return;
+	}
+
+	bool *matches = palloc(sizeof(bool) * numDocuments);
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_SchemaValidation);
+	EvalBooleanExpressionAgainstBsonBatch(evalState, documents, numDocuments, matches);
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
+	for (int i = 0; i < numDocuments; i++)
+	{
+		if (!matches[i])
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_DOCUMENTFAILEDVALIDATION),
+							errmsg("%s", errMsg)));
+		}
+	}
+
+	pfree(matches);
+}
+
+
 /*
  * Validate documents with the schema validator during updates.
  * If validationAction is 'warn', skip validation.
@@ -135,25 +171,25 @@ ValidateSchemaOnDocumentUpdate(ValidationLevels validationLevel,
 							   const pgbson *targetDocument,
 							   const char *errMsg)
 {
+	uint32 previousWaitEventInfo =
+		ReportDocumentDBWaitStart(DocumentDBWaitEvent_SchemaValidation);
 	bson_value_t targetDocumentValue = ConvertPgbsonToBsonValue(targetDocument);
 	bool matched = EvalBooleanExpressionAgainstBson(evalState, &targetDocumentValue);
-	if (!matched)
+
+	/* moderate validation fails only if the source document matches the schema */
+	bool sourceMatched = false;
+	if (!matched && sourceDocument != NULL &&
+		validationLevel == ValidationLevel_Moderate)
 	{
-		if (validationLevel == ValidationLevel_Strict)
-		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_DOCUMENTFAILEDVALIDATION),
-							errmsg("%s", errMsg)));
-		}
-		else if (sourceDocument != NULL && validationLevel == ValidationLevel_Moderate)
-		{
-			bson_value_t sourceDocumentValue = ConvertPgbsonToBsonValue(sourceDocument);
-			matched = EvalBooleanExpressionAgainstBson(evalState, &sourceDocumentValue);
-
-			if (matched)
-			{
-				ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_DOCUMENTFAILEDVALIDATION),
-								errmsg("%s", errMsg)));
-			}
-		}
+		bson_value_t sourceDocumentValue = ConvertPgbsonToBsonValue(sourceDocument);
+		sourceMatched = EvalBooleanExpressionAgainstBson(evalState, &sourceDocumentValue);
+	}
+
+	ReportDocumentDBWaitEnd(previousWaitEventInfo);
+
+	if (!matched && (validationLevel == ValidationLevel_Strict || sourceMatched))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_DOCUMENTFAILEDVALIDATION),
+						errmsg("%s", errMsg)));
 	}
 }
@@ -15,6 +15,9 @@
 #include <lib/stringinfo.h>
 #include <utils/builtins.h>
 #include <nodes/makefuncs.h>
+#include <access/xact.h>
+#include <utils/snapmgr.h>
+#include <nodes/parsenodes.h>
 
 #include "io/bson_core.h"
 #include "api_hooks.h"
@@ -33,6 +36,7 @@ extern bool EnableNativeColocation;
 extern int ShardingMaxChunks;
 extern bool RecreateRetryTableOnSharding;
 extern char *ApiGucPrefixV2;
+extern int MaxTimeBucketsInShardKeyFilter;
 
 /* Metadata about shard keys - this is unchanged through
  * iterating though the query for the shard key.
@@ -42,8 +46,40 @@ typedef struct ShardKeyMetadata
 	/* ordered array of shard key fields */
 	const char **fields;
 	int fieldCount;
+
+	/* width of the buckets of a time bucketed shard key, 0 if it's hashed */
+	int64 timeBucketMs;
 } ShardKeyMetadata;
 
+/*
+ * A shard key path split into its dotted field names up front.
+ */
+typedef struct CompiledShardKeyPath
+{
+	/* the field names of the a.b.c path and their lengths */
+	const char **fields;
+	uint32_t *fieldLengths;
+	int fieldCount;
+} CompiledShardKeyPath;
+
+/*
+ * A shard key definition with its paths compiled once so that a batch
+ * of documents can be hashed without re-parsing the shard key per document.
+ */
+struct CompiledShardKey
+{
+	/* ordered array of shard key paths */
+	CompiledShardKeyPath *paths;
+	int pathCount;
+
+	/* scratch space for the values found in a document */
+	bson_value_t *values;
+	bool *found;
+
+	/* width of the buckets of a time bucketed shard key, 0 if it's hashed */
+	int64 timeBucketMs;
+};
+
 /*
  * ShardKeyFieldValues is used to keep track of shard key values in a query.
  * If we find a value for each shard key, then we will add a filter on
@@ -113,8 +149,27 @@ PG_FUNCTION_INFO_V1(command_validate_shard_key);
 PG_FUNCTION_INFO_V1(command_shard_collection);
 PG_FUNCTION_INFO_V1(command_reshard_collection);
 PG_FUNCTION_INFO_V1(command_unshard_collection);
+PG_FUNCTION_INFO_V1(command_reshard_collection_online);
 
 static bson_value_t FindShardKeyFieldValue(bson_iter_t *docIter, const char *path);
+static bson_value_t FindCompiledShardKeyPathValue(bson_iter_t *docIter,
+												  const CompiledShardKeyPath *path,
+												  int fieldIndex);
+static void ThrowIfInvalidShardKeyValue(bson_iter_t *valueIter);
+static int64 GetShardKeyTimeBucketMs(const pgbson *shardKeyDoc);
+static int64 TimeBucketUnitToMs(const char *unit);
+static bool TryGetTimeBucketShardKeyValue(const bson_value_t *value, int64 timeBucketMs,
+										  int64 *shardKeyValue);
+static int64 GetTimeBucketShardKeyValueForDocument(const bson_value_t *value,
+												   int64 timeBucketMs,
+												   const char *path);
+static Expr * CreateTimeBucketRangeFilter(bson_iter_t *queryDocIter,
+										  const ShardKeyMetadata *shardKeyMetadata,
+										  int collectionVarno);
+static void FindTimeBucketRangeForQuery(bson_iter_t *queryDocIter,
+										const ShardKeyMetadata *shardKeyMetadata,
+										int64 *minMs, bool *hasMin,
+										int64 *maxMs, bool *hasMax);
 
 static void InitShardKeyMetadata(pgbson *shardKeyBson,
 								 ShardKeyMetadata *shardKeyMetadata);
@@ -138,6 +193,25 @@ static Expr * FindShardKeyValuesExprNew(bson_iter_t *queryDocIter, int
 										bool *isShardKeyValueCollationAware);
 
 static void ShardCollectionCore(ShardCollectionArgs *args);
+static const char * CreateReshardDataTable(const ShardCollectionArgs *args,
+										   uint64 collectionId,
+										   const char *qualifiedDataTableName,
+										   const char *tmpDataTableName);
+static void SwapInReshardDataTable(uint64 collectionId, const char *tableName,
+								   const char *qualifiedDataTableName,
+								   const char *tmpDataTableName,
+								   const char *distributionColumn);
+static void ReshardCollectionOnline(ShardCollectionArgs *args, int batchSize,
+									int batchDelayMs, MemoryContext procedureContext);
+static void CommitReshardStep(MemoryContext procedureContext);
+static uint64 ReplayReshardChanges(const char *changeTableName,
+								   const char *qualifiedDataTableName,
+								   const char *tmpDataTableName,
+								   pgbson *shardKeyDefinition, uint64 collectionId,
+								   bool hasCreationTime, int batchSize);
+static void CopyReshardIndexDefinitions(const char *qualifiedDataTableName,
+										const char *tmpDataTableName,
+										bool constraints);
 static void ShardCollectionLegacy(PG_FUNCTION_ARGS);
 static void ParseShardCollectionRequest(pgbson *args, ShardCollectionArgs *shardArgs);
 static void ParseReshardCollectionRequest(pgbson *args, ShardCollectionArgs *shardArgs);
@@ -268,6 +342,60 @@ command_unshard_collection(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * command_reshard_collection_online reshards a collection without blocking
+ * writes for the length of the copy. It is a procedure that commits as it
+ * goes: the documents are copied into the new layout in chunks while the
+ * writes made meanwhile are captured, and only the final catch up and the
+ * table swap run with writes blocked.
+ */
+Datum
+command_reshard_collection_online(PG_FUNCTION_ARGS)
+{
+	if (PG_ARGISNULL(0))
+	{
+		ereport(ERROR, (errmsg("Argument value must not be NULL")));
+	}
+
+	bool isNonAtomic = fcinfo->context != NULL && IsA(fcinfo->context, CallContext) &&
+					   !castNode(CallContext, fcinfo->context)->atomic;
+	if (!isNonAtomic)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_OPERATIONNOTSUPPORTEDINTRANSACTION),
+						errmsg(
+							"Cannot run an online reshardCollection in a multi-document transaction.")));
+	}
+
+	if (!IsMetadataCoordinator())
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_COMMANDNOTSUPPORTED),
+						errmsg(
+							"An online reshardCollection must be run on the metadata coordinator.")));
+	}
+
+	pgbson *shardArg = PG_GETARG_PGBSON(0);
+	int batchSize = PG_ARGISNULL(1) ? 10000 : PG_GETARG_INT32(1);
+	int batchDelayMs = PG_ARGISNULL(2) ? 0 : PG_GETARG_INT32(2);
+
+	if (batchSize <= 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg("batch size must be a positive number")));
+	}
+
+	if (batchDelayMs < 0)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg("batch delay must not be negative")));
+	}
+
+	ShardCollectionArgs args = { 0 };
+	ParseReshardCollectionRequest(shardArg, &args);
+	ReshardCollectionOnline(&args, batchSize, batchDelayMs, CurrentMemoryContext);
+	PG_RETURN_VOID();
+}
+
+
 /*
  * command_get_shard_key_value generates the shard key value for a given
  * shard key and document. Returns the collection_id if there's no shard_key.
@@ -302,9 +430,21 @@ ComputeShardKeyHashForDocument(pgbson *shardKeyDoc, uint64_t collectionId,
 	}
 
 	int64 shardKeyValue = 0;
+	int64 timeBucketMs = GetShardKeyTimeBucketMs(shardKeyDoc);
 
 	bson_iter_t shardKeyIterator;
 	PgbsonInitIterator(shardKeyDoc, &shardKeyIterator);
+	if (timeBucketMs > 0 && bson_iter_next(&shardKeyIterator))
+	{
+		/* a time bucketed shard key has a single date field */
+		const char *shardKey = bson_iter_key(&shardKeyIterator);
+
+		bson_iter_t documentIterator;
+		PgbsonInitIterator(document, &documentIterator);
+		bson_value_t value = FindShardKeyFieldValue(&documentIterator, shardKey);
+		return GetTimeBucketShardKeyValueForDocument(&value, timeBucketMs, shardKey);
+	}
+
 	while (bson_iter_next(&shardKeyIterator))
 	{
 		const char *shardKey = bson_iter_key(&shardKeyIterator);
@@ -356,23 +496,7 @@ FindShardKeyFieldValue(bson_iter_t *docIter, const char *path)
 	{
 		if (!dot)
 		{
-			if (BSON_ITER_HOLDS_ARRAY(docIter))
-			{
-				ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-								errmsg(
-									"A shard key is not permitted to include any array elements.")));
-			}
-			else if (BSON_ITER_HOLDS_REGEX(docIter))
-			{
-				ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-								errmsg(
-									"A shard key is not allowed to include any regular expression pattern.")));
-			}
-			else if (BSON_ITER_HOLDS_UNDEFINED(docIter))
-			{
-				ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-								errmsg("Shard key cannot be undefined.")));
-			}
+			ThrowIfInvalidShardKeyValue(docIter);
 
 			/* found a specific value */
 			return *bson_iter_value(docIter);
@@ -403,6 +527,331 @@ FindShardKeyFieldValue(bson_iter_t *docIter, const char *path)
 }
 
 
+/*
+ * ThrowIfInvalidShardKeyValue throws an error if the value at the end of
+ * a shard key path is of a type that can't be part of a shard key.
+ */
+static void
+ThrowIfInvalidShardKeyValue(bson_iter_t *valueIter)
+{
+	if (BSON_ITER_HOLDS_ARRAY(valueIter))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg(
+							"A shard key is not permitted to include any array elements.")));
+	}
+	else if (BSON_ITER_HOLDS_REGEX(valueIter))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg(
+							"A shard key is not allowed to include any regular expression pattern.")));
+	}
+	else if (BSON_ITER_HOLDS_UNDEFINED(valueIter))
+	{
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg("Shard key cannot be undefined.")));
+	}
+}
+
+
+/*
+ * CompileShardKey splits the paths of the given shard key definition into
+ * their field names so that the shard key hash of many documents can be
+ * computed with ComputeShardKeyHashForCompiledKey. Returns NULL if there's
+ * no shard key.
+ */
+CompiledShardKey *
+CompileShardKey(pgbson *shardKeyDoc)
+{
+	if (shardKeyDoc == NULL)
+	{
+		return NULL;
+	}
+
+	CompiledShardKey *compiledKey = palloc0(sizeof(CompiledShardKey));
+	compiledKey->pathCount = PgbsonCountKeys(shardKeyDoc);
+	compiledKey->paths = palloc0(compiledKey->pathCount *
+								 sizeof(CompiledShardKeyPath));
+	compiledKey->values = palloc0(compiledKey->pathCount * sizeof(bson_value_t));
+	compiledKey->found = palloc0(compiledKey->pathCount * sizeof(bool));
+	compiledKey->timeBucketMs = GetShardKeyTimeBucketMs(shardKeyDoc);
+
+	bson_iter_t shardKeyIterator;
+	PgbsonInitIterator(shardKeyDoc, &shardKeyIterator);
+	for (int pathIndex = 0; bson_iter_next(&shardKeyIterator); pathIndex++)
+	{
+		const char *shardKeyPath = bson_iter_key(&shardKeyIterator);
+		CompiledShardKeyPath *path = &compiledKey->paths[pathIndex];
+
+		int fieldCount = 1;
+		for (const char *dot = strchr(shardKeyPath, '.'); dot != NULL;
+			 dot = strchr(dot + 1, '.'))
+		{
+			fieldCount++;
+		}
+
+		path->fieldCount = fieldCount;
+		path->fields = palloc(fieldCount * sizeof(const char *));
+		path->fieldLengths = palloc(fieldCount * sizeof(uint32_t));
+
+		const char *field = shardKeyPath;
+		for (int fieldIndex = 0; fieldIndex < fieldCount; fieldIndex++)
+		{
+			const char *dot = strchr(field, '.');
+			path->fields[fieldIndex] = field;
+			path->fieldLengths[fieldIndex] = dot != NULL ? (uint32_t) (dot - field) :
+											 (uint32_t) strlen(field);
+			field = dot != NULL ? dot + 1 : NULL;
+		}
+	}
+
+	return compiledKey;
+}
+
+
+/*
+ * ComputeShardKeyHashForCompiledKey computes the same shard key hash as
+ * ComputeShardKeyHashForDocument for a shard key compiled by CompileShardKey.
+ * The top level of the document is walked once for all the shard key paths
+ * rather than once per path. Returns the collection_id if there's no shard_key.
+ */
+int64
+ComputeShardKeyHashForCompiledKey(CompiledShardKey *compiledKey,
+								  uint64_t collectionId, pgbson *document)
+{
+	if (compiledKey == NULL)
+	{
+		return *(int64_t *) &collectionId;
+	}
+
+	memset(compiledKey->found, 0, compiledKey->pathCount * sizeof(bool));
+
+	int pathsRemaining = compiledKey->pathCount;
+	bson_iter_t documentIterator;
+	PgbsonInitIterator(document, &documentIterator);
+	while (pathsRemaining > 0 && bson_iter_next(&documentIterator))
+	{
+		const char *key = bson_iter_key(&documentIterator);
+		uint32_t keyLength = bson_iter_key_len(&documentIterator);
+		for (int pathIndex = 0; pathIndex < compiledKey->pathCount; pathIndex++)
+		{
+			const CompiledShardKeyPath *path = &compiledKey->paths[pathIndex];
+
+			/* like bson_iter_find_w_len, the first field with the name wins */
+			if (compiledKey->found[pathIndex] ||
+				path->fieldLengths[0] != keyLength ||
+				memcmp(path->fields[0], key, keyLength) != 0)
+			{
+				continue;
+			}
+
+			compiledKey->values[pathIndex] =
+				FindCompiledShardKeyPathValue(&documentIterator, path, 0);
+			compiledKey->found[pathIndex] = true;
+			pathsRemaining--;
+		}
+	}
+
+	if (compiledKey->timeBucketMs > 0)
+	{
+		bson_value_t value = { .value_type = BSON_TYPE_NULL };
+		if (compiledKey->found[0])
+		{
+			value = compiledKey->values[0];
+		}
+
+		return GetTimeBucketShardKeyValueForDocument(&value, compiledKey->timeBucketMs,
+													 compiledKey->paths[0].fields[0]);
+	}
+
+	int64 shardKeyValue = 0;
+	for (int pathIndex = 0; pathIndex < compiledKey->pathCount; pathIndex++)
+	{
+		bson_value_t value = { .value_type = BSON_TYPE_NULL };
+		if (compiledKey->found[pathIndex])
+		{
+			value = compiledKey->values[pathIndex];
+		}
+
+		/* use the current value as seed */
+		shardKeyValue = BsonValueHash(&value, shardKeyValue);
+	}
+
+	return shardKeyValue;
+}
+
+
+/*
+ * ComputeShardKeyHashesForDocuments computes the shard key hash of each of
+ * the given documents into shardKeyHashes, compiling the shard key once for
+ * the whole batch.
+ */
+void
+ComputeShardKeyHashesForDocuments(pgbson *shardKeyDoc, uint64_t collectionId,
+								  pgbson **documents, int documentCount,
+								  int64 *shardKeyHashes)
+{
+	CompiledShardKey *compiledKey = CompileShardKey(shardKeyDoc);
+	for (int documentIndex = 0; documentIndex < documentCount; documentIndex++)
+	{
+		shardKeyHashes[documentIndex] =
+			ComputeShardKeyHashForCompiledKey(compiledKey, collectionId,
+											  documents[documentIndex]);
+	}
+}
+
+
+/*
+ * FindCompiledShardKeyPathValue resolves the rest of a compiled shard key path
+ * given an iterator positioned on the field at fieldIndex of the path. Follows
+ * the same rules as FindShardKeyFieldValue.
+ */
+static bson_value_t
+FindCompiledShardKeyPathValue(bson_iter_t *docIter, const CompiledShardKeyPath *path,
+							  int fieldIndex)
+{
+	if (fieldIndex == path->fieldCount - 1)
+	{
+		ThrowIfInvalidShardKeyValue(docIter);
+
+		/* found a specific value */
+		return *bson_iter_value(docIter);
+	}
+
+	if (BSON_ITER_HOLDS_ARRAY(docIter))
+	{
+		/* shard key path that contains array is invalid */
+		ereport(ERROR, (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						errmsg(
+							"Shard key is not allowed to include array values or any array-derived elements.")));
+	}
+	else if (BSON_ITER_HOLDS_DOCUMENT(docIter))
+	{
+		bson_iter_t childIter;
+		if (bson_iter_recurse(docIter, &childIter) &&
+			bson_iter_find_w_len(&childIter, path->fields[fieldIndex + 1],
+								 path->fieldLengths[fieldIndex + 1]))
+		{
+			return FindCompiledShardKeyPathValue(&childIter, path, fieldIndex + 1);
+		}
+	}
+
+	const bson_value_t nullValue = {
+		.value_type = BSON_TYPE_NULL
+	};
+	return nullValue;
+}
+
+
+/*
+ * TimeBucketUnitToMs returns the width in milliseconds of the given time bucket
+ * unit, or 0 if the unit is not supported.
+ */
+static int64
+TimeBucketUnitToMs(const char *unit)
+{
+	if (strcmp(unit, "hour") == 0)
+	{
+		return 60 * 60 * 1000L;
+	}
+	else if (strcmp(unit, "day") == 0)
+	{
+		return 24 * 60 * 60 * 1000L;
+	}
+	else if (strcmp(unit, "week") == 0)
+	{
+		return 7 * 24 * 60 * 60 * 1000L;
+	}
+
+	return 0;
+}
+
+
+/*
+ * GetShardKeyTimeBucketMs returns the width of the buckets of a time bucketed
+ * shard key of the form { "<path>": { "timeBucket": "<unit>" } }, or 0 if
+ * the shard key is hashed.
+ */
+static int64
+GetShardKeyTimeBucketMs(const pgbson *shardKeyDoc)
+{
+	bson_iter_t shardKeyIterator;
+	PgbsonInitIterator(shardKeyDoc, &shardKeyIterator);
+	if (!bson_iter_next(&shardKeyIterator) ||
+		!BSON_ITER_HOLDS_DOCUMENT(&shardKeyIterator))
+	{
+		return 0;
+	}
+
+	bson_iter_t specIterator;
+	if (bson_iter_recurse(&shardKeyIterator, &specIterator) &&
+		bson_iter_find(&specIterator, "timeBucket") &&
+		BSON_ITER_HOLDS_UTF8(&specIterator))
+	{
+		return TimeBucketUnitToMs(bson_iter_utf8(&specIterator, NULL));
+	}
+
+	return 0;
+}
+
+
+/*
+ * TryGetTimeBucketShardKeyValue computes the shard_key_value of a value of a
+ * time bucketed shard key: the number of the bucket of dates since the epoch,
+ * so that documents close in time land on the same shard. A null value (or a
+ * missing field) hashes like it does for a hashed shard key. Returns false
+ * for any other type.
+ */
+static bool
+TryGetTimeBucketShardKeyValue(const bson_value_t *value, int64 timeBucketMs,
+							  int64 *shardKeyValue)
+{
+	if (value->value_type == BSON_TYPE_NULL)
+	{
+		*shardKeyValue = BsonValueHash(value, 0);
+		return true;
+	}
+
+	if (value->value_type != BSON_TYPE_DATE_TIME)
+	{
+		return false;
+	}
+
+	/* round down for dates before the epoch too */
+	int64 dateMs = value->value.v_datetime;
+	int64 bucket = dateMs / timeBucketMs;
+	if (dateMs % timeBucketMs < 0)
+	{
+		bucket--;
+	}
+
+	*shardKeyValue = bucket;
+	return true;
+}
+
+
+/*
+ * GetTimeBucketShardKeyValueForDocument is TryGetTimeBucketShardKeyValue for
+ * the value at the shard key path of a document, and throws for values that
+ * are not dates.
+ */
+static int64
+GetTimeBucketShardKeyValueForDocument(const bson_value_t *value, int64 timeBucketMs,
+									  const char *path)
+{
+	int64 shardKeyValue = 0;
+	if (!TryGetTimeBucketShardKeyValue(value, timeBucketMs, &shardKeyValue))
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_BADVALUE),
+						errmsg(
+							"The time bucketed shard key field %s must be a date, found %s",
+							path, BsonTypeName(value->value_type))));
+	}
+
+	return shardKeyValue;
+}
+
+
 /*
  * command_validate_shard_key throws an error if the given shard key
  * BSON is not valid for the current extension.
@@ -426,7 +875,38 @@ ValidateShardKey(const pgbson *shardKeyDoc)
 	{
 		const bson_value_t *value = bson_iter_value(&shardKeyIterator);
 
-		if (value->value_type == BSON_TYPE_UTF8)
+		if (value->value_type == BSON_TYPE_DOCUMENT)
+		{
+			/* A time bucketed shard key: { "<path>": { "timeBucket": "<unit>" } } */
+			bson_iter_t specIterator;
+			bson_iter_recurse(&shardKeyIterator, &specIterator);
+			if (!bson_iter_next(&specIterator) ||
+				strcmp(bson_iter_key(&specIterator), "timeBucket") != 0 ||
+				!BSON_ITER_HOLDS_UTF8(&specIterator) ||
+				bson_iter_next(&specIterator))
+			{
+				ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+								errmsg(
+									"Shard key value provided is invalid: only { \"timeBucket\": <unit> } documents are supported")));
+			}
+
+			const char *unit = bson_iter_utf8(&specIterator, NULL);
+			if (TimeBucketUnitToMs(unit) == 0)
+			{
+				ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+								errmsg(
+									"Time bucket unit provided is invalid: %s. Supported units are hour, day and week",
+									unit)));
+			}
+
+			if (PgbsonCountKeys(shardKeyDoc) != 1)
+			{
+				ereport(ERROR, (errcode(ERRCODE_INVALID_TEXT_REPRESENTATION),
+								errmsg(
+									"A time bucketed shard key must be the only field of the shard key")));
+			}
+		}
+		else if (value->value_type == BSON_TYPE_UTF8)
 		{
 			if (strcmp("hashed", value->value.v_utf8.str) != 0)
 			{
@@ -459,6 +939,8 @@ InitShardKeyMetadata(pgbson *shardKeyBson, ShardKeyMetadata *shardKeyMetadata)
 	{
 		shardKeyMetadata->fields[fieldIndex] = bson_iter_key(&shardKeyIter);
 	}
+
+	shardKeyMetadata->timeBucketMs = GetShardKeyTimeBucketMs(shardKeyBson);
 }
 
 
@@ -524,6 +1006,15 @@ ComputeShardKeyFieldValuesHash(ShardKeyFieldValues *shardKeyValues,
 							   bool *isShardKeyValueCollationAware)
 {
 	*shardKeyHash = 0;
+	if (shardKeyMetadata->timeBucketMs > 0)
+	{
+		/* dates are not collation aware, and other types can't be in the collection */
+		return shardKeyValues->setCount[0] > 0 &&
+			   TryGetTimeBucketShardKeyValue(&shardKeyValues->values[0],
+											 shardKeyMetadata->timeBucketMs,
+											 shardKeyHash);
+	}
+
 	bool checkCollationAware = false;
 	for (int fieldIndex = 0; fieldIndex < shardKeyMetadata->fieldCount; fieldIndex++)
 	{
@@ -1075,18 +1566,155 @@ ConsiderShardKeyFiltersForOrClauses(const ShardKeyMetadata *shardKeyMetadata,
 }
 
 
+/*
+ * CreateTimeBucketRangeFilter returns a filter on the shard_key_value of the
+ * buckets that a date range on a time bucketed shard key spans, as in
+ * {"<path>": {"$gte": <date>, "$lt": <date>}}, so the query only goes to the
+ * shards with those buckets. Returns NULL if the query has no range bounded
+ * on both ends or the range spans more than MaxTimeBucketsInShardKeyFilter
+ * buckets.
+ */
 static Expr *
-FindShardKeyValuesExprNew(bson_iter_t *queryDocIter,
-						  int collectionVarno,
-						  const ShardKeyMetadata *shardKeyMetadata,
-						  bool *isShardKeyValueCollationAware)
+CreateTimeBucketRangeFilter(bson_iter_t *queryDocIter,
+							const ShardKeyMetadata *shardKeyMetadata,
+							int collectionVarno)
 {
-	/* Phase 1, collect the shard keys from all the $eq and $ands
-	 * All top level $ors are collected separately as are $ins
-	 */
+	int64 minMs = PG_INT64_MIN;
+	int64 maxMs = PG_INT64_MAX;
+	bool hasMin = false;
+	bool hasMax = false;
+	FindTimeBucketRangeForQuery(queryDocIter, shardKeyMetadata, &minMs, &hasMin, &maxMs,
+								&hasMax);
+	if (!hasMin || !hasMax || minMs > maxMs)
+	{
+		return NULL;
+	}
+
+	bson_value_t bound = { .value_type = BSON_TYPE_DATE_TIME };
+	int64 minBucket = 0;
+	int64 maxBucket = 0;
+
+	bound.value.v_datetime = minMs;
+	TryGetTimeBucketShardKeyValue(&bound, shardKeyMetadata->timeBucketMs, &minBucket);
+	bound.value.v_datetime = maxMs;
+	TryGetTimeBucketShardKeyValue(&bound, shardKeyMetadata->timeBucketMs, &maxBucket);
+
+	if (maxBucket - minBucket >= MaxTimeBucketsInShardKeyFilter)
+	{
+		return NULL;
+	}
+
+	List *bucketFilters = NIL;
+	for (int64 bucket = minBucket; bucket <= maxBucket; bucket++)
+	{
+		Const *shardKeyValueConst = makeConst(INT8OID, -1, InvalidOid, 8,
+											  Int64GetDatum(bucket), false, true);
+		bucketFilters = lappend(bucketFilters,
+								CreateShardKeyValueFilter(collectionVarno,
+														  shardKeyValueConst));
+	}
+
+	if (list_length(bucketFilters) == 1)
+	{
+		return (Expr *) linitial(bucketFilters);
+	}
+
+	BoolExpr *logicalExpr = makeNode(BoolExpr);
+	logicalExpr->boolop = OR_EXPR;
+	logicalExpr->args = bucketFilters;
+	logicalExpr->location = -1;
+	return (Expr *) logicalExpr;
+}
+
+
+/*
+ * FindTimeBucketRangeForQuery narrows [minMs, maxMs] down to the dates allowed
+ * by the $gt, $gte, $lt and $lte filters on the time bucketed shard key field
+ * in the query and its $and clauses.
+ */
+static void
+FindTimeBucketRangeForQuery(bson_iter_t *queryDocIter,
+							const ShardKeyMetadata *shardKeyMetadata,
+							int64 *minMs, bool *hasMin, int64 *maxMs, bool *hasMax)
+{
+	while (bson_iter_next(queryDocIter))
+	{
+		const char *key = bson_iter_key(queryDocIter);
+
+		if (strcmp(key, "$and") == 0)
+		{
+			bson_iter_t andIterator;
+			if (!BSON_ITER_HOLDS_ARRAY(queryDocIter) ||
+				!bson_iter_recurse(queryDocIter, &andIterator))
+			{
+				continue;
+			}
+
+			while (bson_iter_next(&andIterator))
+			{
+				bson_iter_t andElementIterator;
+				if (BSON_ITER_HOLDS_DOCUMENT(&andIterator) &&
+					bson_iter_recurse(&andIterator, &andElementIterator))
+				{
+					FindTimeBucketRangeForQuery(&andElementIterator, shardKeyMetadata,
+												minMs, hasMin, maxMs, hasMax);
+				}
+			}
+
+			continue;
+		}
+
+		bson_iter_t operatorIterator;
+		if (key[0] == '$' || ShardKeyFieldIndex(shardKeyMetadata, key) != 0 ||
+			!BSON_ITER_HOLDS_DOCUMENT(queryDocIter) ||
+			!bson_iter_recurse(queryDocIter, &operatorIterator))
+		{
+			continue;
+		}
+
+		while (bson_iter_next(&operatorIterator))
+		{
+			if (!BSON_ITER_HOLDS_DATE_TIME(&operatorIterator))
+			{
+				continue;
+			}
+
+			const char *operatorName = bson_iter_key(&operatorIterator);
+			int64 dateMs = bson_iter_date_time(&operatorIterator);
+			if (strcmp(operatorName, "$gte") == 0 ||
+				(strcmp(operatorName, "$gt") == 0 && dateMs < PG_INT64_MAX))
+			{
+				int64 lowerMs = strcmp(operatorName, "$gt") == 0 ? dateMs + 1 : dateMs;
+				*minMs = Max(*minMs, lowerMs);
+				*hasMin = true;
+			}
+			else if (strcmp(operatorName, "$lte") == 0 ||
+					 (strcmp(operatorName, "$lt") == 0 && dateMs > PG_INT64_MIN))
+			{
+				int64 upperMs = strcmp(operatorName, "$lt") == 0 ? dateMs - 1 : dateMs;
+				*maxMs = Min(*maxMs, upperMs);
+				*hasMax = true;
+			}
+		}
+	}
+}
+
+
+static Expr *
+FindShardKeyValuesExprNew(bson_iter_t *queryDocIter,
+						  int collectionVarno,
+						  const ShardKeyMetadata *shardKeyMetadata,
+						  bool *isShardKeyValueCollationAware)
+{
+	/* Phase 1, collect the shard keys from all the $eq and $ands
+	 * All top level $ors are collected separately as are $ins
+	 */
 	ShardKeyFieldValues fieldValues;
 	InitShardKeyFieldValues(shardKeyMetadata, &fieldValues);
 
+	/* Keep a copy of the iterator to look for date ranges on the query afterwards */
+	bson_iter_t rangeQueryDocIter = *queryDocIter;
+
 	List *orClauses = NIL;
 	ShardKeyFieldValues inFieldValues;
 	InitShardKeyFieldValues(shardKeyMetadata, &inFieldValues);
@@ -1116,6 +1744,19 @@ FindShardKeyValuesExprNew(bson_iter_t *queryDocIter,
 		return inBasedKey;
 	}
 
+	/* For time bucketed shard keys, a date range maps to the buckets it spans */
+	if (shardKeyMetadata->timeBucketMs > 0)
+	{
+		Expr *rangeBasedKey = CreateTimeBucketRangeFilter(&rangeQueryDocIter,
+														  shardKeyMetadata,
+														  collectionVarno);
+		if (rangeBasedKey != NULL)
+		{
+			list_free_deep(orClauses);
+			return rangeBasedKey;
+		}
+	}
+
 	/* Now, fieldValues is populated with all the entries that are *required*
 	 * The orClauses & inClauses are populated with the $or and $in clauses
 	 */
@@ -1271,9 +1912,130 @@ ShardCollectionCore(ShardCollectionArgs *args)
 	char tmpDataTableName[NAMEDATALEN + 20];
 	sprintf(tmpDataTableName, "%s.%s_reshard", ApiDataSchemaName, collection->tableName);
 
+	const char *distributionColumn = CreateReshardDataTable(args, collection->collectionId,
+															qualifiedDataTableName,
+															tmpDataTableName);
+
+	/* apply the new shard key by re-inserting all data */
+	StringInfo queryInfo = makeStringInfo();
+	bool readOnly = false;
+
+	nargs = 2;
+	Oid insertArgTypes[2] = { BsonTypeId(), INT8OID };
+	Datum insertArgValues[2] = { 0 };
+	char insertArgNulls[2] = { ' ', ' ' };
+
+	if (args->shardKeyDefinition == NULL)
+	{
+		insertArgValues[0] = (Datum) 0;
+		insertArgNulls[0] = 'n';
+	}
+	else
+	{
+		insertArgValues[0] = PointerGetDatum(args->shardKeyDefinition);
+	}
+
+	insertArgValues[1] = UInt64GetDatum(collection->collectionId);
+
+	if (collection->mongoDataCreationTimeVarAttrNumber != -1)
+	{
+		appendStringInfo(queryInfo,
+						 "INSERT INTO %s (shard_key_value, object_id, document, creation_time)"
+						 " SELECT %s.get_shard_key_value($1, $2, document), object_id, document, creation_time"
+						 " FROM %s",
+						 tmpDataTableName, ApiInternalSchemaName, qualifiedDataTableName);
+	}
+	else
+	{
+		appendStringInfo(queryInfo,
+						 "INSERT INTO %s (shard_key_value, object_id, document)"
+						 " SELECT %s.get_shard_key_value($1, $2, document), object_id, document"
+						 " FROM %s",
+						 tmpDataTableName, ApiInternalSchemaName, qualifiedDataTableName);
+	}
+
+	ExtensionExecuteQueryWithArgsViaSPI(queryInfo->data, nargs, insertArgTypes,
+										insertArgValues, insertArgNulls, readOnly,
+										SPI_OK_INSERT, &isNull);
+
+	SwapInReshardDataTable(collection->collectionId, collection->tableName,
+						   qualifiedDataTableName, tmpDataTableName, distributionColumn);
+
+	/* Get all valid or in progress indexes and delete them from metadata entries related to the collection.
+	 * TODO(MX): This really should not be CommutativeWrites for the entire query. Ideally only hte DELETE itself
+	 * is commutative and is separate out from the other queries. This only really becomes a concern wiht MX
+	 * and so for now this is left as-is.
+	 */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 " WITH cte AS ("
+					 " DELETE FROM %s.collection_indexes WHERE collection_id = %lu RETURNING *)"
+					 " SELECT array_agg(%s.index_spec_as_bson(index_spec) ORDER BY index_id, '{}') FROM cte"
+					 " WHERE index_is_valid OR %s.index_build_is_in_progress(index_id)",
+					 ApiCatalogSchemaName, collection->collectionId,
+					 ApiInternalSchemaName, ApiInternalSchemaName);
+
+	bool isNullIndexSpecArray = true;
+	Datum indexSpecArray = RunQueryWithCommutativeWrites(queryInfo->data, 0, NULL, NULL,
+														 NULL, SPI_OK_SELECT,
+														 &isNullIndexSpecArray);
+
+	/* Create a vanilla RUM _id index but don't register it yet since we need to build it. */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "SELECT %s.create_builtin_id_index(collection_id => %lu, register_id_index => false)",
+					 ApiInternalSchemaName, collection->collectionId);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_SELECT, &isNull);
+
+	if (!isNullIndexSpecArray)
+	{
+		pgbson_writer createIndexesArgWriter;
+		PgbsonWriterInit(&createIndexesArgWriter);
+
+		PgbsonWriterAppendUtf8(&createIndexesArgWriter, "createIndexes", 13,
+							   args->collectionName);
+
+		pgbson_element_writer elementWriter;
+		PgbsonInitObjectElementWriter(&createIndexesArgWriter, &elementWriter,
+									  "indexes", 7);
+		PgbsonElementWriterWriteSQLValue(&elementWriter, isNullIndexSpecArray,
+										 indexSpecArray, RECORDARRAYOID);
+
+		/* Re-create valid indexes. */
+		pgbson *createIndexesMsg = PgbsonWriterGetPgbson(&createIndexesArgWriter);
+
+
+		/* Disable force GUCs and just follow the create index spec. */
+		int savedGUCLevel = NewGUCNestLevel();
+		SetGUCLocally(psprintf("%s.defaultUseCompositeOpClass", ApiGucPrefixV2), "false");
+
+		CreateIndexesArg createIndexesArg = ParseCreateIndexesArg(databaseDatum,
+																  createIndexesMsg);
+		bool skipCheckCollectionCreate = createIndexesArg.blocking;
+		bool uniqueIndexOnly = false;
+
+		/* We call it good if it doesn't throw. */
+		create_indexes_non_concurrently(databaseDatum, createIndexesArg,
+										skipCheckCollectionCreate, uniqueIndexOnly);
+
+		RollbackGUCChange(savedGUCLevel);
+	}
+}
+
+
+/*
+ * CreateReshardDataTable creates the data table that the documents of the
+ * collection are reinserted into with the new shard key of the request, and
+ * distributes it. Returns the distribution column of the new table.
+ */
+static const char *
+CreateReshardDataTable(const ShardCollectionArgs *args, uint64 collectionId,
+					   const char *qualifiedDataTableName, const char *tmpDataTableName)
+{
 	/* create a new table to reinsert the data into */
 	StringInfo queryInfo = makeStringInfo();
 	bool readOnly = false;
+	bool isNull = false;
 	appendStringInfo(queryInfo,
 					 "CREATE TABLE %s (LIKE %s INCLUDING ALL EXCLUDING INDEXES)",
 					 tmpDataTableName, qualifiedDataTableName);
@@ -1291,7 +2053,7 @@ ShardCollectionCore(ShardCollectionArgs *args)
 	{
 		appendStringInfo(queryInfo,
 						 "ALTER TABLE %s ADD CONSTRAINT shard_key_value_check CHECK (shard_key_value = '%lu'::bigint)",
-						 tmpDataTableName, collection->collectionId);
+						 tmpDataTableName, collectionId);
 	}
 	else
 	{
@@ -1302,7 +2064,7 @@ ShardCollectionCore(ShardCollectionArgs *args)
 						 quote_literal_cstr(PgbsonToHexadecimalString(
 												args->shardKeyDefinition)),
 						 FullBsonTypeName,
-						 collection->collectionId);
+						 collectionId);
 	}
 
 	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
@@ -1334,51 +2096,26 @@ ShardCollectionCore(ShardCollectionArgs *args)
 	DistributePostgresTable(tmpDataTableName, distributionColumn, colocateWith,
 							shardCount);
 
-	/* apply the new shard key by re-inserting all data */
-	resetStringInfo(queryInfo);
-
-	nargs = 2;
-	Oid insertArgTypes[2] = { BsonTypeId(), INT8OID };
-	Datum insertArgValues[2] = { 0 };
-	char insertArgNulls[2] = { ' ', ' ' };
-
-	if (args->shardKeyDefinition == NULL)
-	{
-		insertArgValues[0] = (Datum) 0;
-		insertArgNulls[0] = 'n';
-	}
-	else
-	{
-		insertArgValues[0] = PointerGetDatum(args->shardKeyDefinition);
-	}
-
-	insertArgValues[1] = UInt64GetDatum(collection->collectionId);
-
-	if (collection->mongoDataCreationTimeVarAttrNumber != -1)
-	{
-		appendStringInfo(queryInfo,
-						 "INSERT INTO %s (shard_key_value, object_id, document, creation_time)"
-						 " SELECT %s.get_shard_key_value($1, $2, document), object_id, document, creation_time"
-						 " FROM %s",
-						 tmpDataTableName, ApiInternalSchemaName, qualifiedDataTableName);
-	}
-	else
-	{
-		appendStringInfo(queryInfo,
-						 "INSERT INTO %s (shard_key_value, object_id, document)"
-						 " SELECT %s.get_shard_key_value($1, $2, document), object_id, document"
-						 " FROM %s",
-						 tmpDataTableName, ApiInternalSchemaName, qualifiedDataTableName);
-	}
+	return distributionColumn;
+}
 
-	ExtensionExecuteQueryWithArgsViaSPI(queryInfo->data, nargs, insertArgTypes,
-										insertArgValues, insertArgNulls, readOnly,
-										SPI_OK_INSERT, &isNull);
 
+/*
+ * SwapInReshardDataTable replaces the data table of the collection with the
+ * table created by CreateReshardDataTable, and recreates the retry table for
+ * the new distribution.
+ */
+static void
+SwapInReshardDataTable(uint64 collectionId, const char *tableName,
+					   const char *qualifiedDataTableName, const char *tmpDataTableName,
+					   const char *distributionColumn)
+{
 	/*
 	 * Failed to replace the old table with the newly provided table.
 	 */
-	resetStringInfo(queryInfo);
+	StringInfo queryInfo = makeStringInfo();
+	bool readOnly = false;
+	bool isNull = false;
 	appendStringInfo(queryInfo,
 					 "DROP TABLE %s", qualifiedDataTableName);
 
@@ -1387,7 +2124,7 @@ ShardCollectionCore(ShardCollectionArgs *args)
 	resetStringInfo(queryInfo);
 	appendStringInfo(queryInfo,
 					 "ALTER TABLE %s RENAME TO %s",
-					 tmpDataTableName, collection->tableName);
+					 tmpDataTableName, tableName);
 	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
 
 	/* Update new table owner to admin role */
@@ -1402,7 +2139,7 @@ ShardCollectionCore(ShardCollectionArgs *args)
 	{
 		StringInfo retryTableNameInfo = makeStringInfo();
 		appendStringInfo(retryTableNameInfo, "%s.retry_%lu", ApiDataSchemaName,
-						 collection->collectionId);
+						 collectionId);
 
 		/* Recreate the retry table */
 		resetStringInfo(queryInfo);
@@ -1414,65 +2151,395 @@ ShardCollectionCore(ShardCollectionArgs *args)
 		CreateRetryTable(retryTableNameInfo->data, qualifiedDataTableName,
 						 distributionColumn, shardCountForRetry);
 	}
+}
+
+
+/*
+ * ReshardCollectionOnline applies a new shard key to a collection in steps that
+ * each commit:
+ *   1. The new data table is created with the constraints of the current one,
+ *      and a trigger on the current table starts logging the object_id of every
+ *      document written to a change table.
+ *   2. The documents are copied over in chunks of batchSize in the order of the
+ *      primary key, sleeping batchDelayMs between chunks to throttle the copy.
+ *   3. The remaining indexes are built on the new table.
+ *   4. The logged changes are replayed by recopying the documents with those
+ *      object_ids, until fewer than one batch of changes is left.
+ *   5. The current table is locked against writes, the last changes are
+ *      replayed and the new table is swapped in along with the new shard key.
+ *
+ * Since the copy does not block writes, its snapshot is stale by the time it
+ * is done; the change log makes up for it. A failed run leaves the collection
+ * on its current shard key, and the next run starts over.
+ */
+static void
+ReshardCollectionOnline(ShardCollectionArgs *args, int batchSize, int batchDelayMs,
+						MemoryContext procedureContext)
+{
+	Datum databaseDatum = CStringGetTextDatum(args->databaseName);
+	Datum collectionDatum = CStringGetTextDatum(args->collectionName);
+
+	EnsureMetadataTableReplicated("collections");
+
+	MongoCollection *collection = GetMongoCollectionByNameDatum(
+		databaseDatum, collectionDatum, AccessShareLock);
+
+	if (collection == NULL || collection->shardKey == NULL)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_NAMESPACENOTSHARDED),
+						errmsg("Collection %s.%s is not sharded",
+							   args->databaseName, args->collectionName),
+						errdetail_log(
+							"Can not reshard collection online that is not sharded: %s.%s",
+							args->databaseName, args->collectionName)));
+	}
+
+	if (!args->forceRedistribution &&
+		PgbsonEquals(collection->shardKey, args->shardKeyDefinition))
+	{
+		ereport(NOTICE, (errmsg(
+							 "Skipping Sharding for collection %s.%s as the same options were passed in.",
+							 args->databaseName, args->collectionName)));
+		return;
+	}
+
+	/* The collection entry does not survive the commits, keep what we need */
+	uint64 collectionId = collection->collectionId;
+	char *tableName = pstrdup(collection->tableName);
+	bool hasCreationTime = collection->mongoDataCreationTimeVarAttrNumber != -1;
+
+	char *qualifiedDataTableName = psprintf("%s.%s", ApiDataSchemaName, tableName);
+	char *tmpDataTableName = psprintf("%s.%s_reshard", ApiDataSchemaName, tableName);
+	char *changeTableName = psprintf("%s.reshard_changes_" UINT64_FORMAT,
+									 ApiDataSchemaName, collectionId);
+	char *triggerName = psprintf("reshard_capture_" UINT64_FORMAT, collectionId);
+
+	StringInfo queryInfo = makeStringInfo();
+	bool readOnly = false;
+	bool isNull = false;
+
+	/* Step 1: clean up after a previous failed run, and start capturing changes */
+	appendStringInfo(queryInfo,
+					 "DROP TRIGGER IF EXISTS %s ON %s", triggerName,
+					 qualifiedDataTableName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "DROP TABLE IF EXISTS %s, %s", tmpDataTableName,
+					 changeTableName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
+
+	const char *distributionColumn = CreateReshardDataTable(args, collectionId,
+															qualifiedDataTableName,
+															tmpDataTableName);
+
+	/* The unique constraints (and the primary key) are needed by the copy to skip rows seen twice */
+	CopyReshardIndexDefinitions(qualifiedDataTableName, tmpDataTableName, true);
 
-	/* Get all valid or in progress indexes and delete them from metadata entries related to the collection.
-	 * TODO(MX): This really should not be CommutativeWrites for the entire query. Ideally only hte DELETE itself
-	 * is commutative and is separate out from the other queries. This only really becomes a concern wiht MX
-	 * and so for now this is left as-is.
-	 */
 	resetStringInfo(queryInfo);
 	appendStringInfo(queryInfo,
-					 " WITH cte AS ("
-					 " DELETE FROM %s.collection_indexes WHERE collection_id = %lu RETURNING *)"
-					 " SELECT array_agg(%s.index_spec_as_bson(index_spec) ORDER BY index_id, '{}') FROM cte"
-					 " WHERE index_is_valid OR %s.index_build_is_in_progress(index_id)",
-					 ApiCatalogSchemaName, collection->collectionId,
-					 ApiInternalSchemaName, ApiInternalSchemaName);
+					 "CREATE TABLE %s (change_id bigserial PRIMARY KEY, object_id %s NOT NULL)",
+					 changeTableName, FullBsonTypeName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
 
-	bool isNullIndexSpecArray = true;
-	Datum indexSpecArray = RunQueryWithCommutativeWrites(queryInfo->data, 0, NULL, NULL,
-														 NULL, SPI_OK_SELECT,
-														 &isNullIndexSpecArray);
+	/* The writers of the collection log into it through the trigger */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "ALTER TABLE %s OWNER TO %s", changeTableName,
+					 ApiAdminRole);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
 
-	/* Create a vanilla RUM _id index but don't register it yet since we need to build it. */
 	resetStringInfo(queryInfo);
 	appendStringInfo(queryInfo,
-					 "SELECT %s.create_builtin_id_index(collection_id => %lu, register_id_index => false)",
-					 ApiInternalSchemaName, collection->collectionId);
-	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_SELECT, &isNull);
+					 "CREATE TRIGGER %s AFTER INSERT OR UPDATE OR DELETE ON %s"
+					 " FOR EACH ROW EXECUTE FUNCTION %s.record_reshard_change(%s)",
+					 triggerName, qualifiedDataTableName, ApiInternalSchemaNameV2,
+					 quote_literal_cstr(changeTableName));
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
 
-	if (!isNullIndexSpecArray)
+	CommitReshardStep(procedureContext);
+
+	/* Step 2: copy the documents in chunks, keyed on the primary key of the table */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "WITH chunk AS (SELECT shard_key_value, object_id, document%s FROM %s"
+					 " WHERE $3 IS NULL OR (shard_key_value, object_id) > ($4, $3)"
+					 " ORDER BY shard_key_value, object_id LIMIT $5),"
+					 " copied AS (INSERT INTO %s (shard_key_value, object_id, document%s)"
+					 " SELECT %s.get_shard_key_value($1, $2, document), object_id, document%s"
+					 " FROM chunk ON CONFLICT DO NOTHING)"
+					 " SELECT shard_key_value, object_id, (SELECT COUNT(*) FROM chunk)"
+					 " FROM chunk ORDER BY shard_key_value DESC, object_id DESC LIMIT 1",
+					 hasCreationTime ? ", creation_time" : "", qualifiedDataTableName,
+					 tmpDataTableName, hasCreationTime ? ", creation_time" : "",
+					 ApiInternalSchemaName, hasCreationTime ? ", creation_time" : "");
+	char *copyChunkQuery = queryInfo->data;
+
+	Datum lastShardKeyValue = (Datum) 0;
+	pgbson *lastObjectId = NULL;
+	uint64 documentsCopied = 0;
+	while (true)
 	{
-		pgbson_writer createIndexesArgWriter;
-		PgbsonWriterInit(&createIndexesArgWriter);
+		CHECK_FOR_INTERRUPTS();
+
+		Oid argTypes[5] = { BsonTypeId(), INT8OID, BsonTypeId(), INT8OID, INT4OID };
+		Datum argValues[5] = {
+			PointerGetDatum(args->shardKeyDefinition), UInt64GetDatum(collectionId),
+			PointerGetDatum(lastObjectId), lastShardKeyValue, Int32GetDatum(batchSize)
+		};
+		char argNulls[5] = {
+			' ', ' ', lastObjectId == NULL ? 'n' : ' ', lastObjectId == NULL ? 'n' : ' ',
+			' '
+		};
+
+		MemoryContext oldContext = MemoryContextSwitchTo(procedureContext);
+		Datum results[3] = { 0 };
+		bool resultNulls[3] = { true, true, true };
+		ExtensionExecuteMultiValueQueryWithArgsViaSPI(copyChunkQuery, 5, argTypes,
+													  argValues, argNulls, readOnly,
+													  SPI_OK_SELECT, results,
+													  resultNulls, 3);
+		MemoryContextSwitchTo(oldContext);
+
+		if (resultNulls[0])
+		{
+			break;
+		}
 
-		PgbsonWriterAppendUtf8(&createIndexesArgWriter, "createIndexes", 13,
-							   args->collectionName);
+		lastShardKeyValue = results[0];
+		lastObjectId = DatumGetPgBson(results[1]);
+		int64 chunkSize = DatumGetInt64(results[2]);
+		documentsCopied += chunkSize;
 
-		pgbson_element_writer elementWriter;
-		PgbsonInitObjectElementWriter(&createIndexesArgWriter, &elementWriter,
-									  "indexes", 7);
-		PgbsonElementWriterWriteSQLValue(&elementWriter, isNullIndexSpecArray,
-										 indexSpecArray, RECORDARRAYOID);
+		CommitReshardStep(procedureContext);
 
-		/* Re-create valid indexes. */
-		pgbson *createIndexesMsg = PgbsonWriterGetPgbson(&createIndexesArgWriter);
+		if (chunkSize < batchSize)
+		{
+			break;
+		}
 
+		if (batchDelayMs > 0)
+		{
+			pg_usleep(batchDelayMs * 1000L);
+		}
+	}
 
-		/* Disable force GUCs and just follow the create index spec. */
-		int savedGUCLevel = NewGUCNestLevel();
-		SetGUCLocally(psprintf("%s.defaultUseCompositeOpClass", ApiGucPrefixV2), "false");
+	/* Step 3: build the other indexes now that the bulk of the data is in */
+	CopyReshardIndexDefinitions(qualifiedDataTableName, tmpDataTableName, false);
+	CommitReshardStep(procedureContext);
+
+	/* Step 4: catch up on the changes made during the copy */
+	uint64 changesReplayed = 0;
+	uint64 changesInRound = 0;
+	do {
+		CHECK_FOR_INTERRUPTS();
+		changesInRound = ReplayReshardChanges(changeTableName, qualifiedDataTableName,
+											  tmpDataTableName,
+											  args->shardKeyDefinition, collectionId,
+											  hasCreationTime, batchSize);
+		changesReplayed += changesInRound;
+		CommitReshardStep(procedureContext);
+	} while (changesInRound >= (uint64) batchSize);
+
+	/* Step 5: block writes, drain the last changes and swap in the new table */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "LOCK TABLE %s IN EXCLUSIVE MODE",
+					 qualifiedDataTableName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
 
-		CreateIndexesArg createIndexesArg = ParseCreateIndexesArg(databaseDatum,
-																  createIndexesMsg);
-		bool skipCheckCollectionCreate = createIndexesArg.blocking;
-		bool uniqueIndexOnly = false;
+	do {
+		changesInRound = ReplayReshardChanges(changeTableName, qualifiedDataTableName,
+											  tmpDataTableName,
+											  args->shardKeyDefinition, collectionId,
+											  hasCreationTime, batchSize);
+		changesReplayed += changesInRound;
+	} while (changesInRound > 0);
 
-		/* We call it good if it doesn't throw. */
-		create_indexes_non_concurrently(databaseDatum, createIndexesArg,
-										skipCheckCollectionCreate, uniqueIndexOnly);
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "DROP TABLE %s", changeTableName);
+	ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly, SPI_OK_UTILITY, &isNull);
 
-		RollbackGUCChange(savedGUCLevel);
+	int nargs = 3;
+	Oid argTypes[3] = { BsonTypeId(), TEXTOID, TEXTOID };
+	Datum values[3] = {
+		PointerGetDatum(args->shardKeyDefinition), databaseDatum, collectionDatum
+	};
+	char argNulls[3] = { ' ', ' ', ' ' };
+	RunQueryWithCommutativeWrites(
+		FormatSqlQuery("UPDATE %s.collections SET shard_key = $1"
+					   " WHERE database_name = $2 AND collection_name = $3",
+					   ApiCatalogSchemaName),
+		nargs, argTypes, values, argNulls, SPI_OK_UPDATE, &isNull);
+
+	/* The trigger goes away with the current table */
+	SwapInReshardDataTable(collectionId, tableName, qualifiedDataTableName,
+						   tmpDataTableName, distributionColumn);
+
+	/* Give the indexes and constraints copied in step 1 and 3 their names back */
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "SELECT string_agg(ddl, '; ') FROM ("
+					 " SELECT format('ALTER TABLE %%s RENAME CONSTRAINT %%I TO %%I', %s,"
+					 " con.conname, left(con.conname, -8)) AS ddl"
+					 " FROM pg_catalog.pg_constraint con WHERE con.conrelid = %s::regclass"
+					 " AND con.contype IN ('p', 'u', 'x') AND con.conname LIKE '%%\\_reshard'"
+					 " UNION ALL"
+					 " SELECT format('ALTER INDEX %%I.%%I RENAME TO %%I', %s, c.relname,"
+					 " left(c.relname, -8))"
+					 " FROM pg_catalog.pg_index i JOIN pg_catalog.pg_class c ON c.oid = i.indexrelid"
+					 " WHERE i.indrelid = %s::regclass AND c.relname LIKE '%%\\_reshard'"
+					 " AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_constraint con"
+					 " WHERE con.conindid = i.indexrelid AND con.conrelid = i.indrelid)) ddls",
+					 quote_literal_cstr(qualifiedDataTableName),
+					 quote_literal_cstr(qualifiedDataTableName),
+					 quote_literal_cstr(ApiDataSchemaName),
+					 quote_literal_cstr(qualifiedDataTableName));
+	Datum renameDdl = ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly,
+												  SPI_OK_SELECT, &isNull);
+	if (!isNull)
+	{
+		ExtensionExecuteQueryViaSPI(TextDatumGetCString(renameDdl), readOnly,
+									SPI_OK_UTILITY, &isNull);
+	}
+
+	ereport(NOTICE, (errmsg(
+						 "Resharded collection %s.%s online: copied " UINT64_FORMAT
+						 " documents and replayed " UINT64_FORMAT " changes",
+						 args->databaseName, args->collectionName, documentsCopied,
+						 changesReplayed)));
+}
+
+
+/*
+ * CommitReshardStep commits a step of an online reshard, and starts the
+ * transaction of the next step.
+ */
+static void
+CommitReshardStep(MemoryContext procedureContext)
+{
+	PopAllActiveSnapshots();
+	CommitTransactionCommand();
+	StartTransactionCommand();
+	MemoryContextSwitchTo(procedureContext);
+}
+
+
+/*
+ * ReplayReshardChanges takes up to batchSize changes from the change table of
+ * an online reshard and recopies the current version of the documents they
+ * name into the new data table: the copies there are deleted and the rows of
+ * the current table with those object_ids, if any remain, are inserted again.
+ * Returns the number of changes taken.
+ */
+static uint64
+ReplayReshardChanges(const char *changeTableName, const char *qualifiedDataTableName,
+					 const char *tmpDataTableName, pgbson *shardKeyDefinition,
+					 uint64 collectionId, bool hasCreationTime, int batchSize)
+{
+	bool readOnly = false;
+	StringInfo queryInfo = makeStringInfo();
+
+	/* Take the changes in one statement so none committed in between is lost */
+	appendStringInfo(queryInfo,
+					 "WITH changes AS (DELETE FROM %s WHERE change_id IN"
+					 " (SELECT change_id FROM %s ORDER BY change_id LIMIT $1)"
+					 " RETURNING object_id)"
+					 " SELECT array_agg(DISTINCT object_id), COUNT(*) FROM changes",
+					 changeTableName, changeTableName);
+
+	Oid takeArgTypes[1] = { INT4OID };
+	Datum takeArgValues[1] = { Int32GetDatum(batchSize) };
+	char takeArgNulls[1] = { ' ' };
+	Datum results[2] = { 0 };
+	bool resultNulls[2] = { true, true };
+	ExtensionExecuteMultiValueQueryWithArgsViaSPI(queryInfo->data, 1, takeArgTypes,
+												  takeArgValues, takeArgNulls,
+												  readOnly, SPI_OK_SELECT, results,
+												  resultNulls, 2);
+
+	if (resultNulls[0])
+	{
+		return 0;
+	}
+
+	bool isNull = false;
+	Oid deleteArgTypes[1] = { GetBsonArrayTypeOid() };
+	Datum deleteArgValues[1] = { results[0] };
+	char deleteArgNulls[1] = { ' ' };
+
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo, "DELETE FROM %s WHERE object_id = ANY($1)",
+					 tmpDataTableName);
+	ExtensionExecuteQueryWithArgsViaSPI(queryInfo->data, 1, deleteArgTypes,
+										deleteArgValues, deleteArgNulls, readOnly,
+										SPI_OK_DELETE, &isNull);
+
+	Oid insertArgTypes[3] = { BsonTypeId(), INT8OID, GetBsonArrayTypeOid() };
+	Datum insertArgValues[3] = {
+		PointerGetDatum(shardKeyDefinition), UInt64GetDatum(collectionId), results[0]
+	};
+	char insertArgNulls[3] = { ' ', ' ', ' ' };
+
+	resetStringInfo(queryInfo);
+	appendStringInfo(queryInfo,
+					 "INSERT INTO %s (shard_key_value, object_id, document%s)"
+					 " SELECT %s.get_shard_key_value($1, $2, document), object_id, document%s"
+					 " FROM %s WHERE object_id = ANY($3) ON CONFLICT DO NOTHING",
+					 tmpDataTableName, hasCreationTime ? ", creation_time" : "",
+					 ApiInternalSchemaName, hasCreationTime ? ", creation_time" : "",
+					 qualifiedDataTableName);
+	ExtensionExecuteQueryWithArgsViaSPI(queryInfo->data, 3, insertArgTypes,
+										insertArgValues, insertArgNulls, readOnly,
+										SPI_OK_INSERT, &isNull);
+
+	return (uint64) DatumGetInt64(results[1]);
+}
+
+
+/*
+ * CopyReshardIndexDefinitions recreates the indexes of the current data table
+ * on the new data table of an online reshard, with a _reshard suffix on their
+ * names. If constraints is true, these are the indexes of the primary key and
+ * of the unique and exclusion constraints; otherwise the other indexes.
+ */
+static void
+CopyReshardIndexDefinitions(const char *qualifiedDataTableName,
+							const char *tmpDataTableName, bool constraints)
+{
+	StringInfo queryInfo = makeStringInfo();
+	bool readOnly = false;
+	bool isNull = false;
+
+	if (constraints)
+	{
+		appendStringInfo(queryInfo,
+						 "SELECT string_agg(format('ALTER TABLE %%s ADD CONSTRAINT %%I %%s', %s,"
+						 " con.conname || '_reshard', pg_catalog.pg_get_constraintdef(con.oid)), '; ')"
+						 " FROM pg_catalog.pg_constraint con WHERE con.conrelid = %s::regclass"
+						 " AND con.contype IN ('p', 'u', 'x')",
+						 quote_literal_cstr(tmpDataTableName),
+						 quote_literal_cstr(qualifiedDataTableName));
+	}
+	else
+	{
+		appendStringInfo(queryInfo,
+						 "SELECT string_agg(format('CREATE %%sINDEX %%I ON %%s%%s',"
+						 " CASE WHEN i.indisunique THEN 'UNIQUE ' ELSE '' END,"
+						 " c.relname || '_reshard', %s,"
+						 " substring(pg_catalog.pg_get_indexdef(i.indexrelid) from ' USING .*$')), '; ')"
+						 " FROM pg_catalog.pg_index i JOIN pg_catalog.pg_class c ON c.oid = i.indexrelid"
+						 " WHERE i.indrelid = %s::regclass"
+						 " AND NOT EXISTS (SELECT 1 FROM pg_catalog.pg_constraint con"
+						 " WHERE con.conindid = i.indexrelid AND con.conrelid = i.indrelid)",
+						 quote_literal_cstr(tmpDataTableName),
+						 quote_literal_cstr(qualifiedDataTableName));
+	}
+
+	Datum indexDdl = ExtensionExecuteQueryViaSPI(queryInfo->data, readOnly,
+												 SPI_OK_SELECT, &isNull);
+	if (!isNull)
+	{
+		ExtensionExecuteQueryViaSPI(TextDatumGetCString(indexDdl), readOnly,
+									SPI_OK_UTILITY, &isNull);
 	}
 }
 
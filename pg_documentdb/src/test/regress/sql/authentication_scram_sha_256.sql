@@ -192,4 +192,29 @@ DROP role "test""user";
 DROP role "test""user.";
 DROP role "test user";
 DROP role "test\user";
-DROP role TestUserCase;
\ No newline at end of file
+DROP role TestUserCase;
+/* tests for scram_sha256_get_secret */
+SET client_min_messages TO ERROR;
+CREATE ROLE secretuser WITH LOGIN PASSWORD '<password_placeholder777>';
+RESET client_min_messages;
+
+SELECT documentdb_api_internal.scram_sha256_get_secret(null);
+SELECT documentdb_api_internal.scram_sha256_get_secret('nonexistent');
+
+-- The secret matches the SALT, StoredKey and ServerKey of the shadow password
+WITH secret AS (SELECT documentdb_api_internal.scram_sha256_get_secret('secretuser')::text AS secret),
+     shadow AS (SELECT rolpassword, oid FROM pg_catalog.pg_authid WHERE rolname = 'secretuser')
+SELECT position('"salt" : "' || split_part(split_part(rolpassword, '$', 2), ':', 2) || '"' IN secret) > 0 AS salt_matches,
+       position('"StoredKey" : "' || split_part(split_part(rolpassword, '$', 3), ':', 1) || '"' IN secret) > 0 AS stored_key_matches,
+       position('"ServerKey" : "' || split_part(split_part(rolpassword, '$', 3), ':', 2) || '"' IN secret) > 0 AS server_key_matches,
+       position('"roleOid" : { "$numberLong" : "' || oid || '" }' IN secret) > 0 AS role_oid_matches
+FROM secret, shadow;
+
+-- The secret is only available to the owner of the extension
+SELECT has_function_privilege('secretuser', 'documentdb_api_internal.scram_sha256_get_secret(text)', 'EXECUTE');
+
+SET documentdb.isNativeAuthEnabled TO OFF;
+SELECT documentdb_api_internal.scram_sha256_get_secret('secretuser');
+SET documentdb.isNativeAuthEnabled TO ON;
+
+DROP ROLE secretuser;
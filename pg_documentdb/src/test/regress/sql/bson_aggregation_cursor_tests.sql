@@ -279,4 +279,76 @@ END;
 SELECT * FROM aggregation_cursor_test.drain_aggregation_query(loopCount => 1, pageSize => 1, pipeline => '{ "": [{ "$skip": 2 }]}');
 
 -- now run a new query - this should close the cursor above, and continue with a fresh query
-SELECT * FROM aggregation_cursor_test.drain_aggregation_query(loopCount => 1, pageSize => 1, pipeline => '{ "": [{ "$skip": 2 }]}');
\ No newline at end of file
+SELECT * FROM aggregation_cursor_test.drain_aggregation_query(loopCount => 1, pageSize => 1, pipeline => '{ "": [{ "$skip": 2 }]}');
+-- the query shape cache reuses the query generated for the same find and aggregate
+BEGIN;
+set local documentdb.enableQueryShapeCache to on;
+SELECT documentdb_api.insert_one('db', 'query_shape_cache_test', '{ "_id": 1, "a": 1 }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "query_shape_cache_test", "filter": { "a": 1 }, "lsid" : { "id" : 1 }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "query_shape_cache_test", "filter": { "a": 1 }, "lsid" : { "id" : 2 }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$project": { "a": 1, "now": "$$NOW" } }, { "$project": { "a": 1, "hasNow": { "$eq": [ { "$type": "$now" }, "date" ] } } } ], "cursor": {}, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$addFields": { "b": 2 } } ], "cursor": {}, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$addFields": { "b": 2 } } ], "cursor": {}, "$db" : "db" }');
+
+-- dropping and recreating the collection invalidates the cached queries
+SELECT documentdb_api.drop_collection('db', 'query_shape_cache_test');
+SELECT documentdb_api.insert_one('db', 'query_shape_cache_test', '{ "_id": 2, "a": 1 }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "query_shape_cache_test", "filter": { "a": 1 }, "lsid" : { "id" : 3 }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$addFields": { "b": 2 } } ], "cursor": {}, "$db" : "db" }');
+
+-- a cached aggregate still validates its maxTimeMS as an aggregate
+SAVEPOINT query_shape_cache_max_time;
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$addFields": { "b": 2 } } ], "cursor": {}, "maxTimeMS": "1", "$db" : "db" }');
+ROLLBACK TO SAVEPOINT query_shape_cache_max_time;
+
+-- queries cached with other config values are not reused
+set local documentdb.enableRankFusionStage to on;
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byA": [ { "$sort": { "a": 1 } } ] } } } }, { "$project": { "a": 1 } } ], "cursor": {}, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byA": [ { "$sort": { "a": 1 } } ] } } } }, { "$project": { "a": 1 } } ], "cursor": {}, "$db" : "db" }');
+set local documentdb.enableRankFusionStage to off;
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "query_shape_cache_test", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byA": [ { "$sort": { "a": 1 } } ] } } } }, { "$project": { "a": 1 } } ], "cursor": {}, "$db" : "db" }');
+ROLLBACK;
+
+-- finds on _id are served from the primary key index when direct point reads are enabled
+BEGIN;
+set local documentdb.enableDirectPointReads to on;
+SELECT documentdb_api.insert_one('db', 'direct_point_read_test', '{ "_id": 1, "a": 1 }');
+SELECT documentdb_api.insert_one('db', 'direct_point_read_test', '{ "_id": 2, "a": 2 }');
+SELECT documentdb_api.insert_one('db', 'direct_point_read_test', '{ "_id": "3", "a": 3 }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "direct_point_read_test", "filter": { "_id": 1 }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "direct_point_read_test", "filter": { "_id": { "$eq": "3" } }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "direct_point_read_test", "filter": { "_id": { "$in": [ 1, 2, 1.0, 4 ] } }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "direct_point_read_test", "filter": { "_id": 4 }, "$db" : "db" }');
+
+-- these fall back to the query path
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "direct_point_read_test", "filter": { "_id": 1 }, "projection": { "a": 0 }, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page(database => 'db', commandSpec => '{ "find" : "direct_point_read_test", "filter": { "_id": { "$in": [ 1, 2 ] } }, "batchSize": 1, "$db" : "db" }', cursorId => 4294967294);
+ROLLBACK;
+
+-- maxParallelWorkers is accepted on find and aggregate when parallel query plans are enabled
+BEGIN;
+set local documentdb.enableParallelQueryPlans to on;
+SELECT documentdb_api.insert_one('db', 'parallel_query_test', '{ "_id": 1, "a": 1 }');
+SELECT documentdb_api.insert_one('db', 'parallel_query_test', '{ "_id": 2, "a": 2 }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "parallel_query_test", "filter": { "a": { "$gt": 0 } }, "singleBatch": true, "maxParallelWorkers": 2, "$db" : "db" }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('db', '{ "aggregate" : "parallel_query_test", "pipeline": [ { "$group": { "_id": null, "c": { "$sum": 1 } } } ], "cursor": {}, "maxParallelWorkers": 0, "$db" : "db" }');
+SELECT document FROM documentdb_api.count_query('db', '{ "count": "parallel_query_test", "query": { "a": { "$gt": 1 } } }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('db', '{ "find" : "parallel_query_test", "maxParallelWorkers": -1, "$db" : "db" }');
+ROLLBACK;
+
+-- streaming cursors can return their continuation in the compact binary form and resume from it
+BEGIN;
+set local documentdb.enableCompactCursorContinuation to on;
+SELECT * FROM aggregation_cursor_test.drain_find_query(loopCount => 5, pageSize => 2, project => '{ "a": 1 }');
+SELECT * FROM aggregation_cursor_test.drain_aggregation_query(loopCount => 5, pageSize => 2, pipeline => '{ "": [{ "$project": { "a": 1 } }]}');
+ROLLBACK;
+
+-- maxAwaitTimeMS is accepted on getMore: only tailable cursors wait for new data
+BEGIN;
+SELECT documentdb_api.insert_one('db', 'await_data_test', '{ "_id": 1, "a": 1 }');
+SELECT documentdb_api.insert_one('db', 'await_data_test', '{ "_id": 2, "a": 2 }');
+WITH firstPage AS (SELECT continuation FROM documentdb_api.find_cursor_first_page(database => 'db', commandSpec => '{ "find": "await_data_test", "batchSize": 1 }', cursorId => 4294967294))
+SELECT documentdb_api_catalog.bson_dollar_project(cursorPage, '{ "cursor.nextBatch._id": 1, "cursor.id": 1 }') FROM firstPage, documentdb_api.cursor_get_more(database => 'db', getMoreSpec => '{ "getMore": { "$numberLong": "4294967294" }, "collection": "await_data_test", "maxAwaitTimeMS": 100 }', continuationSpec => firstPage.continuation);
+WITH firstPage AS (SELECT continuation FROM documentdb_api.find_cursor_first_page(database => 'db', commandSpec => '{ "find": "await_data_test", "batchSize": 1 }', cursorId => 4294967294))
+SELECT cursorPage FROM firstPage, documentdb_api.cursor_get_more(database => 'db', getMoreSpec => '{ "getMore": { "$numberLong": "4294967294" }, "collection": "await_data_test", "maxAwaitTimeMS": -1 }', continuationSpec => firstPage.continuation);
+ROLLBACK;
@@ -68,3 +68,26 @@ SELECT documentdb_api.update('db', '{ "update": "aggregation_cursor_txn", "updat
 SELECT continuation AS r1_continuation FROM firstPageResponse \gset
 SELECT bson_dollar_project(cursorpage, '{ "cursor.nextBatch._id": 1, "cursor.id": 1 }'), continuation FROM
     documentdb_api.cursor_get_more(database => 'db', getMoreSpec => '{ "collection": "aggregation_cursor_txn", "getMore": 4294967294, "batchSize": 6 }', continuationSpec => :'r1_continuation');
+
+-- streaming cursors on an _id range resume from the last _id returned
+set documentdb.enableKeysetCursorContinuation to on;
+DO $$
+DECLARE i int;
+BEGIN
+FOR i IN 1..10 LOOP
+PERFORM documentdb_api.insert_one('db', 'aggregation_cursor_keyset', FORMAT('{ "_id": %s, "a": %s }', i, i)::documentdb_core.bson);
+END LOOP;
+END;
+$$;
+
+DROP TABLE firstPageResponse;
+CREATE TEMP TABLE firstPageResponse AS
+SELECT bson_dollar_project(cursorpage, '{ "cursor.firstBatch._id": 1, "cursor.id": 1 }'), continuation, persistconnection, cursorid FROM
+    documentdb_api.find_cursor_first_page(database => 'db', commandSpec => '{ "find": "aggregation_cursor_keyset", "filter": { "_id": { "$gt": 2 } }, "batchSize": 3 }', cursorId => 4294967294);
+
+SELECT * FROM firstPageResponse;
+
+SELECT continuation AS r1_continuation FROM firstPageResponse \gset
+SELECT bson_dollar_project(cursorpage, '{ "cursor.nextBatch._id": 1, "cursor.id": 1 }'), continuation FROM
+    documentdb_api.cursor_get_more(database => 'db', getMoreSpec => '{ "collection": "aggregation_cursor_keyset", "getMore": 4294967294, "batchSize": 10 }', continuationSpec => :'r1_continuation');
+reset documentdb.enableKeysetCursorContinuation;
@@ -30,4 +30,88 @@ SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnosti
 -- index_stats should work
 SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_coll1", "pipeline": [ { "$indexStats": { }}, { "$project": { "accesses.since": 0 }}]}');
 SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_coll2", "pipeline": [ { "$indexStats": { }}, { "$project": { "accesses.since": 0 }}]}');
-SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_coll3", "pipeline": [ { "$indexStats": { }}, { "$project": { "accesses.since": 0 }}]}');
\ No newline at end of file
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_coll3", "pipeline": [ { "$indexStats": { }}, { "$project": { "accesses.since": 0 }}]}');
+
+-- index_stats can report the usage details of each index, e.g. to find unused indexes
+BEGIN;
+SET LOCAL documentdb.enableIndexStatsUsageDetails TO on;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_coll1", "pipeline": [ { "$indexStats": { }}, { "$project": { "name": 1, "hasSize": { "$gt": [ "$usage.sizeBytes", 0 ] }, "tuplesRead": { "$type": "$usage.tuplesRead" }, "lastUsed": { "$type": "$usage.lastUsed" } }}]}');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_coll2", "pipeline": [ { "$indexStats": { }}, { "$match": { "accesses.ops": 0 } }, { "$project": { "name": 1, "hasSize": { "$gt": [ "$usage.sizeBytes", 0 ] } }}]}');
+ROLLBACK;
+
+-- dbStats and collStats responses can be reused within a session
+SET documentdb.diagnosticStatsCacheSeconds TO 600;
+SELECT documentdb_api.db_stats('diagnostic_db') IS NOT NULL AS computed;
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_coll1', '{ "_id": "stats_cache_doc" }');
+SELECT documentdb_api.db_stats('diagnostic_db') IS NOT NULL AS cached;
+SELECT documentdb_api.coll_stats('diagnostic_db', 'diag_coll1') = documentdb_api.coll_stats('diagnostic_db', 'diag_coll1') AS same_response;
+RESET documentdb.diagnosticStatsCacheSeconds;
+SELECT documentdb_api.delete('diagnostic_db', '{ "delete": "diag_coll1", "deletes": [ { "q": { "_id": "stats_cache_doc" }, "limit": 1 } ] }');
+
+-- command latencies are recorded in histograms
+SELECT count(*) >= 0 AS reset FROM documentdb_api_internal.command_latency_stats(true);
+SET documentdb.enableCommandLatencyHistograms TO on;
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_coll1', '{ "_id": "latency_doc" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('diagnostic_db', '{ "find": "diag_coll1", "filter": { "_id": "latency_doc" } }');
+SELECT documentdb_api.delete('diagnostic_db', '{ "delete": "diag_coll1", "deletes": [ { "q": { "_id": "latency_doc" }, "limit": 1 } ] }');
+RESET documentdb.enableCommandLatencyHistograms;
+SELECT command_name, SUM(command_count) FROM documentdb_api_internal.command_latency_stats(true) GROUP BY command_name ORDER BY command_name;
+
+-- the histograms are also reported in the serverStatus opLatencies format
+SET documentdb.enableCommandLatencyHistograms TO on;
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_coll1', '{ "_id": "latency_doc" }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('diagnostic_db', '{ "find": "diag_coll1", "filter": { "_id": "latency_doc" } }');
+SELECT documentdb_api.delete('diagnostic_db', '{ "delete": "diag_coll1", "deletes": [ { "q": { "_id": "latency_doc" }, "limit": 1 } ] }');
+RESET documentdb.enableCommandLatencyHistograms;
+SELECT documentdb_api_catalog.bson_dollar_project(documentdb_api_internal.command_latency_status(true), '{ "insertOps": "$opLatencies.insert.ops", "findOps": "$opLatencies.find.ops", "deleteOps": "$opLatencies.delete.ops", "hasHistogram": { "$gt": [ { "$size": "$opLatencies.find.histogram" }, 0 ] } }');
+SELECT documentdb_api_internal.command_latency_status();
+
+-- queries of commands slower than the threshold are recorded in the slow operation log
+SELECT COUNT(*) FROM documentdb_api_internal.slow_operation_log(true);
+SET documentdb.enableSlowOperationLog TO on;
+SET documentdb.slowOperationThresholdMs TO 0;
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_coll1', '{ "_id": "slow_doc", "a": 1 }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('diagnostic_db', '{ "find": "diag_coll1", "filter": { "a": 1 } }');
+RESET documentdb.slowOperationThresholdMs;
+RESET documentdb.enableSlowOperationLog;
+SELECT documentdb_api_catalog.bson_dollar_project(document, '{ "op": 1, "ns": 1, "planSummary": 1, "nreturned": 1, "sampled": 1, "hasPlan": { "$gt": [ { "$strLenCP": "$plan" }, 0 ] } }')
+    FROM documentdb_api_internal.slow_operation_log() WHERE document @@ '{ "op": "find" }';
+SELECT COUNT(*) > 0 FROM documentdb_api_internal.slow_operation_log(true);
+SELECT COUNT(*) FROM documentdb_api_internal.slow_operation_log();
+SELECT documentdb_api.delete('diagnostic_db', '{ "delete": "diag_coll1", "deletes": [ { "q": { "_id": "slow_doc" }, "limit": 1 } ] }');
+
+-- collections joined by $lookup and $unionWith are counted for colocation advice
+SELECT COUNT(*) FROM documentdb_api_internal.collection_join_stats(true);
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_join_from', '{ "_id": 1, "a": 1 }');
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_join_to', '{ "_id": 1, "a": 1 }');
+SET documentdb.enableCollectionJoinStats TO on;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_join_from", "pipeline": [ { "$lookup": { "from": "diag_join_to", "localField": "a", "foreignField": "a", "as": "b" } } ], "cursor": {} }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": "diag_join_from", "pipeline": [ { "$unionWith": "diag_join_to" } ], "cursor": {} }');
+RESET documentdb.enableCollectionJoinStats;
+SELECT s.collection_name, t.collection_name, j.join_count FROM documentdb_api_internal.collection_join_stats(true) j
+    JOIN documentdb_api_catalog.collections s ON s.collection_id = j.source_collection_id
+    JOIN documentdb_api_catalog.collections t ON t.collection_id = j.target_collection_id;
+SELECT COUNT(*) FROM documentdb_api_internal.collection_join_stats();
+
+-- background worker jobs report their priority, concurrency and executions
+SELECT job_name, priority, max_concurrent_executions, running_executions >= 0 AS has_running FROM documentdb_api_internal.background_worker_jobs() ORDER BY job_id;
+
+-- queries of commands are grouped by query shape and namespace in the query shape statistics
+SELECT COUNT(*) FROM documentdb_api_internal.query_shape_stats(true);
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_shape_coll', '{ "_id": 1, "a": 1, "b": "x" }');
+SELECT documentdb_api.insert_one('diagnostic_db', 'diag_shape_coll', '{ "_id": 2, "a": 2, "b": "y" }');
+SET documentdb.enableQueryShapeStats TO on;
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('diagnostic_db', '{ "find": "diag_shape_coll", "filter": { "a": 1 }, "projection": { "b": 1 } }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('diagnostic_db', '{ "find": "diag_shape_coll", "filter": { "a": 2 }, "projection": { "b": 1 } }');
+SELECT cursorPage FROM documentdb_api.find_cursor_first_page('diagnostic_db', '{ "find": "diag_shape_coll", "filter": { "b": { "$in": [ "x", "y" ] } } }');
+SELECT cursorPage FROM documentdb_api.aggregate_cursor_first_page('diagnostic_db', '{ "aggregate": "diag_shape_coll", "pipeline": [ { "$match": { "a": { "$gt": 0 } } }, { "$project": { "b": 1 } } ], "cursor": {} }');
+SELECT documentdb_api_catalog.bson_dollar_project(document, '{ "key": 1, "planSummary": 1, "execCount": "$metrics.execCount", "docsExamined": "$metrics.docsExamined", "docsReturned": "$metrics.docsReturned" }')
+    FROM documentdb_api_catalog.bson_aggregation_pipeline('admin', '{ "aggregate": 1, "pipeline": [ { "$queryStats": {} }, { "$match": { "key.namespace.coll": "diag_shape_coll" } }, { "$sort": { "key.command": 1, "metrics.execCount": -1 } } ], "cursor": {} }');
+RESET documentdb.enableQueryShapeStats;
+
+-- $queryStats runs on admin as the first stage only
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('diagnostic_db', '{ "aggregate": 1, "pipeline": [ { "$queryStats": {} } ], "cursor": {} }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('admin', '{ "aggregate": 1, "pipeline": [ { "$match": {} }, { "$queryStats": {} } ], "cursor": {} }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('admin', '{ "aggregate": 1, "pipeline": [ { "$queryStats": { "transformIdentifiers": {} } } ], "cursor": {} }');
+SELECT COUNT(*) > 0 FROM documentdb_api_internal.query_shape_stats(true);
+SELECT COUNT(*) FROM documentdb_api_internal.query_shape_stats();
@@ -242,9 +242,39 @@ SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregatio
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 1, "path": "v", "filter": "some sentence" }  } } ], "cursor": {} }');
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 1, "path": "v", "filter": {} }  } } ], "cursor": {} }');
 
+-- vectors extracted from numeric arrays and binary vectors
+SELECT documentdb_api_internal.bson_extract_vector('{ "v": [ 3.0, 5, { "$numberLong": "1" } ] }', 'v');
+SELECT documentdb_api_internal.bson_extract_vector('{ "v": [ 3.0, "a" ] }', 'v');
+SELECT documentdb_api_internal.bson_extract_vector('{ "v": { "$binary": { "base64": "JwAAAEBAAACgQAAAwD8=", "subType": "09" } } }', 'v');
+SELECT documentdb_api_internal.bson_extract_vector('{ "v": { "$binary": { "base64": "AwAB/gM=", "subType": "09" } } }', 'v');
+SELECT documentdb_api_internal.bson_extract_vector('{ "v": { "$binary": { "base64": "AwAB/gM=", "subType": "00" } } }', 'v');
+
+-- few candidate rows are ranked exactly instead of through the vector index
+BEGIN;
+SET LOCAL documentdb.vectorExactSearchMaxCandidateRows = 1000;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 1, "path": "v" }  } } ], "cursor": {} }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 1, "path": "v" }  } } ], "cursor": {} }');
+ROLLBACK;
+
+-- the candidates returned by the vector index are counted by explain analyze
+-- the default oversampling only applies to compressed indexes
+BEGIN;
+SET LOCAL documentdb.vectorSearchDefaultOversampling = 4;
+EXPLAIN (COSTS OFF, ANALYZE ON, TIMING OFF, SUMMARY OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 1, "path": "v" }  } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 1, "path": "v", "oversampling": 2 }  } } ], "cursor": {} }');
+ROLLBACK;
+
 -- search with nProbes
 -- numLists <= data size, using data as centroids, to avoid randomized centroids generated by pgvector
 ANALYZE;
+
+-- once the collection has an estimate, a $sample of more than sampleBlockScanMaxFraction of it sorts the full scan randomly
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$sample": { "size": 2 } } ], "cursor": {} }');
+BEGIN;
+SET LOCAL documentdb.sampleBlockScanMaxFraction = 1;
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$sample": { "size": 2 } } ], "cursor": {} }');
+ROLLBACK;
+
 BEGIN;
 SET LOCAL enable_seqscan = off;
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "nProbes": 2 }  } } ], "cursor": {} }');
@@ -260,10 +290,30 @@ SET LOCAL enable_seqscan = off;
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v" }  } } ], "cursor": {} }');
 COMMIT;
 
+-- $rankFusion inputs can start with a vector search, both as the first input and in an input that is unioned
+BEGIN;
+SET LOCAL enable_seqscan = off;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byVector": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v" } } } ], "byText": [ { "$match": { "a": "some other sentence" } } ] } } } }, { "$project": { "a": 1 } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byText": [ { "$match": { "a": "some other sentence" } } ], "byVector": [ { "$vectorSearch": { "queryVector": [ 3.0, 4.9, 1.0 ], "path": "v", "limit": 2, "numCandidates": 10 } } ] } }, "combination": { "weights": { "byVector": 2 } } } }, { "$project": { "a": 1 } } ], "cursor": {} }');
+COMMIT;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byVector": [ { "$match": { "a": "some sentence" } }, { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v" } } } ] } } } } ], "cursor": {} }');
+
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "nProbes": 10000000 }  } } ], "cursor": {} }');
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "nProbes": -5 }  } } ], "cursor": {} }');
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "nProbes": "5" }  } } ], "cursor": {} }');
 
+-- search with targetRecall: uncalibrated indexes use the default nProbes, calibrated ones the smallest nProbes that meets it
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "targetRecall": 1.5 }  } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "targetRecall": "high" }  } } ], "cursor": {} }');
+BEGIN;
+SET LOCAL enable_seqscan = off;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "targetRecall": 0.9 }  } } ], "cursor": {} }');
+SET LOCAL documentdb.vectorSearchCalibrationSampleSize = 10;
+CALL documentdb_api_internal.calibrate_vector_indexes_background();
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "targetRecall": 1 }  } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "aggregation_pipeline", "pipeline": [ { "$search": { "cosmosSearch": { "vector": [ 3.0, 4.9, 1.0 ], "k": 2, "path": "v", "targetRecall": 1, "nProbes": 1 }  } } ], "cursor": {} }');
+ROLLBACK;
+
 -- numLists > data size, pgvector will generate randomized centroids, using original vector data to query
 CALL documentdb_api.drop_indexes('db', '{ "dropIndexes": "aggregation_pipeline", "index": "foo_1"}');
 SELECT documentdb_api_internal.create_indexes_non_concurrently('db', '{ "createIndexes": "aggregation_pipeline", "indexes": [ { "key": { "v": "cosmosSearch" }, "name": "foo_1", "cosmosSearchOptions": { "kind": "vector-ivf", "numLists": 10000, "similarity": "COS", "dimensions": 3 } } ] }', true);
@@ -499,4 +549,163 @@ SELECT documentdb_api.insert_one('db','lookup_movies','{ "_id": 3, "title": "Cel
 
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$unwind": { "path": "$director_info", "preserveNullAndEmptyArrays": true } }, { "$match": { "title": "Celestial Rift" } } ], "cursor": {} }');
 
-EXPLAIN (COSTS OFF, VERBOSE ON) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$unwind": { "path": "$director_info", "preserveNullAndEmptyArrays": true } }, { "$match": { "title": "Celestial Rift" } } ], "cursor": {} }');
\ No newline at end of file
+EXPLAIN (COSTS OFF, VERBOSE ON) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$unwind": { "path": "$director_info", "preserveNullAndEmptyArrays": true } }, { "$match": { "title": "Celestial Rift" } } ], "cursor": {} }');
+-- exclusion projections and $addFields copy the untouched fields as is
+SELECT documentdb_api.insert_one('db','projection_raw_copy','{ "_id": 1, "a": 1, "b": { "c": 2, "d": [ 1, 2 ] }, "big": "xxxxxxxxxxxxxxxx", "e": { "f": 3 }, "g": "h" }', NULL);
+BEGIN;
+set local documentdb.enableProjectionRawFieldCopy to on;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$project": { "big": 0 } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$project": { "b.c": 0, "e": 0 } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$addFields": { "b.x": 1, "g": "$a" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$unset": [ "a", "g" ] } ], "cursor": {} }');
+ROLLBACK;
+
+-- $addFields of new top level fields appends them to the unmodified document
+BEGIN;
+set local documentdb.enableAddFieldsAppendFastPath to on;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$addFields": { "score": { "$add": [ "$a", 1 ] }, "bucket": "$e.f" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$addFields": { "score": "$$REMOVE", "bucket": 1 } } ], "cursor": {} }');
+
+-- existing or nested fields take the regular path
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$addFields": { "score": 1, "a": 2 } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "projection_raw_copy", "pipeline": [ { "$set": { "score": 1, "e.g": 2 } } ], "cursor": {} }');
+ROLLBACK;
+
+-- stage rewrites: $match moves ahead of the stages that don't touch its paths
+BEGIN;
+set local documentdb.enablePipelineStageRewrites to on;
+EXPLAIN (COSTS OFF, VERBOSE ON) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$addFields": { "x": 1 } }, { "$match": { "title": "Celestial Rift" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$addFields": { "x": 1 } }, { "$match": { "title": "Celestial Rift" } } ], "cursor": {} }');
+
+-- $match on the lookup output stays after it
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$match": { "director_info.name": "Morgan Slate" } } ], "cursor": {} }');
+
+-- $sort + $limit run before the $lookup, adjacent $match, $limit and $skip are combined
+EXPLAIN (COSTS OFF, VERBOSE ON) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$sort": { "title": 1 } }, { "$limit": 2 } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$sort": { "title": 1 } }, { "$limit": 2 } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$match": { "_id": { "$gt": 1 } } }, { "$match": {} }, { "$match": { "director": "Alex Veridian" } }, { "$skip": 0 }, { "$limit": 5 }, { "$limit": 1 } ], "cursor": {} }');
+
+-- $sort, $skip, $limit pushes a limit of the skip and the limit down with the sort
+EXPLAIN (COSTS OFF, VERBOSE ON) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$sort": { "title": 1 } }, { "$skip": 1 }, { "$limit": 2 } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$sort": { "title": 1 } }, { "$skip": 1 }, { "$limit": 2 } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$sort": { "title": 1 } }, { "$limit": 3 }, { "$skip": 1 }, { "$limit": 5 } ], "cursor": {} }');
+
+-- $project inclusions and exclusions
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$project": { "title": 1 } }, { "$match": { "title": "Neon Abyss" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$project": { "title": 1 } }, { "$match": { "director": "Morgan Slate" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$project": { "title": 0 } }, { "$match": { "title": "Neon Abyss" } } ], "cursor": {} }');
+ROLLBACK;
+
+-- each stage can be planned under its own subquery scan for explain
+BEGIN;
+set local documentdb.separateAggregationStagesInPlan to on;
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$match": { "director": "Alex Veridian" } }, { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$sort": { "title": 1 } }, { "$project": { "title": 1 } } ], "cursor": {} }');
+EXPLAIN (COSTS OFF, ANALYZE ON, TIMING OFF, SUMMARY OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$match": { "director": "Alex Veridian" } }, { "$sort": { "title": 1 } }, { "$project": { "title": 1 } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$match": { "director": "Alex Veridian" } }, { "$lookup": { "from": "lookup_directors", "localField": "director", "foreignField": "name", "as": "director_info" } }, { "$sort": { "title": 1 } }, { "$project": { "title": 1 } } ], "cursor": {} }');
+ROLLBACK;
+
+-- consecutive $unionWith stages are planned as one append
+BEGIN;
+set local documentdb.enableFlatUnionWithAppend to on;
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$unionWith": "lookup_directors" }, { "$unionWith": { "coll": "lookup_movies", "pipeline": [ { "$match": { "director": "Alex Veridian" } } ] } }, { "$unionWith": "lookup_directors" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$unionWith": "lookup_directors" }, { "$unionWith": { "coll": "lookup_movies", "pipeline": [ { "$match": { "director": "Alex Veridian" } } ] } }, { "$unionWith": "lookup_directors" } ], "cursor": {} }');
+
+-- stages in between keep the unions nested
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$unionWith": "lookup_directors" }, { "$match": { "name": { "$exists": true } } }, { "$unionWith": "lookup_directors" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$unionWith": "lookup_directors" }, { "$match": { "name": { "$exists": true } } }, { "$unionWith": "lookup_directors" } ], "cursor": {} }');
+ROLLBACK;
+
+-- $rankFusion combines the ranks of each input pipeline
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byTitle": [ { "$sort": { "title": 1 } }, { "$limit": 3 } ], "byDirector": [ { "$match": { "director": "Alex Veridian" } }, { "$sort": { "title": -1 } } ] } } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "byTitle": [ { "$sort": { "title": 1 } }, { "$limit": 3 } ], "byDirector": [ { "$match": { "director": "Alex Veridian" } }, { "$sort": { "title": -1 } } ] } }, "combination": { "weights": { "byDirector": 5 } } } }, { "$project": { "title": 1 } } ], "cursor": {} }');
+
+-- $rankFusion must be the first stage and weights must name an input
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$match": { "director": "Alex Veridian" } }, { "$rankFusion": { "input": { "pipelines": { "a": [ ] } } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { } } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "a": [ ] } }, "combination": { "weights": { "b": 1 } } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "lookup_movies", "pipeline": [ { "$rankFusion": { "input": { "pipelines": { "a": [ ] } }, "combination": { "weights": { "a": -1 } } } } ], "cursor": {} }');
+
+-- with the operator cost model, cheaper filters are evaluated before $regex and $elemMatch
+BEGIN;
+set local documentdb.enableDollarOperatorCostModel to on;
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_find('db', '{ "find": "aggregation_pipeline", "filter": { "a": { "$elemMatch": { "b": { "$gt": 1 }, "c": { "$lt": 2 } } }, "d": { "$regex": "^abc.*xyz$" }, "e": 1 } }');
+ROLLBACK;
+
+-- $elemMatch filters on documents of arrays use the compiled predicate program (and fall back for arrays and NaN)
+SELECT documentdb_api.insert_one('db', 'elemmatch_compiled', '{ "_id": 1, "a": [ { "b": 1, "c": 1 }, { "b": 2, "c": 3 } ] }');
+SELECT documentdb_api.insert_one('db', 'elemmatch_compiled', '{ "_id": 2, "a": [ { "b": [ 2, 5 ], "c": 4 } ] }');
+SELECT documentdb_api.insert_one('db', 'elemmatch_compiled', '{ "_id": 3, "a": [ 2, { "b": { "$numberDouble": "NaN" }, "c": 3 }, { "c": 5 } ] }');
+SELECT documentdb_api.insert_one('db', 'elemmatch_compiled', '{ "_id": 4, "a": [ { "b": 2, "c": 1 }, { "b": 1, "c": 3 } ] }');
+SELECT document FROM bson_aggregation_find('db', '{ "find": "elemmatch_compiled", "filter": { "a": { "$elemMatch": { "b": 2, "c": { "$gt": 2 } } } }, "sort": { "_id": 1 } }');
+SELECT document FROM bson_aggregation_find('db', '{ "find": "elemmatch_compiled", "filter": { "a": { "$elemMatch": { "$or": [ { "b": { "$gte": 5 } }, { "b": { "$exists": false } } ] } } }, "sort": { "_id": 1 } }');
+BEGIN;
+set local documentdb.enableCompiledQueryPredicates to off;
+SELECT document FROM bson_aggregation_find('db', '{ "find": "elemmatch_compiled", "filter": { "a": { "$elemMatch": { "b": 2, "c": { "$gt": 2 } } } }, "sort": { "_id": 1 } }');
+SELECT document FROM bson_aggregation_find('db', '{ "find": "elemmatch_compiled", "filter": { "a": { "$elemMatch": { "$or": [ { "b": { "$gte": 5 } }, { "b": { "$exists": false } } ] } } }, "sort": { "_id": 1 } }');
+ROLLBACK;
+
+-- sorted and limited finds on $or sort and limit each branch separately
+SELECT documentdb_api_internal.create_indexes_non_concurrently('db', '{ "createIndexes": "or_branch_sort", "indexes": [ { "key": { "to": 1, "ts": -1 }, "name": "to_ts" }, { "key": { "cc": 1, "ts": -1 }, "name": "cc_ts" } ] }', TRUE);
+SELECT COUNT(documentdb_api.insert_one('db', 'or_branch_sort', FORMAT('{ "_id": %s, "to": "u%s", "cc": "u%s", "ts": %s }', i, mod(i, 3), mod(i, 5), i)::documentdb_core.bson)) FROM generate_series(1, 30) i;
+BEGIN;
+set local documentdb.enableOrBranchSortMerge to on;
+SELECT document FROM bson_aggregation_find('db', '{ "find": "or_branch_sort", "filter": { "$or": [ { "to": "u1" }, { "cc": "u1" } ] }, "sort": { "ts": -1 }, "limit": 5 }');
+SELECT document FROM bson_aggregation_find('db', '{ "find": "or_branch_sort", "filter": { "$or": [ { "to": "u1" }, { "cc": "u1" } ], "ts": { "$lt": 20 } }, "sort": { "ts": -1 }, "skip": 2, "limit": 3 }');
+ROLLBACK;
+SELECT document FROM bson_aggregation_find('db', '{ "find": "or_branch_sort", "filter": { "$or": [ { "to": "u1" }, { "cc": "u1" } ] }, "sort": { "ts": -1 }, "limit": 5 }');
+
+-- index scans that return far more rows than estimated switch to a sequential scan without duplicating rows
+SELECT documentdb_api_internal.create_indexes_non_concurrently('db', '{ "createIndexes": "adaptive_scan", "indexes": [ { "key": { "a": 1 }, "name": "a_1" } ] }', TRUE);
+SELECT COUNT(documentdb_api.insert_one('db', 'adaptive_scan', FORMAT('{ "_id": %s, "a": %s }', i, i)::documentdb_core.bson)) FROM generate_series(1, 5000) i;
+SELECT collection_id AS adaptive_scan_collection_id FROM documentdb_api_catalog.collections WHERE database_name = 'db' AND collection_name = 'adaptive_scan' \gset
+ANALYZE documentdb_data.documents_:adaptive_scan_collection_id;
+SELECT documentdb_api.update('db', '{ "update": "adaptive_scan", "updates": [ { "q": { "_id": { "$gt": 1000 } }, "u": { "$set": { "a": 1 } }, "multi": true } ] }');
+BEGIN;
+set local documentdb.enableAdaptiveIndexScan to on;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "adaptive_scan", "pipeline": [ { "$match": { "a": 1 } }, { "$count": "n" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "adaptive_scan", "pipeline": [ { "$match": { "a": { "$lte": 10 } } }, { "$group": { "_id": null, "n": { "$sum": 1 }, "ids": { "$sum": "$_id" } } } ], "cursor": {} }');
+ROLLBACK;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "adaptive_scan", "pipeline": [ { "$match": { "a": { "$lte": 10 } } }, { "$group": { "_id": null, "n": { "$sum": 1 }, "ids": { "$sum": "$_id" } } } ], "cursor": {} }');
+
+-- $unwind produces the documents of the array elements one at a time, keeping the field order
+SELECT documentdb_api.insert_one('db', 'unwind_lazy', '{ "_id": 1, "x": "before", "arr": [ 1, { "c": 2 }, [ 3, 4 ] ], "y": "after", "n": { "arr": [ "p", "q" ] } }');
+SELECT documentdb_api.insert_one('db', 'unwind_lazy', '{ "_id": 2, "x": "before", "arr": [], "idx": "existing", "y": "after" }');
+SELECT documentdb_api.insert_one('db', 'unwind_lazy', '{ "_id": 3, "arr": 5, "y": "after" }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "unwind_lazy", "pipeline": [ { "$unwind": "$arr" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "unwind_lazy", "pipeline": [ { "$unwind": { "path": "$arr", "includeArrayIndex": "idx", "preserveNullAndEmptyArrays": true } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "unwind_lazy", "pipeline": [ { "$unwind": { "path": "$arr", "includeArrayIndex": "arr" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "unwind_lazy", "pipeline": [ { "$unwind": { "path": "$n.arr", "includeArrayIndex": "n.idx" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "unwind_lazy", "pipeline": [ { "$unwind": "$arr" }, { "$limit": 2 } ], "cursor": {} }');
+
+-- $replaceRoot/$replaceWith of an embedded document path copy the sub-document, and paths through arrays or to non documents are evaluated as before
+SELECT documentdb_api.insert_one('db', 'replace_root_path', '{ "_id": 1, "payload": { "x": 1, "inner": { "y": [ 1, 2 ], "z": { "w": true } } } }');
+SELECT documentdb_api.insert_one('db', 'replace_root_path', '{ "_id": 2, "payload": { "x": 2, "inner": [ { "z": { "w": false } } ] } }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "replace_root_path", "pipeline": [ { "$match": { "_id": 1 } }, { "$replaceRoot": { "newRoot": "$payload" } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "replace_root_path", "pipeline": [ { "$match": { "_id": 1 } }, { "$replaceWith": "$payload.inner.z" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "replace_root_path", "pipeline": [ { "$match": { "_id": 2 } }, { "$replaceWith": "$payload.inner.z" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "replace_root_path", "pipeline": [ { "$match": { "_id": 1 } }, { "$replaceWith": "$payload.x" } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "replace_root_path", "pipeline": [ { "$replaceWith": "$payload.missing" } ], "cursor": {} }');
+
+-- repeated projection expressions are evaluated once per document and constant operators are folded, without changing results
+SELECT documentdb_api.insert_one('db', 'expr_share', '{ "_id": 1, "a": 1, "b": 10 }');
+SELECT documentdb_api.insert_one('db', 'expr_share', '{ "_id": 2, "a": 5, "b": 20 }');
+SELECT documentdb_api.insert_one('db', 'expr_share', '{ "_id": 3, "b": 30 }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "x": { "$add": [ "$a", 1 ] }, "y": { "$add": [ "$a", 1 ] }, "n.z": { "$add": [ "$a", 1 ] } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "a": 1, "c": { "$add": [ "$a", "$b" ] }, "d": { "$add": [ "$a", "$b" ] } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "b": 0 } }, { "$addFields": { "s1": { "$multiply": [ "$a", 2 ] }, "s2": { "$multiply": [ "$a", 2 ] } } } ], "cursor": {} }');
+
+-- folded operators that yield missing skip the field, and yield null inside arrays
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$match": { "_id": 1 } }, { "$addFields": { "m": { "$arrayElemAt": [ [ 1, 2 ], 5 ] }, "arr": [ { "$arrayElemAt": [ [ 1, 2 ], 5 ] }, { "$arrayElemAt": [ [ 1, 2 ], 1 ] } ], "nl": { "$ifNull": [ null, null ] }, "folded": { "$add": [ 1, 2 ] }, "p.q": { "$add": [ 1, 2 ] } } } ], "cursor": {} }');
+
+-- $rand is neither shared nor folded, and $$NOW and $let variables are not folded
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "r1": { "$rand": {} }, "r2": { "$rand": {} } } }, { "$project": { "shared": { "$eq": [ "$r1", "$r2" ] }, "t": { "$type": "$r1" } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$addFields": { "r": { "$rand": {} } } }, { "$group": { "_id": null, "r": { "$addToSet": "$r" } } }, { "$project": { "_id": 0, "distinct": { "$size": "$r" } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "same": { "$eq": [ "$$NOW", "$$NOW" ] }, "t": { "$type": "$$NOW" } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "v": { "$let": { "vars": { "x": { "$add": [ "$a", 1 ] } }, "in": { "$multiply": [ "$$x", 2 ] } } }, "u": { "$let": { "vars": { "x": { "$add": [ "$a", 1 ] } }, "in": { "$multiply": [ "$$x", 2 ] } } }, "w": { "$let": { "vars": { "x": "$b" }, "in": { "$multiply": [ "$$x", 2 ] } } } } } ], "cursor": {} }');
+
+-- the results are the same with the optimization turned off
+BEGIN;
+set local documentdb.enableAggregationExpressionOptimization to off;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$project": { "x": { "$add": [ "$a", 1 ] }, "y": { "$add": [ "$a", 1 ] }, "n.z": { "$add": [ "$a", 1 ] } } } ], "cursor": {} }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "expr_share", "pipeline": [ { "$match": { "_id": 1 } }, { "$addFields": { "m": { "$arrayElemAt": [ [ 1, 2 ], 5 ] }, "arr": [ { "$arrayElemAt": [ [ 1, 2 ], 5 ] }, { "$arrayElemAt": [ [ 1, 2 ], 1 ] } ], "nl": { "$ifNull": [ null, null ] }, "folded": { "$add": [ 1, 2 ] }, "p.q": { "$add": [ 1, 2 ] } } } ], "cursor": {} }');
+ROLLBACK;
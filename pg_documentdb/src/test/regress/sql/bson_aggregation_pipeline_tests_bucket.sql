@@ -116,3 +116,10 @@ SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "dollarBuck
 EXPLAIN (VERBOSE ON, COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "dollarBucket", "pipeline": [ { "$bucket": { "groupBy": "$year", "boundaries": [2020, 2021, 2022, 2023] } } ] }');
 EXPLAIN (VERBOSE ON, COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "dollarBucket", "pipeline": [ { "$bucket": { "groupBy": "$year", "boundaries": [2020, 2021, 2022], "default": "others", "output": { "count": { "$sum": 1 }, "averageStock": { "$avg": "$stock" } } } } ] }');
 EXPLAIN (VERBOSE ON, COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "dollarBucket", "pipeline": [ { "$bucket": { "groupBy": { "$subtract": ["$year", 2019] }, "boundaries": [1, 2, 3, 4] } } ] }');
+
+-- the accumulators share the memory budget of the query
+SELECT COUNT(*) FROM (SELECT documentdb_api.insert_one('db', 'bucket_memory_budget', FORMAT('{ "_id": %s, "value": "%s" }', i, repeat('a', 4096))::bson) FROM generate_series(1, 600) i) inserts;
+SET documentdb.maxQueryMemoryMB TO 1;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "bucket_memory_budget", "pipeline": [ { "$bucket": { "groupBy": "$_id", "boundaries": [0, 1000], "output": { "values" : { "$push" : "$value" } } } }, { "$project": { "_id": 1 } } ] }');
+RESET documentdb.maxQueryMemoryMB;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "bucket_memory_budget", "pipeline": [ { "$bucket": { "groupBy": "$_id", "boundaries": [0, 1000], "output": { "values" : { "$push" : "$value" } } } }, { "$project": { "_id": 1 } } ] }');
@@ -18,5 +18,12 @@ EXPLAIN (VERBOSE ON, COSTS OFF) SELECT document FROM bson_aggregation_pipeline('
 -- does the same as aggregation.
 SELECT current_op_command('{ "op_prefix": { "$lt": 2 }}');
 
+-- with the command activity registry, commands publish themselves and currentOp still works
+SET documentdb.enableCommandActivityRegistry TO on;
+SELECT documentdb_api.insert_one('db', 'coll_agnostic_activity', '{ "_id": 1 }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "coll_agnostic_activity", "pipeline": [ { "$match": { "_id": 1 } } ] }');
+SELECT document FROM bson_aggregation_pipeline('admin', '{ "aggregate": 1, "pipeline": [ { "$currentOp": {} }, { "$project": { "opid": 0, "op_prefix": 0, "currentOpTime": 0, "secs_running": 0 }}] }');
+RESET documentdb.enableCommandActivityRegistry;
+
 -- collection agnostic with no pipeline should work and return 0 rows.
 SELECT document from bson_aggregation_pipeline('db', '{ "aggregate" : 1.0, "pipeline" : [  ], "cursor" : {  }, "txnNumber" : 0, "lsid" : { "id" : { "$binary" : { "base64": "H+W3J//vSn6obaefeJ6j/g==", "subType" : "04" } } }, "$db" : "admin" }');
\ No newline at end of file
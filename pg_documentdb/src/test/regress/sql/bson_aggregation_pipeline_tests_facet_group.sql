@@ -34,3 +34,49 @@ SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$addFields": {"name": "$a.c"} }, { "$sort": { "a.b": -1, "name" : 1 } },  { "$group": { "_id": "$a.b", "first": { "$first" : "$name" }, "last": { "$last": "$name" } } } ] }');
 
 SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$addFields": {"name": "$a.c"} }, { "$sort": { "a.b": -1, "name" : -1 } },  { "$group": { "_id": "$a.b", "first": { "$first" : "$name" }, "last": { "$last": "$name" } } } ] }');
+
+-- $first of each group after a $sort on the group key keeps the first sorted row of each group
+BEGIN;
+SET LOCAL documentdb.enableGroupFirstRowPerGroup TO on;
+SELECT documentdb_api.insert_one('db','agg_facet_group','{ "_id": 10, "a": { "b": [ 1, 4 ], "c": 5} }', NULL);
+SELECT documentdb_api.insert_one('db','agg_facet_group','{ "_id": 11, "a": { "c": 6} }', NULL);
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": 1, "a.c" : -1 } },  { "$group": { "_id": "$a.b", "latest": { "$first" : "$$ROOT" }, "c": { "$first": "$a.c" }, "missing": { "$first": "$noField" } } }, { "$sort": { "_id": 1 } } ] }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": -1, "a.c" : 1 } },  { "$group": { "_id": "$a.b", "c": { "$first": "$a.c" } } }, { "$sort": { "_id": 1 } } ] }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": 1, "a.c" : -1 } },  { "$group": { "_id": "$a.b", "latest": { "$first" : "$$ROOT" } } } ] }');
+
+-- other shapes still use the accumulators
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": 1, "a.c" : -1 } },  { "$group": { "_id": "$a.b", "first": { "$first" : "$a.c" }, "last": { "$last": "$a.c" } } } ] }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.c": 1 } },  { "$group": { "_id": "$a.b", "first": { "$first" : "$a.c" } } } ] }');
+ROLLBACK;
+
+-- the fields are validated like any other $group
+SET documentdb.enableGroupFirstRowPerGroup TO on;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": 1 } },  { "$group": { "_id": "$a.b", "c.d": { "$first" : "$a.c" } } } ] }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": 1 } },  { "$group": { "_id": "$a.b", "c": "$a.c" } } ] }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.b": 1 } },  { "$group": { "_id": "$a.b", "c": { "$first" : "$a.c", "$last": "$a.c" } } } ] }');
+RESET documentdb.enableGroupFirstRowPerGroup;
+
+-- $first, $last, $firstN and $lastN without a sort use the combinable aggregates with parallel accumulators
+BEGIN;
+SET LOCAL documentdb.enableParallelGroupAccumulators TO on;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$group": { "_id": "$a.b", "first": { "$firstN" : { "input": "$a.c", "n": 10 } }, "last": { "$lastN" : { "input": "$a.c", "n": 1 } }, "count": { "$sum": 1 } } }, { "$project": { "first": { "$size": "$first" }, "last": { "$size": "$last" }, "count": 1 } }, { "$sort": { "_id": 1 } } ] }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$group": { "_id": "$a.b", "first": { "$first" : "$a.c" }, "last": { "$last": "$a.c" }, "firstN": { "$firstN" : { "input": "$a.c", "n": 2 } }, "lastN": { "$lastN" : { "input": "$a.c", "n": 2 } } } } ] }');
+
+-- a prior $sort still uses the sorted aggregates
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_facet_group", "pipeline": [ { "$sort": { "a.c": 1 } },  { "$group": { "_id": "$a.b", "first": { "$first" : "$a.c" } } } ] }');
+ROLLBACK;
+
+-- $sum and $avg over mixed numeric types give the same result as adding row by row
+SELECT documentdb_api.insert('db', '{ "insert": "agg_sum_decimal", "documents": [
+   { "_id": 1, "g": "a", "v": 1 }, { "_id": 2, "g": "a", "v": { "$numberLong": "2" } }, { "_id": 3, "g": "a", "v": { "$numberDecimal": "0.25" } },
+   { "_id": 4, "g": "a", "v": { "$numberDecimal": "0.50" } }, { "_id": 5, "g": "a", "v": { "$numberDecimal": "0.75" } }, { "_id": 6, "g": "a", "v": 3 },
+   { "_id": 7, "g": "b", "v": { "$numberDecimal": "1" } }, { "_id": 8, "g": "b", "v": { "$numberLong": "9223372036854775807" } }, { "_id": 9, "g": "b", "v": { "$numberLong": "1" } },
+   { "_id": 10, "g": "c", "v": { "$numberLong": "9223372036854775807" } }, { "_id": 11, "g": "c", "v": 1 }, { "_id": 12, "g": "c", "v": { "$numberLong": "1" } },
+   { "_id": 13, "g": "d", "v": { "$numberDecimal": "1E+40" } }, { "_id": 14, "g": "d", "v": { "$numberDecimal": "6E+6" } }, { "_id": 15, "g": "d", "v": { "$numberDecimal": "6E+6" } },
+   { "_id": 16, "g": "e", "v": { "$numberDecimal": "9999999999999999999999999999999999" } }, { "_id": 17, "g": "e", "v": { "$numberDecimal": "1" } }
+]}');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_sum_decimal", "pipeline": [ { "$group": { "_id": "$g", "sum": { "$sum": "$v" } } }, { "$sort": { "_id": 1 } } ] }');
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_sum_decimal", "pipeline": [ { "$match": { "g": "a" } }, { "$group": { "_id": "$g", "avg": { "$avg": "$v" } } } ] }');
+SET documentdb.enableDecimal128SumFastPath TO off;
+SELECT document FROM bson_aggregation_pipeline('db', '{ "aggregate": "agg_sum_decimal", "pipeline": [ { "$group": { "_id": "$g", "sum": { "$sum": "$v" } } }, { "$sort": { "_id": 1 } } ] }');
+RESET documentdb.enableDecimal128SumFastPath;
@@ -77,3 +77,16 @@ SELECT document from bson_aggregation_pipeline('invmatch', '{ "aggregate": "sale
 SELECT document from bson_aggregation_pipeline('invmatch', '{ "aggregate": "sales", "pipeline": [ { "$inverseMatch": {"path": "rule", "from": "collection"}} ], "cursor": {} }');
 SELECT document from bson_aggregation_pipeline('invmatch', '{ "aggregate": "sales", "pipeline": [ { "$inverseMatch": {"rule": "rule"}} ], "cursor": {} }');
 SELECT document from bson_aggregation_pipeline('invmatch', '{ "aggregate": "sales", "pipeline": [ { "$inverseMatch": {"path": "rule", "from": "mycoll", "pipeline": []}} ], "cursor": {} }');
+
+-- rules made of simple comparisons are evaluated with compiled predicate programs, with the query operators as fallback
+SELECT documentdb_api.insert_one('invmatch','compiled_rules','{ "_id": 1, "rule": { "severity": { "$gte": 3 }, "source": "db" } }', NULL);
+SELECT documentdb_api.insert_one('invmatch','compiled_rules','{ "_id": 2, "rule": { "$or": [ { "source": "web" }, { "region": { "$exists": true } } ] } }', NULL);
+SELECT documentdb_api.insert_one('invmatch','compiled_rules','{ "_id": 3, "rule": { "source": { "$ne": "db" }, "owner": null } }', NULL);
+SELECT documentdb_api.insert_one('invmatch','compiled_rules','{ "_id": 4, "rule": { "tags": "vip" } }', NULL);
+SELECT document FROM bson_aggregation_pipeline('invmatch', '{ "aggregate": "compiled_rules", "pipeline": [ { "$inverseMatch": {"path": "rule", "input": { "severity": 4.5, "source": "db" }}}, { "$project": { "_id": 1 } } ]}');
+SELECT document FROM bson_aggregation_pipeline('invmatch', '{ "aggregate": "compiled_rules", "pipeline": [ { "$inverseMatch": {"path": "rule", "input": { "severity": 1, "source": "web", "region": "us" }}}, { "$project": { "_id": 1 } } ]}');
+SELECT document FROM bson_aggregation_pipeline('invmatch', '{ "aggregate": "compiled_rules", "pipeline": [ { "$inverseMatch": {"path": "rule", "input": [ { "severity": 1 }, { "tags": [ "vip", "gold" ] } ]}}, { "$project": { "_id": 1 } } ]}');
+BEGIN;
+set local documentdb.enableCompiledQueryPredicates to off;
+SELECT document FROM bson_aggregation_pipeline('invmatch', '{ "aggregate": "compiled_rules", "pipeline": [ { "$inverseMatch": {"path": "rule", "input": { "severity": 4.5, "source": "db" }}}, { "$project": { "_id": 1 } } ]}');
+ROLLBACK;
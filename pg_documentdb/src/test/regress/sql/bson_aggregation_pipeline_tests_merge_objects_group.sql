@@ -41,4 +41,10 @@ SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "
 SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "mergeObjectsGroupColl", "pipeline": [ { "$sort": { "category": 1 } }, { "$group": { "_id": "$year", "shouldFail": { "$mergeObjects": "$category" } } } ] }');
 
 select documentdb_api.drop_collection('db','mergeObjectsGroupColl');
-select documentdb_api.drop_collection('db','mergeObjectsGroupColl2');
\ No newline at end of file
+select documentdb_api.drop_collection('db','mergeObjectsGroupColl2');
+-- wide documents: the merge and projection trees index the children of wide nodes
+SELECT documentdb_api.insert_one('db', 'mergeObjectsWideColl', '{ "_id": 1, "g": 1, "stats": { "f0": 0, "f1": 1, "f2": 2, "f3": 3, "f4": 4, "f5": 5, "f6": 6, "f7": 7, "f8": 8, "f9": 9, "f10": 10, "f11": 11, "f12": 12, "f13": 13, "f14": 14, "f15": 15, "f16": 16, "f17": 17, "f18": 18, "f19": 19 } }');
+SELECT documentdb_api.insert_one('db', 'mergeObjectsWideColl', '{ "_id": 2, "g": 1, "stats": { "f10": 1000, "f11": 1100, "f12": 1200, "f13": 1300, "f14": 1400, "f15": 1500, "f16": 1600, "f17": 1700, "f18": 1800, "f19": 1900, "f20": 2000, "f21": 2100, "f22": 2200, "f23": 2300, "f24": 2400, "f25": 2500, "f26": 2600, "f27": 2700, "f28": 2800, "f29": 2900 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "mergeObjectsWideColl", "pipeline": [ { "$sort": { "_id": 1 } }, { "$group": { "_id": "$g", "merged": { "$mergeObjects": "$stats" } } } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "mergeObjectsWideColl", "pipeline": [ { "$sort": { "_id": 1 } }, { "$replaceRoot": { "newRoot": "$stats" } }, { "$project": { "_id": 0, "f0": 1, "f2": 1, "f4": 1, "f6": 1, "f8": 1, "f10": 1, "f12": 1, "f14": 1, "f16": 1, "f18": 1, "f20": 1, "f22": 1, "f24": 1, "f26": 1, "f28": 1 } } ] }');
+select documentdb_api.drop_collection('db','mergeObjectsWideColl');
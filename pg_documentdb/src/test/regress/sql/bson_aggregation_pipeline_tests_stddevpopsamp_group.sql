@@ -146,4 +146,14 @@ SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "
 
 /* nagetive tests */
 SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "stdDev": { "$stdDevPop": ["$num"] } } } ] }');
-SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "stdDev": { "$stdDevSamp": ["$num"] } } } ] }');
\ No newline at end of file
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "stdDev": { "$stdDevSamp": ["$num"] } } } ] }');
+/* exact $percentile and $median with the discrete method */
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "median": { "$median": { "input": "$num", "method": "discrete" } } } } ] }');
+SET documentdb.enableExactPercentile TO on;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "median": { "$median": { "input": "$num", "method": "discrete" } } } } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "percentiles": { "$percentile": { "input": "$num", "p": [ 0.9, 0, 0.5, 1, 0.25 ], "method": "discrete" } } } } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "empty_col", "pipeline": [ { "$group": { "_id": 1, "median": { "$median": { "input": "$num", "method": "discrete" } }, "percentiles": { "$percentile": { "input": "$num", "p": [ 0.5 ], "method": "discrete" } } } } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "two_nums", "pipeline": [ { "$group": { "_id": 1, "median": { "$median": { "input": "$num", "method": "discrete" } } } } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "percentiles": { "$percentile": { "input": "$num", "p": [ 1.5 ], "method": "discrete" } } } } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "tests", "pipeline": [ { "$group": { "_id": "$group", "percentiles": { "$percentile": { "input": "$num", "p": [ 0.5 ], "method": "continuous" } } } } ] }');
+RESET documentdb.enableExactPercentile;
@@ -100,3 +100,15 @@ SELECT * FROM documentdb_api_catalog.bson_aggregation_find('sortdb', '{ "find":
 -- test null
 SELECT * FROM documentdb_api_catalog.bson_aggregation_find('sortdb', '{ "find": "sortcoll4", "filter": { "a.b.c": null }, "sort": { "a.b.c": 1, "_id": 1 } }');
 SELECT * FROM documentdb_api_catalog.bson_aggregation_find('sortdb', '{ "find": "sortcoll4", "filter": { "a.b.c": { "$ne": null } }, "sort": { "a.b.c": 1, "_id": 1 } }');
+
+-- ordered composite index scans stream their first tuple, so sort + limit can use them
+SELECT documentdb_api_internal.create_indexes_non_concurrently('sortdb', '{ "createIndexes": "sortcoll5", "indexes": [ { "key": { "a.b.c": 1 }, "enableCompositeTerm": true, "name": "a.b.c_1" }] }', true);
+SELECT COUNT(*) FROM (SELECT documentdb_api.insert_one('sortdb', 'sortcoll5', FORMAT('{ "_id": %s, "a": { "b": { "c": %s } } }', i, i)::documentdb_core.bson) FROM generate_series(1, 1000) i) innerQuery;
+ANALYZE documentdb_data.documents_101404;
+
+set documentdb.enableIndexOrderbyPushdown to on;
+set documentdb.enableOrderedIndexScanStartupCost to on;
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('sortdb', '{ "find": "sortcoll5", "filter": { "a.b.c": { "$exists": true } }, "sort": { "a.b.c": -1 }, "limit": 2 }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('sortdb', '{ "find": "sortcoll5", "filter": { "a.b.c": { "$exists": true } }, "sort": { "a.b.c": -1 }, "limit": 2 }');
+reset documentdb.enableOrderedIndexScanStartupCost;
+reset documentdb.enableIndexOrderbyPushdown;
@@ -919,4 +919,12 @@ SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_upd
 
 --$rename working complex cases
 SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 1, "key": 1,"key2": 2,"f": {"g": 1, "h": 1},"h":1}', '{ "": { "$rename": { "key": "f.g"} } }', '{}');
-SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 2, "key": 2,"x": {"y": 1, "z": 2}}', '{ "": { "$rename": { "key": "newName","x.y":"z","x.z":"k"} } }', '{}');
\ No newline at end of file
+SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 2, "key": 2,"x": {"y": 1, "z": 2}}', '{ "": { "$rename": { "key": "newName","x.y":"z","x.z":"k"} } }', '{}');
+-- positional $ with $elemMatch on documents of the array (compiled and fallback matching)
+SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 1, "a": [ { "b": 1, "c": 1 }, { "b": 2, "c": 2 }, { "b": 2, "c": 3 } ] }', '{ "": { "$set": { "a.$.d": true } } }', '{ "a": { "$elemMatch": { "b": 2, "c": { "$gt": 2 } } } }');
+SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 1, "a": [ 5, { "b": [ 2 ] }, { "b": 2 } ] }', '{ "": { "$set": { "a.$": 0 } } }', '{ "a": { "$elemMatch": { "b": 2 } } }');
+SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 1, "a": [ { "b": null }, { "c": 1 } ] }', '{ "": { "$set": { "a.$": 0 } } }', '{ "a": { "$elemMatch": { "b": { "$exists": false } } } }');
+BEGIN;
+set local documentdb.enableCompiledQueryPredicates to off;
+SELECT newDocument as bson_update_document FROM documentdb_api_internal.bson_update_document('{"_id": 1, "a": [ { "b": 1, "c": 1 }, { "b": 2, "c": 2 }, { "b": 2, "c": 3 } ] }', '{ "": { "$set": { "a.$.d": true } } }', '{ "a": { "$elemMatch": { "b": 2, "c": { "$gt": 2 } } } }');
+ROLLBACK;
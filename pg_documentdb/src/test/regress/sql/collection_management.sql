@@ -134,3 +134,8 @@ SELECT * FROM documentdb_api.collection('db','lagacy_coll');
 SELECT document, shard_key_value FROM documentdb_api.collection('db','lagacy_coll');
 ROLLBACK;
 
+
+-- a new backend prepares the queries that the backends of its database prepared
+\c regression
+SELECT documentdb_api_internal.prewarm_query_plan_cache(0);
+SELECT documentdb_api_internal.prewarm_query_plan_cache() > 0;
@@ -433,4 +433,112 @@ SELECT documentdb_api_internal.create_indexes_non_concurrently('wp_test',
         ]
     }'
 );
-SELECT documentdb_test_helpers.documentdb_index_get_pg_def('wp_test', 'no_path_collision_4', 'idx_1');
\ No newline at end of file
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('wp_test', 'no_path_collision_4', 'idx_1');
+-- inclusion projections can store the ordinal of the included path in their terms
+SET documentdb.enableCompactWildcardProjectionTerms TO on;
+SELECT documentdb_api_internal.create_indexes_non_concurrently('wp_test',
+    '{
+        "createIndexes": "compact_paths",
+        "indexes": [
+            {
+                "key": {"$**": 1}, "name": "idx_1",
+                "wildcardProjection": {"a.b": 1, "c": 1}
+            },
+            {
+                "key": {"$**": 1}, "name": "idx_2",
+                "wildcardProjection": {"a.b": 0}
+            }
+        ]
+    }'
+);
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('wp_test', 'compact_paths', 'idx_1');
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('wp_test', 'compact_paths', 'idx_2');
+RESET documentdb.enableCompactWildcardProjectionTerms;
+
+SELECT documentdb_api.insert_one('wp_test', 'compact_paths', '{ "_id": 1, "a": { "b": { "d": 1 } }, "c": 2 }');
+SELECT documentdb_api.insert_one('wp_test', 'compact_paths', '{ "_id": 2, "a": { "b": { "d": 2 }, "e": 1 }, "c": [ 1, 2 ] }');
+SELECT documentdb_api.insert_one('wp_test', 'compact_paths', '{ "_id": 3, "a": { "bb": 1 }, "c": { "f": 3 } }');
+
+BEGIN;
+SET LOCAL documentdb.forceUseIndexIfAvailable TO on;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('wp_test', '{ "find": "compact_paths", "filter": { "a.b.d": { "$gte": 1 } } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('wp_test', '{ "find": "compact_paths", "filter": { "a.b": { "d": 2 } } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('wp_test', '{ "find": "compact_paths", "filter": { "c": 2 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('wp_test', '{ "find": "compact_paths", "filter": { "c.f": 3 } }');
+ROLLBACK;
+
+-- single field hashed indexes can be backed by a native hash index
+SET documentdb.enableNativeHashIndex TO on;
+SELECT documentdb_api_internal.create_indexes_non_concurrently('hash_test', '{"createIndexes": "native_hash", "indexes": [{"key": {"a.b": "hashed"}, "name": "a_b_hashed"}, {"key": {"a": "hashed", "c": 1}, "name": "a_c_hashed"}]}', true);
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('hash_test', 'native_hash', 'a_b_hashed');
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('hash_test', 'native_hash', 'a_c_hashed');
+RESET documentdb.enableNativeHashIndex;
+
+SELECT documentdb_api.insert_one('hash_test', 'native_hash', '{ "_id": 1, "a": { "b": 1 } }');
+SELECT documentdb_api.insert_one('hash_test', 'native_hash', '{ "_id": 2, "a": { "b": 1.0 } }');
+SELECT documentdb_api.insert_one('hash_test', 'native_hash', '{ "_id": 3, "a": { "b": "1" } }');
+SELECT documentdb_api.insert_one('hash_test', 'native_hash', '{ "_id": 4, "a": { "c": 1 } }');
+SELECT documentdb_api.insert_one('hash_test', 'native_hash', '{ "_id": 5, "a": { "b": null } }');
+
+BEGIN;
+SET LOCAL documentdb.forceUseIndexIfAvailable TO on;
+SET LOCAL enable_seqscan TO off;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('hash_test', '{ "find": "native_hash", "filter": { "a.b": 1 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('hash_test', '{ "find": "native_hash", "filter": { "a.b": "1" } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('hash_test', '{ "find": "native_hash", "filter": { "a.b": null } }');
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('hash_test', '{ "find": "native_hash", "filter": { "a.b": 1 } }');
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('hash_test', '{ "find": "native_hash", "filter": { "a.b": { "$gt": 1 } } }');
+ROLLBACK;
+
+-- single path indexes can store a hash of the full value next to truncated terms
+SET documentdb.enableHashedTruncatedIndexTerms TO on;
+SET documentdb.indexTermLimitOverride TO 100;
+SELECT documentdb_api_internal.create_indexes_non_concurrently('trunc_hash_test', '{"createIndexes": "urls", "indexes": [{"key": {"url": 1}, "name": "url_1"}]}', true);
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('trunc_hash_test', 'urls', 'url_1');
+RESET documentdb.indexTermLimitOverride;
+RESET documentdb.enableHashedTruncatedIndexTerms;
+
+SELECT documentdb_api.insert_one('trunc_hash_test', 'urls', FORMAT('{ "_id": %s, "url": "https://example.com/%s/%s" }', i, repeat('a', 150), i)::bson) FROM generate_series(1, 5) i;
+SELECT documentdb_api.insert_one('trunc_hash_test', 'urls', '{ "_id": 6, "url": "https://example.com/short" }');
+
+BEGIN;
+SET LOCAL documentdb.forceUseIndexIfAvailable TO on;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('trunc_hash_test', FORMAT('{ "find": "urls", "filter": { "url": "https://example.com/%s/3" }, "projection": { "_id": 1 } }', repeat('a', 150))::bson);
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('trunc_hash_test', FORMAT('{ "find": "urls", "filter": { "url": "https://example.com/%s/7" }, "projection": { "_id": 1 } }', repeat('a', 150))::bson);
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('trunc_hash_test', FORMAT('{ "find": "urls", "filter": { "url": { "$gte": "https://example.com/%s/3" } }, "projection": { "_id": 1 } }', repeat('a', 150))::bson);
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('trunc_hash_test', '{ "find": "urls", "filter": { "url": "https://example.com/short" }, "projection": { "_id": 1 } }');
+ROLLBACK;
+
+-- single path indexes with a collation store the collation sort keys of string terms
+SET documentdb_core.enableCollation TO on;
+SELECT documentdb_api_internal.create_indexes_non_concurrently('collation_idx_test', '{"createIndexes": "names", "indexes": [{"key": {"name": 1}, "name": "name_1_ci", "collation": { "locale": "en", "strength": 2 }}]}', true);
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('collation_idx_test', 'names', 'name_1_ci');
+SELECT documentdb_api_internal.create_indexes_non_concurrently('collation_idx_test', '{"createIndexes": "names", "indexes": [{"key": {"nick": 1}, "name": "nick_1_simple", "collation": { "locale": "simple" }}]}', true);
+SELECT documentdb_test_helpers.documentdb_index_get_pg_def('collation_idx_test', 'names', 'nick_1_simple');
+
+-- collation is only supported with non-unique regular indexes
+SELECT documentdb_api_internal.create_indexes_non_concurrently('collation_idx_test', '{"createIndexes": "names", "indexes": [{"key": {"name": 1}, "name": "name_1_unique", "unique": true, "collation": { "locale": "en", "strength": 2 }}]}', true);
+SELECT documentdb_api_internal.create_indexes_non_concurrently('collation_idx_test', '{"createIndexes": "names", "indexes": [{"key": {"name": "hashed"}, "name": "name_hashed", "collation": { "locale": "en", "strength": 2 }}]}', true);
+SELECT documentdb_api_internal.create_indexes_non_concurrently('collation_idx_test', '{"createIndexes": "names", "indexes": [{"key": {"$**": 1}, "name": "wildcard_ci", "collation": { "locale": "en", "strength": 2 }}]}', true);
+
+SELECT documentdb_api.insert_one('collation_idx_test', 'names', '{ "_id": 1, "name": "alice" }');
+SELECT documentdb_api.insert_one('collation_idx_test', 'names', '{ "_id": 2, "name": "ALICE" }');
+SELECT documentdb_api.insert_one('collation_idx_test', 'names', '{ "_id": 3, "name": "Bob" }');
+SELECT documentdb_api.insert_one('collation_idx_test', 'names', '{ "_id": 4, "name": "carol" }');
+SELECT documentdb_api.insert_one('collation_idx_test', 'names', '{ "_id": 5, "name": 5 }');
+
+BEGIN;
+SET LOCAL documentdb.forceUseIndexIfAvailable TO on;
+SET LOCAL enable_seqscan TO off;
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": "Alice" }, "collation": { "locale": "en", "strength": 2 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": { "$gt": "ALICE", "$lte": "CAROL" } }, "collation": { "locale": "en", "strength": 2 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": { "$in": [ "bob", "CaRoL" ] } }, "collation": { "locale": "en", "strength": 2 } }');
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": "Alice" }, "collation": { "locale": "en", "strength": 2 } }');
+
+-- queries without the collation of the index only use it for values that aren't strings
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": "alice" } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": 5 } }');
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": "alice" } }');
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('collation_idx_test', '{ "find": "names", "filter": { "name": 5 } }');
+ROLLBACK;
+RESET documentdb_core.enableCollation;
@@ -53,4 +53,35 @@ SELECT documentdb_api_catalog.bson_dollar_unwind(cursorpage, '$cursor.firstBatch
 EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_find('collmod', '{ "find": "coll_mod_test_hidden", "filter": { "a": 1 } }');
 
 -- the row shows up from the index 
-SELECT document FROM bson_aggregation_find('collmod', '{ "find": "coll_mod_test_hidden", "filter": { "a": 101 } }');
\ No newline at end of file
+SELECT document FROM bson_aggregation_find('collmod', '{ "find": "coll_mod_test_hidden", "filter": { "a": 101 } }');
+-- columnar projection store
+SELECT documentdb_api.create_collection('collmod','coll_mod_test_columnar');
+SELECT documentdb_api.insert_one('collmod','coll_mod_test_columnar', '{"_id": 1, "a": 1, "b": { "c": 1, "d": "x" }, "e": "large" }');
+SELECT documentdb_api.insert_one('collmod','coll_mod_test_columnar', '{"_id": 2, "a": 2, "b": { "c": 2, "d": "y" }, "e": "large" }');
+
+-- off by default
+SELECT documentdb_api.coll_mod('collmod', 'coll_mod_test_columnar', '{ "collMod": "coll_mod_test_columnar", "columnarPaths": [ "a" ] }');
+
+SET documentdb.enableColumnarProjectionStore TO on;
+SELECT documentdb_api.coll_mod('collmod', 'coll_mod_test_columnar', '{ "collMod": "coll_mod_test_columnar", "columnarPaths": "a" }');
+SELECT documentdb_api.coll_mod('collmod', 'coll_mod_test_columnar', '{ "collMod": "coll_mod_test_columnar", "columnarPaths": [ "$a" ] }');
+SELECT documentdb_api.coll_mod('collmod', 'coll_mod_test_columnar', '{ "collMod": "coll_mod_test_columnar", "columnarPaths": [ "b", "b.c" ] }');
+SELECT documentdb_api.coll_mod('collmod', 'coll_mod_test_columnar', '{ "collMod": "coll_mod_test_columnar", "columnarPaths": [ "a", "b.c" ] }');
+
+-- the store is filled from the existing documents and kept in sync on writes
+SELECT documentdb_api.insert_one('collmod','coll_mod_test_columnar', '{"_id": 3, "a": 3, "b": { "c": 3 }, "e": "large" }');
+SELECT documentdb_api.update('collmod', '{ "update": "coll_mod_test_columnar", "updates": [ { "q": { "_id": 1 }, "u": { "$set": { "a": 10 } } } ] }');
+SELECT documentdb_api.delete('collmod', '{ "delete": "coll_mod_test_columnar", "deletes": [ { "q": { "_id": 2 }, "limit": 1 } ] }');
+SELECT object_id, document FROM documentdb_data.columns_8702 ORDER BY object_id;
+
+-- covered pipelines read the store, the others the data table
+SELECT document FROM bson_aggregation_pipeline('collmod', '{ "aggregate": "coll_mod_test_columnar", "pipeline": [ { "$match": { "a": { "$gt": 1 } } }, { "$group": { "_id": null, "s": { "$sum": "$b.c" } } } ], "cursor": {} }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('collmod', '{ "aggregate": "coll_mod_test_columnar", "pipeline": [ { "$match": { "a": { "$gt": 1 } } }, { "$group": { "_id": null, "s": { "$sum": "$b.c" } } } ], "cursor": {} }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('collmod', '{ "aggregate": "coll_mod_test_columnar", "pipeline": [ { "$sort": { "a": 1 } }, { "$project": { "a": 1, "c": "$b.c" } } ], "cursor": {} }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('collmod', '{ "aggregate": "coll_mod_test_columnar", "pipeline": [ { "$group": { "_id": "$b.d", "c": { "$sum": 1 } } } ], "cursor": {} }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_pipeline('collmod', '{ "aggregate": "coll_mod_test_columnar", "pipeline": [ { "$project": { "e": 0 } } ], "cursor": {} }');
+
+-- an empty array drops the store
+SELECT documentdb_api.coll_mod('collmod', 'coll_mod_test_columnar', '{ "collMod": "coll_mod_test_columnar", "columnarPaths": [ ] }');
+SELECT to_regclass('documentdb_data.columns_8702');
+RESET documentdb.enableColumnarProjectionStore;
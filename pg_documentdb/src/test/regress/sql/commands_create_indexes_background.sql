@@ -372,4 +372,11 @@ SELECT index_cmd, cmd_type, index_id, index_cmd_status, collection_id FROM docum
 CALL documentdb_api_internal.build_index_concurrently(1);
 
 --all indexes should be built and queue should be empty.
-SELECT * FROM documentdb_api_catalog.documentdb_index_queue;
\ No newline at end of file
+SELECT * FROM documentdb_api_catalog.documentdb_index_queue;
+
+-- index builds are not held back by the replication lag check when there are no replicas
+SELECT * FROM documentdb_api_internal.reindex_index_background('db', '{ "collection": "backgroundcoll1", "indexes": [ 32044 ] }');
+SET documentdb.maxIndexBuildReplicationLagInSec TO 1;
+CALL documentdb_api_internal.build_index_concurrently(1);
+RESET documentdb.maxIndexBuildReplicationLagInSec;
+SELECT * FROM documentdb_api_catalog.documentdb_index_queue;
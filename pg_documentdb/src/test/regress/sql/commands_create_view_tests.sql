@@ -8,7 +8,7 @@ SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tes
 SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tests", "capped": 2.3}');
 SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tests", "capped": "true"}');
 SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tests", "capped": "false"}');
-SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tests", "timeseries": { "timeField": "a" } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tests", "timeseries": { "metaField": "a" } }');
 SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_tests", "clusteredIndex": { } }');
 SELECT documentdb_api.create_collection_view('db', '{ "create": 2 }');
 SELECT documentdb_api.create_collection_view('db', '{ "create": false }');
@@ -110,4 +110,78 @@ SELECT documentdb_api.create_collection_view('db', '{ "create": "create_view_cyc
 
 
 -- create with long name
-SELECT documentdb_api.create_collection_view('db', FORMAT('{ "create": "create_view_cycle_4_%s", "viewOn": "create_view_cycle_1" }', repeat('1bc', 80))::documentdb_core.bson);
\ No newline at end of file
+SELECT documentdb_api.create_collection_view('db', FORMAT('{ "create": "create_view_cycle_4_%s", "viewOn": "create_view_cycle_1" }', repeat('1bc', 80))::documentdb_core.bson);
+
+-- materialize a view and refresh it incrementally
+SELECT documentdb_api.insert_one('db', 'refresh_view_source', '{ "_id": 1, "a": 1 }');
+SELECT documentdb_api.insert_one('db', 'refresh_view_source', '{ "_id": 2, "a": 2 }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "refresh_view_1", "viewOn": "refresh_view_source", "pipeline": [ { "$addFields": { "b": { "$multiply": [ "$a", 10 ] } } } ] }');
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_1", "into": "refresh_view_target" }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "refresh_view_target", "sort": { "_id": 1 } }');
+
+SELECT documentdb_api.insert_one('db', 'refresh_view_source', '{ "_id": 3, "a": 3 }');
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_1", "into": "refresh_view_target", "after": 2 }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "refresh_view_target", "sort": { "_id": 1 } }');
+
+-- nothing new: the watermark is unchanged
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_1", "into": "refresh_view_target", "after": 3 }');
+
+-- stages that aren't per document can only be fully refreshed
+SELECT documentdb_api.create_collection_view('db', '{ "create": "refresh_view_2", "viewOn": "refresh_view_source", "pipeline": [ { "$group": { "_id": null, "c": { "$sum": 1 } } } ] }');
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_2", "into": "refresh_view_target_2", "after": 2 }');
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_2", "into": "refresh_view_target_2" }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "refresh_view_target_2" }');
+
+-- a full refresh includes every _id type, not only those of the largest _id
+SELECT documentdb_api.insert_one('db', 'refresh_view_source', '{ "_id": "x", "a": 4 }');
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_1", "into": "refresh_view_target" }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "refresh_view_target", "sort": { "_id": 1 } }');
+
+-- not a view
+SELECT documentdb_api.refresh_materialized_view('db', '{ "refreshView": "refresh_view_source", "into": "refresh_view_target" }');
+
+-- time-series collections
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "timeseries": { "timeField": "t", "metaField": "t" } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "timeseries": { "timeField": "$t" } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "timeseries": { "timeField": "t", "granularity": "days" } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "viewOn": "create_view_tests", "timeseries": { "timeField": "t" } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "timeseries": { "timeField": "t", "metaField": "m", "granularity": "hours" } }');
+
+-- noop, and a conflicting spec
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "timeseries": { "timeField": "t", "metaField": "m", "granularity": "hours" } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "ts_view_tests", "timeseries": { "timeField": "t" } }');
+
+SELECT documentdb_api.insert('db', '{ "insert": "ts_view_tests", "documents": [ { "_id": 1, "t": { "$date": { "$numberLong": "1700000000000" } }, "m": "a", "v": 1 }, { "_id": 2, "t": { "$date": { "$numberLong": "1700000060000" } }, "m": "a", "v": 2 }, { "_id": 3, "t": { "$date": { "$numberLong": "1700000000000" } }, "m": "b", "v": 3 }, { "_id": 4, "t": { "$date": { "$numberLong": "1710000000000" } }, "m": "a", "v": 4 } ] }');
+SELECT documentdb_api.insert('db', '{ "insert": "ts_view_tests", "documents": [ { "_id": 5, "t": { "$date": { "$numberLong": "1700000120000" } }, "m": "a", "v": 5 } ] }');
+
+-- measurements without a valid time are rejected
+SELECT documentdb_api.insert('db', '{ "insert": "ts_view_tests", "documents": [ { "_id": 6, "t": 1, "m": "a" } ] }');
+
+-- the buckets hold the measurements by meta and time window
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "system.buckets.ts_view_tests", "projection": { "_id": 0 }, "sort": { "meta": 1, "control.min.t": 1 } }');
+
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "ts_view_tests", "sort": { "_id": 1 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "ts_view_tests", "filter": { "m": "a", "t": { "$lt": { "$date": { "$numberLong": "1705000000000" } } } }, "sort": { "_id": 1 } }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_pipeline('db', '{ "aggregate": "ts_view_tests", "pipeline": [ { "$match": { "v": { "$gte": 3 } } }, { "$sort": { "_id": 1 } } ], "cursor": {} }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_count('db', '{ "count": "ts_view_tests", "query": { "m": "b" } }');
+
+-- the filter is also applied on the bucket bounds
+EXPLAIN (COSTS OFF) SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "ts_view_tests", "filter": { "m": "a", "t": { "$lt": { "$date": { "$numberLong": "1705000000000" } } } } }');
+
+-- clustered collections
+SET documentdb.enableClusteredCollections TO on;
+SELECT documentdb_api.create_collection_view('db', '{ "create": "clustered_view_tests", "clusteredIndex": { "key": { "a": 1 }, "unique": true } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "clustered_view_tests", "clusteredIndex": { "key": { "_id": 1 }, "unique": false } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "clustered_view_tests", "clusteredIndex": { "unique": true } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "clustered_view_tests", "clusteredIndex": { "key": { "_id": 1 }, "unique": true, "foo": 1 } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "clustered_view_tests", "viewOn": "create_view_tests", "clusteredIndex": { "key": { "_id": 1 }, "unique": true } }');
+SELECT documentdb_api.create_collection_view('db', '{ "create": "clustered_view_tests", "clusteredIndex": { "key": { "_id": 1 }, "unique": true, "name": "clustered_id" } }');
+
+SELECT indisclustered FROM pg_index WHERE indexrelid = (
+    SELECT ('documentdb_data.collection_pk_' || collection_id)::regclass FROM documentdb_api_catalog.collections WHERE collection_name = 'clustered_view_tests');
+SELECT reloptions FROM pg_class WHERE oid = (
+    SELECT ('documentdb_data.documents_' || collection_id)::regclass FROM documentdb_api_catalog.collections WHERE collection_name = 'clustered_view_tests');
+
+SELECT documentdb_api.insert('db', '{ "insert": "clustered_view_tests", "documents": [ { "_id": 3 }, { "_id": 1 }, { "_id": 2 } ] }');
+SELECT document FROM documentdb_api_catalog.bson_aggregation_find('db', '{ "find": "clustered_view_tests", "filter": { "_id": { "$gte": 2 } }, "sort": { "_id": 1 } }');
+RESET documentdb.enableClusteredCollections;
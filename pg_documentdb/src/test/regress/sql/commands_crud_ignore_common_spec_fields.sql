@@ -53,4 +53,49 @@ select documentdb_api.insert('db', '{
 	"documents":[{"_id":2,"a":"id2"}],
 	"ordered": false,
         "bypassDocumentValidation": true,
-	"comment": "NoOp2"}');
\ No newline at end of file
+	"comment": "NoOp2"}');
+-- a relaxed write concern commits the write asynchronously
+SET documentdb.enableRelaxedDurabilityWriteConcern TO on;
+select documentdb_api.insert('db', '{"insert":"ignoreCommonSpec", "documents":[{"_id":3,"a":"id3"}], "writeConcern": {"w": 1}}'), current_setting('synchronous_commit');
+select documentdb_api.insert('db', '{"insert":"ignoreCommonSpec", "documents":[{"_id":4,"a":"id4"}], "writeConcern": {"w": 0, "j": true}}'), current_setting('synchronous_commit');
+select documentdb_api.insert('db', '{"insert":"ignoreCommonSpec", "documents":[{"_id":5,"a":"id5"}], "writeConcern": {"w": 0}}'), current_setting('synchronous_commit');
+SHOW synchronous_commit;
+select documentdb_api.update('db', '{"update":"ignoreCommonSpec", "updates":[{"q":{"_id":5},"u":{"$set":{"b":1}}}], "writeConcern": {"w": "majority", "j": false}}'), current_setting('synchronous_commit');
+
+-- but not inside a multi-document transaction
+BEGIN;
+select documentdb_api.update('db', '{"update":"ignoreCommonSpec", "updates":[{"q":{"_id":5},"u":{"$set":{"b":2}}}], "writeConcern": {"w": "majority", "j": false}}');
+SHOW synchronous_commit;
+ROLLBACK;
+RESET documentdb.enableRelaxedDurabilityWriteConcern;
+
+-- unordered inserts only retry the failed sub-batch one document at a time
+SET documentdb.enableInsertSubBatchRetry TO on;
+SET documentdb.batchWriteSubTransactionCount TO 2;
+select documentdb_api.insert('db', '{"insert":"insertSubBatchRetry", "documents":[{"_id":1},{"_id":2},{"_id":1},{"_id":3},{"_id":4},{"_id":5},{"_id":4}], "ordered": false}');
+select document FROM documentdb_api.collection('db', 'insertSubBatchRetry') ORDER BY object_id;
+select documentdb_api.insert('db', '{"insert":"insertSubBatchRetry", "documents":[{"_id":6},{"_id":1},{"_id":7},{"_id":8}], "ordered": true}');
+select document FROM documentdb_api.collection('db', 'insertSubBatchRetry') ORDER BY object_id;
+RESET documentdb.batchWriteSubTransactionCount;
+RESET documentdb.enableInsertSubBatchRetry;
+
+-- sub-batches inserted into the local shard with a multi row heap insert
+SET documentdb.enableMultiRowHeapInsert TO on;
+SET documentdb.batchWriteSubTransactionCount TO 3;
+select documentdb_api.insert('db', '{"insert":"multiRowHeapInsert", "documents":[{"_id":1,"a":1},{"_id":2,"a":2},{"_id":3,"a":3},{"_id":4,"a":4},{"_id":5,"a":5}]}');
+
+-- a duplicate _id within a sub-batch
+select documentdb_api.insert('db', '{"insert":"multiRowHeapInsert", "documents":[{"_id":6},{"_id":7},{"_id":6},{"_id":8}], "ordered": false}');
+
+-- an error in the middle of a sub-batch stops ordered inserts at the failed document
+select documentdb_api.insert('db', '{"insert":"multiRowHeapInsert", "documents":[{"_id":9},{"_id":[10]},{"_id":11}], "ordered": true}');
+select document FROM documentdb_api.collection('db', 'multiRowHeapInsert') ORDER BY object_id;
+
+-- inside a transaction the inserted rows roll back with it
+BEGIN;
+select documentdb_api.insert('db', '{"insert":"multiRowHeapInsert", "documents":[{"_id":12},{"_id":13},{"_id":14},{"_id":1}], "ordered": false}');
+select count(*) FROM documentdb_api.collection('db', 'multiRowHeapInsert');
+ROLLBACK;
+select count(*) FROM documentdb_api.collection('db', 'multiRowHeapInsert');
+RESET documentdb.batchWriteSubTransactionCount;
+RESET documentdb.enableMultiRowHeapInsert;
@@ -334,3 +334,13 @@ SELECT documentdb_api.delete(
         "ordered": false
      }'
 );
+
+-- batches of _id deletes run as a single delete
+SET documentdb.enableBatchDeleteByObjectIds TO on;
+SELECT documentdb_api.insert('delete', '{"insert":"delete_by_ids", "documents":[{"_id":1,"a":1},{"_id":2,"a":2},{"_id":"three","a":3},{"_id":4,"a":4},{"_id":5,"a":5}]}');
+SELECT documentdb_api.delete('delete', '{"delete":"delete_by_ids", "deletes":[{"q":{"_id":1},"limit":1},{"q":{"_id":"three"},"limit":1},{"q":{"_id":1},"limit":1},{"q":{"_id":100},"limit":1}]}');
+SELECT document FROM documentdb_api.collection('delete', 'delete_by_ids') ORDER BY object_id;
+-- batches with other filters are deleted one at a time
+SELECT documentdb_api.delete('delete', '{"delete":"delete_by_ids", "deletes":[{"q":{"_id":2},"limit":1},{"q":{"_id":4,"a":5},"limit":1},{"q":{"_id":{"$gt":4}},"limit":0}]}');
+SELECT document FROM documentdb_api.collection('delete', 'delete_by_ids') ORDER BY object_id;
+RESET documentdb.enableBatchDeleteByObjectIds;
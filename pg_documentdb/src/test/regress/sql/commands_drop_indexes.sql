@@ -53,3 +53,25 @@ SELECT documentdb_api.drop_collection('db', 'drop_collection_test');
 
 SELECT COUNT(*)=0 FROM documentdb_api_catalog.collection_indexes
 WHERE collection_id = :db_drop_collection_test_id;
+
+-- with deferred drops, the metadata is removed right away and the relations by the background procedure
+SET documentdb.deferredDropMaxRelationsPerRun TO 10;
+SELECT documentdb_api_internal.create_indexes_non_concurrently('db', '{"createIndexes": "deferred_drop_test", "indexes": [{"key": {"a": 1}, "name": "deferred_idx_1"}, {"key": {"b": 1}, "name": "deferred_idx_2"}]}', true);
+SELECT index_id AS deferred_drop_index_id FROM documentdb_api_catalog.collection_indexes
+WHERE (index_spec).index_name = 'deferred_idx_1' \gset
+SELECT collection_id AS deferred_drop_collection_id FROM documentdb_api_catalog.collections
+WHERE collection_name = 'deferred_drop_test' AND database_name = 'db' \gset
+
+CALL documentdb_api.drop_indexes('db', '{"dropIndexes": "deferred_drop_test", "index": ["deferred_idx_1"]}');
+SELECT indisvalid FROM pg_index WHERE indexrelid = ('documentdb_data.documents_rum_index_' || :deferred_drop_index_id)::regclass;
+SELECT documentdb_api_catalog.bson_dollar_unwind(cursorpage, '$cursor.firstBatch') FROM documentdb_api.list_indexes_cursor_first_page('db', '{ "listIndexes": "deferred_drop_test" }') ORDER BY 1;
+
+SELECT documentdb_api.drop_collection('db', 'deferred_drop_test');
+SELECT COUNT(*) FROM documentdb_api_catalog.collections WHERE collection_id = :deferred_drop_collection_id;
+SELECT to_regclass('documentdb_data.documents_' || :deferred_drop_collection_id) IS NOT NULL;
+
+CALL documentdb_api_internal.drop_deferred_relations_background(100);
+SELECT to_regclass('documentdb_data.documents_' || :deferred_drop_collection_id) IS NULL;
+SELECT to_regclass('documentdb_data.retry_' || :deferred_drop_collection_id) IS NULL;
+SELECT to_regclass('documentdb_data.documents_rum_index_' || :deferred_drop_index_id) IS NULL;
+RESET documentdb.deferredDropMaxRelationsPerRun;
@@ -235,4 +235,14 @@ set documentdb.enableBypassDocumentValidation = on;
 select documentdb_api.find_and_modify('fam', '{"findAndModify": "collection", "query": {"_id": 3}, "update": {"$set": {"a": "zero"}}, "new": true, "upsert": true, "bypassDocumentValidation": true, "fields": {"foo": {"$pow": [1, 2]}}}');
 SELECT documentdb_api_catalog.bson_dollar_project(document,'{"_id":0,"a":1,"b":1}') FROM documentdb_api.collection('fam', 'collection') ORDER BY document;
 set documentdb.enableSchemaValidation = off;
-set documentdb.enableBypassDocumentValidation = off;
\ No newline at end of file
+set documentdb.enableBypassDocumentValidation = off;
+-- findAndModify with a sort reuses the cached plan for the sort directions
+set documentdb.enableSortedWritePlanCache = on;
+select documentdb_api.insert('fam', '{"insert":"job_queue", "documents":[{"_id":1,"state":"ready","priority":2},{"_id":2,"state":"ready","priority":1},{"_id":3,"state":"ready","priority":3},{"_id":4,"state":"ready","priority":1}]}');
+select documentdb_api.find_and_modify('fam', '{"findAndModify": "job_queue", "query": {"state": "ready"}, "sort": {"priority": 1, "_id": 1}, "update": {"$set": {"state": "claimed"}}, "new": true}');
+select documentdb_api.find_and_modify('fam', '{"findAndModify": "job_queue", "query": {"state": "ready"}, "sort": {"priority": 1, "_id": 1}, "update": {"$set": {"state": "claimed"}}}');
+select documentdb_api.find_and_modify('fam', '{"findAndModify": "job_queue", "query": {"state": "ready"}, "sort": {"priority": -1, "_id": 1}, "update": {"$set": {"state": "claimed"}}, "new": true}');
+select documentdb_api.find_and_modify('fam', '{"findAndModify": "job_queue", "query": {"state": "claimed"}, "sort": {"priority": -1}, "remove": true}');
+select documentdb_api.find_and_modify('fam', '{"findAndModify": "job_queue", "query": {"state": "claimed"}, "sort": {"priority": 1, "_id": 1}, "remove": true}');
+SELECT document FROM documentdb_api.collection('fam', 'job_queue') ORDER BY object_id;
+set documentdb.enableSortedWritePlanCache = off;
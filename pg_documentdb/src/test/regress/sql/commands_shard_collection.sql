@@ -244,3 +244,72 @@ SELECT documentdb_api.shard_collection('db', 'nonExistingCollection', '{ "a.b":
 SELECT documentdb_api.create_collection('db', 'nonShardedCollection');
 SELECT documentdb_api.shard_collection('db', 'nonShardedCollection', '{ "a.b": "hashed" }', true);
 
+
+-- batch inserts hash the shard key of the whole batch at once: the hashes must match the per document hash
+SELECT documentdb_api.shard_collection('db', 'batchShardKeyHash', '{ "a.b": "hashed", "c": "hashed" }');
+SELECT documentdb_api.insert('db', '{"insert":"batchShardKeyHash", "documents":[
+  { "_id": 1, "a": { "b": 1 }, "c": "x" },
+  { "_id": 2, "c": "x", "a": { "b": 1 } },
+  { "_id": 3, "a": { "d": 1 }, "c": 2 },
+  { "_id": 4, "a": 5 },
+  { "_id": 5, "c": { "d": 1 }, "a": { "b": { "e": 1 } }, "a": { "b": 2 } }
+]}');
+SELECT COUNT(*) FROM documentdb_api.collection('db', 'batchShardKeyHash') d
+  JOIN documentdb_api_catalog.collections c ON c.database_name = 'db' AND c.collection_name = 'batchShardKeyHash'
+  WHERE d.shard_key_value = documentdb_api_internal.get_shard_key_value(c.shard_key, c.collection_id, d.document);
+
+-- invalid shard key values in a batch still fail
+SELECT documentdb_api.insert('db', '{"insert":"batchShardKeyHash", "documents":[
+  { "_id": 6, "a": { "b": [ 1 ] }, "c": 1 },
+  { "_id": 7, "a": [ { "b": 1 } ], "c": 1 }
+]}');
+
+-- online reshard copies the documents in chunks and keeps the indexes
+SELECT documentdb_api.shard_collection('db', 'reshardOnline', '{ "a": "hashed" }');
+SELECT documentdb_api.insert('db', '{"insert":"reshardOnline", "documents":[
+  { "_id": 1, "a": 1, "b": 1 }, { "_id": 2, "a": 2, "b": 2 }, { "_id": 3, "a": 3, "b": 3 },
+  { "_id": 4, "a": 4, "b": 4 }, { "_id": 5, "a": 5, "b": 5 }
+]}');
+SELECT documentdb_api_internal.create_indexes_non_concurrently('db', '{ "createIndexes": "reshardOnline", "indexes": [ { "key": { "b": 1 }, "name": "b_1" } ] }', TRUE);
+
+-- not allowed in a transaction
+BEGIN;
+CALL documentdb_api.reshard_collection_online('{ "reshardCollection": "db.reshardOnline", "key": { "b": "hashed" } }');
+ROLLBACK;
+
+CALL documentdb_api.reshard_collection_online('{ "reshardCollection": "db.reshardOnline", "key": { "b": "hashed" } }', 2);
+
+SELECT shard_key FROM documentdb_api_catalog.collections WHERE database_name = 'db' AND collection_name = 'reshardOnline';
+SELECT document FROM documentdb_api.collection('db', 'reshardOnline') ORDER BY object_id;
+SELECT COUNT(*) FROM documentdb_api.collection('db', 'reshardOnline') d
+  JOIN documentdb_api_catalog.collections c ON c.database_name = 'db' AND c.collection_name = 'reshardOnline'
+  WHERE d.shard_key_value = documentdb_api_internal.get_shard_key_value(c.shard_key, c.collection_id, d.document);
+SELECT documentdb_api_catalog.bson_dollar_unwind(cursorpage, '$cursor.firstBatch') FROM documentdb_api.list_indexes_cursor_first_page('db', '{ "listIndexes": "reshardOnline" }') ORDER BY 1;
+SELECT COUNT(*) FROM pg_index i JOIN documentdb_api_catalog.collections c ON i.indrelid = ('documentdb_data.documents_' || c.collection_id)::regclass
+  WHERE c.database_name = 'db' AND c.collection_name = 'reshardOnline' AND i.indexrelid::regclass::text LIKE '%\_reshard';
+
+-- the same key is skipped
+CALL documentdb_api.reshard_collection_online('{ "reshardCollection": "db.reshardOnline", "key": { "b": "hashed" } }');
+
+-- time bucketed shard keys keep documents of the same bucket together
+SELECT documentdb_api.shard_collection('db', 'timeBucketed', '{ "ts": { "timeBucket": "month" } }');
+SELECT documentdb_api.shard_collection('db', 'timeBucketed', '{ "ts": { "timeBucket": "day" }, "a": "hashed" }');
+SELECT documentdb_api.shard_collection('db', 'timeBucketed', '{ "ts": { "timeBucket": "day" } }');
+SELECT documentdb_api.insert('db', '{"insert":"timeBucketed", "documents":[
+  { "_id": 1, "ts": { "$date": "2024-05-01T01:00:00Z" } },
+  { "_id": 2, "ts": { "$date": "2024-05-01T23:00:00Z" } },
+  { "_id": 3, "ts": { "$date": "2024-05-02T10:00:00Z" } },
+  { "_id": 4, "ts": { "$date": "1969-12-31T23:00:00Z" } },
+  { "_id": 5 }
+]}');
+SELECT documentdb_api.insert_one('db', 'timeBucketed', '{ "_id": 6, "ts": "2024-05-01" }');
+SELECT object_id, shard_key_value FROM documentdb_api.collection('db', 'timeBucketed') ORDER BY object_id;
+
+-- equality and date ranges on the shard key filter on the buckets
+BEGIN;
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_find('db', '{ "find": "timeBucketed", "filter": { "ts": { "$date": "2024-05-01T01:00:00Z" } } }');
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_find('db', '{ "find": "timeBucketed", "filter": { "ts": { "$gte": { "$date": "2024-05-01T00:00:00Z" }, "$lt": { "$date": "2024-05-03T00:00:00Z" } } } }');
+SELECT document FROM bson_aggregation_find('db', '{ "find": "timeBucketed", "filter": { "ts": { "$gte": { "$date": "2024-05-01T00:00:00Z" }, "$lt": { "$date": "2024-05-03T00:00:00Z" } } } }');
+set local documentdb.maxTimeBucketsInShardKeyFilter to 1;
+EXPLAIN (COSTS OFF) SELECT document FROM bson_aggregation_find('db', '{ "find": "timeBucketed", "filter": { "ts": { "$gte": { "$date": "2024-05-01T00:00:00Z" }, "$lt": { "$date": "2024-05-03T00:00:00Z" } } } }');
+ROLLBACK;
@@ -618,4 +618,25 @@ EXECUTE distinctQueryWithFilter('update', 'server1470_2', 'name', '{ "pic": {"$r
 select documentdb_api.update('update', '{"update":"server1470_noid", "updates":[{"q": {"name": "first", "pic": {"$ref": "foo" } }, "u":{"$set": {"refx": 1}}, "multi": true, "upsert": true} ] }');
 select documentdb_api.update('update', '{"update":"server1470_noref", "updates":[{"q": {"name": "first", "pic": {"$id": {"$oid": "4c48d04cd33a5a92628c9af6"} } }, "u":{"$set": {"refx": 1}}, "multi": true, "upsert": true} ] }');
 select documentdb_api.update('update', '{"update":"server1470_extraf_1", "updates":[{"q": {"name": "first", "pic": {"$ref": "foo", "extraField": "extraField", "$id": {"$oid": "4c48d04cd33a5a92628c9af6"} } }, "u":{"$set": {"refx": 1}}, "multi": true, "upsert": true} ] }');
-select documentdb_api.update('update', '{"update":"server1470_extraf_2", "updates":[{"q": {"name": "first", "pic": {"$id": {"$oid": "4c48d04cd33a5a92628c9af6"}, "extraField": "extraFiele", "$ref": "foo" } }, "u":{"$set": {"refx": 1}}, "multi": true, "upsert": true} ] }');
\ No newline at end of file
+select documentdb_api.update('update', '{"update":"server1470_extraf_2", "updates":[{"q": {"name": "first", "pic": {"$id": {"$oid": "4c48d04cd33a5a92628c9af6"}, "extraField": "extraFiele", "$ref": "foo" } }, "u":{"$set": {"refx": 1}}, "multi": true, "upsert": true} ] }');
+-- batches that repeat the same update spec reuse the parsed update
+SET documentdb.enableUpdateSpecCache TO on;
+select documentdb_api.insert('update', '{"insert":"update_spec_cache", "documents":[{"_id":1,"a":1,"arr":[1,2]},{"_id":2,"a":2,"arr":[1,2]},{"_id":3,"a":3,"arr":[1,2]}]}');
+select documentdb_api.update('update', '{"update":"update_spec_cache", "updates":[{"q":{"_id":1},"u":{"$inc":{"a":10}}},{"q":{"_id":2},"u":{"$inc":{"a":10}}},{"q":{"_id":3},"u":{"$inc":{"a":10}}}]}');
+select documentdb_api.update('update', '{"update":"update_spec_cache", "updates":[{"q":{"_id":4},"u":{"$inc":{"a":10}},"upsert":true},{"q":{"_id":1},"u":{"$inc":{"a":10}}}]}');
+-- positional updates and arrayFilters depend on the query and are not reused
+select documentdb_api.update('update', '{"update":"update_spec_cache", "updates":[{"q":{"_id":1,"arr":1},"u":{"$set":{"arr.$":10}}},{"q":{"_id":2,"arr":2},"u":{"$set":{"arr.$":10}}}]}');
+select documentdb_api.update('update', '{"update":"update_spec_cache", "updates":[{"q":{"_id":3},"u":{"$set":{"arr.$[x]":20}},"arrayFilters":[{"x":1}]},{"q":{"_id":3},"u":{"$set":{"arr.$[x]":20}},"arrayFilters":[{"x":2}]}]}');
+-- a cached spec that fails to apply reports the error for its entry
+select documentdb_api.update('update', '{"update":"update_spec_cache", "updates":[{"q":{"_id":1},"u":{"$inc":{"a":"b"}}},{"q":{"_id":1},"u":{"$inc":{"a":"b"}}}]}');
+SELECT document FROM documentdb_api.collection('update', 'update_spec_cache') ORDER BY object_id;
+RESET documentdb.enableUpdateSpecCache;
+
+-- upserts on _id insert first and fall back to the update when the document exists
+SET documentdb.enableUpsertInsertFirst TO on;
+select documentdb_api.update('update', '{"update":"upsert_insert_first", "updates":[{"q":{"_id":1},"u":{"$inc":{"a":1}},"upsert":true},{"q":{"_id":1},"u":{"$inc":{"a":1}},"upsert":true},{"q":{"_id":2},"u":{"b":2},"upsert":true},{"q":{"_id":2},"u":{"b":3},"upsert":true}]}');
+select documentdb_api.update('update', '{"update":"upsert_insert_first", "updates":[{"q":{"_id":{"$in":[1,3]}},"u":{"$inc":{"a":1}},"upsert":true},{"q":{"_id":"str","c":1},"u":{"$set":{"d":1}},"upsert":true}]}');
+SELECT document FROM documentdb_api.collection('update', 'upsert_insert_first') ORDER BY object_id;
+SELECT documentdb_api.find_and_modify('update', '{"findAndModify":"upsert_insert_first", "query":{"_id":5}, "update":{"$set":{"e":1}}, "upsert":true, "new":true}');
+SELECT documentdb_api.find_and_modify('update', '{"findAndModify":"upsert_insert_first", "query":{"_id":5}, "update":{"$set":{"e":2}}, "upsert":true, "new":true}');
+RESET documentdb.enableUpsertInsertFirst;
@@ -106,4 +106,21 @@ CALL documentdb_api_internal.delete_expired_rows();
 
 SELECT document FROM documentdb_api.collection('ttl_tests', 'coll1');
 
-SELECT drop_collection('ttl_tests', 'coll1');
\ No newline at end of file
+SELECT drop_collection('ttl_tests', 'coll1');
+
+-- a single task invocation keeps deleting full batches from the same shard up to maxTTLBatchesPerShard
+SELECT documentdb_api.insert_one('ttl_tests','coll1', FORMAT('{ "_id" : %s, "ttl" : { "$date": { "$numberLong": "-1000" } } }', i)::bson) FROM generate_series(1, 10) i;
+SELECT documentdb_api_internal.create_indexes_non_concurrently('ttl_tests', '{"createIndexes": "coll1", "indexes": [{"key": {"ttl": 1}, "name": "ttl_index", "expireAfterSeconds": 5}]}', true);
+
+SET documentdb.maxTTLBatchesPerShard TO 3;
+CALL documentdb_api_internal.delete_expired_rows(2);
+SELECT COUNT(*) FROM documentdb_api.collection('ttl_tests', 'coll1');
+
+-- the deletion rate limit slows the task down but still deletes the expired rows
+SET documentdb.TTLPurgerMaxDeletesPerSecond TO 1000;
+CALL documentdb_api_internal.delete_expired_rows(2);
+SELECT COUNT(*) FROM documentdb_api.collection('ttl_tests', 'coll1');
+
+RESET documentdb.TTLPurgerMaxDeletesPerSecond;
+RESET documentdb.maxTTLBatchesPerShard;
+SELECT drop_collection('ttl_tests', 'coll1');
@@ -14,6 +14,9 @@
 #include <commands/sequence.h>
 #include <executor/spi.h>
 #include <portability/instr_time.h>
+#include <miscadmin.h>
+#include <storage/latch.h>
+#include <utils/wait_event.h>
 
 #include "io/bson_core.h"
 #include "metadata/collection.h"
@@ -40,6 +43,8 @@ extern bool EnableTtlJobsOnReadOnly;
 extern bool ForceIndexScanForTTLTask;
 extern bool UseIndexHintsForTTLTask;
 extern bool EnableTTLDescSort;
+extern int MaxTTLBatchesPerShard;
+extern int TTLPurgerMaxDeletesPerSecond;
 
 bool UseV2TTLIndexPurger = true;
 
@@ -86,6 +91,7 @@ static uint64 DeleteExpiredRowsForIndexCore(char *tableName, TtlIndexEntry *inde
 											int64 currentTime, int32 batchSize);
 static bool IsTaskTimeBudgetExceeded(instr_time startTime, double *elapsedTime, int
 									 budget);
+static void ThrottleTTLDeletes(instr_time startTime, uint64 rowsDeleted);
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -359,6 +365,8 @@ delete_expired_rows(PG_FUNCTION_ARGS)
 	ListCell *ttlEntryCell = NULL;
 	bool shouldCleanupCollection = false;
 	uint64 rowsDeletedInCurrentLoop = 0;
+	volatile uint64 rowsDeletedInTask = 0;
+	int32 fullBatchSize = (batchSize != -1) ? batchSize : MaxTTLDeleteBatchSize;
 
 	while (!IsTaskTimeBudgetExceeded(startTime, NULL, TTLTaskMaxRunTimeInMS))
 	{
@@ -471,65 +479,82 @@ delete_expired_rows(PG_FUNCTION_ARGS)
 			{
 				char *tableName = text_to_cstring(DatumGetTextP(itemDatums[i]));
 
-				clock_gettime(CLOCK_REALTIME, &timeSpec);
+				/*
+				 * Keep deleting from the same shard while the batches come back full,
+				 * so a shard with a large backlog of expired rows walks its TTL index
+				 * range in consecutive batches rather than one batch per task loop.
+				 */
+				volatile int batchesForShard = 0;
+				volatile bool shardHasMoreRows = true;
+				while (shardHasMoreRows)
+				{
+					clock_gettime(CLOCK_REALTIME, &timeSpec);
 
-				time_t epochSeconds = timeSpec.tv_sec;
-				uint32_t millisecondsInSecond = timeSpec.tv_nsec / 1000000;
-				uint64_t epochMilliseconds = (epochSeconds * 1000UL) +
-											 millisecondsInSecond;
+					time_t epochSeconds = timeSpec.tv_sec;
+					uint32_t millisecondsInSecond = timeSpec.tv_nsec / 1000000;
+					uint64_t epochMilliseconds = (epochSeconds * 1000UL) +
+												 millisecondsInSecond;
 
-				PG_TRY();
-				{
-					uint64 deletedRows = DeleteExpiredRowsForIndexCore(tableName,
-																	   ttlIndexEntry,
-																	   epochMilliseconds,
-																	   batchSize);
-					double elapsedTime = 0.0;
-					if (IsTaskTimeBudgetExceeded(startTime, &elapsedTime,
-												 SingleTTLTaskTimeBudget))
+					PG_TRY();
 					{
-						/* If exceeded time, mark as should stop but still commit this deletion. */
-						shouldStop = true;
+						uint64 deletedRows = DeleteExpiredRowsForIndexCore(tableName,
+																		   ttlIndexEntry,
+																		   epochMilliseconds,
+																		   batchSize);
+						double elapsedTime = 0.0;
+						if (IsTaskTimeBudgetExceeded(startTime, &elapsedTime,
+													 SingleTTLTaskTimeBudget))
+						{
+							/* If exceeded time, mark as should stop but still commit this deletion. */
+							shouldStop = true;
+						}
+
+						if (LogTTLProgressActivity)
+						{
+							ereport(LOG, errmsg("TTL job elapsed time: %fms, limit: %dms",
+												elapsedTime, SingleTTLTaskTimeBudget));
+						}
+
+						/* Commit the deletion. */
+						PopAllActiveSnapshots();
+						CommitTransactionCommand();
+						StartTransactionCommand();
+
+						rowsDeletedInCurrentLoop += deletedRows;
+						rowsDeletedInTask += deletedRows;
+						batchesForShard++;
+						shardHasMoreRows = fullBatchSize > 0 &&
+										   deletedRows >= (uint64) fullBatchSize &&
+										   batchesForShard < MaxTTLBatchesPerShard;
 					}
-
-					if (LogTTLProgressActivity)
+					PG_CATCH();
 					{
-						ereport(LOG, errmsg("TTL job elapsed time: %fms, limit: %dms",
-											elapsedTime, SingleTTLTaskTimeBudget));
-					}
-
-					/* Commit the deletion. */
-					PopAllActiveSnapshots();
-					CommitTransactionCommand();
-					StartTransactionCommand();
+						ErrorData *edata = CopyErrorDataAndFlush();
+						ereport(WARNING, errmsg(
+									"TTL job failed when processing collection_id=%lu and index_id=%lu with error: %s",
+									collectionId, ttlIndexEntry->indexId, edata->message));
 
-					rowsDeletedInCurrentLoop += deletedRows;
-				}
-				PG_CATCH();
-				{
-					ErrorData *edata = CopyErrorDataAndFlush();
-					ereport(WARNING, errmsg(
-								"TTL job failed when processing collection_id=%lu and index_id=%lu with error: %s",
-								collectionId, ttlIndexEntry->indexId, edata->message));
+						shouldStop = true;
 
-					shouldStop = true;
+						/* Abort the transaction and continue with the next TTL indexes */
+						PopAllActiveSnapshots();
+						AbortCurrentTransaction();
+						StartTransactionCommand();
+					}
+					PG_END_TRY();
 
-					/* Abort the transaction and continue with the next TTL indexes */
-					PopAllActiveSnapshots();
-					AbortCurrentTransaction();
-					StartTransactionCommand();
-				}
-				PG_END_TRY();
+					if (shouldStop)
+					{
+						goto end;
+					}
 
-				if (shouldStop)
-				{
-					goto end;
-				}
+					ThrottleTTLDeletes(startTime, rowsDeletedInTask);
 
-				/* Before starting the next loop, set the transaction characteristics */
-				if (XactReadOnly && EnableTtlJobsOnReadOnly)
-				{
-					SetGUCLocally("transaction_read_only", "false");
+					/* Before starting the next batch, set the transaction characteristics */
+					if (XactReadOnly && EnableTtlJobsOnReadOnly)
+					{
+						SetGUCLocally("transaction_read_only", "false");
+					}
 				}
 			}
 
@@ -607,6 +632,44 @@ IsTaskTimeBudgetExceeded(instr_time startTime, double *elapsedTime, int budget)
 }
 
 
+/*
+ * Waits until the rows deleted since the start of the task are within the rate set by
+ * TTLPurgerMaxDeletesPerSecond, so that a large backlog of expired rows does not
+ * saturate the I/O of the node. The wait never goes past the single task time budget.
+ */
+static void
+ThrottleTTLDeletes(instr_time startTime, uint64 rowsDeleted)
+{
+	if (TTLPurgerMaxDeletesPerSecond <= 0 || rowsDeleted == 0)
+	{
+		return;
+	}
+
+	instr_time current;
+	INSTR_TIME_SET_CURRENT(current);
+	INSTR_TIME_SUBTRACT(current, startTime);
+	double elapsed = INSTR_TIME_GET_MILLISEC(current);
+
+	double targetElapsed = (double) rowsDeleted * 1000.0 / TTLPurgerMaxDeletesPerSecond;
+	double waitTime = Min(targetElapsed, (double) SingleTTLTaskTimeBudget) - elapsed;
+	if (waitTime < 1)
+	{
+		return;
+	}
+
+	if (LogTTLProgressActivity)
+	{
+		ereport(LOG, errmsg("TTL job throttling for %fms after deleting " UINT64_FORMAT
+							" rows", waitTime, rowsDeleted));
+	}
+
+	(void) WaitLatch(MyLatch, WL_LATCH_SET | WL_TIMEOUT | WL_EXIT_ON_PM_DEATH,
+					 (long) waitTime, WAIT_EVENT_PG_SLEEP);
+	ResetLatch(MyLatch);
+	CHECK_FOR_INTERRUPTS();
+}
+
+
 /* Deletes the rows that have expired for the given table name and ttl entry information.
  * It deletes the number of items specified on the batchSize that have expired based on the index entry expiry value. */
 static uint64
@@ -37,6 +37,9 @@ BuildUpdateDescription_HookType build_update_description_hook = NULL;
 /* TODO: This is a hack - in reality we should remove updateDesc and rewrite the query to be better */
 int NumBsonDocumentsUpdated = 0;
 
+/* Slack reserved over the replacement document size for the _id written from the source */
+#define REPLACE_DOCUMENT_ID_SIZE_HINT 32
+
 /*
  * Metadata pertaining to update processing
  * that can be cached and reused across executions
@@ -86,7 +89,8 @@ static void BuildBsonUpdateMetadata(BsonUpdateMetadata *metadata,
 									const bson_value_t *querySpec, const
 									bson_value_t *arrayFilters,
 									const bson_value_t *variableSpec,
-									bool buildSourceDocOnUpsert);
+									bool buildSourceDocOnUpsert,
+									bool useSessionCache);
 
 static pgbson * BsonUpdateDocumentCore(pgbson *sourceDocument, const
 									   bson_value_t *updateSpec,
@@ -215,7 +219,7 @@ bson_update_document(PG_FUNCTION_ARGS)
 		3,
 		BuildBsonUpdateMetadata,
 		&updateSpecElement.bsonValue, &querySpec, arrayFilters,
-		&variableSpec, buildSourceDocOnUpsert);
+		&variableSpec, buildSourceDocOnUpsert, false);
 
 	/* Returns (newDocument bson, updateDesc bson) */
 	Datum values[2];
@@ -239,7 +243,8 @@ bson_update_document(PG_FUNCTION_ARGS)
 	{
 		BsonUpdateMetadata localMetadata = { 0 };
 		BuildBsonUpdateMetadata(&localMetadata, &updateSpecElement.bsonValue, &querySpec,
-								arrayFilters, &variableSpec, buildSourceDocOnUpsert);
+								arrayFilters, &variableSpec, buildSourceDocOnUpsert,
+								false);
 		document = BsonUpdateDocumentCore(sourceDocument, &updateSpecElement.bsonValue,
 										  &localMetadata);
 	}
@@ -292,8 +297,9 @@ ValidateUpdateDocument(const bson_value_t *updateSpec, const bson_value_t *query
 {
 	BsonUpdateMetadata metadata = { 0 };
 	bool buildSourceDocOnUpsert = false;
+	bool useSessionCache = true;
 	BuildBsonUpdateMetadata(&metadata, updateSpec, querySpec, arrayFilters,
-							variableSpec, buildSourceDocOnUpsert);
+							variableSpec, buildSourceDocOnUpsert, useSessionCache);
 }
 
 
@@ -311,8 +317,9 @@ BsonUpdateDocument(pgbson *sourceDocument, const bson_value_t *updateSpec,
 	/* An empty document will be processed as an upsert operation. */
 	bool buildSourceDocOnUpsert = IsPgbsonEmptyDocument(sourceDocument);
 
+	bool useSessionCache = true;
 	BuildBsonUpdateMetadata(&metadata, updateSpec, querySpec, arrayFilters,
-							variableSpec, buildSourceDocOnUpsert);
+							variableSpec, buildSourceDocOnUpsert, useSessionCache);
 	return BsonUpdateDocumentCore(sourceDocument, updateSpec, &metadata);
 }
 
@@ -432,7 +439,8 @@ BsonUpdateDocumentCore(pgbson *sourceDocument, const bson_value_t *updateSpec,
 static void
 BuildBsonUpdateMetadata(BsonUpdateMetadata *metadata, const bson_value_t *updateSpec,
 						const bson_value_t *querySpec, const bson_value_t *arrayFilters,
-						const bson_value_t *variableSpec, bool buildSourceDocOnUpsert)
+						const bson_value_t *variableSpec, bool buildSourceDocOnUpsert,
+						bool useSessionCache)
 {
 	metadata->updateType = DetermineUpdateType(updateSpec);
 
@@ -466,7 +474,17 @@ BuildBsonUpdateMetadata(BsonUpdateMetadata *metadata, const bson_value_t *update
 
 		case UpdateType_Operator:
 		{
-			metadata->operatorState = GetOperatorUpdateState(updateSpec, querySpec,
+			/*
+			 * Trees from the session cache only live until the next cached build,
+			 * so they are not handed to state cached across function calls.
+			 */
+			metadata->operatorState = useSessionCache ?
+									  GetCachedOperatorUpdateState(updateSpec,
+																   querySpec,
+																   arrayFilters,
+																   buildSourceDocOnUpsert)
+									  :
+									  GetOperatorUpdateState(updateSpec, querySpec,
 															 arrayFilters,
 															 buildSourceDocOnUpsert);
 			break;
@@ -577,7 +595,8 @@ ProcessReplaceDocument(pgbson *sourceDoc, const bson_value_t *updateSpec,
 						   documentLength,
 						   BSON_VALIDATE_NONE);
 
-	PgbsonWriterInit(&writer);
+	/* The result is the replacement document, plus possibly the _id from the source. */
+	PgbsonWriterInitWithSizeHint(&writer, documentLength + REPLACE_DOCUMENT_ID_SIZE_HINT);
 
 	/* write the object_id of the document. */
 	const bson_value_t *sourceIdValue = NULL;
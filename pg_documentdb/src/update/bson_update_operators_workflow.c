@@ -17,6 +17,8 @@
 #include <utils/builtins.h>
 #include <common/hashfn.h>
 #include <nodes/bitmapset.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
 
 #include "update/bson_update_common.h"
 #include "query/bson_compare.h"
@@ -34,6 +36,32 @@
 /* Data types */
 /* --------------------------------------------------------- */
 
+/* The number of parsed update specs cached before the cache is dropped */
+#define UPDATE_SPEC_CACHE_MAX_ENTRIES 64
+
+/*
+ * An update tree cached for an update spec. Only trees that do not depend
+ * on the query or on arrayFilters are cached, so the spec and whether it is
+ * an upsert are all that is needed to reuse them.
+ */
+typedef struct UpdateSpecCacheEntry
+{
+	/* The hash of the spec: key of the entry in the hash */
+	uint64 hash;
+
+	/* Whether the tree was built for an upsert */
+	bool isUpsert;
+
+	/* A copy of the spec the tree was built from (and points into) */
+	bson_value_t updateSpec;
+
+	/* The update tree */
+	const BsonIntermediatePathNode *updateState;
+
+	/* memory context that holds the spec and the tree */
+	MemoryContext entryContext;
+} UpdateSpecCacheEntry;
+
 static const StringView PositionalType_AllString = { .string = "$[]", .length = 3 };
 static const StringView PositionalFilterString = { .string = "$", .length = 1 };
 
@@ -305,6 +333,20 @@ static void HandleSetOnInsertUpdateTree(BsonIntermediatePathNode *tree,
 static uint32_t ArrayFiltersKeyHash(const void *key, Size keysize);
 static int ArrayFiltersKeyCompare(const void *obj1, const void *obj2, Size objsize);
 static void WriteCurrentArrayFilterValue(pgbson_writer *writer, bson_value_t *entryValue);
+static const BsonIntermediatePathNode * GetOperatorUpdateStateCore(const
+																   bson_value_t *
+																   updateSpec,
+																   const
+																   bson_value_t *
+																   querySpec,
+																   const
+																   bson_value_t *
+																   arrayFilters,
+																   bool isUpsert,
+																   bool *
+																   usesQuerySpec);
+static void InitializeUpdateSpecCache(void);
+static uint64 HashUpdateSpec(const bson_value_t *updateSpec, bool isUpsert);
 static HTAB * BuildExpressionForArrayFilters(const bson_value_t *arrayFilters);
 static void PostValidateArrayFilters(HTAB *arrayFiltersHash, const
 									 bson_value_t *updateSpec);
@@ -567,6 +609,14 @@ IsAnErrorForIntermediateNodeOfDollarRenameOp(const BsonPathNode *
 }
 
 
+/* Feature flag for caching parsed update specs */
+extern bool EnableUpdateSpecCache;
+
+/* The session-level cache of update trees by spec */
+static HTAB *UpdateSpecCacheHash = NULL;
+static MemoryContext UpdateSpecCacheContext = NULL;
+static int CachedUpdateSpecsCount = 0;
+
 /* --------------------------------------------------------- */
 /* Top level exports */
 /* --------------------------------------------------------- */
@@ -618,6 +668,123 @@ RegisterUpdateOperatorExtension(const MongoUpdateOperatorSpec *extensibleDefinit
 const BsonIntermediatePathNode *
 GetOperatorUpdateState(const bson_value_t *updateSpec, const bson_value_t *querySpec,
 					   const bson_value_t *arrayFilters, bool isUpsert)
+{
+	bool usesQuerySpec = false;
+	return GetOperatorUpdateStateCore(updateSpec, querySpec, arrayFilters, isUpsert,
+									  &usesQuerySpec);
+}
+
+
+/*
+ * Same as GetOperatorUpdateState but reuses the tree built for an identical
+ * spec earlier in the session: Batches tend to apply the same update to
+ * many documents and only differ in the query. Specs with arrayFilters, and
+ * specs that use the positional $ (which binds the query into the tree), are
+ * built every time.
+ *
+ * The tree returned may be freed by the next call, so callers must be done
+ * with it before building another update.
+ */
+const BsonIntermediatePathNode *
+GetCachedOperatorUpdateState(const bson_value_t *updateSpec,
+							 const bson_value_t *querySpec,
+							 const bson_value_t *arrayFilters, bool isUpsert)
+{
+	if (!EnableUpdateSpecCache || updateSpec->value_type != BSON_TYPE_DOCUMENT ||
+		(arrayFilters != NULL && !IsBsonValueEmptyArray(arrayFilters)))
+	{
+		return GetOperatorUpdateState(updateSpec, querySpec, arrayFilters, isUpsert);
+	}
+
+	InitializeUpdateSpecCache();
+
+	uint64 hash = HashUpdateSpec(updateSpec, isUpsert);
+	bool found = false;
+	UpdateSpecCacheEntry *entry = hash_search(UpdateSpecCacheHash, &hash, HASH_FIND,
+											  &found);
+	if (found && entry->isUpsert == isUpsert &&
+		entry->updateSpec.value.v_doc.data_len == updateSpec->value.v_doc.data_len &&
+		memcmp(entry->updateSpec.value.v_doc.data, updateSpec->value.v_doc.data,
+			   updateSpec->value.v_doc.data_len) == 0)
+	{
+		return entry->updateState;
+	}
+
+	/*
+	 * Build the tree from a copy of the spec in its own context since the
+	 * tree points into the spec. If the build fails, nothing is cached.
+	 */
+	MemoryContext entryContext = AllocSetContextCreate(UpdateSpecCacheContext,
+													   "DocumentDB update spec cache entry",
+													   ALLOCSET_SMALL_SIZES);
+	MemoryContext oldContext = MemoryContextSwitchTo(entryContext);
+
+	bson_value_t specCopy = *updateSpec;
+	specCopy.value.v_doc.data = palloc(updateSpec->value.v_doc.data_len);
+	memcpy(specCopy.value.v_doc.data, updateSpec->value.v_doc.data,
+		   updateSpec->value.v_doc.data_len);
+
+	const BsonIntermediatePathNode *updateState = NULL;
+	bool usesQuerySpec = false;
+	PG_TRY();
+	{
+		updateState = GetOperatorUpdateStateCore(&specCopy, querySpec, arrayFilters,
+												 isUpsert, &usesQuerySpec);
+	}
+	PG_CATCH();
+	{
+		MemoryContextSwitchTo(oldContext);
+		MemoryContextDelete(entryContext);
+		PG_RE_THROW();
+	}
+	PG_END_TRY();
+
+	MemoryContextSwitchTo(oldContext);
+
+	if (usesQuerySpec)
+	{
+		/* The tree is only good for this query: Build it again in the caller's context */
+		MemoryContextDelete(entryContext);
+		return GetOperatorUpdateState(updateSpec, querySpec, arrayFilters, isUpsert);
+	}
+
+	if (found)
+	{
+		/* Collision on the hash: Replace the entry */
+		MemoryContextDelete(entry->entryContext);
+	}
+	else
+	{
+		if (CachedUpdateSpecsCount >= UPDATE_SPEC_CACHE_MAX_ENTRIES)
+		{
+			/* Drop all the cached specs: This also deletes entryContext, so start over */
+			MemoryContextDelete(entryContext);
+			MemoryContextReset(UpdateSpecCacheContext);
+			UpdateSpecCacheHash = NULL;
+			return GetCachedOperatorUpdateState(updateSpec, querySpec, arrayFilters,
+												isUpsert);
+		}
+
+		entry = hash_search(UpdateSpecCacheHash, &hash, HASH_ENTER, &found);
+		CachedUpdateSpecsCount++;
+	}
+
+	entry->isUpsert = isUpsert;
+	entry->updateSpec = specCopy;
+	entry->updateState = updateState;
+	entry->entryContext = entryContext;
+	return updateState;
+}
+
+
+/*
+ * Builds the update tree for GetOperatorUpdateState and reports whether the tree
+ * depends on the query spec (i.e. the spec uses the positional $ operator).
+ */
+static const BsonIntermediatePathNode *
+GetOperatorUpdateStateCore(const bson_value_t *updateSpec, const bson_value_t *querySpec,
+						   const bson_value_t *arrayFilters, bool isUpsert,
+						   bool *usesQuerySpec)
 {
 	if (updateSpec->value_type != BSON_TYPE_DOCUMENT)
 	{
@@ -643,10 +810,54 @@ GetOperatorUpdateState(const bson_value_t *updateSpec, const bson_value_t *query
 	PostValidateArrayFilters(arrayFilterHash, updateSpec);
 	hash_destroy(arrayFilterHash);
 
+	*usesQuerySpec = positionalSpec.processedQuerySpec != NULL;
 	return &root->base;
 }
 
 
+/*
+ * InitializeUpdateSpecCache initializes the session-level update spec cache.
+ */
+static void
+InitializeUpdateSpecCache(void)
+{
+	if (UpdateSpecCacheHash != NULL)
+	{
+		return;
+	}
+
+	if (UpdateSpecCacheContext == NULL)
+	{
+		UpdateSpecCacheContext = AllocSetContextCreate(CacheMemoryContext,
+													   "DocumentDB update spec cache context",
+													   ALLOCSET_DEFAULT_SIZES);
+	}
+
+	HASHCTL info;
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(uint64);
+	info.entrysize = sizeof(UpdateSpecCacheEntry);
+	info.hcxt = UpdateSpecCacheContext;
+	int hashFlags = HASH_ELEM | HASH_BLOBS | HASH_CONTEXT;
+
+	UpdateSpecCacheHash = hash_create("DocumentDB update spec cache hash", 32, &info,
+									  hashFlags);
+	CachedUpdateSpecsCount = 0;
+}
+
+
+/*
+ * Hashes the bytes of the update spec along with whether it is an upsert.
+ */
+static uint64
+HashUpdateSpec(const bson_value_t *updateSpec, bool isUpsert)
+{
+	return hash_bytes_extended(updateSpec->value.v_doc.data,
+							   updateSpec->value.v_doc.data_len,
+							   isUpsert ? 1 : 0);
+}
+
+
 /*
  * Given a previously built immutable update tree, and a source document,
  * applies the mutations in the update state and produces a new document.
@@ -679,9 +890,9 @@ ProcessUpdateOperatorWithState(pgbson *sourceDoc,
 
 	PgbsonInitIterator(sourceDoc, &docIterator);
 
-	/* Update */
+	/* Update: the updated document is usually about the size of the source document */
 	pgbson_writer writer;
-	PgbsonWriterInit(&writer);
+	PgbsonWriterInitWithSizeHint(&writer, PgbsonGetBsonSize(sourceDoc));
 
 	const BsonUpdateIntermediatePathNode *updateRoot =
 		(const BsonUpdateIntermediatePathNode *) updateState;
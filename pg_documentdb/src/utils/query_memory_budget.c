@@ -0,0 +1,246 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/utils/query_memory_budget.c
+ *
+ * A memory budget shared by all the stages and accumulators of a query that
+ * hold BSON state in memory ($group accumulators, $densify, ...), so that the
+ * memory of a query is bounded as a whole rather than by each stage on its own.
+ *
+ * Consumers reserve what they allocate against the memory context holding it,
+ * and the reservation is given back when that context is reset or deleted,
+ * e.g. when a sorted $group moves to the next group. The budget and its peak
+ * are tracked per statement of the backend.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <access/xact.h>
+#include <utils/memutils.h>
+#include <utils/timestamp.h>
+
+#include "utils/documentdb_errors.h"
+#include "utils/query_memory_budget.h"
+
+#define BYTES_IN_MB (1024 * 1024L)
+
+/*
+ * The memory reserved by the consumers allocating in one memory context.
+ * It lives in that context and unlinks itself when the context goes away.
+ */
+typedef struct QueryMemoryReservation
+{
+	MemoryContextCallback resetCallback;
+
+	MemoryContext context;
+
+	int64 reservedBytes;
+
+	struct QueryMemoryReservation *next;
+} QueryMemoryReservation;
+
+extern int MaxQueryMemoryMB;
+
+/* The statement the budget below is tracked for */
+static TimestampTz BudgetStatementStartTime = 0;
+
+static int64 QueryMemoryUsedBytes = 0;
+static int64 QueryMemoryPeakBytes = 0;
+
+/* Whether consumers that can spill may do so once the budget is used up */
+static bool QueryMemoryAllowDiskUse = true;
+
+static QueryMemoryReservation *Reservations = NULL;
+static QueryMemoryReservation *LastReservation = NULL;
+
+static void EnsureBudgetForCurrentStatement(void);
+static bool ReserveQueryMemoryCore(MemoryContext context, int64 bytes,
+								   const char *consumerName, bool canSpill);
+static QueryMemoryReservation * GetReservation(MemoryContext context);
+static void ReleaseReservation(void *arg);
+
+
+/*
+ * Reserves memory allocated in the context for a consumer that can't spill to
+ * disk: Fails the query if it goes over the budget.
+ */
+void
+ReserveQueryMemory(MemoryContext context, int64 bytes, const char *consumerName)
+{
+	bool canSpill = false;
+	ReserveQueryMemoryCore(context, bytes, consumerName, canSpill);
+}
+
+
+/*
+ * Reserves memory allocated in the context for a consumer that can spill its
+ * state to disk. Returns false without reserving if the budget is used up and
+ * the query allows disk use, in which case the consumer should spill. Fails the
+ * query if it doesn't allow disk use.
+ */
+bool
+TryReserveQueryMemory(MemoryContext context, int64 bytes, const char *consumerName)
+{
+	bool canSpill = true;
+	return ReserveQueryMemoryCore(context, bytes, consumerName, canSpill);
+}
+
+
+/*
+ * Sets the allowDiskUse of the query run by the current statement.
+ */
+void
+SetQueryMemoryAllowDiskUse(bool allowDiskUse)
+{
+	EnsureBudgetForCurrentStatement();
+	QueryMemoryAllowDiskUse = allowDiskUse;
+}
+
+
+/*
+ * Returns the most memory reserved at once by the query of the current statement.
+ */
+int64
+GetQueryMemoryPeakBytes(void)
+{
+	EnsureBudgetForCurrentStatement();
+	return QueryMemoryPeakBytes;
+}
+
+
+/*
+ * Starts a new budget when the backend moved on to another statement. The memory
+ * still reserved by the previous one (e.g. by a cursor that's kept open) is no
+ * longer counted.
+ */
+static void
+EnsureBudgetForCurrentStatement(void)
+{
+	TimestampTz statementStartTime = GetCurrentStatementStartTimestamp();
+	if (statementStartTime == BudgetStatementStartTime)
+	{
+		return;
+	}
+
+	BudgetStatementStartTime = statementStartTime;
+	QueryMemoryUsedBytes = 0;
+	QueryMemoryPeakBytes = 0;
+	QueryMemoryAllowDiskUse = true;
+
+	for (QueryMemoryReservation *reservation = Reservations; reservation != NULL;
+		 reservation = reservation->next)
+	{
+		reservation->reservedBytes = 0;
+	}
+}
+
+
+static bool
+ReserveQueryMemoryCore(MemoryContext context, int64 bytes, const char *consumerName,
+					   bool canSpill)
+{
+	if (bytes <= 0)
+	{
+		return true;
+	}
+
+	EnsureBudgetForCurrentStatement();
+
+	int64 maxBytes = (int64) MaxQueryMemoryMB * BYTES_IN_MB;
+	if (maxBytes > 0 && QueryMemoryUsedBytes + bytes > maxBytes)
+	{
+		if (canSpill && QueryMemoryAllowDiskUse)
+		{
+			return false;
+		}
+
+		if (canSpill)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT),
+							errmsg(
+								"Exceeded memory limit for %s, but didn't allow external spilling;"
+								" pass allowDiskUse:true to opt in", consumerName),
+							errdetail_log(
+								"%s exceeded the query memory limit of %d MB",
+								consumerName, MaxQueryMemoryMB)));
+		}
+
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT),
+						errmsg(
+							"PlanExecutor error during aggregation :: caused by :: "
+							"%s exceeded the memory limit of the query of %d MB",
+							consumerName, MaxQueryMemoryMB),
+						errdetail_log(
+							"%s exceeded the query memory limit of %d MB",
+							consumerName, MaxQueryMemoryMB)));
+	}
+
+	QueryMemoryReservation *reservation = GetReservation(context);
+	reservation->reservedBytes += bytes;
+	QueryMemoryUsedBytes += bytes;
+	QueryMemoryPeakBytes = Max(QueryMemoryPeakBytes, QueryMemoryUsedBytes);
+	return true;
+}
+
+
+/*
+ * Returns the reservation of the memory context, creating it on the first
+ * reservation since the context was created or last reset.
+ */
+static QueryMemoryReservation *
+GetReservation(MemoryContext context)
+{
+	if (LastReservation != NULL && LastReservation->context == context)
+	{
+		return LastReservation;
+	}
+
+	QueryMemoryReservation *reservation = Reservations;
+	while (reservation != NULL && reservation->context != context)
+	{
+		reservation = reservation->next;
+	}
+
+	if (reservation == NULL)
+	{
+		reservation = MemoryContextAllocZero(context, sizeof(QueryMemoryReservation));
+		reservation->context = context;
+		reservation->next = Reservations;
+		reservation->resetCallback.func = ReleaseReservation;
+		reservation->resetCallback.arg = reservation;
+		MemoryContextRegisterResetCallback(context, &reservation->resetCallback);
+		Reservations = reservation;
+	}
+
+	LastReservation = reservation;
+	return reservation;
+}
+
+
+/*
+ * Gives the memory of a context back to the budget when the context is reset or
+ * deleted, and forgets its reservation.
+ */
+static void
+ReleaseReservation(void *arg)
+{
+	QueryMemoryReservation *reservation = (QueryMemoryReservation *) arg;
+	QueryMemoryUsedBytes = Max(QueryMemoryUsedBytes - reservation->reservedBytes, 0);
+
+	QueryMemoryReservation **link = &Reservations;
+	while (*link != NULL && *link != reservation)
+	{
+		link = &(*link)->next;
+	}
+
+	if (*link != NULL)
+	{
+		*link = reservation->next;
+	}
+
+	if (LastReservation == reservation)
+	{
+		LastReservation = NULL;
+	}
+}
@@ -363,6 +363,27 @@ ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ(char *query, const Oid userOid, b
 }
 
 
+/*
+ * Same as ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ, but passes the given
+ * run time parameters (e.g. "-c vacuum_cost_delay=2") as the options of the
+ * connection, for the statements that can't run in a multi command string.
+ */
+char *
+ExtensionExecuteQueryAsUserOnLocalhostWithOptionsViaLibPQ(char *query, const Oid
+														  userOid, const
+														  char *connectionOptions)
+{
+	bool useSerialExecution = false;
+	char *connStr = GetLocalhostConnStr(userOid, useSerialExecution);
+	if (connectionOptions != NULL)
+	{
+		connStr = psprintf("%s options='%s'", connStr, connectionOptions);
+	}
+
+	return ExtensionExecuteQueryViaLibPQ(query, connStr);
+}
+
+
 /* Same as ExtensionExecuteQueryAsUserOnLocalhostViaLibPQ, but it allows to execute parameterized query */
 char *
 ExtensionExecuteQueryWithArgsAsUserOnLocalhostViaLibPQ(char *query, const Oid userOid, int
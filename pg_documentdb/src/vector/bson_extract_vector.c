@@ -36,6 +36,19 @@
 /* --------------------------------------------------------- */
 
 
+/* The binary subtype for vectors and the element types it can hold */
+#define BSON_BINARY_SUBTYPE_VECTOR 0x09
+#define BSON_BINARY_VECTOR_INT8 0x03
+#define BSON_BINARY_VECTOR_FLOAT32 0x27
+
+/* Binary vectors start with the element type and a padding byte */
+#define BSON_BINARY_VECTOR_HEADER_SIZE 2
+
+
+static ArrayType * AllocateDoubleArray(int32_t numElements);
+static ArrayType * NumericArrayToDoubleArray(const bson_iter_t *arrayIter);
+static ArrayType * BinaryVectorToDoubleArray(const bson_iter_t *binaryIter);
+
 PG_FUNCTION_INFO_V1(command_bson_extract_vector);
 
 
@@ -80,54 +93,161 @@ command_bson_extract_vector_base(pgbson *document, char *pathStr, bool *isNull)
 		return (Datum) 0;
 	}
 
-	if (bson_iter_type(&documentIter) != BSON_TYPE_ARRAY)
+	ArrayType *array = NULL;
+	if (bson_iter_type(&documentIter) == BSON_TYPE_BINARY)
+	{
+		array = BinaryVectorToDoubleArray(&documentIter);
+	}
+	else if (bson_iter_type(&documentIter) == BSON_TYPE_ARRAY)
+	{
+		bson_iter_recurse(&documentIter, &documentIter);
+		array = NumericArrayToDoubleArray(&documentIter);
+	}
+
+	if (array == NULL)
 	{
-		/* We ignore non leaf arrays for the path */
+		/* We ignore non leaf arrays and invalid arrays for the path */
 		*isNull = true;
 		return (Datum) 0;
 	}
 
-	bson_iter_recurse(&documentIter, &documentIter);
+	return OidFunctionCall3Coll(
+		PgDoubleToVectorFunctionOid(),
+		InvalidOid, PointerGetDatum(array), Int32GetDatum(-1),
+		BoolGetDatum(false));
+}
 
-	bson_iter_t currentArrayIter = documentIter;
 
+/*
+ * Allocates a one dimensional float8[] of the given size whose values are filled
+ * in place by the caller.
+ */
+static ArrayType *
+AllocateDoubleArray(int32_t numElements)
+{
+	Size numBytes = ARR_OVERHEAD_NONULLS(1) + sizeof(float8) * numElements;
+	ArrayType *array = (ArrayType *) palloc0(numBytes);
+	SET_VARSIZE(array, numBytes);
+	array->ndim = 1;
+	array->dataoffset = 0;
+	array->elemtype = FLOAT8OID;
+	ARR_DIMS(array)[0] = numElements;
+	ARR_LBOUND(array)[0] = 1;
+	return array;
+}
+
+
+/*
+ * Converts the elements of a bson array into a float8[]. The doubles are written
+ * straight into the array without going through a Datum per element. Returns
+ * NULL if the array is empty or has non numeric elements.
+ */
+static ArrayType *
+NumericArrayToDoubleArray(const bson_iter_t *arrayIter)
+{
 	/* First pass, count elements */
+	bson_iter_t currentArrayIter = *arrayIter;
 	int32_t numElements = 0;
-	bool isAllNumeric = true;
 	while (bson_iter_next(&currentArrayIter))
 	{
-		numElements++;
-		if (!BsonValueIsNumber(bson_iter_value(&currentArrayIter)))
+		bson_type_t elementType = bson_iter_type(&currentArrayIter);
+		if (elementType != BSON_TYPE_DOUBLE &&
+			!BsonValueIsNumber(bson_iter_value(&currentArrayIter)))
 		{
-			isAllNumeric = false;
+			return NULL;
 		}
+
+		numElements++;
 	}
 
-	if (!isAllNumeric || numElements == 0)
+	if (numElements == 0)
 	{
-		/* We ignore invalid arrays for the path */
-		*isNull = true;
-		return (Datum) 0;
+		return NULL;
 	}
 
-	Datum *floatDatumArray = palloc(sizeof(Datum) * numElements);
+	ArrayType *array = AllocateDoubleArray(numElements);
+	float8 *values = (float8 *) ARR_DATA_PTR(array);
 
 	int i = 0;
-	currentArrayIter = documentIter;
+	currentArrayIter = *arrayIter;
 	while (bson_iter_next(&currentArrayIter))
 	{
-		floatDatumArray[i] = Float8GetDatum(BsonValueAsDouble(bson_iter_value(
-																  &currentArrayIter)));
+		/* Embeddings are almost always doubles: skip the type dispatch for them */
+		if (bson_iter_type(&currentArrayIter) == BSON_TYPE_DOUBLE)
+		{
+			values[i] = bson_iter_double(&currentArrayIter);
+		}
+		else
+		{
+			values[i] = BsonValueAsDouble(bson_iter_value(&currentArrayIter));
+		}
+
 		i++;
 	}
 
-	bool elmbyval = true;
-	ArrayType *array = construct_array(floatDatumArray, numElements, FLOAT8OID,
-									   sizeof(double),
-									   elmbyval, TYPALIGN_INT);
+	return array;
+}
 
-	return OidFunctionCall3Coll(
-		PgDoubleToVectorFunctionOid(),
-		InvalidOid, PointerGetDatum(array), Int32GetDatum(-1),
-		BoolGetDatum(false));
+
+/*
+ * Converts a BSON binary vector (subtype 9) of packed float32 or int8 values into
+ * a float8[]. The payload starts with the element type and a padding byte.
+ * Returns NULL for other binary subtypes, packed bit vectors and empty vectors.
+ */
+static ArrayType *
+BinaryVectorToDoubleArray(const bson_iter_t *binaryIter)
+{
+	bson_subtype_t subtype;
+	uint32_t length;
+	const uint8_t *data;
+	bson_iter_binary(binaryIter, &subtype, &length, &data);
+	if ((int) subtype != BSON_BINARY_SUBTYPE_VECTOR ||
+		length <= BSON_BINARY_VECTOR_HEADER_SIZE)
+	{
+		return NULL;
+	}
+
+	uint8_t elementType = data[0];
+	const uint8_t *payload = data + BSON_BINARY_VECTOR_HEADER_SIZE;
+	uint32_t payloadLength = length - BSON_BINARY_VECTOR_HEADER_SIZE;
+
+	ArrayType *array;
+	if (elementType == BSON_BINARY_VECTOR_FLOAT32)
+	{
+		if (payloadLength % sizeof(float) != 0)
+		{
+			return NULL;
+		}
+
+		int32_t numElements = payloadLength / sizeof(float);
+		array = AllocateDoubleArray(numElements);
+		float8 *values = (float8 *) ARR_DATA_PTR(array);
+		for (int32_t i = 0; i < numElements; i++)
+		{
+			/* The floats are little endian and not aligned */
+			uint32_t bits;
+			memcpy(&bits, payload + i * sizeof(float), sizeof(float));
+			bits = BSON_UINT32_FROM_LE(bits);
+
+			float value;
+			memcpy(&value, &bits, sizeof(float));
+			values[i] = value;
+		}
+	}
+	else if (elementType == BSON_BINARY_VECTOR_INT8)
+	{
+		int32_t numElements = payloadLength;
+		array = AllocateDoubleArray(numElements);
+		float8 *values = (float8 *) ARR_DATA_PTR(array);
+		for (int32_t i = 0; i < numElements; i++)
+		{
+			values[i] = (int8_t) payload[i];
+		}
+	}
+	else
+	{
+		return NULL;
+	}
+
+	return array;
 }
@@ -0,0 +1,570 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/vector/vector_search_calibration.c
+ *
+ * Calibration of the search parameters of vector indexes for a target
+ * recall. A background job samples vectors of each vector index as queries
+ * and runs them with an exact search and through the index for increasing
+ * values of its search parameter (efSearch for hnsw, nProbes for ivfflat).
+ * The recall measured for each value is kept in shared memory, and searches
+ * that specify a targetRecall use the smallest value that meets it.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include <postgres.h>
+#include <fmgr.h>
+#include <miscadmin.h>
+#include <access/relation.h>
+#include <catalog/pg_type.h>
+#include <commands/defrem.h>
+#include <executor/spi.h>
+#include <storage/lwlock.h>
+#include <storage/shmem.h>
+#include <utils/array.h>
+#include <utils/builtins.h>
+#include <utils/guc.h>
+#include <utils/lsyscache.h>
+#include <utils/rel.h>
+#include <utils/timestamp.h>
+
+#include "metadata/metadata_cache.h"
+#include "utils/guc_utils.h"
+#include "utils/query_utils.h"
+#include "vector/vector_common.h"
+#include "vector/vector_search_calibration.h"
+
+/* The number of vector indexes calibrated: The least recently calibrated is replaced once full */
+#define MAX_CALIBRATED_VECTOR_INDEXES 512
+
+/* The values of the search parameter measured per index */
+#define MAX_VECTOR_CALIBRATION_POINTS 16
+
+/* The recall is measured for the top k results of the sampled queries */
+#define VECTOR_CALIBRATION_K 10
+
+/* An index is calibrated again after this long */
+#define VECTOR_CALIBRATION_MIN_AGE_SECONDS 3600
+
+/*
+ * The search parameter of a kind of vector index, and the range of values
+ * that are calibrated.
+ */
+typedef struct VectorCalibrationKind
+{
+	const char *accessMethodName;
+
+	const char *parameterName;
+	uint32_t parameterNameLength;
+
+	/* The pgvector GUC of the parameter */
+	const char *gucName;
+
+	int32_t minValue;
+	int32_t maxValue;
+} VectorCalibrationKind;
+
+static const VectorCalibrationKind VectorCalibrationKinds[] = {
+	{
+		.accessMethodName = "hnsw",
+		.parameterName = VECTOR_PARAMETER_NAME_HNSW_EF_SEARCH,
+		.parameterNameLength = VECTOR_PARAMETER_NAME_HNSW_EF_SEARCH_STR_LEN,
+		.gucName = "hnsw.ef_search",
+
+		/* Smaller values return fewer than k results */
+		.minValue = VECTOR_CALIBRATION_K,
+		.maxValue = HNSW_MAX_EF_SEARCH
+	},
+	{
+		.accessMethodName = "ivfflat",
+		.parameterName = VECTOR_PARAMETER_NAME_IVF_NPROBES,
+		.parameterNameLength = VECTOR_PARAMETER_NAME_IVF_NPROBES_STR_LEN,
+		.gucName = "ivfflat.probes",
+		.minValue = IVFFLAT_MIN_NPROBES,
+		.maxValue = IVFFLAT_MAX_NPROBES
+	}
+};
+
+#define NUM_VECTOR_CALIBRATION_KINDS \
+	(sizeof(VectorCalibrationKinds) / sizeof(VectorCalibrationKind))
+
+/*
+ * The recall curve of a vector index: recalls[i] is the recall measured with
+ * parameters[i], in increasing order of the parameter.
+ */
+typedef struct VectorSearchCalibration
+{
+	/* InvalidOid if the entry is unused */
+	Oid databaseOid;
+	Oid indexOid;
+
+	/* The index of the kind in VectorCalibrationKinds */
+	int kindIndex;
+
+	int numPoints;
+	int32_t parameters[MAX_VECTOR_CALIBRATION_POINTS];
+	double recalls[MAX_VECTOR_CALIBRATION_POINTS];
+
+	TimestampTz calibrationTime;
+} VectorSearchCalibration;
+
+typedef struct VectorSearchCalibrationData
+{
+	int trancheId;
+
+	char *trancheName;
+
+	LWLock lock;
+
+	VectorSearchCalibration calibrations[MAX_CALIBRATED_VECTOR_INDEXES];
+} VectorSearchCalibrationData;
+
+static VectorSearchCalibrationData *VectorSearchCalibrations = NULL;
+
+PG_FUNCTION_INFO_V1(calibrate_vector_indexes_background);
+
+static const VectorCalibrationKind * GetVectorCalibrationKind(Oid accessMethodOid,
+															  int *kindIndex);
+static VectorSearchCalibration * FindVectorSearchCalibration(Oid indexOid);
+static bool IsVectorIndexCalibrationDue(Oid indexOid);
+static bool CalibrateVectorIndex(Oid indexOid, int sampleSize);
+static void StoreVectorSearchCalibration(const VectorSearchCalibration *calibration);
+
+
+Size
+VectorSearchCalibrationShmemSize(void)
+{
+	return sizeof(VectorSearchCalibrationData);
+}
+
+
+/*
+ * InitializeVectorSearchCalibrationShmem initializes the shared memory recall
+ * curves of the vector indexes.
+ */
+void
+InitializeVectorSearchCalibrationShmem(void)
+{
+	bool found = false;
+
+	LWLockAcquire(AddinShmemInitLock, LW_EXCLUSIVE);
+	VectorSearchCalibrations =
+		(VectorSearchCalibrationData *) ShmemInitStruct(
+			"DocumentDB Vector Search Calibration",
+			VectorSearchCalibrationShmemSize(),
+			&found);
+
+	if (!found)
+	{
+		memset(VectorSearchCalibrations, 0, VectorSearchCalibrationShmemSize());
+		VectorSearchCalibrations->trancheId = LWLockNewTrancheId();
+		VectorSearchCalibrations->trancheName = "Vector Search Calibration Tranche";
+		LWLockRegisterTranche(VectorSearchCalibrations->trancheId,
+							  VectorSearchCalibrations->trancheName);
+
+		LWLockInitialize(&VectorSearchCalibrations->lock,
+						 VectorSearchCalibrations->trancheId);
+	}
+
+	LWLockRelease(AddinShmemInitLock);
+}
+
+
+/*
+ * TryGetCalibratedVectorSearchParameter returns the smallest calibrated value
+ * of the search parameter of the index that meets the target recall (or the
+ * largest calibrated value if none does). Returns false if the index was not
+ * calibrated yet.
+ */
+bool
+TryGetCalibratedVectorSearchParameter(Oid indexOid, double targetRecall,
+									  const char **parameterName,
+									  uint32_t *parameterNameLength,
+									  int32_t *parameterValue)
+{
+	if (VectorSearchCalibrations == NULL)
+	{
+		return false;
+	}
+
+	bool found = false;
+	LWLockAcquire(&VectorSearchCalibrations->lock, LW_SHARED);
+
+	VectorSearchCalibration *calibration = FindVectorSearchCalibration(indexOid);
+	if (calibration != NULL && calibration->numPoints > 0)
+	{
+		int point = 0;
+		while (point < calibration->numPoints - 1 &&
+			   calibration->recalls[point] < targetRecall)
+		{
+			point++;
+		}
+
+		const VectorCalibrationKind *kind =
+			&VectorCalibrationKinds[calibration->kindIndex];
+		*parameterName = kind->parameterName;
+		*parameterNameLength = kind->parameterNameLength;
+		*parameterValue = calibration->parameters[point];
+		found = true;
+	}
+
+	LWLockRelease(&VectorSearchCalibrations->lock);
+	return found;
+}
+
+
+/*
+ * calibrate_vector_indexes_background measures the recall curve of up to a
+ * batch of vector indexes of the current database (default one per run) that
+ * were not calibrated in the last hour, with VectorSearchCalibrationSampleSize
+ * sampled queries each. This is called periodically by the background worker
+ * framework.
+ */
+Datum
+calibrate_vector_indexes_background(PG_FUNCTION_ARGS)
+{
+	int32 batchSize = PG_ARGISNULL(0) ? -1 : PG_GETARG_INT32(0);
+	if (batchSize <= 0)
+	{
+		batchSize = 1;
+	}
+
+	if (VectorSearchCalibrationSampleSize <= 0 || VectorSearchCalibrations == NULL)
+	{
+		PG_RETURN_VOID();
+	}
+
+	const char *indexesQuery =
+		FormatSqlQuery("SELECT array_agg(c.oid ORDER BY c.oid) FROM pg_catalog.pg_class c"
+					   " JOIN pg_catalog.pg_am am ON am.oid = c.relam"
+					   " JOIN pg_catalog.pg_index i ON i.indexrelid = c.oid"
+					   " WHERE c.relnamespace = %u AND i.indisvalid"
+					   " AND am.amname IN ('hnsw', 'ivfflat')",
+					   ApiDataNamespaceOid());
+
+	bool readOnly = true;
+	bool isNull = false;
+	Datum indexOidsDatum = ExtensionExecuteQueryViaSPI(indexesQuery, readOnly,
+													   SPI_OK_SELECT, &isNull);
+	if (isNull)
+	{
+		PG_RETURN_VOID();
+	}
+
+	Datum *indexOids = NULL;
+	int indexCount = 0;
+	deconstruct_array(DatumGetArrayTypeP(indexOidsDatum), OIDOID, sizeof(Oid), true,
+					  TYPALIGN_INT, &indexOids, NULL, &indexCount);
+
+	int calibrated = 0;
+	for (int i = 0; i < indexCount && calibrated < batchSize; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		Oid indexOid = DatumGetObjectId(indexOids[i]);
+		if (!IsVectorIndexCalibrationDue(indexOid))
+		{
+			continue;
+		}
+
+		if (CalibrateVectorIndex(indexOid, VectorSearchCalibrationSampleSize))
+		{
+			calibrated++;
+		}
+	}
+
+	PG_RETURN_VOID();
+}
+
+
+/* --------------------------------------------------------- */
+/* Private helper methods */
+/* --------------------------------------------------------- */
+
+static const VectorCalibrationKind *
+GetVectorCalibrationKind(Oid accessMethodOid, int *kindIndex)
+{
+	char *accessMethodName = get_am_name(accessMethodOid);
+	if (accessMethodName == NULL)
+	{
+		return NULL;
+	}
+
+	for (int i = 0; i < (int) NUM_VECTOR_CALIBRATION_KINDS; i++)
+	{
+		if (strcmp(accessMethodName, VectorCalibrationKinds[i].accessMethodName) == 0)
+		{
+			*kindIndex = i;
+			return &VectorCalibrationKinds[i];
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+ * Returns the calibration of the index in the current database, NULL if
+ * there is none. Must be called with the lock held.
+ */
+static VectorSearchCalibration *
+FindVectorSearchCalibration(Oid indexOid)
+{
+	for (int i = 0; i < MAX_CALIBRATED_VECTOR_INDEXES; i++)
+	{
+		VectorSearchCalibration *calibration = &VectorSearchCalibrations->calibrations[i];
+		if (calibration->indexOid == indexOid &&
+			calibration->databaseOid == MyDatabaseId)
+		{
+			return calibration;
+		}
+	}
+
+	return NULL;
+}
+
+
+static bool
+IsVectorIndexCalibrationDue(Oid indexOid)
+{
+	TimestampTz calibrationTime = 0;
+
+	LWLockAcquire(&VectorSearchCalibrations->lock, LW_SHARED);
+	VectorSearchCalibration *calibration = FindVectorSearchCalibration(indexOid);
+	if (calibration != NULL)
+	{
+		calibrationTime = calibration->calibrationTime;
+	}
+
+	LWLockRelease(&VectorSearchCalibrations->lock);
+
+	return calibration == NULL ||
+		   TimestampDifferenceExceeds(calibrationTime, GetCurrentTimestamp(),
+									  VECTOR_CALIBRATION_MIN_AGE_SECONDS * 1000);
+}
+
+
+/*
+ * Measures the recall of the index for increasing values of its search
+ * parameter (doubling from the minimum up to the maximum), until the recall
+ * is 1, and stores the curve. Returns false if the index could not be
+ * calibrated (e.g. its table has no vectors yet).
+ */
+static bool
+CalibrateVectorIndex(Oid indexOid, int sampleSize)
+{
+	Relation indexRelation = try_relation_open(indexOid, AccessShareLock);
+	if (indexRelation == NULL)
+	{
+		return false;
+	}
+
+	VectorSearchCalibration calibration = { 0 };
+	const VectorCalibrationKind *kind =
+		GetVectorCalibrationKind(indexRelation->rd_rel->relam, &calibration.kindIndex);
+	Oid tableOid = indexRelation->rd_index->indrelid;
+	relation_close(indexRelation, AccessShareLock);
+
+	if (kind == NULL)
+	{
+		return false;
+	}
+
+	/*
+	 * The indexed expression, its type (to cast the query vectors to it) and
+	 * the ordering operator of the index, so that the queries are served by
+	 * the index.
+	 */
+	const char *indexInfoQuery =
+		FormatSqlQuery("SELECT pg_catalog.pg_get_indexdef(i.indexrelid, 1, false),"
+					   " pg_catalog.format_type(a.atttypid, a.atttypmod),"
+					   " pg_catalog.format('OPERATOR(%%I.%%s)', n.nspname, o.oprname),"
+					   " i.indrelid::regclass::text,"
+					   " c.reltuples::float8"
+					   " FROM pg_catalog.pg_index i"
+					   " JOIN pg_catalog.pg_attribute a ON a.attrelid = i.indexrelid AND a.attnum = 1"
+					   " JOIN pg_catalog.pg_opclass oc ON oc.oid = i.indclass[0]"
+					   " JOIN pg_catalog.pg_amop ao ON ao.amopfamily = oc.opcfamily AND ao.amoppurpose = 'o'"
+					   " JOIN pg_catalog.pg_operator o ON o.oid = ao.amopopr"
+					   " JOIN pg_catalog.pg_namespace n ON n.oid = o.oprnamespace"
+					   " JOIN pg_catalog.pg_class c ON c.oid = i.indrelid"
+					   " WHERE i.indexrelid = %u LIMIT 1", indexOid);
+
+	Datum indexInfo[5] = { 0 };
+	bool indexInfoIsNull[5] = { 0 };
+	bool readOnly = true;
+	ExtensionExecuteMultiValueQueryViaSPI(indexInfoQuery, readOnly, SPI_OK_SELECT,
+										  indexInfo, indexInfoIsNull, 5);
+	for (int i = 0; i < 5; i++)
+	{
+		if (indexInfoIsNull[i])
+		{
+			return false;
+		}
+	}
+
+	const char *vectorExpression = TextDatumGetCString(indexInfo[0]);
+	const char *vectorType = TextDatumGetCString(indexInfo[1]);
+	const char *distanceOperator = TextDatumGetCString(indexInfo[2]);
+	const char *tableName = TextDatumGetCString(indexInfo[3]);
+	double tableRows = Max(DatumGetFloat8(indexInfo[4]), 1);
+
+	/* Sample about 10 times the vectors needed so that enough of them are set */
+	double samplePercent = Min(100.0, 1000.0 * sampleSize / tableRows);
+	const char *sampleQuery =
+		FormatSqlQuery("SELECT array_agg(v::text) FROM (SELECT %s AS v FROM %s"
+					   " TABLESAMPLE SYSTEM (%f) WHERE %s IS NOT NULL LIMIT %d) s",
+					   vectorExpression, tableName, samplePercent, vectorExpression,
+					   sampleSize);
+
+	bool isNull = false;
+	Datum sampleDatum = ExtensionExecuteQueryViaSPI(sampleQuery, readOnly, SPI_OK_SELECT,
+													&isNull);
+	if (isNull)
+	{
+		return false;
+	}
+
+	Datum *sampleVectors = NULL;
+	int sampleCount = 0;
+	deconstruct_array(DatumGetArrayTypeP(sampleDatum), TEXTOID, -1, false,
+					  TYPALIGN_INT, &sampleVectors, NULL, &sampleCount);
+	sampleCount = Min(sampleCount, sampleSize);
+	if (sampleCount == 0)
+	{
+		return false;
+	}
+
+	char **queryVectors = palloc(sizeof(char *) * sampleCount);
+	char **exactResults = palloc(sizeof(char *) * sampleCount);
+	int64 exactResultCount = 0;
+
+	/* The exact top k results of the sampled queries, ranked without the index */
+	int savedGUCLevel = NewGUCNestLevel();
+	SetGUCLocally("enable_indexscan", "off");
+	SetGUCLocally("enable_bitmapscan", "off");
+	for (int i = 0; i < sampleCount; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		queryVectors[i] = psprintf("%s::%s",
+								   quote_literal_cstr(TextDatumGetCString(
+														  sampleVectors[i])),
+								   vectorType);
+
+		const char *exactQuery =
+			FormatSqlQuery("SELECT array_agg(ctid)::text, count(*) FROM (SELECT ctid"
+						   " FROM %s ORDER BY %s %s %s LIMIT %d) s",
+						   tableName, vectorExpression, distanceOperator,
+						   queryVectors[i], VECTOR_CALIBRATION_K);
+
+		Datum exactValues[2] = { 0 };
+		bool exactIsNull[2] = { 0 };
+		ExtensionExecuteMultiValueQueryViaSPI(exactQuery, readOnly, SPI_OK_SELECT,
+											  exactValues, exactIsNull, 2);
+		exactResults[i] = exactIsNull[0] ? NULL : TextDatumGetCString(exactValues[0]);
+		exactResultCount += exactIsNull[1] ? 0 : DatumGetInt64(exactValues[1]);
+	}
+
+	RollbackGUCChange(savedGUCLevel);
+
+	if (exactResultCount == 0)
+	{
+		return false;
+	}
+
+	/* The recall of the index searches for increasing parameter values */
+	int32_t parameter = kind->minValue;
+	while (calibration.numPoints < MAX_VECTOR_CALIBRATION_POINTS)
+	{
+		int64 matchedResultCount = 0;
+
+		savedGUCLevel = NewGUCNestLevel();
+		SetGUCLocally("enable_seqscan", "off");
+		SetGUCLocally(kind->gucName, psprintf("%d", parameter));
+		for (int i = 0; i < sampleCount; i++)
+		{
+			CHECK_FOR_INTERRUPTS();
+
+			if (exactResults[i] == NULL)
+			{
+				continue;
+			}
+
+			const char *indexQuery =
+				FormatSqlQuery("SELECT count(*) FROM (SELECT ctid FROM %s"
+							   " ORDER BY %s %s %s LIMIT %d) s"
+							   " WHERE ctid = ANY(%s::tid[])",
+							   tableName, vectorExpression, distanceOperator,
+							   queryVectors[i], VECTOR_CALIBRATION_K,
+							   quote_literal_cstr(exactResults[i]));
+
+			isNull = false;
+			Datum matched = ExtensionExecuteQueryViaSPI(indexQuery, readOnly,
+														SPI_OK_SELECT, &isNull);
+			matchedResultCount += isNull ? 0 : DatumGetInt64(matched);
+		}
+
+		RollbackGUCChange(savedGUCLevel);
+
+		double recall = (double) matchedResultCount / exactResultCount;
+		calibration.parameters[calibration.numPoints] = parameter;
+		calibration.recalls[calibration.numPoints] = recall;
+		calibration.numPoints++;
+
+		if (recall >= 1.0 || parameter >= kind->maxValue)
+		{
+			break;
+		}
+
+		parameter = (int32_t) Min((int64) parameter * 2, (int64) kind->maxValue);
+	}
+
+	calibration.databaseOid = MyDatabaseId;
+	calibration.indexOid = indexOid;
+	calibration.calibrationTime = GetCurrentTimestamp();
+	StoreVectorSearchCalibration(&calibration);
+
+	elog(LOG, "Calibrated %s of vector index %u with %d queries: %d points, "
+			  "recall %f at %d", kind->parameterName, indexOid, sampleCount,
+		 calibration.numPoints, calibration.recalls[calibration.numPoints - 1],
+		 calibration.parameters[calibration.numPoints - 1]);
+	return true;
+}
+
+
+/*
+ * Stores the calibration of an index, replacing its previous one, or else a
+ * free entry, or else the least recently calibrated index.
+ */
+static void
+StoreVectorSearchCalibration(const VectorSearchCalibration *calibration)
+{
+	LWLockAcquire(&VectorSearchCalibrations->lock, LW_EXCLUSIVE);
+
+	VectorSearchCalibration *target = FindVectorSearchCalibration(calibration->indexOid);
+	for (int i = 0; i < MAX_CALIBRATED_VECTOR_INDEXES && target == NULL; i++)
+	{
+		if (VectorSearchCalibrations->calibrations[i].indexOid == InvalidOid)
+		{
+			target = &VectorSearchCalibrations->calibrations[i];
+		}
+	}
+
+	if (target == NULL)
+	{
+		target = &VectorSearchCalibrations->calibrations[0];
+		for (int i = 1; i < MAX_CALIBRATED_VECTOR_INDEXES; i++)
+		{
+			if (VectorSearchCalibrations->calibrations[i].calibrationTime <
+				target->calibrationTime)
+			{
+				target = &VectorSearchCalibrations->calibrations[i];
+			}
+		}
+	}
+
+	*target = *calibration;
+	LWLockRelease(&VectorSearchCalibrations->lock);
+}
@@ -27,6 +27,7 @@
 #include "vector/vector_common.h"
 #include "vector/vector_configs.h"
 #include "vector/vector_planner.h"
+#include "vector/vector_search_calibration.h"
 #include "vector/vector_utilities.h"
 #include "vector/vector_spec.h"
 #include "utils/error_utils.h"
@@ -49,6 +50,7 @@ static VectorIndexDistanceMetric GetDistanceMetricFromOpName(const
 
 static bool IsHalfVectorCastFunctionCore(FuncExpr *vectorCastFunc,
 										 bool logWarning);
+static pgbson * AddCalibratedSearchParameter(Oid indexOid, pgbson *searchParamBson);
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -118,6 +120,8 @@ CalculateSearchParamBsonForIndexPath(IndexPath *vectorSearchPath, pgbson *search
 	if (definition != NULL)
 	{
 		Oid indexOid = indexPath->indexinfo->indexoid;
+		searchParamBson = AddCalibratedSearchParameter(indexOid, searchParamBson);
+
 		Relation indexRelation = RelationIdGetRelation(indexOid);
 		if (indexRelation->rd_options != NULL)
 		{
@@ -575,3 +579,44 @@ IsHalfVectorCastFunctionCore(FuncExpr *vectorCastFunc, bool logWarning)
 
 	return false;
 }
+
+
+/*
+ * If the search specifies a targetRecall and the index was calibrated, adds
+ * the calibrated efSearch or nProbes that meets it to the search parameters,
+ * unless they already specify it. Otherwise the parameter is calculated by
+ * the static rules of the index kind.
+ */
+static pgbson *
+AddCalibratedSearchParameter(Oid indexOid, pgbson *searchParamBson)
+{
+	bson_iter_t targetRecallIter;
+	if (searchParamBson == NULL ||
+		!PgbsonInitIteratorAtPath(searchParamBson, VECTOR_PARAMETER_NAME_TARGET_RECALL,
+								  &targetRecallIter))
+	{
+		return searchParamBson;
+	}
+
+	const char *parameterName = NULL;
+	uint32_t parameterNameLength = 0;
+	int32_t parameterValue = 0;
+	double targetRecall = BsonValueAsDouble(bson_iter_value(&targetRecallIter));
+	if (!TryGetCalibratedVectorSearchParameter(indexOid, targetRecall, &parameterName,
+											   &parameterNameLength, &parameterValue))
+	{
+		return searchParamBson;
+	}
+
+	bson_iter_t parameterIter;
+	if (PgbsonInitIteratorAtPath(searchParamBson, parameterName, &parameterIter))
+	{
+		return searchParamBson;
+	}
+
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+	PgbsonWriterAppendInt32(&writer, parameterName, parameterNameLength, parameterValue);
+	PgbsonWriterConcat(&writer, searchParamBson);
+	return PgbsonWriterGetPgbson(&writer);
+}
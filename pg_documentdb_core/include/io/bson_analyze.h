@@ -0,0 +1,64 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * include/io/bson_analyze.h
+ *
+ * Declarations for the per path statistics collected by bson_typanalyze.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#ifndef BSON_ANALYZE_H
+#define BSON_ANALYZE_H
+
+#include "utils/string_view.h"
+
+/*
+ * The pg_statistic slot kind used for the per path statistics of a bson column.
+ * The slot's values are bson documents of one of two forms:
+ *
+ *   { "p": <path>, "n": <sample rows>, "a": <has arrays>, "c": <is complete>, "d": <tracked values> }
+ *     A summary of a top level path: The matching number is the fraction of the
+ *     sampled documents that have the path.
+ *
+ *   { "p": <path>, "v": <value> }
+ *     A most common value of a top level path: The matching number is the fraction
+ *     of the sampled documents that have the value at the path.
+ */
+#define BSON_STATISTIC_KIND_PATH_STATS 9201
+
+/*
+ * The parsed form of an entry of the per path statistics slot.
+ */
+typedef struct BsonPathStatisticsEntry
+{
+	/* The top level path the entry is for */
+	StringView path;
+
+	/* Whether this is the summary of the path, or a most common value for it */
+	bool isSummary;
+
+	/* The most common value (for non summary entries) */
+	bson_value_t value;
+
+	/* The number of documents sampled (for summary entries) */
+	int64 sampleRows;
+
+	/* Whether any sampled document had an array at the path (for summary entries) */
+	bool hasArrays;
+
+	/*
+	 * Whether every value seen more than once at the path in the sample is stored as
+	 * a most common value: If so, any other value did not occur in the sample more
+	 * than once (for summary entries).
+	 */
+	bool isComplete;
+
+	/* The number of distinct values tracked at the end of the sample (for summary entries) */
+	int32 trackedValues;
+} BsonPathStatisticsEntry;
+
+void ParseBsonPathStatisticsEntry(const pgbson *entryDocument,
+								  BsonPathStatisticsEntry *entry);
+
+#endif
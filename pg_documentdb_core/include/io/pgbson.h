@@ -21,6 +21,7 @@
 #include <varatt.h>
 #endif
 #include <nodes/pg_list.h>
+#include <lib/stringinfo.h>
 
 /*
  * Max length of string, generated by converting unit32 type value to a string.
@@ -82,6 +83,7 @@ const char * BsonValueToJsonForLoggingWithOptions(const bson_value_t *value, boo
 const char * FormatBsonValueForShellLogging(const bson_value_t *bson);
 const char * PgbsonIterDocumentToJsonForLogging(const bson_iter_t *iter);
 const char * PgbsonToCanonicalExtendedJson(const pgbson *bsonDocument);
+bool TryAppendPgbsonAsCanonicalExtendedJson(StringInfo buffer, const pgbson *document);
 const char * PgbsonToLegacyJson(const pgbson *bsonDocument);
 const char * PgbsonToHexadecimalString(const pgbson *bsonDocument);
 
@@ -95,6 +97,67 @@ void PgbsonInitIterator(const pgbson *bson, bson_iter_t *iterator);
 void BsonValueInitIterator(const bson_value_t *value, bson_iter_t *iterator);
 
 
+/* The number of directory entries that are tracked without a heap allocation */
+#define PGBSON_FIELD_DIRECTORY_INLINE_ENTRIES 16
+
+/*
+ * An entry in the field directory: The key of a top level field
+ * and the offset of that field in the document.
+ */
+typedef struct PgbsonFieldDirectoryEntry
+{
+	/* The key of the field (points into the document) */
+	const char *key;
+
+	/* The length of the key */
+	uint32_t keyLength;
+
+	/* The offset of the field within the document */
+	uint32_t offset;
+} PgbsonFieldDirectoryEntry;
+
+/*
+ * A lazily built directory of top level field offsets for a single document.
+ * Lookups on the directory resolve previously visited fields without
+ * re-walking the document, and resume the scan for fields not yet seen.
+ * The directory must not outlive the document it was initialized with.
+ */
+typedef struct PgbsonFieldDirectory
+{
+	/* The document that the directory indexes */
+	const pgbson *document;
+
+	/* The iterator used to incrementally scan the document */
+	bson_iter_t scanIterator;
+
+	/* Whether or not the scan iterator has been initialized */
+	bool isScanStarted;
+
+	/* Whether or not every top level field has been recorded */
+	bool isComplete;
+
+	/* The number of entries recorded */
+	int numEntries;
+
+	/* The capacity of the entries array */
+	int maxEntries;
+
+	/* The recorded entries, either the inline entries or a palloc'd array */
+	PgbsonFieldDirectoryEntry *entries;
+
+	/* Inline storage for the entries to avoid allocations on narrow documents */
+	PgbsonFieldDirectoryEntry inlineEntries[PGBSON_FIELD_DIRECTORY_INLINE_ENTRIES];
+} PgbsonFieldDirectory;
+
+/* pgbson field directory functions */
+void PgbsonFieldDirectoryInit(PgbsonFieldDirectory *directory, const pgbson *document);
+void PgbsonFieldDirectoryFree(PgbsonFieldDirectory *directory);
+bool PgbsonFieldDirectoryFindField(PgbsonFieldDirectory *directory, const char *key,
+								   uint32_t keyLength, bson_iter_t *iterator);
+bool PgbsonFieldDirectoryInitIteratorAtPath(PgbsonFieldDirectory *directory,
+											const char *path,
+											bson_iter_t *iterator);
+
 pgbson * CopyPgbsonIntoMemoryContext(const pgbson *document, MemoryContext context);
 
 pgbson * BsonValueToDocumentPgbson(const bson_value_t *value);
@@ -106,6 +169,7 @@ pgbson * PgbsonGetDocumentId(const pgbson *document);
 pgbson * PgbsonDeduplicateFields(const pgbson *document);
 List * PgbsonDecomposeFields(const pgbson *document);
 void PgbsonGetBsonValueAtPath(const pgbson *bson, const char *path, bson_value_t *value);
+pgbson * DatumGetPgBsonForPath(Datum documentDatum, const char *path);
 
 /*
  * Validate if the pgbson is an empty document.
@@ -17,6 +17,9 @@
 
 #include <datatype/timestamp.h>
 
+/* The size of the buffer held inline by a pgbson_writer before it needs an allocation */
+#define PGBSON_WRITER_INLINE_BUFFER_SIZE 120
+
 /* bson writer interface */
 typedef struct
 {
@@ -62,6 +65,7 @@ typedef struct pgbson_element_writer
 
 
 void PgbsonWriterInit(pgbson_writer *writer);
+void PgbsonWriterInitWithSizeHint(pgbson_writer *writer, uint32_t sizeHint);
 uint32_t PgbsonWriterGetSize(pgbson_writer *writer);
 uint32_t PgbsonArrayWriterGetSize(pgbson_array_writer *writer);
 void PgbsonWriterCopyToBuffer(pgbson_writer *writer, uint8_t *buffer, uint32_t length);
@@ -158,6 +162,8 @@ void PgbsonWriterConcat(pgbson_writer *writer, const pgbson *document);
 void PgbsonWriterConcatWriter(pgbson_writer *writer, pgbson_writer *writerToConcat);
 void PgbsonWriterConcatBytes(pgbson_writer *writer, const uint8_t *bsonBytes, uint32_t
 							 bsonBytesLength);
+void PgbsonWriterAppendRawElements(pgbson_writer *writer, const uint8_t *elementBytes,
+								   uint32_t elementBytesLength);
 
 uint32_t PgbsonArrayWriterGetIndex(pgbson_array_writer *arrayWriter);
 bool IsPgbsonWriterEmptyDocument(pgbson_writer *writer);
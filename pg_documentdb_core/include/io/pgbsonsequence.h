@@ -24,6 +24,26 @@ typedef struct
 #define PG_GETARG_MAYBE_NULL_PGBSON_SEQUENCE(n) PG_ARGISNULL(n) ? NULL : \
 	((pgbsonsequence *) PG_DETOAST_DATUM(PG_GETARG_DATUM(n)))
 
+/*
+ * An iterator over the documents of a bsonsequence that walks the
+ * sequence in place without materializing the documents.
+ */
+typedef struct PgbsonSequenceIterator
+{
+	/* The raw bytes of the sequence */
+	const uint8_t *data;
+
+	/* The total length of the sequence */
+	uint32_t dataSize;
+
+	/* The offset of the next document in the sequence */
+	uint32_t offset;
+} PgbsonSequenceIterator;
+
 List * PgbsonSequenceGetDocumentBsonValues(const pgbsonsequence *bsonSequence);
+void PgbsonSequenceIteratorInit(PgbsonSequenceIterator *iterator,
+								const pgbsonsequence *bsonSequence);
+bool PgbsonSequenceIteratorNext(PgbsonSequenceIterator *iterator,
+								bson_value_t *documentValue);
 
 #endif
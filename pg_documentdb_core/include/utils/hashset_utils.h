@@ -80,8 +80,10 @@ CreateExtensionHashCTL(Size keySize, Size entrySize,
 HTAB * CreatePgbsonElementHashSet(void);
 HTAB * CreateStringViewHashSet(void);
 HTAB * CreateBsonValueHashSet(void);
+HTAB * CreateBsonValueHashSetWithSize(long numElements);
 HTAB * CreatePgbsonElementOrderedHashSet(void);
 HTAB * CreateBsonValueWithCollationHashSet(int extraDataSize);
+HTAB * CreateBsonValueWithCollationHashSetWithSize(int extraDataSize, long numElements);
 
 bool InsertInToPgbsonElementOrderedHash(HTAB *hashTable,
 										PgbsonElementHashEntryOrdered *hashEntry,
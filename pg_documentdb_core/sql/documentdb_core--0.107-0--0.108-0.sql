@@ -1,2 +1,5 @@
 
-#include "udfs/bson_io/bson_io--0.108-0.sql"
\ No newline at end of file
+#include "udfs/bson_io/bson_io--0.108-0.sql"
+#include "udfs/bson_btree/bson_btree--0.108-0.sql"
+#include "schema/btree_opclass_members--0.108-0.sql"
+#include "udfs/collation/collation--0.108-0.sql"
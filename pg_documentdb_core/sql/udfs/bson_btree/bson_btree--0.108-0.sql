@@ -0,0 +1,6 @@
+-- sort support function for the bson btree operator class
+CREATE OR REPLACE FUNCTION __CORE_SCHEMA__.bson_btree_sortsupport(internal)
+ RETURNS void
+ LANGUAGE C
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_btree_sortsupport$function$;
@@ -60,3 +60,10 @@ CREATE OR REPLACE FUNCTION __CORE_SCHEMA__.bson_in_range_interval(__CORE_SCHEMA_
  LANGUAGE C
  IMMUTABLE PARALLEL SAFE STRICT
 AS 'MODULE_PATHNAME', $function$bson_in_range_interval$function$;
+
+-- sort support function for the bson btree operator class
+CREATE OR REPLACE FUNCTION __CORE_SCHEMA__.bson_btree_sortsupport(internal)
+ RETURNS void
+ LANGUAGE C
+ IMMUTABLE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_btree_sortsupport$function$;
@@ -0,0 +1,6 @@
+-- hit and miss counters of the backend's collator and collation sort key caches
+CREATE OR REPLACE FUNCTION __CORE_SCHEMA__.bson_collation_cache_stats()
+ RETURNS __CORE_SCHEMA__.bson
+ LANGUAGE C
+ VOLATILE PARALLEL SAFE STRICT
+AS 'MODULE_PATHNAME', $function$bson_collation_cache_stats$function$;
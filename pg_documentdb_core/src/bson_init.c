@@ -45,6 +45,34 @@ bool EnableCollation = DEFAULT_ENABLE_COLLATION;
 #define DEFAULT_SKIP_BSON_ARRAY_TRAVERSE_OPTIMIZATION false
 bool SkipBsonArrayTraverseOptimization = DEFAULT_SKIP_BSON_ARRAY_TRAVERSE_OPTIMIZATION;
 
+/* GUC deciding whether the single pass bson validator is used before libbson's validator */
+#define DEFAULT_ENABLE_FAST_BSON_VALIDATION true
+bool EnableFastBsonValidation = DEFAULT_ENABLE_FAST_BSON_VALIDATION;
+
+/* GUC deciding whether toasted documents are partially detoasted for single path lookups */
+#define DEFAULT_ENABLE_PARTIAL_DETOAST_FOR_PATH_LOOKUP false
+bool EnablePartialDetoastForPathLookup = DEFAULT_ENABLE_PARTIAL_DETOAST_FOR_PATH_LOOKUP;
+
+/* GUC deciding whether bson is serialized to json with the streaming serializer */
+#define DEFAULT_ENABLE_STREAMING_JSON_SERIALIZER false
+bool EnableStreamingJsonSerializer = DEFAULT_ENABLE_STREAMING_JSON_SERIALIZER;
+
+/* GUC deciding whether ANALYZE collects per path statistics for bson columns */
+#define DEFAULT_ENABLE_BSON_PATH_STATISTICS false
+bool EnableBsonPathStatistics = DEFAULT_ENABLE_BSON_PATH_STATISTICS;
+
+/* GUC deciding whether btree sorts on bson use abbreviated normalized keys */
+#define DEFAULT_ENABLE_BSON_ABBREVIATED_SORT_KEYS false
+bool EnableBsonAbbreviatedSortKeys = DEFAULT_ENABLE_BSON_ABBREVIATED_SORT_KEYS;
+
+/* GUC deciding whether in memory hash sets of bson values use the faster hash */
+#define DEFAULT_ENABLE_FAST_BSON_VALUE_HASH false
+bool EnableFastBsonValueHash = DEFAULT_ENABLE_FAST_BSON_VALUE_HASH;
+
+/* GUC deciding whether compiled regexes are cached across queries in a backend */
+#define DEFAULT_ENABLE_COMPILED_REGEX_CACHE false
+bool EnableCompiledRegexCache = DEFAULT_ENABLE_COMPILED_REGEX_CACHE;
+
 /* --------------------------------------------------------- */
 /* Top level exports */
 /* --------------------------------------------------------- */
@@ -91,6 +119,62 @@ InitDocumentDBCoreConfigurations(const char *prefix)
 		NULL, &SkipBsonArrayTraverseOptimization,
 		DEFAULT_SKIP_BSON_ARRAY_TRAVERSE_OPTIMIZATION,
 		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableFastBsonValidation", prefix),
+		gettext_noop(
+			"Determines whether input bson is validated with the single pass validator before falling back to libbson."),
+		NULL, &EnableFastBsonValidation,
+		DEFAULT_ENABLE_FAST_BSON_VALIDATION,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enablePartialDetoastForPathLookup", prefix),
+		gettext_noop(
+			"Determines whether large toasted documents are only partially detoasted when evaluating a single path filter."),
+		NULL, &EnablePartialDetoastForPathLookup,
+		DEFAULT_ENABLE_PARTIAL_DETOAST_FOR_PATH_LOOKUP,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableStreamingJsonSerializer", prefix),
+		gettext_noop(
+			"Determines whether bson is converted to extended json with the streaming serializer."),
+		NULL, &EnableStreamingJsonSerializer,
+		DEFAULT_ENABLE_STREAMING_JSON_SERIALIZER,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBsonPathStatistics", prefix),
+		gettext_noop(
+			"Determines whether ANALYZE collects per path statistics on bson columns and whether the planner uses them."),
+		NULL, &EnableBsonPathStatistics,
+		DEFAULT_ENABLE_BSON_PATH_STATISTICS,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableBsonAbbreviatedSortKeys", prefix),
+		gettext_noop(
+			"Determines whether sorts and btree index builds on bson use abbreviated normalized keys."),
+		NULL, &EnableBsonAbbreviatedSortKeys,
+		DEFAULT_ENABLE_BSON_ABBREVIATED_SORT_KEYS,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableFastBsonValueHash", prefix),
+		gettext_noop(
+			"Determines whether in memory hash sets of bson values use the faster non persisted hash."),
+		NULL, &EnableFastBsonValueHash,
+		DEFAULT_ENABLE_FAST_BSON_VALUE_HASH,
+		PGC_USERSET, 0, NULL, NULL, NULL);
+
+	DefineCustomBoolVariable(
+		psprintf("%s.enableCompiledRegexCache", prefix),
+		gettext_noop(
+			"Determines whether compiled and JIT compiled regexes are cached across queries in a backend."),
+		NULL, &EnableCompiledRegexCache,
+		DEFAULT_ENABLE_COMPILED_REGEX_CACHE,
+		PGC_USERSET, 0, NULL, NULL, NULL);
 }
 
 
@@ -19,6 +19,8 @@
 #include <unicode/umachine.h>
 #include <utils/pg_locale.h>
 #include <common/hashfn.h>
+#include <lib/ilist.h>
+#include <fmgr.h>
 
 #include "io/bson_core.h"
 #include "lib/stringinfo.h"
@@ -28,12 +30,50 @@
 #define ALPHABET_SIZE 26
 #define DEFAULT_ICU_COLLATION_SORT_KEY_LENGTH 512
 
+/* The maximum number of collators kept open by a backend */
+#define COLLATOR_CACHE_MAX_ENTRIES 64
+
+/* The number of slots of the sort key cache, and the longest string it memoizes */
+#define SORT_KEY_CACHE_SLOTS 1024
+#define SORT_KEY_CACHE_MAX_STRING_LENGTH 128
+
 typedef struct
 {
-	unsigned long collationKey;
+	/* The ICU collation string, the hash key (must be first) */
+	char collationString[MAX_ICU_COLLATION_LENGTH];
+
 	UCollator *collator; /* locale_t struct, or 0 if not valid */
+
+	/* A backend unique id of the collator, used to validate sort key cache entries */
+	uint64 collatorId;
+
+	/* The position of the entry in the LRU list of collators */
+	dlist_node lruNode;
 } ucollator_cache_entry;
 
+/*
+ * A memoized collation sort key of a string. The sort key cache is a direct
+ * mapped table: a colliding string simply replaces the slot.
+ */
+typedef struct
+{
+	uint64 collatorId;
+	uint32 stringLength;
+	uint32 sortKeyLength;
+	char *string;
+	uint8_t *sortKey;
+} sort_key_cache_entry;
+
+/* Hit and miss counters of the collator and sort key caches */
+typedef struct
+{
+	int64 collatorHits;
+	int64 collatorMisses;
+	int64 collatorEvictions;
+	int64 sortKeyHits;
+	int64 sortKeyMisses;
+} collation_cache_stats;
+
 
 static UConverter *icu_converter = NULL;
 
@@ -242,7 +282,25 @@ char supported_locale_codes[ALPHABET_SIZE][ALPHABET_SIZE] = {
 
 static HTAB *collation_cache = NULL;
 
+/* The collators in least recently used order: the head is the most recently used */
+static dlist_head collation_cache_lru = DLIST_STATIC_INIT(collation_cache_lru);
+
+/* The most recently used collator, checked before the hash table */
+static ucollator_cache_entry *last_collation_entry = NULL;
+
+static uint64 next_collator_id = 1;
+
+static MemoryContext sort_key_cache_context = NULL;
+static sort_key_cache_entry *sort_key_cache = NULL;
+
+static collation_cache_stats CollationCacheStats = { 0 };
+
 static ucollator_cache_entry * LookupUCollatorCache(const char *collationString);
+static void EvictLeastRecentlyUsedCollator(void);
+static sort_key_cache_entry * LookupSortKeyCache(const ucollator_cache_entry *
+												 collationEntry,
+												 const char *key, int keyLength,
+												 bool *found);
 static void GenerateICULocaleAndExtractCollationOption(char *inputLocale, char **locale,
 													   char **collationOptionString);
 
@@ -253,6 +311,8 @@ inline static bool CheckIfValidLocale(const char *locale);
 inline static void ThrowInvalidLocaleError(const char *locale);
 static int32_t icu_to_uchar_core(UChar **buff_uchar, const char *buff, size_t nbytes);
 
+PG_FUNCTION_INFO_V1(bson_collation_cache_stats);
+
 /*
  *  This takes a collation document and convert to postgres locale string
  *  e.g., en-u-ks-level1-kc-false-kf-upper-kn-false, and use that to perform
@@ -535,6 +595,15 @@ GetCollationSortKey(const char *collationString, char *key, int keyLength)
 {
 	ucollator_cache_entry *collation_entry = LookupUCollatorCache(collationString);
 
+	bool found = false;
+	sort_key_cache_entry *cachedSortKey = LookupSortKeyCache(collation_entry, key,
+															 keyLength, &found);
+	if (found)
+	{
+		return (char *) pnstrdup((const char *) cachedSortKey->sortKey,
+								 cachedSortKey->sortKeyLength);
+	}
+
 	uint8_t *sortKeyPtr = palloc(DEFAULT_ICU_COLLATION_SORT_KEY_LENGTH);
 	UChar *uchar;
 	int32_t ulen;
@@ -551,10 +620,57 @@ GetCollationSortKey(const char *collationString, char *key, int keyLength)
 	}
 
 	pfree(uchar);
+
+	if (cachedSortKey != NULL)
+	{
+		if (cachedSortKey->string != NULL)
+		{
+			pfree(cachedSortKey->string);
+			pfree(cachedSortKey->sortKey);
+		}
+
+		cachedSortKey->collatorId = collation_entry->collatorId;
+		cachedSortKey->stringLength = keyLength;
+		cachedSortKey->string = MemoryContextAlloc(sort_key_cache_context, keyLength);
+		memcpy(cachedSortKey->string, key, keyLength);
+
+		/* The sort key is null terminated, and the length excludes the terminator */
+		cachedSortKey->sortKeyLength = expectedLength - 1;
+		cachedSortKey->sortKey = MemoryContextAlloc(sort_key_cache_context,
+													expectedLength);
+		memcpy(cachedSortKey->sortKey, sortKeyPtr, expectedLength);
+	}
+
 	return (char *) sortKeyPtr;
 }
 
 
+/*
+ * Returns the hit and miss counters of the backend's collator and sort key caches
+ * as a bson document.
+ */
+Datum
+bson_collation_cache_stats(PG_FUNCTION_ARGS)
+{
+	pgbson_writer writer;
+	PgbsonWriterInit(&writer);
+	PgbsonWriterAppendInt64(&writer, "collatorHits", 12,
+							CollationCacheStats.collatorHits);
+	PgbsonWriterAppendInt64(&writer, "collatorMisses", 14,
+							CollationCacheStats.collatorMisses);
+	PgbsonWriterAppendInt64(&writer, "collatorEvictions", 17,
+							CollationCacheStats.collatorEvictions);
+	PgbsonWriterAppendInt32(&writer, "collatorEntries", 15,
+							collation_cache == NULL ? 0 :
+							(int32) hash_get_num_entries(collation_cache));
+	PgbsonWriterAppendInt64(&writer, "sortKeyHits", 11,
+							CollationCacheStats.sortKeyHits);
+	PgbsonWriterAppendInt64(&writer, "sortKeyMisses", 13,
+							CollationCacheStats.sortKeyMisses);
+	PG_RETURN_POINTER(PgbsonWriterGetPgbson(&writer));
+}
+
+
 /*
  *  Checks is a locale is supported, otherwise, throws error.
  */
@@ -857,27 +973,11 @@ CheckCollationInputParamType(bson_type_t expectedType, bson_type_t foundType, co
 }
 
 
-/*
- * Well known hash function to efficiently calculate hash of a string. While it may have collisions it's unlikely in our case
- * where the hash function is used to generate hash code for limited number of collation strings. Even if there is collision,
- * the functionality will not be broken, we will just generate a few more cache entries
- */
-static unsigned long
-djb2(const char *str)
-{
-	unsigned long hash = 5381;
-	int c;
-	while ((c = *str++))
-	{
-		hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-	}
-	return hash;
-}
-
-
 /*
  * Cache that live the lifetime of a backend process and caches a Ucollator object for performing
  * collation related operations. Open a collator object can be expensive and hence we create this cache.
+ * The cache holds up to COLLATOR_CACHE_MAX_ENTRIES collators keyed by the collation string, and
+ * closes the least recently used collator when it is full.
  * When the backend process dies all memory associated with the collator cache is cleaned up.
  *
  * This is inspired by lookup_collation_cache() in pg_locale.c
@@ -888,52 +988,148 @@ LookupUCollatorCache(const char *collationString)
 	ucollator_cache_entry *cache_entry;
 	bool found;
 
+	/* Most queries use a single collation: check the last one used first. */
+	if (last_collation_entry != NULL &&
+		strcmp(last_collation_entry->collationString, collationString) == 0)
+	{
+		CollationCacheStats.collatorHits++;
+		return last_collation_entry;
+	}
+
+	if (strlen(collationString) >= MAX_ICU_COLLATION_LENGTH)
+	{
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+						errmsg("Collation language tag exceeds the maximum length: %s",
+							   collationString)));
+	}
+
 	if (collation_cache == NULL)
 	{
 		/* First time through, initialize the hash table */
 		HASHCTL ctl;
 		memset(&ctl, 0, sizeof(ctl));
 
-		ctl.keysize = sizeof(char *);
+		ctl.keysize = MAX_ICU_COLLATION_LENGTH;
 		ctl.entrysize = sizeof(ucollator_cache_entry);
 
-		MemoryContext tempContext = AllocSetContextCreate(CurrentMemoryContext,
-														  "Collation Context",
-														  ALLOCSET_DEFAULT_SIZES);
+		collation_cache = hash_create("Collator cache", COLLATOR_CACHE_MAX_ENTRIES,
+									  &ctl, HASH_ELEM | HASH_STRINGS);
+	}
 
-		MemoryContext oldContext = MemoryContextSwitchTo(tempContext);
-		collation_cache = hash_create("Collator cache", 100, &ctl,
-									  HASH_ELEM | HASH_BLOBS);
-		MemoryContextSwitchTo(oldContext);
+	cache_entry = hash_search(collation_cache, collationString, HASH_FIND, &found);
+	if (found)
+	{
+		CollationCacheStats.collatorHits++;
+		dlist_move_head(&collation_cache_lru, &cache_entry->lruNode);
+		last_collation_entry = cache_entry;
+		return cache_entry;
 	}
 
-	unsigned long collationKey = djb2(collationString);
+	CollationCacheStats.collatorMisses++;
+	UErrorCode status = U_ZERO_ERROR;
+	UCollator *collator = ucol_open(collationString, &status);
 
-	cache_entry = hash_search(collation_cache, &collationKey, HASH_ENTER, &found);
-	if (!found)
+	if (U_FAILURE(status))
 	{
-		cache_entry->collationKey = collationKey;
-		UErrorCode status = U_ZERO_ERROR;
-		UCollator *collator = ucol_open(collationString, &status);
-
-		if (U_FAILURE(status))
-		{
-			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
-							errmsg(
-								"Collation is not supported by ICU for collation language tag: %s",
-								collationString),
-							errdetail_log(
-								"Collation is not supported by ICU for collation language tag: %s",
-								collationString)));
-		}
+		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+						errmsg(
+							"Collation is not supported by ICU for collation language tag: %s",
+							collationString),
+						errdetail_log(
+							"Collation is not supported by ICU for collation language tag: %s",
+							collationString)));
+	}
 
-		cache_entry->collator = collator;
+	if (hash_get_num_entries(collation_cache) >= COLLATOR_CACHE_MAX_ENTRIES)
+	{
+		EvictLeastRecentlyUsedCollator();
 	}
 
+	/* Only insert once the collator is open so that failures leave no entry behind */
+	cache_entry = hash_search(collation_cache, collationString, HASH_ENTER, &found);
+	cache_entry->collator = collator;
+	cache_entry->collatorId = next_collator_id++;
+	dlist_push_head(&collation_cache_lru, &cache_entry->lruNode);
+
+	last_collation_entry = cache_entry;
 	return cache_entry;
 }
 
 
+/*
+ * Closes and removes the least recently used collator from the cache.
+ * Sort keys memoized for it are invalidated by its collator id.
+ */
+static void
+EvictLeastRecentlyUsedCollator(void)
+{
+	if (dlist_is_empty(&collation_cache_lru))
+	{
+		return;
+	}
+
+	ucollator_cache_entry *evicted = dlist_tail_element(ucollator_cache_entry, lruNode,
+														&collation_cache_lru);
+	dlist_delete(&evicted->lruNode);
+	ucol_close(evicted->collator);
+
+	if (last_collation_entry == evicted)
+	{
+		last_collation_entry = NULL;
+	}
+
+	bool found;
+	hash_search(collation_cache, evicted->collationString, HASH_REMOVE, &found);
+	CollationCacheStats.collatorEvictions++;
+}
+
+
+/*
+ * Looks up the memoized sort key of the string for the collator. Sets found if
+ * the slot holds the sort key, otherwise returns the slot that the sort key should
+ * be stored in (or NULL if the string is too long to be memoized).
+ */
+static sort_key_cache_entry *
+LookupSortKeyCache(const ucollator_cache_entry *collationEntry, const char *key,
+				   int keyLength, bool *found)
+{
+	*found = false;
+	if (keyLength > SORT_KEY_CACHE_MAX_STRING_LENGTH)
+	{
+		CollationCacheStats.sortKeyMisses++;
+		return NULL;
+	}
+
+	if (sort_key_cache == NULL)
+	{
+		sort_key_cache_context = AllocSetContextCreate(TopMemoryContext,
+													   "Collation sort key cache",
+													   ALLOCSET_DEFAULT_SIZES);
+		sort_key_cache = MemoryContextAllocZero(sort_key_cache_context,
+												sizeof(sort_key_cache_entry) *
+												SORT_KEY_CACHE_SLOTS);
+	}
+
+	uint32 hash = hash_bytes_extended((const unsigned char *) key, keyLength,
+									  collationEntry->collatorId);
+	sort_key_cache_entry *entry = &sort_key_cache[hash % SORT_KEY_CACHE_SLOTS];
+	if (entry->string != NULL &&
+		entry->collatorId == collationEntry->collatorId &&
+		entry->stringLength == (uint32) keyLength &&
+		memcmp(entry->string, key, keyLength) == 0)
+	{
+		CollationCacheStats.sortKeyHits++;
+		*found = true;
+	}
+	else
+	{
+		CollationCacheStats.sortKeyMisses++;
+	}
+
+	return entry;
+}
+
+
 /*
  * For some collation we need to do additional processing to generate the language-tag-syntax locale from the input locale.
  * For example, en_US and en_US_POSIX needs to be converted to en-us and en-us-posix.
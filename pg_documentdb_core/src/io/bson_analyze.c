@@ -11,19 +11,550 @@
 
 #include <postgres.h>
 #include <fmgr.h>
+#include <miscadmin.h>
 #include <commands/vacuum.h>
+#include <common/hashfn.h>
+#include <utils/datum.h>
+#include <utils/hsearch.h>
+
+#include "io/bson_core.h"
+#include "io/bson_analyze.h"
+#include "query/bson_compare.h"
+#include "utils/hashset_utils.h"
+
+
+/* The max number of top level paths for which statistics are collected */
+#define BSON_ANALYZE_MAX_PATHS 16
+
+/* The number of candidate values tracked per path while sampling */
+#define BSON_ANALYZE_MAX_TRACKED_VALUES 32
+
+/* The max number of most common values stored per path */
+#define BSON_ANALYZE_MAX_MCV_PER_PATH 8
+
+/*
+ * Hash entry tracking how many sampled documents have a given top level path.
+ */
+typedef struct BsonPathCountEntry
+{
+	/* The path (key of the hash entry) - must be the first field */
+	StringView path;
+
+	/* The number of sampled documents that have the path */
+	int documentCount;
+
+	/* The index of the path in the collected statistics or -1 if not collected */
+	int statsIndex;
+} BsonPathCountEntry;
+
+/*
+ * A candidate most common value for a path.
+ */
+typedef struct BsonTrackedValue
+{
+	/* The value (points into valueDocument) */
+	bson_value_t value;
+
+	/* A copy of the value that outlives the sampled document */
+	pgbson *valueDocument;
+
+	/* The (approximate) number of sampled documents with the value */
+	int count;
+} BsonTrackedValue;
+
+/*
+ * The statistics collected for a single top level path.
+ */
+typedef struct BsonPathStatistics
+{
+	BsonPathCountEntry *pathEntry;
+
+	/* Whether any sampled document had an array at the path */
+	bool hasArrays;
+
+	/* Whether a tracked value ever had to be evicted */
+	bool hasEvictions;
+
+	int numTracked;
+
+	BsonTrackedValue tracked[BSON_ANALYZE_MAX_TRACKED_VALUES];
+} BsonPathStatistics;
+
+
+extern bool EnableBsonPathStatistics;
+
+/* The compute_stats function std_typanalyze picked for the column */
+static AnalyzeAttrComputeStatsFunc StdComputeStatsFunc = NULL;
+
+static void ComputeBsonPathStatistics(VacAttrStats *stats,
+									  AnalyzeAttrFetchFunc fetchfunc,
+									  int samplerows, double totalrows);
+static HTAB * CountTopLevelPaths(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfunc,
+								 int samplerows);
+static int SelectMostFrequentPaths(HTAB *pathCounts, BsonPathStatistics *pathStats);
+static void TrackPathValue(BsonPathStatistics *pathStats, const pgbsonelement *element);
+static void StorePathStatistics(VacAttrStats *stats, int slot,
+								BsonPathStatistics *pathStats, int numPaths,
+								int samplerows);
+static int CompareTrackedValueCountDesc(const void *left, const void *right);
+static uint32 BsonPathCountEntryHashFunc(const void *obj, size_t objsize);
+static int BsonPathCountEntryCompareFunc(const void *obj1, const void *obj2,
+										 Size objsize);
 
 PG_FUNCTION_INFO_V1(bson_typanalyze);
 
 
 /*
  * Implement type analyze for bson.
- * Right now thunks to the default - but in the future
- * will be extended to support more.
+ * The standard statistics are computed for the column and, if enabled,
+ * statistics for the most frequent top level paths of the sampled documents
+ * are added in an additional slot.
  */
 Datum
 bson_typanalyze(PG_FUNCTION_ARGS)
 {
 	VacAttrStats *stats = (VacAttrStats *) PG_GETARG_POINTER(0);
-	PG_RETURN_BOOL(std_typanalyze(stats));
+	if (!std_typanalyze(stats))
+	{
+		PG_RETURN_BOOL(false);
+	}
+
+	if (EnableBsonPathStatistics)
+	{
+		StdComputeStatsFunc = stats->compute_stats;
+		stats->compute_stats = ComputeBsonPathStatistics;
+	}
+
+	PG_RETURN_BOOL(true);
+}
+
+
+/*
+ * Parses an entry of the per path statistics slot (see bson_analyze.h).
+ */
+void
+ParseBsonPathStatisticsEntry(const pgbson *entryDocument,
+							 BsonPathStatisticsEntry *entry)
+{
+	memset(entry, 0, sizeof(BsonPathStatisticsEntry));
+	entry->isSummary = true;
+
+	bson_iter_t iter;
+	PgbsonInitIterator(entryDocument, &iter);
+	while (bson_iter_next(&iter))
+	{
+		const char *key = bson_iter_key(&iter);
+		switch (key[0])
+		{
+			case 'p':
+			{
+				entry->path.string = bson_iter_utf8(&iter, &entry->path.length);
+				break;
+			}
+
+			case 'v':
+			{
+				entry->isSummary = false;
+				entry->value = *bson_iter_value(&iter);
+				break;
+			}
+
+			case 'n':
+			{
+				entry->sampleRows = bson_iter_as_int64(&iter);
+				break;
+			}
+
+			case 'a':
+			{
+				entry->hasArrays = bson_iter_as_bool(&iter);
+				break;
+			}
+
+			case 'c':
+			{
+				entry->isComplete = bson_iter_as_bool(&iter);
+				break;
+			}
+
+			case 'd':
+			{
+				entry->trackedValues = (int32) bson_iter_as_int64(&iter);
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+	}
+}
+
+
+/* --------------------------------------------------------- */
+/* Private helper methods */
+/* --------------------------------------------------------- */
+
+/*
+ * The compute_stats callback for bson columns: Computes the standard
+ * statistics and then the per path statistics of the sample.
+ */
+static void
+ComputeBsonPathStatistics(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfunc,
+						  int samplerows, double totalrows)
+{
+	StdComputeStatsFunc(stats, fetchfunc, samplerows, totalrows);
+
+	if (!stats->stats_valid || samplerows <= 0)
+	{
+		return;
+	}
+
+	int slot = 0;
+	while (slot < STATISTIC_NUM_SLOTS && stats->stakind[slot] != 0)
+	{
+		slot++;
+	}
+
+	if (slot >= STATISTIC_NUM_SLOTS)
+	{
+		/* No free slot for the path statistics */
+		return;
+	}
+
+	/* First pass: find the most frequent top level paths */
+	HTAB *pathCounts = CountTopLevelPaths(stats, fetchfunc, samplerows);
+
+	BsonPathStatistics *pathStats = palloc0(sizeof(BsonPathStatistics) *
+											BSON_ANALYZE_MAX_PATHS);
+	int numPaths = SelectMostFrequentPaths(pathCounts, pathStats);
+	if (numPaths == 0)
+	{
+		hash_destroy(pathCounts);
+		return;
+	}
+
+	/* Second pass: track the most common values of those paths */
+	for (int i = 0; i < samplerows; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		bool isNull = false;
+		Datum value = fetchfunc(stats, i, &isNull);
+		if (isNull)
+		{
+			continue;
+		}
+
+		pgbson *document = DatumGetPgBson(value);
+
+		bson_iter_t iter;
+		PgbsonInitIterator(document, &iter);
+		while (bson_iter_next(&iter))
+		{
+			BsonPathCountEntry searchEntry = { 0 };
+			searchEntry.path.string = bson_iter_key(&iter);
+			searchEntry.path.length = bson_iter_key_len(&iter);
+
+			bool found = false;
+			BsonPathCountEntry *pathEntry = hash_search(pathCounts, &searchEntry,
+														HASH_FIND, &found);
+			if (!found || pathEntry->statsIndex < 0)
+			{
+				continue;
+			}
+
+			pgbsonelement element;
+			BsonIterToPgbsonElement(&iter, &element);
+			TrackPathValue(&pathStats[pathEntry->statsIndex], &element);
+		}
+
+		if ((Pointer) document != DatumGetPointer(value))
+		{
+			pfree(document);
+		}
+	}
+
+	StorePathStatistics(stats, slot, pathStats, numPaths, samplerows);
+	hash_destroy(pathCounts);
+}
+
+
+/*
+ * Counts the number of sampled documents that have each top level path.
+ */
+static HTAB *
+CountTopLevelPaths(VacAttrStats *stats, AnalyzeAttrFetchFunc fetchfunc,
+				   int samplerows)
+{
+	HASHCTL hashInfo = CreateExtensionHashCTL(
+		sizeof(StringView),
+		sizeof(BsonPathCountEntry),
+		BsonPathCountEntryCompareFunc,
+		BsonPathCountEntryHashFunc);
+	HTAB *pathCounts = hash_create("Bson Analyze Path Counts", 64, &hashInfo,
+								   DefaultExtensionHashFlags);
+
+	for (int i = 0; i < samplerows; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		bool isNull = false;
+		Datum value = fetchfunc(stats, i, &isNull);
+		if (isNull)
+		{
+			continue;
+		}
+
+		pgbson *document = DatumGetPgBson(value);
+
+		bson_iter_t iter;
+		PgbsonInitIterator(document, &iter);
+		while (bson_iter_next(&iter))
+		{
+			BsonPathCountEntry searchEntry = { 0 };
+			searchEntry.path.string = bson_iter_key(&iter);
+			searchEntry.path.length = bson_iter_key_len(&iter);
+
+			bool found = false;
+			BsonPathCountEntry *pathEntry = hash_search(pathCounts, &searchEntry,
+														HASH_ENTER, &found);
+			if (!found)
+			{
+				/* The key points into the document: Keep a copy instead */
+				pathEntry->path.string = pnstrdup(searchEntry.path.string,
+												  searchEntry.path.length);
+				pathEntry->documentCount = 0;
+				pathEntry->statsIndex = -1;
+			}
+
+			pathEntry->documentCount++;
+		}
+
+		if ((Pointer) document != DatumGetPointer(value))
+		{
+			pfree(document);
+		}
+	}
+
+	return pathCounts;
+}
+
+
+/*
+ * Picks the (up to BSON_ANALYZE_MAX_PATHS) top level paths present in the
+ * most sampled documents and initializes their statistics.
+ */
+static int
+SelectMostFrequentPaths(HTAB *pathCounts, BsonPathStatistics *pathStats)
+{
+	int numPaths = 0;
+
+	HASH_SEQ_STATUS seqStatus;
+	hash_seq_init(&seqStatus, pathCounts);
+
+	BsonPathCountEntry *pathEntry;
+	while ((pathEntry = hash_seq_search(&seqStatus)) != NULL)
+	{
+		if (numPaths < BSON_ANALYZE_MAX_PATHS)
+		{
+			pathStats[numPaths++].pathEntry = pathEntry;
+			continue;
+		}
+
+		/* Replace the least frequent selected path if this one is more frequent */
+		int minIndex = 0;
+		for (int i = 1; i < numPaths; i++)
+		{
+			if (pathStats[i].pathEntry->documentCount <
+				pathStats[minIndex].pathEntry->documentCount)
+			{
+				minIndex = i;
+			}
+		}
+
+		if (pathEntry->documentCount > pathStats[minIndex].pathEntry->documentCount)
+		{
+			pathStats[minIndex].pathEntry = pathEntry;
+		}
+	}
+
+	for (int i = 0; i < numPaths; i++)
+	{
+		pathStats[i].pathEntry->statsIndex = i;
+	}
+
+	return numPaths;
+}
+
+
+/*
+ * Tracks the value of a path in a sampled document. The candidate values are
+ * bounded per path: When a new value arrives and all candidates are taken, every
+ * candidate's count is decremented and those reaching zero are evicted (the
+ * Misra-Gries frequent items summary).
+ */
+static void
+TrackPathValue(BsonPathStatistics *pathStats, const pgbsonelement *element)
+{
+	bson_type_t valueType = element->bsonValue.value_type;
+	if (valueType == BSON_TYPE_ARRAY)
+	{
+		/* Equality on arrays matches elements: values can't be tracked as is */
+		pathStats->hasArrays = true;
+		return;
+	}
+
+	if (valueType == BSON_TYPE_DOCUMENT)
+	{
+		return;
+	}
+
+	for (int i = 0; i < pathStats->numTracked; i++)
+	{
+		if (BsonValueEquals(&pathStats->tracked[i].value, &element->bsonValue))
+		{
+			pathStats->tracked[i].count++;
+			return;
+		}
+	}
+
+	if (pathStats->numTracked < BSON_ANALYZE_MAX_TRACKED_VALUES)
+	{
+		BsonTrackedValue *tracked = &pathStats->tracked[pathStats->numTracked++];
+		pgbsonelement valueElement = *element;
+		tracked->valueDocument = PgbsonElementToPgbson(&valueElement);
+
+		pgbsonelement copiedElement;
+		PgbsonToSinglePgbsonElement(tracked->valueDocument, &copiedElement);
+		tracked->value = copiedElement.bsonValue;
+		tracked->count = 1;
+		return;
+	}
+
+	pathStats->hasEvictions = true;
+	int numRemaining = 0;
+	for (int i = 0; i < pathStats->numTracked; i++)
+	{
+		BsonTrackedValue *tracked = &pathStats->tracked[i];
+		tracked->count--;
+		if (tracked->count > 0)
+		{
+			pathStats->tracked[numRemaining++] = *tracked;
+		}
+		else
+		{
+			pfree(tracked->valueDocument);
+		}
+	}
+
+	pathStats->numTracked = numRemaining;
+}
+
+
+/*
+ * Writes the collected path statistics into the given slot of the column's
+ * statistics. The values must be allocated in the analyze context since
+ * they outlive the per column context.
+ */
+static void
+StorePathStatistics(VacAttrStats *stats, int slot, BsonPathStatistics *pathStats,
+					int numPaths, int samplerows)
+{
+	MemoryContext oldContext = MemoryContextSwitchTo(stats->anl_context);
+
+	int maxEntries = numPaths * (BSON_ANALYZE_MAX_MCV_PER_PATH + 1);
+	Datum *values = palloc(sizeof(Datum) * maxEntries);
+	float4 *numbers = palloc(sizeof(float4) * maxEntries);
+	int numEntries = 0;
+
+	for (int i = 0; i < numPaths; i++)
+	{
+		BsonPathStatistics *path = &pathStats[i];
+		StringView *pathName = &path->pathEntry->path;
+
+		qsort(path->tracked, path->numTracked, sizeof(BsonTrackedValue),
+			  CompareTrackedValueCountDesc);
+
+		/*
+		 * Values missing from the stored most common values are only known to have
+		 * been seen once if nothing was evicted and every value seen more than once
+		 * fits in the stored values.
+		 */
+		bool isComplete = !path->hasEvictions &&
+						  (path->numTracked <= BSON_ANALYZE_MAX_MCV_PER_PATH ||
+						   path->tracked[BSON_ANALYZE_MAX_MCV_PER_PATH].count < 2);
+
+		pgbson_writer writer;
+		PgbsonWriterInit(&writer);
+		PgbsonWriterAppendUtf8(&writer, "p", 1, pathName->string);
+		PgbsonWriterAppendInt64(&writer, "n", 1, samplerows);
+		PgbsonWriterAppendBool(&writer, "a", 1, path->hasArrays);
+		PgbsonWriterAppendBool(&writer, "c", 1, isComplete);
+		PgbsonWriterAppendInt32(&writer, "d", 1, path->numTracked);
+		values[numEntries] = PointerGetDatum(PgbsonWriterGetPgbson(&writer));
+		numbers[numEntries++] = (float4) path->pathEntry->documentCount / samplerows;
+
+		if (path->hasArrays)
+		{
+			continue;
+		}
+
+		for (int j = 0; j < path->numTracked && j < BSON_ANALYZE_MAX_MCV_PER_PATH; j++)
+		{
+			if (path->tracked[j].count < 2)
+			{
+				/* Values seen once are not common */
+				break;
+			}
+
+			PgbsonWriterInit(&writer);
+			PgbsonWriterAppendUtf8(&writer, "p", 1, pathName->string);
+			PgbsonWriterAppendValue(&writer, "v", 1, &path->tracked[j].value);
+			values[numEntries] = PointerGetDatum(PgbsonWriterGetPgbson(&writer));
+			numbers[numEntries++] = (float4) path->tracked[j].count / samplerows;
+		}
+	}
+
+	stats->stakind[slot] = BSON_STATISTIC_KIND_PATH_STATS;
+	stats->staop[slot] = InvalidOid;
+	stats->stacoll[slot] = InvalidOid;
+	stats->stanumbers[slot] = numbers;
+	stats->numnumbers[slot] = numEntries;
+	stats->stavalues[slot] = values;
+	stats->numvalues[slot] = numEntries;
+	stats->statypid[slot] = stats->attrtypid;
+	stats->statyplen[slot] = stats->attrtype->typlen;
+	stats->statypbyval[slot] = stats->attrtype->typbyval;
+	stats->statypalign[slot] = stats->attrtype->typalign;
+
+	MemoryContextSwitchTo(oldContext);
+}
+
+
+static int
+CompareTrackedValueCountDesc(const void *left, const void *right)
+{
+	const BsonTrackedValue *leftValue = left;
+	const BsonTrackedValue *rightValue = right;
+	return rightValue->count - leftValue->count;
+}
+
+
+static uint32
+BsonPathCountEntryHashFunc(const void *obj, size_t objsize)
+{
+	const BsonPathCountEntry *hashEntry = obj;
+	return hash_bytes((const unsigned char *) hashEntry->path.string,
+					  (int) hashEntry->path.length);
+}
+
+
+static int
+BsonPathCountEntryCompareFunc(const void *obj1, const void *obj2, Size objsize)
+{
+	const BsonPathCountEntry *hashEntry1 = obj1;
+	const BsonPathCountEntry *hashEntry2 = obj2;
+	return CompareStringView(&hashEntry1->path, &hashEntry2->path);
 }
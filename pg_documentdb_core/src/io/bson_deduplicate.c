@@ -17,9 +17,17 @@
 #include "utils/hashset_utils.h"
 
 
+/*
+ * The number of keys in a document below which duplicates are detected
+ * by comparing keys pairwise instead of through a hash set.
+ */
+#define DEDUPLICATE_LINEAR_SCAN_MAX_KEYS 16
+
 /*
  * Other helper functions.
  */
+static bool HasDuplicateFieldsInDocumentIter(bson_iter_t *documentIter);
+static bool HasDuplicateFieldsInArrayIter(bson_iter_t *arrayIter);
 static pgbson * PgbsonDeduplicateFieldsHandleDocumentIter(bson_iter_t *documentIter);
 static bson_value_t PgbsonDeduplicateFieldsRecurseArrayElements(bson_iter_t *arrayIter);
 
@@ -58,11 +66,136 @@ pgbson *
 PgbsonDeduplicateFields(const pgbson *document)
 {
 	bson_iter_t iter;
+	PgbsonInitIterator(document, &iter);
+	if (!HasDuplicateFieldsInDocumentIter(&iter))
+	{
+		/* Common case: Nothing to deduplicate, skip rebuilding the document */
+		return PgbsonCloneFromPgbson(document);
+	}
+
 	PgbsonInitIterator(document, &iter);
 	return PgbsonDeduplicateFieldsHandleDocumentIter(&iter);
 }
 
 
+/*
+ * HasDuplicateFieldsInDocumentIter returns true if the document (or any of
+ * its child documents) has a field that appears more than once. Keys of narrow
+ * documents are compared pairwise; a hash set is only built once the document
+ * has more than DEDUPLICATE_LINEAR_SCAN_MAX_KEYS keys.
+ */
+static bool
+HasDuplicateFieldsInDocumentIter(bson_iter_t *documentIter)
+{
+	check_stack_depth();
+
+	StringView keys[DEDUPLICATE_LINEAR_SCAN_MAX_KEYS];
+	int numKeys = 0;
+	HTAB *keySet = NULL;
+	bool hasDuplicates = false;
+
+	while (!hasDuplicates && bson_iter_next(documentIter))
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		StringView key = {
+			.string = bson_iter_key(documentIter),
+			.length = bson_iter_key_len(documentIter)
+		};
+
+		if (keySet == NULL && numKeys < DEDUPLICATE_LINEAR_SCAN_MAX_KEYS)
+		{
+			for (int i = 0; i < numKeys; i++)
+			{
+				if (StringViewEquals(&keys[i], &key))
+				{
+					hasDuplicates = true;
+					break;
+				}
+			}
+
+			keys[numKeys++] = key;
+		}
+		else
+		{
+			if (keySet == NULL)
+			{
+				/* Move the keys seen so far into a hash set */
+				keySet = CreateStringViewHashSet();
+				for (int i = 0; i < numKeys; i++)
+				{
+					hash_search(keySet, &keys[i], HASH_ENTER, NULL);
+				}
+			}
+
+			bool found = false;
+			hash_search(keySet, &key, HASH_ENTER, &found);
+			hasDuplicates = found;
+		}
+
+		if (hasDuplicates)
+		{
+			break;
+		}
+
+		if (BSON_ITER_HOLDS_DOCUMENT(documentIter))
+		{
+			bson_iter_t innerDocumentIter;
+			bson_iter_recurse(documentIter, &innerDocumentIter);
+			hasDuplicates = HasDuplicateFieldsInDocumentIter(&innerDocumentIter);
+		}
+		else if (BSON_ITER_HOLDS_ARRAY(documentIter))
+		{
+			bson_iter_t arrayIter;
+			bson_iter_recurse(documentIter, &arrayIter);
+			hasDuplicates = HasDuplicateFieldsInArrayIter(&arrayIter);
+		}
+	}
+
+	if (keySet != NULL)
+	{
+		hash_destroy(keySet);
+	}
+
+	return hasDuplicates;
+}
+
+
+/*
+ * HasDuplicateFieldsInArrayIter returns true if any document nested
+ * in the array has a field that appears more than once.
+ */
+static bool
+HasDuplicateFieldsInArrayIter(bson_iter_t *arrayIter)
+{
+	check_stack_depth();
+
+	while (bson_iter_next(arrayIter))
+	{
+		if (BSON_ITER_HOLDS_DOCUMENT(arrayIter))
+		{
+			bson_iter_t documentIter;
+			bson_iter_recurse(arrayIter, &documentIter);
+			if (HasDuplicateFieldsInDocumentIter(&documentIter))
+			{
+				return true;
+			}
+		}
+		else if (BSON_ITER_HOLDS_ARRAY(arrayIter))
+		{
+			bson_iter_t innerArrayIter;
+			bson_iter_recurse(arrayIter, &innerArrayIter);
+			if (HasDuplicateFieldsInArrayIter(&innerArrayIter))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
 /*
  * PgbsonDeduplicateFieldsHandleDocumentIter is the helper function for
  * PgbsonDeduplicateFields that instead takes an iterator and so can be used
@@ -9,6 +9,8 @@
  */
 
 #include <postgres.h>
+#include <fmgr.h>
+#include <access/detoast.h>
 #include <utils/builtins.h>
 #include <lib/stringinfo.h>
 #include <utils/timestamp.h>
@@ -30,6 +32,21 @@ static pgbson * CreatePgbsonfromBson_t(bson_t *document, bool destroyDocument);
 
 static pgbson * CreatePgbsonfromBsonBytes(const uint8_t *rawbytes, uint32_t length);
 
+static bool TryFastValidateBsonBytes(const uint8_t *documentBytes,
+									 uint32_t documentBytesLength);
+static bool TryGetBsonElementLength(const uint8_t *elementBytes, uint32_t available,
+									uint32_t *elementLength);
+
+extern bool EnableFastBsonValidation;
+extern bool EnablePartialDetoastForPathLookup;
+extern bool EnableStreamingJsonSerializer;
+
+/* The size of the first slice fetched when partially detoasting a document */
+#define PGBSON_DETOAST_INITIAL_SLICE_SIZE 2048
+
+/* The max nesting depth tracked by the fast validator before deferring to libbson */
+#define FAST_VALIDATE_MAX_NESTING_DEPTH 128
+
 static const char *BsonHexPrefix = "BSONHEX";
 static const uint32_t BsonHexPrefixLength = 7;
 
@@ -452,6 +469,19 @@ PgbsonToCanonicalExtendedJson(const pgbson *bsonDocument)
 						errmsg("invalid input syntax for BSON")));
 	}
 
+	if (EnableStreamingJsonSerializer)
+	{
+		StringInfoData buffer;
+		initStringInfo(&buffer);
+		if (TryAppendPgbsonAsCanonicalExtendedJson(&buffer, bsonDocument))
+		{
+			return buffer.data;
+		}
+
+		/* Let libbson handle documents the streaming serializer can't */
+		pfree(buffer.data);
+	}
+
 	/* since bson strings are palloced - we can simply return the string created. */
 	return bson_as_canonical_extended_json(&bson, NULL);
 }
@@ -504,6 +534,17 @@ ValidateInputBsonBytes(const uint8_t *documentBytes,
 					   uint32_t documentBytesLength,
 					   bson_validate_flags_t validateFlag)
 {
+	/*
+	 * The fast validator only covers the structural checks of BSON_VALIDATE_NONE.
+	 * If it can't prove the document valid, libbson gives the final verdict
+	 * (and the error message).
+	 */
+	if (EnableFastBsonValidation && validateFlag == BSON_VALIDATE_NONE &&
+		TryFastValidateBsonBytes(documentBytes, documentBytesLength))
+	{
+		return;
+	}
+
 	bson_t bson;
 	if (!bson_init_static(&bson, documentBytes, documentBytesLength))
 	{
@@ -685,6 +726,94 @@ PgbsonInitIteratorAtPath(const pgbson *bson, const char *path, bson_iter_t *iter
 }
 
 
+/*
+ * Gets a pgbson from a (possibly toasted) datum for the purpose of evaluating a
+ * path on it. For compressed or out of line documents, only leading slices of the
+ * document are detoasted until the first top level field matching the first segment
+ * of the path is found. In that case the returned pgbson is a document that holds
+ * just that field: Path lookups on it have the same result as on the full document
+ * since they only ever consider the first matching top level field.
+ *
+ * If the field is not found in the leading slices (or the document is not toasted)
+ * the full document is detoasted and returned.
+ */
+pgbson *
+DatumGetPgBsonForPath(Datum documentDatum, const char *path)
+{
+	struct varlena *rawDocument = (struct varlena *) DatumGetPointer(documentDatum);
+	if (!EnablePartialDetoastForPathLookup ||
+		(!VARATT_IS_EXTERNAL_ONDISK(rawDocument) && !VARATT_IS_COMPRESSED(rawDocument)))
+	{
+		return DatumGetPgBson(documentDatum);
+	}
+
+	const char *dotKey = strchr(path, '.');
+	uint32_t keyLength = dotKey == NULL ? strlen(path) : (uint32_t) (dotKey - path);
+	Size documentSize = toast_raw_datum_size(documentDatum) - VARHDRSZ;
+	Size sliceSize = PGBSON_DETOAST_INITIAL_SLICE_SIZE;
+
+	while (sliceSize < documentSize)
+	{
+		struct varlena *slice = PG_DETOAST_DATUM_SLICE(documentDatum, 0, sliceSize);
+		const uint8_t *sliceBytes = (const uint8_t *) VARDATA(slice);
+		uint32_t sliceLength = VARSIZE(slice) - VARHDRSZ;
+
+		/* Skip the document length */
+		uint32_t offset = 4;
+		uint32_t elementLength = 0;
+		bool canContinueScan = true;
+		while (offset < sliceLength)
+		{
+			if (sliceBytes[offset] == BSON_TYPE_EOD ||
+				!TryGetBsonElementLength(sliceBytes + offset, sliceLength - offset,
+										 &elementLength))
+			{
+				/* Reached the end of the document or an element we can't size */
+				canContinueScan = false;
+				break;
+			}
+
+			if (elementLength > sliceLength - offset)
+			{
+				/* The element is not fully in this slice */
+				break;
+			}
+
+			const char *key = (const char *) sliceBytes + offset + 1;
+			if (strncmp(key, path, keyLength) == 0 && key[keyLength] == '\0')
+			{
+				/* Build a document holding just this field */
+				uint32_t bsonLength = 4 + elementLength + 1;
+				pgbson *fieldDocument = palloc(bsonLength + VARHDRSZ);
+				SET_VARSIZE(fieldDocument, bsonLength + VARHDRSZ);
+
+				uint32_t bsonLengthLittleEndian = BSON_UINT32_TO_LE(bsonLength);
+				uint8_t *fieldDocumentBytes = (uint8_t *) VARDATA(fieldDocument);
+				memcpy(fieldDocumentBytes, &bsonLengthLittleEndian, sizeof(uint32_t));
+				memcpy(fieldDocumentBytes + 4, sliceBytes + offset, elementLength);
+				fieldDocumentBytes[bsonLength - 1] = '\0';
+
+				pfree(slice);
+				return fieldDocument;
+			}
+
+			offset += elementLength;
+		}
+
+		pfree(slice);
+
+		if (!canContinueScan)
+		{
+			break;
+		}
+
+		sliceSize *= 4;
+	}
+
+	return DatumGetPgBson(documentDatum);
+}
+
+
 /*
  * Initializes the iterator from a pgbson at given path and sets the bson_value_t
  * struct found at the path
@@ -758,6 +887,34 @@ PgbsonWriterInit(pgbson_writer *writer)
 }
 
 
+/*
+ * Initializes a bson writer so that it's ready to write data, with a buffer
+ * that can hold at least sizeHint bytes without having to grow.
+ * This avoids the repeated buffer growth (and copies) when the caller knows
+ * roughly how large the output will be (e.g. the size of the source document
+ * for an update). A hint smaller than the inline buffer is ignored.
+ */
+void
+PgbsonWriterInitWithSizeHint(pgbson_writer *writer, uint32_t sizeHint)
+{
+	bson_init(&(writer->innerBson));
+
+	if (sizeHint <= PGBSON_WRITER_INLINE_BUFFER_SIZE || sizeHint > BSON_MAX_SIZE)
+	{
+		return;
+	}
+
+	/*
+	 * bson_reserve_buffer grows the buffer and sets the length to the reserved
+	 * size: reinit leaves the buffer allocated and resets it to an empty document.
+	 */
+	if (bson_reserve_buffer(&(writer->innerBson), sizeHint) != NULL)
+	{
+		bson_reinit(&(writer->innerBson));
+	}
+}
+
+
 /*
  * Initializes a bson writer on the heap using bson_new() so that it's ready to write data
  *
@@ -1556,6 +1713,32 @@ PgbsonWriterConcatBytes(pgbson_writer *writer, const uint8_t *bsonBytes, uint32_
 }
 
 
+/*
+ * Appends a contiguous range of serialized elements (e.g. a run of fields of
+ * another document, keys included) to the writer as is.
+ */
+void
+PgbsonWriterAppendRawElements(pgbson_writer *writer, const uint8_t *elementBytes,
+							  uint32_t elementBytesLength)
+{
+	if (elementBytesLength == 0)
+	{
+		return;
+	}
+
+	/* bson_concat needs a well formed document: frame the elements with a header and trailer */
+	uint32_t documentLength = elementBytesLength + 5;
+	uint8_t *documentBytes = palloc(documentLength);
+	uint32_t documentLengthLE = BSON_UINT32_TO_LE(documentLength);
+	memcpy(documentBytes, &documentLengthLE, sizeof(uint32_t));
+	memcpy(documentBytes + 4, elementBytes, elementBytesLength);
+	documentBytes[documentLength - 1] = 0;
+
+	PgbsonWriterConcatBytes(writer, documentBytes, documentLength);
+	pfree(documentBytes);
+}
+
+
 /*
  * Initializes an elementwriter to write to the current index of an array.
  */
@@ -1877,3 +2060,319 @@ IsPgbsonHeapWriterEmptyDocument(pgbson_heap_writer *writer)
 {
 	return writer != NULL && PgbsonHeapWriterGetSize(writer) < 6;
 }
+
+
+/*
+ * Computes the length of the bson element (type byte, key and value) starting
+ * at elementBytes, given that only available bytes can be read. If the element
+ * extends past the available bytes, the length returned is larger than available.
+ * Returns false if the element's type is not one whose size can be determined
+ * cheaply (or the element is malformed).
+ */
+static bool
+TryGetBsonElementLength(const uint8_t *elementBytes, uint32_t available,
+						uint32_t *elementLength)
+{
+	const uint8_t *keyEnd = available < 2 ? NULL :
+							memchr(elementBytes + 1, '\0', available - 1);
+	if (keyEnd == NULL)
+	{
+		*elementLength = available + 1;
+		return true;
+	}
+
+	uint32_t headerLength = (uint32_t) (keyEnd - elementBytes) + 1;
+	uint32_t remaining = available - headerLength;
+	const uint8_t *valueBytes = elementBytes + headerLength;
+	uint32_t valueLength;
+	int32_t length;
+	switch ((bson_type_t) elementBytes[0])
+	{
+		case BSON_TYPE_UNDEFINED:
+		case BSON_TYPE_NULL:
+		case BSON_TYPE_MINKEY:
+		case BSON_TYPE_MAXKEY:
+		{
+			valueLength = 0;
+			break;
+		}
+
+		case BSON_TYPE_BOOL:
+		{
+			valueLength = 1;
+			break;
+		}
+
+		case BSON_TYPE_INT32:
+		{
+			valueLength = 4;
+			break;
+		}
+
+		case BSON_TYPE_DOUBLE:
+		case BSON_TYPE_DATE_TIME:
+		case BSON_TYPE_TIMESTAMP:
+		case BSON_TYPE_INT64:
+		{
+			valueLength = 8;
+			break;
+		}
+
+		case BSON_TYPE_OID:
+		{
+			valueLength = 12;
+			break;
+		}
+
+		case BSON_TYPE_DECIMAL128:
+		{
+			valueLength = 16;
+			break;
+		}
+
+		case BSON_TYPE_UTF8:
+		case BSON_TYPE_CODE:
+		case BSON_TYPE_SYMBOL:
+		case BSON_TYPE_BINARY:
+		case BSON_TYPE_DOCUMENT:
+		case BSON_TYPE_ARRAY:
+		{
+			if (remaining < 4)
+			{
+				*elementLength = available + 1;
+				return true;
+			}
+
+			memcpy(&length, valueBytes, sizeof(int32_t));
+			length = BSON_UINT32_FROM_LE(length);
+			if (length < 0)
+			{
+				return false;
+			}
+
+			if (elementBytes[0] == BSON_TYPE_DOCUMENT ||
+				elementBytes[0] == BSON_TYPE_ARRAY)
+			{
+				/* Nested documents include their own length prefix */
+				valueLength = length;
+			}
+			else if (elementBytes[0] == BSON_TYPE_BINARY)
+			{
+				/* length prefix and subtype */
+				valueLength = 5 + (uint32_t) length;
+			}
+			else
+			{
+				valueLength = 4 + (uint32_t) length;
+			}
+
+			break;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+
+	*elementLength = headerLength + valueLength;
+	return true;
+}
+
+
+/*
+ * Performs a single pass, non-recursive structural validation of the bson
+ * bytes equivalent to bson_validate with BSON_VALIDATE_NONE: Lengths and
+ * terminators of every (nested) document, string and binary are checked against
+ * the enclosing buffer. Keys are scanned with memchr which is vectorized by libc.
+ *
+ * Returns true only if the document is known to be valid. Returns false if the
+ * document is invalid *or* it holds types this validator does not handle (e.g.
+ * regex, code with scope, deprecated binary) in which case the caller must fall
+ * back to the libbson validator.
+ */
+static bool
+TryFastValidateBsonBytes(const uint8_t *documentBytes, uint32_t documentBytesLength)
+{
+	/* The end offset (exclusive) of each document being walked */
+	uint32_t documentEnd[FAST_VALIDATE_MAX_NESTING_DEPTH];
+	int depth = 0;
+	int32_t length;
+
+	if (documentBytesLength < 5 || documentBytesLength > INT32_MAX)
+	{
+		return false;
+	}
+
+	memcpy(&length, documentBytes, sizeof(int32_t));
+	length = BSON_UINT32_FROM_LE(length);
+	if ((uint32_t) length != documentBytesLength ||
+		documentBytes[documentBytesLength - 1] != '\0')
+	{
+		return false;
+	}
+
+	documentEnd[0] = documentBytesLength;
+	uint32_t offset = 4;
+	while (true)
+	{
+		/* offset always points at a type byte within the current document */
+		uint8_t type = documentBytes[offset];
+		if (type == BSON_TYPE_EOD)
+		{
+			/* The terminator must be the very last byte of the document */
+			if (offset + 1 != documentEnd[depth])
+			{
+				return false;
+			}
+
+			offset++;
+			if (depth == 0)
+			{
+				return true;
+			}
+
+			depth--;
+			continue;
+		}
+
+		/* The last byte of a document is its terminator so there is always room for the key */
+		uint32_t limit = documentEnd[depth] - 1;
+		const uint8_t *keyStart = documentBytes + offset + 1;
+		const uint8_t *keyEnd = memchr(keyStart, '\0', limit - (offset + 1));
+		if (keyEnd == NULL)
+		{
+			return false;
+		}
+
+		offset = (uint32_t) (keyEnd - documentBytes) + 1;
+		uint32_t remaining = limit - offset;
+		uint32_t valueLength;
+		switch ((bson_type_t) type)
+		{
+			case BSON_TYPE_UNDEFINED:
+			case BSON_TYPE_NULL:
+			case BSON_TYPE_MINKEY:
+			case BSON_TYPE_MAXKEY:
+			{
+				valueLength = 0;
+				break;
+			}
+
+			case BSON_TYPE_BOOL:
+			{
+				if (remaining < 1 || documentBytes[offset] > 1)
+				{
+					return false;
+				}
+
+				valueLength = 1;
+				break;
+			}
+
+			case BSON_TYPE_INT32:
+			{
+				valueLength = 4;
+				break;
+			}
+
+			case BSON_TYPE_DOUBLE:
+			case BSON_TYPE_DATE_TIME:
+			case BSON_TYPE_TIMESTAMP:
+			case BSON_TYPE_INT64:
+			{
+				valueLength = 8;
+				break;
+			}
+
+			case BSON_TYPE_OID:
+			{
+				valueLength = 12;
+				break;
+			}
+
+			case BSON_TYPE_DECIMAL128:
+			{
+				valueLength = 16;
+				break;
+			}
+
+			case BSON_TYPE_UTF8:
+			case BSON_TYPE_CODE:
+			case BSON_TYPE_SYMBOL:
+			{
+				if (remaining < 5)
+				{
+					return false;
+				}
+
+				memcpy(&length, documentBytes + offset, sizeof(int32_t));
+				length = BSON_UINT32_FROM_LE(length);
+				if (length < 1 || (uint32_t) length > remaining - 4 ||
+					documentBytes[offset + 4 + length - 1] != '\0')
+				{
+					return false;
+				}
+
+				valueLength = 4 + length;
+				break;
+			}
+
+			case BSON_TYPE_BINARY:
+			{
+				if (remaining < 5)
+				{
+					return false;
+				}
+
+				memcpy(&length, documentBytes + offset, sizeof(int32_t));
+				length = BSON_UINT32_FROM_LE(length);
+				if (length < 0 || (uint32_t) length > remaining - 5 ||
+					documentBytes[offset + 4] == BSON_SUBTYPE_BINARY_DEPRECATED)
+				{
+					return false;
+				}
+
+				valueLength = 5 + length;
+				break;
+			}
+
+			case BSON_TYPE_DOCUMENT:
+			case BSON_TYPE_ARRAY:
+			{
+				if (remaining < 5)
+				{
+					return false;
+				}
+
+				memcpy(&length, documentBytes + offset, sizeof(int32_t));
+				length = BSON_UINT32_FROM_LE(length);
+				if (length < 5 || (uint32_t) length > remaining ||
+					documentBytes[offset + length - 1] != '\0' ||
+					depth + 1 >= FAST_VALIDATE_MAX_NESTING_DEPTH)
+				{
+					return false;
+				}
+
+				/* Descend into the nested document: its end is where the parent resumes */
+				depth++;
+				documentEnd[depth] = offset + length;
+				offset += 4;
+				continue;
+			}
+
+			default:
+			{
+				/* Not handled here: defer to libbson */
+				return false;
+			}
+		}
+
+		if (valueLength > remaining)
+		{
+			return false;
+		}
+
+		offset += valueLength;
+	}
+}
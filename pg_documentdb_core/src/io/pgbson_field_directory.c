@@ -0,0 +1,211 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/io/pgbson_field_directory.c
+ *
+ * Implementation of a lazily built per-document field offset directory.
+ * The directory records the byte offset of each top level field as the
+ * document is scanned so that repeated path lookups on the same document
+ * do not re-walk the document from the first key.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+
+#include "io/bson_core.h"
+#include "utils/documentdb_errors.h"
+
+
+static bool FindFieldInDirectoryEntries(PgbsonFieldDirectory *directory,
+										const char *key, uint32_t keyLength,
+										bson_iter_t *iterator);
+static void AddFieldDirectoryEntry(PgbsonFieldDirectory *directory,
+								   const bson_iter_t *iterator);
+
+
+/*
+ * Initializes a field directory for the given document. The directory
+ * is built lazily: no part of the document is scanned until the first
+ * lookup is performed.
+ */
+void
+PgbsonFieldDirectoryInit(PgbsonFieldDirectory *directory, const pgbson *document)
+{
+	memset(directory, 0, sizeof(PgbsonFieldDirectory));
+	directory->document = document;
+	directory->entries = directory->inlineEntries;
+	directory->maxEntries = PGBSON_FIELD_DIRECTORY_INLINE_ENTRIES;
+}
+
+
+/*
+ * Releases any memory allocated by the directory beyond the inline
+ * entries. The directory can no longer be used after this call.
+ */
+void
+PgbsonFieldDirectoryFree(PgbsonFieldDirectory *directory)
+{
+	if (directory->entries != directory->inlineEntries)
+	{
+		pfree(directory->entries);
+	}
+
+	directory->entries = NULL;
+	directory->numEntries = 0;
+	directory->maxEntries = 0;
+}
+
+
+/*
+ * Positions the iterator at the first top level field of the document that
+ * matches the given key. Fields that were already visited by a prior lookup
+ * are resolved from the directory; otherwise the scan resumes from where the
+ * last lookup stopped, recording every field it passes.
+ *
+ * This has the same semantics as bson_iter_find_w_len on a freshly initialized
+ * document iterator: the first field with the matching key wins.
+ */
+bool
+PgbsonFieldDirectoryFindField(PgbsonFieldDirectory *directory, const char *key,
+							  uint32_t keyLength, bson_iter_t *iterator)
+{
+	if (FindFieldInDirectoryEntries(directory, key, keyLength, iterator))
+	{
+		return true;
+	}
+
+	if (directory->isComplete)
+	{
+		return false;
+	}
+
+	if (!directory->isScanStarted)
+	{
+		PgbsonInitIterator(directory->document, &directory->scanIterator);
+		directory->isScanStarted = true;
+	}
+
+	while (bson_iter_next(&directory->scanIterator))
+	{
+		AddFieldDirectoryEntry(directory, &directory->scanIterator);
+
+		if (bson_iter_key_len(&directory->scanIterator) == keyLength &&
+			memcmp(bson_iter_key(&directory->scanIterator), key, keyLength) == 0)
+		{
+			*iterator = directory->scanIterator;
+			return true;
+		}
+	}
+
+	directory->isComplete = true;
+	return false;
+}
+
+
+/*
+ * Initializes a bson iterator for the document in the directory at a
+ * specified dot-notation path. The top level field is resolved through the
+ * directory and the remainder of the path is walked the same way as
+ * bson_iter_find_descendant. If the path does not exist, returns false.
+ */
+bool
+PgbsonFieldDirectoryInitIteratorAtPath(PgbsonFieldDirectory *directory,
+									   const char *path, bson_iter_t *iterator)
+{
+	const char *dotKey = strchr(path, '.');
+	uint32_t keyLength = dotKey == NULL ? strlen(path) : (uint32_t) (dotKey - path);
+
+	bson_iter_t fieldIterator;
+	if (!PgbsonFieldDirectoryFindField(directory, path, keyLength, &fieldIterator))
+	{
+		return false;
+	}
+
+	if (dotKey == NULL)
+	{
+		*iterator = fieldIterator;
+		return true;
+	}
+
+	bson_iter_t childIterator;
+	if ((BSON_ITER_HOLDS_DOCUMENT(&fieldIterator) ||
+		 BSON_ITER_HOLDS_ARRAY(&fieldIterator)) &&
+		bson_iter_recurse(&fieldIterator, &childIterator))
+	{
+		return bson_iter_find_descendant(&childIterator, dotKey + 1, iterator);
+	}
+
+	return false;
+}
+
+
+/* --------------------------------------------------------- */
+/* Private helper methods */
+/* --------------------------------------------------------- */
+
+/*
+ * Looks up the key in the fields already recorded in the directory and on
+ * success re-positions the iterator at the recorded offset.
+ */
+static bool
+FindFieldInDirectoryEntries(PgbsonFieldDirectory *directory, const char *key,
+							uint32_t keyLength, bson_iter_t *iterator)
+{
+	for (int i = 0; i < directory->numEntries; i++)
+	{
+		PgbsonFieldDirectoryEntry *entry = &directory->entries[i];
+		if (entry->keyLength != keyLength ||
+			memcmp(entry->key, key, keyLength) != 0)
+		{
+			continue;
+		}
+
+		if (!bson_iter_init_from_data_at_offset(iterator,
+												(const uint8_t *) VARDATA_ANY(
+													directory->document),
+												VARSIZE_ANY_EXHDR(directory->document),
+												entry->offset, entry->keyLength))
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_INTERNALERROR),
+							errmsg("invalid offset in bson field directory")));
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * Records the field the iterator is currently positioned on, growing the
+ * entries array once the inline entries are exhausted.
+ */
+static void
+AddFieldDirectoryEntry(PgbsonFieldDirectory *directory, const bson_iter_t *iterator)
+{
+	if (directory->numEntries >= directory->maxEntries)
+	{
+		int newMaxEntries = directory->maxEntries * 2;
+		if (directory->entries == directory->inlineEntries)
+		{
+			directory->entries = palloc(sizeof(PgbsonFieldDirectoryEntry) *
+										newMaxEntries);
+			memcpy(directory->entries, directory->inlineEntries,
+				   sizeof(PgbsonFieldDirectoryEntry) * directory->numEntries);
+		}
+		else
+		{
+			directory->entries = repalloc(directory->entries,
+										  sizeof(PgbsonFieldDirectoryEntry) *
+										  newMaxEntries);
+		}
+
+		directory->maxEntries = newMaxEntries;
+	}
+
+	PgbsonFieldDirectoryEntry *entry = &directory->entries[directory->numEntries++];
+	entry->key = bson_iter_key(iterator);
+	entry->keyLength = bson_iter_key_len(iterator);
+	entry->offset = bson_iter_offset((bson_iter_t *) iterator);
+}
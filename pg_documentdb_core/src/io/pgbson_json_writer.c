@@ -0,0 +1,348 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/io/pgbson_json_writer.c
+ *
+ * Implementation of a streaming canonical extended json serializer for pgbson.
+ * The serializer walks the document once and appends directly into a StringInfo,
+ * producing the same output as libbson's bson_as_canonical_extended_json.
+ * Types that are rarely seen on hot paths are formatted by libbson itself.
+ *
+ *-------------------------------------------------------------------------
+ */
+#include <postgres.h>
+#include <miscadmin.h>
+#include <lib/stringinfo.h>
+
+#define PRIVATE_PGBSON_H
+#include "io/pgbson.h"
+#undef PRIVATE_PGBSON_H
+
+
+/*
+ * The prefix and suffix that libbson emits around a single element
+ * with an empty key: { "" : <value> }
+ */
+#define SINGLE_ELEMENT_JSON_PREFIX_LENGTH 7
+#define SINGLE_ELEMENT_JSON_SUFFIX_LENGTH 2
+
+static bool AppendDocumentAsCanonicalJson(StringInfo buffer, bson_iter_t *iter,
+										  bool isArray);
+static bool AppendValueAsCanonicalJson(StringInfo buffer, bson_iter_t *iter);
+static bool AppendEscapedJsonString(StringInfo buffer, const char *string,
+									uint32_t length);
+static bool AppendValueAsCanonicalJsonWithLibbson(StringInfo buffer,
+												  const bson_iter_t *iter);
+
+
+/*
+ * Appends the canonical extended json representation of the document to the
+ * buffer. Returns false if the document could not be serialized (e.g. invalid
+ * utf8 in a string) - in that case the contents appended to the buffer are
+ * unspecified and callers should fall back to libbson for the error semantics.
+ */
+bool
+TryAppendPgbsonAsCanonicalExtendedJson(StringInfo buffer, const pgbson *document)
+{
+	bson_iter_t iter;
+	if (!bson_iter_init_from_data(&iter, (const uint8_t *) VARDATA_ANY(document),
+								  VARSIZE_ANY_EXHDR(document)))
+	{
+		return false;
+	}
+
+	if (IsPgbsonEmptyDocument(document))
+	{
+		/* libbson special cases the top level empty document */
+		appendStringInfoString(buffer, "{ }");
+		return true;
+	}
+
+	return AppendDocumentAsCanonicalJson(buffer, &iter, false);
+}
+
+
+/* --------------------------------------------------------- */
+/* Private helper methods */
+/* --------------------------------------------------------- */
+
+/*
+ * Appends the elements yet to be visited by the iterator as a json
+ * document (or array).
+ */
+static bool
+AppendDocumentAsCanonicalJson(StringInfo buffer, bson_iter_t *iter, bool isArray)
+{
+	check_stack_depth();
+
+	appendStringInfoString(buffer, isArray ? "[ " : "{ ");
+
+	bool isFirst = true;
+	while (bson_iter_next(iter))
+	{
+		if (!isFirst)
+		{
+			appendBinaryStringInfo(buffer, ", ", 2);
+		}
+
+		isFirst = false;
+		if (!isArray)
+		{
+			appendStringInfoChar(buffer, '"');
+			if (!AppendEscapedJsonString(buffer, bson_iter_key(iter),
+										 bson_iter_key_len(iter)))
+			{
+				return false;
+			}
+
+			appendBinaryStringInfo(buffer, "\" : ", 4);
+		}
+
+		if (!AppendValueAsCanonicalJson(buffer, iter))
+		{
+			return false;
+		}
+	}
+
+	if (iter->err_off != 0)
+	{
+		/* The document is corrupt */
+		return false;
+	}
+
+	appendStringInfoString(buffer, isArray ? " ]" : " }");
+	return true;
+}
+
+
+/*
+ * Appends the value the iterator is positioned on as canonical extended json.
+ */
+static bool
+AppendValueAsCanonicalJson(StringInfo buffer, bson_iter_t *iter)
+{
+	switch (bson_iter_type(iter))
+	{
+		case BSON_TYPE_UTF8:
+		{
+			uint32_t length = 0;
+			const char *string = bson_iter_utf8(iter, &length);
+			appendStringInfoChar(buffer, '"');
+			if (!AppendEscapedJsonString(buffer, string, length))
+			{
+				return false;
+			}
+
+			appendStringInfoChar(buffer, '"');
+			return true;
+		}
+
+		case BSON_TYPE_INT32:
+		{
+			appendStringInfo(buffer, "{ \"$numberInt\" : \"%d\" }",
+							 bson_iter_int32(iter));
+			return true;
+		}
+
+		case BSON_TYPE_INT64:
+		{
+			appendStringInfo(buffer, "{ \"$numberLong\" : \"" INT64_FORMAT "\" }",
+							 (int64) bson_iter_int64(iter));
+			return true;
+		}
+
+		case BSON_TYPE_DOUBLE:
+		{
+			double value = bson_iter_double(iter);
+			appendBinaryStringInfo(buffer, "{ \"$numberDouble\" : \"", 21);
+			if (value != value)
+			{
+				appendStringInfoString(buffer, "NaN");
+			}
+			else if (value * 0 != 0)
+			{
+				appendStringInfoString(buffer, value > 0 ? "Infinity" : "-Infinity");
+			}
+			else
+			{
+				char doubleBuffer[64];
+				int length = snprintf(doubleBuffer, sizeof(doubleBuffer), "%.20g",
+									  value);
+				appendBinaryStringInfo(buffer, doubleBuffer, length);
+
+				/* ensure a trailing ".0" to distinguish "3" from "3.0" */
+				if (strspn(doubleBuffer, "0123456789-") == (size_t) length)
+				{
+					appendBinaryStringInfo(buffer, ".0", 2);
+				}
+			}
+
+			appendBinaryStringInfo(buffer, "\" }", 3);
+			return true;
+		}
+
+		case BSON_TYPE_BOOL:
+		{
+			appendStringInfoString(buffer, bson_iter_bool(iter) ? "true" : "false");
+			return true;
+		}
+
+		case BSON_TYPE_NULL:
+		{
+			appendBinaryStringInfo(buffer, "null", 4);
+			return true;
+		}
+
+		case BSON_TYPE_OID:
+		{
+			char oidString[25];
+			bson_oid_to_string(bson_iter_oid(iter), oidString);
+			appendStringInfo(buffer, "{ \"$oid\" : \"%s\" }", oidString);
+			return true;
+		}
+
+		case BSON_TYPE_DATE_TIME:
+		{
+			appendStringInfo(buffer,
+							 "{ \"$date\" : { \"$numberLong\" : \"" INT64_FORMAT
+							 "\" } }", (int64) bson_iter_date_time(iter));
+			return true;
+		}
+
+		case BSON_TYPE_DOCUMENT:
+		case BSON_TYPE_ARRAY:
+		{
+			bson_iter_t childIter;
+			if (!bson_iter_recurse(iter, &childIter))
+			{
+				return false;
+			}
+
+			return AppendDocumentAsCanonicalJson(buffer, &childIter,
+												 BSON_ITER_HOLDS_ARRAY(iter));
+		}
+
+		default:
+		{
+			return AppendValueAsCanonicalJsonWithLibbson(buffer, iter);
+		}
+	}
+}
+
+
+/*
+ * Appends the utf8 string escaped for json the same way as
+ * bson_utf8_escape_for_json. Runs of characters that do not need
+ * escaping are copied in bulk.
+ */
+static bool
+AppendEscapedJsonString(StringInfo buffer, const char *string, uint32_t length)
+{
+	if (!bson_utf8_validate(string, length, true))
+	{
+		return false;
+	}
+
+	const char *runStart = string;
+	const char *end = string + length;
+	for (const char *current = string; current < end; current++)
+	{
+		unsigned char character = (unsigned char) *current;
+		if (character >= ' ' && character != '"' && character != '\\')
+		{
+			continue;
+		}
+
+		appendBinaryStringInfo(buffer, runStart, current - runStart);
+		runStart = current + 1;
+
+		switch (character)
+		{
+			case '"':
+			{
+				appendBinaryStringInfo(buffer, "\\\"", 2);
+				break;
+			}
+
+			case '\\':
+			{
+				appendBinaryStringInfo(buffer, "\\\\", 2);
+				break;
+			}
+
+			case '\b':
+			{
+				appendBinaryStringInfo(buffer, "\\b", 2);
+				break;
+			}
+
+			case '\f':
+			{
+				appendBinaryStringInfo(buffer, "\\f", 2);
+				break;
+			}
+
+			case '\n':
+			{
+				appendBinaryStringInfo(buffer, "\\n", 2);
+				break;
+			}
+
+			case '\r':
+			{
+				appendBinaryStringInfo(buffer, "\\r", 2);
+				break;
+			}
+
+			case '\t':
+			{
+				appendBinaryStringInfo(buffer, "\\t", 2);
+				break;
+			}
+
+			default:
+			{
+				appendStringInfo(buffer, "\\u%04x", (unsigned int) character);
+				break;
+			}
+		}
+	}
+
+	appendBinaryStringInfo(buffer, runStart, end - runStart);
+	return true;
+}
+
+
+/*
+ * Formats the value the iterator is positioned on through libbson by
+ * serializing a single element document { "": <value> } and stripping
+ * the surrounding document.
+ */
+static bool
+AppendValueAsCanonicalJsonWithLibbson(StringInfo buffer, const bson_iter_t *iter)
+{
+	bson_t singleElementDocument;
+	bson_init(&singleElementDocument);
+	if (!bson_append_iter(&singleElementDocument, "", 0, iter))
+	{
+		bson_destroy(&singleElementDocument);
+		return false;
+	}
+
+	size_t jsonLength = 0;
+	char *json = bson_as_canonical_extended_json(&singleElementDocument, &jsonLength);
+	bson_destroy(&singleElementDocument);
+
+	if (json == NULL ||
+		jsonLength < SINGLE_ELEMENT_JSON_PREFIX_LENGTH +
+		SINGLE_ELEMENT_JSON_SUFFIX_LENGTH)
+	{
+		return false;
+	}
+
+	appendBinaryStringInfo(buffer, json + SINGLE_ELEMENT_JSON_PREFIX_LENGTH,
+						   jsonLength - SINGLE_ELEMENT_JSON_PREFIX_LENGTH -
+						   SINGLE_ELEMENT_JSON_SUFFIX_LENGTH);
+	bson_free(json);
+	return true;
+}
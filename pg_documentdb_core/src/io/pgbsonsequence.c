@@ -257,6 +257,53 @@ PgbsonSequenceGetDocumentBsonValues(const pgbsonsequence *bsonSequence)
 }
 
 
+/*
+ * Initializes an iterator over the documents stored in the bsonsequence.
+ * The iterator points into the sequence and must not outlive it.
+ */
+void
+PgbsonSequenceIteratorInit(PgbsonSequenceIterator *iterator,
+						   const pgbsonsequence *bsonSequence)
+{
+	iterator->data = (const uint8_t *) VARDATA_ANY(bsonSequence);
+	iterator->dataSize = VARSIZE_ANY_EXHDR(bsonSequence);
+	iterator->offset = 0;
+}
+
+
+/*
+ * Moves the iterator to the next document in the bsonsequence and sets
+ * documentValue to it. Returns false once the sequence is exhausted.
+ * Similar to bson_reader_read, a trailing document whose length does not
+ * fit the remaining bytes ends the sequence.
+ */
+bool
+PgbsonSequenceIteratorNext(PgbsonSequenceIterator *iterator,
+						   bson_value_t *documentValue)
+{
+	uint32_t remaining = iterator->dataSize - iterator->offset;
+	if (remaining < 5)
+	{
+		return false;
+	}
+
+	int32_t documentLength;
+	memcpy(&documentLength, iterator->data + iterator->offset, sizeof(int32_t));
+	documentLength = BSON_UINT32_FROM_LE(documentLength);
+	if (documentLength < 5 || (uint32_t) documentLength > remaining ||
+		iterator->data[iterator->offset + documentLength - 1] != '\0')
+	{
+		return false;
+	}
+
+	documentValue->value_type = BSON_TYPE_DOCUMENT;
+	documentValue->value.v_doc.data = (uint8_t *) (iterator->data + iterator->offset);
+	documentValue->value.v_doc.data_len = (uint32_t) documentLength;
+	iterator->offset += (uint32_t) documentLength;
+	return true;
+}
+
+
 /*
  * Checks whether the string representation of the bson sequence
  * is hex encoded or not.
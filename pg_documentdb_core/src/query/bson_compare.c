@@ -13,6 +13,9 @@
 #include <utils/array.h>
 #include <utils/builtins.h>
 #include <utils/timestamp.h>
+#include <utils/sortsupport.h>
+#include <lib/hyperloglog.h>
+#include <common/hashfn.h>
 #include <math.h>
 
 #include "io/bson_core.h"
@@ -29,6 +32,31 @@
 
 static const int64 MillisecondsInSecond = 1000;
 
+/*
+ * Layout of the abbreviated (normalized) sort key for a bson document.
+ * The key is compared as an unsigned integer and is laid out (from the most
+ * significant bit) as:
+ *   5 bits: sort order type of the first field + 1 (0 for the empty document)
+ *   1 bit: whether the first field has a non empty name
+ *   58 bits: a order preserving prefix of the first field's value (only for
+ *            the empty field name, which is what index and order by keys use)
+ */
+#define BSON_ABBREV_TYPE_SHIFT 59
+#define BSON_ABBREV_FIELD_NAME_SHIFT 58
+#define BSON_ABBREV_VALUE_BITS 58
+
+/* State tracked for an abbreviated sort of bson documents */
+typedef struct BsonSortSupportState
+{
+	/* The number of keys abbreviated so far */
+	int64 inputCount;
+
+	/* Estimator of the number of distinct abbreviated keys */
+	hyperLogLogState abbreviatedCardinality;
+} BsonSortSupportState;
+
+extern bool EnableBsonAbbreviatedSortKeys;
+
 /* --------------------------------------------------------- */
 /* Forward declaration */
 /* --------------------------------------------------------- */
@@ -43,6 +71,11 @@ static int CompareBsonValue(const bson_value_t *left, const bson_value_t *right,
 static double BsonValueAsDoubleCore(const bson_value_t *value, bool quiet);
 static bool IsBsonValue64BitIntegerCore(const bson_value_t *value, bool checkFixedInteger,
 										bool quantizeDoubleValue);
+static int BsonSortSupportCompare(Datum left, Datum right, SortSupport ssup);
+static int BsonSortSupportAbbreviatedCompare(Datum left, Datum right, SortSupport ssup);
+static Datum BsonSortSupportAbbreviate(Datum original, SortSupport ssup);
+static bool BsonSortSupportAbortAbbreviation(int memtupcount, SortSupport ssup);
+static uint64 GetBsonValueAbbreviatedPrefix(const bson_value_t *value);
 
 /* --------------------------------------------------------- */
 /* Top level exports */
@@ -58,6 +91,7 @@ PG_FUNCTION_INFO_V1(extension_bson_lte);
 PG_FUNCTION_INFO_V1(bson_unique_index_equal);
 PG_FUNCTION_INFO_V1(bson_in_range_interval);
 PG_FUNCTION_INFO_V1(bson_in_range_numeric);
+PG_FUNCTION_INFO_V1(bson_btree_sortsupport);
 
 Datum
 extension_bson_compare(PG_FUNCTION_ARGS)
@@ -288,6 +322,38 @@ bson_in_range_numeric(PG_FUNCTION_ARGS)
 }
 
 
+/*
+ * Sort support for bson_btree_ops: Sorts and btree index builds compare
+ * the documents with ComparePgbson and, with enableBsonAbbreviatedSortKeys,
+ * first compare their abbreviated keys (see BSON_ABBREV_TYPE_SHIFT).
+ */
+Datum
+bson_btree_sortsupport(PG_FUNCTION_ARGS)
+{
+	SortSupport ssup = (SortSupport) PG_GETARG_POINTER(0);
+
+	ssup->comparator = BsonSortSupportCompare;
+
+	/* The abbreviated keys need the full 64 bits of a Datum */
+	if (ssup->abbreviate && EnableBsonAbbreviatedSortKeys &&
+		SIZEOF_DATUM == sizeof(uint64))
+	{
+		MemoryContext oldContext = MemoryContextSwitchTo(ssup->ssup_cxt);
+		BsonSortSupportState *state = palloc0(sizeof(BsonSortSupportState));
+		initHyperLogLog(&state->abbreviatedCardinality, 10);
+		MemoryContextSwitchTo(oldContext);
+
+		ssup->ssup_extra = state;
+		ssup->abbrev_full_comparator = BsonSortSupportCompare;
+		ssup->comparator = BsonSortSupportAbbreviatedCompare;
+		ssup->abbrev_converter = BsonSortSupportAbbreviate;
+		ssup->abbrev_abort = BsonSortSupportAbortAbbreviation;
+	}
+
+	PG_RETURN_VOID();
+}
+
+
 /*
  * ComparePgbson compares 2 BSON objects.
  */
@@ -1029,6 +1095,209 @@ CompareSortOrderType(bson_type_t left, bson_type_t right)
 /* --------------------------------------------------------- */
 
 
+/*
+ * Full comparator for the bson btree sort support.
+ */
+static int
+BsonSortSupportCompare(Datum left, Datum right, SortSupport ssup)
+{
+	pgbson *leftBson = DatumGetPgBsonPacked(left);
+	pgbson *rightBson = DatumGetPgBsonPacked(right);
+
+	int compareResult = ComparePgbson(leftBson, rightBson);
+
+	if ((Pointer) leftBson != DatumGetPointer(left))
+	{
+		pfree(leftBson);
+	}
+
+	if ((Pointer) rightBson != DatumGetPointer(right))
+	{
+		pfree(rightBson);
+	}
+
+	return compareResult;
+}
+
+
+/*
+ * Compares two abbreviated bson keys: Since the keys are normalized, this is
+ * an unsigned integer comparison.
+ */
+static int
+BsonSortSupportAbbreviatedCompare(Datum left, Datum right, SortSupport ssup)
+{
+	uint64 leftKey = (uint64) left;
+	uint64 rightKey = (uint64) right;
+	return leftKey > rightKey ? 1 : (leftKey == rightKey ? 0 : -1);
+}
+
+
+/*
+ * Builds the normalized abbreviated key of a bson document
+ * (see BSON_ABBREV_TYPE_SHIFT for the layout).
+ */
+static Datum
+BsonSortSupportAbbreviate(Datum original, SortSupport ssup)
+{
+	BsonSortSupportState *state = (BsonSortSupportState *) ssup->ssup_extra;
+	pgbson *document = DatumGetPgBsonPacked(original);
+
+	uint64 abbreviatedKey = 0;
+	bson_iter_t documentIter;
+	PgbsonInitIterator(document, &documentIter);
+	if (bson_iter_next(&documentIter))
+	{
+		const bson_value_t *value = bson_iter_value(&documentIter);
+		uint64 sortOrderType = (uint64) GetSortOrderType(value->value_type) + 1;
+		abbreviatedKey = sortOrderType << BSON_ABBREV_TYPE_SHIFT;
+
+		if (bson_iter_key_len(&documentIter) > 0)
+		{
+			/* Values under different field names may not be ordered by the prefix */
+			abbreviatedKey |= UINT64CONST(1) << BSON_ABBREV_FIELD_NAME_SHIFT;
+		}
+		else
+		{
+			abbreviatedKey |= GetBsonValueAbbreviatedPrefix(value);
+		}
+	}
+
+	if ((Pointer) document != DatumGetPointer(original))
+	{
+		pfree(document);
+	}
+
+	state->inputCount++;
+	uint32 hash = DatumGetUInt32(hash_uint32((uint32) abbreviatedKey ^
+											 (uint32) (abbreviatedKey >> 32)));
+	addHyperLogLog(&state->abbreviatedCardinality, hash);
+
+	return (Datum) abbreviatedKey;
+}
+
+
+/*
+ * Aborts the abbreviation when the abbreviated keys are not distinct enough
+ * to pay for computing them (e.g. all documents are keyed on a nested document).
+ */
+static bool
+BsonSortSupportAbortAbbreviation(int memtupcount, SortSupport ssup)
+{
+	BsonSortSupportState *state = (BsonSortSupportState *) ssup->ssup_extra;
+
+	if (memtupcount < 10000 || state->inputCount < 10000)
+	{
+		return false;
+	}
+
+	double abbreviatedDistinct = estimateHyperLogLog(&state->abbreviatedCardinality);
+	if (abbreviatedDistinct < state->inputCount / 2000.0)
+	{
+		return true;
+	}
+
+	return false;
+}
+
+
+/*
+ * Returns the order preserving prefix of a bson value for the abbreviated
+ * sort key. The prefix must never order two values differently from
+ * CompareBsonValue: values that can't be ordered by a prefix return 0 and the
+ * comparison falls back to the full comparator on ties.
+ */
+static uint64
+GetBsonValueAbbreviatedPrefix(const bson_value_t *value)
+{
+	const int unusedBits = 64 - BSON_ABBREV_VALUE_BITS;
+	switch (value->value_type)
+	{
+		case BSON_TYPE_DOUBLE:
+		case BSON_TYPE_INT32:
+		case BSON_TYPE_INT64:
+		case BSON_TYPE_DECIMAL128:
+		{
+			/* Numbers of all types compare by value, so normalize them to doubles */
+			bool quiet = true;
+			double doubleValue = BsonValueAsDoubleCore(value, quiet);
+			if (isnan(doubleValue))
+			{
+				/* NaN sorts before all other numbers */
+				return 0;
+			}
+
+			if (doubleValue == 0)
+			{
+				/* -0.0 and 0.0 are equal */
+				doubleValue = 0;
+			}
+
+			uint64 doubleBits;
+			memcpy(&doubleBits, &doubleValue, sizeof(uint64));
+			doubleBits = (doubleBits & (UINT64CONST(1) << 63)) ?
+						 ~doubleBits : doubleBits | (UINT64CONST(1) << 63);
+			return doubleBits >> unusedBits;
+		}
+
+		case BSON_TYPE_UTF8:
+		case BSON_TYPE_SYMBOL:
+		case BSON_TYPE_OID:
+		{
+			/* memcmp ordered bytes: Use the first 7 bytes padded with zeros */
+			const uint8_t *bytes;
+			uint32_t length;
+			if (value->value_type == BSON_TYPE_UTF8)
+			{
+				bytes = (const uint8_t *) value->value.v_utf8.str;
+				length = value->value.v_utf8.len;
+			}
+			else if (value->value_type == BSON_TYPE_SYMBOL)
+			{
+				bytes = (const uint8_t *) value->value.v_symbol.symbol;
+				length = value->value.v_symbol.len;
+			}
+			else
+			{
+				bytes = value->value.v_oid.bytes;
+				length = sizeof(value->value.v_oid.bytes);
+			}
+
+			uint64 prefix = 0;
+			for (uint32_t i = 0; i < 7; i++)
+			{
+				prefix = (prefix << 8) | (i < length ? bytes[i] : 0);
+			}
+
+			return prefix << (BSON_ABBREV_VALUE_BITS - 56);
+		}
+
+		case BSON_TYPE_BOOL:
+		{
+			return value->value.v_bool ? 1 : 0;
+		}
+
+		case BSON_TYPE_DATE_TIME:
+		{
+			uint64 dateBits = ((uint64) value->value.v_datetime) ^ (UINT64CONST(1) << 63);
+			return dateBits >> unusedBits;
+		}
+
+		case BSON_TYPE_TIMESTAMP:
+		{
+			uint64 timestampBits = ((uint64) value->value.v_timestamp.timestamp << 32) |
+								   value->value.v_timestamp.increment;
+			return timestampBits >> unusedBits;
+		}
+
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+
 /*
  *  Compares two bson values.
  *  Please DO NOT  expose this method beyond this file.
@@ -32,6 +32,19 @@
 #define BSON_FIXED_LENGTH_FIELD_HASH(field, seed) \
 	BSON_VARIABLE_LENGTH_FIELD_HASH(&(field), sizeof(field), seed)
 
+/* The default secrets of the wyhash family of hashes */
+#define FAST_HASH_SECRET_0 UINT64CONST(0xa0761d6478bd642f)
+#define FAST_HASH_SECRET_1 UINT64CONST(0xe7037ed1a0b428db)
+#define FAST_HASH_SECRET_2 UINT64CONST(0x8ebc6af09c88c6e3)
+#define FAST_HASH_SECRET_3 UINT64CONST(0x589965cc75374cc3)
+
+extern bool EnableFastBsonValueHash;
+
+static uint64 HashBytesFast(const uint8_t *bytes, uint32_t bytesLength, uint64 seed);
+static uint64 HashBytesFastUint32AsUint64(const uint8_t *bytes, uint32_t bytesLength,
+										  int64 seed);
+static uint32 HashBsonValueBytesUint32(const void *bytes, uint32_t bytesLength);
+
 static uint64 HashCombineUint32AsUint64(uint64 left, uint64 right);
 static uint64 HashNumber(double number, int64 seed);
 static uint64 HashBytesUint64(const uint8_t *bytes, uint32_t bytesLength, int64 seed);
@@ -111,10 +124,16 @@ HashBsonComparableExtended(bson_iter_t *bsonIterValue, int64 seed)
 }
 
 
+/*
+ * Hashes the document for in memory lookups. The hash is not persisted,
+ * so the faster hash is used when it is enabled.
+ */
 uint32_t
 HashBsonComparable(bson_iter_t *bsonIterValue, uint32_t seed)
 {
 	return (uint32_t) BsonHashCompare(bsonIterValue,
+									  EnableFastBsonValueHash ?
+									  HashBytesFastUint32AsUint64 :
 									  HashBytesUint32AsUint64,
 									  HashCombineUint32AsUint64, seed);
 }
@@ -128,10 +147,17 @@ HashBsonValueComparableExtended(const bson_value_t *bsonIterValue, int64 seed)
 }
 
 
+/*
+ * Hashes the value for in memory lookups. The hash is not persisted,
+ * so the faster hash is used when it is enabled.
+ */
 uint32_t
 HashBsonValueComparable(const bson_value_t *bsonIterValue, uint32_t seed)
 {
-	return (uint32_t) HashBsonValueCompare(bsonIterValue, HashBytesUint32AsUint64,
+	return (uint32_t) HashBsonValueCompare(bsonIterValue,
+										   EnableFastBsonValueHash ?
+										   HashBytesFastUint32AsUint64 :
+										   HashBytesUint32AsUint64,
 										   HashCombineUint32AsUint64, seed);
 }
 
@@ -276,6 +302,9 @@ BsonValueHash(const bson_value_t *value, int64 seed)
 
 /*
  * BsonValueHashUint32 generates a uint32 hash value for a given BSON value.
+ * The hash is only used for in memory hash sets and is never persisted: it
+ * depends on enableFastBsonValueHash and hashes arrays and documents as bytes.
+ * Anything stored (e.g. index terms) must use BsonValueHash instead.
  */
 uint32
 BsonValueHashUint32(const bson_value_t *bsonValue)
@@ -284,17 +313,15 @@ BsonValueHashUint32(const bson_value_t *bsonValue)
 	{
 		case BSON_TYPE_BOOL:
 		{
-			return hash_bytes((const unsigned char *)
-							  &(bsonValue->value.v_bool),
-							  sizeof(bool));
+			return HashBsonValueBytesUint32(&(bsonValue->value.v_bool),
+											sizeof(bool));
 		}
 
 		case BSON_TYPE_INT32:
 		case BSON_TYPE_INT64:
 		{
 			int64 value = BsonValueAsInt64(bsonValue);
-			return hash_bytes((const unsigned char *) &value,
-							  sizeof(int64));
+			return HashBsonValueBytesUint32(&value, sizeof(int64));
 		}
 
 		case BSON_TYPE_DOUBLE:
@@ -311,16 +338,14 @@ BsonValueHashUint32(const bson_value_t *bsonValue)
 			if (IsBsonValue64BitInteger(bsonValue, checkFixedInteger))
 			{
 				int64 value = BsonValueAsInt64(bsonValue);
-				return hash_bytes((const unsigned char *) &value,
-								  sizeof(int64));
+				return HashBsonValueBytesUint32(&value, sizeof(int64));
 			}
 
 			/* In set operators aggregation, non-fixed double and Decimal128 values with the same numerical value are not considered equal.
 			 * For example, if we have a double value of "1.1" and a Decimal128 value of "1.1", they will not be considered equal.
 			 * To ensure that these values are not treated as equal, different hashes are generated for these values.*/
-			return hash_bytes((const unsigned char *)
-							  &bsonValue->value.v_double,
-							  sizeof(double));
+			return HashBsonValueBytesUint32(&bsonValue->value.v_double,
+											sizeof(double));
 		}
 
 		case BSON_TYPE_DECIMAL128:
@@ -337,81 +362,70 @@ BsonValueHashUint32(const bson_value_t *bsonValue)
 			if (IsBsonValue64BitInteger(bsonValue, checkFixedInteger))
 			{
 				int64 value = BsonValueAsInt64(bsonValue);
-				return hash_bytes((const unsigned char *) &value,
-								  sizeof(int64));
+				return HashBsonValueBytesUint32(&value, sizeof(int64));
 			}
 
 			/* In set operators aggregation, non-fixed double and Decimal128 values with the same numerical value are not considered equal.
 			 * For example, if we have a double value of "1.1" and a Decimal128 value of "1.1", they will not be considered equal.
 			 * To ensure that these values are not treated as equal, different hashes are generated for these values.*/
-			return hash_bytes((const unsigned char *)
-							  &bsonValue->value.v_decimal128,
-							  sizeof(bsonValue->value.v_utf8.len));
+			return HashBsonValueBytesUint32(&bsonValue->value.v_decimal128,
+											sizeof(bson_decimal128_t));
 		}
 
 		case BSON_TYPE_UTF8:
 		{
-			return hash_bytes((const unsigned char *)
-							  bsonValue->value.v_utf8.str,
-							  bsonValue->value.v_utf8.len);
+			return HashBsonValueBytesUint32(bsonValue->value.v_utf8.str,
+											bsonValue->value.v_utf8.len);
 		}
 
 		case BSON_TYPE_DOCUMENT:
 		case BSON_TYPE_ARRAY:
 		{
-			return hash_bytes((const unsigned char *)
-							  bsonValue->value.v_doc.data,
-							  bsonValue->value.v_doc.data_len);
+			return HashBsonValueBytesUint32(bsonValue->value.v_doc.data,
+											bsonValue->value.v_doc.data_len);
 		}
 
 		case BSON_TYPE_BINARY:
 		{
-			return hash_bytes((const unsigned char *)
-							  bsonValue->value.v_binary.data,
-							  bsonValue->value.v_binary.data_len);
+			return HashBsonValueBytesUint32(bsonValue->value.v_binary.data,
+											bsonValue->value.v_binary.data_len);
 		}
 
 		case BSON_TYPE_DATE_TIME:
 		{
-			return hash_bytes((const unsigned char *)
-							  &bsonValue->value.v_datetime,
-							  sizeof(int64));
+			return HashBsonValueBytesUint32(&bsonValue->value.v_datetime,
+											sizeof(int64));
 		}
 
 		case BSON_TYPE_TIMESTAMP:
 		{
-			return hash_bytes((const unsigned char *)
-							  &bsonValue->value.v_timestamp.timestamp,
-							  sizeof(int64));
+			return HashBsonValueBytesUint32(&bsonValue->value.v_timestamp.timestamp,
+											sizeof(int64));
 		}
 
 		case BSON_TYPE_OID:
 		{
-			return hash_bytes((const unsigned char *)
-							  &bsonValue->value.v_oid.bytes,
-							  sizeof(bson_oid_t));
+			return HashBsonValueBytesUint32(&bsonValue->value.v_oid.bytes,
+											sizeof(bson_oid_t));
 		}
 
 		case BSON_TYPE_REGEX:
 		{
-			return hash_bytes((const unsigned char *)
-							  &bsonValue->value.v_regex.regex,
-							  strlen(bsonValue->value.v_regex.regex));
+			return HashBsonValueBytesUint32(&bsonValue->value.v_regex.regex,
+											strlen(bsonValue->value.v_regex.regex));
 		}
 
 		case BSON_TYPE_CODE:
 		case BSON_TYPE_CODEWSCOPE:
 		{
-			return hash_bytes((const unsigned char *)
-							  bsonValue->value.v_code.code,
-							  bsonValue->value.v_code.code_len);
+			return HashBsonValueBytesUint32(bsonValue->value.v_code.code,
+											bsonValue->value.v_code.code_len);
 		}
 
 		case BSON_TYPE_SYMBOL:
 		{
-			return hash_bytes((const unsigned char *)
-							  bsonValue->value.v_symbol.symbol,
-							  bsonValue->value.v_symbol.len);
+			return HashBsonValueBytesUint32(bsonValue->value.v_symbol.symbol,
+											bsonValue->value.v_symbol.len);
 		}
 
 		case BSON_TYPE_DBPOINTER:
@@ -420,9 +434,8 @@ BsonValueHashUint32(const bson_value_t *bsonValue)
 			 * we generate a hash using only the collection name because including the 'oid' field in the
 			 * hash computation would be more expensive than comparing the 'oid' values directly if hash matches.
 			 */
-			return hash_bytes((const unsigned char *)
-							  bsonValue->value.v_dbpointer.collection,
-							  bsonValue->value.v_dbpointer.collection_len);
+			return HashBsonValueBytesUint32(bsonValue->value.v_dbpointer.collection,
+											bsonValue->value.v_dbpointer.collection_len);
 		}
 
 		case BSON_TYPE_UNDEFINED:
@@ -735,3 +748,151 @@ HashBytesUint64(const uint8_t *bytes, uint32_t bytesLength, int64 seed)
 {
 	return hash_bytes_extended((unsigned char *) bytes, bytesLength, seed);
 }
+
+
+/*
+ * Hashes the bytes of a bson value for BsonValueHashUint32.
+ */
+static uint32
+HashBsonValueBytesUint32(const void *bytes, uint32_t bytesLength)
+{
+	if (EnableFastBsonValueHash)
+	{
+		return (uint32) HashBytesFast((const uint8_t *) bytes, bytesLength, 0);
+	}
+
+	return hash_bytes((const unsigned char *) bytes, bytesLength);
+}
+
+
+/*
+ * Fast hash as uint32 but represented as uint64.
+ */
+static uint64
+HashBytesFastUint32AsUint64(const uint8_t *bytes, uint32_t bytesLength, int64 seed)
+{
+	return (uint32) HashBytesFast(bytes, bytesLength, (uint64) seed);
+}
+
+
+/*
+ * Multiplies the two values into 128 bits and returns the low and high
+ * halves in place.
+ */
+static inline void
+FastHashMultiply(uint64 *left, uint64 *right)
+{
+#ifdef HAVE_INT128
+	uint128 result = (uint128) (*left) * (*right);
+	*left = (uint64) result;
+	*right = (uint64) (result >> 64);
+#else
+	uint64 leftHigh = *left >> 32, leftLow = (uint32) (*left);
+	uint64 rightHigh = *right >> 32, rightLow = (uint32) (*right);
+	uint64 highHigh = leftHigh * rightHigh, highLow = leftHigh * rightLow;
+	uint64 lowHigh = leftLow * rightHigh, lowLow = leftLow * rightLow;
+	uint64 middle = (lowLow >> 32) + (uint32) highLow + lowHigh;
+	*left = (middle << 32) | (uint32) lowLow;
+	*right = highHigh + (highLow >> 32) + (middle >> 32);
+#endif
+}
+
+
+static inline uint64
+FastHashMix(uint64 left, uint64 right)
+{
+	FastHashMultiply(&left, &right);
+	return left ^ right;
+}
+
+
+static inline uint64
+FastHashRead64(const uint8_t *bytes)
+{
+	uint64 value;
+	memcpy(&value, bytes, sizeof(uint64));
+	return value;
+}
+
+
+static inline uint64
+FastHashRead32(const uint8_t *bytes)
+{
+	uint32 value;
+	memcpy(&value, bytes, sizeof(uint32));
+	return value;
+}
+
+
+/*
+ * A wyhash style non cryptographic hash of the bytes: Consumes 8 bytes at a
+ * time (48 bytes per iteration for long inputs over three independent lanes)
+ * with a 64x64->128 bit multiply-fold per step, which is considerably cheaper
+ * than hash_bytes for the strings and documents that dominate hash sets.
+ * The hash depends on the endianness of the machine, and must not be persisted.
+ */
+static uint64
+HashBytesFast(const uint8_t *bytes, uint32_t bytesLength, uint64 seed)
+{
+	uint64 left, right;
+	seed ^= FastHashMix(seed ^ FAST_HASH_SECRET_0, FAST_HASH_SECRET_1);
+	if (likely(bytesLength <= 16))
+	{
+		if (likely(bytesLength >= 4))
+		{
+			uint32_t offset = (bytesLength >> 3) << 2;
+			left = (FastHashRead32(bytes) << 32) | FastHashRead32(bytes + offset);
+			right = (FastHashRead32(bytes + bytesLength - 4) << 32) |
+					FastHashRead32(bytes + bytesLength - 4 - offset);
+		}
+		else if (likely(bytesLength > 0))
+		{
+			left = ((uint64) bytes[0] << 16) | ((uint64) bytes[bytesLength >> 1] << 8) |
+				   bytes[bytesLength - 1];
+			right = 0;
+		}
+		else
+		{
+			left = right = 0;
+		}
+	}
+	else
+	{
+		const uint8_t *current = bytes;
+		uint32_t remaining = bytesLength;
+		if (unlikely(remaining > 48))
+		{
+			uint64 lane1 = seed, lane2 = seed;
+			do {
+				seed = FastHashMix(FastHashRead64(current) ^ FAST_HASH_SECRET_1,
+								   FastHashRead64(current + 8) ^ seed);
+				lane1 = FastHashMix(FastHashRead64(current + 16) ^ FAST_HASH_SECRET_2,
+									FastHashRead64(current + 24) ^ lane1);
+				lane2 = FastHashMix(FastHashRead64(current + 32) ^ FAST_HASH_SECRET_3,
+									FastHashRead64(current + 40) ^ lane2);
+				current += 48;
+				remaining -= 48;
+			} while (likely(remaining > 48));
+
+			seed ^= lane1 ^ lane2;
+		}
+
+		while (unlikely(remaining > 16))
+		{
+			seed = FastHashMix(FastHashRead64(current) ^ FAST_HASH_SECRET_1,
+							   FastHashRead64(current + 8) ^ seed);
+			current += 16;
+			remaining -= 16;
+		}
+
+		/* The last 16 bytes of the input (may overlap with the consumed bytes) */
+		left = FastHashRead64(current + remaining - 16);
+		right = FastHashRead64(current + remaining - 8);
+	}
+
+	left ^= FAST_HASH_SECRET_1;
+	right ^= seed;
+	FastHashMultiply(&left, &right);
+	return FastHashMix(left ^ FAST_HASH_SECRET_0 ^ bytesLength,
+					   right ^ FAST_HASH_SECRET_1);
+}
@@ -0,0 +1,133 @@
+-- Microbenchmarks of the BSON primitives of documentdb_core.
+--
+-- Every benchmark is a query that applies one primitive to each document of a
+-- corpus of representative documents (small, nested, wide and array heavy)
+-- and returns the number of operations. It runs :iterations times after a
+-- warmup and the fastest run is reported as ns/op, along with the memory the
+-- backend retained across the runs (e.g. leaks into long lived contexts).
+-- The results are printed as CSV: name,ns_per_op,ops,retained_bytes
+--
+-- The decimal128 arithmetic and collation comparisons go through the operators
+-- of the documentdb extension and only run when it is installed.
+
+-- Only the results go to the output
+\o /dev/null
+SET client_min_messages TO WARNING;
+CREATE EXTENSION IF NOT EXISTS documentdb_core;
+
+\if :{?iterations}
+\else
+\set iterations 5
+\endif
+\if :{?corpus_size}
+\else
+\set corpus_size 2000
+\endif
+
+-- The corpus: common fields plus a payload that depends on the shape
+CREATE TEMP TABLE bench_documents AS
+SELECT i AS id, FORMAT(
+		'{ "_id": %s, "name": "%s", "dec": { "$numberDecimal": "%s.25" }, "nested": { "level2": { "value": %s, "tag": "t%s" } }, %s }',
+		i, CASE WHEN i % 2 = 0 THEN 'User' ELSE 'USER' END || (i % 97), i, i, i % 10,
+		CASE i % 4
+			WHEN 0 THEN FORMAT('"a": %s, "b": "str%s", "c": true, "d": %s', i, i, i * 1.5)
+			WHEN 1 THEN FORMAT('"n": { "x": { "y": { "z": [ { "k": %s }, { "k": "%s" } ] } } }', i, i)
+			WHEN 2 THEN (SELECT string_agg(FORMAT('"f%s": %s', j, i + j), ', ') FROM generate_series(1, 50) j)
+			ELSE FORMAT('"arr": [ %s ], "docs": [ %s ]',
+						(SELECT string_agg((i + j)::text, ', ') FROM generate_series(1, 100) j),
+						(SELECT string_agg(FORMAT('{ "k": %s }', j), ', ') FROM generate_series(1, 10) j))
+		END) AS json_text
+FROM generate_series(1, :corpus_size) i;
+
+ALTER TABLE bench_documents ADD COLUMN document documentdb_core.bson, ADD COLUMN raw bytea;
+UPDATE bench_documents SET document = json_text::documentdb_core.bson;
+UPDATE bench_documents SET raw = documentdb_core.bson_to_bytea(document);
+
+CREATE TEMP TABLE bench_pairs AS
+SELECT l.document AS left_document, r.document AS right_document,
+	   documentdb_core.bson_repath_and_build('d'::text, documentdb_core.bson_get_value(l.document, 'dec')) AS left_decimal,
+	   documentdb_core.bson_repath_and_build('d'::text, documentdb_core.bson_get_value(r.document, 'dec')) AS right_decimal
+FROM bench_documents l JOIN bench_documents r ON r.id = l.id % :corpus_size + 1;
+
+ANALYZE bench_documents;
+ANALYZE bench_pairs;
+
+CREATE TEMP TABLE bench_results (name text, ns_per_op numeric, ops bigint, retained_bytes bigint);
+
+CREATE FUNCTION pg_temp.run_microbenchmark(p_name text, p_query text, p_iterations int)
+RETURNS void
+AS $$
+DECLARE
+	v_ops bigint;
+	v_start timestamptz;
+	v_elapsed_ns numeric;
+	v_best_ns numeric := NULL;
+	v_memory_before bigint;
+	v_memory_after bigint;
+BEGIN
+	-- warm up the caches (plans, type info, collators) before measuring
+	EXECUTE p_query INTO v_ops;
+
+	SELECT sum(total_bytes) INTO v_memory_before FROM pg_backend_memory_contexts;
+	FOR i IN 1..p_iterations LOOP
+		v_start := clock_timestamp();
+		EXECUTE p_query INTO v_ops;
+		v_elapsed_ns := extract(epoch FROM clock_timestamp() - v_start) * 1000000000;
+		v_best_ns := least(coalesce(v_best_ns, v_elapsed_ns), v_elapsed_ns);
+	END LOOP;
+	SELECT sum(total_bytes) INTO v_memory_after FROM pg_backend_memory_contexts;
+
+	INSERT INTO bench_results VALUES (p_name, round(v_best_ns / greatest(v_ops, 1), 1),
+									  v_ops, v_memory_after - v_memory_before);
+END;
+$$ LANGUAGE plpgsql;
+
+-- The cost of scanning the corpus, which every other benchmark includes
+SELECT pg_temp.run_microbenchmark('corpus_scan',
+	'SELECT count(document) FROM bench_documents', :iterations);
+
+-- Parse: extended json text to bson
+SELECT pg_temp.run_microbenchmark('bson_parse_json',
+	'SELECT count(json_text::documentdb_core.bson) FROM bench_documents', :iterations);
+
+-- Validate: bytea to bson
+SELECT pg_temp.run_microbenchmark('bson_validate_bytea',
+	'SELECT count(documentdb_core.bson_from_bytea(raw)) FROM bench_documents', :iterations);
+
+-- PgbsonInitIteratorAtPath on a nested path, and on a path of the wide documents
+SELECT pg_temp.run_microbenchmark('bson_get_value_nested_path',
+	'SELECT count(documentdb_core.bson_get_value(document, ''nested.level2.value'')) FROM bench_documents', :iterations);
+SELECT pg_temp.run_microbenchmark('bson_get_value_wide_path',
+	'SELECT count(documentdb_core.bson_get_value(document, ''f50'') IS NULL) FROM bench_documents', :iterations);
+
+-- Writer: appending documents and values to a new document
+SELECT pg_temp.run_microbenchmark('bson_writer_append',
+	'SELECT count(documentdb_core.bson_repath_and_build(''a''::text, left_document, ''b''::text, left_decimal, ''c''::text, right_document)) FROM bench_pairs', :iterations);
+
+-- CompareBsonIter over whole documents, and over decimal128 values
+SELECT pg_temp.run_microbenchmark('bson_compare',
+	'SELECT count(documentdb_core.bson_compare(left_document, right_document)) FROM bench_pairs', :iterations);
+SELECT pg_temp.run_microbenchmark('bson_compare_decimal128',
+	'SELECT count(documentdb_core.bson_compare(left_decimal, right_decimal)) FROM bench_pairs', :iterations);
+
+-- HashBsonValueComparable
+SELECT pg_temp.run_microbenchmark('bson_hash',
+	'SELECT count(documentdb_core.bson_hash_int8(document, 0)) FROM bench_documents', :iterations);
+
+SELECT EXISTS (SELECT 1 FROM pg_extension WHERE extname = 'documentdb') AS has_documentdb \gset
+\if :has_documentdb
+SET documentdb_core.enableCollation TO on;
+
+-- decimal128 arithmetic
+SELECT pg_temp.run_microbenchmark('decimal128_add_multiply',
+	'SELECT count(documentdb_api_catalog.bson_expression_get(document, ''{ "r": { "$multiply": [ { "$add": [ "$dec", "$dec" ] }, "$dec" ] } }'')) FROM bench_documents', :iterations);
+
+-- collation aware string comparisons
+SELECT pg_temp.run_microbenchmark('collation_compare',
+	'SELECT count(documentdb_api_internal.bson_expression_get(document, ''{ "r": { "$eq": [ "$name", "user1" ] } }'', false, NULL, ''en-u-ks-level2'')) FROM bench_documents', :iterations);
+
+RESET documentdb_core.enableCollation;
+\endif
+
+\o
+\copy (SELECT name, ns_per_op, ops, retained_bytes FROM bench_results ORDER BY name) TO STDOUT WITH (FORMAT csv, HEADER)
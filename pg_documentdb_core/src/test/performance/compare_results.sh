@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# Compares the results of a benchmark run with the results of a baseline run
+# and fails if any benchmark regressed by more than the tolerance. The first
+# column of the CSV files is the benchmark name and the second its cost (lower
+# is better).
+# usage: compare_results.sh <results csv> <baseline csv> <tolerance>
+
+set -euo pipefail
+
+if [ $# -ne 3 ]; then
+    echo "usage: $0 <results csv> <baseline csv> <tolerance>"
+    exit 1
+fi
+
+results=$1
+baseline=$2
+tolerance=$3
+
+awk -F, -v tolerance="$tolerance" '
+    NR == FNR {
+        if (FNR > 1) { baseline[$1] = $2 }
+        next
+    }
+    FNR > 1 && ($1 in baseline) {
+        limit = baseline[$1] * (1 + tolerance)
+        status = "ok"
+        if ($2 > limit) { status = "REGRESSED"; failed = 1 }
+        printf "%-40s %12.1f (baseline %12.1f) %s\n", $1, $2, baseline[$1], status
+    }
+    END { exit failed }
+' "$baseline" "$results"
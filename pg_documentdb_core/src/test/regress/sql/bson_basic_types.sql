@@ -76,4 +76,19 @@ ROLLBACK;
 BEGIN;
 set local documentdb_core.bsonUseEJson TO false;
 SELECT COUNT(1) FROM test WHERE bson_hex_to_bson(bson_out(document)) != document;
-ROLLBACK;
\ No newline at end of file
+ROLLBACK;
+-- sorts and btree index builds use the sort support of bson_btree_ops
+CREATE TABLE bson_sort_test (id int, document bson);
+INSERT INTO bson_sort_test VALUES (1, '{ "": 2 }'), (2, '{ "": "b" }'), (3, '{ "": { "$numberLong": "1" } }'), (4, '{ "": 1.5 }'), (5, '{ "": "a" }'), (6, '{ "": null }'), (7, '{ "a": 1 }'), (8, '{ }'), (9, '{ "": true }'), (10, '{ "": { "$date": { "$numberLong": "1565546054692" } } }');
+SET documentdb_core.enableBsonAbbreviatedSortKeys TO on;
+SELECT id FROM bson_sort_test ORDER BY document;
+SELECT id FROM bson_sort_test ORDER BY document DESC;
+CREATE INDEX bson_sort_test_idx ON bson_sort_test USING btree (document);
+BEGIN;
+SET LOCAL enable_seqscan TO off;
+EXPLAIN (COSTS OFF) SELECT id FROM bson_sort_test ORDER BY document;
+SELECT id FROM bson_sort_test ORDER BY document;
+ROLLBACK;
+RESET documentdb_core.enableBsonAbbreviatedSortKeys;
+SELECT id FROM bson_sort_test ORDER BY document;
+DROP TABLE bson_sort_test;
@@ -15,9 +15,18 @@
 #define MIN_JIT_STACK_SIZE (32 * 1024)
 #define MAX_JIT_STACK_SIZE (MIN_JIT_STACK_SIZE * 2)
 
+/* Bounds of the backend's compiled regex cache */
+#define REGEX_CACHE_MAX_ENTRIES 1024
+#define REGEX_CACHE_MAX_BYTES (16 * 1024 * 1024)
+
 #include <pcre2.h>
 #include <postgres.h>
+#include <access/xact.h>
+#include <common/hashfn.h>
+#include <lib/ilist.h>
 #include <utils/builtins.h>
+#include <utils/hsearch.h>
+#include <utils/memutils.h>
 #include <lib/stringinfo.h>
 #include "io/bson_core.h"
 #include "utils/documentdb_errors.h"
@@ -43,30 +52,87 @@ typedef struct PcreData
 
 	/* stack for use by the code compiled by the JIT compiler */
 	pcre2_jit_stack *jitStack;
+
+	/* Whether the data is owned by the compiled regex cache (and must not be freed) */
+	bool isCached;
 } PcreData;
 
+/* The kind of compiled regex: the two kinds are set up differently for matching */
+typedef enum RegexCacheKind
+{
+	RegexCacheKind_Query = 1,
+	RegexCacheKind_Aggregation = 2,
+} RegexCacheKind;
+
+/* An entry of the backend's compiled regex cache */
+typedef struct RegexCacheEntry
+{
+	/* The hash of the kind, compile options, pattern and options (the hash key) */
+	uint64 hash;
+
+	RegexCacheKind kind;
+	uint32_t compileOptions;
+	char *pattern;
+	char *options;
+
+	/* The context holding the compiled regex and everything above */
+	MemoryContext context;
+
+	/* The approximate memory used by the entry, including the JIT compiled code */
+	Size size;
+
+	PcreData *pcreData;
+
+	/* The position of the entry in the LRU list of the cache */
+	dlist_node lruNode;
+} RegexCacheEntry;
+
+extern bool EnableCompiledRegexCache;
+
+static HTAB *RegexCache = NULL;
+static MemoryContext RegexCacheContext = NULL;
+static dlist_head RegexCacheLru = DLIST_STATIC_INIT(RegexCacheLru);
+static Size RegexCacheBytes = 0;
+
 /* --------------------------------------------------------- */
 /* Forward declaration */
 /* --------------------------------------------------------- */
 
 static uint32_t ProcessRegexCompileOptions(char *options);
-static inline void CreatePcreCompileContext(PcreData *pcreData);
+static inline void CreatePcreCompileContext(PcreData *pcreData,
+											MemoryContext memoryContext);
+static PcreData * CreatePcreData(char *regexPatternStr, char *options,
+								 RegexCacheKind kind, uint32_t compileOptions,
+								 const char *regexInvalidErrorMessage,
+								 MemoryContext memoryContext);
+static PcreData * GetOrCreateCachedPcreData(char *regexPatternStr, char *options,
+											RegexCacheKind kind, uint32_t
+											compileOptions,
+											const char *regexInvalidErrorMessage);
+static void EvictRegexCacheEntry(RegexCacheEntry *entry);
+static void FreeCachedPcreDataCallback(void *arg);
 static inline void InvalidRegexError(int errorCode, const char *errorMessage, int
 									 pcreErrorCode, PcreData *pcreData);
 static bool RegexCompileCore(char *regexPatternStr, char *options, PcreData **pcreData,
 							 int *pcreErrorCode, int maxPatternLength,
-							 uint32_t compileOptions);
-void * extension_pcre_malloc(PCRE2_SIZE size, void *ignore);
+							 uint32_t compileOptions, MemoryContext memoryContext);
+void * extension_pcre_malloc(PCRE2_SIZE size, void *memoryContext);
 void extension_pcre_free(void *memPtr, void *ignore);
 
 /* This function is used to get registered with PCRE2 context
  * during the calls to PCRE2 functions so that PCRE2 uses
  * this function to allocate the memory. As palloc gets
  * memory from Postgres, memory management will be taken
- * care by Postgres. */
+ * care by Postgres. The memory data is the memory context to
+ * allocate in for cached regexes (NULL for the current context). */
 void *
-extension_pcre_malloc(PCRE2_SIZE size, void *ignore)
+extension_pcre_malloc(PCRE2_SIZE size, void *memoryContext)
 {
+	if (memoryContext != NULL)
+	{
+		return MemoryContextAlloc((MemoryContext) memoryContext, (Size) size);
+	}
+
 	return palloc((size_t) size);
 }
 
@@ -94,7 +160,7 @@ RegexCompileDuringPlanning(char *regexPatternStr, char *options)
 	int pcreErrorCode = 0;
 
 	if (!RegexCompileCore(regexPatternStr, options, &pcreData, &pcreErrorCode,
-						  REGEX_MAX_PATTERN_LENGTH, PCRE2_NO_AUTO_CAPTURE))
+						  REGEX_MAX_PATTERN_LENGTH, PCRE2_NO_AUTO_CAPTURE, NULL))
 	{
 		InvalidRegexError(ERRCODE_DOCUMENTDB_LOCATION51091,
 						  "The provided regular expression format is invalid",
@@ -109,21 +175,17 @@ RegexCompileDuringPlanning(char *regexPatternStr, char *options)
 PcreData *
 RegexCompile(char *regexPatternStr, char *options)
 {
-	PcreData *pcreData = palloc0(sizeof(PcreData));
-	int pcreErrorCode = 0;
-
-	if (!RegexCompileCore(regexPatternStr, options, &pcreData, &pcreErrorCode,
-						  REGEX_MAX_PATTERN_LENGTH, PCRE2_NO_AUTO_CAPTURE))
+	const char *regexInvalidErrorMessage =
+		"The provided regular expression format is invalid";
+	if (EnableCompiledRegexCache)
 	{
-		InvalidRegexError(ERRCODE_DOCUMENTDB_LOCATION51091,
-						  "The provided regular expression format is invalid",
-						  pcreErrorCode, pcreData);
+		return GetOrCreateCachedPcreData(regexPatternStr, options,
+										 RegexCacheKind_Query, PCRE2_NO_AUTO_CAPTURE,
+										 regexInvalidErrorMessage);
 	}
 
-	/* Creates a new matchData block to hold the result of a match */
-	pcreData->matchData =
-		pcre2_match_data_create_from_pattern(pcreData->compiledRegex, NULL);
-	return pcreData;
+	return CreatePcreData(regexPatternStr, options, RegexCacheKind_Query,
+						  PCRE2_NO_AUTO_CAPTURE, regexInvalidErrorMessage, NULL);
 }
 
 
@@ -132,34 +194,63 @@ PcreData *
 RegexCompileForAggregation(char *regexPatternStr, char *options, bool enableNoAutoCapture,
 						   const char *regexInvalidErrorMessage)
 {
-	PcreData *pcreData = palloc0(sizeof(PcreData));
-
-	int pcreErrorCode = 0;
-
 	uint32_t compileOptions = enableNoAutoCapture ? PCRE2_NO_AUTO_CAPTURE : 0;
-	if (!RegexCompileCore(regexPatternStr, options, &pcreData, &pcreErrorCode,
-						  REGEX_MAX_PATTERN_LENGTH_AGGREGATION, compileOptions))
+	if (EnableCompiledRegexCache)
 	{
-		InvalidRegexError(ERRCODE_DOCUMENTDB_LOCATION51111, regexInvalidErrorMessage,
-						  pcreErrorCode,
-						  pcreData);
+		return GetOrCreateCachedPcreData(regexPatternStr, options,
+										 RegexCacheKind_Aggregation, compileOptions,
+										 regexInvalidErrorMessage);
 	}
 
-	/* we pass pcre2_general_context to the input so for memory allocation we use custom function of general context : palloc and pfree */
-	pcreData->matchContext = pcre2_match_context_create(pcreData->generalContext);
-	pcre2_set_recursion_limit(pcreData->matchContext, PCRE2_RECURSION_LIMIT);
+	return CreatePcreData(regexPatternStr, options, RegexCacheKind_Aggregation,
+						  compileOptions, regexInvalidErrorMessage, NULL);
+}
+
 
-	/* create a stack for use by the code compiled by the JIT compiler */
-	pcreData->jitStack = pcre2_jit_stack_create(MIN_JIT_STACK_SIZE, MAX_JIT_STACK_SIZE,
-												pcreData->generalContext);
-	if (pcreData->jitStack == NULL)
+/*
+ * Compiles the regex and sets up the PcreData for matching according to its kind.
+ * All the memory is allocated in the memory context (or the current context if NULL).
+ * Throws an error if the regex is invalid.
+ */
+static PcreData *
+CreatePcreData(char *regexPatternStr, char *options, RegexCacheKind kind,
+			   uint32_t compileOptions, const char *regexInvalidErrorMessage,
+			   MemoryContext memoryContext)
+{
+	PcreData *pcreData = memoryContext != NULL ?
+						 MemoryContextAllocZero(memoryContext, sizeof(PcreData)) :
+						 palloc0(sizeof(PcreData));
+
+	int pcreErrorCode = 0;
+	bool isAggregation = kind == RegexCacheKind_Aggregation;
+	if (!RegexCompileCore(regexPatternStr, options, &pcreData, &pcreErrorCode,
+						  isAggregation ? REGEX_MAX_PATTERN_LENGTH_AGGREGATION :
+						  REGEX_MAX_PATTERN_LENGTH, compileOptions, memoryContext))
 	{
-		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT), errmsg(
-							"PCRE2 stack creation failure.")));
+		InvalidRegexError(isAggregation ? ERRCODE_DOCUMENTDB_LOCATION51111 :
+						  ERRCODE_DOCUMENTDB_LOCATION51091, regexInvalidErrorMessage,
+						  pcreErrorCode, pcreData);
 	}
 
-	/* provides control over the memory used by JIT as a run-time stack */
-	pcre2_jit_stack_assign(pcreData->matchContext, NULL, pcreData->jitStack);
+	if (isAggregation)
+	{
+		/* we pass pcre2_general_context to the input so for memory allocation we use custom function of general context : palloc and pfree */
+		pcreData->matchContext = pcre2_match_context_create(pcreData->generalContext);
+		pcre2_set_recursion_limit(pcreData->matchContext, PCRE2_RECURSION_LIMIT);
+
+		/* create a stack for use by the code compiled by the JIT compiler */
+		pcreData->jitStack = pcre2_jit_stack_create(MIN_JIT_STACK_SIZE,
+													MAX_JIT_STACK_SIZE,
+													pcreData->generalContext);
+		if (pcreData->jitStack == NULL)
+		{
+			ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT), errmsg(
+								"PCRE2 stack creation failure.")));
+		}
+
+		/* provides control over the memory used by JIT as a run-time stack */
+		pcre2_jit_stack_assign(pcreData->matchContext, NULL, pcreData->jitStack);
+	}
 
 	/* Creates a new matchData block to hold the result of a match */
 	pcreData->matchData =
@@ -168,13 +259,166 @@ RegexCompileForAggregation(char *regexPatternStr, char *options, bool enableNoAu
 }
 
 
+/*
+ * Returns the compiled regex from the backend's cache, compiling and caching it
+ * on a miss. Cached regexes are shared across queries (and by the query operators,
+ * aggregation operators and json schema validation that use the same pattern), so
+ * repeated queries skip the compilation and JIT compilation of their patterns.
+ * The cache is bounded by entries and memory, evicting the least recently used
+ * regexes; evicted regexes stay valid until the end of the current transaction since
+ * callers may still hold them.
+ */
+static PcreData *
+GetOrCreateCachedPcreData(char *regexPatternStr, char *options, RegexCacheKind kind,
+						  uint32_t compileOptions, const char *regexInvalidErrorMessage)
+{
+	if (RegexCache == NULL)
+	{
+		RegexCacheContext = AllocSetContextCreate(TopMemoryContext,
+												  "Compiled regex cache",
+												  ALLOCSET_DEFAULT_SIZES);
+
+		HASHCTL ctl;
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(uint64);
+		ctl.entrysize = sizeof(RegexCacheEntry);
+		ctl.hcxt = RegexCacheContext;
+		RegexCache = hash_create("Compiled regex cache", 128, &ctl,
+								 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	const char *optionsString = options != NULL ? options : "";
+	uint64 hash = hash_bytes_extended((const unsigned char *) regexPatternStr,
+									  strlen(regexPatternStr),
+									  ((uint64) compileOptions << 8) | kind);
+	hash = hash_combine64(hash, hash_bytes_extended(
+							  (const unsigned char *) optionsString,
+							  strlen(optionsString), 0));
+
+	bool found = false;
+	RegexCacheEntry *entry = hash_search(RegexCache, &hash, HASH_FIND, &found);
+	if (found)
+	{
+		if (entry->kind == kind && entry->compileOptions == compileOptions &&
+			strcmp(entry->pattern, regexPatternStr) == 0 &&
+			strcmp(entry->options, optionsString) == 0)
+		{
+			dlist_move_head(&RegexCacheLru, &entry->lruNode);
+			return entry->pcreData;
+		}
+
+		/* A hash collision with another regex: don't cache this one */
+		return CreatePcreData(regexPatternStr, options, kind, compileOptions,
+							  regexInvalidErrorMessage, NULL);
+	}
+
+	/*
+	 * Compile into a context of its own that is owned by the current context until the
+	 * regex is cached, so that an invalid regex doesn't leak into the cache.
+	 */
+	MemoryContext entryContext = AllocSetContextCreate(CurrentMemoryContext,
+													   "Compiled regex",
+													   ALLOCSET_SMALL_SIZES);
+	PcreData *pcreData = CreatePcreData(regexPatternStr, options, kind, compileOptions,
+										regexInvalidErrorMessage, entryContext);
+
+	/*
+	 * Free the PCRE2 objects (notably the JIT compiled code) along with the context.
+	 * Callers freeing the regex would pull it from under other users, so that is a no-op.
+	 */
+	pcreData->isCached = true;
+	MemoryContextCallback *callback = MemoryContextAlloc(entryContext,
+														 sizeof(MemoryContextCallback));
+	callback->func = FreeCachedPcreDataCallback;
+	callback->arg = pcreData;
+	MemoryContextRegisterResetCallback(entryContext, callback);
+
+	size_t jitSize = 0;
+	pcre2_pattern_info(pcreData->compiledRegex, PCRE2_INFO_JITSIZE, &jitSize);
+	Size entrySize = MemoryContextMemAllocated(entryContext, true) + jitSize +
+					 strlen(regexPatternStr) + strlen(optionsString);
+	if (entrySize > REGEX_CACHE_MAX_BYTES / 4)
+	{
+		/*
+		 * Too large to cache: the regex is freed with the current context, so callers
+		 * must not free it themselves.
+		 */
+		pcreData->isCached = true;
+		return pcreData;
+	}
+
+	while (!dlist_is_empty(&RegexCacheLru) &&
+		   (RegexCacheBytes + entrySize > REGEX_CACHE_MAX_BYTES ||
+			hash_get_num_entries(RegexCache) >= REGEX_CACHE_MAX_ENTRIES))
+	{
+		EvictRegexCacheEntry(dlist_tail_element(RegexCacheEntry, lruNode,
+												&RegexCacheLru));
+	}
+
+	MemoryContextSetParent(entryContext, RegexCacheContext);
+
+	entry = hash_search(RegexCache, &hash, HASH_ENTER, &found);
+	entry->kind = kind;
+	entry->compileOptions = compileOptions;
+	entry->pattern = MemoryContextStrdup(entryContext, regexPatternStr);
+	entry->options = MemoryContextStrdup(entryContext, optionsString);
+	entry->context = entryContext;
+	entry->size = entrySize;
+	entry->pcreData = pcreData;
+	dlist_push_head(&RegexCacheLru, &entry->lruNode);
+	RegexCacheBytes += entrySize;
+
+	return pcreData;
+}
+
+
+/*
+ * Removes the entry from the compiled regex cache. Since a query in the current
+ * transaction may still be using the regex, its memory is handed over to the
+ * transaction and freed when it ends.
+ */
+static void
+EvictRegexCacheEntry(RegexCacheEntry *entry)
+{
+	dlist_delete(&entry->lruNode);
+	RegexCacheBytes -= entry->size;
+
+	MemoryContext entryContext = entry->context;
+	uint64 hash = entry->hash;
+	bool found;
+	hash_search(RegexCache, &hash, HASH_REMOVE, &found);
+
+	if (IsTransactionState() && TopTransactionContext != NULL)
+	{
+		MemoryContextSetParent(entryContext, TopTransactionContext);
+	}
+	else
+	{
+		MemoryContextDelete(entryContext);
+	}
+}
+
+
+/*
+ * Frees the PCRE2 objects of a cached regex when its memory context goes away.
+ */
+static void
+FreeCachedPcreDataCallback(void *arg)
+{
+	PcreData *pcreData = (PcreData *) arg;
+	pcreData->isCached = false;
+	FreePcreData(pcreData);
+}
+
+
 /*
  * allocate memory for the input pointer 'pcreData' and then populate it with the compiled 'pcredata' after compiling the regex expression.
  * If the regex compilation is successful, the function will return true; otherwise, it will return false, while also populating the error code into the input variable 'pcreErrorCode'
  */
 static bool
 RegexCompileCore(char *regexPatternStr, char *options, PcreData **pcreData,
-				 int *pcreErrorCode, int maxPatternLength, uint32_t compileOptions)
+				 int *pcreErrorCode, int maxPatternLength, uint32_t compileOptions,
+				 MemoryContext memoryContext)
 {
 	PCRE2_SIZE errorOffset;
 
@@ -186,7 +430,7 @@ RegexCompileCore(char *regexPatternStr, char *options, PcreData **pcreData,
 
 	/* Creates PCRE2 general and compile contexts. This will be needed to
 	 * register the PG's memory management functions with PCRE2 lib */
-	CreatePcreCompileContext(*pcreData);
+	CreatePcreCompileContext(*pcreData, memoryContext);
 
 	pcre2_set_max_pattern_length((*pcreData)->compileContext, maxPatternLength);
 
@@ -375,7 +619,7 @@ ProcessRegexCompileOptions(char *options)
 void
 FreePcreData(PcreData *pcreData)
 {
-	if (!pcreData)
+	if (!pcreData || pcreData->isCached)
 	{
 		return;
 	}
@@ -391,14 +635,15 @@ FreePcreData(PcreData *pcreData)
 
 
 /*
- * Create Compile Context for PCRE2 matching function
+ * Create Compile Context for PCRE2 matching function. PCRE2 allocates in the
+ * memory context, or the current memory context if NULL.
  */
 static inline void
-CreatePcreCompileContext(PcreData *pcreData)
+CreatePcreCompileContext(PcreData *pcreData, MemoryContext memoryContext)
 {
 	pcreData->generalContext = pcre2_general_context_create(extension_pcre_malloc,
 															extension_pcre_free,
-															NULL);
+															memoryContext);
 	if (pcreData->generalContext == NULL)
 	{
 		ereport(ERROR, (errcode(ERRCODE_DOCUMENTDB_EXCEEDEDMEMORYLIMIT), errmsg(
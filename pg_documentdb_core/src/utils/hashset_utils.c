@@ -141,13 +141,24 @@ StringViewHashEntryCompareFunc(const void *obj1, const void *obj2, Size objsize)
  */
 HTAB *
 CreateBsonValueHashSet()
+{
+	static const int numElements = 32;
+	return CreateBsonValueHashSetWithSize(numElements);
+}
+
+
+/*
+ * Same as CreateBsonValueHashSet, but sizes the hash table upfront for the
+ * expected number of elements to avoid growing it incrementally.
+ */
+HTAB *
+CreateBsonValueHashSetWithSize(long numElements)
 {
 	HASHCTL hashInfo = CreateExtensionHashCTL(
 		sizeof(bson_value_t),
 		sizeof(bson_value_t),
 		BsonValueHashEntryCompareFunc,
 		BsonValueHashFunc);
-	static const int numElements = 32;
 	HTAB *bsonValueHashSet =
 		hash_create("Bson Value Hash Table", numElements, &hashInfo,
 					DefaultExtensionHashFlags);
@@ -227,6 +238,17 @@ BsonValueWithCollationHashEntryCompareFunc(const void *obj1, const void *obj2,
  */
 HTAB *
 CreateBsonValueWithCollationHashSet(int extraDataSize)
+{
+	return CreateBsonValueWithCollationHashSetWithSize(extraDataSize, 32);
+}
+
+
+/*
+ * Same as CreateBsonValueWithCollationHashSet, but sizes the hash table upfront
+ * for the expected number of elements to avoid growing it incrementally.
+ */
+HTAB *
+CreateBsonValueWithCollationHashSetWithSize(int extraDataSize, long numElements)
 {
 	HASHCTL hashInfo = CreateExtensionHashCTL(
 		sizeof(BsonValueHashEntry) + extraDataSize,
@@ -235,7 +257,8 @@ CreateBsonValueWithCollationHashSet(int extraDataSize)
 		BsonValueWithCollationHashFunc);
 
 	HTAB *bsonElementHashSet =
-		hash_create("Bson Value Hash Table", 32, &hashInfo, DefaultExtensionHashFlags);
+		hash_create("Bson Value Hash Table", numElements, &hashInfo,
+					DefaultExtensionHashFlags);
 
 	return bsonElementHashSet;
 }
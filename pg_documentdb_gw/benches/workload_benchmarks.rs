@@ -0,0 +1,457 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * benches/workload_benchmarks.rs
+ *
+ * End to end workload benchmarks through the gateway. Each workload is a
+ * weighted mix of operations (YCSB style point reads, range scans, updates,
+ * inserts, and aggregation pipelines) that runs for a fixed duration from a
+ * number of concurrent clients, and reports the throughput and the latency
+ * percentiles of each of its operations.
+ *
+ *   cargo bench --bench workload_benchmarks
+ *
+ * Configuration (environment variables):
+ *   BENCH_URI          connection string of a running gateway; when unset the
+ *                      gateway is started in process as in the tests
+ *   BENCH_WORKLOADS    comma separated workloads to run (default: all)
+ *   BENCH_CONCURRENCY  concurrent clients (default: 8)
+ *   BENCH_DURATION     seconds each workload runs (default: 10)
+ *   BENCH_RECORDS      documents loaded before the workloads (default: 10000)
+ *   BENCH_OUTPUT       path of a CSV file to write the results to
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use std::{
+    env,
+    fs::File,
+    io::Write,
+    sync::{
+        atomic::{AtomicI64, Ordering},
+        Arc,
+    },
+    time::{Duration, Instant},
+};
+
+use bson::{doc, Document};
+use mongodb::{error::Result, Client, Collection, IndexModel};
+use rand::{rngs::StdRng, Rng, SeedableRng};
+
+#[path = "../tests/common/mod.rs"]
+mod common;
+
+const DATABASE: &str = "workload_benchmarks";
+const USERS: &str = "usertable";
+const CATEGORIES: &str = "categories";
+const FIELD_COUNT: usize = 10;
+const FIELD_LENGTH: usize = 100;
+const CATEGORY_COUNT: i64 = 100;
+const SCAN_LENGTH: i64 = 50;
+const BULK_INSERT_SIZE: i64 = 100;
+
+#[derive(Clone, Copy, Debug, PartialEq)]
+enum Operation {
+    PointRead,
+    RangeScan,
+    Update,
+    Insert,
+    BulkInsert,
+    LookupGroup,
+    Group,
+}
+
+impl Operation {
+    fn name(&self) -> &'static str {
+        match self {
+            Operation::PointRead => "point_read",
+            Operation::RangeScan => "range_scan",
+            Operation::Update => "update",
+            Operation::Insert => "insert",
+            Operation::BulkInsert => "bulk_insert",
+            Operation::LookupGroup => "lookup_group",
+            Operation::Group => "group",
+        }
+    }
+}
+
+struct Workload {
+    name: &'static str,
+
+    // The operations of the workload, with their weights
+    mix: &'static [(Operation, u32)],
+}
+
+const WORKLOADS: &[Workload] = &[
+    // YCSB A: update heavy
+    Workload {
+        name: "ycsb_a",
+        mix: &[(Operation::PointRead, 50), (Operation::Update, 50)],
+    },
+    // YCSB B: read mostly
+    Workload {
+        name: "ycsb_b",
+        mix: &[(Operation::PointRead, 95), (Operation::Update, 5)],
+    },
+    // YCSB C: read only
+    Workload {
+        name: "ycsb_c",
+        mix: &[(Operation::PointRead, 100)],
+    },
+    // YCSB E: short ranges
+    Workload {
+        name: "ycsb_e",
+        mix: &[(Operation::RangeScan, 95), (Operation::Insert, 5)],
+    },
+    Workload {
+        name: "bulk_insert",
+        mix: &[(Operation::BulkInsert, 100)],
+    },
+    Workload {
+        name: "aggregation",
+        mix: &[(Operation::LookupGroup, 50), (Operation::Group, 50)],
+    },
+];
+
+struct BenchmarkConfig {
+    workloads: Vec<String>,
+    concurrency: usize,
+    duration: Duration,
+    records: i64,
+    output: Option<String>,
+}
+
+impl BenchmarkConfig {
+    fn from_env() -> Self {
+        fn parse<T: std::str::FromStr>(name: &str, default: T) -> T {
+            match env::var(name) {
+                Ok(value) => value
+                    .parse()
+                    .unwrap_or_else(|_| panic!("Invalid value for {}: {}", name, value)),
+                Err(_) => default,
+            }
+        }
+
+        let workloads = match env::var("BENCH_WORKLOADS") {
+            Ok(value) => value.split(',').map(|w| w.trim().to_string()).collect(),
+            Err(_) => WORKLOADS.iter().map(|w| w.name.to_string()).collect(),
+        };
+
+        BenchmarkConfig {
+            workloads,
+            concurrency: parse("BENCH_CONCURRENCY", 8),
+            duration: Duration::from_secs(parse("BENCH_DURATION", 10)),
+            records: parse("BENCH_RECORDS", 10000),
+            output: env::var("BENCH_OUTPUT").ok(),
+        }
+    }
+}
+
+struct OperationResult {
+    workload: &'static str,
+    operation: Operation,
+    count: usize,
+    throughput: f64,
+    p50: Duration,
+    p95: Duration,
+    p99: Duration,
+    max: Duration,
+}
+
+// The state shared by the clients of a workload
+struct WorkloadContext {
+    users: Collection<Document>,
+    categories: Collection<Document>,
+
+    // The next _id to insert: Reads and updates pick from the ids below it
+    next_id: AtomicI64,
+    records: i64,
+}
+
+fn make_user(id: i64, rng: &mut StdRng) -> Document {
+    let mut document = doc! {
+        "_id": id,
+        "value": id,
+        "category": id % CATEGORY_COUNT,
+    };
+
+    for i in 0..FIELD_COUNT {
+        let field: String = (0..FIELD_LENGTH)
+            .map(|_| rng.gen_range(b'a'..=b'z') as char)
+            .collect();
+        document.insert(format!("field{}", i), field);
+    }
+
+    document
+}
+
+async fn load(client: &Client, records: i64) -> Result<Arc<WorkloadContext>> {
+    let db = common::setup_db(client, DATABASE).await;
+    let users = db.collection::<Document>(USERS);
+    let categories = db.collection::<Document>(CATEGORIES);
+
+    let mut rng = StdRng::seed_from_u64(0);
+    let mut id = 0;
+    while id < records {
+        let batch: Vec<Document> = (id..records.min(id + 1000))
+            .map(|i| make_user(i, &mut rng))
+            .collect();
+        id += batch.len() as i64;
+        users.insert_many(batch).await?;
+    }
+
+    let category_documents: Vec<Document> = (0..CATEGORY_COUNT)
+        .map(|i| doc! { "_id": i, "name": format!("category{}", i) })
+        .collect();
+    categories.insert_many(category_documents).await?;
+
+    users
+        .create_index(IndexModel::builder().keys(doc! { "value": 1 }).build())
+        .await?;
+    users
+        .create_index(IndexModel::builder().keys(doc! { "category": 1 }).build())
+        .await?;
+
+    Ok(Arc::new(WorkloadContext {
+        users,
+        categories,
+        next_id: AtomicI64::new(records),
+        records,
+    }))
+}
+
+async fn run_operation(
+    context: &WorkloadContext,
+    operation: Operation,
+    rng: &mut StdRng,
+) -> Result<()> {
+    let existing_ids = context.next_id.load(Ordering::Relaxed);
+    match operation {
+        Operation::PointRead => {
+            let id = rng.gen_range(0..existing_ids);
+            context.users.find_one(doc! { "_id": id }).await?;
+        }
+        Operation::RangeScan => {
+            let start = rng.gen_range(0..existing_ids);
+            let mut cursor = context
+                .users
+                .find(doc! { "value": { "$gte": start } })
+                .sort(doc! { "value": 1 })
+                .limit(SCAN_LENGTH)
+                .await?;
+            while cursor.advance().await? {}
+        }
+        Operation::Update => {
+            let id = rng.gen_range(0..existing_ids);
+            let field = format!("field{}", rng.gen_range(0..FIELD_COUNT));
+            let value: String = (0..FIELD_LENGTH)
+                .map(|_| rng.gen_range(b'a'..=b'z') as char)
+                .collect();
+            context
+                .users
+                .update_one(doc! { "_id": id }, doc! { "$set": { field: value } })
+                .await?;
+        }
+        Operation::Insert => {
+            let id = context.next_id.fetch_add(1, Ordering::Relaxed);
+            context.users.insert_one(make_user(id, rng)).await?;
+        }
+        Operation::BulkInsert => {
+            let id = context
+                .next_id
+                .fetch_add(BULK_INSERT_SIZE, Ordering::Relaxed);
+            let batch: Vec<Document> = (id..id + BULK_INSERT_SIZE)
+                .map(|i| make_user(i, rng))
+                .collect();
+            context.users.insert_many(batch).await?;
+        }
+        Operation::LookupGroup => {
+            let start = rng.gen_range(0..context.records);
+            let pipeline = vec![
+                doc! { "$match": { "value": { "$gte": start, "$lt": start + 1000 } } },
+                doc! { "$lookup": {
+                    "from": context.categories.name(),
+                    "localField": "category",
+                    "foreignField": "_id",
+                    "as": "categoryInfo"
+                } },
+                doc! { "$unwind": "$categoryInfo" },
+                doc! { "$group": { "_id": "$categoryInfo.name", "count": { "$sum": 1 } } },
+            ];
+            let mut cursor = context.users.aggregate(pipeline).await?;
+            while cursor.advance().await? {}
+        }
+        Operation::Group => {
+            let category = rng.gen_range(0..CATEGORY_COUNT);
+            let pipeline = vec![
+                doc! { "$match": { "category": { "$gte": category } } },
+                doc! { "$group": {
+                    "_id": "$category",
+                    "count": { "$sum": 1 },
+                    "maxValue": { "$max": "$value" }
+                } },
+                doc! { "$sort": { "count": -1 } },
+                doc! { "$limit": 10 },
+            ];
+            let mut cursor = context.users.aggregate(pipeline).await?;
+            while cursor.advance().await? {}
+        }
+    }
+
+    Ok(())
+}
+
+fn pick_operation(mix: &[(Operation, u32)], rng: &mut StdRng) -> Operation {
+    let total: u32 = mix.iter().map(|(_, weight)| weight).sum();
+    let mut pick = rng.gen_range(0..total);
+    for (operation, weight) in mix {
+        if pick < *weight {
+            return *operation;
+        }
+        pick -= weight;
+    }
+
+    mix[mix.len() - 1].0
+}
+
+fn percentile(sorted: &[Duration], fraction: f64) -> Duration {
+    if sorted.is_empty() {
+        return Duration::ZERO;
+    }
+
+    let index = ((sorted.len() as f64 * fraction).ceil() as usize).clamp(1, sorted.len());
+    sorted[index - 1]
+}
+
+async fn run_workload(
+    context: Arc<WorkloadContext>,
+    workload: &'static Workload,
+    config: &BenchmarkConfig,
+) -> Vec<OperationResult> {
+    let deadline = Instant::now() + config.duration;
+    let mut clients = Vec::with_capacity(config.concurrency);
+    for client in 0..config.concurrency {
+        let context = context.clone();
+        clients.push(tokio::spawn(async move {
+            let mut rng = StdRng::seed_from_u64(client as u64 + 1);
+            let mut latencies: Vec<(Operation, Duration)> = Vec::new();
+            while Instant::now() < deadline {
+                let operation = pick_operation(workload.mix, &mut rng);
+                let start = Instant::now();
+                if let Err(e) = run_operation(&context, operation, &mut rng).await {
+                    log::error!("{} {} failed: {}", workload.name, operation.name(), e);
+                    continue;
+                }
+                latencies.push((operation, start.elapsed()));
+            }
+            latencies
+        }));
+    }
+
+    let mut latencies = Vec::new();
+    for client in clients {
+        latencies.extend(client.await.expect("Benchmark client panicked"));
+    }
+
+    workload
+        .mix
+        .iter()
+        .map(|(operation, _)| {
+            let mut durations: Vec<Duration> = latencies
+                .iter()
+                .filter(|(o, _)| o == operation)
+                .map(|(_, d)| *d)
+                .collect();
+            durations.sort();
+            OperationResult {
+                workload: workload.name,
+                operation: *operation,
+                count: durations.len(),
+                throughput: durations.len() as f64 / config.duration.as_secs_f64(),
+                p50: percentile(&durations, 0.50),
+                p95: percentile(&durations, 0.95),
+                p99: percentile(&durations, 0.99),
+                max: durations.last().copied().unwrap_or(Duration::ZERO),
+            }
+        })
+        .collect()
+}
+
+fn report(results: &[OperationResult], output: Option<&str>) -> std::io::Result<()> {
+    println!(
+        "{:<12} {:<14} {:>10} {:>12} {:>10} {:>10} {:>10} {:>10}",
+        "workload", "operation", "ops", "ops/s", "p50 (us)", "p95 (us)", "p99 (us)", "max (us)"
+    );
+    for r in results {
+        println!(
+            "{:<12} {:<14} {:>10} {:>12.1} {:>10} {:>10} {:>10} {:>10}",
+            r.workload,
+            r.operation.name(),
+            r.count,
+            r.throughput,
+            r.p50.as_micros(),
+            r.p95.as_micros(),
+            r.p99.as_micros(),
+            r.max.as_micros()
+        );
+    }
+
+    if let Some(path) = output {
+        let mut file = File::create(path)?;
+        writeln!(
+            file,
+            "workload,operation,ops,ops_per_sec,p50_us,p95_us,p99_us,max_us"
+        )?;
+        for r in results {
+            writeln!(
+                file,
+                "{},{},{},{:.1},{},{},{},{}",
+                r.workload,
+                r.operation.name(),
+                r.count,
+                r.throughput,
+                r.p50.as_micros(),
+                r.p95.as_micros(),
+                r.p99.as_micros(),
+                r.max.as_micros()
+            )?;
+        }
+    }
+
+    Ok(())
+}
+
+#[tokio::main]
+async fn main() {
+    let config = BenchmarkConfig::from_env();
+
+    let client = match env::var("BENCH_URI") {
+        Ok(uri) => Client::with_uri_str(uri)
+            .await
+            .expect("Failed to connect to the gateway"),
+        Err(_) => common::initialize().await,
+    };
+
+    let mut results = Vec::new();
+    for name in &config.workloads {
+        let workload = WORKLOADS
+            .iter()
+            .find(|w| w.name == name)
+            .unwrap_or_else(|| panic!("Unknown workload: {}", name));
+
+        // Every workload starts from the same data
+        let context = load(&client, config.records)
+            .await
+            .expect("Failed to load the benchmark data");
+
+        log::info!(
+            "Running {} with {} clients for {:?}",
+            workload.name,
+            config.concurrency,
+            config.duration
+        );
+        results.extend(run_workload(context, workload, &config).await);
+    }
+
+    report(&results, config.output.as_deref()).expect("Failed to write the results");
+}
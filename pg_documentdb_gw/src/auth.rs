@@ -6,7 +6,7 @@
  *-------------------------------------------------------------------------
  */
 
-use std::{str::from_utf8, sync::Arc};
+use std::{str::from_utf8, sync::Arc, time::Duration};
 
 use base64::{engine::general_purpose, Engine as _};
 use bson::{rawdoc, spec::BinarySubtype};
@@ -15,7 +15,7 @@ use serde_json::Value;
 use tokio_postgres::types::Type;
 
 use crate::{
-    context::{ConnectionContext, RequestContext},
+    context::{ConnectionContext, RequestContext, ScramSecret},
     error::{DocumentDBError, ErrorCode, Result},
     postgres::{PgDataClient, PgDocument},
     processor,
@@ -30,6 +30,9 @@ pub struct ScramFirstState {
     nonce: String,
     first_message_bare: String,
     first_message: String,
+
+    // The cached secret to verify the client proof with, None to verify it in Postgres
+    secret: Option<Arc<ScramSecret>>,
 }
 
 pub struct AuthState {
@@ -176,13 +179,19 @@ async fn handle_scram(
 
     let server_nonce = generate_server_nonce(client_nonce);
 
-    let (salt, iterations) = get_salt_and_iteration(connection_context, username).await?;
+    validate_username(connection_context, username)?;
+    let secret = get_scram_secret(connection_context, username, false).await;
+    let (salt, iterations) = match secret.as_ref() {
+        Some(secret) => (secret.salt.clone(), secret.iterations),
+        None => get_salt_and_iteration(connection_context, username).await?,
+    };
     let response = format!("r={},s={},i={}", server_nonce, salt, iterations);
 
     connection_context.auth_state.first_state = Some(ScramFirstState {
         nonce: server_nonce,
         first_message_bare: format!("n={},r={}", username, client_nonce),
         first_message: response.clone(),
+        secret,
     });
 
     connection_context.auth_state.username = Some(username.to_string());
@@ -370,40 +379,16 @@ async fn handle_sasl_continue(
             client_nonce
         );
 
-        let scram_sha256_row = connection_context
-            .service_context
-            .authentication_connection()
-            .await?
-            .query(
-                connection_context
-                    .service_context
-                    .query_catalog()
-                    .authenticate_with_scram_sha256(),
-                &[Type::TEXT, Type::TEXT, Type::TEXT],
-                &[&username, &auth_message, &proof],
-                None,
-                &mut RequestTracker::new(),
-            )
-            .await?;
-
-        let scram_sha256_doc: PgDocument = scram_sha256_row
-            .first()
-            .ok_or(DocumentDBError::pg_response_empty())?
-            .try_get(0)?;
-
-        if scram_sha256_doc
-            .0
-            .get_i32("ok")
-            .map_err(DocumentDBError::pg_response_invalid)?
-            != 1
-        {
-            return Err(DocumentDBError::unauthorized("Invalid key".to_string()));
-        }
-
-        let server_signature = scram_sha256_doc
-            .0
-            .get_str("ServerSignature")
-            .map_err(DocumentDBError::pg_response_invalid)?;
+        let (server_signature, user_oid) = match first_state.secret.as_ref() {
+            Some(secret) => {
+                verify_client_proof(connection_context, username, secret, &auth_message, proof)
+                    .await?
+            }
+            None => {
+                authenticate_with_scram_sha256(connection_context, username, &auth_message, proof)
+                    .await?
+            }
+        };
 
         let payload = bson::Binary {
             subtype: BinarySubtype::Generic,
@@ -411,8 +396,7 @@ async fn handle_sasl_continue(
         };
 
         connection_context.auth_state.password = Some("".to_string());
-        connection_context.auth_state.user_oid =
-            Some(get_user_oid(connection_context, username).await?);
+        connection_context.auth_state.user_oid = Some(user_oid);
         connection_context.auth_state.authorized = true;
 
         Ok(Response::Raw(RawResponse(rawdoc! {
@@ -428,6 +412,91 @@ async fn handle_sasl_continue(
     }
 }
 
+// Verifies the client proof in Postgres, returning the server signature and the user's oid
+async fn authenticate_with_scram_sha256(
+    connection_context: &ConnectionContext,
+    username: &str,
+    auth_message: &str,
+    proof: &str,
+) -> Result<(String, u32)> {
+    let scram_sha256_row = connection_context
+        .service_context
+        .authentication_connection()
+        .await?
+        .query(
+            connection_context
+                .service_context
+                .query_catalog()
+                .authenticate_with_scram_sha256(),
+            &[Type::TEXT, Type::TEXT, Type::TEXT],
+            &[&username, &auth_message, &proof],
+            None,
+            &mut RequestTracker::new(),
+        )
+        .await?;
+
+    let scram_sha256_doc: PgDocument = scram_sha256_row
+        .first()
+        .ok_or(DocumentDBError::pg_response_empty())?
+        .try_get(0)?;
+
+    if scram_sha256_doc
+        .0
+        .get_i32("ok")
+        .map_err(DocumentDBError::pg_response_invalid)?
+        != 1
+    {
+        return Err(DocumentDBError::unauthorized("Invalid key".to_string()));
+    }
+
+    let server_signature = scram_sha256_doc
+        .0
+        .get_str("ServerSignature")
+        .map_err(DocumentDBError::pg_response_invalid)?;
+
+    Ok((
+        server_signature.to_string(),
+        get_user_oid(connection_context, username).await?,
+    ))
+}
+
+// Verifies the client proof with the cached secret of the user, returning the server
+// signature and the user's oid. A proof the cached secret rejects is checked again
+// with the current secret, in case the password changed since it was cached.
+async fn verify_client_proof(
+    connection_context: &ConnectionContext,
+    username: &str,
+    secret: &Arc<ScramSecret>,
+    auth_message: &str,
+    proof: &str,
+) -> Result<(String, u32)> {
+    let proof = general_purpose::STANDARD
+        .decode(proof)
+        .map_err(|_| DocumentDBError::unauthorized("Invalid key".to_string()))?;
+
+    if let Some(server_signature) = secret.verify_client_proof(auth_message, &proof)? {
+        return Ok((
+            general_purpose::STANDARD.encode(server_signature),
+            secret.role_oid,
+        ));
+    }
+
+    // The salt is part of the auth message, a proof for another salt can't be valid
+    if let Some(current_secret) = get_scram_secret(connection_context, username, true)
+        .await
+        .filter(|current| current.salt == secret.salt && current.iterations == secret.iterations)
+    {
+        if let Some(server_signature) = current_secret.verify_client_proof(auth_message, &proof)? {
+            return Ok((
+                general_purpose::STANDARD.encode(server_signature),
+                current_secret.role_oid,
+            ));
+        }
+    }
+
+    Err(DocumentDBError::unauthorized("Invalid key".to_string()))
+}
+
 struct ScramPayload<'a> {
     username: Option<&'a str>,
     nonce: Option<&'a str>,
@@ -496,10 +565,7 @@ fn parse_sasl_payload<'a, 'b: 'a>(
     })
 }
 
-async fn get_salt_and_iteration(
-    connection_context: &ConnectionContext,
-    username: &str,
-) -> Result<(String, i32)> {
+fn validate_username(connection_context: &ConnectionContext, username: &str) -> Result<()> {
     for blocked_prefix in connection_context
         .service_context
         .setup_configuration()
@@ -514,7 +580,117 @@ async fn get_salt_and_iteration(
             ));
         }
     }
+    Ok(())
+}
+
+// Returns the SCRAM secret of the user from the cache, or from Postgres when it's not
+// cached or refresh is set. None means the login is verified in Postgres instead.
+async fn get_scram_secret(
+    connection_context: &ConnectionContext,
+    username: &str,
+    refresh: bool,
+) -> Option<Arc<ScramSecret>> {
+    let max_age = Duration::from_secs(
+        connection_context
+            .service_context
+            .dynamic_configuration()
+            .scram_secret_cache_secs()
+            .await,
+    );
+    if max_age.is_zero() {
+        return None;
+    }
+
+    let cache = connection_context.service_context.scram_secret_cache();
+    if !refresh {
+        if let Some(secret) = cache.get(username, max_age) {
+            return Some(secret);
+        }
+    }
+
+    match fetch_scram_secret(connection_context, username).await {
+        Ok(Some(secret)) => {
+            let secret = Arc::new(secret);
+            cache.insert(username, Arc::clone(&secret));
+            Some(secret)
+        }
+        Ok(None) => {
+            cache.invalidate(username);
+            None
+        }
+        Err(e) => {
+            log::warn!(
+                "Failed to get the SCRAM secret, verifying the login in Postgres: {}",
+                e
+            );
+            None
+        }
+    }
+}
+
+async fn fetch_scram_secret(
+    connection_context: &ConnectionContext,
+    username: &str,
+) -> Result<Option<ScramSecret>> {
+    let results = connection_context
+        .service_context
+        .authentication_connection()
+        .await?
+        .query(
+            connection_context
+                .service_context
+                .query_catalog()
+                .scram_sha256_get_secret(),
+            &[Type::TEXT],
+            &[&username],
+            None,
+            &mut RequestTracker::new(),
+        )
+        .await?;
+
+    let doc: PgDocument = results
+        .first()
+        .ok_or(DocumentDBError::pg_response_empty())?
+        .try_get(0)?;
+    if doc
+        .0
+        .get_i32("ok")
+        .map_err(DocumentDBError::pg_response_invalid)?
+        != 1
+    {
+        return Ok(None);
+    }
+
+    let decode_key = |key: &str| -> Result<Vec<u8>> {
+        let encoded = doc
+            .0
+            .get_str(key)
+            .map_err(DocumentDBError::pg_response_invalid)?;
+        general_purpose::STANDARD.decode(encoded).map_err(|e| {
+            DocumentDBError::internal_error(format!("Failed to decode the {}: {}", key, e))
+        })
+    };
 
+    Ok(Some(ScramSecret::new(
+        doc.0
+            .get_str("salt")
+            .map_err(DocumentDBError::pg_response_invalid)?
+            .to_string(),
+        doc.0
+            .get_i32("iterations")
+            .map_err(DocumentDBError::pg_response_invalid)?,
+        doc.0
+            .get_i64("roleOid")
+            .map_err(DocumentDBError::pg_response_invalid)? as u32,
+        &decode_key("StoredKey")?,
+        &decode_key("ServerKey")?,
+    )?))
+}
+
+async fn get_salt_and_iteration(
+    connection_context: &ConnectionContext,
+    username: &str,
+) -> Result<(String, i32)> {
     let results = connection_context
         .service_context
         .authentication_connection()
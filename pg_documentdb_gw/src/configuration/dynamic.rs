@@ -64,6 +64,28 @@ pub trait DynamicConfiguration: Send + Sync + Debug {
             || self.get_bool("simulateReadReplica", false).await
     }
 
+    /// The most requests a user runs at a time, 0 for no limit.
+    async fn max_concurrent_requests_per_user(&self) -> usize {
+        self.get_i32("maxConcurrentRequestsPerUser", 0).await.max(0) as usize
+    }
+
+    /// The most long running requests (e.g. aggregations) a user runs at a time, 0 for no limit.
+    async fn max_concurrent_long_requests_per_user(&self) -> usize {
+        self.get_i32("maxConcurrentLongRequestsPerUser", 0)
+            .await
+            .max(0) as usize
+    }
+
+    /// The most requests a user starts per second, 0 for no limit.
+    async fn max_requests_per_second_per_user(&self) -> u32 {
+        self.get_i32("maxRequestsPerSecondPerUser", 0).await.max(0) as u32
+    }
+
+    /// How far behind the primary a replica may be to serve reads without a maxStalenessSeconds.
+    async fn max_replica_lag_secs(&self) -> u64 {
+        self.get_i32("maxReplicaLagSeconds", 30).await.max(0) as u64
+    }
+
     async fn max_write_batch_size(&self) -> i32 {
         self.get_i32("maxWriteBatchSize", 100000).await
     }
@@ -72,6 +94,11 @@ pub trait DynamicConfiguration: Send + Sync + Debug {
         self.get_bool("readOnly", false).await
     }
 
+    /// How long the SCRAM secrets of users are cached to verify their logins, 0 to disable the cache.
+    async fn scram_secret_cache_secs(&self) -> u64 {
+        self.get_i32("scramSecretCacheSeconds", 300).await.max(0) as u64
+    }
+
     async fn send_shutdown_responses(&self) -> bool {
         self.get_bool("SendShutdownResponses", false).await
     }
@@ -44,6 +44,13 @@ pub trait SetupConfiguration: DynClone + Send + Sync + Debug {
     /// Returns the port number of the backend PostgreSQL server.
     fn postgres_port(&self) -> u16;
 
+    /// Returns the hostnames of the read replicas of the backend PostgreSQL server.
+    fn postgres_replica_host_names(&self) -> &[String];
+
+    /// Indicates whether commands touching a single shard are sent straight to the
+    /// worker holding it. Requires the Citus metadata to be synced to the workers.
+    fn enable_shard_aware_routing(&self) -> bool;
+
     /// Returns the system user for connecting to the backend PostgreSQL server.
     fn postgres_system_user(&self) -> String;
 
@@ -57,6 +64,9 @@ pub trait SetupConfiguration: DynClone + Send + Sync + Debug {
     /// Returns the port number on which the gateway listens.
     fn gateway_listen_port(&self) -> u16;
 
+    /// Returns the port on which the request metrics are served, if they're exported.
+    fn metrics_listen_port(&self) -> Option<u16>;
+
     /// Returns a list of role prefixes that are blocked.
     fn blocked_role_prefixes(&self) -> &[String];
 
@@ -75,6 +85,9 @@ pub trait SetupConfiguration: DynClone + Send + Sync + Debug {
     /// Returns the time to wait for PostgreSQL to start up before giving up.
     fn postgres_startup_wait_time_seconds(&self) -> u64;
 
+    /// Returns the number of connections each pool keeps open while idle.
+    fn postgres_pool_min_idle_connections(&self) -> usize;
+
     /// Provides a way to downcast the trait object to a concrete type.
     fn as_any(&self) -> &dyn std::any::Any;
 }
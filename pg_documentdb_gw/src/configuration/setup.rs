@@ -28,12 +28,16 @@ pub struct DocumentDBSetupConfiguration {
     // Gateway listener configuration
     pub use_local_host: Option<bool>,
     pub gateway_listen_port: Option<u16>,
+    pub metrics_listen_port: Option<u16>,
 
     // Postgres configuration
     pub postgres_system_user: Option<String>,
     pub postgres_host_name: Option<String>,
     pub postgres_port: Option<u16>,
     pub postgres_database: Option<String>,
+    #[serde(default)]
+    pub postgres_replica_host_names: Vec<String>,
+    pub enable_shard_aware_routing: Option<bool>,
 
     #[serde(default)]
     pub allow_transaction_snapshot: Option<bool>,
@@ -46,6 +50,7 @@ pub struct DocumentDBSetupConfiguration {
     pub dynamic_configuration_refresh_interval_secs: Option<u32>,
     pub postgres_command_timeout_secs: Option<u64>,
     pub postgres_startup_wait_time_seconds: Option<u64>,
+    pub postgres_pool_min_idle_connections: Option<usize>,
 }
 
 impl DocumentDBSetupConfiguration {
@@ -71,6 +76,14 @@ impl SetupConfiguration for DocumentDBSetupConfiguration {
         self.postgres_port.unwrap_or(9712)
     }
 
+    fn postgres_replica_host_names(&self) -> &[String] {
+        &self.postgres_replica_host_names
+    }
+
+    fn enable_shard_aware_routing(&self) -> bool {
+        self.enable_shard_aware_routing.unwrap_or(false)
+    }
+
     fn postgres_database(&self) -> &str {
         self.postgres_database.as_deref().unwrap_or("postgres")
     }
@@ -106,6 +119,10 @@ impl SetupConfiguration for DocumentDBSetupConfiguration {
         self.gateway_listen_port.unwrap_or(10260)
     }
 
+    fn metrics_listen_port(&self) -> Option<u16> {
+        self.metrics_listen_port
+    }
+
     fn blocked_role_prefixes(&self) -> &[String] {
         &self.blocked_role_prefixes
     }
@@ -131,4 +148,8 @@ impl SetupConfiguration for DocumentDBSetupConfiguration {
     fn postgres_startup_wait_time_seconds(&self) -> u64 {
         self.postgres_startup_wait_time_seconds.unwrap_or(60)
     }
+
+    fn postgres_pool_min_idle_connections(&self) -> usize {
+        self.postgres_pool_min_idle_connections.unwrap_or(1)
+    }
 }
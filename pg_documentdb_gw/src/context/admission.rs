@@ -0,0 +1,235 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/context/admission.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use std::{
+    collections::HashMap,
+    sync::{Arc, Mutex},
+    time::Duration,
+};
+
+use tokio::{
+    sync::{OwnedSemaphorePermit, Semaphore},
+    time::Instant,
+};
+
+use crate::{
+    configuration::DynamicConfiguration,
+    error::{DocumentDBError, Result},
+    requests::{request_tracker::RequestTracker, RequestIntervalKind, RequestType},
+};
+
+/// Holds the admission of a request until it's dropped once the request is processed.
+pub struct AdmissionPermit {
+    _request: Option<OwnedSemaphorePermit>,
+    _long_request: Option<OwnedSemaphorePermit>,
+}
+
+// A concurrency limit, replaced when the configured limit changes. Requests admitted by
+// a replaced semaphore release their permits to it, so the limit applies to new requests.
+#[derive(Default)]
+struct ConcurrencyLane {
+    limit: usize,
+    semaphore: Option<Arc<Semaphore>>,
+}
+
+impl ConcurrencyLane {
+    // Whether a request admitted by the lane still holds its permit
+    fn in_use(&self) -> bool {
+        self.semaphore
+            .as_ref()
+            .is_some_and(|semaphore| Arc::strong_count(semaphore) > 1)
+    }
+
+    fn semaphore(&mut self, limit: usize) -> Option<Arc<Semaphore>> {
+        if limit == 0 {
+            self.limit = 0;
+            self.semaphore = None;
+        } else if self.limit != limit || self.semaphore.is_none() {
+            self.limit = limit;
+            self.semaphore = Some(Arc::new(Semaphore::new(limit)));
+        }
+        self.semaphore.clone()
+    }
+}
+
+// A token bucket refilled at the allowed requests per second, up to one second of burst.
+struct RateLimiter {
+    tokens: f64,
+    last_refill: Instant,
+}
+
+impl RateLimiter {
+    // Takes a token and returns how long the request has to wait for it
+    fn reserve(&mut self, requests_per_second: f64) -> Duration {
+        let now = Instant::now();
+        self.tokens = (self.tokens
+            + now.duration_since(self.last_refill).as_secs_f64() * requests_per_second)
+            .min(requests_per_second);
+        self.last_refill = now;
+
+        self.tokens -= 1.0;
+        if self.tokens >= 0.0 {
+            Duration::ZERO
+        } else {
+            Duration::from_secs_f64(-self.tokens / requests_per_second)
+        }
+    }
+}
+
+struct UserAdmission {
+    requests: ConcurrencyLane,
+    long_requests: ConcurrencyLane,
+    rate_limiter: Option<RateLimiter>,
+    last_used: Instant,
+}
+
+impl UserAdmission {
+    fn new() -> Self {
+        UserAdmission {
+            requests: ConcurrencyLane::default(),
+            long_requests: ConcurrencyLane::default(),
+            rate_limiter: None,
+            last_used: Instant::now(),
+        }
+    }
+}
+
+/// Limits the requests each user runs at a time and per second, so that one user's
+/// load doesn't take the connections of everyone else. Long running commands (e.g.
+/// aggregations) have their own, lower limit so that they queue behind each other
+/// rather than ahead of the user's point operations.
+#[derive(Default)]
+pub struct AdmissionController {
+    users: Mutex<HashMap<String, UserAdmission>>,
+}
+
+impl AdmissionController {
+    pub fn new() -> Self {
+        AdmissionController::default()
+    }
+
+    /// Waits until the request of the user may run, recording the time it was queued for.
+    pub async fn admit(
+        &self,
+        dynamic_configuration: &dyn DynamicConfiguration,
+        user: &str,
+        request_type: &RequestType,
+        request_tracker: &mut RequestTracker,
+    ) -> Result<AdmissionPermit> {
+        let max_requests = dynamic_configuration
+            .max_concurrent_requests_per_user()
+            .await;
+        let max_long_requests = dynamic_configuration
+            .max_concurrent_long_requests_per_user()
+            .await;
+        let requests_per_second = dynamic_configuration
+            .max_requests_per_second_per_user()
+            .await;
+
+        if max_requests == 0 && max_long_requests == 0 && requests_per_second == 0 {
+            return Ok(AdmissionPermit {
+                _request: None,
+                _long_request: None,
+            });
+        }
+
+        let is_long_request = is_long_running(request_type);
+        let (request_semaphore, long_request_semaphore, rate_limit_wait) = {
+            let mut users = self.users.lock().map_err(|_| {
+                DocumentDBError::internal_error("Admission control state was poisoned".to_string())
+            })?;
+            let admission = users
+                .entry(user.to_string())
+                .or_insert_with(UserAdmission::new);
+            admission.last_used = Instant::now();
+
+            let rate_limit_wait = if requests_per_second == 0 {
+                admission.rate_limiter = None;
+                Duration::ZERO
+            } else {
+                let rate = requests_per_second as f64;
+                admission
+                    .rate_limiter
+                    .get_or_insert_with(|| RateLimiter {
+                        tokens: rate,
+                        last_refill: Instant::now(),
+                    })
+                    .reserve(rate)
+            };
+
+            let long_request_semaphore = if is_long_request {
+                admission.long_requests.semaphore(max_long_requests)
+            } else {
+                None
+            };
+            (
+                admission.requests.semaphore(max_requests),
+                long_request_semaphore,
+                rate_limit_wait,
+            )
+        };
+
+        let queue_start = request_tracker.start_timer();
+        if !rate_limit_wait.is_zero() {
+            tokio::time::sleep(rate_limit_wait).await;
+        }
+
+        // The long lane is entered first so that queued long requests don't hold
+        // the permits the user's point operations need
+        let long_request = match long_request_semaphore {
+            Some(semaphore) => Some(semaphore.acquire_owned().await.map_err(|_| {
+                DocumentDBError::internal_error("Admission control was closed".to_string())
+            })?),
+            None => None,
+        };
+        let request = match request_semaphore {
+            Some(semaphore) => Some(semaphore.acquire_owned().await.map_err(|_| {
+                DocumentDBError::internal_error("Admission control was closed".to_string())
+            })?),
+            None => None,
+        };
+        request_tracker.record_duration(RequestIntervalKind::AdmissionQueue, queue_start);
+
+        Ok(AdmissionPermit {
+            _request: request,
+            _long_request: long_request,
+        })
+    }
+
+    /// Forgets the users that sent no request for max_age, keeping those with requests in
+    /// flight so that their limits still count the permits those requests hold.
+    pub fn clean_idle_users(&self, max_age: Duration) {
+        if let Ok(mut users) = self.users.lock() {
+            users.retain(|_, admission| {
+                admission.last_used.elapsed() <= max_age
+                    || admission.requests.in_use()
+                    || admission.long_requests.in_use()
+            });
+        }
+    }
+}
+
+/// Whether the request may run for long in Postgres, as opposed to a point operation.
+fn is_long_running(request_type: &RequestType) -> bool {
+    matches!(
+        request_type,
+        RequestType::Aggregate
+            | RequestType::CollStats
+            | RequestType::Compact
+            | RequestType::Count
+            | RequestType::CreateIndex
+            | RequestType::CreateIndexes
+            | RequestType::DbStats
+            | RequestType::Distinct
+            | RequestType::Explain
+            | RequestType::ReIndex
+            | RequestType::ReshardCollection
+            | RequestType::ShardCollection
+            | RequestType::Validate
+    )
+}
@@ -32,6 +32,7 @@ pub struct ConnectionContext {
     pub service_context: Arc<ServiceContext>,
     pub auth_state: AuthState,
     pub requires_response: bool,
+    pub exhaust_allowed: bool,
     pub client_information: Option<RawDocumentBuf>,
     pub transaction: Option<(Vec<u8>, i64)>,
     pub telemetry_provider: Option<Box<dyn TelemetryProvider>>,
@@ -63,6 +64,7 @@ impl ConnectionContext {
     pub async fn add_cursor(
         &self,
         conn: Option<Arc<Connection>>,
+        replica_index: Option<usize>,
         cursor: Cursor,
         username: &str,
         db: &str,
@@ -72,6 +74,7 @@ impl ConnectionContext {
         let key = (cursor.cursor_id, username.to_string());
         let value = CursorStoreEntry {
             conn,
+            replica_index,
             cursor,
             db: db.to_string(),
             collection: collection.to_string(),
@@ -117,6 +120,7 @@ impl ConnectionContext {
             service_context: Arc::new(service_context),
             auth_state: AuthState::new(),
             requires_response: true,
+            exhaust_allowed: false,
             client_information: None,
             transaction: None,
             telemetry_provider,
@@ -7,16 +7,19 @@
  */
 
 use std::{
-    collections::HashMap,
+    collections::{HashMap, HashSet},
     sync::Arc,
     time::{Duration, Instant},
 };
 
 use bson::RawDocumentBuf;
-use tokio::{sync::RwLock, task::JoinHandle};
+use tokio::{sync::Mutex, task::JoinHandle};
 
 use crate::{configuration::SetupConfiguration, postgres::Connection};
 
+// The number of independently locked partitions of the cursor store
+const CURSOR_STORE_SHARD_COUNT: usize = 32;
+
 #[derive(Debug)]
 pub struct Cursor {
     pub continuation: RawDocumentBuf,
@@ -25,6 +28,9 @@ pub struct Cursor {
 
 pub struct CursorStoreEntry {
     pub conn: Option<Arc<Connection>>,
+
+    // The read replica the cursor was opened on, None for the primary
+    pub replica_index: Option<usize>,
     pub cursor: Cursor,
     pub db: String,
     pub collection: String,
@@ -32,26 +38,98 @@ pub struct CursorStoreEntry {
     pub session_id: Option<Vec<u8>>,
 }
 
+type CursorKey = (i64, String);
+
+// A partition of the cursors, indexed by namespace and session so that
+// invalidations only visit the cursors they remove.
+#[derive(Default)]
+struct CursorShard {
+    cursors: HashMap<CursorKey, CursorStoreEntry>,
+    by_namespace: HashMap<(String, String), HashSet<CursorKey>>,
+    by_session: HashMap<Vec<u8>, HashSet<CursorKey>>,
+}
+
+impl CursorShard {
+    fn insert(&mut self, k: CursorKey, v: CursorStoreEntry) {
+        self.remove(&k);
+
+        self.by_namespace
+            .entry((v.db.clone(), v.collection.clone()))
+            .or_default()
+            .insert(k.clone());
+        if let Some(session_id) = &v.session_id {
+            self.by_session
+                .entry(session_id.clone())
+                .or_default()
+                .insert(k.clone());
+        }
+        self.cursors.insert(k, v);
+    }
+
+    fn remove(&mut self, k: &CursorKey) -> Option<CursorStoreEntry> {
+        let entry = self.cursors.remove(k)?;
+
+        let namespace = (entry.db.clone(), entry.collection.clone());
+        if let Some(keys) = self.by_namespace.get_mut(&namespace) {
+            keys.remove(k);
+            if keys.is_empty() {
+                self.by_namespace.remove(&namespace);
+            }
+        }
+
+        if let Some(session_id) = &entry.session_id {
+            if let Some(keys) = self.by_session.get_mut(session_id) {
+                keys.remove(k);
+                if keys.is_empty() {
+                    self.by_session.remove(session_id);
+                }
+            }
+        }
+
+        Some(entry)
+    }
+
+    fn remove_all(&mut self, keys: HashSet<CursorKey>) {
+        for k in keys {
+            self.remove(&k);
+        }
+    }
+
+    fn remove_expired(&mut self, cursor_timeout: Duration) {
+        let expired: HashSet<CursorKey> = self
+            .cursors
+            .iter()
+            .filter(|(_, v)| v.timestamp.elapsed() >= cursor_timeout)
+            .map(|(k, _)| k.clone())
+            .collect();
+        self.remove_all(expired);
+    }
+}
+
 // Maps CursorId, Username -> Connection, Cursor
 pub struct CursorStore {
-    cursors: Arc<RwLock<HashMap<(i64, String), CursorStoreEntry>>>,
+    shards: Arc<Vec<Mutex<CursorShard>>>,
     _reaper: Option<JoinHandle<()>>,
 }
 
 impl CursorStore {
     pub fn new(config: &dyn SetupConfiguration, use_reaper: bool) -> Self {
-        let cursors: Arc<RwLock<HashMap<(i64, String), CursorStoreEntry>>> =
-            Arc::new(RwLock::new(HashMap::new()));
+        let shards: Arc<Vec<Mutex<CursorShard>>> = Arc::new(
+            (0..CURSOR_STORE_SHARD_COUNT)
+                .map(|_| Mutex::new(CursorShard::default()))
+                .collect(),
+        );
         let cursor_timeout = Duration::from_secs(config.cursor_timeout_secs());
 
-        let cursors_clone = cursors.clone();
+        let shards_clone = shards.clone();
         let reaper = if use_reaper {
             Some(tokio::spawn(async move {
                 let mut interval = tokio::time::interval(cursor_timeout / 10);
                 loop {
                     interval.tick().await;
-                    let mut cursors = cursors_clone.write().await;
-                    cursors.retain(|_, v| v.timestamp.elapsed() < cursor_timeout)
+                    for shard in shards_clone.iter() {
+                        shard.lock().await.remove_expired(cursor_timeout);
+                    }
                 }
             }))
         } else {
@@ -59,43 +137,66 @@ impl CursorStore {
         };
 
         CursorStore {
-            cursors,
+            shards,
             _reaper: reaper,
         }
     }
 
+    fn shard(&self, cursor_id: i64) -> &Mutex<CursorShard> {
+        &self.shards[cursor_id.rem_euclid(CURSOR_STORE_SHARD_COUNT as i64) as usize]
+    }
+
     pub async fn add_cursor(&self, k: (i64, String), v: CursorStoreEntry) {
-        let mut cursors = self.cursors.write().await;
-        cursors.insert(k, v);
+        self.shard(k.0).lock().await.insert(k, v);
     }
 
     pub async fn get_cursor(&self, k: (i64, String)) -> Option<CursorStoreEntry> {
-        let mut cursors = self.cursors.write().await;
-        cursors.remove(&k)
+        self.shard(k.0).lock().await.remove(&k)
     }
 
     pub async fn invalidate_cursors_by_collection(&self, db: &str, collection: &str) {
-        let mut cursors = self.cursors.write().await;
-        cursors.retain(|_, v| !(v.collection == collection && v.db == db))
+        let namespace = (db.to_owned(), collection.to_owned());
+        for shard in self.shards.iter() {
+            let mut shard = shard.lock().await;
+            if let Some(keys) = shard.by_namespace.remove(&namespace) {
+                shard.remove_all(keys);
+            }
+        }
     }
 
     pub async fn invalidate_cursors_by_database(&self, db: &str) {
-        let mut cursors = self.cursors.write().await;
-        cursors.retain(|_, v| v.db != db)
+        for shard in self.shards.iter() {
+            let mut shard = shard.lock().await;
+            let namespaces: Vec<(String, String)> = shard
+                .by_namespace
+                .keys()
+                .filter(|(namespace_db, _)| namespace_db == db)
+                .cloned()
+                .collect();
+            for namespace in namespaces {
+                if let Some(keys) = shard.by_namespace.remove(&namespace) {
+                    shard.remove_all(keys);
+                }
+            }
+        }
     }
 
     pub async fn invalidate_cursors_by_session(&self, session: &[u8]) {
-        let mut cursors = self.cursors.write().await;
-        cursors.retain(|_, v| v.session_id.as_deref() != Some(session))
+        for shard in self.shards.iter() {
+            let mut shard = shard.lock().await;
+            if let Some(keys) = shard.by_session.remove(session) {
+                shard.remove_all(keys);
+            }
+        }
     }
 
     pub async fn kill_cursors(&self, user: String, cursors: &[i64]) -> (Vec<i64>, Vec<i64>) {
         let mut removed_cursors = Vec::new();
         let mut missing_cursors = Vec::new();
 
-        let mut cursor_store = self.cursors.write().await;
         for cursor in cursors.iter() {
-            if cursor_store.remove(&(*cursor, user.clone())).is_some() {
+            let key = (*cursor, user.clone());
+            if self.shard(*cursor).lock().await.remove(&key).is_some() {
                 removed_cursors.push(*cursor);
             } else {
                 missing_cursors.push(*cursor);
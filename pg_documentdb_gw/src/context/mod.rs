@@ -6,13 +6,17 @@
  *-------------------------------------------------------------------------
  */
 
+mod admission;
 mod connection;
 mod cursor;
 mod request;
+mod scram_secret_cache;
 mod service;
 mod transaction;
 
+pub use admission::{AdmissionController, AdmissionPermit};
 pub use cursor::{Cursor, CursorStore, CursorStoreEntry};
+pub use scram_secret_cache::{ScramSecret, ScramSecretCache};
 
 pub use transaction::{RequestTransactionInfo, Transaction, TransactionStore};
 
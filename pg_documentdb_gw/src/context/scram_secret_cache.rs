@@ -0,0 +1,131 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/context/scram_secret_cache.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use std::{
+    collections::HashMap,
+    sync::{Arc, Mutex},
+    time::{Duration, Instant},
+};
+
+use openssl::{hash::MessageDigest, memcmp, pkey::PKey, sha::sha256, sign::Signer};
+
+use crate::error::{DocumentDBError, Result};
+
+pub const SCRAM_KEY_LENGTH: usize = 32;
+
+/// The SCRAM-SHA-256 secret of a user, with which client proofs are verified
+/// without a round trip to Postgres.
+pub struct ScramSecret {
+    pub salt: String,
+    pub iterations: i32,
+    pub role_oid: u32,
+    stored_key: [u8; SCRAM_KEY_LENGTH],
+    server_key: [u8; SCRAM_KEY_LENGTH],
+}
+
+impl ScramSecret {
+    pub fn new(
+        salt: String,
+        iterations: i32,
+        role_oid: u32,
+        stored_key: &[u8],
+        server_key: &[u8],
+    ) -> Result<Self> {
+        let stored_key = stored_key.try_into().map_err(|_| {
+            DocumentDBError::internal_error("StoredKey has an invalid length".to_string())
+        })?;
+        let server_key = server_key.try_into().map_err(|_| {
+            DocumentDBError::internal_error("ServerKey has an invalid length".to_string())
+        })?;
+
+        Ok(ScramSecret {
+            salt,
+            iterations,
+            role_oid,
+            stored_key,
+            server_key,
+        })
+    }
+
+    /// Verifies the client proof of the auth message, returning the server signature
+    /// if it's valid: H(ClientProof ^ HMAC(StoredKey, AuthMessage)) = StoredKey.
+    pub fn verify_client_proof(&self, auth_message: &str, proof: &[u8]) -> Result<Option<Vec<u8>>> {
+        if proof.len() != SCRAM_KEY_LENGTH {
+            return Ok(None);
+        }
+
+        let mut client_key = hmac_sha256(&self.stored_key, auth_message)?;
+        for (key, proof) in client_key.iter_mut().zip(proof) {
+            *key ^= proof;
+        }
+        let client_stored_key = sha256(&client_key);
+        client_key.fill(0);
+
+        if !memcmp::eq(&client_stored_key, &self.stored_key) {
+            return Ok(None);
+        }
+
+        Ok(Some(hmac_sha256(&self.server_key, auth_message)?))
+    }
+}
+
+impl Drop for ScramSecret {
+    fn drop(&mut self) {
+        // Don't leave the key material behind in freed memory
+        for byte in self.stored_key.iter_mut().chain(self.server_key.iter_mut()) {
+            unsafe { std::ptr::write_volatile(byte, 0) };
+        }
+    }
+}
+
+fn hmac_sha256(key: &[u8], message: &str) -> Result<Vec<u8>> {
+    let key = PKey::hmac(key)?;
+    let mut signer = Signer::new(MessageDigest::sha256(), &key)?;
+    signer.update(message.as_bytes())?;
+    Ok(signer.sign_to_vec()?)
+}
+
+/// Caches the SCRAM secrets of the users authenticating to the gateway, so that a
+/// storm of connections (e.g. a fleet of clients restarting) doesn't queue up on
+/// the authentication pool. Entries expire after a while so that changes made
+/// through other gateways are picked up, and are dropped when this gateway
+/// changes or drops the user.
+#[derive(Default)]
+pub struct ScramSecretCache {
+    secrets: Mutex<HashMap<String, (Arc<ScramSecret>, Instant)>>,
+}
+
+impl ScramSecretCache {
+    pub fn new() -> Self {
+        ScramSecretCache::default()
+    }
+
+    pub fn get(&self, username: &str, max_age: Duration) -> Option<Arc<ScramSecret>> {
+        let mut secrets = self.secrets.lock().ok()?;
+        match secrets.get(username) {
+            Some((secret, cached_at)) if cached_at.elapsed() < max_age => Some(Arc::clone(secret)),
+            Some(_) => {
+                secrets.remove(username);
+                None
+            }
+            None => None,
+        }
+    }
+
+    pub fn insert(&self, username: &str, secret: Arc<ScramSecret>) {
+        if let Ok(mut secrets) = self.secrets.lock() {
+            secrets.insert(username.to_string(), (secret, Instant::now()));
+        }
+    }
+
+    pub fn invalidate(&self, username: &str) {
+        if let Ok(mut secrets) = self.secrets.lock() {
+            secrets.remove(username);
+        }
+    }
+}
@@ -12,9 +12,12 @@ use tokio::sync::RwLock;
 
 use crate::{
     configuration::{DynamicConfiguration, SetupConfiguration},
-    context::{CursorStore, CursorStoreEntry, TransactionStore},
+    context::{
+        AdmissionController, CursorStore, CursorStoreEntry, ScramSecretCache, TransactionStore,
+    },
     error::{DocumentDBError, Result},
-    postgres::{Connection, ConnectionPool, QueryCatalog},
+    postgres::{Connection, ConnectionPool, QueryCatalog, ReplicaSet, ShardRouter, WorkerNode},
+    requests::request_metrics::RequestMetrics,
     service::TlsProvider,
 };
 
@@ -33,8 +36,19 @@ pub struct ServiceContextInner {
     // TODO: need to add excessive testing when the user is changing password or pool size changed
     pub user_data_pools: RwLock<HashMap<ClientKey, Arc<ConnectionPool>>>,
     pub system_shared_pools: RwLock<HashMap<usize, Arc<ConnectionPool>>>,
+
+    // The read replicas and, per user, a pool for each of them in the same order
+    pub replica_set: ReplicaSet,
+    pub user_replica_pools: RwLock<HashMap<ClientKey, Arc<Vec<ConnectionPool>>>>,
+
+    // The shard placements and, per user, a pool for each worker commands were routed to
+    pub shard_router: ShardRouter,
+    pub user_worker_pools: RwLock<HashMap<(ClientKey, WorkerNode), Arc<ConnectionPool>>>,
     pub cursor_store: CursorStore,
     pub transaction_store: TransactionStore,
+    pub admission_controller: AdmissionController,
+    pub scram_secret_cache: ScramSecretCache,
+    pub request_metrics: RequestMetrics,
     pub query_catalog: QueryCatalog,
     pub tls_provider: TlsProvider,
 }
@@ -54,6 +68,11 @@ impl ServiceContext {
         log::info!("Initial dynamic configuration: {:?}", dynamic_configuration);
 
         let timeout_secs = setup_configuration.transaction_timeout_secs();
+        let shard_router = ShardRouter::new(
+            setup_configuration.enable_shard_aware_routing(),
+            Arc::clone(&system_requests_pool),
+            query_catalog.shard_placements(),
+        );
         let inner = ServiceContextInner {
             setup_configuration: setup_configuration.clone(),
             dynamic_configuration,
@@ -61,8 +80,15 @@ impl ServiceContext {
             system_auth_pool,
             user_data_pools: RwLock::new(HashMap::new()),
             system_shared_pools: RwLock::new(HashMap::new()),
+            replica_set: ReplicaSet::new(setup_configuration.as_ref(), &query_catalog),
+            user_replica_pools: RwLock::new(HashMap::new()),
+            shard_router,
+            user_worker_pools: RwLock::new(HashMap::new()),
             cursor_store: CursorStore::new(setup_configuration.as_ref(), true),
             transaction_store: TransactionStore::new(Duration::from_secs(timeout_secs)),
+            admission_controller: AdmissionController::new(),
+            scram_secret_cache: ScramSecretCache::new(),
+            request_metrics: RequestMetrics::new(),
             query_catalog,
             tls_provider,
         };
@@ -89,6 +115,79 @@ impl ServiceContext {
         }
     }
 
+    /// Returns the pools of the user's connections to each read replica, None without replicas.
+    pub async fn get_replica_pools(
+        &self,
+        username: &str,
+        password: &str,
+    ) -> Option<Arc<Vec<ConnectionPool>>> {
+        if self.0.replica_set.is_empty() {
+            return None;
+        }
+
+        let max_connections = self.dynamic_configuration().max_connections().await;
+        self.0
+            .user_replica_pools
+            .read()
+            .await
+            .get(&(
+                Cow::Borrowed(username),
+                Cow::Borrowed(password),
+                max_connections,
+            ))
+            .cloned()
+    }
+
+    /// Returns the pool of the user's connections to the worker, created on first use.
+    pub async fn get_worker_pool(
+        &self,
+        username: &str,
+        password: &str,
+        worker: &WorkerNode,
+    ) -> Result<Arc<ConnectionPool>> {
+        let max_connections = self.dynamic_configuration().max_connections().await;
+        let key = (
+            (
+                Cow::Borrowed(username),
+                Cow::Borrowed(password),
+                max_connections,
+            ),
+            worker.clone(),
+        );
+        if let Some(pool) = self.0.user_worker_pools.read().await.get(&key) {
+            return Ok(Arc::clone(pool));
+        }
+
+        // Each worker is a server of its own, with the same connection budget as the coordinator
+        let real_max_connections = self.get_real_max_connections(max_connections).await;
+        let mut write_lock = self.0.user_worker_pools.write().await;
+        if let Some(pool) = write_lock.get(&key) {
+            return Ok(Arc::clone(pool));
+        }
+        let pool = Arc::new(ConnectionPool::new_with_user_on_host(
+            self.setup_configuration(),
+            self.query_catalog(),
+            &worker.host_name,
+            worker.port,
+            username,
+            Some(password),
+            format!("{}-Data", self.setup_configuration().application_name()),
+            real_max_connections,
+        )?);
+        write_lock.insert(
+            (
+                (
+                    Cow::Owned(username.to_owned()),
+                    Cow::Owned(password.to_owned()),
+                    max_connections,
+                ),
+                worker.clone(),
+            ),
+            Arc::clone(&pool),
+        );
+        Ok(pool)
+    }
+
     pub async fn add_cursor(&self, key: (i64, String), entry: CursorStoreEntry) {
         self.0.cursor_store.add_cursor(key, entry).await
     }
@@ -151,6 +250,26 @@ impl ServiceContext {
         &self.0.transaction_store
     }
 
+    pub fn admission_controller(&self) -> &AdmissionController {
+        &self.0.admission_controller
+    }
+
+    pub fn scram_secret_cache(&self) -> &ScramSecretCache {
+        &self.0.scram_secret_cache
+    }
+
+    pub fn request_metrics(&self) -> &RequestMetrics {
+        &self.0.request_metrics
+    }
+
+    pub fn replica_set(&self) -> &ReplicaSet {
+        &self.0.replica_set
+    }
+
+    pub fn shard_router(&self) -> &ShardRouter {
+        &self.0.shard_router
+    }
+
     pub fn query_catalog(&self) -> &QueryCatalog {
         &self.0.query_catalog
     }
@@ -163,7 +282,9 @@ impl ServiceContext {
             Cow::Borrowed(password),
             max_connections,
         )) {
-            return Ok(());
+            return self
+                .allocate_replica_pools(username, password, max_connections)
+                .await;
         }
 
         let mut write_lock = self.0.user_data_pools.write().await;
@@ -182,6 +303,56 @@ impl ServiceContext {
                 self.get_real_max_connections(max_connections).await,
             )?),
         );
+        drop(write_lock);
+
+        self.allocate_replica_pools(username, password, max_connections)
+            .await
+    }
+
+    async fn allocate_replica_pools(
+        &self,
+        username: &str,
+        password: &str,
+        max_connections: usize,
+    ) -> Result<()> {
+        if self.0.replica_set.is_empty()
+            || self.0.user_replica_pools.read().await.contains_key(&(
+                Cow::Borrowed(username),
+                Cow::Borrowed(password),
+                max_connections,
+            ))
+        {
+            return Ok(());
+        }
+
+        // Each replica is a server of its own, with the same connection budget as the primary
+        let real_max_connections = self.get_real_max_connections(max_connections).await;
+        let replica_pools = self
+            .0
+            .replica_set
+            .host_names()
+            .map(|host_name| {
+                ConnectionPool::new_with_user_on_host(
+                    self.setup_configuration(),
+                    self.query_catalog(),
+                    host_name,
+                    self.setup_configuration().postgres_port(),
+                    username,
+                    Some(password),
+                    format!("{}-Data", self.setup_configuration().application_name()),
+                    real_max_connections,
+                )
+            })
+            .collect::<Result<Vec<_>>>()?;
+
+        self.0.user_replica_pools.write().await.insert(
+            (
+                Cow::Owned(username.to_owned()),
+                Cow::Owned(password.to_owned()),
+                max_connections,
+            ),
+            Arc::new(replica_pools),
+        );
         Ok(())
     }
 
@@ -231,7 +402,7 @@ impl ServiceContext {
             let mut user_pools_write_lock = self.0.user_data_pools.write().await;
             let mut keys_to_remove = Vec::new();
             for (key, pool) in user_pools_write_lock.iter() {
-                if pool.last_used().await.elapsed() > max_age {
+                if pool.last_used().elapsed() > max_age {
                     keys_to_remove.push(key.clone());
                 }
             }
@@ -240,11 +411,25 @@ impl ServiceContext {
             }
         }
 
+        {
+            let mut replica_pools_write_lock = self.0.user_replica_pools.write().await;
+            replica_pools_write_lock.retain(|_, pools| {
+                pools
+                    .iter()
+                    .any(|pool| pool.last_used().elapsed() <= max_age)
+            });
+        }
+
+        {
+            let mut worker_pools_write_lock = self.0.user_worker_pools.write().await;
+            worker_pools_write_lock.retain(|_, pool| pool.last_used().elapsed() <= max_age);
+        }
+
         {
             let mut system_shared_write_lock = self.0.system_shared_pools.write().await;
             let mut keys_to_remove = Vec::new();
             for (key, pool) in system_shared_write_lock.iter() {
-                if pool.last_used().await.elapsed() > max_age {
+                if pool.last_used().elapsed() > max_age {
                     keys_to_remove.push(*key);
                 }
             }
@@ -252,6 +437,8 @@ impl ServiceContext {
                 system_shared_write_lock.remove(&key);
             }
         }
+
+        self.0.admission_controller.clean_idle_users(max_age);
     }
 
     pub fn tls_provider(&self) -> &TlsProvider {
@@ -28,7 +28,11 @@ use either::Either::{Left, Right};
 use openssl::ssl::Ssl;
 use rand::Rng;
 use socket2::TcpKeepalive;
-use std::{pin::Pin, sync::Arc, time::Duration};
+use std::{
+    pin::Pin,
+    sync::Arc,
+    time::{Duration, Instant},
+};
 use tokio::{
     io::BufStream,
     net::{TcpListener, TcpStream},
@@ -41,9 +45,10 @@ use crate::{
     context::{ConnectionContext, RequestContext, ServiceContext},
     error::{DocumentDBError, ErrorCode, Result},
     postgres::PgDataClient,
-    protocol::header::Header,
-    requests::{request_tracker::RequestTracker, Request, RequestIntervalKind},
+    protocol::{header::Header, opcode::OpCode},
+    requests::{request_tracker::RequestTracker, Request, RequestIntervalKind, RequestType},
     responses::{CommandError, Response},
+    service::run_metrics_exporter,
     telemetry::TelemetryProvider,
 };
 
@@ -88,14 +93,29 @@ pub async fn run_gateway<T>(
 where
     T: PgDataClient,
 {
+    let listen_address = if service_context.setup_configuration().use_local_host() {
+        "127.0.0.1"
+    } else {
+        "[::]"
+    };
+
+    if let Some(metrics_port) = service_context.setup_configuration().metrics_listen_port() {
+        let metrics_service_context = service_context.clone();
+        let metrics_token = token.clone();
+        let metrics_address = format!("{}:{}", listen_address, metrics_port);
+        tokio::spawn(async move {
+            if let Err(e) =
+                run_metrics_exporter(metrics_address, metrics_service_context, metrics_token).await
+            {
+                log::error!("Failed to serve the request metrics: {e:?}.");
+            }
+        });
+    }
+
     // TCP configuration part
     let tcp_listener = TcpListener::bind(format!(
         "{}:{}",
-        if service_context.setup_configuration().use_local_host() {
-            "127.0.0.1"
-        } else {
-            "[::]"
-        },
+        listen_address,
         service_context.setup_configuration().gateway_listen_port(),
     ))
     .await?;
@@ -175,12 +195,23 @@ where
     let ssl_session = Ssl::new(tls_acceptor.context())?;
     let mut tls_stream = SslStream::new(ssl_session, tcp_stream)?;
 
+    let handshake_start = Instant::now();
     if let Err(ssl_error) = SslStream::accept(Pin::new(&mut tls_stream)).await {
         log::error!("Failed to create TLS connection: {ssl_error:?}.");
         return Err(DocumentDBError::internal_error(format!(
             "SSL handshake failed: {ssl_error:?}."
         )));
     }
+    let handshake_duration = handshake_start.elapsed();
+    let session_reused = tls_stream.ssl().session_reused();
+    log::debug!(
+        "TLS handshake completed in {}us, session resumed: {}.",
+        handshake_duration.as_micros(),
+        session_reused
+    );
+    if let Some(telemetry) = telemetry.as_ref() {
+        telemetry.emit_tls_handshake_event(handshake_duration, session_reused);
+    }
 
     let conn_ctx = ConnectionContext::new(
         service_context,
@@ -230,12 +261,16 @@ where
 {
     loop {
         match protocol::reader::read_header(&mut stream).await {
-            Ok(Some(header)) => {
+            Ok(Some(mut header)) => {
                 let activity_id = get_activity_id(header.request_id);
 
-                if let Err(e) =
-                    handle_message::<T>(&mut connection_context, &header, &mut stream, &activity_id)
-                        .await
+                if let Err(e) = handle_message::<T>(
+                    &mut connection_context,
+                    &mut header,
+                    &mut stream,
+                    &activity_id,
+                )
+                .await
                 {
                     if let Err(e) = log_and_write_error(
                         &connection_context,
@@ -298,6 +333,18 @@ where
     // Once authorized, make sure that there is a pool of pg clients for the user/password.
     connection_context.allocate_data_pool().await?;
 
+    // Wait for the user's concurrency and rate limits, held until the request is processed
+    let _admission = connection_context
+        .service_context
+        .admission_controller()
+        .admit(
+            connection_context.dynamic_configuration().as_ref(),
+            connection_context.auth_state.username()?,
+            request_context.payload.request_type(),
+            request_context.tracker,
+        )
+        .await?;
+
     let service_context = Arc::clone(&connection_context.service_context);
     let data_client = T::new_authorized(&service_context, &connection_context.auth_state).await?;
 
@@ -310,7 +357,7 @@ where
 
 async fn handle_message<T>(
     connection_context: &mut ConnectionContext,
-    header: &Header,
+    header: &mut Header,
     stream: &mut GwStream,
     activity_id: &str,
 ) -> Result<()>
@@ -323,6 +370,8 @@ where
     let handle_request_start = request_tracker.start_timer();
     let buffer_read_start = request_tracker.start_timer();
     let message = protocol::reader::read_request(header, stream).await?;
+    // The header only changes when a compressed request is read
+    let header: &Header = header;
 
     request_tracker.record_duration(RequestIntervalKind::BufferRead, buffer_read_start);
 
@@ -341,9 +390,12 @@ where
     }
 
     let format_request_start = request_tracker.start_timer();
-    let request =
-        protocol::reader::parse_request(&message, &mut connection_context.requires_response)
-            .await?;
+    let request = protocol::reader::parse_request(
+        &message,
+        &mut connection_context.requires_response,
+        &mut connection_context.exhaust_allowed,
+    )
+    .await?;
     request_tracker.record_duration(RequestIntervalKind::FormatRequest, format_request_start);
 
     let request_info = request.extract_common()?;
@@ -365,6 +417,14 @@ where
     )
     .await;
 
+    connection_context
+        .service_context
+        .request_metrics()
+        .observe(
+            *request.request_type(),
+            request_context.tracker,
+            activity_id,
+        );
     log_verbose_latency(connection_context, request_context.tracker, activity_id).await;
 
     // Errors in request handling are handled explicitly so that telemetry can have access to the request
@@ -416,7 +476,7 @@ where
         .tracker
         .record_duration(RequestIntervalKind::HandleRequest, handle_request_start);
 
-    let response = match response_result {
+    let mut response = match response_result {
         Ok(response) => response,
         Err(e) => {
             return Err(e);
@@ -425,7 +485,30 @@ where
 
     // Write the response back to the stream
     if connection_context.requires_response {
+        // An exhaust getMore streams the batches until the cursor is exhausted,
+        // saving the client a round trip per batch
+        while connection_context.exhaust_allowed
+            && header.op_code == OpCode::Msg
+            && request_context.payload.request_type() == &RequestType::GetMore
+            && has_open_cursor(&response)
+        {
+            let write_response_start = request_context.tracker.start_timer();
+            responses::writer::write_more_to_come(header, &response, stream).await?;
+            request_context
+                .tracker
+                .record_duration(RequestIntervalKind::WriteResponse, write_response_start);
+
+            // The written batch is released before the next one is fetched, so that
+            // a connection holds a single batch at a time
+            drop(response);
+            response = get_response::<T>(request_context, connection_context).await?;
+        }
+
+        let write_response_start = request_context.tracker.start_timer();
         responses::writer::write(header, &response, stream).await?;
+        request_context
+            .tracker
+            .record_duration(RequestIntervalKind::WriteResponse, write_response_start);
     }
 
     if let Some(telemetry) = connection_context.telemetry_provider.as_ref() {
@@ -445,6 +528,16 @@ where
     Ok(())
 }
 
+/// Whether the response is a cursor batch with more batches to come.
+fn has_open_cursor(response: &Response) -> bool {
+    response
+        .as_raw_document()
+        .ok()
+        .and_then(|doc| doc.get_document("cursor").ok())
+        .and_then(|cursor| cursor.get_i64("id").ok())
+        .is_some_and(|cursor_id| cursor_id != 0)
+}
+
 #[expect(clippy::too_many_arguments)]
 async fn log_and_write_error(
     connection_context: &ConnectionContext,
@@ -492,7 +585,7 @@ async fn log_verbose_latency(
     {
         log::info!(
             activity_id = activity_id;
-            "Latency for Mongo Request. BufferRead={}ns, HandleRequest={}ns, FormatRequest={}ns, ProcessRequest={}ns, PostgresBeginTransaction={}ns, PostgresSetStatementTimeout={}ns, PostgresTransactionCommit={}ns, FormatResponse={}ns",
+            "Latency for Mongo Request. BufferRead={}ns, HandleRequest={}ns, FormatRequest={}ns, ProcessRequest={}ns, PostgresBeginTransaction={}ns, PostgresSetStatementTimeout={}ns, PostgresTransactionCommit={}ns, AdmissionQueue={}ns, PoolWait={}ns, FormatResponse={}ns, WriteResponse={}ns",
             request_tracker.get_interval_elapsed_time(RequestIntervalKind::BufferRead),
             request_tracker.get_interval_elapsed_time(RequestIntervalKind::HandleRequest),
             request_tracker.get_interval_elapsed_time(RequestIntervalKind::FormatRequest),
@@ -500,7 +593,10 @@ async fn log_verbose_latency(
             request_tracker.get_interval_elapsed_time(RequestIntervalKind::PostgresBeginTransaction),
             request_tracker.get_interval_elapsed_time(RequestIntervalKind::PostgresSetStatementTimeout),
             request_tracker.get_interval_elapsed_time(RequestIntervalKind::PostgresTransactionCommit),
-            request_tracker.get_interval_elapsed_time(RequestIntervalKind::FormatResponse)
+            request_tracker.get_interval_elapsed_time(RequestIntervalKind::AdmissionQueue),
+            request_tracker.get_interval_elapsed_time(RequestIntervalKind::PoolWait),
+            request_tracker.get_interval_elapsed_time(RequestIntervalKind::FormatResponse),
+            request_tracker.get_interval_elapsed_time(RequestIntervalKind::WriteResponse)
         );
     }
 }
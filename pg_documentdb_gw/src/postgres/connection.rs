@@ -6,7 +6,13 @@
  *-------------------------------------------------------------------------
  */
 
-use std::time::{Duration, Instant};
+use std::{
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    time::{Duration, Instant},
+};
 
 use super::{PgDocument, QueryCatalog};
 use crate::{
@@ -14,8 +20,8 @@ use crate::{
     error::Result,
     requests::{request_tracker::RequestTracker, RequestIntervalKind},
 };
-use deadpool_postgres::Runtime;
-use tokio::{sync::RwLock, task::JoinHandle};
+use deadpool_postgres::{Hook, Runtime};
+use tokio::task::JoinHandle;
 use tokio_postgres::{
     types::{ToSql, Type},
     NoTls, Row,
@@ -26,6 +32,8 @@ pub type InnerConnection = deadpool_postgres::Object;
 pub fn pg_configuration(
     setup_configuration: &dyn SetupConfiguration,
     query_catalog: &QueryCatalog,
+    host_name: &str,
+    port: u16,
     user: &str,
     pass: Option<&str>,
     application_name: String,
@@ -43,8 +51,8 @@ pub fn pg_configuration(
             .to_string();
 
     config
-        .host(setup_configuration.postgres_host_name())
-        .port(setup_configuration.postgres_port())
+        .host(host_name)
+        .port(port)
         .dbname(setup_configuration.postgres_database())
         .user(user)
         .application_name(&application_name)
@@ -59,11 +67,23 @@ pub fn pg_configuration(
     config
 }
 
+// A pool starts at this fraction of its connection budget and grows on demand
+const INITIAL_POOL_SIZE_DIVISOR: usize = 4;
+
 // Ensures search_path is set on all acquired connections
 #[derive(Debug)]
 pub struct ConnectionPool {
     pool: deadpool_postgres::Pool,
-    last_used: RwLock<Instant>,
+
+    // The most connections the pool may grow to
+    max_size: usize,
+
+    // When the pool was created, the base of last_used_ms
+    created: Instant,
+
+    // Milliseconds after created at which a connection was last checked out.
+    // An atomic rather than a lock so that concurrent checkouts don't serialize.
+    last_used_ms: AtomicU64,
     _reaper: JoinHandle<()>,
 }
 
@@ -75,10 +95,36 @@ impl ConnectionPool {
         pass: Option<&str>,
         application_name: String,
         max_size: usize,
+    ) -> Result<Self> {
+        Self::new_with_user_on_host(
+            setup_configuration,
+            query_catalog,
+            setup_configuration.postgres_host_name(),
+            setup_configuration.postgres_port(),
+            user,
+            pass,
+            application_name,
+            max_size,
+        )
+    }
+
+    // Creates a pool of connections to a host other than the primary, e.g. a read replica or a worker
+    #[allow(clippy::too_many_arguments)]
+    pub fn new_with_user_on_host(
+        setup_configuration: &dyn SetupConfiguration,
+        query_catalog: &QueryCatalog,
+        host_name: &str,
+        port: u16,
+        user: &str,
+        pass: Option<&str>,
+        application_name: String,
+        max_size: usize,
     ) -> Result<Self> {
         let config = pg_configuration(
             setup_configuration,
             query_catalog,
+            host_name,
+            port,
             user,
             pass,
             application_name,
@@ -86,9 +132,33 @@ impl ConnectionPool {
 
         let manager = deadpool_postgres::Manager::new(config, NoTls);
 
+        let max_size = max_size.max(1);
+        let min_idle = setup_configuration
+            .postgres_pool_min_idle_connections()
+            .min(max_size);
+        let initial_size = (max_size / INITIAL_POOL_SIZE_DIVISOR)
+            .max(min_idle)
+            .clamp(1, max_size);
+
+        // Prepare the data path statements once per connection, when it's created
+        let prepared_statements = Arc::new(query_catalog.prepared_statements());
+
         let builder = deadpool_postgres::Pool::builder(manager)
             .runtime(Runtime::Tokio1)
-            .max_size(max_size)
+            .max_size(initial_size)
+            .post_create(Hook::async_fn(move |client, _| {
+                let prepared_statements = Arc::clone(&prepared_statements);
+                Box::pin(async move {
+                    for (query, types) in prepared_statements.iter() {
+                        // Not fatal: the statement is prepared on first use instead
+                        if let Err(e) = client.prepare_typed_cached(query, types).await {
+                            log::warn!("Failed to prepare a statement on a new connection: {}", e);
+                            break;
+                        }
+                    }
+                    Ok(())
+                })
+            }))
             // The time to wait while trying to establish a connection before terminating the attempt
             .wait_timeout(Some(Duration::from_secs(15)));
         let pool = builder.build()?;
@@ -101,27 +171,63 @@ impl ConnectionPool {
             let idle_connection_max_age = Duration::from_secs(300);
             loop {
                 prune_interval.tick().await;
-                pool_copy
-                    .retain(|_, conn_metrics| conn_metrics.last_used() < idle_connection_max_age);
+
+                // Keep min_idle connections open however long they were idle
+                let kept = AtomicU64::new(0);
+                pool_copy.retain(|_, conn_metrics| {
+                    kept.fetch_add(1, Ordering::Relaxed) < min_idle as u64
+                        || conn_metrics.last_used() < idle_connection_max_age
+                });
+
+                // Give back the connections a burst grew the pool by once it's idle
+                let status = pool_copy.status();
+                if status.max_size > initial_size && status.size * 2 <= initial_size {
+                    pool_copy.resize(initial_size);
+                }
+
+                // Open the minimum idle connections ahead of the requests needing them
+                if status.size < min_idle {
+                    let mut prewarmed = Vec::with_capacity(min_idle);
+                    for _ in 0..min_idle {
+                        match pool_copy.get().await {
+                            Ok(conn) => prewarmed.push(conn),
+                            Err(e) => {
+                                log::warn!("Failed to prewarm a connection: {}", e);
+                                break;
+                            }
+                        }
+                    }
+                }
             }
         });
 
         Ok(ConnectionPool {
             pool,
-            last_used: RwLock::new(Instant::now()),
+            max_size,
+            created: Instant::now(),
+            last_used_ms: AtomicU64::new(0),
             _reaper: reaper,
         })
     }
 
     pub async fn get_inner_connection(&self) -> Result<InnerConnection> {
-        let mut write_lock = self.last_used.write().await;
-        *write_lock = Instant::now();
+        self.last_used_ms
+            .store(self.created.elapsed().as_millis() as u64, Ordering::Relaxed);
+
+        // Grow the pool rather than wait when all of its connections are in use
+        let status = self.pool.status();
+        if status.available == 0
+            && status.size >= status.max_size
+            && status.max_size < self.max_size
+        {
+            self.pool.resize((status.max_size * 2).min(self.max_size));
+        }
+
         Ok(self.pool.get().await?)
     }
 
-    pub async fn last_used(&self) -> Instant {
-        let read_lock = self.last_used.read().await;
-        *read_lock
+    pub fn last_used(&self) -> Instant {
+        self.created + Duration::from_millis(self.last_used_ms.load(Ordering::Relaxed))
     }
 }
 
@@ -132,6 +238,12 @@ impl ConnectionPool {
 pub struct Connection {
     inner_conn: InnerConnection,
     pub in_transaction: bool,
+
+    // Nanoseconds the connection was waited for, recorded by the first query on it
+    pool_wait_ns: AtomicU64,
+
+    // The read replica the connection is to, None for the primary
+    pub replica_index: Option<usize>,
 }
 
 pub enum TimeoutType {
@@ -185,6 +297,14 @@ impl Connection {
         timeout: Option<Timeout>,
         request_tracker: &mut RequestTracker,
     ) -> Result<Vec<Row>> {
+        let pool_wait_ns = self.pool_wait_ns.swap(0, Ordering::Relaxed);
+        if pool_wait_ns > 0 {
+            request_tracker.record_elapsed(
+                RequestIntervalKind::PoolWait,
+                Duration::from_nanos(pool_wait_ns),
+            );
+        }
+
         match timeout {
             Some(Timeout {
                 timeout_type: _,
@@ -318,9 +438,24 @@ impl Connection {
     }
 
     pub fn new(conn: InnerConnection, in_transaction: bool) -> Self {
+        Self::with_pool_wait(conn, in_transaction, Duration::ZERO)
+    }
+
+    pub fn with_pool_wait(
+        conn: InnerConnection,
+        in_transaction: bool,
+        pool_wait: Duration,
+    ) -> Self {
         Connection {
             inner_conn: conn,
             in_transaction,
+            pool_wait_ns: AtomicU64::new(pool_wait.as_nanos() as u64),
+            replica_index: None,
         }
     }
+
+    pub fn with_replica_index(mut self, replica_index: usize) -> Self {
+        self.replica_index = Some(replica_index);
+        self
+    }
 }
@@ -153,6 +153,7 @@ pub trait PgDataClient: Send + Sync {
         db: &str,
         cursor: &Cursor,
         cursor_connection: &Option<Arc<Connection>>,
+        replica_index: Option<usize>,
         connection_context: &ConnectionContext,
     ) -> Result<Vec<Row>>;
 
@@ -6,7 +6,10 @@
  *-------------------------------------------------------------------------
  */
 
-use std::sync::Arc;
+use std::{
+    sync::Arc,
+    time::{Duration, Instant},
+};
 
 use async_trait::async_trait;
 use bson::{RawDocument, RawDocumentBuf};
@@ -17,7 +20,8 @@ use crate::{
     context::{ConnectionContext, Cursor, RequestContext, ServiceContext},
     error::{DocumentDBError, Result},
     explain::Verbosity,
-    postgres::{connection::InnerConnection, PgDataClient},
+    postgres::{connection::InnerConnection, PgDataClient, ReadPreference, ShardKeySource},
+    requests::RequestInfo,
     responses::{PgResponse, Response},
 };
 
@@ -25,6 +29,10 @@ use super::{Connection, ConnectionPool, PgDocument, Timeout};
 
 pub struct DocumentDBDataClient {
     connection_pool: Option<Arc<ConnectionPool>>,
+    replica_pools: Option<Arc<Vec<ConnectionPool>>>,
+
+    // The user and password the worker pools are opened with, when shard aware routing is on
+    worker_credentials: Option<(String, String)>,
 }
 
 impl DocumentDBDataClient {
@@ -37,6 +45,168 @@ impl DocumentDBDataClient {
             .get_inner_connection()
             .await
     }
+
+    // Pulls a connection to the replica the command's readPreference selects, or
+    // to the primary. Reads in a transaction and writing aggregations stay on the primary.
+    async fn pull_read_connection(
+        &self,
+        request: &RawDocument,
+        request_info: &RequestInfo<'_>,
+        shard_key_sources: &[ShardKeySource<'_>],
+        connection_context: &ConnectionContext,
+    ) -> Result<Arc<Connection>> {
+        if connection_context.transaction.is_some() || writes_output(request)? {
+            return self.pull_connection(connection_context).await;
+        }
+        let Some(replica_pools) = self.replica_pools.as_ref() else {
+            return self
+                .pull_routed_connection(request_info, shard_key_sources, connection_context)
+                .await;
+        };
+
+        let read_preference = ReadPreference::parse(request)?;
+        let max_lag = Duration::from_secs(
+            connection_context
+                .service_context
+                .dynamic_configuration()
+                .max_replica_lag_secs()
+                .await,
+        );
+        match connection_context
+            .service_context
+            .replica_set()
+            .select(&read_preference, max_lag)?
+        {
+            Some(index) if index < replica_pools.len() => self.pull_replica_connection(index).await,
+            _ => {
+                self.pull_routed_connection(request_info, shard_key_sources, connection_context)
+                    .await
+            }
+        }
+    }
+
+    // Pulls a connection to the given read replica
+    async fn pull_replica_connection(&self, replica_index: usize) -> Result<Arc<Connection>> {
+        let pool = self
+            .replica_pools
+            .as_ref()
+            .and_then(|replica_pools| replica_pools.get(replica_index))
+            .ok_or(DocumentDBError::internal_error(format!(
+                "Read replica {} has no connection pool",
+                replica_index
+            )))?;
+        let pool_wait_start = Instant::now();
+        let inner_connection = pool.get_inner_connection().await?;
+        Ok(Arc::new(
+            Connection::with_pool_wait(inner_connection, false, pool_wait_start.elapsed())
+                .with_replica_index(replica_index),
+        ))
+    }
+
+    // Pulls a connection to the worker holding the one shard the command touches when
+    // shard aware routing is on, or to the coordinator. Commands in a transaction stay
+    // on the transaction's connection.
+    async fn pull_routed_connection(
+        &self,
+        request_info: &RequestInfo<'_>,
+        shard_key_sources: &[ShardKeySource<'_>],
+        connection_context: &ConnectionContext,
+    ) -> Result<Arc<Connection>> {
+        if let (Some((user, password)), None, Ok(db), Ok(collection)) = (
+            self.worker_credentials.as_ref(),
+            connection_context.transaction.as_ref(),
+            request_info.db(),
+            request_info.collection(),
+        ) {
+            let service_context = &connection_context.service_context;
+            if let Some(worker) =
+                service_context
+                    .shard_router()
+                    .route(db, collection, shard_key_sources)
+            {
+                let pool = service_context
+                    .get_worker_pool(user, password, &worker)
+                    .await?;
+                return pull_connection_from(&pool).await;
+            }
+        }
+
+        self.pull_connection(connection_context).await
+    }
+}
+
+async fn pull_connection_from(pool: &ConnectionPool) -> Result<Arc<Connection>> {
+    let pool_wait_start = Instant::now();
+    let inner_connection = pool.get_inner_connection().await?;
+    Ok(Arc::new(Connection::with_pool_wait(
+        inner_connection,
+        false,
+        pool_wait_start.elapsed(),
+    )))
+}
+
+// The documents of a command's array field, or of the document sequence sent along
+// with it. None if they can't be read, the command then failing in the extension.
+fn command_documents<'a>(
+    request: &'a RawDocument,
+    extra: Option<&'a [u8]>,
+    field: &str,
+) -> Option<Vec<&'a RawDocument>> {
+    if let Some(mut remaining) = extra {
+        let mut documents = Vec::new();
+        while !remaining.is_empty() {
+            let length = i32::from_le_bytes(remaining.get(0..4)?.try_into().ok()?);
+            let length = usize::try_from(length).ok().filter(|length| *length >= 5)?;
+            documents.push(RawDocument::from_bytes(remaining.get(..length)?).ok()?);
+            remaining = &remaining[length..];
+        }
+        return Some(documents);
+    }
+
+    request
+        .get(field)
+        .ok()??
+        .as_array()?
+        .into_iter()
+        .map(|value| value.ok()?.as_document())
+        .collect()
+}
+
+// The filters of the statements of an update or a delete
+fn statement_filters<'a>(
+    request: &'a RawDocument,
+    extra: Option<&'a [u8]>,
+    field: &str,
+) -> Vec<ShardKeySource<'a>> {
+    command_documents(request, extra, field)
+        .and_then(|statements| {
+            statements
+                .into_iter()
+                .map(|statement| {
+                    statement
+                        .get("q")
+                        .ok()??
+                        .as_document()
+                        .map(ShardKeySource::Filter)
+                })
+                .collect()
+        })
+        .unwrap_or_default()
+}
+
+// Whether the command is an aggregation with an $out or $merge stage
+fn writes_output(request: &RawDocument) -> Result<bool> {
+    let Some(pipeline) = request.get("pipeline")?.and_then(|p| p.as_array()) else {
+        return Ok(false);
+    };
+    for stage in pipeline {
+        if let Some(stage) = stage?.as_document() {
+            if stage.get("$out")?.is_some() || stage.get("$merge")?.is_some() {
+                return Ok(true);
+            }
+        }
+    }
+    Ok(false)
 }
 
 #[async_trait]
@@ -53,20 +223,36 @@ impl PgDataClient for DocumentDBDataClient {
                 "Password is missing on pg data pool acquisition".to_string(),
             ))?;
         let connection_pool = Some(service_context.get_data_pool(user, pass).await?);
+        let replica_pools = service_context.get_replica_pools(user, pass).await;
+        let worker_credentials = service_context
+            .shard_router()
+            .is_enabled()
+            .then(|| (user.to_string(), pass.to_string()));
 
-        Ok(DocumentDBDataClient { connection_pool })
+        Ok(DocumentDBDataClient {
+            connection_pool,
+            replica_pools,
+            worker_credentials,
+        })
     }
 
     async fn new_unauthorized(_: &Arc<ServiceContext>) -> Result<Self> {
         Ok(DocumentDBDataClient {
             connection_pool: None,
+            replica_pools: None,
+            worker_credentials: None,
         })
     }
 
     async fn pull_connection_with_transaction(&self, in_transaction: bool) -> Result<Connection> {
+        let pool_wait_start = Instant::now();
         let inner_connection = self.pull_inner_connection().await?;
 
-        Ok(Connection::new(inner_connection, in_transaction))
+        Ok(Connection::with_pool_wait(
+            inner_connection,
+            in_transaction,
+            pool_wait_start.elapsed(),
+        ))
     }
 
     async fn execute_aggregate(
@@ -75,7 +261,9 @@ impl PgDataClient for DocumentDBDataClient {
         connection_context: &ConnectionContext,
     ) -> Result<(PgResponse, Arc<Connection>)> {
         let (request, request_info, request_tracker) = request_context.get_components();
-        let connection = self.pull_connection(connection_context).await?;
+        let connection = self
+            .pull_read_connection(request.document(), request_info, &[], connection_context)
+            .await?;
 
         #[allow(clippy::unnecessary_to_owned)]
         let aggregate_rows = connection
@@ -132,7 +320,7 @@ impl PgDataClient for DocumentDBDataClient {
         let (request, request_info, request_tracker) = request_context.get_components();
         #[allow(clippy::unnecessary_to_owned)]
         let count_query_rows = self
-            .pull_connection(connection_context)
+            .pull_read_connection(request.document(), request_info, &[], connection_context)
             .await?
             .query_db_bson(
                 connection_context
@@ -232,11 +420,13 @@ impl PgDataClient for DocumentDBDataClient {
     ) -> Result<Vec<Row>> {
         let (request, request_info, request_tracker) = request_context.get_components();
         let query_catalog = connection_context.service_context.query_catalog();
+        let shard_key_sources = statement_filters(request.document(), request.extra(), "deletes");
 
         let delete_rows = self
             .run_readonly_if_needed(
                 is_read_only_for_disk_full,
-                self.pull_connection(connection_context).await?,
+                self.pull_routed_connection(request_info, &shard_key_sources, connection_context)
+                    .await?,
                 query_catalog,
                 move |connection| async move {
                     connection
@@ -423,7 +613,21 @@ impl PgDataClient for DocumentDBDataClient {
         connection_context: &ConnectionContext,
     ) -> Result<(PgResponse, Arc<Connection>)> {
         let (request, request_info, request_tracker) = request_context.get_components();
-        let connection = self.pull_connection(connection_context).await?;
+        let shard_key_sources: Vec<ShardKeySource> = request
+            .document()
+            .get("filter")?
+            .and_then(|filter| filter.as_document())
+            .map(ShardKeySource::Filter)
+            .into_iter()
+            .collect();
+        let connection = self
+            .pull_read_connection(
+                request.document(),
+                request_info,
+                &shard_key_sources,
+                connection_context,
+            )
+            .await?;
 
         #[allow(clippy::unnecessary_to_owned)]
         let find_rows = connection
@@ -473,13 +677,16 @@ impl PgDataClient for DocumentDBDataClient {
         db: &str,
         cursor: &Cursor,
         cursor_connection: &Option<Arc<Connection>>,
+        replica_index: Option<usize>,
         connection_context: &ConnectionContext,
     ) -> Result<Vec<Row>> {
         let (request, request_info, request_tracker) = request_context.get_components();
-        let connection = if let Some(ref connection) = cursor_connection {
-            connection
-        } else {
-            &self.pull_connection(connection_context).await?
+
+        // A cursor opened on a replica continues there: The primary may be ahead of it
+        let connection = match (cursor_connection, replica_index) {
+            (Some(connection), _) => Arc::clone(connection),
+            (None, Some(replica_index)) => self.pull_replica_connection(replica_index).await?,
+            (None, None) => self.pull_connection(connection_context).await?,
         };
 
         let get_more_rows = connection
@@ -507,8 +714,14 @@ impl PgDataClient for DocumentDBDataClient {
         connection_context: &ConnectionContext,
     ) -> Result<Vec<Row>> {
         let (request, request_info, request_tracker) = request_context.get_components();
+        let shard_key_sources: Vec<ShardKeySource> =
+            command_documents(request.document(), request.extra(), "documents")
+                .unwrap_or_default()
+                .into_iter()
+                .map(ShardKeySource::Document)
+                .collect();
         let insert_rows = self
-            .pull_connection(connection_context)
+            .pull_routed_connection(request_info, &shard_key_sources, connection_context)
             .await?
             .query(
                 connection_context.service_context.query_catalog().insert(),
@@ -626,8 +839,9 @@ impl PgDataClient for DocumentDBDataClient {
         connection_context: &ConnectionContext,
     ) -> Result<Vec<Row>> {
         let (request, request_info, request_tracker) = request_context.get_components();
+        let shard_key_sources = statement_filters(request.document(), request.extra(), "updates");
         let update_rows = self
-            .pull_connection(connection_context)
+            .pull_routed_connection(request_info, &shard_key_sources, connection_context)
             .await?
             .query(
                 connection_context
@@ -11,6 +11,8 @@ mod data_client;
 mod document;
 mod documentdb_data_client;
 mod query_catalog;
+mod replica_set;
+mod shard_map;
 mod transaction;
 
 pub use connection::{Connection, ConnectionPool, InnerConnection, Timeout, TimeoutType};
@@ -19,4 +21,6 @@ pub use document::PgDocument;
 pub use documentdb_data_client::DocumentDBDataClient;
 pub use query_catalog::create_query_catalog;
 pub use query_catalog::QueryCatalog;
+pub use replica_set::{ReadPreference, ReadPreferenceMode, ReplicaSet};
+pub use shard_map::{ShardKeySource, ShardRouter, WorkerNode};
 pub use transaction::Transaction;
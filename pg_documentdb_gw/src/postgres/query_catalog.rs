@@ -7,12 +7,14 @@
  */
 
 use serde::Deserialize;
+use tokio_postgres::types::Type;
 
 #[derive(Debug, Deserialize, Default, Clone)]
 pub struct QueryCatalog {
     // auth.rs
     pub authenticate_with_scram_sha256: String,
     pub salt_and_iterations: String,
+    pub scram_sha256_get_secret: String,
     pub authenticate_with_token: String,
 
     // dataapi.rs (Not needed for OSS)
@@ -23,6 +25,8 @@ pub struct QueryCatalog {
     // dynamic.rs
     pub pg_settings: String,
     pub pg_is_in_recovery: String,
+    pub replica_lag: String,
+    pub shard_placements: String,
 
     // version.rs
     pub extension_versions: String,
@@ -108,6 +112,10 @@ impl QueryCatalog {
         &self.salt_and_iterations
     }
 
+    pub fn scram_sha256_get_secret(&self) -> &str {
+        &self.scram_sha256_get_secret
+    }
+
     pub fn authenticate_with_token(&self) -> &str {
         &self.authenticate_with_token
     }
@@ -134,6 +142,14 @@ impl QueryCatalog {
         &self.pg_is_in_recovery
     }
 
+    pub fn replica_lag(&self) -> &str {
+        &self.replica_lag
+    }
+
+    pub fn shard_placements(&self) -> &str {
+        &self.shard_placements
+    }
+
     // Topology getter
     pub fn extension_versions(&self) -> &str {
         &self.extension_versions
@@ -357,6 +373,31 @@ impl QueryCatalog {
     pub fn compact(&self) -> &str {
         &self.compact
     }
+
+    /// The statements of the data path commands with their parameter types, which
+    /// are prepared on every new pooled connection so that the first request on a
+    /// connection doesn't pay for their preparation. The parameter types must match
+    /// the ones the statements are queried with, otherwise they are prepared again.
+    pub fn prepared_statements(&self) -> Vec<(String, Vec<Type>)> {
+        let db_and_spec = vec![Type::TEXT, Type::BYTEA];
+        let db_spec_and_extra = vec![Type::TEXT, Type::BYTEA, Type::BYTEA];
+
+        [
+            (&self.find_cursor_first_page, &db_and_spec),
+            (&self.aggregate_cursor_first_page, &db_and_spec),
+            (&self.count_query, &db_and_spec),
+            (&self.distinct_query, &db_and_spec),
+            (&self.find_and_modify, &db_and_spec),
+            (&self.cursor_get_more, &db_spec_and_extra),
+            (&self.insert, &db_spec_and_extra),
+            (&self.process_update, &db_spec_and_extra),
+            (&self.delete, &db_spec_and_extra),
+        ]
+        .into_iter()
+        .filter(|(query, _)| !query.is_empty())
+        .map(|(query, types)| (query.clone(), types.clone()))
+        .collect()
+    }
 }
 
 pub fn create_query_catalog() -> QueryCatalog {
@@ -364,11 +405,23 @@ pub fn create_query_catalog() -> QueryCatalog {
             // auth.rs
             authenticate_with_scram_sha256: "SELECT documentdb_api_internal.authenticate_with_scram_sha256($1, $2, $3)".to_string(),
             salt_and_iterations: "SELECT documentdb_api_internal.scram_sha256_get_salt_and_iterations($1)".to_string(),
+            scram_sha256_get_secret: "SELECT documentdb_api_internal.scram_sha256_get_secret($1)".to_string(),
             authenticate_with_token: "SELECT documentdb_api_internal.authenticate_token($1, $2)".to_string(),
 
             // dynamic.rs
             pg_settings: "SELECT name, setting FROM pg_settings WHERE name LIKE 'documentdb.%' OR name IN ('max_connections', 'default_transaction_read_only')".to_string(),
             pg_is_in_recovery: "SELECT pg_is_in_recovery()".to_string(),
+            // A replica that replayed all the WAL it received is caught up however old its last transaction is
+            replica_lag: "SELECT CASE WHEN NOT pg_is_in_recovery() OR pg_last_wal_receive_lsn() = pg_last_wal_replay_lsn() THEN 0
+                                 ELSE COALESCE((EXTRACT(EPOCH FROM now() - pg_last_xact_replay_timestamp()) * 1000)::int8, 0) END".to_string(),
+            // The active primary node holding each shard of the collections, from the Citus metadata
+            shard_placements: "SELECT c.database_name, c.collection_name, c.shard_key, s.shardminvalue::int4, s.shardmaxvalue::int4, n.nodename, n.nodeport
+                               FROM documentdb_api_catalog.collections c
+                               JOIN pg_dist_shard s ON s.logicalrelid = to_regclass('documentdb_data.documents_' || c.collection_id)
+                               JOIN pg_dist_placement p ON p.shardid = s.shardid
+                               JOIN pg_dist_node n ON n.groupid = p.groupid
+                               WHERE n.isactive AND n.noderole = 'primary' AND p.shardstate = 1
+                               ORDER BY p.placementid".to_string(),
 
             // explain/mod.rs
             explain: "EXPLAIN (FORMAT JSON, ANALYZE {analyze}, VERBOSE True, BUFFERS {analyze}, TIMING {analyze}) SELECT document FROM documentdb_api_catalog.bson_aggregation_{query_base}($1, $2)".to_string(),
@@ -0,0 +1,246 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/postgres/replica_set.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use std::{
+    sync::{
+        atomic::{AtomicU64, AtomicUsize, Ordering},
+        Arc,
+    },
+    time::Duration,
+};
+
+use bson::RawDocument;
+use tokio::task::JoinHandle;
+
+use crate::{
+    configuration::SetupConfiguration,
+    error::{DocumentDBError, ErrorCode, Result},
+};
+
+use super::{ConnectionPool, QueryCatalog};
+
+// How often the replay lag of the replicas is measured
+const LAG_CHECK_INTERVAL: Duration = Duration::from_secs(5);
+
+// The lag of a replica that could not be reached
+const UNREACHABLE_LAG_MS: u64 = u64::MAX;
+
+/// The readPreference modes of a read command.
+#[derive(Copy, Clone, Debug, Eq, PartialEq)]
+pub enum ReadPreferenceMode {
+    Primary,
+    PrimaryPreferred,
+    Secondary,
+    SecondaryPreferred,
+    Nearest,
+}
+
+#[derive(Debug)]
+pub struct ReadPreference {
+    pub mode: ReadPreferenceMode,
+    pub max_staleness: Option<Duration>,
+}
+
+impl ReadPreference {
+    /// Reads the `$readPreference` of a command, which defaults to the primary.
+    pub fn parse(request: &RawDocument) -> Result<Self> {
+        let Some(read_preference) = request.get("$readPreference")? else {
+            return Ok(ReadPreference {
+                mode: ReadPreferenceMode::Primary,
+                max_staleness: None,
+            });
+        };
+        let read_preference = read_preference.as_document().ok_or_else(|| {
+            DocumentDBError::type_mismatch("$readPreference should be a document".to_string())
+        })?;
+
+        let mode = match read_preference.get("mode")?.and_then(|mode| mode.as_str()) {
+            None | Some("primary") => ReadPreferenceMode::Primary,
+            Some("primaryPreferred") => ReadPreferenceMode::PrimaryPreferred,
+            Some("secondary") => ReadPreferenceMode::Secondary,
+            Some("secondaryPreferred") => ReadPreferenceMode::SecondaryPreferred,
+            Some("nearest") => ReadPreferenceMode::Nearest,
+            Some(other) => {
+                return Err(DocumentDBError::bad_value(format!(
+                    "Invalid read preference mode: {}",
+                    other
+                )))
+            }
+        };
+
+        // maxStalenessSeconds of -1 means no maximum
+        let max_staleness = read_preference
+            .get("maxStalenessSeconds")?
+            .and_then(|value| {
+                value
+                    .as_i64()
+                    .or(value.as_i32().map(i64::from))
+                    .or(value.as_f64().map(|f| f as i64))
+            })
+            .filter(|seconds| *seconds > 0)
+            .map(|seconds| Duration::from_secs(seconds as u64));
+
+        Ok(ReadPreference {
+            mode,
+            max_staleness,
+        })
+    }
+}
+
+#[derive(Debug)]
+struct Replica {
+    host_name: String,
+
+    // The replay lag last measured by the monitor
+    lag_ms: AtomicU64,
+}
+
+/// The read replicas of the Postgres primary and how far behind it each of them is.
+/// Reads with a secondary readPreference are spread over the replicas that are
+/// within the allowed lag.
+#[derive(Debug)]
+pub struct ReplicaSet {
+    replicas: Arc<Vec<Replica>>,
+    next_replica: AtomicUsize,
+    _monitor: Option<JoinHandle<()>>,
+}
+
+impl ReplicaSet {
+    pub fn new(setup_configuration: &dyn SetupConfiguration, query_catalog: &QueryCatalog) -> Self {
+        let replicas: Arc<Vec<Replica>> = Arc::new(
+            setup_configuration
+                .postgres_replica_host_names()
+                .iter()
+                .map(|host_name| Replica {
+                    host_name: host_name.clone(),
+                    lag_ms: AtomicU64::new(UNREACHABLE_LAG_MS),
+                })
+                .collect(),
+        );
+
+        let monitor = if replicas.is_empty() {
+            None
+        } else {
+            let monitor_pools = replicas
+                .iter()
+                .map(|replica| {
+                    ConnectionPool::new_with_user_on_host(
+                        setup_configuration,
+                        query_catalog,
+                        &replica.host_name,
+                        setup_configuration.postgres_port(),
+                        &setup_configuration.postgres_system_user(),
+                        None,
+                        format!("{}-ReplicaMonitor", setup_configuration.application_name()),
+                        1,
+                    )
+                    .inspect_err(|e| {
+                        log::error!(
+                            "Failed to create the pool monitoring replica {}: {}",
+                            replica.host_name,
+                            e
+                        )
+                    })
+                    .ok()
+                })
+                .collect::<Vec<_>>();
+
+            let replicas = Arc::clone(&replicas);
+            let replica_lag_query = query_catalog.replica_lag().to_string();
+            Some(tokio::spawn(async move {
+                let mut lag_check_interval = tokio::time::interval(LAG_CHECK_INTERVAL);
+                loop {
+                    lag_check_interval.tick().await;
+                    for (replica, pool) in replicas.iter().zip(monitor_pools.iter()) {
+                        let lag_ms = match pool {
+                            Some(pool) => measure_lag(pool, &replica_lag_query)
+                                .await
+                                .inspect_err(|e| {
+                                    log::warn!(
+                                        "Failed to measure the lag of replica {}: {}",
+                                        replica.host_name,
+                                        e
+                                    )
+                                })
+                                .unwrap_or(UNREACHABLE_LAG_MS),
+                            None => UNREACHABLE_LAG_MS,
+                        };
+                        replica.lag_ms.store(lag_ms, Ordering::Relaxed);
+                    }
+                }
+            }))
+        };
+
+        ReplicaSet {
+            replicas,
+            next_replica: AtomicUsize::new(0),
+            _monitor: monitor,
+        }
+    }
+
+    pub fn host_names(&self) -> impl Iterator<Item = &str> {
+        self.replicas
+            .iter()
+            .map(|replica| replica.host_name.as_str())
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.replicas.is_empty()
+    }
+
+    /// Picks the replica a read with the preference should run on, None for the primary.
+    pub fn select(
+        &self,
+        read_preference: &ReadPreference,
+        default_max_lag: Duration,
+    ) -> Result<Option<usize>> {
+        if matches!(
+            read_preference.mode,
+            ReadPreferenceMode::Primary | ReadPreferenceMode::PrimaryPreferred
+        ) {
+            return Ok(None);
+        }
+
+        // Unreachable replicas are never within the allowed lag
+        let max_lag_ms = u64::try_from(
+            read_preference
+                .max_staleness
+                .unwrap_or(default_max_lag)
+                .as_millis(),
+        )
+        .unwrap_or(UNREACHABLE_LAG_MS)
+        .min(UNREACHABLE_LAG_MS - 1);
+        let eligible: Vec<usize> = self
+            .replicas
+            .iter()
+            .enumerate()
+            .filter(|(_, replica)| replica.lag_ms.load(Ordering::Relaxed) <= max_lag_ms)
+            .map(|(index, _)| index)
+            .collect();
+
+        if eligible.is_empty() {
+            return match read_preference.mode {
+                ReadPreferenceMode::Secondary => Err(DocumentDBError::documentdb_error(
+                    ErrorCode::FailedToSatisfyReadPreference,
+                    "No replica is available within the allowed staleness".to_string(),
+                )),
+                _ => Ok(None),
+            };
+        }
+
+        let next = self.next_replica.fetch_add(1, Ordering::Relaxed);
+        Ok(Some(eligible[next % eligible.len()]))
+    }
+}
+
+async fn measure_lag(pool: &ConnectionPool, replica_lag_query: &str) -> Result<u64> {
+    let connection = pool.get_inner_connection().await?;
+    let row = connection.query_one(replica_lag_query, &[]).await?;
+    let lag_ms: i64 = row.try_get(0)?;
+    Ok(lag_ms.max(0) as u64)
+}
@@ -0,0 +1,403 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/postgres/shard_map.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use std::{collections::HashMap, sync::Arc, time::Duration};
+
+use arc_swap::ArcSwap;
+use bson::{spec::ElementType, RawBsonRef, RawDocument};
+use tokio::task::JoinHandle;
+
+use crate::error::Result;
+
+use super::{ConnectionPool, PgDocument};
+
+// How often the shard placements are read from the coordinator
+const SHARD_MAP_REFRESH_INTERVAL: Duration = Duration::from_secs(30);
+
+/// A node of the cluster holding shards, as the gateway connects to it.
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct WorkerNode {
+    pub host_name: String,
+    pub port: u16,
+}
+
+/// Where the shard key of a command is read from.
+pub enum ShardKeySource<'a> {
+    /// A query filter, which has to match the shard key by equality
+    Filter(&'a RawDocument),
+
+    /// A document being inserted
+    Document(&'a RawDocument),
+}
+
+#[derive(Debug)]
+struct ShardPlacement {
+    min_hash: i32,
+    max_hash: i32,
+    node: usize,
+}
+
+#[derive(Debug)]
+struct CollectionShards {
+    // The paths of the hashed shard key, None for an unsharded collection
+    shard_key: Option<Vec<String>>,
+
+    // Sorted by min_hash
+    placements: Vec<ShardPlacement>,
+}
+
+#[derive(Debug, Default)]
+struct ShardMap {
+    nodes: Vec<WorkerNode>,
+    collections: HashMap<(String, String), CollectionShards>,
+}
+
+/// The placement of the shards of every collection, read from the coordinator's
+/// metadata. Commands touching a single shard are sent straight to the worker
+/// holding it rather than through the coordinator, saving a hop and the
+/// coordinator's planning. A stale map only costs that hop: the worker routes
+/// a command for a shard it doesn't hold like the coordinator would.
+pub struct ShardRouter {
+    map: Arc<ArcSwap<ShardMap>>,
+    refresher: Option<JoinHandle<()>>,
+}
+
+impl ShardRouter {
+    pub fn new(
+        enabled: bool,
+        system_pool: Arc<ConnectionPool>,
+        shard_placements_query: &str,
+    ) -> Self {
+        let map = Arc::new(ArcSwap::from_pointee(ShardMap::default()));
+        if !enabled {
+            return ShardRouter {
+                map,
+                refresher: None,
+            };
+        }
+
+        let refreshed_map = Arc::clone(&map);
+        let shard_placements_query = shard_placements_query.to_string();
+        let refresher = tokio::spawn(async move {
+            let mut refresh_interval = tokio::time::interval(SHARD_MAP_REFRESH_INTERVAL);
+            loop {
+                refresh_interval.tick().await;
+                match load_shard_map(&system_pool, &shard_placements_query).await {
+                    Ok(map) => refreshed_map.store(Arc::new(map)),
+                    Err(e) => log::warn!("Failed to refresh the shard map: {}", e),
+                }
+            }
+        });
+
+        ShardRouter {
+            map,
+            refresher: Some(refresher),
+        }
+    }
+
+    pub fn is_enabled(&self) -> bool {
+        self.refresher.is_some()
+    }
+
+    /// Returns the worker holding the shard every source resolves to, None if
+    /// they span shards, the shard key can't be resolved or the shard is unknown.
+    pub fn route(
+        &self,
+        db: &str,
+        collection: &str,
+        sources: &[ShardKeySource<'_>],
+    ) -> Option<WorkerNode> {
+        let map = self.map.load();
+        let shards = map
+            .collections
+            .get(&(db.to_string(), collection.to_string()))?;
+
+        let node = match shards.shard_key.as_ref() {
+            None => shards.placements.first()?.node,
+            Some(shard_key) => {
+                let mut node = None;
+                for source in sources {
+                    let hash = citus_hash_int8(shard_key_value(shard_key, source)?);
+                    let placement = shards.placements.iter().find(|placement| {
+                        placement.min_hash <= hash && hash <= placement.max_hash
+                    })?;
+                    if node.is_some_and(|node| node != placement.node) {
+                        return None;
+                    }
+                    node = Some(placement.node);
+                }
+                node?
+            }
+        };
+
+        map.nodes.get(node).cloned()
+    }
+}
+
+async fn load_shard_map(pool: &ConnectionPool, shard_placements_query: &str) -> Result<ShardMap> {
+    let connection = pool.get_inner_connection().await?;
+    let rows = connection.query(shard_placements_query, &[]).await?;
+
+    let mut map = ShardMap::default();
+    let mut node_indexes = HashMap::new();
+    for row in rows {
+        let db: String = row.try_get(0)?;
+        let collection: String = row.try_get(1)?;
+        let shard_key: Option<PgDocument> = row.try_get(2)?;
+        let min_hash: Option<i32> = row.try_get(3)?;
+        let max_hash: Option<i32> = row.try_get(4)?;
+        let node = WorkerNode {
+            host_name: row.try_get(5)?,
+            port: u16::try_from(row.try_get::<_, i32>(6)?).unwrap_or_default(),
+        };
+
+        // Only hashed shard keys are routed, e.g. not time bucketed ones
+        let shard_key = match shard_key {
+            None => None,
+            Some(PgDocument(shard_key)) => {
+                let mut paths = Vec::new();
+                for element in shard_key {
+                    let (path, spec) = element?;
+                    if spec.as_str() != Some("hashed") {
+                        paths.clear();
+                        break;
+                    }
+                    paths.push(path.to_string());
+                }
+                if paths.is_empty() {
+                    continue;
+                }
+                Some(paths)
+            }
+        };
+
+        let node_count = map.nodes.len();
+        let node = *node_indexes.entry(node.clone()).or_insert_with(|| {
+            map.nodes.push(node);
+            node_count
+        });
+
+        let shards = map
+            .collections
+            .entry((db, collection))
+            .or_insert_with(|| CollectionShards {
+                shard_key,
+                placements: Vec::new(),
+            });
+
+        // A replicated shard keeps the first of its placements
+        let min_hash = min_hash.unwrap_or(i32::MIN);
+        if shards
+            .placements
+            .iter()
+            .all(|placement| placement.min_hash != min_hash)
+        {
+            shards.placements.push(ShardPlacement {
+                min_hash,
+                max_hash: max_hash.unwrap_or(i32::MAX),
+                node,
+            });
+        }
+    }
+
+    for shards in map.collections.values_mut() {
+        shards
+            .placements
+            .sort_by_key(|placement| placement.min_hash);
+    }
+    Ok(map)
+}
+
+// The shard_key_value the extension stores a document with, the hash of the
+// values of the shard key paths each seeded by the previous one.
+// CODESYNC: ComputeShardKeyHashForDocument in sharding.c and BsonValueHash in bson_hash.c
+fn shard_key_value(shard_key: &[String], source: &ShardKeySource<'_>) -> Option<i64> {
+    let mut shard_key_value = 0u64;
+    for path in shard_key {
+        let value = match source {
+            ShardKeySource::Filter(filter) => filter_equality_value(filter, path)?,
+            ShardKeySource::Document(document) => document_value(document, path)?,
+        };
+        shard_key_value = bson_value_hash(value, shard_key_value)?;
+    }
+    Some(shard_key_value as i64)
+}
+
+// The value a filter matches the path with by equality
+fn filter_equality_value<'a>(filter: &'a RawDocument, path: &str) -> Option<RawBsonRef<'a>> {
+    let value = filter.get(path).ok()??;
+    let value = match value {
+        RawBsonRef::Document(operators) => match operators.into_iter().next() {
+            Some(Ok((operator, value))) if operator.starts_with('$') => {
+                if operator != "$eq" || operators.into_iter().nth(1).is_some() {
+                    return None;
+                }
+                value
+            }
+            _ => value,
+        },
+        _ => value,
+    };
+
+    // An array or a regex matches more than the values equal to it
+    match value {
+        RawBsonRef::Array(_) | RawBsonRef::RegularExpression(_) => None,
+        _ => Some(value),
+    }
+}
+
+// The value of the path in a document, null when it's missing
+fn document_value<'a>(document: &'a RawDocument, path: &str) -> Option<RawBsonRef<'a>> {
+    let mut current = document;
+    let mut segments = path.split('.').peekable();
+    while let Some(segment) = segments.next() {
+        let value = match current.get(segment).ok()? {
+            Some(value) => value,
+            None => return Some(RawBsonRef::Null),
+        };
+        if segments.peek().is_none() {
+            return match value {
+                RawBsonRef::Array(_) => None,
+                _ => Some(value),
+            };
+        }
+        current = match value {
+            RawBsonRef::Document(nested) => nested,
+            RawBsonRef::Array(_) => return None,
+            _ => return Some(RawBsonRef::Null),
+        };
+    }
+    None
+}
+
+// Hashes the type, then the value, of the types a shard key routinely has
+fn bson_value_hash(value: RawBsonRef<'_>, seed: u64) -> Option<u64> {
+    // All numbers hash as doubles, so that 1 and 1.0 land on the same shard
+    let hash_type = match value.element_type() {
+        ElementType::Int32 | ElementType::Int64 => ElementType::Double,
+        element_type => element_type,
+    };
+    let hash = hash_bytes_uint32_extended(hash_type as u32, seed);
+
+    Some(match value {
+        RawBsonRef::Null | RawBsonRef::Undefined | RawBsonRef::MinKey | RawBsonRef::MaxKey => hash,
+        RawBsonRef::Boolean(value) => hash_bytes_uint32_extended(value as u32, hash),
+        RawBsonRef::Int32(value) => hash_bytes_extended(&(value as f64).to_le_bytes(), hash),
+        RawBsonRef::Int64(value) => hash_bytes_extended(&(value as f64).to_le_bytes(), hash),
+        RawBsonRef::Double(value) => hash_bytes_extended(&value.to_le_bytes(), hash),
+        RawBsonRef::DateTime(value) => {
+            hash_bytes_extended(&value.timestamp_millis().to_le_bytes(), hash)
+        }
+        RawBsonRef::ObjectId(value) => hash_bytes_extended(&value.bytes(), hash),
+        RawBsonRef::Decimal128(value) => hash_bytes_extended(&value.bytes(), hash),
+        RawBsonRef::String(value) => hash_bytes_extended(value.as_bytes(), hash),
+        RawBsonRef::Document(value) => hash_bytes_extended(value.as_bytes(), hash),
+        RawBsonRef::Binary(value) => hash_bytes_extended(value.bytes, hash),
+        _ => return None,
+    })
+}
+
+// Citus hashes the int8 shard_key_value column with Postgres' hashint8
+fn citus_hash_int8(value: i64) -> i32 {
+    let low = value as u32;
+    let high = (value >> 32) as u32;
+    let folded = low ^ if value >= 0 { high } else { !high };
+
+    let (mut a, mut b, mut c) = initial_state(4);
+    a = a.wrapping_add(folded);
+    final_mix(&mut a, &mut b, &mut c);
+    c as i32
+}
+
+// Postgres' hash_bytes_extended (Bob Jenkins' lookup3), on a little endian host
+fn hash_bytes_extended(key: &[u8], seed: u64) -> u64 {
+    let (mut a, mut b, mut c) = seeded_state(key.len() as u32, seed);
+
+    let mut blocks = key.chunks_exact(12);
+    for block in &mut blocks {
+        a = a.wrapping_add(u32::from_le_bytes(block[0..4].try_into().unwrap()));
+        b = b.wrapping_add(u32::from_le_bytes(block[4..8].try_into().unwrap()));
+        c = c.wrapping_add(u32::from_le_bytes(block[8..12].try_into().unwrap()));
+        mix(&mut a, &mut b, &mut c);
+    }
+
+    // The lowest byte of c is reserved for the length
+    let tail = blocks.remainder();
+    for (index, byte) in tail.iter().enumerate() {
+        let byte = u32::from(*byte);
+        match index {
+            0..=3 => a = a.wrapping_add(byte << (8 * index)),
+            4..=7 => b = b.wrapping_add(byte << (8 * (index - 4))),
+            _ => c = c.wrapping_add(byte << (8 * (index - 7))),
+        }
+    }
+
+    final_mix(&mut a, &mut b, &mut c);
+    (u64::from(b) << 32) | u64::from(c)
+}
+
+// Postgres' hash_bytes_uint32_extended
+fn hash_bytes_uint32_extended(key: u32, seed: u64) -> u64 {
+    let (mut a, mut b, mut c) = seeded_state(4, seed);
+    a = a.wrapping_add(key);
+    final_mix(&mut a, &mut b, &mut c);
+    (u64::from(b) << 32) | u64::from(c)
+}
+
+fn initial_state(length: u32) -> (u32, u32, u32) {
+    let initial = 0x9e3779b9u32.wrapping_add(length).wrapping_add(3923095);
+    (initial, initial, initial)
+}
+
+fn seeded_state(length: u32, seed: u64) -> (u32, u32, u32) {
+    let (mut a, mut b, mut c) = initial_state(length);
+    if seed != 0 {
+        a = a.wrapping_add((seed >> 32) as u32);
+        b = b.wrapping_add(seed as u32);
+        mix(&mut a, &mut b, &mut c);
+    }
+    (a, b, c)
+}
+
+fn mix(a: &mut u32, b: &mut u32, c: &mut u32) {
+    *a = a.wrapping_sub(*c);
+    *a ^= c.rotate_left(4);
+    *c = c.wrapping_add(*b);
+    *b = b.wrapping_sub(*a);
+    *b ^= a.rotate_left(6);
+    *a = a.wrapping_add(*c);
+    *c = c.wrapping_sub(*b);
+    *c ^= b.rotate_left(8);
+    *b = b.wrapping_add(*a);
+    *a = a.wrapping_sub(*c);
+    *a ^= c.rotate_left(16);
+    *c = c.wrapping_add(*b);
+    *b = b.wrapping_sub(*a);
+    *b ^= a.rotate_left(19);
+    *a = a.wrapping_add(*c);
+    *c = c.wrapping_sub(*b);
+    *c ^= b.rotate_left(4);
+    *b = b.wrapping_add(*a);
+}
+
+fn final_mix(a: &mut u32, b: &mut u32, c: &mut u32) {
+    *c ^= *b;
+    *c = c.wrapping_sub(b.rotate_left(14));
+    *a ^= *c;
+    *a = a.wrapping_sub(c.rotate_left(11));
+    *b ^= *a;
+    *b = b.wrapping_sub(a.rotate_left(25));
+    *c ^= *b;
+    *c = c.wrapping_sub(b.rotate_left(16));
+    *a ^= *c;
+    *a = a.wrapping_sub(c.rotate_left(4));
+    *b ^= *a;
+    *b = b.wrapping_sub(a.rotate_left(14));
+    *c ^= *b;
+    *c = c.wrapping_sub(b.rotate_left(24));
+}
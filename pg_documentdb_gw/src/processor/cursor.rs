@@ -26,10 +26,12 @@ pub async fn save_cursor(
     request_info: &RequestInfo<'_>,
 ) -> Result<()> {
     if let Some((persist, cursor)) = response.get_cursor()? {
+        let replica_index = connection.replica_index;
         let connection = if persist { Some(connection) } else { None };
         connection_context
             .add_cursor(
                 connection,
+                replica_index,
                 cursor,
                 connection_context.auth_state.username()?,
                 request_info.db()?,
@@ -114,6 +116,7 @@ pub async fn process_get_more(
     ))?;
     let CursorStoreEntry {
         conn: cursor_connection,
+        replica_index,
         cursor,
         db,
         collection,
@@ -133,6 +136,7 @@ pub async fn process_get_more(
             &db,
             &cursor,
             &cursor_connection,
+            replica_index,
             connection_context,
         )
         .await?;
@@ -143,6 +147,7 @@ pub async fn process_get_more(
             connection_context
                 .add_cursor(
                     cursor_connection,
+                    replica_index,
                     Cursor {
                         cursor_id: id,
                         continuation: continuation.0.to_raw_document_buf(),
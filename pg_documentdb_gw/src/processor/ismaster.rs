@@ -17,7 +17,10 @@ use crate::{
     configuration::DynamicConfiguration,
     context::{ConnectionContext, RequestContext},
     error::{DocumentDBError, ErrorCode, Result},
-    protocol::{MAX_BSON_OBJECT_SIZE, MAX_MESSAGE_SIZE_BYTES, OK_SUCCEEDED},
+    protocol::{
+        compression::negotiate_compressors, MAX_BSON_OBJECT_SIZE, MAX_MESSAGE_SIZE_BYTES,
+        OK_SUCCEEDED,
+    },
     responses::{RawResponse, Response},
 };
 
@@ -65,6 +68,11 @@ pub async fn process(
         "ok": OK_SUCCEEDED,
     };
 
+    // Reply with the compressors the client asked for that are supported
+    if let Some(compressors) = negotiate_compressors(request.document()) {
+        response_doc.append("compression", compressors);
+    }
+
     // Add the operationTime field if change streams GUC is enabled
     if dynamic_configuration.enable_change_streams().await {
         response_doc.append(
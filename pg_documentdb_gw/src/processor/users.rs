@@ -28,9 +28,11 @@ pub async fn process_drop_user(
     connection_context: &mut ConnectionContext,
     pg_data_client: &impl PgDataClient,
 ) -> Result<Response, DocumentDBError> {
-    pg_data_client
+    let response = pg_data_client
         .execute_drop_user(request_context, connection_context)
-        .await
+        .await;
+    invalidate_scram_secret(request_context, connection_context, "dropUser");
+    response
 }
 
 pub async fn process_update_user(
@@ -38,9 +40,11 @@ pub async fn process_update_user(
     connection_context: &mut ConnectionContext,
     pg_data_client: &impl PgDataClient,
 ) -> Result<Response, DocumentDBError> {
-    pg_data_client
+    let response = pg_data_client
         .execute_update_user(request_context, connection_context)
-        .await
+        .await;
+    invalidate_scram_secret(request_context, connection_context, "updateUser");
+    response
 }
 
 pub async fn process_users_info(
@@ -62,3 +66,17 @@ pub async fn process_connection_status(
         .execute_connection_status(request_context, connection_context)
         .await
 }
+
+// Drops the cached secret of a user this gateway changed, so that the next login reads it again
+fn invalidate_scram_secret(
+    request_context: &RequestContext<'_>,
+    connection_context: &ConnectionContext,
+    command: &str,
+) {
+    if let Ok(username) = request_context.payload.document().get_str(command) {
+        connection_context
+            .service_context
+            .scram_secret_cache()
+            .invalidate(username);
+    }
+}
@@ -0,0 +1,191 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/protocol/compression.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use bson::{RawArrayBuf, RawDocument};
+use miniz_oxide::deflate::core::{
+    compress, create_comp_flags_from_zip_params, CompressorOxide, TDEFLFlush, TDEFLStatus,
+};
+
+use crate::{
+    error::{DocumentDBError, Result},
+    protocol::{header::Header, opcode::OpCode, MAX_MESSAGE_SIZE_BYTES},
+};
+
+/// Responses smaller than this are sent uncompressed, since compressing them
+/// costs more than the bandwidth it saves.
+pub const MIN_COMPRESSED_MESSAGE_SIZE: usize = 1024;
+
+/// Size of the OP_COMPRESSED fields preceding the compressed message
+/// (original opcode, uncompressed size and compressor id).
+pub const COMPRESSED_HEADER_LENGTH: usize =
+    std::mem::size_of::<i32>() + std::mem::size_of::<i32>() + std::mem::size_of::<u8>();
+
+const ZLIB_COMPRESSION_LEVEL: u8 = 6;
+
+/// The compressors of the wire protocol, by their OP_COMPRESSED compressor id.
+#[derive(Copy, Clone, Debug, Eq, PartialEq)]
+pub enum Compressor {
+    Noop = 0,
+    Zlib = 2,
+}
+
+impl Compressor {
+    pub fn from_id(id: u8) -> Result<Self> {
+        match id {
+            0 => Ok(Compressor::Noop),
+            2 => Ok(Compressor::Zlib),
+            _ => Err(DocumentDBError::bad_value(format!(
+                "Unsupported compressor id: {}",
+                id
+            ))),
+        }
+    }
+
+    fn from_name(name: &str) -> Option<Self> {
+        match name {
+            "zlib" => Some(Compressor::Zlib),
+            _ => None,
+        }
+    }
+
+    fn name(&self) -> &'static str {
+        match self {
+            Compressor::Noop => "noop",
+            Compressor::Zlib => "zlib",
+        }
+    }
+
+    /// Compresses the concatenation of the parts, which are read in place so that a
+    /// large response document isn't copied next to its header to be compressed.
+    pub fn compress(&self, parts: &[&[u8]]) -> Vec<u8> {
+        match self {
+            Compressor::Noop => parts.concat(),
+            Compressor::Zlib => zlib_compress(parts),
+        }
+    }
+
+    pub fn decompress(&self, message: &[u8], uncompressed_size: usize) -> Result<Vec<u8>> {
+        let decompressed =
+            match self {
+                Compressor::Noop => message.to_vec(),
+                Compressor::Zlib => miniz_oxide::inflate::decompress_to_vec_zlib_with_limit(
+                    message,
+                    uncompressed_size,
+                )
+                .map_err(|e| {
+                    DocumentDBError::bad_value(format!("Failed to decompress zlib message: {}", e))
+                })?,
+            };
+
+        if decompressed.len() != uncompressed_size {
+            return Err(DocumentDBError::bad_value(format!(
+                "Decompressed message was {} bytes, expected {}",
+                decompressed.len(),
+                uncompressed_size
+            )));
+        }
+        Ok(decompressed)
+    }
+}
+
+fn zlib_compress(parts: &[&[u8]]) -> Vec<u8> {
+    // A positive window size makes the compressor write the zlib header and checksum
+    let flags = create_comp_flags_from_zip_params(ZLIB_COMPRESSION_LEVEL.into(), 1, 0);
+    let mut compressor = CompressorOxide::new(flags);
+
+    let input_length: usize = parts.iter().map(|part| part.len()).sum();
+    let mut output = vec![0; (input_length / 2).max(64)];
+    let mut output_position = 0;
+
+    let empty: &[u8] = &[];
+    let chunks = parts
+        .iter()
+        .map(|part| (*part, TDEFLFlush::None))
+        .chain(std::iter::once((empty, TDEFLFlush::Finish)));
+    for (mut input, flush) in chunks {
+        loop {
+            let (status, bytes_in, bytes_out) = compress(
+                &mut compressor,
+                input,
+                &mut output[output_position..],
+                flush,
+            );
+            output_position += bytes_out;
+            input = &input[bytes_in..];
+
+            match status {
+                TDEFLStatus::Done => {
+                    output.truncate(output_position);
+                    return output;
+                }
+                TDEFLStatus::Okay if input.is_empty() && flush == TDEFLFlush::None => break,
+                TDEFLStatus::Okay => {
+                    if output.len() - output_position < 30 {
+                        output.resize(output.len() * 2, 0);
+                    }
+                }
+                _ => unreachable!("zlib compression of an in-memory buffer can't fail"),
+            }
+        }
+    }
+
+    output.truncate(output_position);
+    output
+}
+
+/// Returns the compressors of the client's hello `compression` list that the
+/// gateway supports, in the client's order of preference.
+pub fn negotiate_compressors(request: &RawDocument) -> Option<RawArrayBuf> {
+    let requested = request.get_array("compression").ok()?;
+
+    let mut supported = RawArrayBuf::new();
+    for name in requested.into_iter().flatten() {
+        if let Some(compressor) = name.as_str().and_then(Compressor::from_name) {
+            supported.push(compressor.name());
+        }
+    }
+    Some(supported)
+}
+
+/// Reads the fields of an OP_COMPRESSED message into the header and returns the
+/// decompressed message. The header takes the original opcode before the message
+/// is decompressed so that a failure is replied to in the client's format.
+pub fn read_compressed_message(header: &mut Header, message: &[u8]) -> Result<Vec<u8>> {
+    if message.len() < COMPRESSED_HEADER_LENGTH {
+        return Err(DocumentDBError::bad_value(
+            "Compressed message was shorter than its header".to_string(),
+        ));
+    }
+
+    let op_code = OpCode::from_value(i32::from_le_bytes(
+        message[0..4].try_into().expect("Slice of wrong length"),
+    ));
+    let uncompressed_size =
+        i32::from_le_bytes(message[4..8].try_into().expect("Slice of wrong length"));
+    if op_code == OpCode::Compressed || op_code == OpCode::INVALID {
+        return Err(DocumentDBError::bad_value(format!(
+            "Invalid original opcode of a compressed message: {:?}",
+            op_code
+        )));
+    }
+    header.op_code = op_code;
+
+    if !(0..=MAX_MESSAGE_SIZE_BYTES).contains(&uncompressed_size) {
+        return Err(DocumentDBError::bad_value(format!(
+            "Invalid uncompressed size of a compressed message: {}",
+            uncompressed_size
+        )));
+    }
+
+    let compressor = Compressor::from_id(message[8])?;
+    header.compressor = Some(compressor);
+    compressor.decompress(
+        &message[COMPRESSED_HEADER_LENGTH..],
+        uncompressed_size as usize,
+    )
+}
@@ -8,7 +8,11 @@
 
 use tokio::io::{AsyncReadExt, AsyncWriteExt};
 
-use crate::{error::Result, protocol::opcode::OpCode, GwStream};
+use crate::{
+    error::Result,
+    protocol::{compression::Compressor, opcode::OpCode},
+    GwStream,
+};
 
 /// Represents the message header (first 16 bytes of wire protocol message).
 ///
@@ -20,6 +24,10 @@ pub struct Header {
     pub request_id: i32,
     pub response_to: i32,
     pub op_code: OpCode,
+
+    /// The compressor of a request that came in an OP_COMPRESSED, which its
+    /// response is compressed with. Not part of the wire format of the header.
+    pub compressor: Option<Compressor>,
 }
 
 impl Header {
@@ -36,16 +44,21 @@ impl Header {
     /// # Errors
     /// Returns an error if writing to the stream fails.
     pub async fn write_to(&self, stream: &mut GwStream) -> Result<()> {
-        stream.write_all(&self.length.to_le_bytes()).await?;
-        stream.write_all(&self.request_id.to_le_bytes()).await?;
-        stream.write_all(&self.response_to.to_le_bytes()).await?;
-        stream
-            .write_all(&(self.op_code as i32).to_le_bytes())
-            .await?;
+        stream.write_all(&self.to_bytes()).await?;
 
         Ok(())
     }
 
+    /// Returns the header in wire format, for writing along with the message.
+    pub fn to_bytes(&self) -> [u8; Header::LENGTH] {
+        let mut bytes = [0u8; Header::LENGTH];
+        bytes[0..4].copy_from_slice(&self.length.to_le_bytes());
+        bytes[4..8].copy_from_slice(&self.request_id.to_le_bytes());
+        bytes[8..12].copy_from_slice(&self.response_to.to_le_bytes());
+        bytes[12..16].copy_from_slice(&(self.op_code as i32).to_le_bytes());
+        bytes
+    }
+
     /// Reads a header from the provided stream.
     ///
     /// Reads exactly 16 bytes from the stream and parses them as wire protocol header
@@ -72,6 +85,7 @@ impl Header {
             request_id,
             response_to,
             op_code,
+            compressor: None,
         })
     }
 }
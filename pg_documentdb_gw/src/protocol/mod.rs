@@ -8,6 +8,7 @@
 
 use crate::error::{DocumentDBError, Result};
 
+pub mod compression;
 pub mod header;
 pub mod message;
 pub mod opcode;
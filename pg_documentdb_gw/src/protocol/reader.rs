@@ -16,7 +16,7 @@ use tokio::io::AsyncReadExt;
 
 use crate::{
     error::{DocumentDBError, Result},
-    protocol::{extract_database_and_collection_names, opcode::OpCode},
+    protocol::{compression, extract_database_and_collection_names, opcode::OpCode},
     requests::{Request, RequestMessage, RequestType},
     GwStream,
 };
@@ -44,8 +44,10 @@ pub async fn read_header(stream: &mut GwStream) -> Result<Option<Header>> {
     }
 }
 
-/// Given an already read header, read the remaining message bytes into a RequestMessage
-pub async fn read_request(header: &Header, stream: &mut GwStream) -> Result<RequestMessage> {
+/// Given an already read header, read the remaining message bytes into a RequestMessage.
+/// An OP_COMPRESSED message is decompressed, and the header takes its original opcode
+/// and compressor so that the response is written alike.
+pub async fn read_request(header: &mut Header, stream: &mut GwStream) -> Result<RequestMessage> {
     let message_size = usize::try_from(header.length).map_err(|_| {
         DocumentDBError::bad_value("Message length could not be converted to a usize".to_string())
     })?;
@@ -55,6 +57,10 @@ pub async fn read_request(header: &Header, stream: &mut GwStream) -> Result<Requ
 
     stream.read_exact(&mut message).await?;
 
+    if header.op_code == OpCode::Compressed {
+        message = compression::read_compressed_message(header, &message)?;
+    }
+
     Ok(RequestMessage {
         request: message,
         op_code: header.op_code,
@@ -67,11 +73,14 @@ pub async fn read_request(header: &Header, stream: &mut GwStream) -> Result<Requ
 pub async fn parse_request<'a>(
     message: &'a RequestMessage,
     requires_response: &mut bool,
+    exhaust_allowed: &mut bool,
 ) -> Result<Request<'a>> {
+    *exhaust_allowed = false;
+
     // Parse the specific message based on OpCode
     let request = match message.op_code {
         OpCode::Query => parse_query(&message.request).await?,
-        OpCode::Msg => parse_msg(message, requires_response).await?,
+        OpCode::Msg => parse_msg(message, requires_response, exhaust_allowed).await?,
         OpCode::Insert => parse_insert(message).await?,
         _ => Err(DocumentDBError::internal_error(format!(
             "Unimplemented: {:?}",
@@ -138,11 +147,13 @@ pub fn str_from_u8_nul_utf8(utf8_src: &[u8]) -> Result<(&str, usize)> {
 async fn parse_msg<'a>(
     message: &'a RequestMessage,
     requires_response: &mut bool,
+    exhaust_allowed: &mut bool,
 ) -> Result<Request<'a>> {
     let reader = Cursor::new(message.request.as_slice());
     let msg: Message = Message::read_from_op_msg(reader, message.response_to)?;
 
     *requires_response = !msg._flags.contains(message::MessageFlags::MORE_TO_COME);
+    *exhaust_allowed = msg._flags.contains(message::MessageFlags::EXHAUST_ALLOWED);
     match msg.sections.len() {
         0 => Err(DocumentDBError::bad_value(
             "Message had no sections".to_string(),
@@ -6,6 +6,7 @@
  *-------------------------------------------------------------------------
  */
 
+pub mod request_metrics;
 pub mod request_tracker;
 
 use std::{
@@ -74,7 +75,7 @@ impl RequestInfo<'_> {
     }
 }
 
-#[derive(PartialEq, Debug)]
+#[derive(PartialEq, Debug, Clone, Copy)]
 pub enum RequestType {
     AbortTransaction,
     Aggregate,
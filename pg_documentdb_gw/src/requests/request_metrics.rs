@@ -0,0 +1,229 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/requests/request_metrics.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+use std::{
+    fmt::Write,
+    sync::{
+        atomic::{AtomicU64, Ordering},
+        Arc,
+    },
+    time::{SystemTime, UNIX_EPOCH},
+};
+
+use arc_swap::ArcSwapOption;
+
+use crate::requests::{request_tracker::RequestTracker, RequestIntervalKind, RequestType};
+
+// Bucket i counts the durations of up to FIRST_BUCKET_NS << i, the last one the rest (+Inf)
+const FIRST_BUCKET_NS: u64 = 16_000;
+const BUCKET_COUNT: usize = 24;
+
+// An exemplar is replaced by a newer request once it's this old
+const EXEMPLAR_REFRESH_MS: u64 = 10_000;
+
+const REQUEST_TYPE_COUNT: usize = RequestType::WhatsMyUri as usize + 1;
+
+const METRIC_NAME: &str = "documentdb_gateway_request_phase_seconds";
+
+/// The phases of a request with a histogram, by their label.
+const PHASES: [(RequestIntervalKind, &str); 10] = [
+    (RequestIntervalKind::HandleRequest, "total"),
+    (RequestIntervalKind::BufferRead, "read"),
+    (RequestIntervalKind::FormatRequest, "parse"),
+    (RequestIntervalKind::AdmissionQueue, "admission_queue"),
+    (RequestIntervalKind::PoolWait, "pool_wait"),
+    (
+        RequestIntervalKind::PostgresBeginTransaction,
+        "postgres_begin",
+    ),
+    (
+        RequestIntervalKind::PostgresSetStatementTimeout,
+        "postgres_set_timeout",
+    ),
+    (RequestIntervalKind::ProcessRequest, "postgres"),
+    (
+        RequestIntervalKind::PostgresTransactionCommit,
+        "postgres_commit",
+    ),
+    (RequestIntervalKind::WriteResponse, "write"),
+];
+
+struct Exemplar {
+    activity_id: String,
+    duration_ns: u64,
+    timestamp_ms: u64,
+}
+
+struct Histogram {
+    buckets: [AtomicU64; BUCKET_COUNT + 1],
+    sum_ns: AtomicU64,
+    exemplars: [ArcSwapOption<Exemplar>; BUCKET_COUNT + 1],
+}
+
+impl Histogram {
+    fn new() -> Self {
+        Histogram {
+            buckets: std::array::from_fn(|_| AtomicU64::new(0)),
+            sum_ns: AtomicU64::new(0),
+            exemplars: std::array::from_fn(|_| ArcSwapOption::empty()),
+        }
+    }
+
+    fn bucket(duration_ns: u64) -> usize {
+        let units = duration_ns.div_ceil(FIRST_BUCKET_NS);
+        if units <= 1 {
+            0
+        } else {
+            ((u64::BITS - (units - 1).leading_zeros()) as usize).min(BUCKET_COUNT)
+        }
+    }
+
+    fn observe(&self, duration_ns: u64, activity_id: &str, now_ms: u64) {
+        let bucket = Self::bucket(duration_ns);
+        self.buckets[bucket].fetch_add(1, Ordering::Relaxed);
+        self.sum_ns.fetch_add(duration_ns, Ordering::Relaxed);
+
+        let exemplar = &self.exemplars[bucket];
+        let is_stale = exemplar.load().as_ref().is_none_or(|exemplar| {
+            now_ms.saturating_sub(exemplar.timestamp_ms) >= EXEMPLAR_REFRESH_MS
+        });
+        if is_stale {
+            exemplar.store(Some(Arc::new(Exemplar {
+                activity_id: activity_id.to_string(),
+                duration_ns,
+                timestamp_ms: now_ms,
+            })));
+        }
+    }
+
+    fn render(&self, labels: &str, output: &mut String) {
+        let counts: Vec<u64> = self
+            .buckets
+            .iter()
+            .map(|bucket| bucket.load(Ordering::Relaxed))
+            .collect();
+        let total: u64 = counts.iter().sum();
+        if total == 0 {
+            return;
+        }
+
+        let mut cumulative = 0;
+        for (bucket, count) in counts.iter().enumerate() {
+            cumulative += count;
+            let upper_bound = if bucket == BUCKET_COUNT {
+                "+Inf".to_string()
+            } else {
+                seconds(FIRST_BUCKET_NS << bucket)
+            };
+            let _ = write!(
+                output,
+                "{}_bucket{{{},le=\"{}\"}} {}",
+                METRIC_NAME, labels, upper_bound, cumulative
+            );
+            if let Some(exemplar) = self.exemplars[bucket].load().as_ref() {
+                let _ = write!(
+                    output,
+                    " # {{activity_id=\"{}\"}} {} {}.{:03}",
+                    exemplar.activity_id,
+                    seconds(exemplar.duration_ns),
+                    exemplar.timestamp_ms / 1000,
+                    exemplar.timestamp_ms % 1000
+                );
+            }
+            output.push('\n');
+        }
+        let _ = writeln!(
+            output,
+            "{}_sum{{{}}} {}",
+            METRIC_NAME,
+            labels,
+            seconds(self.sum_ns.load(Ordering::Relaxed))
+        );
+        let _ = writeln!(output, "{}_count{{{}}} {}", METRIC_NAME, labels, total);
+    }
+}
+
+fn seconds(nanos: u64) -> String {
+    format!("{}.{:09}", nanos / 1_000_000_000, nanos % 1_000_000_000)
+}
+
+/// Latency histograms of every phase of the requests, per command. Recording a
+/// request only takes atomic increments, so the metrics are always on, unlike
+/// the verbose latency log. Each bucket keeps the activity id of a recent request
+/// as an exemplar, to find the request in the logs.
+pub struct RequestMetrics {
+    // Indexed by request type, then by phase
+    histograms: Vec<[Histogram; PHASES.len()]>,
+    command_names: Vec<ArcSwapOption<String>>,
+}
+
+impl Default for RequestMetrics {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl RequestMetrics {
+    pub fn new() -> Self {
+        RequestMetrics {
+            histograms: (0..REQUEST_TYPE_COUNT)
+                .map(|_| std::array::from_fn(|_| Histogram::new()))
+                .collect(),
+            command_names: (0..REQUEST_TYPE_COUNT)
+                .map(|_| ArcSwapOption::empty())
+                .collect(),
+        }
+    }
+
+    /// Records the phases the request went through.
+    pub fn observe(
+        &self,
+        request_type: RequestType,
+        request_tracker: &RequestTracker,
+        activity_id: &str,
+    ) {
+        let command = request_type as usize;
+        if self.command_names[command].load().is_none() {
+            self.command_names[command].store(Some(Arc::new(request_type.to_string())));
+        }
+
+        let now_ms = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map_or(0, |now| now.as_millis() as u64);
+        for (histogram, (interval, _)) in self.histograms[command].iter().zip(PHASES.iter()) {
+            let duration_ns = request_tracker.get_interval_elapsed_time(*interval);
+            if duration_ns > 0 || matches!(interval, RequestIntervalKind::HandleRequest) {
+                histogram.observe(duration_ns.max(0) as u64, activity_id, now_ms);
+            }
+        }
+    }
+
+    /// Renders the histograms in the OpenMetrics text format, which carries the exemplars.
+    pub fn render(&self) -> String {
+        let mut output = String::new();
+        let _ = writeln!(output, "# TYPE {} histogram", METRIC_NAME);
+        let _ = writeln!(
+            output,
+            "# HELP {} Duration of the phases of gateway requests.",
+            METRIC_NAME
+        );
+
+        for (histograms, command_name) in self.histograms.iter().zip(self.command_names.iter()) {
+            let Some(command_name) = command_name.load_full() else {
+                continue;
+            };
+            for (histogram, (_, phase)) in histograms.iter().zip(PHASES.iter()) {
+                let labels = format!("command=\"{}\",phase=\"{}\"", command_name, phase);
+                histogram.render(&labels, &mut output);
+            }
+        }
+
+        output.push_str("# EOF\n");
+        output
+    }
+}
@@ -6,9 +6,11 @@
  *-------------------------------------------------------------------------
  */
 
+use std::time::Duration;
+
 use tokio::time::Instant;
 
-#[derive(Debug)]
+#[derive(Debug, Clone, Copy)]
 pub enum RequestIntervalKind {
     /// Interval kind for reading stream from request body. BufferRead + HandleRequest is the full duration of a request spent in the Gateway.
     BufferRead,
@@ -34,6 +36,15 @@ pub enum RequestIntervalKind {
     /// Time spent committing a Postgres transaction.
     PostgresTransactionCommit,
 
+    /// Time spent queued behind the user's concurrency and rate limits.
+    AdmissionQueue,
+
+    /// Time spent waiting for a Postgres connection from the pool.
+    PoolWait,
+
+    /// Time spent writing the response to the client stream.
+    WriteResponse,
+
     /// Special value used to define the size of the metrics array.
     MaxUnused,
 }
@@ -59,6 +70,10 @@ impl RequestTracker {
         self.request_interval_metrics_array[interval as usize] += elapsed.as_nanos() as i64;
     }
 
+    pub fn record_elapsed(&mut self, interval: RequestIntervalKind, elapsed: Duration) {
+        self.request_interval_metrics_array[interval as usize] += elapsed.as_nanos() as i64;
+    }
+
     pub fn get_interval_elapsed_time(&self, interval: RequestIntervalKind) -> i64 {
         self.request_interval_metrics_array[interval as usize]
     }
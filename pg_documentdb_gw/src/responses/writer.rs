@@ -9,13 +9,26 @@
 use crate::{
     context::ConnectionContext,
     error::{DocumentDBError, Result},
-    protocol::{header::Header, opcode::OpCode},
+    protocol::{
+        compression::{COMPRESSED_HEADER_LENGTH, MIN_COMPRESSED_MESSAGE_SIZE},
+        header::Header,
+        message::MessageFlags,
+        opcode::OpCode,
+    },
     responses::constant::bson_serialize_error_message,
     CommandError, GwStream, Response,
 };
 use bson::{to_raw_document_buf, RawDocument};
+use std::io::{ErrorKind, IoSlice};
 use tokio::io::AsyncWriteExt;
 
+/// Size of the OP_REPLY fields preceding the document (flags, cursor id,
+/// starting from and number returned).
+const REPLY_HEADER_LENGTH: usize = 20;
+
+/// Size of the OP_MSG fields preceding the document (flags and payload type).
+const MESSAGE_HEADER_LENGTH: usize = std::mem::size_of::<u32>() + std::mem::size_of::<u8>();
+
 /// Write a server response to the client stream
 pub async fn write(header: &Header, response: &Response, stream: &mut GwStream) -> Result<()> {
     write_and_flush(header, response.as_raw_document()?, stream).await
@@ -36,23 +49,21 @@ pub async fn write_and_flush(
 
         // Query is responded to with Reply
         OpCode::Query => {
-            // Write the header
-            let header = Header {
-                // Total size of the response is the bytes + standard header + reply header
-                length: (response.as_bytes().len() + Header::LENGTH + 20) as i32,
-                request_id: header.request_id,
-                response_to: header.request_id,
-                op_code: OpCode::Reply,
-            };
-            header.write_to(stream).await?;
-
-            stream.write_i32_le(0).await?; // Response flags
-            stream.write_i64_le(0).await?; // Cursor Id
-            stream.write_i32_le(0).await?; // startingFrom
-            stream.write_i32_le(1).await?; // numberReturned
-
-            stream.write_all(response.as_bytes()).await?;
-            Ok(())
+            // The reply header precedes the response document
+            let mut reply_header = [0u8; REPLY_HEADER_LENGTH];
+            reply_header[0..4].copy_from_slice(&0i32.to_le_bytes()); // Response flags
+            reply_header[4..12].copy_from_slice(&0i64.to_le_bytes()); // Cursor Id
+            reply_header[12..16].copy_from_slice(&0i32.to_le_bytes()); // startingFrom
+            reply_header[16..20].copy_from_slice(&1i32.to_le_bytes()); // numberReturned
+
+            write_body(
+                header,
+                OpCode::Reply,
+                &reply_header,
+                response.as_bytes(),
+                stream,
+            )
+            .await
         }
 
         // Insert has no response
@@ -68,33 +79,129 @@ pub async fn write_and_flush(
     Ok(())
 }
 
+/// Write a batch of an exhaust cursor, flagged with moreToCome so that the
+/// client reads the next batch without sending a getMore.
+pub async fn write_more_to_come(
+    header: &Header,
+    response: &Response,
+    stream: &mut GwStream,
+) -> Result<()> {
+    write_message_with_flags(
+        header,
+        MessageFlags::MORE_TO_COME,
+        response.as_raw_document()?,
+        stream,
+    )
+    .await?;
+    stream.flush().await?;
+    Ok(())
+}
+
 /// Serializes the Message to bytes and writes them to `writer`.
 pub async fn write_message(
     header: &Header,
     response: &RawDocument,
     writer: &mut GwStream,
 ) -> Result<()> {
-    let total_length = Header::LENGTH
-        + std::mem::size_of::<u32>()
-        + std::mem::size_of::<u8>()
-        + response.as_bytes().len(); // Message payload + status code
+    write_message_with_flags(header, MessageFlags::NONE, response, writer).await
+}
 
-    let header = Header {
-        length: total_length as i32,
-        request_id: header.request_id,
-        response_to: header.request_id,
-        op_code: OpCode::Msg,
-    };
-    header.write_to(writer).await?;
+async fn write_message_with_flags(
+    header: &Header,
+    flags: MessageFlags,
+    response: &RawDocument,
+    writer: &mut GwStream,
+) -> Result<()> {
+    // Flags, then the payload type of the single document section
+    let mut message_header = [0u8; MESSAGE_HEADER_LENGTH];
+    message_header[0..4].copy_from_slice(&flags.bits().to_le_bytes());
+    message_header[4] = 0;
+
+    write_body(
+        header,
+        OpCode::Msg,
+        &message_header,
+        response.as_bytes(),
+        writer,
+    )
+    .await
+}
 
-    // Write Flags
-    writer.write_u32_le(0).await?;
+/// Writes the header and body of a response, the body being the opcode specific
+/// prefix followed by the response document. The document is written straight from
+/// the Postgres row it was returned in, along with the headers in a vectored write.
+///
+/// When the request came compressed and the body is large enough to be worth it,
+/// the body is sent in an OP_COMPRESSED with the request's compressor.
+async fn write_body(
+    request_header: &Header,
+    op_code: OpCode,
+    prefix: &[u8],
+    document: &[u8],
+    writer: &mut GwStream,
+) -> Result<()> {
+    let body_length = prefix.len() + document.len();
+
+    if let Some(compressor) = request_header
+        .compressor
+        .filter(|_| body_length >= MIN_COMPRESSED_MESSAGE_SIZE)
+    {
+        // The document is compressed straight from the row, so a large batch is
+        // only held once in memory alongside its compressed form
+        let compressed = compressor.compress(&[prefix, document]);
+
+        let header = Header {
+            length: (Header::LENGTH + COMPRESSED_HEADER_LENGTH + compressed.len()) as i32,
+            request_id: request_header.request_id,
+            response_to: request_header.request_id,
+            op_code: OpCode::Compressed,
+            compressor: None,
+        };
+
+        let mut compressed_header = [0u8; COMPRESSED_HEADER_LENGTH];
+        compressed_header[0..4].copy_from_slice(&(op_code as i32).to_le_bytes());
+        compressed_header[4..8].copy_from_slice(&(body_length as i32).to_le_bytes());
+        compressed_header[8] = compressor as u8;
+
+        return write_all_vectored(
+            writer,
+            &mut [
+                IoSlice::new(&header.to_bytes()),
+                IoSlice::new(&compressed_header),
+                IoSlice::new(&compressed),
+            ],
+        )
+        .await;
+    }
 
-    // Write payload type + section
-    writer.write_u8(0).await?;
+    let header = Header {
+        length: (Header::LENGTH + body_length) as i32,
+        request_id: request_header.request_id,
+        response_to: request_header.request_id,
+        op_code,
+        compressor: None,
+    };
 
-    writer.write_all(response.as_bytes()).await?;
+    write_all_vectored(
+        writer,
+        &mut [
+            IoSlice::new(&header.to_bytes()),
+            IoSlice::new(prefix),
+            IoSlice::new(document),
+        ],
+    )
+    .await
+}
 
+/// Writes all of the slices, in as few writes as the stream takes them in.
+async fn write_all_vectored(writer: &mut GwStream, mut slices: &mut [IoSlice<'_>]) -> Result<()> {
+    while !slices.is_empty() {
+        let written = writer.write_vectored(slices).await?;
+        if written == 0 {
+            return Err(std::io::Error::from(ErrorKind::WriteZero).into());
+        }
+        IoSlice::advance_slices(&mut slices, written);
+    }
     Ok(())
 }
 
@@ -125,6 +232,7 @@ pub async fn write_error_without_header(
         request_id: 0,
         response_to: 0,
         op_code: OpCode::Msg,
+        compressor: None,
     };
 
     write_and_flush(&header, &response, stream).await?;
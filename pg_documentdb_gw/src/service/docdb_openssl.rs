@@ -10,7 +10,9 @@ use std::process::{Command, Stdio};
 
 use openssl::{
     error::ErrorStack,
-    ssl::{SslAcceptor, SslAcceptorBuilder, SslMethod, SslVersion},
+    ssl::{
+        SslAcceptor, SslAcceptorBuilder, SslMethod, SslOptions, SslSessionCacheMode, SslVersion,
+    },
 };
 
 use crate::{
@@ -40,6 +42,15 @@ const DEFAULT_CERT_VALIDITY_DAYS: &str = "365";
 /// Certificate subject for auto-generated certificates
 const DEFAULT_CERT_SUBJECT: &str = "/CN=localhost";
 
+/// Number of TLS 1.2 sessions kept in the server side session cache for resumption
+const SESSION_CACHE_SIZE: i32 = 20480;
+
+/// Context under which sessions are cached, sessions of other contexts are not resumed
+const SESSION_ID_CONTEXT: &[u8] = b"documentdb_gateway";
+
+/// Number of TLS 1.3 session tickets issued per full handshake
+const SESSION_TICKETS_PER_HANDSHAKE: usize = 2;
+
 /// Generates an RSA private key and self-signed certificate using OpenSSL commands.
 ///
 /// This function creates a new 2048-bit RSA private key and a corresponding
@@ -127,6 +138,10 @@ pub fn generate_auth_keys(private_key_path: &str, public_key_path: &str) -> Resu
 /// - Maximum protocol version: TLS 1.3
 /// - Server certificate and private key from the provided certificate bundle
 /// - Certificate Authority chain for certificate validation
+/// - Session resumption through a server side session cache (TLS 1.2) and session
+///   tickets (TLS 1.3), so that reconnecting clients skip the full handshake
+/// - Server cipher preference, so that hardware accelerated AES-GCM is chosen unless
+///   the client prefers ChaCha20 (e.g. clients without AES instructions)
 ///
 /// # Arguments
 ///
@@ -183,6 +198,15 @@ pub fn create_tls_acceptor(
     // SSL server settings
     ssl_acceptor.set_min_proto_version(Some(SslVersion::TLS1_2))?;
     ssl_acceptor.set_max_proto_version(Some(SslVersion::TLS1_3))?;
+    ssl_acceptor.set_options(SslOptions::CIPHER_SERVER_PREFERENCE | SslOptions::PRIORITIZE_CHACHA);
+
+    // Session resumption. The ticket keys are generated with the context, so
+    // rebuilding the acceptor rotates them.
+    ssl_acceptor.clear_options(SslOptions::NO_TICKET);
+    ssl_acceptor.set_session_id_context(SESSION_ID_CONTEXT)?;
+    ssl_acceptor.set_session_cache_mode(SslSessionCacheMode::SERVER);
+    ssl_acceptor.set_session_cache_size(SESSION_CACHE_SIZE);
+    ssl_acceptor.set_num_tickets(SESSION_TICKETS_PER_HANDSHAKE)?;
 
     Ok(ssl_acceptor)
 }
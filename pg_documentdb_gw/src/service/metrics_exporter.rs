@@ -0,0 +1,107 @@
+/*-------------------------------------------------------------------------
+ * Copyright (c) Microsoft Corporation.  All rights reserved.
+ *
+ * src/service/metrics_exporter.rs
+ *
+ *-------------------------------------------------------------------------
+ */
+
+//! A minimal HTTP endpoint serving the gateway's request metrics to a Prometheus scraper.
+
+use std::time::Duration;
+
+use tokio::{
+    io::{AsyncReadExt, AsyncWriteExt},
+    net::{TcpListener, TcpStream},
+};
+use tokio_util::sync::CancellationToken;
+
+use crate::{context::ServiceContext, error::Result};
+
+/// The path the metrics are served on
+const METRICS_PATH: &str = "/metrics";
+
+/// The largest request head read from a scraper
+const MAX_REQUEST_HEAD_SIZE: usize = 8 * 1024;
+
+/// How long a scraper has to send its request
+const REQUEST_READ_TIMEOUT: Duration = Duration::from_secs(5);
+
+const OPENMETRICS_CONTENT_TYPE: &str = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+/// Serves the request metrics on the address until the token is cancelled.
+pub async fn run_metrics_exporter(
+    address: String,
+    service_context: ServiceContext,
+    token: CancellationToken,
+) -> Result<()> {
+    let listener = TcpListener::bind(&address).await?;
+    log::info!("Serving metrics on {address}{METRICS_PATH}.");
+
+    loop {
+        tokio::select! {
+            stream_and_address = listener.accept() => {
+                let (stream, _) = match stream_and_address {
+                    Ok(stream_and_address) => stream_and_address,
+                    Err(e) => {
+                        log::warn!("Failed to accept a metrics connection: {e:?}.");
+                        continue;
+                    }
+                };
+                let service_context = service_context.clone();
+                tokio::spawn(async move {
+                    if let Err(e) = serve_scrape(stream, &service_context).await {
+                        log::warn!("Failed to serve metrics: {e:?}.");
+                    }
+                });
+            }
+            () = token.cancelled() => {
+                return Ok(())
+            }
+        }
+    }
+}
+
+async fn serve_scrape(mut stream: TcpStream, service_context: &ServiceContext) -> Result<()> {
+    let mut head = Vec::with_capacity(1024);
+    let mut buffer = [0u8; 1024];
+    let read_head = async {
+        while !head.windows(4).any(|window| window == b"\r\n\r\n") {
+            let read = stream.read(&mut buffer).await?;
+            if read == 0 || head.len() + read > MAX_REQUEST_HEAD_SIZE {
+                break;
+            }
+            head.extend_from_slice(&buffer[..read]);
+        }
+        std::io::Result::Ok(())
+    };
+    if tokio::time::timeout(REQUEST_READ_TIMEOUT, read_head)
+        .await
+        .is_err()
+    {
+        return Ok(());
+    }
+
+    let request_line = head.split(|byte| *byte == b'\r').next().unwrap_or_default();
+    let mut parts = request_line.split(|byte| *byte == b' ');
+    let is_metrics_request = parts.next() == Some(b"GET")
+        && parts.next().is_some_and(|path| {
+            path.split(|byte| *byte == b'?').next() == Some(METRICS_PATH.as_bytes())
+        });
+
+    let response = if is_metrics_request {
+        let body = service_context.request_metrics().render();
+        format!(
+            "HTTP/1.1 200 OK\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+            OPENMETRICS_CONTENT_TYPE,
+            body.len(),
+            body
+        )
+    } else {
+        "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n".to_string()
+    };
+
+    stream.write_all(response.as_bytes()).await?;
+    stream.shutdown().await?;
+    Ok(())
+}
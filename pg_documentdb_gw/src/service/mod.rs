@@ -7,6 +7,8 @@
  */
 
 mod docdb_openssl;
+mod metrics_exporter;
 mod tls;
 
+pub use metrics_exporter::run_metrics_exporter;
 pub use tls::{create_tls_acceptor_builder, TlsProvider};
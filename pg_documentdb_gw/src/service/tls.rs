@@ -19,6 +19,7 @@
 //! - **TLS Provider**: Automatic certificate reloading with background monitoring
 //! - **SSL Acceptor Configuration**: Integration with OpenSSL for secure connections
 //! - **Zero-Downtime Updates**: Hot reloading of certificates without service interruption
+//! - **Session Resumption**: Session cache and tickets, with periodic ticket key rotation
 //!
 //! # Certificate Types
 //!
@@ -59,6 +60,10 @@ const DEFAULT_PUBLIC_KEY_PATH: &str = "./cert.pem";
 /// Certificate file change monitoring interval in seconds
 const CERT_FILES_CHANGE_WATCH_INTERVAL: u64 = 60;
 
+/// Interval in seconds after which the acceptor is rebuilt to rotate its session ticket keys.
+/// Tickets issued under the previous keys fall back to a full handshake.
+const SESSION_TICKET_KEY_ROTATION_INTERVAL: u64 = 6 * 60 * 60;
+
 /// Internal certificate store that manages certificate file paths.
 ///
 /// The main difference between `CertificateStore` and `CertificateOptions` is that
@@ -258,7 +263,8 @@ impl TlsProvider {
     ///
     /// This function sets up the initial certificate bundle and starts a background
     /// task that monitors certificate files for changes and reloads them automatically.
-    /// The background task runs every 60 seconds to check for certificate updates.
+    /// The background task runs every 60 seconds to check for certificate updates, and
+    /// rebuilds the acceptor every 6 hours to rotate its session ticket keys.
     ///
     /// # Arguments
     ///
@@ -295,6 +301,9 @@ impl TlsProvider {
             let mut certs_changed_watch = tokio::time::interval(tokio::time::Duration::from_secs(
                 CERT_FILES_CHANGE_WATCH_INTERVAL,
             ));
+            let ticket_key_rotation_interval =
+                tokio::time::Duration::from_secs(SESSION_TICKET_KEY_ROTATION_INTERVAL);
+            let mut last_rebuilt = tokio::time::Instant::now();
 
             loop {
                 certs_changed_watch.tick().await;
@@ -302,12 +311,14 @@ impl TlsProvider {
                     Self::get_modified_time(&cert_store.certificate_path).await,
                     Self::get_modified_time(&cert_store.private_key_path).await,
                 ) {
-                    if !(cert_m > last_cert_modified || key_m > last_key_modified) {
+                    if cert_m > last_cert_modified || key_m > last_key_modified {
+                        log::info!("Reloading TLS certificates since they have been modified.");
+                    } else if last_rebuilt.elapsed() >= ticket_key_rotation_interval {
+                        log::info!("Rebuilding the TLS acceptor to rotate session ticket keys.");
+                    } else {
                         continue;
                     }
 
-                    log::info!("Reloading TLS certificates since they have been modified.");
-
                     match CertificateBundle::from_cert_store(&cert_store).await {
                         Ok(new_bundle) => {
                             match docdb_openssl::create_tls_acceptor(&new_bundle, acceptor_builder)
@@ -317,6 +328,7 @@ impl TlsProvider {
                                         .store(Arc::new(new_tls_acceptor.build()));
                                     last_cert_modified = cert_m;
                                     last_key_modified = key_m;
+                                    last_rebuilt = tokio::time::Instant::now();
                                     log::info!("TLS certificates reloaded.");
                                 }
                                 Err(e) => log::error!("Failed to create TLS acceptor: {e:?}."),
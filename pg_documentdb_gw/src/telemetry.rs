@@ -31,6 +31,9 @@ pub trait TelemetryProvider: Send + Sync + DynClone {
         _: &RequestTracker,
         _: &str,
     );
+
+    // Emits the duration of every TLS handshake accepted, and whether it resumed a session
+    fn emit_tls_handshake_event(&self, _: std::time::Duration, _: bool) {}
 }
 
 clone_trait_object!(TelemetryProvider);